@@ -14,6 +14,8 @@
 #pragma once
 #include "llvm/Pass.h"
 #include "dxc/HLSL/ControlDependence.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseBitVector.h"
 #include "llvm/Support/GenericDomTree.h"
 
 #include <memory>
@@ -40,6 +42,7 @@ namespace llvm {
 
 namespace hlsl {
 
+class DxilDomTreeCache;
 class DxilModule;
 class DxilSignature;
 class DxilSignatureElement;
@@ -62,7 +65,8 @@ public:
   const InputsContributingToOutputType &getInputsContributingToPCOutputs() const;
   const InputsContributingToOutputType &getPCInputsContributingToOutputs() const;
 
-  void Compute();
+  // Trees are taken from pDomTrees when given.
+  void Compute(DxilDomTreeCache *pDomTrees = nullptr);
   void Serialize();
   const std::vector<unsigned> &GetSerialized();
   const std::vector<unsigned> &GetSerialized() const;   // returns previously serialized data
@@ -98,18 +102,36 @@ private:
   // Information per entry point.
   using FunctionSetType = std::unordered_set<llvm::Function *>;
   using InstructionSetType = std::unordered_set<llvm::Instruction *>;
+  // Set of indices into EntryInfo::Sources.
+  using SourceSetType = llvm::SparseBitVector<>;
   struct EntryInfo {
     llvm::Function *pEntryFunc = nullptr;
     // Sets of functions that may be reachable from an entry.
     FunctionSetType Functions;
     // Outputs to analyze.
     InstructionSetType Outputs;
-    // Contributing instructions per output.
-    std::unordered_map<unsigned, InstructionSetType> ContributingInstructions[kNumStreams];
+    // Input and ViewID loads that outputs depend on.
+    std::vector<llvm::Instruction *> Sources;
+    // Contributing sources per output.
+    std::unordered_map<unsigned, SourceSetType> ContributingSources[kNumStreams];
 
     void Clear();
   };
 
+  // Sources reaching an instruction, memoized per strongly connected
+  // component of the contribution graph while collecting an entry.
+  struct ContributionNode {
+    unsigned DFSIndex;
+    unsigned LowLink;
+    bool bOnStack;
+    SourceSetType Sources;
+    // Node holding the sources of the whole component, once it is complete.
+    ContributionNode *pComponent;
+  };
+  std::unordered_map<llvm::Instruction *, ContributionNode> m_ContributionNodes;
+  std::vector<ContributionNode *> m_ContributionStack;
+  unsigned m_NextDFSIndex = 0;
+
   EntryInfo m_Entry;
   EntryInfo m_PCEntry;
 
@@ -117,8 +139,9 @@ private:
   using FunctionReturnSet = std::unordered_set<llvm::ReturnInst *>;
   struct FuncInfo {
     FunctionReturnSet Returns;
-    ControlDependence CtrlDep;
-    std::unique_ptr<llvm::DominatorTreeBase<llvm::BasicBlock> > pDomTree;
+    // Owned by the dominator tree cache used by Compute.
+    ControlDependence *pCtrlDep = nullptr;
+    llvm::DominatorTreeBase<llvm::BasicBlock> *pDomTree = nullptr;
     void Clear();
   };
 
@@ -136,20 +159,24 @@ private:
   void Clear();
   void DetermineMaxPackedLocation(DxilSignature &DxilSig, unsigned *pMaxSigLoc, unsigned NumStreams);
   void ComputeReachableFunctionsRec(llvm::CallGraph &CG, llvm::CallGraphNode *pNode, FunctionSetType &FuncSet);
-  void AnalyzeFunctions(EntryInfo &Entry);
+  void AnalyzeFunctions(EntryInfo &Entry, DxilDomTreeCache &DomTrees);
   void CollectValuesContributingToOutputs(EntryInfo &Entry);
-  void CollectValuesContributingToOutputRec(EntryInfo &Entry,
-                                            llvm::Value *pContributingValue,
-                                            InstructionSetType &ContributingInstructions);
-  void CollectPhiCFValuesContributingToOutputRec(llvm::PHINode *pPhi,
-                                                 EntryInfo &Entry,
-                                                 InstructionSetType &ContributingInstructions);
+  void CollectSourcesContributingToValue(EntryInfo &Entry,
+                                         llvm::Value *pContributingValue,
+                                         SourceSetType &ContributingSources);
+  ContributionNode &CollectSourcesContributingToInstRec(EntryInfo &Entry,
+                                                        llvm::Instruction *pContributingInst);
+  void CollectValuesContributingToInst(EntryInfo &Entry,
+                                       llvm::Instruction *pContributingInst,
+                                       llvm::SmallVectorImpl<llvm::Value *> &ContributingValues);
+  void CollectPhiCFValuesContributingToOutput(llvm::PHINode *pPhi,
+                                              llvm::SmallVectorImpl<llvm::Value *> &ContributingValues);
   const ValueSetType &CollectReachingDecls(llvm::Value *pValue);
   void CollectReachingDeclsRec(llvm::Value *pValue, ValueSetType &ReachingDecls, ValueSetType &Visited);
   const ValueSetType &CollectStores(llvm::Value *pValue);
   void CollectStoresRec(llvm::Value *pValue, ValueSetType &Stores, ValueSetType &Visited);
   void UpdateDynamicIndexUsageState() const;
-  void CreateViewIdSets(const std::unordered_map<unsigned, InstructionSetType> &ContributingInstructions,
+  void CreateViewIdSets(const EntryInfo &Entry, unsigned StreamId,
                         OutputsDependentOnViewIdType &OutputsDependentOnViewId,
                         InputsContributingToOutputType &InputsContributingToOutputs, bool bPC);
 
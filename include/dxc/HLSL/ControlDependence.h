@@ -27,6 +27,10 @@ namespace hlsl {
 using BasicBlockSet = std::unordered_set<llvm::BasicBlock *>;
 using PostDomRelationType = llvm::DominatorTreeBase<llvm::BasicBlock>;
 
+/// The blocks each block is control dependent on. The set of a block is
+/// computed the first time it is requested, so analyses that look at a few
+/// blocks don't pay for the whole function. The post-dominator relation
+/// passed to Compute must stay unchanged while the sets are in use.
 class ControlDependence {
 public:
   void Compute(llvm::Function *F, PostDomRelationType &PostDomRel);
@@ -36,16 +40,11 @@ public:
   void dump();
 
 private:
-  using BasicBlockVector = std::vector<llvm::BasicBlock *>;
   using ControlDependenceType = std::unordered_map<llvm::BasicBlock *, BasicBlockSet>;
 
-  llvm::Function *m_pFunc;
-  ControlDependenceType m_ControlDependence;
-  BasicBlockSet m_EmptyBBSet;
-
-  llvm::BasicBlock *GetIPostDom(PostDomRelationType &PostDomRel, llvm::BasicBlock *pBB);
-  void ComputeRevTopOrderRec(PostDomRelationType &PostDomRel, llvm::BasicBlock *pBB,
-                             BasicBlockVector &RevTopOrder, BasicBlockSet &VisitedBBs);
+  llvm::Function *m_pFunc = nullptr;
+  PostDomRelationType *m_pPostDomRel = nullptr;
+  mutable ControlDependenceType m_ControlDependence;
 };
 
 } // end of hlsl namespace
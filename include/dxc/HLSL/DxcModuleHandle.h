@@ -0,0 +1,36 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcModuleHandle.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Keeps a live module between API calls (IDxcModuleHandle).                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/dxcapi.h"
+#include <memory>
+
+namespace llvm {
+class LLVMContext;
+class Module;
+}
+
+namespace hlsl {
+
+/// Creates a handle that owns pModule and the context it was created on.
+HRESULT CreateDxcModuleHandle(_In_ IMalloc *pMalloc,
+                              std::unique_ptr<llvm::LLVMContext> pContext,
+                              std::unique_ptr<llvm::Module> pModule,
+                              _COM_Outptr_ IDxcModuleHandle **ppHandle);
+
+/// Returns the module held by a handle from CreateDxcModuleHandle, or nullptr
+/// for handles implemented elsewhere, whose module layout may differ. The
+/// module stays owned by the handle.
+llvm::Module *GetDxcModuleHandleModule(_In_ IDxcModuleHandle *pHandle);
+
+} // namespace hlsl
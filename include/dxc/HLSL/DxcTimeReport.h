@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcTimeReport.h                                                           //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Collects compile time and peak memory per phase and pass (-ftime-report), //
+// and the size of the IR after each pass (-print-ir-stats).                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/dxcapi.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/Timer.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace hlsl {
+
+class TimeReportMalloc;
+
+/// The size of a module, as counted for -print-ir-stats.
+struct TimeReportIRCounts {
+  uint64_t Functions;
+  uint64_t Blocks;
+  uint64_t Instructions;
+};
+
+/// Told about each phase and pass of a report as it starts and ends, e.g. to
+/// forward them to a tracing provider. pCounts is the size of the module
+/// after a pass when the report counts it, and null otherwise.
+class TimeReportListener {
+public:
+  virtual ~TimeReportListener() {}
+  virtual void entryStarted(const char *pName, bool isPass) = 0;
+  virtual void entryEnded(const char *pName, bool isPass,
+                          const TimeReportIRCounts *pCounts) = 0;
+};
+
+/// Forwards the phases and passes of a report to an events callback, then to
+/// another listener, if any.
+class TimeReportEventsListener : public TimeReportListener {
+  IDxcCompilerEventsCallback *m_pCallback;
+  TimeReportListener *m_pNext;
+
+public:
+  TimeReportEventsListener(IDxcCompilerEventsCallback *pCallback,
+                           TimeReportListener *pNext)
+      : m_pCallback(pCallback), m_pNext(pNext) {}
+  void entryStarted(const char *pName, bool isPass) override;
+  void entryEnded(const char *pName, bool isPass,
+                  const TimeReportIRCounts *pCounts) override;
+};
+
+/// Collects the time and peak allocation of each compilation phase and of
+/// each pass run by the legacy pass managers, for -ftime-report.
+///
+/// A report is only collected while a TimeReportScope for it is active on the
+/// thread. Memory is measured through the allocator returned by GetMalloc,
+/// which must be the thread allocator for the duration of the scope; peak
+/// values are the high-water mark of live bytes, including bytes that were
+/// already live when the phase or pass started.
+class TimeReport : public llvm::legacy::PassTimingListener {
+public:
+  TimeReport(IMalloc *pMalloc);
+  ~TimeReport() override;
+
+  IMalloc *GetMalloc();
+
+  void BeginPhase(llvm::StringRef name);
+  void EndPhase();
+
+  void passStarted(llvm::Pass *P, llvm::Module &M,
+                   llvm::Function *F) override;
+  void passEnded(llvm::Pass *P, llvm::Module &M, llvm::Function *F) override;
+
+  /// Writes the report as a JSON object; the totals cover the time since the
+  /// report was created.
+  void WriteJson(llvm::raw_ostream &OS);
+
+  /// Records each run of a phase or pass from now on, for WriteTrace.
+  void EnableTrace();
+
+  /// Writes the recorded runs in the Chrome trace event format, which
+  /// chrome://tracing, Perfetto and WPA can open; the process is named after
+  /// the shader and its entry point.
+  void WriteTrace(llvm::raw_ostream &OS, llvm::StringRef shaderName,
+                  llvm::StringRef entryPoint);
+
+  /// Records the size of the module after each run of a pass from now on,
+  /// for WriteIRStats.
+  void EnableIRStats();
+
+  /// Writes a table with the functions, blocks and instructions of the module
+  /// after each run of a pass, and the bytes allocated during the run.
+  void WriteIRStats(llvm::raw_ostream &OS);
+
+  /// Counts the module after each run of a pass from now on, for the
+  /// listener, without recording the counts for WriteIRStats.
+  void EnableIRCounts();
+
+  void SetListener(TimeReportListener *pListener) { m_pListener = pListener; }
+
+  /// Returns the report collected on this thread, or null.
+  static TimeReport *GetCurrent();
+
+private:
+  struct Entry {
+    std::string Name;
+    int Parent;
+    unsigned Count;
+    llvm::TimeRecord Time;
+    uint64_t PeakBytes;
+  };
+  typedef TimeReportIRCounts IRCounts;
+  struct ActiveEntry {
+    unsigned Index;
+    llvm::TimeRecord Start;
+    uint64_t OuterPeakBytes;
+    uint64_t StartAllocatedBytes;
+    uint64_t StartInstructions;   // Of the module.
+    IRCounts StartFunctionCounts; // Of the function a pass runs on.
+  };
+  struct TraceEvent {
+    unsigned Index;
+    bool IsPass;
+    double Start; // Seconds since the report was created.
+    double Duration;
+  };
+
+  TimeReportMalloc *m_pMalloc;
+  llvm::TimeRecord m_start;
+  std::vector<Entry> m_phases;
+  std::vector<Entry> m_passes;
+  llvm::DenseMap<const void *, unsigned> m_passIndex;
+  std::vector<ActiveEntry> m_activePhases;
+  std::vector<ActiveEntry> m_activePasses;
+  std::vector<TraceEvent> m_trace;
+  bool m_traceEnabled;
+  struct IRStatsRow {
+    unsigned Index;
+    std::string Function; // Empty for a pass that runs on the module.
+    IRCounts Counts;
+    int64_t InstructionChange;
+    uint64_t AllocatedBytes;
+  };
+  std::vector<IRStatsRow> m_irStats;
+  bool m_irStatsEnabled;
+  bool m_irCountsEnabled; // Also set by EnableIRStats.
+  const llvm::Module *m_pIRModule; // The module m_irCounts is for.
+  IRCounts m_irCounts;
+  TimeReportListener *m_pListener;
+
+  void Begin(std::vector<ActiveEntry> &active, unsigned index, bool isPass);
+  void End(std::vector<ActiveEntry> &active, bool isPass);
+  static IRCounts CountIR(const llvm::Function &F);
+  static IRCounts CountIR(const llvm::Module &M);
+};
+
+/// Makes a report current on this thread, and receives the timing of the
+/// passes run by the legacy pass managers.
+class TimeReportScope {
+  TimeReport *m_pPrior;
+  llvm::legacy::PassTimingListener *m_pPriorListener;
+
+public:
+  TimeReportScope(TimeReport *pReport);
+  ~TimeReportScope();
+};
+
+/// Times a phase of the current report, if any.
+class TimeReportPhase {
+  TimeReport *m_pReport;
+
+public:
+  TimeReportPhase(llvm::StringRef name) : m_pReport(TimeReport::GetCurrent()) {
+    if (m_pReport)
+      m_pReport->BeginPhase(name);
+  }
+  ~TimeReportPhase() {
+    if (m_pReport)
+      m_pReport->EndPhase();
+  }
+};
+
+} // namespace hlsl
@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompression.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Compression of DXIL container parts.                                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace hlsl {
+
+/// Appends Src compressed in the LZ4 block format to Out.
+void Lz4CompressBlock(const void *pSrc, size_t SrcSize,
+                      std::vector<uint8_t> &Out);
+
+/// Decompresses an LZ4 block into exactly DstSize bytes at pDst. Returns
+/// false if the block is malformed or doesn't decompress to DstSize bytes.
+bool Lz4DecompressBlock(const void *pSrc, size_t SrcSize, void *pDst,
+                        size_t DstSize);
+
+} // namespace hlsl
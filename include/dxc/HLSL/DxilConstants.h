@@ -78,6 +78,8 @@ namespace DXIL {
   const unsigned kMaxCS4XThreadGroupX	= 768;
   const unsigned kMaxCS4XThreadGroupY	= 768;
   const unsigned kMaxTGSMSize = 8192*4;
+  const unsigned kMinWaveSize = 4;
+  const unsigned kMaxWaveSize = 128;
   const unsigned kMaxGSOutputTotalScalars = 1024;
 
   const float kMaxMipLodBias = 15.99f;
@@ -239,6 +241,15 @@ namespace DXIL {
     Default = 0, // Choose default packing algorithm based on target (currently PrefixStable)
     PrefixStable, // Maintain assumption that all elements are packed in order and stable as new elements are added.
     Optimized, // Optimize packing of all elements together (all elements must be present, in the same order, for identical placement of any individual element)
+    Minimal, // Search for the packing using the fewest rows (same requirements as Optimized)
+    Invalid,
+  };
+
+  // Accuracy of the expansions of transcendental intrinsics.
+  enum class FPSpeed : unsigned {
+    Precise = 0, // Default expansions
+    Balanced, // Shorter approximations, errors up to about 6e-4
+    Fast, // Shortest approximations, errors up to about 5e-3
     Invalid,
   };
 
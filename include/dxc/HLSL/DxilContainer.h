@@ -17,10 +17,13 @@
 #include <stdint.h>
 #include <iterator>
 #include <functional>
+#include <string>
+#include <unordered_set>
+#include <vector>
 #include "dxc/HLSL/DxilConstants.h"
 
 struct IDxcContainerReflection;
-namespace llvm { class Module; }
+namespace llvm { class Function; class Module; }
 
 namespace hlsl {
 
@@ -70,18 +73,23 @@ struct DxilPartHeader {
 
 enum DxilFourCC {
   DFCC_Container                = DXIL_FOURCC('D', 'X', 'B', 'C'), // for back-compat with tools that look for DXBC containers
+  DFCC_ShaderPack               = DXIL_FOURCC('D', 'X', 'P', 'K'), // header of a shader pack of containers
   DFCC_ResourceDef              = DXIL_FOURCC('R', 'D', 'E', 'F'),
   DFCC_InputSignature           = DXIL_FOURCC('I', 'S', 'G', '1'),
   DFCC_OutputSignature          = DXIL_FOURCC('O', 'S', 'G', '1'),
   DFCC_PatchConstantSignature   = DXIL_FOURCC('P', 'S', 'G', '1'),
   DFCC_ShaderStatistics         = DXIL_FOURCC('S', 'T', 'A', 'T'),
   DFCC_ShaderDebugInfoDXIL      = DXIL_FOURCC('I', 'L', 'D', 'B'),
+  DFCC_ShaderDebugInfoCompressed = DXIL_FOURCC('I', 'L', 'D', 'Z'),
   DFCC_ShaderDebugName          = DXIL_FOURCC('I', 'L', 'D', 'N'),
+  DFCC_ShaderDebugLines         = DXIL_FOURCC('I', 'L', 'D', 'L'),
+  DFCC_ShaderSource             = DXIL_FOURCC('I', 'L', 'D', 'S'),
   DFCC_FeatureInfo              = DXIL_FOURCC('S', 'F', 'I', '0'),
   DFCC_PrivateData              = DXIL_FOURCC('P', 'R', 'I', 'V'),
   DFCC_RootSignature            = DXIL_FOURCC('R', 'T', 'S', '0'),
   DFCC_DXIL                     = DXIL_FOURCC('D', 'X', 'I', 'L'),
   DFCC_PipelineStateValidation  = DXIL_FOURCC('P', 'S', 'V', '0'),
+  DFCC_ShaderHash               = DXIL_FOURCC('H', 'A', 'S', 'H'),
 };
 
 #undef DXIL_FOURCC
@@ -223,6 +231,116 @@ struct DxilShaderDebugName {
 };
 static const size_t MinDxilShaderDebugNameSize = sizeof(DxilShaderDebugName) + 4;
 
+// The shader hash part holds an MD5 of the header and data of the other parts,
+// in container order. Parts that only hold debug or private data are left out,
+// so that stripping them keeps the hash.
+struct DxilShaderHash {
+  uint32_t Flags;       // Reserved, must be set to zero.
+  uint8_t Digest[DxilContainerHashSize];
+};
+
+// The debug lines part holds the line table and the source files of the
+// debug module, so tools can map instructions to source without loading the
+// debug bitcode. Instructions are numbered in module order, skipping calls to
+// llvm.dbg.* intrinsics.
+struct DxilDebugLinesHeader {
+  uint32_t Version;           // Set to DxilDebugLinesVersion.
+  uint32_t InstructionCount;  // Number of numbered instructions.
+  uint32_t FileCount;         // Number of source files.
+  uint32_t LineCount;         // Number of line entries.
+  uint32_t StringsSize;       // Byte count of the string data.
+  // Followed by DxilDebugLinesFile[FileCount].
+  // Followed by DxilDebugLinesEntry[LineCount], sorted by instruction.
+  // Followed by StringsSize bytes of string data.
+  // Followed by [0-3] zero bytes to align to a 4-byte boundary.
+};
+static const uint32_t DxilDebugLinesVersion = 1;
+
+struct DxilDebugLinesFile {
+  uint32_t NameOffset;        // Offset of the UTF-8 name in the string data.
+  uint32_t NameSize;
+  uint32_t ContentOffset;     // Offset of the file content in the string data.
+  uint32_t ContentSize;
+};
+
+struct DxilDebugLinesEntry {
+  uint32_t Instruction;       // Instruction number.
+  uint32_t Line;
+  uint32_t Column;
+  uint32_t FileIndex;         // DxilDebugLinesNoFile if unknown.
+};
+static const uint32_t DxilDebugLinesNoFile = 0xFFFFFFFF;
+
+enum class DxilCompressionAlgorithm : uint32_t {
+  Lz4 = 1,  // LZ4 block format.
+};
+
+// A source pack is a container of source parts, one per distinct file
+// content, for debug modules compiled with -Qsource_pack. Such a module names
+// each file in llvm.dbg.contents with an empty content and the 32 hex digit
+// MD5 of the content, so shaders that include the same files can share the
+// stored sources.
+struct DxilShaderSourceHeader {
+  uint8_t  Digest[DxilContainerHashSize]; // MD5 of the content.
+  uint32_t ContentSize;       // Byte count of the content.
+  // Followed by ContentSize bytes of content.
+  // Followed by [0-3] zero bytes to align to a 4-byte boundary.
+};
+
+// The compressed debug info part is written in place of the debug info part,
+// and holds the data of that part compressed.
+struct DxilCompressedPartHeader {
+  uint32_t Algorithm;         // DxilCompressionAlgorithm.
+  uint32_t CompressedSize;    // Byte count of the compressed data.
+  uint32_t UncompressedSize;  // Byte count of the part data decompressed.
+  // Followed by CompressedSize bytes of compressed data.
+  // Followed by [0-3] zero bytes to align to a 4-byte boundary.
+};
+
+// The statistics part holds a static estimate of the cost of the entry of a
+// shader, for telling builds apart; it says nothing about how often code
+// runs. See ComputeDxilShaderStatistics. Libraries don't have one.
+struct DxilShaderStatistics {
+  uint32_t Version;             // Set to DxilShaderStatisticsVersion.
+  uint32_t InstructionCount;    // Instructions other than phis and debug intrinsics.
+  uint32_t AluCount;            // Arithmetic, compares, conversions and other dx.op math.
+  uint32_t TranscendentalCount; // Trigonometry, exp, log, sqrt and rsqrt.
+  uint32_t SampleCount;         // Samples, gathers and LOD calculations.
+  uint32_t LoadCount;           // Resource, constant buffer and memory loads.
+  uint32_t StoreCount;          // Resource and memory stores.
+  uint32_t AtomicCount;         // Resource and groupshared atomics, counter updates.
+  uint32_t WaveCount;           // Wave and quad operations.
+  uint32_t BarrierCount;
+  uint32_t MaxLiveValues;       // Most scalar values live at once, estimating register pressure.
+  uint32_t GroupSharedBytes;    // Bytes of groupshared memory the entry uses.
+  uint32_t IndexableTempBytes;  // Bytes of dynamically indexed local arrays.
+};
+static const uint32_t DxilShaderStatisticsVersion = 1;
+
+// A shader pack holds many containers, each stored once per shader hash, so
+// that a runtime can map one file and use the containers in place. Every
+// container starts at a multiple of DxilShaderPackAlignment from the start of
+// the pack, which keeps its parts aligned.
+struct DxilShaderPackHeader {
+  uint32_t              HeaderFourCC;     // Set to DFCC_ShaderPack.
+  DxilContainerVersion  Version;
+  uint32_t              EntryCount;
+  uint32_t              Reserved;         // Must be zero.
+  uint64_t              PackSizeInBytes;  // From start of this header
+  // Followed by DxilShaderPackEntry[EntryCount], sorted by Digest.
+  // Followed by the containers, each zero padded to the alignment.
+};
+
+struct DxilShaderPackEntry {
+  uint8_t   Digest[DxilContainerHashSize]; // Shader hash of the container.
+  uint64_t  Offset;   // From start of the pack to the container.
+  uint32_t  Size;     // ContainerSizeInBytes of the container.
+  uint32_t  Reserved; // Must be zero.
+};
+static const uint16_t DxilShaderPackVersionMajor = 1;
+static const uint16_t DxilShaderPackVersionMinor = 0;
+static const uint32_t DxilShaderPackAlignment = 16;
+
 #pragma pack(pop)
 
 /// Gets a part header by index.
@@ -251,6 +369,27 @@ inline const char *GetDxilPartData(const DxilPartHeader *pPart) {
 inline char *GetDxilPartData(DxilPartHeader *pPart) {
   return reinterpret_cast<char *>(pPart + 1);
 }
+/// Returns true if the part of the given kind is covered by the shader hash.
+inline bool IsDxilShaderHashedPart(uint32_t fourCC) {
+  switch (fourCC) {
+  case DFCC_ShaderHash:
+  case DFCC_ShaderDebugInfoDXIL:
+  case DFCC_ShaderDebugInfoCompressed:
+  case DFCC_ShaderDebugName:
+  case DFCC_ShaderDebugLines:
+  case DFCC_ShaderSource:
+  case DFCC_ShaderStatistics:
+  case DFCC_PrivateData:
+    return false;
+  default:
+    return true;
+  }
+}
+
+/// Computes the digest stored in the shader hash part of a valid container.
+void ComputeDxilShaderHash(const DxilContainerHeader *pHeader,
+                           DxilShaderHash *pHash);
+
 /// Gets a part header by fourCC
 DxilPartHeader *GetDxilPartByType(DxilContainerHeader *pHeader,
                                            DxilFourCC fourCC);
@@ -262,6 +401,16 @@ GetDxilPartByType(const DxilContainerHeader *pHeader,
 /// Returns valid DxilProgramHeader. nullptr if does not exist.
 DxilProgramHeader *GetDxilProgramHeader(DxilContainerHeader *pHeader, DxilFourCC fourCC);
 
+/// Decompresses a compressed debug info part into Storage, which then holds
+/// the header and data of the debug info part it replaces.
+bool DecompressDxilDebugInfoPart(const DxilPartHeader *pPart,
+                                 std::vector<char> &Storage);
+
+/// Gets the debug info part of a container, decompressing it into Storage if
+/// the container has it compressed. nullptr if missing or malformed.
+const DxilPartHeader *GetDxilDebugInfoPart(const DxilContainerHeader *pHeader,
+                                           std::vector<char> &Storage);
+
 /// Returns valid DxilProgramHeader. nullptr if does not exist.
 const DxilProgramHeader *
 GetDxilProgramHeader(const DxilContainerHeader *pHeader, DxilFourCC fourCC);
@@ -276,6 +425,57 @@ const DxilContainerHeader *IsDxilContainerLike(const void *ptr, size_t length);
 /// Checks whether the DXIL container is valid and in-bounds.
 bool IsValidDxilContainer(const DxilContainerHeader *pHeader, size_t length);
 
+/// Gets the shader hash of a valid container: the one in its shader hash part,
+/// or the one computed from its parts if it has none.
+void GetDxilContainerShaderHash(const DxilContainerHeader *pHeader,
+                                DxilShaderHash *pHash);
+
+/// Checks whether the shader pack and every container in it are valid and
+/// in-bounds, and whether the entries are sorted.
+bool IsValidDxilShaderPack(const DxilShaderPackHeader *pHeader, size_t length);
+
+/// Gets a shader pack entry by index.
+inline const DxilShaderPackEntry *
+GetDxilShaderPackEntry(const DxilShaderPackHeader *pHeader, uint32_t index) {
+  return reinterpret_cast<const DxilShaderPackEntry *>(pHeader + 1) + index;
+}
+
+/// Gets the container of a shader pack entry by index. The container lives in
+/// the pack, and may be used from there as long as the pack is.
+inline const DxilContainerHeader *
+GetDxilShaderPackContainer(const DxilShaderPackHeader *pHeader, uint32_t index) {
+  return reinterpret_cast<const DxilContainerHeader *>(
+      reinterpret_cast<const uint8_t *>(pHeader) +
+      GetDxilShaderPackEntry(pHeader, index)->Offset);
+}
+
+/// Finds the container with the given shader hash digest in a valid shader
+/// pack. nullptr if the pack has none.
+const DxilContainerHeader *
+FindDxilShaderPackContainer(const DxilShaderPackHeader *pHeader,
+                            const uint8_t (&Digest)[DxilContainerHashSize]);
+
+/// Use this type to build a shader pack. The containers are referenced, not
+/// copied, so they must outlive the call to Write.
+class DxilShaderPackWriter {
+public:
+  typedef std::function<void(const void *pData, size_t size)> WriteFn;
+
+  /// Adds a valid container. Returns false, and adds nothing, if a container
+  /// with the same shader hash has been added.
+  bool AddContainer(const DxilContainerHeader *pContainer);
+  uint32_t GetContainerCount() const { return (uint32_t)m_Entries.size(); }
+  uint64_t GetPackSize() const;
+  /// Writes the pack, in order, through WriteData.
+  void Write(WriteFn WriteData) const;
+
+private:
+  std::vector<DxilShaderPackEntry> m_Entries;  // In the order added.
+  std::vector<const DxilContainerHeader *> m_Containers;
+  std::unordered_set<std::string> m_Digests;
+  uint64_t m_ContainersSize = 0;
+};
+
 /// Use this type as a unary predicate functor.
 struct DxilPartIsType {
   uint32_t IsFourCC;
@@ -402,6 +602,68 @@ inline bool IsDxilShaderDebugNameValid(const DxilPartHeader *pPart) {
   return true;
 }
 
+inline const DxilDebugLinesFile *
+GetDxilDebugLinesFiles(const DxilDebugLinesHeader *pHeader) {
+  return reinterpret_cast<const DxilDebugLinesFile *>(pHeader + 1);
+}
+inline const DxilDebugLinesEntry *
+GetDxilDebugLinesEntries(const DxilDebugLinesHeader *pHeader) {
+  return reinterpret_cast<const DxilDebugLinesEntry *>(
+      GetDxilDebugLinesFiles(pHeader) + pHeader->FileCount);
+}
+inline const char *GetDxilDebugLinesStrings(const DxilDebugLinesHeader *pHeader) {
+  return reinterpret_cast<const char *>(
+      GetDxilDebugLinesEntries(pHeader) + pHeader->LineCount);
+}
+
+inline bool IsDxilDebugLinesValid(const DxilPartHeader *pPart) {
+  if (pPart->PartFourCC != DFCC_ShaderDebugLines) return false;
+  if (pPart->PartSize < sizeof(DxilDebugLinesHeader)) return false;
+  const DxilDebugLinesHeader *pHeader =
+      reinterpret_cast<const DxilDebugLinesHeader *>(GetDxilPartData(pPart));
+  if (pHeader->Version != DxilDebugLinesVersion) return false;
+  uint64_t ExpectedSize = sizeof(DxilDebugLinesHeader) +
+                          (uint64_t)pHeader->FileCount * sizeof(DxilDebugLinesFile) +
+                          (uint64_t)pHeader->LineCount * sizeof(DxilDebugLinesEntry) +
+                          pHeader->StringsSize;
+  if (ExpectedSize > pPart->PartSize) return false;
+  const DxilDebugLinesFile *pFiles = GetDxilDebugLinesFiles(pHeader);
+  for (uint32_t i = 0; i < pHeader->FileCount; ++i) {
+    if ((uint64_t)pFiles[i].NameOffset + pFiles[i].NameSize > pHeader->StringsSize ||
+        (uint64_t)pFiles[i].ContentOffset + pFiles[i].ContentSize > pHeader->StringsSize)
+      return false;
+  }
+  const DxilDebugLinesEntry *pEntries = GetDxilDebugLinesEntries(pHeader);
+  for (uint32_t i = 0; i < pHeader->LineCount; ++i) {
+    if (pEntries[i].Instruction >= pHeader->InstructionCount) return false;
+    if (i > 0 && pEntries[i].Instruction <= pEntries[i - 1].Instruction) return false;
+    if (pEntries[i].FileIndex >= pHeader->FileCount &&
+        pEntries[i].FileIndex != DxilDebugLinesNoFile)
+      return false;
+  }
+  return true;
+}
+
+inline bool IsDxilShaderSourceValid(const DxilPartHeader *pPart) {
+  if (pPart->PartFourCC != DFCC_ShaderSource) return false;
+  if (pPart->PartSize < sizeof(DxilShaderSourceHeader)) return false;
+  const DxilShaderSourceHeader *pHeader =
+      reinterpret_cast<const DxilShaderSourceHeader *>(GetDxilPartData(pPart));
+  return sizeof(DxilShaderSourceHeader) + (uint64_t)pHeader->ContentSize <=
+         pPart->PartSize;
+}
+
+inline const char *
+GetDxilShaderSourceContent(const DxilShaderSourceHeader *pHeader) {
+  return reinterpret_cast<const char *>(pHeader + 1);
+}
+
+/// Finds the source with the given MD5 digest in a valid source pack.
+/// nullptr if the pack has none.
+const DxilShaderSourceHeader *
+FindDxilShaderSource(const DxilContainerHeader *pPack,
+                     const uint8_t (&Digest)[DxilContainerHashSize]);
+
 inline bool GetDxilShaderDebugName(const DxilPartHeader *pDebugNamePart,
   const char **ppUtf8Name, _Out_opt_ uint16_t *pUtf8NameLen) {
   *ppUtf8Name = nullptr;
@@ -426,7 +688,10 @@ public:
 DxilPartWriter *NewProgramSignatureWriter(const DxilModule &M, DXIL::SignatureKind Kind);
 DxilPartWriter *NewRootSignatureWriter(const RootSignatureHandle &S);
 DxilPartWriter *NewFeatureInfoWriter(const DxilModule &M);
-DxilPartWriter *NewPSVWriter(const DxilModule &M, uint32_t PSVVersion = 0);
+// The program bitcode is only needed for PSVVersion 2, which hashes it.
+DxilPartWriter *NewPSVWriter(const DxilModule &M, uint32_t PSVVersion = 0,
+                             const void *pProgramBitcode = nullptr,
+                             uint32_t ProgramBitcodeSize = 0);
 
 class DxilContainerWriter : public DxilPartWriter  {
 public:
@@ -441,7 +706,11 @@ enum class SerializeDxilFlags : uint32_t {
   None = 0,                     // No flags defined.
   IncludeDebugInfoPart = 1,     // Include the debug info part in the container.
   IncludeDebugNamePart = 2,     // Include the debug name part in the container.
-  DebugNameDependOnSource = 4   // Make the debug name depend on source (and not just final module).
+  DebugNameDependOnSource = 4,  // Make the debug name depend on source (and not just final module).
+  IncludeExtendedPSV = 8,       // Include PSVRuntimeInfo2 data in the PSV0 part.
+  IncludeShaderHashPart = 16,   // Include the shader hash part in the container.
+  CompressDebugInfoPart = 32,   // Write the debug info part compressed.
+  IncludeStatisticsPart = 64    // Include the shader statistics part in the container.
 };
 inline SerializeDxilFlags& operator |=(SerializeDxilFlags& l, const SerializeDxilFlags& r) {
   l = static_cast<SerializeDxilFlags>(static_cast<int>(l) | static_cast<int>(r));
@@ -458,13 +727,22 @@ inline SerializeDxilFlags operator~(SerializeDxilFlags l) {
   return static_cast<SerializeDxilFlags>(~static_cast<uint32_t>(l));
 }
 
+/// Serializes the container for a module. With pSidecarStream, the debug
+/// info and debug lines parts are written to a sidecar container rather than
+/// to pStream; the debug name and shader hash parts are written to both.
 void SerializeDxilContainerForModule(hlsl::DxilModule *pModule,
                                      AbstractMemoryStream *pModuleBitcode,
                                      AbstractMemoryStream *pStream,
-                                     SerializeDxilFlags Flags);
+                                     SerializeDxilFlags Flags,
+                                     AbstractMemoryStream *pSidecarStream = nullptr);
 void SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
                                      AbstractMemoryStream *pStream);
 
+/// Computes the statistics of an entry over its code and the functions it
+/// calls, including the patch constant function of a hull shader.
+void ComputeDxilShaderStatistics(hlsl::DxilModule &DM, llvm::Function *pEntry,
+                                 DxilShaderStatistics *pStats);
+
 void CreateDxcContainerReflection(IDxcContainerReflection **ppResult);
 
 // Converts uint32_t partKind to char array object.
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilDomTreeCache.h                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Dominator trees and control dependence shared between HLSL analyses.     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "dxc/HLSL/ControlDependence.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Pass.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+  class BasicBlock;
+  class Function;
+  class PassRegistry;
+}
+
+namespace hlsl {
+
+/// Computes dominator and post-dominator trees and control dependence on
+/// demand and keeps them until the CFG of their function changes. The CFG is compared when a tree
+/// is requested, so passes that edit it need not invalidate explicitly.
+/// Not thread-safe.
+class DxilDomTreeCache {
+public:
+  using DomTreeType = llvm::DominatorTreeBase<llvm::BasicBlock>;
+
+  DomTreeType &GetDomTree(llvm::Function &F);
+  DomTreeType &GetPostDomTree(llvm::Function &F);
+  ControlDependence &GetControlDependence(llvm::Function &F);
+  void Invalidate(llvm::Function *F);
+  void Clear();
+
+private:
+  struct FuncTrees {
+    // Each block followed by its successors and a null separator.
+    std::vector<const llvm::BasicBlock *> CFG;
+    std::unique_ptr<DomTreeType> pDomTree;
+    std::unique_ptr<DomTreeType> pPostDomTree;
+    std::unique_ptr<ControlDependence> pCtrlDep;
+  };
+
+  std::unordered_map<const llvm::Function *, FuncTrees> m_Trees;
+
+  FuncTrees &GetTrees(llvm::Function &F);
+};
+
+} // namespace hlsl
+
+namespace llvm {
+
+/// Holds the trees for the passes run by one pass manager. Passes use it
+/// through getAnalysisIfAvailable, and compute their own trees without it.
+class DxilDomTreeCachePass : public ImmutablePass {
+  hlsl::DxilDomTreeCache m_Cache;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  DxilDomTreeCachePass();
+  const char *getPassName() const override {
+    return "DXIL Dominator Tree Cache";
+  }
+  hlsl::DxilDomTreeCache &getCache() { return m_Cache; }
+};
+
+ImmutablePass *createDxilDomTreeCachePass();
+void initializeDxilDomTreeCachePassPass(llvm::PassRegistry &);
+
+} // namespace llvm
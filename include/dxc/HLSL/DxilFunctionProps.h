@@ -58,6 +58,8 @@ struct DxilFunctionProps {
     } PS;
   } ShaderProps;
   DXIL::ShaderKind shaderKind;
+  // Lane count the shader is specialized for, or 0 for any wave size.
+  unsigned waveSize = 0;
   bool IsPS() const     { return shaderKind == DXIL::ShaderKind::Pixel; }
   bool IsVS() const     { return shaderKind == DXIL::ShaderKind::Vertex; }
   bool IsGS() const     { return shaderKind == DXIL::ShaderKind::Geometry; }
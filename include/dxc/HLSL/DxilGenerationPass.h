@@ -11,7 +11,16 @@
 
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace llvm {
+namespace legacy {
+class FunctionPassManager;
+class PassManager;
+}
 class Module;
 class ModulePass;
 class Function;
@@ -19,9 +28,11 @@ class FunctionPass;
 class Instruction;
 class PassRegistry;
 class StringRef;
+class TargetIRAnalysis;
 }
 
 namespace hlsl {
+class DxilModule;
 class DxilResourceBase;
 class WaveSensitivityAnalysis {
 public:
@@ -37,20 +48,50 @@ class HLSLExtensionsCodegenHelper;
 bool ClearPauseResumePasses(llvm::Module &M); // true if modified; false if missing
 void GetPauseResumePasses(llvm::Module &M, llvm::StringRef &pause, llvm::StringRef &resume);
 void SetPauseResumePasses(llvm::Module &M, llvm::StringRef pause, llvm::StringRef resume);
+
+// Custom optimizer pipelines.
+// Adds the passes named by optimizer options, in the form -Odump prints
+// them, to the per-function and per-module pass managers. Returns false with
+// the option that was rejected if an option doesn't name a pass.
+bool AddOptimizerPipelinePasses(const std::vector<std::string> &options,
+                                llvm::legacy::FunctionPassManager &FPM,
+                                llvm::legacy::PassManager &MPM,
+                                std::string &invalidOption);
+
+// Early depth-stencil promotion.
+// Returns true if forcing early depth-stencil can't change what the pixel
+// shader of DM does; otherwise sets *pReason to what it does that could.
+bool CanForceEarlyDepthStencil(DxilModule &DM, const char **pReason);
 }
 
 namespace llvm {
 
 /// \brief Create and return a pass that tranform the module into a DXIL module
 /// Note that this pass is designed for use with the legacy pass manager.
-ModulePass *createDxilCondenseResourcesPass();
+ModulePass *createDxilCondenseResourcesPass(bool Allocated = false);
 ModulePass *createDxilEliminateOutputDynamicIndexingPass();
 ModulePass *createDxilGenerationPass(bool NotOptimized, hlsl::HLSLExtensionsCodegenHelper *extensionsHelper);
 ModulePass *createHLEmitMetadataPass();
 ModulePass *createHLEnsureMetadataPass();
 ModulePass *createDxilFinalizeModulePass();
 ModulePass *createDxilEmitMetadataPass();
-FunctionPass *createDxilExpandTrigIntrinsicsPass();
+FunctionPass *createDxilExpandTrigIntrinsicsPass(unsigned FPSpeed = 0);
+FunctionPass *createDxilCoalesceCBufferLoadsPass();
+FunctionPass *createDxilCombineBufferAccessesPass();
+FunctionPass *createDxilUniformBranchHintsPass();
+FunctionPass *createDxilAutoFlattenPass();
+FunctionPass *createDxilWaveAggregateAtomicsPass();
+FunctionPass *createDxilDemotePrecisionPass();
+ModulePass *createDxilPromoteEarlyDepthStencilPass();
+ModulePass *createDxilFormGatherPass();
+ModulePass *createDxilMarkReadNoneLoadsPass();
+FunctionPass *createDxilHoistHandlesPass();
+ModulePass *createDxilCompactContextPass();
+FunctionPass *createDxilRematerializePass();
+FunctionPass *createDxilEliminateRedundantBarriersPass();
+ModulePass *createDxilPackGroupSharedPass(bool PadForBanks = false);
+ModulePass *createDxilSpecializeConstantsPass(
+    const std::unordered_map<std::string, uint32_t> &Values);
 ModulePass *createDxilConvergentMarkPass();
 ModulePass *createDxilConvergentClearPass();
 ModulePass *createDxilLoadMetadataPass();
@@ -77,6 +118,21 @@ void initializeHLEmitMetadataPass(llvm::PassRegistry&);
 void initializeDxilFinalizeModulePass(llvm::PassRegistry&);
 void initializeDxilEmitMetadataPass(llvm::PassRegistry&);
 void initializeDxilExpandTrigIntrinsicsPass(llvm::PassRegistry&);
+void initializeDxilCoalesceCBufferLoadsPass(llvm::PassRegistry&);
+void initializeDxilCombineBufferAccessesPass(llvm::PassRegistry&);
+void initializeDxilUniformBranchHintsPass(llvm::PassRegistry&);
+void initializeDxilAutoFlattenPass(llvm::PassRegistry&);
+void initializeDxilWaveAggregateAtomicsPass(llvm::PassRegistry&);
+void initializeDxilDemotePrecisionPass(llvm::PassRegistry&);
+void initializeDxilPromoteEarlyDepthStencilPass(llvm::PassRegistry&);
+void initializeDxilFormGatherPass(llvm::PassRegistry&);
+void initializeDxilMarkReadNoneLoadsPass(llvm::PassRegistry&);
+void initializeDxilHoistHandlesPass(llvm::PassRegistry&);
+void initializeDxilCompactContextPass(llvm::PassRegistry&);
+void initializeDxilRematerializePass(llvm::PassRegistry&);
+void initializeDxilEliminateRedundantBarriersPass(llvm::PassRegistry&);
+void initializeDxilPackGroupSharedPass(llvm::PassRegistry&);
+void initializeDxilSpecializeConstantsPass(llvm::PassRegistry&);
 void initializeDxilLoadMetadataPass(llvm::PassRegistry&);
 void initializeDxilDeadFunctionEliminationPass(llvm::PassRegistry&);
 void initializeHLDeadFunctionEliminationPass(llvm::PassRegistry&);
@@ -97,4 +153,8 @@ void initializeResumePassesPass(llvm::PassRegistry&);
 
 bool AreDxilResourcesDense(llvm::Module *M, hlsl::DxilResourceBase **ppNonDense);
 
+/// Returns a TargetIRAnalysis with the DXIL cost model for functions of
+/// modules that have a DxilModule, and generic costs otherwise.
+TargetIRAnalysis createDxilTargetIRAnalysis();
+
 }
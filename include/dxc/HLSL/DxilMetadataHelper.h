@@ -14,6 +14,7 @@
 #include "dxc/HLSL/DxilConstants.h"
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace llvm {
@@ -171,6 +172,7 @@ public:
   static const char kDxilTypeSystemHelperVariablePrefix[];
   static const unsigned kDxilTypeSystemStructTag                  = 0;
   static const unsigned kDxilTypeSystemFunctionTag                = 1;
+  static const unsigned kDxilTypeSystemCompactTag                 = 2;  // Struct and function annotations as binary records.
   static const unsigned kDxilFieldAnnotationSNormTag              = 0;
   static const unsigned kDxilFieldAnnotationUNormTag              = 1;
   static const unsigned kDxilFieldAnnotationMatrixTag             = 2;
@@ -184,6 +186,12 @@ public:
   // Control flow hint.
   static const char kDxilControlFlowHintMDName[];
 
+  // Uniform branch hint; the condition is the same in all active lanes.
+  static const char kDxilUniformBranchMDName[];
+
+  // Specializable constants, as !{!"name", default} in $Globals.
+  static const char kDxilSpecializableMDName[];
+
   // Resource attribute.
   static const char kHLDxilResourceAttributeMDName[];
   static const unsigned kHLDxilResourceAttributeNumFields = 2;
@@ -203,6 +211,7 @@ public:
   static const unsigned kDxilDSStateTag         = 2;
   static const unsigned kDxilHSStateTag         = 3;
   static const unsigned kDxilNumThreadsTag      = 4;
+  static const unsigned kDxilWaveSizeTag        = 5;
 
   // GSState.
   static const unsigned kDxilGSStateNumFields               = 5;
@@ -327,6 +336,10 @@ public:
   void EmitDxilTypeSystem(DxilTypeSystem &TypeSystem, std::vector<llvm::GlobalVariable *> &LLVMUsed);
   void LoadDxilTypeSystemNode(const llvm::MDTuple &MDT, DxilTypeSystem &TypeSystem);
   void LoadDxilTypeSystem(DxilTypeSystem &TypeSystem);
+  // Emit annotations as one tuple of binary records instead of one tuple per
+  // annotation. Set when the loaded type system was compact.
+  void SetCompactTypeSystem(bool bCompact);
+  bool IsCompactTypeSystem() const;
   llvm::Metadata *EmitDxilStructAnnotation(const DxilStructAnnotation &SA);
   void LoadDxilStructAnnotation(const llvm::MDOperand &MDO, DxilStructAnnotation &SA);
   llvm::Metadata *EmitDxilFieldAnnotation(const DxilFieldAnnotation &FA);
@@ -411,6 +424,19 @@ private:
   llvm::Module *m_pModule;
   const ShaderModel *m_pSM;
   std::unique_ptr<ExtraPropertyHelper> m_ExtraPropertyHelper;
+
+  bool m_bCompactTypeSystem;
+
+  void DecodeDxilFieldAnnotation(const llvm::MDTuple *pTupleMD,
+                                 DxilFieldAnnotation &FA);
+  void EmitDxilTypeSystemCompact(DxilTypeSystem &TypeSystem);
+  void LoadDxilTypeSystemCompact(const llvm::MDTuple &MDT,
+                                 DxilTypeSystem &TypeSystem);
+
+  // Decoded field annotations by node. Identical annotations share one
+  // uniqued node, so most struct fields and parameters hit this.
+  std::unordered_map<const llvm::MDNode *, std::unique_ptr<DxilFieldAnnotation>>
+      m_FieldAnnotationCache;
 };
 
 
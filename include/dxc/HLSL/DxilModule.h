@@ -113,6 +113,9 @@ public:
 
   void RemoveUnusedResources();
   void RemoveFunction(llvm::Function *F);
+  // Shrink resource arrays indexed only by constants to the indices used.
+  void SetTrimResourceRanges(bool bTrim) { m_bTrimResourceRanges = bTrim; }
+  bool GetTrimResourceRanges() const { return m_bTrimResourceRanges; }
 
   // Signatures.
   DxilSignature &GetInputSignature();
@@ -140,6 +143,9 @@ public:
 
   // DXIL type system.
   DxilTypeSystem &GetTypeSystem();
+  // Emit type annotations as binary records instead of metadata tuples.
+  void SetCompactTypeAnnotations(bool bCompact);
+  bool GetCompactTypeAnnotations() const;
 
   /// Emit llvm.used array to make sure that optimizations do not remove unreferenced globals.
   void EmitLLVMUsed();
@@ -323,6 +329,10 @@ public:
 
   ShaderFlags m_ShaderFlags;
   void CollectShaderFlags(ShaderFlags &Flags);
+  // Forget the flags collected for a function's instructions, or for all
+  // functions, after changing it.
+  void InvalidateShaderFlags(const llvm::Function *F);
+  void InvalidateShaderFlags();
 
   // Check if DxilModule contains multi component UAV Loads.
   // This funciton must be called after unused resources are removed from DxilModule
@@ -363,6 +373,10 @@ public:
   float GetMaxTessellationFactor() const;
   void SetMaxTessellationFactor(float MaxTessellationFactor);
 
+  // Wave size the shader is specialized for, or 0 for any.
+  unsigned GetWaveSize() const;
+  void SetWaveSize(unsigned WaveSize);
+
   void SetShaderProperties(DxilFunctionProps *props);
 
   // Shader resource information only needed before linking.
@@ -382,6 +396,7 @@ private:
   std::vector<std::unique_ptr<DxilResource> > m_UAVs;
   std::vector<std::unique_ptr<DxilCBuffer> > m_CBuffers;
   std::vector<std::unique_ptr<DxilSampler> > m_Samplers;
+  bool m_bTrimResourceRanges;
 
   // Save resource link for library, when link replace it with real resource ID.
   std::vector<ResourceLinkInfo> m_SRVsLinkInfo;
@@ -406,6 +421,14 @@ private:
   DXIL::TessellatorOutputPrimitive m_TessellatorOutputPrimitive;
   float m_MaxTessellationFactor;
 
+  unsigned m_WaveSize;
+
+  // Flags needed by the instructions of each function.
+  class ShaderFlagsCache;
+  std::unique_ptr<ShaderFlagsCache> m_pShaderFlagsCache;
+  ShaderFlags CollectFunctionShaderFlags(llvm::Function &F,
+                                         bool hasMulticomponentUAVLoadsBackCompat);
+
 private:
   llvm::LLVMContext &m_Ctx;
   llvm::Module *m_pModule;
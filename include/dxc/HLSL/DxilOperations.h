@@ -126,6 +126,9 @@ private:
   OpCodeCacheItem m_OpCodeClassCache[(unsigned)OpCodeClass::NumOpClasses];
   std::unordered_map<const llvm::Function *, OpCodeClass> m_FunctionToOpClass;
   void UpdateCache(OpCodeClass opClass, unsigned typeSlot, llvm::Function *F);
+  // Looks up the opcode class of a cached function from the opcode of its
+  // first call. Returns false if F has no such call or is not cached.
+  bool GetCachedOpCodeClass(const llvm::Function *F, OpCodeClass &opClass) const;
 private:
   // Static properties.
   struct OpCodeProperty {
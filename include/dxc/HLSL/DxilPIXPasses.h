@@ -20,6 +20,8 @@ ModulePass *createDxilReduceMSAAToSingleSamplePass();
 ModulePass *createDxilForceEarlyZPass();
 ModulePass *createDxilDebugInstrumentationPass();
 ModulePass *createDxilShaderAccessTrackingPass();
+ModulePass *createDxilAddBlockCountersPass();
+ModulePass *createDxilApplyBlockProfilePass();
 
 void initializeDxilAddPixelHitInstrumentationPass(llvm::PassRegistry&);
 void initializeDxilOutputColorBecomesConstantPass(llvm::PassRegistry&);
@@ -28,5 +30,7 @@ void initializeDxilReduceMSAAToSingleSamplePass(llvm::PassRegistry&);
 void initializeDxilForceEarlyZPass(llvm::PassRegistry&);
 void initializeDxilDebugInstrumentationPass(llvm::PassRegistry&);
 void initializeDxilShaderAccessTrackingPass(llvm::PassRegistry&);
+void initializeDxilAddBlockCountersPass(llvm::PassRegistry&);
+void initializeDxilApplyBlockProfilePass(llvm::PassRegistry&);
 
 }
@@ -86,6 +86,16 @@ struct PSVRuntimeInfo1 : public PSVRuntimeInfo0
   uint8_t SigOutputVectors[4];      // Array for GS Stream Out Index
 };
 
+// Only present when requested at compile time; lets the runtime key PSO caches
+// and build input layouts without reflecting the rest of the container.
+struct PSVRuntimeInfo2 : public PSVRuntimeInfo1
+{
+  uint8_t ShaderHash[16];           // MD5 of the DXIL program bitcode
+  uint8_t ResourceBindingHash[16];  // MD5 of the PSVResourceBindInfo table
+  uint8_t InputLayoutHash[16];      // MD5 of the input layout elements, with names resolved
+  uint32_t InputLayoutElements;     // PSVInputLayoutElement count, VS only
+};
+
 enum class PSVResourceType
 {
   Invalid = 0,
@@ -249,6 +259,18 @@ struct PSVSignatureElement0
   uint8_t Reserved;
 };
 
+// One entry per input register a vertex shader reads from the input assembler,
+// in signature order; system values generated by the runtime are excluded.
+struct PSVInputLayoutElement0
+{
+  uint32_t SemanticName;          // Offset into PSVStringTable, never empty
+  uint32_t SemanticIndex;
+  uint8_t Register;               // Input register the element is read from
+  uint8_t ColsAndStart;           // 0:4 = Cols, 4:6 = StartCol
+  uint8_t ComponentType;          // DxilProgramSigCompType
+  uint8_t Reserved;
+};
+
 // Provides convenient access to packed PSVSignatureElementN structure
 class PSVSignatureElement
 {
@@ -286,7 +308,8 @@ struct PSVInitInfo
     SigOutputElements(0),
     SigPatchConstantElements(0),
     SigInputVectors(0),
-    SigPatchConstantVectors(0)
+    SigPatchConstantVectors(0),
+    InputLayoutElements(0)
   {}
   uint32_t PSVVersion;
   uint32_t ResourceCount;
@@ -300,6 +323,7 @@ struct PSVInitInfo
   uint8_t SigInputVectors;
   uint8_t SigPatchConstantVectors;
   uint8_t SigOutputVectors[4] = {0, 0, 0, 0};
+  uint32_t InputLayoutElements;
 };
 
 class DxilPipelineStateValidation
@@ -307,6 +331,7 @@ class DxilPipelineStateValidation
   uint32_t m_uPSVRuntimeInfoSize;
   PSVRuntimeInfo0* m_pPSVRuntimeInfo0;
   PSVRuntimeInfo1* m_pPSVRuntimeInfo1;
+  PSVRuntimeInfo2* m_pPSVRuntimeInfo2;
   uint32_t m_uResourceCount;
   uint32_t m_uPSVResourceBindInfoSize;
   void* m_pPSVResourceBindInfo;
@@ -321,12 +346,15 @@ class DxilPipelineStateValidation
   uint32_t* m_pInputToOutputTable;
   uint32_t* m_pInputToPCOutputTable;
   uint32_t* m_pPCInputToOutputTable;
+  uint32_t m_uPSVInputLayoutElementSize;
+  void* m_pInputLayoutElements;
 
 public:
   DxilPipelineStateValidation() : 
     m_uPSVRuntimeInfoSize(0),
     m_pPSVRuntimeInfo0(nullptr),
     m_pPSVRuntimeInfo1(nullptr),
+    m_pPSVRuntimeInfo2(nullptr),
     m_uResourceCount(0),
     m_uPSVResourceBindInfoSize(0),
     m_pPSVResourceBindInfo(nullptr),
@@ -340,7 +368,9 @@ public:
     m_pViewIDPCOutputMask(nullptr),
     m_pInputToOutputTable(nullptr),
     m_pInputToPCOutputTable(nullptr),
-    m_pPCInputToOutputTable(nullptr)
+    m_pPCInputToOutputTable(nullptr),
+    m_uPSVInputLayoutElementSize(0),
+    m_pInputLayoutElements(nullptr)
   {
   }
 
@@ -381,6 +411,9 @@ public:
   //    If (DS and SigOutputVectors[0] and SigPatchConstantVectors non-zero):
   //      { PSVComputeInputOutputTableSize(SigPatchConstantVectors, SigOutputVectors[0]) }
   //        - Outputs affected by patch constant inputs as a table of bitmasks
+  // If PSVRuntimeInfo2 and InputLayoutElements:
+  //    uint32_t PSVInputLayoutElement_size
+  //    { PSVInputLayoutElementN structure } * InputLayoutElements
   // returns true if no errors occurred.
   bool InitFromPSV0(const void* pBits, uint32_t size) {
     if(!(pBits != nullptr)) return false;
@@ -395,6 +428,8 @@ public:
     m_pPSVRuntimeInfo0 = const_cast<PSVRuntimeInfo0*>((const PSVRuntimeInfo0*)pCurBits);
     if(m_uPSVRuntimeInfoSize >= sizeof(PSVRuntimeInfo1))
       m_pPSVRuntimeInfo1 = const_cast<PSVRuntimeInfo1*>((const PSVRuntimeInfo1*)pCurBits);
+    if(m_uPSVRuntimeInfoSize >= sizeof(PSVRuntimeInfo2))
+      m_pPSVRuntimeInfo2 = const_cast<PSVRuntimeInfo2*>((const PSVRuntimeInfo2*)pCurBits);
     pCurBits += m_uPSVRuntimeInfoSize;
     m_uResourceCount = *(const uint32_t*)pCurBits;
     pCurBits += sizeof(uint32_t);
@@ -497,6 +532,20 @@ public:
         pCurBits += PSVComputeInputOutputTableSize(m_pPSVRuntimeInfo1->SigPatchConstantVectors, m_pPSVRuntimeInfo1->SigOutputVectors[0]);
       }
     }
+
+    // Input layout
+    if (m_pPSVRuntimeInfo2 && m_pPSVRuntimeInfo2->InputLayoutElements) {
+      minsize += sizeof(uint32_t);
+      if (!(size >= minsize)) return false;
+      m_uPSVInputLayoutElementSize = *(uint32_t*)pCurBits;
+      if (m_uPSVInputLayoutElementSize < sizeof(PSVInputLayoutElement0))
+        return false;   // Illegal: Size smaller than first version
+      pCurBits += sizeof(uint32_t);
+      minsize += m_uPSVInputLayoutElementSize * m_pPSVRuntimeInfo2->InputLayoutElements;
+      if (!(size >= minsize)) return false;
+      m_pInputLayoutElements = (PSVInputLayoutElement0*)pCurBits;
+      pCurBits += m_uPSVInputLayoutElementSize * m_pPSVRuntimeInfo2->InputLayoutElements;
+    }
     return true;
   }
 
@@ -511,15 +560,19 @@ public:
 
   bool InitNew(const PSVInitInfo &initInfo, void *pBuffer, uint32_t *pSize) {
     if(!(pSize)) return false;
-    if (initInfo.PSVVersion > 1) return false;
+    if (initInfo.PSVVersion > 2) return false;
 
     // Versioned structure sizes
     m_uPSVRuntimeInfoSize = sizeof(PSVRuntimeInfo0);
     m_uPSVResourceBindInfoSize = sizeof(PSVResourceBindInfo0);
     m_uPSVSignatureElementSize = sizeof(PSVSignatureElement0);
+    m_uPSVInputLayoutElementSize = sizeof(PSVInputLayoutElement0);
     if (initInfo.PSVVersion > 0) {
       m_uPSVRuntimeInfoSize = sizeof(PSVRuntimeInfo1);
     }
+    if (initInfo.PSVVersion > 1) {
+      m_uPSVRuntimeInfoSize = sizeof(PSVRuntimeInfo2);
+    }
 
     // PSVVersion 0
     uint32_t size = m_uPSVRuntimeInfoSize + sizeof(uint32_t) * 2;
@@ -562,6 +615,12 @@ public:
       }
     }
 
+    // PSVVersion 2
+    if (initInfo.PSVVersion > 1 && initInfo.InputLayoutElements) {
+      size += sizeof(uint32_t);   // PSVInputLayoutElement_size
+      size += m_uPSVInputLayoutElementSize * initInfo.InputLayoutElements;
+    }
+
     // Validate or return required size
     if (pBuffer) {
       if(!(*pSize >= size)) return false;
@@ -579,6 +638,9 @@ public:
     if (initInfo.PSVVersion > 0) {
       m_pPSVRuntimeInfo1 = (PSVRuntimeInfo1*)pCurBits;
     }
+    if (initInfo.PSVVersion > 1) {
+      m_pPSVRuntimeInfo2 = (PSVRuntimeInfo2*)pCurBits;
+    }
     pCurBits += m_uPSVRuntimeInfoSize;
 
     // Set resource info:
@@ -673,6 +735,17 @@ public:
       }
     }
 
+    // PSVVersion 2
+    if (initInfo.PSVVersion > 1) {
+      m_pPSVRuntimeInfo2->InputLayoutElements = initInfo.InputLayoutElements;
+      if (m_pPSVRuntimeInfo2->InputLayoutElements) {
+        *(uint32_t*)pCurBits = m_uPSVInputLayoutElementSize;
+        pCurBits += sizeof(uint32_t);
+        m_pInputLayoutElements = (PSVInputLayoutElement0*)pCurBits;
+        pCurBits += m_uPSVInputLayoutElementSize * m_pPSVRuntimeInfo2->InputLayoutElements;
+      }
+    }
+
     return true;
   }
 
@@ -684,6 +757,10 @@ public:
     return m_pPSVRuntimeInfo1;
   }
 
+  PSVRuntimeInfo2* GetPSVRuntimeInfo2() const {
+    return m_pPSVRuntimeInfo2;
+  }
+
   uint32_t GetBindCount() const {
     return m_uResourceCount;
   }
@@ -743,6 +820,21 @@ public:
     }
     return nullptr;
   }
+  // Input layout access
+  uint32_t GetInputLayoutElements() const {
+    if (m_pPSVRuntimeInfo2)
+      return m_pPSVRuntimeInfo2->InputLayoutElements;
+    return 0;
+  }
+  PSVInputLayoutElement0* GetInputLayoutElement0(uint32_t index) const {
+    if (m_pPSVRuntimeInfo2 && m_pInputLayoutElements &&
+        index < m_pPSVRuntimeInfo2->InputLayoutElements &&
+        sizeof(PSVInputLayoutElement0) <= m_uPSVInputLayoutElementSize) {
+      return (PSVInputLayoutElement0*)((uint8_t*)m_pInputLayoutElements +
+        (index * m_uPSVInputLayoutElementSize));
+    }
+    return nullptr;
+  }
   // More convenient wrapper:
   PSVSignatureElement GetSignatureElement(PSVSignatureElement0* pElement0) const {
     return PSVSignatureElement(m_StringTable, m_SemanticIndexTable, pElement0);
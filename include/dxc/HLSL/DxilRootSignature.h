@@ -357,6 +357,28 @@ bool VerifyRootSignatureWithShaderPSV(_In_ const DxilVersionedRootSignatureDesc
                                       _In_ uint32_t PSVSize,
                                       _In_ llvm::raw_ostream &DiagStream);
 
+// Root signatures are interned for the life of the process, since a handful
+// of them is typically shared by many shaders.
+
+// Finds the serialized root signature compiled earlier from the same source.
+bool FindCompiledRootSignature(_In_reads_bytes_(SourceSize) const char *pSource,
+                               _In_ uint32_t SourceSize,
+                               _In_ DxilRootSignatureVersion Version,
+                               _COM_Outptr_ IDxcBlob **ppSerialized);
+void AddCompiledRootSignature(_In_reads_bytes_(SourceSize) const char *pSource,
+                              _In_ uint32_t SourceSize,
+                              _In_ DxilRootSignatureVersion Version,
+                              _In_ IDxcBlob *pSerialized);
+
+// Same as VerifyRootSignatureWithShaderPSV, but the serialized root signature
+// is only deserialized and verified the first time it is seen.
+bool VerifySerializedRootSignatureWithShaderPSV(_In_reads_bytes_(RSSize) const void *pRSData,
+                                                _In_ uint32_t RSSize,
+                                                _In_ DXIL::ShaderKind ShaderKind,
+                                                _In_reads_bytes_(PSVSize) const void *pPSVData,
+                                                _In_ uint32_t PSVSize,
+                                                _In_ llvm::raw_ostream &DiagStream);
+
 } // namespace hlsl
 
 #endif // __DXC_ROOTSIGNATURE__
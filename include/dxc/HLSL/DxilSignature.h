@@ -40,9 +40,16 @@ public:
   const DxilSignatureElement &GetElement(unsigned idx) const;
   const std::vector<std::unique_ptr<DxilSignatureElement> > &GetElements() const;
 
+  // Removes the elements flagged in removed and renumbers the rest in order.
+  // Returns the new ID of each old element, or UINT_MAX for removed ones.
+  std::vector<unsigned> RemoveElements(const std::vector<bool> &removed);
+
   // Packs the signature elements per DXIL constraints and returns the number of rows used for the signature
   unsigned PackElements(DXIL::PackingStrategy packing);
 
+  // Returns the number of rows PackElements would use with the given strategy, leaving elements where they are
+  unsigned GetPackedRowCount(DXIL::PackingStrategy packing) const;
+
   // Returns true if all signature elements that should be allocated are allocated
   bool IsFullyAllocated() const;
 
@@ -141,9 +141,18 @@ public:
   // Pack in a prefix-stable way - appended elements do not affect positions of prior elements.
   unsigned PackPrefixStable(std::vector<PackElement*> elements, unsigned startRow, unsigned numRows);
 
+  // Search for the packing using the fewest rows, starting from the PackOptimized result.
+  // The search gives up after maxNodes placements and keeps the best packing found so far.
+  static const unsigned kDefaultMaxSearchNodes = 1 << 16;
+  unsigned PackMinimal(std::vector<PackElement*> elements, unsigned startRow, unsigned numRows,
+                       unsigned maxNodes = kDefaultMaxSearchNodes);
+
   bool UseMinPrecision() const { return m_bUseMinPrecision; }
 
 protected:
+  struct PackSearch;
+  void SearchPlacements(PackSearch &search, unsigned unit, unsigned rowsUsed, unsigned compsPlaced);
+
   std::vector<PackedRegister> m_Registers;
   bool m_bIgnoreIndexing;
   bool m_bUseMinPrecision;
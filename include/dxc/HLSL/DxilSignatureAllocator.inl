@@ -493,5 +493,162 @@ unsigned DxilSignatureAllocator::PackPrefixStable(std::vector<PackElement*> elem
   return rowsUsed;
 }
 
+struct DxilSignatureAllocator::PackSearch {
+  struct Unit {
+    Unit(PackElement *SE) : pElement(SE), row(0), col(0), bestRow(0), bestCol(0) {}
+    PackElement *pElement;              // element placed by the search
+    std::vector<PackElement*> members;  // clip/cull elements sharing pElement's register
+    unsigned row, col;                  // placement on the current branch
+    unsigned bestRow, bestCol;          // placement in the best packing found
+  };
+  std::vector<Unit> units;
+  std::vector<unsigned> remainingComps; // components in units[i] onwards
+  unsigned startRow, numRows;
+  unsigned bestRows;
+  unsigned nodes, maxNodes;
+};
+
+void DxilSignatureAllocator::SearchPlacements(PackSearch &search, unsigned unit, unsigned rowsUsed, unsigned compsPlaced) {
+  if (unit == search.units.size()) {
+    // Only packings using fewer rows than the best one get this far.
+    search.bestRows = rowsUsed;
+    for (auto &U : search.units) {
+      U.bestRow = U.row;
+      U.bestCol = U.col;
+    }
+    return;
+  }
+
+  // Bound: a row holds at most four components.
+  unsigned comps = compsPlaced + search.remainingComps[unit];
+  if (std::max(rowsUsed, search.startRow + (comps + 3) / 4) >= search.bestRows)
+    return;
+
+  PackSearch::Unit &U = search.units[unit];
+  PackElement *SE = U.pElement;
+  unsigned rows = SE->GetRows();
+  unsigned cols = SE->GetCols();
+  if (rows > search.numRows)
+    return;
+
+  // Rows past rowsUsed are all empty, so only the first of them is worth trying.
+  unsigned lastRow = std::min(rowsUsed, search.startRow + search.numRows - rows);
+  for (unsigned row = search.startRow; row <= lastRow; ++row) {
+    unsigned newRowsUsed = std::max(rowsUsed, row + rows);
+    if (newRowsUsed >= search.bestRows)
+      break;
+    if (DetectRowConflict(SE, row))
+      continue;
+    for (unsigned col = 0; col <= 4 - cols; ++col) {
+      if (DetectColConflict(SE, row, col))
+        continue;
+      if (search.nodes++ >= search.maxNodes)
+        return;
+      std::vector<PackedRegister> saved(m_Registers.begin() + row, m_Registers.begin() + row + rows);
+      PlaceElement(SE, row, col);
+      U.row = row;
+      U.col = col;
+      SearchPlacements(search, unit + 1, newRowsUsed, compsPlaced + rows * cols);
+      std::copy(saved.begin(), saved.end(), m_Registers.begin() + row);
+      // The best packing may have improved past this row.
+      if (newRowsUsed >= search.bestRows)
+        break;
+    }
+  }
+}
+
+unsigned DxilSignatureAllocator::PackMinimal(std::vector<PackElement*> elements, unsigned startRow, unsigned numRows, unsigned maxNodes) {
+  // Branch and bound over element placements, seeded with the PackOptimized result.
+  std::vector<PackedRegister> initialRegisters = m_Registers;
+  unsigned rowsUsed = PackOptimized(elements, startRow, numRows);
+  for (auto &SE : elements) {
+    // Allocation failures should be caught by IsFullyAllocated()
+    if (!SE->IsAllocated())
+      return rowsUsed;
+  }
+
+  // Clip/cull elements sharing a register move together, which keeps them
+  // within the two registers they may occupy.
+  PackSearch search;
+  DummyElement clipcullTempElements[2];
+  unsigned clipcullRegUsed = 0;
+  for (auto &SE : elements) {
+    if (SE->GetKind() != DXIL::SemanticKind::ClipDistance && SE->GetKind() != DXIL::SemanticKind::CullDistance) {
+      search.units.emplace_back(SE);
+      continue;
+    }
+    unsigned i = 0;
+    while (i < clipcullRegUsed && clipcullTempElements[i].row != SE->GetStartRow())
+      ++i;
+    if (i == clipcullRegUsed) {
+      if (clipcullRegUsed == 2)
+        return rowsUsed;
+      ++clipcullRegUsed;
+      clipcullTempElements[i].kind = SE->GetKind();
+      clipcullTempElements[i].interpolation = SE->GetInterpolationMode();
+      clipcullTempElements[i].interpretation = SE->GetInterpretation();
+      clipcullTempElements[i].dataBitWidth = SE->GetDataBitWidth();
+      clipcullTempElements[i].rows = 1;
+      clipcullTempElements[i].cols = SE->GetCols();
+      clipcullTempElements[i].SetLocation(SE->GetStartRow(), SE->GetStartCol());
+      search.units.emplace_back(&clipcullTempElements[i]);
+      search.units.back().members.push_back(SE);
+      continue;
+    }
+    DummyElement &temp = clipcullTempElements[i];
+    unsigned startCol = std::min(temp.col, SE->GetStartCol());
+    unsigned endCol = std::max(temp.col + temp.cols, SE->GetStartCol() + SE->GetCols());
+    temp.col = startCol;
+    temp.cols = endCol - startCol;
+    for (auto &U : search.units) {
+      if (U.pElement == &temp)
+        U.members.push_back(SE);
+    }
+  }
+
+  // Place the largest elements first to tighten the bound early.
+  std::sort(search.units.begin(), search.units.end(),
+            [](const PackSearch::Unit &left, const PackSearch::Unit &right) {
+    unsigned leftComps = left.pElement->GetRows() * left.pElement->GetCols();
+    unsigned rightComps = right.pElement->GetRows() * right.pElement->GetCols();
+    if (leftComps != rightComps)
+      return leftComps > rightComps;
+    return CmpElements(left.pElement, right.pElement) < 0;
+  });
+  search.remainingComps.resize(search.units.size() + 1, 0);
+  for (unsigned i = search.units.size(); i > 0; --i) {
+    PackElement *SE = search.units[i - 1].pElement;
+    search.remainingComps[i - 1] = search.remainingComps[i] + SE->GetRows() * SE->GetCols();
+  }
+  for (auto &U : search.units) {
+    U.bestRow = U.pElement->GetStartRow();
+    U.bestCol = U.pElement->GetStartCol();
+  }
+  search.startRow = startRow;
+  search.numRows = numRows;
+  search.bestRows = rowsUsed;
+  search.nodes = 0;
+  search.maxNodes = maxNodes;
+
+  m_Registers = initialRegisters;
+  SearchPlacements(search, 0, startRow, 0);
+
+  // Place elements where the best packing found puts them.
+  for (auto &U : search.units) {
+    if (U.members.empty()) {
+      PlaceElement(U.pElement, U.bestRow, U.bestCol);
+      U.pElement->SetLocation(U.bestRow, U.bestCol);
+      continue;
+    }
+    for (auto &SE : U.members) {
+      unsigned col = U.bestCol + SE->GetStartCol() - U.pElement->GetStartCol();
+      PlaceElement(SE, U.bestRow, col);
+      SE->SetLocation(U.bestRow, col);
+    }
+  }
+
+  return search.bestRows;
+}
+
 
 } // namespace hlsl
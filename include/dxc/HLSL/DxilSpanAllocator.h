@@ -14,6 +14,7 @@
 #include "dxc/Support/Global.h"
 #include <set>
 #include <map>
+#include <vector>
 
 namespace hlsl {
 
@@ -34,8 +35,12 @@ public:
 public:
   SpanAllocator(T_index Min, T_index Max)
     : m_Min(Min), m_Max(Max), m_FirstFree(Min),
-      m_Unbounded(nullptr), m_AllocationFull(false) {
+      m_Unbounded(nullptr), m_AllocationFull(false),
+      m_GapRoot(0), m_GapSeed(2463534242U) {
     DXASSERT_NOMSG(Min <= Max);
+    // Gap 0 stands for no gap, so the whole range starts out as gap 1.
+    m_Gaps.resize(1);
+    m_GapRoot = NewGap(Min, Max);
   }
   T_index GetMin() { return m_Min; }
   T_index GetMax() { return m_Max; }
@@ -50,37 +55,21 @@ public:
     DXASSERT_NOMSG(size);
     if (size - 1 > m_Max - m_Min)
       return false;
+    if (m_AllocationFull)
+      return false;
     if (pos < m_FirstFree)
       pos = m_FirstFree;
-    if (!UpdatePos(pos, size, align))
-      return false;
-    T_index end = pos + (size - 1);
-    auto next = m_Spans.lower_bound(Span(nullptr, pos, end));
-    if (next == m_Spans.end() || end < next->start)
-      return true;  // it fits here
-    return Find(size, result.first, pos, align);
+    return FindGap(m_GapRoot, pos, size - 1, align, pos);
   }
 
   // allocate element size in first available space, returns false on failure
   bool Allocate(const T_element *element, T_index size, T_index &pos, T_index align = 1) {
-    DXASSERT_NOMSG(size);
-    if (size - 1 > m_Max - m_Min)
-      return false;
-    if (m_AllocationFull)
-      return false;
     pos = m_FirstFree;
-    if (!UpdatePos(pos, size, align))
-      return false;
-    auto result = m_Spans.emplace(element, pos, pos + (size - 1));
-    if (result.second) {
-      AdvanceFirstFree(result.first);
-      return true;
-    }
-    // Collision, find a gap from iterator
-    if (!Find(size, result.first, pos, align))
+    if (!Find(size, pos, align))
       return false;
-    result = m_Spans.emplace(element, pos, pos + (size - 1));
-    return result.second;
+    const T_element *conflict = Insert(element, pos, pos + (size - 1));
+    DXASSERT_NOMSG(!conflict);
+    return !conflict;
   }
 
   bool AllocateUnbounded(const T_element *element, T_index &pos, T_index align = 1) {
@@ -111,38 +100,151 @@ public:
     auto result = m_Spans.emplace(element, start, end);
     if (!result.second)
       return result.first->element;
-    AdvanceFirstFree(result.first);
+    RemoveFromGaps(start, end);
+    if (m_GapRoot) {
+      unsigned first = m_GapRoot;
+      while (m_Gaps[first].left)
+        first = m_Gaps[first].left;
+      m_FirstFree = m_Gaps[first].start;
+    } else {
+      m_AllocationFull = true;
+    }
     return nullptr;
   }
 
 private:
-  // Find size gap starting at iterator, updating pos, and returning true if successful
-  bool Find(T_index size, typename SpanSet::const_iterator it, T_index &pos, T_index align = 1) {
-    pos = it->end;
-    if (!IncPos(pos, /*inc*/1, size, align))
-      return false;
-    for (++it; it != m_Spans.end() && (it->start < pos || it->start - pos < size); ++it) {
-      pos = it->end;
-      if (!IncPos(pos, /*inc*/1, size, align))
-        return false;
+  // The free ranges between spans are kept in a treap ordered by start,
+  // where each node also holds the size of the largest gap below it. That
+  // finds the first gap a span fits in without walking the spans before it,
+  // so allocation stays O(log n) in the number of spans. Gaps are referred
+  // to by index into m_Gaps so the allocator can be copied.
+  struct Gap {
+    T_index start, end;     // inclusive
+    T_index maxSizeLess1;   // largest end - start in this subtree
+    unsigned priority;
+    unsigned left, right;   // 0 for none
+  };
+
+  unsigned NewGap(T_index start, T_index end) {
+    // xorshift32, so priorities and the tree shape are deterministic.
+    m_GapSeed ^= m_GapSeed << 13;
+    m_GapSeed ^= m_GapSeed >> 17;
+    m_GapSeed ^= m_GapSeed << 5;
+    Gap gap = { start, end, end - start, m_GapSeed, 0, 0 };
+    m_Gaps.push_back(gap);
+    return (unsigned)m_Gaps.size() - 1;
+  }
+
+  void UpdateGap(unsigned g) {
+    Gap &gap = m_Gaps[g];
+    gap.maxSizeLess1 = gap.end - gap.start;
+    if (gap.left && gap.maxSizeLess1 < m_Gaps[gap.left].maxSizeLess1)
+      gap.maxSizeLess1 = m_Gaps[gap.left].maxSizeLess1;
+    if (gap.right && gap.maxSizeLess1 < m_Gaps[gap.right].maxSizeLess1)
+      gap.maxSizeLess1 = m_Gaps[gap.right].maxSizeLess1;
+  }
+
+  // Merge two treaps, where all gaps in a come before those in b.
+  unsigned MergeGaps(unsigned a, unsigned b) {
+    if (!a)
+      return b;
+    if (!b)
+      return a;
+    if (m_Gaps[a].priority > m_Gaps[b].priority) {
+      unsigned right = MergeGaps(m_Gaps[a].right, b);
+      m_Gaps[a].right = right;
+      UpdateGap(a);
+      return a;
     }
-    return true;
+    unsigned left = MergeGaps(a, m_Gaps[b].left);
+    m_Gaps[b].left = left;
+    UpdateGap(b);
+    return b;
+  }
+
+  // Split t into the gaps that start before start, and the rest.
+  void SplitGaps(unsigned t, T_index start, unsigned &before, unsigned &after) {
+    if (!t) {
+      before = after = 0;
+      return;
+    }
+    unsigned l, r;
+    if (m_Gaps[t].start < start) {
+      SplitGaps(m_Gaps[t].right, start, l, r);
+      m_Gaps[t].right = l;
+      UpdateGap(t);
+      before = t;
+      after = r;
+    } else {
+      SplitGaps(m_Gaps[t].left, start, l, r);
+      m_Gaps[t].left = r;
+      UpdateGap(t);
+      before = l;
+      after = t;
+    }
+  }
+
+  // Remove the first gap from t, returning it in first.
+  unsigned PopFirstGap(unsigned t, unsigned &first) {
+    if (!m_Gaps[t].left) {
+      first = t;
+      return m_Gaps[t].right;
+    }
+    unsigned left = PopFirstGap(m_Gaps[t].left, first);
+    m_Gaps[t].left = left;
+    UpdateGap(t);
+    return t;
+  }
+
+  // Remove [start, end] from the gap that contains it. Insert has already
+  // checked it doesn't overlap a span, so one gap contains all of it.
+  void RemoveFromGaps(T_index start, T_index end) {
+    unsigned containing = 0;
+    for (unsigned t = m_GapRoot; t; ) {
+      if (start < m_Gaps[t].start) {
+        t = m_Gaps[t].left;
+      } else {
+        containing = t;
+        t = m_Gaps[t].right;
+      }
+    }
+    DXASSERT_NOMSG(containing && end <= m_Gaps[containing].end);
+    T_index gapStart = m_Gaps[containing].start;
+    T_index gapEnd = m_Gaps[containing].end;
+
+    unsigned before, after, gap;
+    SplitGaps(m_GapRoot, gapStart, before, after);
+    after = PopFirstGap(after, gap);
+    DXASSERT_NOMSG(gap == containing);
+    if (end < gapEnd)
+      after = MergeGaps(NewGap(end + 1, gapEnd), after);
+    if (gapStart < start) {
+      m_Gaps[gap].end = start - 1;
+      m_Gaps[gap].left = m_Gaps[gap].right = 0;
+      UpdateGap(gap);
+      after = MergeGaps(gap, after);
+    }
+    m_GapRoot = MergeGaps(before, after);
   }
 
-  // Advance m_FirstFree if it's in span
-  void AdvanceFirstFree(typename SpanSet::const_iterator it) {
-    if (it->start <= m_FirstFree && m_FirstFree <= it->end) {
-      for (; it != m_Spans.end(); ) {
-        if (it->end >= m_Max) {
-          m_AllocationFull = true;
-          break;
-        }
-        m_FirstFree = it->end + 1;
-        ++it;
-        if (it != m_Spans.end() && m_FirstFree < it->start)
-          break;
+  // Find the first gap in t that fits sizeLess1 + 1 at or after from,
+  // returning its aligned start in pos.
+  bool FindGap(unsigned t, T_index from, T_index sizeLess1, T_index align, T_index &pos) {
+    if (!t || m_Gaps[t].maxSizeLess1 < sizeLess1)
+      return false;
+    const Gap &gap = m_Gaps[t];
+    // Gaps to the left end before this one starts.
+    if (from < gap.start && FindGap(gap.left, from, sizeLess1, align, pos))
+      return true;
+    if (from <= gap.end) {
+      T_index start = gap.start < from ? from : gap.start;
+      T_index aligned = Align(start, align);
+      if (start <= aligned && aligned <= gap.end && gap.end - aligned >= sizeLess1) {
+        pos = aligned;
+        return true;
       }
     }
+    return FindGap(gap.right, from, sizeLess1, align, pos);
   }
 
   T_index Align(T_index pos, T_index align) {
@@ -172,6 +274,9 @@ private:
   T_index m_Min, m_Max, m_FirstFree;
   const T_element *m_Unbounded;
   bool m_AllocationFull;
+  std::vector<Gap> m_Gaps;
+  unsigned m_GapRoot;
+  unsigned m_GapSeed;
 };
 
 template<typename T_index, typename T_element>
@@ -43,6 +43,8 @@ namespace dxilutil {
   std::unique_ptr<llvm::Module> LoadModuleFromBitcode(llvm::MemoryBuffer *MB,
     llvm::LLVMContext &Ctx, std::string &DiagStr);
   void PrintDiagnosticHandler(const llvm::DiagnosticInfo &DI, void *Context);
+  // Estimates the peak number of scalar values live at once in F.
+  unsigned EstimateMaxLiveValues(const llvm::Function &F);
 }
 
 }
\ No newline at end of file
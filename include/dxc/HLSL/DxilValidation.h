@@ -227,6 +227,7 @@ enum class ValidationRule : unsigned {
   SmUndefinedOutput, // Not all elements of output %0 were written
   SmValidDomain, // Invalid Tessellator Domain specified. Must be isoline, tri or quad
   SmViewIDNeedsSlot, // ViewID requires compatible space in pixel shader input signature
+  SmWaveSize, // Declared wave size %0 is not a power of two in the range [%1..%2]
   SmZeroHSInputControlPointWithInput, // When HS input control point count is 0, no input signature should exist
 
   // Type system
@@ -243,8 +244,10 @@ enum class ValidationRule : unsigned {
 
 const char *GetValidationRuleText(ValidationRule value);
 void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor);
+// bQuick skips the whole-program checks, as DxcValidatorFlags_Quick does.
 HRESULT ValidateDxilModule(_In_ llvm::Module *pModule,
-                           _In_opt_ llvm::Module *pDebugModule);
+                           _In_opt_ llvm::Module *pDebugModule,
+                           _In_ bool bQuick = false);
 
 // DXIL Container Verification Functions (return false on failure)
 
@@ -284,7 +287,9 @@ HRESULT ValidateLoadModuleFromContainer(
     _In_ std::unique_ptr<llvm::Module> &pDebugModule,
     _In_ llvm::LLVMContext &Ctx, llvm::LLVMContext &DbgCtx,
     _In_ llvm::raw_ostream &DiagStream);
-// Lazy loads module from container, validating load, but not module.
+// Lazy loads module from container, validating load, but not module. This is
+// for the linker, which uses the debug module when there is one, so then
+// only the debug module is loaded and pModule is left empty.
 HRESULT ValidateLoadModuleFromContainerLazy(
     _In_reads_bytes_(ContainerSize) const void *pContainer,
     _In_ uint32_t ContainerSize, _In_ std::unique_ptr<llvm::Module> &pModule,
@@ -295,12 +300,14 @@ HRESULT ValidateLoadModuleFromContainerLazy(
 // Load and validate Dxil module from bitcode.
 HRESULT ValidateDxilBitcode(_In_reads_bytes_(ILLength) const char *pIL,
                             _In_ uint32_t ILLength,
-                            _In_ llvm::raw_ostream &DiagStream);
+                            _In_ llvm::raw_ostream &DiagStream,
+                            _In_ bool bQuick = false);
 
 // Full container validation, including ValidateDxilModule
 HRESULT ValidateDxilContainer(_In_reads_bytes_(ContainerSize) const void *pContainer,
                               _In_ uint32_t ContainerSize,
-                              _In_ llvm::raw_ostream &DiagStream);
+                              _In_ llvm::raw_ostream &DiagStream,
+                              _In_ bool bQuick = false);
 
 class PrintDiagnosticContext {
 private:
@@ -48,7 +48,9 @@ class RootSignatureHandle;
 struct HLOptions {
   HLOptions()
       : bDefaultRowMajor(false), bIEEEStrict(false), bDisableOptimizations(false),
-        bLegacyCBufferLoad(false), PackingStrategy(0), unused(0) {
+        bLegacyCBufferLoad(false), PackingStrategy(0),
+        bCompactTypeAnnotations(false), bTrimResourceRanges(false),
+        FPSpeed(0), unused(0) {
   }
   uint32_t GetHLOptionsRaw() const;
   void SetHLOptionsRaw(uint32_t data);
@@ -57,10 +59,14 @@ struct HLOptions {
   unsigned bAllResourcesBound      : 1;
   unsigned bDisableOptimizations   : 1;
   unsigned bLegacyCBufferLoad      : 1;
-  unsigned PackingStrategy         : 2;
-  static_assert((unsigned)DXIL::PackingStrategy::Invalid < 4, "otherwise 2 bits is not enough to store PackingStrategy");
+  unsigned PackingStrategy         : 3;
+  static_assert((unsigned)DXIL::PackingStrategy::Invalid < 8, "otherwise 3 bits is not enough to store PackingStrategy");
   unsigned bUseMinPrecision        : 1;
-  unsigned unused                  : 24;
+  unsigned bCompactTypeAnnotations : 1;
+  unsigned bTrimResourceRanges     : 1;
+  unsigned FPSpeed                 : 2;
+  static_assert((unsigned)DXIL::FPSpeed::Invalid < 4, "otherwise 2 bits is not enough to store FPSpeed");
+  unsigned unused                  : 19;
 };
 
 /// Use this class to manipulate HLDXIR of a shader.
@@ -206,6 +212,10 @@ public:
   RootSignatureHandle *ReleaseRootSignature();
   std::unordered_map<llvm::Function *, std::unique_ptr<DxilFunctionProps>> &&
   ReleaseFunctionPropsMap();
+  std::vector<std::unique_ptr<DxilCBuffer> > ReleaseCBuffers();
+  std::vector<std::unique_ptr<DxilSampler> > ReleaseSamplers();
+  std::vector<std::unique_ptr<HLResource> > ReleaseSRVs();
+  std::vector<std::unique_ptr<HLResource> > ReleaseUAVs();
 
   llvm::DebugInfoFinder &GetOrCreateDebugInfoFinder();
   static llvm::DIGlobalVariable *
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// AllocationStats.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides an allocator that counts the allocations of an operation.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+#include <atomic>
+#include <stdint.h>
+
+namespace hlsl {
+
+/// Forwards to another allocator, counting allocations, their bytes and size
+/// classes, and keeping track of the high-water mark of live bytes. Callers
+/// make it the thread allocator for the operation they measure.
+class AllocationStatsMalloc : public IMalloc {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::atomic<uint64_t> m_allocCount;
+  std::atomic<uint64_t> m_allocBytes;
+  std::atomic<uint64_t> m_liveBytes;
+  std::atomic<uint64_t> m_peakBytes;
+  std::atomic<uint64_t> m_sizeClassCounts[DxcAllocationSizeClassCount];
+
+  SIZE_T SizeOf(void *pv);
+  void Add(SIZE_T requested, SIZE_T size);
+  void Remove(SIZE_T size);
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(AllocationStatsMalloc)
+
+  AllocationStatsMalloc(IMalloc *pMalloc);
+
+  static HRESULT Create(IMalloc *pMalloc, AllocationStatsMalloc **ppResult);
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  /// Returns the statistics collected so far.
+  void GetStats(DxcAllocationStats *pStats);
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override;
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override;
+  void STDMETHODCALLTYPE Free(void *pv) override;
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override;
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override;
+  void STDMETHODCALLTYPE HeapMinimize() override;
+};
+
+} // namespace hlsl
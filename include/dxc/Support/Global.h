@@ -11,6 +11,10 @@
 
 #pragma once
 
+#ifndef _WIN32
+#include "dxc/Support/WinAdapter.h"
+#endif
+
 // Redeclare some macros to not depend on winerror.h
 #define DXC_FAILED(hr) (((HRESULT)(hr)) < 0)
 #ifndef _HRESULT_DEFINED
@@ -126,7 +130,9 @@ template<typename T> T *VerifyNullAndThrow(T *p) {
 }
 #define VNT(__p) VerifyNullAndThrow(__p)
 
+#ifdef _WIN32
 extern "C" __declspec(dllimport) void __stdcall OutputDebugStringA(_In_opt_ const char *msg);
+#endif
 
 inline void OutputDebugBytes(const void *ptr, size_t len) {
   const char digits[] = "0123456789abcdef";
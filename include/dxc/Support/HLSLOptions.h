@@ -18,6 +18,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Option/ArgList.h"
 #include "dxc/dxcapi.h"
+#include <map>
 
 namespace llvm {
 namespace opt {
@@ -109,18 +110,48 @@ public:
   llvm::StringRef VerifyRootSignatureSource; //OPT_verifyrootsignature
   llvm::StringRef RootSignatureDefine; // OPT_rootsig_define
   llvm::StringRef FloatDenormalMode; // OPT_denorm
+  llvm::StringRef FPSpeed; // OPT_fp_speed_EQ
+  llvm::StringRef CompileCacheDir; // OPT_cache_dir
+  llvm::StringRef BatchFile; // OPT_batch
+  llvm::StringRef RemoteJobFile; // OPT_remote
+  llvm::StringRef RemoteResultFile; // OPT_remote_result
+  llvm::StringRef PretokenizedHeader; // OPT_Yu
+  llvm::StringRef OptPipelineFile; // OPT_opt_pipeline
+  llvm::StringRef TimeReportFile; // OPT_Ftr
+  llvm::StringRef TimeTraceFile; // OPT_Ftt
+  llvm::StringRef DependencyFile; // OPT_MF
+  llvm::StringRef SourcePackFile; // OPT_Fsp
 
   bool AllResourcesBound = false; // OPT_all_resources_bound
   bool AstDump = false; // OPT_ast_dump
   bool ColorCodeAssembly = false; // OPT_Cc
   bool CodeGenHighLevel = false; // OPT_fcgl
   bool DebugInfo = false; // OPT__SLASH_Zi
+  bool DebugLineTablesOnly = false; // OPT_Zi_lines
   bool DebugNameForBinary = false; // OPT_Zsb
   bool DebugNameForSource = false; // OPT_Zss
   bool DumpBin = false;        // OPT_dumpbin
   bool WarningAsError = false; // OPT__SLASH_WX
   bool IEEEStrict = false;     // OPT_Gis
   bool IgnoreLineDirectives = false; // OPT_ignore_line_directives
+  bool Preprocessed = false; // OPT_fpreprocessed
+  bool CompactTypeAnnotations = false; // OPT_compact_type_annotations
+  bool DeferFunctionBodies = false; // OPT_defer_function_bodies
+  bool TrimResourceRanges = false; // OPT_trim_resource_ranges
+  bool UniformBranchHints = false; // OPT_uniform_branch_hints
+  bool AutoFlatten = false; // OPT_auto_flatten
+  bool UnswitchUniformLoops = false; // OPT_unswitch_uniform_loops
+  bool WaveAggregateAtomics = false; // OPT_wave_aggregate_atomics
+  bool AutoEarlyDepthStencil = false; // OPT_auto_early_depth_stencil
+  bool GatherPointSamples = false; // OPT_gather_point_samples
+  bool CompactContext = false; // OPT_compact_context
+  bool DemotePrecision = false; // OPT_demote_precision
+  bool UnrollReport = false; // OPT_unroll_report
+  bool SelectDynamicIndexing = false; // OPT_select_dynamic_indexing
+  bool PadGroupShared = false; // OPT_pad_groupshared
+  bool Specializable = false; // OPT_specializable
+  bool BottomUpInline = false; // OPT_bottom_up_inline
+  bool FreeASTEarly = false; // OPT_free_ast_early
   bool DefaultColMajor = false;  // OPT_Zpc
   bool DefaultRowMajor = false;  // OPT_Zpr
   bool DisableValidation = false; // OPT_VD
@@ -142,18 +173,38 @@ public:
   bool NotUseLegacyCBufLoad = false;  // OPT_not_use_legacy_cbuf_load
   bool PackPrefixStable = false;  // OPT_pack_prefix_stable
   bool PackOptimized = false;  // OPT_pack_optimized
+  bool PackMinimal = false;  // OPT_pack_minimal
+  bool ExtendedPSV = false;  // OPT_psv_extended
   bool DisplayIncludeProcess = false; // OPT__vi
   bool RecompileFromBinary = false; // OPT _Recompile (Recompiling the DXBC binary file not .hlsl file)
   bool StripDebug = false; // OPT Qstrip_debug
   bool StripRootSignature = false; // OPT_Qstrip_rootsignature
   bool StripPrivate = false; // OPT_Qstrip_priv
   bool StripReflection = false; // OPT_Qstrip_reflect
+  bool EmbedShaderHash = false; // OPT_Qembed_hash
+  bool EmbedStatistics = false; // OPT_Qembed_stats
+  bool CompressDebugInfo = false; // OPT_Qcompress_debug
+  bool Sidecar = false; // OPT_Qsidecar
+  bool SourcePack = false; // OPT_Qsource_pack, implied by OPT_Fsp
+  bool Reproducible = false; // OPT_Brepro
+  bool WriteDependencies = false; // OPT_MD or OPT_MF
   bool ExtractRootSignature = false; // OPT_extractrootsignature
   bool DisassembleColorCoded = false; // OPT_Cc
   bool DisassembleInstNumbers = false; //OPT_Ni
   bool DisassembleByteOffset = false; //OPT_No
   bool DisaseembleHex = false; //OPT_Lx
   bool LegacyMacroExpansion = false; // OPT_flegacy_macro_expansion
+  bool CreatePretokenizedHeader = false; // OPT_Yc
+  bool TimeReport = false; // OPT_ftime_report, implied by OPT_Ftr
+  bool TimeTrace = false; // OPT_ftime_trace, implied by OPT_Ftt
+  bool AllocationStats = false; // OPT_falloc_stats
+  bool PrintIRStats = false; // OPT_print_ir_stats
+  bool RemoteServer = false; // OPT_server
+  bool Daemon = false; // OPT_daemon
+  unsigned CompileCacheMaxSize = 1024; // OPT_cache_max_size, in megabytes
+  unsigned BatchJobs = 0; // OPT_batch_jobs, 0 for the number of processors
+  unsigned WaveSize = 0; // OPT_wave_size, 0 for any wave size
+  std::map<std::string, std::string> DebugPrefixMap; // OPT_fdebug_prefix_map_EQ
 
   bool IsRootSignatureProfile();
   bool IsLibraryProfile();
@@ -166,6 +217,11 @@ public:
   bool VkUseGlLayout;                      // OPT_fvk_use_gl_layout
   bool VkUseDxLayout;                      // OPT_fvk_use_dx_layout
   bool SpvEnableReflect;                   // OPT_fspv_reflect
+  bool SpvReflectSidecar;                  // OPT_fspv_reflect_sidecar, implied by OPT_Fsr
+  llvm::StringRef SpvReflectSidecarFile;   // OPT_Fsr
+  bool SpvOptimizeSize;                    // OPT_fspv_optimize_size
+  bool SpvRelaxedPrecision;                // OPT_fspv_relaxed_precision
+  unsigned VkAutoPushConstantSize;         // OPT_fvk_auto_push_constant_EQ
   llvm::StringRef VkStageIoOrder;          // OPT_fvk_stage_io_order
   llvm::SmallVector<int32_t, 4> VkBShift;  // OPT_fvk_b_shift
   llvm::SmallVector<int32_t, 4> VkTShift;  // OPT_fvk_t_shift
@@ -173,6 +229,7 @@ public:
   llvm::SmallVector<int32_t, 4> VkUShift;  // OPT_fvk_u_shift
   llvm::SmallVector<llvm::StringRef, 4> SpvExtensions; // OPT_fspv_extension
   llvm::StringRef SpvTargetEnv;                        // OPT_fspv_target_env
+  llvm::SmallVector<llvm::StringRef, 1> SpvEntryPoints; // OPT_entrypoint
 #endif
   // SPIRV Change Ends
 };
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// SpirvReflection.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Defines the reflection sidecar written next to SPIR-V code.               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+namespace hlsl {
+
+// The sidecar describes the descriptor bindings, the layout of the uniform
+// and push constant blocks, and the stage interface of one entry point, as
+// the compiler assigned them. Pipeline layouts can be built from it without
+// parsing the SPIR-V module.
+//
+// It starts with a SpirvReflectionHeader; each table it names is an array of
+// records at a byte offset from the start of the sidecar. All names are
+// offsets into the string table, which holds null-terminated UTF-8 strings.
+// Resources that the optimizer removes as unused are still listed.
+static const uint32_t SpirvReflectionMagic = 0x52565053; // 'SPVR'
+static const uint32_t SpirvReflectionVersion = 2;
+static const uint32_t SpirvReflectionNone = 0xFFFFFFFF;
+
+struct SpirvReflectionTable {
+  uint32_t Offset; // Byte offset from the start of the sidecar.
+  uint32_t Count;  // Number of records, or bytes for the string table.
+};
+
+struct SpirvReflectionHeader {
+  uint32_t Magic;          // SpirvReflectionMagic.
+  uint32_t Version;        // SpirvReflectionVersion.
+  uint32_t ExecutionModel; // spv::ExecutionModel of the entry point.
+  uint32_t EntryName;      // String offset of the entry point name.
+  SpirvReflectionTable Bindings;  // SpirvReflectionBinding records.
+  SpirvReflectionTable Blocks;    // SpirvReflectionBlock records.
+  SpirvReflectionTable Members;   // SpirvReflectionMember records.
+  SpirvReflectionTable StageVars; // SpirvReflectionStageVar records.
+  SpirvReflectionTable Strings;
+};
+
+// Matches the values of VkDescriptorType.
+enum class SpirvDescriptorType : uint32_t {
+  Sampler = 0,
+  SampledImage = 2,
+  StorageImage = 3,
+  UniformTexelBuffer = 4,
+  StorageTexelBuffer = 5,
+  UniformBuffer = 6,
+  StorageBuffer = 7,
+  InputAttachment = 10,
+};
+
+struct SpirvReflectionBinding {
+  uint32_t Name;           // String offset of the variable name.
+  uint32_t Set;            // DescriptorSet decoration.
+  uint32_t Binding;        // Binding decoration.
+  uint32_t DescriptorType; // SpirvDescriptorType.
+  uint32_t ArraySize;      // Number of descriptors, 1 for non-arrays.
+  uint32_t Block;          // Index into Blocks, or SpirvReflectionNone.
+};
+
+enum SpirvReflectionBlockFlags : uint32_t {
+  // A cbuffer that -fvk-auto-push-constant made a push constant block. It is
+  // bound through vkCmdPushConstants instead of a uniform buffer descriptor,
+  // with the layout of the members listed here.
+  SpirvReflectionBlockAutoPushConstant = 1,
+};
+
+struct SpirvReflectionBlock {
+  uint32_t Name;         // String offset of the variable name.
+  uint32_t StorageClass; // spv::StorageClass: Uniform or PushConstant.
+  uint32_t Size;         // Bytes up to the end of the last member.
+  uint32_t FirstMember;  // Index into Members.
+  uint32_t MemberCount;
+  uint32_t Flags;        // SpirvReflectionBlockFlags.
+};
+
+struct SpirvReflectionMember {
+  uint32_t Name;   // String offset of the member name.
+  uint32_t Offset; // Offset decoration.
+  uint32_t Size;   // Bytes under the block's layout rule.
+};
+
+struct SpirvReflectionStageVar {
+  uint32_t Semantic;      // String offset of the semantic, without index.
+  uint32_t SemanticIndex;
+  uint32_t StorageClass;  // spv::StorageClass: Input or Output.
+  uint32_t Location;      // Location decoration, or SpirvReflectionNone for
+                          // builtins.
+  uint32_t LocationCount;
+};
+
+} // namespace hlsl
@@ -12,7 +12,9 @@
 #pragma once
 
 #include <string>
+#ifdef _WIN32
 #include <specstrings.h>
+#endif
 
 namespace Unicode
 {
@@ -68,4 +70,15 @@ bool UTF16BufferToUTF8Buffer(
   _Outptr_result_buffer_(*pcbUTF8) char **ppUTF8,
   size_t *pcbUTF8) throw();
 
+// Returns true if all cb bytes of pText are 7-bit ASCII, in which case the
+// text has the same bytes in UTF-8 and in any ANSI code page.
+bool IsASCIIBuffer(_In_reads_(cb) const char *pText, size_t cb) throw();
+
+// Narrows cch UTF-16 characters into pASCII if they are all 7-bit ASCII and
+// returns true; otherwise returns false and pASCII has undefined contents.
+// This is the fast path for the common case of all-ASCII source text.
+_Success_(return != false)
+bool UTF16ToASCIIBuffer(_In_reads_(cch) const wchar_t *pUTF16, size_t cch,
+                        _Out_writes_(cch) char *pASCII) throw();
+
 }  // namespace Unicode
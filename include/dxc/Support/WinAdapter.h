@@ -0,0 +1,999 @@
+//===- WinAdapter.h ---------------------------------------------*- C++ -*-===//
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// WinAdapter.h                                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the subset of the Windows, COM and ATL declarations the compiler //
+// uses, for building on platforms other than Windows.                       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef LLVM_SUPPORT_WIN_ADAPTER_H
+#define LLVM_SUPPORT_WIN_ADAPTER_H
+
+#ifndef _WIN32
+
+// The interfaces are declared with __declspec(uuid) and looked up with
+// __uuidof, which need the Microsoft extensions (clang -fms-extensions).
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <new>
+
+//===----------------------------------------------------------------------===//
+// Annotations and calling conventions.
+
+#define _In_
+#define _In_z_
+#define _In_opt_
+#define _In_opt_z_
+#define _In_count_(size)
+#define _In_opt_count_(size)
+#define _In_bytecount_(size)
+#define _In_reads_(size)
+#define _In_reads_opt_(size)
+#define _In_reads_bytes_(size)
+#define _In_reads_bytes_opt_(size)
+#define _In_NLS_string_(size)
+#define _Out_
+#define _Out_opt_
+#define _Out_bytecap_(size)
+#define _Out_cap_x_(size)
+#define _Out_writes_(size)
+#define _Out_writes_opt_(size)
+#define _Out_writes_all_(size)
+#define _Out_writes_z_(size)
+#define _Out_writes_bytes_(size)
+#define _Out_writes_to_(size, count)
+#define _Out_writes_to_opt_(size, count)
+#define _Inout_
+#define _Inout_z_
+#define _Inout_count_(size)
+#define _Inout_cap_(size)
+#define _Outptr_
+#define _Outptr_opt_
+#define _Outptr_result_z_
+#define _Outptr_opt_result_z_
+#define _Outptr_result_maybenull_
+#define _Outptr_result_nullonfailure_
+#define _Outptr_result_buffer_(size)
+#define _Outptr_result_buffer_maybenull_(size)
+#define _Outptr_result_bytebuffer_(size)
+#define _COM_Outptr_
+#define _COM_Outptr_opt_
+#define _COM_Outptr_result_maybenull_
+#define _COM_Outptr_opt_result_maybenull_
+#define _Ret_opt_
+#define _Ret_notnull_
+#define _Ret_maybenull_
+#define _Return_type_success_(expr)
+#define _Success_(expr)
+#define _Use_decl_annotations_
+#define _Analysis_assume_(expr)
+#define _Analysis_assume_nullterminated_(x)
+#define _Field_size_(size)
+#define _Field_size_full_(size)
+#define _Post_readable_byte_size_(size)
+#define _Post_writable_byte_size_(size)
+#define _Printf_format_string_
+#define _Null_terminated_
+#define _Maybenull_
+#define __out_ecount_part(size, length)
+#define __inexpressible_readableTo(size)
+#define __override
+
+#define STDMETHODCALLTYPE
+#define WINAPI
+#define __stdcall
+#define CALLBACK
+#define STDAPI extern "C" HRESULT STDAPICALLTYPE
+#define STDAPICALLTYPE
+#define STDMETHOD(method) virtual HRESULT STDMETHODCALLTYPE method
+#define STDMETHOD_(type, method) virtual type STDMETHODCALLTYPE method
+#define STDMETHODIMP HRESULT STDMETHODCALLTYPE
+#define STDMETHODIMP_(type) type STDMETHODCALLTYPE
+#define EXTERN_C extern "C"
+#define DECLSPEC_SELECTANY __attribute__((weak))
+#define interface struct
+
+#define UNREFERENCED_PARAMETER(P) (void)(P)
+#define ZeroMemory(Dest, Length) memset((Dest), 0, (Length))
+#define CopyMemory(Dest, Src, Length) memcpy((Dest), (Src), (Length))
+#define ATLASSERT(expr) ((void)0)
+#define _ATL_DECLSPEC_ALLOCATOR
+#define __debugbreak() __builtin_trap()
+
+#define _countof(a) (sizeof(a) / sizeof(*(a)))
+#define ARRAYSIZE(a) _countof(a)
+
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+#define _wcsicmp wcscasecmp
+#define _wcsnicmp wcsncasecmp
+#define sprintf_s snprintf
+#define vsprintf_s vsnprintf
+
+//===----------------------------------------------------------------------===//
+// Types.
+
+typedef int BOOL;
+typedef unsigned char BOOLEAN;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef uint32_t DWORD;
+typedef int32_t INT;
+typedef uint32_t UINT;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef int8_t INT8;
+typedef uint8_t UINT8;
+typedef int16_t INT16;
+typedef uint16_t UINT16;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef intptr_t INT_PTR;
+typedef uintptr_t UINT_PTR;
+typedef intptr_t LONG_PTR;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+typedef ptrdiff_t SSIZE_T;
+typedef float FLOAT;
+typedef double DOUBLE;
+typedef int errno_t;
+#define _HRESULT_DEFINED
+typedef int32_t HRESULT;
+
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+typedef char *PSTR;
+typedef const char *PCSTR;
+typedef wchar_t *LPWSTR;
+typedef const wchar_t *LPCWSTR;
+typedef wchar_t *PWSTR;
+typedef const wchar_t *PCWSTR;
+typedef wchar_t OLECHAR;
+typedef OLECHAR *LPOLESTR;
+typedef const OLECHAR *LPCOLESTR;
+typedef OLECHAR *BSTR;
+
+typedef void VOID;
+typedef void *PVOID;
+typedef void *LPVOID;
+typedef const void *LPCVOID;
+typedef BYTE *LPBYTE;
+typedef DWORD *LPDWORD;
+typedef BOOL *LPBOOL;
+
+typedef void *HANDLE;
+typedef void *HMODULE;
+typedef void *HINSTANCE;
+typedef void *HGLOBAL;
+typedef int (*FARPROC)();
+
+#define FALSE 0
+#define TRUE 1
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(LONG_PTR)-1)
+
+typedef union _LARGE_INTEGER {
+  struct {
+    DWORD LowPart;
+    LONG HighPart;
+  } u;
+  struct {
+    DWORD LowPart;
+    LONG HighPart;
+  };
+  LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef union _ULARGE_INTEGER {
+  struct {
+    DWORD LowPart;
+    DWORD HighPart;
+  } u;
+  struct {
+    DWORD LowPart;
+    DWORD HighPart;
+  };
+  ULONGLONG QuadPart;
+} ULARGE_INTEGER, *PULARGE_INTEGER;
+
+typedef struct _FILETIME {
+  DWORD dwLowDateTime;
+  DWORD dwHighDateTime;
+} FILETIME, *PFILETIME, *LPFILETIME;
+
+typedef struct _BY_HANDLE_FILE_INFORMATION {
+  DWORD dwFileAttributes;
+  FILETIME ftCreationTime;
+  FILETIME ftLastAccessTime;
+  FILETIME ftLastWriteTime;
+  DWORD dwVolumeSerialNumber;
+  DWORD nFileSizeHigh;
+  DWORD nFileSizeLow;
+  DWORD nNumberOfLinks;
+  DWORD nFileIndexHigh;
+  DWORD nFileIndexLow;
+} BY_HANDLE_FILE_INFORMATION, *PBY_HANDLE_FILE_INFORMATION,
+    *LPBY_HANDLE_FILE_INFORMATION;
+
+typedef struct _WIN32_FIND_DATAW {
+  DWORD dwFileAttributes;
+  FILETIME ftCreationTime;
+  FILETIME ftLastAccessTime;
+  FILETIME ftLastWriteTime;
+  DWORD nFileSizeHigh;
+  DWORD nFileSizeLow;
+  DWORD dwReserved0;
+  DWORD dwReserved1;
+  WCHAR cFileName[MAX_PATH];
+  WCHAR cAlternateFileName[14];
+} WIN32_FIND_DATAW, *PWIN32_FIND_DATAW, *LPWIN32_FIND_DATAW;
+
+typedef struct _SYSTEM_INFO {
+  DWORD dwPageSize;
+  DWORD dwAllocationGranularity;
+  DWORD dwNumberOfProcessors;
+} SYSTEM_INFO, *LPSYSTEM_INFO;
+
+//===----------------------------------------------------------------------===//
+// Error codes.
+
+#define S_OK ((HRESULT)0L)
+#define S_FALSE ((HRESULT)1L)
+#define E_ABORT ((HRESULT)0x80004004L)
+#define E_ACCESSDENIED ((HRESULT)0x80070005L)
+#define E_BOUNDS ((HRESULT)0x8000000BL)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_HANDLE ((HRESULT)0x80070006L)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+#define E_NOINTERFACE ((HRESULT)0x80004002L)
+#define E_NOTIMPL ((HRESULT)0x80004001L)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define E_PENDING ((HRESULT)0x8000000AL)
+#define E_POINTER ((HRESULT)0x80004003L)
+#define E_UNEXPECTED ((HRESULT)0x8000FFFFL)
+
+#define STG_E_INVALIDFUNCTION ((HRESULT)0x80030001L)
+#define STG_E_ACCESSDENIED ((HRESULT)0x80030005L)
+
+#define SEVERITY_SUCCESS 0
+#define SEVERITY_ERROR 1
+#define FACILITY_WIN32 7
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define MAKE_HRESULT(sev, fac, code)                                           \
+  ((HRESULT)(((unsigned long)(sev) << 31) | ((unsigned long)(fac) << 16) |     \
+             ((unsigned long)(code))))
+#define HRESULT_CODE(hr) ((hr)&0xFFFF)
+#define HRESULT_FACILITY(hr) (((hr) >> 16) & 0x1fff)
+#define HRESULT_FROM_WIN32(x)                                                  \
+  ((HRESULT)(x) <= 0 ? ((HRESULT)(x))                                          \
+                     : ((HRESULT)(((x)&0x0000FFFF) | (FACILITY_WIN32 << 16) |  \
+                                  0x80000000)))
+
+#define NO_ERROR 0L
+#define ERROR_SUCCESS 0L
+#define ERROR_INVALID_FUNCTION 1L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_PATH_NOT_FOUND 3L
+#define ERROR_TOO_MANY_OPEN_FILES 4L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_ENOUGH_MEMORY 8L
+#define ERROR_INVALID_ACCESS 12L
+#define ERROR_OUTOFMEMORY 14L
+#define ERROR_INVALID_DRIVE 15L
+#define ERROR_CURRENT_DIRECTORY 16L
+#define ERROR_NO_MORE_FILES 18L
+#define ERROR_WRITE_PROTECT 19L
+#define ERROR_BAD_UNIT 20L
+#define ERROR_NOT_READY 21L
+#define ERROR_SEEK 25L
+#define ERROR_WRITE_FAULT 29L
+#define ERROR_READ_FAULT 30L
+#define ERROR_GEN_FAILURE 31L
+#define ERROR_SHARING_VIOLATION 32L
+#define ERROR_LOCK_VIOLATION 33L
+#define ERROR_HANDLE_EOF 38L
+#define ERROR_HANDLE_DISK_FULL 39L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_BAD_NETPATH 53L
+#define ERROR_DEV_NOT_EXIST 55L
+#define ERROR_FILE_EXISTS 80L
+#define ERROR_CANNOT_MAKE 82L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_OPEN_FAILED 110L
+#define ERROR_BUFFER_OVERFLOW 111L
+#define ERROR_DISK_FULL 112L
+#define ERROR_CALL_NOT_IMPLEMENTED 120L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_INVALID_NAME 123L
+#define ERROR_NEGATIVE_SEEK 131L
+#define ERROR_DIR_NOT_EMPTY 145L
+#define ERROR_BUSY_DRIVE 142L
+#define ERROR_BUSY 170L
+#define ERROR_ALREADY_EXISTS 183L
+#define ERROR_LOCKED 212L
+#define ERROR_NOT_CAPABLE 775L
+#define ERROR_IO_DEVICE 1117L
+#define ERROR_NO_UNICODE_TRANSLATION 1113L
+#define ERROR_POSSIBLE_DEADLOCK 1131L
+#define ERROR_OPEN_FILES 2401L
+#define ERROR_DEVICE_IN_USE 2404L
+#define ERROR_NOACCESS 998L
+#define ERROR_RETRY 1237L
+#define ERROR_FUNCTION_FAILED 1627L
+#define ERROR_FUNCTION_NOT_CALLED 1626L
+#define ERROR_NOT_FOUND 1168L
+#define ERROR_OUT_OF_STRUCTURES 84L
+#define ERROR_UNHANDLED_EXCEPTION 574L
+#define ERROR_CANTOPEN 1011L
+#define ERROR_CANTREAD 1012L
+#define ERROR_CANTWRITE 1013L
+#define ERROR_DIRECTORY 267L
+#define WSAEINTR 10004L
+#define WSAEBADF 10009L
+#define WSAEACCES 10013L
+#define WSAEFAULT 10014L
+#define WSAEINVAL 10022L
+#define WSAEMFILE 10024L
+#define WSAENAMETOOLONG 10063L
+
+//===----------------------------------------------------------------------===//
+// Files.
+
+#define GENERIC_READ 0x80000000
+#define GENERIC_WRITE 0x40000000
+#define FILE_SHARE_READ 0x00000001
+#define FILE_SHARE_WRITE 0x00000002
+#define FILE_SHARE_DELETE 0x00000004
+#define CREATE_NEW 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define TRUNCATE_EXISTING 5
+#define FILE_ATTRIBUTE_READONLY 0x00000001
+#define FILE_ATTRIBUTE_DIRECTORY 0x00000010
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define FILE_ATTRIBUTE_REPARSE_POINT 0x00000400
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+#define FILE_FLAG_BACKUP_SEMANTICS 0x02000000
+#define FILE_TYPE_UNKNOWN 0x0000
+#define FILE_TYPE_DISK 0x0001
+#define FILE_TYPE_CHAR 0x0002
+#define FILE_TYPE_PIPE 0x0003
+#define MOVEFILE_REPLACE_EXISTING 0x00000001
+#define MOVEFILE_COPY_ALLOWED 0x00000002
+#define PAGE_READONLY 0x02
+#define PAGE_READWRITE 0x04
+#define PAGE_WRITECOPY 0x08
+#define FILE_MAP_COPY 0x0001
+#define FILE_MAP_WRITE 0x0002
+#define FILE_MAP_READ 0x0004
+#define STD_INPUT_HANDLE ((DWORD)-10)
+#define STD_OUTPUT_HANDLE ((DWORD)-11)
+#define STD_ERROR_HANDLE ((DWORD)-12)
+
+#define _O_APPEND O_APPEND
+#define _O_TEXT 0
+#define _O_BINARY 0
+#define O_BINARY 0
+
+typedef struct _CREATEFILE2_EXTENDED_PARAMETERS
+    CREATEFILE2_EXTENDED_PARAMETERS, *LPCREATEFILE2_EXTENDED_PARAMETERS;
+
+// File handles wrap descriptors; see lib/Support/WinFunctions.cpp.
+HANDLE CreateFileW(LPCWSTR lpFileName, DWORD dwDesiredAccess,
+                   DWORD dwShareMode, void *lpSecurityAttributes,
+                   DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes,
+                   HANDLE hTemplateFile);
+inline HANDLE CreateFile2(LPCWSTR lpFileName, DWORD dwDesiredAccess,
+                          DWORD dwShareMode, DWORD dwCreationDisposition,
+                          LPCREATEFILE2_EXTENDED_PARAMETERS pCreateExParams) {
+  return CreateFileW(lpFileName, dwDesiredAccess, dwShareMode, nullptr,
+                     dwCreationDisposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+BOOL ReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead,
+              LPDWORD lpNumberOfBytesRead, void *lpOverlapped);
+BOOL WriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite,
+               LPDWORD lpNumberOfBytesWritten, void *lpOverlapped);
+BOOL CloseHandle(HANDLE hObject);
+BOOL GetFileSizeEx(HANDLE hFile, PLARGE_INTEGER lpFileSize);
+DWORD GetFileType(HANDLE hFile);
+BOOL GetFileInformationByHandle(HANDLE hFile,
+                                LPBY_HANDLE_FILE_INFORMATION lpInfo);
+BOOL SetFileTime(HANDLE hFile, const FILETIME *lpCreationTime,
+                 const FILETIME *lpLastAccessTime,
+                 const FILETIME *lpLastWriteTime);
+DWORD GetFileAttributesW(LPCWSTR lpFileName);
+BOOL DeleteFileW(LPCWSTR lpFileName);
+BOOL RemoveDirectoryW(LPCWSTR lpPathName);
+BOOL CreateDirectoryW(LPCWSTR lpPathName, void *lpSecurityAttributes);
+BOOL MoveFileExW(LPCWSTR lpExistingFileName, LPCWSTR lpNewFileName,
+                 DWORD dwFlags);
+BOOL CreateHardLinkW(LPCWSTR lpFileName, LPCWSTR lpExistingFileName,
+                     void *lpSecurityAttributes);
+DWORD GetCurrentDirectoryW(DWORD nBufferLength, LPWSTR lpBuffer);
+DWORD GetTempPathW(DWORD nBufferLength, LPWSTR lpBuffer);
+DWORD GetModuleFileNameW(HMODULE hModule, LPWSTR lpFilename, DWORD nSize);
+HANDLE FindFirstFileW(LPCWSTR lpFileName, LPWIN32_FIND_DATAW lpFindFileData);
+BOOL FindNextFileW(HANDLE hFindFile, LPWIN32_FIND_DATAW lpFindFileData);
+BOOL FindClose(HANDLE hFindFile);
+HANDLE CreateFileMappingW(HANDLE hFile, void *lpAttributes, DWORD flProtect,
+                          DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow,
+                          LPCWSTR lpName);
+LPVOID MapViewOfFile(HANDLE hFileMappingObject, DWORD dwDesiredAccess,
+                     DWORD dwFileOffsetHigh, DWORD dwFileOffsetLow,
+                     SIZE_T dwNumberOfBytesToMap);
+BOOL UnmapViewOfFile(LPCVOID lpBaseAddress);
+
+// The descriptor of a file handle, and the handle of a descriptor.
+int HandleToDescriptor(HANDLE h);
+HANDLE DescriptorToHandle(int fd);
+
+//===----------------------------------------------------------------------===//
+// Errors, threads, memory and modules.
+
+DWORD GetLastError();
+void SetLastError(DWORD dwErrCode);
+// Sets the last error to the closest Win32 error for errno.
+void SetLastErrorFromErrno();
+
+inline void Sleep(DWORD dwMilliseconds) { usleep(dwMilliseconds * 1000); }
+void GetSystemInfo(LPSYSTEM_INFO lpSystemInfo);
+inline DWORD GetCurrentThreadId() { return (DWORD)(uintptr_t)pthread_self(); }
+void OutputDebugStringA(LPCSTR lpOutputString);
+void OutputDebugStringW(LPCWSTR lpOutputString);
+
+inline LONG InterlockedIncrement(volatile LONG *p) {
+  return __sync_add_and_fetch(p, 1);
+}
+inline LONG InterlockedDecrement(volatile LONG *p) {
+  return __sync_sub_and_fetch(p, 1);
+}
+inline ULONG InterlockedIncrement(volatile ULONG *p) {
+  return __sync_add_and_fetch(p, 1);
+}
+inline ULONG InterlockedDecrement(volatile ULONG *p) {
+  return __sync_sub_and_fetch(p, 1);
+}
+inline LONG InterlockedCompareExchange(volatile LONG *p, LONG exchange,
+                                       LONG comparand) {
+  return __sync_val_compare_and_swap(p, comparand, exchange);
+}
+inline ULONG InterlockedCompareExchange(volatile ULONG *p, ULONG exchange,
+                                        ULONG comparand) {
+  return __sync_val_compare_and_swap(p, comparand, exchange);
+}
+
+typedef pthread_mutex_t CRITICAL_SECTION, *LPCRITICAL_SECTION;
+void InitializeCriticalSection(LPCRITICAL_SECTION lpCriticalSection);
+inline void EnterCriticalSection(LPCRITICAL_SECTION lpCriticalSection) {
+  pthread_mutex_lock(lpCriticalSection);
+}
+inline void LeaveCriticalSection(LPCRITICAL_SECTION lpCriticalSection) {
+  pthread_mutex_unlock(lpCriticalSection);
+}
+inline void DeleteCriticalSection(LPCRITICAL_SECTION lpCriticalSection) {
+  pthread_mutex_destroy(lpCriticalSection);
+}
+
+// Indices are pthread keys plus one, so that zero stays "unallocated".
+#define TLS_OUT_OF_INDEXES ((DWORD)0xFFFFFFFF)
+DWORD TlsAlloc();
+LPVOID TlsGetValue(DWORD dwTlsIndex);
+BOOL TlsSetValue(DWORD dwTlsIndex, LPVOID lpTlsValue);
+BOOL TlsFree(DWORD dwTlsIndex);
+
+// There is a single process heap, backed by malloc.
+#define HEAP_ZERO_MEMORY 0x00000008
+HANDLE GetProcessHeap();
+HANDLE HeapCreate(DWORD flOptions, SIZE_T dwInitialSize, SIZE_T dwMaximumSize);
+BOOL HeapDestroy(HANDLE hHeap);
+LPVOID HeapAlloc(HANDLE hHeap, DWORD dwFlags, SIZE_T dwBytes);
+LPVOID HeapReAlloc(HANDLE hHeap, DWORD dwFlags, LPVOID lpMem, SIZE_T dwBytes);
+BOOL HeapFree(HANDLE hHeap, DWORD dwFlags, LPVOID lpMem);
+SIZE_T HeapSize(HANDLE hHeap, DWORD dwFlags, LPCVOID lpMem);
+
+HMODULE LoadLibraryW(LPCWSTR lpLibFileName);
+HMODULE LoadLibraryA(LPCSTR lpLibFileName);
+BOOL FreeLibrary(HMODULE hModule);
+FARPROC GetProcAddress(HMODULE hModule, LPCSTR lpProcName);
+
+#define DLL_PROCESS_ATTACH 1
+#define DLL_THREAD_ATTACH 2
+#define DLL_THREAD_DETACH 3
+#define DLL_PROCESS_DETACH 0
+
+//===----------------------------------------------------------------------===//
+// Strings.
+
+#define CP_ACP 0
+#define CP_UTF8 65001
+#define CP_UTF16 1200
+#define MB_ERR_INVALID_CHARS 0x00000008
+#define WC_ERR_INVALID_CHARS 0x00000080
+
+// wchar_t holds UTF-32 here; the code page is only ever UTF-8 or ACP, and ACP
+// is taken to be UTF-8.
+int MultiByteToWideChar(UINT CodePage, DWORD dwFlags, LPCSTR lpMultiByteStr,
+                        int cbMultiByte, LPWSTR lpWideCharStr, int cchWideChar);
+int WideCharToMultiByte(UINT CodePage, DWORD dwFlags, LPCWSTR lpWideCharStr,
+                        int cchWideChar, LPSTR lpMultiByteStr, int cbMultiByte,
+                        LPCSTR lpDefaultChar, LPBOOL lpUsedDefaultChar);
+inline UINT GetConsoleOutputCP() { return CP_UTF8; }
+
+#define FORMAT_MESSAGE_IGNORE_INSERTS 0x00000200
+#define FORMAT_MESSAGE_FROM_SYSTEM 0x00001000
+// There is no system message table; callers fall back to the error code.
+inline DWORD FormatMessageA(DWORD dwFlags, LPCVOID lpSource, DWORD dwMessageId,
+                            DWORD dwLanguageId, LPSTR lpBuffer, DWORD nSize,
+                            va_list *Arguments) {
+  if (nSize > 0)
+    lpBuffer[0] = '\0';
+  return 0;
+}
+
+inline HRESULT StringCchCopyW(LPWSTR pszDest, size_t cchDest, LPCWSTR pszSrc) {
+  if (cchDest == 0)
+    return E_INVALIDARG;
+  size_t len = wcslen(pszSrc);
+  bool bTruncated = len >= cchDest;
+  if (bTruncated)
+    len = cchDest - 1;
+  wmemcpy(pszDest, pszSrc, len);
+  pszDest[len] = L'\0';
+  return bTruncated ? HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER) : S_OK;
+}
+inline HRESULT StringCchPrintfA(LPSTR pszDest, size_t cchDest,
+                                LPCSTR pszFormat, ...) {
+  va_list args;
+  va_start(args, pszFormat);
+  int len = vsnprintf(pszDest, cchDest, pszFormat, args);
+  va_end(args);
+  if (len < 0)
+    return E_INVALIDARG;
+  return (size_t)len >= cchDest ? HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER)
+                                : S_OK;
+}
+
+#define INTSAFE_E_ARITHMETIC_OVERFLOW ((HRESULT)0x80070216L)
+inline HRESULT UIntToInt(UINT uOperand, INT *piResult) {
+  if (uOperand > INT32_MAX) {
+    *piResult = -1;
+    return INTSAFE_E_ARITHMETIC_OVERFLOW;
+  }
+  *piResult = (INT)uOperand;
+  return S_OK;
+}
+inline HRESULT UIntAdd(UINT uAugend, UINT uAddend, UINT *puResult) {
+  if (uAugend + uAddend < uAugend) {
+    *puResult = UINT32_MAX;
+    return INTSAFE_E_ARITHMETIC_OVERFLOW;
+  }
+  *puResult = uAugend + uAddend;
+  return S_OK;
+}
+inline HRESULT UIntMult(UINT uMultiplicand, UINT uMultiplier, UINT *puResult) {
+  uint64_t result = (uint64_t)uMultiplicand * uMultiplier;
+  if (result > UINT32_MAX) {
+    *puResult = UINT32_MAX;
+    return INTSAFE_E_ARITHMETIC_OVERFLOW;
+  }
+  *puResult = (UINT)result;
+  return S_OK;
+}
+inline HRESULT SizeTToInt(size_t uOperand, INT *piResult) {
+  if (uOperand > INT32_MAX) {
+    *piResult = -1;
+    return INTSAFE_E_ARITHMETIC_OVERFLOW;
+  }
+  *piResult = (INT)uOperand;
+  return S_OK;
+}
+inline HRESULT Int32ToUInt32(INT iOperand, UINT *puResult) {
+  if (iOperand < 0) {
+    *puResult = UINT32_MAX;
+    return INTSAFE_E_ARITHMETIC_OVERFLOW;
+  }
+  *puResult = (UINT)iOperand;
+  return S_OK;
+}
+#define UInt32Add UIntAdd
+#define UInt32Mult UIntMult
+
+//===----------------------------------------------------------------------===//
+// COM.
+
+typedef struct _GUID {
+  uint32_t Data1;
+  uint16_t Data2;
+  uint16_t Data3;
+  uint8_t Data4[8];
+} GUID;
+typedef GUID IID;
+typedef GUID CLSID;
+typedef const GUID &REFGUID;
+typedef const IID &REFIID;
+typedef const CLSID &REFCLSID;
+
+inline bool IsEqualGUID(REFGUID rguid1, REFGUID rguid2) {
+  return memcmp(&rguid1, &rguid2, sizeof(GUID)) == 0;
+}
+inline bool operator==(REFGUID guidOne, REFGUID guidOther) {
+  return IsEqualGUID(guidOne, guidOther);
+}
+inline bool operator!=(REFGUID guidOne, REFGUID guidOther) {
+  return !IsEqualGUID(guidOne, guidOther);
+}
+#define IsEqualIID(riid1, riid2) IsEqualGUID(riid1, riid2)
+#define IsEqualCLSID(rclsid1, rclsid2) IsEqualGUID(rclsid1, rclsid2)
+
+struct __declspec(uuid("00000000-0000-0000-C000-000000000046")) IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid,
+                                                   void **ppvObject) = 0;
+  virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+  virtual ULONG STDMETHODCALLTYPE Release() = 0;
+  template <class Q> HRESULT QueryInterface(Q **pp) {
+    return QueryInterface(__uuidof(Q), (void **)pp);
+  }
+};
+typedef IUnknown *LPUNKNOWN;
+
+struct __declspec(uuid("ECC8691B-C1DB-4DC0-855E-65F6C551AF49")) INoMarshal
+    : public IUnknown {};
+
+struct __declspec(uuid("00000002-0000-0000-C000-000000000046")) IMalloc
+    : public IUnknown {
+  virtual void *STDMETHODCALLTYPE Alloc(SIZE_T cb) = 0;
+  virtual void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) = 0;
+  virtual void STDMETHODCALLTYPE Free(void *pv) = 0;
+  virtual SIZE_T STDMETHODCALLTYPE GetSize(void *pv) = 0;
+  virtual int STDMETHODCALLTYPE DidAlloc(void *pv) = 0;
+  virtual void STDMETHODCALLTYPE HeapMinimize() = 0;
+};
+
+typedef enum tagSTGTY {
+  STGTY_STORAGE = 1,
+  STGTY_STREAM = 2,
+  STGTY_LOCKBYTES = 3,
+  STGTY_PROPERTY = 4
+} STGTY;
+
+typedef enum tagSTREAM_SEEK {
+  STREAM_SEEK_SET = 0,
+  STREAM_SEEK_CUR = 1,
+  STREAM_SEEK_END = 2
+} STREAM_SEEK;
+
+typedef enum tagSTATFLAG {
+  STATFLAG_DEFAULT = 0,
+  STATFLAG_NONAME = 1,
+  STATFLAG_NOOPEN = 2
+} STATFLAG;
+
+typedef struct tagSTATSTG {
+  LPOLESTR pwcsName;
+  DWORD type;
+  ULARGE_INTEGER cbSize;
+  FILETIME mtime;
+  FILETIME ctime;
+  FILETIME atime;
+  DWORD grfMode;
+  DWORD grfLocksSupported;
+  CLSID clsid;
+  DWORD grfStateBits;
+  DWORD reserved;
+} STATSTG;
+
+struct __declspec(uuid("0c733a30-2a1c-11ce-ade5-00aa0044773d"))
+    ISequentialStream : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE Read(void *pv, ULONG cb,
+                                         ULONG *pcbRead) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Write(const void *pv, ULONG cb,
+                                          ULONG *pcbWritten) = 0;
+};
+
+struct __declspec(uuid("0000000c-0000-0000-C000-000000000046")) IStream
+    : public ISequentialStream {
+  virtual HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER dlibMove,
+                                         DWORD dwOrigin,
+                                         ULARGE_INTEGER *plibNewPosition) = 0;
+  virtual HRESULT STDMETHODCALLTYPE SetSize(ULARGE_INTEGER libNewSize) = 0;
+  virtual HRESULT STDMETHODCALLTYPE CopyTo(IStream *pstm, ULARGE_INTEGER cb,
+                                           ULARGE_INTEGER *pcbRead,
+                                           ULARGE_INTEGER *pcbWritten) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Commit(DWORD grfCommitFlags) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Revert() = 0;
+  virtual HRESULT STDMETHODCALLTYPE LockRegion(ULARGE_INTEGER libOffset,
+                                               ULARGE_INTEGER cb,
+                                               DWORD dwLockType) = 0;
+  virtual HRESULT STDMETHODCALLTYPE UnlockRegion(ULARGE_INTEGER libOffset,
+                                                 ULARGE_INTEGER cb,
+                                                 DWORD dwLockType) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Stat(STATSTG *pstatstg,
+                                         DWORD grfStatFlag) = 0;
+  virtual HRESULT STDMETHODCALLTYPE Clone(IStream **ppstm) = 0;
+};
+typedef IStream *LPSTREAM;
+
+// The task allocator is malloc; see lib/DxcSupport/WinAdapter.cpp.
+HRESULT CoGetMalloc(DWORD dwMemContext, IMalloc **ppMalloc);
+LPVOID CoTaskMemAlloc(SIZE_T cb);
+LPVOID CoTaskMemRealloc(LPVOID pv, SIZE_T cb);
+void CoTaskMemFree(LPVOID pv);
+
+// Strings are length-prefixed, as the callers may embed nulls.
+BSTR SysAllocString(const OLECHAR *psz);
+BSTR SysAllocStringLen(const OLECHAR *strIn, UINT ui);
+void SysFreeString(BSTR bstrString);
+UINT SysStringLen(BSTR pbstr);
+
+//===----------------------------------------------------------------------===//
+// ATL.
+
+template <class T> class CComPtrBase {
+protected:
+  CComPtrBase() throw() : p(nullptr) {}
+  CComPtrBase(T *lp) throw() : p(lp) {
+    if (p != nullptr)
+      p->AddRef();
+  }
+
+public:
+  ~CComPtrBase() throw() {
+    if (p)
+      p->Release();
+  }
+  operator T *() const throw() { return p; }
+  T &operator*() const { return *p; }
+  T **operator&() throw() { return &p; }
+  T *operator->() const throw() { return p; }
+  bool operator!() const throw() { return p == nullptr; }
+  bool operator<(T *pT) const throw() { return p < pT; }
+  bool operator!=(T *pT) const { return !operator==(pT); }
+  bool operator==(T *pT) const throw() { return p == pT; }
+
+  void Release() throw() {
+    T *pTemp = p;
+    if (pTemp) {
+      p = nullptr;
+      pTemp->Release();
+    }
+  }
+  void Attach(T *p2) throw() {
+    if (p)
+      p->Release();
+    p = p2;
+  }
+  T *Detach() throw() {
+    T *pt = p;
+    p = nullptr;
+    return pt;
+  }
+  HRESULT CopyTo(T **ppT) throw() {
+    if (ppT == nullptr)
+      return E_POINTER;
+    *ppT = p;
+    if (p)
+      p->AddRef();
+    return S_OK;
+  }
+  template <class Q> HRESULT QueryInterface(Q **pp) const throw() {
+    return p->QueryInterface(__uuidof(Q), (void **)pp);
+  }
+
+  T *p;
+};
+
+template <class T> class CComPtr : public CComPtrBase<T> {
+public:
+  CComPtr() throw() {}
+  CComPtr(T *lp) throw() : CComPtrBase<T>(lp) {}
+  CComPtr(const CComPtr<T> &lp) throw() : CComPtrBase<T>(lp.p) {}
+  CComPtr(CComPtr<T> &&lp) throw() : CComPtrBase<T>() {
+    this->p = lp.p;
+    lp.p = nullptr;
+  }
+  T *operator=(T *lp) throw() {
+    if (*this != lp) {
+      if (lp)
+        lp->AddRef();
+      if (this->p)
+        this->p->Release();
+      this->p = lp;
+    }
+    return *this;
+  }
+  T *operator=(const CComPtr<T> &lp) throw() { return *this = lp.p; }
+  T *operator=(CComPtr<T> &&lp) throw() {
+    if (this != &lp) {
+      this->Attach(lp.Detach());
+    }
+    return *this;
+  }
+};
+
+class CComAllocator {
+public:
+  static void *Reallocate(void *p, size_t nBytes) throw() {
+    return CoTaskMemRealloc(p, nBytes);
+  }
+  static void *Allocate(size_t nBytes) throw() {
+    return CoTaskMemAlloc(nBytes);
+  }
+  static void Free(void *p) throw() { CoTaskMemFree(p); }
+};
+
+template <class T, class Allocator = CComAllocator> class CHeapPtr {
+public:
+  CHeapPtr() throw() : m_pData(nullptr) {}
+  explicit CHeapPtr(T *pData) throw() : m_pData(pData) {}
+  ~CHeapPtr() throw() { Free(); }
+
+  operator T *() const throw() { return m_pData; }
+  T *operator->() const throw() { return m_pData; }
+  T **operator&() throw() { return &m_pData; }
+
+  bool Allocate(size_t nElements = 1) throw() {
+    Free();
+    m_pData = static_cast<T *>(Allocator::Allocate(nElements * sizeof(T)));
+    return m_pData != nullptr;
+  }
+  bool AllocateBytes(size_t nBytes) throw() {
+    Free();
+    m_pData = static_cast<T *>(Allocator::Allocate(nBytes));
+    return m_pData != nullptr;
+  }
+  bool Reallocate(size_t nElements) throw() {
+    T *pNew = static_cast<T *>(
+        Allocator::Reallocate(m_pData, nElements * sizeof(T)));
+    if (pNew == nullptr)
+      return false;
+    m_pData = pNew;
+    return true;
+  }
+  void Attach(T *pData) throw() {
+    Free();
+    m_pData = pData;
+  }
+  T *Detach() throw() {
+    T *pTemp = m_pData;
+    m_pData = nullptr;
+    return pTemp;
+  }
+  void Free() throw() {
+    Allocator::Free(m_pData);
+    m_pData = nullptr;
+  }
+
+  T *m_pData;
+
+private:
+  CHeapPtr(const CHeapPtr &) = delete;
+  CHeapPtr &operator=(const CHeapPtr &) = delete;
+};
+
+template <class T> class CComHeapPtr : public CHeapPtr<T, CComAllocator> {
+public:
+  CComHeapPtr() throw() {}
+  explicit CComHeapPtr(T *pData) throw() : CHeapPtr<T, CComAllocator>(pData) {}
+};
+
+class CComBSTR {
+public:
+  BSTR m_str;
+  CComBSTR() : m_str(nullptr) {}
+  CComBSTR(LPCOLESTR pSrc) : m_str(pSrc ? SysAllocString(pSrc) : nullptr) {}
+  CComBSTR(int nSize, LPCOLESTR sz) : m_str(SysAllocStringLen(sz, nSize)) {}
+  ~CComBSTR() { SysFreeString(m_str); }
+  operator BSTR() const throw() { return m_str; }
+  BSTR *operator&() throw() { return &m_str; }
+  unsigned int Length() const throw() { return SysStringLen(m_str); }
+  void Empty() throw() {
+    SysFreeString(m_str);
+    m_str = nullptr;
+  }
+  BSTR Detach() throw() {
+    BSTR s = m_str;
+    m_str = nullptr;
+    return s;
+  }
+
+private:
+  CComBSTR(const CComBSTR &) = delete;
+  CComBSTR &operator=(const CComBSTR &) = delete;
+};
+
+// Closes a file or mapping handle when it goes out of scope.
+class CHandle {
+public:
+  CHandle() : m_h(nullptr) {}
+  explicit CHandle(HANDLE h) : m_h(h) {}
+  ~CHandle() {
+    if (m_h != nullptr && m_h != INVALID_HANDLE_VALUE)
+      CloseHandle(m_h);
+  }
+  operator HANDLE() const { return m_h; }
+  HANDLE Detach() {
+    HANDLE h = m_h;
+    m_h = nullptr;
+    return h;
+  }
+
+  HANDLE m_h;
+
+private:
+  CHandle(const CHandle &) = delete;
+  CHandle &operator=(const CHandle &) = delete;
+};
+
+// Conversions between UTF-8 and wide strings.
+class CW2A {
+public:
+  CW2A(LPCWSTR psz, UINT nCodePage = CP_ACP) : m_psz(nullptr) {
+    if (psz == nullptr)
+      return;
+    int len = WideCharToMultiByte(nCodePage, 0, psz, -1, nullptr, 0, nullptr,
+                                  nullptr);
+    m_psz = new char[len > 0 ? len : 1];
+    m_psz[0] = '\0';
+    if (len > 0)
+      WideCharToMultiByte(nCodePage, 0, psz, -1, m_psz, len, nullptr, nullptr);
+  }
+  ~CW2A() { delete[] m_psz; }
+  operator LPSTR() const { return m_psz; }
+
+  LPSTR m_psz;
+
+private:
+  CW2A(const CW2A &) = delete;
+  CW2A &operator=(const CW2A &) = delete;
+};
+
+class CA2W {
+public:
+  CA2W(LPCSTR psz, UINT nCodePage = CP_ACP) : m_psz(nullptr) {
+    if (psz == nullptr)
+      return;
+    int len = MultiByteToWideChar(nCodePage, 0, psz, -1, nullptr, 0);
+    m_psz = new wchar_t[len > 0 ? len : 1];
+    m_psz[0] = L'\0';
+    if (len > 0)
+      MultiByteToWideChar(nCodePage, 0, psz, -1, m_psz, len);
+  }
+  ~CA2W() { delete[] m_psz; }
+  operator LPWSTR() const { return m_psz; }
+
+  LPWSTR m_psz;
+
+private:
+  CA2W(const CA2W &) = delete;
+  CA2W &operator=(const CA2W &) = delete;
+};
+
+#endif // _WIN32
+
+#endif // LLVM_SUPPORT_WIN_ADAPTER_H
@@ -10,6 +10,8 @@
 
 #pragma once
 
+#ifdef _WIN32
+
 #define NOATOM 1
 #define NOGDICAPMASKS 1
 #define NOMETAFILE 1
@@ -39,6 +41,12 @@
 #define _ATL_DECLSPEC_ALLOCATOR
 #endif
 
+#else // _WIN32
+
+#include "dxc/Support/WinAdapter.h"
+
+#endif // _WIN32
+
 /// Swap two ComPtr classes.
 template <class T> void swap(CComHeapPtr<T> &a, CComHeapPtr<T> &b) {
   T *c(a.m_pData);
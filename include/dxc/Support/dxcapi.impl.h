@@ -13,7 +13,9 @@
 #define __DXCAPI_IMPL__
 
 #include "dxc/dxcapi.h"
+#include "dxc/HLSL/DxilContainer.h"
 #include "dxc/Support/microcom.h"
+#include "dxc/Support/Unicode.h"
 #include "llvm/Support/raw_ostream.h"
 
 // Simple adaptor for IStream. Can probably do better.
@@ -32,10 +34,29 @@ public:
   }
 };
 
-class DxcOperationResult : public IDxcOperationResult {
+class DxcOperationResult : public IDxcOperationResult,
+                           public IDxcTimeReport,
+                           public IDxcTimeTrace,
+                           public IDxcIRStats,
+                           public IDxcAllocationStats,
+                           public IDxcShaderHash,
+                           public IDxcIncludeDependencies,
+                           public IDxcSpirvReflection,
+                           public IDxcSourcePack {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
 
+  // Escapes the characters make gives a meaning to in rules.
+  static void AppendMakeEscaped(std::string &text, llvm::StringRef name) {
+    for (char c : name) {
+      if (c == ' ' || c == '#')
+        text += '\\';
+      else if (c == '$')
+        text += '$';
+      text += c;
+    }
+  }
+
   void Init(_In_opt_ IDxcBlob *pResultBlob,
             _In_opt_ IDxcBlobEncoding *pErrorBlob, HRESULT status) {
     m_status = status;
@@ -45,14 +66,34 @@ private:
 
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
-  DXC_MICROCOM_TM_CTOR(DxcOperationResult)
+  DXC_MICROCOM_TM_ALLOC(DxcOperationResult)
+  DxcOperationResult(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_hasAllocationStats(false) {}
 
   HRESULT m_status;
   CComPtr<IDxcBlob> m_result;
   CComPtr<IDxcBlobEncoding> m_errors;
+  CComPtr<IDxcBlobEncoding> m_timeReport;
+  CComPtr<IDxcBlobEncoding> m_timeTrace;
+  CComPtr<IDxcBlobEncoding> m_irStats;
+  CComPtr<IDxcBlobEncoding> m_dependencies;
+  CComPtr<IDxcBlob> m_spirvReflection;
+  CComPtr<IDxcBlob> m_sourcePack;
+  bool m_hasAllocationStats;
+  DxcAllocationStats m_allocationStats;
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcOperationResult>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcOperationResult, IDxcTimeReport,
+                                 IDxcTimeTrace, IDxcIRStats,
+                                 IDxcAllocationStats,
+                                 IDxcShaderHash, IDxcIncludeDependencies,
+                                 IDxcSpirvReflection, IDxcSourcePack>(
+        this, iid, ppvObject);
+  }
+
+  void SetAllocationStats(const DxcAllocationStats &stats) {
+    m_hasAllocationStats = true;
+    m_allocationStats = stats;
   }
 
   static HRESULT CreateFromResultErrorStatus(_In_opt_ IDxcBlob *pResultBlob,
@@ -114,6 +155,120 @@ public:
     GetErrorBuffer(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppErrors) {
     return m_errors.CopyTo(ppErrors);
   }
+
+  __override HRESULT STDMETHODCALLTYPE
+    GetTimeReport(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppReport) {
+    return m_timeReport.CopyTo(ppReport);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE
+    GetTimeTrace(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppTrace) {
+    return m_timeTrace.CopyTo(ppTrace);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE
+    GetIRStats(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppStats) {
+    return m_irStats.CopyTo(ppStats);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE
+    GetAllocationStats(_Out_ DxcAllocationStats *pStats) {
+    if (pStats == nullptr)
+      return E_INVALIDARG;
+    if (!m_hasAllocationStats) {
+      memset(pStats, 0, sizeof(*pStats));
+      return S_FALSE;
+    }
+    *pStats = m_allocationStats;
+    return S_OK;
+  }
+
+  __override HRESULT STDMETHODCALLTYPE
+    GetShaderHash(_Out_ DxcShaderHash *pHash) {
+    if (pHash == nullptr)
+      return E_INVALIDARG;
+    memset(pHash, 0, sizeof(*pHash));
+    // Only containers this library produced are returned as results, so the
+    // part headers can be trusted.
+    if (m_result == nullptr ||
+        m_result->GetBufferSize() < sizeof(hlsl::DxilContainerHeader))
+      return S_FALSE;
+    const hlsl::DxilContainerHeader *pHeader =
+        (const hlsl::DxilContainerHeader *)m_result->GetBufferPointer();
+    if (pHeader->HeaderFourCC != hlsl::DFCC_Container)
+      return S_FALSE;
+    for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+      const hlsl::DxilPartHeader *pPart = hlsl::GetDxilContainerPart(pHeader, i);
+      if (pPart->PartFourCC != hlsl::DFCC_ShaderHash ||
+          pPart->PartSize != sizeof(hlsl::DxilShaderHash))
+        continue;
+      const hlsl::DxilShaderHash *pPartHash =
+          (const hlsl::DxilShaderHash *)hlsl::GetDxilPartData(pPart);
+      static_assert(sizeof(pHash->HashDigest) == sizeof(pPartHash->Digest),
+                    "else digest sizes differ");
+      pHash->Flags = pPartHash->Flags;
+      memcpy(pHash->HashDigest, pPartHash->Digest, sizeof(pHash->HashDigest));
+      return S_OK;
+    }
+    return S_FALSE;
+  }
+
+  __override HRESULT STDMETHODCALLTYPE
+    GetSpirvReflection(_COM_Outptr_result_maybenull_ IDxcBlob **ppReflection) {
+    if (ppReflection == nullptr)
+      return E_INVALIDARG;
+    m_spirvReflection.CopyTo(ppReflection);
+    return m_spirvReflection ? S_OK : S_FALSE;
+  }
+
+  __override HRESULT STDMETHODCALLTYPE
+    GetSourcePack(_COM_Outptr_result_maybenull_ IDxcBlob **ppSourcePack) {
+    if (ppSourcePack == nullptr)
+      return E_INVALIDARG;
+    m_sourcePack.CopyTo(ppSourcePack);
+    return m_sourcePack ? S_OK : S_FALSE;
+  }
+
+  __override HRESULT STDMETHODCALLTYPE GetDependencies(
+      _COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppDependencies) {
+    if (ppDependencies == nullptr)
+      return E_INVALIDARG;
+    m_dependencies.CopyTo(ppDependencies);
+    return m_dependencies ? S_OK : S_FALSE;
+  }
+
+  __override HRESULT STDMETHODCALLTYPE GetDependencyFile(
+      _In_ LPCWSTR pTargetName,
+      _COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppDependencyFile) {
+    if (pTargetName == nullptr || ppDependencyFile == nullptr)
+      return E_INVALIDARG;
+    *ppDependencyFile = nullptr;
+    if (m_dependencies == nullptr)
+      return S_FALSE;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::string target;
+      IFTBOOL(Unicode::UTF16ToUTF8String(pTargetName, &target), E_INVALIDARG);
+      std::string text;
+      AppendMakeEscaped(text, target);
+      text += ':';
+      llvm::StringRef files((const char *)m_dependencies->GetBufferPointer(),
+                            m_dependencies->GetBufferSize());
+      while (!files.empty()) {
+        llvm::StringRef file;
+        std::tie(file, files) = files.split('\n');
+        if (file.empty())
+          continue;
+        text += " \\\n  ";
+        AppendMakeEscaped(text, file);
+      }
+      text += '\n';
+      return hlsl::DxcCreateBlobWithEncodingOnHeapCopy(
+          text.data(), text.size(), CP_UTF8, ppDependencyFile);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
 };
 
 #endif
@@ -40,6 +40,13 @@ public:
   virtual void EnableDisplayIncludeProcess() = 0;
   virtual HRESULT CreateStdStreams(_In_ IMalloc *pMalloc) = 0;
   virtual HRESULT RegisterOutputStream(LPCWSTR pName, IStream *pStream) = 0;
+  // Makes pBlob readable as pName without going through the include handler
+  // or converting it to UTF-8; used for binary inputs such as token caches.
+  virtual HRESULT RegisterInputBlob(LPCWSTR pName, IDxcBlob *pBlob) = 0;
+  // Files opened so far; index 0 is the main source file.
+  virtual unsigned GetIncludedFileCount() = 0;
+  virtual void GetIncludedFile(unsigned index, _Outptr_ LPCWSTR *ppName,
+                               _COM_Outptr_ IDxcBlob **ppBlob) = 0;
 };
 
 DxcArgsFileSystem *
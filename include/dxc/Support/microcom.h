@@ -130,6 +130,21 @@ void DxcCallDestructor(T *obj) {
     return (T *)P; \
   }
 
+template<typename TObject>
+HRESULT DoBasicQueryInterface_recurse(TObject* self, REFIID iid, void** ppvObject) {
+  return E_NOINTERFACE;
+}
+template<typename TObject, typename TInterface, typename... Ts>
+HRESULT DoBasicQueryInterface_recurse(TObject* self, REFIID iid, void** ppvObject) {
+  if (ppvObject == nullptr) return E_POINTER;
+  if (IsEqualIID(iid, __uuidof(TInterface))) {
+    *(TInterface**)ppvObject = self;
+    self->AddRef();
+    return S_OK;
+  }
+  return DoBasicQueryInterface_recurse<TObject, Ts...>(self, iid, ppvObject);
+}
+
 /// <summary>
 /// Provides a QueryInterface implementation for a class that supports
 /// any number of interfaces in addition to IUnknown.
@@ -154,21 +169,6 @@ HRESULT DoBasicQueryInterface(TObject* self, REFIID iid, void** ppvObject) {
   return DoBasicQueryInterface_recurse<TObject, Ts...>(self, iid, ppvObject);
 }
 
-template<typename TObject>
-HRESULT DoBasicQueryInterface_recurse(TObject* self, REFIID iid, void** ppvObject) {
-  return E_NOINTERFACE;
-}
-template<typename TObject, typename TInterface, typename... Ts>
-HRESULT DoBasicQueryInterface_recurse(TObject* self, REFIID iid, void** ppvObject) {
-  if (ppvObject == nullptr) return E_POINTER;
-  if (IsEqualIID(iid, __uuidof(TInterface))) {
-    *(TInterface**)ppvObject = self;
-    self->AddRef();
-    return S_OK;
-  }
-  return DoBasicQueryInterface_recurse<TObject, Ts...>(self, iid, ppvObject);
-}
-
 template <typename T>
 HRESULT AssignToOut(T value, _Out_ T* pResult) {
   if (pResult == nullptr)
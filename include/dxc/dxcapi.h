@@ -19,6 +19,7 @@
 
 struct IMalloc;
 struct IDxcIncludeHandler;
+struct IDxcModuleHandle;
 
 /// <summary>
 /// Creates a single uninitialized object of the class associated with a specified CLSID.
@@ -130,6 +131,126 @@ IDxcOperationResult : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE GetErrorBuffer(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **pErrors) = 0;
 };
 
+// Implemented by compilation results. The report is a UTF-8 JSON object with
+// the time and peak memory of each phase and pass, and is only produced when
+// -ftime-report is given.
+struct __declspec(uuid("74a88468-bb38-4a41-9882-9a49c02fd628"))
+IDxcTimeReport : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetTimeReport(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppReport) = 0;
+};
+
+// Implemented by compilation results. The trace is a UTF-8 JSON object in the
+// Chrome trace event format with each run of a phase and pass, and is only
+// produced when -ftime-trace is given.
+struct __declspec(uuid("b3f1e6a0-5c27-4d94-8e0b-7a61c49d2f35"))
+IDxcTimeTrace : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetTimeTrace(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppTrace) = 0;
+};
+
+// Implemented by compilation results. The statistics are a UTF-8 table with
+// the functions, blocks and instructions of the module after each run of a
+// pass and the bytes allocated during the run, and are only produced when
+// -print-ir-stats is given.
+struct __declspec(uuid("0af3bcf5-f140-4d36-9986-d07d6afbbadc"))
+IDxcIRStats : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE GetIRStats(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppStats) = 0;
+};
+
+// Allocations made through the thread allocator during an operation. Size
+// class i counts the blocks of up to 16 << (2 * i) bytes that don't fit a
+// smaller class; the last class counts all larger blocks.
+static const UINT32 DxcAllocationSizeClassCount = 8;
+struct DxcAllocationStats {
+  UINT64 AllocCount;    // Blocks allocated, including reallocations.
+  UINT64 AllocBytes;    // Bytes requested by those allocations.
+  UINT64 PeakBytes;     // Largest number of bytes live at any one time.
+  UINT64 SizeClassCounts[DxcAllocationSizeClassCount];
+};
+
+// Implemented by the results of Compile and Link when -falloc-stats is given
+// and of Validate with DxcValidatorFlags_AllocationStats, and by the
+// optimizer for its last RunOptimizer call with -falloc-stats.
+struct __declspec(uuid("9D4A7C61-0B3E-4F28-A5D9-6E17C2B8F043"))
+IDxcAllocationStats : public IUnknown {
+  // Returns S_FALSE and zeroed statistics when none were collected.
+  virtual HRESULT STDMETHODCALLTYPE GetAllocationStats(_Out_ DxcAllocationStats *pStats) = 0;
+};
+
+// Hash of the parts of a container that the runtime uses, leaving out debug
+// information and private data.
+struct DxcShaderHash {
+  UINT32 Flags;         // Reserved, zero.
+  BYTE HashDigest[16];  // MD5 digest.
+};
+
+// Implemented by operation results. The hash is read from the HASH part of
+// the result container, which is computed while the container is assembled
+// when -Qembed_hash is given, so getting it doesn't scan the container.
+struct __declspec(uuid("3853ac60-832b-44e4-ac3e-12b8231f95e6"))
+IDxcShaderHash : public IUnknown {
+  // Returns S_FALSE and a zeroed hash when the result has no HASH part.
+  virtual HRESULT STDMETHODCALLTYPE GetShaderHash(_Out_ DxcShaderHash *pHash) = 0;
+};
+
+// Implemented by results of IDxcCompiler::Compile and Preprocess.
+struct __declspec(uuid("21a63545-d239-4859-8ddf-04252280d41e"))
+IDxcIncludeDependencies : public IUnknown {
+  // Returns the files the result was produced from as UTF-8 text, one name
+  // per line: the main source file, then each included file in the order it
+  // was first opened. For a compile with -fpreprocessed, these are the files
+  // named by the #line directives of the source. Returns S_FALSE and a null
+  // blob when the arguments could not be read.
+  virtual HRESULT STDMETHODCALLTYPE GetDependencies(
+    _COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppDependencies) = 0;
+
+  // Returns the same files as a Makefile rule for pTargetName, in the format
+  // that make and Ninja read from depfiles. Returns S_FALSE and a null blob
+  // when GetDependencies has nothing to list.
+  virtual HRESULT STDMETHODCALLTYPE GetDependencyFile(
+    _In_ LPCWSTR pTargetName,                     // Output file the rule is for
+    _COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppDependencyFile) = 0;
+};
+
+// Implemented by results of IDxcCompiler::Compile. The blob is the SPIR-V
+// reflection sidecar laid out in dxc/Support/SpirvReflection.h, and is only
+// produced for -spirv compiles with -fspv-reflect-sidecar.
+struct __declspec(uuid("5c0e8a27-3b94-4f6d-a1c8-92e4d07b6f13"))
+IDxcSpirvReflection : public IUnknown {
+  // Returns S_FALSE and a null blob when no sidecar was produced.
+  virtual HRESULT STDMETHODCALLTYPE GetSpirvReflection(
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppReflection) = 0;
+};
+
+// Implemented by results of IDxcCompiler::Compile. The blob is a container of
+// DFCC_ShaderSource parts laid out in dxc/HLSL/DxilContainer.h, one per
+// distinct source file, and is only produced for compiles with
+// -Qsource_pack, whose debug info names source files by MD5 digest.
+struct __declspec(uuid("4b4f9ca5-be32-4a71-9c11-5c529c8a8438"))
+IDxcSourcePack : public IUnknown {
+  // Returns S_FALSE and a null blob when no source pack was produced.
+  virtual HRESULT STDMETHODCALLTYPE GetSourcePack(
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppSourcePack) = 0;
+};
+
+// Loads the sources that debug info compiled with -Qsource_pack names by
+// digest, for example from a store of source packs.
+struct __declspec(uuid("8055f360-2c74-4ba1-a660-2d926fd91bcb"))
+IDxcSourceProvider : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE LoadSource(
+    _In_reads_(16) const BYTE *pDigest,             // MD5 digest of the content.
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppSource // Content, nullptr if not found.
+    ) = 0;
+};
+
+// Implemented by the data source created from CLSID_DxcDiaDataSource. Sessions
+// opened after the provider is set load the sources of source pack debug info
+// through it when their content is first read.
+struct __declspec(uuid("7255bb04-f6ce-4deb-bf21-62232a823446"))
+IDxcDiaSourceProviderSite : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE SetSourceProvider(
+    _In_opt_ IDxcSourceProvider *pProvider) = 0;
+};
+
 struct __declspec(uuid("7f61fc7d-950d-467f-b3e3-3c02fb49187c"))
 IDxcIncludeHandler : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE LoadSource(
@@ -138,11 +259,31 @@ IDxcIncludeHandler : public IUnknown {
     ) = 0;
 };
 
+struct __declspec(uuid("ca373e0f-f84d-4b98-adb2-5529cb3c32ac"))
+IDxcIncludeCache : public IUnknown {
+  // Create an include handler that serves files from this cache, loading them
+  // through pIncludeHandler on a miss. Cached files are kept as UTF-8 and are
+  // handed out without copying. Files that exist on disk are reloaded when
+  // their size or write time changes; other files are kept until Clear.
+  // Files the handler fails to load are cached the same way, so search paths
+  // that don't have a file are probed once rather than on every compile.
+  // The cache may be shared across compilers and threads.
+  virtual HRESULT STDMETHODCALLTYPE CreateIncludeHandler(
+    _In_ IDxcIncludeHandler *pIncludeHandler,     // Handler used to load files not in the cache
+    _COM_Outptr_ IDxcIncludeHandler **ppResult    // Caching include handler
+  ) = 0;
+
+  // Drop all cached files.
+  virtual HRESULT STDMETHODCALLTYPE Clear() = 0;
+};
+
 struct DxcDefine {
   LPCWSTR Name;
   _Maybenull_ LPCWSTR Value;
 };
 
+// Compiler objects may be used from several threads at once. Extensions or
+// handlers registered while a compile runs apply to compiles started later.
 struct __declspec(uuid("8c210bf3-011f-4422-8d70-6f9acb8db617"))
 IDxcCompiler : public IUnknown {
   // Compile a single entry point to the target shader model
@@ -197,6 +338,216 @@ IDxcCompiler2 : public IDxcCompiler {
   ) = 0;
 };
 
+struct __declspec(uuid("5E3B0C9A-7F2D-4C61-9B8E-2A4D6F1C3B57"))
+IDxcCompilerBatch : public IUnknown {
+  // Compile several entry points from the same source. The source is parsed
+  // and analyzed once; code generation and validation run per entry point.
+  // Library and root signature profiles are not supported.
+  virtual HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ UINT32 entryCount,                       // Number of entry points
+    _In_count_(entryCount) LPCWSTR *pEntryPoints, // Array of entry point names
+    _In_count_(entryCount) LPCWSTR *pTargetProfiles, // Shader profile for each entry point
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _Out_writes_(entryCount) IDxcOperationResult **ppResults // Compiler output for each entry point
+  ) = 0;
+};
+
+struct __declspec(uuid("8b4f2d61-e937-4a0c-9c15-d6a3f07b28e4"))
+IDxcCompilerPermutations : public IUnknown {
+  // Compile one entry point for several sets of defines. Permutations that
+  // preprocess to the same text are compiled once, and permutations whose
+  // output and messages are identical share one result object. With
+  // maxThreads above one, distinct permutations are compiled in parallel,
+  // and pIncludeHandler must then allow calls from several threads.
+  virtual HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ LPCWSTR pEntryPoint,                     // Entry point name
+    _In_ LPCWSTR pTargetProfile,                  // Shader profile to compile
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_ UINT32 permutationCount,                 // Number of permutations
+    _In_count_(permutationCount) const DxcDefine *const *ppDefines, // Defines of each permutation
+    _In_count_(permutationCount) const UINT32 *pDefineCounts, // Number of defines of each permutation
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ UINT32 maxThreads,                       // Most compiles to run at once; 0 or 1 compiles serially
+    _Out_writes_(permutationCount) IDxcOperationResult **ppResults // Compiler output for each permutation
+  ) = 0;
+};
+
+// Priorities for IDxcCompilerAsync::CompileAsync. Queued requests start in
+// priority order, and in submission order within a priority.
+enum DxcCompilePriority {
+  DxcCompilePriority_Background = 0,
+  DxcCompilePriority_Normal = 1,
+  DxcCompilePriority_Interactive = 2,
+};
+
+struct __declspec(uuid("d7a4e2b9-3f81-4c56-b0e7-94c1a5f83d62"))
+IDxcCompletionCallback : public IUnknown {
+  // Called on a compiler worker thread when a request finishes. pResult is
+  // null if the request was cancelled, in which case hrStatus is E_ABORT.
+  // The callback may submit further requests.
+  virtual void STDMETHODCALLTYPE OnCompileCompleted(
+    _In_ UINT64 requestId,                        // Id returned by CompileAsync
+    _In_ HRESULT hrStatus,                        // Status of the request
+    _In_opt_ IDxcOperationResult *pResult         // Compiler output status, buffer, and errors
+  ) = 0;
+};
+
+struct __declspec(uuid("1e5c93f7-a2d8-4b6e-8f04-c7b3e61d9a25"))
+IDxcCompilerAsync : public IUnknown {
+  // Queue a compile of a single entry point. The arguments are copied, so
+  // the caller's buffers needn't outlive the call, but pSource and
+  // pIncludeHandler are kept and used from a worker thread. If pCallback is
+  // null, the result is kept until Wait is called for the request.
+  virtual HRESULT STDMETHODCALLTYPE CompileAsync(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ LPCWSTR pEntryPoint,                     // entry point name
+    _In_ LPCWSTR pTargetProfile,                  // shader profile to compile
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _In_ UINT32 priority,                         // A DxcCompilePriority value
+    _In_opt_ IDxcCompletionCallback *pCallback,   // Called when the request finishes (optional)
+    _Out_ UINT64 *pRequestId                      // Id of the queued request
+  ) = 0;
+
+  // Cancel a request. A queued request completes right away; a compile in
+  // progress stops at its next cancellation point and completes with
+  // E_ABORT. Returns S_FALSE if the request has already finished.
+  virtual HRESULT STDMETHODCALLTYPE Cancel(_In_ UINT64 requestId) = 0;
+
+  // Wait for a request submitted without a callback and take its result.
+  // Returns E_PENDING if the request doesn't finish within the timeout, and
+  // E_ABORT if it was cancelled.
+  virtual HRESULT STDMETHODCALLTYPE Wait(
+    _In_ UINT64 requestId,                        // Id returned by CompileAsync
+    _In_ DWORD milliseconds,                      // Timeout, or INFINITE
+    _COM_Outptr_result_maybenull_ IDxcOperationResult **ppResult // Compiler output status, buffer, and errors
+  ) = 0;
+};
+
+struct __declspec(uuid("6f2a8d43-1c5e-4b97-a0d6-3e81b7c92f54"))
+IDxcFunctionDisassembler : public IUnknown {
+  // Disassemble a single function of a program. The module summary comments
+  // are printed as for IDxcCompiler::Disassemble, followed by only the named
+  // function. Returns E_INVALIDARG if the program has no such function.
+  virtual HRESULT STDMETHODCALLTYPE DisassembleFunction(
+    _In_ IDxcBlob *pProgram,                      // Program to disassemble.
+    _In_ LPCWSTR pFunctionName,                   // Name of the function in the module.
+    _COM_Outptr_ IDxcBlobEncoding **ppDisassembly // Disassembly text.
+  ) = 0;
+};
+
+// Implemented by the caller to stop compiles that take too long. The compiler
+// asks between optimization passes and periodically while parsing and
+// lowering, from the thread running the compile; a deadline is enforced by
+// returning TRUE once it has passed.
+struct __declspec(uuid("3a9e6c52-7d14-4f8b-b2c0-58e1d4a7f603"))
+IDxcCancellationToken : public IUnknown {
+  virtual BOOL STDMETHODCALLTYPE IsCancelled() = 0;
+};
+
+struct __declspec(uuid("c4f17b8e-95a2-4d3c-8e6f-0b2d7a95e1c4"))
+IDxcCompilerCancellation : public IUnknown {
+  // Set the token that the compiles run by this compiler poll, or null to
+  // clear it. A cancelled compile returns E_ABORT, and the compiler can be
+  // used again.
+  virtual HRESULT STDMETHODCALLTYPE SetCancellationToken(
+    _In_opt_ IDxcCancellationToken *pToken
+  ) = 0;
+};
+
+// The size of the module after an optimization pass.
+struct DxcPassIRStats {
+  UINT64 Functions;     // Function definitions.
+  UINT64 Blocks;        // Basic blocks.
+  UINT64 Instructions;
+};
+
+// Implemented by the caller to follow compiles, links and optimizer runs as
+// they happen, e.g. to show progress or collect timings in process. It is
+// called synchronously from the thread doing the work, at the points the ETW
+// provider writes its events, so it should return quickly; a batch may call
+// it from several threads at once. Names are only valid during the call, and
+// the return values are ignored.
+struct __declspec(uuid("bd371c2d-01f1-47f5-a11e-9e7810713eed"))
+IDxcCompilerEventsCallback : public IUnknown {
+  // A phase such as "frontend" or "container" started or ended.
+  virtual HRESULT STDMETHODCALLTYPE OnPhaseBegin(_In_z_ LPCSTR pName) = 0;
+  virtual HRESULT STDMETHODCALLTYPE OnPhaseEnd(_In_z_ LPCSTR pName) = 0;
+  // An optimization pass started or ended; pStats is the size of the module
+  // after the pass.
+  virtual HRESULT STDMETHODCALLTYPE OnPassBegin(_In_z_ LPCSTR pName) = 0;
+  virtual HRESULT STDMETHODCALLTYPE OnPassEnd(_In_z_ LPCSTR pName,
+                                              _In_ const DxcPassIRStats *pStats) = 0;
+  // The include handler returned a file for an #include.
+  virtual HRESULT STDMETHODCALLTYPE OnIncludeOpened(_In_z_ LPCWSTR pFileName) = 0;
+  // A compile or link result was looked up in a cache.
+  virtual HRESULT STDMETHODCALLTYPE OnCacheLookup(BOOL hit) = 0;
+};
+
+// Implemented by the compiler, the linker and the optimizer.
+struct __declspec(uuid("d442af8a-9331-4b06-9534-fa17e8e3d737"))
+IDxcCompilerEvents : public IUnknown {
+  // Set the callback for the work done by this object from now on, or null
+  // to clear it.
+  virtual HRESULT STDMETHODCALLTYPE SetEventsCallback(
+    _In_opt_ IDxcCompilerEventsCallback *pCallback
+  ) = 0;
+};
+
+// Holds a target profile, arguments and defines that have been read once, so
+// that compiles which differ only in their entry point and a few defines can
+// skip parsing them. The object is immutable and may be shared across
+// compilers and threads, but only compilers from the same module accept it.
+struct __declspec(uuid("9c85488a-6c99-4a92-8ce5-45ce566cdca4"))
+IDxcCompilerArgs : public IUnknown {
+  // Returns the arguments the object was created with.
+  virtual HRESULT STDMETHODCALLTYPE GetArguments(
+    _Outptr_result_buffer_(*pArgCount) LPCWSTR **ppArguments, // Array of pointers to arguments, owned by the object
+    _Out_ UINT32 *pArgCount                       // Number of arguments
+  ) = 0;
+};
+
+struct __declspec(uuid("a85cd100-b95b-4b0a-94f1-93fc22ec8857"))
+IDxcCompilerWithArgs : public IUnknown {
+  // Read a target profile, arguments and defines into a reusable object. On
+  // invalid arguments, returns E_INVALIDARG and the diagnostics in ppErrors.
+  virtual HRESULT STDMETHODCALLTYPE CreateArgs(
+    _In_ LPCWSTR pTargetProfile,                  // shader profile to compile
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _COM_Outptr_ IDxcCompilerArgs **ppArgs,       // Parsed arguments
+    _COM_Outptr_opt_result_maybenull_ IDxcBlobEncoding **ppErrors // Diagnostics for invalid arguments
+  ) = 0;
+
+  // Compile a single entry point with arguments created by CreateArgs. The
+  // defines given here are added after the ones the arguments hold.
+  virtual HRESULT STDMETHODCALLTYPE CompileWithArgs(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ LPCWSTR pEntryPoint,                     // entry point name
+    _In_ IDxcCompilerArgs *pArgs,                 // Target profile, arguments and base defines
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of additional defines
+    _In_ UINT32 defineCount,                      // Number of additional defines
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Compiler output status, buffer, and errors
+  ) = 0;
+};
+
 struct __declspec(uuid("F1B5BE2A-62DD-4327-A1C2-42AC1E1E78E6"))
 IDxcLinker : public IUnknown {
 public:
@@ -222,11 +573,44 @@ public:
   ) = 0;
 };
 
+struct __declspec(uuid("3A7C9E51-2B64-4D8F-A0E3-6C15B94F7D28"))
+IDxcLinkerBatch : public IUnknown {
+  // Link several entry points against the same libraries. Entries are linked
+  // concurrently, each on its own copy of the libraries, and results are
+  // returned in entry order.
+  virtual HRESULT STDMETHODCALLTYPE LinkBatch(
+      _In_ UINT32 entryCount, // Number of entry points
+      _In_count_(entryCount)
+          const LPCWSTR *pEntryNames, // Array of entry point names
+      _In_count_(entryCount)
+          const LPCWSTR *pTargetProfiles, // Shader profile for each entry
+      _In_count_(libCount)
+          const LPCWSTR *pLibNames, // Array of library names to link
+      UINT32 libCount,              // Number of libraries to link
+      _In_count_(argCount)
+          const LPCWSTR *pArguments, // Array of pointers to arguments
+      _In_ UINT32 argCount,          // Number of arguments
+      _Out_writes_(entryCount) IDxcOperationResult *
+          *ppResults // Linker output for each entry point
+  ) = 0;
+};
+
 static const UINT32 DxcValidatorFlags_Default = 0;
 static const UINT32 DxcValidatorFlags_InPlaceEdit = 1;  // Validator is allowed to update shader blob in-place.
 static const UINT32 DxcValidatorFlags_RootSignatureOnly = 2;
 static const UINT32 DxcValidatorFlags_ModuleOnly = 4;
-static const UINT32 DxcValidatorFlags_ValidMask = 0x7;
+// Containers whose DXIL module and dependent parts this validator has already
+// accepted are not validated again; if only the root signature differs, only
+// the root signature is validated.
+static const UINT32 DxcValidatorFlags_SkipIfValidated = 8;
+// The result implements IDxcAllocationStats.
+static const UINT32 DxcValidatorFlags_AllocationStats = 16;
+// Skips the whole-program checks: reducibility and dead loops, thread group
+// shared memory race conditions and wave-sensitive gradients. Containers
+// validated this way aren't recorded for DxcValidatorFlags_SkipIfValidated,
+// and must be fully validated before they're signed for release.
+static const UINT32 DxcValidatorFlags_Quick = 32;
+static const UINT32 DxcValidatorFlags_ValidMask = 0x3f;
 
 struct __declspec(uuid("A6E82BD2-1FD7-4826-9811-2857E797F49A"))
 IDxcValidator : public IUnknown {
@@ -255,6 +639,18 @@ IDxcAssembler : public IUnknown {
     ) = 0;
 };
 
+struct __declspec(uuid("e7b05a93-1d64-4c28-b3f1-6a0d94c2e817"))
+IDxcAssembler2 : public IDxcAssembler {
+  // Assemble a live DXIL module to a validated DXIL container. The module is
+  // written to bitcode once, and the validator built into the compiler
+  // validates the module without parsing the container. The handle's module
+  // is left unchanged.
+  virtual HRESULT STDMETHODCALLTYPE AssembleAndValidateModule(
+    _In_ IDxcModuleHandle *pModule,               // Module to assemble.
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Assembly output status, buffer, and errors
+    ) = 0;
+};
+
 struct __declspec(uuid("d2c21b26-8350-4bdc-976a-331ce6f4c54c"))
 IDxcContainerReflection : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pContainer) = 0; // Container to load.
@@ -284,6 +680,97 @@ IDxcOptimizer : public IUnknown {
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
 };
 
+// A module kept live in memory, so that optimizing and assembling it within
+// one process doesn't write and parse bitcode between the steps. A handle
+// must not be used on more than one thread at a time.
+struct __declspec(uuid("2a9d6c41-58e3-4f0b-9e7d-c14b83a5f290"))
+IDxcModuleHandle : public IUnknown {
+  // Writes the module as it is now to bitcode.
+  virtual HRESULT STDMETHODCALLTYPE GetBitcode(_COM_Outptr_ IDxcBlob **ppBitcode) = 0;
+};
+
+// A pass list parsed once from RunOptimizer options, to be run over many
+// modules.
+struct __declspec(uuid("8b0f5d34-6e2a-4c71-9f3b-2d74a1c6e58f"))
+IDxcOptimizerPipeline : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE Run(IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+  // Runs the passes on each module, up to threadCount modules at a time (0
+  // for one per hardware thread). Fails if any module fails.
+  virtual HRESULT STDMETHODCALLTYPE RunBatch(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _Out_writes_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts) = 0;
+  // Runs the passes on the live module, changing it in place.
+  virtual HRESULT STDMETHODCALLTYPE RunOnModule(_In_ IDxcModuleHandle *pModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+};
+
+struct __declspec(uuid("c5e93a17-04d8-4b6f-a2e1-7f3c98b0d246"))
+IDxcOptimizer2 : public IDxcOptimizer {
+  // -falloc-stats is accepted and ignored by pipelines.
+  virtual HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) = 0;
+  // Parses a module once to run pipelines on; takes the same input as
+  // RunOptimizer.
+  virtual HRESULT STDMETHODCALLTYPE LoadModule(_In_ IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcModuleHandle **ppModule) = 0;
+};
+
+// Implemented by optimizer pipelines, to measure one of their passes. Each
+// run copies the module and runs the pipeline on the copy, leaving the
+// module unchanged. Only the time spent in the named pass is measured, not
+// the other passes, the analyses it requires or copying the module.
+struct __declspec(uuid("641acac5-67f2-42a5-b305-2aa5919849d0"))
+IDxcPassBenchmark : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE BenchmarkPass(
+    _In_ IDxcModuleHandle *pModule,               // Module to copy for each run
+    _In_ LPCWSTR pPassName,                       // Option name of a pipeline pass, without '-'
+    UINT32 runCount,                              // Number of runs
+    _Out_writes_(runCount) double *pSeconds       // Seconds in the pass for each run
+  ) = 0;
+};
+
+// Sets the [specializable] constants of a shader compiled with
+// -specializable and folds the code they decide, which is much faster than
+// compiling the shader again. Each value is the 32-bit pattern of the
+// constant, as asuint would give it, with 0 or 1 for a bool; constants not
+// named keep their defaults. The result is a validated container without
+// debug information.
+struct __declspec(uuid("5d8e3b94-c2a7-4f16-8e0b-97a4f1c2d6e3"))
+IDxcSpecializer : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE Specialize(
+    _In_ IDxcBlob *pProgram,                      // Container compiled with -specializable
+    _In_count_(valueCount) LPCWSTR *pNames,       // Names of the constants to set
+    _In_count_(valueCount) const UINT32 *pValues, // Bit patterns of their values
+    _In_ UINT32 valueCount,                       // Number of constants to set
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Output status, buffer, and errors
+  ) = 0;
+};
+
+// Links a shader to the next stage of its pipeline. Outputs the consumer
+// doesn't read are removed from the producer with the code computing them,
+// inputs the producer always sets to the same constant are folded into the
+// consumer, and the remaining elements are packed again at matching
+// locations. Pixel shader inputs the producer sets to the same value for all
+// vertices of a primitive become nointerpolation when the signatures can be
+// packed again. The producer can be a vertex, domain or geometry shader and the
+// consumer a hull, geometry or pixel shader that may follow it. System
+// values and geometry shader streams other than 0 are kept; don't link a
+// producer whose outputs also go to stream output. The results are validated
+// containers without debug information.
+struct __declspec(uuid("9321408c-1c52-4b1f-b001-cd941f9cb4a0"))
+IDxcStageLinker : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE LinkStages(
+    _In_ IDxcBlob *pProducer,                            // Container of the earlier stage
+    _In_ IDxcBlob *pConsumer,                            // Container of the stage that reads its outputs
+    _COM_Outptr_ IDxcOperationResult **ppProducerResult, // Linked producer, or errors
+    _COM_Outptr_ IDxcOperationResult **ppConsumerResult  // Linked consumer, or errors
+  ) = 0;
+};
+
 static const UINT32 DxcVersionInfoFlags_None = 0;
 static const UINT32 DxcVersionInfoFlags_Debug = 1; // Matches VS_FF_DEBUG
 static const UINT32 DxcVersionInfoFlags_Internal = 2; // Internal Validator (non-signing)
@@ -294,6 +781,19 @@ IDxcVersionInfo : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE GetFlags(_Out_ UINT32 *pFlags) = 0;
 };
 
+// Implemented by the allocator created from CLSID_DxcArenaMalloc. Passing it
+// to DxcCreateInstance2 makes the created object and the operations it runs
+// allocate from arenas that are freed together when the last reference to
+// the allocator goes away. Freed blocks are not reused individually, so the
+// allocator is meant to be used for one compilation or a few.
+struct __declspec(uuid("4E6B2F87-93A1-4C5D-B8E0-7D21A6C39F14"))
+IDxcArenaMalloc : public IMalloc {
+  // Largest number of bytes allocated and not yet freed at any one time.
+  virtual HRESULT STDMETHODCALLTYPE GetPeakBytes(_Out_ UINT64 *pPeakBytes) = 0;
+  // Number of bytes the arenas take from the underlying allocator.
+  virtual HRESULT STDMETHODCALLTYPE GetArenaBytes(_Out_ UINT64 *pArenaBytes) = 0;
+};
+
 // {73e22d93-e6ce-47f3-b5bf-f0664f39c1b0}
 __declspec(selectany) extern const CLSID CLSID_DxcCompiler = {
   0x73e22d93,
@@ -302,6 +802,43 @@ __declspec(selectany) extern const CLSID CLSID_DxcCompiler = {
   { 0xb5, 0xbf, 0xf0, 0x66, 0x4f, 0x39, 0xc1, 0xb0 }
 };
 
+// A compiler that keeps state that doesn't depend on the compiled source,
+// such as the validator, across compilations. It supports the same interfaces
+// as CLSID_DxcCompiler and, like it, should be used by one thread at a time.
+// {211388CB-ED31-4FF6-8131-7D75F124A41D}
+__declspec(selectany) extern const CLSID CLSID_DxcCompilerSession = {
+  0x211388cb,
+  0xed31,
+  0x4ff6,
+  { 0x81, 0x31, 0x7d, 0x75, 0xf1, 0x24, 0xa4, 0x1d }
+};
+
+// Schedules compiles on a pool of worker threads, each with its own
+// compiler. Supports IDxcCompilerAsync and may be used from any thread.
+// {5B0E7A19-C83D-4F62-9D1A-E4F07B26C38D}
+__declspec(selectany) extern const CLSID CLSID_DxcCompilerAsync = {
+  0x5b0e7a19,
+  0xc83d,
+  0x4f62,
+  { 0x9d, 0x1a, 0xe4, 0xf0, 0x7b, 0x26, 0xc3, 0x8d }
+};
+
+// {17CE0FC0-E50B-4093-AFC3-F185CEFEC0DB}
+__declspec(selectany) extern const CLSID CLSID_DxcIncludeCache = {
+  0x17ce0fc0,
+  0xe50b,
+  0x4093,
+  { 0xaf, 0xc3, 0xf1, 0x85, 0xce, 0xfe, 0xc0, 0xdb }
+};
+
+// {0C5F3E9B-6A2D-4B71-9E84-F3A1D7C06B25}
+__declspec(selectany) extern const CLSID CLSID_DxcArenaMalloc = {
+  0x0c5f3e9b,
+  0x6a2d,
+  0x4b71,
+  { 0x9e, 0x84, 0xf3, 0xa1, 0xd7, 0xc0, 0x6b, 0x25 }
+};
+
 // {EF6A8087-B0EA-4D56-9E45-D07E1A8B7806}
 __declspec(selectany) extern const GUID CLSID_DxcLinker = {
     0xef6a8087,
@@ -365,4 +902,20 @@ __declspec(selectany) extern const GUID CLSID_DxcContainerBuilder = {
   0x4574,  
   { 0xb4, 0xd0, 0x87, 0x41, 0xe2, 0x52, 0x40, 0xd2 }
 };
+
+// {E3A61C58-7B0D-4E92-A4F5-1C8D06B7E2A9}
+__declspec(selectany) extern const GUID CLSID_DxcSpecializer = {
+  0xe3a61c58,
+  0x7b0d,
+  0x4e92,
+  { 0xa4, 0xf5, 0x1c, 0x8d, 0x06, 0xb7, 0xe2, 0xa9 }
+};
+
+// {6111C864-4023-4972-A363-9A1B096E826B}
+__declspec(selectany) extern const GUID CLSID_DxcStageLinker = {
+  0x6111c864,
+  0x4023,
+  0x4972,
+  { 0xa3, 0x63, 0x9a, 0x1b, 0x09, 0x6e, 0x82, 0x6b }
+};
 #endif
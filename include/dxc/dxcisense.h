@@ -175,6 +175,44 @@ typedef enum DxcTranslationUnitFlags
   DxcTranslationUnitFlags_UseCallerThread = 0x800
 } DxcTranslationUnitFlags;
 
+typedef enum DxcCodeCompleteFlags
+{
+  DxcCodeCompleteFlags_None = 0x0,
+  // Whether to include macros within the set of code completions returned.
+  DxcCodeCompleteFlags_IncludeMacros = 0x01,
+  // Whether to include code patterns for language constructs within the set
+  // of code completions, e.g., for loops.
+  DxcCodeCompleteFlags_IncludeCodePatterns = 0x02,
+  // Whether to include brief documentation within the set of code completions
+  // returned.
+  DxcCodeCompleteFlags_IncludeBriefComments = 0x04
+} DxcCodeCompleteFlags;
+
+typedef enum DxcCompletionChunkKind
+{
+  DxcCompletionChunk_Optional = 0,         // A piece of text that describes something optional, like default arguments.
+  DxcCompletionChunk_TypedText = 1,        // Text that the user would be expected to type to get this completion.
+  DxcCompletionChunk_Text = 2,             // Text that should be inserted as part of the completion.
+  DxcCompletionChunk_Placeholder = 3,      // Placeholder text that should be replaced by the user, like a parameter name.
+  DxcCompletionChunk_Informative = 4,      // Informative text that isn't inserted, like the class of a member.
+  DxcCompletionChunk_CurrentParameter = 5, // Text for the current parameter when completing call arguments.
+  DxcCompletionChunk_LeftParen = 6,
+  DxcCompletionChunk_RightParen = 7,
+  DxcCompletionChunk_LeftBracket = 8,
+  DxcCompletionChunk_RightBracket = 9,
+  DxcCompletionChunk_LeftBrace = 10,
+  DxcCompletionChunk_RightBrace = 11,
+  DxcCompletionChunk_LeftAngle = 12,
+  DxcCompletionChunk_RightAngle = 13,
+  DxcCompletionChunk_Comma = 14,
+  DxcCompletionChunk_ResultType = 15,      // Text that specifies the result type of the completion.
+  DxcCompletionChunk_Colon = 16,
+  DxcCompletionChunk_SemiColon = 17,
+  DxcCompletionChunk_Equal = 18,
+  DxcCompletionChunk_HorizontalSpace = 19,
+  DxcCompletionChunk_VerticalSpace = 20
+} DxcCompletionChunkKind;
+
 typedef enum DxcCursorFormatting
 {
   DxcCursorFormatting_Default = 0x0,             // Default rules, language-insensitive formatting.
@@ -561,16 +599,21 @@ enum DxcCursorKindFlags
   DxcCursorKind_Unexposed = 0x100,
 };
 
+struct IDxcCodeCompleteResults;
+struct IDxcCompletionResult;
+struct IDxcCompletionString;
 struct IDxcCursor;
 struct IDxcDiagnostic;
 struct IDxcFile;
 struct IDxcInclusion;
 struct IDxcIntelliSense;
 struct IDxcIndex;
+struct IDxcIndex2;
 struct IDxcSourceLocation;
 struct IDxcSourceRange;
 struct IDxcToken;
 struct IDxcTranslationUnit;
+struct IDxcTranslationUnit2;
 struct IDxcType;
 struct IDxcUnsavedFile;
 
@@ -678,6 +721,52 @@ IDxcIndex : public IUnknown
       _Out_ IDxcTranslationUnit** pTranslationUnit) = 0;
 };
 
+// A declaration of or reference to an entity found in a workspace index.
+struct DxcIndexedReference
+{
+  unsigned FileIndex;   // Number of the file name, for GetIndexedFileName.
+  unsigned Line;
+  unsigned Column;
+  unsigned Offset;
+  BOOL IsDefinition;
+};
+
+struct __declspec(uuid("e254b420-0e71-4d74-aec0-af2198e761ac"))
+IDxcIndex2 : public IDxcIndex
+{
+  // Adds the files of the compile_commands.json compilation database in the
+  // given directory to the workspace index, with the arguments of their
+  // first command. Files already in the index get the new arguments.
+  virtual HRESULT STDMETHODCALLTYPE AddCompileDatabase(_In_z_ const char* directory) = 0;
+  // Adds a file to the workspace index, or changes the arguments it is
+  // parsed with.
+  virtual HRESULT STDMETHODCALLTYPE AddIndexedFile(
+      _In_z_ const char *source_filename,
+      _In_count_(num_command_line_args) const char * const *command_line_args,
+      int num_command_line_args) = 0;
+  virtual HRESULT STDMETHODCALLTYPE RemoveIndexedFile(_In_z_ const char *source_filename) = 0;
+  // Parses the files that were added or whose arguments changed since they
+  // were indexed, and those that read a file that changed on disk or whose
+  // unsaved contents changed. Files are parsed on up to threadCount threads,
+  // or one per processor if threadCount is 0.
+  virtual HRESULT STDMETHODCALLTYPE UpdateIndex(
+      _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+      unsigned num_unsaved_files, unsigned threadCount,
+      _Out_opt_ unsigned* pParsedCount) = 0;
+  // Finds the declarations of and references to the entity the cursor
+  // refers to in all the indexed files, ordered by file and offset. The
+  // cursor may come from any translation unit.
+  virtual HRESULT STDMETHODCALLTYPE FindIndexedReferences(
+      _In_ IDxcCursor* cursor, unsigned skip, unsigned top,
+      _Out_ unsigned* pResultLength,
+      _Outptr_result_buffer_maybenull_(*pResultLength) DxcIndexedReference** pResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetIndexedFileName(unsigned fileIndex, _Outptr_result_z_ LPSTR* pResult) = 0;
+  // Saves the workspace index to a file, or replaces it with one saved
+  // before. After loading, UpdateIndex only parses the files that changed.
+  virtual HRESULT STDMETHODCALLTYPE SaveIndex(_In_z_ const char* fileName) = 0;
+  virtual HRESULT STDMETHODCALLTYPE LoadIndex(_In_z_ const char* fileName) = 0;
+};
+
 struct __declspec(uuid("8e7ddf1c-d7d3-4d69-b286-85fccba1e0cf"))
 IDxcSourceLocation : public IUnknown
 {
@@ -741,6 +830,40 @@ IDxcTranslationUnit : public IUnknown
   virtual HRESULT STDMETHODCALLTYPE GetInclusionList(_Out_ unsigned* pResultCount, _Outptr_result_buffer_(*pResultCount) IDxcInclusion*** pResult) = 0;
 };
 
+struct __declspec(uuid("5c8a1e44-93b7-4f0d-a6e2-7d41c0b93f58"))
+IDxcTranslationUnit2 : public IDxcTranslationUnit
+{
+  // Reparses the translation unit after the given unsaved files changed.
+  // Unsaved files from the last parse or reparse that aren't among the
+  // changed files keep their contents; changed files replace the ones with
+  // the same name.
+  virtual HRESULT STDMETHODCALLTYPE ReparseChanged(
+    _In_count_(num_changed_files) IDxcUnsavedFile** changed_files,
+    unsigned num_changed_files) = 0;
+  // Gets the completions at the given location. The unsaved files are used
+  // together with the ones of the last parse or reparse, as in
+  // ReparseChanged.
+  virtual HRESULT STDMETHODCALLTYPE CodeCompleteAt(
+    _In_ const char* fileName, unsigned line, unsigned column,
+    _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles,
+    unsigned numUnsavedFiles, DxcCodeCompleteFlags options,
+    _Outptr_result_nullonfailure_ IDxcCodeCompleteResults** pResult) = 0;
+  // Finds the declarations of and references to the entity the cursor
+  // refers to, in the given file or, if file is null, anywhere in the
+  // translation unit. Entities are looked up by USR in an index that is
+  // built on first use and kept until the next reparse.
+  virtual HRESULT STDMETHODCALLTYPE FindReferences(
+    _In_ IDxcCursor* cursor, _In_opt_ IDxcFile* file,
+    unsigned skip, unsigned top,
+    _Out_ unsigned* pResultLength,
+    _Outptr_result_buffer_maybenull_(*pResultLength) IDxcCursor*** pResult) = 0;
+  // Finds the definition of the entity the cursor refers to by looking it up
+  // in the same index; the cursor is null if there is no definition.
+  virtual HRESULT STDMETHODCALLTYPE FindDefinition(
+    _In_ IDxcCursor* cursor,
+    _Outptr_result_nullonfailure_ IDxcCursor** pResult) = 0;
+};
+
 struct __declspec(uuid("2ec912fd-b144-4a15-ad0d-1c5439c81e46"))
 IDxcType : public IUnknown
 {
@@ -757,6 +880,28 @@ IDxcUnsavedFile : public IUnknown
   virtual HRESULT STDMETHODCALLTYPE GetLength(_Out_ unsigned* pLength) = 0;
 };
 
+struct __declspec(uuid("8bf3a57c-2e61-4d9a-b07f-94c2e6d13a85"))
+IDxcCompletionString : public IUnknown
+{
+  virtual HRESULT STDMETHODCALLTYPE GetNumCompletionChunks(_Out_ unsigned* pResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetCompletionChunkKind(unsigned chunkNumber, _Out_ DxcCompletionChunkKind* pResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetCompletionChunkText(unsigned chunkNumber, _Outptr_result_maybenull_ LPSTR* pResult) = 0;
+};
+
+struct __declspec(uuid("1e06466a-fd8b-45f3-a78f-8a3f76ebb552"))
+IDxcCompletionResult : public IUnknown
+{
+  virtual HRESULT STDMETHODCALLTYPE GetCursorKind(_Out_ DxcCursorKind* pResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetCompletionString(_Outptr_result_nullonfailure_ IDxcCompletionString** pResult) = 0;
+};
+
+struct __declspec(uuid("4f7d47a0-c3f2-4e5b-9a61-d05b8e27c415"))
+IDxcCodeCompleteResults : public IUnknown
+{
+  virtual HRESULT STDMETHODCALLTYPE GetNumResults(_Out_ unsigned* pResult) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetResultAt(unsigned index, _Outptr_result_nullonfailure_ IDxcCompletionResult** pResult) = 0;
+};
+
 // Fun fact: 'extern' is required because const is by default static in C++, so
 // CLSID_DxcIntelliSense is not visible externally (this is OK in C, since const is
 // not by default static in C)
@@ -49,6 +49,27 @@ IDxcRewriter : public IUnknown {
 
 };
 
+struct __declspec(uuid("3e4b61d2-7a95-4c0e-b8f3-52d09c6e1a47"))
+IDxcRewriter2 : public IDxcRewriter {
+
+  // Removes unused globals from each source, running up to threadCount
+  // rewrites at a time (0 for one per hardware thread). Each include is
+  // loaded once per batch and calls into pIncludeHandler are serialized.
+  // Each result reports the time of its rewrite through IDxcTimeReport.
+  virtual HRESULT STDMETHODCALLTYPE RemoveUnusedGlobalsBatch(_In_ UINT32 sourceCount,
+                                                             _In_count_(sourceCount) IDxcBlobEncoding **ppSources,
+                                                             // Optional file names for the sources. Used in errors and include handlers.
+                                                             _In_opt_count_(sourceCount) LPCWSTR *pSourceNames,
+                                                             _In_z_ LPCWSTR entryPoint,
+                                                             _In_count_(defineCount) DxcDefine *pDefines,
+                                                             _In_ UINT32 defineCount,
+                                                             // user-provided interface to handle #include directives (optional)
+                                                             _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                                                             _In_ UINT32 threadCount,
+                                                             _Out_writes_(sourceCount) IDxcOperationResult **ppResults) = 0;
+
+};
+
 __declspec(selectany)
 extern const CLSID CLSID_DxcRewriter = { /* b489b951-e07f-40b3-968d-93e124734da4 */
   0xb489b951,
@@ -205,6 +205,13 @@ public:
   /// starting with the sources of divergence.
   bool isSourceOfDivergence(const Value *V) const;
 
+  // HLSL Change Begin - values uniform regardless of their operands.
+  /// \brief Returns whether V is uniform even when its operands are
+  /// divergent, such as the result of a cross-lane reduction. Divergence
+  /// doesn't propagate into these values.
+  bool isAlwaysUniform(const Value *V) const;
+  // HLSL Change End
+
   /// \brief Test whether calls to a function lower to actual program function
   /// calls.
   ///
@@ -556,6 +563,7 @@ public:
   virtual unsigned getUserCost(const User *U) = 0;
   virtual bool hasBranchDivergence() = 0;
   virtual bool isSourceOfDivergence(const Value *V) = 0;
+  virtual bool isAlwaysUniform(const Value *V) = 0; // HLSL Change
   virtual bool isLoweredToCall(const Function *F) = 0;
   virtual void getUnrollingPreferences(Loop *L, UnrollingPreferences &UP) = 0;
   virtual bool isLegalAddImmediate(int64_t Imm) = 0;
@@ -670,6 +678,11 @@ public:
   bool isSourceOfDivergence(const Value *V) override {
     return Impl.isSourceOfDivergence(V);
   }
+  // HLSL Change Begin
+  bool isAlwaysUniform(const Value *V) override {
+    return Impl.isAlwaysUniform(V);
+  }
+  // HLSL Change End
   bool isLoweredToCall(const Function *F) override {
     return Impl.isLoweredToCall(F);
   }
@@ -28,6 +28,7 @@ namespace llvm {
   class Module;
   class ModulePass;
   class raw_ostream;
+  template <typename T> class SmallVectorImpl; // HLSL Change
 
   /// Read the header of the specified bitcode buffer and prepare for lazy
   /// deserialization of function bodies. If ShouldLazyLoadMetadata is true,
@@ -69,6 +70,16 @@ namespace llvm {
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
                           bool ShouldPreserveUseListOrder = false);
 
+  // HLSL Change Begin
+  /// \brief Write the specified module into the empty \c Buffer.
+  ///
+  /// Unlike WriteBitcodeToFile, the bitcode isn't copied once written, so
+  /// callers that only need the bytes in memory can keep them where they are
+  /// and reserve \c Buffer to avoid growing it.
+  void WriteBitcodeToBuffer(const Module *M, SmallVectorImpl<char> &Buffer,
+                            bool ShouldPreserveUseListOrder = false);
+  // HLSL Change End
+
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
   /// for an LLVM IR bitcode wrapper.
   ///
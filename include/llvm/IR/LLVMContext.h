@@ -177,6 +177,25 @@ public:
     return OptionRegistry::instance().template get<ValT, Base, Mem>();
   }
 
+  // HLSL Change Begin - reuse contexts across compilations.
+  /// resetForReuse - Forget the state that would make a module created in
+  /// this context differ from one created in a new context: the names of
+  /// struct types, custom metadata kinds, discriminators and handlers. Types
+  /// and uniqued constants and metadata are kept. Returns false, and does
+  /// nothing, if a module still lives in the context.
+  bool resetForReuse();
+  // HLSL Change End
+
+  // HLSL Change Begin - discard value names.
+  /// shouldDiscardValueNames - Return true if names given to values other
+  /// than global values are dropped rather than stored.
+  bool shouldDiscardValueNames() const;
+
+  /// setDiscardValueNames - Drop the names of values other than global values
+  /// from now on. Names already given are kept.
+  void setDiscardValueNames(bool Discard);
+  // HLSL Change End
+
 private:
   LLVMContext(LLVMContext&) = delete;
   void operator=(LLVMContext&) = delete;
@@ -95,6 +95,22 @@ private:
   Module *M;
 };
 
+// HLSL Change Starts
+/// PassTimingListener - Notified around each pass that the legacy pass
+/// managers run on the thread that installed it. Pass managers themselves
+/// are not reported. F is the function the pass runs on, or null for a pass
+/// that may change any function of M.
+class PassTimingListener {
+public:
+  virtual ~PassTimingListener() {}
+  virtual void passStarted(Pass *P, Module &M, Function *F) = 0;
+  virtual void passEnded(Pass *P, Module &M, Function *F) = 0;
+};
+
+/// Installs a listener for the current thread, returning the prior one.
+PassTimingListener *setThreadPassTimingListener(PassTimingListener *L);
+// HLSL Change Ends
+
 } // End legacy namespace
 
 // Create wrappers for C Binding types (see CBindingWrapping.h).
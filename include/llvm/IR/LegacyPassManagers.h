@@ -90,6 +90,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Timer.h" // HLSL Change
 
 namespace llvm {
   class Module;
@@ -98,6 +99,7 @@ namespace llvm {
   class Value;
   class Timer;
   class PMDataManager;
+  namespace legacy { class PassTimingListener; } // HLSL Change
 
 // enums for debugging strings
 enum PassDebuggingString {
@@ -474,6 +476,23 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+// HLSL Change Starts
+/// PassTimeRegion - Times a pass run for -time-passes and notifies the
+/// thread's PassTimingListener, if any. F is the function the pass runs on,
+/// or null if it runs on all of M.
+class PassTimeRegion {
+  TimeRegion Region;
+  Pass *P;
+  Module &M;
+  Function *F;
+  legacy::PassTimingListener *Listener;
+
+public:
+  PassTimeRegion(Pass *P, Module &M, Function *F);
+  ~PassTimeRegion();
+};
+// HLSL Change Ends
+
 }
 
 #endif
@@ -649,6 +649,16 @@ public:
   /// be called where all uses of the LLVMContext are understood.
   void dropTriviallyDeadConstantArrays();
 
+  // HLSL Change Begin
+  /// Destroy constant expressions, arrays, structs, vectors and data
+  /// sequences in LLVMContext that nothing uses, and return their count.
+  /// Integers, floats and the constants unique per type are kept.
+  ///
+  /// NOTE: As above, this can only be called where all uses of the
+  /// LLVMContext are understood.
+  unsigned dropTriviallyDeadConstants();
+  // HLSL Change End
+
 /// @}
 /// @name Utility functions for printing and dumping Module objects
 /// @{
@@ -0,0 +1,40 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// Cancellation.h                                                            //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides cooperative cancellation of the work running on a thread.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef LLVM_SUPPORT_CANCELLATION_H
+#define LLVM_SUPPORT_CANCELLATION_H
+
+namespace llvm {
+
+/// CancellationCheck - Tells the work running on the thread that installed
+/// it whether it should stop. The pass managers ask between passes, and
+/// long-running loops in the front end and in lowering poll it. Cancelled
+/// work unwinds by throwing hlsl::Exception with E_ABORT.
+class CancellationCheck {
+public:
+  virtual ~CancellationCheck() {}
+  virtual bool isCancelled() = 0;
+};
+
+/// Installs a check for the current thread, returning the prior one.
+CancellationCheck *setThreadCancellationCheck(CancellationCheck *C);
+
+/// Throws if the check installed on the current thread reports that its
+/// work is cancelled.
+void checkThreadCancellation();
+
+/// Like checkThreadCancellation, but only asks the check once every so many
+/// calls, for loops whose iterations are cheap.
+void pollThreadCancellation();
+
+} // namespace llvm
+
+#endif // LLVM_SUPPORT_CANCELLATION_H
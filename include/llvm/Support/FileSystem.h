@@ -186,14 +186,14 @@ public:
 ///               a platform-specific member to store the result.
 class file_status
 {
-  #if defined(LLVM_ON_UNIX)
+  #if 0 // HLSL Change - status comes from an MSFileSystem on every platform
   dev_t fs_st_dev;
   ino_t fs_st_ino;
   time_t fs_st_mtime;
   uid_t fs_st_uid;
   gid_t fs_st_gid;
   off_t fs_st_size;
-  #elif defined (LLVM_ON_WIN32)
+  #else // HLSL Change
   uint32_t LastWriteTimeHigh;
   uint32_t LastWriteTimeLow;
   uint32_t VolumeSerialNumber;
@@ -206,7 +206,7 @@ class file_status
   file_type Type;
   perms Perms;
 public:
-  #if defined(LLVM_ON_UNIX)
+  #if 0 // HLSL Change - status comes from an MSFileSystem on every platform
     file_status() : fs_st_dev(0), fs_st_ino(0), fs_st_mtime(0),
         fs_st_uid(0), fs_st_gid(0), fs_st_size(0),
         Type(file_type::status_error), Perms(perms_not_known) {}
@@ -219,7 +219,7 @@ public:
                 uid_t UID, gid_t GID, off_t Size)
         : fs_st_dev(Dev), fs_st_ino(Ino), fs_st_mtime(MTime), fs_st_uid(UID),
           fs_st_gid(GID), fs_st_size(Size), Type(Type), Perms(Perms) {}
-  #elif defined(LLVM_ON_WIN32)
+  #else // HLSL Change
     file_status() : LastWriteTimeHigh(0), LastWriteTimeLow(0),
         VolumeSerialNumber(0), FileSizeHigh(0), FileSizeLow(0),
         FileIndexHigh(0), FileIndexLow(0), Type(file_type::status_error),
@@ -247,11 +247,11 @@ public:
   TimeValue getLastModificationTime() const;
   UniqueID getUniqueID() const;
 
-  #if defined(LLVM_ON_UNIX)
+  #if 0 // HLSL Change - status comes from an MSFileSystem on every platform
   uint32_t getUser() const { return fs_st_uid; }
   uint32_t getGroup() const { return fs_st_gid; }
   uint64_t getSize() const { return fs_st_size; }
-  #elif defined (LLVM_ON_WIN32)
+  #else // HLSL Change
   uint32_t getUser() const {
     return 9999; // Not applicable to Windows, so...
   }
@@ -127,6 +127,18 @@ public:
   bool MergeFunctions;
   bool PrepareForLTO;
   bool HLSLHighLevel = false; // HLSL Change
+  bool HLSLUniformBranchHints = false; // HLSL Change
+  bool HLSLAutoFlatten = false; // HLSL Change
+  bool HLSLUnswitchUniformLoops = false; // HLSL Change
+  bool HLSLWaveAggregateAtomics = false; // HLSL Change
+  bool HLSLDemotePrecision = false; // HLSL Change
+  bool HLSLAutoEarlyDepthStencil = false; // HLSL Change
+  bool HLSLGatherPointSamples = false; // HLSL Change
+  bool HLSLCompactContext = false; // HLSL Change
+  unsigned HLSLFPSpeed = 0; // HLSL Change
+  bool HLSLSelectDynamicIndexing = false; // HLSL Change
+  bool HLSLPadGroupShared = false; // HLSL Change
+  bool HLSLBottomUpInline = false; // HLSL Change
   hlsl::HLSLExtensionsCodegenHelper *HLSLExtensionsCodeGen = nullptr; // HLSL Change
 
 private:
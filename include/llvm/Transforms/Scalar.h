@@ -133,9 +133,11 @@ void initializeLowerStaticGlobalIntoAllocaPass(PassRegistry&);
 //===----------------------------------------------------------------------===//
 //
 // DynamicIndexingVectorToArray 
-// Replace vector with array if it has dynamic indexing.
+// Replace vector with array if it has dynamic indexing. With SelectIndexing,
+// local vectors are instead indexed with a select per element.
 //
-ModulePass *createDynamicIndexingVectorToArrayPass(bool ReplaceAllVector = false);
+ModulePass *createDynamicIndexingVectorToArrayPass(bool ReplaceAllVector = false,
+                                                   bool SelectIndexing = false);
 void initializeDynamicIndexingVectorToArrayPass(PassRegistry&);
 //===----------------------------------------------------------------------===//
 // Flatten multi dim array into 1 dim.
@@ -217,7 +219,10 @@ Pass *createGlobalMergePass(const TargetMachine *TM, unsigned MaximalOffset,
 //
 // LoopUnswitch - This pass is a simple loop unswitching pass.
 //
-Pass *createLoopUnswitchPass(bool OptimizeForSize = false);
+// HLSL Change - UniformOnly unswitches only wave-uniform conditions, with a
+// larger size budget.
+Pass *createLoopUnswitchPass(bool OptimizeForSize = false,
+                             bool UniformOnly = false);
 
 //===----------------------------------------------------------------------===//
 //
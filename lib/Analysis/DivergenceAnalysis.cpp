@@ -192,6 +192,8 @@ void DivergencePropagator::findUsersOutsideInfluenceRegion(
     Instruction &I, const DenseSet<BasicBlock *> &InfluenceRegion) {
   for (User *U : I.users()) {
     Instruction *UserInst = cast<Instruction>(U);
+    if (TTI.isAlwaysUniform(UserInst)) // HLSL Change
+      continue;
     if (!InfluenceRegion.count(UserInst->getParent())) {
       if (DV.insert(UserInst).second)
         Worklist.push_back(UserInst);
@@ -233,6 +235,8 @@ void DivergencePropagator::exploreDataDependency(Value *V) {
   // Follow def-use chains of V.
   for (User *U : V->users()) {
     Instruction *UserInst = cast<Instruction>(U);
+    if (TTI.isAlwaysUniform(UserInst)) // HLSL Change
+      continue;
     if (DV.insert(UserInst).second)
       Worklist.push_back(UserInst);
   }
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 #include "llvm/Analysis/DxilConstantFolding.h"
 #include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
@@ -391,6 +392,20 @@ static Constant *ConstantFoldTernaryIntIntrinsic(OP::OpCode opcode, Type *Ty, Co
   }
   case OP::OpCode::Ubfe: return ComputeBFE(Ty, C1, C2, C3, [](APInt val, APInt amt) {return val.lshr(amt); });
   case OP::OpCode::Ibfe: return ComputeBFE(Ty, C1, C2, C3, [](APInt val, APInt amt) {return val.ashr(amt); });
+  case OP::OpCode::Msad: {
+    // Sum of the absolute differences of the bytes of src, skipping those
+    // whose reference byte is 0, added to accum.
+    uint32_t ref = (uint32_t)C1.getLimitedValue();
+    uint32_t src = (uint32_t)C2.getLimitedValue();
+    uint32_t accum = (uint32_t)C3.getLimitedValue();
+    for (unsigned i = 0; i < 4; ++i) {
+      uint32_t refByte = (ref >> (i * 8)) & 0xFF;
+      uint32_t srcByte = (src >> (i * 8)) & 0xFF;
+      if (refByte != 0)
+        accum += refByte > srcByte ? refByte - srcByte : srcByte - refByte;
+    }
+    return ConstantInt::get(Ty, accum);
+  }
   }
 
   return nullptr;
@@ -421,6 +436,33 @@ static Constant *ConstantFoldQuaternaryIntInstrinsic(OP::OpCode opcode, Type *Ty
   return ConstantInt::get(Ty, result);
 }
 
+// Constant fold IsNaN, IsInf, IsFinite and IsNormal. Unlike the other
+// intrinsics these are folded for NaN and infinite inputs too.
+static Constant *ConstantFoldIsSpecialFloat(OP::OpCode opcode, Type *Ty, ConstantFP *Op) {
+  const APFloat &V = Op->getValueAPF();
+  bool result;
+  switch (opcode) {
+  default: return nullptr;
+  case OP::OpCode::IsNaN:    result = V.isNaN(); break;
+  case OP::OpCode::IsInf:    result = V.isInfinity(); break;
+  case OP::OpCode::IsFinite: result = V.isFinite(); break;
+  case OP::OpCode::IsNormal: result = V.isNormal(); break;
+  }
+  return ConstantInt::get(Ty, result);
+}
+
+// Convert a double to a 32-bit integer, rounding toward zero as the legacy
+// conversions do. Out of range values aren't folded.
+static Constant *HLSLConstantFoldDoubleToInt(ConstantFP *Op, Type *Ty, bool isSigned) {
+  APSInt result(32, !isSigned);
+  bool isExact;
+  APFloat::opStatus status =
+      Op->getValueAPF().convertToInteger(result, APFloat::rmTowardZero, &isExact);
+  if (status != APFloat::opOK && status != APFloat::opInexact)
+    return nullptr;
+  return ConstantInt::get(Ty, result);
+}
+
 // Top level function to constant fold floating point intrinsics.
 static Constant *ConstantFoldFPIntrinsic(OP::OpCode opcode, Type *Ty, const DxilIntrinsicOperands &IntrinsicOperands) {
   if (!Ty->isHalfTy() && !Ty->isFloatTy() && !Ty->isDoubleTy())
@@ -430,6 +472,40 @@ static Constant *ConstantFoldFPIntrinsic(OP::OpCode opcode, Type *Ty, const Dxil
 
   switch (opClass) {
   default: break;
+  case OP::OpCodeClass::LegacyF16ToF32: {
+    ConstantInt *Op = IntrinsicOperands.GetConstantInt(0);
+    if (!Op)
+      return nullptr;
+    APFloat result(APFloat::IEEEhalf, Op->getValue().trunc(16));
+    bool losesInfo;
+    result.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &losesInfo);
+    return ConstantFP::get(Ty->getContext(), result);
+  }
+  case OP::OpCodeClass::LegacyDoubleToFloat: {
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!IsValidOp(Op))
+      return nullptr;
+    APFloat result(Op->getValueAPF());
+    bool losesInfo;
+    result.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &losesInfo);
+    return ConstantFP::get(Ty->getContext(), result);
+  }
+  case OP::OpCodeClass::MakeDouble: {
+    ConstantInt *Lo = IntrinsicOperands.GetConstantInt(0);
+    ConstantInt *Hi = IntrinsicOperands.GetConstantInt(1);
+    if (!Lo || !Hi)
+      return nullptr;
+    uint64_t bits = (Hi->getZExtValue() << 32) | (Lo->getZExtValue() & 0xFFFFFFFF);
+    return ConstantFP::get(Ty->getContext(), APFloat(APFloat::IEEEdouble, APInt(64, bits)));
+  }
+  case OP::OpCodeClass::BitcastI16toF16:
+  case OP::OpCodeClass::BitcastI32toF32:
+  case OP::OpCodeClass::BitcastI64toF64: {
+    ConstantInt *Op = IntrinsicOperands.GetConstantInt(0);
+    if (!Op)
+      return nullptr;
+    return ConstantExpr::getBitCast(Op, Ty);
+  }
   case OP::OpCodeClass::Unary: {
     assert(IntrinsicOperands.Size() == 1);
     ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
@@ -478,6 +554,36 @@ static Constant *ConstantFoldIntIntrinsic(OP::OpCode opcode, Type *Ty, const Dxi
 
   switch (opClass) {
   default: break;
+  case OP::OpCodeClass::IsSpecialFloat: {
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!Op)
+      return nullptr;
+    return ConstantFoldIsSpecialFloat(opcode, Ty, Op);
+  }
+  case OP::OpCodeClass::LegacyF32ToF16: {
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!Op)
+      return nullptr;
+    APFloat half(Op->getValueAPF());
+    bool losesInfo;
+    half.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven, &losesInfo);
+    return ConstantInt::get(Ty, half.bitcastToAPInt().getZExtValue());
+  }
+  case OP::OpCodeClass::LegacyDoubleToSInt32:
+  case OP::OpCodeClass::LegacyDoubleToUInt32: {
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!IsValidOp(Op))
+      return nullptr;
+    return HLSLConstantFoldDoubleToInt(Op, Ty, opClass == OP::OpCodeClass::LegacyDoubleToSInt32);
+  }
+  case OP::OpCodeClass::BitcastF16toI16:
+  case OP::OpCodeClass::BitcastF32toI32:
+  case OP::OpCodeClass::BitcastF64toI64: {
+    ConstantFP *Op = IntrinsicOperands.GetConstantFloat(0);
+    if (!Op)
+      return nullptr;
+    return ConstantExpr::getBitCast(Op, Ty);
+  }
   case OP::OpCodeClass::Unary:
   case OP::OpCodeClass::UnaryBits: {
     assert(IntrinsicOperands.Size() == 1);
@@ -567,6 +673,19 @@ bool hlsl::CanConstantFoldCallTo(const Function *F) {
     case OP::OpCodeClass::Dot2:
     case OP::OpCodeClass::Dot3:
     case OP::OpCodeClass::Dot4:
+    case OP::OpCodeClass::IsSpecialFloat:
+    case OP::OpCodeClass::LegacyF16ToF32:
+    case OP::OpCodeClass::LegacyF32ToF16:
+    case OP::OpCodeClass::LegacyDoubleToFloat:
+    case OP::OpCodeClass::LegacyDoubleToSInt32:
+    case OP::OpCodeClass::LegacyDoubleToUInt32:
+    case OP::OpCodeClass::MakeDouble:
+    case OP::OpCodeClass::BitcastF16toI16:
+    case OP::OpCodeClass::BitcastF32toI32:
+    case OP::OpCodeClass::BitcastF64toI64:
+    case OP::OpCodeClass::BitcastI16toF16:
+    case OP::OpCodeClass::BitcastI32toF32:
+    case OP::OpCodeClass::BitcastI64toF64:
       return true;
     }
   }
@@ -12,17 +12,21 @@
 //
 //===----------------------------------------------------------------------===//
 
-// simplify dxil op like mad 0, a, b->b.
+// simplify dxil op like mad 0, a, b->b, wave ops on values that are
+// already the same in every lane, and the lane count of shaders specialized
+// for a wave size.
 
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/IRBuilder.h"
 
 #include "dxc/HLSL/DxilModule.h"
 #include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
 #include "llvm/Analysis/DxilConstantFolding.h"
 #include "llvm/Analysis/DxilSimplify.h"
 
@@ -39,6 +43,82 @@ DXIL::OpCode GetOpcode(Value *opArg) {
   }
   return DXIL::OpCode::NumOpCodes;
 }
+
+// Returns true if V is known to be the same in every active lane of the wave.
+// Only values built from constants, constant buffer reads at constant
+// addresses and the results of wave-wide operations are recognized; phis
+// are never uniform, since the lanes may have come from different blocks.
+bool IsWaveUniform(Value *V, OP *hlslOP, unsigned Depth = 0) {
+  if (isa<Constant>(V))
+    return true;
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I || Depth >= 8)
+    return false;
+
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    if (!hlslOP->IsDxilOpFuncCallInst(CI))
+      return false;
+    switch (OP::GetDxilOpFuncCallInst(CI)) {
+    default:
+      return false;
+    case DXIL::OpCode::WaveReadLaneFirst:
+    case DXIL::OpCode::WaveReadLaneAt:
+    case DXIL::OpCode::WaveActiveOp:
+    case DXIL::OpCode::WaveActiveBit:
+    case DXIL::OpCode::WaveActiveAllEqual:
+    case DXIL::OpCode::WaveAllTrue:
+    case DXIL::OpCode::WaveAnyTrue:
+    case DXIL::OpCode::WaveAllBitCount:
+    case DXIL::OpCode::WaveGetLaneCount:
+      return true;
+    case DXIL::OpCode::CreateHandle:
+      return isa<Constant>(DxilInst_CreateHandle(CI).get_index());
+    case DXIL::OpCode::CBufferLoadLegacy: {
+      DxilInst_CBufferLoadLegacy CBufLoad(CI);
+      return isa<Constant>(CBufLoad.get_regIndex()) &&
+             IsWaveUniform(CBufLoad.get_handle(), hlslOP, Depth + 1);
+    }
+    }
+  }
+
+  if (!isa<BinaryOperator>(I) && !isa<CastInst>(I) && !isa<CmpInst>(I) &&
+      !isa<SelectInst>(I) && !isa<ExtractValueInst>(I) &&
+      !isa<ExtractElementInst>(I))
+    return false;
+  for (Value *Op : I->operands())
+    if (!IsWaveUniform(Op, hlslOP, Depth + 1))
+      return false;
+  return true;
+}
+
+// Drops the offsets of a sample operation when they are all zero.
+Value *SimplifySampleOffsets(ArrayRef<Value *> Args, Instruction *I) {
+  // All sample operations have their three offsets in the same place.
+  const unsigned kSampleOffset0OpIdx = 7;
+  bool bAllZero = true;
+  bool bAllUndef = true;
+  for (unsigned i = 0; i < 3; ++i) {
+    Value *Offset = Args[kSampleOffset0OpIdx + i];
+    if (isa<UndefValue>(Offset))
+      continue;
+    bAllUndef = false;
+    Constant *C = dyn_cast<Constant>(Offset);
+    if (!C || !C->isNullValue())
+      bAllZero = false;
+  }
+  if (!bAllZero || bAllUndef)
+    return nullptr;
+
+  Instruction *NewI = I->clone();
+  for (unsigned i = 0; i < 3; ++i) {
+    Value *Offset = Args[kSampleOffset0OpIdx + i];
+    NewI->setOperand(kSampleOffset0OpIdx + i,
+                     UndefValue::get(Offset->getType()));
+  }
+  NewI->insertBefore(I);
+  NewI->takeName(I);
+  return NewI;
+}
 } // namespace
 
 namespace hlsl {
@@ -60,6 +140,18 @@ bool CanSimplify(const llvm::Function *F) {
     default:
       break;
     case OP::OpCodeClass::Tertiary:
+    case OP::OpCodeClass::WaveActiveAllEqual:
+    case OP::OpCodeClass::WaveActiveBit:
+    case OP::OpCodeClass::WaveActiveOp:
+    case OP::OpCodeClass::WaveReadLaneAt:
+    case OP::OpCodeClass::WaveReadLaneFirst:
+    case OP::OpCodeClass::WaveGetLaneCount:
+    case OP::OpCodeClass::Sample:
+    case OP::OpCodeClass::SampleBias:
+    case OP::OpCodeClass::SampleLevel:
+    case OP::OpCodeClass::SampleGrad:
+    case OP::OpCodeClass::SampleCmp:
+    case OP::OpCodeClass::SampleCmpLevelZero:
       return true;
     }
   }
@@ -164,6 +256,58 @@ Value *SimplifyDxilCall(llvm::Function *F, ArrayRef<Value *> Args,
     }
     return nullptr;
   } break;
+  case DXIL::OpCode::WaveGetLaneCount: {
+    // A shader specialized for a wave size only runs with that lane count,
+    // which makes loops and reductions sized on it constant.
+    if (unsigned waveSize = DM.GetWaveSize())
+      return ConstantInt::get(I->getType(), waveSize);
+    return nullptr;
+  } break;
+  case DXIL::OpCode::WaveActiveAllEqual: {
+    Value *op = Args[DXIL::OperandIndex::kUnarySrc0OpIdx];
+    if (IsWaveUniform(op, DM.GetOP()))
+      return ConstantInt::getTrue(I->getType());
+    return nullptr;
+  } break;
+  case DXIL::OpCode::WaveReadLaneFirst:
+  case DXIL::OpCode::WaveReadLaneAt: {
+    Value *op = Args[DXIL::OperandIndex::kUnarySrc0OpIdx];
+    if (IsWaveUniform(op, DM.GetOP()))
+      return op;
+    return nullptr;
+  } break;
+  case DXIL::OpCode::WaveActiveOp: {
+    // min and max of the same value in every lane is that value.
+    ConstantInt *kind = dyn_cast<ConstantInt>(Args[2]);
+    if (!kind)
+      return nullptr;
+    DXIL::WaveOpKind opKind = (DXIL::WaveOpKind)kind->getZExtValue();
+    if (opKind != DXIL::WaveOpKind::Min && opKind != DXIL::WaveOpKind::Max)
+      return nullptr;
+    Value *op = Args[DXIL::OperandIndex::kUnarySrc0OpIdx];
+    if (IsWaveUniform(op, DM.GetOP()))
+      return op;
+    return nullptr;
+  } break;
+  case DXIL::OpCode::WaveActiveBit: {
+    ConstantInt *kind = dyn_cast<ConstantInt>(Args[2]);
+    if (!kind)
+      return nullptr;
+    DXIL::WaveBitOpKind opKind = (DXIL::WaveBitOpKind)kind->getZExtValue();
+    if (opKind != DXIL::WaveBitOpKind::And && opKind != DXIL::WaveBitOpKind::Or)
+      return nullptr;
+    Value *op = Args[DXIL::OperandIndex::kUnarySrc0OpIdx];
+    if (IsWaveUniform(op, DM.GetOP()))
+      return op;
+    return nullptr;
+  } break;
+  case DXIL::OpCode::Sample:
+  case DXIL::OpCode::SampleBias:
+  case DXIL::OpCode::SampleLevel:
+  case DXIL::OpCode::SampleGrad:
+  case DXIL::OpCode::SampleCmp:
+  case DXIL::OpCode::SampleCmpLevelZero:
+    return SimplifySampleOffsets(Args, I);
   }
 }
 
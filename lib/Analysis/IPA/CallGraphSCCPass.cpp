@@ -126,7 +126,7 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
     }
 
     {
-      TimeRegion PassTimer(getPassTimer(CGSP));
+      PassTimeRegion PassTimer(CGSP, CG.getModule(), nullptr); // HLSL Change
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
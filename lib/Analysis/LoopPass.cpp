@@ -246,7 +246,7 @@ bool LPPassManager::runOnFunction(Function &F) {
 
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
-        TimeRegion PassTimer(getPassTimer(P));
+        PassTimeRegion PassTimer(P, *F.getParent(), &F); // HLSL Change
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
@@ -58,6 +58,7 @@ enum {
   FUNCTION_INST_RET_VAL_ABBREV,
   FUNCTION_INST_UNREACHABLE_ABBREV,
   FUNCTION_INST_GEP_ABBREV,
+  FUNCTION_INST_CALL_ABBREV, // HLSL Change
 };
 
 static unsigned GetEncodedCastOpcode(unsigned Opcode) {
@@ -1977,14 +1978,23 @@ static void WriteInstruction(const Instruction &I, unsigned InstID,
     Vals.push_back((CI.getCallingConv() << 1) | unsigned(CI.isTailCall()) |
                    unsigned(CI.isMustTailCall()) << 14 | 1 << 15);
     Vals.push_back(VE.getTypeID(FTy));
-    PushValueAndType(CI.getCalledValue(), InstID, Vals, VE);  // Callee
+    // HLSL Change Begin - abbreviate the common call shape: dx.op and other
+    // direct, non-tail calls with fixed parameters.
+    bool ForwardCallee =
+        PushValueAndType(CI.getCalledValue(), InstID, Vals, VE);  // Callee
+    if (!ForwardCallee && !FTy->isVarArg() &&
+        Vals[1] == (1 << 15)) {
+      AbbrevToUse = FUNCTION_INST_CALL_ABBREV;
+    }
+    // HLSL Change End
 
     // Emit value #'s for the fixed parameters.
     for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i) {
       // Check for labels (can happen with asm labels).
-      if (FTy->getParamType(i)->isLabelTy())
+      if (FTy->getParamType(i)->isLabelTy()) {
         Vals.push_back(VE.getValueID(CI.getArgOperand(i)));
-      else
+        AbbrevToUse = 0; // HLSL Change
+      } else
         pushValue(CI.getArgOperand(i), InstID, Vals, VE);  // fixed param.
     }
 
@@ -2344,6 +2354,22 @@ static void WriteBlockInfo(const ValueEnumerator &VE, BitstreamWriter &Stream) {
         FUNCTION_INST_GEP_ABBREV)
       llvm_unreachable("Unexpected abbrev ordering!");
   }
+  // HLSL Change Begin
+  { // INST_CALL abbrev for FUNCTION_BLOCK.
+    IntrusiveRefCntPtr<BitCodeAbbrev> Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::FUNC_CODE_INST_CALL));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // paramattrs
+    Abbv->Add(BitCodeAbbrevOp(1 << 15));                  // cc, explicit type
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed,    // fnty
+                              VE.computeBitsRequiredForTypeIndicies()));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // callee
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // args
+    if (Stream.EmitBlockInfoAbbrev(bitc::FUNCTION_BLOCK_ID, Abbv.get()) !=
+        FUNCTION_INST_CALL_ABBREV)
+      llvm_unreachable("Unexpected abbrev ordering!");
+  }
+  // HLSL Change End
 
   Stream.ExitBlock();
 }
@@ -2479,6 +2505,18 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
                               bool ShouldPreserveUseListOrder) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
+  WriteBitcodeToBuffer(M, Buffer, ShouldPreserveUseListOrder); // HLSL Change
+
+  // Write the generated bitstream to "Out".
+  Out.write((char*)&Buffer.front(), Buffer.size());
+}
+
+// HLSL Change Begin - write to the caller's buffer, without the copy to a
+// stream.
+void llvm::WriteBitcodeToBuffer(const Module *M, SmallVectorImpl<char> &Buffer,
+                                bool ShouldPreserveUseListOrder) {
+  assert(Buffer.empty() && "the bitcode must start the buffer");
+  // HLSL Change End
 
   // If this is darwin or another generic macho target, reserve space for the
   // header.
@@ -2504,7 +2542,4 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
 
   if (TT.isOSDarwin())
     EmitDarwinBCHeaderAndTrailer(Buffer, TT);
-
-  // Write the generated bitstream to "Out".
-  Out.write((char*)&Buffer.front(), Buffer.size());
 }
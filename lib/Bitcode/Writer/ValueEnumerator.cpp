@@ -535,24 +535,59 @@ void ValueEnumerator::EnumerateMDNodeOperands(const MDNode *N) {
   }
 }
 
+// HLSL Change Starts - walk metadata graphs with a worklist.
+// Debug info and DXIL annotations nest deeply enough that recursing through
+// each operand costs noticeable time and stack. Nodes are numbered in the same
+// post-order as the recursive walk did.
 void ValueEnumerator::EnumerateMetadata(const Metadata *MD) {
+  SmallVector<std::pair<const MDNode *, unsigned>, 32> Worklist;
+  if (const MDNode *N = enumerateMetadataImpl(MD))
+    Worklist.push_back(std::make_pair(N, 0u));
+
+  while (!Worklist.empty()) {
+    const MDNode *N = Worklist.back().first;
+    unsigned OpIndex = Worklist.back().second;
+    if (OpIndex == N->getNumOperands()) {
+      // All operands are numbered; number the node itself.
+      Worklist.pop_back();
+      finishEnumeratingMetadata(N);
+      continue;
+    }
+
+    ++Worklist.back().second;
+    Metadata *Op = N->getOperand(OpIndex);
+    if (!Op)
+      continue;
+    assert(!isa<LocalAsMetadata>(Op) && "MDNodes cannot be function-local");
+    if (const MDNode *OpN = enumerateMetadataImpl(Op))
+      Worklist.push_back(std::make_pair(OpN, 0u));
+  }
+}
+
+/// Reserves an ID for MD, returning the node when its operands must be
+/// numbered before it.
+const MDNode *ValueEnumerator::enumerateMetadataImpl(const Metadata *MD) {
   assert(
       (isa<MDNode>(MD) || isa<MDString>(MD) || isa<ConstantAsMetadata>(MD)) &&
       "Invalid metadata kind");
 
-  // Insert a dummy ID to block the co-recursive call to
-  // EnumerateMDNodeOperands() from re-visiting MD in a cyclic graph.
+  // Insert a dummy ID to block revisiting MD in a cyclic graph.
   //
   // Return early if there's already an ID.
   if (!MDValueMap.insert(std::make_pair(MD, 0)).second)
-    return;
+    return nullptr;
 
   // Visit operands first to minimize RAUW.
   if (auto *N = dyn_cast<MDNode>(MD))
-    EnumerateMDNodeOperands(N);
-  else if (auto *C = dyn_cast<ConstantAsMetadata>(MD))
+    return N;
+  if (auto *C = dyn_cast<ConstantAsMetadata>(MD))
     EnumerateValue(C->getValue());
 
+  finishEnumeratingMetadata(MD);
+  return nullptr;
+}
+
+void ValueEnumerator::finishEnumeratingMetadata(const Metadata *MD) {
   HasMDString |= isa<MDString>(MD);
   HasDILocation |= isa<DILocation>(MD);
   HasGenericDINode |= isa<GenericDINode>(MD);
@@ -562,6 +597,7 @@ void ValueEnumerator::EnumerateMetadata(const Metadata *MD) {
   MDs.push_back(MD);
   MDValueMap[MD] = MDs.size();
 }
+// HLSL Change Ends
 
 /// EnumerateFunctionLocalMetadataa - Incorporate function-local metadata
 /// information reachable from the metadata.
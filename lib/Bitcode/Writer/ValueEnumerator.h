@@ -192,6 +192,8 @@ private:
 
   void EnumerateMDNodeOperands(const MDNode *N);
   void EnumerateMetadata(const Metadata *MD);
+  const MDNode *enumerateMetadataImpl(const Metadata *MD); // HLSL Change
+  void finishEnumeratingMetadata(const Metadata *MD);       // HLSL Change
   void EnumerateFunctionLocalMetadata(const LocalAsMetadata *Local);
   void EnumerateNamedMDNode(const NamedMDNode *NMD);
   void EnumerateValue(const Value *V);
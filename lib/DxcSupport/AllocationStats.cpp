@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// AllocationStats.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides an allocator that counts the allocations of an operation.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/AllocationStats.h"
+
+using namespace hlsl;
+
+// Size class i holds blocks of up to 16 << (2 * i) bytes; the last class
+// holds all larger blocks.
+static unsigned GetSizeClass(SIZE_T cb) {
+  unsigned sizeClass = 0;
+  SIZE_T limit = 16;
+  while (sizeClass + 1 < DxcAllocationSizeClassCount && cb > limit) {
+    limit <<= 2;
+    ++sizeClass;
+  }
+  return sizeClass;
+}
+
+AllocationStatsMalloc::AllocationStatsMalloc(IMalloc *pMalloc)
+    : m_dwRef(0), m_pMalloc(pMalloc), m_allocCount(0), m_allocBytes(0),
+      m_liveBytes(0), m_peakBytes(0) {
+  for (std::atomic<uint64_t> &count : m_sizeClassCounts)
+    count = 0;
+}
+
+HRESULT AllocationStatsMalloc::Create(IMalloc *pMalloc,
+                                      AllocationStatsMalloc **ppResult) {
+  *ppResult = AllocationStatsMalloc::Alloc(pMalloc);
+  IFROOM(*ppResult);
+  (*ppResult)->AddRef();
+  return S_OK;
+}
+
+void AllocationStatsMalloc::GetStats(DxcAllocationStats *pStats) {
+  pStats->AllocCount = m_allocCount.load();
+  pStats->AllocBytes = m_allocBytes.load();
+  pStats->PeakBytes = m_peakBytes.load();
+  for (unsigned i = 0; i < DxcAllocationSizeClassCount; ++i)
+    pStats->SizeClassCounts[i] = m_sizeClassCounts[i].load();
+}
+
+SIZE_T AllocationStatsMalloc::SizeOf(void *pv) {
+  if (pv == nullptr)
+    return 0;
+  SIZE_T size = m_pMalloc->GetSize(pv);
+  return size == (SIZE_T)-1 ? 0 : size;
+}
+
+void AllocationStatsMalloc::Add(SIZE_T requested, SIZE_T size) {
+  m_allocCount++;
+  m_allocBytes += requested;
+  m_sizeClassCounts[GetSizeClass(requested)]++;
+  uint64_t live = m_liveBytes.fetch_add(size) + size;
+  uint64_t prior = m_peakBytes.load();
+  while (prior < live && !m_peakBytes.compare_exchange_weak(prior, live)) {
+  }
+}
+
+void AllocationStatsMalloc::Remove(SIZE_T size) {
+  // Blocks allocated before counting began may be freed through this
+  // allocator, so don't let the count wrap around.
+  uint64_t prior = m_liveBytes.load();
+  while (!m_liveBytes.compare_exchange_weak(
+      prior, prior > size ? prior - size : 0)) {
+  }
+}
+
+void *STDMETHODCALLTYPE AllocationStatsMalloc::Alloc(SIZE_T cb) {
+  void *result = m_pMalloc->Alloc(cb);
+  if (result != nullptr)
+    Add(cb, SizeOf(result));
+  return result;
+}
+
+void *STDMETHODCALLTYPE AllocationStatsMalloc::Realloc(void *pv, SIZE_T cb) {
+  SIZE_T priorSize = SizeOf(pv);
+  void *result = m_pMalloc->Realloc(pv, cb);
+  if (result != nullptr || cb == 0) {
+    Remove(priorSize);
+    if (result != nullptr)
+      Add(cb, SizeOf(result));
+  }
+  return result;
+}
+
+void STDMETHODCALLTYPE AllocationStatsMalloc::Free(void *pv) {
+  Remove(SizeOf(pv));
+  m_pMalloc->Free(pv);
+}
+
+SIZE_T STDMETHODCALLTYPE AllocationStatsMalloc::GetSize(void *pv) {
+  return m_pMalloc->GetSize(pv);
+}
+
+int STDMETHODCALLTYPE AllocationStatsMalloc::DidAlloc(void *pv) {
+  return m_pMalloc->DidAlloc(pv);
+}
+
+void STDMETHODCALLTYPE AllocationStatsMalloc::HeapMinimize() {
+  m_pMalloc->HeapMinimize();
+}
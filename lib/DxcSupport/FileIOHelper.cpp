@@ -18,7 +18,9 @@
 
 #include <algorithm>
 #include <memory>
+#ifdef _WIN32
 #include <intsafe.h>
+#endif
 
 #define CP_UTF16 1200
 
@@ -382,6 +384,84 @@ DxcCreateBlobOnHeapCopy(_In_bytecount_(size) LPCVOID pData, UINT32 size,
   return S_OK;
 }
 
+// Files at least this large are mapped rather than read into the heap.
+static const DWORD kMapFileThreshold = 1024 * 1024;
+
+// A blob over a read-only view of a mapped file.
+class MappedFileBlob : public IDxcBlob {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  HANDLE m_hMapping = nullptr;
+  LPVOID m_pView = nullptr;
+  SIZE_T m_Size = 0;
+public:
+  DXC_MICROCOM_ADDREF_IMPL(m_dwRef)
+  ULONG STDMETHODCALLTYPE Release() {
+    // Like InternalDxcBlobEncoding, avoid TLS.
+    ULONG result = InterlockedDecrement(&m_dwRef);
+    if (result == 0) {
+      CComPtr<IMalloc> pTmp(m_pMalloc);
+      this->~MappedFileBlob();
+      pTmp->Free(this);
+    }
+    return result;
+  }
+  DXC_MICROCOM_TM_CTOR(MappedFileBlob)
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcBlob>(this, iid, ppvObject);
+  }
+
+  ~MappedFileBlob() {
+    if (m_pView != nullptr)
+      UnmapViewOfFile(m_pView);
+    if (m_hMapping != nullptr)
+      CloseHandle(m_hMapping);
+  }
+
+  HRESULT Map(HANDLE hFile, DWORD size) {
+    m_hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0,
+                                    nullptr);
+    if (m_hMapping == nullptr)
+      return HRESULT_FROM_WIN32(GetLastError());
+    m_pView = MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_pView == nullptr)
+      return HRESULT_FROM_WIN32(GetLastError());
+    m_Size = size;
+    return S_OK;
+  }
+
+  virtual LPVOID STDMETHODCALLTYPE GetBufferPointer(void) override {
+    return m_pView;
+  }
+  virtual SIZE_T STDMETHODCALLTYPE GetBufferSize(void) override {
+    return m_Size;
+  }
+};
+
+// Maps the file if it is large enough, returning S_FALSE and no blob if the
+// file should be read instead.
+static HRESULT TryMapFile(_In_ IMalloc *pMalloc, _In_z_ LPCWSTR pFileName,
+                          _COM_Outptr_result_maybenull_ IDxcBlob **ppBlob) {
+  *ppBlob = nullptr;
+  HANDLE hFile = CreateFileW(pFileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE)
+    return HRESULT_FROM_WIN32(GetLastError());
+  // The mapping keeps its own reference to the file.
+  CHandle h(hFile);
+
+  LARGE_INTEGER FileSize;
+  if (!GetFileSizeEx(hFile, &FileSize))
+    return HRESULT_FROM_WIN32(GetLastError());
+  if (FileSize.HighPart != 0 || FileSize.LowPart < kMapFileThreshold)
+    return S_FALSE;
+
+  CComPtr<MappedFileBlob> pMapped = MappedFileBlob::Alloc(pMalloc);
+  IFROOM(pMapped.p);
+  IFR(pMapped->Map(hFile, FileSize.LowPart));
+  return pMapped.QueryInterface(ppBlob);
+}
+
 _Use_decl_annotations_
 HRESULT
 DxcCreateBlobFromFile(IMalloc *pMalloc, LPCWSTR pFileName, UINT32 *pCodePage,
@@ -390,17 +470,31 @@ DxcCreateBlobFromFile(IMalloc *pMalloc, LPCWSTR pFileName, UINT32 *pCodePage,
     return E_POINTER;
   }
 
+  *ppBlobEncoding = nullptr;
+  bool known = (pCodePage != nullptr);
+  UINT32 codePage = (pCodePage != nullptr) ? *pCodePage : 0;
+
+  // Large inputs such as library containers and debug blobs are used in
+  // place rather than copied into the heap. If mapping fails, read the file
+  // below, which reports the error if there is one.
+  CComPtr<IDxcBlob> pMapped;
+  if (TryMapFile(pMalloc, pFileName, &pMapped) == S_OK) {
+    InternalDxcBlobEncoding *internalEncoding;
+    HRESULT hr = InternalDxcBlobEncoding::CreateFromBlob(
+        pMapped, pMalloc, known, codePage, &internalEncoding);
+    if (SUCCEEDED(hr)) {
+      *ppBlobEncoding = internalEncoding;
+    }
+    return hr;
+  }
+
   LPVOID pData;
   DWORD dataSize;
-  *ppBlobEncoding = nullptr;
   try {
     ReadBinaryFile(pMalloc, pFileName, &pData, &dataSize);
   }
   CATCH_CPP_RETURN_HRESULT();
 
-  bool known = (pCodePage != nullptr);
-  UINT32 codePage = (pCodePage != nullptr) ? *pCodePage : 0;
-
   InternalDxcBlobEncoding *internalEncoding;
   HRESULT hr = InternalDxcBlobEncoding::CreateFromMalloc(
     pData, pMalloc, dataSize, known, codePage, &internalEncoding);
@@ -590,6 +684,12 @@ HRESULT DxcGetBlobAsUtf8(IDxcBlob *pBlob, IDxcBlobEncoding **pBlobEncoding) {
     codePage = DxcCodePageFromBytes((char *)pBlob->GetBufferPointer(), blobLen);
   }
 
+  // ASCII text is already UTF-8, whatever the ANSI code page.
+  if (codePage == CP_ACP &&
+      Unicode::IsASCIIBuffer((char *)pBlob->GetBufferPointer(), blobLen)) {
+    codePage = CP_UTF8;
+  }
+
   if (codePage == CP_UTF8) {
     // Reuse the underlying blob but create an object with the encoding known.
     InternalDxcBlobEncoding* internalEncoding;
@@ -610,6 +710,24 @@ HRESULT DxcGetBlobAsUtf8(IDxcBlob *pBlob, IDxcBlobEncoding **pBlobEncoding) {
   if (codePage == CP_UTF16) {
     utf16Chars = (wchar_t*)pBlob->GetBufferPointer();
     utf16CharCount = blobLen / sizeof(wchar_t);
+
+    // All-ASCII UTF-16 narrows straight into the final buffer.
+    CDxcTMHeapPtr<char> asciiCopy;
+    if (!asciiCopy.Allocate((size_t)utf16CharCount + 1))
+      return E_OUTOFMEMORY;
+    if (Unicode::UTF16ToASCIIBuffer(utf16Chars, utf16CharCount,
+                                    asciiCopy.m_pData)) {
+      asciiCopy.m_pData[utf16CharCount] = '\0';
+      InternalDxcBlobEncoding* internalEncoding;
+      hr = InternalDxcBlobEncoding::CreateFromMalloc(asciiCopy.m_pData,
+        DxcGetThreadMallocNoRef(),
+        utf16CharCount, true, CP_UTF8, &internalEncoding);
+      if (SUCCEEDED(hr)) {
+        *pBlobEncoding = internalEncoding;
+        asciiCopy.Detach();
+      }
+      return hr;
+    }
   }
   else {
     hr = CodePageBufferToUtf16(codePage, pBlob->GetBufferPointer(), blobLen,
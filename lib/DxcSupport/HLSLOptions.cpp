@@ -308,6 +308,9 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.AstDump = Args.hasFlag(OPT_ast_dump, OPT_INVALID, false);
   opts.CodeGenHighLevel = Args.hasFlag(OPT_fcgl, OPT_INVALID, false);
   opts.DebugInfo = Args.hasFlag(OPT__SLASH_Zi, OPT_INVALID, false);
+  // /Zi-lines is /Zi without variables and types.
+  opts.DebugLineTablesOnly = Args.hasFlag(OPT_Zi_lines, OPT_INVALID, false);
+  opts.DebugInfo |= opts.DebugLineTablesOnly;
   opts.DebugNameForBinary = Args.hasFlag(OPT_Zsb, OPT_INVALID, false);
   opts.DebugNameForSource = Args.hasFlag(OPT_Zss, OPT_INVALID, false);
   opts.VariableName = Args.getLastArgValue(OPT_Vn);
@@ -328,6 +331,24 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.IEEEStrict = Args.hasFlag(OPT_Gis, OPT_INVALID, false);
 
   opts.IgnoreLineDirectives = Args.hasFlag(OPT_ignore_line_directives, OPT_INVALID, false);
+  opts.Preprocessed = Args.hasFlag(OPT_fpreprocessed, OPT_INVALID, false);
+  opts.CompactTypeAnnotations = Args.hasFlag(OPT_compact_type_annotations, OPT_INVALID, false);
+  opts.DeferFunctionBodies = Args.hasFlag(OPT_defer_function_bodies, OPT_INVALID, false);
+  opts.TrimResourceRanges = Args.hasFlag(OPT_trim_resource_ranges, OPT_INVALID, false);
+  opts.UniformBranchHints = Args.hasFlag(OPT_uniform_branch_hints, OPT_INVALID, false);
+  opts.AutoFlatten = Args.hasFlag(OPT_auto_flatten, OPT_INVALID, false);
+  opts.UnswitchUniformLoops = Args.hasFlag(OPT_unswitch_uniform_loops, OPT_INVALID, false);
+  opts.WaveAggregateAtomics = Args.hasFlag(OPT_wave_aggregate_atomics, OPT_INVALID, false);
+  opts.AutoEarlyDepthStencil = Args.hasFlag(OPT_auto_early_depth_stencil, OPT_INVALID, false);
+  opts.GatherPointSamples = Args.hasFlag(OPT_gather_point_samples, OPT_INVALID, false);
+  opts.CompactContext = Args.hasFlag(OPT_compact_context, OPT_INVALID, false);
+  opts.DemotePrecision = Args.hasFlag(OPT_demote_precision, OPT_INVALID, false);
+  opts.UnrollReport = Args.hasFlag(OPT_unroll_report, OPT_INVALID, false);
+  opts.SelectDynamicIndexing = Args.hasFlag(OPT_select_dynamic_indexing, OPT_INVALID, false);
+  opts.PadGroupShared = Args.hasFlag(OPT_pad_groupshared, OPT_INVALID, false);
+  opts.Specializable = Args.hasFlag(OPT_specializable, OPT_INVALID, false);
+  opts.BottomUpInline = Args.hasFlag(OPT_bottom_up_inline, OPT_INVALID, false);
+  opts.FreeASTEarly = Args.hasFlag(OPT_free_ast_early, OPT_INVALID, false);
 
   opts.FloatDenormalMode = Args.getLastArgValue(OPT_denorm);
   // Check if a given denormalized value is valid
@@ -341,6 +362,30 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     }
   }
 
+  opts.FPSpeed = Args.getLastArgValue(OPT_fp_speed_EQ);
+  if (!opts.FPSpeed.empty()) {
+    if (!(opts.FPSpeed.equals_lower("precise") ||
+          opts.FPSpeed.equals_lower("balanced") ||
+          opts.FPSpeed.equals_lower("fast"))) {
+      errors << "Unsupported value '" << opts.FPSpeed
+          << "' for fp-speed option.";
+      return 1;
+    }
+  }
+
+  if (Arg *A = Args.getLastArg(OPT_wave_size)) {
+    unsigned waveSize = 0;
+    if (llvm::StringRef(A->getValue()).getAsInteger(10, waveSize) ||
+        waveSize < DXIL::kMinWaveSize || waveSize > DXIL::kMaxWaveSize ||
+        (waveSize & (waveSize - 1)) != 0) {
+      errors << "Unsupported value '" << A->getValue()
+          << "' for wave-size option; use a power of two from "
+          << DXIL::kMinWaveSize << " to " << DXIL::kMaxWaveSize << ".";
+      return 1;
+    }
+    opts.WaveSize = waveSize;
+  }
+
   // Check options only allowed in shader model >= 6.2FPDenormalMode
   unsigned Major = 0;
   unsigned Minor = 0;
@@ -382,6 +427,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   else
     opts.OptLevel = 3;
   opts.OptDump = Args.hasFlag(OPT_Odump, OPT_INVALID, false);
+  opts.OptPipelineFile = Args.getLastArgValue(OPT_opt_pipeline);
 
   opts.DisableValidation = Args.hasFlag(OPT_VD, OPT_INVALID, false);
 
@@ -393,6 +439,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.NotUseLegacyCBufLoad = Args.hasFlag(OPT_not_use_legacy_cbuf_load, OPT_INVALID, false);
   opts.PackPrefixStable = Args.hasFlag(OPT_pack_prefix_stable, OPT_INVALID, false);
   opts.PackOptimized = Args.hasFlag(OPT_pack_optimized, OPT_INVALID, false);
+  opts.PackMinimal = Args.hasFlag(OPT_pack_minimal, OPT_INVALID, false);
+  opts.ExtendedPSV = Args.hasFlag(OPT_psv_extended, OPT_INVALID, false);
   opts.DisplayIncludeProcess = Args.hasFlag(OPT_H, OPT_INVALID, false);
   opts.WarningAsError = Args.hasFlag(OPT__SLASH_WX, OPT_INVALID, false);
   opts.AvoidFlowControl = Args.hasFlag(OPT_Gfa, OPT_INVALID, false);
@@ -402,12 +450,110 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.StripRootSignature = Args.hasFlag(OPT_Qstrip_rootsignature, OPT_INVALID, false);
   opts.StripPrivate = Args.hasFlag(OPT_Qstrip_priv, OPT_INVALID, false);
   opts.StripReflection = Args.hasFlag(OPT_Qstrip_reflect, OPT_INVALID, false);
+  opts.EmbedShaderHash = Args.hasFlag(OPT_Qembed_hash, OPT_INVALID, false);
+  opts.EmbedStatistics = Args.hasFlag(OPT_Qembed_stats, OPT_INVALID, false);
+  opts.CompressDebugInfo = Args.hasFlag(OPT_Qcompress_debug, OPT_INVALID, false);
+  opts.Sidecar = Args.hasFlag(OPT_Qsidecar, OPT_INVALID, false);
+  opts.SourcePackFile = Args.getLastArgValue(OPT_Fsp);
+  opts.SourcePack = Args.hasFlag(OPT_Qsource_pack, OPT_INVALID, false) ||
+                    !opts.SourcePackFile.empty();
+  opts.Reproducible = Args.hasFlag(OPT_Brepro, OPT_INVALID, false);
+  for (const std::string &value : Args.getAllArgValues(OPT_fdebug_prefix_map_EQ)) {
+    size_t eq = value.find('=');
+    if (eq == std::string::npos || eq == 0) {
+      errors << "Invalid -fdebug-prefix-map value '" << value
+             << "'; expected <old>=<new>.";
+      return 1;
+    }
+    opts.DebugPrefixMap[value.substr(0, eq)] = value.substr(eq + 1);
+  }
   opts.ExtractRootSignature = Args.hasFlag(OPT_extractrootsignature, OPT_INVALID, false);
   opts.DisassembleColorCoded = Args.hasFlag(OPT_Cc, OPT_INVALID, false);
   opts.DisassembleInstNumbers = Args.hasFlag(OPT_Ni, OPT_INVALID, false);
   opts.DisassembleByteOffset = Args.hasFlag(OPT_No, OPT_INVALID, false);
   opts.DisaseembleHex = Args.hasFlag(OPT_Lx, OPT_INVALID, false);
   opts.LegacyMacroExpansion = Args.hasFlag(OPT_flegacy_macro_expansion, OPT_INVALID, false);
+  opts.CompileCacheDir = Args.getLastArgValue(OPT_cache_dir);
+  if (Arg *A = Args.getLastArg(OPT_cache_max_size)) {
+    if (llvm::StringRef(A->getValue()).getAsInteger(10, opts.CompileCacheMaxSize) ||
+        opts.CompileCacheMaxSize == 0) {
+      errors << "Unsupported value '" << A->getValue() << "' for cache-max-size.";
+      return 1;
+    }
+  }
+
+  opts.CreatePretokenizedHeader = Args.hasFlag(OPT_Yc, OPT_INVALID, false);
+  opts.PretokenizedHeader = Args.getLastArgValue(OPT_Yu);
+  if (opts.CreatePretokenizedHeader && !opts.PretokenizedHeader.empty()) {
+    errors << "Cannot specify /Yc and /Yu together, use /? to get usage information";
+    return 1;
+  }
+
+  opts.TimeReportFile = Args.getLastArgValue(OPT_Ftr);
+  opts.TimeReport = Args.hasFlag(OPT_ftime_report, OPT_INVALID, false) ||
+                    !opts.TimeReportFile.empty();
+  opts.TimeTraceFile = Args.getLastArgValue(OPT_Ftt);
+  opts.TimeTrace = Args.hasFlag(OPT_ftime_trace, OPT_INVALID, false) ||
+                   !opts.TimeTraceFile.empty();
+  opts.AllocationStats = Args.hasFlag(OPT_falloc_stats, OPT_INVALID, false);
+  opts.PrintIRStats = Args.hasFlag(OPT_print_ir_stats, OPT_INVALID, false);
+  opts.DependencyFile = Args.getLastArgValue(OPT_MF);
+  opts.WriteDependencies = Args.hasFlag(OPT_MD, OPT_INVALID, false) ||
+                           !opts.DependencyFile.empty();
+
+  opts.BatchFile = Args.getLastArgValue(OPT_batch);
+  if (Arg *A = Args.getLastArg(OPT_batch_jobs)) {
+    if (llvm::StringRef(A->getValue()).getAsInteger(10, opts.BatchJobs) ||
+        opts.BatchJobs == 0) {
+      errors << "Unsupported value '" << A->getValue() << "' for j.";
+      return 1;
+    }
+    if (opts.BatchFile.empty()) {
+      errors << "/j can only be used with /batch.";
+      return 1;
+    }
+  }
+  opts.RemoteJobFile = Args.getLastArgValue(OPT_remote);
+  opts.RemoteResultFile = Args.getLastArgValue(OPT_remote_result);
+  opts.RemoteServer = Args.hasFlag(OPT_server, OPT_INVALID, false);
+  if (!opts.RemoteJobFile.empty() && !opts.RemoteResultFile.empty()) {
+    errors << "Cannot specify /remote and /remote-result together.";
+    return 1;
+  }
+  if ((!opts.RemoteJobFile.empty() || !opts.RemoteResultFile.empty()) &&
+      (opts.RemoteServer || opts.RecompileFromBinary || opts.DumpBin ||
+       !opts.Preprocess.empty() || !opts.BatchFile.empty())) {
+    errors << "Cannot specify /remote or /remote-result with /server, "
+              "/recompile, /dumpbin, /P or /batch.";
+    return 1;
+  }
+  if (opts.RemoteServer && opts.OutputObject.empty()) {
+    errors << "/server requires /Fo to name the result.";
+    return 1;
+  }
+  opts.Daemon = Args.hasFlag(OPT_daemon, OPT_INVALID, false);
+  if (opts.Daemon && !opts.InputFile.empty()) {
+    errors << "/daemon reads command lines from standard input and takes no "
+              "input file.";
+    return 1;
+  }
+  if (opts.Daemon && (opts.RemoteServer || !opts.BatchFile.empty() ||
+                      !opts.RemoteJobFile.empty() ||
+                      !opts.RemoteResultFile.empty())) {
+    errors << "Cannot specify /daemon with /batch, /server, /remote or "
+              "/remote-result.";
+    return 1;
+  }
+
+  if (opts.Sidecar && !opts.DebugInfo) {
+    errors << "/Qsidecar requires /Zi.";
+    return 1;
+  }
+
+  if (opts.SourcePack && !opts.DebugInfo) {
+    errors << "/Qsource_pack requires /Zi.";
+    return 1;
+  }
 
   if (opts.DefaultColMajor && opts.DefaultRowMajor) {
     errors << "Cannot specify /Zpr and /Zpc together, use /? to get usage information";
@@ -421,6 +567,15 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     errors << "Cannot specify /pack_prefix_stable and /pack_optimized together, use /? to get usage information";
     return 1;
   }
+  if (opts.PackMinimal && (opts.PackPrefixStable || opts.PackOptimized)) {
+    errors << "Cannot specify /pack_minimal with /pack_prefix_stable or /pack_optimized, use /? to get usage information";
+    return 1;
+  }
+  if (opts.IEEEStrict && !opts.FPSpeed.empty() &&
+      !opts.FPSpeed.equals_lower("precise")) {
+    errors << "Cannot specify /Gis with /fp-speed=balanced or /fp-speed=fast, use /? to get usage information";
+    return 1;
+  }
   // TODO: more fxc option check.
   // ERR_RES_MAY_ALIAS_ONLY_IN_CS_5
   // ERR_NOT_ABLE_TO_FLATTEN on if that contain side effects
@@ -431,15 +586,27 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   // ERR_TEMPLATE_VAR_CONFLICT
   // ERR_ATTRIBUTE_PARAM_SIDE_EFFECT
 
-  if ((flagsToInclude & hlsl::options::DriverOption) && opts.InputFile.empty()) {
+  if ((flagsToInclude & hlsl::options::DriverOption) && opts.InputFile.empty() &&
+      opts.BatchFile.empty() && !opts.Daemon) {
     // Input file is required in arguments only for drivers; APIs take this through an argument.
     errors << "Required input file argument is missing. use -help to get more information.";
     return 1;
   }
+  if ((flagsToInclude & hlsl::options::DriverOption) &&
+      opts.CreatePretokenizedHeader && opts.OutputObject.empty()) {
+    errors << "/Yc requires /Fo to name the pretokenized header.";
+    return 1;
+  }
   if (opts.OutputHeader.empty() && !opts.VariableName.empty()) {
     errors << "Cannot specify a header variable name when not writing a header.";
     return 1;
   }
+  // The output file is the target of the dependency rule.
+  if (opts.WriteDependencies && opts.OutputObject.empty() &&
+      opts.OutputHeader.empty() && opts.Preprocess.empty()) {
+    errors << "/MD and /MF require /Fo, /Fh or /P to name the target.";
+    return 1;
+  }
 
   if (!opts.Preprocess.empty() &&
       (!opts.OutputHeader.empty() || !opts.OutputObject.empty() ||
@@ -465,7 +632,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   }
 
   if ((flagsToInclude & hlsl::options::DriverOption) &&
-      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary) {
+      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary &&
+      opts.BatchFile.empty() && !opts.RemoteServer && !opts.Daemon) {
     // Target profile is required in arguments only for drivers when compiling;
     // APIs take this through an argument.
     errors << "Target profile argument is missing";
@@ -487,8 +655,34 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.VkUseGlLayout = Args.hasFlag(OPT_fvk_use_gl_layout, OPT_INVALID, false);
   opts.VkUseDxLayout = Args.hasFlag(OPT_fvk_use_dx_layout, OPT_INVALID, false);
   opts.SpvEnableReflect = Args.hasFlag(OPT_fspv_reflect, OPT_INVALID, false);
+  opts.SpvReflectSidecarFile = Args.getLastArgValue(OPT_Fsr);
+  opts.SpvReflectSidecar =
+      Args.hasFlag(OPT_fspv_reflect_sidecar, OPT_INVALID, false) ||
+      !opts.SpvReflectSidecarFile.empty();
+  if (!genSpirv && opts.SpvReflectSidecar) {
+    errors << "-fspv-reflect-sidecar requires -spirv";
+    return 1;
+  }
+  opts.SpvOptimizeSize = Args.hasFlag(OPT_fspv_optimize_size, OPT_INVALID, false);
+  opts.SpvRelaxedPrecision = Args.hasFlag(OPT_fspv_relaxed_precision, OPT_INVALID, false);
   opts.VkIgnoreUnusedResources = Args.hasFlag(OPT_fvk_ignore_unused_resources, OPT_INVALID, false);
 
+  opts.VkAutoPushConstantSize = 0;
+  llvm::StringRef autoPushConstantSize =
+      Args.getLastArgValue(OPT_fvk_auto_push_constant_EQ);
+  if (!autoPushConstantSize.empty()) {
+    if (!genSpirv) {
+      errors << "-fvk-auto-push-constant requires -spirv";
+      return 1;
+    }
+    if (autoPushConstantSize.getAsInteger(10, opts.VkAutoPushConstantSize) ||
+        opts.VkAutoPushConstantSize == 0) {
+      errors << "invalid -fvk-auto-push-constant argument: "
+             << autoPushConstantSize;
+      return 1;
+    }
+  }
+
   // Collects the arguments for -fvk-{b|s|t|u}-shift.
   const auto handleVkShiftArgs =
       [genSpirv, &Args, &errors](OptSpecifier id, const char *name,
@@ -546,13 +740,25 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   }
 
   opts.SpvTargetEnv = Args.getLastArgValue(OPT_fspv_target_env_EQ, "vulkan1.0");
+
+  // With -spirv, each -E adds an entry point to the module.
+  if (genSpirv) {
+    for (const Arg *A : Args.filtered(OPT_entrypoint)) {
+      opts.SpvEntryPoints.push_back(A->getValue());
+    }
+  }
 #else
   if (Args.hasFlag(OPT_spirv, OPT_INVALID, false) ||
       Args.hasFlag(OPT_fvk_invert_y, OPT_INVALID, false) ||
       Args.hasFlag(OPT_fvk_use_gl_layout, OPT_INVALID, false) ||
       Args.hasFlag(OPT_fvk_use_dx_layout, OPT_INVALID, false) ||
       Args.hasFlag(OPT_fspv_reflect, OPT_INVALID, false) ||
+      Args.hasFlag(OPT_fspv_reflect_sidecar, OPT_INVALID, false) ||
+      !Args.getLastArgValue(OPT_Fsr).empty() ||
+      Args.hasFlag(OPT_fspv_optimize_size, OPT_INVALID, false) ||
+      Args.hasFlag(OPT_fspv_relaxed_precision, OPT_INVALID, false) ||
       Args.hasFlag(OPT_fvk_ignore_unused_resources, OPT_INVALID, false) ||
+      !Args.getLastArgValue(OPT_fvk_auto_push_constant_EQ).empty() ||
       !Args.getLastArgValue(OPT_fvk_stage_io_order_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_extension_EQ).empty() ||
       !Args.getLastArgValue(OPT_fspv_target_env_EQ).empty() ||
@@ -10,12 +10,19 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/Support/Global.h"
+#ifdef _WIN32
 #include <specstrings.h>
+#endif
 #include "dxc/Support/Unicode.h"
 #include <string>
 
 #include "dxc/Support/WinIncludes.h"
 
+#if defined(_WIN32) && (defined(_M_IX86) || defined(_M_X64))
+#include <emmintrin.h>
+#define DXC_UNICODE_SSE2
+#endif
+
 
 namespace Unicode {
 
@@ -33,6 +40,13 @@ bool UTF16ToEncodedString(_In_z_ const wchar_t* text, DWORD cp, DWORD flags, _In
     return true;
   }
 
+  // ASCII text is the same in UTF-8; narrow it without the API round trips.
+  if (cp == CP_UTF8) {
+    pValue->resize(cUTF16);
+    if (UTF16ToASCIIBuffer(text, cUTF16, &(*pValue)[0]))
+      return true;
+  }
+
   int cbUTF8 = ::WideCharToMultiByte(cp, flags, text, cUTF16, nullptr, 0, nullptr, pUsedDefaultChar);
   if (cbUTF8 == 0)
     return false;
@@ -192,6 +206,20 @@ bool UTF16BufferToUTF8Buffer(const wchar_t *pUTF16, int cUTF16, char **ppUTF8, s
     return true;
   }
 
+  // ASCII text is the same in UTF-8; narrow it without the API round trips.
+  if (cUTF16 != -1) {
+    char *pASCII = new (std::nothrow) char[cUTF16 + 1];
+    if (pASCII == nullptr)
+      return false;
+    if (UTF16ToASCIIBuffer(pUTF16, cUTF16, pASCII)) {
+      pASCII[cUTF16] = '\0';
+      *ppUTF8 = pASCII;
+      *pcUTF8 = cUTF16 + 1;
+      return true;
+    }
+    delete[] pASCII;
+  }
+
   int c1 = ::WideCharToMultiByte(CP_UTF8, // code page
                                  0,       // flags
                                  pUTF16,  // string to convert
@@ -224,6 +252,46 @@ bool UTF16BufferToUTF8Buffer(const wchar_t *pUTF16, int cUTF16, char **ppUTF8, s
   return true;
 }
 
+_Use_decl_annotations_
+bool IsASCIIBuffer(const char *pText, size_t cb) throw() {
+  size_t i = 0;
+#ifdef DXC_UNICODE_SSE2
+  for (; i + 16 <= cb; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pText + i));
+    if (_mm_movemask_epi8(v) != 0)
+      return false;
+  }
+#endif
+  for (; i < cb; ++i) {
+    if ((unsigned char)pText[i] >= 0x80)
+      return false;
+  }
+  return true;
+}
+
+_Use_decl_annotations_
+bool UTF16ToASCIIBuffer(const wchar_t *pUTF16, size_t cch, char *pASCII) throw() {
+  size_t i = 0;
+#ifdef DXC_UNICODE_SSE2
+  // Eight characters at a time: any bit above 0x7F rejects the block,
+  // otherwise the characters are narrowed with a saturating pack.
+  const __m128i highMask = _mm_set1_epi16((short)0xFF80);
+  for (; i + 8 <= cch; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pUTF16 + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, highMask),
+                                         _mm_setzero_si128())) != 0xFFFF)
+      return false;
+    _mm_storel_epi64((__m128i *)(pASCII + i), _mm_packus_epi16(v, v));
+  }
+#endif
+  for (; i < cch; ++i) {
+    if ((unsigned)pUTF16[i] >= 0x80)
+      return false;
+    pASCII[i] = (char)pUTF16[i];
+  }
+  return true;
+}
+
 template<typename TChar>
 static
 bool IsStarMatchT(const TChar *pMask, size_t maskLen, const TChar *pName, size_t nameLen, TChar star) {
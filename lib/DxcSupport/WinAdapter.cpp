@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// WinAdapter.cpp                                                            //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the COM functions declared in WinAdapter.h on POSIX.           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+#include "dxc/Support/WinIncludes.h"
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+namespace {
+// The COM task allocator, which every IMalloc default falls back on.
+class TaskMalloc : public IMalloc {
+public:
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    if (ppvObject == nullptr)
+      return E_POINTER;
+    if (IsEqualIID(iid, __uuidof(IUnknown)) ||
+        IsEqualIID(iid, __uuidof(IMalloc))) {
+      *ppvObject = static_cast<IMalloc *>(this);
+      return S_OK;
+    }
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+  }
+  // The allocator lives as long as the process.
+  ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+  ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override { return malloc(cb); }
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    return realloc(pv, cb);
+  }
+  void STDMETHODCALLTYPE Free(void *pv) override { free(pv); }
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override {
+#ifdef __APPLE__
+    return malloc_size(pv);
+#else
+    return malloc_usable_size(pv);
+#endif
+  }
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override {
+    return -1; // don't know
+  }
+  void STDMETHODCALLTYPE HeapMinimize() override {}
+};
+
+TaskMalloc g_TaskMalloc;
+}
+
+HRESULT CoGetMalloc(DWORD dwMemContext, IMalloc **ppMalloc) {
+  if (ppMalloc == nullptr)
+    return E_POINTER;
+  (void)dwMemContext;
+  *ppMalloc = &g_TaskMalloc;
+  return S_OK;
+}
+
+LPVOID CoTaskMemAlloc(SIZE_T cb) { return g_TaskMalloc.Alloc(cb); }
+
+LPVOID CoTaskMemRealloc(LPVOID pv, SIZE_T cb) {
+  return g_TaskMalloc.Realloc(pv, cb);
+}
+
+void CoTaskMemFree(LPVOID pv) { g_TaskMalloc.Free(pv); }
+
+// A string is preceded by its length in bytes, as on Windows.
+BSTR SysAllocStringLen(const OLECHAR *strIn, UINT ui) {
+  UINT32 *pData =
+      (UINT32 *)CoTaskMemAlloc(sizeof(UINT32) + (ui + 1) * sizeof(OLECHAR));
+  if (pData == nullptr)
+    return nullptr;
+  *pData = ui * sizeof(OLECHAR);
+  BSTR str = (BSTR)(pData + 1);
+  if (strIn != nullptr)
+    memcpy(str, strIn, ui * sizeof(OLECHAR));
+  str[ui] = L'\0';
+  return str;
+}
+
+BSTR SysAllocString(const OLECHAR *psz) {
+  if (psz == nullptr)
+    return nullptr;
+  return SysAllocStringLen(psz, (UINT)wcslen(psz));
+}
+
+void SysFreeString(BSTR bstrString) {
+  if (bstrString != nullptr)
+    CoTaskMemFree((UINT32 *)bstrString - 1);
+}
+
+UINT SysStringLen(BSTR pbstr) {
+  if (pbstr == nullptr)
+    return 0;
+  return *((UINT32 *)pbstr - 1) / sizeof(OLECHAR);
+}
+
+#endif // _WIN32
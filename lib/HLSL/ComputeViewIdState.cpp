@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/ComputeViewIdState.h"
+#include "dxc/HLSL/DxilDomTreeCache.h"
 #include "dxc/Support/Global.h"
 #include "dxc/HLSL/DxilModule.h"
 #include "dxc/HLSL/DxilOperations.h"
@@ -49,9 +50,12 @@ const DxilViewIdState::InputsContributingToOutputType &DxilViewIdState::getInput
 const DxilViewIdState::InputsContributingToOutputType &DxilViewIdState::getInputsContributingToPCOutputs() const                { return m_InputsContributingToPCOutputs; }
 const DxilViewIdState::InputsContributingToOutputType &DxilViewIdState::getPCInputsContributingToOutputs() const                { return m_PCInputsContributingToOutputs; }
 
-void DxilViewIdState::Compute() {
+void DxilViewIdState::Compute(DxilDomTreeCache *pDomTrees) {
   Clear();
 
+  DxilDomTreeCache LocalDomTrees;
+  DxilDomTreeCache &DomTrees = pDomTrees ? *pDomTrees : LocalDomTrees;
+
   const ShaderModel *pSM = m_pModule->GetShaderModel();
   m_bUsesViewId = m_pModule->m_ShaderFlags.GetViewID();
 
@@ -72,9 +76,9 @@ void DxilViewIdState::Compute() {
   }
 
   // 3. Determine shape components that are dynamically accesses and collect all sig outputs.
-  AnalyzeFunctions(m_Entry);
+  AnalyzeFunctions(m_Entry, DomTrees);
   if (m_PCEntry.pEntryFunc) {
-    AnalyzeFunctions(m_PCEntry);
+    AnalyzeFunctions(m_PCEntry, DomTrees);
   }
 
   // 4. Collect sets of values contributing to outputs.
@@ -85,17 +89,17 @@ void DxilViewIdState::Compute() {
 
   // 5. Construct dependency sets.
   for (unsigned StreamId = 0; StreamId < (pSM->IsGS() ? kNumStreams : 1u); StreamId++) {
-    CreateViewIdSets(m_Entry.ContributingInstructions[StreamId],
+    CreateViewIdSets(m_Entry, StreamId,
                      m_OutputsDependentOnViewId[StreamId],
                      m_InputsContributingToOutputs[StreamId], false);
   }
   if (pSM->IsHS()) {
-    CreateViewIdSets(m_PCEntry.ContributingInstructions[0],
+    CreateViewIdSets(m_PCEntry, 0,
                      m_PCOutputsDependentOnViewId,
                      m_InputsContributingToPCOutputs, true);
   } else if (pSM->IsDS()) {
     OutputsDependentOnViewIdType OutputsDependentOnViewId;
-    CreateViewIdSets(m_Entry.ContributingInstructions[0],
+    CreateViewIdSets(m_Entry, 0,
                      OutputsDependentOnViewId,
                      m_PCInputsContributingToOutputs, true);
     DXASSERT_NOMSG(OutputsDependentOnViewId == m_OutputsDependentOnViewId[0]);
@@ -206,6 +210,8 @@ void DxilViewIdState::Clear() {
   m_PCEntry.Clear();
   m_FuncInfo.clear();
   m_ReachingDeclsCache.clear();
+  m_ContributionNodes.clear();
+  m_ContributionStack.clear();
   m_SerializedState.clear();
 }
 
@@ -213,14 +219,15 @@ void DxilViewIdState::EntryInfo::Clear() {
   pEntryFunc = nullptr;
   Functions.clear();
   Outputs.clear();
+  Sources.clear();
   for (unsigned i = 0; i < kNumStreams; i++)
-    ContributingInstructions[i].clear();
+    ContributingSources[i].clear();
 }
 
 void DxilViewIdState::FuncInfo::Clear() {
   Returns.clear();
-  CtrlDep.Clear();
-  pDomTree.reset();
+  pCtrlDep = nullptr;
+  pDomTree = nullptr;
 }
 
 void DxilViewIdState::DetermineMaxPackedLocation(DxilSignature &DxilSig,
@@ -264,7 +271,7 @@ static bool GetUnsignedVal(Value *V, uint32_t *pValue) {
   return true;
 }
 
-void DxilViewIdState::AnalyzeFunctions(EntryInfo &Entry) {
+void DxilViewIdState::AnalyzeFunctions(EntryInfo &Entry, DxilDomTreeCache &DomTrees) {
   for (auto *F : Entry.Functions) {
     DXASSERT_NOMSG(!F->empty());
 
@@ -342,22 +349,16 @@ void DxilViewIdState::AnalyzeFunctions(EntryInfo &Entry) {
     }
 
     // Compute dominator relation.
-    pFuncInfo->pDomTree = make_unique<DominatorTreeBase<BasicBlock> >(false);
-    pFuncInfo->pDomTree->recalculate(*F);
+    pFuncInfo->pDomTree = &DomTrees.GetDomTree(*F);
 #if DXILVIEWID_DBG
     pFuncInfo->pDomTree->print(dbgs());
 #endif
 
-    // Compute postdominator relation.
-    DominatorTreeBase<BasicBlock> PDR(true);
-    PDR.recalculate(*F);
-#if DXILVIEWID_DBG
-    PDR.print(dbgs());
-#endif
-    // Compute control dependence.
-    pFuncInfo->CtrlDep.Compute(F, PDR);
+    // Control dependence is computed for the blocks that are queried.
+    pFuncInfo->pCtrlDep = &DomTrees.GetControlDependence(*F);
 #if DXILVIEWID_DBG
-    pFuncInfo->CtrlDep.print(dbgs());
+    DomTrees.GetPostDomTree(*F).print(dbgs());
+    pFuncInfo->pCtrlDep->print(dbgs());
 #endif
   }
 }
@@ -400,38 +401,49 @@ void DxilViewIdState::CollectValuesContributingToOutputs(EntryInfo &Entry) {
       endRow = SigElem.GetRows() - 1;
     }
 
-    InstructionSetType ContributingInstructionsAllRows;
-    InstructionSetType *pContributingInstructions = &ContributingInstructionsAllRows;
+    SourceSetType ContributingSourcesAllRows;
+    SourceSetType *pContributingSources = &ContributingSourcesAllRows;
     if (startRow == endRow) {
       // Scalar or indexable with known index.
       unsigned index = GetLinearIndex(SigElem, startRow, col);
-      pContributingInstructions = &Entry.ContributingInstructions[StreamId][index];
+      pContributingSources = &Entry.ContributingSources[StreamId][index];
     }
 
-    CollectValuesContributingToOutputRec(Entry, pContributingValue, *pContributingInstructions);
+    CollectSourcesContributingToValue(Entry, pContributingValue, *pContributingSources);
 
     // Handle control dependence of this instruction BB.
     BasicBlock *pBB = CI->getParent();
     Function *F = pBB->getParent();
     FuncInfo *pFuncInfo = m_FuncInfo[F].get();
-    const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
+    const BasicBlockSet &CtrlDepSet = pFuncInfo->pCtrlDep->GetCDBlocks(pBB);
     for (BasicBlock *B : CtrlDepSet) {
-      CollectValuesContributingToOutputRec(Entry, B->getTerminator(), *pContributingInstructions);
+      CollectSourcesContributingToValue(Entry, B->getTerminator(), *pContributingSources);
     }
 
-    if (pContributingInstructions == &ContributingInstructionsAllRows) {
+    if (pContributingSources == &ContributingSourcesAllRows) {
       // Write dynamically indexed output contributions to all rows.
       for (int row = startRow; row <= endRow; row++) {
         unsigned index = GetLinearIndex(SigElem, row, col);
-        Entry.ContributingInstructions[StreamId][index].insert(ContributingInstructionsAllRows.begin(), ContributingInstructionsAllRows.end());
+        Entry.ContributingSources[StreamId][index] |= ContributingSourcesAllRows;
       }
     }
   }
+
+  // Source indices are per entry.
+  DXASSERT_NOMSG(m_ContributionStack.empty());
+  m_ContributionNodes.clear();
+}
+
+// Instructions that introduce a dependence on an input or on ViewID.
+static bool IsContributionSource(Instruction *pInst) {
+  return DxilInst_ViewID(pInst) || DxilInst_LoadInput(pInst) ||
+         DxilInst_LoadOutputControlPoint(pInst) ||
+         DxilInst_LoadPatchConstant(pInst);
 }
 
-void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
-                                                           Value *pContributingValue,
-                                                           InstructionSetType &ContributingInstructions) {
+void DxilViewIdState::CollectSourcesContributingToValue(EntryInfo &Entry,
+                                                        Value *pContributingValue,
+                                                        SourceSetType &ContributingSources) {
   if (Argument *pArg = dyn_cast<Argument>(pContributingValue)) {
     // This must be a leftover signature argument of an entry function.
     DXASSERT_NOMSG(Entry.pEntryFunc == m_pModule->GetEntryFunction() ||
@@ -446,13 +458,74 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
     return;
   }
 
-  auto itInst = ContributingInstructions.emplace(pContributingInst);
+  ContributionNode &Node = CollectSourcesContributingToInstRec(Entry, pContributingInst);
+  DXASSERT_NOMSG(!Node.bOnStack);
+  ContributingSources |= Node.pComponent->Sources;
+}
+
+// The sources of an instruction are those of everything it transitively
+// depends on, so instructions in a cycle share their sources. Visit the
+// dependence graph depth first, finding strongly connected components as in
+// Tarjan's algorithm; a component is complete once all the components it
+// depends on are, and its sources are computed once for all outputs.
+DxilViewIdState::ContributionNode &
+DxilViewIdState::CollectSourcesContributingToInstRec(EntryInfo &Entry,
+                                                     Instruction *pContributingInst) {
+  auto itIns = m_ContributionNodes.emplace(pContributingInst, ContributionNode());
+  ContributionNode &Node = itIns.first->second;
   // Already visited instruction.
-  if (!itInst.second) return;
+  if (!itIns.second) return Node;
+
+  Node.DFSIndex = Node.LowLink = m_NextDFSIndex++;
+  Node.bOnStack = true;
+  Node.pComponent = nullptr;
+  m_ContributionStack.push_back(&Node);
+
+  if (IsContributionSource(pContributingInst)) {
+    Node.Sources.set(Entry.Sources.size());
+    Entry.Sources.push_back(pContributingInst);
+  }
+
+  SmallVector<Value *, 8> ContributingValues;
+  CollectValuesContributingToInst(Entry, pContributingInst, ContributingValues);
+  for (Value *V : ContributingValues) {
+    Instruction *pInst = dyn_cast<Instruction>(V);
+    if (pInst == nullptr) {
+      DXASSERT_NOMSG(isa<Constant>(V) || isa<BasicBlock>(V) || isa<Argument>(V));
+      continue;
+    }
+
+    ContributionNode &Succ = CollectSourcesContributingToInstRec(Entry, pInst);
+    if (Succ.bOnStack)
+      Node.LowLink = std::min(Node.LowLink, Succ.LowLink);
+    else
+      Node.Sources |= Succ.pComponent->Sources;
+  }
+
+  if (Node.LowLink == Node.DFSIndex) {
+    // Node is the root of a component; its members are above it on the stack.
+    ContributionNode *pMember;
+    do {
+      pMember = m_ContributionStack.back();
+      m_ContributionStack.pop_back();
+      pMember->bOnStack = false;
+      pMember->pComponent = &Node;
+      if (pMember != &Node) {
+        Node.Sources |= pMember->Sources;
+        pMember->Sources.clear();
+      }
+    } while (pMember != &Node);
+  }
+
+  return Node;
+}
 
+void DxilViewIdState::CollectValuesContributingToInst(EntryInfo &Entry,
+                                                      Instruction *pContributingInst,
+                                                      SmallVectorImpl<Value *> &ContributingValues) {
   // Handle special cases.
   if (PHINode *phi = dyn_cast<PHINode>(pContributingInst)) {
-    CollectPhiCFValuesContributingToOutputRec(phi, Entry, ContributingInstructions);
+    CollectPhiCFValuesContributingToOutput(phi, ContributingValues);
   } else if (isa<LoadInst>(pContributingInst) || 
              isa<AtomicCmpXchgInst>(pContributingInst) ||
              isa<AtomicRMWInst>(pContributingInst)) {
@@ -462,9 +535,7 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
     DXASSERT_NOMSG(ReachingDecls.size() > 0);
     for (Value *pDeclValue : ReachingDecls) {
       const ValueSetType &Stores = CollectStores(pDeclValue);
-      for (Value *V : Stores) {
-        CollectValuesContributingToOutputRec(Entry, V, ContributingInstructions);
-      }
+      ContributingValues.append(Stores.begin(), Stores.end());
     }
   } else if (CallInst *CI = dyn_cast<CallInst>(pContributingInst)) {
     if (!hlsl::OP::IsDxilOpFuncCallInst(CI)) {
@@ -473,28 +544,22 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
         // Return value of a user function.
         if (Entry.Functions.find(F) != Entry.Functions.end()) {
           const FuncInfo &FI = *m_FuncInfo[F];
-          for (ReturnInst *pRetInst : FI.Returns) {
-            CollectValuesContributingToOutputRec(Entry, pRetInst, ContributingInstructions);
-          }
+          ContributingValues.append(FI.Returns.begin(), FI.Returns.end());
         }
       }
     }
   }
 
   // Handle instruction inputs.
-  unsigned NumOps = pContributingInst->getNumOperands();
-  for (unsigned i = 0; i < NumOps; i++) {
-    Value *O = pContributingInst->getOperand(i);
-    CollectValuesContributingToOutputRec(Entry, O, ContributingInstructions);
-  }
+  ContributingValues.append(pContributingInst->op_begin(), pContributingInst->op_end());
 
   // Handle control dependence of this instruction BB.
   BasicBlock *pBB = pContributingInst->getParent();
   Function *F = pBB->getParent();
   FuncInfo *pFuncInfo = m_FuncInfo[F].get();
-  const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
+  const BasicBlockSet &CtrlDepSet = pFuncInfo->pCtrlDep->GetCDBlocks(pBB);
   for (BasicBlock *B : CtrlDepSet) {
-    CollectValuesContributingToOutputRec(Entry, B->getTerminator(), ContributingInstructions);
+    ContributingValues.push_back(B->getTerminator());
   }
 }
 
@@ -503,9 +568,8 @@ void DxilViewIdState::CollectValuesContributingToOutputRec(EntryInfo &Entry,
 // However, this may be too conservative and, as such, pick up extra control dependent BBs.
 // A better "definition" point is the highest dominator where it is still legal to "insert" constant assignment.
 // In this context, "legal" means that only one value "leaves" the dominator and reaches Phi.
-void DxilViewIdState::CollectPhiCFValuesContributingToOutputRec(PHINode *pPhi,
-                                                                EntryInfo &Entry,
-                                                                InstructionSetType &ContributingInstructions) {
+void DxilViewIdState::CollectPhiCFValuesContributingToOutput(PHINode *pPhi,
+                                                             SmallVectorImpl<Value *> &ContributingValues) {
   Function *F = pPhi->getParent()->getParent();
   FuncInfo *pFuncInfo = m_FuncInfo[F].get();
   unordered_map<DomTreeNodeBase<BasicBlock> *, Value *> DomTreeMarkers;
@@ -578,9 +642,9 @@ void DxilViewIdState::CollectPhiCFValuesContributingToOutputRec(PHINode *pPhi,
 
     // Handle control dependence of this constant argument highest legal "definition" point.
     pBB = pDefDomNode->getBlock();
-    const BasicBlockSet &CtrlDepSet = pFuncInfo->CtrlDep.GetCDBlocks(pBB);
+    const BasicBlockSet &CtrlDepSet = pFuncInfo->pCtrlDep->GetCDBlocks(pBB);
     for (BasicBlock *B : CtrlDepSet) {
-      CollectValuesContributingToOutputRec(Entry, B->getTerminator(), ContributingInstructions);
+      ContributingValues.push_back(B->getTerminator());
     }
   }
 }
@@ -676,15 +740,16 @@ void DxilViewIdState::CollectStoresRec(llvm::Value *pValue, ValueSetType &Stores
   }
 }
 
-void DxilViewIdState::CreateViewIdSets(const std::unordered_map<unsigned, InstructionSetType> &ContributingInstructions, 
+void DxilViewIdState::CreateViewIdSets(const EntryInfo &Entry, unsigned StreamId,
                                        OutputsDependentOnViewIdType &OutputsDependentOnViewId,
                                        InputsContributingToOutputType &InputsContributingToOutputs,
                                        bool bPC) {
   const ShaderModel *pSM = m_pModule->GetShaderModel();
 
-  for (auto &itOut : ContributingInstructions) {
+  for (auto &itOut : Entry.ContributingSources[StreamId]) {
     unsigned outIdx = itOut.first;
-    for (Instruction *pInst : itOut.second) {
+    for (unsigned SourceIdx : itOut.second) {
+      Instruction *pInst = Entry.Sources[SourceIdx];
       // Set output dependence on ViewId.
       if (DxilInst_ViewID VID = DxilInst_ViewID(pInst)) {
         DXASSERT(m_bUsesViewId, "otherwise, DxilModule flag not set properly");
@@ -1017,7 +1082,8 @@ bool ComputeViewIdState::runOnModule(Module &M) {
   const ShaderModel *pSM = DxilModule.GetShaderModel();
   if (!pSM->IsCS() && !pSM->IsLib()) {
     DxilViewIdState &ViewIdState = DxilModule.GetViewIdState();
-    ViewIdState.Compute();
+    DxilDomTreeCachePass *pDomTrees = getAnalysisIfAvailable<DxilDomTreeCachePass>();
+    ViewIdState.Compute(pDomTrees ? &pDomTrees->getCache() : nullptr);
     return true;
   }
   return false;
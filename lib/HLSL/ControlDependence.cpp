@@ -5,35 +5,52 @@
 // This file is distributed under the University of Illinois Open Source     //
 // License. See LICENSE.TXT for details.                                     //
 //                                                                           //
-// Control dependence is computed using algorithm in Figure 7.9 from [AK].   //
+// Computes control dependence relation for a function.                      //
 //                                                                           //
-// References                                                                //
-// [AK] Optimizing Compilers for Modern Architectures by Allen and Kennedy.  //
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/ControlDependence.h"
 #include "dxc/Support/Global.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
 #include "llvm/Support/Debug.h"
 
 using namespace llvm;
 using namespace hlsl;
 
 
+// x is control dependent on y if y has a successor that x post-dominates, and
+// x doesn't strictly post-dominate y. The successors x post-dominates are the
+// blocks of its subtree in the post-dominator tree.
 const BasicBlockSet &ControlDependence::GetCDBlocks(BasicBlock *pBB) const {
   auto it = m_ControlDependence.find(pBB);
   if (it != m_ControlDependence.end())
     return it->second;
-  else
-    return m_EmptyBBSet;
+
+  BasicBlockSet &CDBlocks = m_ControlDependence[pBB];
+  // Blocks that don't reach an exit aren't in the post-dominator tree.
+  if (m_pPostDomRel->getNode(pBB) == nullptr)
+    return CDBlocks;
+  SmallVector<BasicBlock *, 8> PostDominated;
+  m_pPostDomRel->getDescendants(pBB, PostDominated);
+  for (BasicBlock *pSuccBB : PostDominated) {
+    for (BasicBlock *pPredBB : predecessors(pSuccBB)) {
+      if (!m_pPostDomRel->properlyDominates(pBB, pPredBB))
+        CDBlocks.insert(pPredBB);
+    }
+  }
+  return CDBlocks;
 }
 
 void ControlDependence::print(raw_ostream &OS) {
   OS << "Control dependence for function '" << m_pFunc->getName() << "'\n";
-  for (auto &it : m_ControlDependence) {
-    BasicBlock *pBB = it.first;
-    OS << "Block " << pBB->getName() << ": { ";
+  for (BasicBlock &BB : *m_pFunc) {
+    const BasicBlockSet &CDBlocks = GetCDBlocks(&BB);
+    if (CDBlocks.empty())
+      continue;
+    OS << "Block " << BB.getName() << ": { ";
     bool bFirst = true;
-    for (BasicBlock *pBB2 : it.second) {
+    for (BasicBlock *pBB2 : CDBlocks) {
       if (!bFirst) OS << ", ";
       OS << pBB2->getName();
       bFirst = false;
@@ -48,77 +65,13 @@ void ControlDependence::dump() {
 }
 
 void ControlDependence::Compute(Function *F, PostDomRelationType &PostDomRel) {
+  Clear();
   m_pFunc = F;
-
-  // Compute reverse topological order of PDT.
-  BasicBlockVector RevTopOrder;
-  BasicBlockSet VisitedBBs;
-  for (BasicBlock *pBB : PostDomRel.getRoots()) {
-    ComputeRevTopOrderRec(PostDomRel, pBB, RevTopOrder, VisitedBBs);
-  }
-  DXASSERT_NOMSG(RevTopOrder.size() == VisitedBBs.size());
-
-  // Compute control dependence relation.
-  for (size_t iBB = 0; iBB < RevTopOrder.size(); iBB++) {
-    BasicBlock *x = RevTopOrder[iBB];
-
-    // For each y = pred(x): if ipostdom(y) != x then add "x is control dependent on y"
-    for (auto itPred = pred_begin(x), endPred = pred_end(x); itPred != endPred; ++itPred) {
-      BasicBlock *y = *itPred;  // predecessor of x
-      BasicBlock *pPredIDomBB = GetIPostDom(PostDomRel, y);
-      if (pPredIDomBB != x) {
-        m_ControlDependence[x].insert(y);
-      }
-    }
-
-    // For all z such that ipostdom(z) = x
-    for (DomTreeNode *child : PostDomRel.getNode(x)->getChildren()) {
-      BasicBlock *z = child->getBlock();
-
-      auto it = m_ControlDependence.find(z);
-      if (it == m_ControlDependence.end())
-        continue;
-
-      // For all y in CDG(z)
-      for (BasicBlock *y : it->second) {
-        // if ipostdom(y) != x then add "x is control dependent on y" 
-        BasicBlock *pPredIDomBB = GetIPostDom(PostDomRel, y);
-        if (pPredIDomBB != x) {
-          m_ControlDependence[x].insert(y);
-        }
-      }
-    }
-  }
+  m_pPostDomRel = &PostDomRel;
 }
 
 void ControlDependence::Clear() {
   m_pFunc = nullptr;
+  m_pPostDomRel = nullptr;
   m_ControlDependence.clear();
-  m_EmptyBBSet.clear();
-}
-
-BasicBlock *ControlDependence::GetIPostDom(PostDomRelationType &PostDomRel, BasicBlock *pBB) {
-  auto *pPDTNode = PostDomRel.getNode(pBB);
-  auto *pIDomNode = pPDTNode->getIDom();
-  BasicBlock *pIDomBB = pIDomNode != nullptr ? pIDomNode->getBlock() : nullptr;
-  return pIDomBB;
-}
-
-void ControlDependence::ComputeRevTopOrderRec(PostDomRelationType &PostDomRel,
-                                              BasicBlock *pBB,
-                                              BasicBlockVector &RevTopOrder,
-                                              BasicBlockSet &VisitedBBs) {
-  if (VisitedBBs.find(pBB) != VisitedBBs.end()) {
-    return;
-  }
-  VisitedBBs.insert(pBB);
-
-  SmallVector<BasicBlock *, 8> Descendants;
-  PostDomRel.getDescendants(pBB, Descendants);
-  for (BasicBlock *pDescBB : Descendants) {
-    if (pDescBB != pBB)
-      ComputeRevTopOrderRec(PostDomRel, pDescBB, RevTopOrder, VisitedBBs);
-  }
-
-  RevTopOrder.emplace_back(pBB);
 }
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcModuleHandle.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Keeps a live module between API calls (IDxcModuleHandle).                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/HLSL/DxcModuleHandle.h"
+
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// The class uuid lets GetDxcModuleHandleModule recognize handles created
+// here; it is not exposed as an interface.
+class __declspec(uuid("6f1c8e52-3b07-4d9a-a5e4-81c2f0d73b96"))
+DxcModuleHandle : public IDxcModuleHandle {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  // The module must go away before its context.
+  std::unique_ptr<LLVMContext> m_pContext;
+  std::unique_ptr<Module> m_pModule;
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcModuleHandle)
+
+  DxcModuleHandle(IMalloc *pMalloc, std::unique_ptr<LLVMContext> pContext,
+                  std::unique_ptr<Module> pModule)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_pContext(std::move(pContext)),
+        m_pModule(std::move(pModule)) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    if (ppvObject != nullptr && IsEqualIID(iid, __uuidof(DxcModuleHandle))) {
+      AddRef();
+      *ppvObject = this;
+      return S_OK;
+    }
+    return DoBasicQueryInterface<IDxcModuleHandle>(this, iid, ppvObject);
+  }
+
+  Module *GetModule() { return m_pModule.get(); }
+
+  __override HRESULT STDMETHODCALLTYPE
+  GetBitcode(_COM_Outptr_ IDxcBlob **ppBitcode) {
+    if (ppBitcode == nullptr)
+      return E_POINTER;
+    *ppBitcode = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      CComPtr<AbstractMemoryStream> pBitcodeStream;
+      IFT(CreateMemoryStream(m_pMalloc, &pBitcodeStream));
+      {
+        raw_stream_ostream outStream(pBitcodeStream.p);
+        WriteBitcodeToFile(m_pModule.get(), outStream, true);
+      }
+      IFT(pBitcodeStream.QueryInterface(ppBitcode));
+    }
+    CATCH_CPP_RETURN_HRESULT();
+    return S_OK;
+  }
+};
+
+} // namespace
+
+namespace hlsl {
+
+HRESULT CreateDxcModuleHandle(_In_ IMalloc *pMalloc,
+                              std::unique_ptr<LLVMContext> pContext,
+                              std::unique_ptr<Module> pModule,
+                              _COM_Outptr_ IDxcModuleHandle **ppHandle) {
+  *ppHandle = nullptr;
+  CComPtr<DxcModuleHandle> result = DxcModuleHandle::Alloc(
+      pMalloc, std::move(pContext), std::move(pModule));
+  IFROOM(result.p);
+  *ppHandle = result.Detach();
+  return S_OK;
+}
+
+Module *GetDxcModuleHandleModule(_In_ IDxcModuleHandle *pHandle) {
+  CComPtr<DxcModuleHandle> pModuleHandle;
+  if (pHandle == nullptr ||
+      FAILED(pHandle->QueryInterface(__uuidof(DxcModuleHandle),
+                                     (void **)&pModuleHandle)))
+    return nullptr;
+  // The caller keeps the handle, and so the module, alive.
+  return pModuleHandle->GetModule();
+}
+
+} // namespace hlsl
@@ -11,6 +11,7 @@
 
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/Global.h"
+#include "dxc/Support/AllocationStats.h"
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/HLSL/DxilContainer.h"
@@ -21,7 +22,10 @@
 #include "dxc/HLSL/HLMatrixLowerPass.h"
 #include "dxc/HLSL/DxilGenerationPass.h"
 #include "dxc/HLSL/ComputeViewIdState.h"
+#include "dxc/HLSL/DxilDomTreeCache.h"
 #include "dxc/HLSL/DxilUtil.h"
+#include "dxc/HLSL/DxcModuleHandle.h"
+#include "dxc/HLSL/DxcTimeReport.h"
 #include "dxc/Support/dxcapi.impl.h"
 
 #include "llvm/Pass.h"
@@ -36,10 +40,13 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/Analysis/CFGPrinter.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include <algorithm>
-#include <list>   // should change this for string_table
+#include <atomic>
+#include <thread>
 #include <vector>
 
 // This is pretty ugly; should be refactored to a proper library
@@ -85,30 +92,48 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDCEPass(Registry);
     initializeDSEPass(Registry);
     initializeDeadInstEliminationPass(Registry);
+    initializeDxilAddBlockCountersPass(Registry);
     initializeDxilAddPixelHitInstrumentationPass(Registry);
+    initializeDxilApplyBlockProfilePass(Registry);
+    initializeDxilAutoFlattenPass(Registry);
+    initializeDxilCoalesceCBufferLoadsPass(Registry);
+    initializeDxilCombineBufferAccessesPass(Registry);
+    initializeDxilCompactContextPass(Registry);
     initializeDxilCondenseResourcesPass(Registry);
     initializeDxilConvergentClearPass(Registry);
     initializeDxilConvergentMarkPass(Registry);
     initializeDxilDeadFunctionEliminationPass(Registry);
     initializeDxilDebugInstrumentationPass(Registry);
+    initializeDxilDemotePrecisionPass(Registry);
+    initializeDxilDomTreeCachePassPass(Registry);
     initializeDxilEliminateOutputDynamicIndexingPass(Registry);
+    initializeDxilEliminateRedundantBarriersPass(Registry);
     initializeDxilEmitMetadataPass(Registry);
     initializeDxilExpandTrigIntrinsicsPass(Registry);
     initializeDxilFinalizeModulePass(Registry);
     initializeDxilForceEarlyZPass(Registry);
+    initializeDxilFormGatherPass(Registry);
     initializeDxilGenerationPassPass(Registry);
+    initializeDxilHoistHandlesPass(Registry);
     initializeDxilLegalizeEvalOperationsPass(Registry);
     initializeDxilLegalizeResourceUsePassPass(Registry);
     initializeDxilLegalizeSampleOffsetPassPass(Registry);
     initializeDxilLegalizeStaticResourceUsePassPass(Registry);
     initializeDxilLoadMetadataPass(Registry);
+    initializeDxilMarkReadNoneLoadsPass(Registry);
     initializeDxilOutputColorBecomesConstantPass(Registry);
+    initializeDxilPackGroupSharedPass(Registry);
     initializeDxilPrecisePropagatePassPass(Registry);
     initializeDxilPreserveAllOutputsPass(Registry);
+    initializeDxilPromoteEarlyDepthStencilPass(Registry);
     initializeDxilReduceMSAAToSingleSamplePass(Registry);
+    initializeDxilRematerializePass(Registry);
     initializeDxilRemoveDiscardsPass(Registry);
     initializeDxilShaderAccessTrackingPass(Registry);
+    initializeDxilSpecializeConstantsPass(Registry);
     initializeDxilTranslateRawBufferPass(Registry);
+    initializeDxilUniformBranchHintsPass(Registry);
+    initializeDxilWaveAggregateAtomicsPass(Registry);
     initializeDynamicIndexingVectorToArrayPass(Registry);
     initializeEarlyCSELegacyPassPass(Registry);
     initializeEliminateAvailableExternallyPass(Registry);
@@ -188,11 +213,17 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   static const LPCSTR ArgPromotionArgs[] = { "maxElements" };
   static const LPCSTR CFGSimplifyPassArgs[] = { "Threshold", "Ftor", "bonus-inst-threshold" };
   static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "force-early-z", "add-pixel-cost", "rt-width", "sv-position-index", "num-pixels" };
-  static const LPCSTR DxilDebugInstrumentationArgs[] = { "UAVSize", "parameter0", "parameter1", "parameter2" };
+  static const LPCSTR DxilApplyBlockProfileArgs[] = { "profile-file", "cold-percent" };
+  static const LPCSTR DxilCondenseResourcesArgs[] = { "allocated" };
+  static const LPCSTR DxilDebugInstrumentationArgs[] = { "UAVSize", "parameter0", "parameter1", "parameter2", "sampleEveryN", "blockEntriesOnly", "ringBuffer" };
+  static const LPCSTR DxilEliminateOutputDynamicIndexingArgs[] = { "max-switch-rows" };
+  static const LPCSTR DxilExpandTrigIntrinsicsArgs[] = { "fp-speed" };
   static const LPCSTR DxilGenerationPassArgs[] = { "NotOptimized" };
   static const LPCSTR DxilOutputColorBecomesConstantArgs[] = { "mod-mode", "constant-red", "constant-green", "constant-blue", "constant-alpha" };
-  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "config", "checkForDynamicIndexing" };
-  static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "ReplaceAllVectors" };
+  static const LPCSTR DxilPackGroupSharedArgs[] = { "pad-for-banks" };
+  static const LPCSTR DxilRematerializeArgs[] = { "max-live-values" };
+  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "config", "checkForDynamicIndexing", "waveAggregate" };
+  static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "ReplaceAllVectors", "SelectDynamicIndexing" };
   static const LPCSTR Float2IntArgs[] = { "float2int-max-integer-bw" };
   static const LPCSTR GVNArgs[] = { "noloads", "enable-pre", "enable-load-pre", "max-recurse-depth" };
   static const LPCSTR JumpThreadingArgs[] = { "Threshold", "jump-threading-threshold" };
@@ -200,7 +231,7 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   static const LPCSTR LoopDistributeArgs[] = { "loop-distribute-verify", "loop-distribute-non-if-convertible" };
   static const LPCSTR LoopRerollArgs[] = { "max-reroll-increment", "reroll-num-tolerated-failed-matches" };
   static const LPCSTR LoopRotateArgs[] = { "MaxHeaderSize", "rotation-max-header-size" };
-  static const LPCSTR LoopUnrollArgs[] = { "Threshold", "Count", "AllowPartial", "Runtime", "unroll-threshold", "unroll-percent-dynamic-cost-saved-threshold", "unroll-dynamic-cost-savings-discount", "unroll-max-iteration-count-to-analyze", "unroll-count", "unroll-allow-partial", "unroll-runtime", "pragma-unroll-threshold" };
+  static const LPCSTR LoopUnrollArgs[] = { "Threshold", "Count", "AllowPartial", "Runtime", "unroll-threshold", "unroll-percent-dynamic-cost-saved-threshold", "unroll-dynamic-cost-savings-discount", "unroll-max-iteration-count-to-analyze", "unroll-count", "unroll-allow-partial", "unroll-runtime", "pragma-unroll-threshold", "unroll-instruction-budget" };
   static const LPCSTR LoopUnswitchArgs[] = { "Os", "loop-unswitch-threshold" };
   static const LPCSTR LowerBitSetsArgs[] = { "lowerbitsets-avoid-reuse" };
   static const LPCSTR LowerExpectIntrinsicArgs[] = { "likely-branch-weight", "unlikely-branch-weight" };
@@ -221,9 +252,15 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   if (strcmp(passName, "argpromotion") == 0) return ArrayRef<LPCSTR>(ArgPromotionArgs, _countof(ArgPromotionArgs));
   if (strcmp(passName, "simplifycfg") == 0) return ArrayRef<LPCSTR>(CFGSimplifyPassArgs, _countof(CFGSimplifyPassArgs));
   if (strcmp(passName, "hlsl-dxil-add-pixel-hit-instrmentation") == 0) return ArrayRef<LPCSTR>(DxilAddPixelHitInstrumentationArgs, _countof(DxilAddPixelHitInstrumentationArgs));
+  if (strcmp(passName, "hlsl-dxil-apply-block-profile") == 0) return ArrayRef<LPCSTR>(DxilApplyBlockProfileArgs, _countof(DxilApplyBlockProfileArgs));
+  if (strcmp(passName, "hlsl-dxil-condense") == 0) return ArrayRef<LPCSTR>(DxilCondenseResourcesArgs, _countof(DxilCondenseResourcesArgs));
   if (strcmp(passName, "hlsl-dxil-debug-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilDebugInstrumentationArgs, _countof(DxilDebugInstrumentationArgs));
+  if (strcmp(passName, "hlsl-dxil-eliminate-output-dynamic") == 0) return ArrayRef<LPCSTR>(DxilEliminateOutputDynamicIndexingArgs, _countof(DxilEliminateOutputDynamicIndexingArgs));
+  if (strcmp(passName, "hlsl-dxil-expand-trig-intrinsics") == 0) return ArrayRef<LPCSTR>(DxilExpandTrigIntrinsicsArgs, _countof(DxilExpandTrigIntrinsicsArgs));
   if (strcmp(passName, "dxilgen") == 0) return ArrayRef<LPCSTR>(DxilGenerationPassArgs, _countof(DxilGenerationPassArgs));
   if (strcmp(passName, "hlsl-dxil-constantColor") == 0) return ArrayRef<LPCSTR>(DxilOutputColorBecomesConstantArgs, _countof(DxilOutputColorBecomesConstantArgs));
+  if (strcmp(passName, "hlsl-dxil-pack-groupshared") == 0) return ArrayRef<LPCSTR>(DxilPackGroupSharedArgs, _countof(DxilPackGroupSharedArgs));
+  if (strcmp(passName, "hlsl-dxil-rematerialize") == 0) return ArrayRef<LPCSTR>(DxilRematerializeArgs, _countof(DxilRematerializeArgs));
   if (strcmp(passName, "hlsl-dxil-pix-shader-access-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilShaderAccessTrackingArgs, _countof(DxilShaderAccessTrackingArgs));
   if (strcmp(passName, "dynamic-vector-to-array") == 0) return ArrayRef<LPCSTR>(DynamicIndexingVectorToArrayArgs, _countof(DynamicIndexingVectorToArrayArgs));
   if (strcmp(passName, "float2int") == 0) return ArrayRef<LPCSTR>(Float2IntArgs, _countof(Float2IntArgs));
@@ -261,11 +298,17 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   static const LPCSTR ArgPromotionArgs[] = { "None" };
   static const LPCSTR CFGSimplifyPassArgs[] = { "None", "None", "Control the number of bonus instructions (default = 1)" };
   static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "None", "None", "None", "None", "None" };
-  static const LPCSTR DxilDebugInstrumentationArgs[] = { "None", "None", "None", "None" };
+  static const LPCSTR DxilApplyBlockProfileArgs[] = { "None", "None" };
+  static const LPCSTR DxilCondenseResourcesArgs[] = { "None" };
+  static const LPCSTR DxilDebugInstrumentationArgs[] = { "None", "None", "None", "None", "None", "None", "None" };
+  static const LPCSTR DxilEliminateOutputDynamicIndexingArgs[] = { "None" };
+  static const LPCSTR DxilExpandTrigIntrinsicsArgs[] = { "None" };
   static const LPCSTR DxilGenerationPassArgs[] = { "None" };
   static const LPCSTR DxilOutputColorBecomesConstantArgs[] = { "None", "None", "None", "None", "None" };
-  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "None", "None" };
-  static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "None" };
+  static const LPCSTR DxilPackGroupSharedArgs[] = { "None" };
+  static const LPCSTR DxilRematerializeArgs[] = { "None" };
+  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "None", "None", "None" };
+  static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "None", "None" };
   static const LPCSTR Float2IntArgs[] = { "Max integer bitwidth to consider in float2int" };
   static const LPCSTR GVNArgs[] = { "None", "None", "None", "Max recurse depth" };
   static const LPCSTR JumpThreadingArgs[] = { "None", "Max block size to duplicate for jump threading" };
@@ -273,7 +316,7 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   static const LPCSTR LoopDistributeArgs[] = { "Turn on DominatorTree and LoopInfo verification after Loop Distribution", "Whether to distribute into a loop that may not be if-convertible by the loop vectorizer" };
   static const LPCSTR LoopRerollArgs[] = { "The maximum increment for loop rerolling", "The maximum number of failures to tolerate during fuzzy matching." };
   static const LPCSTR LoopRotateArgs[] = { "None", "The default maximum header size for automatic loop rotation" };
-  static const LPCSTR LoopUnrollArgs[] = { "None", "None", "None", "None", "The baseline cost threshold for loop unrolling", "The percentage of estimated dynamic cost which must be saved by unrolling to allow unrolling up to the max threshold.", "This is the amount discounted from the total unroll cost when the unrolled form has a high dynamic cost savings (triggered by the '-unroll-perecent-dynamic-cost-saved-threshold' flag).", "Don't allow loop unrolling to simulate more than this number of iterations when checking full unroll profitability", "Use this unroll count for all loops including those with unroll_count pragma values, for testing purposes", "Allows loops to be partially unrolled until -unroll-threshold loop size is reached.", "Unroll loops with run-time trip counts", "Unrolled size limit for loops with an unroll(full) or unroll_count pragma." };
+  static const LPCSTR LoopUnrollArgs[] = { "None", "None", "None", "None", "The baseline cost threshold for loop unrolling", "The percentage of estimated dynamic cost which must be saved by unrolling to allow unrolling up to the max threshold.", "This is the amount discounted from the total unroll cost when the unrolled form has a high dynamic cost savings (triggered by the '-unroll-perecent-dynamic-cost-saved-threshold' flag).", "Don't allow loop unrolling to simulate more than this number of iterations when checking full unroll profitability", "Use this unroll count for all loops including those with unroll_count pragma values, for testing purposes", "Allows loops to be partially unrolled until -unroll-threshold loop size is reached.", "Unroll loops with run-time trip counts", "Unrolled size limit for loops with an unroll(full) or unroll_count pragma.", "Don't unroll loops in functions that would grow past this many instructions." };
   static const LPCSTR LoopUnswitchArgs[] = { "Optimize for size", "Max loop size to unswitch" };
   static const LPCSTR LowerBitSetsArgs[] = { "Try to avoid reuse of byte array addresses using aliases" };
   static const LPCSTR LowerExpectIntrinsicArgs[] = { "Weight of the branch likely to be taken (default = 64)", "Weight of the branch unlikely to be taken (default = 4)" };
@@ -294,9 +337,15 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   if (strcmp(passName, "argpromotion") == 0) return ArrayRef<LPCSTR>(ArgPromotionArgs, _countof(ArgPromotionArgs));
   if (strcmp(passName, "simplifycfg") == 0) return ArrayRef<LPCSTR>(CFGSimplifyPassArgs, _countof(CFGSimplifyPassArgs));
   if (strcmp(passName, "hlsl-dxil-add-pixel-hit-instrmentation") == 0) return ArrayRef<LPCSTR>(DxilAddPixelHitInstrumentationArgs, _countof(DxilAddPixelHitInstrumentationArgs));
+  if (strcmp(passName, "hlsl-dxil-apply-block-profile") == 0) return ArrayRef<LPCSTR>(DxilApplyBlockProfileArgs, _countof(DxilApplyBlockProfileArgs));
+  if (strcmp(passName, "hlsl-dxil-condense") == 0) return ArrayRef<LPCSTR>(DxilCondenseResourcesArgs, _countof(DxilCondenseResourcesArgs));
   if (strcmp(passName, "hlsl-dxil-debug-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilDebugInstrumentationArgs, _countof(DxilDebugInstrumentationArgs));
+  if (strcmp(passName, "hlsl-dxil-eliminate-output-dynamic") == 0) return ArrayRef<LPCSTR>(DxilEliminateOutputDynamicIndexingArgs, _countof(DxilEliminateOutputDynamicIndexingArgs));
+  if (strcmp(passName, "hlsl-dxil-expand-trig-intrinsics") == 0) return ArrayRef<LPCSTR>(DxilExpandTrigIntrinsicsArgs, _countof(DxilExpandTrigIntrinsicsArgs));
   if (strcmp(passName, "dxilgen") == 0) return ArrayRef<LPCSTR>(DxilGenerationPassArgs, _countof(DxilGenerationPassArgs));
   if (strcmp(passName, "hlsl-dxil-constantColor") == 0) return ArrayRef<LPCSTR>(DxilOutputColorBecomesConstantArgs, _countof(DxilOutputColorBecomesConstantArgs));
+  if (strcmp(passName, "hlsl-dxil-pack-groupshared") == 0) return ArrayRef<LPCSTR>(DxilPackGroupSharedArgs, _countof(DxilPackGroupSharedArgs));
+  if (strcmp(passName, "hlsl-dxil-rematerialize") == 0) return ArrayRef<LPCSTR>(DxilRematerializeArgs, _countof(DxilRematerializeArgs));
   if (strcmp(passName, "hlsl-dxil-pix-shader-access-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilShaderAccessTrackingArgs, _countof(DxilShaderAccessTrackingArgs));
   if (strcmp(passName, "dynamic-vector-to-array") == 0) return ArrayRef<LPCSTR>(DynamicIndexingVectorToArrayArgs, _countof(DynamicIndexingVectorToArrayArgs));
   if (strcmp(passName, "float2int") == 0) return ArrayRef<LPCSTR>(Float2IntArgs, _countof(Float2IntArgs));
@@ -344,14 +393,18 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("RequiresDomTree")
     ||  S.equals("Runtime")
     ||  S.equals("ScalarLoadThreshold")
+    ||  S.equals("SelectDynamicIndexing")
     ||  S.equals("StructMemberThreshold")
     ||  S.equals("TIRA")
     ||  S.equals("TLIImpl")
     ||  S.equals("Threshold")
     ||  S.equals("UAVSize")
     ||  S.equals("add-pixel-cost")
+    ||  S.equals("allocated")
+    ||  S.equals("blockEntriesOnly")
     ||  S.equals("bonus-inst-threshold")
     ||  S.equals("checkForDynamicIndexing")
+    ||  S.equals("cold-percent")
     ||  S.equals("config")
     ||  S.equals("constant-alpha")
     ||  S.equals("constant-blue")
@@ -365,30 +418,37 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("float2int-max-integer-bw")
     ||  S.equals("force-early-z")
     ||  S.equals("force-ssa-updater")
+    ||  S.equals("fp-speed")
     ||  S.equals("jump-threading-threshold")
     ||  S.equals("likely-branch-weight")
     ||  S.equals("loop-distribute-non-if-convertible")
     ||  S.equals("loop-distribute-verify")
     ||  S.equals("loop-unswitch-threshold")
     ||  S.equals("lowerbitsets-avoid-reuse")
+    ||  S.equals("max-live-values")
     ||  S.equals("max-recurse-depth")
     ||  S.equals("max-reroll-increment")
+    ||  S.equals("max-switch-rows")
     ||  S.equals("maxElements")
     ||  S.equals("mergefunc-sanity")
     ||  S.equals("mod-mode")
     ||  S.equals("no-discriminators")
+    ||  S.equals("pad-for-banks")
     ||  S.equals("noloads")
     ||  S.equals("num-pixels")
     ||  S.equals("parameter0")
     ||  S.equals("parameter1")
     ||  S.equals("parameter2")
     ||  S.equals("pragma-unroll-threshold")
+    ||  S.equals("profile-file")
     ||  S.equals("reroll-num-tolerated-failed-matches")
     ||  S.equals("rewrite-map-file")
+    ||  S.equals("ringBuffer")
     ||  S.equals("rotation-max-header-size")
     ||  S.equals("rt-width")
     ||  S.equals("sample-profile-file")
     ||  S.equals("sample-profile-max-propagate-iterations")
+    ||  S.equals("sampleEveryN")
     ||  S.equals("sroa-random-shuffle-slices")
     ||  S.equals("sroa-strict-inbounds")
     ||  S.equals("sv-position-index")
@@ -396,12 +456,14 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("unroll-allow-partial")
     ||  S.equals("unroll-count")
     ||  S.equals("unroll-dynamic-cost-savings-discount")
+    ||  S.equals("unroll-instruction-budget")
     ||  S.equals("unroll-max-iteration-count-to-analyze")
     ||  S.equals("unroll-percent-dynamic-cost-saved-threshold")
     ||  S.equals("unroll-runtime")
     ||  S.equals("unroll-threshold")
     ||  S.equals("vector-library")
-    ||  S.equals("verify-debug-info");
+    ||  S.equals("verify-debug-info")
+    ||  S.equals("waveAggregate");
   // ISPASSOPTIONNAME:END
 }
 
@@ -480,184 +542,57 @@ public:
   }
 };
 
-class DxcOptimizer : public IDxcOptimizer {
-private:
-  DXC_MICROCOM_TM_REF_FIELDS()
-  PassRegistry *m_registry;
-  std::vector<const PassInfo *> m_passes;
-public:
-  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
-  DXC_MICROCOM_TM_CTOR(DxcOptimizer)
-
-  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcOptimizer>(this, iid, ppvObject);
-  }
-
-  HRESULT Initialize();
-  const PassInfo *getPassByID(llvm::AnalysisID PassID);
-  const PassInfo *getPassByName(const char *pName);
-  __override HRESULT STDMETHODCALLTYPE GetAvailablePassCount(_Out_ UINT32 *pCount) {
-    return AssignToOut<UINT32>(m_passes.size(), pCount);
-  }
-  __override HRESULT STDMETHODCALLTYPE GetAvailablePass(UINT32 index, _COM_Outptr_ IDxcOptimizerPass** ppResult);
-  __override HRESULT STDMETHODCALLTYPE RunOptimizer(IDxcBlob *pBlob,
-    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
-    _COM_Outptr_ IDxcBlob **ppOutputModule,
-    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText);
+// Passes and flags parsed from optimizer options. Pass instances hold state
+// for the module they run on, so a pipeline keeps the PassInfo of each pass
+// and constructs the passes again for every module.
+struct OptimizerPipelineStep {
+  const PassInfo *Info; // nullptr for a print-module step.
+  std::string Banner;   // Banner of a print-module step.
+  std::vector<std::pair<std::string, std::string>> Options; // Sorted by name.
+  bool FunctionPass;    // Runs in the per-function prepasses.
 };
 
-class CapturePassManager : public llvm::legacy::PassManagerBase {
-private:
-  SmallVector<Pass *, 64> Passes;
-public:
-  ~CapturePassManager() {
-    for (auto P : Passes) delete P;
-  }
-
-  __override void add(Pass *P) {
-    Passes.push_back(P);
-  }
-
-  size_t size() const { return Passes.size(); }
-  const char *getPassNameAt(size_t index) const {
-    return Passes[index]->getPassName();
-  }
-  llvm::AnalysisID getPassIDAt(size_t index) const {
-    return Passes[index]->getPassID();
-  }
+struct OptimizerPipeline {
+  std::vector<OptimizerPipelineStep> Steps;
+  bool OutputAssembly = false;
+  bool AnalyzeOnly = false;
+  bool AllocStats = false;
+  bool IRStats = false;
+  // The optimizer's callback when the pipeline was created.
+  CComPtr<IDxcCompilerEventsCallback> EventsCallback;
 };
 
-HRESULT DxcOptimizer::Initialize() {
-  try {
-    m_registry = PassRegistry::getPassRegistry();
-
-    struct PRL : public PassRegistrationListener {
-      std::vector<const PassInfo *> *Passes;
-      __override void passEnumerate(const PassInfo * PI) {
-        DXASSERT(nullptr != PI->getNormalCtor(), "else cannot construct");
-        Passes->push_back(PI);
-      }
-    };
-    PRL prl;
-    prl.Passes = &this->m_passes;
-    m_registry->enumerateWith(&prl);
-  }
-  CATCH_CPP_RETURN_HRESULT();
-  return S_OK;
-}
-
-const PassInfo *DxcOptimizer::getPassByID(llvm::AnalysisID PassID) {
-  return m_registry->getPassInfo(PassID);
-}
-
-const PassInfo *DxcOptimizer::getPassByName(const char *pName) {
-  return m_registry->getPassInfo(StringRef(pName));
-}
-
-HRESULT STDMETHODCALLTYPE DxcOptimizer::GetAvailablePass(
-    UINT32 index, _COM_Outptr_ IDxcOptimizerPass **ppResult) {
-  IFR(AssignToOut(nullptr, ppResult));
-  if (index >= m_passes.size())
-    return E_INVALIDARG;
-  return DxcOptimizerPass::Create(
-      m_pMalloc, m_passes[index]->getPassArgument(),
-      m_passes[index]->getPassName(),
-      GetPassArgNames(m_passes[index]->getPassArgument()),
-      GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
-}
-
-HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
-    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
-    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
-    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
-  AssignToOutOpt(nullptr, ppOutputModule);
-  AssignToOutOpt(nullptr, ppOutputText);
-  if (pBlob == nullptr)
-    return E_POINTER;
-  if (optionCount > 0 && ppOptions == nullptr)
-    return E_POINTER;
-
-  DxcThreadMalloc TM(m_pMalloc);
-
-  // Setup input buffer.
-  //
-  // The ir parsing requires the buffer to be null terminated. We deal with
-  // both source and bitcode input, so the input buffer may not be null
-  // terminated; we create a new membuf that copies and appends for this.
-  //
-  // If we have the beginning of a DXIL program header, skip to the bitcode.
-  //
-  LLVMContext Context;
-  SMDiagnostic Err;
-  std::unique_ptr<MemoryBuffer> memBuf;
-  std::unique_ptr<Module> M;
-  const char * pBlobContent = reinterpret_cast<const char *>(pBlob->GetBufferPointer());
-  unsigned blobSize = pBlob->GetBufferSize();
-  const DxilProgramHeader *pProgramHeader =
-    reinterpret_cast<const DxilProgramHeader *>(pBlobContent);
-  if (IsValidDxilProgramHeader(pProgramHeader, blobSize)) {
-    std::string DiagStr;
-    GetDxilProgramBitcode(pProgramHeader, &pBlobContent, &blobSize);
-    M = hlsl::dxilutil::LoadModuleFromBitcode(
-      llvm::StringRef(pBlobContent, blobSize), Context, DiagStr);
-  }
-  else {
-    StringRef bufStrRef(pBlobContent, blobSize);
-    memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
-    M = parseIR(memBuf->getMemBufferRef(), Err, Context);
-  }
-
-  if (M == nullptr) {
-    return DXC_E_IR_VERIFICATION_FAILED;
-  }
-
-  legacy::PassManager ModulePasses;
-  legacy::FunctionPassManager FunctionPasses(M.get());
-  legacy::PassManagerBase *pPassManager = &ModulePasses;
-
+static HRESULT ParseOptimizerPipeline(PassRegistry *registry,
+                                      _In_count_(optionCount) LPCWSTR *ppOptions,
+                                      UINT32 optionCount,
+                                      OptimizerPipeline &pipeline) {
   try {
-    CComPtr<AbstractMemoryStream> pOutputStream;
-    CComPtr<IDxcBlob> pOutputBlob;
-
-    IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
-    IFT(pOutputStream.QueryInterface(&pOutputBlob));
-
-    raw_stream_ostream outStream(pOutputStream.p);
-
-    //
-    // Consider some differences from opt.exe:
-    //
-    // Create a new optimization pass for each one specified on the command line
-    // as in StandardLinkOpts, OptLevelO1, etc.
-    // No target machine, and so no passes get their target machine ctor called.
-    // No print-after-each-pass option.
-    // No printing of the pass options.
-    // No StripDebug support.
-    // No verifyModule before starting.
-    // Use of PassPipeline for new manager.
-    // No TargetInfo.
-    // No DataLayout.
-    //
-    bool OutputAssembly = false;
-    bool AnalyzeOnly = false;
-
     // First gather flags, wherever they may be.
     SmallVector<UINT32, 2> handled;
     for (UINT32 i = 0; i < optionCount; ++i) {
       if (wcseq(L"-S", ppOptions[i])) {
-        OutputAssembly = true;
+        pipeline.OutputAssembly = true;
         handled.push_back(i);
         continue;
       }
       if (wcseq(L"-analyze", ppOptions[i])) {
-        AnalyzeOnly = true;
+        pipeline.AnalyzeOnly = true;
+        handled.push_back(i);
+        continue;
+      }
+      if (wcseq(L"-falloc-stats", ppOptions[i])) {
+        pipeline.AllocStats = true;
+        handled.push_back(i);
+        continue;
+      }
+      if (wcseq(L"-print-ir-stats", ppOptions[i])) {
+        pipeline.IRStats = true;
         handled.push_back(i);
         continue;
       }
     }
 
-    // TODO: should really use string_table for this once that's available
-    std::list<std::string> optionsAnsi;
+    bool FunctionPasses = false;
     SmallVector<PassOption, 2> options;
     for (UINT32 i = 0; i < optionCount; ++i) {
       if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
@@ -676,18 +611,23 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
           Banner += name8.m_psz;
           Banner += "\n";
         }
-        if (pPassManager == &ModulePasses)
-          pPassManager->add(llvm::createPrintModulePass(outStream, Banner));
+        if (!FunctionPasses) {
+          OptimizerPipelineStep step;
+          step.Info = nullptr;
+          step.Banner = std::move(Banner);
+          step.FunctionPass = false;
+          pipeline.Steps.push_back(std::move(step));
+        }
         continue;
       }
 
       // Handle special switches to toggle per-function prepasses vs. module passes.
       if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
-        pPassManager = &FunctionPasses;
+        FunctionPasses = true;
         continue;
       }
       if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
-        pPassManager = &ModulePasses;
+        FunctionPasses = false;
         continue;
       }
 
@@ -706,7 +646,7 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
         ++pCursor;
       }
       *pCursor = '\0';
-      const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
+      const llvm::PassInfo *PassInf = registry->getPassInfo(StringRef(pOptionNameStart));
       if (!PassInf) {
         return E_INVALIDARG;
       }
@@ -744,12 +684,168 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
       }
 
       DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
+      OptimizerPipelineStep step;
+      step.Info = PassInf;
+      step.FunctionPass = FunctionPasses;
+      // The options point into optName; keep copies.
+      for (const PassOption &option : options)
+        step.Options.emplace_back(option.first.str(), option.second.str());
+      options.clear();
+      pipeline.Steps.push_back(std::move(step));
+    }
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+// Flags and print steps write to the dxopt output, which a compilation
+// doesn't have, so a compilation pipeline only names passes.
+static bool IsCompilationPipeline(const OptimizerPipeline &pipeline) {
+  if (pipeline.OutputAssembly || pipeline.AnalyzeOnly || pipeline.AllocStats ||
+      pipeline.IRStats)
+    return false;
+  for (const OptimizerPipelineStep &step : pipeline.Steps) {
+    if (step.Info == nullptr)
+      return false;
+  }
+  return true;
+}
+
+bool hlsl::AddOptimizerPipelinePasses(const std::vector<std::string> &options,
+                                      legacy::FunctionPassManager &FPM,
+                                      legacy::PassManager &MPM,
+                                      std::string &invalidOption) {
+  std::vector<std::wstring> wideOptions;
+  for (const std::string &option : options)
+    wideOptions.push_back(Unicode::UTF8ToUTF16StringOrThrow(option.c_str()));
+  std::vector<LPCWSTR> pOptions;
+  for (const std::wstring &option : wideOptions)
+    pOptions.push_back(option.c_str());
+
+  PassRegistry *registry = PassRegistry::getPassRegistry();
+  OptimizerPipeline pipeline;
+  HRESULT hr = ParseOptimizerPipeline(registry, pOptions.data(),
+                                      (UINT32)pOptions.size(), pipeline);
+  if (FAILED(hr) || !IsCompilationPipeline(pipeline)) {
+    // Parse the options one at a time to find the one that was rejected.
+    for (size_t i = 0; i < pOptions.size(); ++i) {
+      OptimizerPipeline single;
+      if (FAILED(ParseOptimizerPipeline(registry, &pOptions[i], 1, single)) ||
+          !IsCompilationPipeline(single)) {
+        invalidOption = options[i];
+        return false;
+      }
+    }
+    invalidOption = options.front();
+    return false;
+  }
+
+  // Nothing is added unless every pass can be, so that a rejected pipeline
+  // leaves the pass managers as they were.
+  std::vector<std::unique_ptr<Pass>> passes;
+  SmallVector<PassOption, 2> passOptions;
+  for (const OptimizerPipelineStep &step : pipeline.Steps) {
+    for (const auto &option : step.Options)
+      passOptions.emplace_back(option.first, option.second);
+    passes.emplace_back(step.Info->getNormalCtor()());
+    passes.back()->applyOptions(passOptions);
+    passOptions.clear();
+    // The per-function pass manager can't schedule module passes.
+    if (step.FunctionPass && passes.back()->getPassKind() > PT_Function) {
+      invalidOption = "-";
+      invalidOption += step.Info->getPassArgument();
+      return false;
+    }
+  }
+  for (size_t i = 0; i < passes.size(); ++i) {
+    if (pipeline.Steps[i].FunctionPass)
+      FPM.add(passes[i].release());
+    else
+      MPM.add(passes[i].release());
+  }
+  return true;
+}
+
+static std::unique_ptr<Module> LoadOptimizerModule(IDxcBlob *pBlob,
+                                                  LLVMContext &Context) {
+  // Setup input buffer.
+  //
+  // The ir parsing requires the buffer to be null terminated. We deal with
+  // both source and bitcode input, so the input buffer may not be null
+  // terminated; we create a new membuf that copies and appends for this.
+  //
+  // If we have the beginning of a DXIL program header, skip to the bitcode.
+  //
+  SMDiagnostic Err;
+  std::unique_ptr<MemoryBuffer> memBuf;
+  std::unique_ptr<Module> M;
+  const char * pBlobContent = reinterpret_cast<const char *>(pBlob->GetBufferPointer());
+  unsigned blobSize = pBlob->GetBufferSize();
+  const DxilProgramHeader *pProgramHeader =
+    reinterpret_cast<const DxilProgramHeader *>(pBlobContent);
+  if (IsValidDxilProgramHeader(pProgramHeader, blobSize)) {
+    std::string DiagStr;
+    GetDxilProgramBitcode(pProgramHeader, &pBlobContent, &blobSize);
+    M = hlsl::dxilutil::LoadModuleFromBitcode(
+      llvm::StringRef(pBlobContent, blobSize), Context, DiagStr);
+  }
+  else {
+    StringRef bufStrRef(pBlobContent, blobSize);
+    memBuf = MemoryBuffer::getMemBufferCopy(bufStrRef);
+    M = parseIR(memBuf->getMemBufferRef(), Err, Context);
+  }
+  return M;
+}
+
+static HRESULT RunOptimizerPipelineOnModule(const OptimizerPipeline &pipeline,
+                                            IMalloc *pMalloc, Module *M,
+                                            _COM_Outptr_opt_ IDxcBlob **ppOutputModule,
+                                            _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  legacy::PassManager ModulePasses;
+  legacy::FunctionPassManager FunctionPasses(M);
+
+  try {
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    CComPtr<IDxcBlob> pOutputBlob;
+
+    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+    IFT(pOutputStream.QueryInterface(&pOutputBlob));
+
+    raw_stream_ostream outStream(pOutputStream.p);
+
+    //
+    // Consider some differences from opt.exe:
+    //
+    // Create a new optimization pass for each one specified on the command line
+    // as in StandardLinkOpts, OptLevelO1, etc.
+    // No target machine, and so no passes get their target machine ctor called.
+    // No print-after-each-pass option.
+    // No printing of the pass options.
+    // No StripDebug support.
+    // No verifyModule before starting.
+    // Use of PassPipeline for new manager.
+    // No TargetInfo.
+    // No DataLayout.
+    //
+    SmallVector<PassOption, 2> options;
+    for (const OptimizerPipelineStep &step : pipeline.Steps) {
+      legacy::PassManagerBase *pPassManager =
+          step.FunctionPass ? (legacy::PassManagerBase *)&FunctionPasses
+                            : &ModulePasses;
+      if (step.Info == nullptr) {
+        pPassManager->add(llvm::createPrintModulePass(outStream, step.Banner));
+        continue;
+      }
+
+      const llvm::PassInfo *PassInf = step.Info;
+      for (const auto &option : step.Options)
+        options.emplace_back(option.first, option.second);
       Pass *pass = PassInf->getNormalCtor()();
       pass->setOSOverride(&outStream);
       pass->applyOptions(options);
       options.clear();
       pPassManager->add(pass);
-      if (AnalyzeOnly) {
+      if (pipeline.AnalyzeOnly) {
         const bool Quiet = false;
         PassKind Kind = pass->getPassKind();
         switch (Kind) {
@@ -777,22 +873,42 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
 
     ModulePasses.add(createVerifierPass());
 
-    if (OutputAssembly) {
+    if (pipeline.OutputAssembly) {
       ModulePasses.add(llvm::createPrintModulePass(outStream));
     }
 
+    // With -print-ir-stats, the size of the module after each pass follows
+    // the rest of the output. An events callback is sent the passes as they
+    // run, in an "optimize" phase.
+    std::unique_ptr<TimeReport> pIRStats;
+    if (pipeline.IRStats || pipeline.EventsCallback)
+      pIRStats.reset(new TimeReport(DxcGetThreadMallocNoRef()));
+    if (pipeline.IRStats)
+      pIRStats->EnableIRStats();
+    TimeReportEventsListener eventsListener(pipeline.EventsCallback, nullptr);
+    if (pipeline.EventsCallback) {
+      pIRStats->EnableIRCounts();
+      pIRStats->SetListener(&eventsListener);
+    }
+
     // Now that we have all of the passes ready, run them.
     {
+      TimeReportScope irStatsScope(pIRStats.get());
+      DxcThreadMalloc TMIRStats(pIRStats ? pIRStats->GetMalloc()
+                                         : DxcGetThreadMallocNoRef());
+      TimeReportPhase optimizePhase("optimize");
       raw_ostream *err_ostream = &outStream;
       ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
 
       FunctionPasses.doInitialization();
-      for (Function &F : *M.get())
+      for (Function &F : *M)
         if (!F.isDeclaration())
           FunctionPasses.run(F);
       FunctionPasses.doFinalization();
-      ModulePasses.run(*M.get());
+      ModulePasses.run(*M);
     }
+    if (pIRStats)
+      pIRStats->WriteIRStats(outStream);
 
     outStream.flush();
     if (ppOutputText != nullptr) {
@@ -800,10 +916,10 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
     }
     if (ppOutputModule != nullptr) {
       CComPtr<AbstractMemoryStream> pProgramStream;
-      IFT(CreateMemoryStream(m_pMalloc, &pProgramStream));
+      IFT(CreateMemoryStream(pMalloc, &pProgramStream));
       {
         raw_stream_ostream outStream(pProgramStream.p);
-        WriteBitcodeToFile(M.get(), outStream, true);
+        WriteBitcodeToFile(M, outStream, true);
       }
       IFT(pProgramStream.QueryInterface(ppOutputModule));
     }
@@ -813,6 +929,387 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
   return S_OK;
 }
 
+static HRESULT RunOptimizerPipeline(const OptimizerPipeline &pipeline,
+                                    IMalloc *pMalloc, IDxcBlob *pBlob,
+                                    _COM_Outptr_opt_ IDxcBlob **ppOutputModule,
+                                    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = LoadOptimizerModule(pBlob, Context);
+  if (M == nullptr) {
+    return DXC_E_IR_VERIFICATION_FAILED;
+  }
+  return RunOptimizerPipelineOnModule(pipeline, pMalloc, M.get(),
+                                      ppOutputModule, ppOutputText);
+}
+
+// Adds up the time spent in the runs of one pass, for IDxcPassBenchmark.
+class PassBenchmarkTimer : public legacy::PassTimingListener {
+private:
+  const void *m_passID;
+  unsigned m_depth;
+  TimeRecord m_start;
+  double m_seconds;
+
+public:
+  PassBenchmarkTimer(const void *passID)
+      : m_passID(passID), m_depth(0), m_seconds(0) {}
+
+  double GetSeconds() const { return m_seconds; }
+
+  void passStarted(Pass *P, Module &M, Function *F) override {
+    if (P->getPassID() == m_passID && m_depth++ == 0)
+      m_start = TimeRecord::getCurrentTime(true);
+  }
+
+  void passEnded(Pass *P, Module &M, Function *F) override {
+    if (P->getPassID() != m_passID || --m_depth != 0)
+      return;
+    TimeRecord time = TimeRecord::getCurrentTime(false);
+    time -= m_start;
+    m_seconds += time.getWallTime();
+  }
+};
+
+class DxcOptimizerPipeline : public IDxcOptimizerPipeline,
+                             public IDxcPassBenchmark {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  OptimizerPipeline m_pipeline;
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcOptimizerPipeline)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcOptimizerPipeline, IDxcPassBenchmark>(
+        this, iid, ppvObject);
+  }
+
+  OptimizerPipeline &GetPipeline() { return m_pipeline; }
+
+  __override HRESULT STDMETHODCALLTYPE Run(IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+    AssignToOutOpt(nullptr, ppOutputModule);
+    AssignToOutOpt(nullptr, ppOutputText);
+    if (pBlob == nullptr)
+      return E_POINTER;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    return RunOptimizerPipeline(m_pipeline, m_pMalloc, pBlob, ppOutputModule,
+                                ppOutputText);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE RunBatch(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _Out_writes_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts);
+
+  __override HRESULT STDMETHODCALLTYPE RunOnModule(
+    _In_ IDxcModuleHandle *pModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+    AssignToOutOpt(nullptr, ppOutputText);
+    Module *M = GetDxcModuleHandleModule(pModule);
+    if (M == nullptr)
+      return E_INVALIDARG;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    return RunOptimizerPipelineOnModule(m_pipeline, m_pMalloc, M, nullptr,
+                                        ppOutputText);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE BenchmarkPass(
+    _In_ IDxcModuleHandle *pModule, _In_ LPCWSTR pPassName, UINT32 runCount,
+    _Out_writes_(runCount) double *pSeconds);
+};
+
+HRESULT STDMETHODCALLTYPE DxcOptimizerPipeline::BenchmarkPass(
+    _In_ IDxcModuleHandle *pModule, _In_ LPCWSTR pPassName, UINT32 runCount,
+    _Out_writes_(runCount) double *pSeconds) {
+  if (pPassName == nullptr || (runCount > 0 && pSeconds == nullptr))
+    return E_POINTER;
+  Module *M = GetDxcModuleHandleModule(pModule);
+  // -print-ir-stats takes over the pass timing listener of the thread.
+  if (M == nullptr || m_pipeline.IRStats)
+    return E_INVALIDARG;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    CW2A passName(pPassName, CP_UTF8);
+    const PassInfo *pInfo = nullptr;
+    for (const OptimizerPipelineStep &step : m_pipeline.Steps) {
+      if (step.Info != nullptr &&
+          StringRef(step.Info->getPassArgument()) == passName.m_psz) {
+        pInfo = step.Info;
+        break;
+      }
+    }
+    if (pInfo == nullptr)
+      return E_INVALIDARG;
+
+    for (UINT32 i = 0; i < runCount; ++i) {
+      std::unique_ptr<Module> pCopy(CloneModule(M));
+      PassBenchmarkTimer timer(pInfo->getTypeInfo());
+      legacy::PassTimingListener *pPriorListener =
+          legacy::setThreadPassTimingListener(&timer);
+      HRESULT hr = RunOptimizerPipelineOnModule(m_pipeline, m_pMalloc,
+                                                pCopy.get(), nullptr, nullptr);
+      legacy::setThreadPassTimingListener(pPriorListener);
+      IFR(hr);
+      pSeconds[i] = timer.GetSeconds();
+    }
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizerPipeline::RunBatch(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _Out_writes_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts) {
+  if (ppOutputModules == nullptr || (blobCount > 0 && ppBlobs == nullptr))
+    return E_INVALIDARG;
+  for (UINT32 i = 0; i < blobCount; ++i) {
+    if (ppBlobs[i] == nullptr)
+      return E_INVALIDARG;
+    ppOutputModules[i] = nullptr;
+    if (ppOutputTexts != nullptr)
+      ppOutputTexts[i] = nullptr;
+  }
+
+  DxcThreadMalloc TM(m_pMalloc);
+  HRESULT hr = S_OK;
+  try {
+    // Each module is loaded on the context of the thread that runs it.
+    if (threadCount == 0)
+      threadCount = std::thread::hardware_concurrency();
+    threadCount = std::max(1u, std::min<unsigned>(threadCount, blobCount));
+
+    std::vector<HRESULT> blobHRs(blobCount, S_OK);
+    std::atomic<UINT32> nextBlob(0);
+    IMalloc *pMalloc = m_pMalloc;
+    auto runBlobs = [&]() {
+      DxcThreadMalloc TM(pMalloc);
+      for (UINT32 i = nextBlob++; i < blobCount; i = nextBlob++) {
+        blobHRs[i] = RunOptimizerPipeline(
+            m_pipeline, pMalloc, ppBlobs[i], &ppOutputModules[i],
+            ppOutputTexts ? &ppOutputTexts[i] : nullptr);
+      }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (unsigned i = 1; i < threadCount; ++i)
+      threads.emplace_back(runBlobs);
+    runBlobs();
+    for (std::thread &t : threads)
+      t.join();
+
+    for (HRESULT blobHR : blobHRs)
+      IFT(blobHR);
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+  if (FAILED(hr)) {
+    for (UINT32 i = 0; i < blobCount; ++i) {
+      if (ppOutputModules[i]) {
+        ppOutputModules[i]->Release();
+        ppOutputModules[i] = nullptr;
+      }
+      if (ppOutputTexts != nullptr && ppOutputTexts[i]) {
+        ppOutputTexts[i]->Release();
+        ppOutputTexts[i] = nullptr;
+      }
+    }
+  }
+  return hr;
+}
+
+class DxcOptimizer : public IDxcOptimizer2, public IDxcAllocationStats,
+                     public IDxcCompilerEvents {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  PassRegistry *m_registry;
+  std::vector<const PassInfo *> m_passes;
+  // Statistics of the last RunOptimizer call with -falloc-stats.
+  bool m_hasAllocationStats;
+  DxcAllocationStats m_allocationStats;
+  CComPtr<IDxcCompilerEventsCallback> m_pEventsCallback;
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcOptimizer)
+  DxcOptimizer(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_hasAllocationStats(false) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcOptimizer2, IDxcOptimizer,
+                                 IDxcAllocationStats, IDxcCompilerEvents>(
+        this, iid, ppvObject);
+  }
+
+  HRESULT Initialize();
+  const PassInfo *getPassByID(llvm::AnalysisID PassID);
+  const PassInfo *getPassByName(const char *pName);
+  __override HRESULT STDMETHODCALLTYPE GetAvailablePassCount(_Out_ UINT32 *pCount) {
+    return AssignToOut<UINT32>(m_passes.size(), pCount);
+  }
+  __override HRESULT STDMETHODCALLTYPE GetAvailablePass(UINT32 index, _COM_Outptr_ IDxcOptimizerPass** ppResult);
+  __override HRESULT STDMETHODCALLTYPE RunOptimizer(IDxcBlob *pBlob,
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText);
+  __override HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline);
+  __override HRESULT STDMETHODCALLTYPE LoadModule(IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcModuleHandle **ppModule);
+
+  __override HRESULT STDMETHODCALLTYPE
+  GetAllocationStats(_Out_ DxcAllocationStats *pStats) {
+    if (pStats == nullptr)
+      return E_INVALIDARG;
+    if (!m_hasAllocationStats) {
+      memset(pStats, 0, sizeof(*pStats));
+      return S_FALSE;
+    }
+    *pStats = m_allocationStats;
+    return S_OK;
+  }
+
+  __override HRESULT STDMETHODCALLTYPE
+  SetEventsCallback(_In_opt_ IDxcCompilerEventsCallback *pCallback) {
+    m_pEventsCallback = pCallback;
+    return S_OK;
+  }
+};
+
+class CapturePassManager : public llvm::legacy::PassManagerBase {
+private:
+  SmallVector<Pass *, 64> Passes;
+public:
+  ~CapturePassManager() {
+    for (auto P : Passes) delete P;
+  }
+
+  __override void add(Pass *P) {
+    Passes.push_back(P);
+  }
+
+  size_t size() const { return Passes.size(); }
+  const char *getPassNameAt(size_t index) const {
+    return Passes[index]->getPassName();
+  }
+  llvm::AnalysisID getPassIDAt(size_t index) const {
+    return Passes[index]->getPassID();
+  }
+};
+
+HRESULT DxcOptimizer::Initialize() {
+  try {
+    m_registry = PassRegistry::getPassRegistry();
+
+    struct PRL : public PassRegistrationListener {
+      std::vector<const PassInfo *> *Passes;
+      __override void passEnumerate(const PassInfo * PI) {
+        DXASSERT(nullptr != PI->getNormalCtor(), "else cannot construct");
+        Passes->push_back(PI);
+      }
+    };
+    PRL prl;
+    prl.Passes = &this->m_passes;
+    m_registry->enumerateWith(&prl);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+const PassInfo *DxcOptimizer::getPassByID(llvm::AnalysisID PassID) {
+  return m_registry->getPassInfo(PassID);
+}
+
+const PassInfo *DxcOptimizer::getPassByName(const char *pName) {
+  return m_registry->getPassInfo(StringRef(pName));
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::GetAvailablePass(
+    UINT32 index, _COM_Outptr_ IDxcOptimizerPass **ppResult) {
+  IFR(AssignToOut(nullptr, ppResult));
+  if (index >= m_passes.size())
+    return E_INVALIDARG;
+  return DxcOptimizerPass::Create(
+      m_pMalloc, m_passes[index]->getPassArgument(),
+      m_passes[index]->getPassName(),
+      GetPassArgNames(m_passes[index]->getPassArgument()),
+      GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
+    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
+    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+
+  OptimizerPipeline pipeline;
+  IFR(ParseOptimizerPipeline(m_registry, ppOptions, optionCount, pipeline));
+  pipeline.EventsCallback = m_pEventsCallback;
+
+  // With -falloc-stats, allocations are counted on their way to the user
+  // allocator.
+  m_hasAllocationStats = false;
+  CComPtr<AllocationStatsMalloc> pStatsMalloc;
+  if (pipeline.AllocStats)
+    IFR(AllocationStatsMalloc::Create(m_pMalloc, &pStatsMalloc));
+  DxcThreadMalloc TMStats(pStatsMalloc ? pStatsMalloc.p : m_pMalloc.p);
+
+  IFR(RunOptimizerPipeline(pipeline, m_pMalloc, pBlob, ppOutputModule,
+                           ppOutputText));
+  if (pStatsMalloc) {
+    pStatsMalloc->GetStats(&m_allocationStats);
+    m_hasAllocationStats = true;
+  }
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) {
+  IFR(AssignToOut(nullptr, ppPipeline));
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  CComPtr<DxcOptimizerPipeline> result = DxcOptimizerPipeline::Alloc(m_pMalloc);
+  IFROOM(result.p);
+  IFR(ParseOptimizerPipeline(m_registry, ppOptions, optionCount,
+                             result->GetPipeline()));
+  result->GetPipeline().EventsCallback = m_pEventsCallback;
+  *ppPipeline = result.Detach();
+  return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::LoadModule(
+    IDxcBlob *pBlob, _COM_Outptr_ IDxcModuleHandle **ppModule) {
+  IFR(AssignToOut(nullptr, ppModule));
+  if (pBlob == nullptr)
+    return E_POINTER;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    std::unique_ptr<LLVMContext> pContext(new LLVMContext());
+    std::unique_ptr<Module> M = LoadOptimizerModule(pBlob, *pContext);
+    if (M == nullptr)
+      return DXC_E_IR_VERIFICATION_FAILED;
+    IFT(CreateDxcModuleHandle(m_pMalloc, std::move(pContext), std::move(M),
+                              ppModule));
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
 HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv) {
   CComPtr<DxcOptimizer> result = DxcOptimizer::Alloc(DxcGetThreadMallocNoRef());
   if (result == nullptr) {
@@ -0,0 +1,443 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxcTimeReport.cpp                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Collects compile time and peak memory per phase and pass (-ftime-report), //
+// and the size of the IR after each pass (-print-ir-stats).                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/HLSL/DxcTimeReport.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace hlsl {
+
+/// Forwards to another allocator, keeping track of the bytes that are live
+/// and of their high-water mark.
+class TimeReportMalloc : public IMalloc {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::atomic<uint64_t> m_liveBytes;
+  std::atomic<uint64_t> m_peakBytes;
+  std::atomic<uint64_t> m_maxPeakBytes;
+  std::atomic<uint64_t> m_allocatedBytes;
+
+  SIZE_T SizeOf(void *pv) {
+    if (pv == nullptr)
+      return 0;
+    SIZE_T size = m_pMalloc->GetSize(pv);
+    return size == (SIZE_T)-1 ? 0 : size;
+  }
+
+  static void Raise(std::atomic<uint64_t> &value, uint64_t minimum) {
+    uint64_t prior = value.load();
+    while (prior < minimum && !value.compare_exchange_weak(prior, minimum)) {
+    }
+  }
+
+  void Add(SIZE_T size) {
+    m_allocatedBytes.fetch_add(size);
+    uint64_t live = m_liveBytes.fetch_add(size) + size;
+    Raise(m_peakBytes, live);
+    Raise(m_maxPeakBytes, live);
+  }
+
+  void Remove(SIZE_T size) {
+    // Blocks allocated before tracking began may be freed through this
+    // allocator, so don't let the count wrap around.
+    uint64_t prior = m_liveBytes.load();
+    while (!m_liveBytes.compare_exchange_weak(
+        prior, prior > size ? prior - size : 0)) {
+    }
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(TimeReportMalloc)
+
+  TimeReportMalloc(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_liveBytes(0), m_peakBytes(0),
+        m_maxPeakBytes(0), m_allocatedBytes(0) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+
+  /// Starts a new high-water mark at the live byte count, returning the
+  /// previous mark.
+  uint64_t ResetPeak() { return m_peakBytes.exchange(m_liveBytes.load()); }
+  uint64_t GetPeak() { return m_peakBytes.load(); }
+  void RaisePeak(uint64_t value) { Raise(m_peakBytes, value); }
+  uint64_t GetMaxPeak() { return m_maxPeakBytes.load(); }
+  /// Returns the bytes allocated so far, whether freed or not.
+  uint64_t GetAllocated() { return m_allocatedBytes.load(); }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    void *result = m_pMalloc->Alloc(cb);
+    Add(SizeOf(result));
+    return result;
+  }
+
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    SIZE_T priorSize = SizeOf(pv);
+    void *result = m_pMalloc->Realloc(pv, cb);
+    if (result != nullptr || cb == 0) {
+      Remove(priorSize);
+      Add(SizeOf(result));
+    }
+    return result;
+  }
+
+  void STDMETHODCALLTYPE Free(void *pv) override {
+    Remove(SizeOf(pv));
+    m_pMalloc->Free(pv);
+  }
+
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override {
+    return m_pMalloc->GetSize(pv);
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override {
+    return m_pMalloc->DidAlloc(pv);
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize() override { m_pMalloc->HeapMinimize(); }
+};
+
+} // namespace hlsl
+
+static LLVM_THREAD_LOCAL TimeReport *g_pCurrentTimeReport;
+
+TimeReport::TimeReport(IMalloc *pMalloc)
+    : m_pMalloc(TimeReportMalloc::Alloc(pMalloc)), m_traceEnabled(false),
+      m_irStatsEnabled(false), m_irCountsEnabled(false), m_pIRModule(nullptr),
+      m_pListener(nullptr) {
+  IFTOOM(m_pMalloc);
+  m_pMalloc->AddRef();
+  m_start = TimeRecord::getCurrentTime(true);
+}
+
+TimeReport::~TimeReport() { m_pMalloc->Release(); }
+
+IMalloc *TimeReport::GetMalloc() { return m_pMalloc; }
+
+TimeReport *TimeReport::GetCurrent() { return g_pCurrentTimeReport; }
+
+void TimeReport::EnableTrace() { m_traceEnabled = true; }
+
+void TimeReport::EnableIRStats() {
+  m_irStatsEnabled = true;
+  m_irCountsEnabled = true;
+}
+
+void TimeReport::EnableIRCounts() { m_irCountsEnabled = true; }
+
+TimeReport::IRCounts TimeReport::CountIR(const Function &F) {
+  IRCounts counts;
+  counts.Functions = F.isDeclaration() ? 0 : 1;
+  counts.Blocks = F.size();
+  counts.Instructions = 0;
+  for (const BasicBlock &BB : F)
+    counts.Instructions += BB.size();
+  return counts;
+}
+
+TimeReport::IRCounts TimeReport::CountIR(const Module &M) {
+  IRCounts counts = {0, 0, 0};
+  for (const Function &F : M) {
+    IRCounts functionCounts = CountIR(F);
+    counts.Functions += functionCounts.Functions;
+    counts.Blocks += functionCounts.Blocks;
+    counts.Instructions += functionCounts.Instructions;
+  }
+  return counts;
+}
+
+void TimeReport::Begin(std::vector<ActiveEntry> &active, unsigned index,
+                       bool isPass) {
+  if (m_pListener)
+    m_pListener->entryStarted(
+        (isPass ? m_passes : m_phases)[index].Name.c_str(), isPass);
+  ActiveEntry entry;
+  entry.Index = index;
+  entry.OuterPeakBytes = m_pMalloc->ResetPeak();
+  entry.StartAllocatedBytes = m_pMalloc->GetAllocated();
+  entry.StartInstructions = 0;
+  entry.StartFunctionCounts = {0, 0, 0};
+  entry.Start = TimeRecord::getCurrentTime(true);
+  active.push_back(entry);
+}
+
+void TimeReport::End(std::vector<ActiveEntry> &active, bool isPass) {
+  DXASSERT_NOMSG(!active.empty());
+  TimeRecord time = TimeRecord::getCurrentTime(false);
+  ActiveEntry &activeEntry = active.back();
+  time -= activeEntry.Start;
+  Entry &entry = (isPass ? m_passes : m_phases)[activeEntry.Index];
+  if (m_traceEnabled) {
+    TraceEvent event;
+    event.Index = activeEntry.Index;
+    event.IsPass = isPass;
+    event.Start = activeEntry.Start.getWallTime() - m_start.getWallTime();
+    event.Duration = time.getWallTime();
+    m_trace.push_back(event);
+  }
+  entry.Time += time;
+  entry.Count++;
+  entry.PeakBytes = std::max(entry.PeakBytes, m_pMalloc->GetPeak());
+  // The enclosing phase or pass saw at least this peak too.
+  m_pMalloc->RaisePeak(activeEntry.OuterPeakBytes);
+  active.pop_back();
+  // passEnded tells the listener once the module is counted.
+  if (m_pListener && !isPass)
+    m_pListener->entryEnded(entry.Name.c_str(), isPass, nullptr);
+}
+
+void TimeReport::BeginPhase(StringRef name) {
+  int parent = m_activePhases.empty() ? -1 : (int)m_activePhases.back().Index;
+  unsigned index = 0;
+  while (index < m_phases.size() &&
+         (m_phases[index].Parent != parent || m_phases[index].Name != name))
+    ++index;
+  if (index == m_phases.size()) {
+    Entry entry;
+    entry.Name = name;
+    entry.Parent = parent;
+    entry.Count = 0;
+    entry.PeakBytes = 0;
+    m_phases.push_back(entry);
+  }
+  Begin(m_activePhases, index, /*isPass*/ false);
+}
+
+void TimeReport::EndPhase() { End(m_activePhases, /*isPass*/ false); }
+
+void TimeReport::passStarted(Pass *P, Module &M, Function *F) {
+  // Counting is done outside of the timed region of the pass. A pass that
+  // runs on the module and outside of any other pass starts from a new
+  // count, as code other than passes may have changed the module since.
+  IRCounts functionCounts = {0, 0, 0};
+  if (m_irCountsEnabled) {
+    if (m_pIRModule != &M || (F == nullptr && m_activePasses.empty())) {
+      m_irCounts = CountIR(M);
+      m_pIRModule = &M;
+    }
+    if (F)
+      functionCounts = CountIR(*F);
+  }
+
+  auto found = m_passIndex.find(P->getPassID());
+  unsigned index;
+  if (found == m_passIndex.end()) {
+    index = m_passes.size();
+    Entry entry;
+    entry.Name = P->getPassName();
+    entry.Parent =
+        m_activePhases.empty() ? -1 : (int)m_activePhases.back().Index;
+    entry.Count = 0;
+    entry.PeakBytes = 0;
+    m_passes.push_back(entry);
+    m_passIndex[P->getPassID()] = index;
+  } else {
+    index = found->second;
+  }
+  Begin(m_activePasses, index, /*isPass*/ true);
+  m_activePasses.back().StartInstructions = m_irCounts.Instructions;
+  m_activePasses.back().StartFunctionCounts = functionCounts;
+}
+
+void TimeReport::passEnded(Pass *P, Module &M, Function *F) {
+  DXASSERT_NOMSG(!m_activePasses.empty());
+  ActiveEntry active = m_activePasses.back();
+  End(m_activePasses, /*isPass*/ true);
+  const char *pName = m_passes[active.Index].Name.c_str();
+  if (!m_irCountsEnabled) {
+    if (m_pListener)
+      m_pListener->entryEnded(pName, /*isPass*/ true, nullptr);
+    return;
+  }
+
+  if (F) {
+    // Only F changed, so the module total moves by the change to F.
+    IRCounts counts = CountIR(*F);
+    m_irCounts.Functions += counts.Functions - active.StartFunctionCounts.Functions;
+    m_irCounts.Blocks += counts.Blocks - active.StartFunctionCounts.Blocks;
+    m_irCounts.Instructions +=
+        counts.Instructions - active.StartFunctionCounts.Instructions;
+  } else {
+    m_irCounts = CountIR(M);
+    m_pIRModule = &M;
+  }
+  if (m_pListener)
+    m_pListener->entryEnded(pName, /*isPass*/ true, &m_irCounts);
+  if (!m_irStatsEnabled)
+    return;
+
+  IRStatsRow row;
+  row.Index = active.Index;
+  row.AllocatedBytes = m_pMalloc->GetAllocated() - active.StartAllocatedBytes;
+  if (F)
+    row.Function = F->getName();
+  row.Counts = m_irCounts;
+  row.InstructionChange =
+      (int64_t)(m_irCounts.Instructions - active.StartInstructions);
+  m_irStats.push_back(std::move(row));
+}
+
+static void WriteJsonString(raw_ostream &OS, StringRef value) {
+  OS << '"';
+  for (char c : value) {
+    switch (c) {
+    case '"': OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\r': OS << "\\r"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if ((unsigned char)c < 0x20)
+        OS << format("\\u%04x", (unsigned)c);
+      else
+        OS << c;
+    }
+  }
+  OS << '"';
+}
+
+void TimeReport::WriteJson(raw_ostream &OS) {
+  auto writeEntries = [&](const char *name, const char *parentName,
+                          const std::vector<Entry> &entries) {
+    OS << "  \"" << name << "\": [";
+    for (size_t i = 0; i < entries.size(); ++i) {
+      const Entry &entry = entries[i];
+      OS << (i == 0 ? "\n" : ",\n") << "    { \"name\": ";
+      WriteJsonString(OS, entry.Name);
+      OS << ", \"" << parentName << "\": ";
+      if (entry.Parent < 0)
+        OS << "null";
+      else
+        WriteJsonString(OS, m_phases[entry.Parent].Name);
+      OS << ", \"count\": " << entry.Count
+         << format(", \"wall\": %.6f, \"user\": %.6f, \"system\": %.6f",
+                   entry.Time.getWallTime(), entry.Time.getUserTime(),
+                   entry.Time.getSystemTime())
+         << ", \"peak_bytes\": " << entry.PeakBytes << " }";
+    }
+    OS << (entries.empty() ? "]" : "\n  ]");
+  };
+
+  TimeRecord total = TimeRecord::getCurrentTime(false);
+  total -= m_start;
+
+  OS << "{\n";
+  OS << "  \"version\": 1,\n";
+  OS << format("  \"wall\": %.6f, \"user\": %.6f, \"system\": %.6f,\n",
+               total.getWallTime(), total.getUserTime(),
+               total.getSystemTime());
+  OS << "  \"peak_bytes\": " << m_pMalloc->GetMaxPeak() << ",\n";
+  writeEntries("phases", "parent", m_phases);
+  OS << ",\n";
+  writeEntries("passes", "phase", m_passes);
+  OS << "\n}\n";
+}
+
+void TimeReport::WriteIRStats(raw_ostream &OS) {
+  OS << format("; %10s %10s %12s %10s %14s  %s\n", "functions", "blocks",
+               "instructions", "change", "allocated", "pass (function)");
+  for (const IRStatsRow &row : m_irStats) {
+    OS << format("  %10llu %10llu %12llu %+10lld %14llu  ",
+                 (unsigned long long)row.Counts.Functions,
+                 (unsigned long long)row.Counts.Blocks,
+                 (unsigned long long)row.Counts.Instructions,
+                 (long long)row.InstructionChange,
+                 (unsigned long long)row.AllocatedBytes)
+       << m_passes[row.Index].Name;
+    if (!row.Function.empty())
+      OS << " (" << row.Function << ")";
+    OS << "\n";
+  }
+}
+
+void TimeReport::WriteTrace(raw_ostream &OS, StringRef shaderName,
+                            StringRef entryPoint) {
+  // Complete ("X") events on a single thread nest by their times; the
+  // viewers need no particular order.
+  std::string processName = shaderName.str();
+  if (!entryPoint.empty())
+    processName += " (" + entryPoint.str() + ")";
+  OS << "{\n";
+  OS << "  \"displayTimeUnit\": \"ms\",\n";
+  OS << "  \"otherData\": { \"shader\": ";
+  WriteJsonString(OS, shaderName);
+  OS << ", \"entry\": ";
+  WriteJsonString(OS, entryPoint);
+  OS << " },\n";
+  OS << "  \"traceEvents\": [\n";
+  OS << "    { \"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+        "\"tid\": 1, \"args\": { \"name\": ";
+  WriteJsonString(OS, processName);
+  OS << " } }";
+  for (const TraceEvent &event : m_trace) {
+    const Entry &entry = (event.IsPass ? m_passes : m_phases)[event.Index];
+    OS << ",\n    { \"name\": ";
+    WriteJsonString(OS, entry.Name);
+    OS << ", \"cat\": \"" << (event.IsPass ? "pass" : "phase") << "\""
+       << ", \"ph\": \"X\", \"pid\": 1, \"tid\": 1"
+       << format(", \"ts\": %.3f, \"dur\": %.3f }", event.Start * 1e6,
+                 event.Duration * 1e6);
+  }
+  OS << "\n  ]\n}\n";
+}
+
+void TimeReportEventsListener::entryStarted(const char *pName, bool isPass) {
+  if (isPass)
+    m_pCallback->OnPassBegin(pName);
+  else
+    m_pCallback->OnPhaseBegin(pName);
+  if (m_pNext)
+    m_pNext->entryStarted(pName, isPass);
+}
+
+void TimeReportEventsListener::entryEnded(const char *pName, bool isPass,
+                                          const TimeReportIRCounts *pCounts) {
+  if (isPass) {
+    DxcPassIRStats stats;
+    if (pCounts) {
+      stats.Functions = pCounts->Functions;
+      stats.Blocks = pCounts->Blocks;
+      stats.Instructions = pCounts->Instructions;
+    }
+    m_pCallback->OnPassEnd(pName, pCounts ? &stats : nullptr);
+  } else {
+    m_pCallback->OnPhaseEnd(pName);
+  }
+  if (m_pNext)
+    m_pNext->entryEnded(pName, isPass, pCounts);
+}
+
+TimeReportScope::TimeReportScope(TimeReport *pReport)
+    : m_pPrior(g_pCurrentTimeReport),
+      m_pPriorListener(llvm::legacy::setThreadPassTimingListener(pReport)) {
+  g_pCurrentTimeReport = pReport;
+}
+
+TimeReportScope::~TimeReportScope() {
+  g_pCurrentTimeReport = m_pPrior;
+  llvm::legacy::setThreadPassTimingListener(m_pPriorListener);
+}
@@ -0,0 +1,229 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilAutoFlatten.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Flattens small divergent branches that have no [branch] or [flatten].     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilMetadataHelper.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DivergenceAnalysis.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-auto-flatten"
+
+STATISTIC(NumBranchesFlattened, "Number of divergent branches flattened");
+
+namespace {
+
+// Two resource loads, or a few transcendentals, per branch.
+const unsigned kFlattenCostLimit = 8 * TargetTransformInfo::TCC_Expensive;
+
+// Lanes of a wave that disagree on a branch condition run both sides, one
+// after the other, with the rest of the wave masked off. For a divergent
+// branch, selecting between both sides costs little more than the sides
+// themselves and saves the mask updates and the jumps. A uniform branch
+// only runs one side, so it is kept, and so are sides costing more than
+// kFlattenCostLimit by DxilTTIImpl's cost model, which a coherent wave would
+// skip.
+//
+// SimplifyCFG already speculates sides of a couple of instructions whatever
+// the condition is; this picks up the divergent ones it leaves. Only if-then
+// and if-then-else shapes whose sides are one block each are flattened, and
+// only when the sides have no side effects, wave operations or implicit
+// derivatives, whose results depend on the lanes that run them. Each
+// decision is reported as an optimization remark.
+class DxilAutoFlatten : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilAutoFlatten() : FunctionPass(ID) {}
+
+  const char *getPassName() const override { return "DXIL Auto Flatten"; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addRequired<DivergenceAnalysis>();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool GetSideCost(BasicBlock *BB, BasicBlock *Head, BasicBlock *Merge,
+                   const TargetTransformInfo &TTI, unsigned &Cost);
+  void Flatten(BranchInst *BI, BasicBlock *Merge);
+  void Report(BranchInst *BI, const Twine &Msg);
+};
+
+}
+
+// Returns true if I computes the same result in any lane running it and can
+// run in lanes that wouldn't have.
+static bool IsSpeculatable(Instruction &I) {
+  if (!OP::IsDxilOpFuncCallInst(&I))
+    return isSafeToSpeculativelyExecute(&I);
+  CallInst *CI = cast<CallInst>(&I);
+  DXIL::OpCode Opcode = OP::GetDxilOpFuncCallInst(CI);
+  return CI->onlyReadsMemory() && !OP::IsDxilOpWave(Opcode) &&
+         !OP::IsDxilOpGradient(Opcode);
+}
+
+// Returns true if BB is a side of the branch in Head that only flows to
+// Merge, and sets Cost to the cost of running it unconditionally.
+bool DxilAutoFlatten::GetSideCost(BasicBlock *BB, BasicBlock *Head,
+                                  BasicBlock *Merge,
+                                  const TargetTransformInfo &TTI,
+                                  unsigned &Cost) {
+  BranchInst *BI = dyn_cast<BranchInst>(BB->getTerminator());
+  if (!BI || BI->isConditional() || BI->getSuccessor(0) != Merge ||
+      BB->getSinglePredecessor() != Head)
+    return false;
+  for (Instruction &I : *BB) {
+    if (&I == BI)
+      break;
+    if (isa<PHINode>(&I) || !IsSpeculatable(I))
+      return false;
+    Cost += TTI.getUserCost(&I);
+  }
+  return true;
+}
+
+void DxilAutoFlatten::Flatten(BranchInst *BI, BasicBlock *Merge) {
+  BasicBlock *Head = BI->getParent();
+  BasicBlock *Sides[2] = {BI->getSuccessor(0), BI->getSuccessor(1)};
+  for (BasicBlock *Side : Sides) {
+    if (Side != Merge)
+      Head->getInstList().splice(BI, Side->getInstList(), Side->begin(),
+                                 std::prev(Side->end()));
+  }
+
+  // Merge only has the two paths from Head, so each phi becomes a select.
+  BasicBlock *From[2] = {Sides[0] == Merge ? Head : Sides[0],
+                         Sides[1] == Merge ? Head : Sides[1]};
+  IRBuilder<> Builder(BI);
+  while (PHINode *Phi = dyn_cast<PHINode>(Merge->begin())) {
+    Value *Sel = Builder.CreateSelect(
+        BI->getCondition(), Phi->getIncomingValueForBlock(From[0]),
+        Phi->getIncomingValueForBlock(From[1]), Phi->getName());
+    Phi->replaceAllUsesWith(Sel);
+    Phi->eraseFromParent();
+  }
+
+  Builder.CreateBr(Merge);
+  BI->eraseFromParent();
+  for (BasicBlock *Side : Sides) {
+    if (Side != Merge)
+      Side->eraseFromParent();
+  }
+  MergeBlockIntoPredecessor(Merge);
+}
+
+void DxilAutoFlatten::Report(BranchInst *BI, const Twine &Msg) {
+  Function &F = *BI->getParent()->getParent();
+  emitOptimizationRemark(F.getContext(), DEBUG_TYPE, F, BI->getDebugLoc(),
+                         Msg + " in '" + F.getName() + "'");
+}
+
+bool DxilAutoFlatten::runOnFunction(Function &F) {
+  const TargetTransformInfo &TTI =
+      getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+  // Without the DXIL cost model every value would look uniform.
+  if (!TTI.hasBranchDivergence())
+    return false;
+  DivergenceAnalysis &DA = getAnalysis<DivergenceAnalysis>();
+
+  // Divergence is decided before the CFG changes. Flattening keeps the
+  // branch conditions, but the selects it adds are unknown to the analysis.
+  SmallPtrSet<BranchInst *, 16> Divergent;
+  for (BasicBlock &BB : F) {
+    BranchInst *BI = dyn_cast<BranchInst>(BB.getTerminator());
+    if (BI && BI->isConditional() && !DA.isUniform(BI))
+      Divergent.insert(BI);
+  }
+
+  // Sides are visited before their branch, so a nested branch that is
+  // flattened leaves a side of one block for the branch around it.
+  std::vector<BasicBlock *> Order(po_begin(&F.getEntryBlock()),
+                                  po_end(&F.getEntryBlock()));
+  SmallPtrSet<BasicBlock *, 16> Erased;
+  bool bChanged = false;
+  for (BasicBlock *BB : Order) {
+    if (Erased.count(BB))
+      continue;
+    BranchInst *BI = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!BI || !BI->isConditional() || isa<Constant>(BI->getCondition()) ||
+        BI->getMetadata(DxilMDHelper::kDxilControlFlowHintMDName))
+      continue;
+
+    BasicBlock *T = BI->getSuccessor(0), *E = BI->getSuccessor(1);
+    BasicBlock *Merge = nullptr;
+    if (T->getSingleSuccessor() == E)
+      Merge = E;
+    else if (E->getSingleSuccessor() == T)
+      Merge = T;
+    else if (T->getSingleSuccessor() == E->getSingleSuccessor())
+      Merge = T->getSingleSuccessor();
+    if (T == E || !Merge || Merge == BB ||
+        std::distance(pred_begin(Merge), pred_end(Merge)) != 2)
+      continue;
+
+    unsigned Cost = 0;
+    if ((T != Merge && !GetSideCost(T, BB, Merge, TTI, Cost)) ||
+        (E != Merge && !GetSideCost(E, BB, Merge, TTI, Cost)))
+      continue;
+    if (!Divergent.count(BI)) {
+      Report(BI, "kept branch with a condition uniform across the wave");
+      continue;
+    }
+    if (Cost > kFlattenCostLimit) {
+      Report(BI, Twine("kept divergent branch with sides costing ") +
+                     Twine(Cost) + ", over the limit of " +
+                     Twine(kFlattenCostLimit));
+      continue;
+    }
+
+    Report(BI, Twine("flattened divergent branch with sides costing ") +
+                   Twine(Cost));
+    Divergent.erase(BI);
+    Erased.insert(T);
+    Erased.insert(E);
+    Erased.insert(Merge);
+    Flatten(BI, Merge);
+    ++NumBranchesFlattened;
+    bChanged = true;
+  }
+  return bChanged;
+}
+
+char DxilAutoFlatten::ID = 0;
+
+FunctionPass *llvm::createDxilAutoFlattenPass() {
+  return new DxilAutoFlatten();
+}
+
+INITIALIZE_PASS_BEGIN(DxilAutoFlatten, "hlsl-dxil-auto-flatten",
+                      "DXIL Auto Flatten", false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DivergenceAnalysis)
+INITIALIZE_PASS_END(DxilAutoFlatten, "hlsl-dxil-auto-flatten",
+                    "DXIL Auto Flatten", false, false)
@@ -0,0 +1,241 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilBlockProfile.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a pass to count basic block executions of the entry function     //
+// into a UAV, and a pass to turn those counts back into control flow hints. //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilMetadataHelper.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilPIXPasses.h"
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include <unordered_map>
+
+using namespace llvm;
+using namespace hlsl;
+
+// Counters are numbered by the position of their block in the entry
+// function, and the number of blocks is used as the hash of a profile
+// record, so a profile only applies to the DXIL it was collected from.
+//
+// The profile is read with lib/ProfileData; the text format is
+//   <entry function name>
+//   <number of blocks>
+//   <number of blocks>
+//   <count of block 0>
+//   ...
+
+namespace {
+
+class DxilAddBlockCounters : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilAddBlockCounters() : ModulePass(ID) {}
+  const char *getPassName() const override {
+    return "DXIL Add basic block counters";
+  }
+  bool runOnModule(Module &M) override;
+};
+
+bool DxilAddBlockCounters::runOnModule(Module &M) {
+  DxilModule &DM = M.GetOrCreateDxilModule();
+  LLVMContext &Ctx = M.getContext();
+  OP *HlslOP = DM.GetOP();
+
+  Function *EntryPointFunction = DM.GetEntryFunction();
+  if (EntryPointFunction == nullptr || EntryPointFunction->isDeclaration())
+    return false;
+
+  IRBuilder<> Builder(EntryPointFunction->getEntryBlock().getFirstInsertionPt());
+
+  unsigned int UAVResourceHandle =
+      static_cast<unsigned int>(DM.GetUAVs().size());
+
+  // Set up a UAV with structure of a single int
+  SmallVector<llvm::Type *, 1> Elements{Type::getInt32Ty(Ctx)};
+  llvm::StructType *UAVStructTy =
+      llvm::StructType::create(Elements, "class.RWStructuredBuffer");
+  std::unique_ptr<DxilResource> pUAV = llvm::make_unique<DxilResource>();
+  pUAV->SetGlobalName("PIX_BlockCountUAVName");
+  pUAV->SetGlobalSymbol(UndefValue::get(UAVStructTy->getPointerTo()));
+  pUAV->SetID(UAVResourceHandle);
+  pUAV->SetSpaceID((unsigned int)-2); // This is the reserved-for-tools register space
+  pUAV->SetSampleCount(1);
+  pUAV->SetGloballyCoherent(false);
+  pUAV->SetHasCounter(false);
+  pUAV->SetCompType(CompType::getI32());
+  pUAV->SetLowerBound(0);
+  pUAV->SetRangeSize(1);
+  pUAV->SetKind(DXIL::ResourceKind::RawBuffer);
+  pUAV->SetRW(true);
+
+  auto pAnnotation = DM.GetTypeSystem().GetStructAnnotation(UAVStructTy);
+  if (pAnnotation == nullptr) {
+    pAnnotation = DM.GetTypeSystem().AddStructAnnotation(UAVStructTy);
+    pAnnotation->GetFieldAnnotation(0).SetCBufferOffset(0);
+    pAnnotation->GetFieldAnnotation(0).SetCompType(hlsl::DXIL::ComponentType::I32);
+    pAnnotation->GetFieldAnnotation(0).SetFieldName("count");
+  }
+
+  unsigned ID = DM.AddUAV(std::move(pUAV));
+  assert(ID == UAVResourceHandle);
+
+  // Create handle for the newly-added UAV
+  Function *CreateHandleOpFunc =
+      HlslOP->GetOpFunc(DXIL::OpCode::CreateHandle, Type::getVoidTy(Ctx));
+  Constant *CreateHandleOpcodeArg =
+      HlslOP->GetU32Const((unsigned)DXIL::OpCode::CreateHandle);
+  Constant *UAVArg = HlslOP->GetI8Const(
+      static_cast<std::underlying_type<DxilResourceBase::Class>::type>(
+          DXIL::ResourceClass::UAV));
+  Constant *MetaDataArg = HlslOP->GetU32Const(ID);
+  Constant *IndexArg = HlslOP->GetU32Const(0);
+  Constant *FalseArg = HlslOP->GetI1Const(0); // non-uniform resource index: false
+  CallInst *HandleForUAV = Builder.CreateCall(
+      CreateHandleOpFunc,
+      {CreateHandleOpcodeArg, UAVArg, MetaDataArg, IndexArg, FalseArg},
+      "PIX_BlockCountUAV_Handle");
+
+  DM.ReEmitDxilResources();
+
+  Function *AtomicOpFunc =
+      HlslOP->GetOpFunc(OP::OpCode::AtomicBinOp, Type::getInt32Ty(Ctx));
+  Constant *AtomicBinOpcode =
+      HlslOP->GetU32Const((unsigned)OP::OpCode::AtomicBinOp);
+  Constant *AtomicAdd =
+      HlslOP->GetU32Const((unsigned)DXIL::AtomicBinOpCode::Add);
+  Constant *One32Arg = HlslOP->GetU32Const(1);
+  UndefValue *UndefArg = UndefValue::get(Type::getInt32Ty(Ctx));
+
+  unsigned BlockIndex = 0;
+  for (BasicBlock &BB : *EntryPointFunction) {
+    // The handle is created at the top of the entry block, count after it.
+    Instruction *InsertPt = BlockIndex == 0 ? HandleForUAV->getNextNode()
+                                            : &*BB.getFirstInsertionPt();
+    IRBuilder<> CountBuilder(InsertPt);
+    (void)CountBuilder.CreateCall(AtomicOpFunc, {
+      AtomicBinOpcode,                       // i32, ; opcode
+      HandleForUAV,                          // %dx.types.Handle, ; resource handle
+      AtomicAdd,                             // i32, ; binary operation code
+      HlslOP->GetU32Const(BlockIndex * 4),   // i32, ; coordinate c0: byte offset
+      UndefArg,                              // i32, ; coordinate c1 (unused)
+      UndefArg,                              // i32, ; coordinate c2 (unused)
+      One32Arg                               // i32); increment value
+    }, "BlockCountResult");
+    ++BlockIndex;
+  }
+
+  return true;
+}
+
+class DxilApplyBlockProfile : public ModulePass {
+  std::string ProfileFile;
+  int ColdPercent = 10;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilApplyBlockProfile() : ModulePass(ID) {}
+  const char *getPassName() const override {
+    return "DXIL Apply basic block profile";
+  }
+  void applyOptions(PassOptions O) override;
+  bool runOnModule(Module &M) override;
+};
+
+void DxilApplyBlockProfile::applyOptions(PassOptions O) {
+  StringRef File;
+  if (GetPassOption(O, "profile-file", &File))
+    ProfileFile = File;
+  GetPassOptionInt(O, "cold-percent", &ColdPercent, 10);
+}
+
+bool DxilApplyBlockProfile::runOnModule(Module &M) {
+  DxilModule &DM = M.GetOrCreateDxilModule();
+  LLVMContext &Ctx = M.getContext();
+
+  Function *EntryPointFunction = DM.GetEntryFunction();
+  if (EntryPointFunction == nullptr || EntryPointFunction->isDeclaration())
+    return false;
+
+  auto ReaderOrErr = InstrProfReader::create(ProfileFile);
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    Ctx.emitError("Could not read profile '" + ProfileFile +
+                  "': " + EC.message());
+    return false;
+  }
+
+  uint64_t NumBlocks = EntryPointFunction->size();
+  std::vector<uint64_t> Counts;
+  for (const InstrProfRecord &Record : *ReaderOrErr.get()) {
+    if (Record.Name == EntryPointFunction->getName() &&
+        Record.Hash == NumBlocks && Record.Counts.size() == NumBlocks) {
+      Counts = Record.Counts;
+      break;
+    }
+  }
+  if (Counts.empty())
+    return false;
+
+  std::unordered_map<BasicBlock *, uint64_t> BlockCounts;
+  unsigned BlockIndex = 0;
+  for (BasicBlock &BB : *EntryPointFunction)
+    BlockCounts[&BB] = Counts[BlockIndex++];
+
+  unsigned HintKind = Ctx.getMDKindID(DxilMDHelper::kDxilControlFlowHintMDName);
+  bool Changed = false;
+  for (BasicBlock &BB : *EntryPointFunction) {
+    BranchInst *BI = dyn_cast<BranchInst>(BB.getTerminator());
+    if (!BI || !BI->isConditional() || BI->getMetadata(HintKind))
+      continue;
+    uint64_t Count = BlockCounts[&BB];
+    if (Count == 0)
+      continue;
+    // A successor count is only the count of the edge when the successor
+    // has no other predecessor.
+    BasicBlock *TrueBB = BI->getSuccessor(0);
+    BasicBlock *FalseBB = BI->getSuccessor(1);
+    if (!TrueBB->getSinglePredecessor() || !FalseBB->getSinglePredecessor())
+      continue;
+    // Skipping a rarely taken side is worth a real branch; when both sides
+    // are hot, flattening avoids the cost of divergence.
+    uint64_t Cold = std::min(BlockCounts[TrueBB], BlockCounts[FalseBB]);
+    std::vector<DXIL::ControlFlowHint> Hints;
+    if (Cold * 100 <= Count * (uint64_t)ColdPercent)
+      Hints.emplace_back(DXIL::ControlFlowHint::Branch);
+    else
+      Hints.emplace_back(DXIL::ControlFlowHint::Flatten);
+    BI->setMetadata(HintKind, DxilMDHelper::EmitControlFlowHints(Ctx, Hints));
+    Changed = true;
+  }
+
+  return Changed;
+}
+
+} // namespace
+
+char DxilAddBlockCounters::ID = 0;
+
+ModulePass *llvm::createDxilAddBlockCountersPass() {
+  return new DxilAddBlockCounters();
+}
+
+INITIALIZE_PASS(DxilAddBlockCounters, "hlsl-dxil-add-block-counters", "DXIL Count basic block executions", false, false)
+
+char DxilApplyBlockProfile::ID = 0;
+
+ModulePass *llvm::createDxilApplyBlockProfilePass() {
+  return new DxilApplyBlockProfile();
+}
+
+INITIALIZE_PASS(DxilApplyBlockProfile, "hlsl-dxil-apply-block-profile", "DXIL Apply basic block profile as control flow hints", false, false)
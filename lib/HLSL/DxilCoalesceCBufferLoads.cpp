@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCoalesceCBufferLoads.cpp                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Merges cbufferLoadLegacy calls that read the same row of the same handle. //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-coalesce-cbuffer-loads"
+
+STATISTIC(NumCBufferLoadsMerged, "Number of cbufferLoadLegacy calls merged");
+
+namespace {
+
+// Legacy cbuffer loads only depend on their handle and row, and nothing in
+// a shader writes a cbuffer, so every load of a row can share one call.
+// The shared call is the first load in the nearest common dominator of the
+// loads, or a new call at the end of that block when no load is in it.
+class DxilCoalesceCBufferLoads : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCoalesceCBufferLoads() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Coalesce CBuffer Loads";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  typedef SmallVector<CallInst *, 4> LoadList;
+  bool CoalesceLoads(LoadList &Loads, DominatorTree &DT);
+};
+
+}
+
+static bool IsAvailableAt(Value *V, Instruction *I, DominatorTree &DT) {
+  Instruction *Def = dyn_cast<Instruction>(V);
+  return Def == nullptr || DT.dominates(Def, I);
+}
+
+bool DxilCoalesceCBufferLoads::CoalesceLoads(LoadList &Loads,
+                                             DominatorTree &DT) {
+  BasicBlock *CommonBB = Loads.front()->getParent();
+  for (CallInst *CI : Loads)
+    CommonBB = DT.findNearestCommonDominator(CommonBB, CI->getParent());
+
+  // Loads are collected in instruction order, so the first load found in
+  // the common dominator comes before any other load in it.
+  CallInst *Leader = nullptr;
+  for (CallInst *CI : Loads) {
+    if (CI->getParent() == CommonBB) {
+      Leader = CI;
+      break;
+    }
+  }
+
+  if (Leader == nullptr) {
+    Instruction *InsertPt = CommonBB->getTerminator();
+    CallInst *First = Loads.front();
+    DxilInst_CBufferLoadLegacy CBLoad(First);
+    if (!IsAvailableAt(CBLoad.get_handle(), InsertPt, DT) ||
+        !IsAvailableAt(CBLoad.get_regIndex(), InsertPt, DT)) {
+      // The row isn't known at the common dominator; merge only loads that
+      // dominate one another.
+      bool bChanged = false;
+      for (unsigned i = 1; i < Loads.size(); ++i) {
+        for (unsigned j = 0; j < i; ++j) {
+          if (Loads[j] && DT.dominates(Loads[j], Loads[i])) {
+            Loads[i]->replaceAllUsesWith(Loads[j]);
+            Loads[i]->eraseFromParent();
+            Loads[i] = nullptr;
+            ++NumCBufferLoadsMerged;
+            bChanged = true;
+            break;
+          }
+        }
+      }
+      return bChanged;
+    }
+    Leader = cast<CallInst>(First->clone());
+    Leader->insertBefore(InsertPt);
+  }
+
+  for (CallInst *CI : Loads) {
+    if (CI == Leader)
+      continue;
+    CI->replaceAllUsesWith(Leader);
+    CI->eraseFromParent();
+    ++NumCBufferLoadsMerged;
+  }
+  return true;
+}
+
+bool DxilCoalesceCBufferLoads::runOnFunction(Function &F) {
+  DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+
+  MapVector<std::pair<Value *, Value *>, LoadList> LoadsByRow;
+  for (inst_iterator It = inst_begin(F), E = inst_end(F); It != E; ++It) {
+    Instruction *I = &*It;
+    if (!OP::IsDxilOpFuncCallInst(I, OP::OpCode::CBufferLoadLegacy))
+      continue;
+    DxilInst_CBufferLoadLegacy CBLoad(I);
+    LoadsByRow[std::make_pair(CBLoad.get_handle(), CBLoad.get_regIndex())]
+        .push_back(cast<CallInst>(I));
+  }
+
+  bool bChanged = false;
+  for (auto &It : LoadsByRow) {
+    if (It.second.size() > 1)
+      bChanged |= CoalesceLoads(It.second, DT);
+  }
+  return bChanged;
+}
+
+char DxilCoalesceCBufferLoads::ID = 0;
+
+FunctionPass *llvm::createDxilCoalesceCBufferLoadsPass() {
+  return new DxilCoalesceCBufferLoads();
+}
+
+INITIALIZE_PASS_BEGIN(DxilCoalesceCBufferLoads,
+                      "hlsl-dxil-coalesce-cbuffer-loads",
+                      "DXIL Coalesce CBuffer Loads", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_END(DxilCoalesceCBufferLoads,
+                    "hlsl-dxil-coalesce-cbuffer-loads",
+                    "DXIL Coalesce CBuffer Loads", false, false)
@@ -0,0 +1,295 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCombineBufferAccesses.cpp                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Combines structured buffer loads and stores of adjacent components.       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-combine-buffer-accesses"
+
+STATISTIC(NumBufferLoadsCombined, "Number of buffer loads combined");
+STATISTIC(NumBufferStoresCombined, "Number of buffer stores combined");
+
+namespace {
+
+// Lowering a structured buffer element access emits one load or store per
+// field, each at its own element offset. Within a block, a load whose
+// components fall in the four components read by an earlier load of the
+// same element is replaced by that load, and stores of adjacent components
+// are fused into one store with the combined mask.
+//
+// The operands shared by bufferLoad and rawBufferLoad, and by bufferStore
+// and rawBufferStore, have the same indices.
+class DxilCombineBufferAccesses : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCombineBufferAccesses() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Combine Buffer Accesses";
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool CombineInBlock(BasicBlock &BB);
+  bool TryCombineLoad(CallInst *Prior, CallInst *CI);
+  CallInst *TryCombineStore(CallInst *Prior, CallInst *CI);
+};
+
+enum class AccessKind { None, Load, RawLoad, Store, RawStore };
+
+static const unsigned kHandleOpIdx = DXIL::OperandIndex::kBufferLoadHandleOpIdx;
+static const unsigned kIndexOpIdx = DXIL::OperandIndex::kBufferLoadCoord0OpIdx;
+static const unsigned kOffsetOpIdx = DXIL::OperandIndex::kBufferLoadCoord1OpIdx;
+static const unsigned kStoreVal0OpIdx = DXIL::OperandIndex::kBufferStoreVal0OpIdx;
+static const unsigned kStoreMaskOpIdx = DXIL::OperandIndex::kBufferStoreMaskOpIdx;
+
+}
+
+static AccessKind GetAccessKind(Instruction *I) {
+  if (!isa<CallInst>(I) || !OP::IsDxilOpFuncCallInst(I))
+    return AccessKind::None;
+  switch (OP::GetDxilOpFuncCallInst(I)) {
+  case OP::OpCode::BufferLoad:
+    return AccessKind::Load;
+  case OP::OpCode::RawBufferLoad:
+    return AccessKind::RawLoad;
+  case OP::OpCode::BufferStore:
+    return AccessKind::Store;
+  case OP::OpCode::RawBufferStore:
+    return AccessKind::RawStore;
+  default:
+    return AccessKind::None;
+  }
+}
+
+// Returns the distance in components from Prior's element offset to CI's,
+// or -1 if the two don't access the same element of the same buffer.
+static int GetComponentDistance(CallInst *Prior, CallInst *CI, Type *CompTy) {
+  if (Prior->getCalledFunction() != CI->getCalledFunction() ||
+      Prior->getArgOperand(kHandleOpIdx) != CI->getArgOperand(kHandleOpIdx) ||
+      Prior->getArgOperand(kIndexOpIdx) != CI->getArgOperand(kIndexOpIdx))
+    return -1;
+  ConstantInt *PriorOffset =
+      dyn_cast<ConstantInt>(Prior->getArgOperand(kOffsetOpIdx));
+  ConstantInt *Offset = dyn_cast<ConstantInt>(CI->getArgOperand(kOffsetOpIdx));
+  if (!PriorOffset || !Offset)
+    return -1;
+  unsigned CompSize = CompTy->getPrimitiveSizeInBits() / 8;
+  if (CompSize == 0)
+    return -1;
+  int64_t Bytes = Offset->getSExtValue() - PriorOffset->getSExtValue();
+  if (Bytes < 0 || Bytes % CompSize != 0 || Bytes / CompSize >= 4)
+    return -1;
+  return (int)(Bytes / CompSize);
+}
+
+static unsigned GetConstMask(CallInst *CI, unsigned OpIdx) {
+  return cast<ConstantInt>(CI->getArgOperand(OpIdx))->getLimitedValue();
+}
+
+static bool IsContiguousMask(unsigned Mask) {
+  unsigned Shifted = Mask >> countTrailingZeros(Mask);
+  return Mask != 0 && (Shifted & (Shifted + 1)) == 0;
+}
+
+bool DxilCombineBufferAccesses::TryCombineLoad(CallInst *Prior, CallInst *CI) {
+  Type *CompTy = CI->getType()->getStructElementType(0);
+  int Distance = GetComponentDistance(Prior, CI, CompTy);
+  if (Distance <= 0)
+    return false;
+
+  // Only component reads can be redirected; the status can't be shared.
+  SmallVector<ExtractValueInst *, 4> Reads;
+  unsigned UsedMask = 0;
+  for (User *U : CI->users()) {
+    ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(U);
+    if (!EVI || EVI->getNumIndices() != 1 || EVI->getIndices()[0] >= 4)
+      return false;
+    Reads.push_back(EVI);
+    UsedMask |= 1 << EVI->getIndices()[0];
+  }
+  if (UsedMask == 0 || (UsedMask << Distance) > 0xf)
+    return false;
+
+  AccessKind Kind = GetAccessKind(CI);
+  if (Kind == AccessKind::RawLoad) {
+    const unsigned MaskOpIdx = DxilInst_RawBufferLoad::arg_mask;
+    if (!isa<ConstantInt>(Prior->getArgOperand(MaskOpIdx)) ||
+        !isa<ConstantInt>(CI->getArgOperand(MaskOpIdx)))
+      return false;
+    unsigned PriorMask = GetConstMask(Prior, MaskOpIdx);
+    unsigned Mask = PriorMask | (GetConstMask(CI, MaskOpIdx) << Distance);
+    if (Mask > 0xf)
+      return false;
+    // Fill the gap between the components so the mask stays contiguous.
+    unsigned Low = countTrailingZeros(Mask);
+    unsigned High = 31 - countLeadingZeros(Mask);
+    Mask = ((1u << (High + 1)) - 1) & ~((1u << Low) - 1);
+    if (Mask != PriorMask) {
+      // A wider read would change what the prior load's status reports.
+      for (User *U : Prior->users()) {
+        ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(U);
+        if (!EVI || EVI->getIndices()[0] >= 4)
+          return false;
+      }
+      Type *MaskTy = Prior->getArgOperand(MaskOpIdx)->getType();
+      Prior->setArgOperand(MaskOpIdx, ConstantInt::get(MaskTy, Mask));
+    }
+  }
+
+  for (ExtractValueInst *EVI : Reads) {
+    IRBuilder<> Builder(EVI);
+    Value *Comp =
+        Builder.CreateExtractValue(Prior, EVI->getIndices()[0] + Distance);
+    EVI->replaceAllUsesWith(Comp);
+    EVI->eraseFromParent();
+  }
+  CI->eraseFromParent();
+  ++NumBufferLoadsCombined;
+  return true;
+}
+
+CallInst *DxilCombineBufferAccesses::TryCombineStore(CallInst *Prior,
+                                                     CallInst *CI) {
+  Type *CompTy = CI->getArgOperand(kStoreVal0OpIdx)->getType();
+  CallInst *Low = Prior, *High = CI;
+  int Distance = GetComponentDistance(Low, High, CompTy);
+  if (Distance < 0) {
+    std::swap(Low, High);
+    Distance = GetComponentDistance(Low, High, CompTy);
+  }
+  if (Distance <= 0)
+    return nullptr;
+  if (!isa<ConstantInt>(Low->getArgOperand(kStoreMaskOpIdx)) ||
+      !isa<ConstantInt>(High->getArgOperand(kStoreMaskOpIdx)))
+    return nullptr;
+
+  unsigned LowMask = GetConstMask(Low, kStoreMaskOpIdx);
+  unsigned HighMask = GetConstMask(High, kStoreMaskOpIdx) << Distance;
+  unsigned Mask = LowMask | HighMask;
+  if (Mask > 0xf || (LowMask & HighMask) != 0 || !IsContiguousMask(Mask))
+    return nullptr;
+
+  // The fused store takes CI's place; Prior's operands are defined before it.
+  SmallVector<Value *, 10> Args(CI->arg_operands().begin(),
+                                CI->arg_operands().end());
+  Args[kOffsetOpIdx] = Low->getArgOperand(kOffsetOpIdx);
+  for (unsigned i = 0; i < 4; ++i) {
+    Value *Val = UndefValue::get(CompTy);
+    if (LowMask & (1 << i))
+      Val = Low->getArgOperand(kStoreVal0OpIdx + i);
+    else if (HighMask & (1 << i))
+      Val = High->getArgOperand(kStoreVal0OpIdx + i - Distance);
+    Args[kStoreVal0OpIdx + i] = Val;
+  }
+  Args[kStoreMaskOpIdx] =
+      ConstantInt::get(CI->getArgOperand(kStoreMaskOpIdx)->getType(), Mask);
+  if (GetAccessKind(CI) == AccessKind::RawStore) {
+    const unsigned AlignOpIdx = DxilInst_RawBufferStore::arg_alignment;
+    Args[AlignOpIdx] = Low->getArgOperand(AlignOpIdx);
+  }
+
+  IRBuilder<> Builder(CI);
+  CallInst *Fused = Builder.CreateCall(CI->getCalledFunction(), Args);
+  Prior->eraseFromParent();
+  CI->eraseFromParent();
+  ++NumBufferStoresCombined;
+  return Fused;
+}
+
+bool DxilCombineBufferAccesses::CombineInBlock(BasicBlock &BB) {
+  // Combining erases the later load and its component reads, so walk a
+  // list of the memory accesses instead of the block itself.
+  SmallVector<Instruction *, 16> Accesses;
+  for (Instruction &I : BB) {
+    if (I.mayReadOrWriteMemory())
+      Accesses.push_back(&I);
+  }
+
+  bool bChanged = false;
+  // Loads with no write since, and stores with no other access since.
+  SmallVector<CallInst *, 8> Loads;
+  SmallVector<CallInst *, 8> Stores;
+  for (Instruction *I : Accesses) {
+    switch (GetAccessKind(I)) {
+    case AccessKind::Load:
+    case AccessKind::RawLoad: {
+      CallInst *CI = cast<CallInst>(I);
+      Stores.clear();
+      bool bCombined = false;
+      for (CallInst *Prior : Loads) {
+        if (TryCombineLoad(Prior, CI)) {
+          bCombined = true;
+          break;
+        }
+      }
+      if (bCombined)
+        bChanged = true;
+      else
+        Loads.push_back(CI);
+      break;
+    }
+    case AccessKind::Store:
+    case AccessKind::RawStore: {
+      CallInst *CI = cast<CallInst>(I);
+      Loads.clear();
+      CallInst *Fused = nullptr;
+      for (CallInst *&Prior : Stores) {
+        Fused = TryCombineStore(Prior, CI);
+        if (Fused) {
+          Prior = Fused;
+          break;
+        }
+      }
+      if (Fused)
+        bChanged = true;
+      else
+        Stores.push_back(CI);
+      break;
+    }
+    case AccessKind::None:
+      if (I->mayWriteToMemory())
+        Loads.clear();
+      Stores.clear();
+      break;
+    }
+  }
+  return bChanged;
+}
+
+bool DxilCombineBufferAccesses::runOnFunction(Function &F) {
+  bool bChanged = false;
+  for (BasicBlock &BB : F)
+    bChanged |= CombineInBlock(BB);
+  return bChanged;
+}
+
+char DxilCombineBufferAccesses::ID = 0;
+
+FunctionPass *llvm::createDxilCombineBufferAccessesPass() {
+  return new DxilCombineBufferAccesses();
+}
+
+INITIALIZE_PASS(DxilCombineBufferAccesses, "hlsl-dxil-combine-buffer-accesses",
+                "DXIL Combine Buffer Accesses", false, false)
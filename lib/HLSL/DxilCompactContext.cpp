@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompactContext.cpp                                                    //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Frees the uniqued constants that nothing in the context uses any more.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-compact-context"
+
+STATISTIC(NumConstantsDropped, "Number of unused constants destroyed");
+
+namespace {
+
+// Constants are owned by the LLVMContext and live until it's destroyed,
+// even after the instructions using them are gone. SROA, matrix lowering
+// and scalarization leave many GEP expressions, aggregates and vectors no
+// one refers to, which add up on long library compiles. This destroys them
+// between the high-level and DXIL passes and again before the module is
+// written.
+//
+// Only constants with no uses, not even from metadata, are destroyed. The
+// DxilModule and the passes only hold on to integers, undef values and
+// globals, which are kept. Types can't be freed, as the context allocates
+// them for its lifetime.
+class DxilCompactContext : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCompactContext() : ModulePass(ID) {}
+
+  const char *getPassName() const override { return "DXIL Compact Context"; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+
+  bool runOnModule(Module &M) override {
+    NumConstantsDropped += M.dropTriviallyDeadConstants();
+    // Unused constants aren't part of the module.
+    return false;
+  }
+};
+
+} // namespace
+
+char DxilCompactContext::ID = 0;
+
+ModulePass *llvm::createDxilCompactContextPass() {
+  return new DxilCompactContext();
+}
+
+INITIALIZE_PASS(DxilCompactContext, "hlsl-dxil-compact-context",
+                "DXIL Compact Context", false, false)
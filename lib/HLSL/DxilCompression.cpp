@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompression.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the LZ4 block format used for compressed container parts.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilCompression.h"
+#include <string.h>
+
+namespace {
+// Limits of the LZ4 block format: matches are at least 4 bytes, the last 5
+// bytes are always literals, and the last match starts at least 12 bytes
+// before the end of the block.
+const size_t Lz4MinMatch = 4;
+const size_t Lz4LastLiterals = 5;
+const size_t Lz4MatchFindLimit = 12;
+const size_t Lz4MaxOffset = 0xFFFF;
+const unsigned Lz4HashLog = 16;
+
+uint32_t ReadUInt32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t HashSequence(uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32 - Lz4HashLog);
+}
+
+void WriteLength(std::vector<uint8_t> &Out, size_t Length) {
+  while (Length >= 255) {
+    Out.push_back(255);
+    Length -= 255;
+  }
+  Out.push_back((uint8_t)Length);
+}
+
+// Writes the literals and, unless it is the last sequence, the match.
+void WriteSequence(std::vector<uint8_t> &Out, const uint8_t *pLiterals,
+                   size_t LiteralLength, size_t Offset, size_t MatchLength,
+                   bool IsLast) {
+  size_t matchCode = IsLast ? 0 : MatchLength - Lz4MinMatch;
+  uint8_t token = (uint8_t)(((LiteralLength < 15 ? LiteralLength : 15) << 4) |
+                            (matchCode < 15 ? matchCode : 15));
+  Out.push_back(token);
+  if (LiteralLength >= 15)
+    WriteLength(Out, LiteralLength - 15);
+  Out.insert(Out.end(), pLiterals, pLiterals + LiteralLength);
+  if (IsLast)
+    return;
+  Out.push_back((uint8_t)(Offset & 0xFF));
+  Out.push_back((uint8_t)(Offset >> 8));
+  if (matchCode >= 15)
+    WriteLength(Out, matchCode - 15);
+}
+
+bool ReadLength(const uint8_t *&ip, const uint8_t *ipEnd, size_t &Length) {
+  uint8_t b;
+  do {
+    if (ip == ipEnd)
+      return false;
+    b = *ip++;
+    Length += b;
+  } while (b == 255);
+  return true;
+}
+} // namespace
+
+namespace hlsl {
+
+void Lz4CompressBlock(const void *pSrc, size_t SrcSize,
+                      std::vector<uint8_t> &Out) {
+  const uint8_t *src = reinterpret_cast<const uint8_t *>(pSrc);
+  size_t anchor = 0;
+  if (SrcSize >= Lz4MatchFindLimit) {
+    // Last position seen for each hashed 4-byte sequence. Candidates are
+    // compared before use, so stale and initial entries are harmless.
+    std::vector<uint32_t> table(1 << Lz4HashLog, 0);
+    const size_t matchLimit = SrcSize - Lz4LastLiterals;
+    const size_t lastMatchStart = SrcSize - Lz4MatchFindLimit;
+    size_t pos = 0;
+    while (pos <= lastMatchStart) {
+      uint32_t sequence = ReadUInt32(src + pos);
+      uint32_t &entry = table[HashSequence(sequence)];
+      size_t candidate = entry;
+      entry = (uint32_t)pos;
+      if (candidate >= pos || pos - candidate > Lz4MaxOffset ||
+          ReadUInt32(src + candidate) != sequence) {
+        ++pos;
+        continue;
+      }
+      size_t length = Lz4MinMatch;
+      while (pos + length < matchLimit &&
+             src[candidate + length] == src[pos + length])
+        ++length;
+      WriteSequence(Out, src + anchor, pos - anchor, pos - candidate, length,
+                    /*IsLast*/ false);
+      pos += length;
+      anchor = pos;
+    }
+  }
+  WriteSequence(Out, src + anchor, SrcSize - anchor, 0, 0, /*IsLast*/ true);
+}
+
+bool Lz4DecompressBlock(const void *pSrc, size_t SrcSize, void *pDst,
+                        size_t DstSize) {
+  const uint8_t *ip = reinterpret_cast<const uint8_t *>(pSrc);
+  const uint8_t *ipEnd = ip + SrcSize;
+  uint8_t *dst = reinterpret_cast<uint8_t *>(pDst);
+  uint8_t *op = dst;
+  uint8_t *opEnd = dst + DstSize;
+  while (ip != ipEnd) {
+    uint8_t token = *ip++;
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !ReadLength(ip, ipEnd, literalLength))
+      return false;
+    if ((size_t)(ipEnd - ip) < literalLength ||
+        (size_t)(opEnd - op) < literalLength)
+      return false;
+    memcpy(op, ip, literalLength);
+    ip += literalLength;
+    op += literalLength;
+    // The last sequence has no match.
+    if (ip == ipEnd)
+      break;
+
+    if (ipEnd - ip < 2)
+      return false;
+    size_t offset = ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst))
+      return false;
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !ReadLength(ip, ipEnd, matchLength))
+      return false;
+    matchLength += Lz4MinMatch;
+    if ((size_t)(opEnd - op) < matchLength)
+      return false;
+    // Matches may overlap the bytes they produce, so copy forward by byte.
+    const uint8_t *match = op - offset;
+    for (size_t i = 0; i < matchLength; ++i)
+      op[i] = match[i];
+    op += matchLength;
+  }
+  return op == opEnd;
+}
+
+} // namespace hlsl
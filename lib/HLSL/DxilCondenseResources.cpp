@@ -24,24 +24,25 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Pass.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include <algorithm>
+#include <climits>
 #include <memory>
 #include <unordered_set>
 
 using namespace llvm;
 using namespace hlsl;
 
+#define DEBUG_TYPE "dxil-condense"
+
+STATISTIC(NumTrimmedRanges, "Number of resource arrays trimmed to the indices used");
+STATISTIC(NumTrimmedDescriptors, "Number of descriptors removed by trimming resource arrays");
+
 struct ResourceID {
   DXIL::ResourceClass Class;  // Resource class.
   unsigned ID;                // Resource ID, as specified on entry.
-
-  bool operator<(const ResourceID& other) const {
-    if (Class < other.Class) return true;
-    if (Class > other.Class) return false;
-    if (ID < other.ID) return true;
-    return false;
-  }
 };
 
 struct RemapEntry {
@@ -50,23 +51,33 @@ struct RemapEntry {
   unsigned Index;             // Index in resource vector - new ID for the resource.
 };
 
-typedef std::map<ResourceID, RemapEntry> RemapEntryCollection;
+// Ordered by resource class, then by index.
+typedef std::vector<RemapEntry> RemapEntryCollection;
 
 class DxilCondenseResources : public ModulePass {
 private:
   RemapEntryCollection m_rewrites;
+  // The module is final DXIL, whose resources are allocated and whose
+  // handles already include the lower bounds; only unused resources are
+  // removed and the rest renumbered.
+  bool m_bAllocated;
 
 public:
   static char ID; // Pass identification, replacement for typeid
-  explicit DxilCondenseResources() : ModulePass(ID) {}
+  explicit DxilCondenseResources(bool Allocated = false)
+      : ModulePass(ID), m_bAllocated(Allocated) {}
 
   const char *getPassName() const override { return "DXIL Condense Resources"; }
 
+  void applyOptions(PassOptions O) override {
+    GetPassOptionBool(O, "allocated", &m_bAllocated, false);
+  }
+
   bool runOnModule(Module &M) override {
     DxilModule &DM = M.GetOrCreateDxilModule();
 
     // Switch tbuffers to SRVs, as they have been treated as cbuffers up to this point.
-    if (DM.GetCBuffers().size())
+    if (DM.GetCBuffers().size() && !m_bAllocated)
       PatchTBuffers(DM);
 
     // Remove unused resource.
@@ -78,11 +89,16 @@ public:
       ApplyRewriteMap(DM);
     }
 
+    if (m_bAllocated)
+      return true;
+
     bool hasResource = DM.GetCBuffers().size() ||
         DM.GetUAVs().size() || DM.GetSRVs().size() || DM.GetSamplers().size();
 
     if (hasResource) {
       if (!DM.GetShaderModel()->IsLib()) {
+        if (DM.GetTrimResourceRanges())
+          TrimResourceRanges(DM);
         AllocateDxilResources(DM);
         PatchCreateHandle(DM);
       } else {
@@ -97,11 +113,13 @@ public:
 
   DxilResourceBase &GetFirstRewrite() const {
     DXASSERT_NOMSG(!m_rewrites.empty());
-    return *m_rewrites.begin()->second.Resource;
+    return *m_rewrites.front().Resource;
   }
 
 private:
   void ApplyRewriteMap(DxilModule &DM);
+  // Shrink resource arrays indexed only by constants to the indices used.
+  void TrimResourceRanges(DxilModule &DM);
   void AllocateDxilResources(DxilModule &DM);
   // Add lowbound to create handle range index.
   void PatchCreateHandle(DxilModule &DM);
@@ -112,36 +130,103 @@ private:
 };
 
 void DxilCondenseResources::ApplyRewriteMap(DxilModule &DM) {
-  for (Function &F : DM.GetModule()->functions()) {
-    if (F.isDeclaration()) {
+  // IDs on entry are bounded by the number of resources originally declared,
+  // so the new ID for each class is found by indexing a dense vector.
+  std::vector<unsigned> newIDs[(unsigned)DXIL::ResourceClass::Invalid];
+  for (const RemapEntry &entry : m_rewrites) {
+    std::vector<unsigned> &classIDs = newIDs[(unsigned)entry.ResID.Class];
+    if (classIDs.size() <= entry.ResID.ID)
+      classIDs.resize(entry.ResID.ID + 1, UINT_MAX);
+    classIDs[entry.ResID.ID] = entry.Index;
+  }
+
+  // Only createHandle calls refer to resource IDs.
+  for (Function *F : DM.GetOP()->GetOpFuncList(DXIL::OpCode::CreateHandle)) {
+    if (F == nullptr)
       continue;
+    for (User *U : F->users()) {
+      DxilInst_CreateHandle CH(cast<Instruction>(U));
+      if (!CH)
+        continue;
+
+      unsigned resClass = CH.get_resourceClass_val();
+      ConstantInt *rangeID = dyn_cast<ConstantInt>(CH.get_rangeId());
+      if (resClass >= (unsigned)DXIL::ResourceClass::Invalid || !rangeID)
+        continue;
+      const std::vector<unsigned> &classIDs = newIDs[resClass];
+      uint64_t oldID = rangeID->getZExtValue();
+      if (oldID >= classIDs.size() || classIDs[oldID] == UINT_MAX)
+        continue;
+
+      Value *newRangeID = DM.GetOP()->GetU32Const(classIDs[oldID]);
+      cast<CallInst>(U)->setArgOperand(
+          DXIL::OperandIndex::kCreateHandleResIDOpIdx, newRangeID);
     }
+  }
+
+  for (RemapEntry &entry : m_rewrites) {
+    entry.Resource->SetID(entry.Index);
+  }
+}
+
+template <typename TResource>
+static void TrimRanges(const std::vector<std::unique_ptr<TResource>> &Rs,
+                       const std::vector<unsigned> &usedSizes) {
+  for (const std::unique_ptr<TResource> &R : Rs) {
+    unsigned rangeSize = R->GetRangeSize();
+    if (rangeSize == 1 || R->IsUnbounded() || R->GetID() >= usedSizes.size())
+      continue;
+    unsigned usedSize = usedSizes[R->GetID()];
+    if (usedSize == 0 || usedSize >= rangeSize)
+      continue;
+    R->SetRangeSize(usedSize);
+    ++NumTrimmedRanges;
+    NumTrimmedDescriptors += rangeSize - usedSize;
+  }
+}
 
-    for (inst_iterator iter = inst_begin(F), E = inst_end(F); iter != E; ++iter) {
-      llvm::Instruction &I = *iter;
-      DxilInst_CreateHandle CH(&I);
+void DxilCondenseResources::TrimResourceRanges(DxilModule &DM) {
+  // Highest index used plus one, per resource class and ID; UINT_MAX when an
+  // index isn't constant. Handle indices are still relative to the range
+  // here; PatchCreateHandle adds the lower bound later.
+  std::vector<unsigned> usedSizes[(unsigned)DXIL::ResourceClass::Invalid];
+  bool dynamicRangeID[(unsigned)DXIL::ResourceClass::Invalid] = {};
+  for (Function *F : DM.GetOP()->GetOpFuncList(DXIL::OpCode::CreateHandle)) {
+    if (F == nullptr)
+      continue;
+    for (User *U : F->users()) {
+      DxilInst_CreateHandle CH(cast<Instruction>(U));
       if (!CH)
         continue;
 
-      ResourceID RId;
-      RId.Class = (DXIL::ResourceClass)CH.get_resourceClass_val();
-      RId.ID = (unsigned)llvm::dyn_cast<llvm::ConstantInt>(CH.get_rangeId())
-                   ->getZExtValue();
-      RemapEntryCollection::iterator it = m_rewrites.find(RId);
-      if (it == m_rewrites.end()) {
+      unsigned resClass = CH.get_resourceClass_val();
+      if (resClass >= (unsigned)DXIL::ResourceClass::Invalid)
+        continue;
+      ConstantInt *rangeID = dyn_cast<ConstantInt>(CH.get_rangeId());
+      if (!rangeID) {
+        dynamicRangeID[resClass] = true;
         continue;
       }
-
-      CallInst *CI = cast<CallInst>(&I);
-      Value *newRangeID = DM.GetOP()->GetU32Const(it->second.Index);
-      CI->setArgOperand(DXIL::OperandIndex::kCreateHandleResIDOpIdx,
-                        newRangeID);
+      std::vector<unsigned> &classSizes = usedSizes[resClass];
+      uint64_t ID = rangeID->getZExtValue();
+      if (classSizes.size() <= ID)
+        classSizes.resize(ID + 1, 0);
+      unsigned size = UINT_MAX;
+      if (ConstantInt *index = dyn_cast<ConstantInt>(CH.get_index()))
+        size = (unsigned)std::min<uint64_t>(index->getZExtValue() + 1, UINT_MAX);
+      classSizes[ID] = std::max(classSizes[ID], size);
     }
   }
 
-  for (auto &entry : m_rewrites) {
-    entry.second.Resource->SetID(entry.second.Index);
-  }
+  // A cbuffer range of one is declared with a struct rather than an array,
+  // so cbuffer arrays keep their size.
+  if (!dynamicRangeID[(unsigned)DXIL::ResourceClass::SRV])
+    TrimRanges(DM.GetSRVs(), usedSizes[(unsigned)DXIL::ResourceClass::SRV]);
+  if (!dynamicRangeID[(unsigned)DXIL::ResourceClass::UAV])
+    TrimRanges(DM.GetUAVs(), usedSizes[(unsigned)DXIL::ResourceClass::UAV]);
+  if (!dynamicRangeID[(unsigned)DXIL::ResourceClass::Sampler])
+    TrimRanges(DM.GetSamplers(),
+               usedSizes[(unsigned)DXIL::ResourceClass::Sampler]);
 }
 
 template <typename TResource>
@@ -153,15 +238,16 @@ static void BuildRewrites(const std::vector<std::unique_ptr<TResource>> &Rs,
     if (R->GetID() != i) {
       ResourceID RId = {R->GetClass(), R->GetID()};
       RemapEntry RE = {RId, R.get(), i};
-      C[RId] = RE;
+      C.push_back(RE);
     }
   }
 }
 
 bool DxilCondenseResources::BuildRewriteMap(DxilModule &DM) {
-  BuildRewrites(DM.GetCBuffers(), m_rewrites);
+  // In ResourceClass order.
   BuildRewrites(DM.GetSRVs(), m_rewrites);
   BuildRewrites(DM.GetUAVs(), m_rewrites);
+  BuildRewrites(DM.GetCBuffers(), m_rewrites);
   BuildRewrites(DM.GetSamplers(), m_rewrites);
 
   return !m_rewrites.empty();
@@ -565,8 +651,8 @@ bool llvm::AreDxilResourcesDense(llvm::Module *M, hlsl::DxilResourceBase **ppNon
   }
 }
 
-ModulePass *llvm::createDxilCondenseResourcesPass() {
-  return new DxilCondenseResources();
+ModulePass *llvm::createDxilCondenseResourcesPass(bool Allocated) {
+  return new DxilCondenseResources(Allocated);
 }
 
 INITIALIZE_PASS(DxilCondenseResources, "hlsl-dxil-condense", "DXIL Condense Resources", false, false)
@@ -10,6 +10,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxilCompression.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/MD5.h"
 #include <algorithm>
 
 namespace hlsl {
@@ -40,6 +43,20 @@ const DxilContainerHeader *IsDxilContainerLike(const void *ptr, size_t length) {
   return reinterpret_cast<const DxilContainerHeader *>(ptr);
 }
 
+void ComputeDxilShaderHash(const DxilContainerHeader *pHeader,
+                           DxilShaderHash *pHash) {
+  llvm::MD5 md5;
+  for (DxilPartIterator it = begin(pHeader), itEnd = end(pHeader); it != itEnd; ++it) {
+    const DxilPartHeader *pPart = *it;
+    if (!IsDxilShaderHashedPart(pPart->PartFourCC))
+      continue;
+    md5.update(llvm::ArrayRef<uint8_t>((const uint8_t *)pPart,
+                                       sizeof(DxilPartHeader) + pPart->PartSize));
+  }
+  pHash->Flags = 0;
+  md5.final(pHash->Digest);
+}
+
 bool IsValidDxilContainer(const DxilContainerHeader *pHeader, size_t length) {
   // Validate that the header is where it's supposed to be.
   if (pHeader == nullptr) return false;
@@ -122,4 +139,178 @@ DxilProgramHeader *GetDxilProgramHeader(DxilContainerHeader *pHeader, DxilFourCC
       GetDxilProgramHeader(static_cast<const DxilContainerHeader *>(pHeader), fourCC));
 }
 
+bool DecompressDxilDebugInfoPart(const DxilPartHeader *pPart,
+                                 std::vector<char> &Storage) {
+  if (pPart->PartFourCC != DFCC_ShaderDebugInfoCompressed ||
+      pPart->PartSize < sizeof(DxilCompressedPartHeader))
+    return false;
+  const DxilCompressedPartHeader *pCompressed =
+      reinterpret_cast<const DxilCompressedPartHeader *>(GetDxilPartData(pPart));
+  if (pCompressed->Algorithm != (uint32_t)DxilCompressionAlgorithm::Lz4 ||
+      pCompressed->CompressedSize >
+          pPart->PartSize - sizeof(DxilCompressedPartHeader) ||
+      pCompressed->UncompressedSize > DxilContainerMaxSize)
+    return false;
+  Storage.resize(sizeof(DxilPartHeader) + pCompressed->UncompressedSize);
+  DxilPartHeader *pDecompressed = reinterpret_cast<DxilPartHeader *>(Storage.data());
+  pDecompressed->PartFourCC = DFCC_ShaderDebugInfoDXIL;
+  pDecompressed->PartSize = pCompressed->UncompressedSize;
+  return Lz4DecompressBlock(pCompressed + 1, pCompressed->CompressedSize,
+                            GetDxilPartData(pDecompressed),
+                            pCompressed->UncompressedSize);
+}
+
+const DxilPartHeader *GetDxilDebugInfoPart(const DxilContainerHeader *pHeader,
+                                           std::vector<char> &Storage) {
+  if (const DxilPartHeader *pPart =
+          GetDxilPartByType(pHeader, DFCC_ShaderDebugInfoDXIL))
+    return pPart;
+  const DxilPartHeader *pPart =
+      GetDxilPartByType(pHeader, DFCC_ShaderDebugInfoCompressed);
+  if (pPart == nullptr || !DecompressDxilDebugInfoPart(pPart, Storage))
+    return nullptr;
+  return reinterpret_cast<const DxilPartHeader *>(Storage.data());
+}
+
+void GetDxilContainerShaderHash(const DxilContainerHeader *pHeader,
+                                DxilShaderHash *pHash) {
+  const DxilPartHeader *pPart = GetDxilPartByType(pHeader, DFCC_ShaderHash);
+  if (pPart && pPart->PartSize >= sizeof(DxilShaderHash)) {
+    memcpy(pHash, GetDxilPartData(pPart), sizeof(DxilShaderHash));
+    return;
+  }
+  ComputeDxilShaderHash(pHeader, pHash);
+}
+
+static uint64_t AlignShaderPackOffset(uint64_t offset) {
+  return (offset + DxilShaderPackAlignment - 1) &
+         ~(uint64_t)(DxilShaderPackAlignment - 1);
+}
+
+static uint64_t GetShaderPackIndexSize(uint32_t entryCount) {
+  return AlignShaderPackOffset(sizeof(DxilShaderPackHeader) +
+                               (uint64_t)sizeof(DxilShaderPackEntry) * entryCount);
+}
+
+static bool ShaderPackEntryLess(const DxilShaderPackEntry &a,
+                                const DxilShaderPackEntry &b) {
+  return memcmp(a.Digest, b.Digest, DxilContainerHashSize) < 0;
+}
+
+bool IsValidDxilShaderPack(const DxilShaderPackHeader *pHeader, size_t length) {
+  if (pHeader == nullptr) return false;
+  if (length < sizeof(DxilShaderPackHeader)) return false;
+
+  // Validate the header values.
+  if (pHeader->HeaderFourCC != DFCC_ShaderPack) return false;
+  if (pHeader->Version.Major != DxilShaderPackVersionMajor) return false;
+  if (pHeader->PackSizeInBytes > length) return false;
+  uint64_t indexSize = GetShaderPackIndexSize(pHeader->EntryCount);
+  if (indexSize > pHeader->PackSizeInBytes) return false;
+
+  // Each container should be aligned, fit and be valid in itself, and the
+  // entries should be sorted for lookups.
+  for (uint32_t i = 0; i < pHeader->EntryCount; ++i) {
+    const DxilShaderPackEntry *pEntry = GetDxilShaderPackEntry(pHeader, i);
+    if (pEntry->Offset % DxilShaderPackAlignment != 0) return false;
+    if (pEntry->Offset < indexSize) return false;
+    if (pEntry->Offset > pHeader->PackSizeInBytes ||
+        pEntry->Size > pHeader->PackSizeInBytes - pEntry->Offset)
+      return false;
+    const DxilContainerHeader *pContainer = GetDxilShaderPackContainer(pHeader, i);
+    if (!IsValidDxilContainer(pContainer, pEntry->Size)) return false;
+    if (pContainer->ContainerSizeInBytes != pEntry->Size) return false;
+    if (i > 0 && !ShaderPackEntryLess(*GetDxilShaderPackEntry(pHeader, i - 1),
+                                      *pEntry))
+      return false;
+  }
+
+  return true;
+}
+
+const DxilContainerHeader *
+FindDxilShaderPackContainer(const DxilShaderPackHeader *pHeader,
+                            const uint8_t (&Digest)[DxilContainerHashSize]) {
+  DxilShaderPackEntry key;
+  memcpy(key.Digest, Digest, DxilContainerHashSize);
+  const DxilShaderPackEntry *pBegin = GetDxilShaderPackEntry(pHeader, 0);
+  const DxilShaderPackEntry *pEnd =
+      GetDxilShaderPackEntry(pHeader, pHeader->EntryCount);
+  const DxilShaderPackEntry *pEntry =
+      std::lower_bound(pBegin, pEnd, key, ShaderPackEntryLess);
+  if (pEntry == pEnd ||
+      memcmp(pEntry->Digest, Digest, DxilContainerHashSize) != 0)
+    return nullptr;
+  return GetDxilShaderPackContainer(pHeader, (uint32_t)(pEntry - pBegin));
+}
+
+const DxilShaderSourceHeader *
+FindDxilShaderSource(const DxilContainerHeader *pPack,
+                     const uint8_t (&Digest)[DxilContainerHashSize]) {
+  for (DxilPartIterator it = begin(pPack), e = end(pPack); it != e; ++it) {
+    const DxilPartHeader *pPart = *it;
+    if (!IsDxilShaderSourceValid(pPart))
+      continue;
+    const DxilShaderSourceHeader *pSource =
+        reinterpret_cast<const DxilShaderSourceHeader *>(GetDxilPartData(pPart));
+    if (memcmp(pSource->Digest, Digest, DxilContainerHashSize) == 0)
+      return pSource;
+  }
+  return nullptr;
+}
+
+bool DxilShaderPackWriter::AddContainer(const DxilContainerHeader *pContainer) {
+  DxilShaderHash hash;
+  GetDxilContainerShaderHash(pContainer, &hash);
+  if (!m_Digests.insert(std::string((const char *)hash.Digest,
+                                    DxilContainerHashSize)).second)
+    return false;
+
+  // The offsets are relative to the containers until the pack is written.
+  DxilShaderPackEntry entry;
+  memcpy(entry.Digest, hash.Digest, DxilContainerHashSize);
+  entry.Offset = m_ContainersSize;
+  entry.Size = pContainer->ContainerSizeInBytes;
+  entry.Reserved = 0;
+  m_Entries.push_back(entry);
+  m_Containers.push_back(pContainer);
+  m_ContainersSize += AlignShaderPackOffset(entry.Size);
+  return true;
+}
+
+uint64_t DxilShaderPackWriter::GetPackSize() const {
+  return GetShaderPackIndexSize(GetContainerCount()) + m_ContainersSize;
+}
+
+void DxilShaderPackWriter::Write(WriteFn WriteData) const {
+  static const uint8_t padding[DxilShaderPackAlignment] = {};
+  uint64_t indexSize = GetShaderPackIndexSize(GetContainerCount());
+
+  DxilShaderPackHeader header;
+  header.HeaderFourCC = DFCC_ShaderPack;
+  header.Version.Major = DxilShaderPackVersionMajor;
+  header.Version.Minor = DxilShaderPackVersionMinor;
+  header.EntryCount = GetContainerCount();
+  header.Reserved = 0;
+  header.PackSizeInBytes = GetPackSize();
+  WriteData(&header, sizeof(header));
+
+  // The index is sorted by digest; the containers stay in the order added,
+  // so that shaders added together are mapped in together.
+  std::vector<DxilShaderPackEntry> index(m_Entries);
+  for (DxilShaderPackEntry &entry : index)
+    entry.Offset += indexSize;
+  std::sort(index.begin(), index.end(), ShaderPackEntryLess);
+  if (!index.empty())
+    WriteData(index.data(), index.size() * sizeof(DxilShaderPackEntry));
+  uint64_t written = sizeof(header) + index.size() * sizeof(DxilShaderPackEntry);
+  WriteData(padding, (size_t)(indexSize - written));
+
+  for (size_t i = 0; i < m_Containers.size(); ++i) {
+    uint32_t size = m_Entries[i].Size;
+    WriteData(m_Containers[i], size);
+    WriteData(padding, (size_t)(AlignShaderPackOffset(size) - size));
+  }
+}
+
 } // namespace hlsl
@@ -10,10 +10,14 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/Support/MD5.h"
+#include "dxc/HLSL/DxilCompression.h"
 #include "dxc/HLSL/DxilContainer.h"
 #include "dxc/HLSL/DxilModule.h"
 #include "dxc/HLSL/DxilShaderModel.h"
@@ -24,8 +28,11 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/HLSL/DxilPipelineStateValidation.h"
+#include "dxc/HLSL/DxcTimeReport.h"
 #include <algorithm>
+#include <exception>
 #include <functional>
+#include <thread>
 
 using namespace llvm;
 using namespace hlsl;
@@ -350,6 +357,8 @@ private:
   std::vector<PSVSignatureElement0> m_SigInputElements;
   std::vector<PSVSignatureElement0> m_SigOutputElements;
   std::vector<PSVSignatureElement0> m_SigPatchConstantElements;
+  std::vector<PSVInputLayoutElement0> m_InputLayoutElements;
+  ArrayRef<uint8_t> m_ProgramBitcode;
 
   void SetPSVSigElement(PSVSignatureElement0 &E, const DxilSignatureElement &SE) {
     memset(&E, 0, sizeof(PSVSignatureElement0));
@@ -403,6 +412,33 @@ private:
     E.DynamicMaskAndStream |= (SE.GetDynIdxCompMask()) & 0xF;
   }
 
+  void AddInputLayoutElements(const PSVSignatureElement0 &E, const DxilSignatureElement &SE) {
+    // These are generated by the runtime, not fetched from vertex buffers.
+    if (!SE.IsAllocated() || SE.GetKind() == DXIL::SemanticKind::VertexID ||
+        SE.GetKind() == DXIL::SemanticKind::InstanceID)
+      return;
+    // Reuse the signature element's name when it has one; system values
+    // have none there, but input layouts still name them.
+    uint32_t SemanticName = E.SemanticName;
+    if (SemanticName == 0) {
+      SemanticName = (uint32_t)m_StringBuffer.size();
+      StringRef Name(SE.GetName());
+      m_StringBuffer.append(Name.size()+1, '\0');
+      memcpy(m_StringBuffer.data() + SemanticName, Name.data(), Name.size());
+    }
+    auto &SemIdx = SE.GetSemanticIndexVec();
+    for (uint32_t row = 0; row < SE.GetRows(); row++) {
+      PSVInputLayoutElement0 IL;
+      memset(&IL, 0, sizeof(PSVInputLayoutElement0));
+      IL.SemanticName = SemanticName;
+      IL.SemanticIndex = (uint32_t)SemIdx[row];
+      IL.Register = (uint8_t)(SE.GetStartRow() + row);
+      IL.ColsAndStart = (uint8_t)((SE.GetCols() & 0xF) | (SE.GetStartCol() << 4));
+      IL.ComponentType = E.ComponentType;
+      m_InputLayoutElements.push_back(IL);
+    }
+  }
+
   const uint32_t *CopyViewIDState(const uint32_t *pSrc, uint32_t InputScalars, uint32_t OutputScalars, PSVComponentMask ViewIDMask, PSVDependencyTable IOTable) {
     unsigned MaskDwords = PSVComputeMaskDwordsFromVectors(PSVALIGN4(OutputScalars) / 4);
     if (ViewIDMask.IsValid()) {
@@ -420,9 +456,11 @@ private:
   }
 
 public:
-  DxilPSVWriter(const DxilModule &module, uint32_t PSVVersion = 0)
+  DxilPSVWriter(const DxilModule &module, uint32_t PSVVersion = 0,
+                ArrayRef<uint8_t> ProgramBitcode = ArrayRef<uint8_t>())
   : m_Module(module),
-    m_PSVInitInfo(PSVVersion)
+    m_PSVInitInfo(PSVVersion),
+    m_ProgramBitcode(ProgramBitcode)
   {
     unsigned ValMajor, ValMinor;
     m_Module.GetValidatorVersion(ValMajor, ValMinor);
@@ -458,6 +496,13 @@ public:
       for (auto &SE : m_Module.GetPatchConstantSignature().GetElements()) {
         SetPSVSigElement(m_SigPatchConstantElements[i++], *(SE.get()));
       }
+      if (m_PSVInitInfo.PSVVersion > 1 && SM->IsVS()) {
+        i = 0;
+        for (auto &SE : m_Module.GetInputSignature().GetElements()) {
+          AddInputLayoutElements(m_SigInputElements[i++], *(SE.get()));
+        }
+        m_PSVInitInfo.InputLayoutElements = m_InputLayoutElements.size();
+      }
       // Set String and SemanticInput Tables
       m_PSVInitInfo.StringTable.Table = m_StringBuffer.data();
       m_PSVInitInfo.StringTable.Size = m_StringBuffer.size();
@@ -485,6 +530,12 @@ public:
     return m_PSVBufferSize;
   }
 
+  // The shader hash covers the final program bitcode, which is only known
+  // once the container parts are being written.
+  void SetProgramBitcode(ArrayRef<uint8_t> ProgramBitcode) {
+    m_ProgramBitcode = ProgramBitcode;
+  }
+
   __override void write(AbstractMemoryStream *pStream) {
     m_PSVBuffer.resize(m_PSVBufferSize);
     if (!m_PSV.InitNew(m_PSVInitInfo, m_PSVBuffer.data(), &m_PSVBufferSize)) {
@@ -496,8 +547,14 @@ public:
     PSVRuntimeInfo0* pInfo = m_PSV.GetPSVRuntimeInfo0();
     PSVRuntimeInfo1* pInfo1 = m_PSV.GetPSVRuntimeInfo1();
     const ShaderModel* SM = m_Module.GetShaderModel();
-    pInfo->MinimumExpectedWaveLaneCount = 0;
-    pInfo->MaximumExpectedWaveLaneCount = (UINT)-1;
+    // A shader specialized for a wave size must not run with any other.
+    if (unsigned waveSize = m_Module.GetWaveSize()) {
+      pInfo->MinimumExpectedWaveLaneCount = waveSize;
+      pInfo->MaximumExpectedWaveLaneCount = waveSize;
+    } else {
+      pInfo->MinimumExpectedWaveLaneCount = 0;
+      pInfo->MaximumExpectedWaveLaneCount = (UINT)-1;
+    }
 
     switch (SM->GetKind()) {
       case ShaderModel::Kind::Vertex: {
@@ -689,39 +746,206 @@ public:
       }
     }
 
+    if (m_PSVInitInfo.PSVVersion > 1) {
+      PSVRuntimeInfo2* pInfo2 = m_PSV.GetPSVRuntimeInfo2();
+      DXASSERT_NOMSG(pInfo2);
+
+      // Write Input Layout Elements
+      for (unsigned i = 0; i < m_PSV.GetInputLayoutElements(); i++) {
+        PSVInputLayoutElement0 *pLayoutElement = m_PSV.GetInputLayoutElement0(i);
+        DXASSERT_NOMSG(pLayoutElement);
+        memcpy(pLayoutElement, &m_InputLayoutElements[i], sizeof(PSVInputLayoutElement0));
+      }
+
+      // Hashes that runtime PSO caches can key on
+      {
+        DXASSERT(!m_ProgramBitcode.empty(), "else program bitcode not set");
+        llvm::MD5 md5;
+        md5.update(m_ProgramBitcode);
+        md5.final(pInfo2->ShaderHash);
+      }
+      {
+        llvm::MD5 md5;
+        if (m_PSV.GetBindCount()) {
+          md5.update(ArrayRef<uint8_t>((const uint8_t *)m_PSV.GetPSVResourceBindInfo0(0),
+                                       sizeof(PSVResourceBindInfo0) * m_PSV.GetBindCount()));
+        }
+        md5.final(pInfo2->ResourceBindingHash);
+      }
+      {
+        // Hash names rather than string table offsets, which depend on the
+        // names of every other signature element.
+        llvm::MD5 md5;
+        for (PSVInputLayoutElement0 IL : m_InputLayoutElements) {
+          md5.update(StringRef(m_StringBuffer.data() + IL.SemanticName));
+          IL.SemanticName = 0;
+          md5.update(ArrayRef<uint8_t>((const uint8_t *)&IL, sizeof(PSVInputLayoutElement0)));
+        }
+        md5.final(pInfo2->InputLayoutHash);
+      }
+    }
+
     ULONG cbWritten;
     IFT(pStream->Write(m_PSVBuffer.data(), m_PSVBufferSize, &cbWritten));
     DXASSERT_NOMSG(cbWritten == m_PSVBufferSize);
   }
 };
 
-DxilPartWriter *hlsl::NewPSVWriter(const DxilModule &M, uint32_t PSVVersion) {
-  return new DxilPSVWriter(M, PSVVersion);
+DxilPartWriter *hlsl::NewPSVWriter(const DxilModule &M, uint32_t PSVVersion,
+                                   const void *pProgramBitcode,
+                                   uint32_t ProgramBitcodeSize) {
+  return new DxilPSVWriter(
+      M, PSVVersion,
+      ArrayRef<uint8_t>((const uint8_t *)pProgramBitcode, ProgramBitcodeSize));
 }
 
+// Captures the line table of a module with debug info, so it must be created
+// before the debug info is stripped. Instructions are numbered the way the
+// DIA implementation numbers them.
+class DxilDebugLinesWriter : public DxilPartWriter  {
+private:
+  DxilDebugLinesHeader m_Header;
+  std::vector<DxilDebugLinesFile> m_Files;
+  std::vector<DxilDebugLinesEntry> m_Lines;
+  std::string m_Strings;
+
+  uint32_t AddString(StringRef Str) {
+    uint32_t Offset = (uint32_t)m_Strings.size();
+    m_Strings.append(Str.begin(), Str.end());
+    return Offset;
+  }
+
+public:
+  DxilDebugLinesWriter(const Module &M) {
+    // The first file with a given name gets the lines.
+    llvm::StringMap<uint32_t> FileIndices;
+    if (const NamedMDNode *Contents = M.getNamedMetadata("llvm.dbg.contents")) {
+      for (const MDNode *File : Contents->operands()) {
+        StringRef Name = cast<MDString>(File->getOperand(0))->getString();
+        StringRef Content = cast<MDString>(File->getOperand(1))->getString();
+        FileIndices.insert({ Name, (uint32_t)m_Files.size() });
+        DxilDebugLinesFile Entry;
+        Entry.NameSize = (uint32_t)Name.size();
+        Entry.NameOffset = AddString(Name);
+        Entry.ContentSize = (uint32_t)Content.size();
+        Entry.ContentOffset = AddString(Content);
+        m_Files.emplace_back(Entry);
+      }
+    }
+
+    uint32_t InstructionCount = 0;
+    for (const Function &F : M.functions()) {
+      for (const_inst_iterator It = inst_begin(F), End = inst_end(F); It != End; ++It) {
+        const Instruction &I = *It;
+        if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+          const Function *Callee = CI->getCalledFunction();
+          if (Callee && Callee->getName().startswith("llvm.dbg."))
+            continue;
+        }
+        if (const DebugLoc &DL = I.getDebugLoc()) {
+          DxilDebugLinesEntry Entry;
+          Entry.Instruction = InstructionCount;
+          Entry.Line = DL.getLine();
+          Entry.Column = DL.getCol();
+          Entry.FileIndex = DxilDebugLinesNoFile;
+          StringRef FileName;
+          if (const DILexicalBlock *Block = dyn_cast_or_null<DILexicalBlock>(DL.getScope()))
+            FileName = Block->getFile()->getFilename();
+          else if (const DISubprogram *SP = dyn_cast_or_null<DISubprogram>(DL.getScope()))
+            FileName = SP->getFile()->getFilename();
+          auto Found = FileIndices.find(FileName);
+          if (Found != FileIndices.end())
+            Entry.FileIndex = Found->second;
+          m_Lines.emplace_back(Entry);
+        }
+        ++InstructionCount;
+      }
+    }
+
+    m_Header.Version = DxilDebugLinesVersion;
+    m_Header.InstructionCount = InstructionCount;
+    m_Header.FileCount = (uint32_t)m_Files.size();
+    m_Header.LineCount = (uint32_t)m_Lines.size();
+    m_Header.StringsSize = (uint32_t)m_Strings.size();
+  }
+  __override uint32_t size() const {
+    uint32_t StringsSize = (m_Header.StringsSize + 3) & ~3;
+    return sizeof(DxilDebugLinesHeader) +
+           m_Header.FileCount * sizeof(DxilDebugLinesFile) +
+           m_Header.LineCount * sizeof(DxilDebugLinesEntry) + StringsSize;
+  }
+  __override void write(AbstractMemoryStream *pStream) {
+    ULONG cbWritten;
+    IFT(WriteStreamValue(pStream, m_Header));
+    if (!m_Files.empty())
+      IFT(pStream->Write(m_Files.data(), m_Files.size() * sizeof(DxilDebugLinesFile), &cbWritten));
+    if (!m_Lines.empty())
+      IFT(pStream->Write(m_Lines.data(), m_Lines.size() * sizeof(DxilDebugLinesEntry), &cbWritten));
+    if (!m_Strings.empty())
+      IFT(pStream->Write(m_Strings.data(), m_Strings.size(), &cbWritten));
+    if (uint32_t PaddingBytes = (4 - m_Strings.size() % 4) % 4) {
+      uint32_t PaddingValue = 0;
+      IFT(pStream->Write(&PaddingValue, PaddingBytes, &cbWritten));
+    }
+  }
+};
+
 class DxilContainerWriter_impl : public DxilContainerWriter  {
 private:
   class DxilPart {
   public:
     DxilPartHeader Header;
     WriteFn Write;
-    DxilPart(uint32_t fourCC, uint32_t size, WriteFn write) : Write(write) {
+    // Set for parts whose size is only known once the container is written.
+    DxilPartWriter *pWriter;
+    DxilPart(uint32_t fourCC, uint32_t size, WriteFn write)
+        : Write(write), pWriter(nullptr) {
       Header.PartFourCC = fourCC;
       Header.PartSize = size;
     }
+    DxilPart(uint32_t fourCC, DxilPartWriter *pPartWriter)
+        : pWriter(pPartWriter) {
+      Header.PartFourCC = fourCC;
+      Header.PartSize = 0;
+      Write = [pPartWriter](AbstractMemoryStream *pStream) {
+        pPartWriter->write(pStream);
+      };
+    }
+    uint32_t GetSize() const { return pWriter ? pWriter->size() : Header.PartSize; }
   };
 
   llvm::SmallVector<DxilPart, 8> m_Parts;
+  // Hashes the parts as they are written, while they are still in cache.
+  llvm::MD5 m_ShaderHasher;
+  DxilShaderHash m_ShaderHash;
 
 public:
   __override void AddPart(uint32_t FourCC, uint32_t Size, WriteFn Write) {
     m_Parts.emplace_back(FourCC, Size, Write);
   }
 
+  // Adds a part sized and written by pWriter, which may still be filling its
+  // buffer; it only has to be done by the time the container is written.
+  void AddPart(uint32_t FourCC, DxilPartWriter *pWriter) {
+    m_Parts.emplace_back(FourCC, pWriter);
+  }
+
+  // Must be added after every part the hash covers.
+  void AddShaderHashPart() {
+    AddPart(DFCC_ShaderHash, sizeof(DxilShaderHash), [&](AbstractMemoryStream *pStream) {
+      m_ShaderHash.Flags = 0;
+      m_ShaderHasher.final(m_ShaderHash.Digest);
+      IFT(WriteStreamValue(pStream, m_ShaderHash));
+    });
+  }
+
+  // Available once the container with the shader hash part is written.
+  const DxilShaderHash &GetShaderHash() const { return m_ShaderHash; }
+
   __override uint32_t size() const {
     uint32_t partSize = 0;
     for (auto &part : m_Parts) {
-      partSize += part.Header.PartSize;
+      partSize += part.GetSize();
     }
     return (uint32_t)GetDxilContainerSizeFromParts((uint32_t)m_Parts.size(), partSize);
   }
@@ -735,6 +959,7 @@ public:
     IFT(WriteStreamValue(pStream, header));
     uint32_t offset = sizeof(header) + (uint32_t)GetOffsetTableSize(PartCount);
     for (auto &&part : m_Parts) {
+      part.Header.PartSize = part.GetSize();
       IFT(WriteStreamValue(pStream, offset));
       offset += sizeof(DxilPartHeader) + part.Header.PartSize;
     }
@@ -742,7 +967,11 @@ public:
       IFT(WriteStreamValue(pStream, part.Header));
       size_t start = pStream->GetPosition();
       part.Write(pStream);
-      DXASSERT_LOCALVAR(start, pStream->GetPosition() - start == (size_t)part.Header.PartSize, "out of bound");
+      DXASSERT(pStream->GetPosition() - start == (size_t)part.Header.PartSize, "out of bound");
+      if (IsDxilShaderHashedPart(part.Header.PartFourCC)) {
+        const uint8_t *pPart = (const uint8_t *)pStream->GetPtr() + start - sizeof(DxilPartHeader);
+        m_ShaderHasher.update(ArrayRef<uint8_t>(pPart, sizeof(DxilPartHeader) + part.Header.PartSize));
+      }
     }
     DXASSERT(containerSizeInBytes == (uint32_t)pStream->GetPosition(), "else stream size is incorrect");
   }
@@ -763,16 +992,16 @@ static bool HasDebugInfo(const Module &M) {
   return false;
 }
 
-static void GetPaddedProgramPartSize(AbstractMemoryStream *pStream,
+static void GetPaddedProgramPartSize(ArrayRef<char> Bitcode,
                                      uint32_t &bitcodeInUInt32,
                                      uint32_t &bitcodePaddingBytes) {
-  bitcodeInUInt32 = pStream->GetPtrSize();
+  bitcodeInUInt32 = Bitcode.size();
   bitcodePaddingBytes = (bitcodeInUInt32 % 4);
   bitcodeInUInt32 = (bitcodeInUInt32 / 4) + (bitcodePaddingBytes ? 1 : 0);
 }
 
 static void WriteProgramPart(const ShaderModel *pModel,
-                             AbstractMemoryStream *pModuleBitcode,
+                             ArrayRef<char> ModuleBitcode,
                              AbstractMemoryStream *pStream) {
   DXASSERT(pModel != nullptr, "else generation should have failed");
   DxilProgramHeader programHeader;
@@ -781,26 +1010,96 @@ static void WriteProgramPart(const ShaderModel *pModel,
   unsigned dxilMajor, dxilMinor;
   pModel->GetDxilVersion(dxilMajor, dxilMinor);
   uint32_t dxilVersion = DXIL::MakeDxilVersion(dxilMajor, dxilMinor);
-  InitProgramHeader(programHeader, shaderVersion, dxilVersion, pModuleBitcode->GetPtrSize());
+  InitProgramHeader(programHeader, shaderVersion, dxilVersion, ModuleBitcode.size());
 
   uint32_t programInUInt32, programPaddingBytes;
-  GetPaddedProgramPartSize(pModuleBitcode, programInUInt32,
+  GetPaddedProgramPartSize(ModuleBitcode, programInUInt32,
                            programPaddingBytes);
 
   ULONG cbWritten;
   IFT(WriteStreamValue(pStream, programHeader));
-  IFT(pStream->Write(pModuleBitcode->GetPtr(), pModuleBitcode->GetPtrSize(),
-                     &cbWritten));
+  IFT(pStream->Write(ModuleBitcode.data(), ModuleBitcode.size(), &cbWritten));
   if (programPaddingBytes) {
     uint32_t paddingValue = 0;
     IFT(pStream->Write(&paddingValue, programPaddingBytes, &cbWritten));
   }
 }
 
+// Writes the debug info part compressed. The debug module is written and
+// compressed by Compress before the part is written, since the part size
+// depends on the compressed size; Compress only reads the bitcode, so it can
+// run while the program bitcode is being written.
+class DxilCompressedDebugInfoWriter : public DxilPartWriter {
+private:
+  const ShaderModel *m_pModel;
+  ArrayRef<char> m_ModuleBitcode;
+  DxilCompressedPartHeader m_Header;
+  std::vector<uint8_t> m_Data;
+
+public:
+  DxilCompressedDebugInfoWriter(const ShaderModel *pModel,
+                                ArrayRef<char> ModuleBitcode)
+      : m_pModel(pModel), m_ModuleBitcode(ModuleBitcode) {}
+  void Compress() {
+    CComPtr<AbstractMemoryStream> pPartStream;
+    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pPartStream));
+    WriteProgramPart(m_pModel, m_ModuleBitcode, pPartStream);
+    Lz4CompressBlock(pPartStream->GetPtr(), pPartStream->GetPtrSize(), m_Data);
+    m_Header.Algorithm = (uint32_t)DxilCompressionAlgorithm::Lz4;
+    m_Header.CompressedSize = (uint32_t)m_Data.size();
+    m_Header.UncompressedSize = (uint32_t)pPartStream->GetPtrSize();
+  }
+  __override uint32_t size() const {
+    return sizeof(DxilCompressedPartHeader) + ((m_Header.CompressedSize + 3) & ~3);
+  }
+  __override void write(AbstractMemoryStream *pStream) {
+    ULONG cbWritten;
+    IFT(WriteStreamValue(pStream, m_Header));
+    IFT(pStream->Write(m_Data.data(), m_Data.size(), &cbWritten));
+    if (uint32_t PaddingBytes = (4 - m_Data.size() % 4) % 4) {
+      uint32_t PaddingValue = 0;
+      IFT(pStream->Write(&PaddingValue, PaddingBytes, &cbWritten));
+    }
+  }
+};
+
+// Runs the work that fills a part writer's buffer on another thread, while
+// the caller goes on with the parts that don't depend on it. Join rethrows
+// what the work threw.
+class DxilPartWork {
+private:
+  std::thread m_Thread;
+  std::exception_ptr m_Exception;
+
+public:
+  ~DxilPartWork() {
+    if (m_Thread.joinable())
+      m_Thread.join();
+  }
+  void Start(std::function<void()> Work) {
+    IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+    m_Thread = std::thread([this, pMalloc, Work]() {
+      DxcThreadMalloc TM(pMalloc);
+      try {
+        Work();
+      } catch (...) {
+        m_Exception = std::current_exception();
+      }
+    });
+  }
+  void Join() {
+    if (m_Thread.joinable())
+      m_Thread.join();
+    if (m_Exception)
+      std::rethrow_exception(m_Exception);
+  }
+};
+
 void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
                                            AbstractMemoryStream *pModuleBitcode,
                                            AbstractMemoryStream *pFinalStream,
-                                           SerializeDxilFlags Flags) {
+                                           SerializeDxilFlags Flags,
+                                           AbstractMemoryStream *pSidecarStream) {
   // TODO: add a flag to update the module and remove information that is not part
   // of DXIL proper and is used only to assemble the container.
 
@@ -821,8 +1120,13 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
       pModule->GetOutputSignature(), pModule->GetTessellatorDomain(),
       /*IsInput*/ false,
       /*UseMinPrecision*/ !pModule->m_ShaderFlags.GetUseNativeLowPrecision());
-  DxilPSVWriter PSVWriter(*pModule);
+  DxilPSVWriter PSVWriter(*pModule,
+      (Flags & SerializeDxilFlags::IncludeExtendedPSV) ? 2 : 0);
   DxilContainerWriter_impl writer;
+  // The parts only tools use go to the sidecar when there is one, so the
+  // shader doesn't have to be serialized again to strip them.
+  DxilContainerWriter_impl sidecarWriter;
+  DxilContainerWriter_impl &debugWriter = pSidecarStream ? sidecarWriter : writer;
 
   // Write the feature part.
   DxilFeatureInfoWriter featureInfoWriter(*pModule);
@@ -850,63 +1154,93 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
   }
 
   // Write the DxilPipelineStateValidation (PSV0) part.
+  // ProgramBitcode is final by the time parts are written.
+  ArrayRef<char> ProgramBitcode;
   writer.AddPart(DFCC_PipelineStateValidation, PSVWriter.size(), [&](AbstractMemoryStream *pStream) {
+    PSVWriter.SetProgramBitcode(ArrayRef<uint8_t>(
+        (const uint8_t *)ProgramBitcode.data(), ProgramBitcode.size()));
     PSVWriter.write(pStream);
   });
 
+  // The module is written again as it is stripped. The bitcode stays in
+  // these buffers until the parts are copied into the container, instead of
+  // being copied to a stream first; each is reserved to the size of the
+  // bitcode it replaces, which it won't exceed.
+  ArrayRef<char> ModuleBitcode((const char *)pModuleBitcode->GetPtr(),
+                               pModuleBitcode->GetPtrSize());
+  SmallVector<char, 0> InputProgramBuffer, ProgramBuffer;
+
   // Write the root signature (RTS0) part.
   DxilProgramRootSignatureWriter rootSigWriter(pModule->GetRootSignature());
-  CComPtr<AbstractMemoryStream> pInputProgramStream = pModuleBitcode;
+  ArrayRef<char> InputProgramBitcode = ModuleBitcode;
   if (!pModule->GetRootSignature().IsEmpty()) {
     writer.AddPart(
         DFCC_RootSignature, rootSigWriter.size(),
         [&](AbstractMemoryStream *pStream) { rootSigWriter.write(pStream); });
     pModule->StripRootSignatureFromMetadata();
-    pInputProgramStream.Release();
-    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pInputProgramStream));
-    raw_stream_ostream outStream(pInputProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, true);
+    InputProgramBuffer.reserve(ModuleBitcode.size());
+    WriteBitcodeToBuffer(pModule->GetModule(), InputProgramBuffer, true);
+    InputProgramBitcode = InputProgramBuffer;
   }
 
   // If we have debug information present, serialize it to a debug part, then use the stripped version as the canonical program version.
-  CComPtr<AbstractMemoryStream> pProgramStream = pInputProgramStream;
+  ProgramBitcode = InputProgramBitcode;
+  std::unique_ptr<DxilDebugLinesWriter> pDebugLinesWriter;
+  std::unique_ptr<DxilCompressedDebugInfoWriter> pCompressedDebugInfoWriter;
+  DxilPartWork compressWork;
   if (HasDebugInfo(*pModule->GetModule())) {
     uint32_t debugInUInt32, debugPaddingBytes;
-    GetPaddedProgramPartSize(pInputProgramStream, debugInUInt32, debugPaddingBytes);
+    GetPaddedProgramPartSize(InputProgramBitcode, debugInUInt32, debugPaddingBytes);
     if (Flags & SerializeDxilFlags::IncludeDebugInfoPart) {
-      writer.AddPart(DFCC_ShaderDebugInfoDXIL, debugInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
-        WriteProgramPart(pModule->GetShaderModel(), pInputProgramStream, pStream);
+      if (Flags & SerializeDxilFlags::CompressDebugInfoPart) {
+        // The debug module is compressed while the line table is collected
+        // and the program bitcode written.
+        pCompressedDebugInfoWriter = llvm::make_unique<DxilCompressedDebugInfoWriter>(
+            pModule->GetShaderModel(), InputProgramBitcode);
+        DxilCompressedDebugInfoWriter *pCompressor = pCompressedDebugInfoWriter.get();
+        compressWork.Start([pCompressor]() { pCompressor->Compress(); });
+        debugWriter.AddPart(DFCC_ShaderDebugInfoCompressed, pCompressor);
+      } else {
+        debugWriter.AddPart(DFCC_ShaderDebugInfoDXIL, debugInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
+          WriteProgramPart(pModule->GetShaderModel(), InputProgramBitcode, pStream);
+        });
+      }
+
+      // Write the line table as well, so it can be read without the bitcode.
+      pDebugLinesWriter = llvm::make_unique<DxilDebugLinesWriter>(*pModule->GetModule());
+      debugWriter.AddPart(DFCC_ShaderDebugLines, pDebugLinesWriter->size(), [&](AbstractMemoryStream *pStream) {
+        pDebugLinesWriter->write(pStream);
       });
     }
 
-    pProgramStream.Release();
-
-    llvm::StripDebugInfo(*pModule->GetModule());
-    pModule->StripDebugRelatedCode();
+    {
+      TimeReportPhase bitcodePhase("container-program-bitcode");
+      llvm::StripDebugInfo(*pModule->GetModule());
+      pModule->StripDebugRelatedCode();
 
-    IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pProgramStream));
-    raw_stream_ostream outStream(pProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, true);
+      ProgramBuffer.reserve(InputProgramBitcode.size());
+      WriteBitcodeToBuffer(pModule->GetModule(), ProgramBuffer, true);
+      ProgramBitcode = ProgramBuffer;
+    }
 
     if (Flags & SerializeDxilFlags::IncludeDebugNamePart) {
-      CComPtr<AbstractMemoryStream> pHashStream;
       // If the debug name should be specific to the sources, base the name on the debug
       // bitcode, which will include the source references, line numbers, etc. Otherwise,
       // do it exclusively on the target shader bitcode.
-      pHashStream = (int)(Flags & SerializeDxilFlags::DebugNameDependOnSource) ? pModuleBitcode : pProgramStream;
+      ArrayRef<char> HashBitcode = (int)(Flags & SerializeDxilFlags::DebugNameDependOnSource) ? ModuleBitcode : ProgramBitcode;
       const uint32_t DebugInfoNameHashLen = 32;   // 32 chars of MD5
       const uint32_t DebugInfoNameSuffix = 4;     // '.lld'
       const uint32_t DebugInfoNameNullAndPad = 4; // '\0\0\0\0'
       const uint32_t DebugInfoContentLen =
           sizeof(DxilShaderDebugName) + DebugInfoNameHashLen +
           DebugInfoNameSuffix + DebugInfoNameNullAndPad;
-      writer.AddPart(DFCC_ShaderDebugName, DebugInfoContentLen, [&](AbstractMemoryStream *pStream) {
+      DxilContainerWriter::WriteFn WriteDebugName = [&](AbstractMemoryStream *pStream) {
         DxilShaderDebugName NameContent;
         NameContent.Flags = 0;
         NameContent.NameLength = DebugInfoNameHashLen + DebugInfoNameSuffix;
         IFT(WriteStreamValue(pStream, NameContent));
 
-        ArrayRef<uint8_t> Data((uint8_t *)pHashStream->GetPtr(), pHashStream->GetPtrSize());
+        ArrayRef<uint8_t> Data((const uint8_t *)HashBitcode.data(), HashBitcode.size());
         llvm::MD5 md5;
         llvm::MD5::MD5Result md5Result;
         SmallString<32> Hash;
@@ -918,20 +1252,51 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
         IFT(pStream->Write(Hash.data(), Hash.size(), &cbWritten));
         const char SuffixAndPad[] = ".lld\0\0\0";
         IFT(pStream->Write(SuffixAndPad, _countof(SuffixAndPad), &cbWritten));
-      });
+      };
+      // The sidecar has the name too, so it can be matched to the shader.
+      writer.AddPart(DFCC_ShaderDebugName, DebugInfoContentLen, WriteDebugName);
+      if (pSidecarStream)
+        sidecarWriter.AddPart(DFCC_ShaderDebugName, DebugInfoContentLen, WriteDebugName);
     }
   }
 
+  // Write the statistics (STAT) part. A library has no single entry to
+  // describe.
+  DxilShaderStatistics statistics;
+  if ((Flags & SerializeDxilFlags::IncludeStatisticsPart) &&
+      !pModule->GetShaderModel()->IsLib()) {
+    ComputeDxilShaderStatistics(*pModule, pModule->GetEntryFunction(), &statistics);
+    writer.AddPart(DFCC_ShaderStatistics, sizeof(statistics), [&](AbstractMemoryStream *pStream) {
+      IFT(WriteStreamValue(pStream, statistics));
+    });
+  }
+
   // Compute padded bitcode size.
   uint32_t programInUInt32, programPaddingBytes;
-  GetPaddedProgramPartSize(pProgramStream, programInUInt32, programPaddingBytes);
+  GetPaddedProgramPartSize(ProgramBitcode, programInUInt32, programPaddingBytes);
 
   // Write the program part.
   writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
-    WriteProgramPart(pModule->GetShaderModel(), pProgramStream, pStream);
+    WriteProgramPart(pModule->GetShaderModel(), ProgramBitcode, pStream);
   });
 
+  // Write the shader hash (HASH) part, after the parts it covers.
+  if (Flags & SerializeDxilFlags::IncludeShaderHashPart) {
+    writer.AddShaderHashPart();
+    // The sidecar carries the hash of the shader, computed as it is written.
+    if (pSidecarStream) {
+      sidecarWriter.AddPart(DFCC_ShaderHash, sizeof(DxilShaderHash), [&](AbstractMemoryStream *pStream) {
+        IFT(WriteStreamValue(pStream, writer.GetShaderHash()));
+      });
+    }
+  }
+
+  // Wait for the parts filled concurrently, then copy every part into place.
+  compressWork.Join();
+  TimeReportPhase writePhase("container-write");
   writer.write(pFinalStream);
+  if (pSidecarStream)
+    sidecarWriter.write(pSidecarStream);
 }
 
 void hlsl::SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
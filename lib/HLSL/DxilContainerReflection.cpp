@@ -50,7 +50,19 @@ private:
   CComPtr<IDxcBlob> m_container;
   const DxilContainerHeader *m_pHeader = nullptr;
   uint32_t m_headerLen = 0;
+  // Reflections handed out for the parts of the loaded container. They are
+  // kept while the same container is loaded again, so that the subsystems
+  // reflecting one shader share its module.
+  struct PartReflection {
+    UINT32 PartIndex;
+    UINT32 PublicAPI;
+    CComPtr<ID3D12ShaderReflection> pReflection;
+  };
+  std::vector<PartReflection> m_partReflections;
   bool IsLoaded() const { return m_pHeader != nullptr; }
+  bool IsSameContainer(const DxilContainerHeader *pHeader, uint32_t bufLen) const;
+  HRESULT AddPartReflection(UINT32 idx, UINT32 api,
+                            ID3D12ShaderReflection *pReflection);
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxilContainerReflection)
@@ -82,7 +94,12 @@ private:
   std::vector<D3D12_SIGNATURE_PARAMETER_DESC>     m_PatchConstantSignature;
   std::vector<std::unique_ptr<char[]>>            m_UpperCaseNames;
   std::vector<std::unique_ptr<CShaderReflectionType>> m_Types;
+  bool m_UsageCollected = false;
+  bool m_StatisticsCollected = false;
+  DxilShaderStatistics m_Statistics;
   void CreateReflectionObjects();
+  HRESULT CollectUsage();
+  HRESULT CollectStatistics();
   void SetCBufferUsage();
   void CreateReflectionObjectForResource(DxilResourceBase *R);
   void CreateReflectionObjectsForSignature(
@@ -162,12 +179,39 @@ public:
   STDMETHODIMP_(UINT64) GetRequiresFlags(THIS);
 };
 
+// True if the container is the one already loaded. Signed containers are
+// compared by their hash; others by their contents.
+bool DxilContainerReflection::IsSameContainer(const DxilContainerHeader *pHeader,
+                                              uint32_t bufLen) const {
+  if (!IsLoaded() || m_headerLen != bufLen)
+    return false;
+  static const DxilContainerHash UnsignedHash = {};
+  if (memcmp(&pHeader->Hash, &UnsignedHash, sizeof(UnsignedHash)) != 0)
+    return memcmp(&pHeader->Hash, &m_pHeader->Hash, sizeof(UnsignedHash)) == 0;
+  return memcmp(pHeader, m_pHeader, bufLen) == 0;
+}
+
+HRESULT DxilContainerReflection::AddPartReflection(
+    UINT32 idx, UINT32 api, ID3D12ShaderReflection *pReflection) {
+  try {
+    PartReflection Part;
+    Part.PartIndex = idx;
+    Part.PublicAPI = api;
+    Part.pReflection = pReflection;
+    m_partReflections.emplace_back(std::move(Part));
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 _Use_decl_annotations_
 HRESULT DxilContainerReflection::Load(IDxcBlob *pContainer) {
+  DxcThreadMalloc TM(m_pMalloc);
   if (pContainer == nullptr) {
     m_container.Release();
     m_pHeader = nullptr;
     m_headerLen = 0;
+    m_partReflections.clear();
     return S_OK;
   }
 
@@ -181,6 +225,8 @@ HRESULT DxilContainerReflection::Load(IDxcBlob *pContainer) {
     return E_INVALIDARG;
   }
 
+  if (!IsSameContainer(pHeader, bufLen))
+    m_partReflections.clear();
   m_container = pContainer;
   m_headerLen = bufLen;
   m_pHeader = pHeader;
@@ -238,18 +284,44 @@ HRESULT DxilContainerReflection::GetPartReflection(UINT32 idx, REFIID iid, void
   if (!IsLoaded()) return E_NOT_VALID_STATE;
   if (idx >= m_pHeader->PartCount) return E_BOUNDS;
   const DxilPartHeader *pPart = GetDxilContainerPart(m_pHeader, idx);
-  if (pPart->PartFourCC != DFCC_DXIL && pPart->PartFourCC != DFCC_ShaderDebugInfoDXIL) {
+  if (pPart->PartFourCC != DFCC_DXIL && pPart->PartFourCC != DFCC_ShaderDebugInfoDXIL &&
+      pPart->PartFourCC != DFCC_ShaderDebugInfoCompressed) {
     return E_NOTIMPL;
   }
-  
+
+  // The debug part is the DXIL part with debug info, which reflection
+  // doesn't use, so the smaller part is read instead when there is one.
+  if (pPart->PartFourCC != DFCC_DXIL) {
+    UINT32 dxilIdx;
+    if (SUCCEEDED(FindFirstPartKind(DFCC_DXIL, &dxilIdx)))
+      return GetPartReflection(dxilIdx, iid, ppvObject);
+  }
+
   DxcThreadMalloc TM(m_pMalloc);
   HRESULT hr = S_OK;
+  DxilShaderReflection::PublicAPI api = DxilShaderReflection::IIDToAPI(iid);
+  for (PartReflection &Part : m_partReflections) {
+    if (Part.PartIndex == idx && Part.PublicAPI == (UINT32)api)
+      return Part.pReflection->QueryInterface(iid, ppvObject);
+  }
+
   CComPtr<DxilShaderReflection> pReflection = DxilShaderReflection::Alloc(m_pMalloc);
   IFCOOM(pReflection.p);
-  DxilShaderReflection::PublicAPI api = DxilShaderReflection::IIDToAPI(iid);
   pReflection->SetPublicAPI(api);
 
-  IFC(pReflection->Load(m_container, pPart));
+  if (pPart->PartFourCC == DFCC_ShaderDebugInfoCompressed) {
+    // The module is read in place, so it is loaded from a blob that holds
+    // the decompressed part.
+    std::vector<char> partStorage;
+    CComPtr<IDxcBlobEncoding> pPartBlob;
+    IFCBOOL(DecompressDxilDebugInfoPart(pPart, partStorage), DXC_E_CONTAINER_INVALID);
+    IFC(DxcCreateBlobWithEncodingOnHeapCopy(partStorage.data(), (UINT32)partStorage.size(),
+                                            CP_ACP, &pPartBlob));
+    IFC(pReflection->Load(pPartBlob, (const DxilPartHeader *)pPartBlob->GetBufferPointer()));
+  } else {
+    IFC(pReflection->Load(m_container, pPart));
+  }
+  IFC(AddPartReflection(idx, (UINT32)api, pReflection));
   IFC(pReflection.p->QueryInterface(iid, ppvObject));
 Cleanup:
   return hr;
@@ -1420,9 +1492,6 @@ void DxilShaderReflection::CreateReflectionObjects() {
     rcb.Initialize(*m_pDxilModule, *(cb.get()), m_Types);
     m_CBs.push_back(std::move(rcb));
   }
-  // Set cbuf usage.
-  SetCBufferUsage();
-
   // TODO: add tbuffers into m_CBs
   for (auto && uav : m_pDxilModule->GetUAVs()) {
     if (uav->GetKind() != DxilResource::Kind::StructuredBuffer) {
@@ -1459,7 +1528,45 @@ void DxilShaderReflection::CreateReflectionObjects() {
   CreateReflectionObjectsForSignature(m_pDxilModule->GetInputSignature(), m_InputSignature);
   CreateReflectionObjectsForSignature(m_pDxilModule->GetOutputSignature(), m_OutputSignature);
   CreateReflectionObjectsForSignature(m_pDxilModule->GetPatchConstantSignature(), m_PatchConstantSignature);
+}
+
+HRESULT DxilShaderReflection::CollectUsage() {
+  if (m_UsageCollected)
+    return S_OK;
+  // Constant buffer variable usage and signature read/write masks come from
+  // the instructions, so the function bodies are needed from here on.
+  if (m_pModule->materializeAllPermanently())
+    return E_FAIL;
+  m_UsageCollected = true;
+  SetCBufferUsage();
   MarkUsedSignatureElements();
+  return S_OK;
+}
+
+HRESULT DxilShaderReflection::CollectStatistics() {
+  if (m_StatisticsCollected)
+    return S_OK;
+  // Shaders compiled with -Qembed_stats have them in the container, which
+  // saves materializing the function bodies.
+  const DxilContainerHeader *pContainer = IsDxilContainerLike(
+      m_pContainer->GetBufferPointer(), m_pContainer->GetBufferSize());
+  const DxilPartHeader *pPart =
+      pContainer ? GetDxilPartByType(pContainer, DFCC_ShaderStatistics)
+                 : nullptr;
+  if (pPart && pPart->PartSize >= sizeof(DxilShaderStatistics) &&
+      reinterpret_cast<const DxilShaderStatistics *>(GetDxilPartData(pPart))
+              ->Version == DxilShaderStatisticsVersion) {
+    memcpy(&m_Statistics, GetDxilPartData(pPart), sizeof(m_Statistics));
+  } else {
+    IFR(CollectUsage());
+    if (!m_pDxilModule->GetEntryFunction())
+      return E_FAIL;
+    ComputeDxilShaderStatistics(*m_pDxilModule,
+                                m_pDxilModule->GetEntryFunction(),
+                                &m_Statistics);
+  }
+  m_StatisticsCollected = true;
+  return S_OK;
 }
 
 static D3D_REGISTER_COMPONENT_TYPE CompTypeToRegisterComponentType(CompType CT) {
@@ -1644,15 +1751,13 @@ HRESULT DxilShaderReflection::Load(IDxcBlob *pBlob,
     const char *pBitcode;
     uint32_t bitcodeLength;
     GetDxilProgramBitcode((DxilProgramHeader *)pData, &pBitcode, &bitcodeLength);
-    std::unique_ptr<MemoryBuffer> pMemBuffer =
-        MemoryBuffer::getMemBufferCopy(StringRef(pBitcode, bitcodeLength));
-#if 0 // We materialize eagerly, because we'll need to walk instructions to look for usage information.
+    // The bitcode is read in place; m_pContainer keeps it alive for as long
+    // as the module. Function bodies are only materialized when a query needs
+    // usage information, see CollectUsage.
+    std::unique_ptr<MemoryBuffer> pMemBuffer = MemoryBuffer::getMemBuffer(
+        StringRef(pBitcode, bitcodeLength), "", false);
     ErrorOr<std::unique_ptr<Module>> module =
         getLazyBitcodeModule(std::move(pMemBuffer), Context);
-#else
-    ErrorOr<std::unique_ptr<Module>> module =
-      parseBitcodeFile(pMemBuffer->getMemBufferRef(), Context, nullptr);
-#endif
     if (!module) {
       return E_INVALIDARG;
     }
@@ -1680,8 +1785,14 @@ HRESULT DxilShaderReflection::GetDesc(D3D12_SHADER_DESC *pDesc) {
   pDesc->OutputParameters = m_OutputSignature.size();
   pDesc->PatchConstantParameters = m_PatchConstantSignature.size();
 
-  // Unset:  UINT                    InstructionCount;            // Number of emitted instructions
-  // Unset:  UINT                    TempRegisterCount;           // Number of temporary registers used 
+  // The counts are static estimates, see DxilShaderStatistics.
+  bool bStatistics = SUCCEEDED(CollectStatistics());
+  if (bStatistics) {
+    pDesc->InstructionCount = m_Statistics.InstructionCount;
+    pDesc->TempRegisterCount = m_Statistics.MaxLiveValues;
+    pDesc->TextureNormalInstructions = m_Statistics.SampleCount;
+    pDesc->TextureLoadInstructions = m_Statistics.LoadCount;
+  }
   // Unset:  UINT                    TempArrayCount;              // Number of temporary arrays used
   // Unset:  UINT                    DefCount;                    // Number of constant defines 
   // Unset:  UINT                    DclCount;                    // Number of declarations (input + output)
@@ -1708,9 +1819,11 @@ HRESULT DxilShaderReflection::GetDesc(D3D12_SHADER_DESC *pDesc) {
   // Unset:  D3D_TESSELLATOR_PARTITIONING HSPartitioning;         // Partitioning mode of the tessellator
   // Unset:  D3D_TESSELLATOR_DOMAIN  TessellatorDomain;           // Domain of the tessellator (quad, tri, isoline)
   // instruction counts
-  // Unset:  UINT cBarrierInstructions;                           // Number of barrier instructions in a compute shader
-  // Unset:  UINT cInterlockedInstructions;                       // Number of interlocked instructions
-  // Unset:  UINT cTextureStoreInstructions;                      // Number of texture writes
+  if (bStatistics) {
+    pDesc->cBarrierInstructions = m_Statistics.BarrierCount;
+    pDesc->cInterlockedInstructions = m_Statistics.AtomicCount;
+    pDesc->cTextureStoreInstructions = m_Statistics.StoreCount;
+  }
   return S_OK;
 }
 
@@ -1788,7 +1901,7 @@ void DxilShaderReflection::MarkUsedSignatureElements() {
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByIndex(UINT Index) {
-  if (Index >= m_CBs.size()) {
+  if (Index >= m_CBs.size() || FAILED(CollectUsage())) {
     return &g_InvalidSRConstantBuffer;
   }
   return &m_CBs[Index];
@@ -1796,7 +1909,7 @@ ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByI
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByName(LPCSTR Name) {
-  if (!Name) {
+  if (!Name || FAILED(CollectUsage())) {
     return &g_InvalidSRConstantBuffer;
   }
   for (UINT index = 0; index < m_CBs.size(); ++index) {
@@ -1826,6 +1939,7 @@ HRESULT DxilShaderReflection::GetInputParameterDesc(UINT ParameterIndex,
   _Out_ D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_InputSignature.size(), E_INVALIDARG);
+  IFR(CollectUsage());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_InputSignature[ParameterIndex];
   else
@@ -1841,6 +1955,7 @@ HRESULT DxilShaderReflection::GetOutputParameterDesc(UINT ParameterIndex,
   D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_OutputSignature.size(), E_INVALIDARG);
+  IFR(CollectUsage());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_OutputSignature[ParameterIndex];
   else
@@ -1856,6 +1971,7 @@ HRESULT DxilShaderReflection::GetPatchConstantParameterDesc(UINT ParameterIndex,
   D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_PatchConstantSignature.size(), E_INVALIDARG);
+  IFR(CollectUsage());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_PatchConstantSignature[ParameterIndex];
   else
@@ -1868,7 +1984,7 @@ HRESULT DxilShaderReflection::GetPatchConstantParameterDesc(UINT ParameterIndex,
 
 _Use_decl_annotations_
 ID3D12ShaderReflectionVariable* DxilShaderReflection::GetVariableByName(LPCSTR Name) {
-  if (Name != nullptr) {
+  if (Name != nullptr && SUCCEEDED(CollectUsage())) {
     // Iterate through all cbuffers to find the variable.
     for (UINT i = 0; i < m_CBs.size(); i++) {
       ID3D12ShaderReflectionVariable *pVar = m_CBs[i].GetVariableByName(Name);
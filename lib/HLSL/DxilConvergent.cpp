@@ -19,6 +19,7 @@
 #include "llvm/Support/raw_os_ostream.h"
 
 #include "dxc/HLSL/DxilConstants.h"
+#include "dxc/HLSL/DxilDomTreeCache.h"
 #include "dxc/HLSL/DxilGenerationPass.h"
 #include "dxc/HLSL/HLOperations.h"
 #include "dxc/HLSL/HLModule.h"
@@ -53,13 +54,18 @@ public:
     }
     bool bUpdated = false;
 
+    DxilDomTreeCache LocalDomTrees;
+    DxilDomTreeCachePass *pDomTreesPass =
+        getAnalysisIfAvailable<DxilDomTreeCachePass>();
+    DxilDomTreeCache &DomTrees =
+        pDomTreesPass ? pDomTreesPass->getCache() : LocalDomTrees;
+
     for (Function &F : M.functions()) {
       if (F.isDeclaration())
         continue;
 
       // Compute postdominator relation.
-      DominatorTreeBase<BasicBlock> PDR(true);
-      PDR.recalculate(F);
+      DominatorTreeBase<BasicBlock> &PDR = DomTrees.GetPostDomTree(F);
       for (BasicBlock &bb : F.getBasicBlockList()) {
         for (auto it = bb.begin(); it != bb.end();) {
           Instruction *I = (it++);
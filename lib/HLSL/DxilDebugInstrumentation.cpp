@@ -18,6 +18,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/MathExtras.h"
 
 
 using namespace llvm;
@@ -67,10 +68,25 @@ using namespace hlsl;
 // close to the end of the power-of-two size of the UAV. If this value has been overwritten, the debug session
 // is deemed to have overflowed the UAV. The caller will than allocate a UAV that is twice the size and
 // try again, up to a predefined maximum.
+//
+// Long shaders produce more steps than a debugger needs to follow the invocation, and each one costs an
+// atomic and a few stores. Two options reduce the number of steps recorded without changing the
+// instruction indices the debugger sees:
+// -  sampleEveryN records only every Nth instrumented instruction.
+// -  blockEntriesOnly records only the first instrumented instruction of each basic block, which is
+//    enough to reconstruct the path taken through the shader.
+// With ringBuffer, the UAV starts with a small header holding the write counter and an overflow counter,
+// followed by a power-of-two ring of records. Once the ring is full, new records overwrite the oldest ones
+// and the overflow counter is incremented for each, so the caller gets the end of the trace and knows how
+// much of it was lost, instead of having to retry with a larger UAV.
 
 // Keep this in sync with the same-named value in the debugger application's WinPixShaderUtils.h
 constexpr uint64_t DebugBufferDumpingGroundSize = 64 * 1024;
 
+// Layout of the header in ring buffer mode.
+constexpr uint32_t DebugRingBufferOverflowCounterOffset = 4;
+constexpr uint32_t DebugRingBufferHeaderSize = 16;
+
 
 // These definitions echo those in the debugger application's debugshaderrecord.h file
 enum DebugShaderModifierRecordType {
@@ -196,6 +212,11 @@ private:
 
   unsigned int m_InstructionIndex = 0;
 
+  unsigned m_SampleEveryN = 1;
+  bool m_BlockEntriesOnly = false;
+  bool m_RingBuffer = false;
+  BasicBlock * m_LastRecordedBlock = nullptr;
+
   struct BuilderContext {
     Module &M;
     DxilModule &DM;
@@ -227,6 +248,7 @@ private:
   void reserveDebugEntrySpace(BuilderContext &BC, uint32_t SpaceInDwords);
   void addStepDebugEntry(BuilderContext &BC, Instruction *Inst);
   uint32_t UAVDumpingGroundOffset();
+  uint32_t RingBufferCapacity();
   template<typename ReturnType>
   void addStepEntryForType(DebugShaderModifierRecordType RecordType, BuilderContext &BC, Instruction *Inst);
 
@@ -237,12 +259,25 @@ void DxilDebugInstrumentation::applyOptions(PassOptions O) {
   GetPassOptionUnsigned(O, "parameter1", &m_Parameters.Parameters[1], 0);
   GetPassOptionUnsigned(O, "parameter2", &m_Parameters.Parameters[2], 0);
   GetPassOptionUInt64(O, "UAVSize", &m_UAVSize, 1024 * 1024);
+  GetPassOptionUnsigned(O, "sampleEveryN", &m_SampleEveryN, 1);
+
+  int blockEntriesOnly;
+  GetPassOptionInt(O, "blockEntriesOnly", &blockEntriesOnly, 0);
+  m_BlockEntriesOnly = blockEntriesOnly != 0;
+
+  int ringBuffer;
+  GetPassOptionInt(O, "ringBuffer", &ringBuffer, 0);
+  m_RingBuffer = ringBuffer != 0;
 }
 
 uint32_t DxilDebugInstrumentation::UAVDumpingGroundOffset() {
   return static_cast<uint32_t>(m_UAVSize - DebugBufferDumpingGroundSize);
 }
 
+uint32_t DxilDebugInstrumentation::RingBufferCapacity() {
+  return static_cast<uint32_t>(PowerOf2Floor(UAVDumpingGroundOffset() - DebugRingBufferHeaderSize));
+}
+
 
 DxilDebugInstrumentation::SystemValueIndices DxilDebugInstrumentation::addRequiredSystemValues(BuilderContext &BC) {
   SystemValueIndices SVIndices{};
@@ -496,7 +531,12 @@ void DxilDebugInstrumentation::addInvocationSelectionProlog(BuilderContext &BC,
   m_OffsetMultiplicand = BC.Builder.CreateCast(Instruction::CastOps::ZExt, ParameterTestResult, Type::getInt32Ty(BC.Ctx), "OffsetMultiplicand");
   auto InverseOffsetMultiplicand = BC.Builder.CreateSub(BC.HlslOP->GetU32Const(1), m_OffsetMultiplicand, "ComplementOfMultiplicand");
   m_OffsetAddend = BC.Builder.CreateMul(BC.HlslOP->GetU32Const(UAVDumpingGroundOffset()), InverseOffsetMultiplicand, "OffsetAddend");
-  m_OffsetMask = BC.HlslOP->GetU32Const(UAVDumpingGroundOffset() - 1);
+  if (m_RingBuffer) {
+    m_OffsetMask = BC.HlslOP->GetU32Const(RingBufferCapacity() - 1);
+  }
+  else {
+    m_OffsetMask = BC.HlslOP->GetU32Const(UAVDumpingGroundOffset() - 1);
+  }
 
   m_SelectionCriterion = ParameterTestResult;
 }
@@ -540,7 +580,24 @@ void DxilDebugInstrumentation::reserveDebugEntrySpace(BuilderContext &BC, uint32
       m_InvocationId = PreviousValue;
   }
 
-  auto MaskedForLimit = BC.Builder.CreateAnd(PreviousValue, m_OffsetMask, "MaskedForUAVLimit");
+  Value * MaskedForLimit = BC.Builder.CreateAnd(PreviousValue, m_OffsetMask, "MaskedForUAVLimit");
+  if (m_RingBuffer) {
+    // Count the records that overwrite older ones. As with the increment, this is zero for
+    // uninteresting invocations.
+    auto Wrapped = BC.Builder.CreateICmpUGE(PreviousValue, BC.HlslOP->GetU32Const(RingBufferCapacity()), "RingWrapped");
+    auto WrappedAsUint = BC.Builder.CreateZExt(Wrapped, Type::getInt32Ty(BC.Ctx), "RingWrappedAsUint");
+    auto OverflowForThisInvocation = BC.Builder.CreateMul(WrappedAsUint, m_OffsetMultiplicand, "OverflowForThisInvocation");
+    (void)BC.Builder.CreateCall(AtomicOpFunc, {
+      AtomicBinOpcode,
+      m_HandleForUAV,
+      AtomicAdd,
+      BC.HlslOP->GetU32Const(DebugRingBufferOverflowCounterOffset),
+      UndefArg,
+      UndefArg,
+      OverflowForThisInvocation,
+    }, "RingOverflowResult");
+    MaskedForLimit = BC.Builder.CreateAdd(MaskedForLimit, BC.HlslOP->GetU32Const(DebugRingBufferHeaderSize), "RingOffset");
+  }
   // The return value will either end up being itself (multiplied by one and added with zero)
   // or the "dump uninteresting things here" value of (UAVSize - a bit).
   auto MultipliedForInterest = BC.Builder.CreateMul(MaskedForLimit, m_OffsetMultiplicand, "MultipliedForInterest");
@@ -636,6 +693,18 @@ void DxilDebugInstrumentation::addInvocationStartMarker(BuilderContext &BC) {
 template<typename ReturnType>
 void DxilDebugInstrumentation::addStepEntryForType(DebugShaderModifierRecordType RecordType, BuilderContext &BC, Instruction *Inst) {
 
+  // Skipped instructions still take an index, so the debugger can map recorded ones back to the shader.
+  uint32_t InstructionIndex = m_InstructionIndex++;
+  if (m_SampleEveryN > 1 && InstructionIndex % m_SampleEveryN != 0) {
+    return;
+  }
+  if (m_BlockEntriesOnly) {
+    if (Inst->getParent() == m_LastRecordedBlock) {
+      return;
+    }
+    m_LastRecordedBlock = Inst->getParent();
+  }
+
   DebugShaderModifierRecordDXILStep<ReturnType> step = {};
   reserveDebugEntrySpace(BC, sizeof(step));
 
@@ -643,7 +712,7 @@ void DxilDebugInstrumentation::addStepEntryForType(DebugShaderModifierRecordType
   step.Header.Details.Type = static_cast<uint8_t>(RecordType);
   addDebugEntryValue(BC, BC.HlslOP->GetU32Const(step.Header.u32Header));
   addDebugEntryValue(BC, m_InvocationId);
-  addDebugEntryValue(BC, BC.HlslOP->GetU32Const(m_InstructionIndex++));
+  addDebugEntryValue(BC, BC.HlslOP->GetU32Const(InstructionIndex));
 
   if (RecordType != DebugShaderModifierRecordTypeDXILStepVoid) {
     addDebugEntryValue(BC, Inst);
@@ -0,0 +1,529 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilDemotePrecision.cpp                                                   //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Computes float math that only feeds UNORM render targets in half.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilShaderModel.h"
+#include "dxc/HLSL/DxilSignatureElement.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-demote-precision"
+
+STATISTIC(NumDemoted, "Number of float operations demoted to half");
+
+namespace {
+
+// Unit roundoff of half, which has 11 significant bits, and its largest
+// finite value.
+const double kHalfRoundoff = 1.0 / 2048;
+const double kHalfMax = 65504.0;
+// An 8-bit UNORM target stores the nearest multiple of 1/255, so an error
+// below half of that changes the stored value by at most one step.
+const double kUNorm8ErrorBudget = 0.5 / 255;
+
+struct ValueBounds {
+  double Lo, Hi;
+  double MaxAbs() const { return std::max(std::fabs(Lo), std::fabs(Hi)); }
+};
+
+// Float math whose results only reach UNORM SV_Target outputs, through
+// adds, multiplies, min/max, saturate and selects, is computed in half
+// when an error bound shows the stored values stay within one UNORM8 step.
+//
+// Value ranges come from constants, saturate, and texels of resources
+// declared unorm, which are in [0, 1]. The error bound for each demoted
+// value adds the rounding of every half operation to the errors of its
+// operands, scaled by the ranges of the other operands for multiplies.
+// Values without a known range can't be demoted, except under a saturate.
+// Each connected group of demoted operations is kept only if its bound
+// holds and it has more operations than the conversions it needs.
+//
+// The demoted type is DXIL half: fp16 with -enable-16bit-types, and
+// min16float, which has at least as much precision, otherwise.
+class DxilDemotePrecision : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilDemotePrecision() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Demote Precision";
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  DxilModule *m_DM = nullptr;
+  OP *m_hlslOP = nullptr;
+  DenseMap<Value *, ValueBounds> m_Bounds;
+  DenseMap<Instruction *, double> m_Error;
+
+  bool IsDemotableOp(Instruction *I);
+  bool IsUNormTexel(Value *V);
+  bool IsUNormTargetStore(User *U, Value *V);
+  bool GetBounds(Value *V, ValueBounds &B);
+  void ComputeBounds(Instruction *I);
+  double GetOperandError(Value *V, DenseSet<Instruction *> &Region,
+                         bool UnderSaturate);
+  void ComputeError(Instruction *I, DenseSet<Instruction *> &Region);
+  Value *GetHalfOperand(Value *V, DenseMap<Value *, Value *> &Half);
+  void Demote(Instruction *I, DenseMap<Value *, Value *> &Half);
+};
+
+}
+
+static DXIL::OpCode GetDxilOpcode(Instruction *I) {
+  if (CallInst *CI = dyn_cast<CallInst>(I))
+    if (OP::IsDxilOpFuncCallInst(CI))
+      return OP::GetDxilOpFuncCallInst(CI);
+  return DXIL::OpCode::NumOpCodes;
+}
+
+bool DxilDemotePrecision::IsDemotableOp(Instruction *I) {
+  if (!I->getType()->isFloatTy())
+    return false;
+  switch (I->getOpcode()) {
+  case Instruction::FAdd:
+  case Instruction::FSub:
+  case Instruction::FMul:
+  case Instruction::Select:
+    return true;
+  default:
+    break;
+  }
+  switch (GetDxilOpcode(I)) {
+  case DXIL::OpCode::Saturate:
+  case DXIL::OpCode::FMin:
+  case DXIL::OpCode::FMax:
+  case DXIL::OpCode::FMad:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool DxilDemotePrecision::IsUNormTexel(Value *V) {
+  ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(V);
+  if (!EVI || !EVI->getType()->isFloatTy())
+    return false;
+  Instruction *ResRet = dyn_cast<Instruction>(EVI->getAggregateOperand());
+  if (!ResRet)
+    return false;
+  switch (GetDxilOpcode(ResRet)) {
+  case DXIL::OpCode::Sample:
+  case DXIL::OpCode::SampleBias:
+  case DXIL::OpCode::SampleLevel:
+  case DXIL::OpCode::SampleGrad:
+  case DXIL::OpCode::TextureLoad:
+  case DXIL::OpCode::TextureGather:
+    break;
+  default:
+    return false;
+  }
+  CallInst *Handle = dyn_cast<CallInst>(ResRet->getOperand(1));
+  if (!Handle ||
+      !m_hlslOP->IsDxilOpFuncCallInst(Handle, DXIL::OpCode::CreateHandle))
+    return false;
+  DxilInst_CreateHandle CreateHandle(Handle);
+  if (!isa<ConstantInt>(CreateHandle.get_resourceClass()) ||
+      !isa<ConstantInt>(CreateHandle.get_rangeId()))
+    return false;
+  unsigned ID = CreateHandle.get_rangeId_val();
+  switch ((DXIL::ResourceClass)CreateHandle.get_resourceClass_val()) {
+  case DXIL::ResourceClass::SRV:
+    return ID < m_DM->GetSRVs().size() &&
+           m_DM->GetSRV(ID).GetCompType().IsUNorm();
+  case DXIL::ResourceClass::UAV:
+    return ID < m_DM->GetUAVs().size() &&
+           m_DM->GetUAV(ID).GetCompType().IsUNorm();
+  default:
+    return false;
+  }
+}
+
+bool DxilDemotePrecision::IsUNormTargetStore(User *U, Value *V) {
+  CallInst *CI = dyn_cast<CallInst>(U);
+  if (!CI || !m_hlslOP->IsDxilOpFuncCallInst(CI, DXIL::OpCode::StoreOutput))
+    return false;
+  DxilInst_StoreOutput Store(CI);
+  ConstantInt *SigId = dyn_cast<ConstantInt>(Store.get_outputSigId());
+  if (Store.get_value() != V || !SigId)
+    return false;
+  DxilSignature &OutSig = m_DM->GetOutputSignature();
+  if (SigId->getZExtValue() >= OutSig.GetElements().size())
+    return false;
+  DxilSignatureElement &SE = OutSig.GetElement(SigId->getZExtValue());
+  return SE.GetKind() == DXIL::SemanticKind::Target &&
+         SE.GetCompType().IsUNorm();
+}
+
+bool DxilDemotePrecision::GetBounds(Value *V, ValueBounds &B) {
+  if (ConstantFP *C = dyn_cast<ConstantFP>(V)) {
+    double D = C->getValueAPF().convertToFloat();
+    B = {D, D};
+    return true;
+  }
+  auto It = m_Bounds.find(V);
+  if (It == m_Bounds.end())
+    return false;
+  B = It->second;
+  return true;
+}
+
+void DxilDemotePrecision::ComputeBounds(Instruction *I) {
+  if (!I->getType()->isFloatTy())
+    return;
+  if (IsUNormTexel(I)) {
+    m_Bounds[I] = {0.0, 1.0};
+    return;
+  }
+  if (!IsDemotableOp(I))
+    return;
+
+  DXIL::OpCode opcode = GetDxilOpcode(I);
+  if (opcode == DXIL::OpCode::Saturate) {
+    m_Bounds[I] = {0.0, 1.0};
+    return;
+  }
+  // Operands start after the condition for selects, and after the opcode
+  // for dx.op calls.
+  unsigned First = isa<BinaryOperator>(I) ? 0 : 1;
+  unsigned NumOps = isa<CallInst>(I) ? cast<CallInst>(I)->getNumArgOperands()
+                                     : I->getNumOperands();
+  ValueBounds Ops[3];
+  for (unsigned i = First; i < NumOps; ++i)
+    if (!GetBounds(I->getOperand(i), Ops[i - First]))
+      return;
+
+  ValueBounds &A = Ops[0], &B = Ops[1];
+  auto Mul = [](const ValueBounds &X, const ValueBounds &Y) -> ValueBounds {
+    double P[] = {X.Lo * Y.Lo, X.Lo * Y.Hi, X.Hi * Y.Lo, X.Hi * Y.Hi};
+    return {*std::min_element(P, P + 4), *std::max_element(P, P + 4)};
+  };
+  ValueBounds R;
+  switch (I->getOpcode()) {
+  case Instruction::FAdd:
+    R = {A.Lo + B.Lo, A.Hi + B.Hi};
+    break;
+  case Instruction::FSub:
+    R = {A.Lo - B.Hi, A.Hi - B.Lo};
+    break;
+  case Instruction::FMul:
+    R = Mul(A, B);
+    break;
+  case Instruction::Select:
+    R = {std::min(A.Lo, B.Lo), std::max(A.Hi, B.Hi)};
+    break;
+  default:
+    switch (opcode) {
+    case DXIL::OpCode::FMin:
+      R = {std::min(A.Lo, B.Lo), std::min(A.Hi, B.Hi)};
+      break;
+    case DXIL::OpCode::FMax:
+      R = {std::max(A.Lo, B.Lo), std::max(A.Hi, B.Hi)};
+      break;
+    default: {
+      DXASSERT(opcode == DXIL::OpCode::FMad, "else IsDemotableOp is wrong");
+      ValueBounds P = Mul(A, B);
+      R = {P.Lo + Ops[2].Lo, P.Hi + Ops[2].Hi};
+      break;
+    }
+    }
+    break;
+  }
+  m_Bounds[I] = R;
+}
+
+double DxilDemotePrecision::GetOperandError(Value *V,
+                                            DenseSet<Instruction *> &Region,
+                                            bool UnderSaturate) {
+  if (Instruction *I = dyn_cast<Instruction>(V))
+    if (Region.count(I))
+      return m_Error[I];
+
+  // The operand is converted to half.
+  if (ConstantFP *C = dyn_cast<ConstantFP>(V)) {
+    APFloat H = C->getValueAPF();
+    bool LosesInfo;
+    APFloat::opStatus Status =
+        H.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven, &LosesInfo);
+    if (Status & APFloat::opOverflow)
+      return HUGE_VAL;
+    H.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &LosesInfo);
+    return std::fabs((double)C->getValueAPF().convertToFloat() -
+                     (double)H.convertToFloat());
+  }
+  ValueBounds B;
+  if (GetBounds(V, B) && B.MaxAbs() <= kHalfMax)
+    return B.MaxAbs() * kHalfRoundoff;
+  // Saturate clamps whatever the conversion gives, including infinities, so
+  // only rounding within [0, 1] matters.
+  return UnderSaturate ? kHalfRoundoff : HUGE_VAL;
+}
+
+void DxilDemotePrecision::ComputeError(Instruction *I,
+                                       DenseSet<Instruction *> &Region) {
+  DXIL::OpCode opcode = GetDxilOpcode(I);
+  if (opcode == DXIL::OpCode::Saturate) {
+    double E = GetOperandError(I->getOperand(1), Region, true);
+    m_Error[I] = std::min(E, 1.0);
+    return;
+  }
+
+  ValueBounds R;
+  if (!GetBounds(I, R) || R.MaxAbs() > kHalfMax) {
+    m_Error[I] = HUGE_VAL;
+    return;
+  }
+  unsigned First = isa<BinaryOperator>(I) ? 0 : 1;
+  auto Err = [&](unsigned i) {
+    return GetOperandError(I->getOperand(First + i), Region, false);
+  };
+  auto MaxAbs = [&](unsigned i) {
+    ValueBounds B;
+    return GetBounds(I->getOperand(First + i), B) ? B.MaxAbs() : HUGE_VAL;
+  };
+  double Rounding = R.MaxAbs() * kHalfRoundoff;
+  double E;
+  switch (I->getOpcode()) {
+  case Instruction::FAdd:
+  case Instruction::FSub:
+    E = Err(0) + Err(1) + Rounding;
+    break;
+  case Instruction::FMul:
+    E = MaxAbs(0) * Err(1) + MaxAbs(1) * Err(0) + Err(0) * Err(1) + Rounding;
+    break;
+  case Instruction::Select:
+    E = std::max(Err(0), Err(1));
+    break;
+  default:
+    if (opcode == DXIL::OpCode::FMin || opcode == DXIL::OpCode::FMax) {
+      E = std::max(Err(0), Err(1));
+    } else {
+      // The multiply and the add of FMad may each round.
+      E = MaxAbs(0) * Err(1) + MaxAbs(1) * Err(0) + Err(0) * Err(1) +
+          MaxAbs(0) * MaxAbs(1) * kHalfRoundoff + Err(2) + Rounding;
+    }
+    break;
+  }
+  m_Error[I] = E;
+}
+
+Value *DxilDemotePrecision::GetHalfOperand(Value *V,
+                                           DenseMap<Value *, Value *> &Half) {
+  auto It = Half.find(V);
+  if (It != Half.end())
+    return It->second;
+  Type *HalfTy = Type::getHalfTy(V->getContext());
+  if (Constant *C = dyn_cast<Constant>(V))
+    return ConstantExpr::getFPTrunc(C, HalfTy);
+  // Convert next to the definition, so every demoted use can share it.
+  IRBuilder<> Builder(V->getContext());
+  if (Argument *A = dyn_cast<Argument>(V)) {
+    Builder.SetInsertPoint(
+        A->getParent()->getEntryBlock().getFirstInsertionPt());
+  } else {
+    Instruction *VI = cast<Instruction>(V);
+    if (isa<PHINode>(VI))
+      Builder.SetInsertPoint(VI->getParent()->getFirstInsertionPt());
+    else
+      Builder.SetInsertPoint(std::next(BasicBlock::iterator(VI)));
+  }
+  Value *Trunc = Builder.CreateFPTrunc(V, HalfTy);
+  Half[V] = Trunc;
+  return Trunc;
+}
+
+void DxilDemotePrecision::Demote(Instruction *I,
+                                 DenseMap<Value *, Value *> &Half) {
+  IRBuilder<> Builder(I);
+  Value *New;
+  if (BinaryOperator *BO = dyn_cast<BinaryOperator>(I)) {
+    New = Builder.CreateBinOp(BO->getOpcode(),
+                              GetHalfOperand(BO->getOperand(0), Half),
+                              GetHalfOperand(BO->getOperand(1), Half));
+    if (BinaryOperator *NewBO = dyn_cast<BinaryOperator>(New))
+      NewBO->copyIRFlags(BO);
+  } else if (SelectInst *SI = dyn_cast<SelectInst>(I)) {
+    New = Builder.CreateSelect(
+        SI->getCondition(), GetHalfOperand(SI->getTrueValue(), Half),
+        GetHalfOperand(SI->getFalseValue(), Half));
+  } else {
+    CallInst *CI = cast<CallInst>(I);
+    DXIL::OpCode opcode = OP::GetDxilOpFuncCallInst(CI);
+    Function *HalfFunc =
+        m_hlslOP->GetOpFunc(opcode, Type::getHalfTy(I->getContext()));
+    SmallVector<Value *, 4> Args;
+    Args.emplace_back(CI->getArgOperand(0));
+    for (unsigned i = 1; i < CI->getNumArgOperands(); ++i)
+      Args.emplace_back(GetHalfOperand(CI->getArgOperand(i), Half));
+    New = Builder.CreateCall(HalfFunc, Args);
+  }
+  Half[I] = New;
+}
+
+bool DxilDemotePrecision::runOnFunction(Function &F) {
+  Module *M = F.getParent();
+  if (!M->HasDxilModule() || F.isDeclaration())
+    return false;
+  m_DM = &M->GetDxilModule();
+  if (!m_DM->GetShaderModel()->IsPS())
+    return false;
+  m_hlslOP = m_DM->GetOP();
+  m_Bounds.clear();
+  m_Error.clear();
+
+  // Definitions come before their uses, except through phis, which are
+  // never demoted.
+  std::vector<Instruction *> Order;
+  DenseSet<Instruction *> Region;
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  for (BasicBlock *BB : RPOT) {
+    for (Instruction &I : *BB) {
+      ComputeBounds(&I);
+      if (IsDemotableOp(&I)) {
+        Order.emplace_back(&I);
+        Region.insert(&I);
+      }
+    }
+  }
+  if (Order.empty())
+    return false;
+
+  // Keep the operations whose users are all demoted or UNORM target stores.
+  // Users come later in the order, so one backwards walk is enough.
+  for (auto It = Order.rbegin(), E = Order.rend(); It != E; ++It) {
+    Instruction *I = *It;
+    for (User *U : I->users()) {
+      Instruction *UI = cast<Instruction>(U);
+      if (!Region.count(UI) && !IsUNormTargetStore(UI, I)) {
+        Region.erase(I);
+        break;
+      }
+    }
+  }
+
+  // Group the operations into connected components and check the bound at
+  // the stores of each.
+  DenseMap<Instruction *, Instruction *> Leader;
+  std::function<Instruction *(Instruction *)> Find =
+      [&](Instruction *I) -> Instruction * {
+    Instruction *L = Leader[I];
+    if (L == I)
+      return I;
+    return Leader[I] = Find(L);
+  };
+  for (Instruction *I : Order) {
+    if (!Region.count(I))
+      continue;
+    Leader[I] = I;
+    ComputeError(I, Region);
+    for (Value *V : I->operands()) {
+      Instruction *OpI = dyn_cast<Instruction>(V);
+      if (OpI && Region.count(OpI))
+        Leader[Find(OpI)] = Find(I);
+    }
+  }
+
+  struct Component {
+    unsigned NumOps = 0;
+    unsigned NumConversions = 0;
+    bool WithinBudget = true;
+  };
+  DenseMap<Instruction *, Component> Components;
+  SmallVector<CallInst *, 8> Stores;
+  for (Instruction *I : Order) {
+    if (!Region.count(I))
+      continue;
+    Component &C = Components[Find(I)];
+    ++C.NumOps;
+    if (m_Error[I] != m_Error[I] || m_Error[I] == HUGE_VAL)
+      C.WithinBudget = false;
+    for (Value *V : I->operands())
+      if (isa<Instruction>(V) && !Region.count(cast<Instruction>(V)) &&
+          V->getType()->isFloatTy())
+        ++C.NumConversions;
+    for (User *U : I->users()) {
+      if (Region.count(cast<Instruction>(U)))
+        continue;
+      ++C.NumConversions;
+      if (m_Error[I] > kUNorm8ErrorBudget)
+        C.WithinBudget = false;
+      Stores.emplace_back(cast<CallInst>(U));
+    }
+  }
+
+  DenseSet<Instruction *> Demoted;
+  for (Instruction *I : Order) {
+    if (!Region.count(I))
+      continue;
+    Component &C = Components[Find(I)];
+    if (C.WithinBudget && C.NumOps > C.NumConversions)
+      Demoted.insert(I);
+  }
+  if (Demoted.empty())
+    return false;
+
+  DenseMap<Value *, Value *> Half;
+  for (Instruction *I : Order)
+    if (Demoted.count(I))
+      Demote(I, Half);
+  for (CallInst *Store : Stores) {
+    DxilInst_StoreOutput StoreOutput(Store);
+    Instruction *I = cast<Instruction>(StoreOutput.get_value());
+    if (!Demoted.count(I))
+      continue;
+    IRBuilder<> Builder(Store);
+    Store->setArgOperand(DxilInst_StoreOutput::arg_value,
+                         Builder.CreateFPExt(Half[I], I->getType()));
+  }
+  for (auto It = Order.rbegin(), E = Order.rend(); It != E; ++It)
+    if (Demoted.count(*It))
+      (*It)->eraseFromParent();
+
+  NumDemoted += Demoted.size();
+  m_DM->m_ShaderFlags.SetLowPrecisionPresent(true);
+  emitOptimizationRemark(
+      F.getContext(), DEBUG_TYPE, F, DebugLoc(),
+      Twine("demoted ") + Twine(Demoted.size()) + " of " +
+          Twine(Order.size()) + " float operations in '" + F.getName() +
+          "' to " + (m_hlslOP->UseMinPrecision() ? "min16float" : "half"));
+  return true;
+}
+
+char DxilDemotePrecision::ID = 0;
+
+FunctionPass *llvm::createDxilDemotePrecisionPass() {
+  return new DxilDemotePrecision();
+}
+
+INITIALIZE_PASS(DxilDemotePrecision, "hlsl-dxil-demote-precision",
+                "DXIL Demote Precision", false, false)
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilDomTreeCache.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Dominator trees and control dependence shared between HLSL analyses.     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilDomTreeCache.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+static void GetCFG(Function &F, std::vector<const BasicBlock *> &CFG) {
+  CFG.clear();
+  for (BasicBlock &BB : F) {
+    CFG.push_back(&BB);
+    for (BasicBlock *Succ : successors(&BB))
+      CFG.push_back(Succ);
+    CFG.push_back(nullptr);
+  }
+}
+
+DxilDomTreeCache::FuncTrees &DxilDomTreeCache::GetTrees(Function &F) {
+  DXASSERT(!F.isDeclaration(), "otherwise, there is no CFG to analyze");
+  FuncTrees &Trees = m_Trees[&F];
+  // The trees only refer to blocks and edges, so they stay valid as long as
+  // the same blocks have the same successors.
+  std::vector<const BasicBlock *> CFG;
+  CFG.reserve(Trees.CFG.size());
+  GetCFG(F, CFG);
+  if (CFG != Trees.CFG) {
+    Trees.CFG.swap(CFG);
+    Trees.pDomTree.reset();
+    Trees.pPostDomTree.reset();
+    Trees.pCtrlDep.reset();
+  }
+  return Trees;
+}
+
+DxilDomTreeCache::DomTreeType &DxilDomTreeCache::GetDomTree(Function &F) {
+  FuncTrees &Trees = GetTrees(F);
+  if (!Trees.pDomTree) {
+    Trees.pDomTree = llvm::make_unique<DomTreeType>(false);
+    Trees.pDomTree->recalculate(F);
+  }
+  return *Trees.pDomTree;
+}
+
+DxilDomTreeCache::DomTreeType &DxilDomTreeCache::GetPostDomTree(Function &F) {
+  FuncTrees &Trees = GetTrees(F);
+  if (!Trees.pPostDomTree) {
+    Trees.pPostDomTree = llvm::make_unique<DomTreeType>(true);
+    Trees.pPostDomTree->recalculate(F);
+  }
+  return *Trees.pPostDomTree;
+}
+
+ControlDependence &DxilDomTreeCache::GetControlDependence(Function &F) {
+  FuncTrees &Trees = GetTrees(F);
+  if (!Trees.pCtrlDep) {
+    if (!Trees.pPostDomTree) {
+      Trees.pPostDomTree = llvm::make_unique<DomTreeType>(true);
+      Trees.pPostDomTree->recalculate(F);
+    }
+    Trees.pCtrlDep = llvm::make_unique<ControlDependence>();
+    Trees.pCtrlDep->Compute(&F, *Trees.pPostDomTree);
+  }
+  return *Trees.pCtrlDep;
+}
+
+void DxilDomTreeCache::Invalidate(Function *F) { m_Trees.erase(F); }
+
+void DxilDomTreeCache::Clear() { m_Trees.clear(); }
+
+char DxilDomTreeCachePass::ID = 0;
+
+DxilDomTreeCachePass::DxilDomTreeCachePass() : ImmutablePass(ID) {
+  initializeDxilDomTreeCachePassPass(*PassRegistry::getPassRegistry());
+}
+
+ImmutablePass *llvm::createDxilDomTreeCachePass() {
+  return new DxilDomTreeCachePass();
+}
+
+INITIALIZE_PASS(DxilDomTreeCachePass, "hlsl-dxil-domtree-cache",
+                "DXIL Dominator Tree Cache", false, true)
@@ -20,13 +20,23 @@
 #include "llvm/Pass.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
 
 using namespace llvm;
 using namespace hlsl;
 
+#define DEBUG_TYPE "dxil-eliminate-output-dynamic"
+
+STATISTIC(NumOutputSwitches, "Number of dynamic output stores switched");
+STATISTIC(NumOutputTemps, "Number of outputs written through temporaries");
+
 namespace {
 class DxilEliminateOutputDynamicIndexing : public ModulePass {
 private:
+  // Outputs with at most this many rows are stored through a switch on the
+  // row index instead of through a temporary array for each column.
+  unsigned m_MaxSwitchRows = 0;
 
 public:
   static char ID; // Pass identification, replacement for typeid
@@ -36,6 +46,10 @@ public:
     return "DXIL eliminate ouptut dynamic indexing";
   }
 
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUnsigned(O, "max-switch-rows", &m_MaxSwitchRows, 0);
+  }
+
   bool runOnModule(Module &M) override {
     DxilModule &DM = M.GetOrCreateDxilModule();
     bool bUpdated = false;
@@ -62,6 +76,7 @@ public:
 private:
   bool EliminateDynamicOutput(hlsl::OP *hlslOP, DXIL::OpCode opcode, DxilSignature &outputSig, Function *Entry);
   void ReplaceDynamicOutput(ArrayRef<Value *> tmpSigElts, Value * sigID, Value *zero, Function *F);
+  void SwitchDynamicOutput(unsigned row, Value *sigID, Function *F);
   void StoreTmpSigToOutput(ArrayRef<Value *> tmpSigElts, unsigned row,
                            Value *opcode, Value *sigID, Function *StoreOutput,
                            Function *Entry);
@@ -134,6 +149,16 @@ bool DxilEliminateOutputDynamicIndexing::EliminateDynamicOutput(
     DxilSignatureElement &sigElt = outputSig.GetElement(ID);
     unsigned row = sigElt.GetRows();
     unsigned col = sigElt.GetCols();
+    Function *F = hlslOP->GetOpFunc(opcode, EltTy);
+
+    if (row <= m_MaxSwitchRows) {
+      SwitchDynamicOutput(row, sigID, F);
+      continue;
+    }
+
+    DEBUG(dbgs() << "Output " << sigElt.GetName() << " with " << row
+                 << " rows written through temporaries\n");
+    ++NumOutputTemps;
     Type *AT = ArrayType::get(EltTy, row);
 
     std::vector<Value *> tmpSigElts(col);
@@ -142,7 +167,6 @@ bool DxilEliminateOutputDynamicIndexing::EliminateDynamicOutput(
       tmpSigElts[c] = newCol;
     }
 
-    Function *F = hlslOP->GetOpFunc(opcode, EltTy);
     // Change store output to store tmpSigElts.
     ReplaceDynamicOutput(tmpSigElts, sigID, zero, F);
     // Store tmpSigElts to Output before return.
@@ -170,6 +194,45 @@ void DxilEliminateOutputDynamicIndexing::ReplaceDynamicOutput(
   }
 }
 
+void DxilEliminateOutputDynamicIndexing::SwitchDynamicOutput(unsigned row,
+                                                             Value *sigID,
+                                                             Function *F) {
+  std::vector<CallInst *> dynamicStores;
+  for (User *U : F->users()) {
+    CallInst *CI = cast<CallInst>(U);
+    DxilOutputStore store(CI);
+    if (sigID == store.get_outputSigId() && !isa<ConstantInt>(store.get_rowIndex()))
+      dynamicStores.emplace_back(CI);
+  }
+
+  // Change
+  //   storeOutput(sigID, r, col, val)
+  // into
+  //   switch r: case 0: storeOutput(sigID, 0, col, val) ... case row-1: ...
+  // Rows out of range are undefined, so the default case stores nothing.
+  for (CallInst *CI : dynamicStores) {
+    BasicBlock *BB = CI->getParent();
+    BasicBlock *EndBB = BB->splitBasicBlock(CI, "output.switch.end");
+    BB->getTerminator()->eraseFromParent();
+
+    Value *r = CI->getArgOperand(DXIL::OperandIndex::kStoreOutputRowOpIdx);
+    SwitchInst *Switch = SwitchInst::Create(r, EndBB, row, BB);
+    for (unsigned i = 0; i < row; i++) {
+      BasicBlock *CaseBB = BasicBlock::Create(
+          CI->getContext(), "output.switch.case", BB->getParent(), EndBB);
+      IRBuilder<> Builder(CaseBB);
+      CallInst *RowCI = cast<CallInst>(CI->clone());
+      RowCI->setArgOperand(DXIL::OperandIndex::kStoreOutputRowOpIdx,
+                           Builder.getInt32(i));
+      Builder.Insert(RowCI);
+      Builder.CreateBr(EndBB);
+      Switch->addCase(Builder.getInt32(i), CaseBB);
+    }
+    CI->eraseFromParent();
+    ++NumOutputSwitches;
+  }
+}
+
 void DxilEliminateOutputDynamicIndexing::StoreTmpSigToOutput(
     ArrayRef<Value *> tmpSigElts, unsigned row, Value *opcode, Value *sigID,
     Function *StoreOutput, Function *Entry) {
@@ -0,0 +1,272 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilEliminateRedundantBarriers.cpp                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Removes barriers that don't order any memory accesses.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include <unordered_map>
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-eliminate-redundant-barriers"
+
+STATISTIC(NumBarriersRemoved, "Number of redundant barriers removed");
+STATISTIC(NumBarriersNarrowed, "Number of barriers with fences removed");
+
+namespace {
+
+// Memory a barrier can fence, as a mask of BarrierMode fence bits.
+const unsigned kTGSMAccess = (unsigned)DXIL::BarrierMode::TGSMFence;
+const unsigned kUAVAccess = (unsigned)DXIL::BarrierMode::UAVFenceGlobal |
+                            (unsigned)DXIL::BarrierMode::UAVFenceThreadGroup;
+const unsigned kSync = (unsigned)DXIL::BarrierMode::SyncThreadGroup;
+
+// HLSL code often has more barriers than its shared memory accesses need,
+// and each one is a sync stall. A fence is dropped from a barrier when no
+// access of the memory it fences happens before it or none happens after
+// it in the function, and a barrier is removed when its fences are covered
+// by the previous barrier in the block with no such access in between.
+// Only the entry function sees all of the shader's accesses, so fences are
+// only dropped there.
+class DxilEliminateRedundantBarriers : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilEliminateRedundantBarriers() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Eliminate Redundant Barriers";
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool DropUnorderedFences(Function &F);
+  bool RemoveCoveredBarriers(BasicBlock &BB);
+};
+
+}
+
+// Returns the kinds of memory I accesses, as fence bits.
+static unsigned GetAccessMask(Instruction &I) {
+  if (!I.mayReadOrWriteMemory())
+    return 0;
+  Value *Ptr = nullptr;
+  if (LoadInst *LI = dyn_cast<LoadInst>(&I))
+    Ptr = LI->getPointerOperand();
+  else if (StoreInst *SI = dyn_cast<StoreInst>(&I))
+    Ptr = SI->getPointerOperand();
+  else if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(&I))
+    Ptr = RMW->getPointerOperand();
+  else if (AtomicCmpXchgInst *CX = dyn_cast<AtomicCmpXchgInst>(&I))
+    Ptr = CX->getPointerOperand();
+  if (Ptr) {
+    if (Ptr->getType()->getPointerAddressSpace() == DXIL::kTGSMAddrSpace)
+      return kTGSMAccess;
+    // Locals and static globals are private to the thread.
+    return 0;
+  }
+
+  if (OP::IsDxilOpFuncCallInst(&I)) {
+    switch (OP::GetDxilOpFuncCallInst(&I)) {
+    case DXIL::OpCode::Barrier:
+      return 0;
+    // Constant buffers are never written.
+    case DXIL::OpCode::CBufferLoad:
+    case DXIL::OpCode::CBufferLoadLegacy:
+      return 0;
+    default:
+      return kUAVAccess;
+    }
+  }
+  // Calls to other functions may access anything.
+  return kTGSMAccess | kUAVAccess;
+}
+
+static bool IsBarrier(Instruction &I) {
+  return OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::Barrier);
+}
+
+static bool HasConstMode(CallInst *CI) {
+  return isa<ConstantInt>(
+      CI->getArgOperand(DxilInst_Barrier::arg_barrierMode));
+}
+
+static unsigned GetMode(CallInst *CI) {
+  return DxilInst_Barrier(CI).get_barrierMode_val();
+}
+
+bool DxilEliminateRedundantBarriers::DropUnorderedFences(Function &F) {
+  // Collect the accesses in each block, and the barriers.
+  std::unordered_map<BasicBlock *, unsigned> blockAccess;
+  std::vector<CallInst *> barriers;
+  for (BasicBlock &BB : F) {
+    unsigned mask = 0;
+    for (Instruction &I : BB) {
+      mask |= GetAccessMask(I);
+      if (IsBarrier(I) && HasConstMode(cast<CallInst>(&I)))
+        barriers.emplace_back(cast<CallInst>(&I));
+    }
+    blockAccess[&BB] = mask;
+  }
+
+  // Accesses in the blocks that reach BB, and in those BB reaches. BB
+  // itself counts only if it is on a cycle.
+  auto collect = [&](BasicBlock *BB, bool bForward) {
+    unsigned mask = 0;
+    SmallPtrSet<BasicBlock *, 16> visited;
+    SmallVector<BasicBlock *, 16> worklist;
+    auto push = [&](BasicBlock *Next) {
+      if (visited.insert(Next).second) {
+        mask |= blockAccess[Next];
+        worklist.push_back(Next);
+      }
+    };
+    if (bForward) {
+      for (BasicBlock *Succ : successors(BB))
+        push(Succ);
+    } else {
+      for (BasicBlock *Pred : predecessors(BB))
+        push(Pred);
+    }
+    while (!worklist.empty()) {
+      BasicBlock *Cur = worklist.pop_back_val();
+      if (bForward) {
+        for (BasicBlock *Succ : successors(Cur))
+          push(Succ);
+      } else {
+        for (BasicBlock *Pred : predecessors(Cur))
+          push(Pred);
+      }
+    }
+    return mask;
+  };
+
+  bool bChanged = false;
+  std::unordered_map<BasicBlock *, unsigned> reachedFrom, reaching;
+  for (CallInst *CI : barriers) {
+    BasicBlock *BB = CI->getParent();
+    if (!reaching.count(BB)) {
+      reaching[BB] = collect(BB, /*bForward*/ false);
+      reachedFrom[BB] = collect(BB, /*bForward*/ true);
+    }
+    unsigned before = reaching[BB];
+    unsigned after = reachedFrom[BB];
+    bool bAfter = false;
+    for (Instruction &I : *BB) {
+      if (&I == CI)
+        bAfter = true;
+      else if (bAfter)
+        after |= GetAccessMask(I);
+      else
+        before |= GetAccessMask(I);
+    }
+
+    unsigned mode = GetMode(CI);
+    unsigned fences = mode & ~kSync;
+    unsigned needed = fences & before & after;
+    if (needed == fences)
+      continue;
+    if (needed == 0) {
+      CI->eraseFromParent();
+      ++NumBarriersRemoved;
+    } else {
+      // Only a fence bit is cleared, so the mode stays valid.
+      DxilInst_Barrier(CI).set_barrierMode_val(needed | (mode & kSync));
+      ++NumBarriersNarrowed;
+    }
+    bChanged = true;
+  }
+  return bChanged;
+}
+
+bool DxilEliminateRedundantBarriers::RemoveCoveredBarriers(BasicBlock &BB) {
+  const unsigned uglobal = (unsigned)DXIL::BarrierMode::UAVFenceGlobal;
+  bool bChanged = false;
+  CallInst *Prior = nullptr;
+  unsigned between = 0;
+  for (auto It = BB.begin(), E = BB.end(); It != E;) {
+    Instruction &I = *(It++);
+    if (!IsBarrier(I)) {
+      between |= GetAccessMask(I);
+      continue;
+    }
+    CallInst *CI = cast<CallInst>(&I);
+    if (!HasConstMode(CI)) {
+      Prior = nullptr;
+      continue;
+    }
+    if (Prior) {
+      unsigned priorMode = GetMode(Prior);
+      unsigned mode = GetMode(CI);
+      // A global UAV fence covers a group one.
+      unsigned covered = priorMode;
+      if (priorMode & uglobal)
+        covered |= kUAVAccess;
+      if (between == 0) {
+        // Nothing happens in between, so one barrier can do both.
+        unsigned merged = priorMode | mode;
+        if (merged & uglobal)
+          merged &= ~(unsigned)DXIL::BarrierMode::UAVFenceThreadGroup;
+        DxilInst_Barrier(Prior).set_barrierMode_val(merged);
+        CI->eraseFromParent();
+        ++NumBarriersRemoved;
+        bChanged = true;
+        continue;
+      }
+      unsigned fences = mode & ~kSync;
+      if ((mode & kSync) <= (priorMode & kSync) &&
+          (fences & ~covered) == 0 && (fences & between) == 0) {
+        CI->eraseFromParent();
+        ++NumBarriersRemoved;
+        bChanged = true;
+        continue;
+      }
+    }
+    Prior = CI;
+    between = 0;
+  }
+  return bChanged;
+}
+
+bool DxilEliminateRedundantBarriers::runOnFunction(Function &F) {
+  bool bChanged = false;
+  for (BasicBlock &BB : F)
+    bChanged |= RemoveCoveredBarriers(BB);
+
+  Module *M = F.getParent();
+  if (M->HasDxilModule()) {
+    DxilModule &DM = M->GetDxilModule();
+    if (!DM.GetShaderModel()->IsLib() && DM.GetEntryFunction() == &F)
+      bChanged |= DropUnorderedFences(F);
+  }
+  return bChanged;
+}
+
+char DxilEliminateRedundantBarriers::ID = 0;
+
+FunctionPass *llvm::createDxilEliminateRedundantBarriersPass() {
+  return new DxilEliminateRedundantBarriers();
+}
+
+INITIALIZE_PASS(DxilEliminateRedundantBarriers,
+                "hlsl-dxil-eliminate-redundant-barriers",
+                "DXIL Eliminate Redundant Barriers", false, false)
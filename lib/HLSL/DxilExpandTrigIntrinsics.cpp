@@ -37,7 +37,15 @@
 // 
 // The approximation functions mostly come from [ADC]. The approximations
 // are also referenced in [HMF], but they give original credit to [ADC].
-// 
+//
+// Precision tiers
+// ---------------------------------------------------------------------------
+// The fp-speed option trades accuracy for fewer instructions. The precise
+// tier uses the expansions described below. The balanced and fast tiers use
+// polynomials with fewer terms for asin, acos and atan, and compute e^-x as
+// 1/e^x for the hyperbolic functions. Instructions marked precise always use
+// the precise tier.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/DxilGenerationPass.h"
@@ -52,6 +60,7 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringSwitch.h"
 
 #include <cmath>
 #include <utility>
@@ -62,14 +71,27 @@ using namespace hlsl;
 namespace {
 class DxilExpandTrigIntrinsics : public FunctionPass {
 private:
+  DXIL::FPSpeed m_FPSpeed;
+  // Tier used for the intrinsic being expanded.
+  DXIL::FPSpeed m_Speed = DXIL::FPSpeed::Precise;
 
 public:
   static char ID; // Pass identification, replacement for typeid
-  explicit DxilExpandTrigIntrinsics() : FunctionPass(ID) {}
+  explicit DxilExpandTrigIntrinsics(DXIL::FPSpeed FPSpeed = DXIL::FPSpeed::Precise)
+      : FunctionPass(ID), m_FPSpeed(FPSpeed) {}
 
   const char *getPassName() const override {
     return "DXIL expand trig intrinsics";
   }
+
+  void applyOptions(PassOptions O) override {
+    StringRef Speed;
+    if (GetPassOption(O, "fp-speed", &Speed))
+      m_FPSpeed = StringSwitch<DXIL::FPSpeed>(Speed.lower())
+                      .Case("balanced", DXIL::FPSpeed::Balanced)
+                      .Case("fast", DXIL::FPSpeed::Fast)
+                      .Default(DXIL::FPSpeed::Precise);
+  }
   
   bool runOnFunction(Function &F) override;
   
@@ -153,7 +175,9 @@ static void setPreciseBuilder(IRBuilder<> &builder, bool precise) {
 void DxilExpandTrigIntrinsics::prepareBuilderToExpandIntrinsic(IRBuilder<> &builder, CallInst *intrinsic) {
   DxilModule &DM = intrinsic->getModule()->GetOrCreateDxilModule();
   builder.SetInsertPoint(intrinsic);
-  setPreciseBuilder(builder, DM.IsPrecise(intrinsic));
+  const bool precise = DM.IsPrecise(intrinsic);
+  setPreciseBuilder(builder, precise);
+  m_Speed = precise ? DXIL::FPSpeed::Precise : m_FPSpeed;
 }
   
 bool DxilExpandTrigIntrinsics::expandTrigIntrinsics(DxilModule &DM, const IntrinsicList &worklist) {
@@ -220,25 +244,30 @@ static Value *emitSqrt(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name)
 //         = a0 + x(a1 + a2x + a3x^2)
 //         = a0 + x(a1 + x(a2 + a3x))
 //
-static Value *emitSqrt1mXtimesPsiX(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name) {
+// The balanced tier drops a3 (|e| <= 3.3e-4) and the fast tier also drops a2
+// (|e| <= 3.2e-3), with the minimax coefficients for each.
+//
+static Value *emitSqrt1mXtimesPsiX(IRBuilder<> &builder, Value *X, OP *dxOp, DXIL::FPSpeed speed, StringRef name) {
+  // Coefficients from the highest degree down.
+  static const double precise[]  = { -0.0187293, 0.0742610, -0.2121144, 1.5707288 };
+  static const double balanced[] = { 0.0513895, -0.2054975, 1.5704703 };
+  static const double fast[]     = { -0.1682581, 1.5675894 };
+  ArrayRef<double> a = speed == DXIL::FPSpeed::Fast     ? makeArrayRef(fast)
+                     : speed == DXIL::FPSpeed::Balanced ? makeArrayRef(balanced)
+                                                        : makeArrayRef(precise);
   Value *One = ConstantFP::get(X->getType(), 1.0);
-  Value *a0 = ConstantFP::get(X->getType(),  1.5707288);
-  Value *a1 = ConstantFP::get(X->getType(), -0.2121144);
-  Value *a2 = ConstantFP::get(X->getType(),  0.0742610);
-  Value *a3 = ConstantFP::get(X->getType(), -0.0187293);
-
 
   // sqrt(1-x)
   Value *r1 = builder.CreateFSub(One, X, name);
   Value *r2 = emitSqrt(builder, r1, dxOp, name);
 
   // psi*(x)
-  Value *r3 = builder.CreateFMul(X,  a3, name);
-         r3 = builder.CreateFAdd(r3, a2, name);
-         r3 = builder.CreateFMul(X,  r3, name);
-         r3 = builder.CreateFAdd(r3, a1, name);
-         r3 = builder.CreateFMul(X,  r3, name);
-         r3 = builder.CreateFAdd(r3, a0, name);
+  Value *r3 = builder.CreateFMul(X, ConstantFP::get(X->getType(), a[0]), name);
+  for (unsigned i = 1; i < a.size(); ++i) {
+    r3 = builder.CreateFAdd(r3, ConstantFP::get(X->getType(), a[i]), name);
+    if (i + 1 < a.size())
+      r3 = builder.CreateFMul(X, r3, name);
+  }
 
   // sqrt(1-x) * psi*(x)
   Value *r4 = builder.CreateFMul(r2, r3,  name);
@@ -254,12 +283,18 @@ static Value *emitSqrt1mXtimesPsiX(IRBuilder<> &builder, Value *X, OP *dxOp, Str
 //
 //  e^x = 2^{x * log_2(e)}
 //
-static std::pair<Value *, Value *> emitExEmx(IRBuilder<> &builder, Value *X, OP *dxOp, StringRef name) {
+// The balanced and fast tiers compute e^-x as 1/e^x, trading the second
+// exponential for a division.
+//
+static std::pair<Value *, Value *> emitExEmx(IRBuilder<> &builder, Value *X, OP *dxOp, DXIL::FPSpeed speed, StringRef name) {
   Value *Zero  = ConstantFP::get(X->getType(), 0.0);
+  Value *One   = ConstantFP::get(X->getType(), 1.0);
   Value *Log2e = ConstantFP::get(X->getType(), math::LOG2E);
 
   Value *r0 = builder.CreateFMul(X, Log2e, name);
   Value *r1 = emitUnaryFloat(builder, r0, dxOp, OP::OpCode::Exp, name);
+  if (speed != DXIL::FPSpeed::Precise)
+    return std::make_pair(r1, builder.CreateFDiv(One, r1, name));
   Value *r2 = builder.CreateFSub(Zero, r0, name);
   Value *r3 = emitUnaryFloat(builder, r2, dxOp, OP::OpCode::Exp, name);
 
@@ -306,7 +341,7 @@ Value *DxilExpandTrigIntrinsics::expandASin(IRBuilder<> &builder, DxilInst_Asin
   Value *absX = emitFAbs(builder, X, DM.GetOP(), name);
 
   // Approximation
-  Value *psiX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), name);
+  Value *psiX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), m_Speed, name);
   Value *asinX = builder.CreateFSub(PI_2, psiX, name);
   Value *asinmX = builder.CreateFSub(Zero, asinX, name);
 
@@ -350,7 +385,7 @@ Value *DxilExpandTrigIntrinsics::expandACos(IRBuilder<> &builder, DxilInst_Acos
   Value *absX = emitFAbs(builder, X, DM.GetOP(), name);
 
   // Approximation
-  Value *acosX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), name);
+  Value *acosX = emitSqrt1mXtimesPsiX(builder, absX, DM.GetOP(), m_Speed, name);
   Value *acosmX = builder.CreateFSub(PI, acosX, name);
 
   // Range expansion to [-1, 1]
@@ -400,18 +435,23 @@ Value *DxilExpandTrigIntrinsics::expandACos(IRBuilder<> &builder, DxilInst_Acos
 // To expand the range we check if x > 1 then subtracted the computed value from
 // pi/2 and if x is negative then negate the final value.
 //
+// The balanced tier uses c1x + c3x^3 + c5x^5 (|e| <= 6.1e-4) and the fast
+// tier c1x + c3x^3 (|e| <= 5.0e-3), with the minimax coefficients for each.
+//
 Value *DxilExpandTrigIntrinsics::expandATan(IRBuilder<> &builder, DxilInst_Atan atan, DxilModule &DM) {
   assert(atan);
+  // Coefficients from the highest degree down.
+  static const double precise[]  = { 0.0208351, -0.0851330, 0.1801410, -0.3302995, 0.9998660 };
+  static const double balanced[] = { 0.0793390, -0.2886902, 0.9953580 };
+  static const double fast[]     = { -0.1919480, 0.9723941 };
+  ArrayRef<double> c = m_Speed == DXIL::FPSpeed::Fast     ? makeArrayRef(fast)
+                     : m_Speed == DXIL::FPSpeed::Balanced ? makeArrayRef(balanced)
+                                                          : makeArrayRef(precise);
   StringRef name  = "atan.x";
   Value *X = atan.get_value();
   Value *PI_2 = ConstantFP::get(X->getType(), math::PI_2);
   Value *One  = ConstantFP::get(X->getType(), 1.0);
   Value *Zero = ConstantFP::get(X->getType(), 0.0);
-  Value *c1 = ConstantFP::get(X->getType(),  0.9998660);
-  Value *c3 = ConstantFP::get(X->getType(), -0.3302995);
-  Value *c5 = ConstantFP::get(X->getType(),  0.1801410);
-  Value *c7 = ConstantFP::get(X->getType(), -0.0851330);
-  Value *c9 = ConstantFP::get(X->getType(),  0.0208351);
 
   // Range reduction to [0, inf]
   Value *absX = emitFAbs(builder, X, DM.GetOP(), name);
@@ -423,15 +463,13 @@ Value *DxilExpandTrigIntrinsics::expandATan(IRBuilder<> &builder, DxilInst_Atan
 
   // Approximate
   Value *r3 = builder.CreateFMul(r2, r2, name);
-  Value *r4 = builder.CreateFMul(r3, c9, name);
-         r4 = builder.CreateFAdd(r4, c7, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c5, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c3, name);
-         r4 = builder.CreateFMul(r4, r3, name);
-         r4 = builder.CreateFAdd(r4, c1, name);
-         r4 = builder.CreateFMul(r2, r4, name);
+  Value *r4 = builder.CreateFMul(r3, ConstantFP::get(X->getType(), c[0]), name);
+  for (unsigned i = 1; i < c.size(); ++i) {
+    r4 = builder.CreateFAdd(r4, ConstantFP::get(X->getType(), c[i]), name);
+    if (i + 1 < c.size())
+      r4 = builder.CreateFMul(r4, r3, name);
+  }
+  r4 = builder.CreateFMul(r2, r4, name);
 
   // Range Expansion to [0, inf]
   Value *r5 = builder.CreateFSub(PI_2, r4, name);
@@ -460,7 +498,7 @@ Value *DxilExpandTrigIntrinsics::expandHCos(IRBuilder<> &builder, DxilInst_Hcos
   Value *X = hcos.get_value();
   Value *Two = ConstantFP::get(X->getType(), 2.0);
 
-  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
+  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), m_Speed, name);
   Value *r4 = builder.CreateFAdd(eX, emX, name);
   Value *r  = builder.CreateFDiv(r4, Two, name);
 
@@ -482,7 +520,7 @@ Value *DxilExpandTrigIntrinsics::expandHSin(IRBuilder<> &builder, DxilInst_Hsin
   Value *X = hsin.get_value();
   Value *Two = ConstantFP::get(X->getType(), 2.0);
 
-  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
+  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), m_Speed, name);
   Value *r4 = builder.CreateFSub(eX, emX, name);
   Value *r  = builder.CreateFDiv(r4, Two, name);
 
@@ -497,13 +535,30 @@ Value *DxilExpandTrigIntrinsics::expandHSin(IRBuilder<> &builder, DxilInst_Hsin
 //
 // No range reduction is needed.
 //
+// The balanced and fast tiers use the identity
+//
+//    tanh(x) = 1 - 2 / (e^2x + 1)
+//
+// which needs a single exponential.
+//
 Value *DxilExpandTrigIntrinsics::expandHTan(IRBuilder<> &builder, DxilInst_Htan htan, DxilModule &DM) {
   assert(htan);
   StringRef name = "htan.x";
   Value *eX, *emX;
   Value *X = htan.get_value();
 
-  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), name);
+  if (m_Speed != DXIL::FPSpeed::Precise) {
+    Value *One   = ConstantFP::get(X->getType(), 1.0);
+    Value *Two   = ConstantFP::get(X->getType(), 2.0);
+    Value *Log2e = ConstantFP::get(X->getType(), 2.0 * math::LOG2E);
+    Value *r0 = builder.CreateFMul(X, Log2e, name);
+    Value *r1 = emitUnaryFloat(builder, r0, DM.GetOP(), OP::OpCode::Exp, name);
+    Value *r2 = builder.CreateFAdd(r1, One, name);
+    Value *r3 = builder.CreateFDiv(Two, r2, name);
+    return builder.CreateFSub(One, r3, name);
+  }
+
+  std::tie(eX, emX) = emitExEmx(builder, X, DM.GetOP(), m_Speed, name);
   Value *r4 = builder.CreateFSub(eX, emX, name);
   Value *r5 = builder.CreateFAdd(eX, emX, name);
   Value *r  = builder.CreateFDiv(r4, r5, name);
@@ -534,8 +589,8 @@ Value *DxilExpandTrigIntrinsics::expandTan(IRBuilder<> &builder,
 
 char DxilExpandTrigIntrinsics::ID = 0;
 
-FunctionPass *llvm::createDxilExpandTrigIntrinsicsPass() {
-  return new DxilExpandTrigIntrinsics();
+FunctionPass *llvm::createDxilExpandTrigIntrinsicsPass(unsigned FPSpeed) {
+  return new DxilExpandTrigIntrinsics((DXIL::FPSpeed)FPSpeed);
 }
 
 INITIALIZE_PASS(DxilExpandTrigIntrinsics,
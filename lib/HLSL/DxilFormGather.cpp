@@ -0,0 +1,271 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilFormGather.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Replaces four point samples of a 2x2 texel block with one gather.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilShaderModel.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include <map>
+#include <tuple>
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-form-gather"
+
+STATISTIC(NumGathersFormed, "Number of gathers formed from SampleLevel calls");
+
+namespace {
+
+// Filter kernels read a 2x2 texel block with four SampleLevel calls at LOD 0
+// that differ only by constant offsets and each use one channel. With a
+// point-filtered sampler, the four results are the texels a gather of that
+// channel returns when its coordinate is moved to the corner between them:
+// a gather fetches the block whose top-left texel is floor(uv * size - 0.5),
+// and a point sample the texel floor(uv * size), so the gather coordinate is
+// (floor(uv * size) + 1) / size.
+//
+// The compiler can't see the sampler's filter, and with linear filtering the
+// samples blend texels, so the pass only runs with -gather-point-samples.
+// TextureLoad has no sampler to gather with and is left alone.
+class DxilFormGather : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilFormGather() : ModulePass(ID) {}
+
+  const char *getPassName() const override { return "DXIL Form Gather"; }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  // Handle, sampler, u, v and channel of the samples of a block.
+  typedef std::tuple<Value *, Value *, Value *, Value *, unsigned> SampleKey;
+  typedef std::pair<int, int> TexelOffset;
+  typedef std::pair<Value *, Value *> TextureSize;
+
+  bool FormGathers(BasicBlock &BB, DxilModule &DM);
+  TextureSize GetTextureSize(Value *Handle, Instruction *InsertPt,
+                             OP *hlslOP);
+
+  DenseMap<Value *, TextureSize> m_sizes;
+};
+
+}
+
+// Returns the offset of a SampleLevel call; a missing offset is undef.
+static bool GetConstOffset(Value *V, int &Offset) {
+  if (isa<UndefValue>(V)) {
+    Offset = 0;
+    return true;
+  }
+  ConstantInt *C = dyn_cast<ConstantInt>(V);
+  if (!C)
+    return false;
+  Offset = (int)C->getSExtValue();
+  return true;
+}
+
+static bool IsTexture2DHandle(Value *V, DxilModule &DM) {
+  CallInst *CI = dyn_cast<CallInst>(V);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CreateHandle))
+    return false;
+  DxilInst_CreateHandle CH(CI);
+  ConstantInt *Class = dyn_cast<ConstantInt>(CH.get_resourceClass());
+  ConstantInt *RangeId = dyn_cast<ConstantInt>(CH.get_rangeId());
+  if (!Class || !RangeId ||
+      Class->getZExtValue() != (unsigned)DXIL::ResourceClass::SRV ||
+      RangeId->getZExtValue() >= DM.GetSRVs().size())
+    return false;
+  return DM.GetSRV(RangeId->getZExtValue()).GetKind() ==
+         DXIL::ResourceKind::Texture2D;
+}
+
+// Returns the channel of the result of CI if that is all of it used.
+static bool GetSingleChannel(CallInst *CI, unsigned &Channel) {
+  bool bFound = false;
+  for (User *U : CI->users()) {
+    ExtractValueInst *EV = dyn_cast<ExtractValueInst>(U);
+    if (!EV || EV->getNumIndices() != 1 || EV->getIndices()[0] > 3)
+      return false;
+    if (bFound && EV->getIndices()[0] != Channel)
+      return false;
+    Channel = EV->getIndices()[0];
+    bFound = true;
+  }
+  return bFound;
+}
+
+DxilFormGather::TextureSize
+DxilFormGather::GetTextureSize(Value *Handle, Instruction *InsertPt,
+                               OP *hlslOP) {
+  // InsertPt is the first sample of the handle in the block, so the size
+  // dominates all the gathers formed there.
+  auto It = m_sizes.find(Handle);
+  if (It != m_sizes.end())
+    return It->second;
+
+  IRBuilder<> Builder(InsertPt);
+  Function *F = hlslOP->GetOpFunc(OP::OpCode::GetDimensions,
+                                  Type::getVoidTy(InsertPt->getContext()));
+  Value *Dims = Builder.CreateCall(
+      F, {hlslOP->GetU32Const((unsigned)OP::OpCode::GetDimensions), Handle,
+          hlslOP->GetU32Const(0)});
+  Type *FloatTy = Builder.getFloatTy();
+  TextureSize Size(
+      Builder.CreateUIToFP(Builder.CreateExtractValue(Dims, 0), FloatTy),
+      Builder.CreateUIToFP(Builder.CreateExtractValue(Dims, 1), FloatTy));
+  m_sizes[Handle] = Size;
+  return Size;
+}
+
+// Returns (floor(Coord * Size) + 1) / Size.
+static Value *GetGatherCoord(Value *Coord, Value *Size, IRBuilder<> &Builder,
+                             OP *hlslOP) {
+  Value *Texel = Builder.CreateFMul(Coord, Size);
+  Function *Floor =
+      hlslOP->GetOpFunc(OP::OpCode::Round_ni, Builder.getFloatTy());
+  Texel = Builder.CreateCall(
+      Floor, {hlslOP->GetU32Const((unsigned)OP::OpCode::Round_ni), Texel});
+  Texel = Builder.CreateFAdd(Texel, ConstantFP::get(Builder.getFloatTy(), 1.0));
+  return Builder.CreateFDiv(Texel, Size);
+}
+
+bool DxilFormGather::FormGathers(BasicBlock &BB, DxilModule &DM) {
+  OP *hlslOP = DM.GetOP();
+  MapVector<SampleKey, std::map<TexelOffset, CallInst *>> SamplesByKey;
+  DenseMap<CallInst *, unsigned> Order;
+  DenseMap<Value *, CallInst *> FirstSample;
+  for (Instruction &I : BB) {
+    if (!OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::SampleLevel))
+      continue;
+    CallInst *CI = cast<CallInst>(&I);
+    DxilInst_SampleLevel Sample(CI);
+    ConstantFP *LOD = dyn_cast<ConstantFP>(Sample.get_LOD());
+    int OffsetX, OffsetY;
+    unsigned Channel;
+    if (!LOD || !LOD->isZero() || !isa<UndefValue>(Sample.get_coord2()) ||
+        !GetConstOffset(Sample.get_offset0(), OffsetX) ||
+        !GetConstOffset(Sample.get_offset1(), OffsetY) ||
+        !IsTexture2DHandle(Sample.get_srv(), DM) ||
+        !GetSingleChannel(CI, Channel))
+      continue;
+    SampleKey Key(Sample.get_srv(), Sample.get_sampler(), Sample.get_coord0(),
+                  Sample.get_coord1(), Channel);
+    // A repeated offset is left for CSE; the first sample stands for it.
+    SamplesByKey[Key].insert(
+        std::make_pair(TexelOffset(OffsetX, OffsetY), CI));
+    unsigned Index = Order.size();
+    Order[CI] = Index;
+    FirstSample.insert(std::make_pair(Sample.get_srv(), CI));
+  }
+
+  bool bChanged = false;
+  for (auto &It : SamplesByKey) {
+    std::map<TexelOffset, CallInst *> &Samples = It.second;
+    if (Samples.size() < 4)
+      continue;
+    // Each block is found from its top-left texel.
+    for (auto &S : Samples) {
+      int X = S.first.first, Y = S.first.second;
+      // The texels in gather component order.
+      TexelOffset Texels[4] = {TexelOffset(X, Y + 1), TexelOffset(X + 1, Y + 1),
+                               TexelOffset(X + 1, Y), TexelOffset(X, Y)};
+      CallInst *Block[4];
+      bool bComplete = true;
+      for (unsigned i = 0; i < 4 && bComplete; ++i) {
+        auto Found = Samples.find(Texels[i]);
+        bComplete = Found != Samples.end() && Found->second;
+        if (bComplete)
+          Block[i] = Found->second;
+      }
+      if (!bComplete)
+        continue;
+
+      CallInst *First = Block[0];
+      for (CallInst *CI : Block) {
+        if (Order[CI] < Order[First])
+          First = CI;
+      }
+      DxilInst_SampleLevel Sample(First);
+      TextureSize Size = GetTextureSize(Sample.get_srv(),
+                                        FirstSample[Sample.get_srv()], hlslOP);
+      IRBuilder<> Builder(First);
+      Value *U = GetGatherCoord(Sample.get_coord0(), Size.first, Builder,
+                                hlslOP);
+      Value *V = GetGatherCoord(Sample.get_coord1(), Size.second, Builder,
+                                hlslOP);
+      Function *Gather = hlslOP->GetOpFunc(
+          OP::OpCode::TextureGather,
+          First->getType()->getStructElementType(0));
+      Value *Undef = UndefValue::get(Builder.getFloatTy());
+      Value *Result = Builder.CreateCall(
+          Gather, {hlslOP->GetU32Const((unsigned)OP::OpCode::TextureGather),
+                   Sample.get_srv(), Sample.get_sampler(), U, V, Undef, Undef,
+                   hlslOP->GetI32Const(X), hlslOP->GetI32Const(Y),
+                   hlslOP->GetU32Const(std::get<4>(It.first))});
+
+      for (unsigned i = 0; i < 4; ++i) {
+        SmallVector<User *, 4> Users(Block[i]->user_begin(),
+                                     Block[i]->user_end());
+        for (User *EVUser : Users) {
+          ExtractValueInst *EV = cast<ExtractValueInst>(EVUser);
+          Builder.SetInsertPoint(EV);
+          EV->replaceAllUsesWith(Builder.CreateExtractValue(Result, i));
+          EV->eraseFromParent();
+        }
+        Block[i]->eraseFromParent();
+        Samples[Texels[i]] = nullptr;
+      }
+      ++NumGathersFormed;
+      bChanged = true;
+    }
+  }
+  return bChanged;
+}
+
+bool DxilFormGather::runOnModule(Module &M) {
+  if (!M.HasDxilModule())
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+  // Library handles aren't created from resource ids.
+  if (DM.GetShaderModel()->IsLib())
+    return false;
+
+  bool bChanged = false;
+  for (Function &F : M.functions()) {
+    for (BasicBlock &BB : F) {
+      m_sizes.clear();
+      bChanged |= FormGathers(BB, DM);
+    }
+  }
+  return bChanged;
+}
+
+char DxilFormGather::ID = 0;
+
+ModulePass *llvm::createDxilFormGatherPass() {
+  return new DxilFormGather();
+}
+
+INITIALIZE_PASS(DxilFormGather, "hlsl-dxil-form-gather", "DXIL Form Gather",
+                false, false)
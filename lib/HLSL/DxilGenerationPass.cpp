@@ -81,27 +81,14 @@ public:
   }
 };
 
-void InitResourceBase(const DxilResourceBase *pSource, DxilResourceBase *pDest) {
-  DXASSERT_NOMSG(pSource->GetClass() == pDest->GetClass());
-  pDest->SetKind(pSource->GetKind());
-  pDest->SetID(pSource->GetID());
-  pDest->SetSpaceID(pSource->GetSpaceID());
-  pDest->SetLowerBound(pSource->GetLowerBound());
-  pDest->SetRangeSize(pSource->GetRangeSize());
-  pDest->SetGlobalSymbol(pSource->GetGlobalSymbol());
-  pDest->SetGlobalName(pSource->GetGlobalName());
-  pDest->SetHandle(pSource->GetHandle());
-}
-
-void InitResource(const DxilResource *pSource, DxilResource *pDest) {
-  pDest->SetCompType(pSource->GetCompType());
-  pDest->SetSampleCount(pSource->GetSampleCount());
-  pDest->SetElementStride(pSource->GetElementStride());
-  pDest->SetGloballyCoherent(pSource->IsGloballyCoherent());
-  pDest->SetHasCounter(pSource->HasCounter());
-  pDest->SetRW(pSource->IsRW());
-  pDest->SetROV(pSource->IsROV());
-  InitResourceBase(pSource, pDest);
+// Resources are moved from the HLModule, which is dropped right after, so
+// their global symbols are replaced rather than copied.
+void DetachGlobalSymbol(DxilResourceBase &Res,
+                        std::vector<GlobalVariable *> &LLVMUsed,
+                        bool HasDebugInfo) {
+  if (HasDebugInfo)
+    LLVMUsed.emplace_back(cast<GlobalVariable>(Res.GetGlobalSymbol()));
+  Res.SetGlobalSymbol(UndefValue::get(Res.GetGlobalSymbol()->getType()));
 }
 
 void InitDxilModuleFromHLModule(HLModule &H, DxilModule &M, DxilEntrySignature *pSig, bool HasDebugInfo) {
@@ -122,43 +109,21 @@ void InitDxilModuleFromHLModule(HLModule &H, DxilModule &M, DxilEntrySignature *
   std::vector<GlobalVariable* > &LLVMUsed = M.GetLLVMUsed();
 
   // Resources
-  for (auto && C : H.GetCBuffers()) {
-    auto b = make_unique<DxilCBuffer>();
-    InitResourceBase(C.get(), b.get());
-    b->SetSize(C->GetSize());
-    if (HasDebugInfo)
-      LLVMUsed.emplace_back(cast<GlobalVariable>(b->GetGlobalSymbol()));
-
-    b->SetGlobalSymbol(UndefValue::get(b->GetGlobalSymbol()->getType()));
-    M.AddCBuffer(std::move(b));
+  for (auto && C : H.ReleaseCBuffers()) {
+    DetachGlobalSymbol(*C, LLVMUsed, HasDebugInfo);
+    M.AddCBuffer(std::move(C));
   }
-  for (auto && C : H.GetUAVs()) {
-    auto b = make_unique<DxilResource>();
-    InitResource(C.get(), b.get());
-    if (HasDebugInfo)
-      LLVMUsed.emplace_back(cast<GlobalVariable>(b->GetGlobalSymbol()));
-
-    b->SetGlobalSymbol(UndefValue::get(b->GetGlobalSymbol()->getType()));
-    M.AddUAV(std::move(b));
+  for (auto && C : H.ReleaseUAVs()) {
+    DetachGlobalSymbol(*C, LLVMUsed, HasDebugInfo);
+    M.AddUAV(std::move(C));
   }
-  for (auto && C : H.GetSRVs()) {
-    auto b = make_unique<DxilResource>();
-    InitResource(C.get(), b.get());
-    if (HasDebugInfo)
-      LLVMUsed.emplace_back(cast<GlobalVariable>(b->GetGlobalSymbol()));
-
-    b->SetGlobalSymbol(UndefValue::get(b->GetGlobalSymbol()->getType()));
-    M.AddSRV(std::move(b));
+  for (auto && C : H.ReleaseSRVs()) {
+    DetachGlobalSymbol(*C, LLVMUsed, HasDebugInfo);
+    M.AddSRV(std::move(C));
   }
-  for (auto && C : H.GetSamplers()) {
-    auto b = make_unique<DxilSampler>();
-    InitResourceBase(C.get(), b.get());
-    b->SetSamplerKind(C->GetSamplerKind());
-    if (HasDebugInfo)
-      LLVMUsed.emplace_back(cast<GlobalVariable>(b->GetGlobalSymbol()));
-
-    b->SetGlobalSymbol(UndefValue::get(b->GetGlobalSymbol()->getType()));
-    M.AddSampler(std::move(b));
+  for (auto && C : H.ReleaseSamplers()) {
+    DetachGlobalSymbol(*C, LLVMUsed, HasDebugInfo);
+    M.AddSampler(std::move(C));
   }
 
   // Signatures.
@@ -189,6 +154,8 @@ void InitDxilModuleFromHLModule(HLModule &H, DxilModule &M, DxilEntrySignature *
 
   // DXIL type system.
   M.ResetTypeSystem(H.ReleaseTypeSystem());
+  M.SetCompactTypeAnnotations(H.GetHLOptions().bCompactTypeAnnotations);
+  M.SetTrimResourceRanges(H.GetHLOptions().bTrimResourceRanges);
   // Dxil OP.
   M.ResetOP(H.ReleaseOP());
   // Keep llvm used.
@@ -1327,6 +1294,29 @@ INITIALIZE_PASS(HLEnsureMetadata, "hlsl-hlensure", "HLSL High-Level Metadata Ens
 // Precise propagate.
 
 namespace {
+
+// Marks the values that precise values are computed from. Each instruction
+// and each pointer is visited at most once, so the walk is linear in the size
+// of the module even when many precise values share one expression DAG.
+class PrecisePropagator {
+public:
+  explicit PrecisePropagator(DxilTypeSystem &typeSys) : m_typeSys(typeSys) {}
+
+  void AddOperand(Value *V);
+  void Run();
+
+private:
+  void AddPointer(Value *Ptr);
+  void Propagate(Instruction *I);
+
+  DxilTypeSystem &m_typeSys;
+  // FP instructions already marked precise.
+  std::unordered_set<Instruction *> m_processedSet;
+  // Pointers whose stores and out parameters were already added.
+  std::unordered_set<Value *> m_visitedPtrs;
+  std::vector<Instruction *> m_worklist;
+};
+
 class DxilPrecisePropagatePass : public ModulePass {
   HLModule *m_pHLModule;
 
@@ -1339,11 +1329,11 @@ public:
   bool runOnModule(Module &M) override {
     DxilModule &dxilModule = M.GetOrCreateDxilModule();
     DxilTypeSystem &typeSys = dxilModule.GetTypeSystem();
-    std::unordered_set<Instruction*> processedSet;
+    PrecisePropagator propagator(typeSys);
     std::vector<Function*> deadList;
     for (Function &F : M.functions()) {
       if (HLModule::HasPreciseAttribute(&F)) {
-        PropagatePreciseOnFunctionUser(F, typeSys, processedSet);
+        PropagatePreciseOnFunctionUser(F, propagator);
         deadList.emplace_back(&F);
       }
     }
@@ -1353,21 +1343,15 @@ public:
   }
 
 private:
-  void PropagatePreciseOnFunctionUser(
-      Function &F, DxilTypeSystem &typeSys,
-      std::unordered_set<Instruction *> &processedSet);
+  void PropagatePreciseOnFunctionUser(Function &F,
+                                      PrecisePropagator &propagator);
 };
 
 char DxilPrecisePropagatePass::ID = 0;
 
 }
 
-static void PropagatePreciseAttribute(Instruction *I, DxilTypeSystem &typeSys,
-    std::unordered_set<Instruction *> &processedSet);
-
-static void PropagatePreciseAttributeOnOperand(
-    Value *V, DxilTypeSystem &typeSys, LLVMContext &Context,
-    std::unordered_set<Instruction *> &processedSet) {
+void PrecisePropagator::AddOperand(Value *V) {
   Instruction *I = dyn_cast<Instruction>(V);
   // Skip none inst.
   if (!I)
@@ -1379,10 +1363,9 @@ static void PropagatePreciseAttributeOnOperand(
     return;
 
   // Skip inst already marked.
-  if (processedSet.count(I) > 0)
-    return;
   // TODO: skip precise on integer type, sample instruction...
-  processedSet.insert(I);
+  if (!m_processedSet.insert(I).second)
+    return;
   // Set precise fast math on those instructions that support it.
   if (DxilModule::PreservesFastMathFlags(I))
     DxilModule::SetPreciseFastMathFlags(I);
@@ -1390,25 +1373,25 @@ static void PropagatePreciseAttributeOnOperand(
   // Fast math not work on call, use metadata.
   if (CallInst *CI = dyn_cast<CallInst>(I))
     HLModule::MarkPreciseAttributeWithMetadata(CI);
-  PropagatePreciseAttribute(I, typeSys, processedSet);
+  m_worklist.emplace_back(I);
 }
 
-static void PropagatePreciseAttributeOnPointer(
-    Value *Ptr, DxilTypeSystem &typeSys, LLVMContext &Context,
-    std::unordered_set<Instruction *> &processedSet) {
+void PrecisePropagator::AddPointer(Value *Ptr) {
+  if (!m_visitedPtrs.insert(Ptr).second)
+    return;
   // Find all store and propagate on the val operand of store.
   // For CallInst, if Ptr is used as out parameter, mark it.
   for (User *U : Ptr->users()) {
     Instruction *user = cast<Instruction>(U);
     if (StoreInst *stInst = dyn_cast<StoreInst>(user)) {
       Value *val = stInst->getValueOperand();
-      PropagatePreciseAttributeOnOperand(val, typeSys, Context, processedSet);
+      AddOperand(val);
     } else if (CallInst *CI = dyn_cast<CallInst>(user)) {
       bool bReadOnly = true;
 
       Function *F = CI->getCalledFunction();
       const DxilFunctionAnnotation *funcAnnotation =
-          typeSys.GetFunctionAnnotation(F);
+          m_typeSys.GetFunctionAnnotation(F);
       for (unsigned i = 0; i < CI->getNumArgOperands(); ++i) {
         if (Ptr != CI->getArgOperand(i))
           continue;
@@ -1425,42 +1408,46 @@ static void PropagatePreciseAttributeOnPointer(
       }
 
       if (!bReadOnly)
-        PropagatePreciseAttributeOnOperand(CI, typeSys, Context, processedSet);
+        AddOperand(CI);
     }
   }
 }
 
-static void
-PropagatePreciseAttribute(Instruction *I, DxilTypeSystem &typeSys,
-                          std::unordered_set<Instruction *> &processedSet) {
-  LLVMContext &Context = I->getContext();
+void PrecisePropagator::Propagate(Instruction *I) {
   if (AllocaInst *AI = dyn_cast<AllocaInst>(I)) {
-    PropagatePreciseAttributeOnPointer(AI, typeSys, Context, processedSet);
+    AddPointer(AI);
   } else if (CallInst *CI = dyn_cast<CallInst>(I)) {
     // Propagate every argument.
     // TODO: only propagate precise argument.
     for (Value *src : I->operands())
-      PropagatePreciseAttributeOnOperand(src, typeSys, Context, processedSet);
+      AddOperand(src);
   } else if (FPMathOperator *FPMath = dyn_cast<FPMathOperator>(I)) {
     // TODO: only propagate precise argument.
     for (Value *src : I->operands())
-      PropagatePreciseAttributeOnOperand(src, typeSys, Context, processedSet);
+      AddOperand(src);
   } else if (LoadInst *ldInst = dyn_cast<LoadInst>(I)) {
     Value *Ptr = ldInst->getPointerOperand();
-    PropagatePreciseAttributeOnPointer(Ptr, typeSys, Context, processedSet);
+    AddPointer(Ptr);
   } else if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(I))
-    PropagatePreciseAttributeOnPointer(GEP, typeSys, Context, processedSet);
+    AddPointer(GEP);
   // TODO: support more case which need
 }
 
+void PrecisePropagator::Run() {
+  while (!m_worklist.empty()) {
+    Instruction *I = m_worklist.back();
+    m_worklist.pop_back();
+    Propagate(I);
+  }
+}
+
 void DxilPrecisePropagatePass::PropagatePreciseOnFunctionUser(
-    Function &F, DxilTypeSystem &typeSys,
-    std::unordered_set<Instruction *> &processedSet) {
-  LLVMContext &Context = F.getContext();
+    Function &F, PrecisePropagator &propagator) {
   for (auto U = F.user_begin(), E = F.user_end(); U != E;) {
     CallInst *CI = cast<CallInst>(*(U++));
     Value *V = CI->getArgOperand(0);
-    PropagatePreciseAttributeOnOperand(V, typeSys, Context, processedSet);
+    propagator.AddOperand(V);
+    propagator.Run();
     CI->eraseFromParent();
   }
 }
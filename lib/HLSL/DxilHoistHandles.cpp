@@ -0,0 +1,208 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilHoistHandles.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Hoists createHandle calls out of loops and merges identical ones.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include <tuple>
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-hoist-handles"
+
+STATISTIC(NumHandlesHoisted, "Number of createHandle calls hoisted out of loops");
+STATISTIC(NumHandlesMerged, "Number of createHandle calls merged");
+
+namespace {
+
+// Resource legalization and DxilCondenseResources leave a createHandle at
+// each use of a resource, so loops and branches create the same handle
+// again and again, and drivers fetch the descriptor each time. createHandle
+// only depends on its operands, so a handle is hoisted to the preheader of
+// each loop its operands are invariant in, and a handle dominated by an
+// identical one is replaced with it. Identical handles in different
+// branches share one created in their common dominator.
+//
+// A handle with a dynamic index is only hoisted out of a loop that always
+// runs it and only merged by dominance, so no index the shader wouldn't
+// have used is created.
+class DxilHoistHandles : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilHoistHandles() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Hoist Handles";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  typedef SmallVector<CallInst *, 4> HandleList;
+  bool HoistOutOfLoops(CallInst *CI, LoopInfo &LI, DominatorTree &DT);
+  unsigned MergeHandles(HandleList &Handles, DominatorTree &DT);
+};
+
+}
+
+static bool HasConstIndex(CallInst *CI) {
+  return isa<Constant>(DxilInst_CreateHandle(CI).get_index());
+}
+
+// Returns true if BB runs on every iteration of L that leaves it.
+static bool IsGuaranteedToExecute(BasicBlock *BB, Loop *L,
+                                  DominatorTree &DT) {
+  SmallVector<BasicBlock *, 8> ExitBlocks;
+  L->getExitBlocks(ExitBlocks);
+  for (BasicBlock *Exit : ExitBlocks) {
+    if (!DT.dominates(BB, Exit))
+      return false;
+  }
+  return true;
+}
+
+bool DxilHoistHandles::HoistOutOfLoops(CallInst *CI, LoopInfo &LI,
+                                       DominatorTree &DT) {
+  bool bConstIndex = HasConstIndex(CI);
+  bool bHoisted = false;
+  for (Loop *L = LI.getLoopFor(CI->getParent()); L;
+       L = LI.getLoopFor(CI->getParent())) {
+    BasicBlock *Preheader = L->getLoopPreheader();
+    if (!Preheader || !L->hasLoopInvariantOperands(CI))
+      break;
+    if (!bConstIndex && !IsGuaranteedToExecute(CI->getParent(), L, DT))
+      break;
+    CI->moveBefore(Preheader->getTerminator());
+    bHoisted = true;
+  }
+  if (bHoisted)
+    ++NumHandlesHoisted;
+  return bHoisted;
+}
+
+unsigned DxilHoistHandles::MergeHandles(HandleList &Handles,
+                                        DominatorTree &DT) {
+  // Handles are collected in dominator tree order, so a handle's dominators
+  // come before it.
+  unsigned NumMerged = 0;
+  for (unsigned i = 1; i < Handles.size(); ++i) {
+    for (unsigned j = 0; j < i; ++j) {
+      if (Handles[j] && DT.dominates(Handles[j], Handles[i])) {
+        Handles[i]->replaceAllUsesWith(Handles[j]);
+        Handles[i]->eraseFromParent();
+        Handles[i] = nullptr;
+        ++NumMerged;
+        break;
+      }
+    }
+  }
+
+  HandleList Remaining;
+  for (CallInst *CI : Handles) {
+    if (CI)
+      Remaining.push_back(CI);
+  }
+  if (Remaining.size() < 2 || !HasConstIndex(Remaining.front()))
+    return NumMerged;
+
+  // None of the remaining handles dominates another, so none is in the
+  // common dominator.
+  BasicBlock *CommonBB = Remaining.front()->getParent();
+  for (CallInst *CI : Remaining)
+    CommonBB = DT.findNearestCommonDominator(CommonBB, CI->getParent());
+  CallInst *Leader = cast<CallInst>(Remaining.front()->clone());
+  Leader->insertBefore(CommonBB->getTerminator());
+  for (CallInst *CI : Remaining) {
+    CI->replaceAllUsesWith(Leader);
+    CI->eraseFromParent();
+  }
+  // One call replaces all of them.
+  return NumMerged + Remaining.size() - 1;
+}
+
+bool DxilHoistHandles::runOnFunction(Function &F) {
+  DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+
+  std::vector<CallInst *> AllHandles;
+  for (inst_iterator It = inst_begin(F), E = inst_end(F); It != E; ++It) {
+    if (OP::IsDxilOpFuncCallInst(&*It, OP::OpCode::CreateHandle))
+      AllHandles.push_back(cast<CallInst>(&*It));
+  }
+  if (AllHandles.empty())
+    return false;
+
+  bool bChanged = false;
+  unsigned NumHoisted = 0;
+  for (CallInst *CI : AllHandles) {
+    if (HoistOutOfLoops(CI, LI, DT)) {
+      ++NumHoisted;
+      bChanged = true;
+    }
+  }
+
+  typedef std::tuple<Value *, Value *, Value *, Value *> HandleKey;
+  MapVector<HandleKey, HandleList> HandlesByKey;
+  for (DomTreeNode *Node : depth_first(DT.getRootNode())) {
+    for (Instruction &I : *Node->getBlock()) {
+      if (!OP::IsDxilOpFuncCallInst(&I, OP::OpCode::CreateHandle))
+        continue;
+      DxilInst_CreateHandle CH(&I);
+      HandleKey Key(CH.get_resourceClass(), CH.get_rangeId(), CH.get_index(),
+                    CH.get_nonUniformIndex());
+      HandlesByKey[Key].push_back(cast<CallInst>(&I));
+    }
+  }
+
+  unsigned NumMerged = 0;
+  for (auto &It : HandlesByKey) {
+    if (It.second.size() > 1)
+      NumMerged += MergeHandles(It.second, DT);
+  }
+  NumHandlesMerged += NumMerged;
+
+  DEBUG(dbgs() << F.getName() << ": " << NumMerged
+               << " createHandle calls removed, " << NumHoisted
+               << " hoisted out of loops\n");
+  return bChanged || NumMerged != 0;
+}
+
+char DxilHoistHandles::ID = 0;
+
+FunctionPass *llvm::createDxilHoistHandlesPass() {
+  return new DxilHoistHandles();
+}
+
+INITIALIZE_PASS_BEGIN(DxilHoistHandles, "hlsl-dxil-hoist-handles",
+                      "DXIL Hoist Handles", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(DxilHoistHandles, "hlsl-dxil-hoist-handles",
+                    "DXIL Hoist Handles", false, false)
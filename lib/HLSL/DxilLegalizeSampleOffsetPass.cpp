@@ -23,6 +23,7 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
 
 #include <unordered_set>
 
@@ -58,7 +59,7 @@ public:
       return false;
 
     // Loop unroll if has offset inside loop.
-    TryUnrollLoop(illegalOffsets, F);
+    bool bPromoted = TryUnrollLoop(illegalOffsets, F);
 
     // Collect offset again after mem2reg.
     std::vector<Instruction *> ssaIllegalOffsets;
@@ -67,10 +68,14 @@ public:
     // Run simple optimization to legalize offsets.
     LegalizeOffsets(ssaIllegalOffsets);
 
-    // Remove PHINodes to keep code shape.
-    legacy::FunctionPassManager PM(F.getParent());
-    PM.add(createDemoteRegisterToMemoryHlslPass());
-    PM.run(F);
+    // Remove PHINodes to keep code shape. A function that was already in
+    // SSA form, as it is when optimizing, is left in it rather than demoted
+    // for the passes that follow to promote again.
+    if (bPromoted) {
+      legacy::FunctionPassManager PM(F.getParent());
+      PM.add(createDemoteRegisterToMemoryHlslPass());
+      PM.run(F);
+    }
 
     FinalCheck(illegalOffsets, F, hlslOP);
 
@@ -78,7 +83,7 @@ public:
   }
 
 private:
-  void TryUnrollLoop(std::vector<Instruction *> &illegalOffsets, Function &F);
+  bool TryUnrollLoop(std::vector<Instruction *> &illegalOffsets, Function &F);
   void CollectIllegalOffsets(std::vector<Instruction *> &illegalOffsets,
                              Function &F, hlsl::OP *hlslOP);
   void CollectIllegalOffsets(std::vector<Instruction *> &illegalOffsets,
@@ -92,9 +97,7 @@ private:
 char DxilLegalizeSampleOffsetPass::ID = 0;
 
 bool HasIllegalOffsetInLoop(std::vector<Instruction *> &illegalOffsets,
-                            Function &F) {
-  DominatorTreeAnalysis DTA;
-  DominatorTree DT = DTA.run(F);
+                            DominatorTree &DT) {
   LoopInfo LI;
   LI.Analyze(DT);
 
@@ -150,20 +153,41 @@ void DxilLegalizeSampleOffsetPass::FinalCheck(
   }
 }
 
-void DxilLegalizeSampleOffsetPass::TryUnrollLoop(
+// Returns true if allocas were promoted.
+bool DxilLegalizeSampleOffsetPass::TryUnrollLoop(
     std::vector<Instruction *> &illegalOffsets, Function &F) {
-  legacy::FunctionPassManager PM(F.getParent());
+  // The loop check is done before promotion, which may erase the offsets.
+  // Promotion doesn't change the CFG, so one dominator tree serves both.
+  DominatorTreeAnalysis DTA;
+  DominatorTree DT = DTA.run(F);
+  bool bInLoop = HasIllegalOffsetInLoop(illegalOffsets, DT);
+
   // Always need mem2reg for simplify illegal offsets.
-  PM.add(createPromoteMemoryToRegisterPass());
+  BasicBlock &Entry = F.getEntryBlock();
+  std::vector<AllocaInst *> Allocas;
+  bool bPromoted = false;
+  while (1) {
+    Allocas.clear();
+    for (BasicBlock::iterator I = Entry.begin(), E = --Entry.end(); I != E; ++I)
+      if (AllocaInst *AI = dyn_cast<AllocaInst>(I))
+        if (isAllocaPromotable(AI))
+          Allocas.push_back(AI);
+    if (Allocas.empty())
+      break;
+    PromoteMemToReg(Allocas, DT);
+    bPromoted = true;
+  }
 
-  if (HasIllegalOffsetInLoop(illegalOffsets, F)) {
+  if (bInLoop) {
+    legacy::FunctionPassManager PM(F.getParent());
     PM.add(createCFGSimplificationPass());
     PM.add(createLCSSAPass());
     PM.add(createLoopSimplifyPass());
     PM.add(createLoopRotatePass());
     PM.add(createLoopUnrollPass(-2, -1, 0, 0));
+    PM.run(F);
   }
-  PM.run(F);
+  return bPromoted;
 }
 
 void DxilLegalizeSampleOffsetPass::CollectIllegalOffsets(
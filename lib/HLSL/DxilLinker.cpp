@@ -87,6 +87,8 @@ namespace {
 struct DxilFunctionLinkInfo {
   DxilFunctionLinkInfo(llvm::Function *F);
   llvm::Function *func;
+  // Set once func is loaded; usedFunctions don't change after that.
+  bool bLoaded;
   std::unordered_set<llvm::Function *> usedFunctions;
   std::unordered_set<llvm::GlobalVariable *> usedGVs;
   std::unordered_set<DxilResourceBase *> usedResources;
@@ -121,6 +123,11 @@ private:
   std::unordered_map<const llvm::Constant *, DxilResourceBase *> m_resourceMap;
   // Set of initialize functions for global variable.
   std::unordered_set<llvm::Function *> m_initFuncSet;
+  // Global usage is kept across links, and only needs to be rebuilt when
+  // more functions have been loaded.
+  bool m_bGlobalUsageBuilt;
+  unsigned m_numLoadedFunctions;
+  unsigned m_numLoadedForGlobalUsage;
 };
 
 struct DxilLinkJob;
@@ -159,7 +166,8 @@ private:
 //
 // DxilFunctionLinkInfo methods.
 //
-DxilFunctionLinkInfo::DxilFunctionLinkInfo(Function *F) : func(F) {
+DxilFunctionLinkInfo::DxilFunctionLinkInfo(Function *F)
+    : func(F), bLoaded(false) {
   DXASSERT_NOMSG(F);
 }
 
@@ -169,7 +177,9 @@ DxilFunctionLinkInfo::DxilFunctionLinkInfo(Function *F) : func(F) {
 //
 
 DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
-    : m_pModule(std::move(pModule)), m_DM(m_pModule->GetOrCreateDxilModule()) {
+    : m_pModule(std::move(pModule)), m_DM(m_pModule->GetOrCreateDxilModule()),
+      m_bGlobalUsageBuilt(false), m_numLoadedFunctions(0),
+      m_numLoadedForGlobalUsage(0) {
   Module &M = *m_pModule;
   const std::string &MID = M.getModuleIdentifier();
 
@@ -197,6 +207,11 @@ DxilLib::DxilLib(std::unique_ptr<llvm::Module> pModule)
 void DxilLib::LazyLoadFunction(Function *F) {
   DXASSERT(m_functionNameMap.count(F->getName()), "else invalid Function");
   DxilFunctionLinkInfo *linkInfo = m_functionNameMap[F->getName()].get();
+  if (linkInfo->bLoaded)
+    return;
+  linkInfo->bLoaded = true;
+  m_numLoadedFunctions++;
+
   std::error_code EC = F->materialize();
   DXASSERT_LOCALVAR(EC, !EC, "else fail to materialize");
 
@@ -223,8 +238,15 @@ void DxilLib::LazyLoadFunction(Function *F) {
 void DxilLib::BuildGlobalUsage() {
   Module &M = *m_pModule;
 
+  // Uses are only added as functions are loaded, so the usage is unchanged
+  // unless more functions were loaded since it was built.
+  if (m_bGlobalUsageBuilt && m_numLoadedFunctions == m_numLoadedForGlobalUsage)
+    return;
+
   // Collect init functions for static globals.
-  if (GlobalVariable *Ctors = M.getGlobalVariable("llvm.global_ctors")) {
+  GlobalVariable *Ctors =
+      m_bGlobalUsageBuilt ? nullptr : M.getGlobalVariable("llvm.global_ctors");
+  if (Ctors) {
     if (ConstantArray *CA = dyn_cast<ConstantArray>(Ctors->getInitializer())) {
       for (User::op_iterator i = CA->op_begin(), e = CA->op_end(); i != e;
            ++i) {
@@ -259,12 +281,17 @@ void DxilLib::BuildGlobalUsage() {
   }
 
   // Build resource map.
-  AddResourceMap(m_DM.GetUAVs(), DXIL::ResourceClass::UAV, m_resourceMap, m_DM);
-  AddResourceMap(m_DM.GetSRVs(), DXIL::ResourceClass::SRV, m_resourceMap, m_DM);
-  AddResourceMap(m_DM.GetCBuffers(), DXIL::ResourceClass::CBuffer,
-                 m_resourceMap, m_DM);
-  AddResourceMap(m_DM.GetSamplers(), DXIL::ResourceClass::Sampler,
-                 m_resourceMap, m_DM);
+  if (!m_bGlobalUsageBuilt) {
+    AddResourceMap(m_DM.GetUAVs(), DXIL::ResourceClass::UAV, m_resourceMap, m_DM);
+    AddResourceMap(m_DM.GetSRVs(), DXIL::ResourceClass::SRV, m_resourceMap, m_DM);
+    AddResourceMap(m_DM.GetCBuffers(), DXIL::ResourceClass::CBuffer,
+                   m_resourceMap, m_DM);
+    AddResourceMap(m_DM.GetSamplers(), DXIL::ResourceClass::Sampler,
+                   m_resourceMap, m_DM);
+  }
+
+  m_bGlobalUsageBuilt = true;
+  m_numLoadedForGlobalUsage = m_numLoadedFunctions;
 }
 
 void DxilLib::CollectUsedInitFunctions(StringSet<> &addedFunctionSet,
@@ -319,7 +346,7 @@ struct DxilLinkJob {
   std::unique_ptr<llvm::Module>
   Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
        StringRef profile);
-  void RunPreparePass(llvm::Module &M);
+  void RunPreparePass(llvm::Module &M, bool bOptimize);
   void AddFunction(std::pair<DxilFunctionLinkInfo *, DxilLib *> &linkPair);
   void AddFunction(llvm::Function *F);
 
@@ -558,12 +585,16 @@ DxilLinkJob::Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
   ValueToValueMapTy vmap;
 
   std::unordered_set<Function *> initFuncSet;
+  // The linked shader is only optimized if all the libraries it comes from
+  // were.
+  bool bOptimize = true;
   // Add function
   for (auto &it : m_functionDefs) {
     DxilFunctionLinkInfo *linkInfo = it.first;
     DxilLib *pLib = it.second;
     DxilModule &tmpDM = pLib->GetDxilModule();
     DxilTypeSystem &tmpTypeSys = tmpDM.GetTypeSystem();
+    bOptimize &= !tmpDM.m_ShaderFlags.GetDisableOptimizations();
 
     Function *F = linkInfo->func;
     Function *NewF = Function::Create(F->getFunctionType(), F->getLinkage(),
@@ -707,7 +738,7 @@ DxilLinkJob::Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
   // This should be after functions cloned.
   AddResourceToDM(DM);
 
-  RunPreparePass(*pM);
+  RunPreparePass(*pM, bOptimize);
 
   return pM;
 }
@@ -721,13 +752,21 @@ void DxilLinkJob::AddFunction(llvm::Function *F) {
   m_dxilFunctions[F->getName()] = F;
 }
 
-void DxilLinkJob::RunPreparePass(Module &M) {
+void DxilLinkJob::RunPreparePass(Module &M, bool bOptimize) {
   legacy::PassManager PM;
 
   PM.add(createAlwaysInlinerPass(/*InsertLifeTime*/ false));
   PM.add(createDxilDeadFunctionEliminationPass());
   // mem2reg.
   PM.add(createPromoteMemoryToRegisterPass());
+  // Each library function was optimized without its callers. Once inlined,
+  // the constant arguments and cbuffer offsets it is called with are known,
+  // so propagate them and fold what they decide.
+  if (bOptimize) {
+    PM.add(createSCCPPass());
+    PM.add(createInstructionCombiningPass());
+    PM.add(createAggressiveDCEPass());
+  }
   // Remove unused functions.
   PM.add(createDeadCodeEliminationPass());
   PM.add(createGlobalDCEPass());
@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilMarkReadNoneLoads.cpp                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Marks loads from resources the shader can't write as readnone.            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-mark-readnone-loads"
+
+STATISTIC(NumMarked, "Number of resource loads marked readnone");
+
+namespace {
+
+// dx.op functions are shared by all resources, so loads are only readonly:
+// any UAV write or call may change what they read. SRVs and constant
+// buffers are never written by a shader, though, so loads from them can be
+// readnone at the call site. EarlyCSE and GVN then merge identical loads
+// across writes, and LICM hoists them out of loops that write.
+//
+// Operations with implicit derivatives are left alone, since moving them
+// across control flow changes their result. DXIL has no call site
+// attributes, so DxilFinalizeModule removes them again.
+class DxilMarkReadNoneLoads : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilMarkReadNoneLoads() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Mark ReadNone Loads";
+  }
+
+  bool runOnModule(Module &M) override {
+    if (!M.HasDxilModule())
+      return false;
+    OP *hlslOP = M.GetDxilModule().GetOP();
+    bool bChanged = false;
+    for (Function &F : M.functions()) {
+      if (!OP::IsDxilOpFunc(&F) || F.doesNotAccessMemory())
+        continue;
+      for (User *U : F.users()) {
+        CallInst *CI = dyn_cast<CallInst>(U);
+        if (!CI || CI->doesNotAccessMemory() || !IsMarkableLoad(CI))
+          continue;
+        SmallPtrSet<Value *, 8> Visited;
+        if (!IsReadOnlyHandle(CI->getArgOperand(1), hlslOP, Visited))
+          continue;
+        CI->setDoesNotAccessMemory();
+        ++NumMarked;
+        bChanged = true;
+      }
+    }
+    return bChanged;
+  }
+
+private:
+  static bool IsMarkableLoad(CallInst *CI) {
+    switch (OP::GetDxilOpFuncCallInst(CI)) {
+    default:
+      return false;
+    case DXIL::OpCode::CBufferLoad:
+    case DXIL::OpCode::CBufferLoadLegacy:
+    case DXIL::OpCode::BufferLoad:
+    case DXIL::OpCode::RawBufferLoad:
+    case DXIL::OpCode::TextureLoad:
+    case DXIL::OpCode::SampleLevel:
+    case DXIL::OpCode::SampleGrad:
+    case DXIL::OpCode::SampleCmpLevelZero:
+    case DXIL::OpCode::TextureGather:
+    case DXIL::OpCode::TextureGatherCmp:
+    case DXIL::OpCode::GetDimensions:
+      return true;
+    }
+  }
+
+  // Returns true if all the handles V may hold were created for an SRV or a
+  // constant buffer.
+  static bool IsReadOnlyHandle(Value *V, OP *hlslOP,
+                               SmallPtrSet<Value *, 8> &Visited) {
+    if (!Visited.insert(V).second)
+      return true;
+    if (PHINode *Phi = dyn_cast<PHINode>(V)) {
+      for (Value *In : Phi->incoming_values())
+        if (!IsReadOnlyHandle(In, hlslOP, Visited))
+          return false;
+      return true;
+    }
+    if (SelectInst *Sel = dyn_cast<SelectInst>(V))
+      return IsReadOnlyHandle(Sel->getTrueValue(), hlslOP, Visited) &&
+             IsReadOnlyHandle(Sel->getFalseValue(), hlslOP, Visited);
+
+    CallInst *CI = dyn_cast<CallInst>(V);
+    if (!CI || !hlslOP->IsDxilOpFuncCallInst(CI, DXIL::OpCode::CreateHandle))
+      return false;
+    ConstantInt *Class =
+        dyn_cast<ConstantInt>(DxilInst_CreateHandle(CI).get_resourceClass());
+    if (!Class)
+      return false;
+    DXIL::ResourceClass RC = (DXIL::ResourceClass)Class->getZExtValue();
+    return RC == DXIL::ResourceClass::SRV ||
+           RC == DXIL::ResourceClass::CBuffer;
+  }
+};
+
+} // namespace
+
+char DxilMarkReadNoneLoads::ID = 0;
+
+ModulePass *llvm::createDxilMarkReadNoneLoadsPass() {
+  return new DxilMarkReadNoneLoads();
+}
+
+INITIALIZE_PASS(DxilMarkReadNoneLoads, "hlsl-dxil-mark-readnone-loads",
+                "DXIL Mark ReadNone Loads", false, false)
@@ -20,6 +20,7 @@
 #include "dxc/HLSL/ComputeViewIdState.h"
 #include "dxc/HLSL/DxilFunctionProps.h"
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
@@ -48,6 +49,8 @@ const char DxilMDHelper::kDxilTypeSystemMDName[]                      = "dx.type
 const char DxilMDHelper::kDxilTypeSystemHelperVariablePrefix[]        = "dx.typevar.";
 const char DxilMDHelper::kDxilControlFlowHintMDName[]                 = "dx.controlflow.hints";
 const char DxilMDHelper::kDxilPreciseAttributeMDName[]                = "dx.precise";
+const char DxilMDHelper::kDxilUniformBranchMDName[]                   = "dx.uniform.branch";
+const char DxilMDHelper::kDxilSpecializableMDName[]                   = "dx.specializable";
 const char DxilMDHelper::kHLDxilResourceAttributeMDName[]             = "dx.hl.resource.attribute";
 const char DxilMDHelper::kDxilValidatorVersionMDName[]                = "dx.valver";
 
@@ -57,7 +60,7 @@ const char DxilMDHelper::kDxilViewIdStateMDName[]                     = "dx.view
 const char DxilMDHelper::kDxilFunctionPropertiesMDName[]              = "dx.func.props";
 const char DxilMDHelper::kDxilEntrySignaturesMDName[]                 = "dx.func.signatures";
 
-static std::array<const char *, 7> DxilMDNames = {
+static std::array<const char *, 8> DxilMDNames = {
   DxilMDHelper::kDxilVersionMDName,
   DxilMDHelper::kDxilShaderModelMDName,
   DxilMDHelper::kDxilEntryPointsMDName,
@@ -65,13 +68,15 @@ static std::array<const char *, 7> DxilMDNames = {
   DxilMDHelper::kDxilTypeSystemMDName,
   DxilMDHelper::kDxilValidatorVersionMDName,
   DxilMDHelper::kDxilViewIdStateMDName,
+  DxilMDHelper::kDxilSpecializableMDName,
 };
 
 DxilMDHelper::DxilMDHelper(Module *pModule, std::unique_ptr<ExtraPropertyHelper> EPH)
 : m_pModule(pModule)
 , m_Ctx(pModule->getContext())
 , m_pSM(nullptr)
-, m_ExtraPropertyHelper(std::move(EPH)) {
+, m_ExtraPropertyHelper(std::move(EPH))
+, m_bCompactTypeSystem(false) {
 }
 
 DxilMDHelper::~DxilMDHelper() {
@@ -213,6 +218,7 @@ void DxilMDHelper::UpdateDxilEntryPoints(vector<MDNode *> &MDEntries) {
   for (size_t i = 0; i < MDEntries.size(); i++) {
     pEntryPointsNamedMD->setOperand(i, MDEntries[i]);
   }
+  m_FieldAnnotationCache.clear();
 }
 
 const NamedMDNode *DxilMDHelper::GetDxilEntryPoints() {
@@ -478,6 +484,7 @@ void DxilMDHelper::UpdateDxilResources(llvm::MDTuple *pDxilResourceTuple) {
   } else {
     m_pModule->eraseNamedMetadata(pResourcesNamedMD);
   }
+  m_FieldAnnotationCache.clear();
 }
 
 void DxilMDHelper::EmitDxilResourceLinkInfoTuple(MDTuple *pSRVs, MDTuple *pUAVs,
@@ -679,6 +686,11 @@ void DxilMDHelper::LoadDxilCBuffer(const MDOperand &MDO, DxilCBuffer &CB) {
 }
 
 void DxilMDHelper::EmitDxilTypeSystem(DxilTypeSystem &TypeSystem, vector<GlobalVariable*> &LLVMUsed) {
+  if (m_bCompactTypeSystem) {
+    EmitDxilTypeSystemCompact(TypeSystem);
+    return;
+  }
+
   auto &TypeMap = TypeSystem.GetStructAnnotationMap();
   vector<Metadata *> MDVals;
   MDVals.emplace_back(Uint32ToConstMD(kDxilTypeSystemStructTag)); // Tag
@@ -732,7 +744,10 @@ void DxilMDHelper::LoadDxilTypeSystemNode(const llvm::MDTuple &MDT,
                                           DxilTypeSystem &TypeSystem) {
 
   unsigned Tag = ConstMDToUint32(MDT.getOperand(0));
-  if (Tag == kDxilTypeSystemStructTag) {
+  if (Tag == kDxilTypeSystemCompactTag) {
+    LoadDxilTypeSystemCompact(MDT, TypeSystem);
+    m_bCompactTypeSystem = true;
+  } else if (Tag == kDxilTypeSystemStructTag) {
     IFTBOOL((MDT.getNumOperands() & 0x1) == 1, DXC_E_INCORRECT_DXIL_METADATA);
 
     for (unsigned i = 1; i < MDT.getNumOperands(); i += 2) {
@@ -769,6 +784,330 @@ void DxilMDHelper::LoadDxilTypeSystem(DxilTypeSystem &TypeSystem) {
   }
 }
 
+void DxilMDHelper::SetCompactTypeSystem(bool bCompact) {
+  m_bCompactTypeSystem = bCompact;
+}
+
+bool DxilMDHelper::IsCompactTypeSystem() const {
+  return m_bCompactTypeSystem;
+}
+
+//
+// Compact type system.
+//
+// The compact form is a single tuple:
+//   !{i32 kDxilTypeSystemCompactTag, !"records", struct undefs..., functions...}
+// The records string holds 32-bit words: a header, one record per struct and
+// function in the order of the tuple operands, and a table with the end
+// offset of each string. The characters of the strings follow the words.
+//
+namespace {
+
+const unsigned kCompactTypeSystemVersion = 1;
+
+enum CompactTypeSystemHeader {
+  kCompactVersionIdx = 0,
+  kCompactNumWordsIdx = 1,  // Words, including header and string table.
+  kCompactNumStringsIdx = 2,
+  kCompactNumStructsIdx = 3,
+  kCompactNumFunctionsIdx = 4,
+  kCompactHeaderNumWords = 5,
+};
+
+// Field records are: flags, rows | cols << 8 | orientation << 16, cbuffer
+// offset, semantic string, field name string, interpolation mode, component
+// type. Struct records are the cbuffer size and field count followed by the
+// fields. Parameter records are the input qualifier, a field record and a
+// counted list of semantic indices. Function records are the parameter count
+// followed by the return type and parameter records.
+enum CompactFieldFlags {
+  kCompactFieldPrecise = 1 << 0,
+  kCompactFieldMatrix = 1 << 1,
+  kCompactFieldCBufferOffset = 1 << 2,
+  kCompactFieldSemanticString = 1 << 3,
+  kCompactFieldInterpolationMode = 1 << 4,
+  kCompactFieldFieldName = 1 << 5,
+  kCompactFieldCompType = 1 << 6,
+};
+
+class CompactTypeSystemWriter {
+public:
+  CompactTypeSystemWriter() : m_Words(kCompactHeaderNumWords, 0) {}
+
+  void WriteStruct(const DxilStructAnnotation &SA) {
+    m_Words.push_back(SA.GetCBufferSize());
+    m_Words.push_back(SA.GetNumFields());
+    for (unsigned i = 0; i < SA.GetNumFields(); i++)
+      WriteField(SA.GetFieldAnnotation(i));
+  }
+
+  void WriteFunction(const DxilFunctionAnnotation &FA) {
+    m_Words.push_back(FA.GetNumParameters());
+    WriteParam(FA.GetRetTypeAnnotation());
+    for (unsigned i = 0; i < FA.GetNumParameters(); i++)
+      WriteParam(FA.GetParameterAnnotation(i));
+  }
+
+  std::string Finish(unsigned NumStructs, unsigned NumFunctions) {
+    unsigned End = 0;
+    for (const std::string &S : m_Strings) {
+      End += S.size();
+      m_Words.push_back(End);
+    }
+    m_Words[kCompactVersionIdx] = kCompactTypeSystemVersion;
+    m_Words[kCompactNumWordsIdx] = m_Words.size();
+    m_Words[kCompactNumStringsIdx] = m_Strings.size();
+    m_Words[kCompactNumStructsIdx] = NumStructs;
+    m_Words[kCompactNumFunctionsIdx] = NumFunctions;
+
+    std::string Records((const char *)m_Words.data(),
+                        m_Words.size() * sizeof(uint32_t));
+    for (const std::string &S : m_Strings)
+      Records += S;
+    return Records;
+  }
+
+private:
+  vector<uint32_t> m_Words;
+  vector<std::string> m_Strings;
+  StringMap<unsigned> m_StringIndices;
+
+  unsigned GetStringIndex(StringRef S) {
+    auto Inserted = m_StringIndices.insert(
+        std::make_pair(S, (unsigned)m_Strings.size()));
+    if (Inserted.second)
+      m_Strings.emplace_back(S.str());
+    return Inserted.first->second;
+  }
+
+  void WriteField(const DxilFieldAnnotation &FA) {
+    unsigned Flags = 0;
+    unsigned Matrix = 0, CBufferOffset = 0, Semantic = 0, FieldName = 0;
+    unsigned InterpMode = 0, CompTy = 0;
+    if (FA.IsPrecise())
+      Flags |= kCompactFieldPrecise;
+    if (FA.HasMatrixAnnotation()) {
+      const DxilMatrixAnnotation &MA = FA.GetMatrixAnnotation();
+      Flags |= kCompactFieldMatrix;
+      Matrix = MA.Rows | (MA.Cols << 8) | ((unsigned)MA.Orientation << 16);
+    }
+    if (FA.HasCBufferOffset()) {
+      Flags |= kCompactFieldCBufferOffset;
+      CBufferOffset = FA.GetCBufferOffset();
+    }
+    if (FA.HasSemanticString()) {
+      Flags |= kCompactFieldSemanticString;
+      Semantic = GetStringIndex(FA.GetSemanticString());
+    }
+    if (FA.HasInterpolationMode()) {
+      Flags |= kCompactFieldInterpolationMode;
+      InterpMode = (unsigned)FA.GetInterpolationMode().GetKind();
+    }
+    if (FA.HasFieldName()) {
+      Flags |= kCompactFieldFieldName;
+      FieldName = GetStringIndex(FA.GetFieldName());
+    }
+    if (FA.HasCompType()) {
+      Flags |= kCompactFieldCompType;
+      CompTy = (unsigned)FA.GetCompType().GetKind();
+    }
+    uint32_t Record[] = {Flags,     Matrix,     CBufferOffset, Semantic,
+                         FieldName, InterpMode, CompTy};
+    m_Words.insert(m_Words.end(), std::begin(Record), std::end(Record));
+  }
+
+  void WriteParam(const DxilParameterAnnotation &PA) {
+    m_Words.push_back((unsigned)PA.GetParamInputQual());
+    WriteField(PA);
+    const vector<unsigned> &SemanticIndices = PA.GetSemanticIndexVec();
+    m_Words.push_back(SemanticIndices.size());
+    m_Words.insert(m_Words.end(), SemanticIndices.begin(),
+                   SemanticIndices.end());
+  }
+};
+
+class CompactTypeSystemReader {
+public:
+  CompactTypeSystemReader(StringRef Records) : m_Records(Records), m_Pos(0) {
+    IFTBOOL(Records.size() >= kCompactHeaderNumWords * sizeof(uint32_t),
+            DXC_E_INCORRECT_DXIL_METADATA);
+    m_NumWords = kCompactHeaderNumWords;
+    IFTBOOL(Read() == kCompactTypeSystemVersion, DXC_E_INCORRECT_DXIL_METADATA);
+    m_NumWords = Read();
+    unsigned NumStrings = Read();
+    m_NumStructs = Read();
+    m_NumFunctions = Read();
+    IFTBOOL(m_NumWords >= kCompactHeaderNumWords + NumStrings &&
+                m_NumWords <= Records.size() / sizeof(uint32_t),
+            DXC_E_INCORRECT_DXIL_METADATA);
+
+    // Strings are read up front; records only refer to them by index.
+    StringRef Chars = Records.substr(m_NumWords * sizeof(uint32_t));
+    unsigned TablePos = m_NumWords - NumStrings;
+    unsigned Start = 0;
+    for (unsigned i = 0; i < NumStrings; i++) {
+      unsigned End = GetWord(TablePos + i);
+      IFTBOOL(Start <= End && End <= Chars.size(),
+              DXC_E_INCORRECT_DXIL_METADATA);
+      m_Strings.emplace_back(Chars.substr(Start, End - Start));
+      Start = End;
+    }
+    m_NumWords = TablePos;
+  }
+
+  unsigned GetNumStructs() const { return m_NumStructs; }
+  unsigned GetNumFunctions() const { return m_NumFunctions; }
+  bool AtEnd() const { return m_Pos == m_NumWords; }
+
+  void ReadStruct(DxilStructAnnotation &SA) {
+    SA.SetCBufferSize(Read());
+    unsigned NumFields = Read();
+    IFTBOOL(NumFields == SA.GetNumFields(), DXC_E_INCORRECT_DXIL_METADATA);
+    if (NumFields == 0)
+      SA.MarkEmptyStruct();
+    for (unsigned i = 0; i < NumFields; i++)
+      ReadField(SA.GetFieldAnnotation(i));
+  }
+
+  void ReadFunction(DxilFunctionAnnotation &FA) {
+    IFTBOOL(Read() == FA.GetNumParameters(), DXC_E_INCORRECT_DXIL_METADATA);
+    ReadParam(FA.GetRetTypeAnnotation());
+    for (unsigned i = 0; i < FA.GetNumParameters(); i++)
+      ReadParam(FA.GetParameterAnnotation(i));
+  }
+
+private:
+  StringRef m_Records;
+  unsigned m_Pos;
+  unsigned m_NumWords; // Words before the string table.
+  unsigned m_NumStructs;
+  unsigned m_NumFunctions;
+  vector<StringRef> m_Strings;
+
+  uint32_t GetWord(unsigned Idx) const {
+    // Metadata strings carry no alignment guarantee.
+    uint32_t Word;
+    memcpy(&Word, m_Records.data() + Idx * sizeof(uint32_t), sizeof(Word));
+    return Word;
+  }
+
+  uint32_t Read() {
+    IFTBOOL(m_Pos < m_NumWords, DXC_E_INCORRECT_DXIL_METADATA);
+    return GetWord(m_Pos++);
+  }
+
+  std::string GetString(unsigned Idx) const {
+    IFTBOOL(Idx < m_Strings.size(), DXC_E_INCORRECT_DXIL_METADATA);
+    return m_Strings[Idx].str();
+  }
+
+  void ReadField(DxilFieldAnnotation &FA) {
+    unsigned Flags = Read();
+    unsigned Matrix = Read();
+    unsigned CBufferOffset = Read();
+    unsigned Semantic = Read();
+    unsigned FieldName = Read();
+    unsigned InterpMode = Read();
+    unsigned CompTy = Read();
+    if (Flags & kCompactFieldPrecise)
+      FA.SetPrecise();
+    if (Flags & kCompactFieldMatrix) {
+      DxilMatrixAnnotation MA;
+      MA.Rows = Matrix & 0xFF;
+      MA.Cols = (Matrix >> 8) & 0xFF;
+      MA.Orientation = (MatrixOrientation)(Matrix >> 16);
+      FA.SetMatrixAnnotation(MA);
+    }
+    if (Flags & kCompactFieldCBufferOffset)
+      FA.SetCBufferOffset(CBufferOffset);
+    if (Flags & kCompactFieldSemanticString)
+      FA.SetSemanticString(GetString(Semantic));
+    if (Flags & kCompactFieldInterpolationMode)
+      FA.SetInterpolationMode(
+          InterpolationMode((InterpolationMode::Kind)InterpMode));
+    if (Flags & kCompactFieldFieldName)
+      FA.SetFieldName(GetString(FieldName));
+    if (Flags & kCompactFieldCompType)
+      FA.SetCompType((CompType::Kind)CompTy);
+  }
+
+  void ReadParam(DxilParameterAnnotation &PA) {
+    PA.SetParamInputQual((DxilParamInputQual)Read());
+    ReadField(PA);
+    unsigned NumIndices = Read();
+    IFTBOOL(NumIndices <= m_NumWords - m_Pos, DXC_E_INCORRECT_DXIL_METADATA);
+    vector<unsigned> SemanticIndices(NumIndices);
+    for (unsigned i = 0; i < NumIndices; i++)
+      SemanticIndices[i] = Read();
+    PA.SetSemanticIndexVec(SemanticIndices);
+  }
+};
+
+} // namespace
+
+void DxilMDHelper::EmitDxilTypeSystemCompact(DxilTypeSystem &TypeSystem) {
+  CompactTypeSystemWriter Writer;
+  vector<Metadata *> MDVals;
+  MDVals.emplace_back(Uint32ToConstMD(kDxilTypeSystemCompactTag)); // Tag
+  MDVals.emplace_back(nullptr); // Records, once all are written.
+  for (auto &it : TypeSystem.GetStructAnnotationMap()) {
+    DxilStructAnnotation *pA = it.second.get();
+    // Don't emit type annotation for empty struct.
+    if (pA->IsEmptyStruct())
+      continue;
+    Writer.WriteStruct(*pA);
+    StructType *pStructType = const_cast<StructType *>(it.first);
+    MDVals.push_back(ValueAsMetadata::get(UndefValue::get(pStructType)));
+  }
+  unsigned NumStructs = MDVals.size() - 2;
+  for (auto &it : TypeSystem.GetFunctionAnnotationMap()) {
+    DxilFunctionAnnotation *pA = it.second.get();
+    Writer.WriteFunction(*pA);
+    MDVals.push_back(
+        ValueAsMetadata::get(const_cast<Function *>(pA->GetFunction())));
+  }
+  unsigned NumFunctions = MDVals.size() - 2 - NumStructs;
+
+  NamedMDNode *pDxilTypeAnnotationsMD = m_pModule->getNamedMetadata(kDxilTypeSystemMDName);
+  if (pDxilTypeAnnotationsMD != nullptr) {
+    m_pModule->eraseNamedMetadata(pDxilTypeAnnotationsMD);
+  }
+  if (NumStructs == 0 && NumFunctions == 0)
+    return;
+
+  MDVals[1] = MDString::get(m_Ctx, Writer.Finish(NumStructs, NumFunctions));
+  pDxilTypeAnnotationsMD = m_pModule->getOrInsertNamedMetadata(kDxilTypeSystemMDName);
+  pDxilTypeAnnotationsMD->addOperand(MDNode::get(m_Ctx, MDVals));
+}
+
+void DxilMDHelper::LoadDxilTypeSystemCompact(const MDTuple &MDT,
+                                             DxilTypeSystem &TypeSystem) {
+  IFTBOOL(MDT.getNumOperands() >= 2, DXC_E_INCORRECT_DXIL_METADATA);
+  MDString *pRecords = dyn_cast<MDString>(MDT.getOperand(1));
+  IFTBOOL(pRecords != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+  CompactTypeSystemReader Reader(pRecords->getString());
+  unsigned NumStructs = Reader.GetNumStructs();
+  IFTBOOL(MDT.getNumOperands() ==
+              2 + NumStructs + Reader.GetNumFunctions(),
+          DXC_E_INCORRECT_DXIL_METADATA);
+
+  for (unsigned i = 2; i < MDT.getNumOperands(); i++) {
+    Value *V = ValueMDToValue(MDT.getOperand(i));
+    if (i < 2 + NumStructs) {
+      Constant *pGV = dyn_cast<Constant>(V);
+      IFTBOOL(pGV != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+      StructType *pGVType = dyn_cast<StructType>(pGV->getType());
+      IFTBOOL(pGVType != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+      Reader.ReadStruct(*TypeSystem.AddStructAnnotation(pGVType));
+    } else {
+      Function *F = dyn_cast<Function>(V);
+      IFTBOOL(F != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+      Reader.ReadFunction(*TypeSystem.AddFunctionAnnotation(F));
+    }
+  }
+  IFTBOOL(Reader.AtEnd(), DXC_E_INCORRECT_DXIL_METADATA);
+}
+
 Metadata *DxilMDHelper::EmitDxilStructAnnotation(const DxilStructAnnotation &SA) {
   vector<Metadata *> MDVals(SA.GetNumFields() + 1);
   MDVals[0] = Uint32ToConstMD(SA.GetCBufferSize());
@@ -901,6 +1240,23 @@ void DxilMDHelper::LoadDxilFieldAnnotation(const MDOperand &MDO, DxilFieldAnnota
   IFTBOOL(MDO.get() != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
   const MDTuple *pTupleMD = dyn_cast<MDTuple>(MDO.get());
   IFTBOOL(pTupleMD != nullptr, DXC_E_INCORRECT_DXIL_METADATA);
+
+  // Annotations are loaded into default ones, so a decoded copy can be
+  // assigned as a whole. Only the field annotation part of a parameter
+  // annotation is assigned.
+  auto cached = m_FieldAnnotationCache.find(pTupleMD);
+  if (cached != m_FieldAnnotationCache.end()) {
+    FA = *cached->second;
+    return;
+  }
+  unique_ptr<DxilFieldAnnotation> pDecoded(new DxilFieldAnnotation());
+  DecodeDxilFieldAnnotation(pTupleMD, *pDecoded);
+  FA = *pDecoded;
+  m_FieldAnnotationCache[pTupleMD] = std::move(pDecoded);
+}
+
+void DxilMDHelper::DecodeDxilFieldAnnotation(const MDTuple *pTupleMD,
+                                             DxilFieldAnnotation &FA) {
   IFTBOOL((pTupleMD->getNumOperands() & 0x1) == 0, DXC_E_INCORRECT_DXIL_METADATA);
 
   for (unsigned i = 0; i < pTupleMD->getNumOperands(); i += 2) {
@@ -1009,6 +1365,9 @@ Function *DxilMDHelper::LoadDxilFunctionProps(MDTuple *pProps,
   default:
     break;
   }
+  // The wave size is only emitted when it is set.
+  if (idx < pProps->getNumOperands())
+    props->waveSize = ConstMDToUint32(pProps->getOperand(idx++));
   return F;
 }
 
@@ -1060,6 +1419,8 @@ DxilMDHelper::EmitDxilFunctionProps(const hlsl::DxilFunctionProps *props,
   default:
     break;
   }
+  if (props->waveSize != 0)
+    MDVals[valIdx++] = Uint32ToConstMD(props->waveSize);
   return MDTuple::get(m_Ctx, ArrayRef<llvm::Metadata *>(MDVals, valIdx));
 }
 
@@ -23,10 +23,12 @@
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ValueMap.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <unordered_set>
 
 using namespace llvm;
@@ -83,7 +85,9 @@ DxilModule::DxilModule(Module *pModule)
 , m_TessellatorPartitioning(DXIL::TessellatorPartitioning::Undefined)
 , m_TessellatorOutputPrimitive(DXIL::TessellatorOutputPrimitive::Undefined)
 , m_MaxTessellationFactor(0.f)
-, m_RootSignature(nullptr) {
+, m_WaveSize(0)
+, m_RootSignature(nullptr)
+, m_bTrimResourceRanges(false) {
   DXASSERT_NOMSG(m_pModule != nullptr);
 
   m_NumThreads[0] = m_NumThreads[1] = m_NumThreads[2] = 0;
@@ -339,7 +343,21 @@ static ConstantInt *GetArbitraryConstantRangeID(CallInst *handleCall) {
   return ConstantRangeID;
 }
 
-void DxilModule::CollectShaderFlags(ShaderFlags &Flags) {
+// Caches the flags each function's instructions need, so finalization and
+// validation of the same module only walk each function once. Entries go
+// away with their function; passes that change a function after its flags
+// are collected call InvalidateShaderFlags.
+class DxilModule::ShaderFlagsCache {
+public:
+  ShaderFlagsCache(bool bUAVLoadsBackCompat)
+      : UAVLoadsBackCompat(bUAVLoadsBackCompat) {}
+  ValueMap<const Function *, ShaderFlags> FunctionFlags;
+  // Which UAV loads need additional formats depends on the validator.
+  bool UAVLoadsBackCompat;
+};
+
+DxilModule::ShaderFlags DxilModule::CollectFunctionShaderFlags(
+    Function &F, bool hasMulticomponentUAVLoadsBackCompat) {
   bool hasDouble = false;
   // ddiv dfma drcp d2i d2u i2d u2d.
   // fma has dxil op. Others should check IR instruction div/cast.
@@ -352,132 +370,122 @@ void DxilModule::CollectShaderFlags(ShaderFlags &Flags) {
   bool hasInnerCoverage = false;
   bool hasViewID = false;
   bool hasMulticomponentUAVLoads = false;
-  bool hasMulticomponentUAVLoadsBackCompat = false;
-
-  // Try to maintain compatibility with a v1.0 validator if that's what we have.
-  {
-    unsigned valMajor, valMinor;
-    GetValidatorVersion(valMajor, valMinor);
-    hasMulticomponentUAVLoadsBackCompat = valMajor <= 1 && valMinor == 0;
-  }
 
   Type *int16Ty = Type::getInt16Ty(GetCtx());
   Type *int64Ty = Type::getInt64Ty(GetCtx());
 
-  for (Function &F : GetModule()->functions()) {
-    for (BasicBlock &BB : F.getBasicBlockList()) {
-      for (Instruction &I : BB.getInstList()) {
-        // Skip none dxil function call.
-        if (CallInst *CI = dyn_cast<CallInst>(&I)) {
-          if (!OP::IsDxilOpFunc(CI->getCalledFunction()))
-            continue;
-        }
-        Type *Ty = I.getType();
-        bool isDouble = Ty->isDoubleTy();
-        bool isHalf = Ty->isHalfTy();
-        bool isInt16 = Ty == int16Ty;
-        bool isInt64 = Ty == int64Ty;
-        if (isa<ExtractElementInst>(&I) ||
-            isa<InsertElementInst>(&I))
+  for (BasicBlock &BB : F.getBasicBlockList()) {
+    for (Instruction &I : BB.getInstList()) {
+      // Skip none dxil function call.
+      if (CallInst *CI = dyn_cast<CallInst>(&I)) {
+        if (!OP::IsDxilOpFunc(CI->getCalledFunction()))
           continue;
-        for (Value *operand : I.operands()) {
-          Type *Ty = operand->getType();
-          isDouble |= Ty->isDoubleTy();
-          isHalf |= Ty->isHalfTy();
-          isInt16 |= Ty == int16Ty;
-          isInt64 |= Ty == int64Ty;
-        }
+      }
+      Type *Ty = I.getType();
+      bool isDouble = Ty->isDoubleTy();
+      bool isHalf = Ty->isHalfTy();
+      bool isInt16 = Ty == int16Ty;
+      bool isInt64 = Ty == int64Ty;
+      if (isa<ExtractElementInst>(&I) ||
+          isa<InsertElementInst>(&I))
+        continue;
+      for (Value *operand : I.operands()) {
+        Type *Ty = operand->getType();
+        isDouble |= Ty->isDoubleTy();
+        isHalf |= Ty->isHalfTy();
+        isInt16 |= Ty == int16Ty;
+        isInt64 |= Ty == int64Ty;
+      }
 
-        if (isDouble) {
-          hasDouble = true;
-          switch (I.getOpcode()) {
-          case Instruction::FDiv:
-          case Instruction::UIToFP:
-          case Instruction::SIToFP:
-          case Instruction::FPToUI:
-          case Instruction::FPToSI:
-            hasDoubleExtension = true;
-            break;
-          }
+      if (isDouble) {
+        hasDouble = true;
+        switch (I.getOpcode()) {
+        case Instruction::FDiv:
+        case Instruction::UIToFP:
+        case Instruction::SIToFP:
+        case Instruction::FPToUI:
+        case Instruction::FPToSI:
+          hasDoubleExtension = true;
+          break;
         }
-        
-        has16 |= isHalf;
-        has16 |= isInt16;
-        has64Int |= isInt64;
-
-        if (CallInst *CI = dyn_cast<CallInst>(&I)) {
-          if (!OP::IsDxilOpFunc(CI->getCalledFunction()))
-            continue;
-          Value *opcodeArg = CI->getArgOperand(DXIL::OperandIndex::kOpcodeIdx);
-          ConstantInt *opcodeConst = dyn_cast<ConstantInt>(opcodeArg);
-          DXASSERT(opcodeConst, "DXIL opcode arg must be immediate");
-          unsigned opcode = opcodeConst->getLimitedValue();
-          DXASSERT(opcode < static_cast<unsigned>(DXIL::OpCode::NumOpCodes),
-                   "invalid DXIL opcode");
-          DXIL::OpCode dxilOp = static_cast<DXIL::OpCode>(opcode);
-          if (hlsl::OP::IsDxilOpWave(dxilOp))
-            hasWaveOps = true;
-          switch (dxilOp) {
-          case DXIL::OpCode::CheckAccessFullyMapped:
-            hasCheckAccessFully = true;
-            break;
-          case DXIL::OpCode::Msad:
-            hasMSAD = true;
-            break;
-          case DXIL::OpCode::BufferLoad:
-          case DXIL::OpCode::TextureLoad: {
-            if (hasMulticomponentUAVLoads) continue;
-            // This is the old-style computation (overestimating requirements).
-            Value *resHandle = CI->getArgOperand(DXIL::OperandIndex::kBufferStoreHandleOpIdx);
-            CallInst *handleCall = cast<CallInst>(resHandle);
-
-            if (ConstantInt *resClassArg =
-              dyn_cast<ConstantInt>(handleCall->getArgOperand(
-                DXIL::OperandIndex::kCreateHandleResClassOpIdx))) {
-              DXIL::ResourceClass resClass = static_cast<DXIL::ResourceClass>(
-                resClassArg->getLimitedValue());
-              if (resClass == DXIL::ResourceClass::UAV) {
-                // Validator 1.0 assumes that all uav load is multi component load.
-                if (hasMulticomponentUAVLoadsBackCompat) {
-                  hasMulticomponentUAVLoads = true;
-                  continue;
-                }
-                else {
-                  ConstantInt *rangeID = GetArbitraryConstantRangeID(handleCall);
-                  if (rangeID) {
-                      DxilResource resource = GetUAV(rangeID->getLimitedValue());
-                      if ((resource.IsTypedBuffer() ||
-                           resource.IsAnyTexture()) &&
-                          !IsResourceSingleComponent(resource.GetRetType())) {
-                        hasMulticomponentUAVLoads = true;
-                      }
-                  }
+      }
+      
+      has16 |= isHalf;
+      has16 |= isInt16;
+      has64Int |= isInt64;
+
+      if (CallInst *CI = dyn_cast<CallInst>(&I)) {
+        if (!OP::IsDxilOpFunc(CI->getCalledFunction()))
+          continue;
+        Value *opcodeArg = CI->getArgOperand(DXIL::OperandIndex::kOpcodeIdx);
+        ConstantInt *opcodeConst = dyn_cast<ConstantInt>(opcodeArg);
+        DXASSERT(opcodeConst, "DXIL opcode arg must be immediate");
+        unsigned opcode = opcodeConst->getLimitedValue();
+        DXASSERT(opcode < static_cast<unsigned>(DXIL::OpCode::NumOpCodes),
+                 "invalid DXIL opcode");
+        DXIL::OpCode dxilOp = static_cast<DXIL::OpCode>(opcode);
+        if (hlsl::OP::IsDxilOpWave(dxilOp))
+          hasWaveOps = true;
+        switch (dxilOp) {
+        case DXIL::OpCode::CheckAccessFullyMapped:
+          hasCheckAccessFully = true;
+          break;
+        case DXIL::OpCode::Msad:
+          hasMSAD = true;
+          break;
+        case DXIL::OpCode::BufferLoad:
+        case DXIL::OpCode::TextureLoad: {
+          if (hasMulticomponentUAVLoads) continue;
+          // This is the old-style computation (overestimating requirements).
+          Value *resHandle = CI->getArgOperand(DXIL::OperandIndex::kBufferStoreHandleOpIdx);
+          CallInst *handleCall = cast<CallInst>(resHandle);
+
+          if (ConstantInt *resClassArg =
+            dyn_cast<ConstantInt>(handleCall->getArgOperand(
+              DXIL::OperandIndex::kCreateHandleResClassOpIdx))) {
+            DXIL::ResourceClass resClass = static_cast<DXIL::ResourceClass>(
+              resClassArg->getLimitedValue());
+            if (resClass == DXIL::ResourceClass::UAV) {
+              // Validator 1.0 assumes that all uav load is multi component load.
+              if (hasMulticomponentUAVLoadsBackCompat) {
+                hasMulticomponentUAVLoads = true;
+                continue;
+              }
+              else {
+                ConstantInt *rangeID = GetArbitraryConstantRangeID(handleCall);
+                if (rangeID) {
+                    DxilResource resource = GetUAV(rangeID->getLimitedValue());
+                    if ((resource.IsTypedBuffer() ||
+                         resource.IsAnyTexture()) &&
+                        !IsResourceSingleComponent(resource.GetRetType())) {
+                      hasMulticomponentUAVLoads = true;
+                    }
                 }
               }
             }
-            else {
-                DXASSERT(false, "Resource class must be constant.");
-            }
-          } break;
-          case DXIL::OpCode::Fma:
-            hasDoubleExtension |= isDouble;
-            break;
-          case DXIL::OpCode::InnerCoverage:
-            hasInnerCoverage = true;
-            break;
-          case DXIL::OpCode::ViewID:
-            hasViewID = true;
-            break;
-          default:
-            // Normal opcodes.
-            break;
           }
+          else {
+              DXASSERT(false, "Resource class must be constant.");
+          }
+        } break;
+        case DXIL::OpCode::Fma:
+          hasDoubleExtension |= isDouble;
+          break;
+        case DXIL::OpCode::InnerCoverage:
+          hasInnerCoverage = true;
+          break;
+        case DXIL::OpCode::ViewID:
+          hasViewID = true;
+          break;
+        default:
+          // Normal opcodes.
+          break;
         }
       }
     }
-
   }
 
+  ShaderFlags Flags;
   Flags.SetEnableDoublePrecision(hasDouble);
   Flags.SetInt64Ops(has64Int);
   Flags.SetLowPrecisionPresent(has16);
@@ -487,6 +495,59 @@ void DxilModule::CollectShaderFlags(ShaderFlags &Flags) {
   Flags.SetEnableMSAD(hasMSAD);
   Flags.SetUAVLoadAdditionalFormats(hasMulticomponentUAVLoads);
   Flags.SetViewID(hasViewID);
+  Flags.SetInnerCoverage(hasInnerCoverage);
+  return Flags;
+}
+
+void DxilModule::InvalidateShaderFlags(const Function *F) {
+  if (m_pShaderFlagsCache)
+    m_pShaderFlagsCache->FunctionFlags.erase(F);
+}
+
+void DxilModule::InvalidateShaderFlags() {
+  m_pShaderFlagsCache.reset();
+}
+
+void DxilModule::CollectShaderFlags(ShaderFlags &Flags) {
+  bool hasMulticomponentUAVLoadsBackCompat = false;
+
+  // Try to maintain compatibility with a v1.0 validator if that's what we have.
+  {
+    unsigned valMajor, valMinor;
+    GetValidatorVersion(valMajor, valMinor);
+    hasMulticomponentUAVLoadsBackCompat = valMajor <= 1 && valMinor == 0;
+  }
+
+  if (!m_pShaderFlagsCache || m_pShaderFlagsCache->UAVLoadsBackCompat !=
+                                  hasMulticomponentUAVLoadsBackCompat) {
+    m_pShaderFlagsCache = std::make_unique<ShaderFlagsCache>(
+        hasMulticomponentUAVLoadsBackCompat);
+  }
+
+  uint64_t instFlagsRaw = 0;
+  for (Function &F : GetModule()->functions()) {
+    auto it = m_pShaderFlagsCache->FunctionFlags.find(&F);
+    if (it == m_pShaderFlagsCache->FunctionFlags.end()) {
+      ShaderFlags FuncFlags =
+          CollectFunctionShaderFlags(F, hasMulticomponentUAVLoadsBackCompat);
+      it = m_pShaderFlagsCache->FunctionFlags.insert(
+          std::make_pair(&F, FuncFlags)).first;
+    }
+    instFlagsRaw |= it->second.GetShaderFlagsRaw();
+  }
+  ShaderFlags InstFlags;
+  InstFlags.SetShaderFlagsRaw(instFlagsRaw);
+  bool hasInnerCoverage = InstFlags.GetInnerCoverage();
+
+  Flags.SetEnableDoublePrecision(InstFlags.GetEnableDoublePrecision());
+  Flags.SetInt64Ops(InstFlags.GetInt64Ops());
+  Flags.SetLowPrecisionPresent(InstFlags.GetLowPrecisionPresent());
+  Flags.SetEnableDoubleExtensions(InstFlags.GetEnableDoubleExtensions());
+  Flags.SetWaveOps(InstFlags.GetWaveOps());
+  Flags.SetTiledResources(InstFlags.GetTiledResources());
+  Flags.SetEnableMSAD(InstFlags.GetEnableMSAD());
+  Flags.SetUAVLoadAdditionalFormats(InstFlags.GetUAVLoadAdditionalFormats());
+  Flags.SetViewID(InstFlags.GetViewID());
 
   const ShaderModel *SM = GetShaderModel();
   if (SM->IsPS()) {
@@ -739,9 +800,18 @@ void DxilModule::SetMaxTessellationFactor(float MaxTessellationFactor) {
   m_MaxTessellationFactor = MaxTessellationFactor;
 }
 
+unsigned DxilModule::GetWaveSize() const {
+  return m_WaveSize;
+}
+
+void DxilModule::SetWaveSize(unsigned WaveSize) {
+  m_WaveSize = WaveSize;
+}
+
 void DxilModule::SetShaderProperties(DxilFunctionProps *props) {
   if (!props)
     return;
+  SetWaveSize(props->waveSize);
   switch (props->shaderKind) {
   case DXIL::ShaderKind::Pixel: {
     auto &PS = props->ShaderProps.PS;
@@ -925,12 +995,13 @@ void DxilModule::LoadDxilSamplerFromMDNode(llvm::MDNode *MD, DxilSampler &S) {
 template <typename TResource>
 static void RemoveResources(std::vector<std::unique_ptr<TResource>> &vec,
                     std::unordered_set<unsigned> &immResID) {
-  for (std::vector<std::unique_ptr<TResource>>::iterator p = vec.begin(); p != vec.end();) {
-    std::vector<std::unique_ptr<TResource>>::iterator c = p++;
-    if (immResID.count((*c)->GetID()) == 0) {
-      p = vec.erase(c);
-    }
-  }
+  // Compact in a single pass; erasing one by one is quadratic when most of
+  // a large number of resources are unused.
+  vec.erase(std::remove_if(vec.begin(), vec.end(),
+                           [&](const std::unique_ptr<TResource> &R) {
+                             return immResID.count(R->GetID()) == 0;
+                           }),
+            vec.end());
 }
 
 static void CollectUsedResource(Value *resID,
@@ -1125,6 +1196,14 @@ DxilTypeSystem &DxilModule::GetTypeSystem() {
   return *m_pTypeSystem;
 }
 
+void DxilModule::SetCompactTypeAnnotations(bool bCompact) {
+  m_pMDHelper->SetCompactTypeSystem(bCompact);
+}
+
+bool DxilModule::GetCompactTypeAnnotations() const {
+  return m_pMDHelper->IsCompactTypeSystem();
+}
+
 DxilViewIdState &DxilModule::GetViewIdState() {
   return *m_pViewIdState;
 }
@@ -1394,6 +1473,8 @@ MDTuple *DxilModule::EmitDxilResources() {
 }
 
 void DxilModule::ReEmitDxilResources() {
+  // Passes that re-emit resources have usually added instructions too.
+  InvalidateShaderFlags();
   ClearDxilMetadata(*m_pModule);
   if (!m_pSM->IsCS() && !m_pSM->IsLib())
     m_pViewIdState->Compute();
@@ -1540,6 +1621,12 @@ MDTuple *DxilModule::EmitDxilShaderProperties() {
     MDVals.emplace_back(MDNode::get(m_Ctx, NumThreadVals));
   }
 
+  // Wave size specialization.
+  if (m_WaveSize != 0) {
+    MDVals.emplace_back(m_pMDHelper->Uint32ToConstMD(DxilMDHelper::kDxilWaveSizeTag));
+    MDVals.emplace_back(m_pMDHelper->Uint32ToConstMD(m_WaveSize));
+  }
+
   // Geometry shader.
   if (m_pSM->IsGS()) {
     MDVals.emplace_back(m_pMDHelper->Uint32ToConstMD(DxilMDHelper::kDxilGSStateTag));
@@ -1604,6 +1691,10 @@ void DxilModule::LoadDxilShaderProperties(const MDOperand &MDO) {
       break;
     }
 
+    case DxilMDHelper::kDxilWaveSizeTag:
+      m_WaveSize = DxilMDHelper::ConstMDToUint32(MDO);
+      break;
+
     case DxilMDHelper::kDxilGSStateTag: {
       m_pMDHelper->LoadDxilGSState(MDO, m_InputPrimitive, m_MaxVertexCount, m_ActiveStreamMask, 
                                    m_StreamPrimitiveTopology, m_NumGSInstances);
@@ -359,7 +359,11 @@ bool OP::IsDxilOpFuncName(StringRef name) {
 }
 
 bool OP::IsDxilOpFunc(const llvm::Function *F) {
-  if (!F->hasName())
+  // Looking up the name of a value hashes into the context, so rule out
+  // functions that cannot be DXIL operations by their shape first: those are
+  // declarations taking the i32 opcode as their first parameter.
+  if (!F->hasName() || !F->isDeclaration() || F->arg_empty() ||
+      !F->getFunctionType()->getParamType(0)->isIntegerTy(32))
     return false;
   return IsDxilOpFuncName(F->getName());
 }
@@ -487,6 +491,11 @@ OP::OP(LLVMContext &Ctx, Module *pModule)
 
 void OP::RefreshCache() {
   for (Function &F : m_pModule->functions()) {
+    // Only functions that are not cached yet need the name check and overload
+    // lookup, so refreshing after adding a few functions stays cheap.
+    OpCodeClass opClass;
+    if (GetCachedOpCodeClass(&F, opClass))
+      continue;
     if (OP::IsDxilOpFunc(&F) && !F.user_empty()) {
       CallInst *CI = cast<CallInst>(*F.user_begin());
       OpCode OpCode = OP::GetDxilOpFuncCallInst(CI);
@@ -511,7 +520,7 @@ Function *OP::GetOpFunc(OpCode OpCode, Type *pOverloadType) {
   OpCodeClass opClass = m_OpCodeProps[(unsigned)OpCode].OpCodeClass;
   Function *&F = m_OpCodeClassCache[(unsigned)opClass].pOverloads[TypeSlot];
   if (F != nullptr) {
-    UpdateCache(opClass, TypeSlot, F);
+    // Cached functions are already in m_FunctionToOpClass.
     return F;
   }
 
@@ -817,7 +826,32 @@ void OP::RemoveFunction(Function *F) {
   }
 }
 
+bool OP::GetCachedOpCodeClass(const Function *F, OP::OpCodeClass &opClass) const {
+  if (F->user_empty())
+    return false;
+  const CallInst *CI = dyn_cast<CallInst>(*F->user_begin());
+  if (CI == nullptr || CI->getCalledFunction() != F ||
+      CI->getNumArgOperands() == 0)
+    return false;
+  const ConstantInt *opcodeArg = dyn_cast<ConstantInt>(CI->getArgOperand(0));
+  if (opcodeArg == nullptr ||
+      opcodeArg->getZExtValue() >= (uint64_t)OpCode::NumOpCodes)
+    return false;
+  OpCodeClass candidate = m_OpCodeProps[opcodeArg->getZExtValue()].OpCodeClass;
+  for (const Function *pOverload :
+       m_OpCodeClassCache[(unsigned)candidate].pOverloads) {
+    if (pOverload == F) {
+      opClass = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
 bool OP::GetOpCodeClass(const Function *F, OP::OpCodeClass &opClass) {
+  // Functions in use are found from the opcode of a call without hashing.
+  if (GetCachedOpCodeClass(F, opClass))
+    return true;
   auto iter = m_FunctionToOpClass.find(F);
   if (iter == m_FunctionToOpClass.end()) {
     DXASSERT(!IsDxilOpFunc(F), "dxil function without an opcode class mapping?");
@@ -0,0 +1,301 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPackGroupShared.cpp                                                   //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Shares and pads groupshared storage.                                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilUtil.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-pack-groupshared"
+
+STATISTIC(NumGroupSharedShared, "Number of groupshared variables sharing storage");
+STATISTIC(NumGroupSharedPadded, "Number of groupshared arrays padded");
+
+namespace {
+
+// Thread group shared memory limits how many groups fit on a core.
+//
+// A variable whose accesses all come after a group sync that no access of
+// another variable of the same type follows can reuse that variable's
+// storage, since no thread touches the first one after the sync.
+//
+// With PadForBanks, 2D arrays of 32-bit elements whose rows are a multiple
+// of the bank count wide get one element of padding per row, so walking a
+// column doesn't hit the same bank in every lane. Only arrays indexed down
+// to the element by every use are padded, so the indices stay valid.
+class DxilPackGroupShared : public ModulePass {
+  bool m_PadForBanks;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilPackGroupShared(bool PadForBanks = false)
+      : ModulePass(ID), m_PadForBanks(PadForBanks) {}
+
+  const char *getPassName() const override {
+    return "DXIL Pack Groupshared";
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionBool(O, "pad-for-banks", &m_PadForBanks, false);
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool ShareStorage(Function &F, std::vector<GlobalVariable *> &GVs);
+  bool PadForBanks(Module &M, std::vector<GlobalVariable *> &GVs);
+};
+
+const unsigned kBankCount = 32;
+
+}
+
+// Collects the instructions using GV, looking through constant expressions.
+// Returns false if GV is used outside F.
+static bool CollectUsers(Value *V, Function &F,
+                         std::vector<Instruction *> &Users) {
+  for (User *U : V->users()) {
+    if (Instruction *I = dyn_cast<Instruction>(U)) {
+      if (I->getParent()->getParent() != &F)
+        return false;
+      Users.emplace_back(I);
+    } else if (isa<ConstantExpr>(U)) {
+      if (!CollectUsers(U, F, Users))
+        return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+static unsigned GetGroupSharedBytes(Module &M) {
+  const DataLayout &DL = M.getDataLayout();
+  unsigned bytes = 0;
+  for (GlobalVariable &GV : M.globals()) {
+    if (dxilutil::IsSharedMemoryGlobal(&GV))
+      bytes += DL.getTypeAllocSize(GV.getType()->getElementType());
+  }
+  return bytes;
+}
+
+bool DxilPackGroupShared::ShareStorage(Function &F,
+                                       std::vector<GlobalVariable *> &GVs) {
+  std::vector<CallInst *> syncs;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (!OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::Barrier))
+        continue;
+      DxilInst_Barrier barrier(&I);
+      ConstantInt *mode = dyn_cast<ConstantInt>(barrier.get_barrierMode());
+      const unsigned ordersTGSM =
+          (unsigned)DXIL::BarrierMode::SyncThreadGroup |
+          (unsigned)DXIL::BarrierMode::TGSMFence;
+      if (mode && (mode->getLimitedValue() & ordersTGSM) == ordersTGSM)
+        syncs.emplace_back(cast<CallInst>(&I));
+    }
+  }
+  if (syncs.empty())
+    return false;
+
+  DominatorTree DT;
+  DT.recalculate(F);
+
+  // Storage in use and the accesses made to it so far.
+  struct Slot {
+    GlobalVariable *GV;
+    std::vector<Instruction *> Users;
+  };
+  std::vector<Slot> slots;
+  bool bChanged = false;
+  for (GlobalVariable *GV : GVs) {
+    std::vector<Instruction *> users;
+    if (!CollectUsers(GV, F, users) || users.empty())
+      continue;
+
+    Slot *reuse = nullptr;
+    for (Slot &S : slots) {
+      if (S.GV->getType() != GV->getType())
+        continue;
+      // A sync no earlier access follows must dominate the new accesses.
+      for (CallInst *sync : syncs) {
+        bool bAllBefore = true;
+        for (Instruction *I : S.Users) {
+          if (isPotentiallyReachable(sync, I, &DT)) {
+            bAllBefore = false;
+            break;
+          }
+        }
+        if (!bAllBefore)
+          continue;
+        bool bAllAfter = true;
+        for (Instruction *I : users) {
+          if (!DT.dominates(sync, I)) {
+            bAllAfter = false;
+            break;
+          }
+        }
+        if (bAllAfter) {
+          reuse = &S;
+          break;
+        }
+      }
+      if (reuse)
+        break;
+    }
+
+    if (!reuse) {
+      slots.push_back({GV, users});
+      continue;
+    }
+    DEBUG(dbgs() << GV->getName() << " shares storage with "
+                 << reuse->GV->getName() << "\n");
+    GV->replaceAllUsesWith(reuse->GV);
+    GV->eraseFromParent();
+    reuse->Users.insert(reuse->Users.end(), users.begin(), users.end());
+    ++NumGroupSharedShared;
+    bChanged = true;
+  }
+  return bChanged;
+}
+
+// Returns the padded type for a [N x [M x T]] array of 32-bit T with M a
+// multiple of the bank count, or null.
+static ArrayType *GetPaddedType(Type *Ty) {
+  ArrayType *AT = dyn_cast<ArrayType>(Ty);
+  if (!AT || AT->getNumElements() < 2)
+    return nullptr;
+  ArrayType *RowTy = dyn_cast<ArrayType>(AT->getElementType());
+  if (!RowTy || RowTy->getNumElements() % kBankCount != 0)
+    return nullptr;
+  Type *EltTy = RowTy->getElementType();
+  if (!EltTy->isIntegerTy(32) && !EltTy->isFloatTy())
+    return nullptr;
+  return ArrayType::get(ArrayType::get(EltTy, RowTy->getNumElements() + 1),
+                        AT->getNumElements());
+}
+
+bool DxilPackGroupShared::PadForBanks(Module &M,
+                                      std::vector<GlobalVariable *> &GVs) {
+  bool bChanged = false;
+  for (GlobalVariable *&GV : GVs) {
+    ArrayType *PaddedTy = GetPaddedType(GV->getType()->getElementType());
+    if (!PaddedTy)
+      continue;
+    // Every use must index down to an element.
+    bool bAllElementGEPs = true;
+    for (User *U : GV->users()) {
+      GEPOperator *GEP = dyn_cast<GEPOperator>(U);
+      if (!GEP || GEP->getNumIndices() != 3 ||
+          GEP->getType()->getPointerElementType()->isAggregateType()) {
+        bAllElementGEPs = false;
+        break;
+      }
+    }
+    if (!bAllElementGEPs)
+      continue;
+    const DataLayout &DL = M.getDataLayout();
+    if (GetGroupSharedBytes(M) + DL.getTypeAllocSize(PaddedTy) -
+            DL.getTypeAllocSize(GV->getType()->getElementType()) >
+        DXIL::kMaxTGSMSize)
+      continue;
+
+    GlobalVariable *NewGV = new GlobalVariable(
+        M, PaddedTy, /*IsConstant*/ false, GV->getLinkage(),
+        UndefValue::get(PaddedTy), "", GV,
+        GlobalVariable::NotThreadLocal, DXIL::kTGSMAddrSpace);
+    NewGV->setAlignment(GV->getAlignment());
+    for (auto U = GV->user_begin(), E = GV->user_end(); U != E;) {
+      User *GEPU = *(U++);
+      SmallVector<Value *, 3> idxList(GEPU->op_begin() + 1, GEPU->op_end());
+      if (ConstantExpr *CE = dyn_cast<ConstantExpr>(GEPU)) {
+        SmallVector<Constant *, 3> constIdxList;
+        for (Value *Idx : idxList)
+          constIdxList.emplace_back(cast<Constant>(Idx));
+        Constant *NewCE =
+            ConstantExpr::getGetElementPtr(PaddedTy, NewGV, constIdxList);
+        CE->replaceAllUsesWith(NewCE);
+        CE->destroyConstant();
+      } else {
+        GetElementPtrInst *GEP = cast<GetElementPtrInst>(GEPU);
+        GetElementPtrInst *NewGEP = GetElementPtrInst::Create(
+            PaddedTy, NewGV, idxList, "", GEP);
+        NewGEP->setIsInBounds(GEP->isInBounds());
+        NewGEP->takeName(GEP);
+        GEP->replaceAllUsesWith(NewGEP);
+        GEP->eraseFromParent();
+      }
+    }
+    NewGV->takeName(GV);
+    GV->eraseFromParent();
+    GV = NewGV;
+    ++NumGroupSharedPadded;
+    bChanged = true;
+  }
+  return bChanged;
+}
+
+bool DxilPackGroupShared::runOnModule(Module &M) {
+  if (!M.HasDxilModule())
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+  // Library functions may be called with other shared memory live.
+  if (DM.GetShaderModel()->IsLib() || !DM.GetEntryFunction())
+    return false;
+
+  std::vector<GlobalVariable *> GVs;
+  for (GlobalVariable &GV : M.globals()) {
+    if (dxilutil::IsSharedMemoryGlobal(&GV))
+      GVs.emplace_back(&GV);
+  }
+  if (GVs.empty())
+    return false;
+
+  unsigned bytesBefore = GetGroupSharedBytes(M);
+  bool bChanged = ShareStorage(*DM.GetEntryFunction(), GVs);
+  if (bChanged) {
+    GVs.clear();
+    for (GlobalVariable &GV : M.globals()) {
+      if (dxilutil::IsSharedMemoryGlobal(&GV))
+        GVs.emplace_back(&GV);
+    }
+  }
+  if (m_PadForBanks)
+    bChanged |= PadForBanks(M, GVs);
+  DEBUG(dbgs() << "Groupshared bytes " << bytesBefore << " -> "
+               << GetGroupSharedBytes(M) << "\n");
+  return bChanged;
+}
+
+char DxilPackGroupShared::ID = 0;
+
+ModulePass *llvm::createDxilPackGroupSharedPass(bool PadForBanks) {
+  return new DxilPackGroupShared(PadForBanks);
+}
+
+INITIALIZE_PASS(DxilPackGroupShared, "hlsl-dxil-pack-groupshared",
+                "DXIL Pack Groupshared", false, false)
@@ -262,6 +262,9 @@ public:
       hlsl::OP *hlslOP = M.GetDxilModule().GetOP();
       RemoveStoreUndefOutput(M, hlslOP);
 
+      // Remove readnone added to loads by DxilMarkReadNoneLoads.
+      StripReadNoneCallSites(M, hlslOP);
+
       RemoveUnusedStaticGlobal(M);
 
       // Clear inbound for GEP which has none-const index.
@@ -284,6 +287,20 @@ public:
   }
 
 private:
+  void StripReadNoneCallSites(Module &M, hlsl::OP *hlslOP) {
+    Attribute ReadNone = Attribute::get(M.getContext(), Attribute::ReadNone);
+    for (Function &F : M.functions()) {
+      if (!hlslOP->IsDxilOpFunc(&F) || F.doesNotAccessMemory())
+        continue;
+      for (User *U : F.users()) {
+        CallInst *CI = dyn_cast<CallInst>(U);
+        if (CI && CI->getAttributes().hasAttribute(
+                      AttributeSet::FunctionIndex, Attribute::ReadNone))
+          CI->removeAttribute(AttributeSet::FunctionIndex, ReadNone);
+      }
+    }
+  }
+
   void RemoveUnusedStaticGlobal(Module &M) {
     // Remove unused internal global.
     std::vector<GlobalVariable *> staticGVs;
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPromoteEarlyDepthStencil.cpp                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Forces early depth-stencil for pixel shaders it can't make a difference   //
+// to.                                                                       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilShaderModel.h"
+#include "dxc/HLSL/DxilSignatureElement.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-promote-early-depth-stencil"
+
+STATISTIC(NumPromoted, "Number of pixel shaders given early depth-stencil");
+
+// With early depth-stencil, the depth-stencil test and writes happen before
+// the shader runs rather than after. That is only visible to a shader that
+// changes the outcome of the test, by writing depth, stencil reference or
+// coverage or by discarding, or that has side effects for pixels that would
+// fail it, which for a pixel shader are UAV writes.
+bool hlsl::CanForceEarlyDepthStencil(DxilModule &DM, const char **pReason) {
+  *pReason = nullptr;
+  if (!DM.GetShaderModel()->IsPS()) {
+    *pReason = "not a pixel shader";
+    return false;
+  }
+
+  for (auto &E : DM.GetOutputSignature().GetElements()) {
+    switch (E->GetKind()) {
+    default:
+      break;
+    case Semantic::Kind::Depth:
+    case Semantic::Kind::DepthLessEqual:
+    case Semantic::Kind::DepthGreaterEqual:
+      *pReason = "the shader writes depth";
+      return false;
+    case Semantic::Kind::Coverage:
+      *pReason = "the shader writes SV_Coverage";
+      return false;
+    case Semantic::Kind::StencilRef:
+      *pReason = "the shader writes SV_StencilRef";
+      return false;
+    }
+  }
+
+  // Overloads are shared by the opcodes of a class, so each call is checked.
+  for (Function &F : DM.GetModule()->functions()) {
+    if (!OP::IsDxilOpFunc(&F))
+      continue;
+    for (User *U : F.users()) {
+      CallInst *CI = dyn_cast<CallInst>(U);
+      if (!CI)
+        continue;
+      switch (OP::GetDxilOpFuncCallInst(CI)) {
+      default:
+        break;
+      case DXIL::OpCode::Discard:
+        *pReason = "the shader uses discard";
+        return false;
+      case DXIL::OpCode::BufferStore:
+      case DXIL::OpCode::RawBufferStore:
+      case DXIL::OpCode::TextureStore:
+      case DXIL::OpCode::BufferUpdateCounter:
+      case DXIL::OpCode::AtomicBinOp:
+      case DXIL::OpCode::AtomicCompareExchange:
+        *pReason = "the shader writes to UAVs";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+namespace {
+
+// Unlike hlsl-dxil-force-early-z, which forces the flag for PIX, this only
+// sets it when CanForceEarlyDepthStencil proves it safe. Alpha-to-coverage
+// is pipeline state the compiler can't see: with it, the alpha output drops
+// samples, whose depth forced early depth-stencil would already have
+// written. So the pass only runs with -auto-early-depth-stencil.
+class DxilPromoteEarlyDepthStencil : public ModulePass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilPromoteEarlyDepthStencil() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Promote Early Depth-Stencil";
+  }
+
+  bool runOnModule(Module &M) override {
+    if (!M.HasDxilModule())
+      return false;
+    DxilModule &DM = M.GetDxilModule();
+    if (!DM.GetShaderModel()->IsPS() ||
+        DM.m_ShaderFlags.GetForceEarlyDepthStencil())
+      return false;
+
+    const char *pReason;
+    if (!CanForceEarlyDepthStencil(DM, &pReason))
+      return false;
+    DM.m_ShaderFlags.SetForceEarlyDepthStencil(true);
+    ++NumPromoted;
+    return true;
+  }
+};
+
+} // namespace
+
+char DxilPromoteEarlyDepthStencil::ID = 0;
+
+ModulePass *llvm::createDxilPromoteEarlyDepthStencilPass() {
+  return new DxilPromoteEarlyDepthStencil();
+}
+
+INITIALIZE_PASS(DxilPromoteEarlyDepthStencil,
+                "hlsl-dxil-promote-early-depth-stencil",
+                "DXIL Promote Early Depth-Stencil", false, false)
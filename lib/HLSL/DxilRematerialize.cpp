@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilRematerialize.cpp                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Recomputes cheap values next to their uses to reduce register pressure.   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilUtil.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-rematerialize"
+
+STATISTIC(NumRematerialized, "Number of values rematerialized at their uses");
+
+namespace {
+
+// DXIL is emitted without register allocation, so GVN, LICM and the
+// constant array hoisting leave values live across large parts of the
+// shader, and the driver has to keep them all in registers. When a
+// function's estimated peak of live values is over the threshold, cheap ALU
+// and cbuffer loads used in other blocks are recomputed in each block that
+// uses them. Values aren't moved into deeper loops.
+class DxilRematerialize : public FunctionPass {
+  unsigned m_MaxLiveValues = 64;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilRematerialize() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Rematerialize";
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUnsigned(O, "max-live-values", &m_MaxLiveValues, 64);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool SinkToUses(Instruction *I, LoopInfo &LI);
+};
+
+// Limit on the chain of operands recomputed with a value.
+const unsigned kMaxRematDepth = 3;
+
+}
+
+static bool IsHandle(Value *V) {
+  Instruction *I = dyn_cast<Instruction>(V);
+  return I && OP::IsDxilOpFuncCallInst(I, OP::OpCode::CreateHandle);
+}
+
+static bool IsRematerializable(Instruction *I, unsigned Depth) {
+  if (Depth > kMaxRematDepth)
+    return false;
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    // Constant buffers don't change during the shader.
+    if (!OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CBufferLoadLegacy) &&
+        !OP::IsDxilOpFuncCallInst(CI, OP::OpCode::CBufferLoad))
+      return false;
+  } else if (!isa<BinaryOperator>(I) && !isa<CastInst>(I) &&
+             !isa<CmpInst>(I) && !isa<SelectInst>(I) &&
+             !isa<ExtractValueInst>(I)) {
+    return false;
+  }
+  for (Value *Op : I->operands()) {
+    if (isa<Constant>(Op) || IsHandle(Op))
+      continue;
+    Instruction *OpI = dyn_cast<Instruction>(Op);
+    if (!OpI || !IsRematerializable(OpI, Depth + 1))
+      return false;
+  }
+  return true;
+}
+
+// Clones I and the operands it doesn't share with InsertPt's block in front
+// of InsertPt.
+static Instruction *CloneBefore(Instruction *I, Instruction *InsertPt) {
+  Instruction *Clone = I->clone();
+  for (unsigned i = 0; i < Clone->getNumOperands(); ++i) {
+    Instruction *OpI = dyn_cast<Instruction>(Clone->getOperand(i));
+    if (!OpI || IsHandle(OpI) || OpI->getParent() == InsertPt->getParent())
+      continue;
+    Clone->setOperand(i, CloneBefore(OpI, InsertPt));
+  }
+  Clone->insertBefore(InsertPt);
+  return Clone;
+}
+
+bool DxilRematerialize::SinkToUses(Instruction *I, LoopInfo &LI) {
+  BasicBlock *DefBB = I->getParent();
+  unsigned DefDepth = LI.getLoopDepth(DefBB);
+
+  // Group the uses outside the defining block by the block they are in.
+  // A phi uses the value at the end of the incoming block.
+  DenseMap<BasicBlock *, SmallVector<Use *, 4>> UsesByBlock;
+  for (Use &U : I->uses()) {
+    Instruction *User = cast<Instruction>(U.getUser());
+    BasicBlock *UseBB = User->getParent();
+    if (PHINode *PN = dyn_cast<PHINode>(User))
+      UseBB = PN->getIncomingBlock(U);
+    if (UseBB == DefBB || LI.getLoopDepth(UseBB) > DefDepth)
+      continue;
+    UsesByBlock[UseBB].push_back(&U);
+  }
+
+  bool bChanged = false;
+  for (auto &It : UsesByBlock) {
+    BasicBlock *UseBB = It.first;
+    SmallPtrSet<Instruction *, 4> Users;
+    for (Use *U : It.second)
+      Users.insert(cast<Instruction>(U->getUser()));
+    // Recompute the value in front of its first non-phi user in the block.
+    Instruction *InsertPt = UseBB->getTerminator();
+    for (Instruction &BI : *UseBB) {
+      if (!isa<PHINode>(BI) && Users.count(&BI)) {
+        InsertPt = &BI;
+        break;
+      }
+    }
+    Instruction *Clone = CloneBefore(I, InsertPt);
+    for (Use *U : It.second)
+      U->set(Clone);
+    ++NumRematerialized;
+    bChanged = true;
+  }
+  return bChanged;
+}
+
+bool DxilRematerialize::runOnFunction(Function &F) {
+  unsigned MaxLive = dxilutil::EstimateMaxLiveValues(F);
+  if (MaxLive <= m_MaxLiveValues)
+    return false;
+
+  SmallVector<WeakVH, 32> Candidates;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (IsRematerializable(&I, 0))
+        Candidates.emplace_back(&I);
+    }
+  }
+
+  // Sink the users of a value before the value itself so the chain is
+  // recomputed together.
+  LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  bool bChanged = false;
+  for (auto It = Candidates.rbegin(), E = Candidates.rend(); It != E; ++It) {
+    Value *V = *It;
+    Instruction *I = cast_or_null<Instruction>(V);
+    if (!I)
+      continue;
+    bChanged |= SinkToUses(I, LI);
+    RecursivelyDeleteTriviallyDeadInstructions(I);
+  }
+
+  DEBUG(dbgs() << F.getName() << ": estimated max live values " << MaxLive
+               << " -> " << dxilutil::EstimateMaxLiveValues(F) << "\n");
+  return bChanged;
+}
+
+char DxilRematerialize::ID = 0;
+
+FunctionPass *llvm::createDxilRematerializePass() {
+  return new DxilRematerialize();
+}
+
+INITIALIZE_PASS_BEGIN(DxilRematerialize, "hlsl-dxil-rematerialize",
+                      "DXIL Rematerialize", false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(DxilRematerialize, "hlsl-dxil-rematerialize",
+                    "DXIL Rematerialize", false, false)
@@ -17,7 +17,10 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/dxcapi.h"
 
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 
 #include <string>
@@ -25,6 +28,9 @@
 #include <utility>
 #include <vector>
 #include <set>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 using namespace llvm;
 using std::string;
@@ -1682,4 +1688,141 @@ bool VerifyRootSignatureWithShaderPSV(const DxilVersionedRootSignatureDesc *pDes
   return true;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Root signature interning.
+
+namespace {
+
+// Entries live until llvm_shutdown, so everything they own is allocated from
+// the default allocator rather than the allocator of the current invocation.
+// Entries are never evicted, which keeps the cached verifiers alive while
+// they are in use; the cache just stops growing once full.
+class RootSignatureCache {
+public:
+  static const size_t kMaxEntries = 256;
+
+  // The serialized blob is never modified, so all compiles of the same source
+  // share it instead of copying it.
+  bool FindCompiled(llvm::StringRef source, DxilRootSignatureVersion version,
+                    IDxcBlob **ppSerialized) {
+    size_t hash = GetCompiledHash(source, version);
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto range = m_compiled.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second.Version == version && it->second.Source == source) {
+        *ppSerialized = it->second.Serialized;
+        (*ppSerialized)->AddRef();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void AddCompiled(llvm::StringRef source, DxilRootSignatureVersion version,
+                   IDxcBlob *pSerialized) {
+    size_t hash = GetCompiledHash(source, version);
+    DxcThreadMalloc TM(nullptr);
+    CompiledEntry entry;
+    entry.Version = version;
+    entry.Source = source.str();
+    IFT(DxcCreateBlobOnHeapCopy(pSerialized->GetBufferPointer(),
+                                pSerialized->GetBufferSize(),
+                                &entry.Serialized));
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_compiled.size() < kMaxEntries)
+      m_compiled.emplace(hash, std::move(entry));
+  }
+
+  RootSignatureVerifier *FindVerified(const std::string &serialized) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_verified.find(serialized);
+    return it == m_verified.end() ? nullptr : it->second.get();
+  }
+
+  // Verifies the root signature again for the cache, as the verifier keeps
+  // what it allocates.
+  RootSignatureVerifier *AddVerified(const std::string &serialized,
+                                     const DxilVersionedRootSignatureDesc *pDesc) {
+    DxcThreadMalloc TM(nullptr);
+    std::unique_ptr<RootSignatureVerifier> pVerifier(new RootSignatureVerifier());
+    DiagnosticPrinterRawOStream DiagPrinter(llvm::nulls());
+    pVerifier->VerifyRootSignature(pDesc, DiagPrinter);
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_verified.size() >= kMaxEntries)
+      return nullptr;
+    auto result = m_verified.emplace(
+        std::string(serialized.data(), serialized.size()), std::move(pVerifier));
+    return result.first->second.get();
+  }
+
+private:
+  struct CompiledEntry {
+    DxilRootSignatureVersion Version;
+    std::string Source;
+    CComPtr<IDxcBlob> Serialized;
+  };
+
+  static size_t GetCompiledHash(llvm::StringRef source,
+                                DxilRootSignatureVersion version) {
+    return llvm::hash_combine((unsigned)version, llvm::hash_value(source));
+  }
+
+  std::mutex m_lock;
+  // Keyed by the hash of version and source text.
+  std::unordered_multimap<size_t, CompiledEntry> m_compiled;
+  // Keyed by serialized bytes.
+  std::unordered_map<std::string, std::unique_ptr<RootSignatureVerifier>> m_verified;
+};
+
+llvm::ManagedStatic<RootSignatureCache> g_RootSignatureCache;
+
+} // anonymous namespace
+
+_Use_decl_annotations_
+bool FindCompiledRootSignature(const char *pSource, uint32_t SourceSize,
+                               DxilRootSignatureVersion Version,
+                               IDxcBlob **ppSerialized) {
+  *ppSerialized = nullptr;
+  return g_RootSignatureCache->FindCompiled(
+      llvm::StringRef(pSource, SourceSize), Version, ppSerialized);
+}
+
+_Use_decl_annotations_
+void AddCompiledRootSignature(const char *pSource, uint32_t SourceSize,
+                              DxilRootSignatureVersion Version,
+                              IDxcBlob *pSerialized) {
+  g_RootSignatureCache->AddCompiled(
+      llvm::StringRef(pSource, SourceSize), Version, pSerialized);
+}
+
+_Use_decl_annotations_
+bool VerifySerializedRootSignatureWithShaderPSV(const void *pRSData,
+                                                uint32_t RSSize,
+                                                DXIL::ShaderKind ShaderKind,
+                                                const void *pPSVData,
+                                                uint32_t PSVSize,
+                                                llvm::raw_ostream &DiagStream) {
+  try {
+    std::string serialized((const char *)pRSData, RSSize);
+    RootSignatureVerifier *pVerifier = g_RootSignatureCache->FindVerified(serialized);
+    if (pVerifier == nullptr) {
+      RootSignatureHandle RS;
+      RS.LoadSerialized((const uint8_t *)pRSData, RSSize);
+      RS.Deserialize();
+      if (!VerifyRootSignatureWithShaderPSV(RS.GetDesc(), ShaderKind, pPSVData,
+                                            PSVSize, DiagStream))
+        return false;
+      g_RootSignatureCache->AddVerified(serialized, RS.GetDesc());
+      return true;
+    }
+    DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+    pVerifier->VerifyShader(GetVisibilityType(ShaderKind), pPSVData, PSVSize,
+                            DiagPrinter);
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
 } // namespace hlsl
@@ -13,6 +13,10 @@
 #include "dxc/HLSL/DxilShaderModel.h"
 #include "dxc/Support/Global.h"
 
+/* <py>
+import hctdb_instrhelp
+</py> */
+
 #include <string>
 
 using std::string;
@@ -30,16 +34,110 @@ Semantic::Semantic(Kind Kind,
 {
 }
 
+/* <py::lines('SEMANTIC-NAME-HASH')>hctdb_instrhelp.get_semantic_name_hash()</py>*/
+// SEMANTIC-NAME-HASH:BEGIN
+static const unsigned kSemanticNameHashBucketCount = 16;
+static const unsigned kSemanticNameHashSlotCount = 64;
+
+static const unsigned SemanticNameHashSeeds[] = {
+  5, 0, 1, 0, 1, 1, 1, 2,
+  1, 1, 0, 2, 2, 1, 2, 2,
+};
+
+// Semantic kind of the name in each slot; Invalid for empty slots.
+static const DXIL::SemanticKind SemanticNameHashSlots[] = {
+  DXIL::SemanticKind::Position,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::GSInstanceID,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::GroupThreadID,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::OutputControlPointID,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::DispatchThreadID,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Barycentrics,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::InstanceID,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::ViewPortArrayIndex,
+  DXIL::SemanticKind::InnerCoverage,
+  DXIL::SemanticKind::InsideTessFactor,
+  DXIL::SemanticKind::DepthLessEqual,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Coverage,
+  DXIL::SemanticKind::ViewID,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::CullDistance,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::DomainLocation,
+  DXIL::SemanticKind::GroupIndex,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::GroupID,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::SampleIndex,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::TessFactor,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::VertexID,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::RenderTargetArrayIndex,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::StencilRef,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Target,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::IsFrontFace,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::Invalid,
+  DXIL::SemanticKind::ClipDistance,
+  DXIL::SemanticKind::Depth,
+  DXIL::SemanticKind::PrimitiveID,
+  DXIL::SemanticKind::DepthGreaterEqual,
+  DXIL::SemanticKind::Invalid,
+};
+// SEMANTIC-NAME-HASH:END
+
+// Hashes a lowercased semantic name for the SemanticNameHash tables.
+// This must match hlsl_intrinsic_name_hash in hctdb_instrhelp.py.
+static unsigned SemanticNameHash(llvm::StringRef name, unsigned seed) {
+  unsigned result = 2166136261u ^ seed;
+  for (char c : name) {
+    if (c >= 'A' && c <= 'Z')
+      c = c - 'A' + 'a';
+    result = (result ^ (unsigned char)c) * 16777619u;
+  }
+  return result;
+}
+
 const Semantic *Semantic::GetByName(llvm::StringRef name) {
   if (!HasSVPrefix(name))
     return GetArbitrary();
 
-  // The search is a simple linear scan as it is fairly infrequent operation and the list is short.
-  // The search can be improved if linear traversal has inadequate performance.
-  for (unsigned i = (unsigned)Kind::Arbitrary + 1; i < (unsigned)Kind::Invalid; i++) {
-    if (name.compare_lower(ms_SemanticTable[i].m_pszName) == 0)
-      return &ms_SemanticTable[i];
-  }
+  // Each system value name has its own slot, so only one name is compared.
+  unsigned bucket =
+      SemanticNameHash(name, 0) & (kSemanticNameHashBucketCount - 1);
+  unsigned slot = SemanticNameHash(name, SemanticNameHashSeeds[bucket]) &
+                  (kSemanticNameHashSlotCount - 1);
+  Kind kind = SemanticNameHashSlots[slot];
+  if (kind != Kind::Invalid &&
+      name.compare_lower(ms_SemanticTable[(unsigned)kind].m_pszName) == 0)
+    return &ms_SemanticTable[(unsigned)kind];
 
   return GetInvalid();
 }
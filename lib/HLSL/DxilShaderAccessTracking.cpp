@@ -19,6 +19,7 @@
 
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include <deque>
 
@@ -136,6 +137,12 @@ private:
 
 private:
   bool m_CheckForDynamicIndexing = false;
+  // With waveAggregate, one lane records an access for the whole wave when
+  // every lane accesses the same slot, and a block records each constant
+  // slot and access type once. The OR is idempotent, so this only drops
+  // atomics that can't change the result.
+  bool m_WaveAggregate = false;
+  std::map<BasicBlock *, std::set<std::pair<unsigned, unsigned>>> m_RecordedInBlock;
   std::map<RegisterTypeAndSpace, SlotRange> m_slotAssignments;
   CallInst *m_HandleForUAV;
   std::set<RSRegisterIdentifier> m_DynamicallyIndexedBindPoints;
@@ -194,6 +201,10 @@ void DxilShaderAccessTracking::applyOptions(PassOptions O) {
   GetPassOptionInt(O, "checkForDynamicIndexing", &checkForDynamic, 0);
   m_CheckForDynamicIndexing = checkForDynamic != 0;
 
+  int waveAggregate;
+  GetPassOptionInt(O, "waveAggregate", &waveAggregate, 0);
+  m_WaveAggregate = waveAggregate != 0;
+
   StringRef configOption;
   if (GetPassOption(O, "config", &configOption)) {
     std::deque<char> config;
@@ -228,6 +239,37 @@ void DxilShaderAccessTracking::applyOptions(PassOptions O) {
 
 void DxilShaderAccessTracking::EmitAccess(LLVMContext & Ctx, OP *HlslOP, IRBuilder<> & Builder, Value * slot, ShaderAccessFlags access)
 {
+  if (m_WaveAggregate) {
+    if (ConstantInt *ConstSlot = dyn_cast<ConstantInt>(slot)) {
+      BasicBlock *BB = Builder.GetInsertBlock();
+      std::pair<unsigned, unsigned> key((unsigned)ConstSlot->getLimitedValue(),
+                                        static_cast<unsigned>(access));
+      if (!m_RecordedInBlock[BB].insert(key).second)
+        return;
+    }
+
+    // Only the first lane records the access unless the lanes' slots differ.
+    Constant *IsFirstLaneOpcode = HlslOP->GetU32Const((unsigned)OP::OpCode::WaveIsFirstLane);
+    Function *IsFirstLaneFunc = HlslOP->GetOpFunc(OP::OpCode::WaveIsFirstLane, Type::getVoidTy(Ctx));
+    Value *ShouldRecord = Builder.CreateCall(IsFirstLaneFunc, { IsFirstLaneOpcode }, "IsFirstLane");
+    if (!isa<Constant>(slot)) {
+      Constant *ReadFirstOpcode = HlslOP->GetU32Const((unsigned)OP::OpCode::WaveReadLaneFirst);
+      Function *ReadFirstFunc = HlslOP->GetOpFunc(OP::OpCode::WaveReadLaneFirst, Type::getInt32Ty(Ctx));
+      Value *FirstSlot = Builder.CreateCall(ReadFirstFunc, { ReadFirstOpcode, slot }, "FirstLaneSlot");
+      Value *DiffersFromFirst = Builder.CreateICmpNE(slot, FirstSlot, "DiffersFromFirst");
+      Constant *AnyTrueOpcode = HlslOP->GetU32Const((unsigned)OP::OpCode::WaveAnyTrue);
+      Function *AnyTrueFunc = HlslOP->GetOpFunc(OP::OpCode::WaveAnyTrue, Type::getVoidTy(Ctx));
+      Value *SlotsDiffer = Builder.CreateCall(AnyTrueFunc, { AnyTrueOpcode, DiffersFromFirst }, "SlotsDiffer");
+      ShouldRecord = Builder.CreateOr(ShouldRecord, SlotsDiffer, "ShouldRecord");
+    }
+    BasicBlock *Head = Builder.GetInsertBlock();
+    TerminatorInst *RecordTerm = SplitBlockAndInsertIfThen(ShouldRecord, &*Builder.GetInsertPoint(), false);
+    // The tail always runs after the head, so it shares what was recorded.
+    BasicBlock *Tail = RecordTerm->getSuccessor(0);
+    m_RecordedInBlock[Tail] = m_RecordedInBlock[Head];
+    Builder.SetInsertPoint(RecordTerm);
+  }
+
   // Slots are four bytes each:
   auto ByteIndex = Builder.CreateMul(slot, HlslOP->GetU32Const(4));
 
@@ -498,6 +540,9 @@ bool DxilShaderAccessTracking::runOnModule(Module &M)
       }
     }
 
+    if (m_WaveAggregate && Modified)
+      DM.m_ShaderFlags.SetWaveOps(true);
+
     if (OSOverride != nullptr) {
       formatted_raw_ostream FOS(*OSOverride);
       FOS << "DynamicallyIndexedBindPoints=";
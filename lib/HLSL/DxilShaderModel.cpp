@@ -11,6 +11,7 @@
 #include "dxc/HLSL/DxilSemantic.h"
 #include "dxc/Support/Global.h"
 
+#include <vector>
 
 namespace hlsl {
 
@@ -72,15 +73,33 @@ const ShaderModel *ShaderModel::Get(unsigned Idx) {
     return GetInvalid();
 }
 
+// Shader model versions run from 4.0 to kHighestMajor.kHighestMinor.
+static const unsigned kLowestMajor = 4;
+static const unsigned kNumVersions =
+    (ShaderModel::kHighestMajor - kLowestMajor + 1) *
+    (ShaderModel::kHighestMinor + 1);
+
 const ShaderModel *ShaderModel::Get(Kind Kind, unsigned Major, unsigned Minor) {
-  // Linear search. Replaced by binary search if necessary.
-  for (unsigned i = 0; i < kNumShaderModels; i++) {
-    const ShaderModel *pSM = &ms_ShaderModels[i];
-    if (pSM->m_Kind == Kind && pSM->m_Major == Major && pSM->m_Minor == Minor)
-      return pSM;
-  }
+  if (Kind >= Kind::Invalid || Major < kLowestMajor || Major > kHighestMajor ||
+      Minor > kHighestMinor)
+    return GetInvalid();
 
-  return GetInvalid();
+  // Index of each kind and version in ms_ShaderModels, built on first use;
+  // versions a kind doesn't have map to the invalid model.
+  static const std::vector<unsigned> Index = [] {
+    std::vector<unsigned> Index((unsigned)DXIL::ShaderKind::Invalid *
+                                    kNumVersions,
+                                kNumShaderModels - 1);
+    for (unsigned i = 0; i < kNumShaderModels - 1; i++) {
+      const ShaderModel &SM = ms_ShaderModels[i];
+      Index[(unsigned)SM.m_Kind * kNumVersions +
+            (SM.m_Major - kLowestMajor) * (kHighestMinor + 1) + SM.m_Minor] = i;
+    }
+    return Index;
+  }();
+  return &ms_ShaderModels[Index[(unsigned)Kind * kNumVersions +
+                                (Major - kLowestMajor) * (kHighestMinor + 1) +
+                                Minor]];
 }
 
 const ShaderModel *ShaderModel::GetByName(const char *pszName) {
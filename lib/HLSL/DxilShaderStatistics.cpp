@@ -0,0 +1,322 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderStatistics.cpp                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Computes the static cost estimate of a shader entry.                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxilFunctionProps.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilUtil.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+void CountDxilOp(DXIL::OpCode opcode, DxilShaderStatistics &Stats) {
+  switch (opcode) {
+  case DXIL::OpCode::Acos:
+  case DXIL::OpCode::Asin:
+  case DXIL::OpCode::Atan:
+  case DXIL::OpCode::Cos:
+  case DXIL::OpCode::Exp:
+  case DXIL::OpCode::Hcos:
+  case DXIL::OpCode::Hsin:
+  case DXIL::OpCode::Htan:
+  case DXIL::OpCode::Log:
+  case DXIL::OpCode::Rsqrt:
+  case DXIL::OpCode::Sin:
+  case DXIL::OpCode::Sqrt:
+  case DXIL::OpCode::Tan:
+    ++Stats.TranscendentalCount;
+    return;
+  default:
+    break;
+  }
+
+  if (OP::IsDxilOpWave(opcode)) {
+    ++Stats.WaveCount;
+    return;
+  }
+
+  switch (OP::GetOpCodeClass(opcode)) {
+  case DXIL::OpCodeClass::CalculateLOD:
+  case DXIL::OpCodeClass::Sample:
+  case DXIL::OpCodeClass::SampleBias:
+  case DXIL::OpCodeClass::SampleCmp:
+  case DXIL::OpCodeClass::SampleCmpLevelZero:
+  case DXIL::OpCodeClass::SampleGrad:
+  case DXIL::OpCodeClass::SampleLevel:
+  case DXIL::OpCodeClass::TextureGather:
+  case DXIL::OpCodeClass::TextureGatherCmp:
+    ++Stats.SampleCount;
+    break;
+  case DXIL::OpCodeClass::BufferLoad:
+  case DXIL::OpCodeClass::CBufferLoad:
+  case DXIL::OpCodeClass::CBufferLoadLegacy:
+  case DXIL::OpCodeClass::RawBufferLoad:
+  case DXIL::OpCodeClass::TextureLoad:
+    ++Stats.LoadCount;
+    break;
+  case DXIL::OpCodeClass::BufferStore:
+  case DXIL::OpCodeClass::RawBufferStore:
+  case DXIL::OpCodeClass::TextureStore:
+    ++Stats.StoreCount;
+    break;
+  case DXIL::OpCodeClass::AtomicBinOp:
+  case DXIL::OpCodeClass::AtomicCompareExchange:
+  case DXIL::OpCodeClass::BufferUpdateCounter:
+    ++Stats.AtomicCount;
+    break;
+  case DXIL::OpCodeClass::Barrier:
+    ++Stats.BarrierCount;
+    break;
+  case DXIL::OpCodeClass::Binary:
+  case DXIL::OpCodeClass::BinaryWithCarryOrBorrow:
+  case DXIL::OpCodeClass::BinaryWithTwoOuts:
+  case DXIL::OpCodeClass::BitcastF16toI16:
+  case DXIL::OpCodeClass::BitcastF32toI32:
+  case DXIL::OpCodeClass::BitcastF64toI64:
+  case DXIL::OpCodeClass::BitcastI16toF16:
+  case DXIL::OpCodeClass::BitcastI32toF32:
+  case DXIL::OpCodeClass::BitcastI64toF64:
+  case DXIL::OpCodeClass::Dot2:
+  case DXIL::OpCodeClass::Dot3:
+  case DXIL::OpCodeClass::Dot4:
+  case DXIL::OpCodeClass::IsSpecialFloat:
+  case DXIL::OpCodeClass::LegacyDoubleToFloat:
+  case DXIL::OpCodeClass::LegacyDoubleToSInt32:
+  case DXIL::OpCodeClass::LegacyDoubleToUInt32:
+  case DXIL::OpCodeClass::LegacyF16ToF32:
+  case DXIL::OpCodeClass::LegacyF32ToF16:
+  case DXIL::OpCodeClass::MakeDouble:
+  case DXIL::OpCodeClass::Quaternary:
+  case DXIL::OpCodeClass::SplitDouble:
+  case DXIL::OpCodeClass::Tertiary:
+  case DXIL::OpCodeClass::Unary:
+  case DXIL::OpCodeClass::UnaryBits:
+    ++Stats.AluCount;
+    break;
+  default:
+    // Handles, inputs, outputs and system values only move data.
+    break;
+  }
+}
+
+void CountInstruction(Instruction &I, DxilShaderStatistics &Stats) {
+  if (isa<PHINode>(I) || isa<DbgInfoIntrinsic>(I))
+    return;
+  ++Stats.InstructionCount;
+  if (isa<BinaryOperator>(I) || isa<CastInst>(I) || isa<CmpInst>(I) ||
+      isa<SelectInst>(I)) {
+    ++Stats.AluCount;
+  } else if (isa<LoadInst>(I)) {
+    ++Stats.LoadCount;
+  } else if (isa<StoreInst>(I)) {
+    ++Stats.StoreCount;
+  } else if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I)) {
+    ++Stats.AtomicCount;
+  } else if (OP::IsDxilOpFuncCallInst(&I)) {
+    CountDxilOp(OP::GetDxilOpFuncCallInst(&I), Stats);
+  }
+}
+
+bool IsRegisterValue(const Value *V) {
+  // Handles and the structs dx.op calls return are taken apart before
+  // anything is computed from them.
+  Type *Ty = V->getType();
+  return !Ty->isVoidTy() && !Ty->isStructTy();
+}
+
+// Returns the most values live at once in F, from a backward liveness
+// analysis over its blocks. Phi operands are live at the end of the
+// predecessor they come from.
+unsigned GetMaxLiveValues(Function &F) {
+  DenseMap<const Value *, unsigned> valueIDs;
+  for (Argument &A : F.args()) {
+    if (IsRegisterValue(&A))
+      valueIDs.insert(std::make_pair(&A, (unsigned)valueIDs.size()));
+  }
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (IsRegisterValue(&I))
+        valueIDs.insert(std::make_pair(&I, (unsigned)valueIDs.size()));
+    }
+  }
+  unsigned numValues = valueIDs.size();
+  if (numValues == 0)
+    return 0;
+
+  DenseMap<const BasicBlock *, unsigned> blockIDs;
+  for (BasicBlock &BB : F)
+    blockIDs.insert(std::make_pair(&BB, (unsigned)blockIDs.size()));
+  std::vector<BitVector> uses(blockIDs.size(), BitVector(numValues));
+  std::vector<BitVector> defs(blockIDs.size(), BitVector(numValues));
+  std::vector<BitVector> liveIn(blockIDs.size(), BitVector(numValues));
+  std::vector<BitVector> liveOut(blockIDs.size(), BitVector(numValues));
+  for (BasicBlock &BB : F) {
+    unsigned b = blockIDs[&BB];
+    for (Instruction &I : BB) {
+      if (!isa<PHINode>(I)) {
+        for (Value *Op : I.operands()) {
+          auto it = valueIDs.find(Op);
+          if (it != valueIDs.end() && !defs[b].test(it->second))
+            uses[b].set(it->second);
+        }
+      }
+      auto it = valueIDs.find(&I);
+      if (it != valueIDs.end())
+        defs[b].set(it->second);
+    }
+  }
+
+  // Blocks are visited in post order, so most successors come first.
+  std::vector<BasicBlock *> order;
+  for (BasicBlock *BB : post_order(&F.getEntryBlock()))
+    order.push_back(BB);
+  bool bChanged = true;
+  while (bChanged) {
+    bChanged = false;
+    for (BasicBlock *BB : order) {
+      unsigned b = blockIDs[BB];
+      BitVector out(numValues);
+      for (BasicBlock *Succ : successors(BB)) {
+        out |= liveIn[blockIDs[Succ]];
+        for (Instruction &I : *Succ) {
+          PHINode *Phi = dyn_cast<PHINode>(&I);
+          if (!Phi)
+            break;
+          auto it = valueIDs.find(Phi->getIncomingValueForBlock(BB));
+          if (it != valueIDs.end())
+            out.set(it->second);
+        }
+      }
+      BitVector in = out;
+      in.reset(defs[b]);
+      in |= uses[b];
+      if (in != liveIn[b]) {
+        liveIn[b] = in;
+        bChanged = true;
+      }
+      liveOut[b] = out;
+    }
+  }
+
+  unsigned maxLive = 0;
+  for (BasicBlock *BB : order) {
+    BitVector live = liveOut[blockIDs[BB]];
+    unsigned numLive = live.count();
+    maxLive = std::max(maxLive, numLive);
+    for (auto it = BB->rbegin(), end = BB->rend(); it != end; ++it) {
+      Instruction &I = *it;
+      if (isa<PHINode>(I))
+        break;
+      // A value takes a register where it is defined, even if it isn't used.
+      auto defIt = valueIDs.find(&I);
+      if (defIt != valueIDs.end()) {
+        if (!live.test(defIt->second))
+          maxLive = std::max(maxLive, numLive + 1);
+        else
+          numLive--;
+        live.reset(defIt->second);
+      }
+      for (Value *Op : I.operands()) {
+        auto opIt = valueIDs.find(Op);
+        if (opIt != valueIDs.end() && !live.test(opIt->second)) {
+          live.set(opIt->second);
+          numLive++;
+        }
+      }
+      maxLive = std::max(maxLive, numLive);
+    }
+  }
+  return maxLive;
+}
+
+bool IsUsedIn(const Value *V, const SmallPtrSetImpl<Function *> &Functions) {
+  for (const User *U : V->users()) {
+    if (const Instruction *I = dyn_cast<Instruction>(U)) {
+      if (Functions.count(const_cast<Function *>(I->getParent()->getParent())))
+        return true;
+    } else if (isa<ConstantExpr>(U) && IsUsedIn(U, Functions)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+void hlsl::ComputeDxilShaderStatistics(DxilModule &DM, Function *pEntry,
+                                       DxilShaderStatistics *pStats) {
+  *pStats = DxilShaderStatistics();
+  pStats->Version = DxilShaderStatisticsVersion;
+
+  SmallPtrSet<Function *, 8> functions;
+  SmallVector<Function *, 8> worklist;
+  worklist.push_back(pEntry);
+  if (pEntry == DM.GetEntryFunction() && DM.GetPatchConstantFunction()) {
+    worklist.push_back(DM.GetPatchConstantFunction());
+  } else if (DM.HasDxilFunctionProps(pEntry)) {
+    DxilFunctionProps &props = DM.GetDxilFunctionProps(pEntry);
+    if (props.IsHS() && props.ShaderProps.HS.patchConstantFunc)
+      worklist.push_back(props.ShaderProps.HS.patchConstantFunc);
+  }
+  while (!worklist.empty()) {
+    Function *F = worklist.pop_back_val();
+    if (F->isDeclaration() || !functions.insert(F).second)
+      continue;
+    for (BasicBlock &BB : *F) {
+      for (Instruction &I : BB) {
+        if (CallInst *CI = dyn_cast<CallInst>(&I)) {
+          if (Function *Callee = CI->getCalledFunction())
+            worklist.push_back(Callee);
+        }
+      }
+    }
+  }
+
+  const DataLayout &DL = DM.GetModule()->getDataLayout();
+  for (Function *F : functions) {
+    for (BasicBlock &BB : *F) {
+      for (Instruction &I : BB) {
+        CountInstruction(I, *pStats);
+        if (AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
+          uint64_t count = 1;
+          if (ConstantInt *pSize = dyn_cast<ConstantInt>(AI->getArraySize()))
+            count = pSize->getZExtValue();
+          pStats->IndexableTempBytes +=
+              DL.getTypeAllocSize(AI->getAllocatedType()) * count;
+        }
+      }
+    }
+    pStats->MaxLiveValues =
+        std::max(pStats->MaxLiveValues, GetMaxLiveValues(*F));
+  }
+
+  for (GlobalVariable &GV : DM.GetModule()->globals()) {
+    if (dxilutil::IsSharedMemoryGlobal(&GV) && IsUsedIn(&GV, functions))
+      pStats->GroupSharedBytes +=
+          DL.getTypeAllocSize(GV.getType()->getElementType());
+  }
+}
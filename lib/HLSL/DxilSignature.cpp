@@ -83,6 +83,21 @@ const std::vector<std::unique_ptr<DxilSignatureElement> > &DxilSignature::GetEle
   return m_Elements;
 }
 
+vector<unsigned> DxilSignature::RemoveElements(const vector<bool> &removed) {
+  DXASSERT_NOMSG(removed.size() == m_Elements.size());
+  vector<unsigned> newIDs(m_Elements.size(), UINT_MAX);
+  unsigned kept = 0;
+  for (unsigned i = 0; i < m_Elements.size(); ++i) {
+    if (removed[i])
+      continue;
+    newIDs[i] = kept;
+    m_Elements[i]->SetID(kept);
+    m_Elements[kept++] = std::move(m_Elements[i]);
+  }
+  m_Elements.resize(kept);
+  return newIDs;
+}
+
 namespace {
 
 static bool ShouldBeAllocated(const DxilSignatureElement *SE) {
@@ -151,6 +166,9 @@ unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
         case DXIL::PackingStrategy::Optimized:
           streamRowsUsed = alloc[i].PackOptimized(elements[i], 0, 32);
           break;
+        case DXIL::PackingStrategy::Minimal:
+          streamRowsUsed = alloc[i].PackMinimal(elements[i], 0, 32);
+          break;
         default:
           DXASSERT(false, "otherwise, invalid packing strategy supplied");
         }
@@ -193,6 +211,9 @@ unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
       case DXIL::PackingStrategy::Optimized:
         rowsUsed = alloc.PackOptimized(elements, 0, 32);
         break;
+      case DXIL::PackingStrategy::Minimal:
+        rowsUsed = alloc.PackMinimal(elements, 0, 32);
+        break;
       default:
         DXASSERT(false, "otherwise, invalid packing strategy supplied");
       }
@@ -222,6 +243,46 @@ unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
   return rowsUsed;
 }
 
+unsigned DxilSignature::GetPackedRowCount(DXIL::PackingStrategy packing) const {
+  DXIL::PackingKind PK = SigPoint::GetSigPoint(m_sigPointKind)->GetPackingKind();
+  if (m_sigPointKind == DXIL::SigPointKind::GSOut ||
+      (PK != DXIL::PackingKind::Vertex && PK != DXIL::PackingKind::PatchConstant))
+    return NumVectorsUsed();
+
+  // Pack stand-ins for the elements so their own locations are untouched.
+  std::vector<DxilSignatureAllocator::DummyElement> dummyElements;
+  for (auto &SE : m_Elements) {
+    if (!ShouldBeAllocated(SE.get()))
+      continue;
+    DxilPackElement PE(SE.get(), m_UseMinPrecision);
+    DxilSignatureAllocator::DummyElement DE(PE.GetID());
+    DE.kind = PE.GetKind();
+    DE.interpolation = PE.GetInterpolationMode();
+    DE.interpretation = PE.GetInterpretation();
+    DE.dataBitWidth = PE.GetDataBitWidth();
+    DE.rows = PE.GetRows();
+    DE.cols = PE.GetCols();
+    dummyElements.push_back(DE);
+  }
+  std::vector<DxilSignatureAllocator::PackElement*> elements;
+  elements.reserve(dummyElements.size());
+  for (auto &DE : dummyElements)
+    elements.push_back(&DE);
+
+  DxilSignatureAllocator alloc(32, UseMinPrecision());
+  switch (packing) {
+  case DXIL::PackingStrategy::PrefixStable:
+    return alloc.PackPrefixStable(elements, 0, 32);
+  case DXIL::PackingStrategy::Optimized:
+    return alloc.PackOptimized(elements, 0, 32);
+  case DXIL::PackingStrategy::Minimal:
+    return alloc.PackMinimal(elements, 0, 32);
+  default:
+    DXASSERT(false, "otherwise, invalid packing strategy supplied");
+  }
+  return 0;
+}
+
 //------------------------------------------------------------------------------
 //
 // EntrySingnature methods.
@@ -121,6 +121,10 @@ const InterpolationMode *DxilSignatureElement::GetInterpolationMode() const {
   return &m_InterpMode;
 }
 
+void DxilSignatureElement::SetInterpolationMode(const InterpolationMode &InterpMode) {
+  m_InterpMode = InterpMode;
+}
+
 CompType DxilSignatureElement::GetCompType() const {
   return m_CompType;
 }
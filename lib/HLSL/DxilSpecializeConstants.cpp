@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSpecializeConstants.cpp                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Substitutes values for the specializable constants of a shader.           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilMetadataHelper.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilTypeSystem.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include <unordered_map>
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-specialize-constants"
+
+STATISTIC(NumSpecializedLoads, "Number of specializable constant loads replaced");
+
+namespace {
+
+// A shader compiled with -specializable reads its [specializable] constants
+// from $Globals, and lists them with their defaults in dx.specializable.
+// The loads of those constants are replaced with the values given, or the
+// defaults, and the list is dropped, leaving SCCP and SimplifyCFG to fold
+// what depends on them. Values are the 32-bit patterns of the constants.
+class DxilSpecializeConstants : public ModulePass {
+  std::unordered_map<std::string, uint32_t> m_Values;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilSpecializeConstants() : ModulePass(ID) {}
+  explicit DxilSpecializeConstants(
+      const std::unordered_map<std::string, uint32_t> &Values)
+      : ModulePass(ID), m_Values(Values) {}
+
+  const char *getPassName() const override {
+    return "DXIL Specialize Constants";
+  }
+
+  bool runOnModule(Module &M) override;
+};
+
+}
+
+static uint32_t GetConstantBits(Constant *C) {
+  if (ConstantInt *CI = dyn_cast<ConstantInt>(C))
+    return (uint32_t)CI->getZExtValue();
+  if (ConstantFP *CFP = dyn_cast<ConstantFP>(C))
+    return (uint32_t)CFP->getValueAPF().bitcastToAPInt().getZExtValue();
+  return 0;
+}
+
+// Returns the constant of type Ty with the given bits, or null if Ty isn't
+// a 32-bit scalar.
+static Constant *GetConstantFromBits(Type *Ty, uint32_t Bits) {
+  if (Ty->isIntegerTy(32))
+    return ConstantInt::get(Ty, Bits);
+  if (Ty->isFloatTy())
+    return ConstantFP::get(Ty->getContext(),
+                           APFloat(APFloat::IEEEsingle, APInt(32, Bits)));
+  return nullptr;
+}
+
+static bool ReplaceWithBits(Instruction *I, unsigned Offset,
+                            const std::unordered_map<unsigned, uint32_t> &Bits) {
+  auto it = Bits.find(Offset);
+  if (it == Bits.end())
+    return false;
+  Constant *C = GetConstantFromBits(I->getType(), it->second);
+  if (!C)
+    return false;
+  I->replaceAllUsesWith(C);
+  I->eraseFromParent();
+  ++NumSpecializedLoads;
+  return true;
+}
+
+bool DxilSpecializeConstants::runOnModule(Module &M) {
+  NamedMDNode *pSpecMD =
+      M.getNamedMetadata(DxilMDHelper::kDxilSpecializableMDName);
+  if (!pSpecMD || !M.HasDxilModule())
+    return false;
+  DxilModule &DM = M.GetDxilModule();
+
+  std::unordered_map<std::string, uint32_t> values;
+  for (MDNode *pNode : pSpecMD->operands()) {
+    StringRef name = cast<MDString>(pNode->getOperand(0))->getString();
+    Constant *pDefault =
+        cast<ConstantAsMetadata>(pNode->getOperand(1))->getValue();
+    auto it = m_Values.find(name);
+    values[name] = it != m_Values.end() ? it->second
+                                        : GetConstantBits(pDefault);
+  }
+  M.eraseNamedMetadata(pSpecMD);
+
+  DxilCBuffer *pGlobals = nullptr;
+  for (auto &CB : DM.GetCBuffers()) {
+    if (CB->GetGlobalName() == "$Globals")
+      pGlobals = CB.get();
+  }
+  if (!pGlobals)
+    return true;
+  StructType *ST = dyn_cast<StructType>(
+      pGlobals->GetGlobalSymbol()->getType()->getPointerElementType());
+  DxilStructAnnotation *pAnnotation =
+      ST ? DM.GetTypeSystem().GetStructAnnotation(ST) : nullptr;
+  if (!pAnnotation)
+    return true;
+
+  // Byte offset in $Globals to the bits of the constant there.
+  std::unordered_map<unsigned, uint32_t> bitsAtOffset;
+  for (unsigned i = 0; i < pAnnotation->GetNumFields(); ++i) {
+    const DxilFieldAnnotation &FA = pAnnotation->GetFieldAnnotation(i);
+    auto it = values.find(FA.GetFieldName());
+    if (it != values.end())
+      bitsAtOffset[FA.GetCBufferOffset()] = it->second;
+  }
+
+  for (Function *F : DM.GetOP()->GetOpFuncList(DXIL::OpCode::CreateHandle)) {
+    if (F == nullptr)
+      continue;
+    for (User *U : F->users()) {
+      DxilInst_CreateHandle CH(cast<Instruction>(U));
+      if (!CH || !isa<ConstantInt>(CH.get_rangeId()) ||
+          CH.get_resourceClass_val() !=
+              (int8_t)DXIL::ResourceClass::CBuffer ||
+          (unsigned)CH.get_rangeId_val() != pGlobals->GetID())
+        continue;
+      for (auto HU = U->user_begin(), HE = U->user_end(); HU != HE;) {
+        Instruction *LoadI = cast<Instruction>(*(HU++));
+        if (DxilInst_CBufferLoadLegacy LL = DxilInst_CBufferLoadLegacy(LoadI)) {
+          ConstantInt *Row = dyn_cast<ConstantInt>(LL.get_regIndex());
+          if (!Row)
+            continue;
+          for (auto EU = LoadI->user_begin(), EE = LoadI->user_end();
+               EU != EE;) {
+            ExtractValueInst *EV = dyn_cast<ExtractValueInst>(*(EU++));
+            if (!EV || EV->getType()->getPrimitiveSizeInBits() != 32)
+              continue;
+            unsigned offset =
+                (unsigned)Row->getLimitedValue() * 16 + EV->getIndices()[0] * 4;
+            ReplaceWithBits(EV, offset, bitsAtOffset);
+          }
+        } else if (DxilInst_CBufferLoad L = DxilInst_CBufferLoad(LoadI)) {
+          ConstantInt *Offset = dyn_cast<ConstantInt>(L.get_byteOffset());
+          if (Offset)
+            ReplaceWithBits(LoadI, (unsigned)Offset->getLimitedValue(),
+                            bitsAtOffset);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+char DxilSpecializeConstants::ID = 0;
+
+ModulePass *llvm::createDxilSpecializeConstantsPass(
+    const std::unordered_map<std::string, uint32_t> &Values) {
+  return new DxilSpecializeConstants(Values);
+}
+
+INITIALIZE_PASS(DxilSpecializeConstants, "hlsl-dxil-specialize-constants",
+                "DXIL Specialize Constants", false, false)
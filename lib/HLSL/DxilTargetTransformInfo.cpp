@@ -9,13 +9,18 @@
 //
 // \file
 // This file implements a TargetTransformInfo analysis pass specific to the
-// DXIL. Only implemented isSourceOfDivergence for DivergenceAnalysis.
+// DXIL. Implements isSourceOfDivergence and isAlwaysUniform for
+// DivergenceAnalysis and a cost model for dx.op calls used by the unroller
+// and SimplifyCFG.
 //
 //===----------------------------------------------------------------------===//
 
 #include "DxilTargetTransformInfo.h"
 #include "dxc/HLSL/DxilModule.h"
 #include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/BasicTTIImpl.h"
 
 using namespace llvm;
@@ -31,7 +36,7 @@ cl::opt<unsigned>
 
 DxilTTIImpl::DxilTTIImpl(const TargetMachine *TM, const Function &F,
                          hlsl::DxilModule &DM, bool ThreadGroup)
-    : BaseT(TM, F.getParent()->getDataLayout()), m_pHlslOP(DM.GetOP()),
+    : BaseT(F.getParent()->getDataLayout()), m_pHlslOP(DM.GetOP()),
       m_isThreadGroup(ThreadGroup) {}
 
 namespace {
@@ -61,9 +66,31 @@ bool IsDxilOpSourceOfDivergence(const CallInst *CI, OP *hlslOP,
   case DXIL::OpCode::RenderTargetGetSamplePosition:
   case DXIL::OpCode::ThreadId:
   case DXIL::OpCode::ThreadIdInGroup:
+  case DXIL::OpCode::SampleIndex:
+  case DXIL::OpCode::WaveGetLaneIndex:
+  case DXIL::OpCode::WaveIsFirstLane:
+  case DXIL::OpCode::WavePrefixOp:
+  case DXIL::OpCode::WavePrefixBitCount:
+  case DXIL::OpCode::QuadReadLaneAt:
+  case DXIL::OpCode::QuadOp:
     return true;
   case DXIL::OpCode::GroupId:
     return !ThreadGroup;
+  case DXIL::OpCode::BufferLoad:
+  case DXIL::OpCode::RawBufferLoad:
+  case DXIL::OpCode::TextureLoad: {
+    // Other lanes may write a UAV between the accesses of this one, so only
+    // read-only resources are uniform at a uniform address.
+    Instruction *handle = dyn_cast<Instruction>(
+        CI->getArgOperand(DXIL::OperandIndex::kBufferLoadHandleOpIdx));
+    if (!handle || !OP::IsDxilOpFuncCallInst(handle, DXIL::OpCode::CreateHandle))
+      return true;
+    DxilInst_CreateHandle createHandle(handle);
+    ConstantInt *resClass =
+        dyn_cast<ConstantInt>(createHandle.get_resourceClass());
+    return !resClass ||
+           resClass->getLimitedValue() != (unsigned)DXIL::ResourceClass::SRV;
+  }
   default:
     return false;
   }
@@ -85,6 +112,14 @@ bool DxilTTIImpl::isSourceOfDivergence(const Value *V) const {
   if (isa<AtomicRMWInst>(V) || isa<AtomicCmpXchgInst>(V))
     return true;
 
+  // Memory isn't tracked, so a load is uniform only when nothing can have
+  // stored a divergent value to it.
+  if (const LoadInst *LI = dyn_cast<LoadInst>(V)) {
+    const GlobalVariable *GV = dyn_cast<GlobalVariable>(
+        GetUnderlyingObject(LI->getPointerOperand(), getDataLayout()));
+    return !GV || !GV->isConstant();
+  }
+
   if (const CallInst *CI = dyn_cast<CallInst>(V)) {
     // Assume none dxil instrincis function calls are a source of divergence.
     if (!m_pHlslOP->IsDxilOpFuncCallInst(CI))
@@ -94,3 +129,137 @@ bool DxilTTIImpl::isSourceOfDivergence(const Value *V) const {
 
   return false;
 }
+
+///
+/// \returns true if the value is the same in every active lane of a wave
+/// whatever its operands are.
+bool DxilTTIImpl::isAlwaysUniform(const Value *V) const {
+  const CallInst *CI = dyn_cast<CallInst>(V);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI))
+    return false;
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case DXIL::OpCode::WaveActiveAllEqual:
+  case DXIL::OpCode::WaveActiveBallot:
+  case DXIL::OpCode::WaveActiveBit:
+  case DXIL::OpCode::WaveActiveOp:
+  case DXIL::OpCode::WaveAllBitCount:
+  case DXIL::OpCode::WaveAllTrue:
+  case DXIL::OpCode::WaveAnyTrue:
+  case DXIL::OpCode::WaveReadLaneFirst:
+    return true;
+  default:
+    return false;
+  }
+}
+
+namespace {
+// Relative costs of dx.op calls, in units of TCC_Basic. Memory accesses and
+// synchronization dominate shader execution time, so a loop that issues them
+// grows expensive quickly even when its body has few instructions.
+const unsigned kTranscendentalCost = TargetTransformInfo::TCC_Expensive;
+const unsigned kWaveOpCost = 2 * TargetTransformInfo::TCC_Expensive;
+const unsigned kResourceStoreCost = 2 * TargetTransformInfo::TCC_Expensive;
+const unsigned kResourceLoadCost = 4 * TargetTransformInfo::TCC_Expensive;
+const unsigned kSynchronizationCost = 8 * TargetTransformInfo::TCC_Expensive;
+
+unsigned GetDxilOpCost(DXIL::OpCode opcode) {
+  switch (opcode) {
+  case DXIL::OpCode::Acos:
+  case DXIL::OpCode::Asin:
+  case DXIL::OpCode::Atan:
+  case DXIL::OpCode::Cos:
+  case DXIL::OpCode::Exp:
+  case DXIL::OpCode::Hcos:
+  case DXIL::OpCode::Hsin:
+  case DXIL::OpCode::Htan:
+  case DXIL::OpCode::Log:
+  case DXIL::OpCode::Rsqrt:
+  case DXIL::OpCode::Sin:
+  case DXIL::OpCode::Sqrt:
+  case DXIL::OpCode::Tan:
+    return kTranscendentalCost;
+  default:
+    break;
+  }
+
+  if (OP::IsDxilOpWave(opcode))
+    return kWaveOpCost;
+
+  switch (OP::GetOpCodeClass(opcode)) {
+  case DXIL::OpCodeClass::CreateHandle:
+    // Handles fold into the resource bindings.
+    return TargetTransformInfo::TCC_Free;
+  case DXIL::OpCodeClass::BufferLoad:
+  case DXIL::OpCodeClass::CalculateLOD:
+  case DXIL::OpCodeClass::RawBufferLoad:
+  case DXIL::OpCodeClass::Sample:
+  case DXIL::OpCodeClass::SampleBias:
+  case DXIL::OpCodeClass::SampleCmp:
+  case DXIL::OpCodeClass::SampleCmpLevelZero:
+  case DXIL::OpCodeClass::SampleGrad:
+  case DXIL::OpCodeClass::SampleLevel:
+  case DXIL::OpCodeClass::TextureGather:
+  case DXIL::OpCodeClass::TextureGatherCmp:
+  case DXIL::OpCodeClass::TextureLoad:
+    return kResourceLoadCost;
+  case DXIL::OpCodeClass::BufferStore:
+  case DXIL::OpCodeClass::RawBufferStore:
+  case DXIL::OpCodeClass::TextureStore:
+    return kResourceStoreCost;
+  case DXIL::OpCodeClass::AtomicBinOp:
+  case DXIL::OpCodeClass::AtomicCompareExchange:
+  case DXIL::OpCodeClass::Barrier:
+  case DXIL::OpCodeClass::BufferUpdateCounter:
+    return kSynchronizationCost;
+  default:
+    return TargetTransformInfo::TCC_Basic;
+  }
+}
+}
+
+unsigned DxilTTIImpl::getCallCost(const Function *F,
+                                  ArrayRef<const Value *> Arguments) {
+  if (!OP::IsDxilOpFunc(F) || Arguments.empty())
+    return BaseT::getCallCost(F, Arguments);
+  const ConstantInt *opArg = dyn_cast<ConstantInt>(Arguments[0]);
+  if (!opArg || opArg->getLimitedValue() >= (unsigned)DXIL::OpCode::NumOpCodes)
+    return BaseT::getCallCost(F, Arguments);
+  return GetDxilOpCost((DXIL::OpCode)opArg->getLimitedValue());
+}
+
+unsigned DxilTTIImpl::getOperationCost(unsigned Opcode, Type *Ty, Type *OpTy) {
+  unsigned Cost = BaseT::getOperationCost(Opcode, Ty, OpTy);
+  // 64-bit values take a register pair, and most 64-bit arithmetic is
+  // emulated. 16-bit and min-precision values still use a full register.
+  if (Cost != TTI::TCC_Free && Ty->getScalarSizeInBits() == 64)
+    Cost *= 2;
+  return Cost;
+}
+
+bool DxilTTIImpl::isLoweredToCall(const Function *F) {
+  // dx.op functions are instructions, not calls.
+  if (OP::IsDxilOpFunc(F))
+    return false;
+  return BaseT::isLoweredToCall(F);
+}
+
+void DxilTTIImpl::getUnrollingPreferences(Loop *L,
+                                          TTI::UnrollingPreferences &UP) {
+  // There is no instruction pipelining for partial unrolling to help, and
+  // runtime unrolling adds a remainder loop whose trip count is usually
+  // divergent; both only grow the shader.
+  UP.Partial = false;
+  UP.Runtime = false;
+}
+
+TargetIRAnalysis llvm::createDxilTargetIRAnalysis() {
+  return TargetIRAnalysis([](Function &F) {
+    Module *M = F.getParent();
+    if (!M->HasDxilModule())
+      return TargetTransformInfo(M->getDataLayout());
+    DxilModule &DM = M->GetDxilModule();
+    // A wave never spans thread groups.
+    return TargetTransformInfo(
+        DxilTTIImpl(nullptr, F, DM, /*ThreadGroup*/ true));
+  });
+}
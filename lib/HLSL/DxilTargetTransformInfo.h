@@ -8,13 +8,14 @@
 //===----------------------------------------------------------------------===//
 /// \file
 /// This file declares a TargetTransformInfo analysis pass specific to the DXIL.
-/// Only implemented isSourceOfDivergence for DivergenceAnalysis.
+/// Implements isSourceOfDivergence and isAlwaysUniform for DivergenceAnalysis
+/// and a cost model for dx.op calls used by the unroller and SimplifyCFG.
 ///
 //===----------------------------------------------------------------------===//
 
 #pragma once
 
-#include "llvm/CodeGen/BasicTTIImpl.h"
+#include "llvm/Analysis/TargetTransformInfoImpl.h"
 
 namespace hlsl {
 class DxilModule;
@@ -23,14 +24,15 @@ class OP;
 
 namespace llvm {
 
-class DxilTTIImpl final : public BasicTTIImplBase<DxilTTIImpl> {
-  typedef BasicTTIImplBase<DxilTTIImpl> BaseT;
+// There is no target lowering for DXIL, so this builds on the generic
+// implementation rather than BasicTTIImplBase, which queries it.
+class DxilTTIImpl final
+    : public TargetTransformInfoImplCRTPBase<DxilTTIImpl> {
+  typedef TargetTransformInfoImplCRTPBase<DxilTTIImpl> BaseT;
   typedef TargetTransformInfo TTI;
   friend BaseT;
   hlsl::OP *m_pHlslOP;
   bool m_isThreadGroup;
-  const TargetSubtargetInfo *getST() const { return nullptr; }
-  const TargetLowering *getTLI() const { return nullptr; }
 
 public:
   explicit DxilTTIImpl(const TargetMachine *TM, const Function &F,
@@ -38,6 +40,14 @@ public:
 
   bool hasBranchDivergence() { return true; }
   bool isSourceOfDivergence(const Value *V) const;
+  bool isAlwaysUniform(const Value *V) const;
+
+  using BaseT::getCallCost;
+  unsigned getCallCost(const Function *F, ArrayRef<const Value *> Arguments);
+  unsigned getOperationCost(unsigned Opcode, Type *Ty, Type *OpTy);
+  bool isLoweredToCall(const Function *F);
+  void getUnrollingPreferences(Loop *L, TTI::UnrollingPreferences &UP);
 };
 
+
 } // end namespace llvm
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilUniformBranchHints.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Marks branches whose condition is uniform across a wave.                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilMetadataHelper.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DivergenceAnalysis.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Pass.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-uniform-branch-hints"
+
+STATISTIC(NumUniformBranches, "Number of branches marked uniform");
+
+namespace {
+
+// DivergenceAnalysis, with the sources of divergence and the always-uniform
+// wave ops from DxilTTIImpl, finds the branches whose condition is the same
+// in every active lane. Drivers can keep such conditions in scalar registers
+// and skip the execution mask updates around them.
+class DxilUniformBranchHints : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilUniformBranchHints() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Uniform Branch Hints";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addRequired<DivergenceAnalysis>();
+    AU.setPreservesAll();
+  }
+
+  bool runOnFunction(Function &F) override;
+};
+
+}
+
+static Value *GetBranchCondition(TerminatorInst *TI) {
+  if (BranchInst *BI = dyn_cast<BranchInst>(TI))
+    return BI->isConditional() ? BI->getCondition() : nullptr;
+  if (SwitchInst *SI = dyn_cast<SwitchInst>(TI))
+    return SI->getCondition();
+  return nullptr;
+}
+
+bool DxilUniformBranchHints::runOnFunction(Function &F) {
+  // Without the DXIL cost model every value would look uniform.
+  if (!getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F)
+           .hasBranchDivergence())
+    return false;
+
+  DivergenceAnalysis &DA = getAnalysis<DivergenceAnalysis>();
+  MDNode *UniformMD = nullptr;
+  bool bChanged = false;
+  for (BasicBlock &BB : F) {
+    TerminatorInst *TI = BB.getTerminator();
+    Value *Cond = GetBranchCondition(TI);
+    if (!Cond || isa<Constant>(Cond) || !DA.isUniform(TI))
+      continue;
+    if (!UniformMD)
+      UniformMD = MDNode::get(F.getContext(), {});
+    TI->setMetadata(DxilMDHelper::kDxilUniformBranchMDName, UniformMD);
+    ++NumUniformBranches;
+    bChanged = true;
+  }
+  return bChanged;
+}
+
+char DxilUniformBranchHints::ID = 0;
+
+FunctionPass *llvm::createDxilUniformBranchHintsPass() {
+  return new DxilUniformBranchHints();
+}
+
+INITIALIZE_PASS_BEGIN(DxilUniformBranchHints, "hlsl-dxil-uniform-branch-hints",
+                      "DXIL Uniform Branch Hints", false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DivergenceAnalysis)
+INITIALIZE_PASS_END(DxilUniformBranchHints, "hlsl-dxil-uniform-branch-hints",
+                    "DXIL Uniform Branch Hints", false, false)
@@ -23,6 +23,9 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include <unordered_map>
 
 using namespace llvm;
 using namespace hlsl;
@@ -148,5 +151,89 @@ std::unique_ptr<llvm::Module> LoadModuleFromBitcode(llvm::StringRef BC,
   return LoadModuleFromBitcode(pBitcodeBuf.get(), Ctx, DiagStr);
 }
 
+// Values the driver keeps in registers. Handles and pointers are resource
+// and memory references rather than register values.
+static bool IsRegisterValue(const Value *V) {
+  if (!isa<Instruction>(V) && !isa<Argument>(V))
+    return false;
+  Type *Ty = V->getType();
+  if (Ty->isVoidTy() || Ty->isPointerTy())
+    return false;
+  if (StructType *ST = dyn_cast<StructType>(Ty))
+    return !ST->hasName() || ST->getName() != "dx.types.Handle";
+  return true;
+}
+
+unsigned EstimateMaxLiveValues(const Function &F) {
+  typedef SmallPtrSet<const Value *, 32> ValueSet;
+  std::unordered_map<const BasicBlock *, ValueSet> liveIn;
+
+  // Computes the values live at the end of BB from the live in sets of its
+  // successors. Phi operands are live out of the incoming block only.
+  auto computeLiveOut = [&](const BasicBlock *BB, ValueSet &out) {
+    out.clear();
+    for (const BasicBlock *Succ : successors(BB)) {
+      for (const Value *V : liveIn[Succ]) {
+        const PHINode *PN = dyn_cast<PHINode>(V);
+        if (!PN || PN->getParent() != Succ)
+          out.insert(V);
+      }
+      for (auto I = Succ->begin(); isa<PHINode>(I); ++I) {
+        const Value *V = cast<PHINode>(I)->getIncomingValueForBlock(BB);
+        if (IsRegisterValue(V))
+          out.insert(V);
+      }
+    }
+  };
+
+  // Iterate the backward liveness problem to a fixed point.
+  bool bChanged = true;
+  while (bChanged) {
+    bChanged = false;
+    for (auto BI = F.rbegin(), BE = F.rend(); BI != BE; ++BI) {
+      const BasicBlock *BB = &*BI;
+      ValueSet live;
+      computeLiveOut(BB, live);
+      for (auto I = BB->rbegin(), E = BB->rend(); I != E; ++I) {
+        bool bLive = live.erase(&*I);
+        if (isa<PHINode>(*I)) {
+          // Phis are defined on entry to the block.
+          if (bLive)
+            live.insert(&*I);
+          continue;
+        }
+        for (const Value *Op : I->operands()) {
+          if (IsRegisterValue(Op))
+            live.insert(Op);
+        }
+      }
+      ValueSet &in = liveIn[BB];
+      if (in.size() != live.size()) {
+        in = live;
+        bChanged = true;
+      }
+    }
+  }
+
+  // Walk each block backward from its live out set to find the peak.
+  unsigned maxLive = 0;
+  for (const BasicBlock &BB : F) {
+    ValueSet live;
+    computeLiveOut(&BB, live);
+    maxLive = std::max(maxLive, live.size());
+    for (auto I = BB.rbegin(), E = BB.rend(); I != E; ++I) {
+      if (isa<PHINode>(*I))
+        break;
+      live.erase(&*I);
+      for (const Value *Op : I->operands()) {
+        if (IsRegisterValue(Op))
+          live.insert(Op);
+      }
+      maxLive = std::max(maxLive, live.size());
+    }
+  }
+  return maxLive;
+}
+
 }
 }
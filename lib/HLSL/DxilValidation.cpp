@@ -19,6 +19,8 @@
 #include "dxc/HLSL/DxilUtil.h"
 #include "dxc/HLSL/DxilInstructions.h"
 #include "dxc/HLSL/ReducibilityAnalysis.h"
+#include "dxc/HLSL/DxilDomTreeCache.h"
+#include "dxc/HLSL/DxcTimeReport.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/FileIOHelper.h"
 
@@ -33,6 +35,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/TypeFinder.h"
 #include "llvm/ADT/BitVector.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -45,6 +48,11 @@
 #include "dxc/HLSL/DxilSignatureAllocator.h"
 #include "dxc/HLSL/DxilRootSignature.h"
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 
 using namespace llvm;
@@ -194,6 +202,7 @@ const char *hlsl::GetValidationRuleText(ValidationRule value) {
     case hlsl::ValidationRule::SmThreadGroupChannelRange: return "Declared Thread Group %0 size %1 outside valid range [%2..%3]";
     case hlsl::ValidationRule::SmMaxTheadGroup: return "Declared Thread Group Count %0 (X*Y*Z) is beyond the valid maximum of %1";
     case hlsl::ValidationRule::SmMaxTGSMSize: return "Total Thread Group Shared Memory storage is %0, exceeded %1";
+    case hlsl::ValidationRule::SmWaveSize: return "Declared wave size %0 is not a power of two in the range [%1..%2]";
     case hlsl::ValidationRule::SmROVOnlyInPS: return "RasterizerOrdered objects are only allowed in 5.0+ pixel shaders";
     case hlsl::ValidationRule::SmTessFactorForDomain: return "Required TessFactor for domain not found declared anywhere in Patch Constant data";
     case hlsl::ValidationRule::SmTessFactorSizeMatchDomain: return "TessFactor rows, columns (%0, %1) invalid for domain %2.  Expected %3 rows and 1 column.";
@@ -339,6 +348,8 @@ struct PSExecutionInfo {
 
 struct ValidationContext {
   bool Failed = false;
+  // Skip the whole-program checks (DxcValidatorFlags_Quick).
+  bool Quick = false;
   Module &M;
   Module *pDebugModule;
   DxilModule &DxilMod;
@@ -358,9 +369,21 @@ struct ValidationContext {
   unsigned domainLocSize;
   const unsigned kDxilControlFlowHintMDKind;
   const unsigned kDxilPreciseMDKind;
+  const unsigned kDxilUniformBranchMDKind;
   const unsigned kLLVMLoopMDKind;
   bool m_bCoverageIn, m_bInnerCoverageIn;
   unsigned m_DxilMajor, m_DxilMinor;
+  // hlsl::OP creates its builtin types on demand, so lookups are serialized
+  // while function bodies are validated concurrently.
+  std::mutex OPMutex;
+  std::mutex &OPLock;
+  // Dominator trees for the checks that run after function bodies.
+  DxilDomTreeCache DomTrees;
+  // Types that passed ValidateType and known IsDxilBuiltinStructType
+  // results, as the same types show up on most operands. Failures aren't
+  // recorded so each use still reports its errors.
+  std::unordered_set<Type *> ValidTypes;
+  std::unordered_map<StructType *, bool> BuiltinStructTypes;
 
   ValidationContext(Module &llvmModule, Module *DebugModule,
                     DxilModule &dxilModule,
@@ -371,10 +394,12 @@ struct ValidationContext {
             DxilMDHelper::kDxilControlFlowHintMDName)),
         kDxilPreciseMDKind(llvmModule.getContext().getMDKindID(
             DxilMDHelper::kDxilPreciseAttributeMDName)),
+        kDxilUniformBranchMDKind(llvmModule.getContext().getMDKindID(
+            DxilMDHelper::kDxilUniformBranchMDName)),
         kLLVMLoopMDKind(llvmModule.getContext().getMDKindID("llvm.loop")),
         DiagPrinter(DiagPrn), LastRuleEmit((ValidationRule)-1),
         m_bCoverageIn(false), m_bInnerCoverageIn(false),
-        hasViewID(false) {
+        hasViewID(false), OPLock(OPMutex) {
     DxilMod.GetDxilVersion(m_DxilMajor, m_DxilMinor);
     for (unsigned i = 0; i < DXIL::kNumOutputStreams; i++) {
       hasOutputPosition[i] = false;
@@ -384,6 +409,29 @@ struct ValidationContext {
     patchConstCols.resize(DxilMod.GetPatchConstantSignature().GetElements().size(), 0);
   }
 
+  // Creates a context that validates a function body into its own
+  // diagnostics. It shares the module and its read-only state with
+  // ModuleCtx; the results of the module-wide checks (call sets, output
+  // tracking) are only kept in ModuleCtx.
+  ValidationContext(ValidationContext &ModuleCtx,
+                    DiagnosticPrinterRawOStream &DiagPrn)
+      : M(ModuleCtx.M), pDebugModule(ModuleCtx.pDebugModule),
+        DxilMod(ModuleCtx.DxilMod), DL(ModuleCtx.DL),
+        kDxilControlFlowHintMDKind(ModuleCtx.kDxilControlFlowHintMDKind),
+        kDxilPreciseMDKind(ModuleCtx.kDxilPreciseMDKind),
+        kLLVMLoopMDKind(ModuleCtx.kLLVMLoopMDKind),
+        DiagPrinter(DiagPrn), LastRuleEmit((ValidationRule)-1),
+        m_bCoverageIn(false), m_bInnerCoverageIn(false),
+        hasViewID(false), m_DxilMajor(ModuleCtx.m_DxilMajor),
+        m_DxilMinor(ModuleCtx.m_DxilMinor), OPLock(ModuleCtx.OPLock) {
+    Quick = ModuleCtx.Quick;
+    PSExec = ModuleCtx.PSExec;
+    for (unsigned i = 0; i < DXIL::kNumOutputStreams; i++) {
+      hasOutputPosition[i] = false;
+      OutputPositionMask[i] = 0;
+    }
+  }
+
   // Provide direct access to the raw_ostream in DiagPrinter.
   raw_ostream &DiagStream() {
     struct DiagnosticPrinterRawOStream_Pub : public DiagnosticPrinterRawOStream {
@@ -464,7 +512,8 @@ struct ValidationContext {
       // Look up the matching instruction in the debug module.
       llvm::Function *Fn = I->getParent()->getParent();
       llvm::Function *DbgFn = pDebugModule->getFunction(Fn->getName());
-      if (DbgFn) {
+      // The debug module's bodies are only read when a diagnostic needs them.
+      if (DbgFn && !DbgFn->materialize()) {
         // Linear lookup, but then again, failing validation is rare.
         inst_iterator it = inst_begin(Fn);
         inst_iterator dbg_it = inst_begin(DbgFn);
@@ -2081,8 +2130,33 @@ static bool IsDxilBuiltinStructType(StructType *ST, hlsl::OP *hlslOP) {
   }
 }
 
+static bool IsDxilBuiltinStructType(StructType *ST,
+                                    ValidationContext &ValCtx) {
+  auto it = ValCtx.BuiltinStructTypes.find(ST);
+  if (it != ValCtx.BuiltinStructTypes.end())
+    return it->second;
+  bool result;
+  {
+    std::lock_guard<std::mutex> lock(ValCtx.OPLock);
+    result = IsDxilBuiltinStructType(ST, ValCtx.DxilMod.GetOP());
+  }
+  ValCtx.BuiltinStructTypes[ST] = result;
+  return result;
+}
+
+static bool ValidateTypeUncached(Type *Ty, ValidationContext &ValCtx);
+
 static bool ValidateType(Type *Ty, ValidationContext &ValCtx) {
   DXASSERT_NOMSG(Ty != nullptr);
+  if (ValCtx.ValidTypes.count(Ty))
+    return true;
+  if (!ValidateTypeUncached(Ty, ValCtx))
+    return false;
+  ValCtx.ValidTypes.insert(Ty);
+  return true;
+}
+
+static bool ValidateTypeUncached(Type *Ty, ValidationContext &ValCtx) {
   if (Ty->isPointerTy()) {
     return ValidateType(Ty->getPointerElementType(), ValCtx);
   }
@@ -2100,8 +2174,7 @@ static bool ValidateType(Type *Ty, ValidationContext &ValCtx) {
 
     StringRef Name = ST->getName();
     if (Name.startswith("dx.")) {
-      hlsl::OP *hlslOP = ValCtx.DxilMod.GetOP();
-      if (IsDxilBuiltinStructType(ST, hlslOP)) {
+      if (IsDxilBuiltinStructType(ST, ValCtx)) {
         ValCtx.EmitTypeError(Ty, ValidationRule::InstrDxilStructUser);
         result = false;
       }
@@ -2157,7 +2230,7 @@ static bool GetNodeOperandAsInt(ValidationContext &ValCtx, MDNode *pMD, unsigned
 }
 
 static bool IsPrecise(Instruction &I, ValidationContext &ValCtx) {
-  MDNode *pMD = I.getMetadata(DxilMDHelper::kDxilPreciseAttributeMDName);
+  MDNode *pMD = I.getMetadata(ValCtx.kDxilPreciseMDKind);
   if (pMD == nullptr) {
     return false;
   }
@@ -2215,7 +2288,7 @@ static void ValidateControlFlowHint(BasicBlock &bb, ValidationContext &ValCtx) {
   if (!TI)
     return;
 
-  MDNode *pNode = TI->getMetadata(DxilMDHelper::kDxilControlFlowHintMDName);
+  MDNode *pNode = TI->getMetadata(ValCtx.kDxilControlFlowHintMDKind);
   if (!pNode)
     return;
 
@@ -2358,7 +2431,8 @@ static void ValidateInstructionMetadata(Instruction *I,
   SmallVector<std::pair<unsigned, MDNode *>, 2> MDNodes;
   I->getAllMetadataOtherThanDebugLoc(MDNodes);
   for (auto &MD : MDNodes) {
-    if (MD.first == ValCtx.kDxilControlFlowHintMDKind) {
+    if (MD.first == ValCtx.kDxilControlFlowHintMDKind ||
+        MD.first == ValCtx.kDxilUniformBranchMDKind) {
       if (!isa<TerminatorInst>(I)) {
         ValCtx.EmitInstrError(
             I, ValidationRule::MetaControlFlowHintNotOnControlFlow);
@@ -2534,7 +2608,7 @@ static void ValidateFunctionBody(Function *F, ValidationContext &ValCtx) {
         if (StructType *ST = dyn_cast<StructType>(Ty)) {
           Value *Agg = EV->getAggregateOperand();
           if (!isa<AtomicCmpXchgInst>(Agg) &&
-              !IsDxilBuiltinStructType(ST, ValCtx.DxilMod.GetOP())) {
+              !IsDxilBuiltinStructType(ST, ValCtx)) {
             ValCtx.EmitInstrError(EV, ValidationRule::InstrExtractValue);
           }
         } else {
@@ -2669,12 +2743,36 @@ static void ValidateFunctionBody(Function *F, ValidationContext &ValCtx) {
     ValidateControlFlowHint(*b, ValCtx);
   }
 
-  if (!gradientOps.empty()) {
+  if (!gradientOps.empty() && !ValCtx.Quick) {
     ValidateGradientOps(F, gradientOps, barriers, ValCtx);
   }
 }
 
-static void ValidateFunction(Function &F, ValidationContext &ValCtx) {
+// Diagnostics of a function body validated ahead of ValidateFunction.
+struct FunctionBodyDiagnostics {
+  bool Validated = false;
+  bool Failed = false;
+  std::string Text;
+  std::exception_ptr Exception;
+};
+
+static void ValidateFunctionBody(Function *F, ValidationContext &ModuleCtx,
+                                 FunctionBodyDiagnostics &Diag) {
+  try {
+    raw_string_ostream Stream(Diag.Text);
+    DiagnosticPrinterRawOStream Printer(Stream);
+    ValidationContext FnCtx(ModuleCtx, Printer);
+    ValidateFunctionBody(F, FnCtx);
+    Stream.flush();
+    Diag.Failed = FnCtx.Failed;
+  } catch (...) {
+    Diag.Exception = std::current_exception();
+  }
+  Diag.Validated = true;
+}
+
+static void ValidateFunction(Function &F, ValidationContext &ValCtx,
+                             FunctionBodyDiagnostics *pBodyDiag = nullptr) {
   if (F.isDeclaration()) {
     ValidateExternalFunction(&F, ValCtx);
   } else {
@@ -2712,7 +2810,14 @@ static void ValidateFunction(Function &F, ValidationContext &ValCtx) {
       }
     }
 
-    ValidateFunctionBody(&F, ValCtx);
+    if (pBodyDiag && pBodyDiag->Validated) {
+      if (pBodyDiag->Exception)
+        std::rethrow_exception(pBodyDiag->Exception);
+      ValCtx.DiagPrinter << pBodyDiag->Text;
+      ValCtx.Failed |= pBodyDiag->Failed;
+    } else {
+      ValidateFunctionBody(&F, ValCtx);
+    }
   }
 
   ValidateFunctionAttribute(&F, ValCtx);
@@ -2722,6 +2827,61 @@ static void ValidateFunction(Function &F, ValidationContext &ValCtx) {
   }
 }
 
+// Function bodies are validated concurrently once a module has this many.
+static const unsigned kMinParallelFunctionBodies = 8;
+
+static void ValidateFunctions(ValidationContext &ValCtx) {
+  std::vector<Function *> bodies;
+  for (Function &F : ValCtx.M.functions()) {
+    if (!F.isDeclaration() &&
+        ValCtx.DxilMod.GetTypeSystem().GetFunctionAnnotation(&F))
+      bodies.push_back(&F);
+  }
+
+  unsigned threadCount =
+      std::min<unsigned>(std::thread::hardware_concurrency(), bodies.size());
+  std::vector<FunctionBodyDiagnostics> bodyDiags;
+  if (bodies.size() >= kMinParallelFunctionBodies && threadCount > 1) {
+    // Body validation only reads the module. Layouts of struct types are
+    // cached by the DataLayout on first use, so compute them here.
+    TypeFinder structTypes;
+    structTypes.run(ValCtx.M, /*onlyNamed*/ false);
+    for (StructType *ST : structTypes) {
+      if (ST->isSized())
+        ValCtx.DL.getStructLayout(ST);
+    }
+
+    bodyDiags.resize(bodies.size());
+    std::atomic<unsigned> nextBody(0);
+    auto validateBodies = [&]() {
+      for (unsigned i = nextBody++; i < bodies.size(); i = nextBody++)
+        ValidateFunctionBody(bodies[i], ValCtx, bodyDiags[i]);
+    };
+    IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (unsigned i = 1; i < threadCount; ++i) {
+      threads.emplace_back([&, pMalloc]() {
+        DxcThreadMalloc TM(pMalloc);
+        validateBodies();
+      });
+    }
+    validateBodies();
+    for (std::thread &t : threads)
+      t.join();
+  }
+
+  // The remaining checks may update module-wide state, and diagnostics are
+  // merged in module order so that they don't depend on scheduling.
+  unsigned bodyIndex = 0;
+  for (Function &F : ValCtx.M.functions()) {
+    FunctionBodyDiagnostics *pBodyDiag = nullptr;
+    if (bodyIndex < bodyDiags.size() && bodies[bodyIndex] == &F)
+      pBodyDiag = &bodyDiags[bodyIndex++];
+    ValidateFunction(F, ValCtx, pBodyDiag);
+  }
+}
+
 static void ValidateGlobalVariable(GlobalVariable &GV,
                                    ValidationContext &ValCtx) {
   bool isInternalGV =
@@ -2787,8 +2947,7 @@ static void ValidateTGSMRaceCondition(std::vector<StoreInst *> &fixAddrTGSMList,
     if (F.isDeclaration() || !fixAddrTGSMFuncSet.count(&F))
       continue;
 
-    PostDominatorTree PDT;
-    PDT.runOnFunction(F);
+    DxilDomTreeCache::DomTreeType &PDT = ValCtx.DomTrees.GetPostDomTree(F);
 
     BasicBlock *Entry = &F.getEntryBlock();
 
@@ -2823,7 +2982,7 @@ static void ValidateGlobalVariables(ValidationContext &ValCtx) {
                            {std::to_string(TGSMSize),
                             std::to_string(DXIL::kMaxTGSMSize)});
   }
-  if (!fixAddrTGSMList.empty()) {
+  if (!fixAddrTGSMList.empty() && !ValCtx.Quick) {
     ValidateTGSMRaceCondition(fixAddrTGSMList, ValCtx);
   }
 }
@@ -2889,7 +3048,8 @@ static void ValidateTypeAnnotation(ValidationContext &ValCtx) {
       ConstantInt *tag = mdconst::extract<ConstantInt>(TANode->getOperand(0));
       uint64_t tagValue = tag->getZExtValue();
       if (tagValue != DxilMDHelper::kDxilTypeSystemStructTag &&
-          tagValue != DxilMDHelper::kDxilTypeSystemFunctionTag) {
+          tagValue != DxilMDHelper::kDxilTypeSystemFunctionTag &&
+          tagValue != DxilMDHelper::kDxilTypeSystemCompactTag) {
           ValCtx.EmitMetaError(TANode, ValidationRule::MetaWellFormed);
           return;
       }
@@ -2949,6 +3109,49 @@ static void ValidateMetadata(ValidationContext &ValCtx) {
   ValidateTypeAnnotation(ValCtx);
 }
 
+// Returns the last register res binds, inclusive.
+static unsigned GetResourceRangeEnd(const hlsl::DxilResourceBase &res) {
+  unsigned base = res.GetLowerBound();
+  unsigned size = res.GetRangeSize();
+  unsigned end = base + size - 1;
+  // unbounded
+  if (end < base)
+    end = size;
+  return end;
+}
+
+// Returns true if any two of the resources bind the same register.
+// Sorting the ranges and sweeping them is O(n log n), so the allocators that
+// find which resource each one conflicts with are only needed, in
+// declaration order so the diagnostics don't change, when this finds an
+// overlap. Bindless shaders declare thousands of ranges, and valid ones
+// have none.
+template <typename T>
+static bool HasResourceOverlap(
+    const std::vector<std::unique_ptr<T>> &resources) {
+  typedef std::tuple<unsigned, unsigned, unsigned> SpaceRange;
+  std::vector<SpaceRange> ranges;
+  ranges.reserve(resources.size());
+  for (auto &res : resources)
+    ranges.emplace_back(res->GetSpaceID(), res->GetLowerBound(),
+                        GetResourceRangeEnd(*res));
+  std::sort(ranges.begin(), ranges.end());
+
+  // Ranges in a space are sorted by start, so a range overlaps an earlier
+  // one exactly when it starts before the furthest end so far.
+  for (size_t i = 1; i < ranges.size(); ++i) {
+    unsigned space, start, end;
+    std::tie(space, start, end) = ranges[i];
+    if (space != std::get<0>(ranges[i - 1]))
+      continue;
+    unsigned maxEnd = std::get<2>(ranges[i - 1]);
+    if (start <= maxEnd)
+      return true;
+    std::get<2>(ranges[i]) = std::max(end, maxEnd);
+  }
+  return false;
+}
+
 static void ValidateResourceOverlap(
     hlsl::DxilResourceBase &res,
     SpacesAllocator<unsigned, DxilResourceBase> &spaceAllocator,
@@ -2958,10 +3161,7 @@ static void ValidateResourceOverlap(
   unsigned space = res.GetSpaceID();
 
   auto &allocator = spaceAllocator.Get(space);
-  unsigned end = base + size - 1;
-  // unbounded
-  if (end < base)
-    end = size;
+  unsigned end = GetResourceRangeEnd(res);
   const DxilResourceBase *conflictRes = allocator.Insert(&res, base, end);
   if (conflictRes) {
     ValCtx.EmitFormatError(
@@ -3153,6 +3353,7 @@ static void ValidateResources(ValidationContext &ValCtx) {
   const vector<unique_ptr<DxilResource>> &uavs = ValCtx.DxilMod.GetUAVs();
   bool hasROV = false;
   SpacesAllocator<unsigned, DxilResourceBase> uavAllocator;
+  bool uavsOverlap = HasResourceOverlap(uavs);
 
   for (auto &uav : uavs) {
     if (uav->IsROV()) {
@@ -3182,14 +3383,17 @@ static void ValidateResources(ValidationContext &ValCtx) {
                                ValidationRule::MetaGlcNotOnAppendConsume);
 
     ValidateResource(*uav, ValCtx);
-    ValidateResourceOverlap(*uav, uavAllocator, ValCtx);
+    if (uavsOverlap)
+      ValidateResourceOverlap(*uav, uavAllocator, ValCtx);
   }
 
   SpacesAllocator<unsigned, DxilResourceBase> srvAllocator;
   const vector<unique_ptr<DxilResource>> &srvs = ValCtx.DxilMod.GetSRVs();
+  bool srvsOverlap = HasResourceOverlap(srvs);
   for (auto &srv : srvs) {
     ValidateResource(*srv, ValCtx);
-    ValidateResourceOverlap(*srv, srvAllocator, ValCtx);
+    if (srvsOverlap)
+      ValidateResourceOverlap(*srv, srvAllocator, ValCtx);
   }
 
   hlsl::DxilResourceBase *pNonDense;
@@ -3198,18 +3402,22 @@ static void ValidateResources(ValidationContext &ValCtx) {
   }
 
   SpacesAllocator<unsigned, DxilResourceBase> samplerAllocator;
+  bool samplersOverlap = HasResourceOverlap(ValCtx.DxilMod.GetSamplers());
   for (auto &sampler : ValCtx.DxilMod.GetSamplers()) {
     if (sampler->GetSamplerKind() == DXIL::SamplerKind::Invalid) {
       ValCtx.EmitResourceError(sampler.get(),
                                ValidationRule::MetaValidSamplerMode);
     }
-    ValidateResourceOverlap(*sampler, samplerAllocator, ValCtx);
+    if (samplersOverlap)
+      ValidateResourceOverlap(*sampler, samplerAllocator, ValCtx);
   }
 
   SpacesAllocator<unsigned, DxilResourceBase> cbufferAllocator;
+  bool cbuffersOverlap = HasResourceOverlap(ValCtx.DxilMod.GetCBuffers());
   for (auto &cbuffer : ValCtx.DxilMod.GetCBuffers()) {
     ValidateCBuffer(*cbuffer, ValCtx);
-    ValidateResourceOverlap(*cbuffer, cbufferAllocator, ValCtx);
+    if (cbuffersOverlap)
+      ValidateResourceOverlap(*cbuffer, cbufferAllocator, ValCtx);
   }
 }
 
@@ -4151,6 +4359,16 @@ static void ValidateShaderState(ValidationContext &ValCtx) {
         {std::to_string(DXIL::kMaxIAPatchControlPointCount),
          std::to_string(outputControlPointCount)});
   }
+
+  unsigned waveSize = M.GetWaveSize();
+  if (waveSize != 0 &&
+      (waveSize < DXIL::kMinWaveSize || waveSize > DXIL::kMaxWaveSize ||
+       (waveSize & (waveSize - 1)) != 0)) {
+    ValCtx.EmitFormatError(ValidationRule::SmWaveSize,
+                           {std::to_string(waveSize),
+                            std::to_string(DXIL::kMinWaveSize),
+                            std::to_string(DXIL::kMaxWaveSize)});
+  }
 }
 
 static bool
@@ -4200,23 +4418,28 @@ static void ValidateCallGraph(ValidationContext &ValCtx) {
 }
 
 static void ValidateFlowControl(ValidationContext &ValCtx) {
-  bool reducible =
-      IsReducible(*ValCtx.DxilMod.GetModule(), IrreducibilityAction::Ignore);
-  if (!reducible) {
-    ValCtx.EmitError(ValidationRule::FlowReducible);
-    return;
+  if (!ValCtx.Quick) {
+    bool reducible =
+        IsReducible(*ValCtx.DxilMod.GetModule(), IrreducibilityAction::Ignore);
+    if (!reducible) {
+      ValCtx.EmitError(ValidationRule::FlowReducible);
+      return;
+    }
   }
 
   ValidateCallGraph(ValCtx);
 
+  // The call sets collected above are used by later checks, but the loop
+  // checks need dominator trees of every function.
+  if (ValCtx.Quick)
+    return;
+
   for (auto &F : ValCtx.DxilMod.GetModule()->functions()) {
     if (F.isDeclaration())
       continue;
 
-    DominatorTreeAnalysis DTA;
-    DominatorTree DT = DTA.run(F);
     LoopInfo LI;
-    LI.Analyze(DT);
+    LI.Analyze(ValCtx.DomTrees.GetDomTree(F));
     for (auto loopIt = LI.begin(); loopIt != LI.end(); loopIt++) {
       Loop *loop = *loopIt;
       SmallVector<BasicBlock *, 4> exitBlocks;
@@ -4269,7 +4492,8 @@ void GetValidationVersion(_Out_ unsigned *pMajor, _Out_ unsigned *pMinor) {
 }
 
 _Use_decl_annotations_ HRESULT
-ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule) {
+ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule,
+                   bool bQuick) {
   std::string diagStr;
   raw_string_ostream diagStream(diagStr);
   DiagnosticPrinterRawOStream DiagPrinter(diagStream);
@@ -4280,29 +4504,49 @@ ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule) {
   }
 
   ValidationContext ValCtx(*pModule, pDebugModule, *pDxilModule, DiagPrinter);
+  ValCtx.Quick = bQuick;
 
-  ValidateMetadata(ValCtx);
-
-  ValidateShaderState(ValCtx);
-
-  ValidateGlobalVariables(ValCtx);
-
-  ValidateResources(ValCtx);
-
-  // Validate control flow and collect function call info.
-  // If has recursive call, call info collection will not finish.
-  ValidateFlowControl(ValCtx);
-
-  // Validate functions.
-  for (Function &F : pModule->functions()) {
-    ValidateFunction(F, ValCtx);
+  // Each group of checks is a phase of -ftime-report, to show which of them
+  // dominate validation time.
+  {
+    TimeReportPhase phase("validate-metadata");
+    ValidateMetadata(ValCtx);
+  }
+  {
+    TimeReportPhase phase("validate-shader-state");
+    ValidateShaderState(ValCtx);
+  }
+  {
+    TimeReportPhase phase("validate-globals");
+    ValidateGlobalVariables(ValCtx);
+  }
+  {
+    TimeReportPhase phase("validate-resources");
+    ValidateResources(ValCtx);
+  }
+  {
+    // Validate control flow and collect function call info.
+    // If has recursive call, call info collection will not finish.
+    TimeReportPhase phase("validate-flow-control");
+    ValidateFlowControl(ValCtx);
+  }
+  {
+    // Validate functions.
+    TimeReportPhase phase("validate-functions");
+    ValidateFunctions(ValCtx);
+  }
+  {
+    TimeReportPhase phase("validate-outputs");
+    ValidateUninitializedOutput(ValCtx);
+  }
+  {
+    TimeReportPhase phase("validate-shader-flags");
+    ValidateShaderFlags(ValCtx);
+  }
+  {
+    TimeReportPhase phase("validate-signatures");
+    ValidateSignatures(ValCtx);
   }
-
-  ValidateUninitializedOutput(ValCtx);
-
-  ValidateShaderFlags(ValCtx);
-
-  ValidateSignatures(ValCtx);
 
   if (!pDxilModule->GetShaderModel()->IsGS()) {
     unsigned posMask = ValCtx.OutputPositionMask[0];
@@ -4411,9 +4655,13 @@ bool VerifySignatureMatches(llvm::Module *pModule,
 
 static void VerifyPSVMatches(_In_ ValidationContext &ValCtx,
                              _In_reads_bytes_(PSVSize) const void *pPSVData,
-                             _In_ uint32_t PSVSize) {
-  uint32_t PSVVersion = 1;  // This should be set to the newest version
-  unique_ptr<DxilPartWriter> pWriter(NewPSVWriter(ValCtx.DxilMod, PSVVersion));
+                             _In_ uint32_t PSVSize,
+                             _In_reads_bytes_opt_(ProgramBitcodeSize) const void *pProgramBitcode = nullptr,
+                             _In_ uint32_t ProgramBitcodeSize = 0) {
+  // This should be set to the newest version; version 2 hashes the program
+  // bitcode, so it can only be checked against a container.
+  uint32_t PSVVersion = pProgramBitcode ? 2 : 1;
+  unique_ptr<DxilPartWriter> pWriter(NewPSVWriter(ValCtx.DxilMod, PSVVersion, pProgramBitcode, ProgramBitcodeSize));
   // Try each version in case an earlier version matches module
   while (PSVVersion && pWriter->size() != PSVSize) {
     PSVVersion --;
@@ -4522,10 +4770,24 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
     case DFCC_RootSignature:
       pRootSignaturePart = pPart;
       break;
-    case DFCC_PipelineStateValidation:
+    case DFCC_ShaderHash: {
+      DxilShaderHash Hash;
+      ComputeDxilShaderHash(pContainer, &Hash);
+      if (pPart->PartSize != sizeof(Hash) ||
+          memcmp(GetDxilPartData(pPart), &Hash, sizeof(Hash)) != 0)
+        ValCtx.EmitFormatError(ValidationRule::ContainerPartMatches, {"Shader Hash"});
+      break;
+    }
+    case DFCC_PipelineStateValidation: {
       pPSVPart = pPart;
-      VerifyPSVMatches(ValCtx, GetDxilPartData(pPart), pPart->PartSize);
+      const char *pProgramBitcode = nullptr;
+      uint32_t ProgramBitcodeSize = 0;
+      if (const DxilProgramHeader *pProgramHeader = GetDxilProgramHeader(pContainer, DFCC_DXIL))
+        GetDxilProgramBitcode(pProgramHeader, &pProgramBitcode, &ProgramBitcodeSize);
+      VerifyPSVMatches(ValCtx, GetDxilPartData(pPart), pPart->PartSize,
+                       pProgramBitcode, ProgramBitcodeSize);
       break;
+    }
 
     // Skip these
     case DFCC_ResourceDef:
@@ -4533,7 +4795,9 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
     case DFCC_PrivateData:
     case DFCC_DXIL:
     case DFCC_ShaderDebugInfoDXIL:
+    case DFCC_ShaderDebugInfoCompressed:
     case DFCC_ShaderDebugName:
+    case DFCC_ShaderDebugLines:
       continue;
 
     case DFCC_Container:
@@ -4564,13 +4828,11 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
   if (pPSVPart) {
     if (pRootSignaturePart) {
       try {
-        RootSignatureHandle RS;
-        RS.LoadSerialized((const uint8_t*)GetDxilPartData(pRootSignaturePart), pRootSignaturePart->PartSize);
-        RS.Deserialize();
-        IFTBOOL(VerifyRootSignatureWithShaderPSV(RS.GetDesc(),
-                                                  pDxilModule->GetShaderModel()->GetKind(),
-                                                  GetDxilPartData(pPSVPart), pPSVPart->PartSize,
-                                                  DiagStream), DXC_E_INCORRECT_ROOT_SIGNATURE);
+        IFTBOOL(VerifySerializedRootSignatureWithShaderPSV(GetDxilPartData(pRootSignaturePart),
+                                                           pRootSignaturePart->PartSize,
+                                                           pDxilModule->GetShaderModel()->GetKind(),
+                                                           GetDxilPartData(pPSVPart), pPSVPart->PartSize,
+                                                           DiagStream), DXC_E_INCORRECT_ROOT_SIGNATURE);
       } catch (...) {
         ValCtx.EmitError(ValidationRule::ContainerRootSignatureIncompatible);
       }
@@ -4617,26 +4879,24 @@ static HRESULT FindDxilPart(_In_reads_bytes_(ContainerSize) const void *pContain
   return S_OK;
 }
 
-_Use_decl_annotations_
-HRESULT ValidateLoadModule(const char *pIL,
-                           uint32_t ILLength,
-                           unique_ptr<llvm::Module> &pModule,
-                           LLVMContext &Ctx,
-                           llvm::raw_ostream &DiagStream,
-                           unsigned bLazyLoad) {
-
+// A lazy loaded module owns pBitcodeBuf until it is destroyed. With
+// bLazyLoadMetadata, the module metadata is also only read when a function
+// is materialized.
+static HRESULT ValidateLoadModule(std::unique_ptr<llvm::MemoryBuffer> pBitcodeBuf,
+                                  unique_ptr<llvm::Module> &pModule,
+                                  LLVMContext &Ctx,
+                                  llvm::raw_ostream &DiagStream,
+                                  unsigned bLazyLoad,
+                                  bool bLazyLoadMetadata = false) {
   llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
   PrintDiagnosticContext DiagContext(DiagPrinter);
   DiagRestore DR(Ctx, &DiagContext);
 
-  std::unique_ptr<llvm::MemoryBuffer> pBitcodeBuf;
-  pBitcodeBuf.reset(llvm::MemoryBuffer::getMemBuffer(
-      llvm::StringRef(pIL, ILLength), "", false).release());
-
   ErrorOr<std::unique_ptr<Module>> loadedModuleResult =
       bLazyLoad == 0?
       llvm::parseBitcodeFile(pBitcodeBuf->getMemBufferRef(), Ctx) :
-      llvm::getLazyBitcodeModule(std::move(pBitcodeBuf), Ctx);
+      llvm::getLazyBitcodeModule(std::move(pBitcodeBuf), Ctx, nullptr,
+                                 bLazyLoadMetadata);
 
   // DXIL disallows some LLVM bitcode constructs, like unaccounted-for sub-blocks.
   // These appear as warnings, which the validator should reject.
@@ -4647,10 +4907,24 @@ HRESULT ValidateLoadModule(const char *pIL,
   return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT ValidateLoadModule(const char *pIL,
+                           uint32_t ILLength,
+                           unique_ptr<llvm::Module> &pModule,
+                           LLVMContext &Ctx,
+                           llvm::raw_ostream &DiagStream,
+                           unsigned bLazyLoad) {
+  return ValidateLoadModule(
+      llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(pIL, ILLength), "",
+                                       false),
+      pModule, Ctx, DiagStream, bLazyLoad);
+}
+
 HRESULT ValidateDxilBitcode(
   _In_reads_bytes_(ILLength) const char *pIL,
   _In_ uint32_t ILLength,
-  _In_ llvm::raw_ostream &DiagStream) {
+  _In_ llvm::raw_ostream &DiagStream,
+  _In_ bool bQuick) {
 
   LLVMContext Ctx;
   std::unique_ptr<llvm::Module> pModule;
@@ -4665,7 +4939,7 @@ HRESULT ValidateDxilBitcode(
                                      /*bLazyLoad*/ false)))
     return hr;
 
-  if (FAILED(hr = ValidateDxilModule(pModule.get(), nullptr)))
+  if (FAILED(hr = ValidateDxilModule(pModule.get(), nullptr, bQuick)))
     return hr;
 
   DxilModule &dxilModule = pModule->GetDxilModule();
@@ -4676,20 +4950,20 @@ HRESULT ValidateDxilBitcode(
     IFT(CreateMemoryStream(DxcGetThreadMallocNoRef(), &pOutputStream));
     pOutputStream->Reserve(pWriter->size());
     pWriter->write(pOutputStream);
-    const DxilVersionedRootSignatureDesc* pDesc = dxilModule.GetRootSignature().GetDesc();
-    RootSignatureHandle RS;
+    const RootSignatureHandle &RSH = dxilModule.GetRootSignature();
     try {
-      if (!pDesc) {
-        RS.Assign(nullptr, dxilModule.GetRootSignature().GetSerialized());
-        RS.Deserialize();
-        pDesc = RS.GetDesc();
-        if (!pDesc)
-          return DXC_E_INCORRECT_ROOT_SIGNATURE;
+      if (RSH.GetSerialized()) {
+        IFTBOOL(VerifySerializedRootSignatureWithShaderPSV(RSH.GetSerializedBytes(),
+                                                           RSH.GetSerializedSize(),
+                                                           dxilModule.GetShaderModel()->GetKind(),
+                                                           pOutputStream->GetPtr(), pWriter->size(),
+                                                           DiagStream), DXC_E_INCORRECT_ROOT_SIGNATURE);
+      } else {
+        IFTBOOL(VerifyRootSignatureWithShaderPSV(RSH.GetDesc(),
+                                                 dxilModule.GetShaderModel()->GetKind(),
+                                                 pOutputStream->GetPtr(), pWriter->size(),
+                                                 DiagStream), DXC_E_INCORRECT_ROOT_SIGNATURE);
       }
-      IFTBOOL(VerifyRootSignatureWithShaderPSV(pDesc,
-                                               dxilModule.GetShaderModel()->GetKind(),
-                                               pOutputStream->GetPtr(), pWriter->size(),
-                                               DiagStream), DXC_E_INCORRECT_ROOT_SIGNATURE);
     } catch (...) {
       return DXC_E_INCORRECT_ROOT_SIGNATURE;
     }
@@ -4718,11 +4992,6 @@ static HRESULT ValidateLoadModuleFromContainer(
 
   const char *pIL = nullptr;
   uint32_t ILLength = 0;
-  GetDxilProgramBitcode(
-      reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart)), &pIL,
-      &ILLength);
-
-  IFR(ValidateLoadModule(pIL, ILLength, pModule, Ctx, DiagStream, bLazyLoad));
 
   HRESULT hr;
   const DxilPartHeader *pDbgPart = nullptr;
@@ -4732,12 +5001,50 @@ static HRESULT ValidateLoadModuleFromContainer(
     return hr;
   }
 
+  // Without a plain debug info part, a compressed one is used.
+  std::vector<char> DbgPartStorage;
+  if (!pDbgPart) {
+    const DxilPartHeader *pCompressedDbgPart = GetDxilPartByType(
+        IsDxilContainerLike(pContainer, ContainerSize),
+        DFCC_ShaderDebugInfoCompressed);
+    if (pCompressedDbgPart) {
+      if (!DecompressDxilDebugInfoPart(pCompressedDbgPart, DbgPartStorage))
+        return DXC_E_CONTAINER_INVALID;
+      pDbgPart = reinterpret_cast<const DxilPartHeader *>(DbgPartStorage.data());
+      if (!IsValidDxilProgramHeader(reinterpret_cast<const DxilProgramHeader *>(
+                                        GetDxilPartData(pDbgPart)),
+                                    pDbgPart->PartSize))
+        return DXC_E_CONTAINER_INVALID;
+    }
+  }
+
+  // A lazy load is for the linker, which only uses the debug module if
+  // there is one.
+  if (!pDbgPart || !bLazyLoad) {
+    GetDxilProgramBitcode(
+        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pPart)),
+        &pIL, &ILLength);
+    IFR(ValidateLoadModule(pIL, ILLength, pModule, Ctx, DiagStream, bLazyLoad));
+  }
+
   if (pDbgPart) {
     GetDxilProgramBitcode(
         reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pDbgPart)),
         &pIL, &ILLength);
-    if (FAILED(hr = ValidateLoadModule(pIL, ILLength, pDebugModule, DbgCtx,
-                                       DiagStream, bLazyLoad))) {
+    // Validation only uses the debug module to find the source location of
+    // an error, so its function bodies and metadata, nearly all of it debug
+    // info, are left unread until then. The linker's lazy load needs the dx.*
+    // metadata up front. Only the linker reads the part in place; the
+    // decompressed data is local, and callers of the eager load may release
+    // the container before the module.
+    std::unique_ptr<llvm::MemoryBuffer> pBitcodeBuf =
+        DbgPartStorage.empty() && bLazyLoad
+            ? llvm::MemoryBuffer::getMemBuffer(StringRef(pIL, ILLength), "",
+                                               false)
+            : llvm::MemoryBuffer::getMemBufferCopy(StringRef(pIL, ILLength));
+    if (FAILED(hr = ValidateLoadModule(std::move(pBitcodeBuf), pDebugModule,
+                                       DbgCtx, DiagStream, /*bLazyLoad*/ 1,
+                                       /*bLazyLoadMetadata*/ !bLazyLoad))) {
       return hr;
     }
   }
@@ -4770,7 +5077,8 @@ _Use_decl_annotations_ HRESULT ValidateLoadModuleFromContainerLazy(
 _Use_decl_annotations_
 HRESULT ValidateDxilContainer(const void *pContainer,
                               uint32_t ContainerSize,
-                              llvm::raw_ostream &DiagStream) {
+                              llvm::raw_ostream &DiagStream,
+                              bool bQuick) {
   LLVMContext Ctx, DbgCtx;
   std::unique_ptr<llvm::Module> pModule, pDebugModule;
 
@@ -4785,7 +5093,7 @@ HRESULT ValidateDxilContainer(const void *pContainer,
       Ctx, DbgCtx, DiagStream));
 
   // Validate DXIL Module
-  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get()));
+  IFR(ValidateDxilModule(pModule.get(), pDebugModule.get(), bQuick));
 
   if (DiagContext.HasErrors() || DiagContext.HasWarnings()) {
     return DXC_E_IR_VERIFICATION_FAILED;
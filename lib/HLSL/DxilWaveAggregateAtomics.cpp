@@ -0,0 +1,197 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilWaveAggregateAtomics.cpp                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Combines the atomic adds of a wave to the same address into one atomic.   //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilShaderModel.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DivergenceAnalysis.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+#define DEBUG_TYPE "dxil-wave-aggregate-atomics"
+
+STATISTIC(NumAtomicsAggregated, "Number of atomic adds aggregated per wave");
+
+namespace {
+
+// When every active lane of a wave adds to the same address, the lanes'
+// values are summed with WaveActiveSum and only the first lane does the
+// atomic. A lane's original value is then what it would have seen had the
+// lanes run in lane order: the first lane's original value plus the sum of
+// the values of the lanes before it.
+//
+// The single atomic is guarded by a WaveIsFirstLane branch, which the
+// validator's WaveSensitivityAnalysis treats as wave-sensitive control flow
+// for everything after it, so functions with gradient operations are left
+// alone.
+class DxilWaveAggregateAtomics : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilWaveAggregateAtomics() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL Wave Aggregate Atomics";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addRequired<DivergenceAnalysis>();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  void AggregateAtomic(Instruction *I, Value *V, OP *hlslOP);
+};
+
+}
+
+// Returns the value added by I if it's an atomic add to an address that is
+// the same in every active lane, or nullptr.
+static Value *GetWaveUniformAtomicAdd(Instruction *I, OP *hlslOP,
+                                      DivergenceAnalysis &DA) {
+  if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(I)) {
+    if (RMW->getOperation() != AtomicRMWInst::Add ||
+        !DA.isUniform(RMW->getPointerOperand()))
+      return nullptr;
+    return RMW->getValOperand();
+  }
+
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI || !hlslOP->IsDxilOpFuncCallInst(CI, DXIL::OpCode::AtomicBinOp))
+    return nullptr;
+  DxilInst_AtomicBinOp Atomic(CI);
+  ConstantInt *AtomicOp = dyn_cast<ConstantInt>(Atomic.get_atomicOp());
+  if (!AtomicOp ||
+      AtomicOp->getZExtValue() != (uint64_t)DXIL::AtomicBinOpCode::Add)
+    return nullptr;
+  if (!DA.isUniform(Atomic.get_handle()) ||
+      !DA.isUniform(Atomic.get_offset0()) ||
+      !DA.isUniform(Atomic.get_offset1()) ||
+      !DA.isUniform(Atomic.get_offset2()))
+    return nullptr;
+  return Atomic.get_newValue();
+}
+
+static Value *CreateWaveSum(IRBuilder<> &Builder, OP *hlslOP, OP::OpCode opcode,
+                            Value *V, const Twine &Name) {
+  Function *F = hlslOP->GetOpFunc(opcode, V->getType());
+  Value *Args[] = {hlslOP->GetU32Const((unsigned)opcode), V,
+                   hlslOP->GetI8Const((char)DXIL::WaveOpKind::Sum),
+                   hlslOP->GetI8Const((char)DXIL::SignedOpKind::Unsigned)};
+  return Builder.CreateCall(F, Args, Name);
+}
+
+void DxilWaveAggregateAtomics::AggregateAtomic(Instruction *I, Value *V,
+                                               OP *hlslOP) {
+  LLVMContext &Ctx = I->getContext();
+  Type *Ty = V->getType();
+  IRBuilder<> Builder(I);
+  Value *Sum = CreateWaveSum(Builder, hlslOP, OP::OpCode::WaveActiveOp, V,
+                             "WaveSum");
+  Function *IsFirstLaneFunc =
+      hlslOP->GetOpFunc(OP::OpCode::WaveIsFirstLane, Type::getVoidTy(Ctx));
+  Value *IsFirstLane = Builder.CreateCall(
+      IsFirstLaneFunc,
+      {hlslOP->GetU32Const((unsigned)OP::OpCode::WaveIsFirstLane)},
+      "IsFirstLane");
+
+  // Move the atomic under the first lane branch and have it add the sum.
+  BasicBlock *Head = I->getParent();
+  TerminatorInst *ThenTerm = SplitBlockAndInsertIfThen(IsFirstLane, I, false);
+  BasicBlock *Tail = ThenTerm->getSuccessor(0);
+  I->moveBefore(ThenTerm);
+  I->replaceUsesOfWith(V, Sum);
+  if (I->use_empty())
+    return;
+
+  SmallVector<User *, 4> Users(I->user_begin(), I->user_end());
+  Builder.SetInsertPoint(Tail->getFirstInsertionPt());
+  PHINode *Original = Builder.CreatePHI(Ty, 2, "WaveOriginal");
+  Original->addIncoming(I, I->getParent());
+  Original->addIncoming(UndefValue::get(Ty), Head);
+  Function *ReadFirstFunc =
+      hlslOP->GetOpFunc(OP::OpCode::WaveReadLaneFirst, Ty);
+  Value *FirstOriginal = Builder.CreateCall(
+      ReadFirstFunc,
+      {hlslOP->GetU32Const((unsigned)OP::OpCode::WaveReadLaneFirst), Original},
+      "FirstOriginal");
+  Value *Prefix = CreateWaveSum(Builder, hlslOP, OP::OpCode::WavePrefixOp, V,
+                                "WavePrefixSum");
+  Value *LaneOriginal = Builder.CreateAdd(FirstOriginal, Prefix);
+  for (User *U : Users)
+    U->replaceUsesOfWith(I, LaneOriginal);
+}
+
+bool DxilWaveAggregateAtomics::runOnFunction(Function &F) {
+  Module *M = F.getParent();
+  if (!M->HasDxilModule())
+    return false;
+  DxilModule &DM = M->GetDxilModule();
+  if (!DM.GetShaderModel()->IsSM60Plus())
+    return false;
+  // Without the DXIL cost model every value would look uniform.
+  if (!getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F)
+           .hasBranchDivergence())
+    return false;
+
+  OP *hlslOP = DM.GetOP();
+  DivergenceAnalysis &DA = getAnalysis<DivergenceAnalysis>();
+  SmallVector<std::pair<Instruction *, Value *>, 8> Atomics;
+  for (Instruction &I : inst_range(F)) {
+    if (CallInst *CI = dyn_cast<CallInst>(&I)) {
+      if (hlslOP->IsDxilOpFuncCallInst(CI) &&
+          OP::IsDxilOpGradient(OP::GetDxilOpFuncCallInst(CI)))
+        return false;
+    }
+    if (Value *V = GetWaveUniformAtomicAdd(&I, hlslOP, DA))
+      Atomics.emplace_back(&I, V);
+  }
+  if (Atomics.empty())
+    return false;
+
+  for (auto &Atomic : Atomics)
+    AggregateAtomic(Atomic.first, Atomic.second, hlslOP);
+  NumAtomicsAggregated += Atomics.size();
+  DM.m_ShaderFlags.SetWaveOps(true);
+  return true;
+}
+
+char DxilWaveAggregateAtomics::ID = 0;
+
+FunctionPass *llvm::createDxilWaveAggregateAtomicsPass() {
+  return new DxilWaveAggregateAtomics();
+}
+
+INITIALIZE_PASS_BEGIN(DxilWaveAggregateAtomics,
+                      "hlsl-dxil-wave-aggregate-atomics",
+                      "DXIL Wave Aggregate Atomics", false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DivergenceAnalysis)
+INITIALIZE_PASS_END(DxilWaveAggregateAtomics,
+                    "hlsl-dxil-wave-aggregate-atomics",
+                    "DXIL Wave Aggregate Atomics", false, false)
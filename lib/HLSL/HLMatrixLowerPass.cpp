@@ -18,12 +18,14 @@
 #include "dxc/Support/Global.h"
 #include "dxc/HLSL/DxilOperations.h"
 
+#include "llvm/ADT/Statistic.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Cancellation.h"
 #include "llvm/Support/raw_ostream.h"
 #include <unordered_set>
 #include <vector>
@@ -31,6 +33,13 @@
 using namespace llvm;
 using namespace hlsl;
 using namespace hlsl::HLMatrixLower;
+
+#define DEBUG_TYPE "hlmatrixlower"
+
+STATISTIC(NumMatInstsLowered, "Number of matrix instructions lowered");
+STATISTIC(NumInstsBefore, "Number of instructions before matrix lowering");
+STATISTIC(NumInstsAfter, "Number of instructions after matrix lowering");
+
 namespace hlsl {
 namespace HLMatrixLower {
 
@@ -170,6 +179,9 @@ public:
     // used to load them.
     m_HasDbgInfo = getDebugMetadataVersionFromModule(M) != 0;
 
+    if (AreStatisticsEnabled())
+      NumInstsBefore += CountInstructions(M);
+
     for (Function &F : M.functions()) {
 
       if (F.isDeclaration())
@@ -187,6 +199,9 @@ public:
     for (GlobalVariable *GV : staticGVs)
       runOnGlobal(GV);
 
+    if (AreStatisticsEnabled())
+      NumInstsAfter += CountInstructions(M);
+
     return true;
   }
 
@@ -194,6 +209,9 @@ private:
   Module *m_pModule;
   HLModule *m_pHLModule;
   bool m_HasDbgInfo;
+  // Matrix instructions of the current function, in the order they were
+  // lowered; the keys of matToVecMap.
+  std::vector<Instruction *> m_matInsts;
   std::vector<Instruction *> m_deadInsts;
   // For instruction like matrix array init.
   // May use more than 1 matrix alloca inst.
@@ -282,6 +300,15 @@ private:
   void DeleteDeadInsts();
   // Map from matrix inst to its vector version.
   DenseMap<Instruction *, Value *> matToVecMap;
+
+  static unsigned CountInstructions(Module &M) {
+    unsigned count = 0;
+    for (Function &F : M.functions()) {
+      for (BasicBlock &BB : F)
+        count += BB.size();
+    }
+    return count;
+  }
 };
 }
 
@@ -820,7 +847,11 @@ void HLMatrixLowerPass::lowerToVec(Instruction *matInst) {
   } else {
     DXASSERT(0, "invalid inst");
   }
-  matToVecMap[matInst] = vecInst;
+  auto inserted = matToVecMap.insert(std::make_pair(matInst, vecInst));
+  if (inserted.second)
+    m_matInsts.emplace_back(matInst);
+  else
+    inserted.first->second = vecInst;
 }
 
 // Replace matInst with vecInst on matUseInst.
@@ -2370,6 +2401,7 @@ void HLMatrixLowerPass::runOnFunction(Function &F) {
   for (Function::iterator BBI = F.begin(), BBE = F.end(); BBI != BBE; ++BBI) {
     BasicBlock *BB = BBI;
     for (Instruction &I : BB->getInstList()) {
+      pollThreadCancellation();
       if (IsMatrixType(I.getType())) {
         lowerToVec(&I);
       } else if (AllocaInst *AI = dyn_cast<AllocaInst>(&I)) {
@@ -2396,30 +2428,27 @@ void HLMatrixLowerPass::runOnFunction(Function &F) {
     }
   }
 
+  // Functions without matrix values are left alone.
+  if (m_matInsts.empty())
+    return;
+  NumMatInstsLowered += m_matInsts.size();
+
+  // The worklist is walked in program order, rather than in the order of the
+  // map, so that the lowered code doesn't depend on pointer values.
   // Update the use of matrix inst with the vector version.
-  for (auto matToVecIter = matToVecMap.begin();
-       matToVecIter != matToVecMap.end();) {
-    auto matToVec = matToVecIter++;
-    replaceMatWithVec(matToVec->first, cast<Instruction>(matToVec->second));
-  }
+  for (Instruction *matInst : m_matInsts)
+    replaceMatWithVec(matInst, cast<Instruction>(matToVecMap[matInst]));
 
   // Translate mat inst which require all operands ready.
-  for (auto matToVecIter = matToVecMap.begin();
-       matToVecIter != matToVecMap.end();) {
-    auto matToVec = matToVecIter++;
-    finalMatTranslation(matToVec->first);
-  }
+  for (Instruction *matInst : m_matInsts)
+    finalMatTranslation(matInst);
 
   // Delete the matrix version insts.
-  for (auto matToVecIter = matToVecMap.begin();
-       matToVecIter != matToVecMap.end();) {
-    auto matToVec = matToVecIter++;
-    // Add to m_deadInsts.
-    Instruction *matInst = matToVec->first;
+  for (Instruction *matInst : m_matInsts)
     AddToDeadInsts(matInst);
-  }
 
   DeleteDeadInsts();
-  
+
   matToVecMap.clear();
+  m_matInsts.clear();
 }
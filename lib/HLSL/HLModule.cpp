@@ -314,6 +314,30 @@ HLModule::ReleaseFunctionPropsMap() {
   return std::move(m_DxilFunctionPropsMap);
 }
 
+vector<unique_ptr<DxilCBuffer> > HLModule::ReleaseCBuffers() {
+  vector<unique_ptr<DxilCBuffer> > CBuffers;
+  CBuffers.swap(m_CBuffers);
+  return CBuffers;
+}
+
+vector<unique_ptr<DxilSampler> > HLModule::ReleaseSamplers() {
+  vector<unique_ptr<DxilSampler> > Samplers;
+  Samplers.swap(m_Samplers);
+  return Samplers;
+}
+
+vector<unique_ptr<HLResource> > HLModule::ReleaseSRVs() {
+  vector<unique_ptr<HLResource> > SRVs;
+  SRVs.swap(m_SRVs);
+  return SRVs;
+}
+
+vector<unique_ptr<HLResource> > HLModule::ReleaseUAVs() {
+  vector<unique_ptr<HLResource> > UAVs;
+  UAVs.swap(m_UAVs);
+  return UAVs;
+}
+
 void HLModule::EmitLLVMUsed() {
   if (m_LLVMUsed.empty())
     return;
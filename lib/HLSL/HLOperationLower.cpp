@@ -9,6 +9,7 @@
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include "dxc/HLSL/DxcTimeReport.h"
 #include "dxc/HLSL/DxilModule.h"
 #include "dxc/HLSL/DxilOperations.h"
 #include "dxc/HLSL/HLMatrixLowerHelper.h"
@@ -38,6 +39,7 @@ struct HLOperationLowerHelper {
   DxilTypeSystem &dxilTypeSys;
   DxilFunctionProps *functionProps;
   bool bLegacyCBufferLoad;
+  DXIL::FPSpeed fpSpeed;
   DataLayout dataLayout;
   HLOperationLowerHelper(HLModule &HLM);
 };
@@ -58,6 +60,7 @@ HLOperationLowerHelper::HLOperationLowerHelper(HLModule &HLM)
   if (HLM.HasDxilFunctionProps(EntryFunc))
     functionProps = &HLM.GetDxilFunctionProps(EntryFunc);
   bLegacyCBufferLoad = HLM.GetHLOptions().bLegacyCBufferLoad;
+  fpSpeed = (DXIL::FPSpeed)HLM.GetHLOptions().FPSpeed;
 }
 
 struct HLObjectOperationLowerHelper {
@@ -1245,6 +1248,52 @@ Value *TranslateAsDouble(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
   return TrivialDxilOperation(opcode, { opArg, x, y }, CI->getType(), CI->getType(), hlslOP, Builder);
 }
 
+// atan2 with the atan polynomial of the balanced or fast tier of
+// DxilExpandTrigIntrinsics. Dividing the smaller magnitude by the larger puts
+// the argument in [0, 1] with one division, where atan(y/x) needs a second
+// one for |y/x| > 1.
+static Value *TranslateFastAtan2(Value *y, Value *x, DXIL::FPSpeed speed,
+                                 hlsl::OP *hlslOP, IRBuilder<> &Builder) {
+  // Coefficients from the highest degree down.
+  static const double balanced[] = { 0.0793390, -0.2886902, 0.9953580 };
+  static const double fast[] = { -0.1919480, 0.9723941 };
+  ArrayRef<double> c = speed == DXIL::FPSpeed::Fast ? makeArrayRef(fast)
+                                                    : makeArrayRef(balanced);
+  // TODO: include M_PI from math.h.
+  const double M_PI = 3.14159265358979323846;
+  Type *Ty = x->getType();
+  Constant *pi = ConstantFP::get(Ty, M_PI);
+  Constant *halfPi = ConstantFP::get(Ty, M_PI / 2);
+  Constant *zero = ConstantFP::get(Ty, 0);
+
+  Value *absX = TrivialDxilUnaryOperation(OP::OpCode::FAbs, x, hlslOP, Builder);
+  Value *absY = TrivialDxilUnaryOperation(OP::OpCode::FAbs, y, hlslOP, Builder);
+  Value *minXY = TrivialDxilBinaryOperation(OP::OpCode::FMin, absX, absY,
+                                            hlslOP, Builder);
+  Value *maxXY = TrivialDxilBinaryOperation(OP::OpCode::FMax, absX, absY,
+                                            hlslOP, Builder);
+  // x == 0, y == 0 -> 0 rather than 0/0.
+  Value *t = Builder.CreateFDiv(minXY, maxXY);
+  t = Builder.CreateSelect(Builder.CreateFCmpOEQ(maxXY, zero), zero, t);
+
+  Value *t2 = Builder.CreateFMul(t, t);
+  Value *poly = ConstantFP::get(Ty, c[0]);
+  for (unsigned i = 1; i < c.size(); ++i)
+    poly = Builder.CreateFAdd(Builder.CreateFMul(poly, t2),
+                              ConstantFP::get(Ty, c[i]));
+  Value *result = Builder.CreateFMul(t, poly);
+
+  // |y| > |x| -> pi/2 - atan.
+  Value *yGtX = Builder.CreateFCmpOGT(absY, absX);
+  result = Builder.CreateSelect(yGtX, Builder.CreateFSub(halfPi, result), result);
+  // x < 0 -> pi - atan.
+  Value *xLt0 = Builder.CreateFCmpOLT(x, zero);
+  result = Builder.CreateSelect(xLt0, Builder.CreateFSub(pi, result), result);
+  // y < 0 -> -atan.
+  Value *yLt0 = Builder.CreateFCmpOLT(y, zero);
+  return Builder.CreateSelect(yLt0, Builder.CreateFSub(zero, result), result);
+}
+
 Value *TranslateAtan2(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
                       HLOperationLowerHelper &helper,  HLObjectOperationLowerHelper *pObjHelper, bool &Translated) {
   hlsl::OP *hlslOP = &helper.hlslOP;
@@ -1252,6 +1301,8 @@ Value *TranslateAtan2(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
   Value *x = CI->getArgOperand(HLOperandIndex::kBinaryOpSrc1Idx);
 
   IRBuilder<> Builder(CI);
+  if (helper.fpSpeed != DXIL::FPSpeed::Precise)
+    return TranslateFastAtan2(y, x, helper.fpSpeed, hlslOP, Builder);
   Value *tan = Builder.CreateFDiv(y, x);
 
   Value *atan =
@@ -1786,6 +1837,22 @@ Value *TranslateNormalize(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
   Type *Ty = CI->getType();
   Value *op = CI->getArgOperand(HLOperandIndex::kUnaryOpSrc0Idx);
   IRBuilder<> Builder(CI);
+  if (helper.fpSpeed != DXIL::FPSpeed::Precise && Ty->isVectorTy()) {
+    // x * rsqrt(dot(x, x)) replaces the square root and the division.
+    VectorType *VT = cast<VectorType>(Ty);
+    Value *Elt = Builder.CreateExtractElement(op, (uint64_t)0);
+    Value *Sum = Builder.CreateFMul(Elt, Elt);
+    for (unsigned i = 1; i < VT->getNumElements(); i++) {
+      Elt = Builder.CreateExtractElement(op, i);
+      Sum = Builder.CreateFAdd(Sum, Builder.CreateFMul(Elt, Elt));
+    }
+    Value *rcpLength =
+        TrivialDxilUnaryOperation(OP::OpCode::Rsqrt, Sum, hlslOP, Builder);
+    Value *vecRcpLength = UndefValue::get(VT);
+    for (unsigned i = 0; i < VT->getNumElements(); i++)
+      vecRcpLength = Builder.CreateInsertElement(vecRcpLength, rcpLength, i);
+    return Builder.CreateFMul(op, vecRcpLength);
+  }
   Value *length = TranslateLength(CI, op, hlslOP);
   if (Ty != length->getType()) {
     VectorType *VT = cast<VectorType>(Ty);
@@ -2106,12 +2173,44 @@ Value *TranslateStep(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
   return Builder.CreateSelect(cond, zero, one);
 }
 
+// pow(x, y) for the constant exponents with a cheaper expansion than
+// exp(y * log(x)), or nullptr. Unlike exp(y * log(x)), these don't return NaN
+// for x < 0, so they're only used outside the precise tier.
+static Value *TranslatePowConstExponent(Value *x, Value *y, hlsl::OP *hlslOP,
+                                        IRBuilder<> &Builder) {
+  Constant *C = dyn_cast<Constant>(y);
+  if (C && C->getType()->isVectorTy())
+    C = C->getSplatValue();
+  ConstantFP *exponent = dyn_cast_or_null<ConstantFP>(C);
+  if (!exponent)
+    return nullptr;
+  if (exponent->isExactlyValue(1.0))
+    return x;
+  if (exponent->isExactlyValue(0.5))
+    return TrivialDxilUnaryOperation(DXIL::OpCode::Sqrt, x, hlslOP, Builder);
+  if (exponent->isExactlyValue(-0.5))
+    return TrivialDxilUnaryOperation(DXIL::OpCode::Rsqrt, x, hlslOP, Builder);
+  if (exponent->isExactlyValue(2.0))
+    return Builder.CreateFMul(x, x);
+  if (exponent->isExactlyValue(3.0))
+    return Builder.CreateFMul(Builder.CreateFMul(x, x), x);
+  if (exponent->isExactlyValue(4.0)) {
+    Value *sqr = Builder.CreateFMul(x, x);
+    return Builder.CreateFMul(sqr, sqr);
+  }
+  return nullptr;
+}
+
 Value *TranslatePow(CallInst *CI, IntrinsicOp IOP, OP::OpCode opcode,
                     HLOperationLowerHelper &helper,  HLObjectOperationLowerHelper *pObjHelper, bool &Translated) {
   hlsl::OP *hlslOP = &helper.hlslOP;
   Value *x = CI->getArgOperand(HLOperandIndex::kBinaryOpSrc0Idx);
   Value *y = CI->getArgOperand(HLOperandIndex::kBinaryOpSrc1Idx);
   IRBuilder<> Builder(CI);
+  if (helper.fpSpeed != DXIL::FPSpeed::Precise) {
+    if (Value *result = TranslatePowConstExponent(x, y, hlslOP, Builder))
+      return result;
+  }
   // t = log(x);
   Value *logX =
       TrivialDxilUnaryOperation(DXIL::OpCode::Log, x, hlslOP, Builder);
@@ -4538,10 +4637,250 @@ IntrinsicLower gLowerTable[static_cast<unsigned>(IntrinsicOp::Num_Intrinsics)] =
 };
 }
 
+// Intrinsic names for -ftime-report, in IntrinsicOp order.
+static const char *gIntrinsicOpNames[] = {
+/* <py>
+import hctdb_instrhelp
+</py> */
+/* <py::lines('HLSL-INTRINSIC-NAMES')>hctdb_instrhelp.get_hlsl_intrinsic_op_names()</py>*/
+// HLSL-INTRINSIC-NAMES:BEGIN
+  "IOP_AddUint64",
+  "IOP_AllMemoryBarrier",
+  "IOP_AllMemoryBarrierWithGroupSync",
+  "IOP_CheckAccessFullyMapped",
+  "IOP_D3DCOLORtoUBYTE4",
+  "IOP_DeviceMemoryBarrier",
+  "IOP_DeviceMemoryBarrierWithGroupSync",
+  "IOP_EvaluateAttributeAtSample",
+  "IOP_EvaluateAttributeCentroid",
+  "IOP_EvaluateAttributeSnapped",
+  "IOP_GetAttributeAtVertex",
+  "IOP_GetRenderTargetSampleCount",
+  "IOP_GetRenderTargetSamplePosition",
+  "IOP_GroupMemoryBarrier",
+  "IOP_GroupMemoryBarrierWithGroupSync",
+  "IOP_InterlockedAdd",
+  "IOP_InterlockedAnd",
+  "IOP_InterlockedCompareExchange",
+  "IOP_InterlockedCompareStore",
+  "IOP_InterlockedExchange",
+  "IOP_InterlockedMax",
+  "IOP_InterlockedMin",
+  "IOP_InterlockedOr",
+  "IOP_InterlockedXor",
+  "IOP_NonUniformResourceIndex",
+  "IOP_Process2DQuadTessFactorsAvg",
+  "IOP_Process2DQuadTessFactorsMax",
+  "IOP_Process2DQuadTessFactorsMin",
+  "IOP_ProcessIsolineTessFactors",
+  "IOP_ProcessQuadTessFactorsAvg",
+  "IOP_ProcessQuadTessFactorsMax",
+  "IOP_ProcessQuadTessFactorsMin",
+  "IOP_ProcessTriTessFactorsAvg",
+  "IOP_ProcessTriTessFactorsMax",
+  "IOP_ProcessTriTessFactorsMin",
+  "IOP_QuadReadAcrossDiagonal",
+  "IOP_QuadReadAcrossX",
+  "IOP_QuadReadAcrossY",
+  "IOP_QuadReadLaneAt",
+  "IOP_WaveActiveAllEqual",
+  "IOP_WaveActiveAllTrue",
+  "IOP_WaveActiveAnyTrue",
+  "IOP_WaveActiveBallot",
+  "IOP_WaveActiveBitAnd",
+  "IOP_WaveActiveBitOr",
+  "IOP_WaveActiveBitXor",
+  "IOP_WaveActiveCountBits",
+  "IOP_WaveActiveMax",
+  "IOP_WaveActiveMin",
+  "IOP_WaveActiveProduct",
+  "IOP_WaveActiveSum",
+  "IOP_WaveGetLaneCount",
+  "IOP_WaveGetLaneIndex",
+  "IOP_WaveIsFirstLane",
+  "IOP_WavePrefixCountBits",
+  "IOP_WavePrefixProduct",
+  "IOP_WavePrefixSum",
+  "IOP_WaveReadLaneAt",
+  "IOP_WaveReadLaneFirst",
+  "IOP_abort",
+  "IOP_abs",
+  "IOP_acos",
+  "IOP_all",
+  "IOP_any",
+  "IOP_asdouble",
+  "IOP_asfloat",
+  "IOP_asfloat16",
+  "IOP_asin",
+  "IOP_asint",
+  "IOP_asint16",
+  "IOP_asuint",
+  "IOP_asuint16",
+  "IOP_atan",
+  "IOP_atan2",
+  "IOP_ceil",
+  "IOP_clamp",
+  "IOP_clip",
+  "IOP_cos",
+  "IOP_cosh",
+  "IOP_countbits",
+  "IOP_cross",
+  "IOP_ddx",
+  "IOP_ddx_coarse",
+  "IOP_ddx_fine",
+  "IOP_ddy",
+  "IOP_ddy_coarse",
+  "IOP_ddy_fine",
+  "IOP_degrees",
+  "IOP_determinant",
+  "IOP_distance",
+  "IOP_dot",
+  "IOP_dst",
+  "IOP_exp",
+  "IOP_exp2",
+  "IOP_f16tof32",
+  "IOP_f32tof16",
+  "IOP_faceforward",
+  "IOP_firstbithigh",
+  "IOP_firstbitlow",
+  "IOP_floor",
+  "IOP_fma",
+  "IOP_fmod",
+  "IOP_frac",
+  "IOP_frexp",
+  "IOP_fwidth",
+  "IOP_isfinite",
+  "IOP_isinf",
+  "IOP_isnan",
+  "IOP_ldexp",
+  "IOP_length",
+  "IOP_lerp",
+  "IOP_lit",
+  "IOP_log",
+  "IOP_log10",
+  "IOP_log2",
+  "IOP_mad",
+  "IOP_max",
+  "IOP_min",
+  "IOP_modf",
+  "IOP_msad4",
+  "IOP_mul",
+  "IOP_normalize",
+  "IOP_pow",
+  "IOP_radians",
+  "IOP_rcp",
+  "IOP_reflect",
+  "IOP_refract",
+  "IOP_reversebits",
+  "IOP_round",
+  "IOP_rsqrt",
+  "IOP_saturate",
+  "IOP_sign",
+  "IOP_sin",
+  "IOP_sincos",
+  "IOP_sinh",
+  "IOP_smoothstep",
+  "IOP_source_mark",
+  "IOP_sqrt",
+  "IOP_step",
+  "IOP_tan",
+  "IOP_tanh",
+  "IOP_tex1D",
+  "IOP_tex1Dbias",
+  "IOP_tex1Dgrad",
+  "IOP_tex1Dlod",
+  "IOP_tex1Dproj",
+  "IOP_tex2D",
+  "IOP_tex2Dbias",
+  "IOP_tex2Dgrad",
+  "IOP_tex2Dlod",
+  "IOP_tex2Dproj",
+  "IOP_tex3D",
+  "IOP_tex3Dbias",
+  "IOP_tex3Dgrad",
+  "IOP_tex3Dlod",
+  "IOP_tex3Dproj",
+  "IOP_texCUBE",
+  "IOP_texCUBEbias",
+  "IOP_texCUBEgrad",
+  "IOP_texCUBElod",
+  "IOP_texCUBEproj",
+  "IOP_transpose",
+  "IOP_trunc",
+  "MOP_Append",
+  "MOP_RestartStrip",
+  "MOP_CalculateLevelOfDetail",
+  "MOP_CalculateLevelOfDetailUnclamped",
+  "MOP_GetDimensions",
+  "MOP_Load",
+  "MOP_Sample",
+  "MOP_SampleBias",
+  "MOP_SampleCmp",
+  "MOP_SampleCmpLevelZero",
+  "MOP_SampleGrad",
+  "MOP_SampleLevel",
+  "MOP_Gather",
+  "MOP_GatherAlpha",
+  "MOP_GatherBlue",
+  "MOP_GatherCmp",
+  "MOP_GatherCmpAlpha",
+  "MOP_GatherCmpBlue",
+  "MOP_GatherCmpGreen",
+  "MOP_GatherCmpRed",
+  "MOP_GatherGreen",
+  "MOP_GatherRed",
+  "MOP_GetSamplePosition",
+  "MOP_Load2",
+  "MOP_Load3",
+  "MOP_Load4",
+  "MOP_InterlockedAdd",
+  "MOP_InterlockedAnd",
+  "MOP_InterlockedCompareExchange",
+  "MOP_InterlockedCompareStore",
+  "MOP_InterlockedExchange",
+  "MOP_InterlockedMax",
+  "MOP_InterlockedMin",
+  "MOP_InterlockedOr",
+  "MOP_InterlockedXor",
+  "MOP_Store",
+  "MOP_Store2",
+  "MOP_Store3",
+  "MOP_Store4",
+  "MOP_DecrementCounter",
+  "MOP_IncrementCounter",
+  "MOP_Consume",
+#ifdef ENABLE_SPIRV_CODEGEN
+  "MOP_SubpassLoad",
+#endif // ENABLE_SPIRV_CODEGEN
+  "IOP_InterlockedUMax",
+  "IOP_InterlockedUMin",
+  "IOP_WaveActiveUMax",
+  "IOP_WaveActiveUMin",
+  "IOP_WaveActiveUProduct",
+  "IOP_WaveActiveUSum",
+  "IOP_WavePrefixUProduct",
+  "IOP_WavePrefixUSum",
+  "IOP_uclamp",
+  "IOP_ufirstbithigh",
+  "IOP_umad",
+  "IOP_umax",
+  "IOP_umin",
+  "IOP_umul",
+  "MOP_InterlockedUMax",
+  "MOP_InterlockedUMin",
+// HLSL-INTRINSIC-NAMES:END
+};
+static_assert(_countof(gIntrinsicOpNames) ==
+                  static_cast<unsigned>(IntrinsicOp::Num_Intrinsics),
+              "else gIntrinsicOpNames does not match IntrinsicOp");
+
 static void TranslateBuiltinIntrinsic(CallInst *CI,
                                       HLOperationLowerHelper &helper,  HLObjectOperationLowerHelper *pObjHelper, bool &Translated) {
   unsigned opcode = hlsl::GetHLOpcode(CI);
   const IntrinsicLower &lower = gLowerTable[opcode];
+  // Times each intrinsic as a phase of its own when a report is collected,
+  // so the report shows the call count and lowering cost of each intrinsic.
+  TimeReportPhase lowerPhase(gIntrinsicOpNames[opcode]);
   Value *Result =
       lower.LowerFunc(CI, lower.IntriOpcode, lower.DxilOpcode, helper, pObjHelper, Translated);
   if (Result)
@@ -24,6 +24,7 @@
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include <map>
 
 using namespace llvm;
 using namespace hlsl;
@@ -510,10 +511,40 @@ void replaceStWithStOutput(Function *stOutput, StoreInst *stInst,
   }
 }
 
+// Shares input loads within a function. Loads with constant element, row,
+// column and vertex return the same value anywhere in the function, so they
+// are bucketed by those operands and emitted once in the entry block. Large
+// signatures read through dynamic indexing keep their per-use loads.
+class InputLoadCache {
+public:
+  Value *GetOrCreate(Function *loadInput, ArrayRef<Value *> args,
+                     IRBuilder<> &Builder) {
+    if (!loadInput->doesNotAccessMemory())
+      return Builder.CreateCall(loadInput, args);
+    for (Value *arg : args) {
+      if (!isa<Constant>(arg))
+        return Builder.CreateCall(loadInput, args);
+    }
+    Function *F = Builder.GetInsertBlock()->getParent();
+    std::vector<Value *> key = {F, loadInput};
+    key.insert(key.end(), args.begin(), args.end());
+    CallInst *&input = m_loads[key];
+    if (!input) {
+      IRBuilder<> EntryBuilder(F->getEntryBlock().getFirstInsertionPt());
+      input = EntryBuilder.CreateCall(loadInput, args);
+    }
+    return input;
+  }
+
+private:
+  std::map<std::vector<Value *>, CallInst *> m_loads;
+};
+
 Value *GenerateLdInput(Function *loadInput, ArrayRef<Value *> args,
                        IRBuilder<> &Builder, Value *zero, bool bCast,
-                       Type *Ty) {
-  Value *input = Builder.CreateCall(loadInput, args);
+                       Type *Ty, InputLoadCache *pCache = nullptr) {
+  Value *input = pCache ? pCache->GetOrCreate(loadInput, args, Builder)
+                        : Builder.CreateCall(loadInput, args);
   if (!bCast)
     return input;
   else {
@@ -528,7 +559,7 @@ Value *GenerateLdInput(Function *loadInput, ArrayRef<Value *> args,
 
 Value *replaceLdWithLdInput(Function *loadInput, LoadInst *ldInst,
                             unsigned cols, MutableArrayRef<Value *> args,
-                            bool bCast) {
+                            bool bCast, InputLoadCache *pCache = nullptr) {
   IRBuilder<> Builder(ldInst);
   Type *Ty = ldInst->getType();
   Type *EltTy = Ty->getScalarType();
@@ -541,8 +572,8 @@ Value *replaceLdWithLdInput(Function *loadInput, LoadInst *ldInst,
     for (unsigned col = 0; col < cols; col++) {
       Value *colIdx = Builder.getInt8(col);
       args[DXIL::OperandIndex::kLoadInputColOpIdx] = colIdx;
-      Value *input =
-          GenerateLdInput(loadInput, args, Builder, zero, bCast, EltTy);
+      Value *input = GenerateLdInput(loadInput, args, Builder, zero, bCast,
+                                     EltTy, pCache);
       newVec = Builder.CreateInsertElement(newVec, input, col);
     }
     ldInst->replaceAllUsesWith(newVec);
@@ -561,8 +592,8 @@ Value *replaceLdWithLdInput(Function *loadInput, LoadInst *ldInst,
 
     if (isa<ConstantInt>(colIdx)) {
       args[DXIL::OperandIndex::kLoadInputColOpIdx] = colIdx;
-      Value *input =
-          GenerateLdInput(loadInput, args, Builder, zero, bCast, EltTy);
+      Value *input = GenerateLdInput(loadInput, args, Builder, zero, bCast,
+                                     EltTy, pCache);
       ldInst->replaceAllUsesWith(input);
       ldInst->eraseFromParent();
       return input;
@@ -576,8 +607,8 @@ Value *replaceLdWithLdInput(Function *loadInput, LoadInst *ldInst,
       for (unsigned col = 0; col < cols; col++) {
         Value *colIdx = Builder.getInt8(col);
         args[DXIL::OperandIndex::kLoadInputColOpIdx] = colIdx;
-        Value *input =
-            GenerateLdInput(loadInput, args, Builder, zero, bCast, EltTy);
+        Value *input = GenerateLdInput(loadInput, args, Builder, zero, bCast,
+                                       EltTy, pCache);
         Value *GEP = Builder.CreateInBoundsGEP(arrayVec, {zeroIdx, colIdx});
         Builder.CreateStore(input, GEP);
       }
@@ -821,7 +852,8 @@ void collectInputOutputAccessInfo(
 void GenerateInputOutputUserCall(InputOutputAccessInfo &info, Value *undefVertexIdx,
     Function *ldStFunc, Constant *OpArg, Constant *ID, unsigned cols, bool bI1Cast,
     Constant *columnConsts[],
-    bool bNeedVertexID, bool isArrayTy, bool bInput, bool bIsInout) {
+    bool bNeedVertexID, bool isArrayTy, bool bInput, bool bIsInout,
+    InputLoadCache *pLoadCache) {
   Value *idxVal = info.idx;
   Value *vertexID = undefVertexIdx;
   if (bNeedVertexID && isArrayTy) {
@@ -833,7 +865,7 @@ void GenerateInputOutputUserCall(InputOutputAccessInfo &info, Value *undefVertex
     if (vertexID)
       args.emplace_back(vertexID);
 
-    replaceLdWithLdInput(ldStFunc, ldInst, cols, args, bI1Cast);
+    replaceLdWithLdInput(ldStFunc, ldInst, cols, args, bI1Cast, pLoadCache);
   } else if (StoreInst *stInst = dyn_cast<StoreInst>(info.user)) {
     if (bInput) {
       DXASSERT_LOCALVAR(bIsInout, bIsInout, "input should not have store use.");
@@ -1034,6 +1066,7 @@ void HLSignatureLower::GenerateDxilInputsOutputs(bool bInput) {
   Type *i32Ty = constZero->getType();
 
   llvm::SmallVector<unsigned, 8> removeIndices;
+  InputLoadCache loadCache;
   for (unsigned i = 0; i < Sig.GetElements().size(); i++) {
     DxilSignatureElement *SE = &Sig.GetElement(i);
     llvm::Type *Ty = SE->GetCompType().GetLLVMType(HLM.GetCtx());
@@ -1103,7 +1136,7 @@ void HLSignatureLower::GenerateDxilInputsOutputs(bool bInput) {
     for (InputOutputAccessInfo &info : accessInfoList) {
       GenerateInputOutputUserCall(info, undefVertexIdx, dxilFunc, OpArg, ID,
                                   cols, bI1Cast, columnConsts, bNeedVertexID,
-                                  bIsArrayTy, bInput, bIsInout);
+                                  bIsArrayTy, bInput, bIsInout, &loadCache);
     }
   }
 }
@@ -1225,6 +1258,7 @@ void HLSignatureLower::GenerateDxilPatchConstantLdSt() {
       bIsInput ? OP::OpCode::LoadPatchConstant : OP::OpCode::StorePatchConstant;
   Constant *OpArg = hlslOP->GetU32Const((unsigned)opcode);
 
+  InputLoadCache loadCache;
   for (unsigned i = 0; i < Sig.GetElements().size(); i++) {
     DxilSignatureElement *SE = &Sig.GetElement(i);
     Value *GV = m_sigValueMap[SE];
@@ -1280,7 +1314,8 @@ void HLSignatureLower::GenerateDxilPatchConstantLdSt() {
     for (InputOutputAccessInfo &info : accessInfoList) {
       GenerateInputOutputUserCall(info, undefVertexIdx, dxilFunc, OpArg, ID,
                                   cols, bI1Cast, columnConsts, bNeedVertexID,
-                                  bIsArrayTy, bIsInput, bIsInout);
+                                  bIsArrayTy, bIsInput, bIsInout,
+                                  &loadCache);
     }
   }
 }
@@ -1301,6 +1336,7 @@ void HLSignatureLower::GenerateDxilPatchConstantFunctionInputs() {
   Type *i1Ty = Type::getInt1Ty(constZero->getContext());
   Type *i32Ty = constZero->getType();
 
+  InputLoadCache loadCache;
   for (Argument &arg : patchConstantFunc->args()) {
     DxilParameterAnnotation &paramAnnotation =
         patchFuncAnnotation->GetParameterAnnotation(arg.getArgNo());
@@ -1341,7 +1377,8 @@ void HLSignatureLower::GenerateDxilPatchConstantFunctionInputs() {
           Constant *OpArg = hlslOP->GetU32Const((unsigned)opcode);
           Value *args[] = {OpArg, inputID, info.idx, info.vectorIdx,
                            info.vertexID};
-          replaceLdWithLdInput(dxilLdFunc, ldInst, cols, args, bI1Cast);
+          replaceLdWithLdInput(dxilLdFunc, ldInst, cols, args, bI1Cast,
+                               &loadCache);
         } else
           DXASSERT(0, "input should only be ld");
       }
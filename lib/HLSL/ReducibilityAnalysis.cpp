@@ -18,6 +18,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
 
 #include <vector>
 #include <unordered_map>
@@ -37,9 +38,14 @@ using std::unordered_set;
 //===----------------------------------------------------------------------===//
 //                    Reducibility Analysis Pass
 //
-// The pass implements T1-T2 graph reducibility test.
-// The algorithm can be found in "Engineering a Compiler" text by 
-// Keith Cooper and Linda Torczon.
+// A CFG is reducible iff every edge that retreats in a depth-first walk from
+// the entry goes to a block that dominates its source, i.e. all cycles are
+// natural loops. Checking this takes near-linear time.
+//
+// Blocks unreachable from the entry are checked with the T1-T2 graph
+// reducibility test, which finds the same answer in quadratic time. The
+// algorithm can be found in "Engineering a Compiler" text by Keith Cooper and
+// Linda Torczon.
 //
 //===----------------------------------------------------------------------===//
 namespace ReducibilityAnalysisNS {
@@ -90,16 +96,52 @@ private:
   vector<unsigned> m_Data;
 };
 
-static bool IsEntryNode(size_t NodeIdx) {
-  return NodeIdx == 0;
+// Walks the blocks reachable from the entry, checking that retreating edges
+// are back edges. Visited blocks are added to Reachable.
+static bool IsReachableCFGReducible(Function &F,
+                                    unordered_set<BasicBlock *> &Reachable) {
+  DominatorTreeBase<BasicBlock> DT(false);
+  DT.recalculate(F);
+
+  // Blocks on the walk's stack, and the next successor of each to visit.
+  vector<std::pair<BasicBlock *, succ_iterator> > Stack;
+  unordered_set<BasicBlock *> OnStack;
+  BasicBlock *pEntryBB = &F.getEntryBlock();
+  Reachable.insert(pEntryBB);
+  OnStack.insert(pEntryBB);
+  Stack.emplace_back(pEntryBB, succ_begin(pEntryBB));
+
+  while (!Stack.empty()) {
+    BasicBlock *pBB = Stack.back().first;
+    succ_iterator &itSucc = Stack.back().second;
+    if (itSucc == succ_end(pBB)) {
+      OnStack.erase(pBB);
+      Stack.pop_back();
+      continue;
+    }
+
+    BasicBlock *pSuccBB = *itSucc;
+    ++itSucc;
+    if (OnStack.count(pSuccBB)) {
+      // Retreating edge.
+      if (!DT.dominates(pSuccBB, pBB))
+        return false;
+    } else if (Reachable.insert(pSuccBB).second) {
+      OnStack.insert(pSuccBB);
+      Stack.emplace_back(pSuccBB, succ_begin(pSuccBB));
+    }
+  }
+
+  return true;
 }
 
-bool ReducibilityAnalysis::runOnFunction(Function &F) {
-  m_bReducible = true;
-  if (F.empty()) return false;
-  IFTBOOL(F.size() < UINT32_MAX, DXC_E_DATA_TOO_LARGE);
+// Reduces the blocks that are not in Reachable with T1-T2 transformations.
+// They are reducible if all of them can be removed.
+static bool IsUnreachableCFGReducible(Function &F,
+                                      const unordered_set<BasicBlock *> &Reachable) {
+  if (Reachable.size() == F.size())
+    return true;
 
-  vector<Node> Nodes(F.size());
   unordered_map<BasicBlock*, unsigned> BasicBlockToNodeIdxMap;
 
   //
@@ -107,22 +149,26 @@ bool ReducibilityAnalysis::runOnFunction(Function &F) {
   //
   unsigned iNode = 0;
   for (auto itBB = F.begin(), endBB = F.end(); itBB != endBB; ++itBB) {
-    BasicBlockToNodeIdxMap[itBB] = iNode++;
+    if (!Reachable.count(itBB))
+      BasicBlockToNodeIdxMap[itBB] = iNode++;
   }
 
-  for (auto itBB = F.begin(), endBB = F.end(); itBB != endBB; ++itBB) {
-    BasicBlock *pBB = itBB;
-    unsigned N = BasicBlockToNodeIdxMap[pBB];
+  vector<Node> Nodes(iNode);
+  for (auto &itBBNode : BasicBlockToNodeIdxMap) {
+    BasicBlock *pBB = itBBNode.first;
+    unsigned N = itBBNode.second;
 
+    // Edges from unreachable blocks go away along with them, so only edges
+    // between unreachable blocks matter.
     for (succ_iterator itSucc = succ_begin(pBB), endSucc = succ_end(pBB); itSucc != endSucc; ++itSucc) {
-      BasicBlock *pSuccBB = *itSucc;
-      unsigned SuccNode = BasicBlockToNodeIdxMap[pSuccBB];
-      Nodes[N].m_Succ.insert(SuccNode);
+      auto itSuccNode = BasicBlockToNodeIdxMap.find(*itSucc);
+      if (itSuccNode != BasicBlockToNodeIdxMap.end())
+        Nodes[N].m_Succ.insert(itSuccNode->second);
     }
 
     for (pred_iterator itPred = pred_begin(pBB), endPred = pred_end(pBB); itPred != endPred; ++itPred) {
-      BasicBlock *pPredBB = *itPred;
-      unsigned PredNode = BasicBlockToNodeIdxMap[pPredBB];
+      // Predecessors of an unreachable block are unreachable.
+      unsigned PredNode = BasicBlockToNodeIdxMap[*itPred];
       Nodes[N].m_Pred.insert(PredNode);
     }
   }
@@ -174,8 +220,8 @@ bool ReducibilityAnalysis::runOnFunction(Function &F) {
         continue;
       }
 
-      // Unreachable.
-      if (pNode->m_Pred.size() == 0 && !IsEntryNode(N)) {
+      // No predecessors left.
+      if (pNode->m_Pred.size() == 0) {
         for (auto itSucc = pNode->m_Succ.begin(), endSucc = pNode->m_Succ.end(); itSucc != endSucc; ++itSucc) {
           unsigned SuccNode = *itSucc;
           Node *pSuccNode = &Nodes[SuccNode];
@@ -190,17 +236,26 @@ bool ReducibilityAnalysis::runOnFunction(Function &F) {
       pWaiting->PushBack(N);
     }
 
-    if (pWaiting->Size() == 1) {
-      break;
+    if (pWaiting->Size() == 0) {
+      return true;
     }
 
     if (!bChanged) {
-      m_bReducible = false;
-      break;
+      return false;
     }
 
     std::swap(pReady, pWaiting);
   }
+}
+
+bool ReducibilityAnalysis::runOnFunction(Function &F) {
+  m_bReducible = true;
+  if (F.empty()) return false;
+  IFTBOOL(F.size() < UINT32_MAX, DXC_E_DATA_TOO_LARGE);
+
+  unordered_set<BasicBlock *> Reachable;
+  m_bReducible = IsReachableCFGReducible(F, Reachable) &&
+                 IsUnreachableCFGReducible(F, Reachable);
 
   if (!IsReducible()) {
     switch (m_Action) {
@@ -115,6 +115,47 @@ void LLVMContext::removeModule(Module *M) {
   pImpl->OwnedModules.erase(M);
 }
 
+// HLSL Change Begin - reuse contexts across compilations.
+bool LLVMContext::resetForReuse() {
+  if (!pImpl->OwnedModules.empty())
+    return false;
+
+  // Unnamed, the old struct types can't be picked up by name or cause a new
+  // type to be renamed.
+  SmallVector<StructType *, 32> NamedStructTypes;
+  for (auto &Entry : pImpl->NamedStructTypes)
+    NamedStructTypes.push_back(Entry.getValue());
+  for (StructType *ST : NamedStructTypes)
+    ST->setName("");
+  pImpl->NamedStructTypesUniqueID = 0;
+
+  // Every kind is written to the bitcode, so only the fixed ones are kept.
+  SmallVector<std::string, 16> CustomKinds;
+  for (auto &Entry : pImpl->CustomMDKindNames)
+    if (Entry.getValue() > MD_dereferenceable_or_null)
+      CustomKinds.push_back(Entry.getKey());
+  for (const std::string &Kind : CustomKinds)
+    pImpl->CustomMDKindNames.erase(Kind);
+
+  pImpl->DiscriminatorTable.clear();
+  setInlineAsmDiagnosticHandler(nullptr);
+  setDiagnosticHandler(nullptr);
+  setYieldCallback(nullptr, nullptr);
+  setDiscardValueNames(false);
+  return true;
+}
+// HLSL Change End
+
+// HLSL Change Begin - discard value names.
+bool LLVMContext::shouldDiscardValueNames() const {
+  return pImpl->DiscardValueNames;
+}
+
+void LLVMContext::setDiscardValueNames(bool Discard) {
+  pImpl->DiscardValueNames = Discard;
+}
+// HLSL Change End
+
 //===----------------------------------------------------------------------===//
 // Recoverable Backend Errors
 //===----------------------------------------------------------------------===//
@@ -42,6 +42,7 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
   DiagnosticHandler = nullptr;
   DiagnosticContext = nullptr;
   RespectDiagnosticFilters = false;
+  DiscardValueNames = false; // HLSL Change
   YieldCallback = nullptr;
   YieldOpaqueHandle = nullptr;
   NamedStructTypesUniqueID = 0;
@@ -184,6 +185,47 @@ void Module::dropTriviallyDeadConstantArrays() {
   Context.pImpl->dropTriviallyDeadConstantArrays();
 }
 
+// HLSL Change Begin
+template <typename MapTy>
+static void collectDeadConstants(MapTy &Map,
+                                 SmallVectorImpl<Constant *> &Dead) {
+  for (auto I = Map.map_begin(), E = Map.map_end(); I != E; ++I) {
+    Constant *C = I->first;
+    if (C->use_empty() && !C->isUsedByMetadata())
+      Dead.push_back(C);
+  }
+}
+
+unsigned LLVMContextImpl::dropTriviallyDeadConstants() {
+  // Constants are collected before any is destroyed, since destroying one
+  // changes the maps. That only removes uses of its operands, which may then
+  // be dropped in the next round.
+  unsigned NumDropped = 0;
+  SmallVector<Constant *, 64> Dead;
+  do {
+    Dead.clear();
+    collectDeadConstants(ExprConstants, Dead);
+    collectDeadConstants(ArrayConstants, Dead);
+    collectDeadConstants(StructConstants, Dead);
+    collectDeadConstants(VectorConstants, Dead);
+    for (auto &Entry : CDSConstants) {
+      for (ConstantDataSequential *C = Entry.getValue(); C; C = C->Next) {
+        if (C->use_empty() && !C->isUsedByMetadata())
+          Dead.push_back(C);
+      }
+    }
+    for (Constant *C : Dead)
+      C->destroyConstant();
+    NumDropped += Dead.size();
+  } while (!Dead.empty());
+  return NumDropped;
+}
+
+unsigned Module::dropTriviallyDeadConstants() {
+  return Context.pImpl->dropTriviallyDeadConstants();
+}
+// HLSL Change End
+
 namespace llvm {
 /// \brief Make MDOperand transparent for hashing.
 ///
@@ -934,6 +934,8 @@ public:
   void *DiagnosticContext;
   bool RespectDiagnosticFilters;
 
+  bool DiscardValueNames; // HLSL Change
+
   LLVMContext::YieldCallbackTy YieldCallback;
   void *YieldOpaqueHandle;
 
@@ -1052,6 +1054,12 @@ public:
 
   /// Destroy the ConstantArrays if they are not used.
   void dropTriviallyDeadConstantArrays();
+
+  // HLSL Change Begin
+  /// Destroy the uniqued expressions, aggregates and data sequences that no
+  /// value or metadata uses, and return how many were destroyed.
+  unsigned dropTriviallyDeadConstants();
+  // HLSL Change End
 };
 
 }
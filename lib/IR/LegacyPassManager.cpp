@@ -17,6 +17,7 @@
 #include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/IR/LegacyPassNameParser.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/Cancellation.h" // HLSL Change
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -498,6 +499,29 @@ public:
 
 static TimingInfo *TheTimeInfo;
 
+// HLSL Change Starts
+static LLVM_THREAD_LOCAL legacy::PassTimingListener *ThePassTimingListener;
+
+legacy::PassTimingListener *
+legacy::setThreadPassTimingListener(legacy::PassTimingListener *L) {
+  legacy::PassTimingListener *Prior = ThePassTimingListener;
+  ThePassTimingListener = L;
+  return Prior;
+}
+
+PassTimeRegion::PassTimeRegion(Pass *P, Module &M, Function *F)
+    : Region(getPassTimer(P)), P(P), M(M), F(F),
+      Listener(P->getAsPMDataManager() ? nullptr : ThePassTimingListener) {
+  if (Listener)
+    Listener->passStarted(P, M, F);
+}
+
+PassTimeRegion::~PassTimeRegion() {
+  if (Listener)
+    Listener->passEnded(P, M, F);
+}
+// HLSL Change Ends
+
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
 
@@ -1317,7 +1341,7 @@ bool BBPassManager::runOnFunction(Function &F) {
       {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
-        TimeRegion PassTimer(getPassTimer(BP));
+        PassTimeRegion PassTimer(BP, *F.getParent(), &F); // HLSL Change
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1541,10 +1565,11 @@ bool FPPassManager::runOnFunction(Function &F) {
     dumpRequiredSet(FP);
 
     initializeAnalysisImpl(FP);
+    checkThreadCancellation(); // HLSL Change
 
     {
       PassManagerPrettyStackEntry X(FP, F);
-      TimeRegion PassTimer(getPassTimer(FP));
+      PassTimeRegion PassTimer(FP, *F.getParent(), &F); // HLSL Change
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1617,10 +1642,11 @@ MPPassManager::runOnModule(Module &M) {
     dumpRequiredSet(MP);
 
     initializeAnalysisImpl(MP);
+    checkThreadCancellation(); // HLSL Change
 
     {
       PassManagerPrettyStackEntry X(MP, M);
-      TimeRegion PassTimer(getPassTimer(MP));
+      PassTimeRegion PassTimer(MP, M, nullptr); // HLSL Change
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -199,6 +199,11 @@ void Value::setNameImpl(const Twine &NewName) {
   if (NewName.isTriviallyEmpty() && !hasName())
     return;
 
+  // HLSL Change Begin - the context may drop the names of local values.
+  if (getContext().shouldDiscardValueNames() && !isa<GlobalValue>(this))
+    return;
+  // HLSL Change End
+
   SmallString<256> NameData;
   StringRef NameRef = NewName.toStringRef(NameData);
   assert(NameRef.find_first_of(0) == StringRef::npos &&
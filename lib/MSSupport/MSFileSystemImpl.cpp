@@ -12,7 +12,12 @@
 
 #include "dxc/Support/WinIncludes.h"
 #include <fcntl.h>
+#ifdef _WIN32
 #include <io.h>
+#else
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdint.h>
@@ -200,6 +205,7 @@ DWORD MSFileSystemForDisk::GetTempPathW(DWORD nBufferLength, LPWSTR lpBuffer)
   return ::GetTempPathW(nBufferLength, lpBuffer);
 }
 
+#ifdef _WIN32
 namespace {
   typedef BOOLEAN(WINAPI *PtrCreateSymbolicLinkW)(
     /*__in*/ LPCWSTR lpSymlinkFileName,
@@ -221,6 +227,24 @@ bool MSFileSystemForDisk::SupportsCreateSymbolicLink()
 {
   return create_symbolic_link_api != nullptr;
 }
+#else
+_Use_decl_annotations_
+BOOLEAN MSFileSystemForDisk::CreateSymbolicLinkW(LPCWSTR lpSymlinkFileName, LPCWSTR lpTargetFileName, DWORD dwFlags)
+{
+  CW2A link(lpSymlinkFileName, CP_UTF8);
+  CW2A target(lpTargetFileName, CP_UTF8);
+  if (::symlink(target.m_psz, link.m_psz) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+bool MSFileSystemForDisk::SupportsCreateSymbolicLink()
+{
+  return true;
+}
+#endif
 
 _Use_decl_annotations_
 BOOL MSFileSystemForDisk::ReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, _Out_opt_ LPDWORD lpNumberOfBytesRead)
@@ -246,6 +270,7 @@ BOOL MSFileSystemForDisk::UnmapViewOfFile(LPCVOID lpBaseAddress) throw()
   return ::UnmapViewOfFile(lpBaseAddress);
 }
 
+#ifdef _WIN32
 bool MSFileSystemForDisk::FileDescriptorIsDisplayed(int fd)
 {
   DWORD Mode;  // Unused
@@ -330,6 +355,91 @@ int MSFileSystemForDisk::Write(int fd, const void* buffer, unsigned int count)
 {
   return ::_write(fd, buffer, count);
 }
+#else
+bool MSFileSystemForDisk::FileDescriptorIsDisplayed(int fd)
+{
+  return ::isatty(fd) != 0;
+}
+
+unsigned MSFileSystemForDisk::GetColumnCount(DWORD nStdHandle)
+{
+  int fd = nStdHandle == STD_ERROR_HANDLE ? STDERR_FILENO : STDOUT_FILENO;
+  struct winsize ws;
+  if (::ioctl(fd, TIOCGWINSZ, &ws) == 0)
+    return ws.ws_col;
+  return 0;
+}
+
+// Colors are written as escape sequences by the Unix process support, so
+// there are no attributes to keep.
+unsigned MSFileSystemForDisk::GetConsoleOutputTextAttributes() throw()
+{
+  return 0;
+}
+
+void MSFileSystemForDisk::SetConsoleOutputTextAttributes(unsigned attributes)
+{
+}
+
+void MSFileSystemForDisk::ResetConsoleOutputTextAttributes()
+{
+}
+
+// Handles and descriptors are the same files, so converting one to the
+// other hands the file over.
+int MSFileSystemForDisk::open_osfhandle(intptr_t osfhandle, int flags)
+{
+  int fd = HandleToDescriptor((HANDLE)osfhandle);
+  if (fd != -1 && (flags & _O_APPEND))
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_APPEND);
+  return fd;
+}
+
+intptr_t MSFileSystemForDisk::get_osfhandle(int fd)
+{
+  return (intptr_t)DescriptorToHandle(fd);
+}
+
+int MSFileSystemForDisk::close(int fd)
+{
+  return ::close(fd);
+}
+
+long MSFileSystemForDisk::lseek(int fd, long offset, int origin)
+{
+  return ::lseek(fd, offset, origin);
+}
+
+int MSFileSystemForDisk::setmode(int fd, int mode)
+{
+  // There is no text mode.
+  return 0;
+}
+
+_Use_decl_annotations_
+errno_t MSFileSystemForDisk::resize_file(LPCWSTR path, uint64_t size)
+{
+  CW2A utf8Path(path, CP_UTF8);
+  int fd = ::open(utf8Path.m_psz, O_RDWR);
+  if (fd == -1)
+    return errno;
+  errno_t error = ::ftruncate(fd, size) == 0 ? 0 : errno;
+  ::close(fd);
+  return error;
+}
+
+_Use_decl_annotations_
+int MSFileSystemForDisk::Read(int fd, void* buffer, unsigned int count)
+{
+  return ::read(fd, buffer, count);
+}
+
+_Use_decl_annotations_
+int MSFileSystemForDisk::Write(int fd, const void* buffer, unsigned int count)
+{
+  return ::write(fd, buffer, count);
+}
+#endif
 
 } // end namespace fs
 } // end namespace sys
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// Cancellation.cpp                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements cooperative cancellation of the work running on a thread.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "llvm/Support/Cancellation.h"
+#include "llvm/Support/Compiler.h"
+
+using namespace llvm;
+
+static LLVM_THREAD_LOCAL CancellationCheck *TheCancellationCheck;
+static LLVM_THREAD_LOCAL unsigned PollsUntilCheck;
+
+// Polls between asks of the check. A poll that doesn't ask is a load and a
+// decrement.
+static const unsigned kPollsPerCheck = 256;
+
+CancellationCheck *llvm::setThreadCancellationCheck(CancellationCheck *C) {
+  CancellationCheck *Prior = TheCancellationCheck;
+  TheCancellationCheck = C;
+  PollsUntilCheck = kPollsPerCheck;
+  return Prior;
+}
+
+void llvm::checkThreadCancellation() {
+  if (TheCancellationCheck && TheCancellationCheck->isCancelled())
+    throw hlsl::Exception(E_ABORT, "compilation was cancelled");
+}
+
+void llvm::pollThreadCancellation() {
+  if (!TheCancellationCheck || --PollsUntilCheck != 0)
+    return;
+  PollsUntilCheck = kPollsPerCheck;
+  checkThreadCancellation();
+}
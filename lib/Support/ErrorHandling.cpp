@@ -148,9 +148,13 @@ void LLVMResetFatalErrorHandler() {
   remove_fatal_error_handler();
 }
 
+// HLSL Change Starts - the MSFileSystem reports Win32 errors everywhere
 #ifdef LLVM_ON_WIN32
-
 #include <winerror.h>
+#else
+#include "dxc/Support/WinIncludes.h"
+#endif
+// HLSL Change Ends
 
 // I'd rather not double the line count of the following.
 #define MAP_ERR_TO_COND(x, y)                                                  \
@@ -212,5 +216,3 @@ std::error_code llvm::mapWindowsError(unsigned EV) {
     return std::error_code(EV, std::system_category());
   }
 }
-
-#endif
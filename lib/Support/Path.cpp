@@ -1068,9 +1068,5 @@ std::error_code directory_entry::status(file_status &result) const {
 } // end namespace llvm
 
 // Include the truly platform-specific parts.
-#if defined(LLVM_ON_UNIX)
-#include "Unix/Path.inc"
-#endif
-#if defined(LLVM_ON_WIN32)
+// HLSL Change - file system calls always go through the MSFileSystem.
 #include "Windows/MSFileSystem.inc.cpp"
-#endif
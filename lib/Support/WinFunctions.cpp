@@ -0,0 +1,947 @@
+//===- WinFunctions.cpp - Windows functions for other platforms --*- C++ -*-===//
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// WinFunctions.cpp                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the Win32 functions declared in WinAdapter.h on POSIX.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+#include "dxc/Support/WinIncludes.h"
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Errors.
+
+static thread_local DWORD g_LastError;
+
+DWORD GetLastError() { return g_LastError; }
+
+void SetLastError(DWORD dwErrCode) { g_LastError = dwErrCode; }
+
+void SetLastErrorFromErrno() {
+  DWORD error;
+  switch (errno) {
+  case 0:            error = ERROR_SUCCESS; break;
+  case ENOENT:       error = ERROR_FILE_NOT_FOUND; break;
+  case ENOTDIR:      error = ERROR_PATH_NOT_FOUND; break;
+  case EACCES:
+  case EPERM:
+  case EISDIR:       error = ERROR_ACCESS_DENIED; break;
+  case EEXIST:       error = ERROR_FILE_EXISTS; break;
+  case ENOTEMPTY:    error = ERROR_DIR_NOT_EMPTY; break;
+  case ENOMEM:       error = ERROR_NOT_ENOUGH_MEMORY; break;
+  case EMFILE:
+  case ENFILE:       error = ERROR_TOO_MANY_OPEN_FILES; break;
+  case ENOSPC:       error = ERROR_DISK_FULL; break;
+  case EBADF:        error = ERROR_INVALID_HANDLE; break;
+  case EINVAL:       error = ERROR_INVALID_PARAMETER; break;
+  case ENAMETOOLONG: error = ERROR_BUFFER_OVERFLOW; break;
+  case EBUSY:        error = ERROR_BUSY; break;
+  case EROFS:        error = ERROR_WRITE_PROTECT; break;
+  case ENOSYS:
+  case ENOTSUP:      error = ERROR_NOT_SUPPORTED; break;
+  case EIO:          error = ERROR_IO_DEVICE; break;
+  default:           error = ERROR_GEN_FAILURE; break;
+  }
+  SetLastError(error);
+}
+
+//===----------------------------------------------------------------------===//
+// Handles.
+//
+// A file handle is its descriptor shifted left with the low bit set, so that
+// neither null nor INVALID_HANDLE_VALUE is ever a file and a descriptor is
+// recovered without a lookup. Other handles point to a HandleObject, which is
+// always at least two-byte aligned.
+
+namespace {
+struct HandleObject {
+  enum Kind { FileMapping, Find };
+  Kind kind;
+  explicit HandleObject(Kind k) : kind(k) {}
+};
+
+struct FileMappingObject : public HandleObject {
+  int fd;
+  DWORD protect;
+  FileMappingObject(int fd, DWORD protect)
+      : HandleObject(FileMapping), fd(fd), protect(protect) {}
+};
+
+struct FindObject : public HandleObject {
+  DIR *dir;
+  FindObject(DIR *dir) : HandleObject(Find), dir(dir) {}
+};
+}
+
+static bool IsDescriptorHandle(HANDLE h) {
+  return h != INVALID_HANDLE_VALUE && ((intptr_t)h & 1) != 0;
+}
+
+static HandleObject *GetHandleObject(HANDLE h) {
+  if (h == nullptr || h == INVALID_HANDLE_VALUE || IsDescriptorHandle(h))
+    return nullptr;
+  return reinterpret_cast<HandleObject *>(h);
+}
+
+int HandleToDescriptor(HANDLE h) {
+  if (!IsDescriptorHandle(h))
+    return -1;
+  return (int)((intptr_t)h >> 1);
+}
+
+HANDLE DescriptorToHandle(int fd) {
+  if (fd < 0)
+    return INVALID_HANDLE_VALUE;
+  return (HANDLE)(((intptr_t)fd << 1) | 1);
+}
+
+BOOL CloseHandle(HANDLE hObject) {
+  int fd = HandleToDescriptor(hObject);
+  if (fd != -1) {
+    if (::close(fd) != 0) {
+      SetLastErrorFromErrno();
+      return FALSE;
+    }
+    return TRUE;
+  }
+  HandleObject *pObject = GetHandleObject(hObject);
+  if (pObject == nullptr) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return FALSE;
+  }
+  if (pObject->kind == HandleObject::FileMapping) {
+    FileMappingObject *pMapping = static_cast<FileMappingObject *>(pObject);
+    ::close(pMapping->fd);
+    delete pMapping;
+    return TRUE;
+  }
+  return FindClose(hObject);
+}
+
+//===----------------------------------------------------------------------===//
+// Strings.
+
+static bool IsContinuation(unsigned char c) { return (c & 0xC0) == 0x80; }
+
+// Decodes the code point at p, or returns false if it is malformed.
+static bool DecodeUtf8(const unsigned char *&p, const unsigned char *end,
+                       uint32_t &cp) {
+  unsigned char c = *p++;
+  unsigned extra;
+  if (c < 0x80) {
+    cp = c;
+    return true;
+  } else if ((c & 0xE0) == 0xC0) {
+    cp = c & 0x1F;
+    extra = 1;
+  } else if ((c & 0xF0) == 0xE0) {
+    cp = c & 0x0F;
+    extra = 2;
+  } else if ((c & 0xF8) == 0xF0) {
+    cp = c & 0x07;
+    extra = 3;
+  } else {
+    return false;
+  }
+  for (unsigned i = 0; i < extra; ++i) {
+    if (p == end || !IsContinuation(*p))
+      return false;
+    cp = (cp << 6) | (*p++ & 0x3F);
+  }
+  // Reject overlong forms, surrogates and values past the Unicode range.
+  static const uint32_t kMinForLength[] = {0, 0x80, 0x800, 0x10000};
+  return cp >= kMinForLength[extra] && cp <= 0x10FFFF &&
+         (cp < 0xD800 || cp > 0xDFFF);
+}
+
+int MultiByteToWideChar(UINT CodePage, DWORD dwFlags, LPCSTR lpMultiByteStr,
+                        int cbMultiByte, LPWSTR lpWideCharStr,
+                        int cchWideChar) {
+  (void)CodePage;
+  if (lpMultiByteStr == nullptr || cbMultiByte == 0 || cchWideChar < 0) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return 0;
+  }
+  size_t length =
+      cbMultiByte < 0 ? strlen(lpMultiByteStr) + 1 : (size_t)cbMultiByte;
+  const unsigned char *p = (const unsigned char *)lpMultiByteStr;
+  const unsigned char *end = p + length;
+  int count = 0;
+  while (p != end) {
+    uint32_t cp;
+    if (!DecodeUtf8(p, end, cp)) {
+      if (dwFlags & MB_ERR_INVALID_CHARS) {
+        SetLastError(ERROR_NO_UNICODE_TRANSLATION);
+        return 0;
+      }
+      cp = 0xFFFD;
+    }
+    if (cchWideChar != 0) {
+      if (count == cchWideChar) {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+      }
+      lpWideCharStr[count] = (wchar_t)cp;
+    }
+    ++count;
+  }
+  return count;
+}
+
+int WideCharToMultiByte(UINT CodePage, DWORD dwFlags, LPCWSTR lpWideCharStr,
+                        int cchWideChar, LPSTR lpMultiByteStr, int cbMultiByte,
+                        LPCSTR lpDefaultChar, LPBOOL lpUsedDefaultChar) {
+  (void)CodePage;
+  (void)lpDefaultChar;
+  if (lpUsedDefaultChar)
+    *lpUsedDefaultChar = FALSE;
+  if (lpWideCharStr == nullptr || cchWideChar == 0 || cbMultiByte < 0) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return 0;
+  }
+  size_t length =
+      cchWideChar < 0 ? wcslen(lpWideCharStr) + 1 : (size_t)cchWideChar;
+  int count = 0;
+  for (size_t i = 0; i < length; ++i) {
+    uint32_t cp = (uint32_t)lpWideCharStr[i];
+    if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+      if (dwFlags & WC_ERR_INVALID_CHARS) {
+        SetLastError(ERROR_NO_UNICODE_TRANSLATION);
+        return 0;
+      }
+      cp = 0xFFFD;
+    }
+    char bytes[4];
+    int n;
+    if (cp < 0x80) {
+      bytes[0] = (char)cp;
+      n = 1;
+    } else if (cp < 0x800) {
+      bytes[0] = (char)(0xC0 | (cp >> 6));
+      bytes[1] = (char)(0x80 | (cp & 0x3F));
+      n = 2;
+    } else if (cp < 0x10000) {
+      bytes[0] = (char)(0xE0 | (cp >> 12));
+      bytes[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+      bytes[2] = (char)(0x80 | (cp & 0x3F));
+      n = 3;
+    } else {
+      bytes[0] = (char)(0xF0 | (cp >> 18));
+      bytes[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+      bytes[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+      bytes[3] = (char)(0x80 | (cp & 0x3F));
+      n = 4;
+    }
+    if (cbMultiByte != 0) {
+      if (count + n > cbMultiByte) {
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+      }
+      memcpy(lpMultiByteStr + count, bytes, n);
+    }
+    count += n;
+  }
+  return count;
+}
+
+static bool WideToUtf8(LPCWSTR pWide, std::string &utf8) {
+  if (pWide == nullptr) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return false;
+  }
+  int len = WideCharToMultiByte(CP_UTF8, 0, pWide, -1, nullptr, 0, nullptr,
+                                nullptr);
+  if (len == 0)
+    return false;
+  utf8.resize(len);
+  WideCharToMultiByte(CP_UTF8, 0, pWide, -1, &utf8[0], len, nullptr, nullptr);
+  utf8.resize(len - 1);
+  return true;
+}
+
+// Copies a path into a caller's buffer the way GetCurrentDirectoryW does:
+// the length without the terminator on success, or the size needed.
+static DWORD CopyPathResult(const std::string &path, DWORD nBufferLength,
+                            LPWSTR lpBuffer) {
+  int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  if (len == 0)
+    return 0;
+  if (lpBuffer == nullptr || nBufferLength < (DWORD)len)
+    return (DWORD)len;
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, lpBuffer, len);
+  return (DWORD)len - 1;
+}
+
+//===----------------------------------------------------------------------===//
+// Files.
+
+static FILETIME ToFileTime(const struct timespec &ts) {
+  // FILETIME counts 100ns intervals since 1601.
+  const uint64_t kEpochDifference = 11644473600ULL;
+  uint64_t ticks = ((uint64_t)ts.tv_sec + kEpochDifference) * 10000000ULL +
+                   (uint64_t)ts.tv_nsec / 100;
+  FILETIME ft;
+  ft.dwLowDateTime = (DWORD)ticks;
+  ft.dwHighDateTime = (DWORD)(ticks >> 32);
+  return ft;
+}
+
+static struct timespec FromFileTime(const FILETIME &ft) {
+  const uint64_t kEpochDifference = 11644473600ULL;
+  uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+  struct timespec ts;
+  ts.tv_sec = (time_t)(ticks / 10000000ULL - kEpochDifference);
+  ts.tv_nsec = (long)(ticks % 10000000ULL) * 100;
+  return ts;
+}
+
+#ifdef __APPLE__
+#define ST_MTIM(st) (st).st_mtimespec
+#define ST_ATIM(st) (st).st_atimespec
+#define ST_CTIM(st) (st).st_ctimespec
+#else
+#define ST_MTIM(st) (st).st_mtim
+#define ST_ATIM(st) (st).st_atim
+#define ST_CTIM(st) (st).st_ctim
+#endif
+
+static DWORD GetAttributesFromStat(const struct stat &st) {
+  DWORD attributes = S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : 0;
+  if ((st.st_mode & S_IWUSR) == 0)
+    attributes |= FILE_ATTRIBUTE_READONLY;
+  return attributes ? attributes : FILE_ATTRIBUTE_NORMAL;
+}
+
+HANDLE CreateFileW(LPCWSTR lpFileName, DWORD dwDesiredAccess,
+                   DWORD dwShareMode, void *lpSecurityAttributes,
+                   DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes,
+                   HANDLE hTemplateFile) {
+  (void)dwShareMode;
+  (void)lpSecurityAttributes;
+  (void)hTemplateFile;
+  std::string path;
+  if (!WideToUtf8(lpFileName, path))
+    return INVALID_HANDLE_VALUE;
+
+  int flags = O_CLOEXEC;
+  if ((dwDesiredAccess & GENERIC_READ) && (dwDesiredAccess & GENERIC_WRITE))
+    flags |= O_RDWR;
+  else if (dwDesiredAccess & GENERIC_WRITE)
+    flags |= O_WRONLY;
+  else
+    flags |= O_RDONLY;
+  switch (dwCreationDisposition) {
+  case CREATE_NEW:        flags |= O_CREAT | O_EXCL; break;
+  case CREATE_ALWAYS:     flags |= O_CREAT | O_TRUNC; break;
+  case OPEN_ALWAYS:       flags |= O_CREAT; break;
+  case TRUNCATE_EXISTING: flags |= O_TRUNC; break;
+  case OPEN_EXISTING:     break;
+  default:
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return INVALID_HANDLE_VALUE;
+  }
+
+  int fd = ::open(path.c_str(), flags, 0666);
+  if (fd == -1) {
+    SetLastErrorFromErrno();
+    return INVALID_HANDLE_VALUE;
+  }
+  // As on Windows, directories only open with backup semantics.
+  if ((dwFlagsAndAttributes & FILE_FLAG_BACKUP_SEMANTICS) == 0) {
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISDIR(st.st_mode)) {
+      ::close(fd);
+      SetLastError(ERROR_ACCESS_DENIED);
+      return INVALID_HANDLE_VALUE;
+    }
+  }
+  return DescriptorToHandle(fd);
+}
+
+BOOL ReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead,
+              LPDWORD lpNumberOfBytesRead, void *lpOverlapped) {
+  (void)lpOverlapped;
+  int fd = HandleToDescriptor(hFile);
+  DWORD total = 0;
+  while (total < nNumberOfBytesToRead) {
+    ssize_t n = ::read(fd, (char *)lpBuffer + total,
+                       nNumberOfBytesToRead - total);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (lpNumberOfBytesRead)
+        *lpNumberOfBytesRead = total;
+      SetLastErrorFromErrno();
+      return FALSE;
+    }
+    if (n == 0) {
+      SetLastError(ERROR_HANDLE_EOF);
+      break;
+    }
+    total += (DWORD)n;
+  }
+  if (lpNumberOfBytesRead)
+    *lpNumberOfBytesRead = total;
+  return TRUE;
+}
+
+BOOL WriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD nNumberOfBytesToWrite,
+               LPDWORD lpNumberOfBytesWritten, void *lpOverlapped) {
+  (void)lpOverlapped;
+  int fd = HandleToDescriptor(hFile);
+  DWORD total = 0;
+  while (total < nNumberOfBytesToWrite) {
+    ssize_t n = ::write(fd, (const char *)lpBuffer + total,
+                        nNumberOfBytesToWrite - total);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (lpNumberOfBytesWritten)
+        *lpNumberOfBytesWritten = total;
+      SetLastErrorFromErrno();
+      return FALSE;
+    }
+    total += (DWORD)n;
+  }
+  if (lpNumberOfBytesWritten)
+    *lpNumberOfBytesWritten = total;
+  return TRUE;
+}
+
+BOOL GetFileSizeEx(HANDLE hFile, PLARGE_INTEGER lpFileSize) {
+  struct stat st;
+  if (::fstat(HandleToDescriptor(hFile), &st) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  lpFileSize->QuadPart = st.st_size;
+  return TRUE;
+}
+
+DWORD GetFileType(HANDLE hFile) {
+  struct stat st;
+  if (::fstat(HandleToDescriptor(hFile), &st) != 0) {
+    SetLastErrorFromErrno();
+    return FILE_TYPE_UNKNOWN;
+  }
+  if (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode))
+    return FILE_TYPE_DISK;
+  if (S_ISCHR(st.st_mode))
+    return FILE_TYPE_CHAR;
+  if (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode))
+    return FILE_TYPE_PIPE;
+  SetLastError(NO_ERROR);
+  return FILE_TYPE_UNKNOWN;
+}
+
+BOOL GetFileInformationByHandle(HANDLE hFile,
+                                LPBY_HANDLE_FILE_INFORMATION lpInfo) {
+  struct stat st;
+  if (::fstat(HandleToDescriptor(hFile), &st) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  lpInfo->dwFileAttributes = GetAttributesFromStat(st);
+  lpInfo->ftCreationTime = ToFileTime(ST_CTIM(st));
+  lpInfo->ftLastAccessTime = ToFileTime(ST_ATIM(st));
+  lpInfo->ftLastWriteTime = ToFileTime(ST_MTIM(st));
+  lpInfo->dwVolumeSerialNumber = (DWORD)st.st_dev;
+  lpInfo->nFileSizeHigh = (DWORD)((uint64_t)st.st_size >> 32);
+  lpInfo->nFileSizeLow = (DWORD)st.st_size;
+  lpInfo->nNumberOfLinks = (DWORD)st.st_nlink;
+  lpInfo->nFileIndexHigh = (DWORD)((uint64_t)st.st_ino >> 32);
+  lpInfo->nFileIndexLow = (DWORD)st.st_ino;
+  return TRUE;
+}
+
+BOOL SetFileTime(HANDLE hFile, const FILETIME *lpCreationTime,
+                 const FILETIME *lpLastAccessTime,
+                 const FILETIME *lpLastWriteTime) {
+  (void)lpCreationTime;
+  struct timespec times[2];
+  times[0].tv_nsec = UTIME_OMIT;
+  times[1].tv_nsec = UTIME_OMIT;
+  if (lpLastAccessTime)
+    times[0] = FromFileTime(*lpLastAccessTime);
+  if (lpLastWriteTime)
+    times[1] = FromFileTime(*lpLastWriteTime);
+  if (::futimens(HandleToDescriptor(hFile), times) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+DWORD GetFileAttributesW(LPCWSTR lpFileName) {
+  std::string path;
+  if (!WideToUtf8(lpFileName, path))
+    return INVALID_FILE_ATTRIBUTES;
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0) {
+    SetLastErrorFromErrno();
+    return INVALID_FILE_ATTRIBUTES;
+  }
+  return GetAttributesFromStat(st);
+}
+
+BOOL DeleteFileW(LPCWSTR lpFileName) {
+  std::string path;
+  if (!WideToUtf8(lpFileName, path))
+    return FALSE;
+  if (::unlink(path.c_str()) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOL RemoveDirectoryW(LPCWSTR lpPathName) {
+  std::string path;
+  if (!WideToUtf8(lpPathName, path))
+    return FALSE;
+  if (::rmdir(path.c_str()) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOL CreateDirectoryW(LPCWSTR lpPathName, void *lpSecurityAttributes) {
+  (void)lpSecurityAttributes;
+  std::string path;
+  if (!WideToUtf8(lpPathName, path))
+    return FALSE;
+  if (::mkdir(path.c_str(), 0777) != 0) {
+    if (errno == EEXIST)
+      SetLastError(ERROR_ALREADY_EXISTS);
+    else
+      SetLastErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOL MoveFileExW(LPCWSTR lpExistingFileName, LPCWSTR lpNewFileName,
+                 DWORD dwFlags) {
+  std::string from, to;
+  if (!WideToUtf8(lpExistingFileName, from) || !WideToUtf8(lpNewFileName, to))
+    return FALSE;
+  struct stat st;
+  if ((dwFlags & MOVEFILE_REPLACE_EXISTING) == 0 &&
+      ::stat(to.c_str(), &st) == 0) {
+    SetLastError(ERROR_ALREADY_EXISTS);
+    return FALSE;
+  }
+  if (::rename(from.c_str(), to.c_str()) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOL CreateHardLinkW(LPCWSTR lpFileName, LPCWSTR lpExistingFileName,
+                     void *lpSecurityAttributes) {
+  (void)lpSecurityAttributes;
+  std::string link, existing;
+  if (!WideToUtf8(lpFileName, link) || !WideToUtf8(lpExistingFileName, existing))
+    return FALSE;
+  if (::link(existing.c_str(), link.c_str()) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+DWORD GetCurrentDirectoryW(DWORD nBufferLength, LPWSTR lpBuffer) {
+  std::vector<char> buffer(PATH_MAX);
+  while (::getcwd(buffer.data(), buffer.size()) == nullptr) {
+    if (errno != ERANGE) {
+      SetLastErrorFromErrno();
+      return 0;
+    }
+    buffer.resize(buffer.size() * 2);
+  }
+  return CopyPathResult(buffer.data(), nBufferLength, lpBuffer);
+}
+
+DWORD GetTempPathW(DWORD nBufferLength, LPWSTR lpBuffer) {
+  const char *tmp = ::getenv("TMPDIR");
+  std::string path = tmp && *tmp ? tmp : "/tmp";
+  if (path.back() != '/')
+    path.push_back('/');
+  return CopyPathResult(path, nBufferLength, lpBuffer);
+}
+
+DWORD GetModuleFileNameW(HMODULE hModule, LPWSTR lpFilename, DWORD nSize) {
+  std::string path;
+  if (hModule == nullptr) {
+    std::vector<char> buffer(PATH_MAX);
+    ssize_t len = ::readlink("/proc/self/exe", buffer.data(), buffer.size());
+    if (len <= 0) {
+      SetLastErrorFromErrno();
+      return 0;
+    }
+    path.assign(buffer.data(), len);
+  } else {
+    // Find the library through any of its symbols.
+    void *pSymbol = ::dlsym(hModule, "DxcCreateInstance");
+    Dl_info info;
+    if (pSymbol == nullptr || ::dladdr(pSymbol, &info) == 0 ||
+        info.dli_fname == nullptr) {
+      SetLastError(ERROR_NOT_FOUND);
+      return 0;
+    }
+    path = info.dli_fname;
+  }
+  if (nSize == 0) {
+    SetLastError(ERROR_INSUFFICIENT_BUFFER);
+    return 0;
+  }
+  std::vector<wchar_t> wide(path.size() + 1);
+  int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wide.data(),
+                                (int)wide.size());
+  if (len == 0)
+    return 0;
+  // Truncates like Windows does, returning the full buffer size.
+  DWORD count = (DWORD)len - 1;
+  if (count >= nSize) {
+    wmemcpy(lpFilename, wide.data(), nSize - 1);
+    lpFilename[nSize - 1] = L'\0';
+    SetLastError(ERROR_INSUFFICIENT_BUFFER);
+    return nSize;
+  }
+  wmemcpy(lpFilename, wide.data(), count + 1);
+  return count;
+}
+
+static BOOL FillFindData(FindObject *pFind, LPWIN32_FIND_DATAW lpFindFileData) {
+  errno = 0;
+  struct dirent *pEntry = ::readdir(pFind->dir);
+  if (pEntry == nullptr) {
+    if (errno == 0)
+      SetLastError(ERROR_NO_MORE_FILES);
+    else
+      SetLastErrorFromErrno();
+    return FALSE;
+  }
+  memset(lpFindFileData, 0, sizeof(*lpFindFileData));
+  struct stat st;
+  if (::fstatat(::dirfd(pFind->dir), pEntry->d_name, &st, 0) == 0) {
+    lpFindFileData->dwFileAttributes = GetAttributesFromStat(st);
+    lpFindFileData->ftCreationTime = ToFileTime(ST_CTIM(st));
+    lpFindFileData->ftLastAccessTime = ToFileTime(ST_ATIM(st));
+    lpFindFileData->ftLastWriteTime = ToFileTime(ST_MTIM(st));
+    lpFindFileData->nFileSizeHigh = (DWORD)((uint64_t)st.st_size >> 32);
+    lpFindFileData->nFileSizeLow = (DWORD)st.st_size;
+  } else {
+    lpFindFileData->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+  }
+  if (MultiByteToWideChar(CP_UTF8, 0, pEntry->d_name, -1,
+                          lpFindFileData->cFileName, MAX_PATH) == 0)
+    return FALSE;
+  return TRUE;
+}
+
+HANDLE FindFirstFileW(LPCWSTR lpFileName, LPWIN32_FIND_DATAW lpFindFileData) {
+  std::string pattern;
+  if (!WideToUtf8(lpFileName, pattern))
+    return INVALID_HANDLE_VALUE;
+  // Only whole-directory searches, "dir/*", are supported.
+  if (pattern.empty() || pattern.back() != '*') {
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return INVALID_HANDLE_VALUE;
+  }
+  pattern.pop_back();
+  if (pattern.size() > 1 && (pattern.back() == '/' || pattern.back() == '\\'))
+    pattern.pop_back();
+  if (pattern.empty())
+    pattern = ".";
+
+  DIR *dir = ::opendir(pattern.c_str());
+  if (dir == nullptr) {
+    SetLastErrorFromErrno();
+    return INVALID_HANDLE_VALUE;
+  }
+  FindObject *pFind = new (std::nothrow) FindObject(dir);
+  if (pFind == nullptr) {
+    ::closedir(dir);
+    SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+    return INVALID_HANDLE_VALUE;
+  }
+  if (!FillFindData(pFind, lpFindFileData)) {
+    DWORD error = GetLastError();
+    FindClose(pFind);
+    SetLastError(error == ERROR_NO_MORE_FILES ? ERROR_FILE_NOT_FOUND : error);
+    return INVALID_HANDLE_VALUE;
+  }
+  return pFind;
+}
+
+BOOL FindNextFileW(HANDLE hFindFile, LPWIN32_FIND_DATAW lpFindFileData) {
+  HandleObject *pObject = GetHandleObject(hFindFile);
+  if (pObject == nullptr || pObject->kind != HandleObject::Find) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return FALSE;
+  }
+  return FillFindData(static_cast<FindObject *>(pObject), lpFindFileData);
+}
+
+BOOL FindClose(HANDLE hFindFile) {
+  HandleObject *pObject = GetHandleObject(hFindFile);
+  if (pObject == nullptr || pObject->kind != HandleObject::Find) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return FALSE;
+  }
+  FindObject *pFind = static_cast<FindObject *>(pObject);
+  ::closedir(pFind->dir);
+  delete pFind;
+  return TRUE;
+}
+
+//===----------------------------------------------------------------------===//
+// File mappings.
+
+// munmap needs the length of each view.
+static std::mutex g_ViewsLock;
+static std::map<const void *, size_t> *g_pViews;
+
+HANDLE CreateFileMappingW(HANDLE hFile, void *lpAttributes, DWORD flProtect,
+                          DWORD dwMaximumSizeHigh, DWORD dwMaximumSizeLow,
+                          LPCWSTR lpName) {
+  (void)lpAttributes;
+  (void)dwMaximumSizeHigh;
+  (void)dwMaximumSizeLow;
+  if (lpName != nullptr) {
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return nullptr;
+  }
+  // The mapping holds its own reference to the file.
+  int fd = ::dup(HandleToDescriptor(hFile));
+  if (fd == -1) {
+    SetLastErrorFromErrno();
+    return nullptr;
+  }
+  FileMappingObject *pMapping =
+      new (std::nothrow) FileMappingObject(fd, flProtect);
+  if (pMapping == nullptr) {
+    ::close(fd);
+    SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+    return nullptr;
+  }
+  return pMapping;
+}
+
+LPVOID MapViewOfFile(HANDLE hFileMappingObject, DWORD dwDesiredAccess,
+                     DWORD dwFileOffsetHigh, DWORD dwFileOffsetLow,
+                     SIZE_T dwNumberOfBytesToMap) {
+  HandleObject *pObject = GetHandleObject(hFileMappingObject);
+  if (pObject == nullptr || pObject->kind != HandleObject::FileMapping) {
+    SetLastError(ERROR_INVALID_HANDLE);
+    return nullptr;
+  }
+  FileMappingObject *pMapping = static_cast<FileMappingObject *>(pObject);
+  off_t offset = (off_t)(((uint64_t)dwFileOffsetHigh << 32) | dwFileOffsetLow);
+  size_t length = dwNumberOfBytesToMap;
+  if (length == 0) {
+    // Map to the end of the file.
+    struct stat st;
+    if (::fstat(pMapping->fd, &st) != 0) {
+      SetLastErrorFromErrno();
+      return nullptr;
+    }
+    if (st.st_size <= offset) {
+      SetLastError(ERROR_INVALID_PARAMETER);
+      return nullptr;
+    }
+    length = (size_t)(st.st_size - offset);
+  }
+
+  int prot = PROT_READ;
+  int flags = MAP_SHARED;
+  if (dwDesiredAccess & FILE_MAP_WRITE) {
+    prot |= PROT_WRITE;
+  } else if (dwDesiredAccess & FILE_MAP_COPY) {
+    prot |= PROT_WRITE;
+    flags = MAP_PRIVATE;
+  }
+  void *pView = ::mmap(nullptr, length, prot, flags, pMapping->fd, offset);
+  if (pView == MAP_FAILED) {
+    SetLastErrorFromErrno();
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(g_ViewsLock);
+  if (g_pViews == nullptr)
+    g_pViews = new std::map<const void *, size_t>();
+  (*g_pViews)[pView] = length;
+  return pView;
+}
+
+BOOL UnmapViewOfFile(LPCVOID lpBaseAddress) {
+  size_t length;
+  {
+    std::lock_guard<std::mutex> lock(g_ViewsLock);
+    auto it = g_pViews ? g_pViews->find(lpBaseAddress)
+                       : std::map<const void *, size_t>::iterator();
+    if (g_pViews == nullptr || it == g_pViews->end()) {
+      SetLastError(ERROR_INVALID_PARAMETER);
+      return FALSE;
+    }
+    length = it->second;
+    g_pViews->erase(it);
+  }
+  if (::munmap(const_cast<void *>(lpBaseAddress), length) != 0) {
+    SetLastErrorFromErrno();
+    return FALSE;
+  }
+  return TRUE;
+}
+
+//===----------------------------------------------------------------------===//
+// Threads and the system.
+
+void GetSystemInfo(LPSYSTEM_INFO lpSystemInfo) {
+  long pageSize = ::sysconf(_SC_PAGESIZE);
+  lpSystemInfo->dwPageSize = (DWORD)pageSize;
+  lpSystemInfo->dwAllocationGranularity = (DWORD)pageSize;
+  lpSystemInfo->dwNumberOfProcessors = (DWORD)::sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+void OutputDebugStringA(LPCSTR lpOutputString) {
+  fputs(lpOutputString, stderr);
+}
+
+void OutputDebugStringW(LPCWSTR lpOutputString) {
+  std::string utf8;
+  if (WideToUtf8(lpOutputString, utf8))
+    fputs(utf8.c_str(), stderr);
+}
+
+void InitializeCriticalSection(LPCRITICAL_SECTION lpCriticalSection) {
+  // Critical sections may be entered again by the thread that owns them.
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(lpCriticalSection, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+DWORD TlsAlloc() {
+  pthread_key_t key;
+  if (pthread_key_create(&key, nullptr) != 0) {
+    SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+    return TLS_OUT_OF_INDEXES;
+  }
+  return (DWORD)key + 1;
+}
+
+LPVOID TlsGetValue(DWORD dwTlsIndex) {
+  return pthread_getspecific((pthread_key_t)(dwTlsIndex - 1));
+}
+
+BOOL TlsSetValue(DWORD dwTlsIndex, LPVOID lpTlsValue) {
+  if (pthread_setspecific((pthread_key_t)(dwTlsIndex - 1), lpTlsValue) != 0) {
+    SetLastError(ERROR_INVALID_PARAMETER);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOL TlsFree(DWORD dwTlsIndex) {
+  return pthread_key_delete((pthread_key_t)(dwTlsIndex - 1)) == 0;
+}
+
+//===----------------------------------------------------------------------===//
+// Heaps and modules.
+
+static char g_ProcessHeap;
+
+HANDLE GetProcessHeap() { return &g_ProcessHeap; }
+
+HANDLE HeapCreate(DWORD flOptions, SIZE_T dwInitialSize,
+                  SIZE_T dwMaximumSize) {
+  (void)flOptions;
+  (void)dwInitialSize;
+  (void)dwMaximumSize;
+  return GetProcessHeap();
+}
+
+BOOL HeapDestroy(HANDLE hHeap) {
+  (void)hHeap;
+  return TRUE;
+}
+
+LPVOID HeapAlloc(HANDLE hHeap, DWORD dwFlags, SIZE_T dwBytes) {
+  (void)hHeap;
+  return (dwFlags & HEAP_ZERO_MEMORY) ? calloc(1, dwBytes) : malloc(dwBytes);
+}
+
+LPVOID HeapReAlloc(HANDLE hHeap, DWORD dwFlags, LPVOID lpMem, SIZE_T dwBytes) {
+  (void)hHeap;
+  (void)dwFlags;
+  return realloc(lpMem, dwBytes);
+}
+
+BOOL HeapFree(HANDLE hHeap, DWORD dwFlags, LPVOID lpMem) {
+  (void)hHeap;
+  (void)dwFlags;
+  free(lpMem);
+  return TRUE;
+}
+
+SIZE_T HeapSize(HANDLE hHeap, DWORD dwFlags, LPCVOID lpMem) {
+  (void)hHeap;
+  (void)dwFlags;
+#ifdef __APPLE__
+  return malloc_size(lpMem);
+#else
+  return malloc_usable_size(const_cast<void *>(lpMem));
+#endif
+}
+
+HMODULE LoadLibraryA(LPCSTR lpLibFileName) {
+  HMODULE hModule = ::dlopen(lpLibFileName, RTLD_LAZY | RTLD_LOCAL);
+  if (hModule == nullptr)
+    SetLastError(ERROR_FILE_NOT_FOUND);
+  return hModule;
+}
+
+HMODULE LoadLibraryW(LPCWSTR lpLibFileName) {
+  std::string path;
+  if (!WideToUtf8(lpLibFileName, path))
+    return nullptr;
+  return LoadLibraryA(path.c_str());
+}
+
+BOOL FreeLibrary(HMODULE hModule) { return ::dlclose(hModule) == 0; }
+
+FARPROC GetProcAddress(HMODULE hModule, LPCSTR lpProcName) {
+  FARPROC proc = (FARPROC)::dlsym(hModule, lpProcName);
+  if (proc == nullptr)
+    SetLastError(ERROR_NOT_FOUND);
+  return proc;
+}
+
+#endif // _WIN32
@@ -14,7 +14,11 @@
 #define NOMINMAX
 #include "WindowsSupport.h"
 #include <fcntl.h>
+#ifdef _WIN32
 #include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <system_error>
@@ -211,6 +215,11 @@ namespace path {
   // prefixed by '\\?\'.
   std::error_code widenPath(const Twine &Path8,
     SmallVectorImpl<wchar_t> &Path16) {
+#ifndef _WIN32
+    // There is no limit to work around.
+    SmallString<128> Path8Str;
+    return UTF8ToUTF16(Path8.toStringRef(Path8Str), Path16);
+#else
     const size_t MaxDirLen = MAX_PATH - 12; // Must leave room for 8.3 filename.
 
     // Several operations would convert Path8 to SmallString; more efficient to
@@ -257,6 +266,7 @@ namespace path {
 
     // Just use the caller's original path.
     return UTF8ToUTF16(Path8Str, Path16);
+#endif
   }
 } // end namespace path
 
@@ -436,6 +446,16 @@ error_code rename(const Twine &from, const Twine &to) {
   return ec;
 }
 
+#ifndef _WIN32
+// Unlike CreateFileMapping, mmap doesn't extend the file, so output buffers
+// resize theirs first. Only disk files are mapped for writing.
+std::error_code resize_file(int FD, uint64_t Size) {
+  if (::ftruncate(FD, Size) == -1)
+    return std::error_code(errno, std::generic_category());
+  return std::error_code();
+}
+#endif
+
 error_code resize_file(const Twine &path, uint64_t size) {
   SmallString<128> path_storage;
   SmallVector<wchar_t, 128> path_utf16;
@@ -751,6 +771,17 @@ error_code mapped_file_region::init(int FD, uint64_t Offset, mapmode Mode) {
   }
 
   if (Size == 0) {
+#ifndef _WIN32
+    // The view runs to the end of the file.
+    BY_HANDLE_FILE_INFORMATION Info;
+    if (!fsr->GetFileInformationByHandle(FileHandle, &Info)) {
+      std::error_code ec = mapWindowsError(GetLastError());
+      fsr->UnmapViewOfFile(Mapping);
+      fsr->CloseHandle(FileMappingHandle);
+      return ec;
+    }
+    Size = ((uint64_t(Info.nFileSizeHigh) << 32) | Info.nFileSizeLow) - Offset;
+#else
     MEMORY_BASIC_INFORMATION mbi;
     SIZE_T Result = VirtualQuery(Mapping, &mbi, sizeof(mbi)); // TODO: do we need to plumb through fsr?
     if (Result == 0) {
@@ -760,6 +791,7 @@ error_code mapped_file_region::init(int FD, uint64_t Offset, mapmode Mode) {
       return ec;
     }
     Size = mbi.RegionSize;
+#endif
   }
 
   // Close all the handles except for the view. It will keep the other handles
@@ -818,7 +850,11 @@ error_code detail::directory_iterator_construct(detail::DirIterState &it,
   if (path_utf16.size() > 0 &&
       !is_separator(path_utf16[path.size() - 1]) &&
       path_utf16[path.size() - 1] != L':') {
+#ifdef _WIN32
     path_utf16.push_back(L'\\');
+#else
+    path_utf16.push_back(L'/');
+#endif
     path_utf16.push_back(L'*');
   } else {
     path_utf16.push_back(L'*');
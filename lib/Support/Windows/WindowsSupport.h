@@ -38,8 +38,12 @@
 #include "llvm/Config/config.h" // Get build system configuration settings
 #include "llvm/Support/Compiler.h"
 #include <system_error>
+#ifdef _WIN32 // HLSL Change - also used with the MSFileSystem elsewhere
 #include <windows.h>
 #include <wincrypt.h>
+#else
+#include "dxc/Support/WinIncludes.h"
+#endif
 #include <cassert>
 #include <string>
 #include <vector>
@@ -47,6 +51,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MSFileSystem.h"
 
+#ifdef _WIN32 // HLSL Change
 inline bool MakeErrMsg(std::string* ErrMsg, const std::string& prefix) {
   if (!ErrMsg)
     return true;
@@ -62,6 +67,7 @@ inline bool MakeErrMsg(std::string* ErrMsg, const std::string& prefix) {
   LocalFree(buffer);
   return R != 0;
 }
+#endif // HLSL Change
 
 template <typename HandleTraits>
 class ScopedHandle {
@@ -127,6 +133,7 @@ struct JobHandleTraits : CommonHandleTraits {
   }
 };
 
+#ifdef _WIN32 // HLSL Change
 struct CryptContextTraits : CommonHandleTraits {
   typedef HCRYPTPROV handle_type;
 
@@ -142,6 +149,7 @@ struct CryptContextTraits : CommonHandleTraits {
     return h != GetInvalid();
   }
 };
+#endif // HLSL Change
 
 struct FindHandleTraits : CommonHandleTraits {
   static void Close(handle_type h) {
@@ -153,7 +161,9 @@ struct FileHandleTraits : CommonHandleTraits {};
 
 typedef ScopedHandle<CommonHandleTraits> ScopedCommonHandle;
 typedef ScopedHandle<FileHandleTraits>   ScopedFileHandle;
+#ifdef _WIN32 // HLSL Change
 typedef ScopedHandle<CryptContextTraits> ScopedCryptContext;
+#endif // HLSL Change
 typedef ScopedHandle<FindHandleTraits>   ScopedFindHandle;
 typedef ScopedHandle<JobHandleTraits>    ScopedJobHandle;
 
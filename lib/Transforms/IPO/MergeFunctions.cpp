@@ -103,6 +103,8 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include <vector>
+#include "dxc/HLSL/DxilModule.h" // HLSL Change
+#include "dxc/HLSL/DxilMetadataHelper.h" // HLSL Change
 using namespace llvm;
 
 #define DEBUG_TYPE "mergefunc"
@@ -733,6 +735,14 @@ int FunctionComparator::cmpOperations(const Instruction *L,
                            R->getRawSubclassOptionalData()))
     return Res;
 
+  // HLSL Change Begin - a precise call doesn't have the same behaviour as an
+  // imprecise one.
+  if (int Res = cmpNumbers(
+          (uint64_t)L->getMetadata(hlsl::DxilMDHelper::kDxilPreciseAttributeMDName),
+          (uint64_t)R->getMetadata(hlsl::DxilMDHelper::kDxilPreciseAttributeMDName)))
+    return Res;
+  // HLSL Change End
+
   if (const AllocaInst *AI = dyn_cast<AllocaInst>(L)) {
     if (int Res = cmpTypes(AI->getAllocatedType(),
                            cast<AllocaInst>(R)->getAllocatedType()))
@@ -1088,7 +1098,7 @@ class MergeFunctions : public ModulePass {
 public:
   static char ID;
   MergeFunctions()
-    : ModulePass(ID), HasGlobalAliases(false) {
+    : ModulePass(ID), HasGlobalAliases(false), DM(nullptr) {
     initializeMergeFunctionsPass(*PassRegistry::getPassRegistry());
   }
 
@@ -1145,6 +1155,19 @@ private:
 
   /// Whether or not the target supports global aliases.
   bool HasGlobalAliases;
+
+  // HLSL Change Begin - DXIL function merging.
+  /// The DXIL module, once the module has been lowered to DXIL. DXIL has no
+  /// aliases or bitcasts of functions, and shader entries need their own
+  /// functions for their properties.
+  hlsl::DxilModule *DM;
+
+  /// Whether F may be merged into another function, or another into it.
+  bool isMergeCandidate(Function *F);
+
+  /// Replace the body of G with a call to F, keeping G and its annotations.
+  void writeDxilThunk(Function *F, Function *G);
+  // HLSL Change End
 };
 
 }  // end anonymous namespace
@@ -1228,13 +1251,58 @@ bool MergeFunctions::doSanityCheck(std::vector<WeakVH> &Worklist) {
   return true;
 }
 
+// HLSL Change Begin - DXIL function merging.
+bool MergeFunctions::isMergeCandidate(Function *F) {
+  if (F->isDeclaration() || F->hasAvailableExternallyLinkage())
+    return false;
+  if (!DM)
+    return true;
+  // Weak functions would need double thunks through a new function.
+  if (F->mayBeOverridden())
+    return false;
+  return F != DM->GetEntryFunction() && F != DM->GetPatchConstantFunction() &&
+         !DM->HasDxilFunctionProps(F);
+}
+
+void MergeFunctions::writeDxilThunk(Function *F, Function *G) {
+  // Direct callers of G now call F; their function types are the same.
+  replaceDirectCallers(G, F);
+  if (G->hasLocalLinkage() && G->use_empty()) {
+    G->eraseFromParent();
+    return;
+  }
+
+  GlobalValue::LinkageTypes Linkage = G->getLinkage();
+  removeUsers(G);
+  G->deleteBody();
+  G->setLinkage(Linkage);
+  BasicBlock *BB = BasicBlock::Create(F->getContext(), "", G);
+  IRBuilder<false> Builder(BB);
+  SmallVector<Value *, 16> Args;
+  for (Argument &Arg : G->args())
+    Args.push_back(&Arg);
+  CallInst *CI = Builder.CreateCall(F, Args);
+  CI->setCallingConv(F->getCallingConv());
+  if (G->getReturnType()->isVoidTy())
+    Builder.CreateRetVoid();
+  else
+    Builder.CreateRet(CI);
+
+  DEBUG(dbgs() << "writeDxilThunk: " << G->getName() << '\n');
+  ++NumThunksWritten;
+}
+// HLSL Change End
+
 bool MergeFunctions::runOnModule(Module &M) {
   bool Changed = false;
 
+  // HLSL Change Begin - merge DXIL functions only when it keeps valid DXIL.
+  DM = M.HasDxilModule() ? &M.GetDxilModule() : nullptr;
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
-    if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage())
+    if (isMergeCandidate(I))
       Deferred.push_back(WeakVH(I));
   }
+  // HLSL Change End
 
   do {
     std::vector<WeakVH> Worklist;
@@ -1398,6 +1466,13 @@ void MergeFunctions::writeAlias(Function *F, Function *G) {
 
 // Merge two equivalent functions. Upon completion, Function G is deleted.
 void MergeFunctions::mergeTwoFunctions(Function *F, Function *G) {
+  // HLSL Change Begin - DXIL functions are never weak.
+  if (DM) {
+    writeDxilThunk(F, G);
+    ++NumFunctionsMerged;
+    return;
+  }
+  // HLSL Change End
   if (F->mayBeOverridden()) {
     assert(G->mayBeOverridden());
 
@@ -1457,6 +1532,12 @@ bool MergeFunctions::insert(Function *NewFunction) {
 
   const FunctionNode &OldF = *Result.first;
 
+  // HLSL Change Begin - calls in DXIL can't bitcast the callee, so only
+  // functions of the same type are merged.
+  if (DM && OldF.getFunc()->getFunctionType() != NewFunction->getFunctionType())
+    return false;
+  // HLSL Change End
+
   // Don't merge tiny functions, since it can just end up making the function
   // larger.
   // FIXME: Should still merge them if they are unnamed_addr and produce an
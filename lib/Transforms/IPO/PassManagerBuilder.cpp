@@ -29,9 +29,16 @@
 #include "dxc/HLSL/DxilGenerationPass.h" // HLSL Change
 #include "dxc/HLSL/HLMatrixLowerPass.h" // HLSL Change
 #include "dxc/HLSL/ComputeViewIdState.h" // HLSL Change
+#include "dxc/HLSL/DxilDomTreeCache.h" // HLSL Change
 
 using namespace llvm;
 
+// HLSL Change Begin - DXIL has no vector types outside of a few intrinsic
+// signatures and the validator rejects vector operations (TypesNoVector), so
+// packing 16-bit math into half2 or int16_t2 has to be left to the driver
+// compiler. DxilTTIImpl reports no vector registers, so even with these
+// passes built they would not form vectors.
+// HLSL Change End
 #if HLSL_VECTORIZATION_ENABLED // HLSL Change - don't build vectorization passes
 
 static cl::opt<bool>
@@ -203,13 +210,22 @@ void PassManagerBuilder::populateFunctionPassManager(
 }
 
 // HLSL Change Starts
-static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, legacy::PassManagerBase &MPM) {
+// All passes, including the function passes run for each export of a
+// library, run on one thread. Functions of a module share its LLVMContext,
+// whose uniqued constants, types and metadata aren't thread-safe, and the
+// order values are created in decides the emitted bitcode; running function
+// passes concurrently would need a context per function and a deterministic
+// merge afterwards.
+static void addHLSLPasses(bool HLSLHighLevel, bool HLSLSelectDynamicIndexing, bool HLSLCompactContext, unsigned OptLevel, hlsl::HLSLExtensionsCodegenHelper *ExtHelper, legacy::PassManagerBase &MPM) {
   // Don't do any lowering if we're targeting high-level.
   if (HLSLHighLevel) {
     MPM.add(createHLEmitMetadataPass());
     return;
   }
 
+  // Share dominator trees between the HLSL analyses that follow.
+  MPM.add(createDxilDomTreeCachePass());
+
   MPM.add(createHLPreprocessPass());
   bool NoOpt = OptLevel == 0;
   if (!NoOpt) {
@@ -236,7 +252,8 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, hlsl::HLSLExten
   }
 
   // Change dynamic indexing vector to array.
-  MPM.add(createDynamicIndexingVectorToArrayPass(NoOpt));
+  MPM.add(createDynamicIndexingVectorToArrayPass(
+      NoOpt, !NoOpt && HLSLSelectDynamicIndexing));
 
   if (!NoOpt) {
     MPM.add(createLowerStaticGlobalIntoAlloca());
@@ -256,10 +273,16 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, hlsl::HLSLExten
 
   MPM.add(createDxilLegalizeResourceUsePass());
   MPM.add(createDxilLegalizeStaticResourceUsePass());
+  // Free what the high-level passes left unused before lowering to DXIL.
+  if (HLSLCompactContext)
+    MPM.add(createDxilCompactContextPass());
   MPM.add(createDxilGenerationPass(NoOpt, ExtHelper));
   MPM.add(createDxilLoadMetadataPass()); // Ensure DxilModule is loaded for optimizations.
   // Propagate precise attribute.
   MPM.add(createDxilPrecisePropagatePass());
+  // Let loads from SRVs and cbuffers be CSE'd and hoisted across UAV writes.
+  if (!NoOpt)
+    MPM.add(createDxilMarkReadNoneLoadsPass());
 
   MPM.add(createSimplifyInstPass());
 
@@ -301,7 +324,8 @@ void PassManagerBuilder::populateModulePassManager(
 
     addExtensionsToPM(EP_EnabledOnOptLevel0, MPM);
     // HLSL Change Begins.
-    addHLSLPasses(HLSLHighLevel, OptLevel, HLSLExtensionsCodeGen, MPM);
+    addHLSLPasses(HLSLHighLevel, HLSLSelectDynamicIndexing,
+                  HLSLCompactContext, OptLevel, HLSLExtensionsCodeGen, MPM);
     if (!HLSLHighLevel) {
       MPM.add(createDxilConvergentClearPass());
       MPM.add(createMultiDimArrayToOneDimArrayPass());
@@ -312,6 +336,8 @@ void PassManagerBuilder::populateModulePassManager(
       MPM.add(createDxilDeadFunctionEliminationPass());
       MPM.add(createNoPausePassesPass());
       MPM.add(createDxilEmitMetadataPass());
+      if (HLSLCompactContext)
+        MPM.add(createDxilCompactContextPass());
     }
     // HLSL Change Ends.
     return;
@@ -323,11 +349,23 @@ void PassManagerBuilder::populateModulePassManager(
 
   // HLSL Change Begins
   MPM.add(createAlwaysInlinerPass(/*InsertLifeTime*/false));
+  if (HLSLBottomUpInline) {
+    // Function passes added after the inliner join its call graph SCC pass
+    // manager, so each function is simplified after its callees are inlined
+    // into it and before it is inlined into its callers. InstCombine doesn't
+    // run this early: it rewrites small memcpys and loads as integers, which
+    // the HLSL SROA and lowering passes can't split.
+    MPM.add(createScalarReplAggregatesHLSLPass(/*UseDomTree*/ true,
+                                               /*Promote*/ true));
+    MPM.add(createSimplifyInstPass());
+    MPM.add(createCFGSimplificationPass());
+  }
   if (Inliner) {
     delete Inliner;
     Inliner = nullptr;
   }
-  addHLSLPasses(HLSLHighLevel, OptLevel, HLSLExtensionsCodeGen, MPM); // HLSL Change
+  addHLSLPasses(HLSLHighLevel, HLSLSelectDynamicIndexing, HLSLCompactContext,
+                OptLevel, HLSLExtensionsCodeGen, MPM); // HLSL Change
   // HLSL Change Ends
 
   // Add LibraryInfo if we have some.
@@ -386,6 +424,12 @@ void PassManagerBuilder::populateModulePassManager(
   MPM.add(createLoopRotatePass(SizeLevel == 2 ? 0 : -1));
   MPM.add(createLICMPass());                  // Hoist loop invariants
   //MPM.add(createLoopUnswitchPass(SizeLevel || OptLevel < 3)); // HLSL Change - may move barrier inside divergent if.
+  // HLSL Change Begin - a wave-uniform condition keeps barriers in uniform
+  // control flow.
+  if (HLSLUnswitchUniformLoops)
+    MPM.add(createLoopUnswitchPass(SizeLevel || OptLevel < 3,
+                                   /*UniformOnly*/ true));
+  // HLSL Change End
   MPM.add(createInstructionCombiningPass());
   MPM.add(createIndVarSimplifyPass());        // Canonicalize indvars
   MPM.add(createLoopIdiomPass());             // Recognize idioms like memset.
@@ -577,16 +621,44 @@ void PassManagerBuilder::populateModulePassManager(
   // HLSL Change Begins.
   if (!HLSLHighLevel) {
     MPM.add(createDxilConvergentClearPass());
+    MPM.add(createDxilPackGroupSharedPass(HLSLPadGroupShared));
     MPM.add(createMultiDimArrayToOneDimArrayPass());
     MPM.add(createDxilCondenseResourcesPass());
+    MPM.add(createDxilHoistHandlesPass());
+    MPM.add(createDxilCoalesceCBufferLoadsPass());
+    MPM.add(createDxilCombineBufferAccessesPass());
+    MPM.add(createDxilEliminateRedundantBarriersPass());
+    // Expand trig intrinsics with the shorter approximations chosen by
+    // -fp-speed; at the precise tier drivers expand them.
+    if (HLSLFPSpeed)
+      MPM.add(createDxilExpandTrigIntrinsicsPass(HLSLFPSpeed));
     MPM.add(createDeadCodeEliminationPass());
+    if (HLSLDemotePrecision)
+      MPM.add(createDxilDemotePrecisionPass());
+    MPM.add(createDxilRematerializePass());
     if (DisableUnrollLoops)
       MPM.add(createDxilLegalizeSampleOffsetPass());
+    if (HLSLGatherPointSamples)
+      MPM.add(createDxilFormGatherPass());
+    if (HLSLWaveAggregateAtomics)
+      MPM.add(createDxilWaveAggregateAtomicsPass());
+    if (HLSLAutoFlatten)
+      MPM.add(createDxilAutoFlattenPass());
+    if (HLSLUniformBranchHints)
+      MPM.add(createDxilUniformBranchHintsPass());
+    if (HLSLAutoEarlyDepthStencil)
+      MPM.add(createDxilPromoteEarlyDepthStencilPass());
     MPM.add(createDxilFinalizeModulePass());
+    // Fold library functions that are identical after lowering. Shaders
+    // have nothing to merge, as all but the entry is inlined.
+    MPM.add(createMergeFunctionsPass());
     MPM.add(createComputeViewIdStatePass());
     MPM.add(createDxilDeadFunctionEliminationPass());
     MPM.add(createNoPausePassesPass());
     MPM.add(createDxilEmitMetadataPass());
+    // Free what's left unused before the module is written.
+    if (HLSLCompactContext)
+      MPM.add(createDxilCompactContextPass());
   }
   // HLSL Change Ends.
   addExtensionsToPM(EP_OptimizerLast, MPM);
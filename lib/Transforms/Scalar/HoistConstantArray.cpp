@@ -24,13 +24,13 @@
 // We limit hoisting to those arrays that are initialized by constant values.
 // We still hoist if the array is partially initialized as long as no
 // non-constant values are written. The uninitialized values will be hoisted 
-// as undef values.
+// as undef values. Values loaded at constant indices from internal constant
+// globals, such as elements copied from a static const array, count as
+// constants too.
 //
-// Improvements:
-// Currently we do not merge arrays that have the same constant values. We
-// create the global variables with `unnamed_addr` set which means they
-// can be merged with other constants. We should probably use a separate
-// pass to merge all the unnamed_addr constants.
+// Arrays with the same constant values share one global, and an existing
+// internal constant global with the same values is used instead of a new one,
+// so that each table takes up a single immediate constant buffer.
 //
 // Example:
 //
@@ -73,6 +73,8 @@
 
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Instruction.h"
@@ -107,6 +109,9 @@ namespace {
     std::vector<AllocaInst *> findCandidateAllocas(Function &F);
     void hoistArray(const CandidateArray &candidate);
     void removeLocalArrayStores(const CandidateArray &candidate);
+
+    // Constant globals by initializer, for sharing one global per table.
+    DenseMap<Constant *, GlobalVariable *> m_GlobalArrays;
  };
 
   // Represents an array we are considering for hoisting.
@@ -117,6 +122,7 @@ namespace {
     explicit CandidateArray(AllocaInst *);
     bool IsConstArray() const { return m_IsConstArray; }
     void AnalyzeUses();
+    Constant *GetInitializer() const;
     GlobalVariable *GetGlobalArray() const;
     AllocaInst *GetLocalArray() const { return m_Alloca; }
     std::vector<StoreInst*> GetArrayStores() const;
@@ -175,11 +181,17 @@ CandidateArray::CandidateArray(AllocaInst *AI)
   m_ArrayType = getAllocaArrayType(AI);
 }
 
-// Get the global variable with a constant initializer for the array.
+// Get the constant initializer for the array.
 // Only valid to call if the array has been analyzed as a constant array.
-GlobalVariable *CandidateArray::GetGlobalArray() const {
+Constant *CandidateArray::GetInitializer() const {
   assert(IsConstArray());
-  Constant *initializer = ConstantArray::get(m_ArrayType, m_Values);
+  return ConstantArray::get(m_ArrayType, m_Values);
+}
+
+// Create a global variable with a constant initializer for the array.
+// Only valid to call if the array has been analyzed as a constant array.
+GlobalVariable *CandidateArray::GetGlobalArray() const {
+  Constant *initializer = GetInitializer();
   Module *M = m_Alloca->getModule();
   GlobalVariable *GV = new GlobalVariable(*M, m_ArrayType, true, GlobalVariable::LinkageTypes::InternalLinkage, initializer, Twine(m_Alloca->getName()) + ".hca");
   GV->setUnnamedAddr(true);
@@ -268,10 +280,49 @@ void CandidateArray::AnalyzeUses() {
   m_IsConstArray = true;
 }
 
+// Returns a constant expression for a pointer into an internal constant
+// global that is computed with constant indices, or nullptr. Only globals
+// with local linkage are considered; the constant globals left over for
+// cbuffer variables don't hold the values the shader will see.
+static Constant *getConstantGlobalPointer(Value *ptr) {
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(ptr))
+    return GV->isConstant() && GV->hasLocalLinkage() ? GV : nullptr;
+
+  GEPOperator *gep = dyn_cast<GEPOperator>(ptr);
+  if (!gep || !gep->hasAllConstantIndices())
+    return nullptr;
+  Constant *base = getConstantGlobalPointer(gep->getPointerOperand());
+  if (!base)
+    return nullptr;
+  SmallVector<Constant *, 4> indices;
+  for (auto I = gep->idx_begin(), E = gep->idx_end(); I != E; ++I)
+    indices.push_back(cast<Constant>(*I));
+  return ConstantExpr::getGetElementPtr(gep->getSourceElementType(), base,
+                                        indices, gep->isInBounds());
+}
+
+// Get the constant value written by a store, or nullptr if it is not
+// constant. A load from an internal constant global at a constant index
+// reads a known value.
+static Constant *getStoredConstant(StoreInst *SI) {
+  Value *value = SI->getValueOperand();
+  if (Constant *C = dyn_cast<Constant>(value))
+    return C;
+
+  LoadInst *LI = dyn_cast<LoadInst>(value);
+  if (!LI || LI->isVolatile())
+    return nullptr;
+  Constant *ptr = getConstantGlobalPointer(LI->getPointerOperand());
+  if (!ptr)
+    return nullptr;
+  return ConstantFoldLoadFromConstPtr(ptr, SI->getModule()->getDataLayout());
+}
+
 // Analyze a store to see if it is a valid constant store.
 // A valid store will write a constant value to a known (constant) location.
 bool CandidateArray::AnalyzeStore(StoreInst *SI) {
-  if (!isa<Constant>(SI->getValueOperand()))
+  Constant *value = getStoredConstant(SI);
+  if (!value)
     return false;
   // Walk up the ladder of GetElementPtr instructions to accumulate the index
   int64_t index = 0;
@@ -300,7 +351,7 @@ bool CandidateArray::AnalyzeStore(StoreInst *SI) {
     iter = gep->getPointerOperand();
   }
 
-  return StoreConstant(index, cast<Constant>(SI->getValueOperand()));
+  return StoreConstant(index, value);
 }
 
 // Check if the store is valid and record the value if so.
@@ -363,7 +414,9 @@ void HoistConstantArray::hoistArray(const CandidateArray &candidate) {
 
   removeLocalArrayStores(candidate);
   AllocaInst *local = candidate.GetLocalArray();
-  GlobalVariable *global = candidate.GetGlobalArray();
+  GlobalVariable *&global = m_GlobalArrays[candidate.GetInitializer()];
+  if (!global)
+    global = candidate.GetGlobalArray();
   local->replaceAllUsesWith(global);
   local->eraseFromParent();
 }
@@ -389,6 +442,16 @@ char HoistConstantArray::ID = 0;
 INITIALIZE_PASS(HoistConstantArray, "hlsl-hca", "Hoist constant arrays", false, false)
 
 bool HoistConstantArray::runOnModule(Module &M) {
+  // Start from the internal constant arrays already in the module.
+  m_GlobalArrays.clear();
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.isConstant() && GV.hasLocalLinkage() &&
+        GV.hasDefinitiveInitializer() &&
+        GV.getType()->getAddressSpace() == 0 &&
+        isa<ArrayType>(GV.getValueType()))
+      m_GlobalArrays.insert(std::make_pair(GV.getInitializer(), &GV));
+  }
+
   bool changed = false;
   for (Function &F : M) {
     if (F.isDeclaration())
@@ -76,6 +76,12 @@ static cl::opt<unsigned>
 PragmaUnrollThreshold("pragma-unroll-threshold", cl::init(16 * 1024), cl::Hidden,
   cl::desc("Unrolled size limit for loops with an unroll(full) or "
            "unroll_count pragma."));
+
+static cl::opt<unsigned>
+UnrollInstructionBudget("unroll-instruction-budget", cl::init(256 * 1024),
+  cl::Hidden,
+  cl::desc("Don't unroll loops in functions that would grow past this many "
+           "instructions."));
 #else
 template <typename T>
 struct NullOpt {
@@ -94,6 +100,9 @@ static const NullOpt<unsigned> UnrollCount = 0;
 static const NullOpt<bool> UnrollAllowPartial = false;
 static const NullOpt<bool> UnrollRuntime = false;
 static const NullOpt<unsigned> PragmaUnrollThreshold = 16 * 1024;
+// The size estimates above don't bound what unrolled nests of [unroll] loops
+// grow to; the passes after unrolling take time and memory in proportion.
+static const NullOpt<unsigned> UnrollInstructionBudget = 256 * 1024;
 #endif // HLSL Change Ends
 
 namespace {
@@ -717,6 +726,15 @@ bool LoopUnroll::canUnrollCompletely(Loop *L, unsigned Threshold,
   return false;
 }
 
+// HLSL Change Begin - unroll budget and report.
+static uint64_t CountInstructions(const Function &F) {
+  uint64_t Count = 0;
+  for (const BasicBlock &BB : F)
+    Count += BB.size();
+  return Count;
+}
+// HLSL Change End
+
 unsigned LoopUnroll::selectUnrollCount(
     const Loop *L, unsigned TripCount, bool PragmaFullUnroll,
     unsigned PragmaCount, const TargetTransformInfo::UnrollingPreferences &UP,
@@ -933,10 +951,44 @@ bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     return false;
   }
 
+  // HLSL Change Begin - keep the function within the instruction budget.
+  DebugLoc LoopLoc = L->getStartLoc();
+  uint64_t LoopInsts = 0;
+  for (BasicBlock *BB : L->blocks())
+    LoopInsts += BB->size();
+  uint64_t FnInsts = CountInstructions(F);
+  uint64_t GrownInsts = FnInsts + LoopInsts * (Count - 1);
+  if (GrownInsts > UnrollInstructionBudget) {
+    // Heuristic unrolling gives up quietly; an unroll pragma was asked for.
+    if (HasPragma)
+      F.getContext().diagnose(DiagnosticInfoOptimizationFailure(
+          F, LoopLoc,
+          Twine("loop not unrolled: unrolling it ") + Twine(Count) +
+              " times would grow '" + F.getName() + "' to about " +
+              Twine(GrownInsts) + " instructions, over the budget of " +
+              Twine((unsigned)UnrollInstructionBudget)));
+    return false;
+  }
+  // HLSL Change End
+
   // Unroll the loop.
   if (!UnrollLoop(L, Count, TripCount, AllowRuntime, UP.AllowExpensiveTripCount,
                   TripMultiple, LI, this, &LPM, &AC))
     return false;
 
+  // HLSL Change Begin - report the growth for -unroll-report.
+  std::string Report;
+  raw_string_ostream ReportOS(Report);
+  if (TripCount)
+    ReportOS << "unrolled loop with trip count " << TripCount;
+  else
+    ReportOS << "unrolled loop with a runtime trip count";
+  ReportOS << " by a factor of " << Count << "; '" << F.getName()
+           << "' grew from " << FnInsts << " to " << CountInstructions(F)
+           << " instructions";
+  emitOptimizationRemark(F.getContext(), "loop-unroll-report", F, LoopLoc,
+                         ReportOS.str());
+  // HLSL Change End
+
   return true;
 }
@@ -32,6 +32,7 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/CodeMetrics.h"
+#include "llvm/Analysis/DivergenceAnalysis.h" // HLSL Change
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/LoopPass.h"
@@ -74,6 +75,11 @@ Threshold("loop-unswitch-threshold", cl::desc("Max loop size to unswitch"),
 static const unsigned Threshold = 100;
 #endif
 
+// HLSL Change Begin - a uniform condition removes a branch from every
+// iteration of every lane of the wave, which is worth more code.
+static const unsigned UniformThreshold = 400;
+// HLSL Change End
+
 namespace {
 
   class LUAnalysisCache {
@@ -116,9 +122,10 @@ namespace {
     unsigned MaxSize;
 
   public:
-    LUAnalysisCache()
+    // HLSL Change - take the threshold.
+    explicit LUAnalysisCache(unsigned MaxSize)
         : CurLoopInstructions(nullptr), CurrentLoopProperties(nullptr),
-          MaxSize(Threshold) {}
+          MaxSize(MaxSize) {}
 
     // Analyze loop. Check its size, calculate is it possible to unswitch
     // it. Returns true if we can unswitch this loop.
@@ -160,6 +167,10 @@ namespace {
 
     bool OptimizeForSize;
     bool redoLoop;
+    // HLSL Change Begin - unswitch only wave-uniform conditions.
+    bool UniformOnly;
+    DivergenceAnalysis *DA;
+    // HLSL Change End
 
     Loop *currentLoop;
     DominatorTree *DT;
@@ -175,10 +186,11 @@ namespace {
 
   public:
     static char ID; // Pass ID, replacement for typeid
-    explicit LoopUnswitch(bool Os = false) :
-      LoopPass(ID), OptimizeForSize(Os), redoLoop(false),
-      currentLoop(nullptr), DT(nullptr), loopHeader(nullptr),
-      loopPreheader(nullptr) {
+    explicit LoopUnswitch(bool Os = false, bool UniformOnly = false) :
+      LoopPass(ID), BranchesInfo(UniformOnly ? UniformThreshold : Threshold),
+      OptimizeForSize(Os), redoLoop(false), UniformOnly(UniformOnly),
+      DA(nullptr), currentLoop(nullptr), DT(nullptr), loopHeader(nullptr),
+      loopPreheader(nullptr) { // HLSL Change - UniformOnly
         initializeLoopUnswitchPass(*PassRegistry::getPassRegistry());
       }
 
@@ -199,6 +211,8 @@ namespace {
       AU.addPreserved<DominatorTreeWrapperPass>();
       AU.addPreserved<ScalarEvolution>();
       AU.addRequired<TargetTransformInfoWrapperPass>();
+      if (UniformOnly) // HLSL Change
+        AU.addRequired<DivergenceAnalysis>();
     }
 
   private:
@@ -232,6 +246,11 @@ namespace {
                                         Instruction *InsertPt,
                                         TerminatorInst *TI);
 
+    // HLSL Change Begin
+    bool IsUnswitchableCondition(Value *LoopCond) const;
+    bool HasBarrier(Loop *L) const;
+    // HLSL Change End
+
     void SimplifyCode(std::vector<Instruction*> &Worklist, Loop *L);
     bool IsTrivialUnswitchCondition(Value *Cond, Constant **Val = nullptr,
                                     BasicBlock **LoopExit = nullptr);
@@ -364,12 +383,36 @@ INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
 INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_DEPENDENCY(DivergenceAnalysis) // HLSL Change
 INITIALIZE_PASS_END(LoopUnswitch, "loop-unswitch", "Unswitch loops",
                       false, false)
 
-Pass *llvm::createLoopUnswitchPass(bool Os) {
-  return new LoopUnswitch(Os);
+Pass *llvm::createLoopUnswitchPass(bool Os, bool UniformOnly) {
+  return new LoopUnswitch(Os, UniformOnly); // HLSL Change - UniformOnly
+}
+
+// HLSL Change Begin
+// With UniformOnly, a condition must be the same in every lane of the wave:
+// unswitching a divergent one would run each lane's iterations in a
+// different loop, and any barrier in the loop under divergent control flow.
+bool LoopUnswitch::IsUnswitchableCondition(Value *LoopCond) const {
+  return !UniformOnly || DA->isUniform(LoopCond);
+}
+
+// A condition uniform across the wave may still differ between the waves of
+// a thread group, so loops with a group barrier are left alone.
+bool LoopUnswitch::HasBarrier(Loop *L) const {
+  for (BasicBlock *BB : L->blocks()) {
+    for (Instruction &I : *BB) {
+      CallInst *CI = dyn_cast<CallInst>(&I);
+      if (CI && CI->getCalledFunction() &&
+          CI->getCalledFunction()->getName().startswith("dx.op.barrier"))
+        return true;
+    }
+  }
+  return false;
 }
+// HLSL Change End
 
 /// FindLIVLoopCondition - Cond is a condition that occurs in L.  If it is
 /// invariant in the loop, or has an invariant piece, return the invariant.
@@ -420,6 +463,16 @@ bool LoopUnswitch::runOnLoop(Loop *L, LPPassManager &LPM_Ref) {
   DT = DTWP ? &DTWP->getDomTree() : nullptr;
   currentLoop = L;
   Function *F = currentLoop->getHeader()->getParent();
+  // HLSL Change Begin - without the DXIL cost model nothing is known to be
+  // uniform.
+  if (UniformOnly) {
+    if (!getAnalysis<TargetTransformInfoWrapperPass>().getTTI(*F)
+             .hasBranchDivergence() ||
+        HasBarrier(L))
+      return false;
+    DA = &getAnalysis<DivergenceAnalysis>();
+  }
+  // HLSL Change End
   bool Changed = false;
   do {
     assert(currentLoop->isLCSSAForm(*DT));
@@ -478,7 +531,7 @@ bool LoopUnswitch::processCurrentLoop() {
         // unswitch on it if we desire.
         Value *LoopCond = FindLIVLoopCondition(BI->getCondition(),
                                                currentLoop, Changed);
-        if (LoopCond &&
+        if (LoopCond && IsUnswitchableCondition(LoopCond) && // HLSL Change
             UnswitchIfProfitable(LoopCond, ConstantInt::getTrue(Context), TI)) {
           ++NumBranches;
           return true;
@@ -488,7 +541,8 @@ bool LoopUnswitch::processCurrentLoop() {
       Value *LoopCond = FindLIVLoopCondition(SI->getCondition(),
                                              currentLoop, Changed);
       unsigned NumCases = SI->getNumCases();
-      if (LoopCond && NumCases) {
+      if (LoopCond && NumCases &&
+          IsUnswitchableCondition(LoopCond)) { // HLSL Change
         // Find a value to unswitch on:
         // FIXME: this should chose the most expensive case!
         // FIXME: scan for a case with a non-critical edge?
@@ -522,8 +576,9 @@ bool LoopUnswitch::processCurrentLoop() {
       if (SelectInst *SI = dyn_cast<SelectInst>(BBI)) {
         Value *LoopCond = FindLIVLoopCondition(SI->getCondition(),
                                                currentLoop, Changed);
-        if (LoopCond && UnswitchIfProfitable(LoopCond,
-                                             ConstantInt::getTrue(Context))) {
+        if (LoopCond && IsUnswitchableCondition(LoopCond) && // HLSL Change
+            UnswitchIfProfitable(LoopCond,
+                                 ConstantInt::getTrue(Context))) {
           ++NumSelects;
           return true;
         }
@@ -38,6 +38,8 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Cancellation.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
@@ -69,6 +71,16 @@ STATISTIC(NumReplaced, "Number of allocas broken up");
 STATISTIC(NumPromoted, "Number of allocas promoted");
 STATISTIC(NumAdjusted, "Number of scalar allocas adjusted to allow promotion");
 STATISTIC(NumConverted, "Number of aggregates converted to scalar");
+STATISTIC(NumLargeArraysKept, "Number of large arrays left intact");
+STATISTIC(NumVectorsSelected,
+          "Number of dynamically indexed vectors lowered to selects");
+STATISTIC(NumVectorsToArray,
+          "Number of dynamically indexed vectors lowered to arrays");
+
+static cl::opt<unsigned> SROAArrayElementLimit(
+    "sroa-hlsl-array-element-limit", cl::init(1024), cl::Hidden,
+    cl::desc("Arrays of scalars with more elements than this are not split "
+             "into one alloca per element (0 means no limit)"));
 
 namespace {
 
@@ -1512,6 +1524,21 @@ bool SROA_HLSL::performPromotion(Function &F) {
   return Changed;
 }
 
+/// IsLargeScalarArray - Check if T is a (possibly multi-dimensional) array of
+/// scalars with more elements than SROAArrayElementLimit.
+static bool IsLargeScalarArray(ArrayType *AT) {
+  if (SROAArrayElementLimit == 0)
+    return false;
+  uint64_t NumElts = 1;
+  Type *EltTy = AT;
+  while (ArrayType *EltAT = dyn_cast<ArrayType>(EltTy)) {
+    NumElts *= EltAT->getNumElements();
+    EltTy = EltAT->getElementType();
+  }
+  return (EltTy->isIntegerTy() || EltTy->isFloatingPointTy()) &&
+         NumElts > SROAArrayElementLimit;
+}
+
 /// ShouldAttemptScalarRepl - Decide if an alloca is a good candidate for
 /// SROA.  It must be a struct or array type with a small number of elements.
 bool SROA_HLSL::ShouldAttemptScalarRepl(AllocaInst *AI) {
@@ -1519,9 +1546,16 @@ bool SROA_HLSL::ShouldAttemptScalarRepl(AllocaInst *AI) {
   // promote every struct.
   if (StructType *ST = dyn_cast<StructType>(T))
     return true;
-  // promote every array.
-  if (ArrayType *AT = dyn_cast<ArrayType>(T))
+  // promote every array, except large arrays of scalars. Splitting those
+  // creates an alloca and a GEP per element, and DXIL can keep them as
+  // indexable arrays.
+  if (ArrayType *AT = dyn_cast<ArrayType>(T)) {
+    if (IsLargeScalarArray(AT)) {
+      ++NumLargeArraysKept;
+      return false;
+    }
     return true;
+  }
   return false;
 }
 
@@ -1564,6 +1598,7 @@ bool SROA_HLSL::performScalarRepl(Function &F, DxilTypeSystem &typeSys) {
   // Process the worklist
   bool Changed = false;
   while (!WorkList.empty()) {
+    pollThreadCancellation();
     AllocaInst *AI = WorkList.top();
     WorkList.pop();
 
@@ -2239,6 +2274,32 @@ static bool IsMemCpyTy(Type *Ty, DxilTypeSystem &typeSys) {
   return true;
 }
 
+// Types that only differ in name, which flat conversions between user structs
+// copy with a memcpy. Matrices and objects are only the same as themselves.
+static bool IsSameLayoutTy(Type *DestTy, Type *SrcTy) {
+  if (DestTy == SrcTy)
+    return true;
+  if (HLMatrixLower::IsMatrixType(DestTy) ||
+      HLMatrixLower::IsMatrixType(SrcTy) ||
+      HLModule::IsHLSLObjectType(DestTy) || HLModule::IsHLSLObjectType(SrcTy))
+    return false;
+  if (ArrayType *DestAT = dyn_cast<ArrayType>(DestTy)) {
+    ArrayType *SrcAT = dyn_cast<ArrayType>(SrcTy);
+    return SrcAT && DestAT->getNumElements() == SrcAT->getNumElements() &&
+           IsSameLayoutTy(DestAT->getElementType(), SrcAT->getElementType());
+  }
+  StructType *DestST = dyn_cast<StructType>(DestTy);
+  StructType *SrcST = dyn_cast<StructType>(SrcTy);
+  if (!DestST || !SrcST || DestST->getNumElements() != SrcST->getNumElements() ||
+      DestST->isPacked() != SrcST->isPacked())
+    return false;
+  for (unsigned i = 0; i < DestST->getNumElements(); ++i) {
+    if (!IsSameLayoutTy(DestST->getElementType(i), SrcST->getElementType(i)))
+      return false;
+  }
+  return true;
+}
+
 // Split copy into ld/st.
 static void SplitCpy(Type *Ty, Value *Dest, Value *Src,
                      SmallVector<Value *, 16> &idxList, IRBuilder<> &Builder,
@@ -2554,7 +2615,11 @@ void MemcpySplitter::SplitMemCpy(MemCpyInst *MI, const DataLayout &DL,
 
   // Allow copy between different address space.
   if (DestTy != SrcTy) {
-    return;
+    if (!IsSameLayoutTy(DestTy, SrcTy))
+      return;
+    // Split with the destination type; the source has the same layout.
+    Src = Builder.CreateBitCast(
+        Src, PointerType::get(DestTy, Src->getType()->getPointerAddressSpace()));
   }
 
   llvm::SmallVector<llvm::Value *, 16> idxList;
@@ -4162,6 +4227,7 @@ public:
 
     // Process the worklist
     while (!WorkList.empty()) {
+      checkThreadCancellation();
       Function *F = WorkList.front();
       WorkList.pop_front();
       createFlattenedFunction(F);
@@ -6195,6 +6261,7 @@ void SROA_Parameter_HLSL::createFlattenedFunction(Function *F) {
     std::unique_ptr<DxilFunctionProps> flatFuncProps = std::make_unique<DxilFunctionProps>();
     flatFuncProps->shaderKind = funcProps.shaderKind;
     flatFuncProps->ShaderProps = funcProps.ShaderProps;
+    flatFuncProps->waveSize = funcProps.waveSize;
     m_pHLModule->AddDxilFunctionProps(flatF, flatFuncProps);
     if (funcProps.shaderKind == ShaderModel::Kind::Vertex) {
       auto &VS = funcProps.ShaderProps.VS;
@@ -6725,9 +6792,14 @@ bool LowerTypePass::runOnModule(Module &M) {
 namespace {
 class DynamicIndexingVectorToArray : public LowerTypePass {
   bool ReplaceAllVectors;
+  // Read and write dynamically indexed local vectors with a compare and
+  // select per element instead of through an indexable array.
+  bool SelectDynamicIndexing;
 public:
-  explicit DynamicIndexingVectorToArray(bool ReplaceAll = false)
-      : LowerTypePass(ID), ReplaceAllVectors(ReplaceAll) {}
+  explicit DynamicIndexingVectorToArray(bool ReplaceAll = false,
+                                        bool SelectIndexing = false)
+      : LowerTypePass(ID), ReplaceAllVectors(ReplaceAll),
+        SelectDynamicIndexing(SelectIndexing) {}
   static char ID; // Pass identification, replacement for typeid
   void applyOptions(PassOptions O) override;
   void dumpConfig(raw_ostream &OS) override;
@@ -6740,6 +6812,7 @@ protected:
 
 private:
   bool HasVectorDynamicIndexing(Value *V);
+  bool ReplaceDynamicIndexingWithSelect(Value *V);
   void ReplaceVecGEP(Value *GEP, ArrayRef<Value *> idxList, Value *A,
                      IRBuilder<> &Builder);
   void ReplaceVecArrayGEP(Value *GEP, ArrayRef<Value *> idxList, Value *A,
@@ -6752,10 +6825,93 @@ private:
 void DynamicIndexingVectorToArray::applyOptions(PassOptions O) {
   GetPassOptionBool(O, "ReplaceAllVectors", &ReplaceAllVectors,
                     ReplaceAllVectors);
+  GetPassOptionBool(O, "SelectDynamicIndexing", &SelectDynamicIndexing,
+                    SelectDynamicIndexing);
 }
 void DynamicIndexingVectorToArray::dumpConfig(raw_ostream &OS) {
   ModulePass::dumpConfig(OS);
   OS << ",ReplaceAllVectors=" << ReplaceAllVectors;
+  OS << ",SelectDynamicIndexing=" << SelectDynamicIndexing;
+}
+
+static bool IsLoadOrStoreThrough(User *U, Value *Ptr) {
+  if (isa<LoadInst>(U))
+    return true;
+  if (StoreInst *SI = dyn_cast<StoreInst>(U))
+    return SI->getPointerOperand() == Ptr;
+  return false;
+}
+
+bool DynamicIndexingVectorToArray::ReplaceDynamicIndexingWithSelect(Value *V) {
+  // Every element access must be a load or store through an element GEP.
+  for (User *U : V->users()) {
+    if (IsLoadOrStoreThrough(U, V))
+      continue;
+    GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(U);
+    if (!GEP || GEP->getNumOperands() != 3)
+      return false;
+    for (User *GEPU : GEP->users()) {
+      if (!IsLoadOrStoreThrough(GEPU, GEP))
+        return false;
+    }
+  }
+
+  unsigned size = V->getType()->getPointerElementType()->getVectorNumElements();
+  for (auto U = V->user_begin(), E = V->user_end(); U != E;) {
+    GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(*(U++));
+    if (!GEP)
+      continue;
+    Value *Idx = GEP->getOperand(2);
+    if (isa<ConstantInt>(Idx))
+      continue;
+
+    for (auto GEPU = GEP->user_begin(), GEPE = GEP->user_end();
+         GEPU != GEPE;) {
+      Instruction *GEPUser = cast<Instruction>(*(GEPU++));
+      IRBuilder<> Builder(GEPUser);
+      Value *vec = Builder.CreateLoad(V);
+      if (LoadInst *ldInst = dyn_cast<LoadInst>(GEPUser)) {
+        // Change
+        //    ld a[i]
+        // into
+        //    b = ld a
+        //    select(i == n-1, b[n-1], ... select(i == 1, b[1], b[0]))
+        Value *Elt = Builder.CreateExtractElement(vec, (uint64_t)0);
+        for (unsigned i = 1; i < size; i++) {
+          Value *IsI = Builder.CreateICmpEQ(
+              Idx, ConstantInt::get(Idx->getType(), i));
+          Elt = Builder.CreateSelect(
+              IsI, Builder.CreateExtractElement(vec, (uint64_t)i), Elt);
+        }
+        ldInst->replaceAllUsesWith(Elt);
+        ldInst->eraseFromParent();
+      } else {
+        // Change
+        //    st val, a[i]
+        // into
+        //    b = ld a
+        //    b.x = select(i == 0, val, b.x), ...
+        //    st b, a
+        StoreInst *stInst = cast<StoreInst>(GEPUser);
+        Value *val = stInst->getValueOperand();
+        Value *newVec = vec;
+        for (unsigned i = 0; i < size; i++) {
+          Value *IsI = Builder.CreateICmpEQ(
+              Idx, ConstantInt::get(Idx->getType(), i));
+          Value *Elt = Builder.CreateSelect(
+              IsI, val, Builder.CreateExtractElement(vec, (uint64_t)i));
+          newVec = Builder.CreateInsertElement(newVec, Elt, (uint64_t)i);
+        }
+        Builder.CreateStore(newVec, V);
+        stInst->eraseFromParent();
+      }
+    }
+    GEP->eraseFromParent();
+  }
+
+  // The remaining element accesses have constant indices.
+  ReplaceStaticIndexingOnVector(V);
+  return true;
 }
 
 void DynamicIndexingVectorToArray::ReplaceStaticIndexingOnVector(Value *V) {
@@ -6823,6 +6979,13 @@ bool DynamicIndexingVectorToArray::needToLower(Value *V) {
     }
     // Don't lower local vector which only static indexing.
     if (HasVectorDynamicIndexing(V)) {
+      if (SelectDynamicIndexing && ReplaceDynamicIndexingWithSelect(V)) {
+        ++NumVectorsSelected;
+        return false;
+      }
+      DEBUG(dbgs() << "Dynamically indexed vector lowered to array: " << *V
+                   << '\n');
+      ++NumVectorsToArray;
       return true;
     } else {
       // Change vector indexing with ld st.
@@ -7003,8 +7166,9 @@ INITIALIZE_PASS(DynamicIndexingVectorToArray, "dynamic-vector-to-array",
   false)
 
 // Public interface to the DynamicIndexingVectorToArray pass
-ModulePass *llvm::createDynamicIndexingVectorToArrayPass(bool ReplaceAllVector) {
-  return new DynamicIndexingVectorToArray(ReplaceAllVector);
+ModulePass *llvm::createDynamicIndexingVectorToArrayPass(bool ReplaceAllVector,
+                                                        bool SelectIndexing) {
+  return new DynamicIndexingVectorToArray(ReplaceAllVector, SelectIndexing);
 }
 
 //===----------------------------------------------------------------------===//
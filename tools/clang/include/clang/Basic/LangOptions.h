@@ -151,11 +151,13 @@ public:
   // HLSL Change Starts
   unsigned HLSLVersion;  // Only supported for IntelliSense scenarios.
   std::string HLSLEntryFunction;
+  std::vector<std::string> HLSLBatchEntryFunctions; // Other entries generated from this TU.
   std::string HLSLProfile;
   unsigned RootSigMajor;
   unsigned RootSigMinor;
   bool IsHLSLLibrary;
   bool UseMinPrecision; // use min precision, not native precision.
+  bool HLSLDeferFunctionBodies = false; // only parse referenced bodies.
   // HLSL Change Ends
 
   bool SPIRV = false;  // SPIRV Change
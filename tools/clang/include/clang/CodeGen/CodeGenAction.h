@@ -11,7 +11,11 @@
 #define LLVM_CLANG_CODEGEN_CODEGENACTION_H
 
 #include "clang/Frontend/FrontendAction.h"
+#include "llvm/ADT/ArrayRef.h" // HLSL Change
+#include "llvm/ADT/SmallVector.h" // HLSL Change
 #include <memory>
+#include <string> // HLSL Change
+#include <vector> // HLSL Change
 
 namespace llvm {
   class LLVMContext;
@@ -20,6 +24,7 @@ namespace llvm {
 
 namespace clang {
 class BackendConsumer;
+class BatchBackendConsumer; // HLSL Change
 
 class CodeGenAction : public ASTFrontendAction {
 private:
@@ -104,6 +109,39 @@ class EmitOptDumpAction : public CodeGenAction {
 public:
   EmitOptDumpAction(llvm::LLVMContext *_VMContext = nullptr);
 };
+
+/// Generates one bitcode module per entry point from a single parse of the
+/// translation unit. Each entry point uses a copy of the compiler's
+/// CodeGenOptions with its own entry function and profile; Sema runs once,
+/// with the entry function and profile of the first entry.
+class EmitBCBatchAction : public ASTFrontendAction {
+public:
+  struct EntryResult {
+    std::string EntryFunction;
+    std::string Profile;
+    llvm::SmallVector<char, 0> Bitcode; // Output of the backend pipeline.
+    std::unique_ptr<llvm::Module> Module;
+    bool HasErrors = false; // Errors reported while generating this entry.
+  };
+
+private:
+  llvm::LLVMContext *VMContext;
+  std::vector<EntryResult> Results;
+  BatchBackendConsumer *Consumer;
+
+protected:
+  std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
+                                                 StringRef InFile) override;
+  void EndSourceFileAction() override;
+
+public:
+  EmitBCBatchAction(llvm::LLVMContext *_VMContext,
+                    llvm::ArrayRef<std::string> EntryFunctions,
+                    llvm::ArrayRef<std::string> Profiles);
+  ~EmitBCBatchAction() override;
+
+  std::vector<EntryResult> &getResults() { return Results; }
+};
 // HLSL Change Ends
 
 }
@@ -16,6 +16,7 @@
 
 #include "clang/Basic/Sanitizers.h"
 #include "llvm/Support/Regex.h"
+#include <map> // HLSL Change
 #include <memory>
 #include <string>
 #include <vector>
@@ -186,6 +187,43 @@ public:
   bool HLSLAvoidControlFlow = false;
   /// Force [flatten] on every if.
   bool HLSLAllResourcesBound = false;
+  /// Store DXIL type annotations as binary records.
+  bool HLSLCompactTypeAnnotations = false;
+  /// Shrink constant-indexed resource arrays to the indices used.
+  bool HLSLTrimResourceRanges = false;
+  /// Mark wave-uniform branches with dx.uniform.branch metadata.
+  bool HLSLUniformBranchHints = false;
+  /// Flatten cheap divergent branches without control flow attributes.
+  bool HLSLAutoFlatten = false;
+  /// Unswitch loops on wave-uniform conditions.
+  bool HLSLUnswitchUniformLoops = false;
+  /// Combine wave-uniform atomic adds into one atomic per wave.
+  bool HLSLWaveAggregateAtomics = false;
+  /// Force early depth-stencil for pixel shaders it can't affect.
+  bool HLSLAutoEarlyDepthStencil = false;
+  /// Replace point samples of 2x2 texel blocks with gathers.
+  bool HLSLGatherPointSamples = false;
+  /// Free unused constants between pipeline stages.
+  bool HLSLCompactContext = false;
+  /// Compute float math feeding unorm targets in half where it is safe.
+  bool HLSLDemotePrecision = false;
+  /// Index small local vectors with selects instead of indexable arrays.
+  bool HLSLSelectDynamicIndexing = false;
+  /// Pad groupshared 2D arrays to avoid bank conflicts on column access.
+  bool HLSLPadGroupShared = false;
+  /// Place [specializable] constants in $Globals, with their defaults listed
+  /// in dx.specializable.
+  bool HLSLSpecializable = false;
+  /// Simplify each function before it is inlined into its callers.
+  bool HLSLBottomUpInline = false;
+  /// Free Sema and the AST context after IR generation, before the module is
+  /// optimized; the source manager stays alive for backend diagnostics.
+  bool HLSLFreeASTEarly = false;
+  /// Drop the names of local values and blocks while generating IR.
+  bool HLSLDiscardValueNames = false;
+  /// Optimizer options, as -Odump prints them, that replace the default
+  /// optimization pipeline.
+  std::vector<std::string> HLSLOptimizerPipeline;
   /// Major version of validator to run.
   unsigned HLSLValidatorMajorVer = 0;
   /// Minor version of validator to run.
@@ -194,10 +232,19 @@ public:
   std::vector<std::string> HLSLDefines;
   /// Arguments passed in from command line
   std::vector<std::string> HLSLArguments;
+  /// Path prefixes replaced in the file names recorded in debug information.
+  std::map<std::string, std::string> DebugPrefixMap;
+  /// Warn about absolute paths left in debug information, which keep the
+  /// output from being identical across machines.
+  bool HLSLReproducible = false;
   /// Helper for generating llvm bitcode for hlsl extensions.
   std::shared_ptr<hlsl::HLSLExtensionsCodegenHelper> HLSLExtensionsCodegen;
   /// Signature packing mode (0 == default for target)
   unsigned HLSLSignaturePackingStrategy = 0;
+  /// Accuracy of transcendental math (0 == precise)
+  unsigned HLSLFPSpeed = 0;
+  /// Wave size to specialize the shader for (0 == any)
+  unsigned HLSLWaveSize = 0;
   /// denormalized number mode ("ieee" for default)
   hlsl::DXIL::Float32DenormMode HLSLFloat32DenormMode;
   // HLSL Change Ends
@@ -242,6 +289,11 @@ public:
 #include "clang/Frontend/CodeGenOptions.def"
 
   CodeGenOptions();
+
+  // HLSL Change Begin
+  /// Returns Path with its longest prefix in DebugPrefixMap replaced.
+  std::string remapDebugPath(StringRef Path) const;
+  // HLSL Change End
 };
 
 }  // end namespace clang
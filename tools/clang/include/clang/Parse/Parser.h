@@ -238,6 +238,17 @@ class Parser : public CodeCompletionHandler {
 
   bool SkipFunctionBodies;
 
+  // HLSL Change Starts
+  /// Function bodies whose parsing waits until the function is referenced.
+  struct HLSLDeferredFunctionBody {
+    FunctionDecl *FD;
+    CachedTokens Toks;
+    bool Parsed;
+  };
+  std::vector<std::unique_ptr<HLSLDeferredFunctionBody>>
+      HLSLDeferredFunctionBodies;
+  // HLSL Change Ends
+
 public:
   Parser(Preprocessor &PP, Sema &Actions, bool SkipFunctionBodies);
   ~Parser() override;
@@ -1177,6 +1188,10 @@ private:
   void ParseLateTemplatedFuncDef(LateParsedTemplate &LPT);
 
   static void LateTemplateParserCallback(void *P, LateParsedTemplate &LPT);
+  // HLSL Change Starts
+  bool CanDeferHLSLFunctionBody(Declarator &D);
+  void ParseHLSLDeferredFunctionBodies();
+  // HLSL Change Ends
   static void LateTemplateParserCleanupCallback(void *P);
 
   Sema::ParsingClassState
@@ -148,6 +148,11 @@ public:
   // target <result-id>.
   std::vector<uint32_t> withTargetId(uint32_t targetId) const;
 
+  // \brief Appends the SPIR-V words for this decoration with the given target
+  // <result-id> to words.
+  void appendWithTargetId(uint32_t targetId,
+                          std::vector<uint32_t> *words) const;
+
 private:
   /// \brief prevent public APIs from creating Decoration objects.
   Decoration(spv::Decoration dec_id, llvm::ArrayRef<uint32_t> arg = {},
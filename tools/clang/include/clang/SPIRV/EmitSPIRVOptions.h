@@ -39,16 +39,28 @@ struct EmitSPIRVOptions {
   bool enable16BitTypes;
   bool enableReflect;
   bool enableDebugInfo;
+  bool optimizeSize;
+  /// Decorate values of min precision types with RelaxedPrecision
+  bool relaxedPrecision;
   llvm::StringRef stageIoOrder;
+  /// Largest cbuffer, in bytes, to turn into a push constant block when no
+  /// block is one already; 0 to keep all cbuffers as uniform buffers.
+  uint32_t autoPushConstantSize;
   llvm::SmallVector<int32_t, 4> bShift;
   llvm::SmallVector<int32_t, 4> tShift;
   llvm::SmallVector<int32_t, 4> sShift;
   llvm::SmallVector<int32_t, 4> uShift;
   llvm::SmallVector<llvm::StringRef, 4> allowedExtensions;
+  /// Entry points to emit in the module besides the entry function of the
+  /// compile. They share the target profile.
+  llvm::SmallVector<llvm::StringRef, 1> entryPoints;
   llvm::StringRef targetEnv;
   spirv::LayoutRule cBufferLayoutRule;
   spirv::LayoutRule tBufferLayoutRule;
   spirv::LayoutRule sBufferLayoutRule;
+  /// Receives the reflection sidecar laid out in dxc/Support/SpirvReflection.h
+  /// if not null.
+  std::string *reflectionSidecar;
 
   // Initializes dependent fields appropriately
   void Initialize();
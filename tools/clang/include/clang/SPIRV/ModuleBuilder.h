@@ -22,6 +22,10 @@
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
 
+namespace llvm {
+class raw_ostream;
+}
+
 namespace clang {
 namespace spirv {
 
@@ -32,7 +36,7 @@ namespace spirv {
 /// but there can exist multiple basic blocks under construction.
 ///
 /// Call `takeModule()` to get the SPIR-V words after finishing building the
-/// module.
+/// module, or `takeModule(out)` to write them to a stream.
 class ModuleBuilder {
 public:
   /// \brief Constructs a ModuleBuilder with the given SPIR-V context.
@@ -45,6 +49,11 @@ public:
   /// module under construction.
   std::vector<uint32_t> takeModule();
 
+  /// \brief Writes the SPIR-V module under building to the given stream one
+  /// instruction at a time, without assembling the words of the whole module
+  /// first. This will consume the module under construction.
+  void takeModule(llvm::raw_ostream &out);
+
   // === Function and Basic Block ===
 
   /// \brief Begins building a SPIR-V function. Returns the <result-id> for the
@@ -487,7 +496,7 @@ private:
   /// It can be used to contruct instructions on the fly.
   /// The constructed instruction will appear in constructSite.
   InstBuilder instBuilder;
-  std::vector<uint32_t> constructSite; ///< InstBuilder construction site.
+  Instruction constructSite; ///< InstBuilder construction site.
   uint32_t glslExtSetId; ///< The <result-id> of GLSL extended instruction set.
 };
 
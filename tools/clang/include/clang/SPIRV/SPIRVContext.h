@@ -15,6 +15,8 @@
 #include "clang/SPIRV/Constant.h"
 #include "clang/SPIRV/Decoration.h"
 #include "clang/SPIRV/Type.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Allocator.h"
 
 namespace clang {
 namespace spirv {
@@ -27,8 +29,15 @@ struct TypeHash {
 };
 struct DecorationHash {
   std::size_t operator()(const Decoration &d) const {
-    // TODO: We could probably improve this hash function if needed.
-    return std::hash<uint32_t>{}(static_cast<uint32_t>(d.getValue()));
+    // Every stage variable and struct member gets a Location, BuiltIn or
+    // Offset decoration of its own, so the arguments and member index must
+    // be hashed to keep these from sharing a bucket.
+    const auto &args = d.getArgs();
+    const auto memberIndex = d.getMemberIndex();
+    return llvm::hash_combine(
+        static_cast<uint32_t>(d.getValue()),
+        memberIndex.hasValue() ? memberIndex.getValue() + 1 : 0u,
+        llvm::hash_combine_range(args.begin(), args.end()));
   }
 };
 struct ConstantHash {
@@ -79,6 +88,13 @@ public:
   /// context, and returns the unique Decoration pointer.
   const Decoration *registerDecoration(const Decoration &);
 
+  /// \brief Copies the given SPIR-V words into storage owned by this context
+  /// and returns the copy. The storage is released with the context.
+  llvm::ArrayRef<uint32_t> allocateWords(llvm::ArrayRef<uint32_t> words);
+
+  /// \brief Returns the number of words copied by allocateWords() so far.
+  inline size_t getAllocatedWordCount() const;
+
 private:
   using TypeSet = std::unordered_set<Type, TypeHash>;
   using ConstantSet = std::unordered_set<Constant, ConstantHash>;
@@ -105,11 +121,19 @@ private:
   /// that constant. If a Constant* does not exist in the map, the constant
   /// is not yet defined and is not associated with a <result-id>.
   std::unordered_map<const Constant *, uint32_t> constantResultIdMap;
+
+  /// \brief Storage for the words of the instructions built in this context,
+  /// so that they don't each need a heap allocation.
+  llvm::BumpPtrAllocator wordAllocator;
+  size_t allocatedWordCount;
 };
 
-SPIRVContext::SPIRVContext() : nextId(1) {}
+SPIRVContext::SPIRVContext() : nextId(1), allocatedWordCount(0) {}
 uint32_t SPIRVContext::getNextId() const { return nextId; }
 uint32_t SPIRVContext::takeNextId() { return nextId++; }
+size_t SPIRVContext::getAllocatedWordCount() const {
+  return allocatedWordCount;
+}
 
 } // end namespace spirv
 } // end namespace clang
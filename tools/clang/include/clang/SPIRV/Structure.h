@@ -38,21 +38,31 @@
 namespace clang {
 namespace spirv {
 
+class SPIRVContext;
+
 // === Instruction definition ===
 
 /// \brief The class representing a SPIR-V instruction.
 class Instruction {
 public:
+  /// Constructs an empty instruction.
+  inline Instruction();
+
   /// Constructs an instruction from the given underlying SPIR-V binary words.
   inline Instruction(std::vector<uint32_t> &&);
 
+  /// Constructs an instruction from a copy of the given SPIR-V binary words,
+  /// allocated in the given context. The instruction must not outlive the
+  /// context.
+  Instruction(SPIRVContext *, llvm::ArrayRef<uint32_t>);
+
   // Copy constructor/assignment
   Instruction(const Instruction &) = default;
   Instruction &operator=(const Instruction &) = default;
 
   // Move constructor/assignment
-  Instruction(Instruction &&) = default;
-  Instruction &operator=(Instruction &&) = default;
+  inline Instruction(Instruction &&);
+  inline Instruction &operator=(Instruction &&);
 
   /// Returns true if this instruction is empty, which contains no underlying
   /// SPIR-V binary words.
@@ -64,7 +74,13 @@ public:
 
   /// Returns the underlying SPIR-v binary words for this instruction.
   /// This instruction will be in an empty state after this call.
-  inline std::vector<uint32_t> take();
+  std::vector<uint32_t> take();
+
+  /// Feeds the underlying SPIR-V binary words for this instruction to the
+  /// given consumer. Words allocated in a context are passed through scratch,
+  /// which keeps its storage as long as the consumer doesn't take it.
+  /// This instruction will be in an empty state after this call.
+  void take(const WordConsumer &consumer, std::vector<uint32_t> *scratch);
 
   /// Returns true if this instruction is a termination instruction.
   ///
@@ -73,8 +89,12 @@ public:
   bool isTerminator() const;
 
 private:
-  // TODO: do some statistics and switch to use SmallVector here if helps.
-  std::vector<uint32_t> words; ///< Underlying SPIR-V words
+  /// Returns the underlying SPIR-V words, wherever they are stored.
+  inline llvm::ArrayRef<uint32_t> getWords() const;
+
+  std::vector<uint32_t> words;  ///< SPIR-V words owned by this instruction
+  const uint32_t *contextWords; ///< SPIR-V words owned by a SPIRVContext
+  uint32_t contextWordCount;    ///< Number of words at contextWords
 };
 
 // === Basic block definition ===
@@ -360,12 +380,40 @@ private:
 
 // === Instruction inline implementations ===
 
+Instruction::Instruction() : contextWords(nullptr), contextWordCount(0) {}
+
 Instruction::Instruction(std::vector<uint32_t> &&data)
-    : words(std::move(data)) {}
+    : words(std::move(data)), contextWords(nullptr), contextWordCount(0) {}
+
+Instruction::Instruction(Instruction &&that)
+    : words(std::move(that.words)), contextWords(that.contextWords),
+      contextWordCount(that.contextWordCount) {
+  that.words.clear();
+  that.contextWords = nullptr;
+  that.contextWordCount = 0;
+}
+
+Instruction &Instruction::operator=(Instruction &&that) {
+  if (this != &that) {
+    words = std::move(that.words);
+    contextWords = that.contextWords;
+    contextWordCount = that.contextWordCount;
+    that.words.clear();
+    that.contextWords = nullptr;
+    that.contextWordCount = 0;
+  }
+  return *this;
+}
 
-bool Instruction::isEmpty() const { return words.empty(); }
+bool Instruction::isEmpty() const {
+  return words.empty() && contextWordCount == 0;
+}
 
-std::vector<uint32_t> Instruction::take() { return std::move(words); }
+llvm::ArrayRef<uint32_t> Instruction::getWords() const {
+  if (contextWords)
+    return llvm::ArrayRef<uint32_t>(contextWords, contextWordCount);
+  return words;
+}
 
 // === Basic block inline implementations ===
 
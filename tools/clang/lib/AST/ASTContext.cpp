@@ -39,6 +39,7 @@
 #include "llvm/Support/Capacity.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm> // HLSL Change
 #include <map>
 
 using namespace clang;
@@ -8463,8 +8464,13 @@ bool ASTContext::DeclMustBeEmitted(const Decl *D) {
       return false;
     // HLSL Change Starts
     // Don't just return true because of visibility, unless building a library
-    return FD->getName() == getLangOpts().HLSLEntryFunction ||
-           IsPatchConstantFunctionDecl(FD) || getLangOpts().IsHLSLLibrary;
+    if (FD->getName() == getLangOpts().HLSLEntryFunction ||
+        IsPatchConstantFunctionDecl(FD) || getLangOpts().IsHLSLLibrary)
+      return true;
+    const std::vector<std::string> &BatchEntries =
+        getLangOpts().HLSLBatchEntryFunctions;
+    return std::find(BatchEntries.begin(), BatchEntries.end(),
+                     FD->getName()) != BatchEntries.end();
     // HLSL Change Ends
   }
   
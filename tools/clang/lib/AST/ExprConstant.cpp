@@ -2042,6 +2042,9 @@ static bool evaluateVarDeclInit(EvalInfo &Info, const Expr *E,
   if (VD->hasExternalFormalLinkage() &&
       !isa<EnumConstantDecl>(VD))
     return false;
+  // Specializable constants may be given another value after compilation.
+  if (VD->hasAttr<HLSLSpecializableAttr>())
+    return false;
   // HLSL Change End.
 
   // Check that we can fold the initializer. In C++, we will have already done
@@ -43,6 +43,7 @@
 #include <memory>
 #include "dxc/HLSL/DxilGenerationPass.h" // HLSL Change
 #include "dxc/HLSL/HLMatrixLowerPass.h"  // HLSL Change
+#include "dxc/HLSL/DxcTimeReport.h"      // HLSL Change
 
 using namespace clang;
 using namespace llvm;
@@ -75,7 +76,7 @@ private:
     if (TM)
       return TM->getTargetIRAnalysis();
 
-    return TargetIRAnalysis();
+    return createDxilTargetIRAnalysis(); // HLSL Change
   }
 
   legacy::PassManager *getCodeGenPasses() const {
@@ -320,6 +321,18 @@ void EmitAssemblyHelper::CreatePasses() {
   PMBuilder.SLPVectorize = CodeGenOpts.VectorizeSLP;
   PMBuilder.LoopVectorize = CodeGenOpts.VectorizeLoop;
   PMBuilder.HLSLHighLevel = CodeGenOpts.HLSLHighLevel; // HLSL Change
+  PMBuilder.HLSLUniformBranchHints = CodeGenOpts.HLSLUniformBranchHints; // HLSL Change
+  PMBuilder.HLSLAutoFlatten = CodeGenOpts.HLSLAutoFlatten; // HLSL Change
+  PMBuilder.HLSLUnswitchUniformLoops = CodeGenOpts.HLSLUnswitchUniformLoops; // HLSL Change
+  PMBuilder.HLSLWaveAggregateAtomics = CodeGenOpts.HLSLWaveAggregateAtomics; // HLSL Change
+  PMBuilder.HLSLDemotePrecision = CodeGenOpts.HLSLDemotePrecision; // HLSL Change
+  PMBuilder.HLSLAutoEarlyDepthStencil = CodeGenOpts.HLSLAutoEarlyDepthStencil; // HLSL Change
+  PMBuilder.HLSLGatherPointSamples = CodeGenOpts.HLSLGatherPointSamples; // HLSL Change
+  PMBuilder.HLSLCompactContext = CodeGenOpts.HLSLCompactContext; // HLSL Change
+  PMBuilder.HLSLFPSpeed = CodeGenOpts.HLSLFPSpeed; // HLSL Change
+  PMBuilder.HLSLSelectDynamicIndexing = CodeGenOpts.HLSLSelectDynamicIndexing; // HLSL Change
+  PMBuilder.HLSLPadGroupShared = CodeGenOpts.HLSLPadGroupShared; // HLSL Change
+  PMBuilder.HLSLBottomUpInline = CodeGenOpts.HLSLBottomUpInline; // HLSL Change
   PMBuilder.HLSLExtensionsCodeGen = CodeGenOpts.HLSLExtensionsCodegen.get(); // HLSL Change
 
   PMBuilder.DisableUnitAtATime = !CodeGenOpts.UnitAtATime;
@@ -427,6 +440,19 @@ void EmitAssemblyHelper::CreatePasses() {
   legacy::FunctionPassManager *FPM = getPerFunctionPasses();
   if (CodeGenOpts.VerifyModule)
     FPM->add(createVerifierPass());
+  // HLSL Change Begin - a pipeline from -opt-pipeline replaces the default.
+  if (!CodeGenOpts.HLSLOptimizerPipeline.empty() && !CodeGenOpts.HLSLHighLevel) {
+    std::string InvalidOption;
+    if (!hlsl::AddOptimizerPipelinePasses(CodeGenOpts.HLSLOptimizerPipeline,
+                                          *FPM, *getPerModulePasses(),
+                                          InvalidOption)) {
+      unsigned DiagID = Diags.getCustomDiagID(
+          DiagnosticsEngine::Error, "invalid optimizer pipeline option '%0'");
+      Diags.Report(DiagID) << InvalidOption;
+    }
+    return;
+  }
+  // HLSL Change End
   PMBuilder.populateFunctionPassManager(*FPM);
 
   // Set up the per-module pass manager.
@@ -703,6 +729,8 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
   // Run passes. For now we do all passes at once, but eventually we
   // would like to have the option of streaming code generation.
 
+  hlsl::TimeReportPhase OptimizerPhase("optimizer"); // HLSL Change
+
   if (PerFunctionPasses) {
     PrettyStackTraceString CrashInfo("Per-function optimization");
 
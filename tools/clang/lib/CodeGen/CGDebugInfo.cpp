@@ -259,8 +259,11 @@ llvm::DIFile *CGDebugInfo::getOrCreateFile(SourceLocation Loc) {
       return cast<llvm::DIFile>(V);
   }
 
+  // HLSL Change - apply -fdebug-prefix-map
+  const CodeGenOptions &CGO = CGM.getCodeGenOpts();
   llvm::DIFile *F =
-      DBuilder.createFile(PLoc.getFilename(), getCurrentDirname());
+      DBuilder.createFile(CGO.remapDebugPath(PLoc.getFilename()),
+                          CGO.remapDebugPath(getCurrentDirname()));
 
   DIFileCache[fname].reset(F);
   return F;
@@ -332,7 +335,8 @@ void CGDebugInfo::CreateCompileUnit() {
   }
 
   // Save filename string.
-  StringRef Filename = internString(MainFileName);
+  StringRef Filename = internString(
+      CGM.getCodeGenOpts().remapDebugPath(MainFileName)); // HLSL Change
 
   // Save split dwarf file string.
   std::string SplitDwarfFile = CGM.getCodeGenOpts().SplitDwarfFile;
@@ -363,7 +367,10 @@ void CGDebugInfo::CreateCompileUnit() {
   // Create new compile unit.
   // FIXME - Eliminate TheCU.
   TheCU = DBuilder.createCompileUnit(
-      LangTag, Filename, getCurrentDirname(), Producer, LO.Optimize,
+      LangTag, Filename,
+      internString(CGM.getCodeGenOpts().remapDebugPath(
+          getCurrentDirname())), // HLSL Change
+      Producer, LO.Optimize,
       CGM.getCodeGenOpts().DwarfDebugFlags, RuntimeVers, SplitDwarfFilename,
       DebugKind <= CodeGenOptions::DebugLineTablesOnly
           ? llvm::DIBuilder::LineTablesOnly
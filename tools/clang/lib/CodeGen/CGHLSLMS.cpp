@@ -44,6 +44,7 @@
 #include "dxc/dxcapi.h"                 // stream support
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
 #include "dxc/HLSL/DxilGenerationPass.h" // support pause/resume passes
+#include "dxc/HLSL/DxcTimeReport.h"
 
 using namespace clang;
 using namespace CodeGen;
@@ -106,7 +107,9 @@ private:
   HLCBuffer &GetGlobalCBuffer() {
     return *static_cast<HLCBuffer*>(&(m_pHLModule->GetCBuffer(globalCBIndex)));
   }
-  void AddConstant(VarDecl *constDecl, HLCBuffer &CB);
+  void AddConstant(VarDecl *constDecl, HLCBuffer &CB,
+                   bool bSpecializable = false);
+  void AddSpecializableConstant(VarDecl *constDecl);
   uint32_t AddSampler(VarDecl *samplerDecl);
   uint32_t AddUAVSRV(VarDecl *decl, hlsl::DxilResourceBase::Class resClass);
   bool SetUAVSRV(SourceLocation loc, hlsl::DxilResourceBase::Class resClass,
@@ -310,6 +313,20 @@ void clang::CompileRootSignature(
   llvm::raw_string_ostream OS(OSStr);
   hlsl::DxilVersionedRootSignatureDesc *D = nullptr;
 
+  // Root signatures shared by many shaders are only parsed, serialized and
+  // verified once.
+  CComPtr<IDxcBlob> pCached;
+  if (hlsl::FindCompiledRootSignature(rootSigStr.data(),
+                                      (uint32_t)rootSigStr.size(), rootSigVer,
+                                      &pCached)) {
+    const hlsl::DxilVersionedRootSignatureDesc *pCachedDesc = nullptr;
+    hlsl::DeserializeRootSignature(pCached->GetBufferPointer(),
+                                   (uint32_t)pCached->GetBufferSize(),
+                                   &pCachedDesc);
+    pRootSigHandle->Assign(pCachedDesc, pCached);
+    return;
+  }
+
   if (ParseHLSLRootSignature(rootSigStr.data(), rootSigStr.size(), rootSigVer,
                              &D, SLoc, Diags)) {
     CComPtr<IDxcBlob> pSignature;
@@ -321,6 +338,9 @@ void clang::CompileRootSignature(
                              pErrors->GetBufferSize());
       hlsl::DeleteRootSignature(D);
     } else {
+      hlsl::AddCompiledRootSignature(rootSigStr.data(),
+                                     (uint32_t)rootSigStr.size(), rootSigVer,
+                                     pSignature);
       pRootSigHandle->Assign(D, pSignature);
     }
   }
@@ -372,6 +392,10 @@ CGMSHLSLRuntime::CGMSHLSLRuntime(CodeGenModule &CGM)
   opts.bLegacyCBufferLoad = !CGM.getCodeGenOpts().HLSLNotUseLegacyCBufLoad;
   opts.bAllResourcesBound = CGM.getCodeGenOpts().HLSLAllResourcesBound;
   opts.PackingStrategy = CGM.getCodeGenOpts().HLSLSignaturePackingStrategy;
+  opts.bCompactTypeAnnotations =
+      CGM.getCodeGenOpts().HLSLCompactTypeAnnotations;
+  opts.bTrimResourceRanges = CGM.getCodeGenOpts().HLSLTrimResourceRanges;
+  opts.FPSpeed = CGM.getCodeGenOpts().HLSLFPSpeed;
 
   opts.bUseMinPrecision = CGM.getLangOpts().UseMinPrecision;
 
@@ -379,7 +403,8 @@ CGMSHLSLRuntime::CGMSHLSLRuntime(CodeGenModule &CGM)
 
   m_pHLModule->SetValidatorVersion(CGM.getCodeGenOpts().HLSLValidatorMajorVer, CGM.getCodeGenOpts().HLSLValidatorMinorVer);
 
-  m_bDebugInfo = CGM.getCodeGenOpts().getDebugInfo() == CodeGenOptions::FullDebugInfo;
+  // Line tables need locations too.
+  m_bDebugInfo = CGM.getCodeGenOpts().getDebugInfo() != CodeGenOptions::NoDebugInfo;
 
   // set profile
   m_pHLModule->SetShaderModel(SM);
@@ -1421,6 +1446,8 @@ void CGMSHLSLRuntime::AddHLSLFunctionInfo(Function *F, const FunctionDecl *FD) {
   // TODO: check this in front-end and report error.
   DXASSERT(profileAttributes < 2, "profile attributes are mutual exclusive");
 
+  funcProps->waveSize = CGM.getCodeGenOpts().HLSLWaveSize;
+
   if (isEntry) {
     switch (funcProps->shaderKind) {
     case ShaderModel::Kind::Compute:
@@ -1900,6 +1927,12 @@ void CGMSHLSLRuntime::addResource(Decl *D) {
     // skip decl has init which is resource.
     if (VD->hasInit() && resClass != DXIL::ResourceClass::Invalid)
       return;
+    // Specializable constants are read from $Globals when asked for.
+    if (VD->hasAttr<HLSLSpecializableAttr>() &&
+        CGM.getCodeGenOpts().HLSLSpecializable) {
+      AddSpecializableConstant(VD);
+      return;
+    }
     // skip static global.
     if (!VD->hasExternalFormalLinkage()) {
       if (VD->hasInit() && VD->getType().isConstQualified()) {
@@ -2391,8 +2424,9 @@ static bool IsResourceInType(const clang::ASTContext &context,
   return false; // no resources found
 }
 
-void CGMSHLSLRuntime::AddConstant(VarDecl *constDecl, HLCBuffer &CB) {
-  if (constDecl->getStorageClass() == SC_Static) {
+void CGMSHLSLRuntime::AddConstant(VarDecl *constDecl, HLCBuffer &CB,
+                                  bool bSpecializable) {
+  if (constDecl->getStorageClass() == SC_Static && !bSpecializable) {
     // For static inside cbuffer, take as global static.
     // Don't add to cbuffer.
     CGM.EmitGlobal(constDecl);
@@ -2496,6 +2530,29 @@ void CGMSHLSLRuntime::AddConstant(VarDecl *constDecl, HLCBuffer &CB) {
   m_ConstVarAnnotationMap[constVal] = fieldAnnotation;
 }
 
+// A specializable constant is read from $Globals instead of being folded, so
+// IDxcSpecializer can replace its loads later. Its default is listed in
+// dx.specializable for the constants the specializer isn't given.
+void CGMSHLSLRuntime::AddSpecializableConstant(VarDecl *constDecl) {
+  llvm::Constant *defaultVal = CGM.EmitConstantInit(*constDecl);
+  if (!defaultVal) {
+    DiagnosticsEngine &Diags = CGM.getDiags();
+    unsigned DiagID = Diags.getCustomDiagID(
+        DiagnosticsEngine::Error,
+        "specializable constant must have a constant initializer.");
+    Diags.Report(constDecl->getLocation(), DiagID);
+    return;
+  }
+  AddConstant(constDecl, GetGlobalCBuffer(), /*bSpecializable*/ true);
+
+  LLVMContext &Ctx = TheModule.getContext();
+  Metadata *MDs[] = {MDString::get(Ctx, constDecl->getName()),
+                     ConstantAsMetadata::get(defaultVal)};
+  NamedMDNode *pSpecMD = TheModule.getOrInsertNamedMetadata(
+      DxilMDHelper::kDxilSpecializableMDName);
+  pSpecMD->addOperand(MDNode::get(Ctx, MDs));
+}
+
 uint32_t CGMSHLSLRuntime::AddCBuffer(HLSLBufferDecl *D) {
   unique_ptr<HLCBuffer> CB = llvm::make_unique<HLCBuffer>();
 
@@ -4221,6 +4278,7 @@ void CGMSHLSLRuntime::SetPatchConstantFunctionWithAttr(
 }
 
 void CGMSHLSLRuntime::FinishCodeGen() {
+  TimeReportPhase FinishPhase("hlsl-finish-codegen");
   // Library don't have entry.
   if (!m_bIsLib) {
     SetEntryFunction();
@@ -5291,8 +5349,81 @@ static Constant *BuildConstInitializer(QualType Type, unsigned &offset,
   }
 }
 
+template <typename T>
+static Constant *GetConstDataArray(LLVMContext &Ctx, ArrayRef<uint64_t> Bits,
+                                   bool bFP) {
+  SmallVector<T, 16> Elts(Bits.begin(), Bits.end());
+  return bFP ? ConstantDataArray::getFP(Ctx, Elts)
+             : ConstantDataArray::get(Ctx, Elts);
+}
+
+// Lookup tables are arrays with one initializer per element. Build those
+// straight from the initializers instead of flattening and rebuilding them.
+// Scalar elements go into a ConstantDataArray; vector elements are emitted
+// whole. Returns nullptr for anything else.
+static Constant *EmitConstArrayInitList(CodeGenModule &CGM, InitListExpr *E) {
+  ASTContext &Ctx = CGM.getContext();
+  const ConstantArrayType *AT = Ctx.getAsConstantArrayType(E->getType());
+  if (!AT || AT->getSize() != E->getNumInits())
+    return nullptr;
+  QualType EltTy = Ctx.getCanonicalType(AT->getElementType()).getUnqualifiedType();
+  bool bVector = hlsl::IsHLSLVecType(EltTy);
+  if (!bVector && !EltTy->isArithmeticType())
+    return nullptr;
+  llvm::Type *Ty = CGM.getTypes().ConvertType(EltTy);
+  if (!bVector && !ConstantDataSequential::isElementTypeCompatible(Ty))
+    return nullptr;
+
+  unsigned NumInits = E->getNumInits();
+  SmallVector<Constant *, 16> Vectors;
+  SmallVector<uint64_t, 16> Bits;
+  if (bVector)
+    Vectors.reserve(NumInits);
+  else
+    Bits.reserve(NumInits);
+  for (unsigned i = 0; i != NumInits; ++i) {
+    Expr *init = E->getInit(i);
+    if (!Ctx.hasSameUnqualifiedType(init->getType(), EltTy))
+      return nullptr;
+    Constant *C = CGM.EmitConstantExpr(init, EltTy);
+    if (!C || C->getType() != Ty)
+      return nullptr;
+    if (bVector) {
+      Vectors.emplace_back(C);
+    } else if (ConstantInt *CI = dyn_cast<ConstantInt>(C)) {
+      Bits.emplace_back(CI->getZExtValue());
+    } else if (ConstantFP *CF = dyn_cast<ConstantFP>(C)) {
+      Bits.emplace_back(CF->getValueAPF().bitcastToAPInt().getZExtValue());
+    } else {
+      return nullptr;
+    }
+  }
+
+  if (bVector)
+    return llvm::ConstantArray::get(llvm::ArrayType::get(Ty, NumInits),
+                                    Vectors);
+  LLVMContext &LLVMCtx = Ty->getContext();
+  bool bFP = Ty->isFloatingPointTy();
+  switch (Ty->getPrimitiveSizeInBits()) {
+  case 8:
+    // i8 has no floating point counterpart.
+    return GetConstDataArray<uint8_t>(LLVMCtx, Bits, /*bFP*/ false);
+  case 16:
+    return GetConstDataArray<uint16_t>(LLVMCtx, Bits, bFP);
+  case 32:
+    return GetConstDataArray<uint32_t>(LLVMCtx, Bits, bFP);
+  case 64:
+    return GetConstDataArray<uint64_t>(LLVMCtx, Bits, bFP);
+  default:
+    return nullptr;
+  }
+}
+
 Constant *CGMSHLSLRuntime::EmitHLSLConstInitListExpr(CodeGenModule &CGM,
                                                      InitListExpr *E) {
+  if (Constant *C = EmitConstArrayInitList(CGM, E))
+    return C;
+
   bool bDefaultRowMajor = m_pHLModule->GetHLOptions().bDefaultRowMajor;
   SmallVector<Constant *, 4> EltValList;
   if (!ScanConstInitList(CGM, E, EltValList, CGM.getTypes(), bDefaultRowMajor))
@@ -6025,6 +6156,58 @@ static bool IsTypeMatchForMemcpy(llvm::Type *SrcTy, llvm::Type *DestTy) {
   }
 }
 
+// A flat conversion converts no element when the types only differ in name:
+// the same bases, fields and array sizes down to elements of the same type.
+// Matrices are converted element by element since their memory layout
+// depends on an orientation the canonical type doesn't carry, and objects of
+// different types since their copies depend on more than the bits.
+static bool IsFlatConversionBitwiseCopy(CodeGenFunction &CGF, QualType SrcTy,
+                                        QualType DestTy) {
+  if (hlsl::IsHLSLMatType(SrcTy) || hlsl::IsHLSLMatType(DestTy))
+    return false;
+  ASTContext &Ctx = CGF.getContext();
+  SrcTy = Ctx.getCanonicalType(SrcTy).getUnqualifiedType();
+  DestTy = Ctx.getCanonicalType(DestTy).getUnqualifiedType();
+  if (Ctx.hasSameType(SrcTy, DestTy))
+    return true;
+
+  const ConstantArrayType *SrcAT = Ctx.getAsConstantArrayType(SrcTy);
+  const ConstantArrayType *DestAT = Ctx.getAsConstantArrayType(DestTy);
+  if (SrcAT || DestAT)
+    return SrcAT && DestAT && SrcAT->getSize() == DestAT->getSize() &&
+           IsFlatConversionBitwiseCopy(CGF, SrcAT->getElementType(),
+                                       DestAT->getElementType());
+
+  if (hlsl::IsHLSLVecMatType(SrcTy) || hlsl::IsHLSLVecMatType(DestTy))
+    return false;
+  const RecordType *SrcRT = SrcTy->getAs<RecordType>();
+  const RecordType *DestRT = DestTy->getAs<RecordType>();
+  if (!SrcRT || !DestRT)
+    return false;
+  if (HLModule::IsHLSLObjectType(CGF.ConvertType(SrcTy)) ||
+      HLModule::IsHLSLObjectType(CGF.ConvertType(DestTy)))
+    return false;
+
+  const CXXRecordDecl *SrcRD = dyn_cast<CXXRecordDecl>(SrcRT->getDecl());
+  const CXXRecordDecl *DestRD = dyn_cast<CXXRecordDecl>(DestRT->getDecl());
+  if (!SrcRD || !DestRD || SrcRD->getNumBases() != DestRD->getNumBases())
+    return false;
+  for (auto SrcBase = SrcRD->bases_begin(), DestBase = DestRD->bases_begin();
+       SrcBase != SrcRD->bases_end(); ++SrcBase, ++DestBase) {
+    if (!IsFlatConversionBitwiseCopy(CGF, SrcBase->getType(),
+                                     DestBase->getType()))
+      return false;
+  }
+  auto SrcField = SrcRD->field_begin(), DestField = DestRD->field_begin();
+  for (; SrcField != SrcRD->field_end() && DestField != DestRD->field_end();
+       ++SrcField, ++DestField) {
+    if (!IsFlatConversionBitwiseCopy(CGF, SrcField->getType(),
+                                     DestField->getType()))
+      return false;
+  }
+  return SrcField == SrcRD->field_end() && DestField == DestRD->field_end();
+}
+
 void CGMSHLSLRuntime::EmitHLSLFlatConversionAggregateCopy(CodeGenFunction &CGF, llvm::Value *SrcPtr,
     clang::QualType SrcTy,
     llvm::Value *DestPtr,
@@ -6052,6 +6235,15 @@ void CGMSHLSLRuntime::EmitHLSLFlatConversionAggregateCopy(CodeGenFunction &CGF,
     }
   }
 
+  // Keep copies between types that only differ in name as one memcpy instead
+  // of a load and store per element; ScalarReplAggregatesHLSL splits it with
+  // the layout it picks for the destination.
+  if (IsFlatConversionBitwiseCopy(CGF, SrcTy, DestTy)) {
+    unsigned size = TheModule.getDataLayout().getTypeAllocSize(DestPtrTy);
+    CGF.Builder.CreateMemCpy(DestPtr, SrcPtr, size, 1);
+    return;
+  }
+
   // It is possiable to implement EmitHLSLAggregateCopy, EmitHLSLAggregateStore
   // the same way. But split value to scalar will generate many instruction when
   // src type is same as dest type.
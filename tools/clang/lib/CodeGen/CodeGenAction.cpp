@@ -18,6 +18,7 @@
 #include "clang/CodeGen/BackendUtil.h"
 #include "clang/CodeGen/CodeGenAction.h"
 #include "clang/CodeGen/ModuleBuilder.h"
+#include "clang/Frontend/CodeGenOptions.h" // HLSL Change
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Lex/Preprocessor.h"
@@ -35,6 +36,7 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/Timer.h"
 #include <memory>
+#include "dxc/HLSL/DxcTimeReport.h" // HLSL Change
 using namespace clang;
 using namespace llvm;
 
@@ -48,6 +50,11 @@ namespace clang {
     const LangOptions &LangOpts;
     raw_pwrite_stream *AsmOutStream;
     ASTContext *Context;
+    // HLSL Change Starts - the backend may run after the AST is freed.
+    SourceManager *SourceMgr;
+    std::string TargetDescription;
+    bool BackendPending;
+    // HLSL Change Ends
 
     Timer LLVMIRGeneration;
 
@@ -67,11 +74,13 @@ namespace clang {
                     CoverageSourceInfo *CoverageInfo = nullptr)
         : Diags(Diags), Action(Action), CodeGenOpts(CodeGenOpts),
           TargetOpts(TargetOpts), LangOpts(LangOpts), AsmOutStream(OS),
-          Context(nullptr), LLVMIRGeneration("LLVM IR Generation Time"),
+          Context(nullptr), SourceMgr(nullptr), BackendPending(false), // HLSL Change
+          LLVMIRGeneration("LLVM IR Generation Time"),
           Gen(CreateLLVMCodeGen(Diags, InFile, HeaderSearchOpts, PPOpts,
                                 CodeGenOpts, C, CoverageInfo)),
           LinkModule(LinkModule) {
       llvm::TimePassesIsEnabled = TimePasses;
+      C.setDiscardValueNames(CodeGenOpts.HLSLDiscardValueNames); // HLSL Change
     }
 
     // HLSL Change Starts - avoid double free
@@ -85,6 +94,26 @@ namespace clang {
     std::unique_ptr<llvm::Module> takeModule() { return std::move(TheModule); }
     llvm::Module *takeLinkModule() { return LinkModule.release(); }
 
+    // HLSL Change Starts - free the AST before optimization.
+    /// True if the module was generated but, under HLSLFreeASTEarly, not yet
+    /// handed to the backend.
+    bool hasPendingBackend() const { return BackendPending; }
+
+    /// Destroy the IR generator, which refers to the AST context; this must
+    /// happen while the context is still alive.
+    void releaseCodeGenerator() {
+      Gen.reset();
+      Context = nullptr;
+    }
+
+    /// Run the backend on the module deferred by HandleTranslationUnit.
+    void emitPendingBackendOutput() {
+      assert(BackendPending && "no module is waiting for the backend");
+      BackendPending = false;
+      EmitBackend();
+    }
+    // HLSL Change Ends
+
     void HandleCXXStaticMemberVarInstantiation(VarDecl *VD) override {
       Gen->HandleCXXStaticMemberVarInstantiation(VD);
     }
@@ -96,6 +125,7 @@ namespace clang {
       }
         
       Context = &Ctx;
+      SourceMgr = &Ctx.getSourceManager(); // HLSL Change
 
       if (llvm::TimePassesIsEnabled)
         LLVMIRGeneration.startTimer();
@@ -143,7 +173,15 @@ namespace clang {
         if (llvm::TimePassesIsEnabled)
           LLVMIRGeneration.startTimer();
 
+        hlsl::TimeReportPhase CodeGenPhase("codegen"); // HLSL Change
+        // HLSL Change Begin - discard value names during IR generation only.
+        // Other consumers may share the context, so set it again here; names
+        // that lowering gives, such as those of resource handles, are kept.
+        llvm::LLVMContext &VMCtx = Gen->GetModule()->getContext();
+        VMCtx.setDiscardValueNames(CodeGenOpts.HLSLDiscardValueNames);
         Gen->HandleTranslationUnit(C);
+        VMCtx.setDiscardValueNames(false);
+        // HLSL Change End
 
         if (llvm::TimePassesIsEnabled)
           LLVMIRGeneration.stopTimer();
@@ -174,6 +212,17 @@ namespace clang {
           return;
       }
 
+      // HLSL Change Starts - optionally defer the backend until the AST is freed.
+      TargetDescription = C.getTargetInfo().getTargetDescription();
+      if (CodeGenOpts.HLSLFreeASTEarly) {
+        BackendPending = true;
+        return;
+      }
+      EmitBackend();
+    }
+
+    void EmitBackend() {
+      // HLSL Change Ends
       // Install an inline asm handler so that diagnostics get printed through
       // our diagnostics hooks.
       LLVMContext &Ctx = TheModule->getContext();
@@ -188,7 +237,7 @@ namespace clang {
       Ctx.setDiagnosticHandler(DiagnosticHandler, this);
 
       EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, LangOpts,
-                        C.getTargetInfo().getTargetDescription(),
+                        TargetDescription, // HLSL Change
                         TheModule.get(), Action, AsmOutStream);
 
       Ctx.setInlineAsmDiagnosticHandler(OldHandler, OldContext);
@@ -317,7 +366,7 @@ void BackendConsumer::InlineAsmDiagHandler2(const llvm::SMDiagnostic &D,
   // If the SMDiagnostic has an inline asm source location, translate it.
   FullSourceLoc Loc;
   if (D.getLoc() != SMLoc())
-    Loc = ConvertBackendLocation(D, Context->getSourceManager());
+    Loc = ConvertBackendLocation(D, *SourceMgr); // HLSL Change
 
   unsigned DiagID;
   switch (D.getKind()) {
@@ -441,7 +490,7 @@ void BackendConsumer::EmitOptimizationMessage(
   assert(D.getSeverity() == llvm::DS_Remark ||
          D.getSeverity() == llvm::DS_Warning);
 
-  SourceManager &SourceMgr = Context->getSourceManager();
+  SourceManager &SourceMgr = *this->SourceMgr; // HLSL Change
   FileManager &FileMgr = SourceMgr.getFileManager();
   StringRef Filename;
   unsigned Line, Column;
@@ -588,7 +637,7 @@ void BackendConsumer::DiagnosticHandlerImpl(const DiagnosticInfo &DI) {
 CodeGenAction::CodeGenAction(unsigned _Act, LLVMContext *_VMContext)
   : Act(_Act), LinkModule(nullptr),
     VMContext(_VMContext ? _VMContext : new LLVMContext),
-    OwnsVMContext(!_VMContext) {}
+    OwnsVMContext(!_VMContext), BEConsumer(nullptr) {} // HLSL Change
 
 CodeGenAction::~CodeGenAction() {
   TheModule.reset();
@@ -752,6 +801,19 @@ void CodeGenAction::ExecuteAction() {
 
   // Otherwise follow the normal AST path.
   this->ASTFrontendAction::ExecuteAction();
+
+  // HLSL Change Starts - free the AST before optimization.
+  // The module no longer refers to the AST, so Sema and the AST context can go
+  // before the backend runs. The source manager and its buffers belong to the
+  // compiler instance and stay alive for the backend's diagnostics.
+  if (BEConsumer && BEConsumer->hasPendingBackend()) {
+    CompilerInstance &CI = getCompilerInstance();
+    BEConsumer->releaseCodeGenerator();
+    CI.setSema(nullptr);
+    CI.setASTContext(nullptr);
+    BEConsumer->emitPendingBackendOutput();
+  }
+  // HLSL Change Ends
 }
 
 //
@@ -785,3 +847,117 @@ void EmitOptDumpAction::anchor() { }
 EmitOptDumpAction::EmitOptDumpAction(llvm::LLVMContext *_VMContext)
   : CodeGenAction(Backend_EmitPasses, _VMContext) {}
 // HLSL Change Ends
+
+// HLSL Change Starts
+namespace clang {
+/// Forwards the parsed translation unit to one BackendConsumer per entry of
+/// an EmitBCBatchAction, tracking which entries reported errors.
+class BatchBackendConsumer : public ASTConsumer {
+  DiagnosticsEngine &Diags;
+  std::vector<EmitBCBatchAction::EntryResult> &Results;
+  std::vector<std::unique_ptr<CodeGenOptions>> EntryCodeGenOpts;
+  std::vector<std::unique_ptr<raw_svector_ostream>> EntryStreams;
+  std::vector<std::unique_ptr<BackendConsumer>> Consumers;
+
+public:
+  BatchBackendConsumer(CompilerInstance &CI, StringRef InFile,
+                       std::vector<EmitBCBatchAction::EntryResult> &Results,
+                       LLVMContext &C)
+      : Diags(CI.getDiagnostics()), Results(Results) {
+    for (EmitBCBatchAction::EntryResult &R : Results) {
+      std::unique_ptr<CodeGenOptions> Opts(
+          new CodeGenOptions(CI.getCodeGenOpts()));
+      Opts->HLSLEntryFunction = R.EntryFunction;
+      Opts->HLSLProfile = R.Profile;
+      std::unique_ptr<raw_svector_ostream> OS(
+          new raw_svector_ostream(R.Bitcode));
+      Consumers.emplace_back(new BackendConsumer(
+          Backend_EmitBC, CI.getDiagnostics(), CI.getHeaderSearchOpts(),
+          CI.getPreprocessorOpts(), *Opts, CI.getTargetOpts(),
+          CI.getLangOpts(), CI.getFrontendOpts().ShowTimers, InFile,
+          nullptr, OS.get(), C));
+      EntryCodeGenOpts.emplace_back(std::move(Opts));
+      EntryStreams.emplace_back(std::move(OS));
+    }
+  }
+
+  void Initialize(ASTContext &Ctx) override {
+    for (auto &BC : Consumers)
+      BC->Initialize(Ctx);
+  }
+  bool HandleTopLevelDecl(DeclGroupRef D) override {
+    for (auto &BC : Consumers)
+      BC->HandleTopLevelDecl(D);
+    return true;
+  }
+  void HandleInlineMethodDefinition(CXXMethodDecl *D) override {
+    for (auto &BC : Consumers)
+      BC->HandleInlineMethodDefinition(D);
+  }
+  void HandleCXXStaticMemberVarInstantiation(VarDecl *VD) override {
+    for (auto &BC : Consumers)
+      BC->HandleCXXStaticMemberVarInstantiation(VD);
+  }
+  void HandleTagDeclDefinition(TagDecl *D) override {
+    for (auto &BC : Consumers)
+      BC->HandleTagDeclDefinition(D);
+  }
+  void HandleTagDeclRequiredDefinition(const TagDecl *D) override {
+    for (auto &BC : Consumers)
+      BC->HandleTagDeclRequiredDefinition(D);
+  }
+  void CompleteTentativeDefinition(VarDecl *D) override {
+    for (auto &BC : Consumers)
+      BC->CompleteTentativeDefinition(D);
+  }
+  void HandleTranslationUnit(ASTContext &C) override {
+    // Errors from the front-end apply to every entry; errors reported while
+    // generating code for one entry only apply to that entry.
+    bool FrontEndErrors = Diags.hasErrorOccurred();
+    for (unsigned i = 0, e = Consumers.size(); i != e; ++i) {
+      DiagnosticErrorTrap Trap(Diags);
+      Consumers[i]->HandleTranslationUnit(C);
+      EntryStreams[i]->flush();
+      Results[i].HasErrors = FrontEndErrors || Trap.hasErrorOccurred();
+    }
+  }
+
+  void TakeModules() {
+    for (unsigned i = 0, e = Consumers.size(); i != e; ++i)
+      Results[i].Module = Consumers[i]->takeModule();
+  }
+};
+} // namespace clang
+
+EmitBCBatchAction::EmitBCBatchAction(llvm::LLVMContext *_VMContext,
+                                     ArrayRef<std::string> EntryFunctions,
+                                     ArrayRef<std::string> Profiles)
+    : VMContext(_VMContext), Consumer(nullptr) {
+  assert(VMContext && "batch compilation requires an external LLVMContext");
+  assert(EntryFunctions.size() == Profiles.size() &&
+         "else each entry does not have a profile");
+  Results.resize(EntryFunctions.size());
+  for (unsigned i = 0, e = EntryFunctions.size(); i != e; ++i) {
+    Results[i].EntryFunction = EntryFunctions[i];
+    Results[i].Profile = Profiles[i];
+  }
+}
+
+EmitBCBatchAction::~EmitBCBatchAction() {}
+
+std::unique_ptr<ASTConsumer>
+EmitBCBatchAction::CreateASTConsumer(CompilerInstance &CI, StringRef InFile) {
+  std::unique_ptr<BatchBackendConsumer> Result(
+      new BatchBackendConsumer(CI, InFile, Results, *VMContext));
+  Consumer = Result.get();
+  return std::move(Result);
+}
+
+void EmitBCBatchAction::EndSourceFileAction() {
+  // If the consumer creation failed, do nothing.
+  if (!getCompilerInstance().hasASTConsumer())
+    return;
+
+  Consumer->TakeModules();
+}
+// HLSL Change Ends
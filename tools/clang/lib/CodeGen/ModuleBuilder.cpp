@@ -24,6 +24,8 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/Path.h" // HLSL Change
+#include <algorithm> // HLSL Change
 #include <memory>
 using namespace clang;
 
@@ -57,6 +59,20 @@ namespace {
   private:
     SmallVector<CXXMethodDecl *, 8> DeferredInlineMethodDefinitions;
 
+    // HLSL Change Begin
+    // With /Brepro, absolute paths left after -fdebug-prefix-map are
+    // reported, since they keep outputs from matching across machines.
+    void WarnIfNotReproducible(StringRef Path) {
+      if (!CodeGenOpts.HLSLReproducible || !llvm::sys::path::is_absolute(Path))
+        return;
+      unsigned DiagID = Diags.getCustomDiagID(
+          DiagnosticsEngine::Warning,
+          "debug information records the absolute path '%0'; map it with "
+          "-fdebug-prefix-map for reproducible output");
+      Diags.Report(DiagID) << Path;
+    }
+    // HLSL Change End
+
   public:
     CodeGeneratorImpl(DiagnosticsEngine &diags, const std::string &ModuleName,
                       const HeaderSearchOptions &HSO,
@@ -212,25 +228,33 @@ namespace {
         Builder->Release();
       // HLSL Change Begins
       // Error may happen in Builder->Release for HLSL
-      if (CodeGenOpts.getDebugInfo() == CodeGenOptions::DebugInfoKind::FullDebugInfo) {
-        // Add all file contents in a list of filename/content pairs.
+      if (CodeGenOpts.getDebugInfo() != CodeGenOptions::DebugInfoKind::NoDebugInfo) {
+        // Add all file contents in a list of filename/content pairs, sorted
+        // by name; the source manager keeps them in pointer order, which
+        // changes from run to run.
         llvm::NamedMDNode *pContents = nullptr;
         llvm::LLVMContext &LLVMCtx = M->getContext();
+        std::vector<std::pair<std::string, StringRef>> files;
         for (SourceManager::fileinfo_iterator
                  it = Ctx.getSourceManager().fileinfo_begin(),
                  end = Ctx.getSourceManager().fileinfo_end();
              it != end; ++it) {
           if (it->first->isValid() && !it->second->IsSystemFile) {
-            if (pContents == nullptr) {
-              pContents = M->getOrInsertNamedMetadata("llvm.dbg.contents");
-            }
-            llvm::MDTuple *pFileInfo = llvm::MDNode::get(
-                LLVMCtx,
-                {llvm::MDString::get(LLVMCtx, it->first->getName()),
-                 llvm::MDString::get(LLVMCtx,
-                                     it->second->getRawBuffer()->getBuffer())});
-            pContents->addOperand(pFileInfo);
+            files.emplace_back(
+                CodeGenOpts.remapDebugPath(it->first->getName()),
+                it->second->getRawBuffer()->getBuffer());
+          }
+        }
+        std::sort(files.begin(), files.end());
+        for (auto &file : files) {
+          if (pContents == nullptr) {
+            pContents = M->getOrInsertNamedMetadata("llvm.dbg.contents");
           }
+          WarnIfNotReproducible(file.first);
+          llvm::MDTuple *pFileInfo = llvm::MDNode::get(
+              LLVMCtx, {llvm::MDString::get(LLVMCtx, file.first),
+                        llvm::MDString::get(LLVMCtx, file.second)});
+          pContents->addOperand(pFileInfo);
         }
 
         // Add Defines to Debug Info
@@ -245,7 +269,9 @@ namespace {
         // Add main file name to debug info
         llvm::NamedMDNode *pSourceFilename = M->getOrInsertNamedMetadata("llvm.dbg.mainFileName");
         llvm::MDTuple *pFileName = llvm::MDNode::get(
-          LLVMCtx, llvm::MDString::get(LLVMCtx, CodeGenOpts.MainFileName));
+          LLVMCtx, llvm::MDString::get(
+                       LLVMCtx,
+                       CodeGenOpts.remapDebugPath(CodeGenOpts.MainFileName)));
         pSourceFilename->addOperand(pFileName);
 
         // Pass in any other arguments to debug info
@@ -253,7 +279,10 @@ namespace {
         std::vector<llvm::Metadata *> vecArguments;
         vecArguments.resize(CodeGenOpts.HLSLArguments.size());
         std::transform(CodeGenOpts.HLSLArguments.begin(), CodeGenOpts.HLSLArguments.end(),
-          vecArguments.begin(), [&LLVMCtx](const std::string &str) { return llvm::MDString::get(LLVMCtx, str); });
+          vecArguments.begin(), [&](const std::string &str) {
+            return llvm::MDString::get(LLVMCtx,
+                                       CodeGenOpts.remapDebugPath(str));
+          });
         llvm::MDTuple *pArgumentsInfo = llvm::MDNode::get(LLVMCtx, vecArguments);
         pArgs->addOperand(pArgumentsInfo);
 
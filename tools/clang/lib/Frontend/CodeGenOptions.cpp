@@ -21,4 +21,17 @@ CodeGenOptions::CodeGenOptions() {
   memcpy(CoverageVersion, "402*", 4);
 }
 
+// HLSL Change Begin
+std::string CodeGenOptions::remapDebugPath(StringRef Path) const {
+  // A longer prefix sorts after the prefixes it extends, so searching from
+  // the end finds the longest match first.
+  for (auto it = DebugPrefixMap.rbegin(), E = DebugPrefixMap.rend(); it != E;
+       ++it) {
+    if (Path.startswith(it->first))
+      return it->second + Path.substr(it->first.size()).str();
+  }
+  return Path.str();
+}
+// HLSL Change End
+
 }  // end namespace clang
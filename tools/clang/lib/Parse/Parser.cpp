@@ -574,6 +574,10 @@ bool Parser::ParseTopLevelDecl(DeclGroupPtrTy &Result) {
     return false;
 
   case tok::eof:
+    // HLSL Change Starts - parse the deferred bodies that are referenced.
+    if (!HLSLDeferredFunctionBodies.empty())
+      ParseHLSLDeferredFunctionBodies();
+    // HLSL Change Ends
     // Late template parsing can begin.
     if (getLangOpts().DelayedTemplateParsing)
       Actions.SetLateTemplateParser(LateTemplateParserCallback,
@@ -1056,6 +1060,33 @@ Decl *Parser::ParseFunctionDefinition(ParsingDeclarator &D,
     }
   }
 
+  // HLSL Change Starts - store the body tokens of functions the entry point
+  // may not reach; they are parsed at the end of the translation unit if
+  // the function has been referenced by then.
+  if (TemplateInfo.Kind == ParsedTemplateInfo::NonTemplate &&
+      CanDeferHLSLFunctionBody(D)) {
+    ParseScope BodyScope(this, Scope::FnScope|Scope::DeclScope);
+    Scope *ParentScope = getCurScope()->getParent();
+
+    D.setFunctionDefinitionKind(FDK_Definition);
+    Decl *DP = Actions.HandleDeclarator(ParentScope, D,
+                                        MultiTemplateParamsArg());
+    D.complete(DP);
+    D.getMutableDeclSpec().abort();
+
+    std::unique_ptr<HLSLDeferredFunctionBody> Body(
+        new HLSLDeferredFunctionBody());
+    Body->FD = DP ? DP->getAsFunction() : nullptr;
+    Body->Parsed = false;
+    Body->Toks.push_back(Tok);
+    ConsumeBrace();
+    ConsumeAndStoreUntil(tok::r_brace, Body->Toks, /*StopAtSemi=*/false);
+    if (Body->FD)
+      HLSLDeferredFunctionBodies.push_back(std::move(Body));
+    return DP;
+  }
+  // HLSL Change Ends
+
   // In delayed template parsing mode, for function template we consume the
   // tokens and store them for late parsing at the end of the translation unit.
   if (getLangOpts().DelayedTemplateParsing && Tok.isNot(tok::equal) &&
@@ -1179,6 +1210,66 @@ Decl *Parser::ParseFunctionDefinition(ParsingDeclarator &D,
   return ParseFunctionStatementBody(Res, BodyScope);
 }
 
+// HLSL Change Starts
+/// Whether the body of the function being defined can wait until the end of
+/// the translation unit. Entry points are always parsed; in libraries only
+/// static functions, which are never exported, wait.
+bool Parser::CanDeferHLSLFunctionBody(Declarator &D) {
+  const LangOptions &LangOpts = getLangOpts();
+  if (!LangOpts.HLSL || !LangOpts.HLSLDeferFunctionBodies ||
+      Tok.isNot(tok::l_brace) || !Actions.CurContext->isTranslationUnit())
+    return false;
+  IdentifierInfo *II = D.getIdentifier();
+  if (!II)
+    return false;
+  if (LangOpts.IsHLSLLibrary)
+    return D.getDeclSpec().getStorageClassSpec() == DeclSpec::SCS_static;
+  StringRef Name = II->getName();
+  if (Name == LangOpts.HLSLEntryFunction)
+    return false;
+  const std::vector<std::string> &BatchEntries =
+      LangOpts.HLSLBatchEntryFunctions;
+  return std::find(BatchEntries.begin(), BatchEntries.end(), Name) ==
+         BatchEntries.end();
+}
+
+/// Parses the deferred bodies of referenced functions. A body can reference
+/// other deferred functions, so this repeats until a pass parses nothing.
+/// Patch constant functions are named only by an attribute string, so any
+/// function that could be one is parsed as well.
+void Parser::ParseHLSLDeferredFunctionBodies() {
+  bool ParsedAny;
+  do {
+    ParsedAny = false;
+    for (std::unique_ptr<HLSLDeferredFunctionBody> &Body :
+         HLSLDeferredFunctionBodies) {
+      FunctionDecl *FD = Body->FD;
+      if (Body->Parsed ||
+          !(FD->isReferenced() ||
+            Actions.getASTContext().IsPatchConstantFunctionDecl(FD)))
+        continue;
+      Body->Parsed = true;
+      ParsedAny = true;
+
+      Sema::ContextRAII SavedContext(
+          Actions, Actions.Context.getTranslationUnitDecl());
+
+      // Append the current token so that it doesn't get lost.
+      Body->Toks.push_back(Tok);
+      PP.EnterTokenStream(Body->Toks.data(), Body->Toks.size(), true, false);
+      ConsumeAnyToken();
+      assert(Tok.is(tok::l_brace) && "deferred body must start with '{'");
+
+      ParseScope FnScope(this, Scope::FnScope|Scope::DeclScope);
+      Decl *Res = Actions.ActOnStartOfFunctionDef(getCurScope(), FD);
+      Res = ParseFunctionStatementBody(Res, FnScope);
+      if (Res)
+        Actions.getASTConsumer().HandleTopLevelDecl(DeclGroupRef(Res));
+    }
+  } while (ParsedAny);
+}
+// HLSL Change Ends
+
 /// ParseKNRParamDeclarations - Parse 'declaration-list[opt]' which provides
 /// types for a function with a K&R-style identifier list for arguments.
 void Parser::ParseKNRParamDeclarations(Declarator &D) {
@@ -19,7 +19,9 @@
 #include "clang/AST/Expr.h"
 #include "clang/AST/HlslTypes.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
 
 namespace clang {
@@ -92,6 +94,78 @@ inline uint32_t getNumBaseClasses(QualType type) {
     return cxxDecl->getNumBases();
   return 0;
 }
+
+/// Returns the Vulkan descriptor type for variables of the given resource
+/// type, which must not be an array.
+hlsl::SpirvDescriptorType getDescriptorType(QualType type) {
+  if (TypeTranslator::isSampler(type))
+    return hlsl::SpirvDescriptorType::Sampler;
+  if (TypeTranslator::isSubpassInput(type) ||
+      TypeTranslator::isSubpassInputMS(type))
+    return hlsl::SpirvDescriptorType::InputAttachment;
+  if (TypeTranslator::isRWTexture(type))
+    return hlsl::SpirvDescriptorType::StorageImage;
+  if (TypeTranslator::isTexture(type) || TypeTranslator::isTextureMS(type))
+    return hlsl::SpirvDescriptorType::SampledImage;
+  if (TypeTranslator::isRWBuffer(type))
+    return hlsl::SpirvDescriptorType::StorageTexelBuffer;
+  if (TypeTranslator::isBuffer(type))
+    return hlsl::SpirvDescriptorType::UniformTexelBuffer;
+  // Structured and byte address buffers are BufferBlock structs.
+  return hlsl::SpirvDescriptorType::StorageBuffer;
+}
+
+/// Appends the bytes of the given record to out.
+template <typename T> void appendRecord(std::string *out, const T &record) {
+  out->append(reinterpret_cast<const char *>(&record), sizeof(record));
+}
+
+/// Collects the cbuffers used in the bodies of the functions queued, queuing
+/// the functions they call as they are found.
+class CBufferUseCollector : public RecursiveASTVisitor<CBufferUseCollector> {
+public:
+  llvm::SetVector<const FunctionDecl *> functions;
+  llvm::SetVector<const HLSLBufferDecl *> cbuffers;
+
+  void addFunction(const FunctionDecl *func) {
+    const FunctionDecl *definition = nullptr;
+    if (func->hasBody(definition))
+      functions.insert(definition);
+  }
+
+  bool VisitDeclRefExpr(DeclRefExpr *expr) {
+    const auto *decl = expr->getDecl();
+    if (const auto *func = dyn_cast<FunctionDecl>(decl)) {
+      addFunction(func);
+    } else if (const auto *buffer =
+                   dyn_cast<HLSLBufferDecl>(decl->getDeclContext())) {
+      // ConstantBuffers are variables of their own, not cbuffer blocks.
+      if (buffer->isCBuffer() && !buffer->isConstantBufferView())
+        cbuffers.insert(buffer);
+    }
+    return true;
+  }
+
+  bool VisitCallExpr(CallExpr *expr) {
+    // Method calls have no DeclRefExpr for the callee.
+    if (const auto *callee = expr->getDirectCallee())
+      addFunction(callee);
+    return true;
+  }
+};
+
+/// Returns true if a variable in the given DeclContext, or in the namespaces
+/// in it, is a push constant block.
+bool hasPushConstant(const DeclContext *context) {
+  for (const auto *decl : context->decls()) {
+    if (decl->hasAttr<VKPushConstantAttr>())
+      return true;
+    if (const auto *ns = dyn_cast<NamespaceDecl>(decl))
+      if (hasPushConstant(ns))
+        return true;
+  }
+  return false;
+}
 } // anonymous namespace
 
 std::string StageVar::getSemanticStr() const {
@@ -428,6 +502,7 @@ SpirvEvalInfo DeclResultIdMapper::createExternVar(const VarDecl *var) {
   const auto *counterBindingAttr = var->getAttr<VKCounterBindingAttr>();
 
   resourceVars.emplace_back(id, regAttr, bindingAttr, counterBindingAttr);
+  reflectResource(id, var->getName(), var->getType());
 
   if (const auto *inputAttachment = var->getAttr<VKInputAttachmentIndexAttr>())
     theBuilder.decorateInputAttachmentIndex(id, inputAttachment->getIndex());
@@ -538,17 +613,113 @@ uint32_t DeclResultIdMapper::createStructOrStructArrayVarOfExplicitLayout(
                       : spv::StorageClass::Uniform;
 
   // Create the variable for the whole struct / struct array.
-  return theBuilder.addModuleVar(resultType, sc, varName);
+  const uint32_t var = theBuilder.addModuleVar(resultType, sc, varName);
+
+  if (spirvOptions.reflectionSidecar) {
+    const uint32_t flags = decl == autoPushConstant
+                               ? hlsl::SpirvReflectionBlockAutoPushConstant
+                               : 0;
+    ReflectedBlock block = {var, varName.str(), sc, 0, flags, {}, {}};
+    for (const auto *subDecl : declGroup) {
+      const auto *declDecl = cast<DeclaratorDecl>(subDecl);
+      uint32_t stride = 0;
+      const uint32_t size = typeTranslator
+                                .getAlignmentAndSize(declDecl->getType(),
+                                                     layoutRule, &stride)
+                                .second;
+      block.members.push_back({0, 0, size});
+      block.memberNames.push_back(declDecl->getName().str());
+    }
+    for (const auto *decoration : decorations)
+      if (decoration->getValue() == spv::Decoration::Offset &&
+          decoration->getMemberIndex().hasValue())
+        block.members[decoration->getMemberIndex().getValue()].Offset =
+            decoration->getArgs()[0];
+    for (const auto &member : block.members)
+      block.size = std::max(block.size, member.Offset + member.Size);
+    reflectedBlocks.push_back(std::move(block));
+  }
+
+  return var;
+}
+
+void DeclResultIdMapper::selectAutoPushConstant(
+    const TranslationUnitDecl *tu,
+    llvm::ArrayRef<const DeclaratorDecl *> entries) {
+  assert(spirvOptions.autoPushConstantSize != 0);
+  if (hasPushConstant(tu))
+    return;
+
+  CBufferUseCollector collector;
+  for (const auto *entry : entries)
+    if (const auto *func = dyn_cast<FunctionDecl>(entry))
+      collector.addFunction(func);
+  // The queue can grow in the meanwhile.
+  for (uint32_t i = 0; i < collector.functions.size(); ++i)
+    collector.TraverseStmt(
+        const_cast<Stmt *>(collector.functions[i]->getBody()));
+
+  // Ties go to the cbuffer used first.
+  uint32_t bestSize = spirvOptions.autoPushConstantSize;
+  for (const auto *buffer : collector.cbuffers) {
+    if (buffer->hasAttr<VKBindingAttr>())
+      continue;
+    const auto &declGroup = typeTranslator.collectDeclsInDeclContext(buffer);
+    if (declGroup.empty())
+      continue;
+    uint32_t size = 0;
+    for (const auto *decoration : typeTranslator.getLayoutDecorations(
+             declGroup, spirvOptions.sBufferLayoutRule)) {
+      if (decoration->getValue() != spv::Decoration::Offset ||
+          !decoration->getMemberIndex().hasValue())
+        continue;
+      const auto *member =
+          cast<DeclaratorDecl>(declGroup[decoration->getMemberIndex().getValue()]);
+      uint32_t stride = 0;
+      size = std::max(size, decoration->getArgs()[0] +
+                                typeTranslator
+                                    .getAlignmentAndSize(
+                                        member->getType(),
+                                        spirvOptions.sBufferLayoutRule, &stride)
+                                    .second);
+    }
+    if (size <= bestSize && (!autoPushConstant || size < bestSize)) {
+      autoPushConstant = buffer;
+      bestSize = size;
+    }
+  }
 }
 
 uint32_t DeclResultIdMapper::createCTBuffer(const HLSLBufferDecl *decl) {
+  // A cbuffer made a push constant block is laid out like the ones declared
+  // with [[vk::push_constant]], and needs no descriptor.
+  const bool forPushConstant = decl == autoPushConstant;
   const auto usageKind =
-      decl->isCBuffer() ? ContextUsageKind::CBuffer : ContextUsageKind::TBuffer;
-  const std::string structName = "type." + decl->getName().str();
+      forPushConstant ? ContextUsageKind::PushConstant
+                      : decl->isCBuffer() ? ContextUsageKind::CBuffer
+                                          : ContextUsageKind::TBuffer;
+  const std::string structName =
+      (forPushConstant ? "type.PushConstant." : "type.") +
+      decl->getName().str();
   // The front-end does not allow arrays of cbuffer/tbuffer.
   const uint32_t bufferVar = createStructOrStructArrayVarOfExplicitLayout(
       decl, /*arraySize*/ 0, usageKind, structName, decl->getName());
 
+  if (forPushConstant) {
+    int index = 0;
+    for (const auto *subDecl : decl->decls()) {
+      if (TypeTranslator::shouldSkipInStructLayout(subDecl))
+        continue;
+
+      const auto *varDecl = cast<VarDecl>(subDecl);
+      astDecls[varDecl] = SpirvEvalInfo(bufferVar)
+                              .setStorageClass(spv::StorageClass::PushConstant)
+                              .setLayoutRule(spirvOptions.sBufferLayoutRule);
+      astDecls[varDecl].indexInCTBuffer = index++;
+    }
+    return bufferVar;
+  }
+
   // We still register all VarDecls seperately here. All the VarDecls are
   // mapped to the <result-id> of the buffer object, which means when querying
   // querying the <result-id> for a certain VarDecl, we need to do an extra
@@ -569,6 +740,10 @@ uint32_t DeclResultIdMapper::createCTBuffer(const HLSLBufferDecl *decl) {
   resourceVars.emplace_back(bufferVar, getResourceBinding(decl),
                             decl->getAttr<VKBindingAttr>(),
                             decl->getAttr<VKCounterBindingAttr>());
+  reflectResource(bufferVar, decl->getName(),
+                  decl->isCBuffer() ? hlsl::SpirvDescriptorType::UniformBuffer
+                                    : hlsl::SpirvDescriptorType::StorageBuffer,
+                  1);
 
   return bufferVar;
 }
@@ -607,6 +782,11 @@ uint32_t DeclResultIdMapper::createCTBuffer(const VarDecl *decl) {
   resourceVars.emplace_back(bufferVar, getResourceBinding(context),
                             decl->getAttr<VKBindingAttr>(),
                             decl->getAttr<VKCounterBindingAttr>());
+  reflectResource(bufferVar, decl->getName(),
+                  context->isCBuffer()
+                      ? hlsl::SpirvDescriptorType::UniformBuffer
+                      : hlsl::SpirvDescriptorType::StorageBuffer,
+                  arraySize ? arraySize : 1);
 
   return bufferVar;
 }
@@ -642,6 +822,8 @@ void DeclResultIdMapper::createGlobalsCBuffer(const VarDecl *var) {
       "$Globals");
 
   resourceVars.emplace_back(globals, nullptr, nullptr, nullptr);
+  reflectResource(globals, "$Globals", hlsl::SpirvDescriptorType::UniformBuffer,
+                  1);
 
   uint32_t index = 0;
   for (const auto *decl : typeTranslator.collectDeclsInDeclContext(context))
@@ -757,6 +939,8 @@ void DeclResultIdMapper::createCounterVar(
     resourceVars.emplace_back(counterId, getResourceBinding(decl),
                               decl->getAttr<VKBindingAttr>(),
                               decl->getAttr<VKCounterBindingAttr>(), true);
+    reflectResource(counterId, counterName,
+                    hlsl::SpirvDescriptorType::StorageBuffer, 1);
     assert(declId);
     theBuilder.decorateCounterBufferId(declId, counterId);
   }
@@ -798,7 +982,8 @@ DeclResultIdMapper::getCTBufferPushConstantTypeId(const DeclContext *decl) {
   return found->second;
 }
 
-std::vector<uint32_t> DeclResultIdMapper::collectStageVars() const {
+std::vector<uint32_t>
+DeclResultIdMapper::collectStageVars(uint32_t entryId) const {
   std::vector<uint32_t> vars;
 
   for (auto var : glPerVertex.getStageInVars())
@@ -807,7 +992,8 @@ std::vector<uint32_t> DeclResultIdMapper::collectStageVars() const {
     vars.push_back(var);
 
   for (const auto &var : stageVars)
-    vars.push_back(var.getSpirvId());
+    if (isStageVarOf(var, entryId))
+      vars.push_back(var.getSpirvId());
 
   return vars;
 }
@@ -877,10 +1063,14 @@ private:
 };
 } // namespace
 
-bool DeclResultIdMapper::checkSemanticDuplication(bool forInput) {
+bool DeclResultIdMapper::checkSemanticDuplication(uint32_t entryId,
+                                                  bool forInput) {
   llvm::StringSet<> seenSemantics;
   bool success = true;
   for (const auto &var : stageVars) {
+    if (!isStageVarOf(var, entryId))
+      continue;
+
     auto s = var.getSemanticStr();
 
     if (s.empty()) {
@@ -909,14 +1099,15 @@ bool DeclResultIdMapper::checkSemanticDuplication(bool forInput) {
   return success;
 }
 
-bool DeclResultIdMapper::finalizeStageIOLocations(bool forInput) {
-  if (!checkSemanticDuplication(forInput))
+bool DeclResultIdMapper::finalizeStageIOLocations(uint32_t entryId,
+                                                  bool forInput) {
+  if (!checkSemanticDuplication(entryId, forInput))
     return false;
 
   // Returns false if the given StageVar is an input/output variable without
   // explicit location assignment. Otherwise, returns true.
-  const auto locAssigned = [forInput, this](const StageVar &v) {
-    if (forInput == isInputStorageClass(v))
+  const auto locAssigned = [entryId, forInput, this](const StageVar &v) {
+    if (isStageVarOf(v, entryId) && forInput == isInputStorageClass(v))
       // No need to assign location for builtins. Treat as assigned.
       return v.isSpirvBuitin() || v.getLocationAttr() != nullptr;
     // For the ones we don't care, treat as assigned.
@@ -931,7 +1122,7 @@ bool DeclResultIdMapper::finalizeStageIOLocations(bool forInput) {
 
     for (const auto &var : stageVars) {
       // Skip those stage variables we are not handling for this call
-      if (forInput != isInputStorageClass(var))
+      if (!isStageVarOf(var, entryId) || forInput != isInputStorageClass(var))
         continue;
 
       // Skip builtins
@@ -958,7 +1149,7 @@ bool DeclResultIdMapper::finalizeStageIOLocations(bool forInput) {
       }
       locSet.useLoc(loc);
 
-      theBuilder.decorateLocation(var.getSpirvId(), loc);
+      decorateLocation(var.getSpirvId(), loc);
     }
 
     return noError;
@@ -968,7 +1159,7 @@ bool DeclResultIdMapper::finalizeStageIOLocations(bool forInput) {
   LocationSet locSet;
 
   for (const auto &var : stageVars) {
-    if (forInput != isInputStorageClass(var))
+    if (!isStageVarOf(var, entryId) || forInput != isInputStorageClass(var))
       continue;
 
     if (!var.isSpirvBuitin()) {
@@ -987,7 +1178,7 @@ bool DeclResultIdMapper::finalizeStageIOLocations(bool forInput) {
       // Arbitrary semantics are disallowed in pixel shader.
       if (var.getSemantic() &&
           var.getSemantic()->GetKind() == hlsl::Semantic::Kind::Target) {
-        theBuilder.decorateLocation(var.getSpirvId(), var.getSemanticIndex());
+        decorateLocation(var.getSpirvId(), var.getSemanticIndex());
         locSet.useLoc(var.getSemanticIndex());
       } else {
         vars.push_back(&var);
@@ -1010,8 +1201,8 @@ bool DeclResultIdMapper::finalizeStageIOLocations(bool forInput) {
   }
 
   for (const auto *var : vars)
-    theBuilder.decorateLocation(var->getSpirvId(),
-                                locSet.useNextLocs(var->getLocationCount()));
+    decorateLocation(var->getSpirvId(),
+                     locSet.useNextLocs(var->getLocationCount()));
 
   return true;
 }
@@ -1073,7 +1264,7 @@ bool DeclResultIdMapper::decorateResourceBindings() {
                                                  const uint32_t setNo,
                                                  const uint32_t bindingNo) {
     bindingSet.useBinding(bindingNo, setNo);
-    theBuilder.decorateDSetBinding(varId, setNo, bindingNo);
+    decorateDSetBinding(varId, setNo, bindingNo);
   };
 
   for (const auto &var : resourceVars) {
@@ -1141,19 +1332,149 @@ bool DeclResultIdMapper::decorateResourceBindings() {
         else if (const auto *reg = var.getRegister())
           set = reg->RegisterSpace;
 
-        theBuilder.decorateDSetBinding(var.getSpirvId(), set,
-                                       bindingSet.useNextBinding(set));
+        decorateDSetBinding(var.getSpirvId(), set,
+                            bindingSet.useNextBinding(set));
       }
     } else if (!var.getBinding() && !var.getRegister()) {
       // Process m3
-      theBuilder.decorateDSetBinding(var.getSpirvId(), 0,
-                                     bindingSet.useNextBinding(0));
+      decorateDSetBinding(var.getSpirvId(), 0, bindingSet.useNextBinding(0));
     }
   }
 
   return true;
 }
 
+void DeclResultIdMapper::writeReflectionSidecar(spv::ExecutionModel model,
+                                                llvm::StringRef entryName,
+                                                std::string *out) const {
+  // Strings are pooled so that each name is stored once.
+  std::string strings;
+  llvm::StringMap<uint32_t> stringOffsets;
+  const auto addString = [&strings, &stringOffsets](llvm::StringRef str) {
+    auto inserted = stringOffsets.insert(
+        std::make_pair(str, static_cast<uint32_t>(strings.size())));
+    if (inserted.second) {
+      strings.append(str.begin(), str.end());
+      strings.push_back('\0');
+    }
+    return inserted.first->second;
+  };
+
+  hlsl::SpirvReflectionHeader header = {};
+  header.Magic = hlsl::SpirvReflectionMagic;
+  header.Version = hlsl::SpirvReflectionVersion;
+  header.ExecutionModel = static_cast<uint32_t>(model);
+  header.EntryName = addString(entryName);
+
+  llvm::SmallVector<hlsl::SpirvReflectionBinding, 8> bindings;
+  for (const auto &resource : reflectedResources) {
+    hlsl::SpirvReflectionBinding binding = {};
+    binding.Name = addString(resource.name);
+    binding.Set = binding.Binding = hlsl::SpirvReflectionNone;
+    const auto found = resourceBindings.find(resource.varId);
+    if (found != resourceBindings.end()) {
+      binding.Set = found->second.first;
+      binding.Binding = found->second.second;
+    }
+    binding.DescriptorType = static_cast<uint32_t>(resource.descriptorType);
+    binding.ArraySize = resource.arraySize;
+    binding.Block = hlsl::SpirvReflectionNone;
+    for (uint32_t i = 0; i < reflectedBlocks.size(); ++i)
+      if (reflectedBlocks[i].varId == resource.varId)
+        binding.Block = i;
+    bindings.push_back(binding);
+  }
+
+  llvm::SmallVector<hlsl::SpirvReflectionBlock, 4> blocks;
+  llvm::SmallVector<hlsl::SpirvReflectionMember, 16> members;
+  for (const auto &reflected : reflectedBlocks) {
+    hlsl::SpirvReflectionBlock block = {};
+    block.Name = addString(reflected.name);
+    block.StorageClass = static_cast<uint32_t>(reflected.storageClass);
+    block.Size = reflected.size;
+    block.FirstMember = members.size();
+    block.MemberCount = reflected.members.size();
+    block.Flags = reflected.flags;
+    for (uint32_t i = 0; i < reflected.members.size(); ++i) {
+      members.push_back(reflected.members[i]);
+      members.back().Name = addString(reflected.memberNames[i]);
+    }
+    blocks.push_back(block);
+  }
+
+  llvm::SmallVector<hlsl::SpirvReflectionStageVar, 8> vars;
+  for (const auto &stageVar : stageVars) {
+    hlsl::SpirvReflectionStageVar var = {};
+    var.Semantic = addString(stageVar.getSemanticName());
+    var.SemanticIndex = stageVar.getSemanticIndex();
+    var.StorageClass = static_cast<uint32_t>(stageVar.getStorageClass());
+    var.Location = hlsl::SpirvReflectionNone;
+    const auto found = stageVarLocations.find(stageVar.getSpirvId());
+    if (found != stageVarLocations.end())
+      var.Location = found->second;
+    var.LocationCount = stageVar.getLocationCount();
+    vars.push_back(var);
+  }
+
+  // The tables follow the header in the order they are declared in it.
+  uint32_t offset = sizeof(header);
+  const auto placeTable = [&offset](hlsl::SpirvReflectionTable &table,
+                                    uint32_t count, uint32_t recordSize) {
+    table.Offset = offset;
+    table.Count = count;
+    offset += count * recordSize;
+  };
+  placeTable(header.Bindings, bindings.size(), sizeof(bindings[0]));
+  placeTable(header.Blocks, blocks.size(), sizeof(blocks[0]));
+  placeTable(header.Members, members.size(), sizeof(members[0]));
+  placeTable(header.StageVars, vars.size(), sizeof(vars[0]));
+  placeTable(header.Strings, strings.size(), 1);
+
+  out->clear();
+  out->reserve(offset);
+  appendRecord(out, header);
+  for (const auto &binding : bindings)
+    appendRecord(out, binding);
+  for (const auto &block : blocks)
+    appendRecord(out, block);
+  for (const auto &member : members)
+    appendRecord(out, member);
+  for (const auto &var : vars)
+    appendRecord(out, var);
+  out->append(strings);
+}
+
+void DeclResultIdMapper::decorateDSetBinding(uint32_t varId, uint32_t setNo,
+                                             uint32_t bindingNo) {
+  theBuilder.decorateDSetBinding(varId, setNo, bindingNo);
+  resourceBindings[varId] = std::make_pair(setNo, bindingNo);
+}
+
+void DeclResultIdMapper::decorateLocation(uint32_t varId, uint32_t location) {
+  theBuilder.decorateLocation(varId, location);
+  stageVarLocations[varId] = location;
+}
+
+void DeclResultIdMapper::reflectResource(uint32_t varId, llvm::StringRef name,
+                                         QualType type) {
+  if (!spirvOptions.reflectionSidecar)
+    return;
+
+  uint32_t arraySize = 1;
+  while (const auto *arrayType = astContext.getAsConstantArrayType(type)) {
+    arraySize *= static_cast<uint32_t>(arrayType->getSize().getZExtValue());
+    type = arrayType->getElementType();
+  }
+  reflectResource(varId, name, getDescriptorType(type), arraySize);
+}
+
+void DeclResultIdMapper::reflectResource(
+    uint32_t varId, llvm::StringRef name,
+    hlsl::SpirvDescriptorType descriptorType, uint32_t arraySize) {
+  if (spirvOptions.reflectionSidecar)
+    reflectedResources.push_back({varId, name.str(), descriptorType, arraySize});
+}
+
 bool DeclResultIdMapper::createStageVars(const hlsl::SigPoint *sigPoint,
                                          const NamedDecl *decl, bool asInput,
                                          QualType type, uint32_t arraySize,
@@ -1315,6 +1636,7 @@ bool DeclResultIdMapper::createStageVars(const hlsl::SigPoint *sigPoint,
 
     stageVar.setSpirvId(varId);
     stageVar.setLocationAttr(decl->getAttr<VKLocationAttr>());
+    stageVar.setEntryFunctionId(entryFunctionId);
     stageVars.push_back(stageVar);
 
     // Emit OpDecorate* instructions to link this stage variable with the HLSL
@@ -16,6 +16,7 @@
 #include "dxc/HLSL/DxilSemantic.h"
 #include "dxc/HLSL/DxilShaderModel.h"
 #include "dxc/HLSL/DxilSigPoint.h"
+#include "dxc/Support/SpirvReflection.h"
 #include "spirv/unified1/spirv.hpp11"
 #include "clang/AST/Attr.h"
 #include "clang/SPIRV/EmitSPIRVOptions.h"
@@ -44,7 +45,7 @@ public:
         semanticName(semaName), semanticIndex(semaIndex), builtinAttr(builtin),
         typeId(type), valueId(0), isBuiltin(false),
         storageClass(spv::StorageClass::Max), location(nullptr),
-        locationCount(locCount) {
+        locationCount(locCount), entryFunctionId(0) {
     isBuiltin = builtinAttr != nullptr;
   }
 
@@ -59,6 +60,7 @@ public:
   const VKBuiltInAttr *getBuiltInAttr() const { return builtinAttr; }
 
   std::string getSemanticStr() const;
+  llvm::StringRef getSemanticName() const { return semanticName; }
   uint32_t getSemanticIndex() const { return semanticIndex; }
 
   bool isSpirvBuitin() const { return isBuiltin; }
@@ -72,6 +74,9 @@ public:
 
   uint32_t getLocationCount() const { return locationCount; }
 
+  uint32_t getEntryFunctionId() const { return entryFunctionId; }
+  void setEntryFunctionId(uint32_t id) { entryFunctionId = id; }
+
 private:
   /// HLSL SigPoint. It uniquely identifies each set of parameters that may be
   /// input or output for each entry point.
@@ -98,6 +103,9 @@ private:
   const VKLocationAttr *location;
   /// How many locations this stage variable takes.
   uint32_t locationCount;
+  /// <result-id> of the entry function this stage variable is created for.
+  /// Zero for builtins shared by all entry functions.
+  uint32_t entryFunctionId;
 };
 
 class ResourceVar {
@@ -319,6 +327,18 @@ public:
   /// \brief Creates a PushConstant block from the given decl.
   uint32_t createPushConstant(const VarDecl *decl);
 
+  /// \brief Chooses the cbuffer that createCTBuffer makes a PushConstant
+  /// block instead of a uniform buffer, for -fvk-auto-push-constant. Must be
+  /// called before any cbuffer is created.
+  ///
+  /// The cbuffer is the smallest one the given entry functions, or the
+  /// functions they call, use, if it takes at most the size in the options
+  /// under the push constant layout. cbuffers with [[vk::binding]] keep
+  /// their descriptor, and none is chosen if the source declares a push
+  /// constant block already, since an entry point can only use one.
+  void selectAutoPushConstant(const TranslationUnitDecl *tu,
+                              llvm::ArrayRef<const DeclaratorDecl *> entries);
+
   /// \brief Creates the $Globals cbuffer.
   void createGlobalsCBuffer(const VarDecl *var);
 
@@ -337,8 +357,12 @@ public:
                                               bool *shouldBeAlias = nullptr,
                                               SpirvEvalInfo *info = nullptr);
 
-  /// \brief Sets the <result-id> of the entry function.
-  void setEntryFunctionId(uint32_t id) { entryFunctionId = id; }
+  /// \brief Sets the <result-id> of the entry function. Stage variables
+  /// created afterwards belong to it.
+  void setEntryFunctionId(uint32_t id) {
+    entryFunctionId = id;
+    entryFunctionIds.push_back(id);
+  }
 
 private:
   /// The struct containing SPIR-V information of a AST Decl.
@@ -408,8 +432,8 @@ public:
   uint32_t getCTBufferPushConstantTypeId(const DeclContext *decl);
 
   /// \brief Returns all defined stage (builtin/input/ouput) variables in this
-  /// mapper.
-  std::vector<uint32_t> collectStageVars() const;
+  /// mapper for the entry function with the given <result-id>.
+  std::vector<uint32_t> collectStageVars(uint32_t entryId) const;
 
   /// \brief Writes out the contents in the function parameter for the GS
   /// stream output to the corresponding stage output variables in a recursive
@@ -425,7 +449,8 @@ public:
                              uint32_t value);
 
   /// \brief Decorates all stage input and output variables with proper
-  /// location and returns true on success.
+  /// location and returns true on success. Locations are assigned for each
+  /// entry function separately.
   ///
   /// This method will write the location assignment into the module under
   /// construction.
@@ -438,6 +463,14 @@ public:
   /// module under construction.
   bool decorateResourceBindings();
 
+  /// \brief Writes the reflection sidecar laid out in SpirvReflection.h for
+  /// the entry point into out. Must be called after the resource bindings and
+  /// stage IO locations have been decorated, and only if the sidecar was
+  /// requested in the options.
+  void writeReflectionSidecar(spv::ExecutionModel model,
+                              llvm::StringRef entryName,
+                              std::string *out) const;
+
   bool requiresLegalization() const { return needsLegalization; }
 
 private:
@@ -480,7 +513,7 @@ private:
 
   /// \brief Checks whether some semantic is used more than once and returns
   /// true if no such cases. Returns false otherwise.
-  bool checkSemanticDuplication(bool forInput);
+  bool checkSemanticDuplication(uint32_t entryId, bool forInput);
 
   /// \brief Decorates all stage input (if forInput is true) or output (if
   /// forInput is false) variables with proper location and returns true on
@@ -488,7 +521,13 @@ private:
   ///
   /// This method will write the location assignment into the module under
   /// construction.
-  bool finalizeStageIOLocations(bool forInput);
+  bool finalizeStageIOLocations(uint32_t entryId, bool forInput);
+
+  /// \brief Returns true if the given stage variable is in the interface of
+  /// the entry function with the given <result-id>.
+  static bool isStageVarOf(const StageVar &var, uint32_t entryId) {
+    return var.getEntryFunctionId() == 0 || var.getEntryFunctionId() == entryId;
+  }
 
   /// \brief Wraps the given matrix type with a struct and returns the struct
   /// type's <result-id>.
@@ -611,6 +650,21 @@ private:
   /// Returns true if the given SPIR-V stage variable has Input storage class.
   inline bool isInputStorageClass(const StageVar &v);
 
+  /// Decorates varId with the given set and binding numbers, remembering them
+  /// for the reflection sidecar.
+  void decorateDSetBinding(uint32_t varId, uint32_t setNo, uint32_t bindingNo);
+
+  /// Decorates the stage variable varId with the given location, remembering
+  /// it for the reflection sidecar.
+  void decorateLocation(uint32_t varId, uint32_t location);
+
+  /// Records the descriptor of the resource variable varId of the given type
+  /// for the reflection sidecar, if one was requested.
+  void reflectResource(uint32_t varId, llvm::StringRef name, QualType type);
+  void reflectResource(uint32_t varId, llvm::StringRef name,
+                       hlsl::SpirvDescriptorType descriptorType,
+                       uint32_t arraySize);
+
 private:
   const hlsl::ShaderModel &shaderModel;
   ModuleBuilder &theBuilder;
@@ -622,6 +676,8 @@ private:
   FeatureManager &featureManager;
 
   uint32_t entryFunctionId;
+  /// <result-id>s of all the entry functions, in translation order.
+  llvm::SmallVector<uint32_t, 1> entryFunctionIds;
 
   /// Mapping of all Clang AST decls to their <result-id>s.
   llvm::DenseMap<const ValueDecl *, DeclSpirvInfo> astDecls;
@@ -637,6 +693,35 @@ private:
   llvm::DenseMap<const ValueDecl *, uint32_t> stageVarIds;
   /// Vector of all defined resource variables.
   llvm::SmallVector<ResourceVar, 8> resourceVars;
+
+  /// What the reflection sidecar lists about a resource variable.
+  struct ReflectedResource {
+    uint32_t varId;
+    std::string name;
+    hlsl::SpirvDescriptorType descriptorType;
+    uint32_t arraySize;
+  };
+  /// What the reflection sidecar lists about a cbuffer, tbuffer or push
+  /// constant block variable.
+  struct ReflectedBlock {
+    uint32_t varId;
+    std::string name;
+    spv::StorageClass storageClass;
+    uint32_t size;
+    uint32_t flags; ///< hlsl::SpirvReflectionBlockFlags
+    llvm::SmallVector<hlsl::SpirvReflectionMember, 8> members;
+    llvm::SmallVector<std::string, 8> memberNames;
+  };
+  /// Resources and blocks in the order they were created. Only filled in
+  /// when a reflection sidecar was requested.
+  llvm::SmallVector<ReflectedResource, 8> reflectedResources;
+  llvm::SmallVector<ReflectedBlock, 4> reflectedBlocks;
+  /// The cbuffer chosen by selectAutoPushConstant, if any.
+  const HLSLBufferDecl *autoPushConstant;
+  /// Mapping from resource variables' <result-id>s to their (set, binding).
+  llvm::DenseMap<uint32_t, std::pair<uint32_t, uint32_t>> resourceBindings;
+  /// Mapping from stage variables' <result-id>s to their locations.
+  llvm::DenseMap<uint32_t, uint32_t> stageVarLocations;
   /// Mapping from {RW|Append|Consume}StructuredBuffers to their
   /// counter variables' (<result-id>, is-alias-or-not) pairs
   ///
@@ -730,12 +815,17 @@ DeclResultIdMapper::DeclResultIdMapper(const hlsl::ShaderModel &model,
     : shaderModel(model), theBuilder(builder), spirvOptions(options),
       astContext(context), diags(context.getDiagnostics()),
       typeTranslator(translator), featureManager(features), entryFunctionId(0),
-      laneCountBuiltinId(0), laneIndexBuiltinId(0), needsLegalization(false),
+      autoPushConstant(nullptr), laneCountBuiltinId(0), laneIndexBuiltinId(0), needsLegalization(false),
       glPerVertex(model, context, builder, typeTranslator, options.invertY) {}
 
 bool DeclResultIdMapper::decorateStageIOLocations() {
-  // Try both input and output even if input location assignment failed
-  return finalizeStageIOLocations(true) & finalizeStageIOLocations(false);
+  bool success = true;
+  for (uint32_t entryId : entryFunctionIds) {
+    // Try both input and output even if input location assignment failed
+    success = finalizeStageIOLocations(entryId, true) &
+              finalizeStageIOLocations(entryId, false) && success;
+  }
+  return success;
 }
 
 bool DeclResultIdMapper::isInputStorageClass(const StageVar &v) {
@@ -299,19 +299,23 @@ Decoration::getHlslSemanticGOOGLE(SPIRVContext &context,
 
 std::vector<uint32_t> Decoration::withTargetId(uint32_t targetId) const {
   std::vector<uint32_t> words;
+  appendWithTargetId(targetId, &words);
+  return words;
+}
 
+void Decoration::appendWithTargetId(uint32_t targetId,
+                                    std::vector<uint32_t> *words) const {
   // TODO: we are essentially duplicate the work InstBuilder is responsible for.
   // Should figure out a way to unify them.
-  words.reserve(3 + args.size() + (memberIndex.hasValue() ? 1 : 0));
-  words.push_back(static_cast<uint32_t>(getDecorateOpcode(id, memberIndex)));
-  words.push_back(targetId);
+  const uint32_t wordCount =
+      3 + args.size() + (memberIndex.hasValue() ? 1 : 0);
+  words->push_back(static_cast<uint32_t>(getDecorateOpcode(id, memberIndex)) |
+                   (wordCount << 16));
+  words->push_back(targetId);
   if (memberIndex.hasValue())
-    words.push_back(*memberIndex);
-  words.push_back(static_cast<uint32_t>(id));
-  words.insert(words.end(), args.begin(), args.end());
-  words.front() |= static_cast<uint32_t>(words.size()) << 16;
-
-  return words;
+    words->push_back(*memberIndex);
+  words->push_back(static_cast<uint32_t>(id));
+  words->insert(words->end(), args.begin(), args.end());
 }
 
 spv::Op
@@ -374,7 +374,7 @@ uint32_t GlPerVertex::createBlockVar(bool asInput, uint32_t arraySize) {
 
   // Handle the extra arrayness over the block
   if (arraySize != 0) {
-    const uint32_t arraySizeId = theBuilder.getConstantUint32(arraySize);
+    const uint32_t arraySizeId = getUint32Constant(arraySize);
     typeId = theBuilder.getArrayType(typeId, arraySizeId);
   }
 
@@ -396,7 +396,7 @@ uint32_t GlPerVertex::createPositionVar(bool asInput) {
 
 uint32_t GlPerVertex::createClipDistanceVar(bool asInput, uint32_t arraySize) {
   const uint32_t type = theBuilder.getArrayType(
-      theBuilder.getFloat32Type(), theBuilder.getConstantUint32(arraySize));
+      theBuilder.getFloat32Type(), getUint32Constant(arraySize));
   spv::StorageClass sc =
       asInput ? spv::StorageClass::Input : spv::StorageClass::Output;
 
@@ -409,7 +409,7 @@ uint32_t GlPerVertex::createClipDistanceVar(bool asInput, uint32_t arraySize) {
 
 uint32_t GlPerVertex::createCullDistanceVar(bool asInput, uint32_t arraySize) {
   const uint32_t type = theBuilder.getArrayType(
-      theBuilder.getFloat32Type(), theBuilder.getConstantUint32(arraySize));
+      theBuilder.getFloat32Type(), getUint32Constant(arraySize));
   spv::StorageClass sc =
       asInput ? spv::StorageClass::Input : spv::StorageClass::Output;
 
@@ -501,7 +501,7 @@ uint32_t GlPerVertex::readPositionOrPointSize(bool isPosition) const {
       isPosition ? theBuilder.getVecType(f32Type, 4) : f32Type;
   const uint32_t ptrType =
       theBuilder.getPointerType(fieldType, spv::StorageClass::Input);
-  const uint32_t fieldIndex = theBuilder.getConstantUint32(isPosition ? 0 : 1);
+  const uint32_t fieldIndex = getUint32Constant(isPosition ? 0 : 1);
 
   if (inArraySize == 0) {
     // The input builtin block is a single block. Only need one index to
@@ -516,7 +516,7 @@ uint32_t GlPerVertex::readPositionOrPointSize(bool isPosition) const {
 
   llvm::SmallVector<uint32_t, 8> elements;
   for (uint32_t i = 0; i < inArraySize; ++i) {
-    const uint32_t arrayIndex = theBuilder.getConstantUint32(i);
+    const uint32_t arrayIndex = getUint32Constant(i);
     // Get pointer into the array of structs. We need two indices to locate
     // the Position/PointSize builtin now: the first one is the array index,
     // and the second one is the struct index.
@@ -526,7 +526,7 @@ uint32_t GlPerVertex::readPositionOrPointSize(bool isPosition) const {
   }
   // Construct a new array of float4/float for the Position/PointSize builtins
   const uint32_t arrayType = theBuilder.getArrayType(
-      fieldType, theBuilder.getConstantUint32(inArraySize));
+      fieldType, getUint32Constant(inArraySize));
   return theBuilder.createCompositeConstruct(arrayType, elements);
 }
 
@@ -549,13 +549,13 @@ uint32_t GlPerVertex::readClipCullArrayAsType(bool isClip, uint32_t offset,
     uint32_t count = {};
 
     if (TypeTranslator::isScalarType(asType)) {
-      const uint32_t offsetId = theBuilder.getConstantUint32(offset);
+      const uint32_t offsetId = getUint32Constant(offset);
       uint32_t ptr = 0;
 
       if (inIsGrouped) {
         ptr = theBuilder.createAccessChain(
             ptrType, inBlockVar,
-            {theBuilder.getConstantUint32(clipCullIndex), offsetId});
+            {getUint32Constant(clipCullIndex), offsetId});
       } else {
         ptr = theBuilder.createAccessChain(
             ptrType, clipCullIndex == 2 ? inClipVar : inCullVar, {offsetId});
@@ -569,13 +569,13 @@ uint32_t GlPerVertex::readClipCullArrayAsType(bool isClip, uint32_t offset,
       llvm::SmallVector<uint32_t, 4> elements;
       for (uint32_t i = 0; i < count; ++i) {
         // Read elements sequentially from the float array
-        const uint32_t offsetId = theBuilder.getConstantUint32(offset + i);
+        const uint32_t offsetId = getUint32Constant(offset + i);
         uint32_t ptr = 0;
 
         if (inIsGrouped) {
           ptr = theBuilder.createAccessChain(
               ptrType, inBlockVar,
-              {theBuilder.getConstantUint32(clipCullIndex), offsetId});
+              {getUint32Constant(clipCullIndex), offsetId});
         } else {
           ptr = theBuilder.createAccessChain(
               ptrType, clipCullIndex == 2 ? inClipVar : inCullVar, {offsetId});
@@ -603,16 +603,16 @@ uint32_t GlPerVertex::readClipCullArrayAsType(bool isClip, uint32_t offset,
   QualType elemType = {};
   uint32_t count = {};
   uint32_t arrayType = {};
-  uint32_t arraySize = theBuilder.getConstantUint32(inArraySize);
+  uint32_t arraySize = getUint32Constant(inArraySize);
 
   if (TypeTranslator::isScalarType(asType)) {
     arrayType = theBuilder.getArrayType(f32Type, arraySize);
     for (uint32_t i = 0; i < inArraySize; ++i) {
       const uint32_t ptr = theBuilder.createAccessChain(
           ptrType, inBlockVar,
-          {theBuilder.getConstantUint32(i), // Block array index
-           theBuilder.getConstantUint32(clipCullIndex),
-           theBuilder.getConstantUint32(offset)});
+          {getUint32Constant(i), // Block array index
+           getUint32Constant(clipCullIndex),
+           getUint32Constant(offset)});
       arrayElements.push_back(theBuilder.createLoad(f32Type, ptr));
     }
   } else if (TypeTranslator::isVectorType(asType, &elemType, &count)) {
@@ -624,10 +624,10 @@ uint32_t GlPerVertex::readClipCullArrayAsType(bool isClip, uint32_t offset,
       for (uint32_t j = 0; j < count; ++j) {
         const uint32_t ptr = theBuilder.createAccessChain(
             ptrType, inBlockVar,
-            {theBuilder.getConstantUint32(i), // Block array index
-             theBuilder.getConstantUint32(clipCullIndex),
+            {getUint32Constant(i), // Block array index
+             getUint32Constant(clipCullIndex),
              // Read elements sequentially from the float array
-             theBuilder.getConstantUint32(offset + j)});
+             getUint32Constant(offset + j)});
         vecElements.push_back(theBuilder.createLoad(f32Type, ptr));
       }
       arrayElements.push_back(theBuilder.createCompositeConstruct(
@@ -641,8 +641,29 @@ uint32_t GlPerVertex::readClipCullArrayAsType(bool isClip, uint32_t offset,
   return theBuilder.createCompositeConstruct(arrayType, arrayElements);
 };
 
+uint32_t GlPerVertex::getUint32Constant(uint32_t value) const {
+  uint32_t &constant = uint32Constants[value];
+  if (!constant)
+    constant = theBuilder.getConstantUint32(value);
+  return constant;
+}
+
 bool GlPerVertex::readField(hlsl::Semantic::Kind semanticKind,
                             uint32_t semanticIndex, uint32_t *value) {
+  uint32_t &inputValue = inputValues[std::make_pair(
+      static_cast<uint32_t>(semanticKind), semanticIndex)];
+  if (inputValue) {
+    *value = inputValue;
+    return true;
+  }
+  if (!doReadField(semanticKind, semanticIndex, value))
+    return false;
+  inputValue = *value;
+  return true;
+}
+
+bool GlPerVertex::doReadField(hlsl::Semantic::Kind semanticKind,
+                              uint32_t semanticIndex, uint32_t *value) {
   switch (semanticKind) {
   case hlsl::Semantic::Kind::Position:
     *value = readPositionOrPointSize(/*isPosition=*/true);
@@ -683,7 +704,7 @@ void GlPerVertex::writePositionOrPointSize(
       isPosition ? theBuilder.getVecType(f32Type, 4) : f32Type;
   const uint32_t ptrType =
       theBuilder.getPointerType(fieldType, spv::StorageClass::Output);
-  const uint32_t fieldIndex = theBuilder.getConstantUint32(isPosition ? 0 : 1);
+  const uint32_t fieldIndex = getUint32Constant(isPosition ? 0 : 1);
 
   if (outArraySize == 0) {
     // The input builtin block is a single block. Only need one index to
@@ -743,13 +764,13 @@ void GlPerVertex::writeClipCullArrayFromType(
     uint32_t count = {};
 
     if (TypeTranslator::isScalarType(fromType)) {
-      const uint32_t offsetId = theBuilder.getConstantUint32(offset);
+      const uint32_t offsetId = getUint32Constant(offset);
       uint32_t ptr = 0;
 
       if (outIsGrouped) {
         ptr = theBuilder.createAccessChain(
             ptrType, outBlockVar,
-            {theBuilder.getConstantUint32(clipCullIndex), offsetId});
+            {getUint32Constant(clipCullIndex), offsetId});
       } else {
         ptr = theBuilder.createAccessChain(
             ptrType, clipCullIndex == 2 ? outClipVar : outCullVar, {offsetId});
@@ -763,13 +784,13 @@ void GlPerVertex::writeClipCullArrayFromType(
       // type. We need to write each component in the vector out.
       for (uint32_t i = 0; i < count; ++i) {
         // Write elements sequentially into the float array
-        const uint32_t offsetId = theBuilder.getConstantUint32(offset + i);
+        const uint32_t offsetId = getUint32Constant(offset + i);
         uint32_t ptr = 0;
 
         if (outIsGrouped) {
           ptr = theBuilder.createAccessChain(
               ptrType, outBlockVar,
-              {theBuilder.getConstantUint32(clipCullIndex), offsetId});
+              {getUint32Constant(clipCullIndex), offsetId});
         } else {
           ptr = theBuilder.createAccessChain(
               ptrType, clipCullIndex == 2 ? outClipVar : outCullVar,
@@ -809,8 +830,8 @@ void GlPerVertex::writeClipCullArrayFromType(
     const uint32_t ptr = theBuilder.createAccessChain(
         ptrType, outBlockVar,
         {arrayIndex, // Block array index
-         theBuilder.getConstantUint32(clipCullIndex),
-         theBuilder.getConstantUint32(offset)});
+         getUint32Constant(clipCullIndex),
+         getUint32Constant(offset)});
     theBuilder.createStore(ptr, fromValue);
     return;
   }
@@ -821,9 +842,9 @@ void GlPerVertex::writeClipCullArrayFromType(
       const uint32_t ptr = theBuilder.createAccessChain(
           ptrType, outBlockVar,
           {arrayIndex, // Block array index
-           theBuilder.getConstantUint32(clipCullIndex),
+           getUint32Constant(clipCullIndex),
            // Write elements sequentially into the float array
-           theBuilder.getConstantUint32(offset + i)});
+           getUint32Constant(offset + i)});
       const uint32_t subValue =
           theBuilder.createCompositeExtract(f32Type, fromValue, {i});
       theBuilder.createStore(ptr, subValue);
@@ -135,9 +135,13 @@ private:
   /// into the given type asType.
   uint32_t readClipCullArrayAsType(bool isClip, uint32_t offset,
                                    QualType asType) const;
-  /// Emits SPIR-V instructions to read a field in gl_PerVertex.
+  /// Emits SPIR-V instructions to read a field in gl_PerVertex, or returns
+  /// the value read before.
   bool readField(hlsl::Semantic::Kind semanticKind, uint32_t semanticIndex,
                  uint32_t *value);
+  /// Internal implementation for readField().
+  bool doReadField(hlsl::Semantic::Kind semanticKind, uint32_t semanticIndex,
+                   uint32_t *value);
 
   /// Emits SPIR-V instructions for writing the Position/PointSize builtin.
   void writePositionOrPointSize(bool isPosition,
@@ -158,6 +162,10 @@ private:
   bool doGlPerVertexFacts(const DeclaratorDecl *decl, QualType type,
                           bool asInput);
 
+  /// Returns the <result-id> of the given uint constant. The accesses into
+  /// gl_PerVertex ask for the same few indices over and over.
+  uint32_t getUint32Constant(uint32_t value) const;
+
 private:
   using SemanticIndexToTypeMap = llvm::DenseMap<uint32_t, QualType>;
   using SemanticIndexToArrayOffsetMap = llvm::DenseMap<uint32_t, uint32_t>;
@@ -222,6 +230,14 @@ private:
   /// builtins in gl_PerVertex.
   llvm::SmallVector<std::string, 4> inSemanticStrs;
   llvm::SmallVector<std::string, 4> outSemanticStrs;
+
+  /// Mapping from uint values to the <result-id>s of their constants.
+  mutable llvm::DenseMap<uint32_t, uint32_t> uint32Constants;
+  /// Mapping from (semantic kind, semantic index) to the <result-id> of the
+  /// value read from the input builtins. Inputs are read-only and are only
+  /// read at the start of the entry function wrapper, so a value that was
+  /// composed once can be handed out again.
+  llvm::DenseMap<std::pair<uint32_t, uint32_t>, uint32_t> inputValues;
 };
 
 } // end namespace spirv
@@ -13,6 +13,7 @@
 #include "spirv/unified1//spirv.hpp11"
 #include "clang/SPIRV/BitwiseCast.h"
 #include "clang/SPIRV/InstBuilder.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/llvm_assert/assert.h"
 
 namespace clang {
@@ -23,8 +24,10 @@ ModuleBuilder::ModuleBuilder(SPIRVContext *C, FeatureManager *features,
     : theContext(*C), featureManager(features), allowReflect(reflect),
       theModule(), theFunction(nullptr), insertPoint(nullptr),
       instBuilder(nullptr), glslExtSetId(0) {
+  // Copy the words into the context instead of taking them, so that the
+  // InstBuilder keeps reusing its buffer.
   instBuilder.setConsumer([this](std::vector<uint32_t> &&words) {
-    this->constructSite = std::move(words);
+    this->constructSite = Instruction(&theContext, words);
   });
 
   // Set the SPIR-V version if needed.
@@ -35,7 +38,10 @@ ModuleBuilder::ModuleBuilder(SPIRVContext *C, FeatureManager *features,
 std::vector<uint32_t> ModuleBuilder::takeModule() {
   theModule.setBound(theContext.getNextId());
 
+  // Most words were allocated in the context; the rest are types, constants,
+  // decorations and names.
   std::vector<uint32_t> binary;
+  binary.reserve(theContext.getAllocatedWordCount() * 5 / 4);
   auto ib = InstBuilder([&binary](std::vector<uint32_t> &&words) {
     binary.insert(binary.end(), words.begin(), words.end());
   });
@@ -44,6 +50,16 @@ std::vector<uint32_t> ModuleBuilder::takeModule() {
   return binary;
 }
 
+void ModuleBuilder::takeModule(llvm::raw_ostream &out) {
+  theModule.setBound(theContext.getNextId());
+
+  auto ib = InstBuilder([&out](std::vector<uint32_t> &&words) {
+    out.write(reinterpret_cast<const char *>(words.data()), words.size() * 4);
+  });
+
+  theModule.take(&ib);
+}
+
 uint32_t ModuleBuilder::beginFunction(uint32_t funcType, uint32_t returnType,
                                       llvm::StringRef funcName, uint32_t fId) {
   if (theFunction) {
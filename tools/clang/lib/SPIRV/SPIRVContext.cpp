@@ -7,6 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <tuple>
 
 #include "clang/SPIRV/SPIRVContext.h"
@@ -74,5 +75,13 @@ const Decoration *SPIRVContext::registerDecoration(const Decoration &d) {
   return &*it;
 }
 
+llvm::ArrayRef<uint32_t>
+SPIRVContext::allocateWords(llvm::ArrayRef<uint32_t> words) {
+  uint32_t *storage = wordAllocator.Allocate<uint32_t>(words.size());
+  std::copy(words.begin(), words.end(), storage);
+  allocatedWordCount += words.size();
+  return llvm::ArrayRef<uint32_t>(storage, words.size());
+}
+
 } // end namespace spirv
 } // end namespace clang
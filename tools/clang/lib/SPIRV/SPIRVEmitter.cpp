@@ -217,7 +217,11 @@ bool spirvToolsLegalize(spv_target_env env, std::vector<uint32_t> *module,
   return optimizer.Run(module->data(), module->size(), module);
 }
 
+/// Runs the SPIRV-Tools optimization recipe for the given optimization level:
+/// -O1 runs a short list of cleanup passes, -O2 and above run the performance
+/// recipe, and optimizeSize selects the size recipe instead.
 bool spirvToolsOptimize(spv_target_env env, std::vector<uint32_t> *module,
+                        unsigned optLevel, bool optimizeSize,
                         std::string *messages) {
   spvtools::Optimizer optimizer(env);
 
@@ -226,7 +230,21 @@ bool spirvToolsOptimize(spv_target_env env, std::vector<uint32_t> *module,
                  const spv_position_t & /*position*/,
                  const char *message) { *messages += message; });
 
-  optimizer.RegisterPerformancePasses();
+  if (optimizeSize) {
+    optimizer.RegisterSizePasses();
+  } else if (optLevel == 1) {
+    optimizer.RegisterPass(spvtools::CreateInlineExhaustivePass())
+        .RegisterPass(spvtools::CreateLocalSingleBlockLoadStoreElimPass())
+        .RegisterPass(spvtools::CreateLocalSingleStoreElimPass())
+        .RegisterPass(spvtools::CreateFoldSpecConstantOpAndCompositePass())
+        .RegisterPass(spvtools::CreateDeadBranchElimPass())
+        .RegisterPass(spvtools::CreateAggressiveDCEPass())
+        .RegisterPass(spvtools::CreateEliminateDeadFunctionsPass())
+        .RegisterPass(spvtools::CreateUnifyConstantPass())
+        .RegisterPass(spvtools::CreateEliminateDeadConstantPass());
+  } else {
+    optimizer.RegisterPerformancePasses();
+  }
 
   optimizer.RegisterPass(spvtools::CreateCompactIdsPass());
 
@@ -533,12 +551,25 @@ std::string getFnName(const FunctionDecl *fn) {
   return getNamespacePrefix(fn) + classOrStructName + fn->getName().str();
 }
 
+/// Returns the entry function given to the compiler followed by the other
+/// entry points requested with -E.
+std::vector<std::string>
+getEntryFunctionNames(const CompilerInstance &ci,
+                      const EmitSPIRVOptions &options) {
+  std::vector<std::string> names;
+  names.push_back(ci.getCodeGenOpts().HLSLEntryFunction);
+  for (const auto name : options.entryPoints)
+    if (std::find(names.begin(), names.end(), name) == names.end())
+      names.push_back(name);
+  return names;
+}
+
 } // namespace
 
 SPIRVEmitter::SPIRVEmitter(CompilerInstance &ci, EmitSPIRVOptions &options)
     : theCompilerInstance(ci), astContext(ci.getASTContext()),
       diags(ci.getDiagnostics()), spirvOptions(options),
-      entryFunctionName(ci.getCodeGenOpts().HLSLEntryFunction),
+      entryFunctionNames(getEntryFunctionNames(ci, options)),
       shaderModel(*hlsl::ShaderModel::GetByName(
           ci.getCodeGenOpts().HLSLProfile.c_str())),
       theContext(), featureManager(diags, options),
@@ -556,6 +587,15 @@ SPIRVEmitter::SPIRVEmitter(CompilerInstance &ci, EmitSPIRVOptions &options)
       !shaderModel.IsGS())
     emitError("-fvk-invert-y can only be used in VS/DS/GS", {});
 
+  // Stage variables of other stages, like gl_PerVertex, are shared by the
+  // whole module.
+  if (entryFunctionNames.size() > 1 && !shaderModel.IsPS() &&
+      !shaderModel.IsCS())
+    emitError("multiple entry points are only supported for PS and CS", {});
+
+  if (entryFunctionNames.size() > 1 && options.reflectionSidecar)
+    emitError("-fspv-reflect-sidecar requires a single entry point", {});
+
   if (options.useGlLayout && options.useDxLayout)
     emitError("cannot specify both -fvk-use-dx-layout and -fvk-use-gl-layout",
               {});
@@ -580,24 +620,36 @@ void SPIRVEmitter::HandleTranslationUnit(ASTContext &context) {
 
   TranslationUnitDecl *tu = context.getTranslationUnitDecl();
 
-  // The entry function is the seed of the queue.
-  for (auto *decl : tu->decls()) {
-    if (auto *funcDecl = dyn_cast<FunctionDecl>(decl)) {
-      if (funcDecl->getName() == entryFunctionName) {
+  // The entry functions are the seeds of the queue.
+  for (auto *decl : tu->decls())
+    if (auto *funcDecl = dyn_cast<FunctionDecl>(decl))
+      if (isEntryFunctionName(funcDecl->getName()))
         workQueue.insert(funcDecl);
-      }
-    } else {
-      // If ignoring unused resources, defer Decl handling inside
-      // TranslationUnit to the time of first referencing.
-      if (!spirvOptions.ignoreUnusedResources) {
+
+  // The cbuffer to promote depends on what the entry functions use, and
+  // must be known before any cbuffer is created.
+  if (spirvOptions.autoPushConstantSize)
+    declIdMapper.selectAutoPushConstant(
+        tu, std::vector<const DeclaratorDecl *>(workQueue.begin(),
+                                                workQueue.end()));
+
+  // If ignoring unused resources, defer Decl handling inside
+  // TranslationUnit to the time of first referencing.
+  if (!spirvOptions.ignoreUnusedResources)
+    for (auto *decl : tu->decls())
+      if (!isa<FunctionDecl>(decl))
         doDecl(decl);
-      }
-    }
-  }
 
   // Translate all functions reachable from the entry function.
   // The queue can grow in the meanwhile; so need to keep evaluating
   // workQueue.size().
+  //
+  // Functions are deliberately translated one at a time and in queue order:
+  // translating a function body allocates <result-id>s from theBuilder, and
+  // creates types, constants and module-scope variables on first use through
+  // declIdMapper and typeTranslator. The order of these side effects decides
+  // the ids and the module layout, so it must stay fixed for the output to be
+  // reproducible.
   for (uint32_t i = 0; i < workQueue.size(); ++i) {
     doDecl(workQueue[i]);
   }
@@ -605,6 +657,17 @@ void SPIRVEmitter::HandleTranslationUnit(ASTContext &context) {
   if (context.getDiagnostics().hasErrorOccurred())
     return;
 
+  // Sema only looks for the entry function of the compile.
+  if (entryFunctions.size() < entryFunctionNames.size()) {
+    for (const auto &name : entryFunctionNames)
+      if (std::none_of(entryFunctions.begin(), entryFunctions.end(),
+                       [&name](const std::pair<uint32_t, std::string> &e) {
+                         return e.second == name;
+                       }))
+        emitError("missing entry point definition for '%0'", {}) << name;
+    return;
+  }
+
   const spv_target_env targetEnv = featureManager.getTargetEnv();
 
   AddRequiredCapabilitiesForShaderModel();
@@ -613,8 +676,12 @@ void SPIRVEmitter::HandleTranslationUnit(ASTContext &context) {
   theBuilder.setAddressingModel(spv::AddressingModel::Logical);
   theBuilder.setMemoryModel(spv::MemoryModel::GLSL450);
 
-  theBuilder.addEntryPoint(getSpirvShaderStage(shaderModel), entryFunctionId,
-                           entryFunctionName, declIdMapper.collectStageVars());
+  // Entry functions share the functions, types and decorations of the module;
+  // each one lists only its own stage variables.
+  for (const auto &entry : entryFunctions)
+    theBuilder.addEntryPoint(getSpirvShaderStage(shaderModel), entry.first,
+                             entry.second,
+                             declIdMapper.collectStageVars(entry.first));
 
   // Add Location decorations to stage input/output variables.
   if (!declIdMapper.decorateStageIOLocations())
@@ -624,6 +691,21 @@ void SPIRVEmitter::HandleTranslationUnit(ASTContext &context) {
   if (!declIdMapper.decorateResourceBindings())
     return;
 
+  if (spirvOptions.reflectionSidecar)
+    declIdMapper.writeReflectionSidecar(getSpirvShaderStage(shaderModel),
+                                        entryFunctionNames.front(),
+                                        spirvOptions.reflectionSidecar);
+
+  // SPIRV-Tools works on the words of the whole module. If it isn't run, the
+  // module is written out instruction by instruction instead.
+  if (spirvOptions.disableValidation &&
+      (spirvOptions.codeGenHighLevel ||
+       (!needsLegalization && !declIdMapper.requiresLegalization() &&
+        theCompilerInstance.getCodeGenOpts().OptimizationLevel == 0))) {
+    theBuilder.takeModule(*theCompilerInstance.getOutStream());
+    return;
+  }
+
   // Output the constructed module.
   std::vector<uint32_t> m = theBuilder.takeModule();
 
@@ -644,9 +726,12 @@ void SPIRVEmitter::HandleTranslationUnit(ASTContext &context) {
     }
 
     // Run optimization passes
-    if (theCompilerInstance.getCodeGenOpts().OptimizationLevel > 0) {
+    const unsigned optLevel =
+        theCompilerInstance.getCodeGenOpts().OptimizationLevel;
+    if (optLevel > 0) {
       std::string messages;
-      if (!spirvToolsOptimize(targetEnv, &m, &messages)) {
+      if (!spirvToolsOptimize(targetEnv, &m, optLevel,
+                              spirvOptions.optimizeSize, &messages)) {
         emitFatalError("failed to optimize SPIR-V: %0", {}) << messages;
         emitNote("please file a bug report on "
                  "https://github.com/Microsoft/DirectXShaderCompiler/issues "
@@ -1015,16 +1100,18 @@ void SPIRVEmitter::doFunctionDecl(const FunctionDecl *decl) {
 
   uint32_t funcId = 0;
 
-  if (funcName == entryFunctionName) {
+  if (isEntryFunctionName(funcName)) {
     // The entry function surely does not have pre-assigned <result-id> for
     // it like other functions that got added to the work queue following
     // function calls.
     funcId = theContext.takeNextId();
+    const std::string entryName = funcName;
     funcName = "src." + funcName;
 
     // Create wrapper for the entry function
     if (!emitEntryFunctionWrapper(decl, funcId))
       return;
+    entryFunctions.push_back({entryFunctionId, entryName});
   } else {
     // Non-entry functions are added to the work queue following function
     // calls. We have already assigned <result-id>s for it when translating
@@ -1073,7 +1160,8 @@ void SPIRVEmitter::doFunctionDecl(const FunctionDecl *decl) {
   // Create all parameters.
   for (uint32_t i = 0; i < decl->getNumParams(); ++i) {
     const ParmVarDecl *paramDecl = decl->getParamDecl(i);
-    (void)declIdMapper.createFnParam(paramDecl);
+    decorateRelaxedPrecision(declIdMapper.createFnParam(paramDecl),
+                             paramDecl->getType());
   }
 
   if (decl->hasBody()) {
@@ -4547,6 +4635,7 @@ SpirvEvalInfo SPIRVEmitter::doUnaryOperator(const UnaryOperator *expr) {
       incValue = processEachVectorInMatrix(subExpr, originValue, actOnEachVec);
     } else {
       incValue = theBuilder.createBinaryOp(spvOp, subTypeId, originValue, one);
+      decorateRelaxedPrecision(incValue, subType);
     }
     theBuilder.createStore(subValue, incValue);
 
@@ -4557,6 +4646,7 @@ SpirvEvalInfo SPIRVEmitter::doUnaryOperator(const UnaryOperator *expr) {
   case UO_Not: {
     const auto valId =
         theBuilder.createUnaryOp(spv::Op::OpNot, subTypeId, subValue);
+    decorateRelaxedPrecision(valId, subType);
     return SpirvEvalInfo(valId).setRValue();
   }
   case UO_LNot: {
@@ -4574,6 +4664,7 @@ SpirvEvalInfo SPIRVEmitter::doUnaryOperator(const UnaryOperator *expr) {
     const spv::Op spvOp = isFloatOrVecOfFloatType(subType) ? spv::Op::OpFNegate
                                                            : spv::Op::OpSNegate;
     const auto valId = theBuilder.createUnaryOp(spvOp, subTypeId, subValue);
+    decorateRelaxedPrecision(valId, subType);
     return SpirvEvalInfo(valId).setRValue();
   }
   default:
@@ -4837,6 +4928,16 @@ void SPIRVEmitter::storeValue(const SpirvEvalInfo &lhsPtr,
              lhsIsNonFpMat) {
     theBuilder.createStore(
         lhsPtr, reconstructValue(rhsVal, lhsValType, lhsPtr.getLayoutRule()));
+
+    // A struct copied out of a buffer into a function variable is rebuilt
+    // member by member. Have SPIRV-Tools scalarize the copy and forward the
+    // members so that they are loaded from the buffer where they are used.
+    //
+    // Note: legalization specific code
+    if (lhsValType->isRecordType() &&
+        lhsPtr.getStorageClass() == spv::StorageClass::Function &&
+        rhsVal.getLayoutRule() != LayoutRule::Void)
+      needsLegalization = true;
   } else {
     emitError("storing value of type %0 unimplemented", {}) << lhsValType;
   }
@@ -5071,6 +5172,7 @@ SpirvEvalInfo SPIRVEmitter::processBinaryOp(const Expr *lhs, const Expr *rhs,
     if (BinaryOperator::isCompoundAssignmentOp(opcode)) {
       valId = theBuilder.createBinaryOp(
           spvOp, typeTranslator.translateType(computationType), lhsVal, rhsVal);
+      decorateRelaxedPrecision(valId, computationType);
       // For a compound assignments, the AST does not have the proper implicit
       // cast if lhs and rhs have different types. So we need to manually cast
       // the result back to lhs' type.
@@ -5079,6 +5181,7 @@ SpirvEvalInfo SPIRVEmitter::processBinaryOp(const Expr *lhs, const Expr *rhs,
     } else {
       valId = theBuilder.createBinaryOp(
           spvOp, typeTranslator.translateType(resultType), lhsVal, rhsVal);
+      decorateRelaxedPrecision(valId, resultType);
     }
 
     auto result = SpirvEvalInfo(valId).setRValue();
@@ -5095,6 +5198,12 @@ SpirvEvalInfo SPIRVEmitter::processBinaryOp(const Expr *lhs, const Expr *rhs,
   return 0;
 }
 
+void SPIRVEmitter::decorateRelaxedPrecision(uint32_t id, QualType type) {
+  if (spirvOptions.relaxedPrecision &&
+      TypeTranslator::isRelaxedPrecisionType(type, spirvOptions))
+    theBuilder.decorate(id, spv::Decoration::RelaxedPrecision);
+}
+
 void SPIRVEmitter::initOnce(QualType varType, std::string varName,
                             uint32_t varPtr, const Expr *varInit) {
   // For uninitialized resource objects, we do nothing since there is no
@@ -8362,7 +8471,10 @@ uint32_t SPIRVEmitter::processIntrinsicUsingGLSLInst(
       };
       return processEachVectorInMatrix(arg, argId, actOnEachVec);
     }
-    return theBuilder.createExtInst(returnType, glslInstSetId, opcode, {argId});
+    const uint32_t valId =
+        theBuilder.createExtInst(returnType, glslInstSetId, opcode, {argId});
+    decorateRelaxedPrecision(valId, callExpr->getType());
+    return valId;
   } else if (callExpr->getNumArgs() == 2u) {
     const Expr *arg0 = callExpr->getArg(0);
     const uint32_t arg0Id = doExpr(arg0);
@@ -8380,8 +8492,10 @@ uint32_t SPIRVEmitter::processIntrinsicUsingGLSLInst(
       };
       return processEachVectorInMatrix(arg0, arg0Id, actOnEachVec);
     }
-    return theBuilder.createExtInst(returnType, glslInstSetId, opcode,
-                                    {arg0Id, arg1Id});
+    const uint32_t valId = theBuilder.createExtInst(returnType, glslInstSetId,
+                                                    opcode, {arg0Id, arg1Id});
+    decorateRelaxedPrecision(valId, callExpr->getType());
+    return valId;
   } else if (callExpr->getNumArgs() == 3u) {
     const Expr *arg0 = callExpr->getArg(0);
     const uint32_t arg0Id = doExpr(arg0);
@@ -8402,8 +8516,10 @@ uint32_t SPIRVEmitter::processIntrinsicUsingGLSLInst(
       };
       return processEachVectorInMatrix(arg0, arg0Id, actOnEachVec);
     }
-    return theBuilder.createExtInst(returnType, glslInstSetId, opcode,
-                                    {arg0Id, arg1Id, arg2Id});
+    const uint32_t valId = theBuilder.createExtInst(
+        returnType, glslInstSetId, opcode, {arg0Id, arg1Id, arg2Id});
+    decorateRelaxedPrecision(valId, callExpr->getType());
+    return valId;
   }
 
   emitError("unsupported %0 intrinsic function", callExpr->getExprLoc())
@@ -9056,6 +9172,11 @@ bool SPIRVEmitter::processTessellationShaderAttributes(
   return true;
 }
 
+bool SPIRVEmitter::isEntryFunctionName(llvm::StringRef name) const {
+  return std::find(entryFunctionNames.begin(), entryFunctionNames.end(),
+                   name) != entryFunctionNames.end();
+}
+
 bool SPIRVEmitter::emitEntryFunctionWrapper(const FunctionDecl *decl,
                                             const uint32_t entryFuncId) {
   // HS specific attributes
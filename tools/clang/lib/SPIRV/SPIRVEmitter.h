@@ -173,6 +173,11 @@ private:
                                 SourceRange, SpirvEvalInfo *lhsInfo = nullptr,
                                 spv::Op mandateGenOpcode = spv::Op::Max);
 
+  /// Decorates the value or variable with the given <result-id> with
+  /// RelaxedPrecision if it is of a min precision type and relaxed precision
+  /// is requested. Drivers may then compute it at 16 bits.
+  void decorateRelaxedPrecision(uint32_t id, QualType type);
+
   /// Generates SPIR-V instructions to initialize the given variable once.
   void initOnce(QualType varType, std::string varName, uint32_t varPtr,
                 const Expr *varInit);
@@ -573,6 +578,9 @@ private:
   /// HLSL attributes of the entry point function.
   void processComputeShaderAttributes(const FunctionDecl *entryFunction);
 
+  /// \brief Returns true if the given name is one of the entry functions.
+  bool isEntryFunctionName(llvm::StringRef name) const;
+
   /// \brief Emits a wrapper function for the entry function and returns true
   /// on success.
   ///
@@ -906,9 +914,10 @@ private:
 
   const EmitSPIRVOptions &spirvOptions;
 
-  /// Entry function name and shader stage. Both of them are derived from the
-  /// command line and should be const.
-  const llvm::StringRef entryFunctionName;
+  /// Entry function names and shader stage. Both of them are derived from the
+  /// command line and should be const. All entry functions are of the same
+  /// stage.
+  const std::vector<std::string> entryFunctionNames;
   const hlsl::ShaderModel &shaderModel;
 
   SPIRVContext theContext;
@@ -926,6 +935,8 @@ private:
   /// <result-id> for the entry function. Initially it is zero and will be reset
   /// when starting to translate the entry function.
   uint32_t entryFunctionId;
+  /// <result-id>s and names of the entry functions translated so far.
+  llvm::SmallVector<std::pair<uint32_t, std::string>, 1> entryFunctions;
   /// The current function under traversal.
   const FunctionDecl *curFunction;
   /// The SPIR-V function parameter for the current this object.
@@ -946,8 +957,10 @@ private:
   /// 1. Opaque types (textures, samplers) within structs
   /// 2. Structured buffer aliasing
   /// 3. Using SPIR-V instructions not allowed in the currect shader stage
+  /// 4. Function-scope copies of structs in constant or texture buffers, which
+  ///    are legal but would be left for drivers to break up
   ///
-  /// This covers the first and third case.
+  /// This covers the first, third and fourth case.
   ///
   /// If this is true, SPIRV-Tools legalization passes will be executed after
   /// the translation to legalize the generated SPIR-V binary.
@@ -10,6 +10,7 @@
 #include "clang/SPIRV/Structure.h"
 
 #include "BlockReadableOrder.h"
+#include "clang/SPIRV/SPIRVContext.h"
 
 namespace clang {
 namespace spirv {
@@ -21,14 +22,47 @@ constexpr uint32_t kToolVersion = 0;
 
 // === Instruction implementations ===
 
+Instruction::Instruction(SPIRVContext *context, llvm::ArrayRef<uint32_t> data)
+    : contextWords(nullptr), contextWordCount(0) {
+  if (!data.empty()) {
+    const llvm::ArrayRef<uint32_t> allocated = context->allocateWords(data);
+    contextWords = allocated.data();
+    contextWordCount = static_cast<uint32_t>(allocated.size());
+  }
+}
+
 spv::Op Instruction::getOpcode() const {
   if (!isEmpty()) {
-    return static_cast<spv::Op>(words.front() & spv::OpCodeMask);
+    return static_cast<spv::Op>(getWords().front() & spv::OpCodeMask);
   }
 
   return spv::Op::Max;
 }
 
+std::vector<uint32_t> Instruction::take() {
+  std::vector<uint32_t> result;
+  if (contextWords)
+    result.assign(contextWords, contextWords + contextWordCount);
+  else
+    result.swap(words);
+  contextWords = nullptr;
+  contextWordCount = 0;
+  return result;
+}
+
+void Instruction::take(const WordConsumer &consumer,
+                       std::vector<uint32_t> *scratch) {
+  if (contextWords) {
+    scratch->assign(contextWords, contextWords + contextWordCount);
+    contextWords = nullptr;
+    contextWordCount = 0;
+    consumer(std::move(*scratch));
+    scratch->clear();
+  } else {
+    consumer(take());
+  }
+}
+
 bool Instruction::isTerminator() const {
   switch (getOpcode()) {
   case spv::Op::OpBranch:
@@ -68,8 +102,10 @@ void BasicBlock::take(InstBuilder *builder) {
 
   builder->opLabel(labelId).x();
 
+  const auto &consumer = builder->getConsumer();
+  std::vector<uint32_t> scratch;
   for (auto &inst : instructions) {
-    builder->getConsumer()(inst.take());
+    inst.take(consumer, &scratch);
   }
 
   clear();
@@ -250,6 +286,7 @@ void SPIRVModule::clear() {
 
 void SPIRVModule::take(InstBuilder *builder) {
   const auto &consumer = builder->getConsumer();
+  std::vector<uint32_t> scratch;
 
   // Order matters here.
 
@@ -279,7 +316,7 @@ void SPIRVModule::take(InstBuilder *builder) {
   }
 
   for (auto &inst : executionModes) {
-    consumer(inst.take());
+    inst.take(consumer, &scratch);
   }
 
   if (shaderModelVersion != 0) {
@@ -316,8 +353,14 @@ void SPIRVModule::take(InstBuilder *builder) {
     }
   }
 
+  // Decorations are encoded into one buffer and handed over at once.
+  scratch.reserve(decorations.size() * 4);
   for (const auto &idDecorPair : decorations) {
-    consumer(idDecorPair.second->withTargetId(idDecorPair.first));
+    idDecorPair.second->appendWithTargetId(idDecorPair.first, &scratch);
+  }
+  if (!scratch.empty()) {
+    consumer(std::move(scratch));
+    scratch.clear();
   }
 
   // Note on interdependence of types and constants:
@@ -327,11 +370,11 @@ void SPIRVModule::take(InstBuilder *builder) {
   // constant integer is defined.
 
   for (auto &v : typeConstant) {
-    consumer(v.take());
+    v.take(consumer, &scratch);
   }
 
   for (auto &v : variables) {
-    consumer(v.take());
+    v.take(consumer, &scratch);
   }
 
   for (uint32_t i = 0; i < functions.size(); ++i) {
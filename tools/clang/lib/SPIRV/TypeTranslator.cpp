@@ -480,6 +480,13 @@ uint32_t TypeTranslator::translateType(QualType type, LayoutRule rule) {
     return id;
   }
 
+  if (isTranslationCacheable(type)) {
+    const auto found = translatedTypes.find(
+        std::make_pair(type.getAsOpaquePtr(), static_cast<unsigned>(rule)));
+    if (found != translatedTypes.end())
+      return found->second;
+  }
+
   // Primitive types
   {
     QualType ty = {};
@@ -592,7 +599,7 @@ uint32_t TypeTranslator::translateType(QualType type, LayoutRule rule) {
     // then a subclass of RecordDecl.) So we need to check them before checking
     // the general struct type.
     if (const auto id = translateResourceType(type, rule))
-      return id;
+      return cacheTranslation(type, rule, id);
 
     // Collect all fields' types and names.
     llvm::SmallVector<uint32_t, 4> fieldTypes;
@@ -617,8 +624,10 @@ uint32_t TypeTranslator::translateType(QualType type, LayoutRule rule) {
       decorations = getLayoutDecorations(collectDeclsInDeclContext(decl), rule);
     }
 
-    return theBuilder.getStructType(fieldTypes, decl->getName(), fieldNames,
-                                    decorations);
+    return cacheTranslation(type, rule,
+                            theBuilder.getStructType(fieldTypes,
+                                                     decl->getName(),
+                                                     fieldNames, decorations));
   }
 
   if (const auto *arrayType = astContext.getAsConstantArrayType(type)) {
@@ -635,8 +644,10 @@ uint32_t TypeTranslator::translateType(QualType type, LayoutRule rule) {
           Decoration::getArrayStride(*theBuilder.getSPIRVContext(), stride));
     }
 
-    return theBuilder.getArrayType(elemType, theBuilder.getConstantUint32(size),
-                                   decorations);
+    return cacheTranslation(
+        type, rule,
+        theBuilder.getArrayType(elemType, theBuilder.getConstantUint32(size),
+                                decorations));
   }
 
   emitError("type %0 unimplemented") << type->getTypeClassName();
@@ -1717,6 +1728,17 @@ TypeTranslator::getAlignmentAndSize(QualType type, LayoutRule rule,
     if (structType->getDecl()->field_empty())
       return {1, 0};
 
+    // Majorness recorded from an enclosing attributed type affects the
+    // matrices inside, as for translateType.
+    const bool cacheable = !typeMatMajorAttr.hasValue();
+    const auto key =
+        std::make_pair(type.getAsOpaquePtr(), static_cast<unsigned>(rule));
+    if (cacheable) {
+      const auto found = structLayouts.find(key);
+      if (found != structLayouts.end())
+        return found->second;
+    }
+
     uint32_t maxAlignment = 0;
     uint32_t structSize = 0;
 
@@ -1750,6 +1772,11 @@ TypeTranslator::getAlignmentAndSize(QualType type, LayoutRule rule,
       // to the next multiple of the base alignment of the structure.
       structSize = roundToPow2(structSize, maxAlignment);
     }
+
+    // Layouts that hit an error are not cached so that it is reported at each
+    // use.
+    if (cacheable && !diags.hasErrorOccurred())
+      structLayouts[key] = {maxAlignment, structSize};
     return {maxAlignment, structSize};
   }
 
@@ -1857,5 +1884,37 @@ QualType TypeTranslator::desugarType(QualType type) {
   return type;
 }
 
+bool TypeTranslator::isTranslationCacheable(QualType type) const {
+  // Majorness recorded from an enclosing attributed type affects the
+  // decorations of the matrices inside.
+  if (typeMatMajorAttr.hasValue())
+    return false;
+
+  if (type->getAs<RecordType>())
+    return true;
+
+  if (!astContext.getAsConstantArrayType(type))
+    return false;
+
+  // Literal element types are resolved using the intended literal type hints,
+  // which depend on the expression being translated.
+  QualType elemType = astContext.getBaseElementType(type);
+  if (!isScalarType(elemType, &elemType))
+    if (!isVectorType(elemType, &elemType))
+      isMxNMatrix(elemType, &elemType);
+  return !elemType->isSpecificBuiltinType(BuiltinType::LitInt) &&
+         !elemType->isSpecificBuiltinType(BuiltinType::LitFloat);
+}
+
+uint32_t TypeTranslator::cacheTranslation(QualType type, LayoutRule rule,
+                                          uint32_t id) {
+  // Failed translations are not cached so that the error is reported at
+  // each use.
+  if (id && isTranslationCacheable(type))
+    translatedTypes[std::make_pair(type.getAsOpaquePtr(),
+                                   static_cast<unsigned>(rule))] = id;
+  return id;
+}
+
 } // end namespace spirv
 } // end namespace clang
@@ -16,6 +16,7 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/SPIRV/EmitSPIRVOptions.h"
 #include "clang/SPIRV/ModuleBuilder.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 
 #include "SpirvEvalInfo.h"
@@ -369,6 +370,16 @@ private:
   /// matrix majorness.
   QualType desugarType(QualType type);
 
+  /// \brief Returns true if the SPIR-V type translated from the given
+  /// desugared struct or array type only depends on the type and the layout
+  /// rule, so that translateType can reuse the result for later requests.
+  bool isTranslationCacheable(QualType type) const;
+
+  /// \brief Records the <result-id> translated for the given type and layout
+  /// rule if the translation succeeded and is cacheable. Returns the
+  /// <result-id>.
+  uint32_t cacheTranslation(QualType type, LayoutRule rule, uint32_t id);
+
   ASTContext &astContext;
   ModuleBuilder &theBuilder;
   DiagnosticsEngine &diags;
@@ -388,6 +399,20 @@ private:
   /// row, col>). When we reach the desugared matrix type, this information will
   /// already be gone.
   llvm::Optional<AttributedType::Kind> typeMatMajorAttr;
+
+  /// \brief The <result-id>s of struct and array types translated so far,
+  /// keyed by the desugared QualType and the layout rule. Translating these
+  /// types recurses into all their members and recomputes the layout
+  /// decorations, which is expensive for large cbuffer and structured buffer
+  /// struct hierarchies that are referenced over and over.
+  llvm::DenseMap<std::pair<void *, unsigned>, uint32_t> translatedTypes;
+
+  /// \brief The alignment and size of struct types computed so far, keyed
+  /// like translatedTypes. Laying out a struct lays out all of its members, so
+  /// without this nested structs are laid out again for every enclosing
+  /// struct, member decoration and buffer that uses them.
+  llvm::DenseMap<std::pair<void *, unsigned>, std::pair<uint32_t, uint32_t>>
+      structLayouts;
 };
 
 } // end namespace spirv
@@ -49,6 +49,7 @@
 #include <cstring>
 #include <functional>
 #include "clang/Sema/SemaHLSL.h" // HLSL Change
+#include "llvm/Support/Cancellation.h" // HLSL Change
 using namespace clang;
 using namespace sema;
 
@@ -10825,6 +10826,7 @@ Decl *Sema::ActOnFinishFunctionBody(Decl *D, Stmt *BodyArg) {
 
 Decl *Sema::ActOnFinishFunctionBody(Decl *dcl, Stmt *Body,
                                     bool IsInstantiation) {
+  llvm::checkThreadCancellation(); // HLSL Change
   FunctionDecl *FD = dcl ? dcl->getAsFunction() : nullptr;
 
   sema::AnalysisBasedWarnings::Policy WP = AnalysisWarnings.getDefaultPolicy();
@@ -39,6 +39,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "clang/Sema/SemaHLSL.h"      // HLSL Change
+#include "llvm/Support/Cancellation.h" // HLSL Change
 using namespace clang;
 using namespace sema;
 
@@ -6663,6 +6664,8 @@ ExprResult Sema::ActOnFinishFullExpr(Expr *FE, SourceLocation CC,
 
   if (!FullExpr.get())
     return ExprError();
+
+  llvm::pollThreadCancellation(); // HLSL Change
  
   // If we are an init-expression in a lambdas init-capture, we should not 
   // diagnose an unexpanded pack now (will be diagnosed once lambda-expr 
@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Attr.h"
 #include "clang/AST/DeclCXX.h"
@@ -38,6 +39,9 @@
 #include "dxc/HLSL/HLOperations.h"
 #include "dxc/HLSL/DxilShaderModel.h"
 #include <array>
+#include <map>
+#include <tuple>
+#include <unordered_set>
 
 enum ArBasicKind {
   AR_BASIC_BOOL,
@@ -1759,6 +1763,15 @@ public:
     return compare(other) < 0;
   }
 
+  size_t hash() const
+  {
+    llvm::hash_code result = llvm::hash_value(m_intrinsicSource);
+    for (size_t i = 0; i < m_argLength; i++) {
+      result = llvm::hash_combine(result, m_args[i].getAsOpaquePtr());
+    }
+    return result;
+  }
+
 private:
   QualType m_args[g_MaxIntrinsicParamCount];
   size_t m_argLength;
@@ -1943,10 +1956,41 @@ static bool CombineBasicTypes(
   return true;
 }
 
-class UsedIntrinsicStore : public std::set<UsedIntrinsic>
+struct UsedIntrinsicHash
 {
+  size_t operator()(const UsedIntrinsic& value) const { return value.hash(); }
 };
 
+class UsedIntrinsicStore : public std::unordered_set<UsedIntrinsic, UsedIntrinsicHash>
+{
+};
+
+/// <summary>Hashes an intrinsic name for the generated g_IntrinsicNameHash tables.</summary>
+/// <remarks>This must match hlsl_intrinsic_name_hash in hctdb_instrhelp.py.</remarks>
+static UINT IntrinsicNameHash(StringRef name, UINT seed)
+{
+  UINT result = 2166136261u ^ seed;
+  for (char c : name) {
+    result = (result ^ (unsigned char)c) * 16777619u;
+  }
+  return result;
+}
+
+/// <summary>Finds the g_Intrinsics entries with the given name.</summary>
+/// <returns>The first entry and the count of entries; the count is zero if there is no match.</returns>
+static const HLSL_INTRINSIC* FindBuiltinIntrinsicsByName(StringRef name, _Out_ size_t* count)
+{
+  UINT bucket = IntrinsicNameHash(name, 0) & (g_uIntrinsicNameHashBucketCount - 1);
+  UINT slot = IntrinsicNameHash(name, g_IntrinsicNameHashSeeds[bucket]) & (g_uIntrinsicNameHashSlotCount - 1);
+  const HLSL_INTRINSIC_NAME_RANGE& range = g_IntrinsicNameHashSlots[slot];
+  if (range.pName == nullptr || !name.equals(range.pName)) {
+    *count = 0;
+    return nullptr;
+  }
+  *count = range.uCount;
+  return &g_Intrinsics[range.uFirst];
+}
+
 static
 void GetIntrinsicMethods(ArBasicKind kind, _Outptr_result_buffer_(*intrinsicCount) const HLSL_INTRINSIC** intrinsics, _Out_ size_t* intrinsicCount)
 {
@@ -2558,6 +2602,29 @@ private:
 
   UsedIntrinsicStore m_usedIntrinsics;
 
+  // Object method specializations already deduced, keyed by the method
+  // template followed by the canonical argument types.
+  struct ObjectMethodDeduction {
+    const HLSL_INTRINSIC *Intrinsic;
+    FunctionDecl *Specialization;
+  };
+  std::map<std::vector<const void *>, ObjectMethodDeduction> m_objectMethodDeductions;
+
+  // Intrinsic calls already resolved, keyed by the intrinsic name followed by
+  // the canonical argument types. Calls that matched no overload map to null.
+  std::map<std::vector<const void *>, FunctionDecl *> m_intrinsicCallResolutions;
+
+  // Conversions between basic, vector and matrix types already ranked, keyed
+  // by the canonical source and target types and whether the conversion is
+  // explicit.
+  struct ConversionRank {
+    bool Allowed;
+    ImplicitConversionKind Second;
+    ImplicitConversionKind ComponentConversion;
+    TYPE_CONVERSION_REMARKS Remarks;
+  };
+  std::map<std::tuple<const void *, const void *, bool>, ConversionRank> m_conversionRanks;
+
   /// <summary>Add all base QualTypes for each hlsl scalar types.</summary>
   void AddBaseTypes();
 
@@ -3720,16 +3787,19 @@ public:
     StringRef nameIdentifier,
     size_t argumentCount)
   {
-    // This is implemented by a linear scan for now.
-    // We tested binary search on tables, and there was no performance gain on
-    // samples probably for the following reasons.
-    // 1. The tables are not big enough to make noticable difference
-    // 2. The user of this function assumes that it returns the first entry in
-    // the table that matches name and argument count. So even in the binary
-    // search, we have to scan backwards until the entry does not match the name
-    // or arg count. For linear search this is not a problem
-    for (unsigned int i = 0; i < tableSize; i++) {
-      const HLSL_INTRINSIC* pIntrinsic = &table[i];
+    // The global intrinsics table is the largest and most frequently
+    // searched, so it uses the generated name hash to narrow the scan down to
+    // the entries with a matching name. Entries that share a name are
+    // contiguous in every table.
+    // The object method tables are small, and are scanned linearly.
+    const HLSL_INTRINSIC* first = table;
+    size_t count = tableSize;
+    if (table == g_Intrinsics) {
+      first = FindBuiltinIntrinsicsByName(nameIdentifier, &count);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      const HLSL_INTRINSIC* pIntrinsic = &first[i];
 
       // Do some quick checks to verify size and name.
       if (pIntrinsic->uNumArgs != 1 + argumentCount) {
@@ -3764,6 +3834,36 @@ public:
 
     StringRef nameIdentifier = idInfo->getName();
 
+    auto addCandidate = [&CandidateSet](FunctionDecl *intrinsicFuncDecl) {
+      OverloadCandidate& candidate = CandidateSet.addCandidate();
+      candidate.Function = intrinsicFuncDecl;
+      candidate.FoundDecl.setDecl(intrinsicFuncDecl);
+      candidate.Viable = true;
+    };
+
+    // Calls with the same argument types resolve to the same overload, unless
+    // the value of a literal argument takes part.
+    std::vector<const void *> resolutionKey;
+    resolutionKey.push_back(idInfo);
+    for (Expr *arg : Args) {
+      QualType argType = arg->getType();
+      ArBasicKind argKind = GetTypeElementKind(argType);
+      if (argKind == AR_BASIC_LITERAL_INT || argKind == AR_BASIC_LITERAL_FLOAT) {
+        resolutionKey.clear();
+        break;
+      }
+      resolutionKey.push_back(argType.getCanonicalType().getAsOpaquePtr());
+    }
+    if (!resolutionKey.empty()) {
+      auto found = m_intrinsicCallResolutions.find(resolutionKey);
+      if (found != m_intrinsicCallResolutions.end()) {
+        if (found->second == nullptr)
+          return false;
+        addCandidate(found->second);
+        return true;
+      }
+    }
+
     IntrinsicDefIter cursor = FindIntrinsicByNameAndArgCount(
       g_Intrinsics, _countof(g_Intrinsics), StringRef(), nameIdentifier, Args.size());
     IntrinsicDefIter end = IntrinsicDefIter::CreateEnd(
@@ -3802,14 +3902,14 @@ public:
         intrinsicFuncDecl = (*insertResult.first).getFunctionDecl();
       }
 
-      OverloadCandidate& candidate = CandidateSet.addCandidate();
-      candidate.Function = intrinsicFuncDecl;
-      candidate.FoundDecl.setDecl(intrinsicFuncDecl);
-      candidate.Viable = true;
-
+      if (!resolutionKey.empty())
+        m_intrinsicCallResolutions[resolutionKey] = intrinsicFuncDecl;
+      addCandidate(intrinsicFuncDecl);
       return true;
     }
 
+    if (!resolutionKey.empty())
+      m_intrinsicCallResolutions[resolutionKey] = nullptr;
     return false;
   }
 
@@ -3951,6 +4051,10 @@ public:
   bool CanConvert(SourceLocation loc, Expr* sourceExpr, QualType target, bool explicitConversion,
     _Out_opt_ TYPE_CONVERSION_REMARKS* remarks,
     _Inout_opt_ StandardConversionSequence* sequence);
+  /// <summary>Ranks a conversion between basic, vector and matrix types.</summary>
+  bool RankConversion(QualType source, QualType target,
+    const ArTypeInfo &TargetInfo, const ArTypeInfo &SourceInfo,
+    _Out_ ConversionRank *rank);
   /// <summary>Produces an expression that turns the given expression into the specified numeric type.</summary>
   Expr* CastExprToTypeNumeric(Expr* expr, QualType targetType);
   void CollectInfo(QualType type, _Out_ ArTypeInfo* pTypeInfo);
@@ -7253,176 +7357,14 @@ bool HandleVoidConversion(QualType source, QualType target, bool explicitConvers
   return applicable;
 }
 
-_Use_decl_annotations_
-bool HLSLExternalSource::CanConvert(
-  SourceLocation loc,
-  Expr* sourceExpr,
-  QualType target,
-  bool explicitConversion,
-  _Out_opt_ TYPE_CONVERSION_REMARKS* remarks,
-  _Inout_opt_ StandardConversionSequence* standard)
+bool HLSLExternalSource::RankConversion(QualType source, QualType target,
+                                        const ArTypeInfo &TargetInfo,
+                                        const ArTypeInfo &SourceInfo,
+                                        _Out_ ConversionRank *rank)
 {
-  DXASSERT_NOMSG(sourceExpr != nullptr);
-  DXASSERT_NOMSG(!target.isNull());
-
-  // Implements the semantics of ArType::CanConvertTo.
-  TYPE_CONVERSION_FLAGS Flags = explicitConversion ? TYPE_CONVERSION_EXPLICIT : TYPE_CONVERSION_DEFAULT;
-  TYPE_CONVERSION_REMARKS Remarks = TYPE_CONVERSION_NONE;
-  QualType source = sourceExpr->getType();
-  // Cannot cast function type.
-  if (source->isFunctionType())
-    return false;
-  // Convert to an r-value to begin with.
-  bool needsLValueToRValue = sourceExpr->isLValue() &&
-    !target->isLValueReferenceType() && 
-    IsConversionToLessOrEqualElements(source, target, explicitConversion);
-
-  bool targetRef = target->isReferenceType();
-
-  // Initialize the output standard sequence if available.
-  if (standard != nullptr) {
-    // Set up a no-op conversion, other than lvalue to rvalue - HLSL does not support references.
-    standard->setAsIdentityConversion();
-    if (needsLValueToRValue) {
-      standard->First = ICK_Lvalue_To_Rvalue;
-    }
-
-    standard->setFromType(source);
-    standard->setAllToTypes(target);
-  }
-
-  source = GetStructuralForm(source);
-  target = GetStructuralForm(target);
-
-  // Temporary conversion kind tracking which will be used/fixed up at the end
   ImplicitConversionKind Second = ICK_Identity;
   ImplicitConversionKind ComponentConversion = ICK_Identity;
-
-  // Identical types require no conversion.
-  if (source == target) {
-    Remarks = TYPE_CONVERSION_IDENTICAL;
-    goto lSuccess;
-  }
-
-  // Trivial cases for void.
-  bool allowed;
-  if (HandleVoidConversion(source, target, explicitConversion, &allowed)) {
-    if (allowed) {
-      Remarks = target->isVoidType() ? TYPE_CONVERSION_TO_VOID : Remarks;
-      goto lSuccess;
-    }
-    else {
-      return false;
-    }
-  }
-
-  ArTypeInfo TargetInfo, SourceInfo;
-  CollectInfo(target, &TargetInfo);
-  CollectInfo(source, &SourceInfo);
-
-  UINT uTSize = TargetInfo.uTotalElts;
-  UINT uSSize = SourceInfo.uTotalElts;
-
-  // TODO: TYPE_CONVERSION_BY_REFERENCE does not seem possible here
-  // are we missing cases?
-  if ((Flags & TYPE_CONVERSION_BY_REFERENCE) != 0 && uTSize != uSSize) {
-    return false;
-  }
-
-  // Structure cast.
-  if (TargetInfo.ShapeKind == AR_TOBJ_COMPOUND || TargetInfo.ShapeKind == AR_TOBJ_ARRAY ||
-      SourceInfo.ShapeKind == AR_TOBJ_COMPOUND || SourceInfo.ShapeKind == AR_TOBJ_ARRAY) {
-    if (!explicitConversion && TargetInfo.ShapeKind != SourceInfo.ShapeKind)
-    {
-      return false;
-    }
-
-    const RecordType *targetRT = target->getAsStructureType();
-    if (!targetRT)
-      targetRT = dyn_cast<RecordType>(target);
-
-    const RecordType *sourceRT = source->getAsStructureType();
-    if (!sourceRT)
-      sourceRT = dyn_cast<RecordType>(source);
-
-    if (targetRT && sourceRT) {
-      RecordDecl *targetRD = targetRT->getDecl();
-      RecordDecl *sourceRD = sourceRT->getDecl();
-      const CXXRecordDecl *targetCXXRD = dyn_cast<CXXRecordDecl>(targetRD);
-      const CXXRecordDecl *sourceCXXRD = dyn_cast<CXXRecordDecl>(sourceRD);
-      if (targetCXXRD && sourceCXXRD) {
-        if (targetRD == sourceRD) {
-          Second = ICK_Flat_Conversion;
-          goto lSuccess;
-        }
-        if (sourceCXXRD->isDerivedFrom(targetCXXRD)) {
-          Second = ICK_HLSL_Derived_To_Base;
-          goto lSuccess;
-        }
-      } else {
-        if (targetRD == sourceRD) {
-          Second = ICK_Flat_Conversion;
-          goto lSuccess;
-        }
-      }
-    }
-
-    if (const BuiltinType *BT = source->getAs<BuiltinType>()) {
-      BuiltinType::Kind kind = BT->getKind();
-      switch (kind) {
-      case BuiltinType::Kind::UInt:
-      case BuiltinType::Kind::Int:
-      case BuiltinType::Kind::Float:
-      case BuiltinType::Kind::LitFloat:
-      case BuiltinType::Kind::LitInt:
-        if (explicitConversion) {
-          Second = ICK_Flat_Conversion;
-          goto lSuccess;
-        }
-        break;
-      }
-    }
-
-    if (const BuiltinType *BT = source->getAs<BuiltinType>()) {
-      BuiltinType::Kind kind = BT->getKind();
-      switch (kind) {
-      case BuiltinType::Kind::UInt:
-      case BuiltinType::Kind::Int:
-      case BuiltinType::Kind::Float:
-      case BuiltinType::Kind::LitFloat:
-      case BuiltinType::Kind::LitInt:
-        if (explicitConversion) {
-          Second = ICK_Flat_Conversion;
-          goto lSuccess;
-        }
-        break;
-      }
-    }
-
-    FlattenedTypeIterator::ComparisonResult result =
-      FlattenedTypeIterator::CompareTypes(*this, loc, loc, target, source);
-    if (!result.CanConvertElements) {
-      return false;
-    }
-
-    // Only allow scalar to compound or array with explicit cast
-    if (result.IsConvertibleAndLeftLonger()) {
-      if (!explicitConversion || SourceInfo.ShapeKind != AR_TOBJ_SCALAR) {
-      return false;
-    }
-    }
-
-    // Assignment is valid if elements are exactly the same in type and size; if
-    // an explicit conversion is being done, we accept converted elements and a
-    // longer right-hand sequence.
-    if (!explicitConversion &&
-        (!result.AreElementsEqual || result.IsRightLonger()))
-    {
-      return false;
-    }
-    Second = ICK_Flat_Conversion;
-    goto lSuccess;
-  }
+  TYPE_CONVERSION_REMARKS Remarks = TYPE_CONVERSION_NONE;
 
   // Base type cast.
   //
@@ -7672,6 +7614,206 @@ bool HLSLExternalSource::CanConvert(
     }
   }
 
+  rank->Second = Second;
+  rank->ComponentConversion = ComponentConversion;
+  rank->Remarks = Remarks;
+  return true;
+}
+
+_Use_decl_annotations_
+bool HLSLExternalSource::CanConvert(
+  SourceLocation loc,
+  Expr* sourceExpr,
+  QualType target,
+  bool explicitConversion,
+  _Out_opt_ TYPE_CONVERSION_REMARKS* remarks,
+  _Inout_opt_ StandardConversionSequence* standard)
+{
+  DXASSERT_NOMSG(sourceExpr != nullptr);
+  DXASSERT_NOMSG(!target.isNull());
+
+  // Implements the semantics of ArType::CanConvertTo.
+  TYPE_CONVERSION_FLAGS Flags = explicitConversion ? TYPE_CONVERSION_EXPLICIT : TYPE_CONVERSION_DEFAULT;
+  TYPE_CONVERSION_REMARKS Remarks = TYPE_CONVERSION_NONE;
+  QualType source = sourceExpr->getType();
+  // Cannot cast function type.
+  if (source->isFunctionType())
+    return false;
+  // Convert to an r-value to begin with.
+  bool needsLValueToRValue = sourceExpr->isLValue() &&
+    !target->isLValueReferenceType() && 
+    IsConversionToLessOrEqualElements(source, target, explicitConversion);
+
+  bool targetRef = target->isReferenceType();
+
+  // Initialize the output standard sequence if available.
+  if (standard != nullptr) {
+    // Set up a no-op conversion, other than lvalue to rvalue - HLSL does not support references.
+    standard->setAsIdentityConversion();
+    if (needsLValueToRValue) {
+      standard->First = ICK_Lvalue_To_Rvalue;
+    }
+
+    standard->setFromType(source);
+    standard->setAllToTypes(target);
+  }
+
+  source = GetStructuralForm(source);
+  target = GetStructuralForm(target);
+
+  // Temporary conversion kind tracking which will be used/fixed up at the end
+  ImplicitConversionKind Second = ICK_Identity;
+  ImplicitConversionKind ComponentConversion = ICK_Identity;
+
+  // Identical types require no conversion.
+  if (source == target) {
+    Remarks = TYPE_CONVERSION_IDENTICAL;
+    goto lSuccess;
+  }
+
+  // Trivial cases for void.
+  bool allowed;
+  if (HandleVoidConversion(source, target, explicitConversion, &allowed)) {
+    if (allowed) {
+      Remarks = target->isVoidType() ? TYPE_CONVERSION_TO_VOID : Remarks;
+      goto lSuccess;
+    }
+    else {
+      return false;
+    }
+  }
+
+  // Conversions between basic, vector and matrix types depend only on the
+  // two structural types, so their rank is computed once per pair.
+  auto rankKey = std::make_tuple(source.getCanonicalType().getAsOpaquePtr(),
+                                 target.getCanonicalType().getAsOpaquePtr(),
+                                 explicitConversion);
+  auto rankIt = m_conversionRanks.find(rankKey);
+  if (rankIt != m_conversionRanks.end()) {
+    if (!rankIt->second.Allowed)
+      return false;
+    Second = rankIt->second.Second;
+    ComponentConversion = rankIt->second.ComponentConversion;
+    Remarks = rankIt->second.Remarks;
+    goto lSuccess;
+  }
+
+  ArTypeInfo TargetInfo, SourceInfo;
+  CollectInfo(target, &TargetInfo);
+  CollectInfo(source, &SourceInfo);
+
+  UINT uTSize = TargetInfo.uTotalElts;
+  UINT uSSize = SourceInfo.uTotalElts;
+
+  // TODO: TYPE_CONVERSION_BY_REFERENCE does not seem possible here
+  // are we missing cases?
+  if ((Flags & TYPE_CONVERSION_BY_REFERENCE) != 0 && uTSize != uSSize) {
+    return false;
+  }
+
+  // Structure cast.
+  if (TargetInfo.ShapeKind == AR_TOBJ_COMPOUND || TargetInfo.ShapeKind == AR_TOBJ_ARRAY ||
+      SourceInfo.ShapeKind == AR_TOBJ_COMPOUND || SourceInfo.ShapeKind == AR_TOBJ_ARRAY) {
+    if (!explicitConversion && TargetInfo.ShapeKind != SourceInfo.ShapeKind)
+    {
+      return false;
+    }
+
+    const RecordType *targetRT = target->getAsStructureType();
+    if (!targetRT)
+      targetRT = dyn_cast<RecordType>(target);
+
+    const RecordType *sourceRT = source->getAsStructureType();
+    if (!sourceRT)
+      sourceRT = dyn_cast<RecordType>(source);
+
+    if (targetRT && sourceRT) {
+      RecordDecl *targetRD = targetRT->getDecl();
+      RecordDecl *sourceRD = sourceRT->getDecl();
+      const CXXRecordDecl *targetCXXRD = dyn_cast<CXXRecordDecl>(targetRD);
+      const CXXRecordDecl *sourceCXXRD = dyn_cast<CXXRecordDecl>(sourceRD);
+      if (targetCXXRD && sourceCXXRD) {
+        if (targetRD == sourceRD) {
+          Second = ICK_Flat_Conversion;
+          goto lSuccess;
+        }
+        if (sourceCXXRD->isDerivedFrom(targetCXXRD)) {
+          Second = ICK_HLSL_Derived_To_Base;
+          goto lSuccess;
+        }
+      } else {
+        if (targetRD == sourceRD) {
+          Second = ICK_Flat_Conversion;
+          goto lSuccess;
+        }
+      }
+    }
+
+    if (const BuiltinType *BT = source->getAs<BuiltinType>()) {
+      BuiltinType::Kind kind = BT->getKind();
+      switch (kind) {
+      case BuiltinType::Kind::UInt:
+      case BuiltinType::Kind::Int:
+      case BuiltinType::Kind::Float:
+      case BuiltinType::Kind::LitFloat:
+      case BuiltinType::Kind::LitInt:
+        if (explicitConversion) {
+          Second = ICK_Flat_Conversion;
+          goto lSuccess;
+        }
+        break;
+      }
+    }
+
+    if (const BuiltinType *BT = source->getAs<BuiltinType>()) {
+      BuiltinType::Kind kind = BT->getKind();
+      switch (kind) {
+      case BuiltinType::Kind::UInt:
+      case BuiltinType::Kind::Int:
+      case BuiltinType::Kind::Float:
+      case BuiltinType::Kind::LitFloat:
+      case BuiltinType::Kind::LitInt:
+        if (explicitConversion) {
+          Second = ICK_Flat_Conversion;
+          goto lSuccess;
+        }
+        break;
+      }
+    }
+
+    FlattenedTypeIterator::ComparisonResult result =
+      FlattenedTypeIterator::CompareTypes(*this, loc, loc, target, source);
+    if (!result.CanConvertElements) {
+      return false;
+    }
+
+    // Only allow scalar to compound or array with explicit cast
+    if (result.IsConvertibleAndLeftLonger()) {
+      if (!explicitConversion || SourceInfo.ShapeKind != AR_TOBJ_SCALAR) {
+      return false;
+    }
+    }
+
+    // Assignment is valid if elements are exactly the same in type and size; if
+    // an explicit conversion is being done, we accept converted elements and a
+    // longer right-hand sequence.
+    if (!explicitConversion &&
+        (!result.AreElementsEqual || result.IsRightLonger()))
+    {
+      return false;
+    }
+    Second = ICK_Flat_Conversion;
+    goto lSuccess;
+  }
+
+  ConversionRank &rank = m_conversionRanks[rankKey];
+  rank.Allowed = RankConversion(source, target, TargetInfo, SourceInfo, &rank);
+  if (!rank.Allowed)
+    return false;
+  Second = rank.Second;
+  ComponentConversion = rank.ComponentConversion;
+  Remarks = rank.Remarks;
+
 lSuccess:
   if (standard)
   {
@@ -8455,6 +8597,33 @@ Sema::TemplateDeductionResult HLSLExternalSource::DeduceTemplateArgumentsForHLSL
     return Sema::TemplateDeductionResult::TDK_NonDeducedMismatch;
   }
 
+  // Calls with the same argument types deduce the same specialization, unless
+  // the value of a literal argument or explicit template arguments take part.
+  std::vector<const void *> deductionKey;
+  if (ExplicitTemplateArgs == nullptr || ExplicitTemplateArgs->size() == 0) {
+    deductionKey.push_back(FunctionTemplate);
+    for (Expr *arg : Args) {
+      QualType argType = arg->getType();
+      ArBasicKind argKind = GetTypeElementKind(argType);
+      if (argKind == AR_BASIC_LITERAL_INT || argKind == AR_BASIC_LITERAL_FLOAT) {
+        deductionKey.clear();
+        break;
+      }
+      deductionKey.push_back(argType.getCanonicalType().getAsOpaquePtr());
+    }
+  }
+  if (!deductionKey.empty()) {
+    auto found = m_objectMethodDeductions.find(deductionKey);
+    if (found != m_objectMethodDeductions.end()) {
+      Specialization = found->second.Specialization;
+      if (!IsValidateObjectElement(found->second.Intrinsic, objectElement)) {
+        m_sema->Diag(Args[0]->getExprLoc(), diag::err_hlsl_invalid_resource_type_on_intrinsic) <<
+            FunctionTemplate->getName() << g_ArBasicTypeNames[GetTypeElementKind(objectElement)];
+      }
+      return Sema::TemplateDeductionResult::TDK_Success;
+    }
+  }
+
   // Find the table of intrinsics based on the object type.
   const HLSL_INTRINSIC* intrinsics;
   size_t intrinsicCount;
@@ -8547,6 +8716,10 @@ Sema::TemplateDeductionResult HLSLExternalSource::DeduceTemplateArgumentsForHLSL
       m_sema->Diag(Args[0]->getExprLoc(), diag::err_hlsl_invalid_resource_type_on_intrinsic) <<
           nameIdentifier << g_ArBasicTypeNames[GetTypeElementKind(objectElement)];
     }
+    if (!deductionKey.empty()) {
+      ObjectMethodDeduction deduction = { *cursor, Specialization };
+      m_objectMethodDeductions[deductionKey] = deduction;
+    }
     return Sema::TemplateDeductionResult::TDK_Success;
   }
 
@@ -10252,6 +10425,31 @@ bool ValidateAttributeTargetIsFunction(Sema& S, Decl* D, const AttributeList &A)
   return false;
 }
 
+static
+bool ValidateAttributeTargetIsSpecializable(Sema& S, Decl* D, const AttributeList &A)
+{
+  // Specialization substitutes a 32-bit value for the constant, so only
+  // scalars stored in a single cbuffer component are allowed.
+  VarDecl *VD = dyn_cast<VarDecl>(D);
+  if (VD && VD->isFileVarDecl() && VD->getStorageClass() == SC_Static &&
+      VD->getType().isConstQualified() && VD->hasInit()) {
+    if (const BuiltinType *BT = VD->getType()->getAs<BuiltinType>()) {
+      switch (BT->getKind()) {
+      case BuiltinType::Bool:
+      case BuiltinType::Int:
+      case BuiltinType::UInt:
+      case BuiltinType::Float:
+        return true;
+      default:
+        break;
+      }
+    }
+  }
+
+  S.Diag(A.getLoc(), diag::err_hlsl_specializable_target);
+  return false;
+}
+
 void hlsl::HandleDeclAttributeForHLSL(Sema &S, Decl *D, const AttributeList &A, bool& Handled)
 {
   DXASSERT_NOMSG(D != nullptr);
@@ -10354,6 +10552,12 @@ void hlsl::HandleDeclAttributeForHLSL(Sema &S, Decl *D, const AttributeList &A,
     declAttr = ::new (S.Context) HLSLGloballyCoherentAttr(
         A.getRange(), S.Context, A.getAttributeSpellingListIndex());
     break;
+  case AttributeList::AT_HLSLSpecializable:
+    if (!ValidateAttributeTargetIsSpecializable(S, D, A))
+      return;
+    declAttr = ::new (S.Context) HLSLSpecializableAttr(
+        A.getRange(), S.Context, A.getAttributeSpellingListIndex());
+    break;
 
   default:
     Handled = false;
@@ -11480,6 +11684,11 @@ void hlsl::CustomPrintHLSLAttr(const clang::Attr *A, llvm::raw_ostream &Out, con
     Indent(Indentation, Out);
     Out << "[earlydepthstencil]\n";
     break;
+
+  case clang::attr::HLSLSpecializable:
+    Indent(Indentation, Out);
+    Out << "[specializable]\n";
+    break;
   
   case clang::attr::HLSLInstance: //TODO - test 
   {
@@ -11723,6 +11932,7 @@ bool hlsl::IsHLSLAttr(clang::attr::Kind AttrKind) {
   case clang::attr::HLSLSemantic:
   case clang::attr::HLSLShared:
   case clang::attr::HLSLSnorm:
+  case clang::attr::HLSLSpecializable:
   case clang::attr::HLSLUniform:
   case clang::attr::HLSLUnorm:
   case clang::attr::HLSLUnroll:
@@ -5627,3 +5627,288 @@ static const int g_MaxIntrinsicName = 32; // Count of characters for longest int
 static const int g_MaxIntrinsicParamName = 22; // Count of characters for longest intrinsic parameter name - 'UnroundedInsideFactors'
 static const int g_MaxIntrinsicParamCount = 8; // Count of parameters (without return) for longest intrinsic argument list - 'GatherCmpAlpha'
 // HLSL-INTRINSIC-STATS:END
+
+/* <py::lines('HLSL-INTRINSIC-NAME-HASH')>hctdb_instrhelp.get_hlsl_intrinsic_name_hash()</py>*/
+// HLSL-INTRINSIC-NAME-HASH:BEGIN
+struct HLSL_INTRINSIC_NAME_RANGE {
+    LPCSTR pName;
+    UINT uFirst;
+    UINT uCount;
+};
+
+static const UINT g_uIntrinsicNameHashBucketCount = 64;
+static const UINT g_uIntrinsicNameHashSlotCount = 256;
+
+static const UINT g_IntrinsicNameHashSeeds[] =
+{
+    1, 4, 1, 0, 9, 7, 0, 10,
+    3, 3, 11, 1, 1, 3, 2, 7,
+    1, 3, 2, 2, 1, 2, 2, 2,
+    4, 3, 1, 3, 1, 5, 4, 1,
+    1, 1, 5, 0, 1, 1, 4, 1,
+    1, 1, 19, 7, 8, 2, 1, 1,
+    1, 0, 7, 0, 17, 0, 8, 1,
+    2, 1, 4, 17, 5, 3, 5, 2,
+};
+
+// Index of the first g_Intrinsics entry and entry count for each slot.
+static const HLSL_INTRINSIC_NAME_RANGE g_IntrinsicNameHashSlots[] =
+{
+    {"texCUBE", 174, 2},
+    {"InterlockedXor", 28, 2},
+    {"EvaluateAttributeAtSample", 7, 1},
+    {"AllMemoryBarrierWithGroupSync", 2, 1},
+    {"normalize", 136, 1},
+    {"fwidth", 111, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"rsqrt", 144, 1},
+    {"ddy_coarse", 92, 1},
+    {nullptr, 0, 0},
+    {"ceil", 81, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"clamp", 82, 1},
+    {"WavePrefixProduct", 61, 1},
+    {nullptr, 0, 0},
+    {"QuadReadAcrossY", 43, 1},
+    {"texCUBElod", 178, 1},
+    {"tex3Dgrad", 171, 1},
+    {nullptr, 0, 0},
+    {"asint16", 75, 1},
+    {nullptr, 0, 0},
+    {"max", 123, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"ProcessIsolineTessFactors", 34, 1},
+    {nullptr, 0, 0},
+    {"InterlockedExchange", 21, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"tex1Dgrad", 159, 1},
+    {"sinh", 149, 1},
+    {"texCUBEproj", 179, 1},
+    {nullptr, 0, 0},
+    {"DeviceMemoryBarrier", 5, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"WaveActiveAllTrue", 46, 1},
+    {"InterlockedCompareStore", 20, 1},
+    {nullptr, 0, 0},
+    {"asin", 73, 1},
+    {"mad", 122, 1},
+    {nullptr, 0, 0},
+    {"lerp", 117, 1},
+    {"WaveGetLaneIndex", 58, 1},
+    {"tex2Dgrad", 165, 1},
+    {"tex3Dproj", 173, 1},
+    {"fmod", 108, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"cos", 84, 1},
+    {"ddy_fine", 93, 1},
+    {"AddUint64", 0, 1},
+    {"tex1Dlod", 160, 1},
+    {nullptr, 0, 0},
+    {"isinf", 113, 1},
+    {nullptr, 0, 0},
+    {"WaveActiveCountBits", 52, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"GetAttributeAtVertex", 10, 1},
+    {nullptr, 0, 0},
+    {"GroupMemoryBarrier", 13, 1},
+    {"sign", 146, 1},
+    {"asuint16", 78, 1},
+    {nullptr, 0, 0},
+    {"sqrt", 152, 1},
+    {"tex2Dproj", 167, 1},
+    {"WaveGetLaneCount", 57, 1},
+    {"dot", 97, 1},
+    {"log", 119, 1},
+    {"tanh", 155, 1},
+    {"rcp", 139, 1},
+    {nullptr, 0, 0},
+    {"WavePrefixCountBits", 60, 1},
+    {"EvaluateAttributeCentroid", 8, 1},
+    {"WaveReadLaneAt", 63, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"DeviceMemoryBarrierWithGroupSync", 6, 1},
+    {"Process2DQuadTessFactorsAvg", 31, 1},
+    {"f16tof32", 101, 1},
+    {"InterlockedAnd", 17, 2},
+    {"log2", 121, 1},
+    {"WaveActiveAnyTrue", 47, 1},
+    {"ddx", 88, 1},
+    {"QuadReadLaneAt", 44, 1},
+    {nullptr, 0, 0},
+    {"ProcessTriTessFactorsMin", 40, 1},
+    {nullptr, 0, 0},
+    {"min", 124, 1},
+    {"WaveActiveSum", 56, 1},
+    {nullptr, 0, 0},
+    {"Process2DQuadTessFactorsMax", 32, 1},
+    {"saturate", 145, 1},
+    {nullptr, 0, 0},
+    {"NonUniformResourceIndex", 30, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"isnan", 114, 1},
+    {nullptr, 0, 0},
+    {"InterlockedCompareExchange", 19, 1},
+    {"lit", 118, 1},
+    {"countbits", 86, 1},
+    {"GetRenderTargetSamplePosition", 12, 1},
+    {"WaveActiveMin", 54, 1},
+    {"trunc", 181, 1},
+    {"source_mark", 151, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"QuadReadAcrossX", 42, 1},
+    {"tex3Dbias", 170, 1},
+    {"any", 69, 1},
+    {"ddx_fine", 90, 1},
+    {nullptr, 0, 0},
+    {"pow", 137, 1},
+    {"InterlockedMin", 24, 2},
+    {"firstbithigh", 104, 1},
+    {nullptr, 0, 0},
+    {"WaveActiveMax", 53, 1},
+    {"InterlockedAdd", 15, 2},
+    {nullptr, 0, 0},
+    {"smoothstep", 150, 1},
+    {"WaveReadLaneFirst", 64, 1},
+    {nullptr, 0, 0},
+    {"QuadReadAcrossDiagonal", 41, 1},
+    {nullptr, 0, 0},
+    {"WaveActiveProduct", 55, 1},
+    {nullptr, 0, 0},
+    {"fma", 107, 1},
+    {"faceforward", 103, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"cosh", 85, 1},
+    {"asuint", 76, 2},
+    {"WaveActiveBitOr", 50, 1},
+    {"InterlockedMax", 22, 2},
+    {"InterlockedOr", 26, 2},
+    {"msad4", 126, 1},
+    {"tex2D", 162, 2},
+    {"sin", 147, 1},
+    {"WaveActiveBitAnd", 49, 1},
+    {"cross", 87, 1},
+    {nullptr, 0, 0},
+    {"ddx_coarse", 89, 1},
+    {"asdouble", 70, 1},
+    {"AllMemoryBarrier", 1, 1},
+    {"distance", 96, 1},
+    {"asint", 74, 1},
+    {nullptr, 0, 0},
+    {"abort", 65, 1},
+    {"texCUBEbias", 176, 1},
+    {"tex2Dbias", 164, 1},
+    {"WaveActiveBitXor", 51, 1},
+    {"WavePrefixSum", 62, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"WaveActiveAllEqual", 45, 1},
+    {"dst", 98, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"reversebits", 142, 1},
+    {"D3DCOLORtoUBYTE4", 4, 1},
+    {"frac", 109, 1},
+    {"WaveIsFirstLane", 59, 1},
+    {"asfloat16", 72, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"ProcessTriTessFactorsMax", 39, 1},
+    {"ProcessQuadTessFactorsMin", 37, 1},
+    {"ProcessQuadTessFactorsAvg", 35, 1},
+    {nullptr, 0, 0},
+    {"firstbitlow", 105, 1},
+    {"floor", 106, 1},
+    {"f32tof16", 102, 1},
+    {"ProcessQuadTessFactorsMax", 36, 1},
+    {"sincos", 148, 1},
+    {"radians", 138, 1},
+    {"frexp", 110, 1},
+    {"tex3D", 168, 2},
+    {"degrees", 94, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"step", 153, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"ProcessTriTessFactorsAvg", 38, 1},
+    {"round", 143, 1},
+    {"CheckAccessFullyMapped", 3, 1},
+    {nullptr, 0, 0},
+    {"refract", 141, 1},
+    {nullptr, 0, 0},
+    {"WaveActiveBallot", 48, 1},
+    {nullptr, 0, 0},
+    {"reflect", 140, 1},
+    {"abs", 66, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"log10", 120, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"clip", 83, 1},
+    {"exp2", 100, 1},
+    {nullptr, 0, 0},
+    {"GetRenderTargetSampleCount", 11, 1},
+    {"acos", 67, 1},
+    {"determinant", 95, 1},
+    {nullptr, 0, 0},
+    {"modf", 125, 1},
+    {"asfloat", 71, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"mul", 127, 9},
+    {"isfinite", 112, 1},
+    {nullptr, 0, 0},
+    {"Process2DQuadTessFactorsMin", 33, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"ldexp", 115, 1},
+    {nullptr, 0, 0},
+    {"atan", 79, 1},
+    {"tex2Dlod", 166, 1},
+    {"length", 116, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"transpose", 180, 1},
+    {"tan", 154, 1},
+    {"texCUBEgrad", 177, 1},
+    {"EvaluateAttributeSnapped", 9, 1},
+    {"ddy", 91, 1},
+    {"tex1Dbias", 158, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"exp", 99, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"tex1D", 156, 2},
+    {"all", 68, 1},
+    {"atan2", 80, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+    {"GroupMemoryBarrierWithGroupSync", 14, 1},
+    {"tex1Dproj", 161, 1},
+    {"tex3Dlod", 172, 1},
+    {nullptr, 0, 0},
+    {nullptr, 0, 0},
+};
+// HLSL-INTRINSIC-NAME-HASH:END
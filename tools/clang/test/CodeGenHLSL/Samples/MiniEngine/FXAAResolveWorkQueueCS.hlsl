@@ -1,9 +1,9 @@
-// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_0 -Zi %s | FileCheck %s
 
 // CHECK: flattenedThreadIdInGroup
 // CHECK: bufferLoad
 // CHECK: bufferStore
-// note that the following checks might fail on release builds, as they rely on basic block names being preserved
+// note that the following checks rely on basic block names, which release builds only keep with -Zi
 // CHECK: if.then
 // CHECK: if.end
 
@@ -0,0 +1,7 @@
+
+float scale(float a, uint mode) {
+  if (mode == 1)
+    return a * 2;
+  return sin(a);
+}
+
@@ -0,0 +1,10 @@
+// Make sure constant arguments are propagated into linked functions.
+
+float scale(float a, uint mode);
+
+[shader("pixel")]
+float4 ps_main(float a : A) : SV_TARGET
+{
+  return scale(a, 1);
+}
+
@@ -0,0 +1,24 @@
+// RUN: %dxc -T lib_6_1 %s | FileCheck %s
+
+// Identical exports are kept, but all but one only call the first.
+// CHECK: define {{.*}} @"\01?blend_a{{[^"]*}}"(
+// CHECK: define {{.*}} @"\01?blend_b{{[^"]*}}"(
+// CHECK-NEXT: call {{.*}} @"\01?blend_a{{[^"]*}}"(
+// CHECK-NEXT: ret
+
+// A different constant keeps its own body.
+// CHECK: define {{.*}} @"\01?blend_c{{[^"]*}}"(
+// CHECK-NOT: call {{.*}} @"\01?blend_a
+// CHECK: ret
+
+export float4 blend_a(float4 a, float4 b) {
+  return sin(a) * 0.25 + b * 0.75;
+}
+
+export float4 blend_b(float4 a, float4 b) {
+  return sin(a) * 0.25 + b * 0.75;
+}
+
+export float4 blend_c(float4 a, float4 b) {
+  return sin(a) * 0.5 + b * 0.75;
+}
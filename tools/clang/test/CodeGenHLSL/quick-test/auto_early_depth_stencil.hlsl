@@ -0,0 +1,30 @@
+// RUN: %dxc -E main -T ps_6_0 -auto-early-depth-stencil %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck -check-prefix=OFF %s
+// RUN: %dxc -E main -T ps_6_0 -auto-early-depth-stencil -DDISCARD %s | FileCheck -check-prefix=DISCARD %s
+// RUN: %dxc -E main -T ps_6_0 -auto-early-depth-stencil -DUAV %s | FileCheck -check-prefix=UAV %s
+
+// A shader that can't tell early from late depth-stencil gets the flag.
+// CHECK: ; Early depth-stencil: forced
+// CHECK: !{i32 0, i64 8}
+
+// Without the option, the disassembly says the flag could be set.
+// OFF: ; Early depth-stencil: not forced, and safe to force
+
+// DISCARD: ; Early depth-stencil: not forced, as the shader uses discard
+// UAV: ; Early depth-stencil: not forced, as the shader writes to UAVs
+
+Texture2D<float4> tex;
+SamplerState samp;
+RWBuffer<uint> counts;
+
+float4 main(float2 uv : TEXCOORD, float4 pos : SV_Position) : SV_Target {
+  float4 c = tex.Sample(samp, uv);
+#ifdef DISCARD
+  if (c.a < 0.5)
+    discard;
+#endif
+#ifdef UAV
+  counts[(uint)pos.x] = 1;
+#endif
+  return c;
+}
@@ -0,0 +1,26 @@
+// RUN: %dxc -E main -T ps_6_0 -auto-flatten %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -auto-flatten %s 2>&1 | FileCheck %s -check-prefix=REMARK
+
+// The branch on the interpolated values diverges and its side is cheap, so
+// it becomes a select.
+// CHECK: fcmp
+// CHECK: call float @dx.op.unary.f32(i32 24,
+// CHECK: select
+
+// The branch on the constant buffer value is uniform and stays.
+// CHECK: br i1
+
+// REMARK-DAG: remark: flattened divergent branch with sides costing {{[0-9]+}} in 'main'
+// REMARK-DAG: remark: kept branch with a condition uniform across the wave in 'main'
+
+float scale;
+uint mode;
+
+float main(float a : A, float b : B) : SV_Target {
+  float r = a;
+  if (a > b)
+    r = sqrt(a * b) + 1;
+  if (mode == 3)
+    r = sqrt(r * scale) - 2;
+  return r;
+}
@@ -0,0 +1,33 @@
+// RUN: %dxc -E main -T ps_6_0 -bottom-up-inline %s | FileCheck %s
+
+// Each helper is simplified before it is inlined, and the result is the same
+// single function with no locals left in memory.
+// CHECK: define void @main()
+// CHECK-NOT: alloca
+// CHECK-NOT: call {{.*}} @"\01?
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 3,
+// CHECK: ret void
+
+struct Pair {
+  float4 a;
+  float4 b;
+};
+
+Pair make(float4 v) {
+  Pair p;
+  p.a = v;
+  p.b = v * 2;
+  return p;
+}
+
+float4 combine(Pair p) {
+  return p.a + p.b;
+}
+
+float4 scale(float4 v) {
+  return combine(make(v));
+}
+
+float4 main(float4 v : V) : SV_Target {
+  return scale(scale(v));
+}
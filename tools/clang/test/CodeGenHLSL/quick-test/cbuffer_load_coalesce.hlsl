@@ -0,0 +1,20 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Both branches read row 0 of the cbuffer; the load is shared from the
+// block that dominates them.
+// CHECK: call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{.*}}, i32 0)
+// CHECK-NOT: @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %{{.*}}, i32 0)
+// CHECK: ret void
+
+cbuffer CB {
+  float4 a;
+  float4 b;
+};
+
+float4 main(float c : C) : SV_Target {
+  [branch]
+  if (c > 0)
+    return a.x * c;
+  else
+    return a.y + b.z;
+}
@@ -0,0 +1,28 @@
+// RUN: %dxc -T lib_6_3 -compact-context %s | FileCheck %s
+// RUN: %dxc -T lib_6_3 -compact-context -Zi %s | FileCheck %s
+// RUN: %dxc -E ps_main -T ps_6_0 -compact-context %s | FileCheck -check-prefix=PS %s
+
+// Freeing unused constants keeps the ones initializers, instructions and
+// metadata still use.
+// CHECK: [4 x float] [float 1.000000e+00, float 2.000000e+00, float 3.000000e+00, float 4.000000e+00]
+// CHECK: define float @"\01?Blend@@
+// CHECK: !dx.typeAnnotations
+
+// PS: @dx.op.cbufferLoadLegacy
+// PS: @dx.op.storeOutput.f32
+
+static const float Weights[4] = { 1, 2, 3, 4 };
+
+cbuffer Params {
+  float4x4 Transform;
+  int Index;
+};
+
+export float Blend(float4x4 m, int i) {
+  float4x4 t = mul(m, Transform);
+  return t[i & 3][0] * Weights[i & 3];
+}
+
+float4 ps_main(float4 pos : SV_Position) : SV_Target {
+  return mul(pos, Transform) * Weights[Index & 3];
+}
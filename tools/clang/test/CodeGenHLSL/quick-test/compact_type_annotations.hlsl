@@ -0,0 +1,20 @@
+// RUN: %dxc -E main -T ps_6_0 -compact-type-annotations %s | FileCheck %s
+
+// Make sure type annotations are one tuple with the records followed by the
+// annotated struct and function, and that the validator reads them.
+// CHECK: !dx.typeAnnotations = !{![[TA:[0-9]+]]}
+// CHECK: ![[TA]] = !{i32 2, !"{{.*}}", {{.*}} undef, {{.*}}@main}
+
+struct Light {
+  float3 dir;
+  float4 color;
+};
+
+cbuffer Lights {
+  Light lights[2];
+  float4x4 xform;
+};
+
+float4 main(float3 n : NORMAL) : SV_Target {
+  return mul(xform, lights[0].color * dot(n, lights[1].dir));
+}
@@ -0,0 +1,22 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Declare 10000 textures and use 1000 of them; the used ones are condensed to
+// IDs 0..999 in declaration order.
+// CHECK-DAG: call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 0, i1 false)
+// CHECK-DAG: call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 999, i32 999, i1 false)
+
+#define R1(M, p) M(p##0) M(p##1) M(p##2) M(p##3) M(p##4) M(p##5) M(p##6) M(p##7) M(p##8) M(p##9)
+#define R2(M, p) R1(M, p##0) R1(M, p##1) R1(M, p##2) R1(M, p##3) R1(M, p##4) R1(M, p##5) R1(M, p##6) R1(M, p##7) R1(M, p##8) R1(M, p##9)
+#define R3(M, p) R2(M, p##0) R2(M, p##1) R2(M, p##2) R2(M, p##3) R2(M, p##4) R2(M, p##5) R2(M, p##6) R2(M, p##7) R2(M, p##8) R2(M, p##9)
+#define R4(M, p) R3(M, p##0) R3(M, p##1) R3(M, p##2) R3(M, p##3) R3(M, p##4) R3(M, p##5) R3(M, p##6) R3(M, p##7) R3(M, p##8) R3(M, p##9)
+
+#define D(name) Texture2D<float> name;
+#define U(name) r += name.Load(int3(0, 0, 0));
+
+R4(D, t)
+
+float main() : SV_Target {
+  float r = 0;
+  R3(U, t1)
+  return r;
+}
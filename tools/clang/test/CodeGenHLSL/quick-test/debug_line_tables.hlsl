@@ -0,0 +1,18 @@
+// RUN: %dxc -E main -T ps_6_0 -Od -Zi-lines %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -Od -Zi-lines %s | FileCheck -check-prefix=SRC %s
+
+// Line tables only have locations and subprograms: no variables or types.
+// CHECK-NOT: llvm.dbg.declare
+// CHECK-NOT: llvm.dbg.value
+// CHECK: !DICompileUnit({{.*}}emissionKind: 2
+// CHECK-DAG: !DISubprogram(name: "main"
+// CHECK-DAG: !DILocation(line: 16,
+// CHECK-NOT: !DILocalVariable
+
+// Sources are embedded as with /Zi.
+// SRC: !llvm.dbg.contents
+
+float4 main(float4 c : C) : SV_TARGET {
+  float4 a = abs(c);
+  return a;
+}
@@ -0,0 +1,11 @@
+// RUN: %dxc -E main -T ps_6_0 -Zi -I C:/build/inc -fdebug-prefix-map=C:/build=/src %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -Zi -I C:/build/inc -fdebug-prefix-map=C:/build=/src %s | FileCheck %s -check-prefix=NOMAP
+
+// Make sure include paths recorded in debug information are remapped, and
+// that the mapping itself isn't recorded.
+// CHECK: !"-I", !"/src/inc"
+// NOMAP-NOT: !"-fdebug-prefix-map
+
+float4 main(float4 a : A) : SV_Target {
+  return a * 2;
+}
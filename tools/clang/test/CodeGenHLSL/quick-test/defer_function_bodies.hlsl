@@ -0,0 +1,22 @@
+// RUN: %dxc -E main -T ps_6_0 -defer-function-bodies %s | FileCheck %s
+
+// Bodies of functions the entry point never references are not checked.
+// CHECK: define void @main()
+// CHECK: fadd fast float
+// CHECK: fmul fast float
+
+float unused_helper(float x) {
+  return undeclared_name * x;
+}
+
+float helper2(float x) {
+  return x + 1.0;
+}
+
+float helper1(float x) {
+  return helper2(x) * 2.0;
+}
+
+float main(float a : A) : SV_Target {
+  return helper1(a);
+}
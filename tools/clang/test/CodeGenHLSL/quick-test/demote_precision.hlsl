@@ -0,0 +1,27 @@
+// RUN: %dxc -E main -T ps_6_2 -enable-16bit-types -demote-precision %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_2 -enable-16bit-types -demote-precision %s 2>&1 | FileCheck %s -check-prefix=REMARK
+
+// The blend of two unorm texels stays within one 8-bit step in half, so it
+// is computed in half and widened for the store to the unorm target.
+// CHECK: fptrunc float %{{.*}} to half
+// CHECK: fmul {{.*}}half
+// CHECK: call half @dx.op.unary.f16(i32 7,
+// CHECK: fpext half %{{.*}} to float
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 3,
+
+// The float target isn't unorm, so its product isn't demoted.
+// CHECK-NOT: fpext
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 1,
+
+// REMARK: demoted {{[0-9]+}} of {{[0-9]+}} float operations in 'main' to half
+
+Texture2D<unorm float4> tex;
+SamplerState samp;
+
+void main(float2 uv : TEXCOORD, out unorm float4 color : SV_Target0,
+          out float4 raw : SV_Target1) {
+  float4 a = tex.Sample(samp, uv);
+  float4 b = tex.Sample(samp, uv + 0.5);
+  color = saturate(a * 0.25 + b * 0.75) * 0.5 + 0.25;
+  raw = a * b;
+}
@@ -0,0 +1,22 @@
+// Release builds are the ones without asserts.
+// UNSUPPORTED: asserts
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -Zi %s | FileCheck %s -check-prefix=ZI
+
+// Block names from IR generation are dropped unless debug information is
+// generated; the names lowering gives resource handles are kept.
+// CHECK: %buf_texture_{{[a-z]+}} = call %dx.types.Handle @dx.op.createHandle
+// CHECK-NOT: if.then
+// CHECK: ret void
+
+// ZI: if.then
+
+Buffer<float4> buf;
+uint n;
+
+float4 main() : SV_Target {
+  float4 r = 0;
+  if (n > 3)
+    r = buf[n];
+  return r;
+}
@@ -0,0 +1,36 @@
+// RUN: %dxc -E main -T ds_6_0 %s | FileCheck %s
+
+// Loads at a constant row are shared; dynamically indexed rows still load
+// per use.
+// CHECK: call float @dx.op.loadPatchConstant.f32(i32 104, i32 2, i32 3, i8 0)
+// CHECK-NOT: call float @dx.op.loadPatchConstant.f32(i32 104, i32 2, i32 3, i8 0)
+// CHECK: call float @dx.op.loadPatchConstant.f32(i32 104, i32 2, i32 %
+// CHECK: ret void
+
+struct PatchConstants {
+  float edges[4] : SV_TessFactor;
+  float inside[2] : SV_InsideTessFactor;
+  float4 data[32] : DATA;
+};
+
+struct ControlPoint {
+  float4 pos : POSITION;
+};
+
+struct DSOut {
+  float4 pos : SV_Position;
+  float4 color : COLOR;
+};
+
+[domain("quad")]
+DSOut main(PatchConstants pc, float2 uv : SV_DomainLocation,
+           const OutputPatch<ControlPoint, 4> patch, uint i : I) {
+  DSOut o;
+  o.pos = lerp(lerp(patch[0].pos, patch[1].pos, uv.x),
+               lerp(patch[3].pos, patch[2].pos, uv.x), uv.y);
+  o.pos.x += pc.data[3].x;
+  o.color = pc.data[i % 32];
+  if (uv.x > 0.5)
+    o.color.x += pc.data[3].x * pc.data[(i + 1) % 32].y;
+  return o;
+}
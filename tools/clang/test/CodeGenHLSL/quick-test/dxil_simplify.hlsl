@@ -0,0 +1,29 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Zero offsets are dropped from the sample.
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62, %dx.types.Handle %{{.*}}, %dx.types.Handle %{{.*}}, float %{{.*}}, float %{{.*}}, float undef, float undef, i32 undef, i32 undef, i32 undef, float 0.000000e+00)
+
+// The sum is the same in every lane, so reading it back or taking its maximum
+// is the sum itself.
+// CHECK: call float @dx.op.waveActiveOp.f32(i32 119,
+// CHECK-NOT: waveReadLaneFirst
+// CHECK-NOT: waveActiveAllEqual
+// CHECK-NOT: call float @dx.op.waveActiveOp.f32(i32 119, {{.*}} i8 3,
+
+// f32tof16 of a constant is folded.
+// CHECK: call void @dx.op.storeOutput.i32(i32 5, i32 1, i32 0, i8 0, i32 15360)
+
+Texture2D tex;
+SamplerState samp;
+
+void main(float2 uv : TEXCOORD, out float4 color : SV_Target0,
+          out uint bits : SV_Target1) {
+  float4 t = tex.SampleLevel(samp, uv, 0, int2(0, 0));
+  float sum = WaveActiveSum(t.x);
+  float first = WaveReadLaneFirst(sum);
+  float biggest = WaveActiveMax(sum);
+  color = t * first + biggest;
+  if (WaveActiveAllEqual(sum))
+    color += 1;
+  bits = f32tof16(1.0);
+}
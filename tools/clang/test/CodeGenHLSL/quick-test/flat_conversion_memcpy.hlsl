@@ -0,0 +1,31 @@
+// RUN: %dxc -E main -T ps_6_0 -fcgl %s | FileCheck %s -check-prefix=CGL
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Make sure a cast between structs that only differ in name copies with a
+// memcpy, which SROA_HLSL still splits into the fields.
+// CGL: call void @llvm.memcpy
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 3, float
+
+struct Inner {
+  float2 f;
+  int i;
+};
+
+struct A {
+  Inner a[4];
+  float4 v;
+};
+
+struct B {
+  Inner b[4];
+  float4 w;
+};
+
+A ga;
+int idx;
+
+float4 main() : SV_Target {
+  B b = (B)ga;
+  return b.w + b.b[idx].f.xyxy + b.b[1].i;
+}
@@ -0,0 +1,26 @@
+// RUN: %dxc -E main -T ps_6_0 -fp-speed=fast %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -fp-speed=fast %s | FileCheck %s -check-prefix=NOOP
+
+// normalize multiplies by rsqrt instead of dividing by sqrt.
+// CHECK: call float @dx.op.unary.f32(i32 25,
+
+// atan2 is expanded with the short atan polynomial.
+// CHECK: call float @dx.op.binary.f32(i32 36,
+// CHECK: call float @dx.op.binary.f32(i32 35,
+// CHECK: fmul {{.*}}0xBFC891C080000000
+
+// asin is expanded in the compiler with the short polynomial.
+// CHECK: call float @dx.op.unary.f32(i32 24,
+// CHECK: fmul {{.*}}0xBFC5897B40000000
+
+// No atan, asin, or the log of pow with a constant exponent of 2 remain.
+// NOOP: define void @main()
+// NOOP-NOT: call float @dx.op.unary.f32(i32 17,
+// NOOP-NOT: call float @dx.op.unary.f32(i32 16,
+// NOOP-NOT: call float @dx.op.unary.f32(i32 23,
+// NOOP: ret void
+
+float4 main(float2 a : A, float3 n : N, float b : B) : SV_Target {
+  float3 d = normalize(n);
+  return float4(atan2(a.y, a.x), d.x * d.y, pow(b, 2.0), asin(b));
+}
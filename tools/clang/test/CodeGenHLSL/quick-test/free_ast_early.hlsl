@@ -0,0 +1,17 @@
+// RUN: %dxc -E main -T ps_6_0 -free-ast-early -unroll-report %s 2>&1 | FileCheck %s
+
+// The AST is gone by the time the loop is unrolled; the remark still goes
+// through the source manager.
+// CHECK-DAG: remark: unrolled loop with trip count 4 by a factor of 4
+// CHECK-DAG: define void @main()
+// CHECK-DAG: call void @dx.op.storeOutput.f32
+
+Buffer<float4> buf;
+uint n;
+
+float4 main() : SV_Target {
+  float4 r = 0;
+  [unroll] for (uint i = 0; i < 4; ++i)
+    r += buf[i * n];
+  return r;
+}
@@ -0,0 +1,32 @@
+// RUN: %dxc -E main -T ps_6_0 -gather-point-samples %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck -check-prefix=OFF %s
+
+// The four red samples of the block at offset (-1, 0) become one gather, at
+// the corner between the texels.
+// CHECK: call %dx.types.Dimensions @dx.op.getDimensions(i32 72, %dx.types.Handle %{{.*}}, i32 0)
+// CHECK: call float @dx.op.unary.f32(i32 27,
+// CHECK: call %dx.types.ResRet.f32 @dx.op.textureGather.f32(i32 73, %dx.types.Handle %{{.*}}, %dx.types.Handle %{{.*}}, float %{{.*}}, float %{{.*}}, float undef, float undef, i32 -1, i32 0, i32 0)
+
+// The green sample has no block and is kept.
+// CHECK-NOT: call %dx.types.ResRet.f32 @dx.op.textureGather
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62, {{.*}}, i32 2, i32 2, i32 undef, float 0.000000e+00)
+// CHECK-NOT: call %dx.types.ResRet.f32 @dx.op.sampleLevel
+
+// OFF-NOT: textureGather
+// OFF: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62
+// OFF: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62
+// OFF: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62
+// OFF: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62
+// OFF: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62
+
+Texture2D<float4> tex;
+SamplerState pointSamp;
+
+float4 main(float2 uv : TEXCOORD) : SV_Target {
+  float a = tex.SampleLevel(pointSamp, uv, 0, int2(-1, 0)).r;
+  float b = tex.SampleLevel(pointSamp, uv, 0, int2(0, 0)).r;
+  float c = tex.SampleLevel(pointSamp, uv, 0, int2(-1, 1)).r;
+  float d = tex.SampleLevel(pointSamp, uv, 0, int2(0, 1)).r;
+  float e = tex.SampleLevel(pointSamp, uv, 0, int2(2, 2)).g;
+  return float4(a * 0.1 + b * 0.2 + c * 0.3 + d * 0.4, e, 0, 1);
+}
@@ -0,0 +1,28 @@
+// RUN: %dxc -E main -T cs_6_0 -pad-groupshared %s | FileCheck %s
+
+// b is only used after the sync that ends the last use of a, so the two
+// share storage. tile is padded to 33 elements per row.
+// CHECK: ; Groupshared Memory:
+// CHECK: ; a {{ +}}256
+// CHECK-NOT: ; b
+// CHECK: ; tile {{ +}}8448
+// CHECK: ; Total {{ +}}8704
+
+groupshared float a[64];
+groupshared float b[64];
+groupshared float tile[64][32];
+RWStructuredBuffer<float> buf;
+
+[numthreads(64, 1, 1)]
+void main(uint tid : SV_GroupIndex) {
+  a[tid] = buf[tid];
+  GroupMemoryBarrierWithGroupSync();
+  float v = a[63 - tid];
+  GroupMemoryBarrierWithGroupSync();
+  b[tid] = v * 2;
+  GroupMemoryBarrierWithGroupSync();
+  float w = b[(tid + 1) % 64];
+  tile[tid][tid % 32] = w;
+  GroupMemoryBarrierWithGroupSync();
+  buf[tid] = tile[tid % 32][tid / 32];
+}
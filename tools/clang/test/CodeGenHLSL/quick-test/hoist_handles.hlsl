@@ -0,0 +1,21 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// The store in the loop keeps the handles in it, but they are created once
+// before the loop.
+// CHECK: call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0,
+// CHECK: phi i32
+// CHECK-NOT: createHandle
+
+Texture2D<float4> tex[8];
+RWBuffer<float4> output;
+
+cbuffer Params {
+  uint idx;
+  uint n;
+};
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  for (uint i = 0; i < n; ++i)
+    output[id * n + i] = tex[idx].Load(int3(i, id, 0));
+}
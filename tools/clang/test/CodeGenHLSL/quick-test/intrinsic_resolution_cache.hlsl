@@ -0,0 +1,16 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Calls with the same argument types reuse the overload resolved first; calls
+// with other types or with literal arguments are resolved on their own.
+// CHECK-DAG: call i32 @dx.op.binary.i32(i32 37, i32 %{{.*}}, i32 %{{.*}})
+// CHECK-DAG: call i32 @dx.op.binary.i32(i32 37, i32 %{{.*}}, i32 %{{.*}})
+// CHECK-DAG: call float @dx.op.binary.f32(i32 35, float %{{.*}}, float %{{.*}})
+// CHECK-DAG: call float @dx.op.binary.f32(i32 35, float %{{.*}}, float 2.000000e+00)
+
+int4 main(int a : A, int b : B, float c : C, float d : D) : SV_Target {
+  int i = max(a, b);
+  float f = max(c, d);
+  int j = max(b + 1, a);
+  float g = max(d, 2.0);
+  return int4(i, j, f, g);
+}
@@ -0,0 +1,16 @@
+// RUN: %dxc -E main -T ps_6_0 -Od %s | FileCheck %s
+
+// Make sure a large array that is only indexed with constants is kept as one
+// array instead of being split into an alloca per element.
+
+// CHECK: alloca [2048 x float]
+// CHECK-NOT: alloca float
+
+float main(float x : X, float y : Y) : SV_TARGET
+{
+  float a[2048];
+  a[0] = x;
+  a[1024] = y;
+  a[2047] = x * y;
+  return a[0] + a[1024] + a[2047];
+}
@@ -0,0 +1,12 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// The disassembly reports the estimated register pressure of each function.
+// CHECK: ; Estimated max live values: {{[0-9]+}}
+// CHECK: define void @main()
+
+float4 a;
+float4 b;
+
+float4 main(float4 c : C) : SV_Target {
+  return a * c + b;
+}
@@ -0,0 +1,25 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Repeated method calls with the same argument types share a deduced
+// specialization; a literal argument or other element types still deduce
+// their own.
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62
+// CHECK: call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62
+
+Texture2D<float4> t0;
+Texture2D<float4> t1;
+Texture2D<float> t2;
+Buffer<uint2> b0;
+SamplerState s;
+
+float4 main(float2 uv : TEXCOORD, float lod : LOD, uint i : I) : SV_Target {
+  float4 r = t0.Sample(s, uv);
+  r += t1.Sample(s, uv * 2);
+  r.xy += b0.Load(i);
+  r += t2.SampleLevel(s, uv, lod);
+  r += t1.SampleLevel(s, uv, 0);
+  return r;
+}
@@ -0,0 +1,17 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// The UAV store between them can't change the SRV, so the second load of
+// input[i] reuses the first.
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68,
+// CHECK: call void @dx.op.bufferStore.i32(i32 69,
+// CHECK-NOT: bufferLoad
+// CHECK: call void @dx.op.bufferStore.i32(i32 69,
+
+Buffer<uint> input;
+RWBuffer<uint> output;
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  output[id] = input[id & 7];
+  output[id + 64] = input[id & 7] * 3;
+}
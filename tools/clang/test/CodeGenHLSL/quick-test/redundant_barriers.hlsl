@@ -0,0 +1,23 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// The back-to-back barriers become one, and the last barrier is removed
+// since no shared memory access follows it.
+// CHECK: store float
+// CHECK: call void @dx.op.barrier(i32 80, i32 9)
+// CHECK-NOT: call void @dx.op.barrier
+// CHECK: load float
+// CHECK-NOT: call void @dx.op.barrier
+// CHECK: ret void
+
+groupshared float cache[64];
+RWStructuredBuffer<float> buf;
+
+[numthreads(64, 1, 1)]
+void main(uint tid : SV_GroupIndex) {
+  cache[tid] = buf[tid];
+  GroupMemoryBarrierWithGroupSync();
+  GroupMemoryBarrierWithGroupSync();
+  float v = cache[63 - tid];
+  GroupMemoryBarrierWithGroupSync();
+  buf[tid] = v;
+}
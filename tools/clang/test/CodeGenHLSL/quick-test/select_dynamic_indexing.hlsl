@@ -0,0 +1,18 @@
+// RUN: %dxc -E main -T ps_6_0 -select-dynamic-indexing %s | FileCheck %s
+
+// A dynamically indexed local vector is read and written with selects
+// instead of through an indexable array.
+// CHECK-NOT: alloca
+// CHECK: icmp eq i32 %{{.*}}, 1
+// CHECK: select i1
+// CHECK-NOT: alloca
+
+float4 a;
+uint i;
+uint j;
+
+float main(float b : B) : SV_Target {
+  float4 v = a;
+  v[i] = b;
+  return v[j];
+}
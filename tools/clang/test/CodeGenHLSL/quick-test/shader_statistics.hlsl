@@ -0,0 +1,20 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// The disassembly ends its header with static statistics of the entry.
+// CHECK: ; Statistics for main:
+// CHECK: ; Instructions {{ +}}{{[0-9]+}}
+// CHECK: ; Transcendental {{ +}}1
+// CHECK: ; Sample and gather {{ +}}1
+// CHECK: ; Load {{ +}}1
+// CHECK: ; Max live values {{ +}}{{[1-9][0-9]*}}
+// CHECK: ; Groupshared bytes {{ +}}0
+// CHECK: ; Indexable temp bytes {{ +}}0
+// CHECK: define void @main()
+
+Texture2D tex;
+SamplerState samp;
+float4 scale;
+
+float4 main(float2 uv : TEXCOORD) : SV_Target {
+  return tex.Sample(samp, uv) * sin(uv.x) * scale;
+}
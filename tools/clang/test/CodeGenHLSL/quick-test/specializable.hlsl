@@ -0,0 +1,15 @@
+// RUN: %dxc -E main -T ps_6_0 -specializable %s | FileCheck %s
+
+// kFactor is read from $Globals instead of being folded, and its default
+// is recorded for the specializer.
+// CHECK: float kFactor; {{ +}}; Offset: {{ +}}0
+// CHECK: call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32
+// CHECK: fmul
+// CHECK: !dx.specializable = !{![[SPEC:[0-9]+]]}
+// CHECK: ![[SPEC]] = !{!"kFactor", float 2.000000e+00}
+
+[specializable] static const float kFactor = 2.0;
+
+float4 main(float4 a : A) : SV_Target {
+  return a * kFactor;
+}
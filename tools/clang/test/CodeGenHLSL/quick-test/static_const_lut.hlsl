@@ -0,0 +1,16 @@
+// RUN: %dxc -E main -T ps_6_0 -fcgl %s | FileCheck %s
+
+// Make sure lookup tables get their initializers as whole constant arrays.
+// CHECK: lut{{.*}} = {{.*}}constant [8 x float] [float 0.000000e+00, float 1.000000e+00, float 2.000000e+00, float 3.000000e+00, float -4.000000e+00, float 5.000000e+00, float 6.000000e+00, float 7.500000e+00]
+// CHECK: ilut{{.*}} = {{.*}}constant [4 x i32] [i32 1, i32 -2, i32 3, i32 4]
+// CHECK: vlut{{.*}} = {{.*}}constant [2 x <2 x i32>] [<2 x i32> <i32 1, i32 2>, <2 x i32> <i32 3, i32 4>]
+
+static const float lut[] = { 0, 1, 2, 3, -4, 5, 6, 7.5 };
+static const int ilut[4] = { 1, -2, 3, 4 };
+static const int2 vlut[2] = { int2(1, 2), int2(3, 4) };
+
+uint i;
+
+float4 main() : SV_Target {
+  return float4(lut[i], ilut[i], vlut[i]);
+}
@@ -0,0 +1,28 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// Each field is lowered to its own access at its own element offset; the
+// loads of one element share one call and the stores merge into one.
+// CHECK: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 0)
+// CHECK-NOT: @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 {{4|8}})
+// CHECK: call void @dx.op.bufferStore.f32(i32 69, %dx.types.Handle %{{.*}}, i32 %{{.*}}, i32 0, float %{{.*}}, float %{{.*}}, float %{{.*}}, float undef, i8 7)
+// CHECK-NOT: @dx.op.bufferStore.f32
+// CHECK: ret void
+
+struct S {
+  float x;
+  float y;
+  float z;
+};
+
+StructuredBuffer<S> input;
+RWStructuredBuffer<S> output;
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  S s = input[id];
+  S r;
+  r.x = s.y * s.z;
+  r.y = s.x + s.z;
+  r.z = s.x - s.y;
+  output[id] = r;
+}
@@ -0,0 +1,18 @@
+// RUN: %dxc -E main -T ps_6_0 -trim-resource-ranges %s | FileCheck %s
+
+// tex is only indexed with constants, so it keeps the first three of its
+// eight descriptors and other is allocated right after them. dyn is
+// indexed dynamically and keeps its size.
+// CHECK: ; tex{{ +}}texture{{ +}}f32{{ +}}2d{{ +}}T0{{ +}}t0{{ +}}3
+// CHECK: ; other{{ +}}texture{{ +}}f32{{ +}}2d{{ +}}T1{{ +}}t3{{ +}}1
+// CHECK: ; dyn{{ +}}texture{{ +}}f32{{ +}}2d{{ +}}T2{{ +}}t4{{ +}}4
+
+Texture2D tex[8];
+Texture2D other;
+Texture2D dyn[4];
+SamplerState s;
+
+float4 main(float2 uv : TEXCOORD, uint i : I) : SV_Target {
+  return tex[0].Sample(s, uv) + tex[2].Sample(s, uv) + other.Sample(s, uv) +
+         dyn[i].Sample(s, uv);
+}
@@ -0,0 +1,30 @@
+// RUN: %dxc -E main -T cs_6_0 -uniform-branch-hints %s | FileCheck %s
+
+// A cbuffer condition and a WaveReadLaneFirst result are the same in every
+// lane; a thread id condition isn't.
+// CHECK: icmp ugt i32 %{{.*}}, 3
+// CHECK: br i1 {{.*}}!dx.uniform.branch
+// CHECK: icmp ugt i32 %{{.*}}, 7
+// CHECK-NOT: !dx.uniform.branch
+// CHECK: call void @dx.op.bufferStore
+// CHECK: call i32 @dx.op.waveReadLaneFirst.i32
+// CHECK: br i1 {{.*}}!dx.uniform.branch
+
+cbuffer CB {
+  uint n;
+};
+
+RWBuffer<uint> buf;
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  [branch]
+  if (n > 3)
+    buf[id] = 1;
+  [branch]
+  if (id > 7)
+    buf[id + 64] = 2;
+  [branch]
+  if (WaveReadLaneFirst(id) > 5)
+    buf[id + 128] = 3;
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T ps_6_0 -unroll-report %s 2>&1 | FileCheck %s
+
+// The constant trip count loop is unrolled and reported with its growth.
+// CHECK-DAG: remark: unrolled loop with trip count 4 by a factor of 4; '{{.*}}' grew from {{[0-9]+}} to {{[0-9]+}} instructions
+
+// The [unroll] loop with a runtime trip count can't be unrolled.
+// CHECK-DAG: remark: Unable to fully unroll loop as directed by unroll(full) pragma because loop has a runtime trip count.
+
+Buffer<float4> buf;
+uint n;
+
+float4 main() : SV_Target {
+  float4 r = 0;
+  [unroll] for (uint i = 0; i < 4; ++i)
+    r += buf[i * n];
+  [unroll] for (uint j = 0; j < n; ++j)
+    r *= buf[j];
+  return r;
+}
@@ -0,0 +1,39 @@
+// RUN: %dxc -E main -T ps_6_0 -unswitch-uniform-loops %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck -check-prefix=OFF %s
+// RUN: %dxc -E main -T ps_6_0 -unswitch-uniform-loops -DDIVERGENT %s | FileCheck -check-prefix=OFF %s
+
+// The constant buffer toggle is tested once, before one of two copies of
+// the light loop, each loading the lights.
+// CHECK: @dx.op.cbufferLoadLegacy
+// CHECK: br i1
+// CHECK: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68,
+// CHECK: call %dx.types.ResRet.f32 @dx.op.textureLoad.f32(i32 66,
+// CHECK: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68,
+
+// Without the option, or with a condition that differs across the wave,
+// the loop tests the condition each iteration.
+// OFF: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68,
+// OFF-NOT: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68,
+
+cbuffer Lighting {
+  uint g_LightCount;
+  bool g_UseShadows;
+};
+Buffer<float4> lights;
+Texture2D<float> shadows;
+
+float4 main(float4 pos : SV_Position) : SV_Target {
+#ifdef DIVERGENT
+  bool useShadows = pos.x > 0.5;
+#else
+  bool useShadows = g_UseShadows;
+#endif
+  float4 r = 0;
+  for (uint i = 0; i < g_LightCount; ++i) {
+    float4 l = lights[i];
+    if (useShadows)
+      l *= shadows.Load(int3(i, (int)pos.y, 0));
+    r += l;
+  }
+  return r;
+}
@@ -0,0 +1,23 @@
+// RUN: %dxc -E main -T cs_6_0 -wave-aggregate-atomics %s | FileCheck %s
+
+// Every lane adds to buf[0], so one lane adds the wave's sum, and each lane's
+// original value is rebuilt from the first lane's and a prefix sum.
+// CHECK: call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %{{.*}}, i8 0, i8 1)
+// CHECK: call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %{{.*}}, i32 0, i32 0,
+// CHECK: phi i32
+// CHECK: call i32 @dx.op.waveReadLaneFirst.i32(i32 118,
+// CHECK: call i32 @dx.op.wavePrefixOp.i32(i32 121, i32 %{{.*}}, i8 0, i8 1)
+
+// The address of the second add differs per lane, so it is left alone.
+// CHECK-NOT: waveIsFirstLane
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %{{.*}}, i32 0, i32 %
+
+RWByteAddressBuffer buf;
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  uint original;
+  buf.InterlockedAdd(0, id & 3, original);
+  buf.InterlockedAdd(256 + original * 4, 1);
+}
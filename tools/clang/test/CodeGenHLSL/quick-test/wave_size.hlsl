@@ -0,0 +1,29 @@
+// RUN: %dxc -E main -T cs_6_0 -wave-size 64 %s | FileCheck %s
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck -check-prefix=ANY %s
+
+// With a wave size, the lane count is a constant and the loop over the wave
+// in steps of 16 lanes is unrolled into four loads.
+// CHECK-NOT: waveGetLaneCount
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68, %dx.types.Handle %{{.*}}, i32 0,
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68, %dx.types.Handle %{{.*}}, i32 16,
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68, %dx.types.Handle %{{.*}}, i32 32,
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68, %dx.types.Handle %{{.*}}, i32 48,
+// CHECK-NOT: bufferLoad
+
+// The wave size is recorded with the shader properties.
+// CHECK: !{i32 4, !{{[0-9]+}}, i32 5, i32 64}
+
+// Without one, the lane count is queried.
+// ANY: call i32 @dx.op.waveGetLaneCount(i32 112)
+// ANY-NOT: i32 5, i32 64}
+
+Buffer<uint> input;
+RWBuffer<uint> output;
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  uint sum = 0;
+  for (uint i = 0; i < WaveGetLaneCount(); i += 16)
+    sum += input[i];
+  output[id] = sum;
+}
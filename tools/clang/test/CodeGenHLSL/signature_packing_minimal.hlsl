@@ -0,0 +1,17 @@
+// RUN: %dxc -E main -T ps_6_0 -pack_minimal %s | FileCheck %s
+
+// CHECK: ; Packed into 5 rows, 1 fewer than /pack_optimized
+
+// CHECK: {{![0-9]+}} = !{i32 0, !"A", i8 9, i8 0, {{![0-9]+}}, i8 2, i32 1, i8 3, i32 0, i8 0, null}
+// CHECK: {{![0-9]+}} = !{i32 1, !"B", i8 9, i8 0, {{![0-9]+}}, i8 2, i32 1, i8 3, i32 1, i8 0, null}
+// CHECK: {{![0-9]+}} = !{i32 2, !"C", i8 9, i8 0, {{![0-9]+}}, i8 2, i32 2, i8 1, i32 0, i8 3, null}
+// CHECK: {{![0-9]+}} = !{i32 3, !"D", i8 9, i8 0, {{![0-9]+}}, i8 1, i32 1, i8 1, i32 4, i8 0, null}
+// CHECK: {{![0-9]+}} = !{i32 4, !"E", i8 9, i8 0, {{![0-9]+}}, i8 2, i32 2, i8 1, i32 2, i8 3, null}
+// CHECK: {{![0-9]+}} = !{i32 5, !"F", i8 9, i8 0, {{![0-9]+}}, i8 2, i32 1, i8 3, i32 2, i8 0, null}
+// CHECK: {{![0-9]+}} = !{i32 6, !"G", i8 9, i8 0, {{![0-9]+}}, i8 2, i32 1, i8 1, i32 3, i8 0, null}
+
+float4 main(float3 a : A, float3 b : B, float c[2] : C,
+            nointerpolation float d : D, float e[2] : E, float3 f : F,
+            float g : G) : SV_Target {
+  return float4(a + b + f, c[0] + c[1] + d + e[0] + e[1] + g);
+}
@@ -0,0 +1,7 @@
+// Run: %dxc -T vs_6_0 -E main -E other
+
+float4 main(float4 pos : POSITION) : SV_Position { return pos; }
+
+float4 other(float4 pos : POSITION) : SV_Position { return pos * 2; }
+
+// CHECK: error: multiple entry points are only supported for PS and CS
@@ -0,0 +1,28 @@
+// Run: %dxc -T ps_6_0 -E main -E other
+
+// Both entry points share the helper function and the resources. Each one
+// lists only its own stage variables, whose locations start from 0.
+
+// CHECK:      OpEntryPoint Fragment %main "main" [[mainColor:%\w+]] [[mainTarget:%\w+]]{{$}}
+// CHECK-NEXT: OpEntryPoint Fragment %other "other" [[otherUV:%\w+]] [[otherColor:%\w+]] [[otherTarget:%\w+]]{{$}}
+// CHECK:      OpExecutionMode %main OriginUpperLeft
+// CHECK-NEXT: OpExecutionMode %other OriginUpperLeft
+
+// CHECK-DAG: OpDecorate [[mainColor]] Location 0
+// CHECK-DAG: OpDecorate [[mainTarget]] Location 0
+// CHECK-DAG: OpDecorate [[otherUV]] Location 0
+// CHECK-DAG: OpDecorate [[otherColor]] Location 1
+// CHECK-DAG: OpDecorate [[otherTarget]] Location 0
+
+Texture2D<float4> tex;
+SamplerState      samp;
+
+// CHECK:     %shade = OpFunction
+// CHECK-NOT: %shade_0 = OpFunction
+float4 shade(float4 c) { return c * 2; }
+
+float4 main(float4 color : COLOR) : SV_Target { return shade(color); }
+
+float4 other(float2 uv : TEXCOORD, float4 color : COLOR) : SV_Target {
+  return shade(tex.Sample(samp, uv) * color);
+}
@@ -0,0 +1,28 @@
+// Run: %dxc -T ps_6_0 -E main -fspv-relaxed-precision
+
+// Parameters, operations and intrinsics on min precision types are decorated,
+// the ones on full precision types are not.
+
+// CHECK:      OpDecorate %x RelaxedPrecision
+// CHECK-NEXT: OpDecorate [[neg:%\d+]] RelaxedPrecision
+// CHECK-NEXT: OpDecorate %a RelaxedPrecision
+// CHECK-NEXT: OpDecorate [[mul:%\d+]] RelaxedPrecision
+// CHECK-NEXT: OpDecorate [[sin:%\d+]] RelaxedPrecision
+// CHECK-NEXT: OpDecorate [[add:%\d+]] RelaxedPrecision
+// CHECK-NOT:  RelaxedPrecision
+
+// CHECK:      [[neg]] = OpFNegate %float
+// CHECK:      {{%\d+}} = OpFMul %float {{%\d+}} %float_2
+// CHECK:      [[mul]] = OpFMul %float
+// CHECK-NEXT: [[sin]] = OpExtInst %float {{%\d+}} Sin [[mul]]
+// CHECK:      [[add]] = OpFAdd %float [[sin]]
+
+min16float scale(min16float x, float y) {
+  min16float a = -x;
+  float b = y * 2;
+  return sin(a * x) + (min16float)b;
+}
+
+float4 main(float4 c : COLOR) : SV_Target {
+  return scale((min16float)c.x, c.y);
+}
@@ -0,0 +1,46 @@
+// Run: %dxc -T ps_6_0 -E main -fvk-auto-push-constant=128
+
+// PerDraw is the smallest cbuffer main uses within the limit, so it becomes
+// the push constant block. Unused is smaller but not used, and Bound asks for
+// a descriptor.
+
+// CHECK:      OpName %type_PushConstant_PerDraw "type.PushConstant.PerDraw"
+// CHECK-NEXT: OpMemberName %type_PushConstant_PerDraw 0 "tint"
+// CHECK-NEXT: OpMemberName %type_PushConstant_PerDraw 1 "offset"
+
+// CHECK-NOT:  OpDecorate %PerDraw DescriptorSet
+// CHECK-NOT:  OpDecorate %PerDraw Binding
+
+// CHECK:      %PerFrame = OpVariable %_ptr_Uniform_type_PerFrame Uniform
+// CHECK:      %PerDraw = OpVariable %_ptr_PushConstant_type_PushConstant_PerDraw PushConstant
+// CHECK:      %Unused = OpVariable %_ptr_Uniform_type_Unused Uniform
+// CHECK:      %Bound = OpVariable %_ptr_Uniform_type_Bound Uniform
+
+cbuffer PerFrame : register(b0) {
+    float4x4 viewProj[4];
+};
+
+cbuffer PerDraw : register(b1) {
+    float4 tint;
+    float4 offset;
+};
+
+cbuffer Unused : register(b2) {
+    float4 unused;
+};
+
+[[vk::binding(3)]]
+cbuffer Bound {
+    float4 bound;
+};
+
+// CHECK:      %helper = OpFunction
+// CHECK:      {{%\d+}} = OpAccessChain %_ptr_PushConstant_v4float %PerDraw %int_0
+// CHECK:      {{%\d+}} = OpAccessChain %_ptr_PushConstant_v4float %PerDraw %int_1
+float4 helper() {
+    return tint + offset;
+}
+
+float4 main(float4 pos : POS) : SV_Target {
+    return mul(viewProj[0], pos) + helper() + bound;
+}
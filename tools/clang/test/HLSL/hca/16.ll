@@ -0,0 +1,58 @@
+; RUN: %opt %s -hlsl-hca -S | FileCheck %s
+
+; A local copy of an internal constant array reads @LUT itself, and local
+; arrays with the same constant values share one global.
+; CHECK: @LUT = internal constant [2 x float] [float 1.000000e+00, float 2.000000e+00]
+; CHECK: @B.hca = internal unnamed_addr constant [2 x float] [float 5.000000e+00, float 6.000000e+00]
+; CHECK-NOT: @C.hca
+; CHECK-NOT: alloca
+; CHECK: getelementptr inbounds [2 x float], [2 x float]* @LUT, i32 0, i32 %i
+; CHECK: getelementptr inbounds [2 x float], [2 x float]* @B.hca, i32 0, i32 %i
+; CHECK: getelementptr inbounds [2 x float], [2 x float]* @B.hca, i32 0, i32 %i
+
+; The cbuffer leftover @cb isn't internal, so a copy of it isn't hoisted.
+; CHECK: alloca [2 x float]
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f:64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+@LUT = internal constant [2 x float] [float 1.000000e+00, float 2.000000e+00]
+@cb = constant [2 x float] zeroinitializer
+
+define float @main(i32 %i) {
+entry:
+  %A = alloca [2 x float]
+  %B = alloca [2 x float]
+  %C = alloca [2 x float]
+  %A0 = getelementptr inbounds [2 x float], [2 x float]* %A, i32 0, i32 0
+  %A1 = getelementptr inbounds [2 x float], [2 x float]* %A, i32 0, i32 1
+  %lut0 = load float, float* getelementptr inbounds ([2 x float], [2 x float]* @LUT, i32 0, i32 0)
+  store float %lut0, float* %A0
+  %lut1.ptr = getelementptr inbounds [2 x float], [2 x float]* @LUT, i32 0, i32 1
+  %lut1 = load float, float* %lut1.ptr
+  store float %lut1, float* %A1
+  %B0 = getelementptr inbounds [2 x float], [2 x float]* %B, i32 0, i32 0
+  %B1 = getelementptr inbounds [2 x float], [2 x float]* %B, i32 0, i32 1
+  store float 5.000000e+00, float* %B0
+  store float 6.000000e+00, float* %B1
+  %C0 = getelementptr inbounds [2 x float], [2 x float]* %C, i32 0, i32 0
+  %C1 = getelementptr inbounds [2 x float], [2 x float]* %C, i32 0, i32 1
+  store float 5.000000e+00, float* %C0
+  store float 6.000000e+00, float* %C1
+  %a.ptr = getelementptr inbounds [2 x float], [2 x float]* %A, i32 0, i32 %i
+  %a = load float, float* %a.ptr
+  %b.ptr = getelementptr inbounds [2 x float], [2 x float]* %B, i32 0, i32 %i
+  %b = load float, float* %b.ptr
+  %c.ptr = getelementptr inbounds [2 x float], [2 x float]* %C, i32 0, i32 %i
+  %c = load float, float* %c.ptr
+  %D = alloca [2 x float]
+  %D0 = getelementptr inbounds [2 x float], [2 x float]* %D, i32 0, i32 0
+  %cb0 = load float, float* getelementptr inbounds ([2 x float], [2 x float]* @cb, i32 0, i32 0)
+  store float %cb0, float* %D0
+  %d.ptr = getelementptr inbounds [2 x float], [2 x float]* %D, i32 0, i32 %i
+  %d = load float, float* %d.ptr
+  %ab = fadd float %a, %b
+  %abc = fadd float %ab, %c
+  %abcd = fadd float %abc, %d
+  ret float %abcd
+}
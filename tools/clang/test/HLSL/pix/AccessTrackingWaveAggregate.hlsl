@@ -0,0 +1,29 @@
+// RUN: %dxc -ECSMain -Tcs_6_0 %s | %opt -S -hlsl-dxil-pix-shader-access-instrumentation,config=S0:1:1i1;U0:2:10i0;..,waveAggregate=1 | %FileCheck %s
+
+// The constant-slot read is recorded once, by the first lane:
+// CHECK: %IsFirstLane = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: br i1 %IsFirstLane
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_CountUAV_Handle, i32 2, i32 4,
+
+// The second read of the same slot in the block isn't recorded again:
+// CHECK-NOT: atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_CountUAV_Handle, i32 2, i32 4,
+
+// The dynamically indexed write is recorded by every lane only if the
+// lanes' slots differ:
+// CHECK: %FirstLaneSlot = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %slotIndex)
+// CHECK: %DiffersFromFirst = icmp ne i32 %slotIndex, %FirstLaneSlot
+// CHECK: %SlotsDiffer = call i1 @dx.op.waveAnyTrue(i32 113, i1 %DiffersFromFirst)
+// CHECK: %ShouldRecord = or i1 %IsFirstLane{{[0-9]*}}, %SlotsDiffer
+// CHECK: br i1 %ShouldRecord
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_CountUAV_Handle, i32 2, i32
+
+
+ByteAddressBuffer inBuffer : register(t0);
+RWByteAddressBuffer bufferArray[] : register(u0);
+
+[numthreads(64, 1, 1)]
+void CSMain()
+{
+  uint dynamicBufferIndex = inBuffer.Load(0);
+  bufferArray[dynamicBufferIndex].Store(0, inBuffer.Load(4));
+}
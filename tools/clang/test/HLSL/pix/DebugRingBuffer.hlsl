@@ -0,0 +1,26 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -hlsl-dxil-debug-instrumentation,blockEntriesOnly=1,ringBuffer=1 | %FileCheck %s
+
+// Records go to a power-of-two ring after the header, and overwriting ones
+// are counted at offset 4:
+// CHECK: %UAVIncResult = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_DebugUAV_Handle, i32 0, i32 0, i32 undef, i32 undef, i32 %IncrementForThisInvocation)
+// CHECK: %MaskedForUAVLimit = and i32 %UAVIncResult, 524287
+// CHECK: %RingWrapped = icmp uge i32 %UAVIncResult, 524288
+// CHECK: %RingWrappedAsUint = zext i1 %RingWrapped to i32
+// CHECK: %OverflowForThisInvocation = mul i32 %RingWrappedAsUint, %OffsetMultiplicand
+// CHECK: %RingOverflowResult = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_DebugUAV_Handle, i32 0, i32 4, i32 undef, i32 undef, i32 %OverflowForThisInvocation)
+// CHECK: %RingOffset = add i32 %MaskedForUAVLimit, 16
+
+// Only the first instruction of each block is recorded, but the others
+// keep their indices:
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{.*}}, i32 undef, i32 0, i32 undef, i32 undef, i32 undef, i8 1)
+// CHECK-NOT: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{.*}}, i32 undef, i32 1, i32 undef, i32 undef, i32 undef, i8 1)
+// CHECK: br i1
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{.*}}, i32 undef, i32 {{[1-9][0-9]*}}, i32 undef, i32 undef, i32 undef, i8 1)
+
+[RootSignature("")]
+float4 main(float4 color : COLOR) : SV_Target {
+  [branch]
+  if (color.x > 0.5)
+    return color * color.y + color.z;
+  return color.wzyx;
+}
@@ -0,0 +1,18 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -hlsl-dxil-add-block-counters | %FileCheck %s
+
+// Check the handle to the counter UAV:
+// CHECK: %PIX_BlockCountUAV_Handle = call %dx.types.Handle @dx.op.createHandle(
+
+// Check that each block increments its own counter:
+// CHECK: %BlockCountResult = call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_BlockCountUAV_Handle, i32 0, i32 0, i32 undef, i32 undef, i32 1)
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_BlockCountUAV_Handle, i32 0, i32 4, i32 undef, i32 undef, i32 1)
+// CHECK: call i32 @dx.op.atomicBinOp.i32(i32 78, %dx.types.Handle %PIX_BlockCountUAV_Handle, i32 0, i32 8, i32 undef, i32 undef, i32 1)
+
+float4 main(float4 pos : SV_Position, uint c : C) : SV_Target {
+  float4 r = pos;
+  [branch]
+  if (c > 2) {
+    r = sin(r);
+  }
+  return r;
+}
@@ -11,6 +11,7 @@
 
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
 #include "dxc/HLSL/DxilContainer.h"
 #include "dxc/dxcapi.h"
 
@@ -34,6 +35,187 @@ HRESULT CreateContainerReflection(IDxcContainerReflection **ppReflection) {
                            (void **)ppReflection);
 }
 
+namespace {
+
+// Engines that compile at runtime call D3DCompile for every material, so the
+// objects a compile needs are kept for the thread rather than created each
+// call. A compiler may be shared by threads, but each thread keeping its own
+// avoids contending on its allocator.
+struct BridgeThreadState {
+  CComPtr<IDxcLibrary> Library;
+  CComPtr<IDxcCompiler> Compiler;
+  CComPtr<IDxcIncludeHandler> StandardInclude;
+  // Reused to convert D3D_SHADER_MACRO arrays without allocating each call.
+  std::vector<std::wstring> DefineValues;
+  std::vector<DxcDefine> Defines;
+};
+
+thread_local BridgeThreadState t_bridgeState;
+
+HRESULT GetThreadLibrary(IDxcLibrary **ppLibrary) {
+  if (t_bridgeState.Library == nullptr)
+    IFR(CreateLibrary(&t_bridgeState.Library));
+  return t_bridgeState.Library.CopyTo(ppLibrary);
+}
+
+HRESULT GetThreadCompiler(IDxcCompiler **ppCompiler) {
+  if (t_bridgeState.Compiler == nullptr)
+    IFR(CreateCompiler(&t_bridgeState.Compiler));
+  return t_bridgeState.Compiler.CopyTo(ppCompiler);
+}
+
+// Includes are served from one cache for the process, so headers shared by
+// many materials are read and converted once. Returns null if the cache
+// can't be created, in which case includes aren't cached.
+IDxcIncludeCache *GetIncludeCache() {
+  static CComPtr<IDxcIncludeCache> s_includeCache = []() {
+    CComPtr<IDxcIncludeCache> cache;
+    DxcCreateInstance(CLSID_DxcIncludeCache, __uuidof(IDxcIncludeCache),
+                      (void **)&cache);
+    return cache;
+  }();
+  return s_includeCache;
+}
+
+// Setting DXC_D3DCOMPILE_CACHE_DIR keeps compilation results in that
+// directory, so an unchanged shader compiled again, in this process or a
+// later one, is read back instead. DXC_D3DCOMPILE_CACHE_MAX_SIZE sets the
+// size of the cache in megabytes. The variables are read once.
+struct ResultCacheSettings {
+  std::wstring Dir;
+  std::wstring MaxSize;
+};
+
+const ResultCacheSettings &GetResultCacheSettings() {
+  static const ResultCacheSettings s_settings = []() {
+    ResultCacheSettings settings;
+    wchar_t value[MAX_PATH];
+    DWORD len = GetEnvironmentVariableW(L"DXC_D3DCOMPILE_CACHE_DIR", value,
+                                        _countof(value));
+    if (len > 0 && len < _countof(value))
+      settings.Dir.assign(value, len);
+    len = GetEnvironmentVariableW(L"DXC_D3DCOMPILE_CACHE_MAX_SIZE", value,
+                                  _countof(value));
+    if (len > 0 && len < _countof(value))
+      settings.MaxSize.assign(value, len);
+    return settings;
+  }();
+  return s_settings;
+}
+
+// Serves includes from an ID3DInclude. The compiler asks for the path it
+// resolved the include to, which is opened as a local include with no
+// parent.
+class D3DIncludeAdapter : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  ID3DInclude *m_pInclude;
+  CComPtr<IDxcLibrary> m_pLibrary;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+
+  D3DIncludeAdapter(ID3DInclude *pInclude, IDxcLibrary *pLibrary)
+      : m_pInclude(pInclude), m_pLibrary(pLibrary) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+      _In_ LPCWSTR pFilename,
+      _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    *ppIncludeSource = nullptr;
+    try {
+      CW2A pFilenameA(pFilename);
+      LPCVOID pData = nullptr;
+      UINT dataSize = 0;
+      IFR(m_pInclude->Open(D3D_INCLUDE_LOCAL, pFilenameA, nullptr, &pData,
+                           &dataSize));
+      CComPtr<IDxcBlobEncoding> pBlob;
+      HRESULT hr = m_pLibrary->CreateBlobWithEncodingOnHeapCopy(
+          pData, dataSize, CP_ACP, &pBlob);
+      m_pInclude->Close(pData);
+      IFR(hr);
+      *ppIncludeSource = pBlob.Detach();
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+// The include cache keeps files that aren't on disk until the process ends,
+// but an engine may generate the contents of such includes for each
+// material. Only files on disk, which the cache reloads when they change,
+// are served from the cache.
+class D3DCachedIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IDxcIncludeHandler> m_pInclude;
+  CComPtr<IDxcIncludeHandler> m_pCachedInclude;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+
+  D3DCachedIncludeHandler(IDxcIncludeHandler *pInclude,
+                          IDxcIncludeHandler *pCachedInclude)
+      : m_pInclude(pInclude), m_pCachedInclude(pCachedInclude) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+      _In_ LPCWSTR pFilename,
+      _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    if (GetFileAttributesW(pFilename) != INVALID_FILE_ATTRIBUTES)
+      return m_pCachedInclude->LoadSource(pFilename, ppIncludeSource);
+    return m_pInclude->LoadSource(pFilename, ppIncludeSource);
+  }
+};
+
+// Creates the handler for the pInclude argument of the D3DCompile functions.
+HRESULT CreateBridgeIncludeHandler(ID3DInclude *pInclude,
+                                   IDxcIncludeHandler **ppIncludeHandler) {
+  *ppIncludeHandler = nullptr;
+  if (pInclude == nullptr)
+    return S_OK;
+
+  CComPtr<IDxcLibrary> library;
+  IFR(GetThreadLibrary(&library));
+  IDxcIncludeCache *pCache = GetIncludeCache();
+  if (D3D_COMPILE_STANDARD_FILE_INCLUDE == pInclude) {
+    if (t_bridgeState.StandardInclude == nullptr) {
+      CComPtr<IDxcIncludeHandler> fileInclude;
+      IFR(library->CreateIncludeHandler(&fileInclude));
+      if (pCache)
+        IFR(pCache->CreateIncludeHandler(fileInclude,
+                                         &t_bridgeState.StandardInclude));
+      else
+        t_bridgeState.StandardInclude = fileInclude;
+    }
+    return t_bridgeState.StandardInclude.CopyTo(ppIncludeHandler);
+  }
+
+  CComPtr<IDxcIncludeHandler> adapter = new D3DIncludeAdapter(pInclude, library);
+  if (pCache == nullptr) {
+    *ppIncludeHandler = adapter.Detach();
+    return S_OK;
+  }
+  CComPtr<IDxcIncludeHandler> cachedAdapter;
+  IFR(pCache->CreateIncludeHandler(adapter, &cachedAdapter));
+  CComPtr<IDxcIncludeHandler> handler =
+      new D3DCachedIncludeHandler(adapter, cachedAdapter);
+  *ppIncludeHandler = handler.Detach();
+  return S_OK;
+}
+
+} // namespace
+
 HRESULT CompileFromBlob(IDxcBlobEncoding *pSource, LPCWSTR pSourceName,
                         const D3D_SHADER_MACRO *pDefines, IDxcIncludeHandler *pInclude,
                         LPCSTR pEntrypoint, LPCSTR pTarget, UINT Flags1,
@@ -54,18 +236,20 @@ HRESULT CompileFromBlob(IDxcBlobEncoding *pSource, LPCWSTR pSourceName,
   try {
     CA2W pEntrypointW(pEntrypoint);
     CA2W pTargetProfileW(pTarget);
-    std::vector<std::wstring> defineValues;
-    std::vector<DxcDefine> defines;
+    std::vector<std::wstring> &defineValues = t_bridgeState.DefineValues;
+    std::vector<DxcDefine> &defines = t_bridgeState.Defines;
+    defineValues.clear();
+    defines.clear();
     if (pDefines) {
       CONST D3D_SHADER_MACRO *pCursor = pDefines;
 
       // Convert to UTF-16.
       while (pCursor->Name) {
-        defineValues.push_back(std::wstring(CA2W(pCursor->Name)));
+        defineValues.emplace_back(CA2W(pCursor->Name));
         if (pCursor->Definition)
-          defineValues.push_back(std::wstring(CA2W(pCursor->Definition)));
+          defineValues.emplace_back(CA2W(pCursor->Definition));
         else
-          defineValues.push_back(std::wstring());
+          defineValues.emplace_back();
         ++pCursor;
       }
 
@@ -105,7 +289,17 @@ HRESULT CompileFromBlob(IDxcBlobEncoding *pSource, LPCWSTR pSourceName,
     //if(Flags1 & D3DCOMPILE_PARTIAL_PRECISION) arguments.push_back(L"/Gpp");
     if(Flags1 & D3DCOMPILE_RESOURCES_MAY_ALIAS) arguments.push_back(L"/res_may_alias");
 
-    IFR(CreateCompiler(&compiler));
+    const ResultCacheSettings &cacheSettings = GetResultCacheSettings();
+    if (!cacheSettings.Dir.empty()) {
+      arguments.push_back(L"-cache-dir");
+      arguments.push_back(cacheSettings.Dir.c_str());
+      if (!cacheSettings.MaxSize.empty()) {
+        arguments.push_back(L"-cache-max-size");
+        arguments.push_back(cacheSettings.MaxSize.c_str());
+      }
+    }
+
+    IFR(GetThreadCompiler(&compiler));
     IFR(compiler->Compile(pSource, pSourceName, pEntrypointW, pTargetProfileW,
                           arguments.data(), (UINT)arguments.size(),
                           defines.data(), (UINT)defines.size(), pInclude,
@@ -140,18 +334,12 @@ HRESULT WINAPI BridgeD3DCompile(LPCVOID pSrcData, SIZE_T SrcDataSize,
   if (ppErrorMsgs != nullptr)
     *ppErrorMsgs = nullptr;
 
-  IFR(CreateLibrary(&library));
+  IFR(GetThreadLibrary(&library));
   IFR(library->CreateBlobWithEncodingFromPinned((LPBYTE)pSrcData, SrcDataSize,
                                                 CP_ACP, &source));
 
-  // Until we actually wrap the include handler, fail if there's a user-supplied handler.
-  if (D3D_COMPILE_STANDARD_FILE_INCLUDE == pInclude) {
-    IFT(library->CreateIncludeHandler(&includeHandler));
-  } else if (pInclude) {
-    return E_INVALIDARG;
-  }
-
   try {
+    IFR(CreateBridgeIncludeHandler(pInclude, &includeHandler));
     CA2W pFileName(pSourceName);
     return CompileFromBlob(source, pFileName, pDefines, includeHandler, pEntrypoint,
                            pTarget, Flags1, Flags2, ppCode, ppErrorMsgs);
@@ -189,19 +377,17 @@ HRESULT WINAPI BridgeD3DCompileFromFile(
   if (ppErrorMsgs != nullptr)
     *ppErrorMsgs = nullptr;
 
-  hr = CreateLibrary(&library);
+  hr = GetThreadLibrary(&library);
   if (FAILED(hr))
     return hr;
   hr = library->CreateBlobFromFile(pFileName, nullptr, &source);
   if (FAILED(hr))
     return hr;
 
-  // Until we actually wrap the include handler, fail if there's a user-supplied handler.
-  if (D3D_COMPILE_STANDARD_FILE_INCLUDE == pInclude) {
-    IFT(library->CreateIncludeHandler(&includeHandler));
-  }
-  else if (pInclude) {
-    return E_INVALIDARG;
+  try {
+    IFR(CreateBridgeIncludeHandler(pInclude, &includeHandler));
+  } catch (const std::bad_alloc &) {
+    return E_OUTOFMEMORY;
   }
 
   return CompileFromBlob(source, pFileName, pDefines, includeHandler, pEntrypoint,
@@ -224,10 +410,10 @@ HRESULT WINAPI BridgeD3DDisassemble(
   UNREFERENCED_PARAMETER(szComments);
   UNREFERENCED_PARAMETER(Flags);
 
-  IFR(CreateLibrary(&library));
+  IFR(GetThreadLibrary(&library));
   IFR(library->CreateBlobWithEncodingFromPinned((LPBYTE)pSrcData, SrcDataSize,
                                                 CP_ACP, &source));
-  IFR(CreateCompiler(&compiler));
+  IFR(GetThreadCompiler(&compiler));
   IFR(compiler->Disassemble(source, &disassemblyText));
   IFR(disassemblyText.QueryInterface(ppDisassembly));
 
@@ -274,11 +460,10 @@ BridgeReadFileToBlob(_In_ LPCWSTR pFileName,
 
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD Reason, LPVOID) {
   BOOL result = TRUE;
-  if (Reason == DLL_PROCESS_ATTACH) {
-    DisableThreadLibraryCalls(hinstDLL);
-  } else if (Reason == DLL_PROCESS_DETACH) {
-    // Nothing to clean-up.
-  }
+  // Thread library calls are left enabled so that the compiler objects each
+  // thread keeps are released when it exits.
+  UNREFERENCED_PARAMETER(hinstDLL);
+  UNREFERENCED_PARAMETER(Reason);
 
   return result;
 }
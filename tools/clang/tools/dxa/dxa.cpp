@@ -19,8 +19,11 @@
 #include "dxc/HLSL/DxilContainer.h"
 
 #include "llvm/Support/CommandLine.h"
+#include <algorithm>
+#include <atomic>
 #include <dia2.h>
 #include <intsafe.h>
+#include <thread>
 
 using namespace llvm;
 using namespace llvm::opt;
@@ -31,6 +34,9 @@ static cl::opt<std::string> InputFilename(cl::Positional,
                                           cl::desc("<input .llvm file>"),
                                           cl::init("-"));
 
+static cl::list<std::string> MoreInputFilenames(cl::Positional,
+                                                cl::desc("<more input .llvm files to assemble>"));
+
 static cl::opt<std::string> OutputFilename("o",
                                            cl::desc("Override output filename"),
                                            cl::value_desc("filename"));
@@ -48,6 +54,16 @@ static cl::opt<bool> ListFiles("listfiles",
 static cl::opt<std::string>
     ExtractFile("extractfile", cl::desc("Extract file from debug information (use '*' for all files)"));
 
+static cl::opt<bool> Pack("pack",
+                          cl::desc("Pack the containers named one per line in the input file into a shader pack"),
+                          cl::init(false));
+static cl::opt<bool> Unpack("unpack",
+                            cl::desc("Write each container of the input shader pack to <shader hash>.dxbc in the output directory"),
+                            cl::init(false));
+static cl::opt<unsigned> Threads("j",
+                                 cl::desc("Number of threads to assemble several inputs on (default: one per core)"),
+                                 cl::init(0));
+
 
 class DxaContext {
 
@@ -55,49 +71,117 @@ private:
   DxcDllSupport &m_dxcSupport;
   HRESULT GetInjectedSourcesTable(IDxcLibrary *pLibrary, IDxcBlob *pTargetBlob, IDiaTable **ppTable);
   HRESULT FindModule(hlsl::DxilFourCC fourCC, IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcBlob **ppTarget);
+  bool AssembleFile(IDxcAssembler *pAssembler, const std::string &InputName,
+                    const std::string &OutputName, std::string &Errors);
 public:
   DxaContext(DxcDllSupport &dxcSupport) : m_dxcSupport(dxcSupport) {}
 
-  void Assemble();
+  bool Assemble();
   bool ExtractFile(const char *pName);
   bool ExtractPart(const char *pName);
   void ListFiles();
   void ListParts();
+  void Pack();
+  void Unpack();
 };
 
-void DxaContext::Assemble() {
-  CComPtr<IDxcOperationResult> pAssembleResult;
+static std::string GetAssembleOutputName(StringRef IFN) {
+  if (IFN == "-")
+    return "-";
+  if (IFN.endswith(".ll") || IFN.endswith(".bc"))
+    IFN = IFN.drop_back(3);
+  return (IFN + ".dxbc").str();
+}
 
+// Assembles one input, returning false with the messages in Errors if it
+// doesn't assemble.
+bool DxaContext::AssembleFile(IDxcAssembler *pAssembler,
+                              const std::string &InputName,
+                              const std::string &OutputName,
+                              std::string &Errors) {
+  CComPtr<IDxcOperationResult> pAssembleResult;
   {
     CComPtr<IDxcBlobEncoding> pSource;
-    ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(InputFilename), &pSource);
-
-    CComPtr<IDxcAssembler> pAssembler;
-    IFT(m_dxcSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+    ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(InputName), &pSource);
     IFT(pAssembler->AssembleToContainer(pSource, &pAssembleResult));
   }
 
   HRESULT status;
   IFT(pAssembleResult->GetStatus(&status));
-  if (SUCCEEDED(status)) {
-    CComPtr<IDxcBlob> pContainer;
-    IFT(pAssembleResult->GetResult(&pContainer));
-    if (pContainer.p != nullptr) {
-      // Infer the output filename if needed.
-      if (OutputFilename.empty()) {
-        if (InputFilename == "-") {
-          OutputFilename = "-";
-        } else {
-          StringRef IFN = InputFilename;
-          OutputFilename = (IFN.endswith(".ll") ? IFN.drop_back(3) : IFN).str();
-          OutputFilename = (IFN.endswith(".bc") ? IFN.drop_back(3) : IFN).str();
-          OutputFilename += ".dxbc";
-        }
-      }
+  if (FAILED(status)) {
+    CComPtr<IDxcBlobEncoding> pErrors;
+    IFT(pAssembleResult->GetErrorBuffer(&pErrors));
+    if (pErrors != nullptr)
+      Errors.assign((const char *)pErrors->GetBufferPointer(),
+                    pErrors->GetBufferSize());
+    return false;
+  }
+  CComPtr<IDxcBlob> pContainer;
+  IFT(pAssembleResult->GetResult(&pContainer));
+  if (pContainer.p != nullptr)
+    WriteBlobToFile(pContainer, StringRefUtf16(OutputName));
+  return true;
+}
+
+bool DxaContext::Assemble() {
+  if (MoreInputFilenames.empty()) {
+    CComPtr<IDxcAssembler> pAssembler;
+    IFT(m_dxcSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+    if (OutputFilename.empty())
+      OutputFilename = GetAssembleOutputName(InputFilename);
+    std::string errors;
+    if (AssembleFile(pAssembler, InputFilename, OutputFilename, errors))
+      return true;
+    printf("%s", errors.c_str());
+    return false;
+  }
 
-      WriteBlobToFile(pContainer, StringRefUtf16(OutputFilename));
+  // Several inputs are assembled on a pool of threads, each with its own
+  // assembler, and written next to their inputs.
+  if (!OutputFilename.empty()) {
+    IFTMSG(E_INVALIDARG, "-o cannot be used with several inputs");
+  }
+  std::vector<std::string> inputs;
+  inputs.push_back(InputFilename);
+  inputs.insert(inputs.end(), MoreInputFilenames.begin(), MoreInputFilenames.end());
+  std::vector<std::string> errors(inputs.size());
+  std::vector<char> succeeded(inputs.size(), 0);
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    CComPtr<IDxcAssembler> pAssembler;
+    if (FAILED(m_dxcSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler)))
+      return;
+    for (size_t i = next++; i < inputs.size(); i = next++) {
+      try {
+        succeeded[i] = AssembleFile(pAssembler, inputs[i],
+                                    GetAssembleOutputName(inputs[i]), errors[i]);
+      } catch (const ::hlsl::Exception &e) {
+        errors[i] = e.msg.empty() ? "failed to assemble" : e.msg;
+      } catch (...) {
+        errors[i] = "failed to assemble";
+      }
     }
+  };
+  unsigned threadCount = Threads ? Threads : std::thread::hardware_concurrency();
+  threadCount = std::max(1u, std::min(threadCount, (unsigned)inputs.size()));
+  std::vector<std::thread> workers;
+  for (unsigned i = 1; i < threadCount; ++i)
+    workers.emplace_back(worker);
+  worker();
+  for (std::thread &t : workers)
+    t.join();
+
+  unsigned failures = 0;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (succeeded[i])
+      continue;
+    ++failures;
+    printf("%s: %s\n", inputs[i].c_str(),
+           errors[i].empty() ? "failed to assemble" : errors[i].c_str());
   }
+  printf("%u of %u inputs assembled\n", (unsigned)inputs.size() - failures,
+         (unsigned)inputs.size());
+  return failures == 0;
 }
 
 // Finds DXIL module from the blob assuming blob is either DxilContainer, DxilPartHeader, or DXIL module
@@ -115,6 +199,19 @@ HRESULT DxaContext::FindModule(hlsl::DxilFourCC fourCC, IDxcBlob *pSource, IDxcL
   }
   if (hlsl::IsValidDxilContainer((hlsl::DxilContainerHeader*)pSource->GetBufferPointer(), pSource->GetBufferSize())) {
     hlsl::DxilContainerHeader *pDxilContainerHeader = (hlsl::DxilContainerHeader*)pSource->GetBufferPointer();
+    // Compressed debug info is handed out as a copy of the decompressed module.
+    if (fourCC == hlsl::DFCC_ShaderDebugInfoDXIL &&
+        !hlsl::GetDxilPartByType(pDxilContainerHeader, fourCC)) {
+      std::vector<char> partStorage;
+      pDxilPartHeader = hlsl::GetDxilDebugInfoPart(pDxilContainerHeader, partStorage);
+      if (pDxilPartHeader == nullptr)
+        return E_INVALIDARG;
+      UINT32 pBlobSize;
+      hlsl::GetDxilProgramBitcode((const hlsl::DxilProgramHeader *)(pDxilPartHeader + 1), &pBitcode, &pBlobSize);
+      CComPtr<IDxcBlobEncoding> pBitcodeBlob;
+      IFR(pLibrary->CreateBlobWithEncodingOnHeapCopy(pBitcode, pBlobSize, CP_ACP, &pBitcodeBlob));
+      return pBitcodeBlob.QueryInterface(ppTargetBlob);
+    }
     pDxilPartHeader = *std::find_if(begin(pDxilContainerHeader), end(pDxilContainerHeader), hlsl::DxilPartIsType(fourCC));
   }
   if (fourCC == pDxilPartHeader->PartFourCC) {
@@ -326,6 +423,120 @@ void DxaContext::ListParts() {
   }
 }
 
+static void WriteDataToHandle(HANDLE hFile, const void *pData, size_t size,
+                              const std::string &fileName) {
+  while (size > 0) {
+    DWORD chunk = size > MAXDWORD ? MAXDWORD : (DWORD)size;
+    DWORD written;
+    if (FALSE == WriteFile(hFile, pData, chunk, &written, nullptr)) {
+      IFTMSG(HRESULT_FROM_WIN32(GetLastError()), "failed to write " + fileName);
+    }
+    pData = (const char *)pData + written;
+    size -= written;
+  }
+}
+
+void DxaContext::Pack() {
+  CComPtr<IDxcBlobEncoding> pList;
+  ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(InputFilename), &pList);
+  StringRef listText((const char *)pList->GetBufferPointer(),
+                     pList->GetBufferSize());
+  SmallVector<StringRef, 256> names;
+  listText.split(names, "\n", -1, false);
+
+  // The writer refers to the containers, so they are all kept until the pack
+  // has been written.
+  std::vector<CComPtr<IDxcBlobEncoding>> containers;
+  hlsl::DxilShaderPackWriter writer;
+  unsigned duplicates = 0;
+  for (StringRef name : names) {
+    name = name.trim();
+    if (name.empty())
+      continue;
+    CComPtr<IDxcBlobEncoding> pContainer;
+    ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(name), &pContainer);
+    const hlsl::DxilContainerHeader *pHeader =
+        (const hlsl::DxilContainerHeader *)pContainer->GetBufferPointer();
+    if (!hlsl::IsValidDxilContainer(pHeader, pContainer->GetBufferSize())) {
+      IFTMSG(DXC_E_CONTAINER_INVALID, name.str() + " is not a valid container");
+    }
+    if (writer.AddContainer(pHeader))
+      containers.push_back(pContainer);
+    else
+      ++duplicates;
+  }
+
+  if (OutputFilename.empty())
+    OutputFilename = InputFilename + ".dxpk";
+  CHandle file(CreateFile2(StringRefUtf16(OutputFilename), GENERIC_WRITE,
+                           FILE_SHARE_READ, CREATE_ALWAYS, nullptr));
+  if (file == INVALID_HANDLE_VALUE) {
+    IFTMSG(HRESULT_FROM_WIN32(GetLastError()), "failed to create " + OutputFilename);
+  }
+  writer.Write([&](const void *pData, size_t size) {
+    WriteDataToHandle(file, pData, size, OutputFilename);
+  });
+  printf("%u containers (%u duplicates skipped), %llu bytes written to %s\n",
+         writer.GetContainerCount(), duplicates,
+         (unsigned long long)writer.GetPackSize(), OutputFilename.c_str());
+}
+
+void DxaContext::Unpack() {
+  // Map the pack the way a runtime would, and write the containers out from
+  // where they are in it.
+  CHandle file(CreateFile2(StringRefUtf16(InputFilename), GENERIC_READ,
+                           FILE_SHARE_READ, OPEN_EXISTING, nullptr));
+  if (file == INVALID_HANDLE_VALUE) {
+    IFTMSG(HRESULT_FROM_WIN32(GetLastError()), "failed to open " + InputFilename);
+  }
+  LARGE_INTEGER fileSize;
+  if (FALSE == GetFileSizeEx(file, &fileSize)) {
+    IFT(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  if (fileSize.QuadPart < (LONGLONG)sizeof(hlsl::DxilShaderPackHeader)) {
+    IFTMSG(DXC_E_MALFORMED_CONTAINER, InputFilename + " is not a valid shader pack");
+  }
+  CHandle mapping(CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr));
+  if (mapping == nullptr) {
+    IFT(HRESULT_FROM_WIN32(GetLastError()));
+  }
+  struct MappedView {
+    const void *p;
+    ~MappedView() { if (p) UnmapViewOfFile(p); }
+  } view = { MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+  if (view.p == nullptr) {
+    IFT(HRESULT_FROM_WIN32(GetLastError()));
+  }
+
+  const hlsl::DxilShaderPackHeader *pPack =
+      (const hlsl::DxilShaderPackHeader *)view.p;
+  if (!hlsl::IsValidDxilShaderPack(pPack, (size_t)fileSize.QuadPart)) {
+    IFTMSG(DXC_E_MALFORMED_CONTAINER, InputFilename + " is not a valid shader pack");
+  }
+
+  if (OutputFilename.empty())
+    OutputFilename = ".";
+  if (FALSE == CreateDirectoryW(StringRefUtf16(OutputFilename), nullptr) &&
+      GetLastError() != ERROR_ALREADY_EXISTS) {
+    IFTMSG(HRESULT_FROM_WIN32(GetLastError()), "failed to create " + OutputFilename);
+  }
+  for (uint32_t i = 0; i < pPack->EntryCount; ++i) {
+    const hlsl::DxilShaderPackEntry *pEntry = hlsl::GetDxilShaderPackEntry(pPack, i);
+    char digestText[hlsl::DxilContainerHashSize * 2 + 1];
+    for (size_t j = 0; j < hlsl::DxilContainerHashSize; ++j)
+      sprintf_s(digestText + j * 2, 3, "%02x", pEntry->Digest[j]);
+    std::string fileName = OutputFilename + "\\" + digestText + ".dxbc";
+    CHandle containerFile(CreateFile2(StringRefUtf16(fileName), GENERIC_WRITE,
+                                      FILE_SHARE_READ, CREATE_ALWAYS, nullptr));
+    if (containerFile == INVALID_HANDLE_VALUE) {
+      IFTMSG(HRESULT_FROM_WIN32(GetLastError()), "failed to create " + fileName);
+    }
+    WriteDataToHandle(containerFile, hlsl::GetDxilShaderPackContainer(pPack, i),
+                      pEntry->Size, fileName);
+  }
+  printf("%u containers written to %s\n", pPack->EntryCount, OutputFilename.c_str());
+}
+
 using namespace hlsl::options;
 
 int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
@@ -349,6 +560,14 @@ int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
       pStage = "Listing files";
       context.ListFiles();
     }
+    else if (Pack) {
+      pStage = "Packing";
+      context.Pack();
+    }
+    else if (Unpack) {
+      pStage = "Unpacking";
+      context.Unpack();
+    }
     else if (!ExtractPart.empty()) {
       pStage = "Extracting part";
       if (!context.ExtractPart(ExtractPart.c_str())) {
@@ -363,7 +582,9 @@ int __cdecl main(int argc, _In_reads_z_(argc) char **argv) {
     }
     else {
       pStage = "Assembling";
-      context.Assemble();
+      if (!context.Assemble()) {
+        return 1;
+      }
     }
   } catch (const ::hlsl::Exception &hlslException) {
     try {
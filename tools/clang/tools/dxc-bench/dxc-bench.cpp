@@ -0,0 +1,382 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxc-bench.cpp                                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxc-bench console program, which         //
+// measures compile time and allocations over a corpus of shaders.           //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/dxcapi.use.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include <comdef.h>
+
+inline bool wcsieq(LPCWSTR a, LPCWSTR b) { return _wcsicmp(a, b) == 0; }
+inline bool wcsieqopt(LPCWSTR text, LPCWSTR opt) {
+  return (text[0] == L'-' || text[0] == L'/') && wcsieq(text + 1, opt);
+}
+
+static dxc::DxcDllSupport g_DxcSupport;
+
+// A line of the corpus file.
+struct BenchShader {
+  std::string File;
+  std::string EntryPoint;
+  std::string TargetProfile;
+  std::vector<std::string> Arguments;
+};
+
+// The measurements of a shader, or their sum over the corpus.
+struct BenchResult {
+  bool Succeeded = true;
+  std::vector<double> Wall; // Seconds, for each iteration.
+  std::vector<std::pair<std::string, double>> Phases; // Mean seconds.
+  UINT64 AllocCount = 0;
+  UINT64 AllocBytes = 0;
+  UINT64 PeakBytes = 0;
+
+  double Median() const {
+    if (Wall.empty())
+      return 0;
+    std::vector<double> sorted(Wall);
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    return (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+  }
+  double Min() const {
+    return Wall.empty() ? 0 : *std::min_element(Wall.begin(), Wall.end());
+  }
+  void AddPhase(const std::string &name, double wall) {
+    for (auto &phase : Phases) {
+      if (phase.first == name) {
+        phase.second += wall;
+        return;
+      }
+    }
+    Phases.emplace_back(name, wall);
+  }
+};
+
+static std::string GetDirectory(const std::string &path) {
+  size_t pos = path.find_last_of("/\\");
+  return pos == std::string::npos ? std::string() : path.substr(0, pos + 1);
+}
+
+static void ReadCorpus(LPCWSTR pFileName, std::vector<BenchShader> &shaders) {
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcBlobEncoding> pBlob;
+  IFT(g_DxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  IFT(pLibrary->CreateBlobFromFile(pFileName, nullptr, &pBlob));
+  std::string directory = GetDirectory(CW2A(pFileName, CP_UTF8).m_psz);
+
+  llvm::StringRef text((const char *)pBlob->GetBufferPointer(),
+                       pBlob->GetBufferSize());
+  llvm::SmallVector<llvm::StringRef, 32> lines;
+  text.split(lines, "\n", -1, false);
+  for (llvm::StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#"))
+      continue;
+    llvm::SmallVector<llvm::StringRef, 8> fields;
+    line.split(fields, " ", -1, false);
+    if (fields.size() < 3) {
+      fprintf(stderr, "Invalid corpus line: %s\n", line.str().c_str());
+      IFT(E_INVALIDARG);
+    }
+    BenchShader shader;
+    shader.File = directory + fields[0].str();
+    if (fields[1] != "-")
+      shader.EntryPoint = fields[1];
+    shader.TargetProfile = fields[2];
+    for (size_t i = 3; i < fields.size(); ++i)
+      shader.Arguments.emplace_back(fields[i].str());
+    shaders.push_back(std::move(shader));
+  }
+}
+
+// Adds the wall time of the top-level phases of a -ftime-report report. The
+// report writes one phase per line, which is all that is relied upon here.
+static void AddTopLevelPhases(llvm::StringRef report, BenchResult &result) {
+  size_t start = report.find("\"phases\": [");
+  if (start == llvm::StringRef::npos)
+    return;
+  report = report.substr(start);
+  report = report.substr(0, report.find(']'));
+  llvm::SmallVector<llvm::StringRef, 16> lines;
+  report.split(lines, "\n", -1, false);
+  for (llvm::StringRef line : lines) {
+    if (line.find("\"parent\": null") == llvm::StringRef::npos)
+      continue;
+    const char namePrefix[] = "{ \"name\": \"";
+    const char wallPrefix[] = "\"wall\": ";
+    size_t namePos = line.find(namePrefix);
+    size_t wallPos = line.find(wallPrefix);
+    if (namePos == llvm::StringRef::npos || wallPos == llvm::StringRef::npos)
+      continue;
+    llvm::StringRef name = line.substr(namePos + sizeof(namePrefix) - 1);
+    name = name.substr(0, name.find('"'));
+    llvm::StringRef wall = line.substr(wallPos + sizeof(wallPrefix) - 1);
+    wall = wall.substr(0, wall.find(','));
+    result.AddPhase(name.str(), atof(wall.str().c_str()));
+  }
+}
+
+static void CompileShader(IDxcCompiler *pCompiler, IDxcLibrary *pLibrary,
+                          const BenchShader &shader, bool measure,
+                          BenchResult &result) {
+  CA2W fileW(shader.File.c_str(), CP_UTF8);
+  CA2W entryW(shader.EntryPoint.c_str(), CP_UTF8);
+  CA2W profileW(shader.TargetProfile.c_str(), CP_UTF8);
+  std::vector<std::wstring> argStrings;
+  for (const std::string &arg : shader.Arguments)
+    argStrings.emplace_back(CA2W(arg.c_str(), CP_UTF8).m_psz);
+  argStrings.emplace_back(L"-ftime-report");
+  argStrings.emplace_back(L"-falloc-stats");
+  std::vector<LPCWSTR> args;
+  for (const std::wstring &arg : argStrings)
+    args.push_back(arg.c_str());
+
+  // Reading the source and setting up the include handler aren't timed.
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  CComPtr<IDxcOperationResult> pResult;
+  IFT(pLibrary->CreateBlobFromFile(fileW, nullptr, &pSource));
+  IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+
+  auto start = std::chrono::steady_clock::now();
+  IFT(pCompiler->Compile(pSource, fileW,
+                         shader.EntryPoint.empty() ? L"" : entryW.m_psz,
+                         profileW, args.data(), (UINT32)args.size(), nullptr,
+                         0, pIncludeHandler, &pResult));
+  auto end = std::chrono::steady_clock::now();
+
+  HRESULT status;
+  IFT(pResult->GetStatus(&status));
+  if (FAILED(status)) {
+    CComPtr<IDxcBlobEncoding> pErrors;
+    IFT(pResult->GetErrorBuffer(&pErrors));
+    fprintf(stderr, "Failed to compile %s:\n%.*s\n", shader.File.c_str(),
+            pErrors ? (int)pErrors->GetBufferSize() : 0,
+            pErrors ? (const char *)pErrors->GetBufferPointer() : "");
+    result.Succeeded = false;
+    return;
+  }
+  if (!measure)
+    return;
+
+  result.Wall.push_back(std::chrono::duration<double>(end - start).count());
+
+  CComPtr<IDxcTimeReport> pTimeReport;
+  CComPtr<IDxcBlobEncoding> pReport;
+  if (SUCCEEDED(pResult.QueryInterface(&pTimeReport)) &&
+      SUCCEEDED(pTimeReport->GetTimeReport(&pReport)) && pReport) {
+    AddTopLevelPhases(llvm::StringRef((const char *)pReport->GetBufferPointer(),
+                                      pReport->GetBufferSize()),
+                      result);
+  }
+  // Allocations don't change from one iteration to the next.
+  CComPtr<IDxcAllocationStats> pAllocationStats;
+  DxcAllocationStats stats;
+  if (SUCCEEDED(pResult.QueryInterface(&pAllocationStats)) &&
+      pAllocationStats->GetAllocationStats(&stats) == S_OK) {
+    result.AllocCount = stats.AllocCount;
+    result.AllocBytes = stats.AllocBytes;
+    result.PeakBytes = stats.PeakBytes;
+  }
+}
+
+static void WriteJsonString(std::string &out, llvm::StringRef value) {
+  out += '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if ((unsigned char)c < 0x20) {
+      char buffer[8];
+      sprintf_s(buffer, _countof(buffer), "\\u%04x", (unsigned)c);
+      out += buffer;
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+}
+
+static void WriteJsonResult(std::string &out, const BenchResult &result) {
+  char buffer[256];
+  sprintf_s(buffer, _countof(buffer),
+            "\"succeeded\": %s, \"wall_median\": %.6f, \"wall_min\": %.6f, "
+            "\"alloc_count\": %llu, \"alloc_bytes\": %llu, "
+            "\"peak_bytes\": %llu, \"phases\": {",
+            result.Succeeded ? "true" : "false", result.Median(),
+            result.Min(), (unsigned long long)result.AllocCount,
+            (unsigned long long)result.AllocBytes,
+            (unsigned long long)result.PeakBytes);
+  out += buffer;
+  for (size_t i = 0; i < result.Phases.size(); ++i) {
+    out += i == 0 ? " " : ", ";
+    WriteJsonString(out, result.Phases[i].first);
+    sprintf_s(buffer, _countof(buffer), ": %.6f", result.Phases[i].second);
+    out += buffer;
+  }
+  out += result.Phases.empty() ? "}" : " }";
+}
+
+static void PrintHelp() {
+  wprintf(L"%s",
+    L"Measures compile time and allocations over a corpus of shaders.\n\n"
+    L"dxc-bench [-? | -n COUNT | -o OUT-FILE] CORPUS-FILE\n\n"
+    L"Arguments:\n"
+    L"  -?           Displays this help message\n"
+    L"  -n COUNT     Compiles each shader COUNT times, after a warm-up\n"
+    L"               compile; 5 if omitted\n"
+    L"  -o OUT-FILE  Writes the results as JSON to OUT-FILE\n"
+    L"  CORPUS-FILE  File with a shader to compile on each line:\n"
+    L"               FILE ENTRY-POINT TARGET-PROFILE [DXC-ARGUMENTS ...]\n"
+    L"\n"
+    L"Times are the median wall time of the compiles; phases are the mean\n"
+    L"wall time of each top-level -ftime-report phase.\n"
+  );
+}
+
+int __cdecl wmain(int argc, const wchar_t **argv_) {
+  const char *pStage = "Operation";
+  try {
+    pStage = "Argument processing";
+    LPCWSTR corpusFileName = nullptr;
+    LPCWSTR outFileName = nullptr;
+    unsigned iterations = 5;
+    for (int argIdx = 1; argIdx < argc; ++argIdx) {
+      LPCWSTR arg = argv_[argIdx];
+      if (wcsieqopt(arg, L"?")) {
+        PrintHelp();
+        return 0;
+      } else if (wcsieqopt(arg, L"n") && argIdx + 1 < argc) {
+        iterations = (unsigned)_wtoi(argv_[++argIdx]);
+      } else if (wcsieqopt(arg, L"o") && argIdx + 1 < argc) {
+        outFileName = argv_[++argIdx];
+      } else if (corpusFileName == nullptr && arg[0] != L'-') {
+        corpusFileName = arg;
+      } else {
+        PrintHelp();
+        return 1;
+      }
+    }
+    if (corpusFileName == nullptr || iterations == 0) {
+      PrintHelp();
+      return 1;
+    }
+
+    pStage = "Reading corpus";
+    IFT(g_DxcSupport.Initialize());
+    std::vector<BenchShader> shaders;
+    ReadCorpus(corpusFileName, shaders);
+
+    pStage = "Compilation";
+    CComPtr<IDxcLibrary> pLibrary;
+    CComPtr<IDxcCompiler> pCompiler;
+    IFT(g_DxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+    IFT(g_DxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    std::vector<BenchResult> results(shaders.size());
+    BenchResult total;
+    total.Wall.assign(iterations, 0);
+    bool anyFailed = false;
+    for (size_t i = 0; i < shaders.size(); ++i) {
+      BenchResult &result = results[i];
+      CompileShader(pCompiler, pLibrary, shaders[i], /*measure*/ false,
+                    result);
+      for (unsigned n = 0; n < iterations && result.Succeeded; ++n)
+        CompileShader(pCompiler, pLibrary, shaders[i], /*measure*/ true,
+                      result);
+      if (!result.Succeeded) {
+        anyFailed = true;
+        result.Wall.clear();
+        result.Phases.clear();
+        continue;
+      }
+      for (auto &phase : result.Phases)
+        phase.second /= iterations;
+      for (unsigned n = 0; n < iterations; ++n)
+        total.Wall[n] += result.Wall[n];
+      for (auto &phase : result.Phases)
+        total.AddPhase(phase.first, phase.second);
+      total.AllocCount += result.AllocCount;
+      total.AllocBytes += result.AllocBytes;
+      total.PeakBytes = std::max(total.PeakBytes, result.PeakBytes);
+      printf("%10.3f ms %12llu allocs %12llu bytes  %s %s\n",
+             result.Median() * 1000, (unsigned long long)result.AllocCount,
+             (unsigned long long)result.AllocBytes, shaders[i].File.c_str(),
+             shaders[i].TargetProfile.c_str());
+    }
+    printf("%10.3f ms %12llu allocs %12llu bytes  total\n",
+           total.Median() * 1000, (unsigned long long)total.AllocCount,
+           (unsigned long long)total.AllocBytes);
+    for (auto &phase : total.Phases)
+      printf("%10.3f ms  %s\n", phase.second * 1000, phase.first.c_str());
+
+    if (outFileName) {
+      pStage = "Writing results";
+      std::string json = "{\n  \"version\": 1,\n";
+      json += "  \"iterations\": " + std::to_string(iterations) + ",\n";
+      json += "  \"shaders\": [";
+      for (size_t i = 0; i < shaders.size(); ++i) {
+        const BenchShader &shader = shaders[i];
+        json += i == 0 ? "\n" : ",\n";
+        json += "    { \"file\": ";
+        WriteJsonString(json, shader.File);
+        json += ", \"entry\": ";
+        WriteJsonString(json, shader.EntryPoint);
+        json += ", \"profile\": ";
+        WriteJsonString(json, shader.TargetProfile);
+        json += ", \"arguments\": [";
+        for (size_t a = 0; a < shader.Arguments.size(); ++a) {
+          if (a > 0)
+            json += ", ";
+          WriteJsonString(json, shader.Arguments[a]);
+        }
+        json += "], ";
+        WriteJsonResult(json, results[i]);
+        json += " }";
+      }
+      json += "\n  ],\n  \"total\": { ";
+      total.Succeeded = !anyFailed;
+      WriteJsonResult(json, total);
+      json += " }\n}\n";
+
+      CComPtr<IDxcBlobEncoding> pJson;
+      IFT(pLibrary->CreateBlobWithEncodingOnHeapCopy(
+          json.data(), (UINT32)json.size(), CP_UTF8, &pJson));
+      dxc::WriteBlobToFile(pJson, outFileName);
+    }
+    return anyFailed ? 1 : 0;
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg == nullptr || *msg == '\0')
+      printf("%s failed - error code 0x%08x.\n", pStage, hlslException.hr);
+    else
+      printf("%s failed - %s\n", pStage, msg);
+    return 1;
+  } catch (std::bad_alloc &) {
+    printf("%s failed - out of memory.\n", pStage);
+    return 1;
+  } catch (...) {
+    printf("%s failed - unknown error.\n", pStage);
+    return 1;
+  }
+}
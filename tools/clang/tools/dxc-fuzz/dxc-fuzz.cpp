@@ -0,0 +1,601 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxc-fuzz.cpp                                                              //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxc-fuzz console program, which mutates  //
+// shaders to find inputs whose compile time or peak memory grows faster     //
+// than their size.                                                          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/dxcapi.use.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include <comdef.h>
+
+inline bool wcsieq(LPCWSTR a, LPCWSTR b) { return _wcsicmp(a, b) == 0; }
+inline bool wcsieqopt(LPCWSTR text, LPCWSTR opt) {
+  return (text[0] == L'-' || text[0] == L'/') && wcsieq(text + 1, opt);
+}
+
+static dxc::DxcDllSupport g_DxcSupport;
+
+// A line of the corpus file, in the format dxc-bench reads.
+struct FuzzSeed {
+  std::string File;
+  std::string EntryPoint;
+  std::string TargetProfile;
+  std::vector<std::string> Arguments;
+  std::string Source;
+};
+
+// What one compile of an input took.
+struct FuzzCost {
+  bool Compiled = false;
+  double Wall = 0;      // Seconds.
+  UINT64 PeakBytes = 0; // Largest number of bytes live during the compile.
+};
+
+// An input in the pool that mutations start from.
+struct FuzzInput {
+  std::string Source;
+  double WallPerByte;
+  double PeakPerByte;
+};
+
+struct FuzzOptions {
+  unsigned Mutants = 200;  // Mutants compiled per seed.
+  unsigned RandomSeed = 1;
+  double Ratio = 4;        // Flag inputs this many times costlier per byte.
+  double MinWall = 0.25;   // Seconds; faster compiles are never flagged.
+  UINT64 MinPeakBytes = 64 << 20;
+  size_t MaxSize = 64 << 10;
+  size_t MaxPool = 32;     // Inputs kept per seed to mutate further.
+  std::wstring OutDir = L".";
+};
+
+static std::string GetDirectory(const std::string &path) {
+  size_t pos = path.find_last_of("/\\");
+  return pos == std::string::npos ? std::string() : path.substr(0, pos + 1);
+}
+
+static std::string GetFileName(const std::string &path) {
+  size_t pos = path.find_last_of("/\\");
+  return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+static void ReadCorpus(IDxcLibrary *pLibrary, LPCWSTR pFileName,
+                       std::vector<FuzzSeed> &seeds) {
+  CComPtr<IDxcBlobEncoding> pBlob;
+  IFT(pLibrary->CreateBlobFromFile(pFileName, nullptr, &pBlob));
+  std::string directory = GetDirectory(CW2A(pFileName, CP_UTF8).m_psz);
+
+  llvm::StringRef text((const char *)pBlob->GetBufferPointer(),
+                       pBlob->GetBufferSize());
+  llvm::SmallVector<llvm::StringRef, 32> lines;
+  text.split(lines, "\n", -1, false);
+  for (llvm::StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#"))
+      continue;
+    llvm::SmallVector<llvm::StringRef, 8> fields;
+    line.split(fields, " ", -1, false);
+    if (fields.size() < 3) {
+      fprintf(stderr, "Invalid corpus line: %s\n", line.str().c_str());
+      IFT(E_INVALIDARG);
+    }
+    FuzzSeed seed;
+    seed.File = directory + fields[0].str();
+    if (fields[1] != "-")
+      seed.EntryPoint = fields[1];
+    seed.TargetProfile = fields[2];
+    for (size_t i = 3; i < fields.size(); ++i)
+      seed.Arguments.emplace_back(fields[i].str());
+
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcBlobEncoding> pSourceUtf8;
+    IFT(pLibrary->CreateBlobFromFile(CA2W(seed.File.c_str(), CP_UTF8),
+                                     nullptr, &pSource));
+    IFT(pLibrary->GetBlobAsUtf8(pSource, &pSourceUtf8));
+    seed.Source.assign((const char *)pSourceUtf8->GetBufferPointer(),
+                       pSourceUtf8->GetBufferSize());
+    while (!seed.Source.empty() && seed.Source.back() == '\0')
+      seed.Source.pop_back();
+    seeds.push_back(std::move(seed));
+  }
+}
+
+// Compiles source in place of the seed's file, so that its includes resolve
+// as they do for the seed.
+static void CompileInput(IDxcCompiler *pCompiler, IDxcLibrary *pLibrary,
+                         const FuzzSeed &seed, const std::string &source,
+                         FuzzCost &cost) {
+  CA2W fileW(seed.File.c_str(), CP_UTF8);
+  CA2W entryW(seed.EntryPoint.c_str(), CP_UTF8);
+  CA2W profileW(seed.TargetProfile.c_str(), CP_UTF8);
+  std::vector<std::wstring> argStrings;
+  for (const std::string &arg : seed.Arguments)
+    argStrings.emplace_back(CA2W(arg.c_str(), CP_UTF8).m_psz);
+  argStrings.emplace_back(L"-falloc-stats");
+  std::vector<LPCWSTR> args;
+  for (const std::wstring &arg : argStrings)
+    args.push_back(arg.c_str());
+
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  CComPtr<IDxcOperationResult> pResult;
+  IFT(pLibrary->CreateBlobWithEncodingOnHeapCopy(
+      source.data(), (UINT32)source.size(), CP_UTF8, &pSource));
+  IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+
+  auto start = std::chrono::steady_clock::now();
+  IFT(pCompiler->Compile(pSource, fileW,
+                         seed.EntryPoint.empty() ? L"" : entryW.m_psz,
+                         profileW, args.data(), (UINT32)args.size(), nullptr,
+                         0, pIncludeHandler, &pResult));
+  auto end = std::chrono::steady_clock::now();
+  cost.Wall = std::chrono::duration<double>(end - start).count();
+
+  HRESULT status;
+  IFT(pResult->GetStatus(&status));
+  cost.Compiled = SUCCEEDED(status);
+  CComPtr<IDxcAllocationStats> pAllocationStats;
+  DxcAllocationStats stats;
+  cost.PeakBytes = 0;
+  if (SUCCEEDED(pResult.QueryInterface(&pAllocationStats)) &&
+      pAllocationStats->GetAllocationStats(&stats) == S_OK)
+    cost.PeakBytes = stats.PeakBytes;
+}
+
+static bool IsIdentifierChar(char c) {
+  return isalnum((unsigned char)c) || c == '_';
+}
+
+// Scalar types that vector and matrix types are spelled from.
+static const char *const ShapeBaseNames[] = {
+  "bool", "int", "uint", "half", "float", "double", "min16float", "min10float",
+  "min16int", "min12int", "min16uint", "int16_t", "uint16_t", "float16_t",
+};
+
+// Returns the length of the base name if name is a scalar, vector or
+// matrix type such as float, int3 or half2x4, or 0.
+static size_t GetShapeBaseLength(llvm::StringRef name) {
+  for (const char *base : ShapeBaseNames) {
+    if (!name.startswith(base))
+      continue;
+    llvm::StringRef shape = name.substr(strlen(base));
+    if (shape.empty() ||
+        (shape.size() == 1 && shape[0] >= '1' && shape[0] <= '4') ||
+        (shape.size() == 3 && shape[0] >= '1' && shape[0] <= '4' &&
+         shape[1] == 'x' && shape[2] >= '1' && shape[2] <= '4'))
+      return strlen(base);
+  }
+  return 0;
+}
+
+// The parts of a shader the mutations work on, found without parsing it:
+// statements and nested blocks inside braces, integer literals and numeric
+// type names. Comments, strings and preprocessor lines are skipped.
+struct SourceScan {
+  struct Range {
+    size_t Begin;
+    size_t End; // One past the ';' or '}'.
+  };
+  std::vector<Range> Statements;
+  std::vector<Range> Blocks;
+  std::vector<Range> Literals;
+  std::vector<Range> Types;
+
+  explicit SourceScan(const std::string &s) {
+    const size_t none = std::string::npos;
+    std::vector<size_t> openBraces;
+    unsigned parenDepth = 0;
+    size_t statementBegin = none;
+    bool lineStart = true;
+    size_t i = 0;
+    while (i < s.size()) {
+      char c = s[i];
+      char next = i + 1 < s.size() ? s[i + 1] : '\0';
+      if (c == '\n') {
+        lineStart = true;
+        ++i;
+        continue;
+      }
+      if (isspace((unsigned char)c)) {
+        ++i;
+        continue;
+      }
+      if ((lineStart && c == '#') || (c == '/' && next == '/')) {
+        while (i < s.size() && s[i] != '\n') {
+          i += (s[i] == '\\' && i + 1 < s.size()) ? 2 : 1;
+        }
+        continue;
+      }
+      lineStart = false;
+      if (c == '/' && next == '*') {
+        size_t end = s.find("*/", i + 2);
+        i = end == none ? s.size() : end + 2;
+        continue;
+      }
+      if (!openBraces.empty() && statementBegin == none && c != '{' &&
+          c != '}' && c != ';')
+        statementBegin = i;
+      if (c == '"' || c == '\'') {
+        ++i;
+        while (i < s.size() && s[i] != c && s[i] != '\n')
+          i += (s[i] == '\\') ? 2 : 1;
+        ++i;
+        continue;
+      }
+      if (isdigit((unsigned char)c)) {
+        size_t end = i;
+        while (end < s.size() && (IsIdentifierChar(s[end]) || s[end] == '.'))
+          ++end;
+        size_t digits = i;
+        while (digits < end && isdigit((unsigned char)s[digits]))
+          ++digits;
+        if (digits == end || (digits + 1 == end && tolower(s[digits]) == 'u'))
+          Literals.push_back({i, digits});
+        i = end;
+        continue;
+      }
+      if (IsIdentifierChar(c)) {
+        size_t end = i;
+        while (end < s.size() && IsIdentifierChar(s[end]))
+          ++end;
+        if (GetShapeBaseLength(llvm::StringRef(s).slice(i, end)) != 0)
+          Types.push_back({i, end});
+        i = end;
+        continue;
+      }
+      switch (c) {
+      case '(':
+        ++parenDepth;
+        break;
+      case ')':
+        if (parenDepth > 0)
+          --parenDepth;
+        break;
+      case ';':
+        if (parenDepth == 0) {
+          if (statementBegin != none && !openBraces.empty())
+            Statements.push_back({statementBegin, i + 1});
+          statementBegin = none;
+        }
+        break;
+      case '{':
+        openBraces.push_back(i);
+        statementBegin = none;
+        break;
+      case '}':
+        if (!openBraces.empty()) {
+          size_t begin = openBraces.back();
+          openBraces.pop_back();
+          if (!openBraces.empty())
+            Blocks.push_back({begin, i + 1});
+        }
+        statementBegin = none;
+        parenDepth = 0;
+        break;
+      }
+      ++i;
+    }
+  }
+};
+
+// Mutations that keep a shader close to valid HLSL, aimed at the shapes that
+// make passes slow: long and repeated straight-line code, unrolled and nested
+// loops, big constant trip counts and array sizes, and wider vectors and
+// matrices.
+class HlslMutator {
+public:
+  explicit HlslMutator(unsigned seed) : m_rng(seed) {}
+
+  // Applies one to three mutations; returns false if none applied.
+  bool Mutate(std::string &source) {
+    unsigned count = 1 + Pick(3);
+    bool mutated = false;
+    for (unsigned n = 0; n < count; ++n) {
+      SourceScan scan(source);
+      switch (Pick(5)) {
+      case 0: mutated |= DuplicateStatement(source, scan); break;
+      case 1: mutated |= WrapInLoop(source, scan); break;
+      case 2: mutated |= DuplicateBlock(source, scan); break;
+      case 3: mutated |= GrowLiteral(source, scan); break;
+      case 4: mutated |= WidenType(source, scan); break;
+      }
+    }
+    return mutated;
+  }
+
+private:
+  std::mt19937 m_rng;
+  unsigned m_loopCount = 0;
+
+  unsigned Pick(size_t n) {
+    return std::uniform_int_distribution<unsigned>(0, (unsigned)n - 1)(m_rng);
+  }
+
+  static std::string Text(const std::string &source,
+                          const SourceScan::Range &range) {
+    return source.substr(range.Begin, range.End - range.Begin);
+  }
+
+  bool DuplicateStatement(std::string &source, const SourceScan &scan) {
+    if (scan.Statements.empty())
+      return false;
+    const SourceScan::Range &range = scan.Statements[Pick(scan.Statements.size())];
+    source.insert(range.End, " " + Text(source, range));
+    return true;
+  }
+
+  bool WrapInLoop(std::string &source, const SourceScan &scan) {
+    if (scan.Statements.empty())
+      return false;
+    static const unsigned TripCounts[] = { 2, 4, 8, 16, 32, 64 };
+    const SourceScan::Range &range = scan.Statements[Pick(scan.Statements.size())];
+    std::string counter = "dxcfuzz" + std::to_string(m_loopCount++);
+    std::string loop = Pick(2) ? "[unroll] " : "[loop] ";
+    loop += "for (uint " + counter + " = 0; " + counter + " < " +
+            std::to_string(TripCounts[Pick(_countof(TripCounts))]) + "; ++" +
+            counter + ") { " + Text(source, range) + " }";
+    source.replace(range.Begin, range.End - range.Begin, loop);
+    return true;
+  }
+
+  bool DuplicateBlock(std::string &source, const SourceScan &scan) {
+    if (scan.Blocks.empty())
+      return false;
+    const SourceScan::Range &range = scan.Blocks[Pick(scan.Blocks.size())];
+    source.insert(range.End, " " + Text(source, range));
+    return true;
+  }
+
+  bool GrowLiteral(std::string &source, const SourceScan &scan) {
+    if (scan.Literals.empty())
+      return false;
+    const SourceScan::Range &range = scan.Literals[Pick(scan.Literals.size())];
+    unsigned long long value = strtoull(Text(source, range).c_str(), nullptr, 10);
+    unsigned long long grown = std::min(std::max(value, 1ULL) * (2 + Pick(7)),
+                                        4096ULL);
+    if (grown <= value)
+      return false;
+    source.replace(range.Begin, range.End - range.Begin, std::to_string(grown));
+    return true;
+  }
+
+  bool WidenType(std::string &source, const SourceScan &scan) {
+    if (scan.Types.empty())
+      return false;
+    const SourceScan::Range &range = scan.Types[Pick(scan.Types.size())];
+    std::string name = Text(source, range);
+    size_t baseLength = GetShapeBaseLength(name);
+    std::string widened = name.substr(0, baseLength) +
+                          (name.find('x', baseLength) != std::string::npos
+                               ? "4x4" : "4");
+    if (widened == name)
+      return false;
+    source.replace(range.Begin, range.End - range.Begin, widened);
+    return true;
+  }
+};
+
+// Writes a flagged input with a header that says how to compile it and what
+// it cost next to its seed.
+static void WriteFlaggedInput(IDxcLibrary *pLibrary, const FuzzOptions &opts,
+                              const FuzzSeed &seed, const FuzzCost &seedCost,
+                              const std::string &source, const FuzzCost &cost,
+                              unsigned index) {
+  std::string text = "// dxc-fuzz: " + GetFileName(seed.File) + " " +
+                     (seed.EntryPoint.empty() ? "-" : seed.EntryPoint) + " " +
+                     seed.TargetProfile;
+  for (const std::string &arg : seed.Arguments)
+    text += " " + arg;
+  char buffer[256];
+  sprintf_s(buffer, _countof(buffer),
+            "\n// %.3f s and %llu peak bytes for %u bytes; the seed took "
+            "%.3f s and %llu peak bytes for %u bytes.\n",
+            cost.Wall, (unsigned long long)cost.PeakBytes,
+            (unsigned)source.size(), seedCost.Wall,
+            (unsigned long long)seedCost.PeakBytes,
+            (unsigned)seed.Source.size());
+  text += buffer;
+  text += source;
+
+  std::wstring fileName = opts.OutDir + L"\\" +
+                          std::wstring(CA2W(GetFileName(seed.File).c_str(),
+                                            CP_UTF8).m_psz) +
+                          L"." + std::to_wstring(index) + L".hlsl";
+  CComPtr<IDxcBlobEncoding> pBlob;
+  IFT(pLibrary->CreateBlobWithEncodingOnHeapCopy(
+      text.data(), (UINT32)text.size(), CP_UTF8, &pBlob));
+  dxc::WriteBlobToFile(pBlob, fileName.c_str());
+  printf("%10.3f s %12llu peak bytes  %ls\n", cost.Wall,
+         (unsigned long long)cost.PeakBytes, fileName.c_str());
+}
+
+// Mutates the inputs in the seed's pool and compiles the mutants. Mutants
+// that cost more per byte than their parent join the pool, so the search
+// climbs towards the shapes that scale worst; those that cost more per byte
+// than the seed by the ratio are written out. Returns the number flagged.
+static unsigned FuzzSeedInputs(IDxcCompiler *pCompiler, IDxcLibrary *pLibrary,
+                               const FuzzOptions &opts, const FuzzSeed &seed,
+                               HlslMutator &mutator) {
+  // The first compile warms up the compiler; the second is the baseline.
+  FuzzCost seedCost;
+  CompileInput(pCompiler, pLibrary, seed, seed.Source, seedCost);
+  CompileInput(pCompiler, pLibrary, seed, seed.Source, seedCost);
+  if (!seedCost.Compiled) {
+    fprintf(stderr, "Skipping %s, which doesn't compile.\n",
+            seed.File.c_str());
+    return 0;
+  }
+  double size = (double)std::max<size_t>(seed.Source.size(), 1);
+  std::vector<FuzzInput> pool;
+  pool.push_back({seed.Source, seedCost.Wall / size,
+                  (double)seedCost.PeakBytes / size});
+  const FuzzInput seedInput = pool.front();
+
+  unsigned flagged = 0;
+  for (unsigned n = 0; n < opts.Mutants; ++n) {
+    const FuzzInput &parent = pool[n % pool.size()];
+    std::string source = parent.Source;
+    if (!mutator.Mutate(source) || source.size() > opts.MaxSize)
+      continue;
+
+    FuzzCost cost;
+    CompileInput(pCompiler, pLibrary, seed, source, cost);
+    double mutantSize = (double)source.size();
+    FuzzInput mutant = {std::move(source), cost.Wall / mutantSize,
+                        (double)cost.PeakBytes / mutantSize};
+
+    bool slow = cost.Wall >= opts.MinWall &&
+                mutant.WallPerByte > opts.Ratio * seedInput.WallPerByte;
+    bool large = cost.PeakBytes >= opts.MinPeakBytes &&
+                 mutant.PeakPerByte > opts.Ratio * seedInput.PeakPerByte;
+    if (slow || large) {
+      // Compile again, so that a stall elsewhere doesn't get flagged.
+      FuzzCost again;
+      CompileInput(pCompiler, pLibrary, seed, mutant.Source, again);
+      cost.Wall = std::min(cost.Wall, again.Wall);
+      mutant.WallPerByte = cost.Wall / mutantSize;
+      slow = cost.Wall >= opts.MinWall &&
+             mutant.WallPerByte > opts.Ratio * seedInput.WallPerByte;
+      if (slow || large)
+        WriteFlaggedInput(pLibrary, opts, seed, seedCost, mutant.Source, cost,
+                          flagged++);
+    }
+
+    // Only mutants that compile keep the search in valid HLSL.
+    if (cost.Compiled && (mutant.WallPerByte > parent.WallPerByte ||
+                          mutant.PeakPerByte > parent.PeakPerByte)) {
+      if (pool.size() < opts.MaxPool) {
+        pool.push_back(std::move(mutant));
+      } else {
+        // Replace the cheapest input other than the seed.
+        auto cheapest = std::min_element(
+            pool.begin() + 1, pool.end(),
+            [](const FuzzInput &a, const FuzzInput &b) {
+              return a.WallPerByte < b.WallPerByte;
+            });
+        if (cheapest->WallPerByte < mutant.WallPerByte)
+          *cheapest = std::move(mutant);
+      }
+    }
+  }
+  return flagged;
+}
+
+static void PrintHelp() {
+  wprintf(L"%s",
+    L"Mutates shaders to find inputs whose compile time or peak memory grows\n"
+    L"faster than their size.\n\n"
+    L"dxc-fuzz [-? | -n COUNT | -seed N | -ratio R | -min-ms MS |\n"
+    L"          -min-mb MB | -max-size BYTES | -o OUT-DIR] CORPUS-FILE\n\n"
+    L"Arguments:\n"
+    L"  -?              Displays this help message\n"
+    L"  -n COUNT        Compiles COUNT mutants of each shader; 200 if omitted\n"
+    L"  -seed N         Seeds the mutations, so that runs can be repeated\n"
+    L"  -ratio R        Flags mutants that take R times as long or as much\n"
+    L"                  memory per byte as their shader; 4 if omitted\n"
+    L"  -min-ms MS      Doesn't flag compiles faster than MS; 250 if omitted\n"
+    L"  -min-mb MB      Doesn't flag compiles with a peak under MB; 64 if\n"
+    L"                  omitted\n"
+    L"  -max-size BYTES Doesn't compile mutants larger than BYTES; 65536 if\n"
+    L"                  omitted\n"
+    L"  -o OUT-DIR      Writes flagged mutants to OUT-DIR; the current\n"
+    L"                  directory if omitted\n"
+    L"  CORPUS-FILE     File with a shader to mutate on each line, in the\n"
+    L"                  format dxc-bench reads:\n"
+    L"                  FILE ENTRY-POINT TARGET-PROFILE [DXC-ARGUMENTS ...]\n"
+    L"\n"
+    L"Each flagged mutant starts with a comment giving its corpus line and\n"
+    L"its cost next to the shader it came from.\n"
+  );
+}
+
+int __cdecl wmain(int argc, const wchar_t **argv_) {
+  const char *pStage = "Operation";
+  try {
+    pStage = "Argument processing";
+    LPCWSTR corpusFileName = nullptr;
+    FuzzOptions opts;
+    for (int argIdx = 1; argIdx < argc; ++argIdx) {
+      LPCWSTR arg = argv_[argIdx];
+      bool hasValue = argIdx + 1 < argc;
+      if (wcsieqopt(arg, L"?")) {
+        PrintHelp();
+        return 0;
+      } else if (wcsieqopt(arg, L"n") && hasValue) {
+        opts.Mutants = (unsigned)_wtoi(argv_[++argIdx]);
+      } else if (wcsieqopt(arg, L"seed") && hasValue) {
+        opts.RandomSeed = (unsigned)_wtoi(argv_[++argIdx]);
+      } else if (wcsieqopt(arg, L"ratio") && hasValue) {
+        opts.Ratio = _wtof(argv_[++argIdx]);
+      } else if (wcsieqopt(arg, L"min-ms") && hasValue) {
+        opts.MinWall = _wtof(argv_[++argIdx]) / 1000;
+      } else if (wcsieqopt(arg, L"min-mb") && hasValue) {
+        opts.MinPeakBytes = (UINT64)_wtoi(argv_[++argIdx]) << 20;
+      } else if (wcsieqopt(arg, L"max-size") && hasValue) {
+        opts.MaxSize = (size_t)_wtoi(argv_[++argIdx]);
+      } else if (wcsieqopt(arg, L"o") && hasValue) {
+        opts.OutDir = argv_[++argIdx];
+      } else if (corpusFileName == nullptr && arg[0] != L'-') {
+        corpusFileName = arg;
+      } else {
+        PrintHelp();
+        return 1;
+      }
+    }
+    if (corpusFileName == nullptr || opts.Ratio <= 1) {
+      PrintHelp();
+      return 1;
+    }
+
+    pStage = "Reading corpus";
+    IFT(g_DxcSupport.Initialize());
+    CComPtr<IDxcLibrary> pLibrary;
+    CComPtr<IDxcCompiler> pCompiler;
+    IFT(g_DxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+    IFT(g_DxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    std::vector<FuzzSeed> seeds;
+    ReadCorpus(pLibrary, corpusFileName, seeds);
+
+    pStage = "Fuzzing";
+    HlslMutator mutator(opts.RandomSeed);
+    unsigned flagged = 0;
+    for (const FuzzSeed &seed : seeds)
+      flagged += FuzzSeedInputs(pCompiler, pLibrary, opts, seed, mutator);
+    printf("%u inputs flagged\n", flagged);
+    return flagged ? 1 : 0;
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg == nullptr || *msg == '\0')
+      printf("%s failed - error code 0x%08x.\n", pStage, hlslException.hr);
+    else
+      printf("%s failed - %s\n", pStage, msg);
+    return 1;
+  } catch (std::bad_alloc &) {
+    printf("%s failed - out of memory.\n", pStage);
+    return 1;
+  } catch (...) {
+    printf("%s failed - unknown error.\n", pStage);
+    return 1;
+  }
+}
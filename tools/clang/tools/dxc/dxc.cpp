@@ -57,9 +57,14 @@
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/StringSaver.h"
 #include <dia2.h>
 #include <comdef.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <unordered_map>
 
 #pragma comment(lib, "version.lib")
@@ -165,6 +170,8 @@ using namespace dxc;
 using namespace llvm::opt;
 using namespace hlsl::options;
 
+struct RemoteJob;
+
 class DxcContext {
 
 private:
@@ -172,6 +179,7 @@ private:
   DxcDllSupport &m_dxcSupport;
   NoSerializeHeapMalloc m_Malloc;
   HANDLE m_MallocHeap;
+  IDxcIncludeCache *m_pIncludeCache = nullptr;
 
   int ActOnBlob(IDxcBlob *pBlob);
   int ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugBlobName);
@@ -186,6 +194,24 @@ private:
   HRESULT FindModuleBlob(hlsl::DxilFourCC fourCC, IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcBlob **ppTargetBlob);
   void ExtractRootSignature(IDxcBlob *pBlob, IDxcBlob **ppResult);
   int VerifyRootSignature();
+  void WriteTimeReport(IDxcOperationResult *pResult);
+  void WriteTimeTrace(IDxcOperationResult *pResult);
+  void WriteIRStats(IDxcOperationResult *pResult);
+  void WriteSpirvReflection(IDxcOperationResult *pResult,
+                            llvm::StringRef FileName);
+  void WriteDependencyFile(IDxcOperationResult *pResult);
+  void WriteSourcePack(IDxcOperationResult *pResult);
+  void GetCompileArgs(std::vector<std::wstring> &argStrings,
+                      std::vector<LPCWSTR> &args);
+  void CompileSource(IDxcCompiler *pCompiler, IDxcBlob *pSource,
+                     std::vector<LPCWSTR> &args,
+                     IDxcIncludeHandler *pIncludeHandler,
+                     IDxcOperationResult **ppCompileResult,
+                     IDxcBlob **ppDebugBlob, std::wstring &debugName);
+  int WriteRemoteJob();
+  int ActOnRemoteResult();
+  void CreateIncludeHandler(IDxcLibrary *pLibrary,
+                            IDxcIncludeHandler **ppIncludeHandler);
 
   template <typename TInterface>
   HRESULT CreateInstance(REFCLSID clsid, _Outptr_ TInterface** pResult) {
@@ -203,15 +229,28 @@ public:
       if (m_MallocHeap == NULL)
         IFT_Data(HRESULT_FROM_WIN32(GetLastError()), L"unable to create custom heap");
       m_Malloc.SetHandle(m_MallocHeap);
-      // We never free the heap because it's tied to the dxc process lifetime
     }
   }
+  ~DxcContext() {
+    // All compiler objects are released by the time the context goes away;
+    // /batch creates one context per job, so the heap can't be leaked.
+    if (m_MallocHeap != nullptr)
+      HeapDestroy(m_MallocHeap);
+  }
+
+  // Serves includes from pIncludeCache, which must outlive the context.
+  void SetIncludeCache(IDxcIncludeCache *pIncludeCache) {
+    m_pIncludeCache = pIncludeCache;
+  }
 
   int  Compile();
   void Recompile(IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcCompiler *pCompiler, std::vector<LPCWSTR> &args, IDxcOperationResult **pCompileResult);
   int DumpBinary();
   void Preprocess();
   void GetCompilerVersionInfo(llvm::raw_string_ostream &OS);
+  void CompileRemoteJob(const RemoteJob &job,
+                        IDxcOperationResult **ppCompileResult,
+                        IDxcBlob **ppDebugBlob, std::wstring &debugName);
 };
 
 static void WriteBlobToFile(_In_opt_ IDxcBlob *pBlob, llvm::StringRef FName) {
@@ -225,15 +264,18 @@ static void WritePartToFile(IDxcBlob *pBlob, hlsl::DxilFourCC CC,
   if (!pContainer) {
     throw hlsl::Exception(E_FAIL, "Unable to find required part in blob");
   }
-  hlsl::DxilPartIsType pred(CC);
-  hlsl::DxilPartIterator it =
-      std::find_if(hlsl::begin(pContainer), hlsl::end(pContainer), pred);
-  if (it == hlsl::end(pContainer)) {
+  // Debug info is written decompressed, for tools that only know ILDB.
+  std::vector<char> partStorage;
+  const hlsl::DxilPartHeader *pPart =
+      CC == hlsl::DFCC_ShaderDebugInfoDXIL
+          ? hlsl::GetDxilDebugInfoPart(pContainer, partStorage)
+          : hlsl::GetDxilPartByType(pContainer, CC);
+  if (pPart == nullptr) {
     throw hlsl::Exception(E_FAIL, "Unable to find required part in blob");
   }
 
-  const char *pData = hlsl::GetDxilPartData(*it);
-  DWORD dataLen = (*it)->PartSize;
+  const char *pData = hlsl::GetDxilPartData(pPart);
+  DWORD dataLen = pPart->PartSize;
   StringRefUtf16 WideName(FName);
   CHandle file(CreateFile2(WideName, GENERIC_WRITE, FILE_SHARE_READ,
                            CREATE_ALWAYS, nullptr));
@@ -260,6 +302,12 @@ int DxcContext::ActOnBlob(IDxcBlob *pBlob, IDxcBlob *pDebugBlob, LPCWSTR pDebugB
     return retVal;
   }
 
+  // A pretokenized header is not a container; write it out as-is.
+  if (m_Opts.CreatePretokenizedHeader) {
+    WriteBlobToFile(pBlob, m_Opts.OutputObject);
+    return retVal;
+  }
+
   // Write the output blob.
   if (!m_Opts.OutputObject.empty()) {
     // For backward compatability: fxc requires /Fo for /extractrootsignature
@@ -380,7 +428,14 @@ void DxcContext::UpdatePart(IDxcBlob *pSource, IDxcBlob **ppResult) {
 
   // Update parts based on dxc options
   if (m_Opts.StripDebug) {
-    IFT(pContainerBuilder->RemovePart(hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
+    HRESULT hr = pContainerBuilder->RemovePart(hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL);
+    if (hr == DXC_E_MISSING_PART)
+      hr = pContainerBuilder->RemovePart(hlsl::DxilFourCC::DFCC_ShaderDebugInfoCompressed);
+    IFT(hr);
+    // Containers from older compilers have no line table.
+    hr = pContainerBuilder->RemovePart(hlsl::DxilFourCC::DFCC_ShaderDebugLines);
+    if (hr != DXC_E_MISSING_PART)
+      IFT(hr);
   }
   if (m_Opts.StripPrivate) {
     IFT(pContainerBuilder->RemovePart(hlsl::DxilFourCC::DFCC_PrivateData));
@@ -573,7 +628,7 @@ public:
     return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
   }
 
-  HRESULT insertIncludeFile(_In_ LPCWSTR pFilename, _In_ IDxcBlobEncoding *pBlob, _In_ UINT32 dataLen) {
+  HRESULT insertIncludeFile(_In_ LPCWSTR pFilename, _In_ IDxcBlob *pBlob, _In_ UINT32 dataLen) {
     try {
       includeFiles.try_emplace(std::wstring(pFilename), pBlob);
     }
@@ -586,14 +641,293 @@ public:
     _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource
   ) {
     try {
-      *ppIncludeSource = includeFiles.at(std::wstring(pFilename));
-      (*ppIncludeSource)->AddRef();
+      // Files that weren't captured are reported as not found, so that the
+      // search through the include paths goes on as it did originally.
+      *ppIncludeSource = nullptr;
+      auto it = includeFiles.find(std::wstring(pFilename));
+      if (it != includeFiles.end()) {
+        *ppIncludeSource = it->second;
+        (*ppIncludeSource)->AddRef();
+      }
     }
     CATCH_CPP_RETURN_HRESULT()
     return S_OK;
   }
 };
 
+// Remote compilation packages. A job holds everything a worker needs to
+// repeat a compilation without the client's file system: the command line,
+// the main source, each included file that was read, and the version of the
+// validator the outputs are validated with. A result holds the status and
+// errors of the compilation, the program and the separate debug blob if
+// there is one. Both are a four-character code and a version followed by
+// length-prefixed fields; moving them between machines is left to the build
+// system, the way distcc leaves it to ssh.
+static const uint32_t RemoteJobFourCC = DXIL_FOURCC('D', 'X', 'R', 'J');
+static const uint32_t RemoteResultFourCC = DXIL_FOURCC('D', 'X', 'R', 'R');
+static const uint32_t RemotePackageVersion = 1;
+
+struct RemoteJob {
+  std::vector<std::string> Args; // Command line without the input and /remote.
+  std::string MainFileName;
+  CComPtr<IDxcBlob> pSource;
+  std::vector<std::pair<std::wstring, CComPtr<IDxcBlob>>> Includes;
+  UINT32 ValidatorMajor = 0;
+  UINT32 ValidatorMinor = 0;
+};
+
+class RemotePackageWriter {
+  std::string m_Data;
+
+public:
+  void WriteUInt32(uint32_t value) {
+    m_Data.append((const char *)&value, sizeof(value));
+  }
+  void WriteBytes(const void *pData, size_t size) {
+    WriteUInt32((uint32_t)size);
+    m_Data.append((const char *)pData, size);
+  }
+  void WriteString(llvm::StringRef value) {
+    WriteBytes(value.data(), value.size());
+  }
+  void WriteBlob(_In_opt_ IDxcBlob *pBlob) {
+    if (pBlob == nullptr)
+      WriteBytes(nullptr, 0);
+    else
+      WriteBytes(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  }
+  // Source blobs keep their code page, when known.
+  void WriteSourceBlob(_In_ IDxcBlob *pBlob) {
+    CComPtr<IDxcBlobEncoding> pEncoding;
+    BOOL known = FALSE;
+    UINT32 codePage = 0;
+    if (SUCCEEDED(pBlob->QueryInterface(&pEncoding)))
+      IFT(pEncoding->GetEncoding(&known, &codePage));
+    WriteUInt32(known ? 1 : 0);
+    WriteUInt32(codePage);
+    WriteBlob(pBlob);
+  }
+  void WriteToFile(llvm::StringRef FName) {
+    hlsl::WriteBinaryFile(StringRefUtf16(FName), m_Data.data(),
+                          (DWORD)m_Data.size());
+  }
+};
+
+class RemotePackageReader {
+  CComPtr<IDxcBlobEncoding> m_pPackage;
+  const char *m_pCursor;
+  const char *m_pEnd;
+
+  const char *Advance(size_t size) {
+    if ((size_t)(m_pEnd - m_pCursor) < size)
+      throw hlsl::Exception(E_INVALIDARG, "remote package is truncated");
+    const char *pResult = m_pCursor;
+    m_pCursor += size;
+    return pResult;
+  }
+
+public:
+  RemotePackageReader(DxcDllSupport &dxcSupport, llvm::StringRef FName,
+                      uint32_t fourCC) {
+    ReadFileIntoBlob(dxcSupport, StringRefUtf16(FName), &m_pPackage);
+    m_pCursor = (const char *)m_pPackage->GetBufferPointer();
+    m_pEnd = m_pCursor + m_pPackage->GetBufferSize();
+    if (ReadUInt32() != fourCC)
+      throw hlsl::Exception(E_INVALIDARG, "file is not a remote package of "
+                                          "the expected kind");
+    if (ReadUInt32() != RemotePackageVersion)
+      throw hlsl::Exception(E_INVALIDARG,
+                            "remote package version is not supported");
+  }
+  uint32_t ReadUInt32() {
+    uint32_t value;
+    memcpy(&value, Advance(sizeof(value)), sizeof(value));
+    return value;
+  }
+  llvm::StringRef ReadBytes() {
+    uint32_t size = ReadUInt32();
+    return llvm::StringRef(Advance(size), size);
+  }
+  void ReadBlob(IDxcBlob **ppBlob) {
+    llvm::StringRef bytes = ReadBytes();
+    *ppBlob = nullptr;
+    if (!bytes.empty())
+      IFT(hlsl::DxcCreateBlobOnHeapCopy(bytes.data(), bytes.size(), ppBlob));
+  }
+  void ReadSourceBlob(IDxcBlob **ppBlob) {
+    bool known = ReadUInt32() != 0;
+    UINT32 codePage = ReadUInt32();
+    llvm::StringRef bytes = ReadBytes();
+    if (known) {
+      CComPtr<IDxcBlobEncoding> pEncoding;
+      IFT(hlsl::DxcCreateBlobWithEncodingOnHeapCopy(bytes.data(), bytes.size(),
+                                                   codePage, &pEncoding));
+      *ppBlob = pEncoding.Detach();
+    } else {
+      IFT(hlsl::DxcCreateBlobOnHeapCopy(bytes.data(), bytes.size(), ppBlob));
+    }
+  }
+};
+
+// Passes include requests on to another handler and keeps each file loaded,
+// by the name the compiler asked for it with.
+class DxcIncludeHandlerForRemoteJob : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IDxcIncludeHandler> m_pInner;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  DxcIncludeHandlerForRemoteJob(IDxcIncludeHandler *pInner)
+      : m_dwRef(0), m_pInner(pInner) {}
+  std::vector<std::pair<std::wstring, CComPtr<IDxcBlob>>> loadedFiles;
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+    _In_ LPCWSTR pFilename,
+    _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource
+  ) {
+    HRESULT hr = m_pInner->LoadSource(pFilename, ppIncludeSource);
+    if (SUCCEEDED(hr) && *ppIncludeSource != nullptr) {
+      try {
+        loadedFiles.emplace_back(std::wstring(pFilename), *ppIncludeSource);
+      }
+      CATCH_CPP_RETURN_HRESULT()
+    }
+    return hr;
+  }
+};
+
+static void WriteRemoteResult(llvm::StringRef FName, HRESULT status,
+                              llvm::StringRef errors, _In_opt_ IDxcBlob *pProgram,
+                              llvm::StringRef debugName,
+                              _In_opt_ IDxcBlob *pDebugBlob) {
+  RemotePackageWriter writer;
+  writer.WriteUInt32(RemoteResultFourCC);
+  writer.WriteUInt32(RemotePackageVersion);
+  writer.WriteUInt32((uint32_t)status);
+  writer.WriteString(errors);
+  writer.WriteBlob(pProgram);
+  writer.WriteString(debugName);
+  writer.WriteBlob(pDebugBlob);
+  writer.WriteToFile(FName);
+}
+
+// Preprocesses the input to find the files it includes, then writes the job.
+int DxcContext::WriteRemoteJob() {
+  std::vector<std::wstring> argStrings;
+  std::vector<LPCWSTR> args;
+  GetCompileArgs(argStrings, args);
+
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(m_Opts.InputFile), &pSource);
+
+  CComPtr<IDxcIncludeHandler> pDefaultHandler;
+  IFT(pLibrary->CreateIncludeHandler(&pDefaultHandler));
+  CComPtr<DxcIncludeHandlerForRemoteJob> pIncludeHandler =
+      new DxcIncludeHandlerForRemoteJob(pDefaultHandler);
+  CComPtr<IDxcOperationResult> pPreprocessResult;
+  IFT(pCompiler->Preprocess(pSource, StringRefUtf16(m_Opts.InputFile),
+                            args.data(), args.size(), m_Opts.Defines.data(),
+                            m_Opts.Defines.size(), pIncludeHandler,
+                            &pPreprocessResult));
+  HRESULT status;
+  IFT(pPreprocessResult->GetStatus(&status));
+  if (FAILED(status)) {
+    WriteOperationErrorsToConsole(pPreprocessResult, m_Opts.OutputWarnings);
+    return status;
+  }
+
+  UINT32 validatorMajor = 0, validatorMinor = 0;
+  CComPtr<IDxcVersionInfo> pValidatorVersion;
+  if (SUCCEEDED(CreateInstance(CLSID_DxcValidator, &pValidatorVersion)))
+    IFT(pValidatorVersion->GetVersion(&validatorMajor, &validatorMinor));
+
+  ArgStringList jobArgs;
+  for (const Arg *A : m_Opts.Args) {
+    if (A->getOption().matches(OPT_remote) ||
+        A->getOption().matches(OPT_INPUT))
+      continue;
+    A->render(m_Opts.Args, jobArgs);
+  }
+
+  RemotePackageWriter writer;
+  writer.WriteUInt32(RemoteJobFourCC);
+  writer.WriteUInt32(RemotePackageVersion);
+  writer.WriteUInt32(validatorMajor);
+  writer.WriteUInt32(validatorMinor);
+  writer.WriteUInt32(jobArgs.size());
+  for (const char *pArg : jobArgs)
+    writer.WriteString(pArg);
+  writer.WriteString(m_Opts.InputFile);
+  writer.WriteSourceBlob(pSource);
+  writer.WriteUInt32(pIncludeHandler->loadedFiles.size());
+  for (auto &file : pIncludeHandler->loadedFiles) {
+    writer.WriteString(Unicode::UTF16ToUTF8StringOrThrow(file.first.c_str()));
+    writer.WriteSourceBlob(file.second);
+  }
+  writer.WriteToFile(m_Opts.RemoteJobFile);
+  return 0;
+}
+
+// Compiles a job read by the worker, serving includes from the job only.
+void DxcContext::CompileRemoteJob(const RemoteJob &job,
+                                  IDxcOperationResult **ppCompileResult,
+                                  IDxcBlob **ppDebugBlob,
+                                  std::wstring &debugName) {
+  std::vector<std::wstring> argStrings;
+  std::vector<LPCWSTR> args;
+  GetCompileArgs(argStrings, args);
+
+  CComPtr<IDxcCompiler> pCompiler;
+  IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  CComPtr<DxcIncludeHandlerForInjectedSources> pIncludeHandler =
+      new DxcIncludeHandlerForInjectedSources();
+  for (auto &file : job.Includes) {
+    IFT(pIncludeHandler->insertIncludeFile(file.first.c_str(), file.second,
+                                           file.second->GetBufferSize()));
+  }
+  CompileSource(pCompiler, job.pSource, args, pIncludeHandler, ppCompileResult,
+                ppDebugBlob, debugName);
+}
+
+// Writes the outputs named on the command line from a worker's result, as
+// if the compilation had run here.
+int DxcContext::ActOnRemoteResult() {
+  RemotePackageReader reader(m_dxcSupport, m_Opts.RemoteResultFile,
+                             RemoteResultFourCC);
+  HRESULT status = (HRESULT)reader.ReadUInt32();
+  llvm::StringRef errors = reader.ReadBytes();
+  CComPtr<IDxcBlob> pProgram;
+  reader.ReadBlob(&pProgram);
+  std::wstring debugName =
+      Unicode::UTF8ToUTF16StringOrThrow(reader.ReadBytes().str().c_str());
+  CComPtr<IDxcBlob> pDebugBlob;
+  reader.ReadBlob(&pDebugBlob);
+
+  if (!m_Opts.OutputWarningsFile.empty()) {
+    CComPtr<IDxcBlobEncoding> pErrors;
+    IFT(hlsl::DxcCreateBlobWithEncodingOnHeapCopy(errors.data(), errors.size(),
+                                                 CP_UTF8, &pErrors));
+    WriteBlobToFile(pErrors, m_Opts.OutputWarningsFile);
+  }
+  else if (!errors.empty() && (FAILED(status) || m_Opts.OutputWarnings)) {
+    WriteUtf8ToConsoleSizeT(errors.data(), errors.size(), STD_ERROR_HANDLE);
+  }
+
+  if (SUCCEEDED(status) && pProgram.p != nullptr) {
+    ActOnBlob(pProgram.p, pDebugBlob, debugName.c_str());
+  }
+  return status;
+}
+
 void DxcContext::Recompile(IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcCompiler *pCompiler, std::vector<LPCWSTR> &args, IDxcOperationResult **ppCompileResult) {
   CComPtr<IDxcBlob> pTargetBlob;
   IFT(FindModuleBlob(hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL, pSource, pLibrary, &pTargetBlob));
@@ -747,7 +1081,92 @@ void DxcContext::Recompile(IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcCompile
   *ppCompileResult = pResult.Detach();
 }
 
+void DxcContext::GetCompileArgs(std::vector<std::wstring> &argStrings,
+                                std::vector<LPCWSTR> &args) {
+  CopyArgsToWStrings(m_Opts.Args, CoreOption, argStrings);
+
+  args.reserve(argStrings.size() + 3);
+  for (const std::wstring &a : argStrings)
+    args.push_back(a.data());
+
+  if (m_Opts.AstDump)
+    args.push_back(L"-ast-dump");
+  if (!m_Opts.TimeReportFile.empty())
+    args.push_back(L"-ftime-report");
+  if (!m_Opts.TimeTraceFile.empty())
+    args.push_back(L"-ftime-trace");
+  if (!m_Opts.SourcePackFile.empty())
+    args.push_back(L"-Qsource_pack");
+  // SPIRV Change Starts
+#ifdef ENABLE_SPIRV_CODEGEN
+  if (!m_Opts.SpvReflectSidecarFile.empty())
+    args.push_back(L"-fspv-reflect-sidecar");
+#endif // ENABLE_SPIRV_CODEGEN
+  // SPIRV Change Ends
+}
+
+void DxcContext::CompileSource(IDxcCompiler *pCompiler, IDxcBlob *pSource,
+                               std::vector<LPCWSTR> &args,
+                               IDxcIncludeHandler *pIncludeHandler,
+                               IDxcOperationResult **ppCompileResult,
+                               IDxcBlob **ppDebugBlob,
+                               std::wstring &debugName) {
+  // Upgrade profile to 6.0 version from minimum recognized shader model
+  llvm::StringRef TargetProfile = m_Opts.TargetProfile;
+  const hlsl::ShaderModel *SM = hlsl::ShaderModel::GetByName(m_Opts.TargetProfile.str().c_str());
+  if (SM->IsValid() && SM->GetMajor() < 6) {
+    TargetProfile = hlsl::ShaderModel::Get(SM->GetKind(), 6, 0)->GetName();
+  }
+
+  // With /Qsidecar, the debug blob is the sidecar container for /Fd.
+  bool autoDebugName = !m_Opts.DebugFile.empty() &&
+                       m_Opts.DebugFile.endswith(llvm::StringRef("\\"));
+  if (autoDebugName || (m_Opts.Sidecar && !m_Opts.DebugFile.empty())) {
+    if (autoDebugName && !m_Opts.Sidecar)
+      args.push_back(L"/Qstrip_debug"); // implied
+    CComPtr<IDxcCompiler2> pCompiler2;
+    CComHeapPtr<WCHAR> pDebugName;
+    IFT(pCompiler->QueryInterface(&pCompiler2));
+    IFT(pCompiler2->CompileWithDebug(
+        pSource, StringRefUtf16(m_Opts.InputFile),
+        StringRefUtf16(m_Opts.EntryPoint), StringRefUtf16(TargetProfile),
+        args.data(), args.size(), m_Opts.Defines.data(),
+        m_Opts.Defines.size(), pIncludeHandler, ppCompileResult,
+        &pDebugName, ppDebugBlob));
+    if (!autoDebugName) {
+      Unicode::UTF8ToUTF16String(m_Opts.DebugFile.str().c_str(), &debugName);
+    } else if (pDebugName.m_pData) {
+      Unicode::UTF8ToUTF16String(m_Opts.DebugFile.str().c_str(), &debugName);
+      debugName += pDebugName.m_pData;
+    }
+  } else {
+    IFT(pCompiler->Compile(pSource, StringRefUtf16(m_Opts.InputFile),
+      StringRefUtf16(m_Opts.EntryPoint),
+      StringRefUtf16(TargetProfile), args.data(),
+      args.size(), m_Opts.Defines.data(),
+      m_Opts.Defines.size(), pIncludeHandler, ppCompileResult));
+  }
+}
+
+void DxcContext::CreateIncludeHandler(IDxcLibrary *pLibrary,
+                                      IDxcIncludeHandler **ppIncludeHandler) {
+  CComPtr<IDxcIncludeHandler> pDefaultHandler;
+  IFT(pLibrary->CreateIncludeHandler(&pDefaultHandler));
+  if (m_pIncludeCache == nullptr) {
+    *ppIncludeHandler = pDefaultHandler.Detach();
+    return;
+  }
+  IFT(m_pIncludeCache->CreateIncludeHandler(pDefaultHandler, ppIncludeHandler));
+}
+
 int DxcContext::Compile() {
+  if (!m_Opts.RemoteJobFile.empty()) {
+    return WriteRemoteJob();
+  }
+  if (!m_Opts.RemoteResultFile.empty()) {
+    return ActOnRemoteResult();
+  }
+
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pCompileResult;
   CComPtr<IDxcBlob> pDebugBlob;
@@ -756,15 +1175,8 @@ int DxcContext::Compile() {
     CComPtr<IDxcBlobEncoding> pSource;
 
     std::vector<std::wstring> argStrings;
-    CopyArgsToWStrings(m_Opts.Args, CoreOption, argStrings);
-
     std::vector<LPCWSTR> args;
-    args.reserve(argStrings.size());
-    for (const std::wstring &a : argStrings)
-      args.push_back(a.data());
-
-    if (m_Opts.AstDump)
-      args.push_back(L"-ast-dump");
+    GetCompileArgs(argStrings, args);
 
     CComPtr<IDxcLibrary> pLibrary;
     IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
@@ -777,37 +1189,9 @@ int DxcContext::Compile() {
     }
     else {
       CComPtr<IDxcIncludeHandler> pIncludeHandler;
-      IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
-
-      // Upgrade profile to 6.0 version from minimum recognized shader model
-      llvm::StringRef TargetProfile = m_Opts.TargetProfile;
-      const hlsl::ShaderModel *SM = hlsl::ShaderModel::GetByName(m_Opts.TargetProfile.str().c_str());
-      if (SM->IsValid() && SM->GetMajor() < 6) {
-        TargetProfile = hlsl::ShaderModel::Get(SM->GetKind(), 6, 0)->GetName();
-      }
-
-      if (!m_Opts.DebugFile.empty() && m_Opts.DebugFile.endswith(llvm::StringRef("\\"))) {
-        args.push_back(L"/Qstrip_debug"); // implied
-        CComPtr<IDxcCompiler2> pCompiler2;
-        CComHeapPtr<WCHAR> pDebugName;
-        IFT(pCompiler.QueryInterface(&pCompiler2));
-        IFT(pCompiler2->CompileWithDebug(
-            pSource, StringRefUtf16(m_Opts.InputFile),
-            StringRefUtf16(m_Opts.EntryPoint), StringRefUtf16(TargetProfile),
-            args.data(), args.size(), m_Opts.Defines.data(),
-            m_Opts.Defines.size(), pIncludeHandler, &pCompileResult,
-            &pDebugName, &pDebugBlob));
-        if (pDebugName.m_pData) {
-          Unicode::UTF8ToUTF16String(m_Opts.DebugFile.str().c_str(), &debugName);
-          debugName += pDebugName.m_pData;
-        }
-      } else {
-        IFT(pCompiler->Compile(pSource, StringRefUtf16(m_Opts.InputFile),
-          StringRefUtf16(m_Opts.EntryPoint),
-          StringRefUtf16(TargetProfile), args.data(),
-          args.size(), m_Opts.Defines.data(),
-          m_Opts.Defines.size(), pIncludeHandler, &pCompileResult));
-      }
+      CreateIncludeHandler(pLibrary, &pIncludeHandler);
+      CompileSource(pCompiler, pSource, args, pIncludeHandler, &pCompileResult,
+                    &pDebugBlob, debugName);
     }
   }
 
@@ -820,8 +1204,31 @@ int DxcContext::Compile() {
     WriteOperationErrorsToConsole(pCompileResult, m_Opts.OutputWarnings);
   }
 
+  if (m_Opts.TimeReport) {
+    WriteTimeReport(pCompileResult);
+  }
+  if (m_Opts.TimeTrace) {
+    WriteTimeTrace(pCompileResult);
+  }
+  if (m_Opts.PrintIRStats) {
+    WriteIRStats(pCompileResult);
+  }
+
   HRESULT status;
   IFT(pCompileResult->GetStatus(&status));
+  if (SUCCEEDED(status) && m_Opts.WriteDependencies) {
+    WriteDependencyFile(pCompileResult);
+  }
+  if (SUCCEEDED(status) && !m_Opts.SourcePackFile.empty()) {
+    WriteSourcePack(pCompileResult);
+  }
+  // SPIRV Change Starts
+#ifdef ENABLE_SPIRV_CODEGEN
+  if (SUCCEEDED(status) && !m_Opts.SpvReflectSidecarFile.empty()) {
+    WriteSpirvReflection(pCompileResult, m_Opts.SpvReflectSidecarFile);
+  }
+#endif // ENABLE_SPIRV_CODEGEN
+  // SPIRV Change Ends
   if (SUCCEEDED(status) || m_Opts.AstDump || m_Opts.OptDump) {
     CComPtr<IDxcBlob> pProgram;
     IFT(pCompileResult->GetResult(&pProgram));
@@ -834,6 +1241,94 @@ int DxcContext::Compile() {
   return status;
 }
 
+void DxcContext::WriteTimeReport(IDxcOperationResult *pResult) {
+  CComPtr<IDxcTimeReport> pTimeReport;
+  CComPtr<IDxcBlobEncoding> pReport;
+  if (FAILED(pResult->QueryInterface(&pTimeReport)))
+    return;
+  IFT(pTimeReport->GetTimeReport(&pReport));
+  if (pReport == nullptr)
+    return;
+  if (!m_Opts.TimeReportFile.empty()) {
+    WriteBlobToFile(pReport, m_Opts.TimeReportFile);
+  }
+  else {
+    WriteBlobToConsole(pReport);
+  }
+}
+
+// Writes a Makefile rule listing the files the output was built from, to the
+// /MF file or next to the output.
+void DxcContext::WriteDependencyFile(IDxcOperationResult *pResult) {
+  CComPtr<IDxcIncludeDependencies> pDependencies;
+  CComPtr<IDxcBlobEncoding> pDependencyFile;
+  if (FAILED(pResult->QueryInterface(&pDependencies)))
+    return;
+  llvm::StringRef Target = !m_Opts.OutputObject.empty() ? m_Opts.OutputObject
+                         : !m_Opts.OutputHeader.empty() ? m_Opts.OutputHeader
+                         : m_Opts.Preprocess;
+  IFT(pDependencies->GetDependencyFile(StringRefUtf16(Target),
+                                       &pDependencyFile));
+  if (pDependencyFile == nullptr)
+    return;
+  if (!m_Opts.DependencyFile.empty()) {
+    WriteBlobToFile(pDependencyFile, m_Opts.DependencyFile);
+  }
+  else {
+    WriteBlobToFile(pDependencyFile, (Target + ".d").str());
+  }
+}
+
+void DxcContext::WriteTimeTrace(IDxcOperationResult *pResult) {
+  CComPtr<IDxcTimeTrace> pTimeTrace;
+  CComPtr<IDxcBlobEncoding> pTrace;
+  if (FAILED(pResult->QueryInterface(&pTimeTrace)))
+    return;
+  IFT(pTimeTrace->GetTimeTrace(&pTrace));
+  if (pTrace == nullptr)
+    return;
+  if (!m_Opts.TimeTraceFile.empty()) {
+    WriteBlobToFile(pTrace, m_Opts.TimeTraceFile);
+  }
+  else {
+    WriteBlobToConsole(pTrace);
+  }
+}
+
+void DxcContext::WriteIRStats(IDxcOperationResult *pResult) {
+  CComPtr<IDxcIRStats> pIRStats;
+  CComPtr<IDxcBlobEncoding> pStats;
+  if (FAILED(pResult->QueryInterface(&pIRStats)))
+    return;
+  IFT(pIRStats->GetIRStats(&pStats));
+  if (pStats != nullptr)
+    WriteBlobToConsole(pStats);
+}
+
+// Writes the SPIR-V reflection sidecar to the /Fsr file.
+void DxcContext::WriteSpirvReflection(IDxcOperationResult *pResult,
+                                      llvm::StringRef FileName) {
+  CComPtr<IDxcSpirvReflection> pSpirvReflection;
+  CComPtr<IDxcBlob> pReflection;
+  if (FAILED(pResult->QueryInterface(&pSpirvReflection)))
+    return;
+  IFT(pSpirvReflection->GetSpirvReflection(&pReflection));
+  if (pReflection == nullptr)
+    return;
+  WriteBlobToFile(pReflection, FileName);
+}
+
+void DxcContext::WriteSourcePack(IDxcOperationResult *pResult) {
+  CComPtr<IDxcSourcePack> pSourcePack;
+  CComPtr<IDxcBlob> pPack;
+  if (FAILED(pResult->QueryInterface(&pSourcePack)))
+    return;
+  IFT(pSourcePack->GetSourcePack(&pPack));
+  if (pPack == nullptr)
+    return;
+  WriteBlobToFile(pPack, m_Opts.SourcePackFile);
+}
+
 int DxcContext::DumpBinary() {
   CComPtr<IDxcBlobEncoding> pSource;
   ReadFileIntoBlob(m_dxcSupport, StringRefUtf16(m_Opts.InputFile), &pSource);
@@ -850,7 +1345,7 @@ void DxcContext::Preprocess() {
   CComPtr<IDxcLibrary> pLibrary;
   CComPtr<IDxcIncludeHandler> pIncludeHandler;
   IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
-  IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+  CreateIncludeHandler(pLibrary, &pIncludeHandler);
 
   // Carry forward the options that control preprocessor
   if (m_Opts.LegacyMacroExpansion)
@@ -867,6 +1362,8 @@ void DxcContext::Preprocess() {
     CComPtr<IDxcBlob> pProgram;
     IFT(pPreprocessResult->GetResult(&pProgram));
     WriteBlobToFile(pProgram, m_Opts.Preprocess);
+    if (m_Opts.WriteDependencies)
+      WriteDependencyFile(pPreprocessResult);
   }
 }
 
@@ -942,6 +1439,17 @@ HRESULT DxcContext::FindModuleBlob(hlsl::DxilFourCC fourCC, IDxcBlob *pSource, I
   if (hlsl::IsValidDxilContainer((hlsl::DxilContainerHeader*)pSource->GetBufferPointer(), pSource->GetBufferSize())) {
     hlsl::DxilContainerHeader *pDxilContainerHeader = (hlsl::DxilContainerHeader*)pSource->GetBufferPointer();
     pDxilPartHeader = hlsl::GetDxilPartByType(pDxilContainerHeader, fourCC);
+    // Compressed debug info is handed out as a copy of the decompressed module.
+    if (pDxilPartHeader == nullptr && fourCC == hlsl::DFCC_ShaderDebugInfoDXIL) {
+      std::vector<char> partStorage;
+      pDxilPartHeader = hlsl::GetDxilDebugInfoPart(pDxilContainerHeader, partStorage);
+      IFTBOOL(pDxilPartHeader != nullptr, DXC_E_CONTAINER_MISSING_DEBUG);
+      UINT32 pBlobSize;
+      hlsl::GetDxilProgramBitcode((const hlsl::DxilProgramHeader *)(pDxilPartHeader + 1), &pBitcode, &pBlobSize);
+      CComPtr<IDxcBlobEncoding> pBitcodeBlob;
+      IFR(pLibrary->CreateBlobWithEncodingOnHeapCopy(pBitcode, pBlobSize, CP_ACP, &pBitcodeBlob));
+      return pBitcodeBlob.QueryInterface(ppTargetBlob);
+    }
     IFTBOOL(pDxilPartHeader != nullptr, DXC_E_CONTAINER_MISSING_DEBUG);
   }
   if (fourCC == pDxilPartHeader->PartFourCC) {
@@ -1064,6 +1572,262 @@ void DxcContext::GetCompilerVersionInfo(llvm::raw_string_ostream &OS) {
   }
 }
 
+// Runs the job in the /server input file and writes the result to /Fo. The
+// job's command line is parsed as it was on the client, but files are only
+// read from the job.
+static int RunRemoteJob(const DxcOpts &serverOpts, DxcDllSupport &dxcSupport) {
+  RemoteJob job;
+  {
+    RemotePackageReader reader(dxcSupport, serverOpts.InputFile,
+                               RemoteJobFourCC);
+    job.ValidatorMajor = reader.ReadUInt32();
+    job.ValidatorMinor = reader.ReadUInt32();
+    uint32_t argCount = reader.ReadUInt32();
+    for (uint32_t i = 0; i < argCount; ++i)
+      job.Args.emplace_back(reader.ReadBytes().str());
+    job.MainFileName = reader.ReadBytes().str();
+    reader.ReadSourceBlob(&job.pSource);
+    uint32_t includeCount = reader.ReadUInt32();
+    for (uint32_t i = 0; i < includeCount; ++i) {
+      std::wstring name =
+          Unicode::UTF8ToUTF16StringOrThrow(reader.ReadBytes().str().c_str());
+      CComPtr<IDxcBlob> pInclude;
+      reader.ReadSourceBlob(&pInclude);
+      job.Includes.emplace_back(std::move(name), pInclude);
+    }
+  }
+
+  std::vector<llvm::StringRef> args(job.Args.begin(), job.Args.end());
+  args.push_back(job.MainFileName);
+  MainArgs argStrings(args);
+  DxcOpts jobOpts;
+  {
+    std::string errorString;
+    llvm::raw_string_ostream errorStream(errorString);
+    int optResult = ReadDxcOpts(getHlslOptTable(), DxcFlags, argStrings,
+                                jobOpts, errorStream);
+    errorStream.flush();
+    if (optResult != 0) {
+      WriteRemoteResult(serverOpts.OutputObject, E_INVALIDARG, errorString,
+                        nullptr, "", nullptr);
+      return 1;
+    }
+  }
+  if (jobOpts.EntryPoint.empty()) {
+    jobOpts.EntryPoint = "main";
+  }
+
+  // The outputs are only as good as the validator that checked them.
+  {
+    UINT32 validatorMajor = 0, validatorMinor = 0;
+    CComPtr<IDxcVersionInfo> pValidatorVersion;
+    if (SUCCEEDED(dxcSupport.CreateInstance(CLSID_DxcValidator,
+                                            &pValidatorVersion)))
+      IFT(pValidatorVersion->GetVersion(&validatorMajor, &validatorMinor));
+    if (validatorMajor != job.ValidatorMajor ||
+        validatorMinor != job.ValidatorMinor) {
+      std::string errorString;
+      llvm::raw_string_ostream errorStream(errorString);
+      errorStream << "error: the job requires validator version "
+                  << job.ValidatorMajor << "." << job.ValidatorMinor
+                  << " but this worker has " << validatorMajor << "."
+                  << validatorMinor << ".\n";
+      errorStream.flush();
+      WriteRemoteResult(serverOpts.OutputObject, E_FAIL, errorString, nullptr,
+                        "", nullptr);
+      return 1;
+    }
+  }
+
+  CComPtr<IDxcOperationResult> pCompileResult;
+  CComPtr<IDxcBlob> pDebugBlob;
+  std::wstring debugName;
+  {
+    DxcContext context(jobOpts, dxcSupport);
+    context.CompileRemoteJob(job, &pCompileResult, &pDebugBlob, debugName);
+  }
+
+  HRESULT status;
+  CComPtr<IDxcBlobEncoding> pErrors;
+  CComPtr<IDxcBlob> pProgram;
+  IFT(pCompileResult->GetStatus(&status));
+  IFT(pCompileResult->GetErrorBuffer(&pErrors));
+  if (SUCCEEDED(status))
+    IFT(pCompileResult->GetResult(&pProgram));
+  llvm::StringRef errors;
+  if (pErrors != nullptr)
+    errors = llvm::StringRef((const char *)pErrors->GetBufferPointer(),
+                             pErrors->GetBufferSize());
+  WriteRemoteResult(serverOpts.OutputObject, status, errors, pProgram,
+                    Unicode::UTF16ToUTF8StringOrThrow(debugName.c_str()),
+                    pDebugBlob);
+  return SUCCEEDED(status) ? 0 : 1;
+}
+
+// Runs a single line of a /batch file as a complete dxc command line.
+static int CompileBatchCommand(llvm::StringRef command,
+                               DxcDllSupport &dxcSupport,
+                               IDxcIncludeCache *pIncludeCache = nullptr) {
+  llvm::BumpPtrAllocator alloc;
+  llvm::BumpPtrStringSaver saver(alloc);
+  llvm::SmallVector<const char *, 16> tokens;
+  llvm::cl::TokenizeWindowsCommandLine(command, saver, tokens);
+  std::vector<llvm::StringRef> args(tokens.begin(), tokens.end());
+  MainArgs argStrings(args);
+  DxcOpts dxcOpts;
+  std::string commandStr = command.str();
+
+  {
+    std::string errorString;
+    llvm::raw_string_ostream errorStream(errorString);
+    int optResult = ReadDxcOpts(getHlslOptTable(), DxcFlags, argStrings,
+                                dxcOpts, errorStream);
+    errorStream.flush();
+    if (errorString.size()) {
+      fprintf(stderr, "dxc failed : %s : %s\n", commandStr.c_str(),
+              errorString.data());
+    }
+    if (optResult != 0) {
+      return optResult;
+    }
+  }
+  if (!dxcOpts.BatchFile.empty() || dxcOpts.Daemon) {
+    fprintf(stderr, "dxc failed : %s : /batch and /daemon cannot be nested.\n",
+            commandStr.c_str());
+    return 1;
+  }
+  if (dxcOpts.EntryPoint.empty() && !dxcOpts.RecompileFromBinary) {
+    dxcOpts.EntryPoint = "main";
+  }
+
+  try {
+    if (dxcOpts.RemoteServer) {
+      return RunRemoteJob(dxcOpts, dxcSupport);
+    }
+    DxcContext context(dxcOpts, dxcSupport);
+    context.SetIncludeCache(pIncludeCache);
+    if (!dxcOpts.Preprocess.empty()) {
+      context.Preprocess();
+      return 0;
+    }
+    if (dxcOpts.DumpBin) {
+      return context.DumpBinary();
+    }
+    return context.Compile();
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg == nullptr || *msg == '\0') {
+      fprintf(stderr, "dxc failed : %s : error code 0x%08x.\n",
+              commandStr.c_str(), hlslException.hr);
+    } else {
+      fprintf(stderr, "dxc failed : %s : %s\n", commandStr.c_str(), msg);
+    }
+  } catch (std::bad_alloc &) {
+    fprintf(stderr, "dxc failed : %s : out of memory.\n", commandStr.c_str());
+  } catch (...) {
+    fprintf(stderr, "dxc failed : %s : unknown error.\n", commandStr.c_str());
+  }
+  return 1;
+}
+
+// Runs every command line in the /batch file on a pool of worker threads.
+// Each job gets its own context and thread allocator, and writes its outputs
+// as soon as it finishes.
+static int BatchCompile(const DxcOpts &dxcOpts, DxcDllSupport &dxcSupport) {
+  CComPtr<IDxcBlobEncoding> pSource;
+  ReadFileIntoBlob(dxcSupport, StringRefUtf16(dxcOpts.BatchFile), &pSource);
+  llvm::StringRef source((const char *)pSource->GetBufferPointer(),
+                         pSource->GetBufferSize());
+  llvm::SmallVector<llvm::StringRef, 64> lines;
+  source.split(lines, "\n", -1, false);
+  std::vector<std::string> commands;
+  for (llvm::StringRef line : lines) {
+    // Trim to remove \r if present; # and // start comment lines.
+    line = line.trim();
+    if (line.empty() || line.startswith("#") || line.startswith("//"))
+      continue;
+    commands.emplace_back(line.str());
+  }
+  if (commands.empty())
+    return 0;
+
+  unsigned threadCount = dxcOpts.BatchJobs;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min<unsigned>(threadCount, commands.size());
+
+  auto startTime = std::chrono::steady_clock::now();
+  std::atomic<unsigned> nextCommand(0);
+  std::atomic<unsigned> failedCount(0);
+  auto runJobs = [&]() {
+    for (unsigned i = nextCommand++; i < commands.size(); i = nextCommand++) {
+      if (CompileBatchCommand(commands[i], dxcSupport) != 0)
+        ++failedCount;
+    }
+  };
+  // The calling thread already has a thread allocator and takes part in the
+  // work, so only threadCount - 1 new threads are started.
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount);
+  for (unsigned i = 1; i < threadCount; ++i) {
+    threads.emplace_back([&]() {
+      DxcThreadMalloc TM(nullptr);
+      runJobs();
+    });
+  }
+  runJobs();
+  for (std::thread &t : threads)
+    t.join();
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - startTime;
+  unsigned failed = failedCount;
+  fprintf(stderr, "%u of %u compilations succeeded in %.2fs using %u threads.\n",
+          (unsigned)commands.size() - failed, (unsigned)commands.size(),
+          elapsed.count(), threadCount);
+  return failed == 0 ? 0 : 1;
+}
+
+// Reads a line from stdin into line, without the line break. Returns false
+// at the end of the input.
+static bool ReadStdinLine(std::string &line) {
+  line.clear();
+  char buffer[1024];
+  while (fgets(buffer, _countof(buffer), stdin) != nullptr) {
+    line += buffer;
+    if (!line.empty() && line.back() == '\n') {
+      line.pop_back();
+      return true;
+    }
+  }
+  return !line.empty();
+}
+
+// Runs each command line read from stdin as a /batch line would be, one at a
+// time, and reports its exit code on stdout with a line of the form
+// "dxc-daemon: exit <code>" after all of its output. The process does its
+// startup once, and the compiler DLL, its caches (root signatures, per
+// thread validators) and the include cache stay warm across requests, as
+// with the persistent workers of Gradle and Bazel. A build system runs as
+// many daemons as it wants compilations in parallel. The daemon stops at
+// the end of the input.
+static int RunDaemon(DxcDllSupport &dxcSupport) {
+  CComPtr<IDxcIncludeCache> pIncludeCache;
+  IFT(dxcSupport.CreateInstance(CLSID_DxcIncludeCache, &pIncludeCache));
+
+  std::string line;
+  while (ReadStdinLine(line)) {
+    llvm::StringRef command = llvm::StringRef(line).trim();
+    if (command.empty())
+      continue;
+    int result = CompileBatchCommand(command, dxcSupport, pIncludeCache);
+    fflush(stderr);
+    printf("dxc-daemon: exit %d\n", result);
+    fflush(stdout);
+  }
+  return 0;
+}
+
 int __cdecl wmain(int argc, const wchar_t **argv_) {
   const char *pStage = "Operation";
   int retVal = 0;
@@ -1131,7 +1895,19 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
     }
 
     // TODO: implement all other actions.
-    if (!dxcOpts.Preprocess.empty()) {
+    if (!dxcOpts.BatchFile.empty()) {
+      pStage = "Batch compilation";
+      retVal = BatchCompile(dxcOpts, dxcSupport);
+    }
+    else if (dxcOpts.Daemon) {
+      pStage = "Daemon";
+      retVal = RunDaemon(dxcSupport);
+    }
+    else if (dxcOpts.RemoteServer) {
+      pStage = "Remote compilation";
+      retVal = RunRemoteJob(dxcOpts, dxcSupport);
+    }
+    else if (!dxcOpts.Preprocess.empty()) {
       pStage = "Preprocessing";
       context.Preprocess();
     }
@@ -16,6 +16,7 @@
 #include "dxc/Support/HLSLOptions.h"
 #include "dxcetw.h"
 #include "dxillib.h"
+#include <mutex>
 
 namespace hlsl { HRESULT SetupRegistryPassForHLSL(); }
 
@@ -51,12 +52,7 @@ static HRESULT InitMaybeFail() throw() {
     goto Cleanup;
   }
   fsSetup = true;
-  IFC(hlsl::SetupRegistryPassForHLSL());
   IFC(DxilLibInitialize());
-  if (hlsl::options::initHlslOptTable()) {
-    hr = E_FAIL;
-    goto Cleanup;
-  }
 Cleanup:
   if (FAILED(hr)) {
     if (fsSetup) {
@@ -73,6 +69,30 @@ Cleanup:
   return hr;
 }
 
+static std::mutex g_CompilerGlobalsLock;
+static bool g_CompilerGlobalsReady = false;
+
+// Registering every pass and building the option table is only needed by
+// objects that parse arguments or run passes, so it is done when the first
+// of them is created rather than when the DLL loads. Processes that only
+// read containers or reflection never pay for it.
+HRESULT DxcInitCompilerGlobals() throw() {
+  try {
+    std::lock_guard<std::mutex> lock(g_CompilerGlobalsLock);
+    if (g_CompilerGlobalsReady)
+      return S_OK;
+    // The globals outlive the objects of the caller's allocator.
+    DxcThreadMalloc TM(nullptr);
+    IFR(hlsl::SetupRegistryPassForHLSL());
+    if (hlsl::options::getHlslOptTable() == nullptr &&
+        hlsl::options::initHlslOptTable())
+      return E_FAIL;
+    g_CompilerGlobalsReady = true;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD Reason, LPVOID reserved) {
   BOOL result = TRUE;
   if (Reason == DLL_PROCESS_ATTACH) {
@@ -21,6 +21,8 @@
 #include <memory>
 
 HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcCompilerSession(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcCompilerAsync(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcDiaDataSource(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcIntelliSense(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcLibrary(_In_ REFIID riid, _Out_ LPVOID *ppv);
@@ -30,6 +32,22 @@ HRESULT CreateDxcAssembler(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcOptimizer(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcContainerBuilder(_In_ REFIID riid, _Out_ LPVOID *ppv);
 HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcSpecializer(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcStageLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcIncludeCache(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcArenaMalloc(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT DxcInitCompilerGlobals() throw();
+
+// Objects that never parse arguments or run passes, which can be created
+// before the compiler globals are set up.
+static bool NeedsCompilerGlobals(REFCLSID rclsid) {
+  return !IsEqualCLSID(rclsid, CLSID_DxcLibrary) &&
+         !IsEqualCLSID(rclsid, CLSID_DxcContainerReflection) &&
+         !IsEqualCLSID(rclsid, CLSID_DxcContainerBuilder) &&
+         !IsEqualCLSID(rclsid, CLSID_DxcDiaDataSource) &&
+         !IsEqualCLSID(rclsid, CLSID_DxcIncludeCache) &&
+         !IsEqualCLSID(rclsid, CLSID_DxcArenaMalloc);
+}
 
 namespace hlsl {
 void CreateDxcContainerReflection(IDxcContainerReflection **ppResult);
@@ -53,6 +71,8 @@ static HRESULT ThreadMallocDxcCreateInstance(
                   _Out_ LPVOID   *ppv) {
   HRESULT hr = S_OK;
   *ppv = nullptr;
+  if (NeedsCompilerGlobals(rclsid))
+    IFR(DxcInitCompilerGlobals());
   if (IsEqualCLSID(rclsid, CLSID_DxcIntelliSense)) {
     hr = CreateDxcIntelliSense(riid, ppv);
   }
@@ -62,6 +82,12 @@ static HRESULT ThreadMallocDxcCreateInstance(
   else if (IsEqualCLSID(rclsid, CLSID_DxcCompiler)) {
     hr = CreateDxcCompiler(riid, ppv);
   }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcCompilerSession)) {
+    hr = CreateDxcCompilerSession(riid, ppv);
+  }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcCompilerAsync)) {
+    hr = CreateDxcCompilerAsync(riid, ppv);
+  }
   else if (IsEqualCLSID(rclsid, CLSID_DxcLibrary)) {
     hr = CreateDxcLibrary(riid, ppv);
   }
@@ -90,6 +116,18 @@ static HRESULT ThreadMallocDxcCreateInstance(
   else if (IsEqualCLSID(rclsid, CLSID_DxcContainerBuilder)) {
     hr = CreateDxcContainerBuilder(riid, ppv);
   }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcSpecializer)) {
+    hr = CreateDxcSpecializer(riid, ppv);
+  }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcStageLinker)) {
+    hr = CreateDxcStageLinker(riid, ppv);
+  }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcIncludeCache)) {
+    hr = CreateDxcIncludeCache(riid, ppv);
+  }
+  else if (IsEqualCLSID(rclsid, CLSID_DxcArenaMalloc)) {
+    hr = CreateDxcArenaMalloc(riid, ppv);
+  }
   else {
     hr = REGDB_E_CLASSNOTREG;
   }
@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcarenamalloc.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements an IMalloc that allocates from arenas freed all at once.       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+#include <algorithm>
+#include <mutex>
+
+namespace {
+
+// Blocks are carved out of arenas taken from the underlying allocator, each
+// one preceded by a header holding its size. Freeing a block only returns its
+// space when it is the last one carved from the current arena.
+//
+// Nothing here may allocate through operator new: the allocator is usually
+// the thread allocator that operator new forwards to.
+class DxcArenaMalloc : public IDxcArenaMalloc {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+  static const SIZE_T kAlignment = 16;
+  static const SIZE_T kArenaSize = 1024 * 1024;
+  // Larger blocks get an arena of their own.
+  static const SIZE_T kMaxArenaBlockSize = kArenaSize / 4;
+
+  struct Arena {
+    Arena *pNext;
+    SIZE_T Size; // Bytes following the header.
+  };
+  struct BlockHeader {
+    SIZE_T Size;
+  };
+  static const SIZE_T kArenaHeaderSize =
+      (sizeof(Arena) + kAlignment - 1) & ~(kAlignment - 1);
+  static const SIZE_T kBlockHeaderSize =
+      (sizeof(BlockHeader) + kAlignment - 1) & ~(kAlignment - 1);
+
+  std::mutex m_lock;
+  Arena *m_pArenas;     // All arenas, most recently taken first.
+  char *m_pNext;        // Next free byte in the current arena.
+  char *m_pEnd;         // End of the current arena.
+  char *m_pLastBlock;   // Last block carved from the current arena.
+  UINT64 m_liveBytes;
+  UINT64 m_peakBytes;
+  UINT64 m_arenaBytes;
+
+  static SIZE_T AlignSize(SIZE_T cb) {
+    return (cb + kAlignment - 1) & ~(kAlignment - 1);
+  }
+  static BlockHeader *GetHeader(void *pv) {
+    return reinterpret_cast<BlockHeader *>((char *)pv - kBlockHeaderSize);
+  }
+  static char *GetArenaStart(Arena *pArena) {
+    return (char *)pArena + kArenaHeaderSize;
+  }
+
+  Arena *TakeArena(SIZE_T size) {
+    Arena *pArena = (Arena *)m_pMalloc->Alloc(kArenaHeaderSize + size);
+    if (pArena == nullptr)
+      return nullptr;
+    pArena->pNext = m_pArenas;
+    pArena->Size = size;
+    m_pArenas = pArena;
+    m_arenaBytes += kArenaHeaderSize + size;
+    return pArena;
+  }
+
+  void *AllocLocked(SIZE_T cb) {
+    SIZE_T blockSize = kBlockHeaderSize + AlignSize(cb);
+    if (blockSize < cb)
+      return nullptr; // Overflow.
+    char *pBlock;
+    if (blockSize > kMaxArenaBlockSize) {
+      // The current arena stays current for the smaller blocks.
+      Arena *pArena = TakeArena(blockSize);
+      if (pArena == nullptr)
+        return nullptr;
+      pBlock = GetArenaStart(pArena);
+    } else {
+      if ((SIZE_T)(m_pEnd - m_pNext) < blockSize) {
+        Arena *pArena = TakeArena(kArenaSize);
+        if (pArena == nullptr)
+          return nullptr;
+        m_pNext = GetArenaStart(pArena);
+        m_pEnd = m_pNext + kArenaSize;
+      }
+      pBlock = m_pNext;
+      m_pNext += blockSize;
+      m_pLastBlock = pBlock;
+    }
+    BlockHeader *pHeader = (BlockHeader *)pBlock;
+    pHeader->Size = cb;
+    m_liveBytes += cb;
+    m_peakBytes = std::max(m_peakBytes, m_liveBytes);
+    return pBlock + kBlockHeaderSize;
+  }
+
+  void FreeLocked(void *pv) {
+    BlockHeader *pHeader = GetHeader(pv);
+    m_liveBytes -= pHeader->Size;
+    if ((char *)pHeader == m_pLastBlock) {
+      m_pNext = m_pLastBlock;
+      m_pLastBlock = nullptr;
+    }
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcArenaMalloc)
+
+  DxcArenaMalloc(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_pArenas(nullptr), m_pNext(nullptr),
+        m_pEnd(nullptr), m_pLastBlock(nullptr), m_liveBytes(0),
+        m_peakBytes(0), m_arenaBytes(0) {}
+
+  ~DxcArenaMalloc() {
+    Arena *pArena = m_pArenas;
+    while (pArena != nullptr) {
+      Arena *pNext = pArena->pNext;
+      m_pMalloc->Free(pArena);
+      pArena = pNext;
+    }
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcArenaMalloc, IMalloc>(this, iid,
+                                                           ppvObject);
+  }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return AllocLocked(cb);
+  }
+
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    if (pv == nullptr)
+      return Alloc(cb);
+    if (cb == 0) {
+      Free(pv);
+      return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(m_lock);
+    BlockHeader *pHeader = GetHeader(pv);
+    SIZE_T priorSize = pHeader->Size;
+    // Grow or shrink the last block in place when it fits.
+    if ((char *)pHeader == m_pLastBlock) {
+      SIZE_T blockSize = kBlockHeaderSize + AlignSize(cb);
+      if (blockSize >= cb &&
+          (SIZE_T)(m_pEnd - m_pLastBlock) >= blockSize) {
+        m_pNext = m_pLastBlock + blockSize;
+        pHeader->Size = cb;
+        m_liveBytes = m_liveBytes - priorSize + cb;
+        m_peakBytes = std::max(m_peakBytes, m_liveBytes);
+        return pv;
+      }
+    } else if (cb <= priorSize) {
+      m_liveBytes -= priorSize - cb;
+      pHeader->Size = cb;
+      return pv;
+    }
+    void *pResult = AllocLocked(cb);
+    if (pResult == nullptr)
+      return nullptr;
+    memcpy(pResult, pv, std::min(priorSize, cb));
+    FreeLocked(pv);
+    return pResult;
+  }
+
+  void STDMETHODCALLTYPE Free(void *pv) override {
+    if (pv == nullptr)
+      return;
+    std::lock_guard<std::mutex> lock(m_lock);
+    FreeLocked(pv);
+  }
+
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override {
+    if (pv == nullptr)
+      return (SIZE_T)-1;
+    std::lock_guard<std::mutex> lock(m_lock);
+    return GetHeader(pv)->Size;
+  }
+
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override {
+    if (pv == nullptr)
+      return -1;
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (Arena *pArena = m_pArenas; pArena != nullptr; pArena = pArena->pNext) {
+      char *pBytes = GetArenaStart(pArena);
+      if ((char *)pv >= pBytes && (char *)pv < pBytes + pArena->Size)
+        return 1;
+    }
+    return 0;
+  }
+
+  void STDMETHODCALLTYPE HeapMinimize() override {}
+
+  HRESULT STDMETHODCALLTYPE GetPeakBytes(_Out_ UINT64 *pPeakBytes) override {
+    if (pPeakBytes == nullptr)
+      return E_POINTER;
+    std::lock_guard<std::mutex> lock(m_lock);
+    *pPeakBytes = m_peakBytes;
+    return S_OK;
+  }
+
+  HRESULT STDMETHODCALLTYPE GetArenaBytes(_Out_ UINT64 *pArenaBytes) override {
+    if (pArenaBytes == nullptr)
+      return E_POINTER;
+    std::lock_guard<std::mutex> lock(m_lock);
+    *pArenaBytes = m_arenaBytes;
+    return S_OK;
+  }
+};
+
+} // namespace
+
+HRESULT CreateDxcArenaMalloc(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  CComPtr<DxcArenaMalloc> result =
+      DxcArenaMalloc::Alloc(DxcGetThreadMallocNoRef());
+  if (result == nullptr) {
+    *ppv = nullptr;
+    return E_OUTOFMEMORY;
+  }
+
+  return result.p->QueryInterface(riid, ppv);
+}
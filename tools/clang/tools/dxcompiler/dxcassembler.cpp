@@ -16,6 +16,7 @@
 #include "dxc/HLSL/DxilContainer.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxcModuleHandle.h"
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxillib.h"
 #include "dxcutil.h"
@@ -25,6 +26,10 @@
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
 
 using namespace llvm;
 using namespace hlsl;
@@ -32,7 +37,7 @@ using namespace hlsl;
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
-class DxcAssembler : public IDxcAssembler {
+class DxcAssembler : public IDxcAssembler2 {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()      
 public:
@@ -40,7 +45,8 @@ public:
   DXC_MICROCOM_TM_CTOR(DxcAssembler)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcAssembler>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcAssembler2, IDxcAssembler>(this, iid,
+                                                                ppvObject);
   }
 
   // Assemble dxil in ll or llvm bitcode to dxbc container.
@@ -48,6 +54,12 @@ public:
       _In_ IDxcBlob *pShader, // Shader to assemble.
       _COM_Outptr_ IDxcOperationResult **ppResult // Assemble output status, buffer, and errors
       );
+
+  // Assemble a live dxil module to a validated dxbc container.
+  __override HRESULT STDMETHODCALLTYPE AssembleAndValidateModule(
+      _In_ IDxcModuleHandle *pModule, // Module to assemble.
+      _COM_Outptr_ IDxcOperationResult **ppResult // Assemble output status, buffer, and errors
+      );
 };
 
 // Assemble dxil in ll or llvm bitcode to dxbc container.
@@ -106,6 +118,10 @@ HRESULT STDMETHODCALLTYPE DxcAssembler::AssembleToContainer(
       return S_OK;
     }
 
+    // Bitcode input is the program bitcode as it is, unless the validator
+    // version has to be upgraded, which saves writing the module again.
+    bool bWriteBitcode = bytesAreText || !isRawBitcode(pBytes, pBytes + bytesLen);
+
     // Upgrade Validator Version if necessary.
     try {
       DxilModule &program = M->GetOrCreateDxilModule();
@@ -115,6 +131,7 @@ HRESULT STDMETHODCALLTYPE DxcAssembler::AssembleToContainer(
         dxcutil::GetValidatorVersion(&majorVer, &minorVer);
         if (program.UpgradeValidatorVersion(majorVer, minorVer)) {
           program.UpdateValidatorVersionMetadata();
+          bWriteBitcode = true;
         }
       }
     } catch (hlsl::Exception &e) {
@@ -126,8 +143,13 @@ HRESULT STDMETHODCALLTYPE DxcAssembler::AssembleToContainer(
       return S_OK;
     }
     // Create bitcode of M.
-    WriteBitcodeToFile(M.get(), outStream);
-    outStream.flush();
+    if (bWriteBitcode) {
+      WriteBitcodeToFile(M.get(), outStream);
+      outStream.flush();
+    } else {
+      ULONG cbWritten;
+      IFT(pOutputStream->Write(pBytes, bytesLen, &cbWritten));
+    }
 
     CComPtr<IDxcBlob> pResultBlob;
     dxcutil::AssembleToContainer(std::move(M), pResultBlob,
@@ -141,6 +163,85 @@ HRESULT STDMETHODCALLTYPE DxcAssembler::AssembleToContainer(
   return hr;
 }
 
+// Assemble a live dxil module to a validated dxbc container.
+HRESULT STDMETHODCALLTYPE DxcAssembler::AssembleAndValidateModule(
+    _In_ IDxcModuleHandle *pModule, // Module to assemble.
+    _COM_Outptr_ IDxcOperationResult **ppResult // Assemble output status, buffer, and errors
+    ) {
+  if (pModule == nullptr || ppResult == nullptr)
+    return E_POINTER;
+
+  *ppResult = nullptr;
+  llvm::Module *pLiveModule = GetDxcModuleHandleModule(pModule);
+  if (pLiveModule == nullptr)
+    return E_INVALIDARG;
+
+  HRESULT hr = S_OK;
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    // Serializing the container strips the module, so assemble a copy. The
+    // copy is made on the handle's context, without going through bitcode.
+    std::unique_ptr<Module> M(llvm::CloneModule(pLiveModule));
+    bool bDebugInfo = M->getNamedMetadata("llvm.dbg.cu") != nullptr;
+
+    // Upgrade Validator Version if necessary.
+    try {
+      DxilModule &program = M->GetOrCreateDxilModule();
+
+      {
+        UINT32 majorVer, minorVer;
+        dxcutil::GetValidatorVersion(&majorVer, &minorVer);
+        if (program.UpgradeValidatorVersion(majorVer, minorVer)) {
+          program.UpdateValidatorVersionMetadata();
+        }
+      }
+    } catch (hlsl::Exception &e) {
+      CComPtr<IDxcBlobEncoding> pErrorBlob;
+      IFT(DxcCreateBlobWithEncodingOnHeapCopy(e.msg.c_str(), e.msg.size(),
+                                              CP_UTF8, &pErrorBlob));
+      IFT(DxcOperationResult::CreateFromResultErrorStatus(nullptr, pErrorBlob,
+                                                          e.hr, ppResult));
+      return S_OK;
+    }
+
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    IFT(CreateMemoryStream(TM.p, &pOutputStream));
+    raw_stream_ostream outStream(pOutputStream.p);
+    // Create bitcode of M.
+    WriteBitcodeToFile(M.get(), outStream);
+    outStream.flush();
+
+    CComPtr<AbstractMemoryStream> pDiagStream;
+    IFT(CreateMemoryStream(TM.p, &pDiagStream));
+    raw_stream_ostream DiagStream(pDiagStream);
+    const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
+        new clang::DiagnosticIDs);
+    IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+        new clang::DiagnosticOptions();
+    // Construct our diagnostic client.
+    clang::TextDiagnosticPrinter *DiagClient =
+        new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
+    clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
+
+    SerializeDxilFlags SerializeFlags = SerializeDxilFlags::IncludeDebugNamePart;
+    if (bDebugInfo)
+      SerializeFlags |= SerializeDxilFlags::IncludeDebugInfoPart;
+    CComPtr<IDxcBlob> pResultBlob;
+    HRESULT valHR = dxcutil::ValidateAndAssembleToContainer(
+        std::move(M), pResultBlob, TM.p, SerializeFlags, pOutputStream,
+        bDebugInfo, Diag);
+    DiagStream.flush();
+
+    CComPtr<IStream> pErrorStream = pDiagStream;
+    dxcutil::CreateOperationResultFromOutputs(
+        pResultBlob, pErrorStream, "",
+        FAILED(valHR) || Diag.hasErrorOccurred(), ppResult);
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+
+  return hr;
+}
+
 HRESULT CreateDxcAssembler(_In_ REFIID riid, _Out_ LPVOID *ppv) {
   CComPtr<DxcAssembler> result = DxcAssembler::Alloc(DxcGetThreadMallocNoRef());
   if (result == nullptr) {
@@ -0,0 +1,362 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a persistent, content-addressed cache of compilation results.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/HLSL/DxilContainer.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/dxcapi.impl.h"
+#include "dxc/Support/dxcfilesystem.h"
+#include "dxccompilecache.h"
+#include "dxcutil.h"
+#include "llvm/ADT/ArrayRef.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Bump kCacheEntryVersion whenever the entry layout or the key changes.
+static const uint32_t kCacheEntryMagic = DXIL_FOURCC('D', 'X', 'C', 'C');
+static const uint32_t kCacheEntryVersion = 1;
+static const wchar_t kCacheEntryExt[] = L".dxcc";
+
+void HashBlob(MD5::MD5Result &result, IDxcBlob *pBlob) {
+  MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)pBlob->GetBufferPointer(),
+                               pBlob->GetBufferSize()));
+  md5.final(result);
+}
+
+void HashWide(MD5 &md5, LPCWSTR pValue) {
+  // Values are hashed with their terminator, so that "ab","c" and "a","bc"
+  // produce different keys; null values hash differently from empty ones.
+  if (pValue == nullptr) {
+    md5.update(StringRef("N", 1));
+    return;
+  }
+  md5.update(StringRef("S", 1));
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)pValue,
+                               (wcslen(pValue) + 1) * sizeof(wchar_t)));
+}
+
+void HashUInt(MD5 &md5, uint32_t value) {
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)&value, sizeof(value)));
+}
+
+/// Serializes an entry into a flat buffer.
+class EntryWriter {
+  std::string m_data;
+
+public:
+  void WriteUInt(uint32_t value) {
+    m_data.append((const char *)&value, sizeof(value));
+  }
+  void WriteBytes(const void *pData, size_t size) {
+    WriteUInt((uint32_t)size);
+    m_data.append((const char *)pData, size);
+  }
+  void WriteBlob(IDxcBlob *pBlob) {
+    if (pBlob == nullptr)
+      WriteBytes(nullptr, 0);
+    else
+      WriteBytes(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+  }
+  void WriteWide(LPCWSTR pValue) {
+    WriteBytes(pValue, pValue ? wcslen(pValue) * sizeof(wchar_t) : 0);
+  }
+  const std::string &GetData() const { return m_data; }
+};
+
+/// Reads an entry written by EntryWriter; any inconsistency is reported by
+/// returning false, in which case the entry is treated as a miss.
+class EntryReader {
+  const uint8_t *m_pCur;
+  const uint8_t *m_pEnd;
+
+public:
+  EntryReader(const void *pData, size_t size)
+      : m_pCur((const uint8_t *)pData), m_pEnd(m_pCur + size) {}
+  bool ReadUInt(uint32_t &value) {
+    if ((size_t)(m_pEnd - m_pCur) < sizeof(value))
+      return false;
+    memcpy(&value, m_pCur, sizeof(value));
+    m_pCur += sizeof(value);
+    return true;
+  }
+  bool ReadBytes(ArrayRef<uint8_t> &value) {
+    uint32_t size;
+    if (!ReadUInt(size) || (size_t)(m_pEnd - m_pCur) < size)
+      return false;
+    value = ArrayRef<uint8_t>(m_pCur, size);
+    m_pCur += size;
+    return true;
+  }
+  bool ReadWide(std::wstring &value) {
+    ArrayRef<uint8_t> bytes;
+    if (!ReadBytes(bytes) || (bytes.size() % sizeof(wchar_t)) != 0)
+      return false;
+    value.assign((const wchar_t *)bytes.data(), bytes.size() / sizeof(wchar_t));
+    return true;
+  }
+  bool AtEnd() const { return m_pCur == m_pEnd; }
+};
+
+struct CacheFileInfo {
+  std::wstring Name;
+  FILETIME LastWrite;
+  uint64_t Size;
+};
+
+} // namespace
+
+namespace dxcutil {
+
+DxcCompileCache::DxcCompileCache(llvm::StringRef dir, unsigned maxSizeInMB)
+    : m_dir(Unicode::UTF8ToUTF16StringOrThrow(dir.str().c_str())),
+      m_maxSize((uint64_t)maxSizeInMB * 1024 * 1024) {
+  if (!m_dir.empty() && m_dir.back() != L'\\' && m_dir.back() != L'/')
+    m_dir += L'\\';
+}
+
+void DxcCompileCache::ComputeKey(IDxcBlob *pUtf8Source, LPCWSTR pEntryPoint,
+                                 LPCWSTR pTargetProfile, LPCWSTR *pArguments,
+                                 UINT32 argCount, const DxcDefine *pDefines,
+                                 UINT32 defineCount, bool debugBlobRequested) {
+  UINT32 valMajor, valMinor;
+  dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+
+  MD5 md5;
+  HashUInt(md5, kCacheEntryVersion);
+  HashUInt(md5, DXIL::kDxilMajor);
+  HashUInt(md5, DXIL::kDxilMinor);
+  HashUInt(md5, valMajor);
+  HashUInt(md5, valMinor);
+  HashUInt(md5, debugBlobRequested ? 1 : 0);
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)pUtf8Source->GetBufferPointer(),
+                               pUtf8Source->GetBufferSize()));
+  HashWide(md5, pEntryPoint);
+  HashWide(md5, pTargetProfile);
+  HashUInt(md5, argCount);
+  for (UINT32 i = 0; i < argCount; ++i)
+    HashWide(md5, pArguments[i]);
+  HashUInt(md5, defineCount);
+  for (UINT32 i = 0; i < defineCount; ++i) {
+    HashWide(md5, pDefines[i].Name);
+    HashWide(md5, pDefines[i].Value);
+  }
+
+  MD5::MD5Result result;
+  md5.final(result);
+  MD5::stringifyResult(result, m_key);
+}
+
+std::wstring DxcCompileCache::GetEntryPath() const {
+  DXASSERT(!m_key.empty(), "else ComputeKey was not called");
+  std::wstring path(m_dir);
+  path.append(m_key.begin(), m_key.end());
+  path += kCacheEntryExt;
+  return path;
+}
+
+bool DxcCompileCache::Lookup(IDxcIncludeHandler *pIncludeHandler,
+                             IDxcOperationResult **ppResult,
+                             LPWSTR *ppDebugBlobName, IDxcBlob **ppDebugBlob,
+                             std::vector<std::wstring> *pIncludedFiles) {
+  *ppResult = nullptr;
+  try {
+    std::wstring path = GetEntryPath();
+    if (GetFileAttributesW(path.c_str()) == INVALID_FILE_ATTRIBUTES)
+      return false;
+
+    CDxcMallocHeapPtr<char> pData(DxcGetThreadMallocNoRef());
+    DWORD dataSize;
+    ReadBinaryFile(DxcGetThreadMallocNoRef(), path.c_str(),
+                   (void **)&pData.m_pData, &dataSize);
+
+    EntryReader reader(pData.m_pData, dataSize);
+    uint32_t magic, version, depCount;
+    if (!reader.ReadUInt(magic) || magic != kCacheEntryMagic ||
+        !reader.ReadUInt(version) || version != kCacheEntryVersion ||
+        !reader.ReadUInt(depCount))
+      return false;
+
+    // Every include must still resolve to the same contents.
+    std::vector<std::wstring> depNames;
+    for (uint32_t i = 0; i < depCount; ++i) {
+      std::wstring depName;
+      ArrayRef<uint8_t> depHash;
+      if (!reader.ReadWide(depName) || !reader.ReadBytes(depHash) ||
+          depHash.size() != sizeof(MD5::MD5Result))
+        return false;
+      if (pIncludeHandler == nullptr)
+        return false;
+      CComPtr<IDxcBlob> pDepBlob;
+      CComPtr<IDxcBlobEncoding> pDepUtf8;
+      if (FAILED(pIncludeHandler->LoadSource(depName.c_str(), &pDepBlob)) ||
+          pDepBlob == nullptr ||
+          FAILED(hlsl::DxcGetBlobAsUtf8(pDepBlob, &pDepUtf8)))
+        return false;
+      MD5::MD5Result depResult;
+      HashBlob(depResult, pDepUtf8);
+      if (0 != memcmp(depResult, depHash.data(), sizeof(depResult)))
+        return false;
+      depNames.emplace_back(std::move(depName));
+    }
+
+    ArrayRef<uint8_t> resultBytes, errorBytes, debugBytes;
+    std::wstring debugName;
+    if (!reader.ReadBytes(resultBytes) || !reader.ReadBytes(errorBytes) ||
+        !reader.ReadBytes(debugBytes) || !reader.ReadWide(debugName) ||
+        !reader.AtEnd())
+      return false;
+
+    CComPtr<IDxcBlob> pResultBlob;
+    CComPtr<IDxcBlobEncoding> pErrorBlob;
+    CComPtr<IDxcBlob> pDebugBlob;
+    CComHeapPtr<wchar_t> pDebugName;
+    IFT(DxcCreateBlobOnHeapCopy(resultBytes.data(), resultBytes.size(),
+                                &pResultBlob));
+    IFT(DxcCreateBlobWithEncodingOnHeapCopy(errorBytes.data(),
+                                            errorBytes.size(), CP_UTF8,
+                                            &pErrorBlob));
+    if (ppDebugBlob && !debugBytes.empty()) {
+      IFT(DxcCreateBlobOnHeapCopy(debugBytes.data(), debugBytes.size(),
+                                  &pDebugBlob));
+    }
+    if (ppDebugBlobName && !debugName.empty()) {
+      IFTBOOL(pDebugName.Allocate(debugName.size() + 1), E_OUTOFMEMORY);
+      memcpy(pDebugName.m_pData, debugName.c_str(),
+             (debugName.size() + 1) * sizeof(wchar_t));
+    }
+    IFT(DxcOperationResult::CreateFromResultErrorStatus(pResultBlob, pErrorBlob,
+                                                        S_OK, ppResult));
+
+    // After assigning ppResult, nothing should fail.
+    if (pIncludedFiles)
+      pIncludedFiles->swap(depNames);
+    if (ppDebugBlob)
+      *ppDebugBlob = pDebugBlob.Detach();
+    if (ppDebugBlobName)
+      *ppDebugBlobName = pDebugName.Detach();
+    return true;
+  } catch (...) {
+    if (*ppResult) {
+      (*ppResult)->Release();
+      *ppResult = nullptr;
+    }
+    return false;
+  }
+}
+
+void DxcCompileCache::Store(DxcArgsFileSystem *msf,
+                            IDxcOperationResult *pResult,
+                            LPCWSTR pDebugBlobName, IDxcBlob *pDebugBlob) {
+  try {
+    CComPtr<IDxcBlob> pResultBlob;
+    CComPtr<IDxcBlobEncoding> pErrorBlob;
+    IFT(pResult->GetResult(&pResultBlob));
+    IFT(pResult->GetErrorBuffer(&pErrorBlob));
+    if (pResultBlob == nullptr)
+      return;
+
+    EntryWriter writer;
+    writer.WriteUInt(kCacheEntryMagic);
+    writer.WriteUInt(kCacheEntryVersion);
+
+    // The main source file is part of the key already.
+    unsigned fileCount = msf->GetIncludedFileCount();
+    writer.WriteUInt(fileCount - 1);
+    for (unsigned i = 1; i < fileCount; ++i) {
+      LPCWSTR pName;
+      CComPtr<IDxcBlob> pFileBlob;
+      msf->GetIncludedFile(i, &pName, &pFileBlob);
+      MD5::MD5Result fileHash;
+      HashBlob(fileHash, pFileBlob);
+      writer.WriteWide(pName);
+      writer.WriteBytes(fileHash, sizeof(fileHash));
+    }
+    writer.WriteBlob(pResultBlob);
+    writer.WriteBlob(pErrorBlob);
+    writer.WriteBlob(pDebugBlob);
+    writer.WriteWide(pDebugBlobName);
+
+    const std::string &data = writer.GetData();
+    if (data.size() > m_maxSize)
+      return;
+
+    // Write to a unique name first so that concurrent compilers never observe
+    // a partially-written entry.
+    std::wstring path = GetEntryPath();
+    std::wstring tempPath(path);
+    tempPath += L".";
+    tempPath += std::to_wstring(GetCurrentProcessId());
+    tempPath += L".";
+    tempPath += std::to_wstring(GetCurrentThreadId());
+    CreateDirectoryW(m_dir.c_str(), nullptr);
+    WriteBinaryFile(tempPath.c_str(), data.data(), (DWORD)data.size());
+    if (!MoveFileExW(tempPath.c_str(), path.c_str(),
+                     MOVEFILE_REPLACE_EXISTING)) {
+      DeleteFileW(tempPath.c_str());
+      return;
+    }
+
+    TrimToMaxSize();
+  } catch (...) {
+    // The cache is an optimization only; the compilation has succeeded.
+  }
+}
+
+void DxcCompileCache::TrimToMaxSize() {
+  std::wstring pattern(m_dir);
+  pattern += L"*";
+  pattern += kCacheEntryExt;
+
+  std::vector<CacheFileInfo> files;
+  uint64_t totalSize = 0;
+  WIN32_FIND_DATAW findData;
+  HANDLE hFind = FindFirstFileW(pattern.c_str(), &findData);
+  if (hFind == INVALID_HANDLE_VALUE)
+    return;
+  do {
+    if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      continue;
+    CacheFileInfo info;
+    info.Name = findData.cFileName;
+    info.LastWrite = findData.ftLastWriteTime;
+    info.Size = ((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+    totalSize += info.Size;
+    files.emplace_back(std::move(info));
+  } while (FindNextFileW(hFind, &findData));
+  FindClose(hFind);
+
+  if (totalSize <= m_maxSize)
+    return;
+
+  // Evict oldest entries first.
+  std::sort(files.begin(), files.end(),
+            [](const CacheFileInfo &a, const CacheFileInfo &b) {
+              return CompareFileTime(&a.LastWrite, &b.LastWrite) < 0;
+            });
+  for (const CacheFileInfo &info : files) {
+    if (totalSize <= m_maxSize)
+      break;
+    std::wstring path(m_dir);
+    path += info.Name;
+    if (DeleteFileW(path.c_str()))
+      totalSize -= info.Size;
+  }
+}
+
+} // namespace dxcutil
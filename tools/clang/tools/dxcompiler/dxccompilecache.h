@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a persistent, content-addressed cache of compilation results.    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/microcom.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include <string>
+#include <vector>
+
+namespace dxcutil {
+
+class DxcArgsFileSystem;
+
+/// Opt-in on-disk cache of compilation results (-cache-dir).
+///
+/// An entry is keyed on the hash of everything passed to the compiler (source
+/// text, entry point, profile, arguments, defines and validator version).
+/// The entry itself records the name and hash of every included file seen
+/// during the original compilation; a lookup only hits if the include handler
+/// still returns the same contents for each of them. This is the same
+/// approach that ccache uses in its direct mode, and avoids having to run the
+/// preprocessor to compute a key.
+///
+/// The cache does not try to detect a change of compiler binary; the cache
+/// directory should be cleared when the compiler is updated.
+class DxcCompileCache {
+private:
+  std::wstring m_dir;
+  uint64_t m_maxSize;
+  llvm::SmallString<32> m_key;
+
+  std::wstring GetEntryPath() const;
+  void TrimToMaxSize();
+
+public:
+  DxcCompileCache(llvm::StringRef dir, unsigned maxSizeInMB);
+
+  void ComputeKey(_In_ IDxcBlob *pUtf8Source, _In_ LPCWSTR pEntryPoint,
+                  _In_ LPCWSTR pTargetProfile,
+                  _In_count_(argCount) LPCWSTR *pArguments, UINT32 argCount,
+                  _In_count_(defineCount) const DxcDefine *pDefines,
+                  UINT32 defineCount, bool debugBlobRequested);
+
+  /// Returns true and sets up the outputs if a matching entry is found.
+  /// Failures to read the cache are treated as misses. The names of the
+  /// files the entry's compilation included go to pIncludedFiles.
+  bool Lookup(_In_opt_ IDxcIncludeHandler *pIncludeHandler,
+              _COM_Outptr_ IDxcOperationResult **ppResult,
+              _Outptr_opt_result_z_ LPWSTR *ppDebugBlobName,
+              _COM_Outptr_opt_ IDxcBlob **ppDebugBlob,
+              _Out_opt_ std::vector<std::wstring> *pIncludedFiles = nullptr);
+
+  /// Records a successful compilation. Failures to write are ignored.
+  void Store(_In_ DxcArgsFileSystem *msf, _In_ IDxcOperationResult *pResult,
+             _In_opt_ LPCWSTR pDebugBlobName, _In_opt_ IDxcBlob *pDebugBlob);
+};
+
+} // namespace dxcutil
@@ -0,0 +1,370 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilerasync.cpp                                                      //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements a compiler that runs queued compiles on worker threads.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/dxcapi.h"
+#include "llvm/Support/Cancellation.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+HRESULT CreateDxcCompilerSession(_In_ REFIID riid, _Out_ LPVOID *ppv);
+
+namespace {
+
+// A queued compile, with copies of the caller's arguments.
+struct CompileRequest {
+  UINT64 Id;
+  CComPtr<IDxcBlob> Source;
+  bool HasSourceName;
+  std::wstring SourceName;
+  std::wstring EntryPoint;
+  std::wstring TargetProfile;
+  std::vector<std::wstring> Arguments;
+  std::vector<std::wstring> DefineNames;
+  std::vector<std::wstring> DefineValues;
+  std::vector<bool> DefineHasValue;
+  CComPtr<IDxcIncludeHandler> IncludeHandler;
+  CComPtr<IDxcCompletionCallback> Callback;
+  // Set by Cancel once the request has started.
+  std::atomic<bool> Cancelled{false};
+};
+
+// Stops the compile of a request at its next cancellation point once the
+// request is cancelled.
+class RequestCancellationCheck : public llvm::CancellationCheck {
+  const std::atomic<bool> &m_cancelled;
+
+public:
+  RequestCancellationCheck(const std::atomic<bool> &cancelled)
+      : m_cancelled(cancelled) {}
+  bool isCancelled() override { return m_cancelled.load(); }
+};
+
+struct CompletedRequest {
+  HRESULT Status;
+  CComPtr<IDxcOperationResult> Result;
+};
+
+// The queue and workers behind a DxcCompilerAsync. Each worker keeps the
+// scheduler alive, so the compiler object may be released from a completion
+// callback. The workers share one free-threaded compiler session, which keeps
+// the validator and LLVM contexts from one compile to the next, and at most
+// one worker per hardware thread is started.
+class CompileScheduler
+    : public std::enable_shared_from_this<CompileScheduler> {
+public:
+  CompileScheduler(IMalloc *pMalloc)
+      : m_pMalloc(pMalloc),
+        m_maxWorkers(std::max(1u, std::thread::hardware_concurrency())) {}
+
+  UINT64 Submit(std::unique_ptr<CompileRequest> pRequest, UINT32 priority) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    UINT64 id = m_nextId++;
+    pRequest->Id = id;
+    if (pRequest->Callback == nullptr)
+      m_waitable.insert(id);
+    if (priority > DxcCompilePriority_Interactive)
+      priority = DxcCompilePriority_Interactive;
+    m_queue[QueueKey(DxcCompilePriority_Interactive - priority, id)] =
+        std::move(pRequest);
+    if (m_idleWorkers == 0 && m_workers.size() < m_maxWorkers) {
+      std::shared_ptr<CompileScheduler> pThis(shared_from_this());
+      m_workers.emplace_back([pThis]() mutable { WorkerMain(pThis); });
+    }
+    m_workAvailable.notify_one();
+    return id;
+  }
+
+  bool Cancel(UINT64 id) {
+    std::unique_ptr<CompileRequest> pRequest;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for (auto it = m_queue.begin(), end = m_queue.end(); it != end; ++it) {
+        if (it->first.second == id) {
+          pRequest = std::move(it->second);
+          m_queue.erase(it);
+          break;
+        }
+      }
+      if (!pRequest) {
+        auto running = m_running.find(id);
+        if (running == m_running.end())
+          return false;
+        running->second->Cancelled = true;
+        return true;
+      }
+    }
+    Complete(*pRequest, E_ABORT, nullptr);
+    return true;
+  }
+
+  HRESULT Wait(UINT64 id, DWORD milliseconds,
+               IDxcOperationResult **ppResult) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_waitable.count(id) == 0)
+      return E_INVALIDARG;
+    auto isDone = [&]() { return m_completed.count(id) != 0; };
+    if (milliseconds == INFINITE) {
+      m_requestDone.wait(lock, isDone);
+    } else if (!m_requestDone.wait_for(
+                   lock, std::chrono::milliseconds(milliseconds), isDone)) {
+      return E_PENDING;
+    }
+    auto found = m_completed.find(id);
+    HRESULT hr = found->second.Status;
+    *ppResult = found->second.Result.Detach();
+    m_completed.erase(found);
+    m_waitable.erase(id);
+    return hr;
+  }
+
+  // Cancels the queued requests and waits for the ones in progress, which
+  // stop at their next cancellation point.
+  void Shutdown() {
+    std::map<QueueKey, std::unique_ptr<CompileRequest>> cancelled;
+    std::vector<std::thread> workers;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_shutdown = true;
+      cancelled.swap(m_queue);
+      workers.swap(m_workers);
+      for (auto &entry : m_running)
+        entry.second->Cancelled = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto &entry : cancelled)
+      Complete(*entry.second, E_ABORT, nullptr);
+    for (std::thread &t : workers) {
+      // The last reference may be released by a callback on a worker.
+      if (t.get_id() == std::this_thread::get_id())
+        t.detach();
+      else
+        t.join();
+    }
+  }
+
+private:
+  // Ordered by priority, highest first, then by submission.
+  typedef std::pair<UINT32, UINT64> QueueKey;
+
+  static void WorkerMain(std::shared_ptr<CompileScheduler> &pThis) {
+    CComPtr<IMalloc> pMalloc(pThis->m_pMalloc);
+    DxcThreadMalloc TM(pMalloc);
+    pThis->Work();
+    // Release the scheduler while its allocator is still current.
+    pThis.reset();
+  }
+
+  void Work() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_compilerCreated) {
+      m_hrCompiler = CreateDxcCompilerSession(IID_PPV_ARGS(&m_pCompiler));
+      m_compilerCreated = true;
+    }
+    CComPtr<IDxcCompiler> pCompiler(m_pCompiler);
+    HRESULT hrCompiler = m_hrCompiler;
+    for (;;) {
+      ++m_idleWorkers;
+      m_workAvailable.wait(lock,
+                           [&]() { return m_shutdown || !m_queue.empty(); });
+      --m_idleWorkers;
+      if (m_queue.empty())
+        return;
+      auto next = m_queue.begin();
+      std::unique_ptr<CompileRequest> pRequest(std::move(next->second));
+      m_queue.erase(next);
+      m_running[pRequest->Id] = pRequest.get();
+      lock.unlock();
+
+      CComPtr<IDxcOperationResult> pResult;
+      HRESULT status = hrCompiler;
+      if (SUCCEEDED(status)) {
+        RequestCancellationCheck check(pRequest->Cancelled);
+        llvm::CancellationCheck *pPrior =
+            llvm::setThreadCancellationCheck(&check);
+        status = RunRequest(pCompiler, *pRequest, &pResult);
+        llvm::setThreadCancellationCheck(pPrior);
+      }
+      lock.lock();
+      m_running.erase(pRequest->Id);
+      lock.unlock();
+      // Report the status of the compile itself, not just of the call.
+      if (SUCCEEDED(status) && FAILED(pResult->GetStatus(&status)))
+        status = E_FAIL;
+      Complete(*pRequest, status, pResult);
+      pResult.Release();
+      pRequest.reset();
+
+      lock.lock();
+    }
+  }
+
+  static HRESULT RunRequest(IDxcCompiler *pCompiler,
+                            const CompileRequest &request,
+                            IDxcOperationResult **ppResult) {
+    try {
+      std::vector<LPCWSTR> arguments;
+      for (const std::wstring &argument : request.Arguments)
+        arguments.push_back(argument.c_str());
+      std::vector<DxcDefine> defines(request.DefineNames.size());
+      for (size_t i = 0; i < defines.size(); ++i) {
+        defines[i].Name = request.DefineNames[i].c_str();
+        defines[i].Value = request.DefineHasValue[i]
+                               ? request.DefineValues[i].c_str()
+                               : nullptr;
+      }
+      return pCompiler->Compile(
+          request.Source,
+          request.HasSourceName ? request.SourceName.c_str() : nullptr,
+          request.EntryPoint.c_str(), request.TargetProfile.c_str(),
+          arguments.data(), (UINT32)arguments.size(), defines.data(),
+          (UINT32)defines.size(), request.IncludeHandler, ppResult);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  void Complete(CompileRequest &request, HRESULT hr,
+                IDxcOperationResult *pResult) {
+    if (request.Callback != nullptr) {
+      request.Callback->OnCompileCompleted(request.Id, hr, pResult);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      CompletedRequest &completed = m_completed[request.Id];
+      completed.Status = hr;
+      completed.Result = pResult;
+    }
+    m_requestDone.notify_all();
+  }
+
+  CComPtr<IMalloc> m_pMalloc;
+  const unsigned m_maxWorkers;
+  std::mutex m_mutex;
+  // Created by the first worker.
+  CComPtr<IDxcCompiler> m_pCompiler;
+  HRESULT m_hrCompiler = S_OK;
+  bool m_compilerCreated = false;
+  std::condition_variable m_workAvailable;
+  std::condition_variable m_requestDone;
+  std::map<QueueKey, std::unique_ptr<CompileRequest>> m_queue;
+  // Requests without a callback that haven't been waited for.
+  std::set<UINT64> m_waitable;
+  std::map<UINT64, CompletedRequest> m_completed;
+  // Requests being compiled, so that Cancel can stop them.
+  std::map<UINT64, CompileRequest *> m_running;
+  std::vector<std::thread> m_workers;
+  unsigned m_idleWorkers = 0;
+  UINT64 m_nextId = 1;
+  bool m_shutdown = false;
+};
+
+class DxcCompilerAsync : public IDxcCompilerAsync {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  std::shared_ptr<CompileScheduler> m_pScheduler;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcCompilerAsync)
+
+  DxcCompilerAsync(IMalloc *pMalloc)
+      : m_dwRef(0), m_pMalloc(pMalloc),
+        m_pScheduler(std::make_shared<CompileScheduler>(pMalloc)) {}
+  ~DxcCompilerAsync() {
+    m_pScheduler->Shutdown();
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcCompilerAsync>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE CompileAsync(
+      _In_ IDxcBlob *pSource, _In_opt_ LPCWSTR pSourceName,
+      _In_ LPCWSTR pEntryPoint, _In_ LPCWSTR pTargetProfile,
+      _In_count_(argCount) LPCWSTR *pArguments, _In_ UINT32 argCount,
+      _In_count_(defineCount) const DxcDefine *pDefines,
+      _In_ UINT32 defineCount, _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+      _In_ UINT32 priority, _In_opt_ IDxcCompletionCallback *pCallback,
+      _Out_ UINT64 *pRequestId) {
+    if (pSource == nullptr || pEntryPoint == nullptr ||
+        pTargetProfile == nullptr || pRequestId == nullptr ||
+        (argCount > 0 && pArguments == nullptr) ||
+        (defineCount > 0 && pDefines == nullptr))
+      return E_INVALIDARG;
+    *pRequestId = 0;
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::unique_ptr<CompileRequest> pRequest(new CompileRequest());
+      pRequest->Source = pSource;
+      pRequest->HasSourceName = pSourceName != nullptr;
+      if (pSourceName)
+        pRequest->SourceName = pSourceName;
+      pRequest->EntryPoint = pEntryPoint;
+      pRequest->TargetProfile = pTargetProfile;
+      pRequest->Arguments.assign(pArguments, pArguments + argCount);
+      for (UINT32 i = 0; i < defineCount; ++i) {
+        pRequest->DefineNames.emplace_back(pDefines[i].Name);
+        pRequest->DefineHasValue.push_back(pDefines[i].Value != nullptr);
+        pRequest->DefineValues.emplace_back(
+            pDefines[i].Value ? pDefines[i].Value : L"");
+      }
+      pRequest->IncludeHandler = pIncludeHandler;
+      pRequest->Callback = pCallback;
+      *pRequestId = m_pScheduler->Submit(std::move(pRequest), priority);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  __override HRESULT STDMETHODCALLTYPE Cancel(_In_ UINT64 requestId) {
+    DxcThreadMalloc TM(m_pMalloc);
+    return m_pScheduler->Cancel(requestId) ? S_OK : S_FALSE;
+  }
+
+  __override HRESULT STDMETHODCALLTYPE Wait(
+      _In_ UINT64 requestId, _In_ DWORD milliseconds,
+      _COM_Outptr_result_maybenull_ IDxcOperationResult **ppResult) {
+    if (ppResult == nullptr)
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      return m_pScheduler->Wait(requestId, milliseconds, ppResult);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+} // namespace
+
+HRESULT CreateDxcCompilerAsync(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  *ppv = nullptr;
+  try {
+    CComPtr<DxcCompilerAsync> result(
+        DxcCompilerAsync::Alloc(DxcGetThreadMallocNoRef()));
+    IFROOM(result.p);
+    return result.p->QueryInterface(riid, ppv);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
@@ -11,6 +11,8 @@
 
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "clang/Sema/SemaHLSL.h"
 #include "llvm/IR/LLVMContext.h"
@@ -140,32 +142,112 @@ static HRESULT StringRefToBSTR(llvm::StringRef value, BSTR *pRetVal) {
 static HRESULT CreateDxcDiaEnumTables(DxcDiaSession *, IDiaEnumTables **);
 static HRESULT CreateDxcDiaTable(DxcDiaSession *, DiaTableKind kind, IDiaTable **ppTable);
 static HRESULT DxcDiaFindLineNumbersByRVA(DxcDiaSession *, DWORD rva, DWORD length, IDiaEnumLineNumbers **);
+static HRESULT DxcDiaFindLineNumbersByLinenum(DxcDiaSession *, DWORD fileId, DWORD linenum, DWORD column, IDiaEnumLineNumbers **);
+
+// Loads the debug module from LLVM bitcode or from an ILDB part.
+static HRESULT LoadDiaModuleFromBuffer(MemoryBuffer *pBuffer, LLVMContext &context,
+                                       std::unique_ptr<llvm::Module> &pModule) {
+  size_t bufferSize = pBuffer->getBufferSize();
+  if (bufferSize < sizeof(UINT32)) {
+    return DXC_E_MALFORMED_CONTAINER;
+  }
+  MemoryBuffer *pBitcodeBuffer;
+  std::unique_ptr<MemoryBuffer> pEmbeddedBuffer;
+  const UINT32 BC_C0DE = ((INT32)(INT8)'B' | (INT32)(INT8)'C' << 8 | (INT32)0xDEC0 << 16); // BC0xc0de in big endian
+  if (BC_C0DE == *(const UINT32*)pBuffer->getBufferStart()) {
+    pBitcodeBuffer = pBuffer;
+  }
+  else {
+    if (bufferSize <= sizeof(hlsl::DxilProgramHeader)) {
+      return DXC_E_MALFORMED_CONTAINER;
+    }
+
+    hlsl::DxilProgramHeader *pDxilProgramHeader = (hlsl::DxilProgramHeader *)pBuffer->getBufferStart();
+    if (pDxilProgramHeader->BitcodeHeader.DxilMagic != DxilMagicValue) {
+      return DXC_E_MALFORMED_CONTAINER;
+    }
+
+    UINT32 BlobSize;
+    const char *pBitcode = nullptr;
+    hlsl::GetDxilProgramBitcode(pDxilProgramHeader, &pBitcode, &BlobSize);
+    UINT32 offset = (UINT32)(pBitcode - (const char *)pDxilProgramHeader);
+    std::unique_ptr<MemoryBuffer> p = MemoryBuffer::getMemBuffer(
+        StringRef(pBitcode, bufferSize - offset), "data", false);
+    pEmbeddedBuffer.swap(p);
+    pBitcodeBuffer = pEmbeddedBuffer.get();
+  }
+
+  std::string DiagStr;
+  pModule = dxilutil::LoadModuleFromBitcode(pBitcodeBuffer, context, DiagStr);
+  if (!pModule.get())
+    return E_FAIL;
+  return S_OK;
+}
+
+// Loads the debug module from the ILDB part of a container, or from the
+// compressed ILDZ part.
+static HRESULT LoadDiaModuleFromContainer(MemoryBuffer *pContainer, LLVMContext &context,
+                                          std::unique_ptr<llvm::Module> &pModule) {
+  const DxilContainerHeader *pHeader = IsDxilContainerLike(
+      pContainer->getBufferStart(), pContainer->getBufferSize());
+  if (!IsValidDxilContainer(pHeader, pContainer->getBufferSize()))
+    return DXC_E_MALFORMED_CONTAINER;
+  std::vector<char> partStorage;
+  const DxilPartHeader *pPart = GetDxilDebugInfoPart(pHeader, partStorage);
+  if (pPart == nullptr) {
+    return GetDxilPartByType(pHeader, DFCC_ShaderDebugInfoCompressed)
+               ? DXC_E_MALFORMED_CONTAINER
+               : DXC_E_MISSING_PART;
+  }
+  std::unique_ptr<MemoryBuffer> pPartBuffer = MemoryBuffer::getMemBuffer(
+      StringRef(GetDxilPartData(pPart), pPart->PartSize), "data", false);
+  return LoadDiaModuleFromBuffer(pPartBuffer.get(), context, pModule);
+}
 
 class DxcDiaSession : public IDiaSession {
+public:
+  typedef hlsl::DxilDebugLinesEntry LineEntry;
+  struct LineIndexEntry {
+    DWORD line;
+    DWORD column;
+    DWORD rva;
+  };
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   std::shared_ptr<llvm::LLVMContext> m_context;
   std::shared_ptr<llvm::Module> m_module;
   std::shared_ptr<llvm::DebugInfoFinder> m_finder;
   std::unique_ptr<DxilModule> m_dxilModule;
-  llvm::NamedMDNode *m_contents;
+  // A container with a debug lines part; the debug module is only loaded
+  // from it when a query needs more than lines and source files.
+  std::shared_ptr<llvm::MemoryBuffer> m_container;
   llvm::NamedMDNode *m_defines;
   llvm::NamedMDNode *m_mainFileName;
   llvm::NamedMDNode *m_arguments;
-  std::vector<const Instruction *> m_instructions;
-  std::vector<const Instruction *> m_instructionLines; // Instructions with line info.
-  typedef unsigned RVA;
-  std::unordered_map<const Instruction *, RVA> m_rvaMap; // Map instruction to its RVA.
-public:
-  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
-  DXC_MICROCOM_TM_CTOR(DxcDiaSession)
-
-  IMalloc *GetMallocNoRef() { return m_pMalloc.p; }
-
-  void Init(std::shared_ptr<llvm::LLVMContext> context,
+  struct SourceFile {
+    StringRef Name;
+    StringRef Content;
+    bool ContentLoaded; // Set once the provider was asked for the content.
+  };
+  std::vector<SourceFile> m_sourceFiles;
+  // Loads the contents that source pack debug info names by digest, and
+  // keeps the loaded contents alive.
+  CComPtr<IDxcSourceProvider> m_pSourceProvider;
+  std::vector<CComPtr<IDxcBlob>> m_loadedSources;
+  llvm::StringMap<DWORD> m_fileIds; // Map file name to its source file id.
+  DWORD m_instructionCount;
+  // Lines of instructions with line info, sorted by RVA. Points into the
+  // debug lines part, or into m_lineStorage when built from the module.
+  llvm::ArrayRef<LineEntry> m_lines;
+  std::vector<LineEntry> m_lineStorage;
+  // Lines of every source file, sorted by line and then RVA. Built on first
+  // lookup by line number.
+  std::vector<std::vector<LineIndexEntry>> m_fileLines;
+  bool m_fileLinesBuilt = false;
+
+  void InitModule(std::shared_ptr<llvm::LLVMContext> context,
       std::shared_ptr<llvm::Module> module,
       std::shared_ptr<llvm::DebugInfoFinder> finder) {
-    m_pEnumTables = nullptr;
     m_module = module;
     m_context = context;
     m_finder = finder;
@@ -174,13 +256,42 @@ public:
     // Extract HLSL metadata.
     m_dxilModule->LoadDxilMetadata();
 
-    // Get file contents.
-    m_contents = m_module->getNamedMetadata("llvm.dbg.contents");
     m_defines = m_module->getNamedMetadata("llvm.dbg.defines");
     m_mainFileName = m_module->getNamedMetadata("llvm.dbg.mainFileName");
     m_arguments = m_module->getNamedMetadata("llvm.dbg.args");
+  }
+
+  void InitFileIds() {
+    // Index file names; the first file with a given name gets the lookups.
+    for (DWORD i = 0, e = (DWORD)m_sourceFiles.size(); i < e; ++i) {
+      m_fileIds.insert({ m_sourceFiles[i].Name, i });
+    }
+  }
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcDiaSession)
+
+  IMalloc *GetMallocNoRef() { return m_pMalloc.p; }
+
+  void Init(std::shared_ptr<llvm::LLVMContext> context,
+      std::shared_ptr<llvm::Module> module,
+      std::shared_ptr<llvm::DebugInfoFinder> finder) {
+    m_pEnumTables = nullptr;
+    InitModule(context, module, finder);
+
+    // Get file contents.
+    if (NamedMDNode *contents = m_module->getNamedMetadata("llvm.dbg.contents")) {
+      for (const MDNode *file : contents->operands()) {
+        m_sourceFiles.push_back(
+            { cast<MDString>(file->getOperand(0))->getString(),
+              cast<MDString>(file->getOperand(1))->getString(), false });
+      }
+    }
+    InitFileIds();
+
     // Build up a linear list of instructions. The index will be used as the
     // RVA. Debug instructions are ommitted from this enumeration.
+    m_instructionCount = 0;
     for (const Function &fn : m_module->functions()) {
       for (const_inst_iterator it = inst_begin(fn), end = inst_end(fn); it != end; ++it) {
         const Instruction &i = *it;
@@ -191,47 +302,174 @@ public:
           }
         }
 
-        m_rvaMap.insert({ &i, static_cast<RVA>(m_instructions.size()) });
-        m_instructions.push_back(&i);
-        if (i.getDebugLoc()) {
-          m_instructionLines.push_back(&i);
+        if (const llvm::DebugLoc &DL = i.getDebugLoc()) {
+          LineEntry entry;
+          entry.Instruction = m_instructionCount;
+          entry.Line = DL.getLine();
+          entry.Column = DL.getCol();
+          DWORD fileId;
+          entry.FileIndex = getSourceFileIdByLoc(DL, &fileId) == S_OK
+                                ? fileId : DxilDebugLinesNoFile;
+          m_lineStorage.push_back(entry);
         }
+        ++m_instructionCount;
       }
     }
+    m_lines = m_lineStorage;
+  }
 
-    // Sanity check to make sure rva map is same as instruction index.
-    for (size_t i = 0, e = m_instructions.size(); i < e; ++i) {
-      DXASSERT(m_rvaMap.find(m_instructions[i]) != m_rvaMap.end(), "instruction not mapped to rva");
-      DXASSERT(m_rvaMap[m_instructions[i]] == i, "instruction mapped to wrong rva");
+  // Initializes the session from the debug lines part of a container, which
+  // stays in place and is queried directly.
+  void InitFromDebugLines(std::shared_ptr<llvm::MemoryBuffer> container,
+                          const DxilDebugLinesHeader *pLines) {
+    m_pEnumTables = nullptr;
+    m_container = container;
+    m_defines = m_mainFileName = m_arguments = nullptr;
+    const char *pStrings = GetDxilDebugLinesStrings(pLines);
+    const DxilDebugLinesFile *pFiles = GetDxilDebugLinesFiles(pLines);
+    for (uint32_t i = 0; i < pLines->FileCount; ++i) {
+      m_sourceFiles.push_back(
+          { StringRef(pStrings + pFiles[i].NameOffset, pFiles[i].NameSize),
+            StringRef(pStrings + pFiles[i].ContentOffset, pFiles[i].ContentSize),
+            false });
     }
+    InitFileIds();
+    m_instructionCount = pLines->InstructionCount;
+    m_lines = llvm::ArrayRef<LineEntry>(GetDxilDebugLinesEntries(pLines),
+                                        pLines->LineCount);
+  }
+
+  // Loads the debug module, for queries that need more than lines and source
+  // files.
+  HRESULT EnsureModule() {
+    if (m_module.get() != nullptr)
+      return S_OK;
+    if (m_container.get() == nullptr)
+      return E_FAIL;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::shared_ptr<LLVMContext> context = std::make_shared<LLVMContext>();
+      std::unique_ptr<llvm::Module> pModule;
+      IFR(LoadDiaModuleFromContainer(m_container.get(), *context.get(), pModule));
+      std::shared_ptr<DebugInfoFinder> finder = std::make_shared<DebugInfoFinder>();
+      finder->processModule(*pModule.get());
+      InitModule(context, std::shared_ptr<llvm::Module>(pModule.release()), finder);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+    return S_OK;
+  }
+
+  void SetSourceProvider(IDxcSourceProvider *pProvider) {
+    m_pSourceProvider = pProvider;
+  }
+
+  // Loads the content of a file that source pack debug info names by digest
+  // through the source provider. The digests are only kept in the debug
+  // module, in the file order of the debug lines part.
+  void LoadSourceFileContent(DWORD id) {
+    SourceFile &file = m_sourceFiles[id];
+    file.ContentLoaded = true;
+    if (FAILED(EnsureModule()))
+      return;
+    NamedMDNode *contents = m_module->getNamedMetadata("llvm.dbg.contents");
+    if (contents == nullptr || id >= contents->getNumOperands())
+      return;
+    const MDNode *fileNode = contents->getOperand(id);
+    if (fileNode->getNumOperands() < 3)
+      return;
+    StringRef digestText = cast<MDString>(fileNode->getOperand(2))->getString();
+    BYTE digest[DxilContainerHashSize];
+    if (digestText.size() != 2 * DxilContainerHashSize)
+      return;
+    for (unsigned i = 0; i < DxilContainerHashSize; ++i) {
+      unsigned hi = llvm::hexDigitValue(digestText[2 * i]);
+      unsigned lo = llvm::hexDigitValue(digestText[2 * i + 1]);
+      if (hi == -1U || lo == -1U)
+        return;
+      digest[i] = (BYTE)(hi << 4 | lo);
+    }
+    CComPtr<IDxcBlob> pSource;
+    if (FAILED(m_pSourceProvider->LoadSource(digest, &pSource)) ||
+        pSource == nullptr)
+      return;
+    file.Content = StringRef((const char *)pSource->GetBufferPointer(),
+                             pSource->GetBufferSize());
+    m_loadedSources.emplace_back(std::move(pSource));
+  }
+
+  DWORD SourceFileCount() { return (DWORD)m_sourceFiles.size(); }
+  StringRef SourceFileName(DWORD id) { return m_sourceFiles[id].Name; }
+  StringRef SourceFileContent(DWORD id) {
+    SourceFile &file = m_sourceFiles[id];
+    if (file.Content.empty() && !file.ContentLoaded && m_pSourceProvider)
+      LoadSourceFileContent(id);
+    return file.Content;
   }
-  llvm::NamedMDNode *Contents() { return m_contents; }
   llvm::NamedMDNode *Defines() { return m_defines; }
   llvm::NamedMDNode *MainFileName() { return m_mainFileName; }
   llvm::NamedMDNode *Arguments() { return m_arguments; }
   hlsl::DxilModule &DxilModuleRef() { return *m_dxilModule.get(); }
   llvm::Module &ModuleRef() { return *m_module.get(); }
   llvm::DebugInfoFinder &InfoRef() { return *m_finder.get(); }
-  std::vector<const Instruction *> &InstructionsRef() { return m_instructions; }
-  std::vector<const Instruction *> &InstructionLinesRef() { return m_instructionLines; }
-  std::unordered_map<const Instruction *, RVA> &RvaMapRef() { return m_rvaMap; }
+  DWORD InstructionCount() { return m_instructionCount; }
+  llvm::ArrayRef<LineEntry> LinesRef() { return m_lines; }
 
   HRESULT getSourceFileIdByName(StringRef fileName, DWORD *pRetVal) {
-    if (Contents() != nullptr) {
-      for (unsigned i = 0; i < Contents()->getNumOperands(); ++i) {
-        StringRef fn =
-            dyn_cast<MDString>(Contents()->getOperand(i)->getOperand(0))
-                ->getString();
-        if (fn.equals(fileName)) {
-          *pRetVal = i;
-          return S_OK;
-        }
-      }
+    auto it = m_fileIds.find(fileName);
+    if (it != m_fileIds.end()) {
+      *pRetVal = it->second;
+      return S_OK;
+    }
+    *pRetVal = 0;
+    return S_FALSE;
+  }
+
+  HRESULT getSourceFileIdByEntry(const LineEntry &entry, DWORD *pRetVal) {
+    if (entry.FileIndex == DxilDebugLinesNoFile) {
+      *pRetVal = 0;
+      return S_FALSE;
+    }
+    *pRetVal = entry.FileIndex;
+    return S_OK;
+  }
+
+  HRESULT getSourceFileIdByLoc(const llvm::DebugLoc &DL, DWORD *pRetVal) {
+    MDNode *pScope = DL.getScope();
+    DILexicalBlock *pBlock = dyn_cast_or_null<DILexicalBlock>(pScope);
+    if (pBlock != nullptr) {
+      return getSourceFileIdByName(pBlock->getFile()->getFilename(), pRetVal);
+    }
+    DISubprogram *pSubProgram= dyn_cast_or_null<DISubprogram>(pScope);
+    if (pSubProgram != nullptr) {
+      return getSourceFileIdByName(pSubProgram->getFile()->getFilename(), pRetVal);
     }
     *pRetVal = 0;
     return S_FALSE;
   }
 
+  // Returns the lines of a source file, sorted by line and then RVA.
+  const std::vector<LineIndexEntry> &FileLinesRef(DWORD fileId) {
+    if (!m_fileLinesBuilt) {
+      m_fileLines.resize(m_sourceFiles.size());
+      for (const LineEntry &entry : m_lines) {
+        DWORD id;
+        if (getSourceFileIdByEntry(entry, &id) != S_OK)
+          continue;
+        m_fileLines[id].push_back({ entry.Line, entry.Column, entry.Instruction });
+      }
+      for (std::vector<LineIndexEntry> &lines : m_fileLines) {
+        // Entries were added in RVA order.
+        std::stable_sort(lines.begin(), lines.end(),
+          [](const LineIndexEntry &a, const LineIndexEntry &b) {
+            return a.line < b.line;
+          });
+      }
+      m_fileLinesBuilt = true;
+    }
+    static const std::vector<LineIndexEntry> noLines;
+    return fileId < m_fileLines.size() ? m_fileLines[fileId] : noLines;
+  }
+
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
     return DoBasicQueryInterface<IDiaSession>(this, iid, ppvObject);
   }
@@ -396,7 +634,14 @@ public:
     /* [in] */ IDiaSourceFile *file,
     /* [in] */ DWORD linenum,
     /* [in] */ DWORD column,
-    /* [out] */ IDiaEnumLineNumbers **ppResult) { return E_NOTIMPL; }
+    /* [out] */ IDiaEnumLineNumbers **ppResult) {
+    if (file == nullptr)
+      return E_INVALIDARG;
+    DxcThreadMalloc TM(m_pMalloc);
+    DWORD fileId;
+    IFR(file->get_uniqueId(&fileId));
+    return DxcDiaFindLineNumbersByLinenum(this, fileId, linenum, column, ppResult);
+  }
 
   __override STDMETHODIMP findInjectedSource(
       /* [in] */ LPCOLESTR srcFile,
@@ -613,14 +858,13 @@ public:
     if (indexVal > (unsigned)LastTableKind) {
       return E_INVALIDARG;
     }
-    HRESULT hr = S_OK;
     if (!m_tables[indexVal]) {
       DxcThreadMalloc TM(m_pMalloc);
-      hr = CreateDxcDiaTable(m_pSession, (DiaTableKind)indexVal, &m_tables[indexVal]);
+      IFR(CreateDxcDiaTable(m_pSession, (DiaTableKind)indexVal, &m_tables[indexVal]));
     }
     m_tables[indexVal].p->AddRef();
     *table = m_tables[indexVal];
-    return hr;
+    return S_OK;
   }
 
   __override STDMETHODIMP Next(
@@ -1719,11 +1963,8 @@ public:
   DxcDiaSourceFile(IMalloc *pMalloc, DxcDiaSession *pSession, DWORD index)
     : m_pMalloc(pMalloc), m_pSession(pSession), m_index(index) {}
 
-  llvm::MDTuple *NameContent() {
-    return cast<llvm::MDTuple>(m_pSession->Contents()->getOperand(m_index));
-  }
   llvm::StringRef Name() {
-    return dyn_cast<llvm::MDString>(NameContent()->getOperand(0))->getString();
+    return m_pSession->SourceFileName(m_index);
   }
 
   __override STDMETHODIMP get_uniqueId(
@@ -1759,8 +2000,7 @@ public:
 class DxcDiaTableSourceFiles : public DxcDiaTableBase<IDiaEnumSourceFiles, IDiaSourceFile> {
 public:
   DxcDiaTableSourceFiles(IMalloc *pMalloc, DxcDiaSession *pSession) : DxcDiaTableBase(pMalloc, pSession, DiaTableKind::SourceFiles) { 
-    m_count =
-      (m_pSession->Contents() == nullptr) ? 0 : m_pSession->Contents()->getNumOperands();
+    m_count = m_pSession->SourceFileCount();
     m_items.assign(m_count, nullptr);
   }
 
@@ -1782,20 +2022,15 @@ private:
 class DxcDiaLineNumber : public IDiaLineNumber {
   DXC_MICROCOM_TM_REF_FIELDS()
   CComPtr<DxcDiaSession> m_pSession;
-  const Instruction *m_inst;
+  DxcDiaSession::LineEntry m_entry;
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
     return DoBasicQueryInterface<IDiaLineNumber>(this, iid, ppvObject);
   }
 
-  DxcDiaLineNumber(IMalloc *pMalloc, DxcDiaSession *pSession, const Instruction * inst)
-    : m_pMalloc(pMalloc), m_pSession(pSession), m_inst(inst) {}
-
-  const llvm::DebugLoc &DL() {
-    DXASSERT(bool(m_inst->getDebugLoc()), "Trying to read line info from invalid debug location");
-    return m_inst->getDebugLoc();
-  }
+  DxcDiaLineNumber(IMalloc *pMalloc, DxcDiaSession *pSession, const DxcDiaSession::LineEntry &entry)
+    : m_pMalloc(pMalloc), m_pSession(pSession), m_entry(entry) {}
 
   __override STDMETHODIMP get_compiland(
     /* [retval][out] */ IDiaSymbol **pRetVal) { return E_NOTIMPL; }
@@ -1811,25 +2046,25 @@ public:
 
   __override STDMETHODIMP get_lineNumber(
     /* [retval][out] */ DWORD *pRetVal) {
-    *pRetVal = DL().getLine();
+    *pRetVal = m_entry.Line;
     return S_OK;
   }
 
   __override STDMETHODIMP get_lineNumberEnd(
     /* [retval][out] */ DWORD *pRetVal) {
-    *pRetVal = DL().getLine();
+    *pRetVal = m_entry.Line;
     return S_OK;
   }
 
   __override STDMETHODIMP get_columnNumber(
     /* [retval][out] */ DWORD *pRetVal) {
-    *pRetVal = DL().getCol();
+    *pRetVal = m_entry.Column;
     return S_OK;
   }
 
   __override STDMETHODIMP get_columnNumberEnd(
     /* [retval][out] */ DWORD *pRetVal) {
-    *pRetVal = DL().getCol();
+    *pRetVal = m_entry.Column;
     return S_OK;
   }
 
@@ -1841,7 +2076,7 @@ public:
 
   __override STDMETHODIMP get_relativeVirtualAddress(
     /* [retval][out] */ DWORD *pRetVal) { 
-    *pRetVal = m_pSession->RvaMapRef()[m_inst];
+    *pRetVal = m_entry.Instruction;
     return S_OK;
   }
 
@@ -1853,17 +2088,7 @@ public:
 
   __override STDMETHODIMP get_sourceFileId(
     /* [retval][out] */ DWORD *pRetVal) {
-    MDNode *pScope = DL().getScope();
-    DILexicalBlock *pBlock = dyn_cast_or_null<DILexicalBlock>(pScope);
-    if (pBlock != nullptr) {
-      return m_pSession->getSourceFileIdByName(pBlock->getFile()->getFilename(), pRetVal);
-    }
-    DISubprogram *pSubProgram= dyn_cast_or_null<DISubprogram>(pScope);
-    if (pSubProgram != nullptr) {
-      return m_pSession->getSourceFileIdByName(pSubProgram->getFile()->getFilename(), pRetVal);
-    }
-    *pRetVal = 0;
-    return S_FALSE;
+    return m_pSession->getSourceFileIdByEntry(m_entry, pRetVal);
   }
 
   __override STDMETHODIMP get_statement(
@@ -1881,36 +2106,37 @@ public:
 
 // This class implements the line number table for dxc.
 //
-// It keeps a reference to the list of instructions that contain
+// It keeps a reference to the lines of instructions that contain
 // line number debug info. By default, it points to the full list
-// of instructions that contain line info.
+// of lines of the session.
 //
-// It can also be passed a list of instructions that contain line info so
-// that we can iterate over a subset of lines. When passed an explicit list
-// it takes ownership of the list and points its reference to the internal
-// copy of the list.
+// It can also be passed a list of lines so that we can iterate over a
+// subset of lines. When passed an explicit list it takes ownership of the
+// list and points its reference to the internal copy of the list.
 class DxcDiaTableLineNumbers : public DxcDiaTableBase<IDiaEnumLineNumbers, IDiaLineNumber> {
 public:
+  typedef DxcDiaSession::LineEntry LineEntry;
+
   DxcDiaTableLineNumbers(IMalloc *pMalloc, DxcDiaSession *pSession) 
     : DxcDiaTableBase(pMalloc, pSession, DiaTableKind::LineNumbers)
-    , m_instructions(pSession->InstructionLinesRef())
+    , m_lines(pSession->LinesRef())
   {
-    m_count = m_instructions.size();
+    m_count = m_lines.size();
   }
   
-  DxcDiaTableLineNumbers(IMalloc *pMalloc, DxcDiaSession *pSession, std::vector<const Instruction*> &&instructions) 
+  DxcDiaTableLineNumbers(IMalloc *pMalloc, DxcDiaSession *pSession, std::vector<LineEntry> &&lines) 
     : DxcDiaTableBase(pMalloc, pSession, DiaTableKind::LineNumbers)
-    , m_instructions(m_instructionsStorage)
-    , m_instructionsStorage(std::move(instructions))
+    , m_linesStorage(std::move(lines))
   {
-    m_count = m_instructions.size();
+    m_lines = m_linesStorage;
+    m_count = m_lines.size();
   }
   
 
   __override HRESULT GetItem(DWORD index, IDiaLineNumber **ppItem) {
-    if (index >= m_instructions.size())
+    if (index >= m_lines.size())
       return E_INVALIDARG;
-    *ppItem = CreateOnMalloc<DxcDiaLineNumber>(m_pMalloc, m_pSession, m_instructions[index]);
+    *ppItem = CreateOnMalloc<DxcDiaLineNumber>(m_pMalloc, m_pSession, m_lines[index]);
     if (*ppItem == nullptr)
       return E_OUTOFMEMORY;
     (*ppItem)->AddRef();
@@ -1918,12 +2144,12 @@ public:
   }
 
 private:
-  // Keep a reference to the instructions that contain the line numbers.
-  const std::vector<const Instruction *> &m_instructions;
+  // Keep a reference to the lines of the table.
+  llvm::ArrayRef<LineEntry> m_lines;
   
-  // Provide storage space for instructions for when the table contains
-  // a subset of all instructions.
-  std::vector<const Instruction *> m_instructionsStorage;
+  // Provide storage space for lines for when the table contains
+  // a subset of all lines.
+  std::vector<LineEntry> m_linesStorage;
 };
 
 static HRESULT DxcDiaFindLineNumbersByRVA(
@@ -1935,23 +2161,56 @@ static HRESULT DxcDiaFindLineNumbersByRVA(
   if (!ppResult)
     return E_POINTER;
 
-  std::vector<const Instruction*> instructions;
-  const std::vector<const Instruction*> &allInstructions = pSession->InstructionsRef();
-
-  // Gather the list of insructions that map to the given rva range.
-  for (DWORD i = rva; i < rva + length; ++i) {
-    if (i >= allInstructions.size())
-      return E_INVALIDARG;
+  if (length > 0 && (ULONGLONG)rva + length > pSession->InstructionCount())
+    return E_INVALIDARG;
+
+  // Gather the lines of insructions that map to the given rva range; only
+  // instructions with debug info have line mappings.
+  typedef DxcDiaSession::LineEntry LineEntry;
+  llvm::ArrayRef<LineEntry> allLines = pSession->LinesRef();
+  auto lessRva = [](const LineEntry &entry, DWORD value) {
+    return entry.Instruction < value;
+  };
+  auto first = std::lower_bound(allLines.begin(), allLines.end(), rva, lessRva);
+  auto last = std::lower_bound(first, allLines.end(), rva + length, lessRva);
+  std::vector<LineEntry> lines(first, last);
+
+  // Create line number table from explicit line list.
+  IMalloc *pMalloc = pSession->GetMallocNoRef();
+  *ppResult = CreateOnMalloc<DxcDiaTableLineNumbers>(pMalloc, pSession, std::move(lines));
+  if (*ppResult == nullptr)
+    return E_OUTOFMEMORY;
+  (*ppResult)->AddRef();
+  return S_OK;
+}
 
-    // Only include the instruction if it has debug info for line mappings.
-    const Instruction *inst = allInstructions[i];
-    if (inst->getDebugLoc())
-      instructions.push_back(inst);
-  }
+static HRESULT DxcDiaFindLineNumbersByLinenum(
+  DxcDiaSession *pSession,
+  DWORD fileId,
+  DWORD linenum,
+  DWORD column,
+  IDiaEnumLineNumbers **ppResult)
+{
+  if (!ppResult)
+    return E_POINTER;
 
-  // Create line number table from explicit instruction list.
+  // Find the first line at or after linenum that has code, then the
+  // instructions on it at the given column, or at any column for zero.
+  typedef DxcDiaSession::LineIndexEntry LineIndexEntry;
+  typedef DxcDiaSession::LineEntry LineEntry;
+  const std::vector<LineIndexEntry> &fileLines = pSession->FileLinesRef(fileId);
+  auto it = std::lower_bound(fileLines.begin(), fileLines.end(), linenum,
+    [](const LineIndexEntry &entry, DWORD line) { return entry.line < line; });
+  std::vector<LineEntry> lines;
+  for (DWORD foundLine = it != fileLines.end() ? it->line : 0;
+       it != fileLines.end() && it->line == foundLine; ++it) {
+    if (column == 0 || it->column == column)
+      lines.push_back({ it->rva, it->line, it->column, fileId });
+  }
+
+  // Create line number table from explicit line list.
   IMalloc *pMalloc = pSession->GetMallocNoRef();
-  *ppResult = CreateOnMalloc<DxcDiaTableLineNumbers>(pMalloc, pSession, std::move(instructions));
+  *ppResult = CreateOnMalloc<DxcDiaTableLineNumbers>(pMalloc, pSession, std::move(lines));
   if (*ppResult == nullptr)
     return E_OUTOFMEMORY;
   (*ppResult)->AddRef();
@@ -1989,14 +2248,11 @@ public:
   DxcDiaInjectedSource(IMalloc *pMalloc, DxcDiaSession *pSession, DWORD index)
     : m_pMalloc(pMalloc), m_pSession(pSession), m_index(index) {}
 
-  llvm::MDTuple *NameContent() {
-    return cast<llvm::MDTuple>(m_pSession->Contents()->getOperand(m_index));
-  }
   llvm::StringRef Name() {
-    return dyn_cast<llvm::MDString>(NameContent()->getOperand(0))->getString();
+    return m_pSession->SourceFileName(m_index);
   }
   llvm::StringRef Content() {
-    return dyn_cast<llvm::MDString>(NameContent()->getOperand(1))->getString();
+    return m_pSession->SourceFileContent(m_index);
   }
 
   __override STDMETHODIMP get_crc(
@@ -2049,8 +2305,7 @@ public:
   DxcDiaTableInjectedSource(IMalloc *pMalloc, DxcDiaSession *pSession) : DxcDiaTableBase(pMalloc, pSession, DiaTableKind::InjectedSource) {
     // Count the number of source files available.
     // m_count = m_pSession->InfoRef().compile_unit_count();
-    m_count =
-      (m_pSession->Contents() == nullptr) ? 0 : m_pSession->Contents()->getNumOperands();
+    m_count = m_pSession->SourceFileCount();
   }
 
   __override HRESULT GetItem(DWORD index, IDiaInjectedSource **ppItem) {
@@ -2066,11 +2321,8 @@ public:
     return S_OK;
   }
   void Init(StringRef filename) {
-    for (unsigned i = 0; i < m_pSession->Contents()->getNumOperands(); ++i) {
-      StringRef fn =
-          dyn_cast<MDString>(m_pSession->Contents()->getOperand(i)->getOperand(0))
-              ->getString();
-      if (fn.equals(filename)) {
+    for (unsigned i = 0; i < m_pSession->SourceFileCount(); ++i) {
+      if (m_pSession->SourceFileName(i).equals(filename)) {
         m_indexList.emplace_back(i);
       }
     }
@@ -2106,7 +2358,7 @@ public:
 __override STDMETHODIMP DxcDiaSession::findInjectedSource(
     /* [in] */ LPCOLESTR srcFile,
     /* [out] */ IDiaEnumInjectedSources **ppResult) {
-  if (Contents() != nullptr) {
+  if (SourceFileCount() != 0) {
     CW2A pUtf8FileName(srcFile);
     DxcThreadMalloc TM(m_pMalloc);
     IDiaTable *pTable;
@@ -2125,7 +2377,11 @@ HRESULT CreateDxcDiaTable(DxcDiaSession *pSession, DiaTableKind kind, IDiaTable
   *ppTable = nullptr;
   IMalloc *pMalloc = pSession->GetMallocNoRef();
   switch (kind) {
-  case DiaTableKind::Symbols: *ppTable = CreateOnMalloc<DxcDiaTableSymbols>(pMalloc, pSession); break;
+  case DiaTableKind::Symbols:
+    // Symbols are read from the debug module.
+    IFR(pSession->EnsureModule());
+    *ppTable = CreateOnMalloc<DxcDiaTableSymbols>(pMalloc, pSession);
+    break;
   case DiaTableKind::SourceFiles: *ppTable = CreateOnMalloc<DxcDiaTableSourceFiles>(pMalloc, pSession); break;
   case DiaTableKind::LineNumbers: *ppTable = CreateOnMalloc<DxcDiaTableLineNumbers>(pMalloc, pSession); break;
   case DiaTableKind::Sections: *ppTable = CreateOnMalloc<DxcDiaTableSections>(pMalloc, pSession); break;
@@ -2141,20 +2397,26 @@ HRESULT CreateDxcDiaTable(DxcDiaSession *pSession, DiaTableKind kind, IDiaTable
   return S_OK;
 }
 
-class DxcDiaDataSource : public IDiaDataSource {
+class DxcDiaDataSource : public IDiaDataSource,
+                         public IDxcDiaSourceProviderSite {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   std::shared_ptr<llvm::Module> m_module;
   std::shared_ptr<llvm::LLVMContext> m_context;
   std::shared_ptr<llvm::DebugInfoFinder> m_finder;
+  // A container whose debug lines part sessions are opened on.
+  std::shared_ptr<llvm::MemoryBuffer> m_container;
+  const DxilDebugLinesHeader *m_pDebugLines;
+  CComPtr<IDxcSourceProvider> m_pSourceProvider;
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDiaDataSource>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDiaDataSource, IDxcDiaSourceProviderSite>(
+        this, iid, ppvObject);
   }
 
-  DxcDiaDataSource(IMalloc *pMalloc) : m_pMalloc(pMalloc) {}
+  DxcDiaDataSource(IMalloc *pMalloc) : m_pMalloc(pMalloc), m_pDebugLines(nullptr) {}
   ~DxcDiaDataSource() {
     // These are cross-referenced, so let's be explicit.
     m_finder.reset();
@@ -2188,53 +2450,43 @@ public:
 
   __override STDMETHODIMP loadDataFromIStream(_In_ IStream *pIStream) {
     DxcThreadMalloc TM(m_pMalloc);
-    if (m_module.get() != nullptr) {
+    if (m_module.get() != nullptr || m_container.get() != nullptr) {
       return E_FAIL;
     }
     m_context.reset();
     m_finder.reset();
     try {
-      m_context = std::make_shared<LLVMContext>();
-      MemoryBuffer *pBitcodeBuffer;
-      std::unique_ptr<MemoryBuffer> pEmbeddedBuffer;
       std::unique_ptr<MemoryBuffer> pBuffer =
           getMemBufferFromStream(pIStream, "data");
-      size_t bufferSize = pBuffer->getBufferSize();
-
-      // The buffer can hold LLVM bitcode for a module, or the ILDB
-      // part from a container.
-      if (bufferSize < sizeof(UINT32)) {
-        return DXC_E_MALFORMED_CONTAINER;
-      }
-      const UINT32 BC_C0DE = ((INT32)(INT8)'B' | (INT32)(INT8)'C' << 8 | (INT32)0xDEC0 << 16); // BC0xc0de in big endian
-      if (BC_C0DE == *(const UINT32*)pBuffer->getBufferStart()) {
-        pBitcodeBuffer = pBuffer.get();
-      }
-      else {
-        if (bufferSize <= sizeof(hlsl::DxilProgramHeader)) {
+      std::unique_ptr<llvm::Module> pModule;
+
+      // The buffer can hold LLVM bitcode for a module, the ILDB part from a
+      // container, or a container with debug info. When the container has a
+      // debug lines part, the module is only loaded if a session needs it.
+      const DxilContainerHeader *pHeader = IsDxilContainerLike(
+          pBuffer->getBufferStart(), pBuffer->getBufferSize());
+      if (pHeader != nullptr) {
+        if (!IsValidDxilContainer(pHeader, pBuffer->getBufferSize())) {
           return DXC_E_MALFORMED_CONTAINER;
         }
-
-        hlsl::DxilProgramHeader *pDxilProgramHeader = (hlsl::DxilProgramHeader *)pBuffer->getBufferStart();
-        if (pDxilProgramHeader->BitcodeHeader.DxilMagic != DxilMagicValue) {
-          return DXC_E_MALFORMED_CONTAINER;
+        const DxilPartHeader *pLinesPart =
+            GetDxilPartByType(pHeader, DFCC_ShaderDebugLines);
+        if (pLinesPart != nullptr) {
+          if (!IsDxilDebugLinesValid(pLinesPart)) {
+            return DXC_E_MALFORMED_CONTAINER;
+          }
+          m_pDebugLines = reinterpret_cast<const DxilDebugLinesHeader *>(
+              GetDxilPartData(pLinesPart));
+          m_container.reset(pBuffer.release());
+          return S_OK;
         }
-
-        UINT32 BlobSize;
-        const char *pBitcode = nullptr;
-        hlsl::GetDxilProgramBitcode(pDxilProgramHeader, &pBitcode, &BlobSize);
-        UINT32 offset = (UINT32)(pBitcode - (const char *)pDxilProgramHeader);
-        std::unique_ptr<MemoryBuffer> p = MemoryBuffer::getMemBuffer(
-            StringRef(pBitcode, bufferSize - offset), "data");
-        pEmbeddedBuffer.swap(p);
-        pBitcodeBuffer = pEmbeddedBuffer.get();
+        m_context = std::make_shared<LLVMContext>();
+        IFR(LoadDiaModuleFromContainer(pBuffer.get(), *m_context.get(), pModule));
+      }
+      else {
+        m_context = std::make_shared<LLVMContext>();
+        IFR(LoadDiaModuleFromBuffer(pBuffer.get(), *m_context.get(), pModule));
       }
-
-      std::string DiagStr;
-      std::unique_ptr<llvm::Module> pModule = dxilutil::LoadModuleFromBitcode(
-          pBitcodeBuffer, *m_context.get(), DiagStr);
-      if (!pModule.get())
-        return E_FAIL;
       m_finder = std::make_shared<DebugInfoFinder>();
       m_finder->processModule(*pModule.get());
       m_module.reset(pModule.release());
@@ -2246,15 +2498,25 @@ public:
   __override STDMETHODIMP openSession(_COM_Outptr_ IDiaSession **ppSession) {
     DxcThreadMalloc TM(m_pMalloc);
     *ppSession = nullptr;
-    if (m_module.get() == nullptr)
+    if (m_module.get() == nullptr && m_container.get() == nullptr)
       return E_FAIL;
     CComPtr<DxcDiaSession> pSession = DxcDiaSession::Alloc(DxcGetThreadMallocNoRef());
     IFROOM(pSession.p);
-    pSession->Init(m_context, m_module, m_finder);
+    if (m_module.get() != nullptr)
+      pSession->Init(m_context, m_module, m_finder);
+    else
+      pSession->InitFromDebugLines(m_container, m_pDebugLines);
+    pSession->SetSourceProvider(m_pSourceProvider);
     *ppSession = pSession.Detach();
     return S_OK;
   }
 
+  __override HRESULT STDMETHODCALLTYPE
+  SetSourceProvider(_In_opt_ IDxcSourceProvider *pProvider) {
+    m_pSourceProvider = pProvider;
+    return S_OK;
+  }
+
   __override HRESULT STDMETHODCALLTYPE loadDataFromCodeViewInfo(
     _In_ LPCOLESTR executable,
     _In_ LPCOLESTR searchPath,
@@ -19,6 +19,7 @@
 #include "dxc/HLSL/HLMatrixLowerHelper.h"
 #include "dxc/HLSL/DxilConstants.h"
 #include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/AssemblyAnnotationWriter.h"
@@ -49,7 +50,7 @@ bool SigElementHasStream(const DxilProgramSignatureElement &pSignature) {
 }
 
 void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
-                           bool bIsInput, raw_string_ostream &OS,
+                           bool bIsInput, raw_ostream &OS,
                            StringRef comment) {
   OS << comment << "\n"
      << comment << " " << pName << " signature:\n"
@@ -252,7 +253,7 @@ void PrintSignature(LPCSTR pName, const DxilProgramSignature *pSignature,
   OS << comment << "\n";
 }
 
-void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
+void PintCompMaskNameCompact(raw_ostream &OS, unsigned CompMask) {
   char Mask[5];
   memset(Mask, '\0', sizeof(Mask));
   unsigned idx = 0;
@@ -268,7 +269,7 @@ void PintCompMaskNameCompact(raw_string_ostream &OS, unsigned CompMask) {
 }
 
 void PrintDxilSignature(LPCSTR pName, const DxilSignature &Signature,
-                               raw_string_ostream &OS, StringRef comment) {
+                               raw_ostream &OS, StringRef comment) {
   const std::vector<std::unique_ptr<DxilSignatureElement>> &sigElts =
       Signature.GetElements();
   if (sigElts.size() == 0)
@@ -292,6 +293,15 @@ void PrintDxilSignature(LPCSTR pName, const DxilSignature &Signature,
     PintCompMaskNameCompact(OS, sigElt->GetDynIdxCompMask());
     OS << "\n";
   }
+
+  unsigned rowsUsed = Signature.NumVectorsUsed();
+  unsigned optimizedRows =
+      Signature.GetPackedRowCount(DXIL::PackingStrategy::Optimized);
+  if (rowsUsed < optimizedRows) {
+    OS << comment << "\n"
+       << comment << " Packed into " << rowsUsed << " rows, "
+       << optimizedRows - rowsUsed << " fewer than /pack_optimized\n";
+  }
 }
 
 PCSTR g_pFeatureInfoNames[] = {
@@ -319,7 +329,7 @@ PCSTR g_pFeatureInfoNames[] = {
 static_assert(_countof(g_pFeatureInfoNames) == ShaderFeatureInfoCount, "g_pFeatureInfoNames needs to be updated");
 
 void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
-                             raw_string_ostream &OS, StringRef comment) {
+                             raw_ostream &OS, StringRef comment) {
   uint64_t featureFlags = pFeatureInfo->FeatureFlags;
   if (!featureFlags)
     return;
@@ -333,7 +343,7 @@ void PrintFeatureInfo(const DxilShaderFeatureInfo *pFeatureInfo,
 }
 
 void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
-                                raw_string_ostream &OS) {
+                                raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -360,7 +370,7 @@ void PrintResourceFormat(DxilResourceBase &res, unsigned alignment,
 }
 
 void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
-                             raw_string_ostream &OS) {
+                             raw_ostream &OS) {
   switch (res.GetClass()) {
   case DxilResourceBase::Class::CBuffer:
   case DxilResourceBase::Class::Sampler:
@@ -400,7 +410,7 @@ void PrintResourceDim(DxilResourceBase &res, unsigned alignment,
   }
 }
 
-void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
+void PrintResourceBinding(DxilResourceBase &res, raw_ostream &OS,
                                  StringRef comment) {
   OS << comment << " " << left_justify(res.GetGlobalName(), 31);
 
@@ -426,7 +436,7 @@ void PrintResourceBinding(DxilResourceBase &res, raw_string_ostream &OS,
     OS << right_justify("unbounded", 6) << "\n";
 }
 
-void PrintResourceBindings(DxilModule &M, raw_string_ostream &OS,
+void PrintResourceBindings(DxilModule &M, raw_ostream &OS,
                                   StringRef comment) {
   OS << comment << "\n"
      << comment << " Resource Bindings:\n"
@@ -453,6 +463,92 @@ void PrintResourceBindings(DxilModule &M, raw_string_ostream &OS,
   OS << comment << "\n";
 }
 
+void PrintGroupSharedMemory(DxilModule &M, raw_ostream &OS,
+                            StringRef comment) {
+  Module *pModule = M.GetModule();
+  const DataLayout &DL = pModule->getDataLayout();
+  unsigned total = 0;
+  bool bAny = false;
+  for (GlobalVariable &GV : pModule->globals()) {
+    if (!dxilutil::IsSharedMemoryGlobal(&GV))
+      continue;
+    if (!bAny) {
+      bAny = true;
+      OS << comment << "\n"
+         << comment << " Groupshared Memory:\n"
+         << comment << "\n"
+         << comment << " Name                                Bytes\n"
+         << comment << " ------------------------------ ----------\n";
+    }
+    unsigned size = DL.getTypeAllocSize(GV.getType()->getElementType());
+    OS << comment << " " << left_justify(GV.getName(), 31)
+       << right_justify(std::to_string(size), 10) << "\n";
+    total += size;
+  }
+  if (!bAny)
+    return;
+  OS << comment << "\n"
+     << comment << " " << left_justify("Total", 31)
+     << right_justify(std::to_string(total), 10) << "\n"
+     << comment << "\n";
+}
+
+void PrintShaderStatistics(DxilModule &M, raw_ostream &OS,
+                           StringRef comment) {
+  std::vector<Function *> entries;
+  if (M.GetShaderModel()->IsLib()) {
+    for (Function &F : M.GetModule()->functions()) {
+      if (!F.isDeclaration() && M.HasDxilFunctionProps(&F))
+        entries.push_back(&F);
+    }
+  } else if (M.GetEntryFunction()) {
+    entries.push_back(M.GetEntryFunction());
+  }
+
+  for (Function *F : entries) {
+    DxilShaderStatistics stats;
+    ComputeDxilShaderStatistics(M, F, &stats);
+    const std::pair<const char *, uint32_t> rows[] = {
+        {"Instructions", stats.InstructionCount},
+        {"ALU", stats.AluCount},
+        {"Transcendental", stats.TranscendentalCount},
+        {"Sample and gather", stats.SampleCount},
+        {"Load", stats.LoadCount},
+        {"Store", stats.StoreCount},
+        {"Atomic", stats.AtomicCount},
+        {"Wave", stats.WaveCount},
+        {"Barrier", stats.BarrierCount},
+        {"Max live values", stats.MaxLiveValues},
+        {"Groupshared bytes", stats.GroupSharedBytes},
+        {"Indexable temp bytes", stats.IndexableTempBytes},
+    };
+    OS << comment << "\n"
+       << comment << " Statistics for " << F->getName() << ":\n"
+       << comment << "\n";
+    for (auto &row : rows) {
+      OS << comment << " " << left_justify(row.first, 31)
+         << right_justify(std::to_string(row.second), 10) << "\n";
+    }
+  }
+  if (!entries.empty())
+    OS << comment << "\n";
+}
+
+void PrintEarlyDepthStencil(DxilModule &M, raw_ostream &OS,
+                            StringRef comment) {
+  if (!M.GetShaderModel()->IsPS())
+    return;
+  OS << comment << " Early depth-stencil: ";
+  const char *pReason;
+  if (M.m_ShaderFlags.GetForceEarlyDepthStencil())
+    OS << "forced";
+  else if (CanForceEarlyDepthStencil(M, &pReason))
+    OS << "not forced, and safe to force";
+  else
+    OS << "not forced, as " << pReason;
+  OS << "\n" << comment << "\n";
+}
+
 void PrintOutputsDependentOnViewId(
     llvm::raw_ostream &OS, llvm::StringRef comment, llvm::StringRef SetName,
     unsigned NumOutputs,
@@ -493,7 +589,7 @@ void PrintInputsContributingToOutputs(
   }
 }
 
-void PrintViewIdState(DxilModule &M, raw_string_ostream &OS,
+void PrintViewIdState(DxilModule &M, raw_ostream &OS,
                              StringRef comment) {
   if (!M.GetModule()->getNamedMetadata("dx.viewIdState"))
     return;
@@ -561,7 +657,7 @@ void PrintViewIdState(DxilModule &M, raw_string_ostream &OS,
 }
 
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys,
-                              raw_string_ostream &OS, StringRef comment,
+                              raw_ostream &OS, StringRef comment,
                               StringRef varName, unsigned offset,
                               unsigned indent, unsigned arraySize,
                               unsigned sizeOfStruct = 0);
@@ -597,7 +693,7 @@ void PrintTypeAndName(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 }
 
 void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
-                             DxilTypeSystem &typeSys, raw_string_ostream &OS,
+                             DxilTypeSystem &typeSys, raw_ostream &OS,
                              StringRef comment, unsigned offset,
                              unsigned indent, unsigned offsetIndent,
                              unsigned sizeToPrint = 0) {
@@ -665,7 +761,7 @@ void PrintFieldLayout(llvm::Type *Ty, DxilFieldAnnotation &annotation,
 }
 
 void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys,
-                              raw_string_ostream &OS, StringRef comment,
+                              raw_ostream &OS, StringRef comment,
                               StringRef varName, unsigned offset,
                               unsigned indent, unsigned offsetIndent,
                               unsigned sizeOfStruct) {
@@ -697,7 +793,7 @@ void PrintStructLayout(StructType *ST, DxilTypeSystem &typeSys,
 void PrintStructBufferDefinition(DxilResource *buf,
                                         DxilTypeSystem &typeSys,
                                         const DataLayout &DL,
-                                        raw_string_ostream &OS,
+                                        raw_ostream &OS,
                                         StringRef comment) {
   const unsigned offsetIndent = 50;
 
@@ -747,7 +843,7 @@ void PrintStructBufferDefinition(DxilResource *buf,
 }
 
 void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
-                                   raw_string_ostream &OS, StringRef comment) {
+                                   raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   Value *GV = buf->GetGlobalSymbol();
   llvm::Type *Ty = GV->getType()->getPointerElementType();
@@ -774,7 +870,7 @@ void PrintTBufferDefinition(DxilResource *buf, DxilTypeSystem &typeSys,
 }
 
 void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
-                                   raw_string_ostream &OS, StringRef comment) {
+                                   raw_ostream &OS, StringRef comment) {
   const unsigned offsetIndent = 50;
   Value *GV = buf->GetGlobalSymbol();
   llvm::Type *Ty = GV->getType()->getPointerElementType();
@@ -801,7 +897,7 @@ void PrintCBufferDefinition(DxilCBuffer *buf, DxilTypeSystem &typeSys,
   OS << comment << "\n";
 }
 
-void PrintBufferDefinitions(DxilModule &M, raw_string_ostream &OS,
+void PrintBufferDefinitions(DxilModule &M, raw_ostream &OS,
                                    StringRef comment) {
   OS << comment << "\n"
      << comment << " Buffer Definitions:\n"
@@ -973,6 +1069,13 @@ static const char *OpCodeSignatures[] = {
 class DxcAssemblyAnnotationWriter : public llvm::AssemblyAnnotationWriter {
 public:
   ~DxcAssemblyAnnotationWriter() {}
+  __override void emitFunctionAnnot(const Function *F,
+                                    formatted_raw_ostream &OS) {
+    if (F->isDeclaration())
+      return;
+    OS << "; Estimated max live values: "
+       << dxilutil::EstimateMaxLiveValues(*F) << "\n";
+  }
   __override void printInfoComment(const Value &V, formatted_raw_ostream &OS) {
     const CallInst *CI = dyn_cast<const CallInst>(&V);
     if (!CI) {
@@ -1005,7 +1108,7 @@ public:
 
 void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
                                                     DXIL::ShaderKind shaderKind,
-                                                    raw_string_ostream &OS,
+                                                    raw_ostream &OS,
                                                     StringRef comment) {
   OS << comment << "\n"
      << comment << " Pipeline Runtime Information: \n"
@@ -1234,9 +1337,12 @@ void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
 
 
 namespace dxcutil {
-HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
+HRESULT Disassemble(IDxcBlob *pProgram, raw_ostream &Stream,
+                    StringRef FunctionName) {
   const char *pIL = (const char *)pProgram->GetBufferPointer();
   uint32_t pILLength = pProgram->GetBufferSize();
+  // Holds the debug info part if the container has it compressed.
+  std::vector<char> DebugPartStorage;
   if (const DxilContainerHeader *pContainer =
           IsDxilContainerLike(pIL, pILLength)) {
     if (!IsValidDxilContainer(pContainer, pILLength)) {
@@ -1287,22 +1393,22 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
       }
     }
 
-    it = std::find_if(begin(pContainer), end(pContainer),
-                      DxilPartIsType(DFCC_DXIL));
-    if (it == end(pContainer)) {
+    // Use dbg module if exist. A /Qsidecar container has only the dbg module.
+    const DxilPartHeader *pProgramPart =
+        GetDxilPartByType(pContainer, DFCC_DXIL);
+    if (GetDxilPartByType(pContainer, DFCC_ShaderDebugInfoDXIL) ||
+        GetDxilPartByType(pContainer, DFCC_ShaderDebugInfoCompressed)) {
+      pProgramPart = GetDxilDebugInfoPart(pContainer, DebugPartStorage);
+      if (pProgramPart == nullptr)
+        return DXC_E_CONTAINER_INVALID;
+    }
+    if (pProgramPart == nullptr) {
       return DXC_E_CONTAINER_MISSING_DXIL;
     }
 
-    DxilPartIterator dbgit =
-        std::find_if(begin(pContainer), end(pContainer),
-                     DxilPartIsType(DFCC_ShaderDebugInfoDXIL));
-    // Use dbg module if exist.
-    if (dbgit != end(pContainer))
-      it = dbgit;
-
     const DxilProgramHeader *pProgramHeader =
-        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(*it));
-    if (!IsValidDxilProgramHeader(pProgramHeader, (*it)->PartSize)) {
+        reinterpret_cast<const DxilProgramHeader *>(GetDxilPartData(pProgramPart));
+    if (!IsValidDxilProgramHeader(pProgramHeader, pProgramPart->PartSize)) {
       return DXC_E_CONTAINER_INVALID;
     }
 
@@ -1342,10 +1448,22 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
                        /*comment*/ ";");
     PrintBufferDefinitions(dxilModule, Stream, /*comment*/ ";");
     PrintResourceBindings(dxilModule, Stream, /*comment*/ ";");
+    PrintGroupSharedMemory(dxilModule, Stream, /*comment*/ ";");
     PrintViewIdState(dxilModule, Stream, /*comment*/ ";");
+    PrintShaderStatistics(dxilModule, Stream, /*comment*/ ";");
+    PrintEarlyDepthStencil(dxilModule, Stream, /*comment*/ ";");
   }
   DxcAssemblyAnnotationWriter w;
-  pModule->print(Stream, &w);
+  if (FunctionName.empty()) {
+    pModule->print(Stream, &w);
+  } else {
+    // Print only the requested function, so very large modules needn't be
+    // printed whole to look at one part of them.
+    Function *F = pModule->getFunction(FunctionName);
+    if (F == nullptr)
+      return E_INVALIDARG;
+    F->print(Stream, &w);
+  }
   Stream.flush();
   return S_OK;
 }
@@ -16,12 +16,15 @@
 #include "dxc/Support/Global.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/dxcapi.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/raw_ostream.h"
 #include "dxcutil.h"
 
 #include "dxc/Support/dxcfilesystem.h"
 #include "dxc/Support/Unicode.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include <cwctype>
+#include <unordered_map>
 
 using namespace llvm;
 using namespace hlsl;
@@ -208,10 +211,89 @@ private:
     CComPtr<IDxcBlob> Blob;
     CComPtr<IStream> BlobStream;
     std::wstring Name;
+    size_t ContentHash;
     IncludedFile(std::wstring &&name, IDxcBlob *pBlob, IStream *pStream)
-      : Name(name), Blob(pBlob), BlobStream(pStream) { }
+      : Name(name), Blob(pBlob), BlobStream(pStream),
+        ContentHash(HashContents(pBlob)) { }
   };
   llvm::SmallVector<IncludedFile, 4> m_includedFiles;
+  std::unordered_map<std::wstring, size_t> m_includedFileIndex;
+  // Clang tells files apart by the index in their handle, so every spelling
+  // of a file must resolve to the same entry for #pragma once and include
+  // guards to hold across spellings. Included files are also found by their
+  // canonical name, and by that name folded to lower case when the contents
+  // are the same.
+  std::unordered_map<std::wstring, size_t> m_canonicalFileIndex;
+  std::unordered_map<std::wstring, size_t> m_foldedFileIndex;
+  // Files the include handler didn't load, with the error returned for them.
+  // Clang looks a file up by attributes before opening it, and again for each
+  // include of it, so misses are remembered to ask the handler only once.
+  std::unordered_map<std::wstring, DWORD> m_missingFiles;
+
+  static size_t HashContents(IDxcBlob *pBlob) {
+    return llvm::hash_value(llvm::StringRef(
+        (const char *)pBlob->GetBufferPointer(), pBlob->GetBufferSize()));
+  }
+
+  static bool IsSameContents(const IncludedFile &file, IDxcBlob *pBlob) {
+    size_t size = pBlob->GetBufferSize();
+    return file.Blob->GetBufferSize() == size &&
+           file.ContentHash == HashContents(pBlob) &&
+           0 == memcmp(file.Blob->GetBufferPointer(),
+                       pBlob->GetBufferPointer(), size);
+  }
+
+  // Unifies separators and resolves '.' and '..' components, so that
+  // ./inc/../a.h and a.h name the same file.
+  static std::wstring GetCanonicalName(LPCWSTR lpFileName) {
+    std::wstring result;
+    LPCWSTR p = lpFileName;
+    while (*p == L'\\' || *p == L'/') {
+      result += L'\\';
+      ++p;
+    }
+    const size_t rootLen = result.size();
+    std::vector<size_t> componentStarts;
+    while (*p) {
+      LPCWSTR end = p;
+      while (*end && *end != L'\\' && *end != L'/')
+        ++end;
+      size_t len = end - p;
+      if (len == 2 && p[0] == L'.' && p[1] == L'.' &&
+          !componentStarts.empty() &&
+          0 != result.compare(componentStarts.back(), std::wstring::npos,
+                              L"..")) {
+        result.resize(componentStarts.back() == rootLen
+                          ? rootLen
+                          : componentStarts.back() - 1);
+        componentStarts.pop_back();
+      } else if (len != 0 && !(len == 1 && p[0] == L'.')) {
+        if (result.size() > rootLen)
+          result += L'\\';
+        componentStarts.push_back(result.size());
+        result.append(p, len);
+      }
+      p = *end ? end + 1 : end;
+    }
+    return result;
+  }
+
+  static std::wstring FoldCase(std::wstring name) {
+    for (wchar_t &c : name)
+      c = std::towlower(c);
+    return name;
+  }
+
+  size_t AddIncludedFile(std::wstring &&name, IDxcBlob *pBlob, IStream *pStream) {
+    size_t index = m_includedFiles.size();
+    m_missingFiles.erase(name);
+    m_includedFileIndex[name] = index;
+    std::wstring canonicalName = GetCanonicalName(name.c_str());
+    m_foldedFileIndex.emplace(FoldCase(canonicalName), index);
+    m_canonicalFileIndex.emplace(std::move(canonicalName), index);
+    m_includedFiles.emplace_back(std::move(name), pBlob, pStream);
+    return index;
+  }
 
   static bool IsDirOf(LPCWSTR lpDir, size_t dirLen, const std::wstring &fileName) {
     if (fileName.size() <= dirLen) return false;
@@ -248,11 +330,21 @@ private:
     return INVALID_HANDLE_VALUE;
   }
   DWORD TryFindOrOpen(LPCWSTR lpFileName, size_t &index) {
-    for (size_t i = 0; i < m_includedFiles.size(); ++i) {
-      if (0 == wcscmp(lpFileName, m_includedFiles[i].Name.data())) {
-        index = i;
-        return ERROR_SUCCESS;
-      }
+    auto found = m_includedFileIndex.find(lpFileName);
+    if (found != m_includedFileIndex.end()) {
+      index = found->second;
+      return ERROR_SUCCESS;
+    }
+    auto missing = m_missingFiles.find(lpFileName);
+    if (missing != m_missingFiles.end()) {
+      return missing->second;
+    }
+    std::wstring canonicalName = GetCanonicalName(lpFileName);
+    auto canonical = m_canonicalFileIndex.find(canonicalName);
+    if (canonical != m_canonicalFileIndex.end()) {
+      index = canonical->second;
+      m_includedFileIndex[lpFileName] = index;
+      return ERROR_SUCCESS;
     }
 
     if (m_includeLoader.p != nullptr) {
@@ -263,6 +355,7 @@ private:
       CComPtr<::IDxcBlob> fileBlob;
       HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
       if (FAILED(hr)) {
+        m_missingFiles[lpFileName] = ERROR_UNHANDLED_EXCEPTION;
         return ERROR_UNHANDLED_EXCEPTION;
       }
       if (fileBlob.p != nullptr) {
@@ -270,12 +363,18 @@ private:
         if (FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, &fileBlobEncoded))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
+        auto folded = m_foldedFileIndex.find(FoldCase(canonicalName));
+        if (folded != m_foldedFileIndex.end() &&
+            IsSameContents(m_includedFiles[folded->second], fileBlobEncoded)) {
+          index = folded->second;
+          m_includedFileIndex[lpFileName] = index;
+          return ERROR_SUCCESS;
+        }
         CComPtr<IStream> fileStream;
         if (FAILED(hlsl::CreateReadOnlyBlobStream(fileBlobEncoded, &fileStream))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
-        m_includedFiles.emplace_back(std::wstring(lpFileName), fileBlobEncoded, fileStream);
-        index = m_includedFiles.size() - 1;
+        index = AddIncludedFile(std::wstring(lpFileName), fileBlobEncoded, fileStream);
 
         if (m_bDisplayIncludeProcess) {
           std::string openFileStr;
@@ -290,6 +389,7 @@ private:
         }
         return ERROR_SUCCESS;
       }
+      m_missingFiles[lpFileName] = ERROR_NOT_FOUND;
     }
     return ERROR_NOT_FOUND;
   }
@@ -311,7 +411,7 @@ public:
         m_pOutputStreamName(nullptr) {
     MakeAbsoluteOrCurDirRelativeW(m_pSourceName, m_pAbsSourceName);
     IFT(CreateReadOnlyBlobStream(m_pSource, &m_pSourceStream));
-    m_includedFiles.push_back(IncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream));
+    AddIncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream);
   }
   void EnableDisplayIncludeProcess() override {
     m_bDisplayIncludeProcess = true;
@@ -377,6 +477,17 @@ public:
     }
   }
 
+  unsigned GetIncludedFileCount() override {
+    return m_includedFiles.size();
+  }
+
+  void GetIncludedFile(unsigned index, LPCWSTR *ppName,
+                       IDxcBlob **ppBlob) override {
+    DXASSERT_NOMSG(index < m_includedFiles.size());
+    *ppName = m_includedFiles[index].Name.c_str();
+    m_includedFiles[index].Blob.CopyTo(ppBlob);
+  }
+
   HRESULT RegisterOutputStream(LPCWSTR pName, IStream *pStream) override {
     DXASSERT(m_pOutputStream.p == nullptr, "else multiple outputs registered");
     m_pOutputStream = pStream;
@@ -385,6 +496,21 @@ public:
     return S_OK;
   }
 
+  HRESULT RegisterInputBlob(LPCWSTR pName, IDxcBlob *pBlob) override {
+    if (m_includedFiles.size() == MaxIncludedFiles) {
+      return HRESULT_FROM_WIN32(ERROR_OUT_OF_STRUCTURES);
+    }
+    std::wstring nameStore;
+    MakeAbsoluteOrCurDirRelativeW(pName, nameStore);
+    CComPtr<IStream> pStream;
+    HRESULT hr = hlsl::CreateReadOnlyBlobStream(pBlob, &pStream);
+    if (FAILED(hr)) {
+      return hr;
+    }
+    AddIncludedFile(std::wstring(pName), pBlob, pStream);
+    return S_OK;
+  }
+
   __override ~DxcArgsFileSystemImpl() { };
   __override BOOL FindNextFileW(
     _In_   HANDLE hFindFile,
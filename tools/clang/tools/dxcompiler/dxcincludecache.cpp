@@ -0,0 +1,213 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcincludecache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements an include file cache that can be shared across compilations.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/dxcapi.h"
+#include <cwctype>
+#include <string>
+#include <unordered_map>
+
+using namespace hlsl;
+
+namespace {
+
+class DxcIncludeCache : public IDxcIncludeCache {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+
+  // A file that the include handler could not load has no blob and keeps
+  // the result the handler returned, so that search paths probed by every
+  // compilation don't go back to the handler for each miss.
+  struct CachedFile {
+    CComPtr<IDxcBlobEncoding> Blob;
+    HRESULT MissResult;
+    bool HasFileData;
+    FILETIME LastWriteTime;
+    DWORD FileSizeHigh;
+    DWORD FileSizeLow;
+  };
+
+  class CacheLock {
+    CRITICAL_SECTION &m_cs;
+  public:
+    CacheLock(CRITICAL_SECTION &cs) : m_cs(cs) { EnterCriticalSection(&m_cs); }
+    ~CacheLock() { LeaveCriticalSection(&m_cs); }
+  };
+
+  CRITICAL_SECTION m_cs;
+  std::unordered_map<std::wstring, CachedFile> m_files;
+
+  // Keys are full paths folded to lower case, so that the different
+  // spellings that include lookup produces for one file share an entry.
+  static void GetKey(LPCWSTR pFilename, std::wstring &key) {
+    DWORD len = GetFullPathNameW(pFilename, 0, nullptr, nullptr);
+    if (len == 0) {
+      key = pFilename;
+    } else {
+      key.resize(len);
+      len = GetFullPathNameW(pFilename, len, &key[0], nullptr);
+      key.resize(len);
+    }
+    for (wchar_t &c : key)
+      c = std::towlower(c);
+  }
+
+  static bool IsCurrent(const CachedFile &file, bool hasFileData,
+                        const WIN32_FILE_ATTRIBUTE_DATA &fileData) {
+    if (file.HasFileData != hasFileData)
+      return false;
+    if (!hasFileData)
+      return true;
+    return file.FileSizeHigh == fileData.nFileSizeHigh &&
+           file.FileSizeLow == fileData.nFileSizeLow &&
+           CompareFileTime(&file.LastWriteTime, &fileData.ftLastWriteTime) == 0;
+  }
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcIncludeCache)
+
+  DxcIncludeCache(IMalloc *pMalloc) : m_dwRef(0), m_pMalloc(pMalloc) {
+    InitializeCriticalSection(&m_cs);
+  }
+  ~DxcIncludeCache() {
+    DeleteCriticalSection(&m_cs);
+  }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeCache>(this, iid, ppvObject);
+  }
+
+  HRESULT LoadSource(IDxcIncludeHandler *pIncludeHandler, LPCWSTR pFilename,
+                     IDxcBlob **ppIncludeSource) {
+    // Entries are allocated with the cache's allocator, as they outlive the
+    // compilation that created them.
+    DxcThreadMalloc TM(m_pMalloc);
+    *ppIncludeSource = nullptr;
+    try {
+      std::wstring key;
+      GetKey(pFilename, key);
+      WIN32_FILE_ATTRIBUTE_DATA fileData;
+      bool hasFileData = FALSE != GetFileAttributesExW(
+                                      key.c_str(), GetFileExInfoStandard,
+                                      &fileData);
+      {
+        CacheLock lock(m_cs);
+        auto found = m_files.find(key);
+        if (found != m_files.end() &&
+            IsCurrent(found->second, hasFileData, fileData)) {
+          if (found->second.Blob == nullptr)
+            return found->second.MissResult;
+          *ppIncludeSource = found->second.Blob;
+          (*ppIncludeSource)->AddRef();
+          return S_OK;
+        }
+      }
+
+      CComPtr<IDxcBlob> pBlob;
+      HRESULT hr = pIncludeHandler->LoadSource(pFilename, &pBlob);
+      // Running out of memory says nothing about the file.
+      if (hr == E_OUTOFMEMORY)
+        return hr;
+
+      CachedFile file;
+      file.MissResult = hr;
+      if (SUCCEEDED(hr) && pBlob != nullptr) {
+        IFR(DxcGetBlobAsUtf8(pBlob, &file.Blob));
+      }
+      file.HasFileData = hasFileData;
+      if (hasFileData) {
+        file.LastWriteTime = fileData.ftLastWriteTime;
+        file.FileSizeHigh = fileData.nFileSizeHigh;
+        file.FileSizeLow = fileData.nFileSizeLow;
+      }
+      if (file.Blob != nullptr) {
+        *ppIncludeSource = file.Blob;
+        (*ppIncludeSource)->AddRef();
+      }
+
+      CacheLock lock(m_cs);
+      m_files[key] = file;
+      return file.Blob != nullptr ? S_OK : hr;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  __override HRESULT STDMETHODCALLTYPE CreateIncludeHandler(
+      _In_ IDxcIncludeHandler *pIncludeHandler,
+      _COM_Outptr_ IDxcIncludeHandler **ppResult) override;
+
+  __override HRESULT STDMETHODCALLTYPE Clear() override {
+    DxcThreadMalloc TM(m_pMalloc);
+    CacheLock lock(m_cs);
+    m_files.clear();
+    return S_OK;
+  }
+};
+
+class DxcCachingIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<DxcIncludeCache> m_pCache;
+  CComPtr<IDxcIncludeHandler> m_pIncludeHandler;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcCachingIncludeHandler)
+
+  DxcCachingIncludeHandler(IMalloc *pMalloc, DxcIncludeCache *pCache,
+                           IDxcIncludeHandler *pIncludeHandler)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_pCache(pCache),
+        m_pIncludeHandler(pIncludeHandler) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+      _In_ LPCWSTR pFilename,
+      _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    return m_pCache->LoadSource(m_pIncludeHandler, pFilename, ppIncludeSource);
+  }
+};
+
+HRESULT STDMETHODCALLTYPE DxcIncludeCache::CreateIncludeHandler(
+    _In_ IDxcIncludeHandler *pIncludeHandler,
+    _COM_Outptr_ IDxcIncludeHandler **ppResult) {
+  if (pIncludeHandler == nullptr || ppResult == nullptr)
+    return E_INVALIDARG;
+  *ppResult = nullptr;
+  DxcThreadMalloc TM(m_pMalloc);
+  CComPtr<DxcCachingIncludeHandler> result =
+      DxcCachingIncludeHandler::Alloc(m_pMalloc, this, pIncludeHandler);
+  if (result.p == nullptr)
+    return E_OUTOFMEMORY;
+  *ppResult = result.Detach();
+  return S_OK;
+}
+
+} // namespace
+
+HRESULT CreateDxcIncludeCache(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  CComPtr<DxcIncludeCache> result =
+      DxcIncludeCache::Alloc(DxcGetThreadMallocNoRef());
+  if (result == nullptr) {
+    *ppv = nullptr;
+    return E_OUTOFMEMORY;
+  }
+
+  return result.p->QueryInterface(riid, ppv);
+}
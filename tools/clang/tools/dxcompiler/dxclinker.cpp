@@ -10,7 +10,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/Support/WinIncludes.h"
+#include "dxc/HLSL/DxcTimeReport.h"
 #include "dxc/HLSL/DxilContainer.h"
+#include "dxc/Support/AllocationStats.h"
 #include "dxc/Support/ErrorCodes.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/FileIOHelper.h"
@@ -21,6 +23,9 @@
 
 #include "llvm/ADT/SmallVector.h"
 #include <algorithm>
+#include <atomic>
+#include <list>
+#include <thread>
 
 #include "dxc/HLSL/DxilLinker.h"
 #include "dxc/HLSL/DxilValidation.h"
@@ -42,7 +47,10 @@ using namespace llvm;
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
-class DxcLinker : public IDxcLinker, public IDxcContainerEvent {
+class DxcLinker : public IDxcLinker,
+                  public IDxcLinkerBatch,
+                  public IDxcContainerEvent,
+                  public IDxcCompilerEvents {
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcLinker)
@@ -68,6 +76,23 @@ public:
           *ppResult // Linker output status, buffer, and errors
   );
 
+  // Links several entry points from the same libraries.
+  __override HRESULT STDMETHODCALLTYPE LinkBatch(
+      _In_ UINT32 entryCount, // Number of entry points
+      _In_count_(entryCount)
+          const LPCWSTR *pEntryNames, // Array of entry point names
+      _In_count_(entryCount)
+          const LPCWSTR *pTargetProfiles, // Shader profile for each entry
+      _In_count_(libCount)
+          const LPCWSTR *pLibNames, // Array of library names to link
+      UINT32 libCount,              // Number of libraries to link
+      _In_count_(argCount)
+          const LPCWSTR *pArguments, // Array of pointers to arguments
+      _In_ UINT32 argCount,          // Number of arguments
+      _Out_writes_(entryCount) IDxcOperationResult *
+          *ppResults // Linker output for each entry point
+  );
+
   __override HRESULT STDMETHODCALLTYPE RegisterDxilContainerEventHandler(
       IDxcContainerEventsHandler *pHandler, UINT64 *pCookie) {
     DxcThreadMalloc TM(m_pMalloc);
@@ -86,14 +111,20 @@ public:
     return S_OK;
   }
 
+  __override HRESULT STDMETHODCALLTYPE
+  SetEventsCallback(_In_opt_ IDxcCompilerEventsCallback *pCallback) {
+    m_pEventsCallback = pCallback;
+    return S_OK;
+  }
+
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcLinker>(this, riid, ppvObject);
+    return DoBasicQueryInterface<IDxcLinker, IDxcLinkerBatch,
+                                 IDxcCompilerEvents>(this, riid, ppvObject);
   }
 
   void Initialize() {
-    UINT32 valMajor, valMinor;
-    dxcutil::GetValidatorVersion(&valMajor, &valMinor);
-    m_pLinker.reset(DxilLinker::CreateLinker(m_Ctx, valMajor, valMinor));
+    dxcutil::GetValidatorVersion(&m_valMajor, &m_valMinor);
+    m_pLinker.reset(DxilLinker::CreateLinker(m_Ctx, m_valMajor, m_valMinor));
   }
 
   ~DxcLinker() {
@@ -105,10 +136,89 @@ private:
   DXC_MICROCOM_TM_REF_FIELDS()
   LLVMContext m_Ctx;
   std::unique_ptr<DxilLinker> m_pLinker;
+  UINT32 m_valMajor, m_valMinor;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
+  CComPtr<IDxcCompilerEventsCallback> m_pEventsCallback;
   std::vector<CComPtr<IDxcBlob>> m_blobs; // Keep blobs live for lazy load.
+  std::vector<std::string> m_libNames;    // Name of each blob in m_blobs.
+  // Containers from recent links that produced no diagnostics, most recently
+  // used last. A library name can't be registered twice, so the names stand
+  // for the library contents in the key.
+  static const size_t kMaxCachedLinks = 16;
+  std::list<std::pair<std::string, CComPtr<IDxcBlob>>> m_linkCache;
+
+  IDxcBlob *FindCachedLink(const std::string &key);
+  void AddCachedLink(const std::string &key, IDxcBlob *pBlob);
+  void OnDxilContainerBuilt(CComPtr<IDxcBlob> &pOutputBlob);
+
+  // Output of linking one entry point, before the container event handler
+  // has seen it.
+  struct LinkOutput {
+    CComPtr<IDxcBlob> pOutputBlob;
+    CComPtr<AbstractMemoryStream> pDiagStream;
+    std::string warnings;
+    bool hasErrorOccurred = false;
+    bool bValidated = false;
+  };
+  static void LinkEntry(DxilLinker &linker, LLVMContext &Ctx,
+                        const char *pEntryName, const char *pTargetProfile,
+                        const std::vector<std::string> &libNames,
+                        IDxcCompilerEventsCallback *pEventsCallback,
+                        LinkOutput &output);
+  void FinishLink(const std::string &cacheKey, LinkOutput &output,
+                  IDxcOperationResult **ppResult);
+  bool LoadLibraries(DxilLinker &linker, LLVMContext &Ctx,
+                     const std::vector<std::string> &libNames);
 };
 
+static std::string GetLinkCacheKey(const char *pEntryName,
+                                   const char *pTargetProfile,
+                                   const std::vector<std::string> &libNames,
+                                   const LPCWSTR *pArguments,
+                                   UINT32 argCount) {
+  std::string cacheKey = pEntryName;
+  cacheKey += '\0';
+  cacheKey += pTargetProfile;
+  for (const std::string &libName : libNames) {
+    cacheKey += '\0';
+    cacheKey += libName;
+  }
+  for (unsigned i = 0; i < argCount; i++) {
+    cacheKey += '\0';
+    cacheKey += CW2A(pArguments[i], CP_UTF8).m_psz;
+  }
+  return cacheKey;
+}
+
+IDxcBlob *DxcLinker::FindCachedLink(const std::string &key) {
+  for (auto it = m_linkCache.begin(), e = m_linkCache.end(); it != e; ++it) {
+    if (it->first == key) {
+      m_linkCache.splice(m_linkCache.end(), m_linkCache, it);
+      return m_linkCache.back().second;
+    }
+  }
+  return nullptr;
+}
+
+void DxcLinker::AddCachedLink(const std::string &key, IDxcBlob *pBlob) {
+  if (m_linkCache.size() == kMaxCachedLinks)
+    m_linkCache.pop_front();
+  m_linkCache.emplace_back(key, pBlob);
+}
+
+void DxcLinker::OnDxilContainerBuilt(CComPtr<IDxcBlob> &pOutputBlob) {
+  // Callback after valid DXIL is produced
+  CComPtr<IDxcBlob> pTargetBlob;
+  if (m_pDxcContainerEventsHandler != nullptr) {
+    HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
+        pOutputBlob, &pTargetBlob);
+    if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
+      std::swap(pOutputBlob, pTargetBlob);
+    }
+  }
+  // TODO: DFCC_ShaderDebugName
+}
+
 HRESULT
 DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
                            _In_ IDxcBlob *pBlob       // Library to add.
@@ -139,6 +249,7 @@ DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
     if (m_pLinker->RegisterLib(pUtf8LibName.m_psz, std::move(pModule),
                                std::move(pDebugModule))) {
       m_blobs.emplace_back(pBlob);
+      m_libNames.emplace_back(pUtf8LibName.m_psz);
       return S_OK;
     } else {
       return E_INVALIDARG;
@@ -148,6 +259,128 @@ DxcLinker::RegisterLibrary(_In_opt_ LPCWSTR pLibName, // Name of the library.
   }
 }
 
+void DxcLinker::LinkEntry(DxilLinker &linker, LLVMContext &Ctx,
+                          const char *pEntryName, const char *pTargetProfile,
+                          const std::vector<std::string> &libNames,
+                          IDxcCompilerEventsCallback *pEventsCallback,
+                          LinkOutput &output) {
+  CComPtr<IMalloc> pMalloc;
+  CComPtr<AbstractMemoryStream> pOutputStream;
+
+  // An events callback is sent the phases and passes of the link.
+  std::unique_ptr<TimeReport> pTimeReport;
+  TimeReportEventsListener eventsListener(pEventsCallback, nullptr);
+  if (pEventsCallback) {
+    pTimeReport.reset(new TimeReport(DxcGetThreadMallocNoRef()));
+    pTimeReport->EnableIRCounts();
+    pTimeReport->SetListener(&eventsListener);
+  }
+  TimeReportScope timeReportScope(pTimeReport.get());
+  DxcThreadMalloc TMReport(pTimeReport ? pTimeReport->GetMalloc()
+                                       : DxcGetThreadMallocNoRef());
+
+  // Detach previous libraries.
+  linker.DetachAll();
+
+  IFT(CoGetMalloc(1, &pMalloc));
+  IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+
+  IFT(CreateMemoryStream(pMalloc, &output.pDiagStream));
+  raw_stream_ostream DiagStream(output.pDiagStream);
+  llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
+  PrintDiagnosticContext DiagContext(DiagPrinter);
+  Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
+                           &DiagContext, true);
+
+  // Attach libraries.
+  bool bSuccess = true;
+  for (const std::string &libName : libNames) {
+    bSuccess &= linker.AttachLib(libName);
+  }
+
+  output.hasErrorOccurred = !bSuccess;
+  if (bSuccess) {
+    std::unique_ptr<Module> pM;
+    {
+      TimeReportPhase linkPhase("link");
+      pM = linker.Link(pEntryName, pTargetProfile);
+    }
+    if (pM) {
+      const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
+          new clang::DiagnosticIDs);
+      IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+          new clang::DiagnosticOptions();
+      // Construct our diagnostic client.
+      clang::TextDiagnosticPrinter *DiagClient =
+          new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
+      clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
+
+      raw_stream_ostream outStream(pOutputStream.p);
+      // Create bitcode of M.
+      WriteBitcodeToFile(pM.get(), outStream);
+      outStream.flush();
+
+      // Validation.
+      TimeReportPhase containerPhase("container");
+      HRESULT valHR = dxcutil::ValidateAndAssembleToContainer(
+          std::move(pM), output.pOutputBlob, pMalloc, SerializeDxilFlags::None,
+          pOutputStream,
+          /*bDebugInfo*/ false, Diag);
+
+      output.bValidated = SUCCEEDED(valHR);
+      output.hasErrorOccurred = Diag.hasErrorOccurred();
+
+    } else {
+      output.hasErrorOccurred = true;
+    }
+  }
+  DiagStream.flush();
+  // The diagnostic context goes away with this frame.
+  Ctx.setDiagnosticHandler(nullptr, nullptr);
+}
+
+void DxcLinker::FinishLink(const std::string &cacheKey, LinkOutput &output,
+                           IDxcOperationResult **ppResult) {
+  if (output.bValidated) {
+    if (!output.hasErrorOccurred && output.warnings.empty() &&
+        output.pDiagStream->GetPtrSize() == 0) {
+      AddCachedLink(cacheKey, output.pOutputBlob);
+    }
+    OnDxilContainerBuilt(output.pOutputBlob);
+  }
+  CComPtr<IStream> pStream = output.pDiagStream;
+  dxcutil::CreateOperationResultFromOutputs(output.pOutputBlob, pStream,
+                                            output.warnings,
+                                            output.hasErrorOccurred, ppResult);
+}
+
+// Registers the named libraries with a linker that doesn't share the
+// registered modules' context. The modules are parsed again from the
+// registered blobs, lazily as the linker needs their functions.
+bool DxcLinker::LoadLibraries(DxilLinker &linker, LLVMContext &Ctx,
+                              const std::vector<std::string> &libNames) {
+  for (const std::string &libName : libNames) {
+    if (linker.HasLibNameRegistered(libName))
+      continue;
+    auto found = std::find(m_libNames.begin(), m_libNames.end(), libName);
+    if (found == m_libNames.end())
+      continue; // AttachLib reports the missing library.
+    IDxcBlob *pBlob = m_blobs[found - m_libNames.begin()];
+
+    std::unique_ptr<llvm::Module> pModule, pDebugModule;
+    std::string diag;
+    raw_string_ostream DiagStream(diag);
+    if (FAILED(ValidateLoadModuleFromContainerLazy(
+            pBlob->GetBufferPointer(), pBlob->GetBufferSize(), pModule,
+            pDebugModule, Ctx, Ctx, DiagStream)))
+      return false;
+    if (!linker.RegisterLib(libName, std::move(pModule),
+                            std::move(pDebugModule)))
+      return false;
+  }
+  return true;
+}
+
 // Links the shader and produces a shader blob that the Direct3D runtime can
 // use.
 HRESULT STDMETHODCALLTYPE DxcLinker::Link(
@@ -167,87 +400,192 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
   CW2A pUtf8EntryPoint(pEntryName, CP_UTF8);
   CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
   // TODO: read and validate options.
-
-  CComPtr<AbstractMemoryStream> pOutputStream;
-
-  // Detach previous libraries.
-  m_pLinker->DetachAll();
+  bool bAllocationStats = false;
+  for (unsigned i = 0; i < argCount; i++) {
+    if (wcscmp(pArguments[i], L"-falloc-stats") == 0)
+      bAllocationStats = true;
+  }
 
   HRESULT hr = S_OK;
   try {
-    CComPtr<IMalloc> pMalloc;
-    CComPtr<IDxcBlob> pOutputBlob;
-    CComPtr<AbstractMemoryStream> pDiagStream;
+    // With -falloc-stats, allocations are counted on their way to the user
+    // allocator.
+    CComPtr<AllocationStatsMalloc> pStatsMalloc;
+    if (bAllocationStats)
+      IFT(AllocationStatsMalloc::Create(m_pMalloc, &pStatsMalloc));
+    DxcThreadMalloc TMStats(pStatsMalloc ? pStatsMalloc.p : m_pMalloc.p);
+    auto setAllocationStats = [&]() {
+      if (pStatsMalloc) {
+        DxcAllocationStats allocationStats;
+        pStatsMalloc->GetStats(&allocationStats);
+        static_cast<DxcOperationResult *>(*ppResult)->SetAllocationStats(
+            allocationStats);
+      }
+    };
+
+    std::vector<std::string> libNames;
+    for (unsigned i = 0; i < libCount; i++)
+      libNames.emplace_back(CW2A(pLibNames[i], CP_UTF8).m_psz);
+
+    std::string cacheKey =
+        GetLinkCacheKey(pUtf8EntryPoint.m_psz, pUtf8TargetProfile.m_psz,
+                        libNames, pArguments, argCount);
+    IDxcBlob *pCachedBlob = FindCachedLink(cacheKey);
+    if (m_pEventsCallback)
+      m_pEventsCallback->OnCacheLookup(pCachedBlob != nullptr);
+    if (pCachedBlob) {
+      CComPtr<IDxcBlob> pOutputBlob = pCachedBlob;
+      OnDxilContainerBuilt(pOutputBlob);
+      CComPtr<IStream> pNoDiagStream;
+      dxcutil::CreateOperationResultFromOutputs(pOutputBlob, pNoDiagStream, "",
+                                                /*hasErrorOccurred*/ false,
+                                                ppResult);
+      setAllocationStats();
+      return S_OK;
+    }
 
-    IFT(CoGetMalloc(1, &pMalloc));
-    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+    LinkOutput output;
+    LinkEntry(*m_pLinker, m_Ctx, pUtf8EntryPoint.m_psz,
+              pUtf8TargetProfile.m_psz, libNames, m_pEventsCallback, output);
+    FinishLink(cacheKey, output, ppResult);
+    setAllocationStats();
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+  return hr;
+}
 
-    std::string warnings;
-    llvm::raw_string_ostream w(warnings);
-    IFT(CreateMemoryStream(pMalloc, &pDiagStream));
-    raw_stream_ostream DiagStream(pDiagStream);
-    llvm::DiagnosticPrinterRawOStream DiagPrinter(DiagStream);
-    PrintDiagnosticContext DiagContext(DiagPrinter);
-    m_Ctx.setDiagnosticHandler(PrintDiagnosticContext::PrintDiagnosticHandler,
-                               &DiagContext, true);
-
-    // Attach libraries.
-    bool bSuccess = true;
-    for (unsigned i = 0; i < libCount; i++) {
-      CW2A pUtf8LibName(pLibNames[i], CP_UTF8);
-      bSuccess &= m_pLinker->AttachLib(pUtf8LibName.m_psz);
+HRESULT STDMETHODCALLTYPE DxcLinker::LinkBatch(
+    _In_ UINT32 entryCount, // Number of entry points
+    _In_count_(entryCount)
+        const LPCWSTR *pEntryNames, // Array of entry point names
+    _In_count_(entryCount)
+        const LPCWSTR *pTargetProfiles, // Shader profile for each entry
+    _In_count_(libCount)
+        const LPCWSTR *pLibNames, // Array of library names to link
+    UINT32 libCount,              // Number of libraries to link
+    _In_count_(argCount)
+        const LPCWSTR *pArguments, // Array of pointers to arguments
+    _In_ UINT32 argCount,          // Number of arguments
+    _Out_writes_(entryCount) IDxcOperationResult *
+        *ppResults // Linker output for each entry point
+) {
+  if (ppResults == nullptr || entryCount == 0 || pEntryNames == nullptr ||
+      pTargetProfiles == nullptr || (libCount > 0 && pLibNames == nullptr) ||
+      (argCount > 0 && pArguments == nullptr))
+    return E_INVALIDARG;
+  for (UINT32 i = 0; i < entryCount; ++i) {
+    if (pTargetProfiles[i] == nullptr)
+      return E_INVALIDARG;
+    ppResults[i] = nullptr;
+  }
+
+  DxcThreadMalloc TM(m_pMalloc);
+  HRESULT hr = S_OK;
+  try {
+    std::vector<std::string> libNames;
+    for (unsigned i = 0; i < libCount; i++)
+      libNames.emplace_back(CW2A(pLibNames[i], CP_UTF8).m_psz);
+
+    std::vector<std::string> entryNames, profiles, cacheKeys;
+    std::vector<CComPtr<IDxcBlob>> cachedBlobs(entryCount);
+    std::vector<UINT32> pending; // Entries not found in the link cache.
+    for (UINT32 i = 0; i < entryCount; ++i) {
+      entryNames.emplace_back(
+          pEntryNames[i] ? CW2A(pEntryNames[i], CP_UTF8).m_psz : "");
+      profiles.emplace_back(CW2A(pTargetProfiles[i], CP_UTF8).m_psz);
+      cacheKeys.emplace_back(GetLinkCacheKey(entryNames[i].c_str(),
+                                             profiles[i].c_str(), libNames,
+                                             pArguments, argCount));
+      // Hold on to cached containers; linking the other entries may evict
+      // them from the cache.
+      cachedBlobs[i] = FindCachedLink(cacheKeys[i]);
+      if (m_pEventsCallback)
+        m_pEventsCallback->OnCacheLookup(cachedBlobs[i] != nullptr);
+      if (cachedBlobs[i] == nullptr)
+        pending.push_back(i);
     }
 
-    bool hasErrorOccurred = !bSuccess;
-    if (bSuccess) {
-      std::unique_ptr<Module> pM =
-          m_pLinker->Link(pUtf8EntryPoint.m_psz, pUtf8TargetProfile.m_psz);
-      if (pM) {
-        const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
-            new clang::DiagnosticIDs);
-        IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
-            new clang::DiagnosticOptions();
-        // Construct our diagnostic client.
-        clang::TextDiagnosticPrinter *DiagClient =
-            new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
-        clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
-
-        raw_stream_ostream outStream(pOutputStream.p);
-        // Create bitcode of M.
-        WriteBitcodeToFile(pM.get(), outStream);
-        outStream.flush();
-
-        // Validation.
-        HRESULT valHR = dxcutil::ValidateAndAssembleToContainer(
-            std::move(pM), pOutputBlob, pMalloc, SerializeDxilFlags::None,
-            pOutputStream,
-            /*bDebugInfo*/ false, Diag);
-
-        // Callback after valid DXIL is produced
-        if (SUCCEEDED(valHR)) {
-          CComPtr<IDxcBlob> pTargetBlob;
-          if (m_pDxcContainerEventsHandler != nullptr) {
-            HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
-                pOutputBlob, &pTargetBlob);
-            if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
-              std::swap(pOutputBlob, pTargetBlob);
+    // Each worker links on its own context, so it needs its own linker and
+    // its own copy of the library modules; the modules on m_Ctx are only
+    // used when linking on the calling thread.
+    std::vector<LinkOutput> outputs(entryCount);
+    std::vector<HRESULT> entryHRs(entryCount, S_OK);
+    unsigned threadCount =
+        std::min<unsigned>(std::thread::hardware_concurrency(), pending.size());
+    if (threadCount > 1) {
+      std::atomic<unsigned> nextPending(0);
+      IMalloc *pMalloc = m_pMalloc;
+      auto linkEntries = [&]() {
+        DxcThreadMalloc TM(pMalloc);
+        LLVMContext Ctx;
+        std::unique_ptr<DxilLinker> pLinker(
+            DxilLinker::CreateLinker(Ctx, m_valMajor, m_valMinor));
+        HRESULT hr = S_OK;
+        try {
+          if (!LoadLibraries(*pLinker, Ctx, libNames))
+            hr = E_INVALIDARG;
+        }
+        CATCH_CPP_ASSIGN_HRESULT();
+        HRESULT loadHR = hr;
+        for (unsigned i = nextPending++; i < pending.size();
+             i = nextPending++) {
+          UINT32 entry = pending[i];
+          hr = loadHR;
+          if (SUCCEEDED(hr)) {
+            try {
+              LinkEntry(*pLinker, Ctx, entryNames[entry].c_str(),
+                        profiles[entry].c_str(), libNames, m_pEventsCallback,
+                        outputs[entry]);
             }
+            CATCH_CPP_ASSIGN_HRESULT();
           }
-          // TODO: DFCC_ShaderDebugName
+          entryHRs[entry] = hr;
         }
+        // Make sure DxilLinker is released before LLVMContext.
+        pLinker.reset();
+      };
+      std::vector<std::thread> threads;
+      threads.reserve(threadCount);
+      for (unsigned i = 1; i < threadCount; ++i)
+        threads.emplace_back(linkEntries);
+      linkEntries();
+      for (std::thread &t : threads)
+        t.join();
+    } else {
+      for (UINT32 entry : pending) {
+        LinkEntry(*m_pLinker, m_Ctx, entryNames[entry].c_str(),
+                  profiles[entry].c_str(), libNames, m_pEventsCallback,
+                  outputs[entry]);
+      }
+    }
 
-        hasErrorOccurred = Diag.hasErrorOccurred();
-
-      } else {
-        hasErrorOccurred = true;
+    // Results are completed in entry order, so the container event handler
+    // is never called concurrently.
+    size_t pendingIndex = 0;
+    for (UINT32 i = 0; i < entryCount; ++i) {
+      if (pendingIndex < pending.size() && pending[pendingIndex] == i) {
+        ++pendingIndex;
+        IFT(entryHRs[i]);
+        FinishLink(cacheKeys[i], outputs[i], &ppResults[i]);
+        continue;
       }
+      CComPtr<IDxcBlob> pOutputBlob = cachedBlobs[i];
+      OnDxilContainerBuilt(pOutputBlob);
+      CComPtr<IStream> pNoDiagStream;
+      dxcutil::CreateOperationResultFromOutputs(pOutputBlob, pNoDiagStream, "",
+                                                /*hasErrorOccurred*/ false,
+                                                &ppResults[i]);
     }
-    DiagStream.flush();
-    CComPtr<IStream> pStream = pDiagStream;
-    dxcutil::CreateOperationResultFromOutputs(pOutputBlob, pStream, warnings,
-                                              hasErrorOccurred, ppResult);
   }
   CATCH_CPP_ASSIGN_HRESULT();
+  if (FAILED(hr)) {
+    for (UINT32 i = 0; i < entryCount; ++i) {
+      if (ppResults[i]) {
+        ppResults[i]->Release();
+        ppResults[i] = nullptr;
+      }
+    }
+  }
   return hr;
 }
 
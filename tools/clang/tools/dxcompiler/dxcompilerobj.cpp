@@ -24,10 +24,14 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/CodeGen/CodeGenAction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/Cancellation.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
 #include "dxc/HLSL/DxilRootSignature.h"
+#include "dxc/HLSL/DxcTimeReport.h"
+#include "dxc/Support/AllocationStats.h"
 #include "dxcutil.h"
+#include "dxccompilecache.h"
 #include "dxc/Support/dxcfilesystem.h"
 
 // SPIRV change starts
@@ -52,6 +56,11 @@
 #include "dxcetw.h"
 #include "dxillib.h"
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #define CP_UTF16 1200
 
@@ -62,6 +71,7 @@ using std::string;
 
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
+HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
 // This internal call allows the validator to avoid having to re-deserialize
 // the module. It trusts that the caller didn't make any changes and is
@@ -94,9 +104,147 @@ static void CreateOperationResultFromOutputs(
                                    ppResult);
 }
 
+// Lists the files a compilation read: the main source and then each include
+// in the order they were opened. Preprocessed source has no includes left, so
+// the files named by its #line directives are listed instead.
+static void GetDependencies(bool preprocessed, IDxcBlob *pUtf8Source,
+                            dxcutil::DxcArgsFileSystem *msfPtr,
+                            std::vector<std::string> &files) {
+  if (!preprocessed) {
+    for (unsigned i = 0, e = msfPtr->GetIncludedFileCount(); i < e; ++i) {
+      LPCWSTR pName;
+      CComPtr<IDxcBlob> pBlob;
+      msfPtr->GetIncludedFile(i, &pName, &pBlob);
+      files.emplace_back(Unicode::UTF16ToUTF8StringOrThrow(pName));
+    }
+    return;
+  }
+
+  std::set<std::string> seen;
+  StringRef source((const char *)pUtf8Source->GetBufferPointer(),
+                   pUtf8Source->GetBufferSize());
+  while (!source.empty()) {
+    StringRef line;
+    std::tie(line, source) = source.split('\n');
+    line = line.ltrim();
+    if (!line.startswith("#line"))
+      continue;
+    size_t quote = line.find('"');
+    if (quote == StringRef::npos)
+      continue;
+    // The preprocessor escapes the name as a string literal.
+    std::string name;
+    for (size_t i = quote + 1; i < line.size() && line[i] != '"'; ++i) {
+      if (line[i] == '\\' && i + 1 < line.size())
+        ++i;
+      name += line[i];
+    }
+    if (seen.insert(name).second)
+      files.emplace_back(std::move(name));
+  }
+}
+
+// Writes the files from GetDependencies one per line.
+static void CreateDependenciesBlob(const std::vector<std::string> &files,
+                                   _COM_Outptr_ IDxcBlobEncoding **ppBlob) {
+  std::string text;
+  for (const std::string &file : files) {
+    text += file;
+    text += '\n';
+  }
+  IFT(DxcCreateBlobWithEncodingOnHeapCopy(text.data(), text.size(), CP_UTF8,
+                                          ppBlob));
+}
+
+// Creates the main file buffer for the UTF-8 source. The source blob is held
+// for the whole compilation, so a null-terminated source is lexed in place;
+// otherwise the lexer needs a copy with a terminator added.
+static std::unique_ptr<llvm::MemoryBuffer>
+CreateSourceMemoryBuffer(StringRef Data, StringRef Name) {
+  if (!Data.empty() && Data.back() == '\0')
+    return llvm::MemoryBuffer::getMemBuffer(Data.drop_back(), Name);
+  return llvm::MemoryBuffer::getMemBufferCopy(Data, Name);
+}
+
+// Writes the phases and passes of a compilation as ETW events, tagged with
+// the shader they were run for.
+class DxcEtwTimeReportListener : public hlsl::TimeReportListener {
+  const char *m_pShaderName;
+  const char *m_pEntryPoint;
+
+public:
+  DxcEtwTimeReportListener(const char *pShaderName, const char *pEntryPoint)
+      : m_pShaderName(pShaderName), m_pEntryPoint(pEntryPoint) {}
+
+  void entryStarted(const char *pName, bool isPass) override {
+    if (isPass)
+      DxcEtw_DXCompilerPass_Start(pName, m_pShaderName, m_pEntryPoint);
+    else
+      DxcEtw_DXCompilerPhase_Start(pName, m_pShaderName, m_pEntryPoint);
+  }
+  void entryEnded(const char *pName, bool isPass,
+                  const hlsl::TimeReportIRCounts *) override {
+    if (isPass)
+      DxcEtw_DXCompilerPass_Stop(pName, m_pShaderName, m_pEntryPoint);
+    else
+      DxcEtw_DXCompilerPhase_Stop(pName, m_pShaderName, m_pEntryPoint);
+  }
+};
+
+// Tells an events callback about each file the include handler it wraps
+// returns.
+class DxcEventsIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcIncludeHandler> m_pIncludeHandler;
+  CComPtr<IDxcCompilerEventsCallback> m_pCallback;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcEventsIncludeHandler)
+
+  DxcEventsIncludeHandler(IMalloc *pMalloc, IDxcIncludeHandler *pIncludeHandler,
+                          IDxcCompilerEventsCallback *pCallback)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_pIncludeHandler(pIncludeHandler),
+        m_pCallback(pCallback) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+      _In_ LPCWSTR pFilename,
+      _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) {
+    HRESULT hr = m_pIncludeHandler->LoadSource(pFilename, ppIncludeSource);
+    if (SUCCEEDED(hr) && *ppIncludeSource != nullptr)
+      m_pCallback->OnIncludeOpened(pFilename);
+    return hr;
+  }
+};
+
+// Makes a compiler's cancellation token, if it has one, the check polled by
+// the compile running on the thread.
+class DxcCancellationScope : public llvm::CancellationCheck {
+  IDxcCancellationToken *m_pToken;
+  llvm::CancellationCheck *m_pPrior;
+
+public:
+  DxcCancellationScope(IDxcCancellationToken *pToken)
+      : m_pToken(pToken), m_pPrior(nullptr) {
+    if (m_pToken)
+      m_pPrior = llvm::setThreadCancellationCheck(this);
+  }
+  ~DxcCancellationScope() {
+    if (m_pToken)
+      llvm::setThreadCancellationCheck(m_pPrior);
+  }
+  bool isCancelled() override { return m_pToken->IsCancelled() != FALSE; }
+};
+
 class HLSLExtensionsCodegenHelperImpl : public HLSLExtensionsCodegenHelper {
 private:
   CompilerInstance &m_CI;
+  std::shared_ptr<DxcLangExtensionsHelper> m_pLangExtensions;
   DxcLangExtensionsHelper &m_langExtensionsHelper;
   std::string m_rootSigDefine;
 
@@ -138,8 +286,9 @@ private:
   }
 
 public:
-  HLSLExtensionsCodegenHelperImpl(CompilerInstance &CI, DxcLangExtensionsHelper &langExtensionsHelper, StringRef rootSigDefine)
-  : m_CI(CI), m_langExtensionsHelper(langExtensionsHelper)
+  HLSLExtensionsCodegenHelperImpl(CompilerInstance &CI, std::shared_ptr<DxcLangExtensionsHelper> pLangExtensions, StringRef rootSigDefine)
+  : m_CI(CI), m_pLangExtensions(pLangExtensions)
+  , m_langExtensionsHelper(*m_pLangExtensions)
   , m_rootSigDefine(rootSigDefine)
   {}
 
@@ -194,11 +343,150 @@ public:
   }
 };
 
-class DxcCompiler : public IDxcCompiler2, public IDxcLangExtensions, public IDxcContainerEvent, public IDxcVersionInfo {
+// Arguments read once by IDxcCompilerWithArgs::CreateArgs. The parsed options
+// refer to the UTF-8 arguments, and the defines to the wide strings, held
+// alongside them; nothing changes after creation.
+class DxcCompilerArgs : public IDxcCompilerArgs {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  friend class DxcCompiler;
+
+  std::wstring m_targetProfile;
+  std::string m_utf8TargetProfile;
+  std::vector<std::wstring> m_arguments;
+  std::vector<LPCWSTR> m_argumentPtrs;
+  std::vector<std::wstring> m_defineStrings; // Names and values of m_defines.
+  std::vector<DxcDefine> m_defines;
+  hlsl::options::MainArgs m_mainArgs;
+  hlsl::options::DxcOpts m_opts;
+  // UTF-8 definitions for m_defines followed by those from the arguments.
+  std::vector<std::string> m_utf8Defines;
+
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcCompilerArgs)
+
+  DxcCompilerArgs(IMalloc *pMalloc, int argCount, LPCWSTR *pArguments)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_mainArgs(argCount, pArguments, 0) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcCompilerArgs>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE GetArguments(
+      _Outptr_result_buffer_(*pArgCount) LPCWSTR **ppArguments,
+      _Out_ UINT32 *pArgCount) {
+    if (ppArguments == nullptr || pArgCount == nullptr)
+      return E_INVALIDARG;
+    *ppArguments = m_argumentPtrs.data();
+    *pArgCount = m_argumentPtrs.size();
+    return S_OK;
+  }
+};
+
+class DxcCompiler : public IDxcCompiler2, public IDxcCompilerBatch, public IDxcCompilerPermutations, public IDxcFunctionDisassembler, public IDxcCompilerWithArgs, public IDxcCompilerCancellation, public IDxcCompilerEvents, public IDxcLangExtensions, public IDxcContainerEvent, public IDxcVersionInfo {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
-  DxcLangExtensionsHelper m_langExtensionsHelper;
+  // Compilations may run on any number of threads at once, and only read
+  // state that is immutable or guarded by m_lock. Registering a language
+  // extension replaces the shared extensions instead of changing them, so
+  // running compilations keep the ones they started with.
+  std::mutex m_lock;
+  std::shared_ptr<DxcLangExtensionsHelper> m_pLangExtensions =
+      std::make_shared<DxcLangExtensionsHelper>();
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
+  // Kept across compilations when this compiler is a session. Each context
+  // is lent to one compilation at a time, with the number of times used.
+  std::unique_ptr<dxcutil::CachedValidator> m_pSessionValidator;
+  std::vector<std::pair<std::unique_ptr<llvm::LLVMContext>, unsigned>>
+      m_sessionContexts;
+  CComPtr<IDxcCancellationToken> m_pCancellationToken;
+  CComPtr<IDxcCompilerEventsCallback> m_pEventsCallback;
+
+  // Constants and metadata stay in a context until it is destroyed, so a
+  // session starts over with a new one after this many compilations.
+  static const unsigned kMaxSessionContextUses = 64;
+
+  // The LLVM context of one compilation. A session lends its own, and takes
+  // it back for the next compilation once this one completes; creating a
+  // context and its types is a noticeable part of compiling a small shader.
+  // Declare before the CompilerInstance, which must not outlive it.
+  class ContextLease {
+    DxcCompiler *m_pCompiler;
+    std::unique_ptr<llvm::LLVMContext> m_pContext;
+    unsigned m_uses = 0;
+    bool m_completed = false;
+  public:
+    ContextLease(DxcCompiler *pCompiler) : m_pCompiler(pCompiler) {
+      {
+        std::lock_guard<std::mutex> lock(m_pCompiler->m_lock);
+        auto &contexts = m_pCompiler->m_sessionContexts;
+        if (!contexts.empty()) {
+          m_pContext = std::move(contexts.back().first);
+          m_uses = contexts.back().second;
+          contexts.pop_back();
+        }
+      }
+      if (!m_pContext)
+        m_pContext = std::make_unique<llvm::LLVMContext>();
+    }
+    ~ContextLease() {
+      if (m_completed && m_pCompiler->m_pSessionValidator &&
+          ++m_uses < kMaxSessionContextUses && m_pContext->resetForReuse()) {
+        try {
+          std::lock_guard<std::mutex> lock(m_pCompiler->m_lock);
+          m_pCompiler->m_sessionContexts.emplace_back(std::move(m_pContext),
+                                                      m_uses);
+        } catch (...) {
+          // The context is simply not reused.
+        }
+      }
+    }
+    llvm::LLVMContext &get() { return *m_pContext; }
+    // Only a compilation that didn't throw gives its context back.
+    void SetCompleted() { m_completed = true; }
+  };
+
+  std::shared_ptr<DxcLangExtensionsHelper> GetLangExtensions() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pLangExtensions;
+  }
+
+  template <typename TFn> HRESULT UpdateLangExtensions(TFn fn) {
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      std::lock_guard<std::mutex> lock(m_lock);
+      std::shared_ptr<DxcLangExtensionsHelper> pUpdated =
+          std::make_shared<DxcLangExtensionsHelper>(*m_pLangExtensions);
+      HRESULT hr = fn(*pUpdated);
+      if (SUCCEEDED(hr))
+        m_pLangExtensions = pUpdated;
+      return hr;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  CComPtr<IDxcContainerEventsHandler> GetContainerEventsHandler() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pDxcContainerEventsHandler;
+  }
+
+  CComPtr<IDxcCancellationToken> GetCancellationToken() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pCancellationToken;
+  }
+
+  CComPtr<IDxcCompilerEventsCallback> GetEventsCallback() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pEventsCallback;
+  }
+
+  void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor) {
+    if (m_pSessionValidator)
+      m_pSessionValidator->GetVersion(pMajor, pMinor);
+    else
+      dxcutil::GetValidatorVersion(pMajor, pMinor);
+  }
 
   void CreateDefineStrings(_In_count_(defineCount) const DxcDefine *pDefines,
                            UINT defineCount,
@@ -236,18 +524,92 @@ private:
     DXASSERT(opts.HLSLVersion > 2015, "else ReadDxcOpts didn't fail for non-isense");
     finished = false;
   }
+  // A pretokenized header is binary, so it is loaded up front instead of
+  // going through the text conversion applied to included files.
+  void LoadPretokenizedHeader(const hlsl::options::DxcOpts &opts,
+                              dxcutil::DxcArgsFileSystem *msfPtr,
+                              IDxcIncludeHandler *pIncludeHandler) {
+    IFTARG(pIncludeHandler != nullptr);
+    StringRefUtf16 tokenCacheName(opts.PretokenizedHeader);
+    CComPtr<IDxcBlob> pTokenCache;
+    IFT(pIncludeHandler->LoadSource(tokenCacheName, &pTokenCache));
+    IFTARG(pTokenCache != nullptr);
+    IFT(msfPtr->RegisterInputBlob(tokenCacheName, pTokenCache));
+  }
+  // A pipeline file has one optimizer command per line, as /Odump prints
+  // them; blank lines and lines starting with '#' are skipped.
+  void LoadOptimizerPipeline(const hlsl::options::DxcOpts &opts,
+                             IDxcIncludeHandler *pIncludeHandler,
+                             std::vector<std::string> &commands) {
+    IFTARG(pIncludeHandler != nullptr);
+    StringRefUtf16 pipelineName(opts.OptPipelineFile);
+    CComPtr<IDxcBlob> pPipeline;
+    IFT(pIncludeHandler->LoadSource(pipelineName, &pPipeline));
+    IFTARG(pPipeline != nullptr);
+    CComPtr<IDxcBlobEncoding> pUtf8Pipeline;
+    IFT(hlsl::DxcGetBlobAsUtf8(pPipeline, &pUtf8Pipeline));
+    const char *pText = (const char *)pUtf8Pipeline->GetBufferPointer();
+    StringRef text(pText, strnlen(pText, pUtf8Pipeline->GetBufferSize()));
+    SmallVector<StringRef, 64> lines;
+    text.split(lines, "\n", -1, false);
+    for (StringRef line : lines) {
+      line = line.trim();
+      if (line.empty() || line[0] == '#')
+        continue;
+      commands.push_back(line.str());
+    }
+    IFTBOOLMSG(!commands.empty(), DXC_E_ABORT_COMPILATION_ERROR,
+               "error: optimizer pipeline file has no commands\n");
+  }
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcCompiler)
-  DXC_LANGEXTENSIONS_HELPER_IMPL(m_langExtensionsHelper)
+
+  // IDxcLangExtensions
+  __override HRESULT STDMETHODCALLTYPE RegisterIntrinsicTable(_In_ IDxcIntrinsicTable *pTable) {
+    return UpdateLangExtensions([&](DxcLangExtensionsHelper &helper) {
+      return helper.RegisterIntrinsicTable(pTable);
+    });
+  }
+  __override HRESULT STDMETHODCALLTYPE RegisterSemanticDefine(LPCWSTR name) {
+    return UpdateLangExtensions([&](DxcLangExtensionsHelper &helper) {
+      return helper.RegisterSemanticDefine(name);
+    });
+  }
+  __override HRESULT STDMETHODCALLTYPE RegisterSemanticDefineExclusion(LPCWSTR name) {
+    return UpdateLangExtensions([&](DxcLangExtensionsHelper &helper) {
+      return helper.RegisterSemanticDefineExclusion(name);
+    });
+  }
+  __override HRESULT STDMETHODCALLTYPE RegisterDefine(LPCWSTR name) {
+    return UpdateLangExtensions([&](DxcLangExtensionsHelper &helper) {
+      return helper.RegisterDefine(name);
+    });
+  }
+  __override HRESULT STDMETHODCALLTYPE SetSemanticDefineValidator(_In_ IDxcSemanticDefineValidator* pValidator) {
+    return UpdateLangExtensions([&](DxcLangExtensionsHelper &helper) {
+      return helper.SetSemanticDefineValidator(pValidator);
+    });
+  }
+  __override HRESULT STDMETHODCALLTYPE SetSemanticDefineMetaDataName(LPCSTR name) {
+    return UpdateLangExtensions([&](DxcLangExtensionsHelper &helper) {
+      return helper.SetSemanticDefineMetaDataName(name);
+    });
+  }
+
+  void InitSession() {
+    m_pSessionValidator.reset(new dxcutil::CachedValidator());
+  }
 
   __override HRESULT STDMETHODCALLTYPE RegisterDxilContainerEventHandler(IDxcContainerEventsHandler *pHandler, UINT64 *pCookie) {
+    std::lock_guard<std::mutex> lock(m_lock);
     DXASSERT(m_pDxcContainerEventsHandler == nullptr, "else events handler is already registered");
     *pCookie = 1; // Only one EventsHandler supported 
     m_pDxcContainerEventsHandler = pHandler;
     return S_OK;
   };
   __override HRESULT STDMETHODCALLTYPE UnRegisterDxilContainerEventHandler(UINT64 cookie) {
+    std::lock_guard<std::mutex> lock(m_lock);
     DXASSERT(m_pDxcContainerEventsHandler != nullptr, "else unregister should not have been called");
     m_pDxcContainerEventsHandler.Release();
     return S_OK;
@@ -256,12 +618,34 @@ public:
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
     return DoBasicQueryInterface<IDxcCompiler,
                                  IDxcCompiler2,
+                                 IDxcCompilerBatch,
+                                 IDxcCompilerPermutations,
+                                 IDxcFunctionDisassembler,
+                                 IDxcCompilerWithArgs,
+                                 IDxcCompilerCancellation,
+                                 IDxcCompilerEvents,
                                  IDxcLangExtensions,
                                  IDxcContainerEvent,
                                  IDxcVersionInfo>
                                  (this, iid, ppvObject);
   }
 
+  __override HRESULT STDMETHODCALLTYPE SetCancellationToken(
+    _In_opt_ IDxcCancellationToken *pToken
+  ) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pCancellationToken = pToken;
+    return S_OK;
+  }
+
+  __override HRESULT STDMETHODCALLTYPE SetEventsCallback(
+    _In_opt_ IDxcCompilerEventsCallback *pCallback
+  ) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pEventsCallback = pCallback;
+    return S_OK;
+  }
+
   // Compile a single entry point to the target shader model
   __override HRESULT STDMETHODCALLTYPE Compile(
     _In_ IDxcBlob *pSource,                       // Source text to compile
@@ -294,6 +678,129 @@ public:
     _COM_Outptr_ IDxcOperationResult **ppResult,  // Compiler output status, buffer, and errors
     _Outptr_opt_result_z_ LPWSTR *ppDebugBlobName,// Suggested file name for debug blob.
     _COM_Outptr_opt_ IDxcBlob **ppDebugBlob       // Debug blob
+  ) {
+    return CompileImpl(pSource, pSourceName, pEntryPoint, pTargetProfile,
+                       pArguments, argCount, pDefines, defineCount,
+                       pIncludeHandler, ppResult, ppDebugBlobName, ppDebugBlob,
+                       nullptr);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE CreateArgs(
+    _In_ LPCWSTR pTargetProfile,                  // shader profile to compile
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _COM_Outptr_ IDxcCompilerArgs **ppArgs,       // Parsed arguments
+    _COM_Outptr_opt_result_maybenull_ IDxcBlobEncoding **ppErrors // Diagnostics for invalid arguments
+  ) {
+    if (pTargetProfile == nullptr || ppArgs == nullptr ||
+        (defineCount > 0 && pDefines == nullptr) ||
+        (argCount > 0 && pArguments == nullptr))
+      return E_INVALIDARG;
+    *ppArgs = nullptr;
+    AssignToOutOpt(nullptr, ppErrors);
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      int argCountInt;
+      IFT(UIntToInt(argCount, &argCountInt));
+      CComPtr<DxcCompilerArgs> pArgs =
+          DxcCompilerArgs::Alloc(m_pMalloc, argCountInt, pArguments);
+      IFROOM(pArgs.p);
+      pArgs->m_targetProfile = pTargetProfile;
+      pArgs->m_utf8TargetProfile =
+          Unicode::UTF16ToUTF8StringOrThrow(pTargetProfile);
+      pArgs->m_arguments.assign(pArguments, pArguments + argCount);
+      for (const std::wstring &arg : pArgs->m_arguments)
+        pArgs->m_argumentPtrs.push_back(arg.c_str());
+      // Reserve so that the define pointers stay valid.
+      pArgs->m_defineStrings.reserve(defineCount * 2);
+      for (UINT32 i = 0; i < defineCount; ++i) {
+        DxcDefine define;
+        pArgs->m_defineStrings.emplace_back(pDefines[i].Name);
+        define.Name = pArgs->m_defineStrings.back().c_str();
+        define.Value = nullptr;
+        if (pDefines[i].Value) {
+          pArgs->m_defineStrings.emplace_back(pDefines[i].Value);
+          define.Value = pArgs->m_defineStrings.back().c_str();
+        }
+        pArgs->m_defines.push_back(define);
+      }
+
+      hlsl::options::DxcOpts &opts = pArgs->m_opts;
+      opts.TargetProfile = pArgs->m_utf8TargetProfile;
+      std::string errors;
+      raw_string_ostream errorStream(errors);
+      if (0 != hlsl::options::ReadDxcOpts(::options::getHlslOptTable(),
+                                          hlsl::options::CompilerFlags,
+                                          pArgs->m_mainArgs, opts,
+                                          errorStream)) {
+        errorStream.flush();
+        if (ppErrors)
+          IFT(DxcCreateBlobWithEncodingOnHeapCopy(errors.data(), errors.size(),
+                                                  CP_UTF8, ppErrors));
+        return E_INVALIDARG;
+      }
+      CreateDefineStrings(pArgs->m_defines.data(), pArgs->m_defines.size(),
+                          pArgs->m_utf8Defines);
+      CreateDefineStrings(opts.Defines.data(), opts.Defines.size(),
+                          pArgs->m_utf8Defines);
+      *ppArgs = pArgs.Detach();
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  __override HRESULT STDMETHODCALLTYPE CompileWithArgs(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ LPCWSTR pEntryPoint,                     // entry point name
+    _In_ IDxcCompilerArgs *pArgs,                 // Target profile, arguments and base defines
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of additional defines
+    _In_ UINT32 defineCount,                      // Number of additional defines
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Compiler output status, buffer, and errors
+  ) {
+    if (pArgs == nullptr || ppResult == nullptr ||
+        (defineCount > 0 && pDefines == nullptr))
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+    DxcCompilerArgs *pCompilerArgs = static_cast<DxcCompilerArgs *>(pArgs);
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      // The base defines lead, so the compile cache key still covers them;
+      // only the added ones are converted again.
+      std::vector<DxcDefine> allDefines(pCompilerArgs->m_defines);
+      allDefines.insert(allDefines.end(), pDefines, pDefines + defineCount);
+      return CompileImpl(pSource, pSourceName, pEntryPoint,
+                         pCompilerArgs->m_targetProfile.c_str(),
+                         pCompilerArgs->m_argumentPtrs.data(),
+                         pCompilerArgs->m_argumentPtrs.size(),
+                         allDefines.data(), allDefines.size(), pIncludeHandler,
+                         ppResult, nullptr, nullptr, pCompilerArgs);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
+  // Compile a single entry point, reading the arguments unless pArgs holds
+  // them already parsed. With pArgs, the first pArgs->m_defines.size() defines
+  // are its base defines.
+  HRESULT CompileImpl(
+    _In_ IDxcBlob *pSource,
+    _In_opt_ LPCWSTR pSourceName,
+    _In_ LPCWSTR pEntryPoint,
+    _In_ LPCWSTR pTargetProfile,
+    _In_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_count_(defineCount) const DxcDefine *pDefines,
+    _In_ UINT32 defineCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _COM_Outptr_ IDxcOperationResult **ppResult,
+    _Outptr_opt_result_z_ LPWSTR *ppDebugBlobName,
+    _COM_Outptr_opt_ IDxcBlob **ppDebugBlob,
+    _In_opt_ DxcCompilerArgs *pArgs
   ) {
     if (pSource == nullptr || ppResult == nullptr ||
         (defineCount > 0 && pDefines == nullptr) ||
@@ -311,12 +818,29 @@ public:
     DxcEtw_DXCompilerCompile_Start();
     pSourceName = (pSourceName && *pSourceName) ? pSourceName : L"hlsl.hlsl"; // declared optional, so pick a default
     DxcThreadMalloc TM(m_pMalloc);
+    CComPtr<IDxcCancellationToken> pCancellationToken = GetCancellationToken();
+    DxcCancellationScope cancellationScope(pCancellationToken);
+    CComPtr<IDxcContainerEventsHandler> pEventsHandler =
+        GetContainerEventsHandler();
+    CComPtr<IDxcCompilerEventsCallback> pEventsCallback = GetEventsCallback();
     IFC(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
 
     try {
       CComPtr<IDxcBlob> pOutputBlob;
+      CComPtr<IDxcBlob> pSidecarBlob; // With -Qsidecar, the debug parts.
+      CComPtr<IDxcBlob> pSpirvReflectionBlob; // With -fspv-reflect-sidecar.
+      CComPtr<IDxcBlob> pSourcePackBlob; // With -Qsource_pack.
+      // The compile cache and pretokenized headers load through the
+      // handler itself; only the files the source includes are reported.
+      CComPtr<IDxcIncludeHandler> pSourceIncludeHandler = pIncludeHandler;
+      if (pEventsCallback && pIncludeHandler) {
+        pSourceIncludeHandler = DxcEventsIncludeHandler::Alloc(
+            m_pMalloc, pIncludeHandler, pEventsCallback);
+        IFTOOM(pSourceIncludeHandler.p);
+      }
       dxcutil::DxcArgsFileSystem *msfPtr =
-        dxcutil::CreateDxcArgsFileSystem(utf8Source, pSourceName, pIncludeHandler);
+        dxcutil::CreateDxcArgsFileSystem(utf8Source, pSourceName,
+                                         pSourceIncludeHandler);
       std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
 
       ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
@@ -327,20 +851,96 @@ public:
 
       int argCountInt;
       IFT(UIntToInt(argCount, &argCountInt));
-      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
-      hlsl::options::DxcOpts opts;
+      // Arguments from CreateArgs were read and validated there.
+      hlsl::options::MainArgs mainArgs(pArgs ? 0 : argCountInt, pArguments, 0);
+      hlsl::options::DxcOpts parsedOpts;
+      hlsl::options::DxcOpts &opts = pArgs ? pArgs->m_opts : parsedOpts;
       CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
-      // Set target profile before reading options and validate
-      opts.TargetProfile = pUtf8TargetProfile.m_psz;
-      bool finished;
-      ReadOptsAndValidate(mainArgs, opts, pOutputStream, ppResult, finished);
-      if (finished) {
-        hr = S_OK;
-        goto Cleanup;
+      if (pArgs == nullptr) {
+        // Set target profile before reading options and validate
+        opts.TargetProfile = pUtf8TargetProfile.m_psz;
+        bool finished;
+        ReadOptsAndValidate(mainArgs, opts, pOutputStream, ppResult, finished);
+        if (finished) {
+          hr = S_OK;
+          goto Cleanup;
+        }
       }
       if (opts.DisplayIncludeProcess)
         msfPtr->EnableDisplayIncludeProcess();
 
+      if (!opts.PretokenizedHeader.empty())
+        LoadPretokenizedHeader(opts, msfPtr, pIncludeHandler);
+
+      // Only plain compilations to a container are cached; the container
+      // events handler must observe every container that is built.
+      std::unique_ptr<dxcutil::DxcCompileCache> pCache;
+      bool cacheable = !opts.CompileCacheDir.empty() &&
+                       !opts.CodeGenHighLevel && !opts.AstDump &&
+                       !opts.OptDump && !opts.IsRootSignatureProfile() &&
+                       !opts.CreatePretokenizedHeader &&
+                       !opts.AllocationStats && !opts.PrintIRStats &&
+                       opts.OptPipelineFile.empty() &&
+                       !opts.SourcePack && pEventsHandler == nullptr;
+#ifdef ENABLE_SPIRV_CODEGEN
+      cacheable = cacheable && !opts.GenSPIRV;
+#endif
+      if (cacheable) {
+        pCache.reset(new dxcutil::DxcCompileCache(opts.CompileCacheDir,
+                                                  opts.CompileCacheMaxSize));
+        pCache->ComputeKey(utf8Source, pEntryPoint, pTargetProfile,
+                           pArguments, argCount, pDefines, defineCount,
+                           ppDebugBlob != nullptr);
+        std::vector<std::wstring> cachedIncludes;
+        bool cacheHit = pCache->Lookup(pIncludeHandler, ppResult,
+                                       ppDebugBlobName, ppDebugBlob,
+                                       &cachedIncludes);
+        if (pEventsCallback)
+          pEventsCallback->OnCacheLookup(cacheHit);
+        if (cacheHit) {
+          // Nothing was included on a hit; the entry lists the includes.
+          std::vector<std::string> dependencies;
+          GetDependencies(opts.Preprocessed, utf8Source, msfPtr, dependencies);
+          if (!opts.Preprocessed) {
+            for (const std::wstring &name : cachedIncludes)
+              dependencies.emplace_back(
+                  Unicode::UTF16ToUTF8StringOrThrow(name.c_str()));
+          }
+          CComPtr<IDxcBlobEncoding> pDependencies;
+          CreateDependenciesBlob(dependencies, &pDependencies);
+          static_cast<DxcOperationResult *>(*ppResult)->m_dependencies =
+              pDependencies;
+          hr = S_OK;
+          goto Cleanup;
+        }
+      }
+
+      // With -falloc-stats, allocations are counted on their way to the
+      // user allocator. With -ftime-report, allocations are made through the
+      // report so that it can track their high-water mark. A report is also
+      // collected for -ftime-trace, and while a trace session listens to the
+      // provider or an events callback is set, to send its phase and pass
+      // events.
+      CComPtr<hlsl::AllocationStatsMalloc> pStatsMalloc;
+      if (opts.AllocationStats)
+        IFT(hlsl::AllocationStatsMalloc::Create(m_pMalloc, &pStatsMalloc));
+      IMalloc *pOpMalloc = pStatsMalloc ? pStatsMalloc.p : m_pMalloc.p;
+      bool etwEnabled =
+          MICROSOFT_WINDOWS_DXCOMPILER_PROVIDER_Context.IsEnabled != 0;
+      std::unique_ptr<hlsl::TimeReport> pTimeReport;
+      if (opts.TimeReport || opts.TimeTrace || opts.PrintIRStats ||
+          etwEnabled || pEventsCallback)
+        pTimeReport.reset(new hlsl::TimeReport(pOpMalloc));
+      if (pEventsCallback)
+        pTimeReport->EnableIRCounts();
+      if (opts.TimeTrace)
+        pTimeReport->EnableTrace();
+      if (opts.PrintIRStats)
+        pTimeReport->EnableIRStats();
+      hlsl::TimeReportScope timeReportScope(pTimeReport.get());
+      DxcThreadMalloc TMReport(pTimeReport ? pTimeReport->GetMalloc()
+                                           : pOpMalloc);
+
       // Prepare UTF8-encoded versions of API values.
       CW2A pUtf8EntryPoint(pEntryPoint, CP_UTF8);
       CW2A utf8SourceName(pSourceName, CP_UTF8);
@@ -353,6 +953,16 @@ public:
           pUtf8SourceName = opts.InputFile.data();
         }
       }
+      const char *pUtf8EntryPointName =
+          pUtf8EntryPoint.m_psz ? pUtf8EntryPoint.m_psz : "";
+      DxcEtwTimeReportListener etwListener(pUtf8SourceName,
+                                           pUtf8EntryPointName);
+      hlsl::TimeReportEventsListener eventsListener(
+          pEventsCallback, etwEnabled ? &etwListener : nullptr);
+      if (pEventsCallback)
+        pTimeReport->SetListener(&eventsListener);
+      else if (etwEnabled)
+        pTimeReport->SetListener(&etwListener);
 
       IFT(msfPtr->RegisterOutputStream(L"output.bc", pOutputStream));
       IFT(msfPtr->CreateStdStreams(m_pMalloc));
@@ -360,23 +970,35 @@ public:
       StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
                      utf8Source->GetBufferSize());
       std::unique_ptr<llvm::MemoryBuffer> pBuffer(
-          llvm::MemoryBuffer::getMemBufferCopy(Data, pUtf8SourceName));
+          CreateSourceMemoryBuffer(Data, pUtf8SourceName));
 
-      // Not very efficient but also not very important.
+      // Not very efficient but also not very important. Preprocessed source
+      // has had its macros expanded already.
       std::vector<std::string> defines;
-      CreateDefineStrings(pDefines, defineCount, defines);
-      CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
+      if (pArgs && !opts.Preprocessed) {
+        UINT32 baseDefineCount = pArgs->m_defines.size();
+        defines = pArgs->m_utf8Defines;
+        CreateDefineStrings(pDefines + baseDefineCount,
+                            defineCount - baseDefineCount, defines);
+      } else if (!opts.Preprocessed) {
+        CreateDefineStrings(pDefines, defineCount, defines);
+        CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
+      }
 
       // Setup a compiler instance.
       std::string warnings;
       raw_string_ostream w(warnings);
       raw_stream_ostream outStream(pOutputStream.p);
-      llvm::LLVMContext llvmContext; // LLVMContext should outlive CompilerInstance
+      ContextLease contextLease(this); // Should outlive CompilerInstance
+      llvm::LLVMContext &llvmContext = contextLease.get();
       CompilerInstance compiler;
       std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
           std::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
-      SetupCompilerForCompile(compiler, &m_langExtensionsHelper, utf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
+      SetupCompilerForCompile(compiler, GetLangExtensions(), utf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
       msfPtr->SetupForCompilerInstance(compiler);
+      if (!opts.OptPipelineFile.empty())
+        LoadOptimizerPipeline(opts, pIncludeHandler,
+                              compiler.getCodeGenOpts().HLSLOptimizerPipeline);
 
       // The clang entry point (cc1_main) would now create a compiler invocation
       // from arguments, but for this path we're exclusively trying to compile
@@ -408,14 +1030,15 @@ public:
 
       // NOTE: this calls the validation component from dxil.dll; the built-in
       // validator can be used as a fallback.
-      bool produceFullContainer = !opts.CodeGenHighLevel && !opts.AstDump && !opts.OptDump && rootSigMajor == 0;
+      bool produceFullContainer = !opts.CodeGenHighLevel && !opts.AstDump && !opts.OptDump && rootSigMajor == 0 &&
+                                  !opts.CreatePretokenizedHeader;
 
       bool needsValidation = produceFullContainer && !opts.DisableValidation &&
                              !opts.IsLibraryProfile();
 
       if (needsValidation || (opts.CodeGenHighLevel && !opts.DisableValidation)) {
         UINT32 majorVer, minorVer;
-        dxcutil::GetValidatorVersion(&majorVer, &minorVer);
+        GetValidatorVersion(&majorVer, &minorVer);
         compiler.getCodeGenOpts().HLSLValidatorMajorVer = majorVer;
         compiler.getCodeGenOpts().HLSLValidatorMinorVer = minorVer;
       }
@@ -430,6 +1053,15 @@ public:
         dumpAction.EndSourceFile();
         outStream.flush();
       }
+      else if (opts.CreatePretokenizedHeader) {
+        GeneratePTHAction action;
+        FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
+        if (action.BeginSourceFile(compiler, file)) {
+          action.Execute();
+          action.EndSourceFile();
+        }
+        outStream.flush();
+      }
       else if (opts.OptDump) {
         EmitOptDumpAction action(&llvmContext);
         FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
@@ -472,7 +1104,10 @@ public:
           spirvOpts.useGlLayout = opts.VkUseGlLayout;
           spirvOpts.useDxLayout = opts.VkUseDxLayout;
           spirvOpts.enableReflect = opts.SpvEnableReflect;
+          spirvOpts.optimizeSize = opts.SpvOptimizeSize;
+          spirvOpts.relaxedPrecision = opts.SpvRelaxedPrecision;
           spirvOpts.ignoreUnusedResources = opts.VkIgnoreUnusedResources;
+          spirvOpts.autoPushConstantSize = opts.VkAutoPushConstantSize;
           spirvOpts.defaultRowMajor = opts.DefaultRowMajor;
           spirvOpts.stageIoOrder = opts.VkStageIoOrder;
           spirvOpts.bShift = opts.VkBShift;
@@ -483,12 +1118,23 @@ public:
           spirvOpts.targetEnv = opts.SpvTargetEnv;
           spirvOpts.enable16BitTypes = opts.Enable16BitTypes;
           spirvOpts.enableDebugInfo = opts.DebugInfo;
+          spirvOpts.entryPoints = opts.SpvEntryPoints;
+          // Keep the bodies of the other entry points from being deferred.
+          for (llvm::StringRef entry : opts.SpvEntryPoints)
+            compiler.getLangOpts().HLSLBatchEntryFunctions.push_back(entry);
+          std::string spirvReflection;
+          spirvOpts.reflectionSidecar =
+              opts.SpvReflectSidecar ? &spirvReflection : nullptr;
           clang::EmitSPIRVAction action(spirvOpts);
           FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
           action.BeginSourceFile(compiler, file);
           action.Execute();
           action.EndSourceFile();
           outStream.flush();
+          if (!spirvReflection.empty())
+            IFT(DxcCreateBlobOnHeapCopy(spirvReflection.data(),
+                                        spirvReflection.size(),
+                                        &pSpirvReflectionBlob));
       }
 #endif
       // SPIRV change ends
@@ -496,48 +1142,74 @@ public:
         EmitBCAction action(&llvmContext);
         FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
         bool compileOK;
-        if (action.BeginSourceFile(compiler, file)) {
-          action.Execute();
-          action.EndSourceFile();
-          compileOK = !compiler.getDiagnostics().hasErrorOccurred();
-        }
-        else {
-          compileOK = false;
+        {
+          hlsl::TimeReportPhase frontendPhase("frontend");
+          if (action.BeginSourceFile(compiler, file)) {
+            action.Execute();
+            action.EndSourceFile();
+            compileOK = !compiler.getDiagnostics().hasErrorOccurred();
+          }
+          else {
+            compileOK = false;
+          }
         }
         outStream.flush();
 
+        // The sidecar is returned as the debug blob, so the debug parts are
+        // only split out when the caller takes one.
+        bool splitSidecar = opts.Sidecar && opts.DebugInfo && ppDebugBlob != nullptr;
         SerializeDxilFlags SerializeFlags = SerializeDxilFlags::None;
         if (opts.DebugInfo) {
           SerializeFlags = SerializeDxilFlags::IncludeDebugNamePart;
           // Unless we want to strip it right away, include it in the container.
-          if (!opts.StripDebug || ppDebugBlob == nullptr) {
+          if (!opts.StripDebug || ppDebugBlob == nullptr || splitSidecar) {
             SerializeFlags |= SerializeDxilFlags::IncludeDebugInfoPart;
           }
         }
         if (opts.DebugNameForSource) {
           SerializeFlags |= SerializeDxilFlags::DebugNameDependOnSource;
         }
+        if (opts.ExtendedPSV) {
+          SerializeFlags |= SerializeDxilFlags::IncludeExtendedPSV;
+        }
+        if (opts.EmbedShaderHash) {
+          SerializeFlags |= SerializeDxilFlags::IncludeShaderHashPart;
+        }
+        if (opts.EmbedStatistics) {
+          SerializeFlags |= SerializeDxilFlags::IncludeStatisticsPart;
+        }
+        if (opts.CompressDebugInfo) {
+          SerializeFlags |= SerializeDxilFlags::CompressDebugInfoPart;
+        }
 
         // Don't do work to put in a container if an error has occurred
         // Do not create a container when there is only a a high-level representation in the module.
         if (compileOK && !opts.CodeGenHighLevel) {
           HRESULT valHR = S_OK;
+          std::unique_ptr<llvm::Module> pModule = action.takeModule();
+          if (opts.SourcePack)
+            dxcutil::MoveSourcesToPack(*pModule, m_pMalloc, pSourcePackBlob);
 
           if (needsValidation) {
+            hlsl::TimeReportPhase validationPhase("validation");
             valHR = dxcutil::ValidateAndAssembleToContainer(
-                action.takeModule(), pOutputBlob, m_pMalloc, SerializeFlags,
-                pOutputStream, opts.DebugInfo, compiler.getDiagnostics());
+                std::move(pModule), pOutputBlob, m_pMalloc, SerializeFlags,
+                pOutputStream, opts.DebugInfo, compiler.getDiagnostics(),
+                m_pSessionValidator.get(),
+                splitSidecar ? &pSidecarBlob : nullptr);
           } else {
-            dxcutil::AssembleToContainer(action.takeModule(),
+            hlsl::TimeReportPhase containerPhase("container");
+            dxcutil::AssembleToContainer(std::move(pModule),
                                                  pOutputBlob, m_pMalloc,
-                                                 SerializeFlags, pOutputStream);
+                                                 SerializeFlags, pOutputStream,
+                                                 splitSidecar ? &pSidecarBlob : nullptr);
           }
 
           // Callback after valid DXIL is produced
           if (SUCCEEDED(valHR)) {
             CComPtr<IDxcBlob> pTargetBlob;
-            if (m_pDxcContainerEventsHandler != nullptr) {
-              HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(pOutputBlob, &pTargetBlob);
+            if (pEventsHandler != nullptr) {
+              HRESULT hr = pEventsHandler->OnDxilContainerBuilt(pOutputBlob, &pTargetBlob);
               if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
                 std::swap(pOutputBlob, pTargetBlob);
               }
@@ -562,21 +1234,83 @@ public:
       // Add std err to warnings.
       msfPtr->WriteStdErrToStream(w);
 
+      CComPtr<IDxcBlobEncoding> pTimeReportBlob;
+      if (opts.TimeReport) {
+        std::string timeReport;
+        raw_string_ostream timeReportOS(timeReport);
+        pTimeReport->WriteJson(timeReportOS);
+        timeReportOS.flush();
+        IFT(DxcCreateBlobWithEncodingOnHeapCopy(
+            timeReport.data(), timeReport.size(), CP_UTF8, &pTimeReportBlob));
+      }
+      CComPtr<IDxcBlobEncoding> pTimeTraceBlob;
+      if (opts.TimeTrace) {
+        std::string timeTrace;
+        raw_string_ostream timeTraceOS(timeTrace);
+        pTimeReport->WriteTrace(timeTraceOS, pUtf8SourceName,
+                                pUtf8EntryPointName);
+        timeTraceOS.flush();
+        IFT(DxcCreateBlobWithEncodingOnHeapCopy(
+            timeTrace.data(), timeTrace.size(), CP_UTF8, &pTimeTraceBlob));
+      }
+      CComPtr<IDxcBlobEncoding> pIRStatsBlob;
+      if (opts.PrintIRStats) {
+        std::string irStats;
+        raw_string_ostream irStatsOS(irStats);
+        pTimeReport->WriteIRStats(irStatsOS);
+        irStatsOS.flush();
+        IFT(DxcCreateBlobWithEncodingOnHeapCopy(
+            irStats.data(), irStats.size(), CP_UTF8, &pIRStatsBlob));
+      }
+
+      std::vector<std::string> dependencies;
+      GetDependencies(opts.Preprocessed, utf8Source, msfPtr, dependencies);
+      CComPtr<IDxcBlobEncoding> pDependencies;
+      CreateDependenciesBlob(dependencies, &pDependencies);
+
       CreateOperationResultFromOutputs(pOutputBlob, msfPtr, warnings,
                                        compiler.getDiagnostics(), ppResult);
+      static_cast<DxcOperationResult *>(*ppResult)->m_dependencies =
+          pDependencies;
+      static_cast<DxcOperationResult *>(*ppResult)->m_timeReport =
+          pTimeReportBlob;
+      static_cast<DxcOperationResult *>(*ppResult)->m_timeTrace =
+          pTimeTraceBlob;
+      static_cast<DxcOperationResult *>(*ppResult)->m_irStats = pIRStatsBlob;
+      static_cast<DxcOperationResult *>(*ppResult)->m_spirvReflection =
+          pSpirvReflectionBlob;
+      static_cast<DxcOperationResult *>(*ppResult)->m_sourcePack =
+          pSourcePackBlob;
+      if (pStatsMalloc) {
+        DxcAllocationStats allocationStats;
+        pStatsMalloc->GetStats(&allocationStats);
+        static_cast<DxcOperationResult *>(*ppResult)->SetAllocationStats(
+            allocationStats);
+      }
 
       // On success, return values. After assigning ppResult, nothing should fail.
       HRESULT status;
       DXVERIFY_NOMSG(SUCCEEDED((*ppResult)->GetStatus(&status)));
       if (SUCCEEDED(status)) {
+        // The debug blob is the sidecar container when split, otherwise the
+        // debug module bitcode.
+        CComPtr<IDxcBlob> pDebugBlob;
+        if (pSidecarBlob)
+          pDebugBlob = pSidecarBlob;
+        else if (opts.DebugInfo && ppDebugBlob)
+          pOutputStream.QueryInterface(&pDebugBlob);
+        if (pCache) {
+          pCache->Store(msfPtr, *ppResult, DebugBlobName, pDebugBlob);
+        }
         if (opts.DebugInfo && ppDebugBlob) {
-          DXVERIFY_NOMSG(SUCCEEDED(pOutputStream.QueryInterface(ppDebugBlob)));
+          *ppDebugBlob = pDebugBlob.Detach();
         }
         if (ppDebugBlobName) {
           *ppDebugBlobName = DebugBlobName.Detach();
         }
       }
 
+      contextLease.SetCompleted();
       hr = S_OK;
     } catch (std::bad_alloc &) {
       hr = E_OUTOFMEMORY;
@@ -599,6 +1333,389 @@ public:
     return hr;
   }
 
+  // Compile several entry points from a single parse of the source.
+  __override HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_ UINT32 entryCount,                       // Number of entry points
+    _In_count_(entryCount) LPCWSTR *pEntryPoints, // Array of entry point names
+    _In_count_(entryCount) LPCWSTR *pTargetProfiles, // Shader profile for each entry point
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _Out_writes_(entryCount) IDxcOperationResult **ppResults // Compiler output for each entry point
+  ) {
+    if (pSource == nullptr || ppResults == nullptr || entryCount == 0 ||
+        pEntryPoints == nullptr || pTargetProfiles == nullptr ||
+        (defineCount > 0 && pDefines == nullptr) ||
+        (argCount > 0 && pArguments == nullptr))
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < entryCount; ++i) {
+      if (pEntryPoints[i] == nullptr || pTargetProfiles[i] == nullptr)
+        return E_INVALIDARG;
+      ppResults[i] = nullptr;
+    }
+
+    HRESULT hr = S_OK;
+    CComPtr<IDxcBlobEncoding> utf8Source;
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    DxcEtw_DXCompilerCompile_Start();
+    pSourceName = (pSourceName && *pSourceName) ? pSourceName : L"hlsl.hlsl"; // declared optional, so pick a default
+    DxcThreadMalloc TM(m_pMalloc);
+    CComPtr<IDxcCancellationToken> pCancellationToken = GetCancellationToken();
+    DxcCancellationScope cancellationScope(pCancellationToken);
+    IFC(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
+
+    try {
+      dxcutil::DxcArgsFileSystem *msfPtr =
+        dxcutil::CreateDxcArgsFileSystem(utf8Source, pSourceName, pIncludeHandler);
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+
+      std::vector<std::string> entryPoints, profiles;
+      for (UINT32 i = 0; i < entryCount; ++i) {
+        CW2A utf8EntryPoint(pEntryPoints[i], CP_UTF8);
+        CW2A utf8Profile(pTargetProfiles[i], CP_UTF8);
+        entryPoints.push_back(utf8EntryPoint.m_psz);
+        profiles.push_back(utf8Profile.m_psz);
+      }
+
+      int argCountInt;
+      IFT(UIntToInt(argCount, &argCountInt));
+      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+      hlsl::options::DxcOpts opts;
+      // The first profile drives option validation; the rest must agree on
+      // being a plain shader compilation.
+      opts.TargetProfile = profiles[0];
+      bool finished;
+      CComPtr<IDxcOperationResult> pOptsResult;
+      ReadOptsAndValidate(mainArgs, opts, pOutputStream, &pOptsResult,
+                          finished);
+      if (finished) {
+        for (UINT32 i = 0; i < entryCount; ++i) {
+          pOptsResult.p->AddRef();
+          ppResults[i] = pOptsResult.p;
+        }
+        hr = S_OK;
+        goto Cleanup;
+      }
+      for (const std::string &profile : profiles) {
+        opts.TargetProfile = profile;
+        if (opts.IsLibraryProfile() || opts.IsRootSignatureProfile())
+          throw hlsl::Exception(E_INVALIDARG);
+      }
+      opts.TargetProfile = profiles[0];
+#ifdef ENABLE_SPIRV_CODEGEN
+      if (opts.GenSPIRV)
+        throw hlsl::Exception(E_INVALIDARG);
+#endif
+      if (opts.AstDump || opts.OptDump || opts.CreatePretokenizedHeader)
+        throw hlsl::Exception(E_INVALIDARG);
+      if (opts.DisplayIncludeProcess)
+        msfPtr->EnableDisplayIncludeProcess();
+      if (!opts.PretokenizedHeader.empty())
+        LoadPretokenizedHeader(opts, msfPtr, pIncludeHandler);
+
+      CW2A utf8SourceName(pSourceName, CP_UTF8);
+      IFT(msfPtr->CreateStdStreams(m_pMalloc));
+
+      // Preprocessed source has had its macros expanded already.
+      std::vector<std::string> defines;
+      if (!opts.Preprocessed) {
+        CreateDefineStrings(pDefines, defineCount, defines);
+        CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
+      }
+
+      // Setup a compiler instance; diagnostics text is shared by all entries.
+      std::string warnings;
+      raw_string_ostream w(warnings);
+      ContextLease contextLease(this); // Should outlive CompilerInstance
+      llvm::LLVMContext &llvmContext = contextLease.get();
+      CompilerInstance compiler;
+      std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
+          std::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
+      SetupCompilerForCompile(compiler, GetLangExtensions(), utf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
+      msfPtr->SetupForCompilerInstance(compiler);
+      if (!opts.OptPipelineFile.empty())
+        LoadOptimizerPipeline(opts, pIncludeHandler,
+                              compiler.getCodeGenOpts().HLSLOptimizerPipeline);
+
+      // Sema runs once for the first entry; the remaining entries are kept
+      // alive so that each per-entry code generator can find its function.
+      compiler.getLangOpts().HLSLEntryFunction =
+      compiler.getCodeGenOpts().HLSLEntryFunction = entryPoints[0];
+      compiler.getLangOpts().HLSLProfile =
+      compiler.getCodeGenOpts().HLSLProfile = profiles[0];
+      compiler.getLangOpts().HLSLBatchEntryFunctions = entryPoints;
+      compiler.getLangOpts().IsHLSLLibrary = false;
+
+      bool needsValidation = !opts.CodeGenHighLevel && !opts.DisableValidation;
+      if (!opts.DisableValidation) {
+        UINT32 majorVer, minorVer;
+        GetValidatorVersion(&majorVer, &minorVer);
+        compiler.getCodeGenOpts().HLSLValidatorMajorVer = majorVer;
+        compiler.getCodeGenOpts().HLSLValidatorMinorVer = minorVer;
+      }
+
+      EmitBCBatchAction action(&llvmContext, entryPoints, profiles);
+      FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
+      bool parseOK = false;
+      if (action.BeginSourceFile(compiler, file)) {
+        action.Execute();
+        action.EndSourceFile();
+        parseOK = true;
+      }
+
+      SerializeDxilFlags SerializeFlags = SerializeDxilFlags::None;
+      if (opts.DebugInfo) {
+        SerializeFlags = SerializeDxilFlags::IncludeDebugNamePart;
+        SerializeFlags |= SerializeDxilFlags::IncludeDebugInfoPart;
+      }
+      if (opts.DebugNameForSource)
+        SerializeFlags |= SerializeDxilFlags::DebugNameDependOnSource;
+      if (opts.ExtendedPSV)
+        SerializeFlags |= SerializeDxilFlags::IncludeExtendedPSV;
+      if (opts.EmbedShaderHash)
+        SerializeFlags |= SerializeDxilFlags::IncludeShaderHashPart;
+      if (opts.EmbedStatistics)
+        SerializeFlags |= SerializeDxilFlags::IncludeStatisticsPart;
+      if (opts.CompressDebugInfo)
+        SerializeFlags |= SerializeDxilFlags::CompressDebugInfoPart;
+
+      std::vector<bool> entryHasErrors(entryCount, !parseOK);
+      std::vector<CComPtr<IDxcBlob>> outputBlobs(entryCount);
+      std::vector<CComPtr<IDxcBlob>> sourcePackBlobs(entryCount);
+      for (UINT32 i = 0; parseOK && i < entryCount; ++i) {
+        EmitBCBatchAction::EntryResult &R = action.getResults()[i];
+        CComPtr<AbstractMemoryStream> pEntryStream;
+        IFT(CreateMemoryStream(m_pMalloc, &pEntryStream));
+        ULONG cbWritten;
+        IFT(pEntryStream->Write(R.Bitcode.data(), R.Bitcode.size(),
+                                &cbWritten));
+        IFT(pEntryStream.QueryInterface(&outputBlobs[i]));
+        entryHasErrors[i] = R.HasErrors;
+        if (R.HasErrors || opts.CodeGenHighLevel)
+          continue;
+        if (opts.SourcePack)
+          dxcutil::MoveSourcesToPack(*R.Module, m_pMalloc, sourcePackBlobs[i]);
+
+        if (needsValidation) {
+          DiagnosticErrorTrap Trap(compiler.getDiagnostics());
+          dxcutil::ValidateAndAssembleToContainer(
+              std::move(R.Module), outputBlobs[i], m_pMalloc, SerializeFlags,
+              pEntryStream, opts.DebugInfo, compiler.getDiagnostics(),
+              m_pSessionValidator.get());
+          entryHasErrors[i] = Trap.hasErrorOccurred();
+        } else {
+          dxcutil::AssembleToContainer(std::move(R.Module), outputBlobs[i],
+                                       m_pMalloc, SerializeFlags,
+                                       pEntryStream);
+        }
+      }
+
+      // Add std err to warnings.
+      msfPtr->WriteStdErrToStream(w);
+      w.flush();
+
+      std::vector<std::string> dependencies;
+      GetDependencies(opts.Preprocessed, utf8Source, msfPtr, dependencies);
+      CComPtr<IDxcBlobEncoding> pDependencies;
+      CreateDependenciesBlob(dependencies, &pDependencies);
+
+      CComPtr<IStream> pErrorStream;
+      msfPtr->GetStdOutpuHandleStream(&pErrorStream);
+      for (UINT32 i = 0; i < entryCount; ++i) {
+        dxcutil::CreateOperationResultFromOutputs(
+            outputBlobs[i], pErrorStream, warnings, entryHasErrors[i],
+            &ppResults[i]);
+        static_cast<DxcOperationResult *>(ppResults[i])->m_dependencies =
+            pDependencies;
+        static_cast<DxcOperationResult *>(ppResults[i])->m_sourcePack =
+            sourcePackBlobs[i];
+      }
+
+      contextLease.SetCompleted();
+      hr = S_OK;
+    } catch (std::bad_alloc &) {
+      hr = E_OUTOFMEMORY;
+    } catch (hlsl::Exception &e) {
+      _Analysis_assume_(DXC_FAILED(e.hr));
+      hr = e.hr;
+    } catch (...) {
+      hr = E_FAIL;
+    }
+  Cleanup:
+    if (FAILED(hr)) {
+      for (UINT32 i = 0; i < entryCount; ++i) {
+        if (ppResults[i] != nullptr) {
+          ppResults[i]->Release();
+          ppResults[i] = nullptr;
+        }
+      }
+    }
+    DxcEtw_DXCompilerCompile_Stop(hr);
+    return hr;
+  }
+
+  // Returns the bytes of a result's output and messages, which identify the
+  // result, or an empty key for a failed call.
+  static std::string GetResultKey(IDxcOperationResult *pResult) {
+    std::string key;
+    CComPtr<IDxcBlob> pOutput;
+    CComPtr<IDxcBlobEncoding> pErrors;
+    HRESULT status;
+    if (FAILED(pResult->GetStatus(&status)) ||
+        FAILED(pResult->GetResult(&pOutput)) ||
+        FAILED(pResult->GetErrorBuffer(&pErrors)))
+      return key;
+    key.append((const char *)&status, sizeof(status));
+    size_t outputSize = pOutput ? pOutput->GetBufferSize() : 0;
+    key.append((const char *)&outputSize, sizeof(outputSize));
+    if (outputSize)
+      key.append((const char *)pOutput->GetBufferPointer(), outputSize);
+    if (pErrors)
+      key.append((const char *)pErrors->GetBufferPointer(),
+                 pErrors->GetBufferSize());
+    return key;
+  }
+
+  // Compile one entry point for several sets of defines.
+  __override HRESULT STDMETHODCALLTYPE CompilePermutations(
+    _In_ IDxcBlob *pSource,
+    _In_opt_ LPCWSTR pSourceName,
+    _In_ LPCWSTR pEntryPoint,
+    _In_ LPCWSTR pTargetProfile,
+    _In_count_(argCount) LPCWSTR *pArguments,
+    _In_ UINT32 argCount,
+    _In_ UINT32 permutationCount,
+    _In_count_(permutationCount) const DxcDefine *const *ppDefines,
+    _In_count_(permutationCount) const UINT32 *pDefineCounts,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+    _In_ UINT32 maxThreads,
+    _Out_writes_(permutationCount) IDxcOperationResult **ppResults
+  ) {
+    if (pSource == nullptr || pEntryPoint == nullptr ||
+        pTargetProfile == nullptr || ppResults == nullptr ||
+        (argCount > 0 && pArguments == nullptr) ||
+        (permutationCount > 0 &&
+         (ppDefines == nullptr || pDefineCounts == nullptr)))
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < permutationCount; ++i) {
+      if (pDefineCounts[i] > 0 && ppDefines[i] == nullptr)
+        return E_INVALIDARG;
+      ppResults[i] = nullptr;
+    }
+
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      // The root signature define is read from the preprocessor rather than
+      // the preprocessed text, so its value must be part of the key.
+      bool rootSigDefine = false;
+      for (UINT32 i = 0; i < argCount; ++i) {
+        if (wcscmp(pArguments[i], L"-rootsig-define") == 0 ||
+            wcscmp(pArguments[i], L"/rootsig-define") == 0)
+          rootSigDefine = true;
+      }
+
+      // Group the permutations that preprocess to the same text. The first
+      // permutation of each group is compiled for the group.
+      std::vector<UINT32> compiledFor(permutationCount);
+      std::vector<UINT32> unique;
+      std::map<std::string, UINT32> byText;
+      for (UINT32 i = 0; i < permutationCount; ++i) {
+        CComPtr<IDxcOperationResult> pPreprocessed;
+        IFT(Preprocess(pSource, pSourceName, pArguments, argCount,
+                       ppDefines[i], pDefineCounts[i], pIncludeHandler,
+                       &pPreprocessed));
+        HRESULT status;
+        CComPtr<IDxcBlob> pText;
+        IFT(pPreprocessed->GetStatus(&status));
+        if (SUCCEEDED(status))
+          IFT(pPreprocessed->GetResult(&pText));
+        if (pText == nullptr) {
+          // Let the compile report the errors.
+          compiledFor[i] = i;
+          unique.push_back(i);
+          continue;
+        }
+        std::string key((const char *)pText->GetBufferPointer(),
+                        pText->GetBufferSize());
+        if (rootSigDefine) {
+          std::vector<std::string> defines;
+          CreateDefineStrings(ppDefines[i], pDefineCounts[i], defines);
+          for (const std::string &define : defines) {
+            key += '\0';
+            key += define;
+          }
+        }
+        auto inserted = byText.insert(std::make_pair(std::move(key), i));
+        compiledFor[i] = inserted.first->second;
+        if (inserted.second)
+          unique.push_back(i);
+      }
+
+      std::vector<CComPtr<IDxcOperationResult>> results(permutationCount);
+      std::vector<HRESULT> hrs(permutationCount, S_OK);
+      // The container events handler may not expect to be called from
+      // several threads, so its compiles stay on this thread.
+      size_t threadCount = std::min<size_t>(
+          {maxThreads, unique.size(),
+           std::max(1u, std::thread::hardware_concurrency())});
+      if (threadCount <= 1 || GetContainerEventsHandler() != nullptr) {
+        for (UINT32 u : unique)
+          hrs[u] = Compile(pSource, pSourceName, pEntryPoint, pTargetProfile,
+                           pArguments, argCount, ppDefines[u],
+                           pDefineCounts[u], pIncludeHandler, &results[u]);
+      } else {
+        // This compiler is free-threaded, so every thread compiles with it
+        // and shares its extensions and session state.
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+          for (size_t n; (n = next++) < unique.size();) {
+            UINT32 u = unique[n];
+            hrs[u] = Compile(pSource, pSourceName, pEntryPoint,
+                             pTargetProfile, pArguments, argCount,
+                             ppDefines[u], pDefineCounts[u], pIncludeHandler,
+                             &results[u]);
+          }
+        };
+        // Run with the threads that could be started.
+        std::vector<std::thread> threads;
+        try {
+          for (size_t t = 1; t < threadCount; ++t)
+            threads.emplace_back(work);
+        } catch (...) {
+        }
+        work();
+        for (std::thread &thread : threads)
+          thread.join();
+      }
+      for (UINT32 u : unique)
+        IFT(hrs[u]);
+
+      // Permutations that compiled to the same output share its result.
+      std::map<std::string, UINT32> byOutput;
+      for (UINT32 u : unique) {
+        std::string key = GetResultKey(results[u]);
+        if (key.empty())
+          continue;
+        auto inserted = byOutput.insert(std::make_pair(std::move(key), u));
+        if (!inserted.second)
+          results[u] = results[inserted.first->second];
+      }
+      for (UINT32 i = 0; i < permutationCount; ++i)
+        results[compiledFor[i]].CopyTo(&ppResults[i]);
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
   // Preprocess source text
   __override HRESULT STDMETHODCALLTYPE Preprocess(
     _In_ IDxcBlob *pSource,                       // Source text to preprocess
@@ -662,7 +1779,7 @@ public:
       StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
         utf8Source->GetBufferSize());
       std::unique_ptr<llvm::MemoryBuffer> pBuffer(
-        llvm::MemoryBuffer::getMemBufferCopy(Data, pUtf8SourceName));
+        CreateSourceMemoryBuffer(Data, pUtf8SourceName));
 
       // Not very efficient but also not very important.
       std::vector<std::string> defines;
@@ -675,7 +1792,7 @@ public:
       CompilerInstance compiler;
       std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
           std::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
-      SetupCompilerForCompile(compiler, &m_langExtensionsHelper, utf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
+      SetupCompilerForCompile(compiler, GetLangExtensions(), utf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
       msfPtr->SetupForCompilerInstance(compiler);
 
       // The clang entry point (cc1_main) would now create a compiler invocation
@@ -707,8 +1824,16 @@ public:
       // Add std err to warnings.
       msfPtr->WriteStdErrToStream(w);
 
+      std::vector<std::string> dependencies;
+      GetDependencies(/*preprocessed*/ false, utf8Source, msfPtr,
+                      dependencies);
+      CComPtr<IDxcBlobEncoding> pDependencies;
+      CreateDependenciesBlob(dependencies, &pDependencies);
+
       CreateOperationResultFromOutputs(pOutputStream, msfPtr, warnings,
         compiler.getDiagnostics(), ppResult);
+      static_cast<DxcOperationResult *>(*ppResult)->m_dependencies =
+          pDependencies;
       hr = S_OK;
     }
     CATCH_CPP_ASSIGN_HRESULT();
@@ -722,6 +1847,23 @@ public:
     _In_ IDxcBlob *pProgram,                      // Program to disassemble.
     _COM_Outptr_ IDxcBlobEncoding** ppDisassembly // Disassembly text.
     ) {
+    return DisassembleImpl(pProgram, StringRef(), ppDisassembly);
+  }
+
+  // Disassemble a single function of a shader.
+  __override HRESULT STDMETHODCALLTYPE DisassembleFunction(
+    _In_ IDxcBlob *pProgram,                      // Program to disassemble.
+    _In_ LPCWSTR pFunctionName,                   // Name of the function in the module.
+    _COM_Outptr_ IDxcBlobEncoding **ppDisassembly // Disassembly text.
+    ) {
+    if (pFunctionName == nullptr)
+      return E_INVALIDARG;
+    CW2A utf8FunctionName(pFunctionName, CP_UTF8);
+    return DisassembleImpl(pProgram, utf8FunctionName.m_psz, ppDisassembly);
+  }
+
+  HRESULT DisassembleImpl(IDxcBlob *pProgram, StringRef FunctionName,
+                          IDxcBlobEncoding **ppDisassembly) {
     if (pProgram == nullptr || ppDisassembly == nullptr)
       return E_INVALIDARG;
 
@@ -738,13 +1880,18 @@ public:
       ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
       IFTLLVM(pts.error_code());
 
-      std::string StreamStr;
-      raw_string_ostream Stream(StreamStr);
-
-      IFC(dxcutil::Disassemble(pProgram, Stream));
+      // Write straight to a stream on the compiler's allocator; the text of
+      // a large module would otherwise be built in a string and copied.
+      CComPtr<AbstractMemoryStream> pOutputStream;
+      IFT(CreateMemoryStream(m_pMalloc, &pOutputStream));
+      {
+        raw_stream_ostream Stream(pOutputStream.p);
+        IFC(dxcutil::Disassemble(pProgram, Stream, FunctionName));
+      }
 
-      IFT(DxcCreateBlobWithEncodingOnHeapCopy(
-          StreamStr.c_str(), StreamStr.size(), CP_UTF8, ppDisassembly));
+      CComPtr<IDxcBlob> pStreamBlob;
+      IFT(pOutputStream.QueryInterface(&pStreamBlob));
+      IFT(DxcCreateBlobWithEncodingSet(pStreamBlob, CP_UTF8, ppDisassembly));
 
       return S_OK;
     }
@@ -755,7 +1902,7 @@ public:
   }
 
   void SetupCompilerForCompile(CompilerInstance &compiler,
-                               _In_ DxcLangExtensionsHelper *helper,
+                               std::shared_ptr<DxcLangExtensionsHelper> helper,
                                _In_ LPCSTR pMainFile, _In_ TextDiagnosticPrinter *diagPrinter,
                                _In_ std::vector<std::string>& defines,
                                _In_ hlsl::options::DxcOpts &Opts,
@@ -767,7 +1914,7 @@ public:
     targetOptions->DescriptionString = Opts.Enable16BitTypes
       ? hlsl::DXIL::kNewLayoutString
       : hlsl::DXIL::kLegacyLayoutString;
-    compiler.HlslLangExtensions = helper;
+    compiler.HlslLangExtensions = helper.get();
     compiler.createDiagnostics(diagPrinter, false);
     compiler.createFileManager();
     compiler.createSourceManager(compiler.getFileManager());
@@ -778,7 +1925,9 @@ public:
     // Setup debug information.
     if (Opts.DebugInfo) {
       CodeGenOptions &CGOpts = compiler.getCodeGenOpts();
-      CGOpts.setDebugInfo(CodeGenOptions::FullDebugInfo);
+      CGOpts.setDebugInfo(Opts.DebugLineTablesOnly
+                              ? CodeGenOptions::DebugLineTablesOnly
+                              : CodeGenOptions::FullDebugInfo);
       CGOpts.DebugColumnInfo = 1;
       CGOpts.DwarfVersion = 4; // Latest version.
       // TODO: consider
@@ -793,6 +1942,8 @@ public:
     PPOpts.IgnoreLineDirectives = Opts.IgnoreLineDirectives;
     // fxc compatibility: pre-expand operands before performing token-pasting
     PPOpts.ExpandTokPastingArg = Opts.LegacyMacroExpansion;
+    // Files cached in the pretokenized header are lexed from the cache.
+    PPOpts.TokenCache = Opts.PretokenizedHeader;
 
     // Pick additional arguments.
     clang::HeaderSearchOptions &HSOpts = compiler.getHeaderSearchOpts();
@@ -826,6 +1977,7 @@ public:
     compiler.getLangOpts().HLSLVersion = (unsigned) Opts.HLSLVersion;
 
     compiler.getLangOpts().UseMinPrecision = !Opts.Enable16BitTypes;
+    compiler.getLangOpts().HLSLDeferFunctionBodies = Opts.DeferFunctionBodies;
 
 // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
@@ -853,6 +2005,15 @@ public:
       compiler.getCodeGenOpts().HLSLFloat32DenormMode = DXIL::Float32DenormMode::Preserve;
     }
 
+    if (Opts.FPSpeed.equals_lower(StringRef("balanced")))
+      compiler.getCodeGenOpts().HLSLFPSpeed = (unsigned)DXIL::FPSpeed::Balanced;
+    else if (Opts.FPSpeed.equals_lower(StringRef("fast")))
+      compiler.getCodeGenOpts().HLSLFPSpeed = (unsigned)DXIL::FPSpeed::Fast;
+    else
+      compiler.getCodeGenOpts().HLSLFPSpeed = (unsigned)DXIL::FPSpeed::Precise;
+
+    compiler.getCodeGenOpts().HLSLWaveSize = Opts.WaveSize;
+
     if (Opts.DisableOptimizations)
       compiler.getCodeGenOpts().DisableLLVMOpts = true;
 
@@ -866,6 +2027,54 @@ public:
     compiler.getCodeGenOpts().HLSLPreferControlFlow = Opts.PreferFlowControl;
     compiler.getCodeGenOpts().HLSLAvoidControlFlow = Opts.AvoidFlowControl;
     compiler.getCodeGenOpts().HLSLNotUseLegacyCBufLoad = Opts.NotUseLegacyCBufLoad;
+    compiler.getCodeGenOpts().HLSLCompactTypeAnnotations = Opts.CompactTypeAnnotations;
+    compiler.getCodeGenOpts().HLSLTrimResourceRanges = Opts.TrimResourceRanges;
+    compiler.getCodeGenOpts().HLSLUniformBranchHints = Opts.UniformBranchHints;
+    compiler.getCodeGenOpts().HLSLAutoFlatten = Opts.AutoFlatten;
+    compiler.getCodeGenOpts().HLSLUnswitchUniformLoops = Opts.UnswitchUniformLoops;
+    compiler.getCodeGenOpts().HLSLWaveAggregateAtomics = Opts.WaveAggregateAtomics;
+    compiler.getCodeGenOpts().HLSLAutoEarlyDepthStencil = Opts.AutoEarlyDepthStencil;
+    compiler.getCodeGenOpts().HLSLGatherPointSamples = Opts.GatherPointSamples;
+    compiler.getCodeGenOpts().HLSLCompactContext = Opts.CompactContext;
+    compiler.getCodeGenOpts().HLSLDemotePrecision = Opts.DemotePrecision;
+    // The passes report demotions, unrolled loops and flattened branches as
+    // optimization remarks.
+    std::string remarkPattern;
+    if (Opts.DemotePrecision)
+      remarkPattern = "^dxil-demote-precision$";
+    if (Opts.AutoFlatten) {
+      if (!remarkPattern.empty())
+        remarkPattern += "|";
+      remarkPattern += "^dxil-auto-flatten$";
+    }
+    if (Opts.UnrollReport) {
+      if (!remarkPattern.empty())
+        remarkPattern += "|";
+      remarkPattern += "^loop-unroll-report$";
+      // [unroll] loops that couldn't be unrolled are missed remarks.
+      compiler.getCodeGenOpts().OptimizationRemarkMissedPattern =
+          std::make_shared<llvm::Regex>("^loop-unroll$");
+      compiler.getDiagnostics().setSeverityForGroup(
+          diag::Flavor::Remark, "pass-missed", diag::Severity::Remark);
+    }
+    if (!remarkPattern.empty()) {
+      compiler.getCodeGenOpts().OptimizationRemarkPattern =
+          std::make_shared<llvm::Regex>(remarkPattern);
+      compiler.getDiagnostics().setSeverityForGroup(
+          diag::Flavor::Remark, "pass", diag::Severity::Remark);
+    }
+    compiler.getCodeGenOpts().HLSLSelectDynamicIndexing = Opts.SelectDynamicIndexing;
+    compiler.getCodeGenOpts().HLSLPadGroupShared = Opts.PadGroupShared;
+    compiler.getCodeGenOpts().HLSLSpecializable = Opts.Specializable;
+    compiler.getCodeGenOpts().HLSLBottomUpInline = Opts.BottomUpInline;
+    compiler.getCodeGenOpts().HLSLFreeASTEarly = Opts.FreeASTEarly;
+#ifdef NDEBUG
+    // Release builds name nothing nobody will read: only debug information
+    // with variables and -fcgl output show the names IR generation gives.
+    compiler.getCodeGenOpts().HLSLDiscardValueNames =
+        (!Opts.DebugInfo || Opts.DebugLineTablesOnly) &&
+        !Opts.CodeGenHighLevel;
+#endif
     compiler.getCodeGenOpts().HLSLDefines = defines;
     compiler.getCodeGenOpts().MainFileName = pMainFile;
 
@@ -874,16 +2083,24 @@ public:
       compiler.getCodeGenOpts().HLSLSignaturePackingStrategy = (unsigned)DXIL::PackingStrategy::PrefixStable;
     else if (Opts.PackOptimized)
       compiler.getCodeGenOpts().HLSLSignaturePackingStrategy = (unsigned)DXIL::PackingStrategy::Optimized;
+    else if (Opts.PackMinimal)
+      compiler.getCodeGenOpts().HLSLSignaturePackingStrategy = (unsigned)DXIL::PackingStrategy::Minimal;
     else
       compiler.getCodeGenOpts().HLSLSignaturePackingStrategy = (unsigned)DXIL::PackingStrategy::Default;
 
     // Constructing vector of wide strings to pass in to codegen. Just passing
     // in pArguments will expose ownership of memory to both CodeGenOptions and
     // this caller, which can lead to unexpected behavior.
+    // The prefix map itself names paths of this machine, so it isn't kept.
     for (UINT32 i = 0; i != argCount; ++i) {
-      compiler.getCodeGenOpts().HLSLArguments.emplace_back(
-          Unicode::UTF16ToUTF8StringOrThrow(pArguments[i]));
+      std::string arg = Unicode::UTF16ToUTF8StringOrThrow(pArguments[i]);
+      if (arg.size() > 1 &&
+          StringRef(arg).substr(1).startswith("fdebug-prefix-map="))
+        continue;
+      compiler.getCodeGenOpts().HLSLArguments.emplace_back(std::move(arg));
     }
+    compiler.getCodeGenOpts().DebugPrefixMap = Opts.DebugPrefixMap;
+    compiler.getCodeGenOpts().HLSLReproducible = Opts.Reproducible;
     // Overrding default set of loop unroll.
     if (Opts.PreferFlowControl)
       compiler.getCodeGenOpts().UnrollLoops = false;
@@ -894,7 +2111,7 @@ public:
     compiler.getCodeGenOpts().setInlining(
         clang::CodeGenOptions::OnlyAlwaysInlining);
 
-    compiler.getCodeGenOpts().HLSLExtensionsCodegen = std::make_shared<HLSLExtensionsCodegenHelperImpl>(compiler, m_langExtensionsHelper, Opts.RootSignatureDefine);
+    compiler.getCodeGenOpts().HLSLExtensionsCodegen = std::make_shared<HLSLExtensionsCodegenHelperImpl>(compiler, helper, Opts.RootSignatureDefine);
   }
 
   // IDxcVersionInfo
@@ -926,3 +2143,14 @@ HRESULT CreateDxcCompiler(_In_ REFIID riid, _Out_ LPVOID* ppv) {
   }
   CATCH_CPP_RETURN_HRESULT();
 }
+
+HRESULT CreateDxcCompilerSession(_In_ REFIID riid, _Out_ LPVOID* ppv) {
+  *ppv = nullptr;
+  try {
+    CComPtr<DxcCompiler> result(DxcCompiler::Alloc(DxcGetThreadMallocNoRef()));
+    IFROOM(result.p);
+    result->InitSession();
+    return result.p->QueryInterface(riid, ppv);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
@@ -52,7 +52,11 @@ private:
   public:
     UINT32 m_fourCC;
     CComPtr<IDxcBlob> m_Blob;
-    DxilPart(UINT32 fourCC, IDxcBlob *pSource) : m_fourCC(fourCC), m_Blob(pSource) {}
+    // Header of the part in the loaded container, or null for added parts.
+    const DxilPartHeader *m_pSourceHeader;
+    DxilPart(UINT32 fourCC, IDxcBlob *pSource,
+             const DxilPartHeader *pSourceHeader = nullptr)
+        : m_fourCC(fourCC), m_Blob(pSource), m_pSourceHeader(pSourceHeader) {}
   };
   typedef llvm::SmallVector<DxilPart, 8> PartList;
 
@@ -80,11 +84,11 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::Load(_In_ IDxcBlob *pSource) {
       const DxilPartHeader *pPartHeader = *it;
       CComPtr<IDxcBlobEncoding> pBlob;
       IFT(DxcCreateBlobWithEncodingFromPinned((const void *)(pPartHeader + 1), pPartHeader->PartSize, CP_UTF8, &pBlob));
-      PartList::iterator itPartList = std::find_if(m_parts.begin(), m_parts.end(), [&](DxilPart part) {
+      PartList::iterator itPartList = std::find_if(m_parts.begin(), m_parts.end(), [&](const DxilPart &part) {
         return part.m_fourCC == pPartHeader->PartFourCC;
       });
       IFTBOOL(itPartList == m_parts.end(), DXC_E_DUPLICATE_PART);
-      m_parts.emplace_back(DxilPart(pPartHeader->PartFourCC, pBlob));
+      m_parts.emplace_back(DxilPart(pPartHeader->PartFourCC, pBlob, pPartHeader));
     }
     return S_OK;
   }
@@ -104,7 +108,7 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::AddPart(_In_ UINT32 fourCC, _In_
         fourCC == DxilFourCC::DFCC_ShaderDebugName ||
         fourCC == DxilFourCC::DFCC_PrivateData, 
       E_INVALIDARG);
-    PartList::iterator it = std::find_if(m_parts.begin(), m_parts.end(), [&](DxilPart part) {
+    PartList::iterator it = std::find_if(m_parts.begin(), m_parts.end(), [&](const DxilPart &part) {
       return part.m_fourCC == fourCC;
     });
     IFTBOOL(it == m_parts.end(), DXC_E_DUPLICATE_PART);
@@ -121,13 +125,15 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::RemovePart(_In_ UINT32 fourCC) {
   DxcThreadMalloc TM(m_pMalloc);
   try {
     IFTBOOL(fourCC == DxilFourCC::DFCC_ShaderDebugInfoDXIL ||
+                fourCC == DxilFourCC::DFCC_ShaderDebugInfoCompressed ||
+                fourCC == DxilFourCC::DFCC_ShaderDebugLines ||
                 fourCC == DxilFourCC::DFCC_ShaderDebugName ||
                 fourCC == DxilFourCC::DFCC_RootSignature ||
                 fourCC == DxilFourCC::DFCC_PrivateData,
             E_INVALIDARG); // You can only remove debug info, debug info name, rootsignature, or private data blob
     PartList::iterator it =
       std::find_if(m_parts.begin(), m_parts.end(),
-        [&](DxilPart part) { return part.m_fourCC == fourCC; });
+        [&](const DxilPart &part) { return part.m_fourCC == fourCC; });
     IFTBOOL(it != m_parts.end(), DXC_E_MISSING_PART);
     m_parts.erase(it);
     return S_OK;
@@ -155,6 +161,13 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
     // Update Parts
     IFT(UpdateParts(pMemoryStream));
 
+    // Parts covered by the shader hash may have been added or removed.
+    DxilContainerHeader *pContainer = (DxilContainerHeader *)pMemoryStream->GetPtr();
+    if (DxilPartHeader *pHashPart = GetDxilPartByType(pContainer, DFCC_ShaderHash)) {
+      IFTBOOL(pHashPart->PartSize == sizeof(DxilShaderHash), DXC_E_CONTAINER_INVALID);
+      ComputeDxilShaderHash(pContainer, (DxilShaderHash *)GetDxilPartData(pHashPart));
+    }
+
     CComPtr<IDxcBlobEncoding> pErrorBlob;
     HRESULT valHR = S_OK;
     if (m_RequireValidation) {
@@ -193,7 +206,7 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
 
 UINT32 DxcContainerBuilder::ComputeContainerSize() {
   UINT32 partsSize = 0;
-  for (DxilPart part : m_parts) {
+  for (const DxilPart &part : m_parts) {
     partsSize += part.m_Blob->GetBufferSize();
   }
   return GetDxilContainerSizeFromParts(m_parts.size(), partsSize);
@@ -224,6 +237,22 @@ HRESULT DxcContainerBuilder::UpdateOffsetTable(AbstractMemoryStream *pStream) {
 HRESULT DxcContainerBuilder::UpdateParts(AbstractMemoryStream *pStream) {
   for (size_t i = 0; i < m_parts.size(); ++i) {
     ULONG cbWritten;
+    // Parts that were loaded next to each other are still laid out the same
+    // way in the source container, headers included, so write each such run
+    // straight from the source buffer.
+    if (const DxilPartHeader *pRunStart = m_parts[i].m_pSourceHeader) {
+      const char *pRunEnd = GetDxilPartData(pRunStart) + pRunStart->PartSize;
+      while (i + 1 < m_parts.size() &&
+             (const char *)m_parts[i + 1].m_pSourceHeader == pRunEnd) {
+        ++i;
+        pRunEnd = GetDxilPartData(m_parts[i].m_pSourceHeader) +
+                  m_parts[i].m_pSourceHeader->PartSize;
+      }
+      ULONG runSize = (ULONG)(pRunEnd - (const char *)pRunStart);
+      IFR(pStream->Write(pRunStart, runSize, &cbWritten));
+      if (cbWritten != runSize) { return E_FAIL; }
+      continue;
+    }
     CComPtr<IDxcBlob> pBlob = m_parts[i].m_Blob;
     // Write part header
     DxilPartHeader partHeader = { m_parts[i].m_fourCC, (uint32_t) pBlob->GetBufferSize() };
@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcspecializer.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the DirectX Specializer object.                                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/HLSL/ComputeViewIdState.h"
+#include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilMetadataHelper.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilRootSignature.h"
+#include "dxc/HLSL/DxilValidation.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/dxcapi.impl.h"
+#include "dxcutil.h"
+
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Scalar.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include <unordered_map>
+
+using namespace llvm;
+using namespace hlsl;
+
+class DxcSpecializer : public IDxcSpecializer {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcSpecializer)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcSpecializer>(this, iid, ppvObject);
+  }
+
+  // Set the specializable constants of a shader and fold what they decide.
+  __override HRESULT STDMETHODCALLTYPE Specialize(
+      _In_ IDxcBlob *pProgram, // Container compiled with -specializable.
+      _In_count_(valueCount) LPCWSTR *pNames, // Names of the constants to set.
+      _In_count_(valueCount) const UINT32 *pValues, // Bit patterns of the values.
+      _In_ UINT32 valueCount, // Number of constants to set.
+      _COM_Outptr_ IDxcOperationResult **ppResult // Output status, buffer, and errors
+      );
+};
+
+// Checks that every name set is a specializable constant of the module.
+static bool CheckSpecializableNames(
+    Module &M, const std::unordered_map<std::string, uint32_t> &Values,
+    raw_ostream &DiagStream) {
+  NamedMDNode *pSpecMD =
+      M.getNamedMetadata(DxilMDHelper::kDxilSpecializableMDName);
+  if (!pSpecMD) {
+    DiagStream << "error: shader has no specializable constants; compile "
+                  "it with -specializable.\n";
+    return false;
+  }
+  bool bAllFound = true;
+  for (auto &it : Values) {
+    bool bFound = false;
+    for (MDNode *pNode : pSpecMD->operands()) {
+      if (cast<MDString>(pNode->getOperand(0))->getString() == it.first) {
+        bFound = true;
+        break;
+      }
+    }
+    if (!bFound) {
+      DiagStream << "error: no specializable constant named '" << it.first
+                 << "'.\n";
+      bAllFound = false;
+    }
+  }
+  return bAllFound;
+}
+
+HRESULT STDMETHODCALLTYPE DxcSpecializer::Specialize(
+    _In_ IDxcBlob *pProgram, _In_count_(valueCount) LPCWSTR *pNames,
+    _In_count_(valueCount) const UINT32 *pValues, _In_ UINT32 valueCount,
+    _COM_Outptr_ IDxcOperationResult **ppResult) {
+  if (pProgram == nullptr || ppResult == nullptr ||
+      (valueCount > 0 && (pNames == nullptr || pValues == nullptr)))
+    return E_POINTER;
+
+  *ppResult = nullptr;
+  HRESULT hr = S_OK;
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    std::unordered_map<std::string, uint32_t> values;
+    for (UINT32 i = 0; i < valueCount; ++i) {
+      CW2A pUtf8Name(pNames[i], CP_UTF8);
+      values[pUtf8Name.m_psz] = pValues[i];
+    }
+
+    CComPtr<AbstractMemoryStream> pDiagStream;
+    IFT(CreateMemoryStream(TM.p, &pDiagStream));
+    raw_stream_ostream DiagStream(pDiagStream);
+    CComPtr<IStream> pErrorStream = pDiagStream;
+
+    const DxilContainerHeader *pContainer = IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    if (!pContainer ||
+        !IsValidDxilContainer(pContainer, pProgram->GetBufferSize()))
+      return E_INVALIDARG;
+
+    // Debug information isn't kept; the result has the program only.
+    LLVMContext Ctx;
+    std::unique_ptr<Module> M, pDebugModule;
+    if (FAILED(ValidateLoadModuleFromContainer(
+            pProgram->GetBufferPointer(), pProgram->GetBufferSize(), M,
+            pDebugModule, Ctx, Ctx, DiagStream)) ||
+        !CheckSpecializableNames(*M, values, DiagStream)) {
+      DiagStream.flush();
+      dxcutil::CreateOperationResultFromOutputs(nullptr, pErrorStream, "",
+                                                /*hasErrorOccurred*/ true,
+                                                ppResult);
+      return S_OK;
+    }
+
+    DxilModule &DM = M->GetOrCreateDxilModule();
+    if (DM.GetShaderModel()->IsLib()) {
+      DiagStream << "error: libraries cannot be specialized; specialize the "
+                    "linked shader.\n";
+      DiagStream.flush();
+      dxcutil::CreateOperationResultFromOutputs(nullptr, pErrorStream, "",
+                                                /*hasErrorOccurred*/ true,
+                                                ppResult);
+      return S_OK;
+    }
+    // The root signature is only in the container.
+    if (const DxilPartHeader *pRSPart =
+            GetDxilPartByType(pContainer, DFCC_RootSignature)) {
+      std::unique_ptr<RootSignatureHandle> pRootSig =
+          llvm::make_unique<RootSignatureHandle>();
+      pRootSig->LoadSerialized((const uint8_t *)GetDxilPartData(pRSPart),
+                               pRSPart->PartSize);
+      DM.ResetRootSignature(pRootSig.release());
+    }
+
+    // The module was optimized when compiled, so only what the values
+    // decide needs folding.
+    legacy::PassManager PM;
+    PM.add(createDxilSpecializeConstantsPass(values));
+    PM.add(createSCCPPass());
+    PM.add(createCFGSimplificationPass());
+    PM.add(createDeadCodeEliminationPass());
+    PM.add(createDxilCondenseResourcesPass(/*Allocated*/ true));
+    PM.add(createComputeViewIdStatePass());
+    PM.add(createDxilEmitMetadataPass());
+    PM.run(*M);
+
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    IFT(CreateMemoryStream(TM.p, &pOutputStream));
+    raw_stream_ostream outStream(pOutputStream.p);
+    // Create bitcode of M.
+    WriteBitcodeToFile(M.get(), outStream);
+    outStream.flush();
+
+    const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
+        new clang::DiagnosticIDs);
+    IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+        new clang::DiagnosticOptions();
+    // Construct our diagnostic client.
+    clang::TextDiagnosticPrinter *DiagClient =
+        new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
+    clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
+
+    CComPtr<IDxcBlob> pResultBlob;
+    HRESULT valHR = dxcutil::ValidateAndAssembleToContainer(
+        std::move(M), pResultBlob, TM.p, SerializeDxilFlags::None,
+        pOutputStream, /*bDebugInfo*/ false, Diag);
+    DiagStream.flush();
+
+    dxcutil::CreateOperationResultFromOutputs(
+        pResultBlob, pErrorStream, "",
+        FAILED(valHR) || Diag.hasErrorOccurred(), ppResult);
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+
+  return hr;
+}
+
+HRESULT CreateDxcSpecializer(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  CComPtr<DxcSpecializer> result =
+      DxcSpecializer::Alloc(DxcGetThreadMallocNoRef());
+  if (result == nullptr) {
+    *ppv = nullptr;
+    return E_OUTOFMEMORY;
+  }
+
+  return result.p->QueryInterface(riid, ppv);
+}
@@ -0,0 +1,727 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxcstagelinker.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements the DirectX Stage Linker object.                               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/microcom.h"
+#include "dxc/HLSL/ComputeViewIdState.h"
+#include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilRootSignature.h"
+#include "dxc/HLSL/DxilSignatureAllocator.h"
+#include "dxc/HLSL/DxilValidation.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/dxcapi.impl.h"
+#include "dxcutil.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Scalar.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+using namespace llvm;
+using namespace hlsl;
+
+class DxcStageLinker : public IDxcStageLinker {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_CTOR(DxcStageLinker)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcStageLinker>(this, iid, ppvObject);
+  }
+
+  // Remove the outputs of a stage that the next one doesn't read.
+  __override HRESULT STDMETHODCALLTYPE LinkStages(
+      _In_ IDxcBlob *pProducer, // Container of the earlier stage.
+      _In_ IDxcBlob *pConsumer, // Container of the stage reading its outputs.
+      _COM_Outptr_ IDxcOperationResult **ppProducerResult, // Linked producer
+      _COM_Outptr_ IDxcOperationResult **ppConsumerResult  // Linked consumer
+      );
+};
+
+namespace {
+
+// Links the output signature of one stage to the input signature of the
+// next. Rows are matched by semantic name and index, so elements that are
+// packed or split differently on the two sides still match.
+class StageLinker {
+public:
+  StageLinker(DxilModule &Producer, DxilModule &Consumer)
+      : m_Producer(Producer), m_Consumer(Consumer),
+        m_OutSig(Producer.GetOutputSignature()),
+        m_InSig(Consumer.GetInputSignature()) {}
+
+  void Run();
+
+private:
+  typedef std::pair<unsigned, unsigned> ElementRow;
+  static const unsigned kNoElement = UINT_MAX;
+
+  void MatchRows();
+  void CollectStoredOutputs();
+  void FoldConstantInputs();
+  void FindRemovedElements();
+  bool IsExactMatch(unsigned inElt) const;
+  bool IsPerPrimitive(Value *V);
+  bool IsPerPrimitiveInst(Instruction *I);
+  bool IsPerPrimitiveElement(unsigned inElt);
+  bool NarrowInterpolation();
+  void RemoveElements();
+  void PackElements();
+
+  unsigned Find(unsigned node) {
+    while (m_Groups[node] != node)
+      node = m_Groups[node] = m_Groups[m_Groups[node]];
+    return node;
+  }
+
+  DxilModule &m_Producer;
+  DxilModule &m_Consumer;
+  DxilSignature &m_OutSig;
+  DxilSignature &m_InSig;
+  std::vector<CallInst *> m_Stores;
+  std::vector<CallInst *> m_Reads;
+  // The producer row of each consumer row, or kNoElement.
+  std::vector<std::vector<ElementRow>> m_InRows;
+  // The value each producer component is always set to, or null.
+  std::map<std::tuple<unsigned, unsigned, unsigned>, Value *> m_StoredValues;
+  // Whether each producer value is the same for all vertices of a primitive.
+  DenseMap<Value *, bool> m_PerPrimitive;
+  std::vector<bool> m_DynamicStores;
+  std::vector<bool> m_InRead;
+  std::vector<bool> m_OutRemoved;
+  std::vector<bool> m_InRemoved;
+  // Union-find over the producer elements followed by the consumer elements.
+  std::vector<unsigned> m_Groups;
+};
+
+} // namespace
+
+static bool CanLinkStages(DXIL::ShaderKind producer,
+                          DXIL::ShaderKind consumer) {
+  switch (producer) {
+  case DXIL::ShaderKind::Vertex:
+    return consumer == DXIL::ShaderKind::Hull ||
+           consumer == DXIL::ShaderKind::Geometry ||
+           consumer == DXIL::ShaderKind::Pixel;
+  case DXIL::ShaderKind::Domain:
+    return consumer == DXIL::ShaderKind::Geometry ||
+           consumer == DXIL::ShaderKind::Pixel;
+  case DXIL::ShaderKind::Geometry:
+    return consumer == DXIL::ShaderKind::Pixel;
+  default:
+    return false;
+  }
+}
+
+static void CollectSigCalls(Module &M, ArrayRef<DXIL::OpCode> opcodes,
+                            std::vector<CallInst *> &calls) {
+  for (Function &F : M.functions()) {
+    if (!OP::IsDxilOpFunc(&F))
+      continue;
+    for (User *U : F.users()) {
+      CallInst *CI = dyn_cast<CallInst>(U);
+      if (CI && std::find(opcodes.begin(), opcodes.end(),
+                          OP::GetDxilOpFuncCallInst(CI)) != opcodes.end())
+        calls.push_back(CI);
+    }
+  }
+}
+
+static unsigned GetConstantOperand(CallInst *CI, unsigned idx) {
+  return cast<ConstantInt>(CI->getArgOperand(idx))->getZExtValue();
+}
+
+void StageLinker::MatchRows() {
+  std::map<std::pair<std::string, unsigned>, ElementRow> outRows;
+  for (auto &SE : m_OutSig.GetElements()) {
+    // Only stream 0 is rasterized.
+    if (SE->GetOutputStream() != 0)
+      continue;
+    const std::vector<unsigned> &indices = SE->GetSemanticIndexVec();
+    for (unsigned row = 0; row < indices.size(); ++row)
+      outRows[std::make_pair(SE->GetSemanticName().upper(), indices[row])] =
+          ElementRow(SE->GetID(), row);
+  }
+  for (auto &SE : m_InSig.GetElements()) {
+    std::vector<ElementRow> rows;
+    for (unsigned index : SE->GetSemanticIndexVec()) {
+      auto it = outRows.find(
+          std::make_pair(SE->GetSemanticName().upper(), index));
+      rows.emplace_back(it == outRows.end() ? ElementRow(kNoElement, 0)
+                                            : it->second);
+    }
+    m_InRows.emplace_back(std::move(rows));
+  }
+}
+
+void StageLinker::CollectStoredOutputs() {
+  m_DynamicStores.assign(m_OutSig.GetElements().size(), false);
+  for (CallInst *CI : m_Stores) {
+    DxilInst_StoreOutput store(CI);
+    unsigned elt = GetConstantOperand(CI, DxilInst_StoreOutput::arg_outputSigId);
+    ConstantInt *pRow = dyn_cast<ConstantInt>(store.get_rowIndex());
+    ConstantInt *pCol = dyn_cast<ConstantInt>(store.get_colIndex());
+    if (!pRow || !pCol) {
+      m_DynamicStores[elt] = true;
+      continue;
+    }
+    // An output isn't defined where it isn't written, so undef stores don't
+    // count against a value.
+    Value *pValue = store.get_value();
+    if (isa<UndefValue>(pValue))
+      continue;
+    auto key = std::make_tuple(elt, (unsigned)pRow->getZExtValue(),
+                               (unsigned)pCol->getZExtValue());
+    auto it = m_StoredValues.emplace(key, pValue);
+    if (!it.second && it.first->second != pValue)
+      it.first->second = nullptr;
+  }
+}
+
+void StageLinker::FoldConstantInputs() {
+  m_InRead.assign(m_InSig.GetElements().size(), false);
+  std::vector<CallInst *> reads;
+  for (CallInst *CI : m_Reads) {
+    unsigned inElt = GetConstantOperand(CI, DxilInst_LoadInput::arg_inputSigId);
+    // Interpolation keeps a constant the same, but only plain loads are
+    // folded; evaluated attributes count as reads.
+    if (OP::GetDxilOpFuncCallInst(CI) == DXIL::OpCode::LoadInput &&
+        m_InSig.GetElement(inElt).IsArbitrary()) {
+      DxilInst_LoadInput load(CI);
+      ConstantInt *pRow = dyn_cast<ConstantInt>(load.get_rowIndex());
+      ConstantInt *pCol = dyn_cast<ConstantInt>(load.get_colIndex());
+      if (pRow && pCol && pRow->getZExtValue() < m_InRows[inElt].size()) {
+        ElementRow outRow = m_InRows[inElt][pRow->getZExtValue()];
+        if (outRow.first != kNoElement && !m_DynamicStores[outRow.first]) {
+          auto it = m_StoredValues.find(std::make_tuple(
+              outRow.first, outRow.second, (unsigned)pCol->getZExtValue()));
+          Constant *pConst = it == m_StoredValues.end()
+                                 ? nullptr
+                                 : dyn_cast_or_null<Constant>(it->second);
+          if (pConst && pConst->getType() == CI->getType()) {
+            CI->replaceAllUsesWith(pConst);
+            CI->eraseFromParent();
+            continue;
+          }
+        }
+      }
+    }
+    m_InRead[inElt] = true;
+    reads.push_back(CI);
+  }
+  m_Reads.swap(reads);
+}
+
+void StageLinker::FindRemovedElements() {
+  unsigned numOut = m_OutSig.GetElements().size();
+  unsigned numIn = m_InSig.GetElements().size();
+  m_Groups.resize(numOut + numIn);
+  for (unsigned i = 0; i < m_Groups.size(); ++i)
+    m_Groups[i] = i;
+
+  // Elements sharing a row are kept or removed together.
+  std::vector<bool> unmatched(numIn, false);
+  for (unsigned inElt = 0; inElt < numIn; ++inElt) {
+    for (ElementRow outRow : m_InRows[inElt]) {
+      if (outRow.first == kNoElement)
+        unmatched[inElt] = true;
+      else
+        m_Groups[Find(numOut + inElt)] = Find(outRow.first);
+    }
+  }
+
+  // System values and the other streams are used past the consumer, and
+  // consumer elements that aren't fed by the producer come from elsewhere.
+  std::vector<bool> keep(m_Groups.size(), false);
+  for (unsigned outElt = 0; outElt < numOut; ++outElt) {
+    const DxilSignatureElement &SE = m_OutSig.GetElement(outElt);
+    if (!SE.IsArbitrary() || SE.GetOutputStream() != 0)
+      keep[Find(outElt)] = true;
+  }
+  for (unsigned inElt = 0; inElt < numIn; ++inElt) {
+    if (!m_InSig.GetElement(inElt).IsArbitrary() || m_InRead[inElt] ||
+        unmatched[inElt])
+      keep[Find(numOut + inElt)] = true;
+  }
+
+  m_OutRemoved.resize(numOut);
+  for (unsigned outElt = 0; outElt < numOut; ++outElt)
+    m_OutRemoved[outElt] = !keep[Find(outElt)];
+  m_InRemoved.resize(numIn);
+  for (unsigned inElt = 0; inElt < numIn; ++inElt)
+    m_InRemoved[inElt] = !keep[Find(numOut + inElt)];
+}
+
+// Returns true if the consumer element has the shape of one producer element,
+// or isn't fed by the producer at all.
+bool StageLinker::IsExactMatch(unsigned inElt) const {
+  const std::vector<ElementRow> &rows = m_InRows[inElt];
+  if (std::all_of(rows.begin(), rows.end(), [](ElementRow outRow) {
+        return outRow.first == kNoElement;
+      }))
+    return true;
+  unsigned outElt = rows[0].first;
+  if (outElt == kNoElement ||
+      m_OutSig.GetElement(outElt).GetRows() != rows.size() ||
+      m_OutSig.GetElement(outElt).GetCols() !=
+          m_InSig.GetElement(inElt).GetCols())
+    return false;
+  for (unsigned row = 0; row < rows.size(); ++row) {
+    if (rows[row] != ElementRow(outElt, row))
+      return false;
+  }
+  return true;
+}
+
+bool StageLinker::IsPerPrimitive(Value *V) {
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I)
+    return isa<Constant>(V);
+  auto it = m_PerPrimitive.find(I);
+  if (it != m_PerPrimitive.end())
+    return it->second;
+  // Phis can only reach themselves through other phis.
+  m_PerPrimitive[I] = false;
+  bool bPerPrimitive = IsPerPrimitiveInst(I);
+  m_PerPrimitive[I] = bPerPrimitive;
+  return bPerPrimitive;
+}
+
+// Returns true if I computes the same value for all the vertices of a
+// primitive: from constants, read-only resources, and values the producer
+// gets once per instance, patch, primitive or view.
+bool StageLinker::IsPerPrimitiveInst(Instruction *I) {
+  // Which value a phi takes depends on the path taken to it.
+  if (PHINode *Phi = dyn_cast<PHINode>(I)) {
+    Value *pSame = Phi->hasConstantValue();
+    return pSame && IsPerPrimitive(pSame);
+  }
+
+  unsigned firstOperand = 0;
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    if (!OP::IsDxilOpFuncCallInst(CI))
+      return false;
+    DXIL::OpCode opcode = OP::GetDxilOpFuncCallInst(CI);
+    switch (OP::GetOpCodeClass(opcode)) {
+    default:
+      return false;
+    case DXIL::OpCodeClass::Unary:
+    case DXIL::OpCodeClass::UnaryBits:
+    case DXIL::OpCodeClass::IsSpecialFloat:
+    case DXIL::OpCodeClass::Binary:
+    case DXIL::OpCodeClass::BinaryWithCarryOrBorrow:
+    case DXIL::OpCodeClass::BinaryWithTwoOuts:
+    case DXIL::OpCodeClass::Tertiary:
+    case DXIL::OpCodeClass::Quaternary:
+    case DXIL::OpCodeClass::Dot2:
+    case DXIL::OpCodeClass::Dot3:
+    case DXIL::OpCodeClass::Dot4:
+    case DXIL::OpCodeClass::MakeDouble:
+    case DXIL::OpCodeClass::SplitDouble:
+    case DXIL::OpCodeClass::LegacyF16ToF32:
+    case DXIL::OpCodeClass::LegacyF32ToF16:
+    case DXIL::OpCodeClass::LegacyDoubleToFloat:
+    case DXIL::OpCodeClass::LegacyDoubleToSInt32:
+    case DXIL::OpCodeClass::LegacyDoubleToUInt32:
+    case DXIL::OpCodeClass::ViewID:
+    case DXIL::OpCodeClass::PrimitiveID:
+    case DXIL::OpCodeClass::GSInstanceID:
+    case DXIL::OpCodeClass::LoadPatchConstant:
+    // Reads are checked through their handle.
+    case DXIL::OpCodeClass::CBufferLoad:
+    case DXIL::OpCodeClass::CBufferLoadLegacy:
+    case DXIL::OpCodeClass::BufferLoad:
+    case DXIL::OpCodeClass::RawBufferLoad:
+    case DXIL::OpCodeClass::TextureLoad:
+    case DXIL::OpCodeClass::SampleLevel:
+    case DXIL::OpCodeClass::GetDimensions:
+      break;
+    case DXIL::OpCodeClass::CreateHandle: {
+      // Other vertices may write to a UAV.
+      ConstantInt *pClass =
+          dyn_cast<ConstantInt>(DxilInst_CreateHandle(CI).get_resourceClass());
+      if (!pClass ||
+          (pClass->getZExtValue() != (unsigned)DXIL::ResourceClass::SRV &&
+           pClass->getZExtValue() != (unsigned)DXIL::ResourceClass::CBuffer))
+        return false;
+      break;
+    }
+    case DXIL::OpCodeClass::LoadInput: {
+      // Of the vertex inputs, only the instance is shared by a primitive.
+      if (!m_Producer.GetShaderModel()->IsVS())
+        return false;
+      ConstantInt *pID = dyn_cast<ConstantInt>(
+          CI->getArgOperand(DxilInst_LoadInput::arg_inputSigId));
+      if (!pID || pID->getZExtValue() >=
+                      m_Producer.GetInputSignature().GetElements().size() ||
+          m_Producer.GetInputSignature()
+                  .GetElement(pID->getZExtValue())
+                  .GetKind() != Semantic::Kind::InstanceID)
+        return false;
+      break;
+    }
+    }
+    // The first operand is the opcode.
+    firstOperand = 1;
+  } else if (!isa<BinaryOperator>(I) && !isa<CastInst>(I) &&
+             !isa<CmpInst>(I) && !isa<SelectInst>(I) &&
+             !isa<ExtractValueInst>(I) && !isa<InsertValueInst>(I) &&
+             !isa<ExtractElementInst>(I) && !isa<InsertElementInst>(I)) {
+    return false;
+  }
+
+  for (unsigned i = firstOperand; i < I->getNumOperands(); ++i) {
+    Value *pOp = I->getOperand(i);
+    if (!isa<Function>(pOp) && !IsPerPrimitive(pOp))
+      return false;
+  }
+  return true;
+}
+
+// Returns true if all the components of a consumer element are written by
+// the producer with a value that is the same for all the vertices of a
+// primitive, so that interpolating them gives that value.
+bool StageLinker::IsPerPrimitiveElement(unsigned inElt) {
+  const DxilSignatureElement &SE = m_InSig.GetElement(inElt);
+  for (ElementRow outRow : m_InRows[inElt]) {
+    if (outRow.first == kNoElement || m_DynamicStores[outRow.first])
+      return false;
+    for (unsigned col = 0; col < SE.GetCols(); ++col) {
+      auto it = m_StoredValues.find(
+          std::make_tuple(outRow.first, outRow.second, col));
+      if (it == m_StoredValues.end())
+        continue;
+      if (!it->second || !IsPerPrimitive(it->second))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Makes the pixel shader inputs that are the same for all the vertices of a
+// primitive nointerpolation, and the producer outputs feeding them, so that
+// the hardware passes the provoking vertex's value rather than interpolating
+// the same value. Inputs with sample interpolation are kept, since they
+// decide whether the shader runs per sample, as are inputs that are
+// evaluated at other locations. Returns true if any input was changed; the
+// caller packs the signatures again.
+bool StageLinker::NarrowInterpolation() {
+  if (!m_Consumer.GetShaderModel()->IsPS())
+    return false;
+
+  std::vector<bool> evaluated(m_InSig.GetElements().size(), false);
+  for (CallInst *CI : m_Reads) {
+    if (OP::GetDxilOpFuncCallInst(CI) != DXIL::OpCode::LoadInput)
+      evaluated[GetConstantOperand(CI, DxilInst_LoadInput::arg_inputSigId)] =
+          true;
+  }
+
+  bool bNarrowed = false;
+  const InterpolationMode constantMode(InterpolationMode::Kind::Constant);
+  for (unsigned inElt = 0; inElt < m_InRows.size(); ++inElt) {
+    DxilSignatureElement &SE = m_InSig.GetElement(inElt);
+    const InterpolationMode *pMode = SE.GetInterpolationMode();
+    if (m_InRemoved[inElt] || !SE.IsArbitrary() || !pMode->IsAnyLinear() ||
+        pMode->IsAnySample() || evaluated[inElt] ||
+        !IsPerPrimitiveElement(inElt))
+      continue;
+    SE.SetInterpolationMode(constantMode);
+    // Packing again needs the elements to match one to one.
+    m_OutSig.GetElement(m_InRows[inElt][0].first)
+        .SetInterpolationMode(constantMode);
+    bNarrowed = true;
+  }
+  return bNarrowed;
+}
+
+void StageLinker::RemoveElements() {
+  std::vector<unsigned> outIDs = m_OutSig.RemoveElements(m_OutRemoved);
+  for (CallInst *CI : m_Stores) {
+    unsigned newID =
+        outIDs[GetConstantOperand(CI, DxilInst_StoreOutput::arg_outputSigId)];
+    if (newID == UINT_MAX) {
+      CI->eraseFromParent();
+      continue;
+    }
+    Value *pID = CI->getArgOperand(DxilInst_StoreOutput::arg_outputSigId);
+    CI->setArgOperand(DxilInst_StoreOutput::arg_outputSigId,
+                      ConstantInt::get(pID->getType(), newID));
+  }
+
+  std::vector<unsigned> inIDs = m_InSig.RemoveElements(m_InRemoved);
+  for (CallInst *CI : m_Reads) {
+    unsigned newID =
+        inIDs[GetConstantOperand(CI, DxilInst_LoadInput::arg_inputSigId)];
+    DXASSERT(newID != UINT_MAX, "otherwise, a read element was removed");
+    Value *pID = CI->getArgOperand(DxilInst_LoadInput::arg_inputSigId);
+    CI->setArgOperand(DxilInst_LoadInput::arg_inputSigId,
+                      ConstantInt::get(pID->getType(), newID));
+  }
+}
+
+// Packs the consumer inputs and places the producer outputs they read at the
+// same locations; the other producer outputs are packed around them.
+void StageLinker::PackElements() {
+  m_InSig.PackElements(DXIL::PackingStrategy::Optimized);
+  std::vector<int> startRows(m_OutSig.GetElements().size(), -1);
+  std::vector<int> startCols(m_OutSig.GetElements().size(), -1);
+  for (auto &SE : m_InSig.GetElements()) {
+    if (!SE->IsAllocated())
+      continue;
+    unsigned outElt = m_InRows[SE->GetID()][0].first;
+    if (outElt == kNoElement)
+      continue;
+    startRows[outElt] = SE->GetStartRow();
+    startCols[outElt] = SE->GetStartCol();
+  }
+
+  DxilSignatureAllocator alloc(32, m_OutSig.UseMinPrecision());
+  std::vector<DxilPackElement> pending;
+  for (auto &SE : m_OutSig.GetElements()) {
+    if (!SE->IsAllocated() || SE->GetOutputStream() != 0)
+      continue;
+    DxilPackElement PE(SE.get(), m_OutSig.UseMinPrecision());
+    if (startRows[SE->GetID()] < 0) {
+      pending.push_back(PE);
+      continue;
+    }
+    PE.SetLocation(startRows[SE->GetID()], startCols[SE->GetID()]);
+    alloc.PlaceElement(&PE, PE.GetStartRow(), PE.GetStartCol());
+  }
+  for (DxilPackElement &PE : pending) {
+    PE.ClearLocation();
+    alloc.PackNext(&PE, 0, 32);
+  }
+}
+
+void StageLinker::Run() {
+  CollectSigCalls(*m_Producer.GetModule(), {DXIL::OpCode::StoreOutput},
+                  m_Stores);
+  CollectSigCalls(*m_Consumer.GetModule(),
+                  {DXIL::OpCode::LoadInput, DXIL::OpCode::EvalSnapped,
+                   DXIL::OpCode::EvalSampleIndex, DXIL::OpCode::EvalCentroid},
+                  m_Reads);
+
+  MatchRows();
+  CollectStoredOutputs();
+  FoldConstantInputs();
+  FindRemovedElements();
+
+  // Packing again is only safe when the remaining consumer elements each
+  // take a whole producer element of the same width; otherwise the
+  // locations are kept.
+  bool bRemoved = false;
+  bool bRepack = true;
+  for (unsigned inElt = 0; inElt < m_InRows.size(); ++inElt) {
+    bRemoved |= m_InRemoved[inElt];
+    if (!m_InRemoved[inElt] && m_InSig.GetElement(inElt).IsAllocated() &&
+        !IsExactMatch(inElt))
+      bRepack = false;
+  }
+  for (bool bOutRemoved : m_OutRemoved)
+    bRemoved |= bOutRemoved;
+  // Rows can't mix interpolation modes, so inputs are only narrowed when
+  // the signatures can be packed again.
+  bool bNarrowed = bRepack && NarrowInterpolation();
+  if (!bRemoved && !bNarrowed)
+    return;
+
+  // The IDs of the elements kept are renumbered, so the matches are too.
+  std::vector<std::vector<ElementRow>> inRows;
+  std::vector<unsigned> outIDs(m_OutRemoved.size());
+  for (unsigned outElt = 0, newID = 0; outElt < m_OutRemoved.size(); ++outElt)
+    outIDs[outElt] = m_OutRemoved[outElt] ? kNoElement : newID++;
+  for (unsigned inElt = 0; inElt < m_InRows.size(); ++inElt) {
+    if (m_InRemoved[inElt])
+      continue;
+    for (ElementRow &outRow : m_InRows[inElt]) {
+      if (outRow.first != kNoElement)
+        outRow.first = outIDs[outRow.first];
+    }
+    inRows.emplace_back(std::move(m_InRows[inElt]));
+  }
+  m_InRows.swap(inRows);
+
+  RemoveElements();
+  if (bRepack)
+    PackElements();
+}
+
+// Loads a stage for linking with its root signature, which is only in the
+// container.
+static bool LoadStage(IDxcBlob *pProgram, LLVMContext &Ctx,
+                      raw_ostream &DiagStream, std::unique_ptr<Module> &M) {
+  const DxilContainerHeader *pContainer = IsDxilContainerLike(
+      pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+  if (!pContainer ||
+      !IsValidDxilContainer(pContainer, pProgram->GetBufferSize())) {
+    DiagStream << "error: stage is not a valid container.\n";
+    return false;
+  }
+
+  // Debug information isn't kept; the results have the programs only.
+  std::unique_ptr<Module> pDebugModule;
+  if (FAILED(ValidateLoadModuleFromContainer(
+          pProgram->GetBufferPointer(), pProgram->GetBufferSize(), M,
+          pDebugModule, Ctx, Ctx, DiagStream)))
+    return false;
+
+  DxilModule &DM = M->GetOrCreateDxilModule();
+  if (DM.GetShaderModel()->IsLib()) {
+    DiagStream << "error: libraries cannot be linked as stages; link the "
+                  "shaders first.\n";
+    return false;
+  }
+  if (const DxilPartHeader *pRSPart =
+          GetDxilPartByType(pContainer, DFCC_RootSignature)) {
+    std::unique_ptr<RootSignatureHandle> pRootSig =
+        llvm::make_unique<RootSignatureHandle>();
+    pRootSig->LoadSerialized((const uint8_t *)GetDxilPartData(pRSPart),
+                             pRSPart->PartSize);
+    DM.ResetRootSignature(pRootSig.release());
+  }
+  return true;
+}
+
+static void AssembleStage(std::unique_ptr<Module> M, IMalloc *pMalloc,
+                          IDxcOperationResult **ppResult) {
+  CComPtr<AbstractMemoryStream> pDiagStream;
+  IFT(CreateMemoryStream(pMalloc, &pDiagStream));
+  raw_stream_ostream DiagStream(pDiagStream);
+  CComPtr<IStream> pErrorStream = pDiagStream;
+
+  CComPtr<AbstractMemoryStream> pOutputStream;
+  IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+  raw_stream_ostream outStream(pOutputStream.p);
+  // Create bitcode of M.
+  WriteBitcodeToFile(M.get(), outStream);
+  outStream.flush();
+
+  const IntrusiveRefCntPtr<clang::DiagnosticIDs> Diags(
+      new clang::DiagnosticIDs);
+  IntrusiveRefCntPtr<clang::DiagnosticOptions> DiagOpts =
+      new clang::DiagnosticOptions();
+  // Construct our diagnostic client.
+  clang::TextDiagnosticPrinter *DiagClient =
+      new clang::TextDiagnosticPrinter(DiagStream, &*DiagOpts);
+  clang::DiagnosticsEngine Diag(Diags, &*DiagOpts, DiagClient);
+
+  CComPtr<IDxcBlob> pResultBlob;
+  HRESULT valHR = dxcutil::ValidateAndAssembleToContainer(
+      std::move(M), pResultBlob, pMalloc, SerializeDxilFlags::None,
+      pOutputStream, /*bDebugInfo*/ false, Diag);
+  DiagStream.flush();
+
+  dxcutil::CreateOperationResultFromOutputs(
+      pResultBlob, pErrorStream, "", FAILED(valHR) || Diag.hasErrorOccurred(),
+      ppResult);
+}
+
+HRESULT STDMETHODCALLTYPE DxcStageLinker::LinkStages(
+    _In_ IDxcBlob *pProducer, _In_ IDxcBlob *pConsumer,
+    _COM_Outptr_ IDxcOperationResult **ppProducerResult,
+    _COM_Outptr_ IDxcOperationResult **ppConsumerResult) {
+  if (pProducer == nullptr || pConsumer == nullptr ||
+      ppProducerResult == nullptr || ppConsumerResult == nullptr)
+    return E_POINTER;
+
+  *ppProducerResult = nullptr;
+  *ppConsumerResult = nullptr;
+  HRESULT hr = S_OK;
+  DxcThreadMalloc TM(m_pMalloc);
+  try {
+    CComPtr<AbstractMemoryStream> pDiagStream;
+    IFT(CreateMemoryStream(TM.p, &pDiagStream));
+    raw_stream_ostream DiagStream(pDiagStream);
+    CComPtr<IStream> pErrorStream = pDiagStream;
+
+    // Both stages share a context so constants can move between them.
+    LLVMContext Ctx;
+    std::unique_ptr<Module> pProducerModule, pConsumerModule;
+    bool bLoaded = LoadStage(pProducer, Ctx, DiagStream, pProducerModule) &&
+                   LoadStage(pConsumer, Ctx, DiagStream, pConsumerModule);
+    if (bLoaded &&
+        !CanLinkStages(
+            pProducerModule->GetDxilModule().GetShaderModel()->GetKind(),
+            pConsumerModule->GetDxilModule().GetShaderModel()->GetKind())) {
+      DiagStream << "error: the consumer can't follow the producer in a "
+                    "pipeline.\n";
+      bLoaded = false;
+    }
+    if (!bLoaded) {
+      DiagStream.flush();
+      dxcutil::CreateOperationResultFromOutputs(nullptr, pErrorStream, "",
+                                                /*hasErrorOccurred*/ true,
+                                                ppProducerResult);
+      dxcutil::CreateOperationResultFromOutputs(nullptr, pErrorStream, "",
+                                                /*hasErrorOccurred*/ true,
+                                                ppConsumerResult);
+      return S_OK;
+    }
+
+    StageLinker(pProducerModule->GetDxilModule(),
+                pConsumerModule->GetDxilModule()).Run();
+
+    // Removed outputs leave their code dead in the producer, and folded
+    // inputs leave constants to propagate in the consumer.
+    for (Module *M : {pProducerModule.get(), pConsumerModule.get()}) {
+      legacy::PassManager PM;
+      PM.add(createSCCPPass());
+      PM.add(createCFGSimplificationPass());
+      PM.add(createDeadCodeEliminationPass());
+      PM.add(createDxilCondenseResourcesPass(/*Allocated*/ true));
+      PM.add(createComputeViewIdStatePass());
+      PM.add(createDxilEmitMetadataPass());
+      PM.run(*M);
+    }
+
+    AssembleStage(std::move(pProducerModule), TM.p, ppProducerResult);
+    AssembleStage(std::move(pConsumerModule), TM.p, ppConsumerResult);
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+
+  if (FAILED(hr)) {
+    for (IDxcOperationResult **ppResult : {ppProducerResult, ppConsumerResult}) {
+      if (*ppResult) {
+        (*ppResult)->Release();
+        *ppResult = nullptr;
+      }
+    }
+  }
+  return hr;
+}
+
+HRESULT CreateDxcStageLinker(_In_ REFIID riid, _Out_ LPVOID *ppv) {
+  CComPtr<DxcStageLinker> result =
+      DxcStageLinker::Alloc(DxcGetThreadMallocNoRef());
+  if (result == nullptr) {
+    *ppv = nullptr;
+    return E_OUTOFMEMORY;
+  }
+
+  return result.p->QueryInterface(riid, ppv);
+}
@@ -13,6 +13,7 @@
 
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxcTimeReport.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/dxcapi.h"
@@ -23,13 +24,16 @@
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "dxc/Support/dxcapi.impl.h"
 
 #include "llvm/Support/Path.h"
+#include <set>
 
 using namespace llvm;
 using namespace hlsl;
@@ -51,7 +55,7 @@ namespace {
 
 bool CreateValidator(CComPtr<IDxcValidator> &pValidator) {
   if (DxilLibIsEnabled()) {
-    DxilLibCreateInstance(CLSID_DxcValidator, &pValidator);
+    DxilLibGetThreadValidator(&pValidator);
   }
   bool bInternalValidator = false;
   if (pValidator == nullptr) {
@@ -75,14 +79,23 @@ public:
   void WrapModuleInDxilContainer(IMalloc *pMalloc,
                                  AbstractMemoryStream *pModuleBitcode,
                                  CComPtr<IDxcBlob> &pDxilContainerBlob,
-                                 SerializeDxilFlags Flags) {
+                                 SerializeDxilFlags Flags,
+                                 CComPtr<IDxcBlob> *ppSidecarBlob) {
     CComPtr<AbstractMemoryStream> pContainerStream;
+    CComPtr<AbstractMemoryStream> pSidecarStream;
     IFT(CreateMemoryStream(pMalloc, &pContainerStream));
+    if (ppSidecarBlob)
+      IFT(CreateMemoryStream(pMalloc, &pSidecarStream));
     SerializeDxilContainerForModule(&m_llvmModule->GetOrCreateDxilModule(),
-                                    pModuleBitcode, pContainerStream, Flags);
+                                    pModuleBitcode, pContainerStream, Flags,
+                                    pSidecarStream);
 
     pDxilContainerBlob.Release();
     IFT(pContainerStream.QueryInterface(&pDxilContainerBlob));
+    if (ppSidecarBlob) {
+      ppSidecarBlob->Release();
+      IFT(pSidecarStream.QueryInterface(&*ppSidecarBlob));
+    }
   }
 
   llvm::Module *get() { return m_llvmModule.get(); }
@@ -96,13 +109,8 @@ private:
 } // namespace
 
 namespace dxcutil {
-void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor) {
-  if (pMajor == nullptr || pMinor == nullptr)
-    return;
-
-  CComPtr<IDxcValidator> pValidator;
-  CreateValidator(pValidator);
-
+static void GetValidatorVersion(CComPtr<IDxcValidator> &pValidator,
+                                unsigned *pMajor, unsigned *pMinor) {
   CComPtr<IDxcVersionInfo> pVersionInfo;
   if (SUCCEEDED(pValidator.QueryInterface(&pVersionInfo))) {
     IFT(pVersionInfo->GetVersion(pMajor, pMinor));
@@ -113,30 +121,62 @@ void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor) {
   }
 }
 
+void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor) {
+  if (pMajor == nullptr || pMinor == nullptr)
+    return;
+
+  CComPtr<IDxcValidator> pValidator;
+  CreateValidator(pValidator);
+  GetValidatorVersion(pValidator, pMajor, pMinor);
+}
+
+IDxcValidator *CachedValidator::Get(bool *pInternal) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (m_pValidator == nullptr) {
+    m_bInternal = CreateValidator(m_pValidator);
+    GetValidatorVersion(m_pValidator, &m_major, &m_minor);
+  }
+  *pInternal = m_bInternal;
+  return m_pValidator;
+}
+
+void CachedValidator::GetVersion(unsigned *pMajor, unsigned *pMinor) {
+  bool bInternal;
+  Get(&bInternal);
+  *pMajor = m_major;
+  *pMinor = m_minor;
+}
+
 void AssembleToContainer(std::unique_ptr<llvm::Module> pM,
                          CComPtr<IDxcBlob> &pOutputBlob,
                          IMalloc *pMalloc,
                          SerializeDxilFlags SerializeFlags,
-                         CComPtr<AbstractMemoryStream> &pOutputStream) {
+                         CComPtr<AbstractMemoryStream> &pOutputStream,
+                         CComPtr<IDxcBlob> *ppSidecarBlob) {
   // Take ownership of the module from the action.
   DxilCompilerLLVMModuleOutput llvmModule(std::move(pM));
 
   llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob,
-                                       SerializeFlags);
+                                       SerializeFlags, ppSidecarBlob);
 }
 
 HRESULT ValidateAndAssembleToContainer(
     std::unique_ptr<llvm::Module> pM, CComPtr<IDxcBlob> &pOutputBlob,
     IMalloc *pMalloc, SerializeDxilFlags SerializeFlags,
     CComPtr<AbstractMemoryStream> &pOutputStream, bool bDebugInfo,
-    clang::DiagnosticsEngine &Diag) {
+    clang::DiagnosticsEngine &Diag, CachedValidator *pCachedValidator,
+    CComPtr<IDxcBlob> *ppSidecarBlob) {
   HRESULT valHR = S_OK;
 
   // Take ownership of the module from the action.
   DxilCompilerLLVMModuleOutput llvmModule(std::move(pM));
 
   CComPtr<IDxcValidator> pValidator;
-  bool bInternalValidator = CreateValidator(pValidator);
+  bool bInternalValidator;
+  if (pCachedValidator)
+    pValidator = pCachedValidator->Get(&bInternalValidator);
+  else
+    bInternalValidator = CreateValidator(pValidator);
   // Warning on internal Validator
 
   if (bInternalValidator) {
@@ -155,10 +195,14 @@ HRESULT ValidateAndAssembleToContainer(
     }
   }
 
-  llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob,
-                                       SerializeFlags);
+  {
+    hlsl::TimeReportPhase containerPhase("container");
+    llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob,
+                                         SerializeFlags, ppSidecarBlob);
+  }
 
   CComPtr<IDxcOperationResult> pValResult;
+  hlsl::TimeReportPhase validatorPhase("validator");
   // Important: in-place edit is required so the blob is reused and thus
   // dxil.dll can be released.
   if (bInternalValidator) {
@@ -191,6 +235,54 @@ HRESULT ValidateAndAssembleToContainer(
   return valHR;
 }
 
+void MoveSourcesToPack(llvm::Module &M, IMalloc *pMalloc,
+                       CComPtr<IDxcBlob> &pSourcePackBlob) {
+  std::unique_ptr<DxilContainerWriter> pWriter(NewDxilContainerWriter());
+  if (NamedMDNode *pContents = M.getNamedMetadata("llvm.dbg.contents")) {
+    LLVMContext &Ctx = M.getContext();
+    std::set<std::string> digests;
+    for (unsigned i = 0, e = pContents->getNumOperands(); i != e; ++i) {
+      MDNode *pFile = pContents->getOperand(i);
+      // The content strings are owned by the context, so they outlive the
+      // writer even once no node uses them.
+      StringRef content = cast<MDString>(pFile->getOperand(1))->getString();
+      MD5 md5;
+      MD5::MD5Result digest;
+      md5.update(content);
+      md5.final(digest);
+      SmallString<32> digestText;
+      MD5::stringifyResult(digest, digestText);
+      pContents->setOperand(
+          i, MDNode::get(Ctx, {pFile->getOperand(0), MDString::get(Ctx, ""),
+                               MDString::get(Ctx, digestText)}));
+      if (!digests.insert(digestText.str().str()).second)
+        continue;
+
+      DxilShaderSourceHeader header;
+      memcpy(header.Digest, digest, DxilContainerHashSize);
+      header.ContentSize = (uint32_t)content.size();
+      uint32_t paddingBytes = (4 - content.size() % 4) % 4;
+      pWriter->AddPart(
+          DFCC_ShaderSource,
+          sizeof(header) + header.ContentSize + paddingBytes,
+          [header, content, paddingBytes](AbstractMemoryStream *pStream) {
+            ULONG cbWritten;
+            IFT(WriteStreamValue(pStream, header));
+            IFT(pStream->Write(content.data(), content.size(), &cbWritten));
+            uint32_t paddingValue = 0;
+            if (paddingBytes)
+              IFT(pStream->Write(&paddingValue, paddingBytes, &cbWritten));
+          });
+    }
+  }
+
+  CComPtr<AbstractMemoryStream> pStream;
+  IFT(CreateMemoryStream(pMalloc, &pStream));
+  pWriter->write(pStream);
+  pSourcePackBlob.Release();
+  IFT(pStream.QueryInterface(&pSourcePackBlob));
+}
+
 void CreateOperationResultFromOutputs(
     IDxcBlob *pResultBlob, CComPtr<IStream> &pErrorStream,
     const std::string &warnings, bool hasErrorOccurred,
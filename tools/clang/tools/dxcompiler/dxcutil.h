@@ -13,7 +13,9 @@
 
 #include "dxc/dxcapi.h"
 #include "dxc/Support/microcom.h"
+#include "llvm/ADT/StringRef.h"
 #include <memory>
+#include <mutex>
 
 namespace clang {
 class DiagnosticsEngine;
@@ -23,8 +25,7 @@ namespace llvm {
 class LLVMContext;
 class MemoryBuffer;
 class Module;
-class raw_string_ostream;
-class StringRef;
+class raw_ostream;
 class Twine;
 } // namespace llvm
 
@@ -35,18 +36,46 @@ class AbstractMemoryStream;
 
 
 namespace dxcutil {
+// A validator that is created on first use and then kept, so that a compiler
+// session doesn't create one for every compilation. It may be shared by
+// compilations running on different threads.
+class CachedValidator {
+  std::mutex m_lock;
+  CComPtr<IDxcValidator> m_pValidator;
+  bool m_bInternal = false;
+  unsigned m_major = 0;
+  unsigned m_minor = 0;
+
+public:
+  IDxcValidator *Get(bool *pInternal);
+  void GetVersion(unsigned *pMajor, unsigned *pMinor);
+};
+
 HRESULT ValidateAndAssembleToContainer(
     std::unique_ptr<llvm::Module> pM, CComPtr<IDxcBlob> &pOutputContainerBlob,
     IMalloc *pMalloc, hlsl::SerializeDxilFlags SerializeFlags,
     CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode, bool bDebugInfo,
-    clang::DiagnosticsEngine &Diag);
+    clang::DiagnosticsEngine &Diag,
+    CachedValidator *pCachedValidator = nullptr,
+    CComPtr<IDxcBlob> *ppSidecarBlob = nullptr);
 void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor);
+// With ppSidecarBlob, the debug parts are written to a sidecar container
+// rather than the output container; see SerializeDxilContainerForModule.
 void AssembleToContainer(std::unique_ptr<llvm::Module> pM,
                          CComPtr<IDxcBlob> &pOutputContainerBlob,
                          IMalloc *pMalloc,
                          hlsl::SerializeDxilFlags SerializeFlags,
-                         CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode);
-HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
+                         CComPtr<hlsl::AbstractMemoryStream> &pModuleBitcode,
+                         CComPtr<IDxcBlob> *ppSidecarBlob = nullptr);
+// Replaces the file contents in llvm.dbg.contents of a module compiled with
+// debug info with their MD5 digests, and returns the contents in a source
+// pack; see DxilShaderSourceHeader.
+void MoveSourcesToPack(llvm::Module &M, IMalloc *pMalloc,
+                       CComPtr<IDxcBlob> &pSourcePackBlob);
+// Writes the disassembly of pProgram to Stream. With FunctionName, only that
+// function's IR is printed after the module summary.
+HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_ostream &Stream,
+                    llvm::StringRef FunctionName = llvm::StringRef());
 
 void CreateOperationResultFromOutputs(
     IDxcBlob *pResultBlob, CComPtr<IStream> &pErrorStream,
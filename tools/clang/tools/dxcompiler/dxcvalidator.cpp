@@ -12,19 +12,23 @@
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/Support/MD5.h"
 
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/DxilContainer.h"
 #include "dxc/HLSL/DxilValidation.h"
 
 #include "dxc/Support/Global.h"
+#include "dxc/Support/AllocationStats.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MSFileSystem.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/HLSL/DxilRootSignature.h"
+#include "dxc/HLSL/DxcTimeReport.h"
 #include "dxcetw.h"
+#include <mutex>
 
 using namespace llvm;
 using namespace hlsl;
@@ -46,6 +50,91 @@ struct DiagRestore {
   }
 };
 
+// Digests of the containers accepted by this validator, for
+// DxcValidatorFlags_SkipIfValidated. The set has a fixed capacity and doesn't
+// allocate, as it outlives the allocators of the validators that fill it.
+class ValidatedContainerSet {
+  static const unsigned kCapacity = 256;
+  std::mutex m_lock;
+  MD5::MD5Result m_digests[kCapacity];
+  unsigned m_count = 0;
+  unsigned m_next = 0;
+
+public:
+  bool Contains(const MD5::MD5Result &digest) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (unsigned i = 0; i < m_count; ++i) {
+      if (memcmp(m_digests[i], digest, sizeof(digest)) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  void Insert(const MD5::MD5Result &digest) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (unsigned i = 0; i < m_count; ++i) {
+      if (memcmp(m_digests[i], digest, sizeof(digest)) == 0)
+        return;
+    }
+    // Replace the oldest entry once the set is full.
+    memcpy(m_digests[m_next], digest, sizeof(digest));
+    m_next = (m_next + 1) % kCapacity;
+    if (m_count < kCapacity)
+      ++m_count;
+  }
+};
+
+static ValidatedContainerSet g_ValidatedContainers;
+
+// Computes the digests that identify what full validation of the container
+// checked. The module digest covers the DXIL part and the parts verified
+// against it; the container digest adds the root signature. Only the kinds of
+// the parts that validation skips are hashed, so that changes to them don't
+// require validating again.
+static void HashValidatedContainer(const DxilContainerHeader *pContainer,
+                                   MD5::MD5Result &moduleDigest,
+                                   MD5::MD5Result &containerDigest) {
+  unsigned major, minor;
+  GetValidationVersion(&major, &minor);
+  MD5 md5;
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)&major, sizeof(major)));
+  md5.update(ArrayRef<uint8_t>((const uint8_t *)&minor, sizeof(minor)));
+  const DxilPartHeader *pRootSignaturePart = nullptr;
+  for (auto it = begin(pContainer), itEnd = end(pContainer); it != itEnd; ++it) {
+    const DxilPartHeader *pPart = *it;
+    // The root signature may move when it is replaced, but a repeated one
+    // must still fail validation.
+    if (pPart->PartFourCC == DFCC_RootSignature && !pRootSignaturePart) {
+      pRootSignaturePart = pPart;
+      continue;
+    }
+    md5.update(ArrayRef<uint8_t>((const uint8_t *)&pPart->PartFourCC,
+                                 sizeof(pPart->PartFourCC)));
+    switch (pPart->PartFourCC) {
+    case DFCC_ResourceDef:
+    case DFCC_ShaderStatistics:
+    case DFCC_PrivateData:
+    case DFCC_ShaderDebugName:
+    case DFCC_RootSignature:
+      break;
+    default:
+      md5.update(ArrayRef<uint8_t>((const uint8_t *)pPart,
+                                   sizeof(*pPart) + pPart->PartSize));
+      break;
+    }
+  }
+  md5.final(moduleDigest);
+
+  MD5 containerMd5;
+  containerMd5.update(ArrayRef<uint8_t>(moduleDigest, sizeof(moduleDigest)));
+  if (pRootSignaturePart) {
+    containerMd5.update(ArrayRef<uint8_t>(
+        (const uint8_t *)GetDxilPartData(pRootSignaturePart),
+        pRootSignaturePart->PartSize));
+  }
+  containerMd5.final(containerDigest);
+}
+
 class DxcValidator : public IDxcValidator, public IDxcVersionInfo {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
@@ -99,7 +188,7 @@ HRESULT STDMETHODCALLTYPE DxcValidator::Validate(
   DxcThreadMalloc TM(m_pMalloc);
   if (pShader == nullptr || ppResult == nullptr || Flags & ~DxcValidatorFlags_ValidMask)
     return E_INVALIDARG;
-  if ((Flags & DxcValidatorFlags_ModuleOnly) && (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly)))
+  if ((Flags & DxcValidatorFlags_ModuleOnly) && (Flags & (DxcValidatorFlags_InPlaceEdit | DxcValidatorFlags_RootSignatureOnly | DxcValidatorFlags_SkipIfValidated)))
     return E_INVALIDARG;
   return ValidateWithOptModules(pShader, Flags, nullptr, nullptr, ppResult);
 }
@@ -117,16 +206,49 @@ HRESULT DxcValidator::ValidateWithOptModules(
   DxcEtw_DxcValidation_Start();
   DxcThreadMalloc TM(m_pMalloc);
   try {
+    CComPtr<AllocationStatsMalloc> pStatsMalloc;
+    if (Flags & DxcValidatorFlags_AllocationStats)
+      IFT(AllocationStatsMalloc::Create(m_pMalloc, &pStatsMalloc));
+    DxcThreadMalloc TMStats(pStatsMalloc ? pStatsMalloc.p : m_pMalloc.p);
+
     CComPtr<AbstractMemoryStream> pDiagStream;
     IFT(CreateMemoryStream(m_pMalloc, &pDiagStream));
 
+    // Containers that get fully validated are recorded, so that they can be
+    // recognized when validated again with DxcValidatorFlags_SkipIfValidated.
+    const DxilContainerHeader *pContainer = nullptr;
+    MD5::MD5Result moduleDigest, containerDigest;
+    if (!(Flags & (DxcValidatorFlags_ModuleOnly | DxcValidatorFlags_RootSignatureOnly))) {
+      pContainer = IsDxilContainerLike(pShader->GetBufferPointer(), pShader->GetBufferSize());
+      if (pContainer && IsValidDxilContainer(pContainer, pShader->GetBufferSize())) {
+        TimeReportPhase hashPhase("hash");
+        HashValidatedContainer(pContainer, moduleDigest, containerDigest);
+      }
+      else
+        pContainer = nullptr;
+    }
+
     // Run validation may throw, but that indicates an inability to validate,
     // not that the validation failed (eg out of memory).
-    if (Flags & DxcValidatorFlags_RootSignatureOnly) {
+    bool skipIfValidated = pContainer && (Flags & DxcValidatorFlags_SkipIfValidated);
+    if (skipIfValidated && g_ValidatedContainers.Contains(containerDigest)) {
+      validationStatus = S_OK;
+    } else if (skipIfValidated && g_ValidatedContainers.Contains(moduleDigest)) {
+      // Only the root signature may have changed since the module was
+      // validated.
+      validationStatus = S_OK;
+      if (GetDxilPartByType(pContainer, DFCC_RootSignature))
+        validationStatus = RunRootSignatureValidation(pShader, pDiagStream);
+    } else if (Flags & DxcValidatorFlags_RootSignatureOnly) {
       validationStatus = RunRootSignatureValidation(pShader, pDiagStream);
     } else {
       validationStatus = RunValidation(pShader, Flags, pModule, pDebugModule, pDiagStream);
     }
+    if (pContainer && SUCCEEDED(validationStatus) &&
+        !(Flags & DxcValidatorFlags_Quick)) {
+      g_ValidatedContainers.Insert(moduleDigest);
+      g_ValidatedContainers.Insert(containerDigest);
+    }
     if (FAILED(validationStatus)) {
       std::string msg("Validation failed.\n");
       ULONG cbWritten;
@@ -139,6 +261,11 @@ HRESULT DxcValidator::ValidateWithOptModules(
     DXASSERT_NOMSG(SUCCEEDED(hr));
     IFT(DxcCreateBlobWithEncodingSet(pDiagBlob, CP_UTF8, &pDiagBlobEnconding));
     IFT(DxcOperationResult::CreateFromResultErrorStatus(nullptr, pDiagBlobEnconding, validationStatus, ppResult));
+    if (pStatsMalloc) {
+      DxcAllocationStats allocationStats;
+      pStatsMalloc->GetStats(&allocationStats);
+      static_cast<DxcOperationResult *>(*ppResult)->SetAllocationStats(allocationStats);
+    }
   }
   CATCH_CPP_ASSIGN_HRESULT();
 
@@ -176,6 +303,7 @@ HRESULT DxcValidator::RunValidation(
   // by a failing HRESULT, and possibly error messages in the diagnostics stream.
 
   raw_stream_ostream DiagStream(pDiagStream);
+  bool bQuick = (Flags & DxcValidatorFlags_Quick) != 0;
 
   if (Flags & DxcValidatorFlags_ModuleOnly) {
     IFRBOOL(!IsDxilContainerLike(pShader->GetBufferPointer(), pShader->GetBufferSize()), E_INVALIDARG);
@@ -186,9 +314,9 @@ HRESULT DxcValidator::RunValidation(
   if (!pModule) {
     DXASSERT_NOMSG(pDebugModule == nullptr);
     if (Flags & DxcValidatorFlags_ModuleOnly) {
-      return ValidateDxilBitcode((const char*)pShader->GetBufferPointer(), (uint32_t)pShader->GetBufferSize(), DiagStream);
+      return ValidateDxilBitcode((const char*)pShader->GetBufferPointer(), (uint32_t)pShader->GetBufferSize(), DiagStream, bQuick);
     } else {
-      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream);
+      return ValidateDxilContainer(pShader->GetBufferPointer(), pShader->GetBufferSize(), DiagStream, bQuick);
     }
   }
 
@@ -196,8 +324,12 @@ HRESULT DxcValidator::RunValidation(
   PrintDiagnosticContext DiagContext(DiagPrinter);
   DiagRestore DR(pModule->getContext(), &DiagContext);
 
-  IFR(hlsl::ValidateDxilModule(pModule, pDebugModule));
+  {
+    TimeReportPhase modulePhase("validate-module");
+    IFR(hlsl::ValidateDxilModule(pModule, pDebugModule, bQuick));
+  }
   if (!(Flags & DxcValidatorFlags_ModuleOnly)) {
+    TimeReportPhase partsPhase("validate-parts");
     IFR(ValidateDxilContainerParts(pModule, pDebugModule,
                       IsDxilContainerLike(pShader->GetBufferPointer(), pShader->GetBufferSize()),
                       (uint32_t)pShader->GetBufferSize()));
@@ -225,15 +357,13 @@ HRESULT DxcValidator::RunRootSignatureValidation(
   const DxilPartHeader *pRSPart = GetDxilPartByType(pDxilContainer, DFCC_RootSignature);
   IFRBOOL(pPSVPart && pRSPart, DXC_E_MISSING_PART);
   try {
-    RootSignatureHandle RSH;
-    RSH.LoadSerialized((const uint8_t*)GetDxilPartData(pRSPart), pRSPart->PartSize);
-    RSH.Deserialize();
     raw_stream_ostream DiagStream(pDiagStream);
-    IFRBOOL(VerifyRootSignatureWithShaderPSV(RSH.GetDesc(),
-                                             GetVersionShaderType(pProgramHeader->ProgramVersion),
-                                             GetDxilPartData(pPSVPart),
-                                             pPSVPart->PartSize,
-                                             DiagStream),
+    IFRBOOL(VerifySerializedRootSignatureWithShaderPSV(GetDxilPartData(pRSPart),
+                                                       pRSPart->PartSize,
+                                                       GetVersionShaderType(pProgramHeader->ProgramVersion),
+                                                       GetDxilPartData(pPSVPart),
+                                                       pPSVPart->PartSize,
+                                                       DiagStream),
       DXC_E_INCORRECT_ROOT_SIGNATURE);
   } catch(...) {
     return DXC_E_IR_VERIFICATION_FAILED;
@@ -12,22 +12,44 @@
 #include "dxillib.h"
 #include "dxc/Support/Global.h" // For DXASSERT
 #include "dxc/Support/dxcapi.use.h"
+#include <atomic>
+#include <mutex>
 
 using namespace dxc;
 
 static DxcDllSupport g_DllSupport;
 static HRESULT g_DllLibResult = S_OK;
-static CRITICAL_SECTION cs;
+// dxil.dll is loaded at most once. After the first call, checking whether it
+// is available is a single atomic load, so threads compiling in parallel
+// don't serialize on it.
+static std::once_flag g_DllLibLoadOnce;
+static std::atomic<bool> g_DllLibLoaded(false);
+// Incremented when dxil.dll is released, so that validators cached by
+// threads before then are not released into an unloaded library.
+static std::atomic<unsigned> g_DllLibGeneration(1);
+
+namespace {
+struct ThreadValidatorCache {
+  CComPtr<IDxcValidator> Validator;
+  unsigned Generation = 0;
+
+  ~ThreadValidatorCache() {
+    if (Generation != g_DllLibGeneration.load(std::memory_order_acquire))
+      Validator.Detach();
+  }
+};
+}
+
+static thread_local ThreadValidatorCache t_ValidatorCache;
 
-// Check if we can successfully get IDxcValidator from dxil.dll
-// This function is to prevent multiple attempts to load dxil.dll 
 HRESULT DxilLibInitialize() {
-  InitializeCriticalSection(&cs);
   return S_OK;
 }
 
 HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
   HRESULT hr = S_OK;
+  g_DllLibLoaded.store(false, std::memory_order_release);
+  g_DllLibGeneration.fetch_add(1, std::memory_order_acq_rel);
   if (type == DxilLibCleanUpType::ProcessTermination) {
     g_DllSupport.Detach();
   }
@@ -37,32 +59,45 @@ HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
   else {
     hr = E_INVALIDARG;
   }
-  DeleteCriticalSection(&cs);
   return hr;
 }
 
-// g_DllLibResult is S_OK by default, check again to see if dxil.dll is loaded
-// If we fail to load dxil.dll, set g_DllLibResult to E_FAIL so that we don't
-// have multiple attempts to load dxil.dll
+// If we fail to load dxil.dll, g_DllLibResult keeps the failure so that we
+// don't have multiple attempts to load dxil.dll.
 bool DxilLibIsEnabled() {
-  EnterCriticalSection(&cs);
-  if (SUCCEEDED(g_DllLibResult)) {
-    if (!g_DllSupport.IsEnabled()) {
-      g_DllLibResult = g_DllSupport.InitializeForDll(L"dxil.dll", "DxcCreateInstance");
-    }
-  }
-  LeaveCriticalSection(&cs);
-  return SUCCEEDED(g_DllLibResult);
+  if (g_DllLibLoaded.load(std::memory_order_acquire))
+    return true;
+  std::call_once(g_DllLibLoadOnce, []() {
+    g_DllLibResult = g_DllSupport.InitializeForDll(L"dxil.dll", "DxcCreateInstance");
+    g_DllLibLoaded.store(SUCCEEDED(g_DllLibResult), std::memory_order_release);
+  });
+  return g_DllLibLoaded.load(std::memory_order_acquire);
 }
 
 
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ REFIID riid, _In_ IUnknown **ppInterface) {
   DXASSERT_NOMSG(ppInterface != nullptr);
   HRESULT hr = E_FAIL;
+  // DxcCreateInstance in dxil.dll is thread-safe, so once the library is
+  // loaded no lock is needed.
   if (DxilLibIsEnabled()) {
-    EnterCriticalSection(&cs);
     hr = g_DllSupport.CreateInstance(rclsid, riid, ppInterface);
-    LeaveCriticalSection(&cs);
   }
   return hr;
-}
\ No newline at end of file
+}
+
+HRESULT DxilLibGetThreadValidator(_COM_Outptr_ IDxcValidator **ppValidator) {
+  DXASSERT_NOMSG(ppValidator != nullptr);
+  *ppValidator = nullptr;
+  if (!DxilLibIsEnabled())
+    return E_FAIL;
+
+  ThreadValidatorCache &cache = t_ValidatorCache;
+  unsigned generation = g_DllLibGeneration.load(std::memory_order_acquire);
+  if (cache.Validator == nullptr || cache.Generation != generation) {
+    cache.Validator.Detach();
+    IFR(DxilLibCreateInstance(CLSID_DxcValidator, &cache.Validator));
+    cache.Generation = generation;
+  }
+  return cache.Validator.CopyTo(ppValidator);
+}
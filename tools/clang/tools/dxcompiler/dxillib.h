@@ -14,6 +14,7 @@
 #define __DXC_DXILLIB__
 
 #include "dxc/Support/WinIncludes.h"
+#include "dxc/dxcapi.h"
 
 
 // Initialize Dxil library. 
@@ -34,6 +35,11 @@ bool DxilLibIsEnabled();
 
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ REFIID riid, _In_ IUnknown **ppInterface);
 
+// Returns the calling thread's validator from dxil.dll, creating it on first
+// use. The validator keeps no state between calls, so compiles on the thread
+// share it instead of each creating their own.
+HRESULT DxilLibGetThreadValidator(_COM_Outptr_ IDxcValidator **ppValidator);
+
 template <class TInterface>
 HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ TInterface **ppInterface) {
   return DxilLibCreateInstance(rclsid, __uuidof(TInterface), (IUnknown**) ppInterface);
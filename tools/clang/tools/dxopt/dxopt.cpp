@@ -24,6 +24,7 @@
 #include "dxc/Support/FileIOHelper.h"
 #include "dxc/Support/microcom.h"
 #include <comdef.h>
+#include <algorithm>
 #include <iostream>
 #include <limits>
 
@@ -45,6 +46,7 @@ enum class ProgramAction {
   PrintPasses,
   PrintPassesWithDetails,
   RunOptimizer,
+  BenchmarkPass,
 };
 
 const wchar_t *STDIN_FILE_NAME = L"-";
@@ -191,16 +193,54 @@ static void ReadFileOpts(LPCWSTR pPassFileName, IDxcBlobEncoding **ppPassOpts, s
   *ppPassOpts = pPassOpts.Detach();
 }
 
+// Runs the pipeline on repeatCount copies of the module and prints the time
+// spent in the pass named benchPassName. Without optimizer arguments, the
+// pipeline is the pass alone.
+static void BenchmarkPass(IDxcOptimizer *pOptimizer, IDxcBlob *pBlob,
+                          LPCWSTR benchPassName, UINT32 repeatCount,
+                          const wchar_t **optArgs, UINT32 optArgCount) {
+  CComPtr<IDxcOptimizer2> pOptimizer2;
+  CComPtr<IDxcModuleHandle> pModule;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  CComPtr<IDxcPassBenchmark> pBenchmark;
+  IFT(pOptimizer->QueryInterface(&pOptimizer2));
+  IFT(pOptimizer2->LoadModule(pBlob, &pModule));
+
+  std::wstring passOption = std::wstring(L"-") + benchPassName;
+  const wchar_t *passOptionArgs[] = { passOption.c_str() };
+  if (optArgCount == 0) {
+    optArgs = passOptionArgs;
+    optArgCount = 1;
+  }
+  IFT(pOptimizer2->CreatePipeline(optArgs, optArgCount, &pPipeline));
+  IFT(pPipeline.QueryInterface(&pBenchmark));
+
+  std::vector<double> seconds(repeatCount);
+  IFT(pBenchmark->BenchmarkPass(pModule, benchPassName, repeatCount,
+                                seconds.data()));
+  std::sort(seconds.begin(), seconds.end());
+  double median = seconds[repeatCount / 2];
+  if (repeatCount % 2 == 0)
+    median = (median + seconds[repeatCount / 2 - 1]) / 2;
+  wprintf(L"%s: %u runs, min %.3f ms, median %.3f ms, max %.3f ms\n",
+          benchPassName, repeatCount, seconds.front() * 1000, median * 1000,
+          seconds.back() * 1000);
+}
+
 static void PrintHelp() {
   wprintf(L"%s",
     L"Performs optimizations on a bitcode file by running a sequence of passes.\n\n"
-    L"dxopt [-? | -passes | -pass-details | -pf [PASS-FILE] | [-o=OUT-FILE] | IN-FILE OPT-ARGUMENTS ...]\n\n"
+    L"dxopt [-? | -passes | -pass-details | -pf [PASS-FILE] | [-o=OUT-FILE] | [-bench-pass PASS [-repeat N]] | IN-FILE OPT-ARGUMENTS ...]\n\n"
     L"Arguments:\n"
     L"  -?  Displays this help message\n"
     L"  -passes        Displays a list of pass names\n"
     L"  -pass-details  Displays a list of passes with detailed information\n"
     L"  -pf PASS-FILE  Loads passes from the specified file\n"
     L"  -o=OUT-FILE    Output file for processed module\n"
+    L"  -bench-pass PASS  Times PASS on a fresh copy of the module in each run, and\n"
+    L"                 prints the minimum and median times; OPT-ARGUMENTS, which\n"
+    L"                 default to -PASS, run on each copy but aren't timed\n"
+    L"  -repeat N      Number of runs for -bench-pass (10 if omitted)\n"
     L"  IN-FILE        File with with bitcode to optimize\n"
     L"  OPT-ARGUMENTS  One or more passes to run in sequence\n"
     L"\n"
@@ -221,6 +261,8 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
     LPCWSTR externalLib = nullptr;
     LPCWSTR externalFn = nullptr;
     LPCWSTR passFileName = nullptr;
+    LPCWSTR benchPassName = nullptr;
+    UINT32 repeatCount = 10;
     const wchar_t **optArgs = nullptr;
     UINT32 optArgCount = 0;
 
@@ -263,8 +305,27 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
       else if (wcsistarts(arg, L"-o=")) {
         outFileName = argv_[argIdx] + 3;
       }
+      else if (wcsieqopt(arg, L"bench-pass")) {
+        ++argIdx;
+        if (argIdx == argc) {
+          PrintHelp();
+          return 1;
+        }
+        benchPassName = argv_[argIdx];
+        if (*benchPassName == L'-')
+          ++benchPassName;
+      }
+      else if (wcsieqopt(arg, L"repeat")) {
+        ++argIdx;
+        if (argIdx == argc || _wtoi(argv_[argIdx]) <= 0) {
+          PrintHelp();
+          return 1;
+        }
+        repeatCount = (UINT32)_wtoi(argv_[argIdx]);
+      }
       else {
-        action = ProgramAction::RunOptimizer;
+        action = benchPassName ? ProgramAction::BenchmarkPass
+                               : ProgramAction::RunOptimizer;
         // See if arg is file input specifier.
         if (isFileInputArg(arg)) {
           inFileName = arg;
@@ -324,6 +385,13 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
       IFT(pOptimizer->RunOptimizer(pBlob, optArgs, optArgCount, &pOutputModule, &pOutputText));
       PrintOptOutput(outFileName, pOutputModule, pOutputText);
       break;
+    case ProgramAction::BenchmarkPass:
+      pStage = "Pass benchmark";
+      BlobFromFile(inFileName, &pBlob);
+      ReadFileOpts(passFileName, &pPassOpts, passes, &optArgs, &optArgCount);
+      BenchmarkPass(pOptimizer, pBlob, benchPassName, repeatCount, optArgs,
+                    optArgCount);
+      break;
     }
   } catch (const ::hlsl::Exception &hlslException) {
     try {
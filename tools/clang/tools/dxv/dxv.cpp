@@ -28,6 +28,10 @@ using namespace hlsl::options;
 static cl::opt<std::string>
 InputFilename(cl::Positional, cl::desc("<input dxil file>"), cl::init("-"));
 
+static cl::opt<bool>
+Quick("quick", cl::desc("Skip the whole-program checks; the result is not valid for release"),
+      cl::init(false));
+
 class DxvContext {
 private:
   DxcDllSupport &m_dxcSupport;
@@ -68,7 +72,10 @@ void DxvContext::Validate() {
     CComPtr<IDxcOperationResult> pResult;
 
     IFT(m_dxcSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
-    IFT(pValidator->Validate(pContainerBlob, DxcValidatorFlags_InPlaceEdit, &pResult));
+    UINT32 flags = DxcValidatorFlags_InPlaceEdit;
+    if (Quick)
+      flags |= DxcValidatorFlags_Quick;
+    IFT(pValidator->Validate(pContainerBlob, flags, &pResult));
 
     HRESULT status;
     IFT(pResult->GetStatus(&status));
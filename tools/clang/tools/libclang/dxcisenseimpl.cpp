@@ -25,12 +25,21 @@
 #include "clang/Frontend/ASTUnit.h"
 #include "llvm/Support/Host.h"
 #include "clang/Sema/SemaHLSL.h"
+#include "clang/Tooling/JSONCompilationDatabase.h"
 
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/Global.h"
 #include "dxcisenseimpl.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -207,17 +216,12 @@ HRESULT CXStringToBSTRAndDispose(CXString value, _Outptr_result_maybenull_ BSTR*
 }
 
 static
-void CleanupUnsavedFiles(
-  _In_count_(file_count) CXUnsavedFile * files,
-  unsigned file_count) throw()
+std::string CXStringToStdStringAndDispose(CXString value)
 {
-  for (unsigned i = 0; i < file_count; ++i)
-  {
-    CoTaskMemFree((LPVOID)files[i].Filename);
-    CoTaskMemFree((LPVOID)files[i].Contents);
-  }
-
-  delete[] files;
+  const char* text = clang_getCString(value);
+  std::string result(text ? text : "");
+  clang_disposeString(value);
+  return result;
 }
 
 static
@@ -335,48 +339,54 @@ void SafeReleaseIfaceArray(_Inout_count_(count) TIface** arr, unsigned count) th
   }
 }
 
+// Reads the given unsaved files into files, replacing the contents of files
+// with the same name.
 static
-HRESULT SetupUnsavedFiles(
+HRESULT MergeUnsavedFiles(
   _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
   unsigned num_unsaved_files,
-  _Outptr_result_buffer_maybenull_(num_unsaved_files) CXUnsavedFile** files)
+  DxcUnsavedFileContents& files)
 {
-  *files = nullptr;
-  if (num_unsaved_files == 0)
-  {
-    return S_OK;
-  }
-
-  HRESULT hr = S_OK;
-  CXUnsavedFile* localFiles = new (std::nothrow) CXUnsavedFile[num_unsaved_files];
-  IFROOM(localFiles);
-  ZeroMemory(localFiles, num_unsaved_files * sizeof(localFiles[0]));
   for (unsigned i = 0; i < num_unsaved_files; ++i)
   {
     if (unsaved_files[i] == nullptr)
     {
-      hr = E_INVALIDARG;
-      break;
+      return E_INVALIDARG;
     }
 
-    hr = unsaved_files[i]->GetFileName((LPSTR*)&localFiles[i].Filename);
-    if (FAILED(hr)) break;
-    hr = unsaved_files[i]->GetContents((LPSTR*)&localFiles[i].Contents);
-    if (FAILED(hr)) break;
-    hr = unsaved_files[i]->GetLength((unsigned*)&localFiles[i].Length);
-    if (FAILED(hr)) break;
+    CComHeapPtr<char> fileName;
+    CComHeapPtr<char> contents;
+    unsigned length;
+    IFR(unsaved_files[i]->GetFileName(&fileName));
+    IFR(unsaved_files[i]->GetContents(&contents));
+    IFR(unsaved_files[i]->GetLength(&length));
+
+    auto found = std::find_if(files.begin(), files.end(),
+      [&](const std::pair<std::string, std::string>& file) {
+        return file.first == fileName.m_pData;
+      });
+    if (found == files.end())
+    {
+      found = files.emplace(files.end(), fileName.m_pData, std::string());
+    }
+    found->second.assign(contents.m_pData, length);
   }
 
-  if (SUCCEEDED(hr))
-  {
-    *files = localFiles;
-  }
-  else
+  return S_OK;
+}
+
+// The returned files point into the strings of contents.
+static
+std::vector<CXUnsavedFile> GetCXUnsavedFiles(const DxcUnsavedFileContents& contents)
+{
+  std::vector<CXUnsavedFile> files(contents.size());
+  for (size_t i = 0; i < contents.size(); ++i)
   {
-    CleanupUnsavedFiles(localFiles, num_unsaved_files);
+    files[i].Filename = contents[i].first.c_str();
+    files[i].Contents = contents[i].second.data();
+    files[i].Length = (unsigned long)contents[i].second.size();
   }
-
-  return hr;
+  return files;
 }
 
 struct PagedCursorVisitorContext
@@ -417,6 +427,33 @@ CXChildVisitResult LIBCLANG_CC PagedCursorTraverseVisit(CXCursor cursor, CXCurso
   return (pagedContext->top == 0) ? CXChildVisit_Break : CXChildVisit_Continue;
 }
 
+static
+CXChildVisitResult LIBCLANG_CC UsrIndexVisit(CXCursor cursor, CXCursor parent, CXClientData client_data)
+{
+  DxcUsrIndex* index = (DxcUsrIndex*)client_data;
+  CXCursorKind kind = clang_getCursorKind(cursor);
+  if (clang_isDeclaration(kind) || clang_isReference(kind) ||
+      kind == CXCursor_DeclRefExpr || kind == CXCursor_MemberRefExpr)
+  {
+    CXCursor referenced = clang_getCursorReferenced(cursor);
+    if (!clang_Cursor_isNull(referenced))
+    {
+      CXString usr = clang_getCursorUSR(referenced);
+      const char* usrText = clang_getCString(usr);
+      if (usrText != nullptr && *usrText != '\0')
+      {
+        index->References[usrText].push_back(cursor);
+        if (clang_isCursorDefinition(cursor))
+        {
+          index->Definitions.emplace(usrText, cursor);
+        }
+      }
+      clang_disposeString(usr);
+    }
+  }
+  return CXChildVisit_Recurse;
+}
+
 static
 HRESULT PagedCursorVisitorCopyResults(
   _In_ PagedCursorVisitorContext* context,
@@ -602,6 +639,147 @@ HRESULT DxcBasicUnsavedFile::GetLength(unsigned* pLength)
 
 ///////////////////////////////////////////////////////////////////////////////
 
+DxcCodeCompleteResults::DxcCodeCompleteResults() : m_ccr(nullptr)
+{
+  m_pMalloc = DxcGetThreadMallocNoRef();
+}
+
+DxcCodeCompleteResults::~DxcCodeCompleteResults()
+{
+  if (m_ccr != nullptr)
+  {
+    clang_disposeCodeCompleteResults(m_ccr);
+    m_ccr = nullptr;
+  }
+}
+
+void DxcCodeCompleteResults::Initialize(CXCodeCompleteResults* ccr)
+{
+  m_ccr = ccr;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCodeCompleteResults::GetNumResults(unsigned* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = m_ccr->NumResults;
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCodeCompleteResults::GetResultAt(unsigned index, IDxcCompletionResult** pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = nullptr;
+  if (index >= m_ccr->NumResults) return E_INVALIDARG;
+  DxcThreadMalloc TM(m_pMalloc);
+  return DxcCompletionResult::Create(this, m_ccr->Results[index], pResult);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+DxcCompletionResult::DxcCompletionResult()
+{
+  m_pMalloc = DxcGetThreadMallocNoRef();
+}
+
+DxcCompletionResult::~DxcCompletionResult()
+{
+}
+
+void DxcCompletionResult::Initialize(IDxcCodeCompleteResults* results, const CXCompletionResult& result)
+{
+  m_results = results;
+  m_result = result;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCompletionResult::Create(IDxcCodeCompleteResults* results, const CXCompletionResult& result, IDxcCompletionResult** pObject)
+{
+  if (pObject == nullptr) return E_POINTER;
+  *pObject = nullptr;
+  DxcCompletionResult* newValue = new (std::nothrow) DxcCompletionResult();
+  if (newValue == nullptr) return E_OUTOFMEMORY;
+  newValue->Initialize(results, result);
+  newValue->AddRef();
+  *pObject = newValue;
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCompletionResult::GetCursorKind(DxcCursorKind* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = (DxcCursorKind)m_result.CursorKind;
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCompletionResult::GetCompletionString(IDxcCompletionString** pResult)
+{
+  DxcThreadMalloc TM(m_pMalloc);
+  return DxcCompletionString::Create(m_results, m_result.CompletionString, pResult);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+DxcCompletionString::DxcCompletionString() : m_completionString(nullptr)
+{
+  m_pMalloc = DxcGetThreadMallocNoRef();
+}
+
+DxcCompletionString::~DxcCompletionString()
+{
+}
+
+void DxcCompletionString::Initialize(IDxcCodeCompleteResults* results, const CXCompletionString& completionString)
+{
+  m_results = results;
+  m_completionString = completionString;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCompletionString::Create(IDxcCodeCompleteResults* results, const CXCompletionString& completionString, IDxcCompletionString** pObject)
+{
+  if (pObject == nullptr) return E_POINTER;
+  *pObject = nullptr;
+  DxcCompletionString* newValue = new (std::nothrow) DxcCompletionString();
+  if (newValue == nullptr) return E_OUTOFMEMORY;
+  newValue->Initialize(results, completionString);
+  newValue->AddRef();
+  *pObject = newValue;
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCompletionString::GetNumCompletionChunks(unsigned* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = clang_getNumCompletionChunks(m_completionString);
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCompletionString::GetCompletionChunkKind(unsigned chunkNumber, DxcCompletionChunkKind* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  if (chunkNumber >= clang_getNumCompletionChunks(m_completionString)) return E_INVALIDARG;
+  *pResult = (DxcCompletionChunkKind)clang_getCompletionChunkKind(m_completionString, chunkNumber);
+  return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DxcCompletionString::GetCompletionChunkText(unsigned chunkNumber, LPSTR* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = nullptr;
+  if (chunkNumber >= clang_getNumCompletionChunks(m_completionString)) return E_INVALIDARG;
+  DxcThreadMalloc TM(m_pMalloc);
+  return CXStringToAnsiAndDispose(clang_getCompletionChunkText(m_completionString, chunkNumber), pResult);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 DxcCursor::DxcCursor()
 {
   m_pMalloc = DxcGetThreadMallocNoRef();
@@ -1161,12 +1339,12 @@ HRESULT DxcIndex::ParseTranslationUnit(
 
   DxcThreadMalloc TM(m_pMalloc);
 
-  CXUnsavedFile* files;
-  HRESULT hr = SetupUnsavedFiles(unsaved_files, num_unsaved_files, &files);
-  if (FAILED(hr)) return hr;
-
   try
   {
+    DxcUnsavedFileContents contents;
+    IFR(MergeUnsavedFiles(unsaved_files, num_unsaved_files, contents));
+    std::vector<CXUnsavedFile> files = GetCXUnsavedFiles(contents);
+
     // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
     ::llvm::sys::fs::MSFileSystem* msfPtr;
     IFT(CreateMSFileSystemForDisk(&msfPtr));
@@ -1176,8 +1354,7 @@ HRESULT DxcIndex::ParseTranslationUnit(
     IFTLLVM(pts.error_code());
     CXTranslationUnit tu = clang_parseTranslationUnit(m_index, source_filename,
       command_line_args, num_command_line_args,
-      files, num_unsaved_files, options);
-    CleanupUnsavedFiles(files, num_unsaved_files);
+      files.data(), (unsigned)files.size(), options);
     if (tu == nullptr)
     {
       return E_FAIL;
@@ -1189,7 +1366,7 @@ HRESULT DxcIndex::ParseTranslationUnit(
       clang_disposeTranslationUnit(tu);
       return E_OUTOFMEMORY;
     }
-    localTU->Initialize(tu);
+    localTU->Initialize(tu, std::move(contents));
     *pTranslationUnit = localTU.Detach();
 
     return S_OK;
@@ -1199,6 +1376,672 @@ HRESULT DxcIndex::ParseTranslationUnit(
 
 ///////////////////////////////////////////////////////////////////////////////
 
+unsigned DxcStringTable::Intern(const std::string& value)
+{
+  auto inserted = Ids.emplace(value, (unsigned)Strings.size());
+  if (inserted.second)
+  {
+    Strings.push_back(value);
+  }
+  return inserted.first->second;
+}
+
+// References of a file are kept in this order, so that lookups are a
+// binary search per file.
+static
+bool IndexedReferenceLess(const DxcWorkspaceIndex::Reference& a, const DxcWorkspaceIndex::Reference& b)
+{
+  if (a.Usr != b.Usr) return a.Usr < b.Usr;
+  if (a.File != b.File) return a.File < b.File;
+  return a.Offset < b.Offset;
+}
+
+// A saved index is a header followed by the strings it uses, then each
+// file with its arguments, inputs and references. Numbers are stored as
+// little-endian 32-bit or 64-bit values.
+static const uint32_t WorkspaceIndexMagic = 0x49535844; // 'DXSI'
+static const uint32_t WorkspaceIndexVersion = 1;
+
+static
+void WriteIndexU32(std::string& data, uint32_t value)
+{
+  data.append((const char*)&value, sizeof(value));
+}
+
+static
+void WriteIndexU64(std::string& data, uint64_t value)
+{
+  data.append((const char*)&value, sizeof(value));
+}
+
+static
+void WriteIndexString(std::string& data, const std::string& value)
+{
+  WriteIndexU32(data, (uint32_t)value.size());
+  data.append(value);
+}
+
+namespace {
+struct IndexReader
+{
+  const char* Cur;
+  const char* End;
+
+  bool Read(void* value, size_t size)
+  {
+    if ((size_t)(End - Cur) < size) return false;
+    memcpy(value, Cur, size);
+    Cur += size;
+    return true;
+  }
+  bool ReadU32(uint32_t& value) { return Read(&value, sizeof(value)); }
+  bool ReadU64(uint64_t& value) { return Read(&value, sizeof(value)); }
+  bool ReadString(std::string& value)
+  {
+    uint32_t size;
+    if (!ReadU32(size) || (size_t)(End - Cur) < size) return false;
+    value.assign(Cur, size);
+    Cur += size;
+    return true;
+  }
+};
+}
+
+void DxcWorkspaceIndex::Save(std::string& data) const
+{
+  // Strings of references that were reparsed away aren't saved, so the
+  // saved strings are numbered again.
+  DxcStringTable saved;
+  std::vector<unsigned> ids(Strings.Strings.size(), UINT_MAX);
+  auto savedId = [&](unsigned id) {
+    if (ids[id] == UINT_MAX)
+      ids[id] = saved.Intern(Strings.Strings[id]);
+    return ids[id];
+  };
+  std::string entries;
+  for (const auto& it : Entries)
+  {
+    const Entry& entry = it.second;
+    WriteIndexString(entries, it.first);
+    WriteIndexU32(entries, (uint32_t)entry.Args.size());
+    for (const std::string& arg : entry.Args)
+      WriteIndexString(entries, arg);
+    // A file that wasn't parsed is saved without inputs, so that it is
+    // parsed after loading.
+    WriteIndexU32(entries, entry.Parsed ? 1 : 0);
+    WriteIndexU32(entries, (uint32_t)entry.Inputs.size());
+    for (const Input& input : entry.Inputs)
+    {
+      WriteIndexU32(entries, savedId(input.File));
+      WriteIndexU32(entries, input.Unsaved ? 1 : 0);
+      WriteIndexU64(entries, input.Stamp);
+      WriteIndexU64(entries, input.Size);
+    }
+    WriteIndexU32(entries, (uint32_t)entry.References.size());
+    for (const Reference& ref : entry.References)
+    {
+      WriteIndexU32(entries, savedId(ref.Usr));
+      WriteIndexU32(entries, savedId(ref.File));
+      WriteIndexU32(entries, ref.Line);
+      WriteIndexU32(entries, ref.Column);
+      WriteIndexU32(entries, ref.Offset);
+      WriteIndexU32(entries, ref.IsDefinition ? 1 : 0);
+    }
+  }
+
+  data.clear();
+  WriteIndexU32(data, WorkspaceIndexMagic);
+  WriteIndexU32(data, WorkspaceIndexVersion);
+  WriteIndexU32(data, (uint32_t)saved.Strings.size());
+  for (const std::string& value : saved.Strings)
+    WriteIndexString(data, value);
+  WriteIndexU32(data, (uint32_t)Entries.size());
+  data.append(entries);
+}
+
+HRESULT DxcWorkspaceIndex::Load(const char* data, size_t size)
+{
+  const HRESULT invalid = HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+  IndexReader reader = { data, data + size };
+  uint32_t magic, version, count;
+  if (!reader.ReadU32(magic) || magic != WorkspaceIndexMagic ||
+      !reader.ReadU32(version) || version != WorkspaceIndexVersion ||
+      !reader.ReadU32(count))
+    return invalid;
+
+  DxcWorkspaceIndex loaded;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    std::string value;
+    if (!reader.ReadString(value)) return invalid;
+    loaded.Strings.Intern(value);
+  }
+  size_t stringCount = loaded.Strings.Strings.size();
+  auto readId = [&](unsigned& id) {
+    uint32_t value;
+    if (!reader.ReadU32(value) || value >= stringCount) return false;
+    id = value;
+    return true;
+  };
+
+  if (!reader.ReadU32(count)) return invalid;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    std::string fileName;
+    uint32_t argCount, parsed, inputCount, refCount, flag;
+    if (!reader.ReadString(fileName) || !reader.ReadU32(argCount))
+      return invalid;
+    // Each argument takes at least its size.
+    if (argCount > size) return invalid;
+    Entry& entry = loaded.Entries[fileName];
+    entry.Args.resize(argCount);
+    for (std::string& arg : entry.Args)
+      if (!reader.ReadString(arg)) return invalid;
+    if (!reader.ReadU32(parsed) || !reader.ReadU32(inputCount))
+      return invalid;
+    entry.Parsed = parsed != 0;
+    for (uint32_t j = 0; j < inputCount; ++j)
+    {
+      Input input;
+      if (!readId(input.File) || !reader.ReadU32(flag) ||
+          !reader.ReadU64(input.Stamp) || !reader.ReadU64(input.Size))
+        return invalid;
+      input.Unsaved = flag != 0;
+      entry.Inputs.push_back(input);
+    }
+    if (!reader.ReadU32(refCount)) return invalid;
+    for (uint32_t j = 0; j < refCount; ++j)
+    {
+      Reference ref;
+      if (!readId(ref.Usr) || !readId(ref.File) || !reader.ReadU32(ref.Line) ||
+          !reader.ReadU32(ref.Column) || !reader.ReadU32(ref.Offset) ||
+          !reader.ReadU32(flag))
+        return invalid;
+      ref.IsDefinition = flag != 0;
+      entry.References.push_back(ref);
+    }
+    // Saved strings are numbered in a different order.
+    std::sort(entry.References.begin(), entry.References.end(),
+              IndexedReferenceLess);
+  }
+  if (reader.Cur != reader.End) return invalid;
+
+  *this = std::move(loaded);
+  return S_OK;
+}
+
+// Records how the named file is now, as an input of a parse.
+static
+void StampIndexedInput(const std::string& fileName,
+                       const DxcUnsavedFileContents& unsaved,
+                       DxcWorkspaceIndex::Input& input)
+{
+  auto found = std::find_if(unsaved.begin(), unsaved.end(),
+    [&](const std::pair<std::string, std::string>& file) {
+      return file.first == fileName;
+    });
+  if (found != unsaved.end())
+  {
+    input.Unsaved = true;
+    input.Stamp = (uint64_t)llvm::hash_value(found->second);
+    input.Size = found->second.size();
+    return;
+  }
+
+  // A file that can't be found stays the same until it is created.
+  ::llvm::sys::fs::file_status status;
+  input.Unsaved = false;
+  if (::llvm::sys::fs::status(fileName, status))
+  {
+    input.Stamp = 0;
+    input.Size = 0;
+    return;
+  }
+  input.Stamp = status.getLastModificationTime().toWin32Time();
+  input.Size = status.getSize();
+}
+
+struct IndexedInputData
+{
+  DxcWorkspaceIndex::Entry* entry;
+  DxcStringTable* strings;
+  const DxcUnsavedFileContents* unsaved;
+};
+
+static
+void VisitIndexedInput(CXFile included_file,
+  CXSourceLocation* inclusion_stack,
+  unsigned include_len,
+  CXClientData client_data) {
+  IndexedInputData* D = (IndexedInputData *)client_data;
+  std::string fileName = CXStringToStdStringAndDispose(clang_getFileName(included_file));
+  DxcWorkspaceIndex::Input input;
+  input.File = D->strings->Intern(fileName);
+  StampIndexedInput(fileName, *D->unsaved, input);
+  D->entry->Inputs.push_back(input);
+}
+
+// The caller sets up the file system for the calling thread.
+bool DxcIndex::IsIndexedFileStale(const DxcWorkspaceIndex::Entry& entry,
+                                  const DxcUnsavedFileContents& unsaved)
+{
+  if (!entry.Parsed || entry.Inputs.empty())
+  {
+    return true;
+  }
+  for (const DxcWorkspaceIndex::Input& input : entry.Inputs)
+  {
+    DxcWorkspaceIndex::Input current;
+    StampIndexedInput(m_workspace.Strings.Strings[input.File], unsaved, current);
+    if (current.Unsaved != input.Unsaved || current.Stamp != input.Stamp ||
+        current.Size != input.Size)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Parses the file into entry, numbering its strings in strings. This runs
+// on the update threads, each with its own string table.
+HRESULT DxcIndex::ParseIndexedFile(const std::string& fileName,
+                                   DxcWorkspaceIndex::Entry& entry,
+                                   DxcStringTable& strings,
+                                   const DxcUnsavedFileContents& unsaved)
+{
+  try
+  {
+    std::vector<CXUnsavedFile> files = GetCXUnsavedFiles(unsaved);
+    std::vector<const char*> args;
+    for (const std::string& arg : entry.Args)
+      args.push_back(arg.c_str());
+
+    ::llvm::sys::fs::MSFileSystem* msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+    CXTranslationUnit tu = clang_parseTranslationUnit(m_index, fileName.c_str(),
+      args.data(), (int)args.size(), files.data(), (unsigned)files.size(),
+      DxcTranslationUnitFlags_UseCallerThread);
+    if (tu == nullptr)
+    {
+      return E_FAIL;
+    }
+
+    DxcUsrIndex usrIndex;
+    clang_visitChildren(clang_getTranslationUnitCursor(tu), UsrIndexVisit, &usrIndex);
+    for (const auto& it : usrIndex.References)
+    {
+      unsigned usr = strings.Intern(it.first);
+      for (const CXCursor& cursor : it.second)
+      {
+        CXFile file;
+        DxcWorkspaceIndex::Reference ref;
+        clang_getSpellingLocation(clang_getCursorLocation(cursor), &file,
+                                  &ref.Line, &ref.Column, &ref.Offset);
+        // Builtin declarations have no file.
+        if (file == nullptr)
+          continue;
+        ref.Usr = usr;
+        ref.File = strings.Intern(CXStringToStdStringAndDispose(clang_getFileName(file)));
+        ref.IsDefinition = clang_isCursorDefinition(cursor) != 0;
+        entry.References.push_back(ref);
+      }
+    }
+
+    IndexedInputData D = { &entry, &strings, &unsaved };
+    clang_getInclusions(tu, VisitIndexedInput, &D);
+    clang_disposeTranslationUnit(tu);
+    entry.Parsed = true;
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::AddCompileDatabase(const char* directory)
+{
+  if (directory == nullptr) return E_INVALIDARG;
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    ::llvm::sys::fs::MSFileSystem* msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+    llvm::SmallString<128> databasePath(directory);
+    llvm::sys::path::append(databasePath, "compile_commands.json");
+    std::string errorMessage;
+    std::unique_ptr<clang::tooling::JSONCompilationDatabase> database =
+      clang::tooling::JSONCompilationDatabase::loadFromFile(databasePath, errorMessage);
+    if (!database)
+    {
+      return E_FAIL;
+    }
+
+    for (const std::string& file : database->getAllFiles())
+    {
+      std::vector<clang::tooling::CompileCommand> commands =
+        database->getCompileCommands(file);
+      if (commands.empty())
+        continue;
+      // The command starts with the compiler and names the file among its
+      // arguments, relative to the directory it ran in.
+      const clang::tooling::CompileCommand& command = commands.front();
+      std::vector<std::string> args;
+      for (size_t i = 1; i < command.CommandLine.size(); ++i)
+      {
+        const std::string& arg = command.CommandLine[i];
+        if (!arg.empty() && arg[0] != '-')
+        {
+          llvm::SmallString<128> argPath(arg);
+          if (llvm::sys::path::is_relative(argPath))
+          {
+            argPath = command.Directory;
+            llvm::sys::path::append(argPath, arg);
+          }
+          llvm::sys::path::remove_dots(argPath, /*remove_dot_dot*/ true);
+          llvm::sys::path::native(argPath);
+          if (argPath == file)
+            continue;
+        }
+        args.push_back(arg);
+      }
+
+      DxcWorkspaceIndex::Entry& entry = m_workspace.Entries[file];
+      if (entry.Args != args)
+      {
+        entry.Args = std::move(args);
+        entry.Parsed = false;
+      }
+    }
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::AddIndexedFile(
+  const char *source_filename,
+  const char * const *command_line_args,
+  int num_command_line_args)
+{
+  if (source_filename == nullptr) return E_INVALIDARG;
+  if (num_command_line_args > 0 && command_line_args == nullptr) return E_INVALIDARG;
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    std::vector<std::string> args(command_line_args,
+                                  command_line_args + std::max(0, num_command_line_args));
+    DxcWorkspaceIndex::Entry& entry = m_workspace.Entries[source_filename];
+    if (entry.Args != args)
+    {
+      entry.Args = std::move(args);
+      entry.Parsed = false;
+    }
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::RemoveIndexedFile(const char *source_filename)
+{
+  if (source_filename == nullptr) return E_INVALIDARG;
+  DxcThreadMalloc TM(m_pMalloc);
+  return m_workspace.Entries.erase(source_filename) ? S_OK : E_INVALIDARG;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::UpdateIndex(
+  IDxcUnsavedFile** unsaved_files,
+  unsigned num_unsaved_files, unsigned threadCount,
+  unsigned* pParsedCount)
+{
+  if (pParsedCount != nullptr) *pParsedCount = 0;
+  if (m_index == 0) return E_FAIL;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  HRESULT hr = S_OK;
+  try
+  {
+    DxcUnsavedFileContents unsaved;
+    IFR(MergeUnsavedFiles(unsaved_files, num_unsaved_files, unsaved));
+
+    std::vector<std::pair<const std::string*, DxcWorkspaceIndex::Entry*>> stale;
+    {
+      ::llvm::sys::fs::MSFileSystem* msfPtr;
+      IFT(CreateMSFileSystemForDisk(&msfPtr));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+      for (auto& it : m_workspace.Entries)
+      {
+        if (IsIndexedFileStale(it.second, unsaved))
+          stale.emplace_back(&it.first, &it.second);
+      }
+    }
+    if (stale.empty())
+    {
+      return S_OK;
+    }
+
+    // Translation units are independent, so files are parsed in parallel
+    // into entries of their own and merged once all are done.
+    struct ParsedFile
+    {
+      DxcWorkspaceIndex::Entry entry;
+      DxcStringTable strings;
+      HRESULT hr;
+    };
+    std::vector<ParsedFile> parsed(stale.size());
+    if (threadCount == 0)
+      threadCount = std::thread::hardware_concurrency();
+    threadCount = std::max(1u, std::min<unsigned>(threadCount, (unsigned)stale.size()));
+    std::atomic<size_t> nextFile(0);
+    IMalloc *pMalloc = m_pMalloc;
+    auto parseFiles = [&]() {
+      DxcThreadMalloc TM(pMalloc);
+      for (size_t i = nextFile++; i < stale.size(); i = nextFile++) {
+        parsed[i].entry.Args = stale[i].second->Args;
+        parsed[i].hr = ParseIndexedFile(*stale[i].first, parsed[i].entry,
+                                        parsed[i].strings, unsaved);
+      }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (unsigned i = 1; i < threadCount; ++i)
+      threads.emplace_back(parseFiles);
+    parseFiles();
+    for (std::thread &t : threads)
+      t.join();
+
+    // Files that fail to parse lose their references and are parsed again
+    // by the next update; the first failure is returned.
+    unsigned parsedCount = 0;
+    for (size_t i = 0; i < stale.size(); ++i)
+    {
+      ParsedFile& file = parsed[i];
+      if (FAILED(file.hr))
+      {
+        if (SUCCEEDED(hr))
+          hr = file.hr;
+        stale[i].second->Parsed = false;
+        stale[i].second->Inputs.clear();
+        stale[i].second->References.clear();
+        continue;
+      }
+      std::vector<unsigned> ids(file.strings.Strings.size());
+      for (size_t j = 0; j < ids.size(); ++j)
+        ids[j] = m_workspace.Strings.Intern(file.strings.Strings[j]);
+      for (DxcWorkspaceIndex::Input& input : file.entry.Inputs)
+        input.File = ids[input.File];
+      for (DxcWorkspaceIndex::Reference& ref : file.entry.References)
+      {
+        ref.Usr = ids[ref.Usr];
+        ref.File = ids[ref.File];
+      }
+      std::sort(file.entry.References.begin(), file.entry.References.end(),
+                IndexedReferenceLess);
+      *stale[i].second = std::move(file.entry);
+      ++parsedCount;
+    }
+    if (pParsedCount != nullptr) *pParsedCount = parsedCount;
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
+  return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::FindIndexedReferences(
+  IDxcCursor* cursor, unsigned skip, unsigned top,
+  unsigned* pResultLength, DxcIndexedReference** pResult)
+{
+  if (pResultLength == nullptr) return E_POINTER;
+  if (pResult == nullptr) return E_POINTER;
+  if (cursor == nullptr) return E_INVALIDARG;
+
+  *pResult = nullptr;
+  *pResultLength = 0;
+  if (top == 0)
+  {
+    return S_OK;
+  }
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    DxcCursor* cursorImpl = reinterpret_cast<DxcCursor*>(cursor);
+    CXCursor referenced = clang_getCursorReferenced(cursorImpl->GetCursor());
+    if (clang_Cursor_isNull(referenced))
+    {
+      return S_OK;
+    }
+    std::string usr = CXStringToStdStringAndDispose(clang_getCursorUSR(referenced));
+    auto foundUsr = m_workspace.Strings.Ids.find(usr);
+    if (foundUsr == m_workspace.Strings.Ids.end())
+    {
+      return S_OK;
+    }
+
+    DxcWorkspaceIndex::Reference key = { foundUsr->second, 0, 0, 0, 0, false };
+    std::vector<DxcWorkspaceIndex::Reference> refs;
+    for (const auto& it : m_workspace.Entries)
+    {
+      const std::vector<DxcWorkspaceIndex::Reference>& entryRefs = it.second.References;
+      for (auto ref = std::lower_bound(entryRefs.begin(), entryRefs.end(), key,
+                                       IndexedReferenceLess);
+           ref != entryRefs.end() && ref->Usr == key.Usr; ++ref)
+        refs.push_back(*ref);
+    }
+
+    // Headers included by several files are indexed with each of them.
+    const std::vector<std::string>& strings = m_workspace.Strings.Strings;
+    std::sort(refs.begin(), refs.end(),
+      [&](const DxcWorkspaceIndex::Reference& a, const DxcWorkspaceIndex::Reference& b) {
+        if (a.File != b.File) return strings[a.File] < strings[b.File];
+        return a.Offset < b.Offset;
+      });
+    refs.erase(std::unique(refs.begin(), refs.end(),
+      [](const DxcWorkspaceIndex::Reference& a, const DxcWorkspaceIndex::Reference& b) {
+        return a.File == b.File && a.Offset == b.Offset;
+      }), refs.end());
+    if (skip >= refs.size())
+    {
+      return S_OK;
+    }
+
+    unsigned resultLength = std::min<unsigned>(top, (unsigned)refs.size() - skip);
+    CoTaskMemAllocZeroElems(resultLength, pResult);
+    if (*pResult == nullptr)
+    {
+      return E_OUTOFMEMORY;
+    }
+    for (unsigned i = 0; i < resultLength; ++i)
+    {
+      const DxcWorkspaceIndex::Reference& ref = refs[skip + i];
+      DxcIndexedReference& result = (*pResult)[i];
+      result.FileIndex = ref.File;
+      result.Line = ref.Line;
+      result.Column = ref.Column;
+      result.Offset = ref.Offset;
+      result.IsDefinition = ref.IsDefinition ? TRUE : FALSE;
+    }
+    *pResultLength = resultLength;
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::GetIndexedFileName(unsigned fileIndex, LPSTR* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = nullptr;
+  if (fileIndex >= m_workspace.Strings.Strings.size()) return E_INVALIDARG;
+  DxcThreadMalloc TM(m_pMalloc);
+  return CoTaskMemAllocString(m_workspace.Strings.Strings[fileIndex].c_str(), pResult);
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::SaveIndex(const char* fileName)
+{
+  if (fileName == nullptr) return E_INVALIDARG;
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    std::string data;
+    m_workspace.Save(data);
+
+    ::llvm::sys::fs::MSFileSystem* msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(fileName, EC, llvm::sys::fs::F_None);
+    IFTLLVM(EC);
+    OS << data;
+    OS.close();
+    if (OS.has_error())
+    {
+      OS.clear_error();
+      return E_FAIL;
+    }
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcIndex::LoadIndex(const char* fileName)
+{
+  if (fileName == nullptr) return E_INVALIDARG;
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    ::llvm::sys::fs::MSFileSystem* msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFile(fileName);
+    IFTLLVM(buffer.getError());
+    return m_workspace.Load((*buffer)->getBufferStart(), (*buffer)->getBufferSize());
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 DxcIntelliSense::DxcIntelliSense(IMalloc *pMalloc)
 {
   m_pMalloc = pMalloc;
@@ -1508,9 +2351,10 @@ DxcTranslationUnit::~DxcTranslationUnit() {
   }
 }
 
-void DxcTranslationUnit::Initialize(CXTranslationUnit tu)
+void DxcTranslationUnit::Initialize(CXTranslationUnit tu, DxcUnsavedFileContents&& unsavedFiles)
 {
   m_tu = tu;
+  m_unsavedFiles = std::move(unsavedFiles);
 }
 
 _Use_decl_annotations_
@@ -1637,17 +2481,186 @@ HRESULT DxcTranslationUnit::Reparse(
   IDxcUnsavedFile** unsaved_files,
   unsigned num_unsaved_files)
 {
-  HRESULT hr;
-  CXUnsavedFile* local_unsaved_files;
   DxcThreadMalloc TM(m_pMalloc);
-  hr = SetupUnsavedFiles(unsaved_files, num_unsaved_files, &local_unsaved_files);
-  if (FAILED(hr)) return hr;
+  try
+  {
+    DxcUnsavedFileContents contents;
+    IFR(MergeUnsavedFiles(unsaved_files, num_unsaved_files, contents));
+    m_unsavedFiles = std::move(contents);
+    return ReparseUnsavedFiles();
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::ReparseChanged(
+  IDxcUnsavedFile** changed_files,
+  unsigned num_changed_files)
+{
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    // Only the changed files are read; a failure leaves the retained files
+    // as they were.
+    DxcUnsavedFileContents contents(m_unsavedFiles);
+    IFR(MergeUnsavedFiles(changed_files, num_changed_files, contents));
+    m_unsavedFiles = std::move(contents);
+    return ReparseUnsavedFiles();
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT DxcTranslationUnit::ReparseUnsavedFiles()
+{
+  if (m_tu == nullptr) return E_FAIL;
+  m_usrIndex.reset();
+
+  // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
+  ::llvm::sys::fs::MSFileSystem* msfPtr;
+  IFT(CreateMSFileSystemForDisk(&msfPtr));
+  std::auto_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+  IFTLLVM(pts.error_code());
+  std::vector<CXUnsavedFile> files = GetCXUnsavedFiles(m_unsavedFiles);
   int reparseResult = clang_reparseTranslationUnit(
-    m_tu, num_unsaved_files, local_unsaved_files, clang_defaultReparseOptions(m_tu));
-  CleanupUnsavedFiles(local_unsaved_files, num_unsaved_files);
+    m_tu, (unsigned)files.size(), files.data(), clang_defaultReparseOptions(m_tu));
   return reparseResult == 0 ? S_OK : E_FAIL;
 }
 
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::CodeCompleteAt(
+  const char* fileName, unsigned line, unsigned column,
+  IDxcUnsavedFile** pUnsavedFiles, unsigned numUnsavedFiles,
+  DxcCodeCompleteFlags options, IDxcCodeCompleteResults** pResult)
+{
+  if (fileName == nullptr) return E_INVALIDARG;
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = nullptr;
+  if (m_tu == nullptr) return E_FAIL;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    DxcUnsavedFileContents contents(m_unsavedFiles);
+    IFR(MergeUnsavedFiles(pUnsavedFiles, numUnsavedFiles, contents));
+    std::vector<CXUnsavedFile> files = GetCXUnsavedFiles(contents);
+
+    CComPtr<DxcCodeCompleteResults> newValue = new (std::nothrow) DxcCodeCompleteResults();
+    if (newValue == nullptr) return E_OUTOFMEMORY;
+
+    // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
+    ::llvm::sys::fs::MSFileSystem* msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::auto_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+    CXCodeCompleteResults* ccr = clang_codeCompleteAt(m_tu, fileName, line,
+      column, files.data(), (unsigned)files.size(), options);
+    if (ccr == nullptr) return E_FAIL;
+    newValue->Initialize(ccr);
+    *pResult = newValue.Detach();
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+const DxcUsrIndex& DxcTranslationUnit::GetUsrIndex()
+{
+  if (!m_usrIndex)
+  {
+    std::unique_ptr<DxcUsrIndex> index(new DxcUsrIndex());
+    clang_visitChildren(clang_getTranslationUnitCursor(m_tu), UsrIndexVisit, index.get());
+    m_usrIndex = std::move(index);
+  }
+  return *m_usrIndex;
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::FindReferences(
+  IDxcCursor* cursor, IDxcFile* file, unsigned skip, unsigned top,
+  unsigned* pResultLength, IDxcCursor*** pResult)
+{
+  if (pResultLength == nullptr) return E_POINTER;
+  if (pResult == nullptr) return E_POINTER;
+  if (cursor == nullptr) return E_INVALIDARG;
+
+  *pResult = nullptr;
+  *pResultLength = 0;
+  if (m_tu == nullptr) return E_FAIL;
+  if (top == 0)
+  {
+    return S_OK;
+  }
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    DxcCursor* cursorImpl = reinterpret_cast<DxcCursor*>(cursor);
+    CXCursor referenced = clang_getCursorReferenced(cursorImpl->GetCursor());
+    if (clang_Cursor_isNull(referenced))
+    {
+      return S_OK;
+    }
+
+    PagedCursorVisitorContext findReferencesContext;
+    findReferencesContext.skip = skip;
+    findReferencesContext.top = top;
+    std::string usr = CXStringToStdStringAndDispose(clang_getCursorUSR(referenced));
+    const DxcUsrIndex& index = GetUsrIndex();
+    auto found = index.References.find(usr);
+    if (found != index.References.end())
+    {
+      CXFile cxFile = file ? reinterpret_cast<DxcFile*>(file)->GetFile() : nullptr;
+      for (const CXCursor& reference : found->second)
+      {
+        if (cxFile != nullptr)
+        {
+          CXFile referenceFile;
+          clang_getSpellingLocation(clang_getCursorLocation(reference),
+                                    &referenceFile, nullptr, nullptr, nullptr);
+          if (!clang_File_isEqual(cxFile, referenceFile))
+            continue;
+        }
+        if (PagedCursorFindVisit(&findReferencesContext, reference,
+                                 clang_getNullRange()) == CXVisit_Break)
+          break;
+      }
+    }
+
+    return PagedCursorVisitorCopyResults(&findReferencesContext, pResultLength, pResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::FindDefinition(IDxcCursor* cursor, IDxcCursor** pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  *pResult = nullptr;
+  if (cursor == nullptr) return E_INVALIDARG;
+  if (m_tu == nullptr) return E_FAIL;
+
+  DxcThreadMalloc TM(m_pMalloc);
+  try
+  {
+    DxcCursor* cursorImpl = reinterpret_cast<DxcCursor*>(cursor);
+    CXCursor referenced = clang_getCursorReferenced(cursorImpl->GetCursor());
+    CXCursor definition = clang_getNullCursor();
+    if (!clang_Cursor_isNull(referenced))
+    {
+      std::string usr = CXStringToStdStringAndDispose(clang_getCursorUSR(referenced));
+      const DxcUsrIndex& index = GetUsrIndex();
+      auto found = index.Definitions.find(usr);
+      if (found != index.Definitions.end())
+        definition = found->second;
+    }
+    return DxcCursor::Create(definition, pResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 _Use_decl_annotations_
 HRESULT DxcTranslationUnit::GetCursorForLocation(IDxcSourceLocation* location, IDxcCursor** pResult)
 {
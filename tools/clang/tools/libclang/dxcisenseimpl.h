@@ -17,8 +17,18 @@
 #include "dxc/dxcapi.internal.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // Forward declarations.
+class DxcCodeCompleteResults;
+class DxcCompletionResult;
+class DxcCompletionString;
 class DxcCursor;
 class DxcDiagnostic;
 class DxcFile;
@@ -30,6 +40,132 @@ class DxcTranslationUnit;
 class DxcToken;
 struct IMalloc;
 
+// File names and contents of unsaved files.
+typedef std::vector<std::pair<std::string, std::string>> DxcUnsavedFileContents;
+
+// Cursors of a translation unit by the USR of the entity they declare or
+// refer to, in source order.
+struct DxcUsrIndex
+{
+  std::unordered_map<std::string, std::vector<CXCursor>> References;
+  std::unordered_map<std::string, CXCursor> Definitions;
+};
+
+// Numbered strings, so that references of a workspace index store numbers
+// rather than file names and USRs.
+struct DxcStringTable
+{
+  std::vector<std::string> Strings;
+  std::unordered_map<std::string, unsigned> Ids;
+
+  unsigned Intern(const std::string& value);
+};
+
+// The files of a workspace, the arguments they are parsed with, and the
+// references found when they were last parsed.
+struct DxcWorkspaceIndex
+{
+  struct Reference
+  {
+    unsigned Usr;
+    unsigned File;
+    unsigned Line;
+    unsigned Column;
+    unsigned Offset;
+    bool IsDefinition;
+  };
+  // A file a parse read: its modification time and size if it was read from
+  // disk, or the hash of its contents if it was an unsaved file.
+  struct Input
+  {
+    unsigned File;
+    bool Unsaved;
+    uint64_t Stamp;
+    uint64_t Size;
+  };
+  struct Entry
+  {
+    std::vector<std::string> Args;
+    bool Parsed = false;
+    std::vector<Input> Inputs;
+    std::vector<Reference> References;
+  };
+
+  DxcStringTable Strings;
+  // Ordered by file name, so that a saved index doesn't depend on the
+  // order files were added in.
+  std::map<std::string, Entry> Entries;
+
+  void Save(std::string& data) const;
+  HRESULT Load(const char* data, size_t size);
+};
+
+class DxcCodeCompleteResults : public IDxcCodeCompleteResults
+{
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CXCodeCompleteResults* m_ccr;
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject)
+  {
+    return DoBasicQueryInterface<IDxcCodeCompleteResults>(this, iid, ppvObject);
+  }
+
+  DxcCodeCompleteResults();
+  ~DxcCodeCompleteResults();
+  void Initialize(CXCodeCompleteResults* ccr);
+
+  __override HRESULT STDMETHODCALLTYPE GetNumResults(_Out_ unsigned* pResult);
+  __override HRESULT STDMETHODCALLTYPE GetResultAt(unsigned index, _Outptr_result_nullonfailure_ IDxcCompletionResult** pResult);
+};
+
+// Keeps the results it came from alive, as they own its completion string.
+class DxcCompletionResult : public IDxcCompletionResult
+{
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcCodeCompleteResults> m_results;
+  CXCompletionResult m_result;
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject)
+  {
+    return DoBasicQueryInterface<IDxcCompletionResult>(this, iid, ppvObject);
+  }
+
+  DxcCompletionResult();
+  ~DxcCompletionResult();
+  void Initialize(IDxcCodeCompleteResults* results, const CXCompletionResult& result);
+  static HRESULT Create(IDxcCodeCompleteResults* results, const CXCompletionResult& result, _Outptr_result_nullonfailure_ IDxcCompletionResult** pObject);
+
+  __override HRESULT STDMETHODCALLTYPE GetCursorKind(_Out_ DxcCursorKind* pResult);
+  __override HRESULT STDMETHODCALLTYPE GetCompletionString(_Outptr_result_nullonfailure_ IDxcCompletionString** pResult);
+};
+
+class DxcCompletionString : public IDxcCompletionString
+{
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcCodeCompleteResults> m_results;
+  CXCompletionString m_completionString;
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject)
+  {
+    return DoBasicQueryInterface<IDxcCompletionString>(this, iid, ppvObject);
+  }
+
+  DxcCompletionString();
+  ~DxcCompletionString();
+  void Initialize(IDxcCodeCompleteResults* results, const CXCompletionString& completionString);
+  static HRESULT Create(IDxcCodeCompleteResults* results, const CXCompletionString& completionString, _Outptr_result_nullonfailure_ IDxcCompletionString** pObject);
+
+  __override HRESULT STDMETHODCALLTYPE GetNumCompletionChunks(_Out_ unsigned* pResult);
+  __override HRESULT STDMETHODCALLTYPE GetCompletionChunkKind(unsigned chunkNumber, _Out_ DxcCompletionChunkKind* pResult);
+  __override HRESULT STDMETHODCALLTYPE GetCompletionChunkText(unsigned chunkNumber, _Outptr_result_maybenull_ LPSTR* pResult);
+};
+
 class DxcCursor : public IDxcCursor
 {
 private:
@@ -46,6 +182,7 @@ public:
   ~DxcCursor();
   void Initialize(const CXCursor& cursor);
   static HRESULT Create(const CXCursor& cursor, _Outptr_result_nullonfailure_ IDxcCursor** pObject);
+  const CXCursor& GetCursor() const { return m_cursor; }
 
   __override HRESULT STDMETHODCALLTYPE GetExtent(_Outptr_result_nullonfailure_ IDxcSourceRange** pRange);
   __override HRESULT STDMETHODCALLTYPE GetLocation(_Outptr_result_nullonfailure_ IDxcSourceLocation** pResult);
@@ -157,18 +294,26 @@ public:
   __override HRESULT STDMETHODCALLTYPE GetStackItem(unsigned index, _Outptr_result_nullonfailure_ IDxcSourceLocation **pResult);
 };
 
-class DxcIndex : public IDxcIndex
+class DxcIndex : public IDxcIndex2
 {
 private:
     DXC_MICROCOM_TM_REF_FIELDS()
     CXIndex m_index;
     DxcGlobalOptions m_options;
     hlsl::DxcLangExtensionsHelper m_langHelper;
+    DxcWorkspaceIndex m_workspace;
+
+    bool IsIndexedFileStale(const DxcWorkspaceIndex::Entry& entry,
+                            const DxcUnsavedFileContents& unsaved);
+    HRESULT ParseIndexedFile(const std::string& fileName,
+                             DxcWorkspaceIndex::Entry& entry,
+                             DxcStringTable& strings,
+                             const DxcUnsavedFileContents& unsaved);
 public:
     DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject)
     {
-      return DoBasicQueryInterface<IDxcIndex>(this, iid, ppvObject);
+      return DoBasicQueryInterface<IDxcIndex, IDxcIndex2>(this, iid, ppvObject);
     }
 
     DxcIndex();
@@ -186,6 +331,23 @@ public:
       unsigned num_unsaved_files,
       DxcTranslationUnitFlags options,
       _Outptr_result_nullonfailure_ IDxcTranslationUnit** pTranslationUnit);
+    __override HRESULT STDMETHODCALLTYPE AddCompileDatabase(_In_z_ const char* directory);
+    __override HRESULT STDMETHODCALLTYPE AddIndexedFile(
+      _In_z_ const char *source_filename,
+      _In_count_(num_command_line_args) const char * const *command_line_args,
+      int num_command_line_args);
+    __override HRESULT STDMETHODCALLTYPE RemoveIndexedFile(_In_z_ const char *source_filename);
+    __override HRESULT STDMETHODCALLTYPE UpdateIndex(
+      _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
+      unsigned num_unsaved_files, unsigned threadCount,
+      _Out_opt_ unsigned* pParsedCount);
+    __override HRESULT STDMETHODCALLTYPE FindIndexedReferences(
+      _In_ IDxcCursor* cursor, unsigned skip, unsigned top,
+      _Out_ unsigned* pResultLength,
+      _Outptr_result_buffer_maybenull_(*pResultLength) DxcIndexedReference** pResult);
+    __override HRESULT STDMETHODCALLTYPE GetIndexedFileName(unsigned fileIndex, _Outptr_result_z_ LPSTR* pResult);
+    __override HRESULT STDMETHODCALLTYPE SaveIndex(_In_z_ const char* fileName);
+    __override HRESULT STDMETHODCALLTYPE LoadIndex(_In_z_ const char* fileName);
 };
 
 class DxcIntelliSense : public IDxcIntelliSense, public IDxcLangExtensions {
@@ -294,21 +456,28 @@ public:
   __override HRESULT STDMETHODCALLTYPE GetSpelling(_Outptr_result_maybenull_ LPSTR* pValue);
 };
 
-class DxcTranslationUnit : public IDxcTranslationUnit
+class DxcTranslationUnit : public IDxcTranslationUnit2
 {
 private:
     DXC_MICROCOM_TM_REF_FIELDS()
     CXTranslationUnit m_tu;
+    // Unsaved files of the last parse or reparse.
+    DxcUnsavedFileContents m_unsavedFiles;
+    // Built on first use after a parse or reparse.
+    std::unique_ptr<DxcUsrIndex> m_usrIndex;
+
+    HRESULT ReparseUnsavedFiles();
+    const DxcUsrIndex& GetUsrIndex();
 public:
     DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject)
     {
-      return DoBasicQueryInterface<IDxcTranslationUnit>(this, iid, ppvObject);
+      return DoBasicQueryInterface<IDxcTranslationUnit, IDxcTranslationUnit2>(this, iid, ppvObject);
     }
 
     DxcTranslationUnit();
     ~DxcTranslationUnit();
-    void Initialize(CXTranslationUnit tu);
+    void Initialize(CXTranslationUnit tu, DxcUnsavedFileContents&& unsavedFiles);
 
     __override HRESULT STDMETHODCALLTYPE GetCursor(_Outptr_ IDxcCursor** pCursor);
     __override HRESULT STDMETHODCALLTYPE Tokenize(
@@ -338,6 +507,22 @@ public:
       _Out_ unsigned* errorLength,
       _Out_ BSTR* errorMessage);
     __override HRESULT STDMETHODCALLTYPE GetInclusionList(_Out_ unsigned* pResultCount, _Outptr_result_buffer_(*pResultCount) IDxcInclusion*** pResult);
+    __override HRESULT STDMETHODCALLTYPE ReparseChanged(
+      _In_count_(num_changed_files) IDxcUnsavedFile** changed_files,
+      unsigned num_changed_files);
+    __override HRESULT STDMETHODCALLTYPE CodeCompleteAt(
+      _In_ const char* fileName, unsigned line, unsigned column,
+      _In_count_(numUnsavedFiles) IDxcUnsavedFile** pUnsavedFiles,
+      unsigned numUnsavedFiles, DxcCodeCompleteFlags options,
+      _Outptr_result_nullonfailure_ IDxcCodeCompleteResults** pResult);
+    __override HRESULT STDMETHODCALLTYPE FindReferences(
+      _In_ IDxcCursor* cursor, _In_opt_ IDxcFile* file,
+      unsigned skip, unsigned top,
+      _Out_ unsigned* pResultLength,
+      _Outptr_result_buffer_maybenull_(*pResultLength) IDxcCursor*** pResult);
+    __override HRESULT STDMETHODCALLTYPE FindDefinition(
+      _In_ IDxcCursor* cursor,
+      _Outptr_result_nullonfailure_ IDxcCursor** pResult);
 };
 
 class DxcType : public IDxcType
@@ -41,6 +41,11 @@
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
 #include "dxc/Support/dxcfilesystem.h"
+#include "dxc/HLSL/DxcTimeReport.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
 
 #define CP_UTF16 1200
 
@@ -340,12 +345,19 @@ HRESULT DoRewriteUnused(_In_ DxcLangExtensionsHelper *pHelper,
   CompilerInstance compiler;
   std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
       std::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());  
-  SetupCompilerForRewrite(compiler, pHelper, pFileName, diagPrinter.get(), pRemap, pDefines);
+  {
+    hlsl::TimeReportPhase setupPhase("setup");
+    SetupCompilerForRewrite(compiler, pHelper, pFileName, diagPrinter.get(), pRemap, pDefines);
+  }
 
   // Parse the source file.
-  compiler.getDiagnosticClient().BeginSourceFile(compiler.getLangOpts(), &compiler.getPreprocessor());
-  ParseAST(compiler.getSema(), false, false);
+  {
+    hlsl::TimeReportPhase parsePhase("parse");
+    compiler.getDiagnosticClient().BeginSourceFile(compiler.getLangOpts(), &compiler.getPreprocessor());
+    ParseAST(compiler.getSema(), false, false);
+  }
 
+  hlsl::TimeReportPhase rewritePhase("rewrite");
   ASTContext& C = compiler.getASTContext();
   TranslationUnitDecl *tu = C.getTranslationUnitDecl();
 
@@ -538,17 +550,120 @@ HRESULT DoSimpleReWrite(_In_ DxcLangExtensionsHelper *pHelper,
   return S_OK;
 }
 
-class DxcRewriter : public IDxcRewriter, public IDxcLangExtensions {
+// Loads each include once for all the rewrites of a batch. Rewrites run in
+// parallel, so this also serializes the calls into the user's handler.
+class DxcBatchIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_TM_REF_FIELDS()
+  CComPtr<IDxcIncludeHandler> m_pIncludeHandler;
+  std::mutex m_lock;
+  std::map<std::wstring, std::pair<HRESULT, CComPtr<IDxcBlob>>> m_sources;
+public:
+  DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
+  DXC_MICROCOM_TM_ALLOC(DxcBatchIncludeHandler)
+
+  DxcBatchIncludeHandler(IMalloc *pMalloc, IDxcIncludeHandler *pIncludeHandler)
+      : m_dwRef(0), m_pMalloc(pMalloc), m_pIncludeHandler(pIncludeHandler) {}
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+      _In_ LPCWSTR pFilename,
+      _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    *ppIncludeSource = nullptr;
+    try {
+      std::lock_guard<std::mutex> lock(m_lock);
+      auto it = m_sources.find(pFilename);
+      if (it == m_sources.end()) {
+        CComPtr<IDxcBlob> pSource;
+        HRESULT hr = m_pIncludeHandler->LoadSource(pFilename, &pSource);
+        it = m_sources.insert({ pFilename, { hr, pSource } }).first;
+      }
+      if (FAILED(it->second.first))
+        return it->second.first;
+      return it->second.second.CopyTo(ppIncludeSource);
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+class DxcRewriter : public IDxcRewriter2, public IDxcLangExtensions {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   DxcLangExtensionsHelper m_langExtensionsHelper;
+
+  // Removes the unused globals of one source of a batch, timing the rewrite.
+  HRESULT RemoveUnusedGlobalsTimed(_In_ IDxcBlobEncoding *pSource,
+                                   _In_opt_ LPCWSTR pSourceName,
+                                   _In_ LPCSTR pUtf8EntryPoint,
+                                   _In_opt_ LPCSTR pUtf8Defines,
+                                   _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                                   _COM_Outptr_ IDxcOperationResult **ppResult) {
+    *ppResult = nullptr;
+    hlsl::TimeReport timeReport(m_pMalloc);
+    hlsl::TimeReportScope timeReportScope(&timeReport);
+    DxcThreadMalloc TMReport(timeReport.GetMalloc());
+
+    try {
+      CComPtr<IDxcBlobEncoding> utf8Source;
+      IFT(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
+
+      if (pSourceName == nullptr)
+        pSourceName = L"input.hlsl";
+      CW2A utf8SourceName(pSourceName, CP_UTF8);
+      LPCSTR fName = utf8SourceName.m_psz;
+
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf;
+      if (pIncludeHandler != nullptr) {
+        msf.reset(dxcutil::CreateDxcArgsFileSystem(utf8Source, pSourceName, pIncludeHandler));
+      }
+      else {
+        ::llvm::sys::fs::MSFileSystem* msfPtr;
+        IFT(CreateMSFileSystemForDisk(&msfPtr));
+        msf.reset(msfPtr);
+      }
+
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      StringRef Data((LPCSTR)utf8Source->GetBufferPointer(), utf8Source->GetBufferSize());
+      std::unique_ptr<llvm::MemoryBuffer> pBuffer(llvm::MemoryBuffer::getMemBufferCopy(Data, fName));
+      std::unique_ptr<ASTUnit::RemappedFile> pRemap(new ASTUnit::RemappedFile(fName, pBuffer.release()));
+
+      LPSTR errors = nullptr;
+      LPSTR rewrite = nullptr;
+      HRESULT status = DoRewriteUnused(
+          &m_langExtensionsHelper, fName, pRemap.get(), pUtf8EntryPoint,
+          pUtf8Defines, &errors, &rewrite);
+
+      std::string report;
+      raw_string_ostream reportOS(report);
+      timeReport.WriteJson(reportOS);
+      reportOS.flush();
+      CComPtr<IDxcBlobEncoding> pTimeReportBlob;
+      IFT(DxcCreateBlobWithEncodingOnHeapCopy(report.data(), report.size(),
+                                              CP_UTF8, &pTimeReportBlob));
+
+      IFT(DxcOperationResult::CreateFromUtf8Strings(errors, rewrite, status,
+                                                    ppResult));
+      static_cast<DxcOperationResult *>(*ppResult)->m_timeReport =
+          pTimeReportBlob;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+    return S_OK;
+  }
+
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcRewriter)
   DXC_LANGEXTENSIONS_HELPER_IMPL(m_langExtensionsHelper)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcRewriter, IDxcLangExtensions>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcRewriter2, IDxcRewriter, IDxcLangExtensions>(this, iid, ppvObject);
   }
 
   __override HRESULT STDMETHODCALLTYPE RemoveUnusedGlobals(_In_ IDxcBlobEncoding *pSource,
@@ -690,6 +805,76 @@ public:
 
   }
 
+  __override HRESULT STDMETHODCALLTYPE RemoveUnusedGlobalsBatch(
+      _In_ UINT32 sourceCount,
+      _In_count_(sourceCount) IDxcBlobEncoding **ppSources,
+      _In_opt_count_(sourceCount) LPCWSTR *pSourceNames,
+      _In_z_ LPCWSTR pEntryPoint,
+      _In_count_(defineCount) DxcDefine *pDefines,
+      _In_ UINT32 defineCount,
+      _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+      _In_ UINT32 threadCount,
+      _Out_writes_(sourceCount) IDxcOperationResult **ppResults) {
+    if (ppResults == nullptr || (sourceCount > 0 && ppSources == nullptr) ||
+        pEntryPoint == nullptr || (defineCount > 0 && pDefines == nullptr))
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < sourceCount; ++i) {
+      if (ppSources[i] == nullptr)
+        return E_INVALIDARG;
+      ppResults[i] = nullptr;
+    }
+
+    DxcThreadMalloc TM(m_pMalloc);
+    HRESULT hr = S_OK;
+    try {
+      // The entry point, defines and includes are shared by all rewrites.
+      CW2A utf8EntryPoint(pEntryPoint, CP_UTF8);
+      std::string definesStr = DefinesToString(pDefines, defineCount);
+      LPCSTR pUtf8Defines = defineCount > 0 ? definesStr.c_str() : nullptr;
+      CComPtr<DxcBatchIncludeHandler> pBatchIncludeHandler;
+      if (pIncludeHandler != nullptr) {
+        pBatchIncludeHandler = DxcBatchIncludeHandler::Alloc(m_pMalloc, pIncludeHandler);
+        IFTOOM(pBatchIncludeHandler.p);
+      }
+
+      if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+      threadCount = std::max(1u, std::min<unsigned>(threadCount, sourceCount));
+
+      std::vector<HRESULT> sourceHRs(sourceCount, S_OK);
+      std::atomic<UINT32> nextSource(0);
+      IMalloc *pMalloc = m_pMalloc;
+      auto rewriteSources = [&]() {
+        DxcThreadMalloc TM(pMalloc);
+        for (UINT32 i = nextSource++; i < sourceCount; i = nextSource++) {
+          sourceHRs[i] = RemoveUnusedGlobalsTimed(
+              ppSources[i], pSourceNames ? pSourceNames[i] : nullptr,
+              utf8EntryPoint, pUtf8Defines, pBatchIncludeHandler, &ppResults[i]);
+        }
+      };
+      std::vector<std::thread> threads;
+      threads.reserve(threadCount);
+      for (unsigned i = 1; i < threadCount; ++i)
+        threads.emplace_back(rewriteSources);
+      rewriteSources();
+      for (std::thread &t : threads)
+        t.join();
+
+      for (HRESULT sourceHR : sourceHRs)
+        IFT(sourceHR);
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+    if (FAILED(hr)) {
+      for (UINT32 i = 0; i < sourceCount; ++i) {
+        if (ppResults[i]) {
+          ppResults[i]->Release();
+          ppResults[i] = nullptr;
+        }
+      }
+    }
+    return hr;
+  }
+
   std::string DefinesToString(_In_count_(defineCount) DxcDefine *pDefines, _In_ UINT32 defineCount) {
     std::string defineStr;
     for (UINT32 i = 0; i < defineCount; i++) {
@@ -16,6 +16,7 @@
 #include <cstdlib>
 #include <random>
 #include <algorithm>
+#include <chrono>
 #include <iterator>
 #include <vector>
 #include <set>
@@ -535,6 +536,7 @@ public:
   TEST_METHOD(Intersections);
   TEST_METHOD(GapFilling);
   TEST_METHOD(Allocate);
+  TEST_METHOD(ManyBindings);
 
   void InitScenarios() {
     struct P {
@@ -754,3 +756,42 @@ TEST_F(AllocatorTest, Allocate) {
     TestSizesFn();
   }
 }
+
+// Automatic binding of many resources around explicit bindings, where each
+// allocation has to skip the gaps too small for it. This used to walk the
+// spans from the first free register for every allocation.
+TEST_F(AllocatorTest, ManyBindings) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  const unsigned explicitCount = 25000;
+  ElementVector elements;
+  elements.reserve(explicitCount * 4);
+  Allocator alloc(0, UINT_MAX);
+
+  auto start = std::chrono::system_clock::now();
+  // Explicit bindings every 4 registers leave gaps of 3.
+  for (unsigned i = 0; i < explicitCount; ++i) {
+    elements.emplace_back(elements.size(), i * 4, i * 4);
+    VERIFY_IS_NULL(alloc.Insert(&elements.back(), i * 4, i * 4));
+  }
+  // Arrays of 2 go in the gaps, leaving a register in each.
+  unsigned pos = 0;
+  for (unsigned i = 0; i < explicitCount; ++i) {
+    elements.emplace_back(elements.size(), 0, 0);
+    VERIFY_IS_TRUE(alloc.Allocate(&elements.back(), 2, pos));
+    VERIFY_ARE_EQUAL(i * 4 + 1, pos);
+  }
+  // Single registers fill what's left, then go after the last binding.
+  for (unsigned i = 0; i < explicitCount * 2; ++i) {
+    elements.emplace_back(elements.size(), 0, 0);
+    VERIFY_IS_TRUE(alloc.Allocate(&elements.back(), 1, pos));
+    VERIFY_ARE_EQUAL(i < explicitCount ? i * 4 + 3 : i + explicitCount * 3, pos);
+  }
+  auto end = std::chrono::system_clock::now();
+  auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  LogCommentFmt(L"%u bindings allocated in %u ms", (unsigned)elements.size(),
+                (unsigned)dur.count());
+
+  VERIFY_ARE_EQUAL(elements.size(), alloc.GetSpans().size());
+  VERIFY_IS_FALSE(alloc.IsFull());
+  VERIFY_ARE_EQUAL(explicitCount * 5, alloc.GetFirstFree());
+}
@@ -17,10 +17,13 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <set>
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <thread>
 #include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxilPipelineStateValidation.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
 #include <atlfile.h>
@@ -389,9 +392,15 @@ public:
   END_TEST_CLASS()
 
   TEST_CLASS_SETUP(InitSupport);
+  TEST_METHOD_SETUP(BeginTiming);
+  TEST_METHOD_CLEANUP(EndTiming);
 
   TEST_METHOD(CompileWhenDebugThenDIPresent)
   TEST_METHOD(CompileDebugLines)
+  TEST_METHOD(CompileDebugLinesWhenLineTablesOnly)
+  TEST_METHOD(CompileDebugLinesFromContainer)
+  TEST_METHOD(CompileDebugSourcesWhenSourcePackThenProvided)
+  TEST_METHOD(AssembleWhenBitcodeThenProgramBitcodeKept)
 
   TEST_METHOD(CompileWhenDefinesThenApplied)
   TEST_METHOD(CompileWhenDefinesManyThenApplied)
@@ -399,11 +408,17 @@ public:
   TEST_METHOD(CompileWhenIncorrectThenFails)
   TEST_METHOD(CompileWhenWorksThenDisassembleWorks)
   TEST_METHOD(CompileWhenDebugWorksThenStripDebug)
+  TEST_METHOD(CompileWhenSidecarThenDebugPartsSplit)
   TEST_METHOD(CompileWhenWorksThenAddRemovePrivate)
   TEST_METHOD(CompileThenAddCustomDebugName)
   TEST_METHOD(CompileWithRootSignatureThenStripRootSignature)
+  TEST_METHOD(CompileWhenRootSignatureSharedThenEachShaderVerified)
+  TEST_METHOD(CompileWhenExtendedPSVThenInputLayoutAndHashesEmitted)
+  TEST_METHOD(CompileWhenEmbedHashThenResultHasShaderHash)
+  TEST_METHOD(CompileWithArgsWhenDefinesAddedThenMatchesCompile)
 
   TEST_METHOD(CompileWhenIncludeThenLoadInvoked)
+  TEST_METHOD(CompileWhenIncludeThenDependencyFileListsIt)
   TEST_METHOD(CompileWhenIncludeThenLoadUsed)
   TEST_METHOD(CompileWhenIncludeAbsoluteThenLoadAbsolute)
   TEST_METHOD(CompileWhenIncludeLocalThenLoadRelative)
@@ -412,12 +427,35 @@ public:
   TEST_METHOD(CompileWhenIncludeFlagsThenIncludeUsed)
   TEST_METHOD(CompileWhenIncludeMissingThenFail)
   TEST_METHOD(CompileWhenIncludeHasPathThenOK)
+  TEST_METHOD(CompileWhenIncludeSpelledDifferentlyThenPragmaOnceHolds)
+  TEST_METHOD(CompileWhenCacheDirThenResultReused)
+  TEST_METHOD(CompileBatchWhenTwoEntriesThenBothSucceed)
+  TEST_METHOD(DisassembleFunctionWhenNamedThenOnlyThatFunction)
+  TEST_METHOD(CompileWhenYcThenPretokenizedHeaderProduced)
+  TEST_METHOD(CompileWhenIncludeCacheThenIncludeLoadedOnce)
+  TEST_METHOD(CompileWhenIncludeCacheThenMissesProbedOnce)
+  TEST_METHOD(CompileWhenTimeReportThenJsonProduced)
+  TEST_METHOD(CompileWhenTimeTraceThenTraceEventsProduced)
+  TEST_METHOD(CompileWhenPrintIRStatsThenTableProduced)
+  TEST_METHOD(CompileWhenAllocStatsThenCountsProduced)
+  TEST_METHOD(CompileWhenSessionThenMatchesCompiler)
+  TEST_METHOD(CompileWhenSessionReusesContextThenOutputMatches)
+  TEST_METHOD(CompileWhenSessionSharedByThreadsThenMatchesCompiler)
+  TEST_METHOD(CompileAsyncWhenWaitedThenMatchesCompiler)
+  TEST_METHOD(CompileWhenCancelledThenAborts)
+  TEST_METHOD(CompileWhenEventsCallbackThenPhasesAndPassesReported)
+  TEST_METHOD(CompilePermutationsWhenSameTokensThenSharedResult)
+  TEST_METHOD(SpecializeWhenValuesSetThenConstantsFolded)
+  TEST_METHOD(LinkStagesWhenOutputsUnreadThenRemoved)
+  TEST_METHOD(LinkStagesWhenOutputPerPrimitiveThenNoInterpolation)
 
   TEST_METHOD(CompileWhenODumpThenPassConfig)
   TEST_METHOD(CompileWhenODumpThenOptimizerMatch)
+  TEST_METHOD(CompileWhenOptPipelineThenSameAsODumpPasses)
   TEST_METHOD(CompileWhenVdThenProducesDxilContainer)
 
   TEST_METHOD(CompileWhenNoMemThenOOM)
+  TEST_METHOD(CompileWhenArenaMallocThenPeakReported)
   TEST_METHOD(CompileWhenShaderModelMismatchAttributeThenFail)
   TEST_METHOD(CompileBadHlslThenFail)
   TEST_METHOD(CompileLegacyShaderModelThenFail)
@@ -461,6 +499,7 @@ public:
   TEST_METHOD(PixDebugPreexistingSVVertex)
   TEST_METHOD(PixDebugPreexistingSVInstance)
   TEST_METHOD(PixAccessTracking)
+  TEST_METHOD(PixBlockCounters)
 
   TEST_METHOD(CodeGenAbs1)
   TEST_METHOD(CodeGenAbs2)
@@ -629,6 +668,7 @@ public:
   TEST_METHOD(CodeGenLibCsEntry3)
   TEST_METHOD(CodeGenLibEntries)
   TEST_METHOD(CodeGenLibEntries2)
+  TEST_METHOD(CodeGenLibMergeFunc)
   TEST_METHOD(CodeGenLibNoAlias)
   TEST_METHOD(CodeGenLibResource)
   TEST_METHOD(CodeGenLibUnusedFunc)
@@ -753,6 +793,7 @@ public:
   TEST_METHOD(CodeGenSelMat)
   TEST_METHOD(CodeGenSignaturePacking)
   TEST_METHOD(CodeGenSignaturePackingByWidth)
+  TEST_METHOD(CodeGenSignaturePackingMinimal)
   TEST_METHOD(CodeGenShaderAttr)
   TEST_METHOD(CodeGenShare_Mem_Dbg)
   TEST_METHOD(CodeGenShare_Mem_Phi)
@@ -942,6 +983,7 @@ public:
   TEST_METHOD(CodeGenPatchLength)
   TEST_METHOD(PreprocessWhenValidThenOK)
   TEST_METHOD(PreprocessWhenExpandTokenPastingOperandThenAccept)
+  TEST_METHOD(PreprocessWhenCompiledPreprocessedThenDependenciesKept)
   TEST_METHOD(WhenSigMismatchPCFunctionThenFail)
 
   // Dx11 Sample
@@ -1628,7 +1670,8 @@ public:
     return BlobToUtf8(pErrors);
   }
 
-  HRESULT CreateDiaSourceForCompile(const char *hlsl, IDiaDataSource **ppDiaSource)
+  HRESULT CreateDiaSourceForCompile(const char *hlsl, IDiaDataSource **ppDiaSource,
+                                    LPCWSTR debugArg = L"/Zi")
   {
     if (!ppDiaSource)
       return E_POINTER;
@@ -1640,7 +1683,7 @@ public:
 
     VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
     CreateBlobFromText(hlsl, &pSource);
-    LPCWSTR args[] = { L"/Zi" };
+    LPCWSTR args[] = { debugArg };
     VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
       L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
     VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
@@ -1654,7 +1697,7 @@ public:
       //WEX::Logging::Log::Comment(disTextW);
     }
 
-    // CONSIDER: have the dia data source look for the part if passed a whole container.
+    // Load the debug module itself, rather than the debug lines part.
     CComPtr<IDiaDataSource> pDiaSource;
     CComPtr<IStream> pProgramStream;
     CComPtr<IDxcLibrary> pLib;
@@ -1754,6 +1797,14 @@ bool CompilerTest::InitSupport() {
   return true;
 }
 
+bool CompilerTest::BeginTiming() {
+  return hlsl_test::BeginTestTiming();
+}
+
+bool CompilerTest::EndTiming() {
+  return hlsl_test::EndTestTiming();
+}
+
 TEST_F(CompilerTest, CompileWhenDebugThenDIPresent) {
   // BUG: the first test written was of this form:
   // float4 local = 0; return local;
@@ -1882,6 +1933,259 @@ TEST_F(CompilerTest, CompileDebugLines) {
   CComBSTR pName;
   VERIFY_SUCCEEDED(pFile->get_fileName(&pName));
   VERIFY_ARE_EQUAL_WSTR(pName, L"source.hlsl");
+
+  // Verify lines by line number, including a line without code.
+  pEnumLineNumbers.Release();
+  VERIFY_SUCCEEDED(pSession->findLinesByLinenum(nullptr, pFile, 5, 0, &pEnumLineNumbers));
+  std::vector<LineNumber> linesByLinenum = ReadLineNumbers(pEnumLineNumbers);
+  VERIFY_ARE_EQUAL(linesByLinenum.size(), 2);
+  VERIFY_ARE_EQUAL(linesByLinenum[0].rva, 4);
+  VERIFY_ARE_EQUAL(linesByLinenum[1].rva, 5);
+  pEnumLineNumbers.Release();
+  VERIFY_SUCCEEDED(pSession->findLinesByLinenum(nullptr, pFile, 6, 0, &pEnumLineNumbers));
+  linesByLinenum = ReadLineNumbers(pEnumLineNumbers);
+  VERIFY_ARE_EQUAL(linesByLinenum.size(), 0);
+}
+
+TEST_F(CompilerTest, CompileDebugLinesWhenLineTablesOnly) {
+  const char *source =
+    "float main(float pos : A) : SV_Target {\r\n"
+    "  float x = abs(pos);\r\n"
+    "  float y = sin(pos);\r\n"
+    "  float z = x + y;\r\n"
+    "  return z;\r\n"
+    "}";
+  CComPtr<IDiaDataSource> pDiaSource;
+  VERIFY_SUCCEEDED(CreateDiaSourceForCompile(source, &pDiaSource, L"/Zi-lines"));
+
+  // Lines are the same as with /Zi.
+  CComPtr<IDiaSession> pSession;
+  CComPtr<IDiaEnumLineNumbers> pEnumLineNumbers;
+  VERIFY_SUCCEEDED(pDiaSource->openSession(&pSession));
+  VERIFY_SUCCEEDED(pSession->findLinesByRVA(0, 6, &pEnumLineNumbers));
+  std::vector<LineNumber> lines = ReadLineNumbers(pEnumLineNumbers);
+  VERIFY_ARE_EQUAL(lines.size(), 6);
+  const DWORD expectedLines[] = { 1, 2, 3, 4, 5, 5 };
+  for (unsigned i = 0; i < lines.size(); ++i) {
+    VERIFY_ARE_EQUAL(lines[i].rva, i);
+    VERIFY_ARE_EQUAL(lines[i].line, expectedLines[i]);
+  }
+
+  // Without variables and types, the debug module is smaller.
+  auto getDebugPartSize = [&](LPCWSTR debugArg) -> uint32_t {
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+    CreateBlobFromText(source, &pSource);
+    LPCWSTR args[] = { debugArg };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pContainer);
+    const hlsl::DxilPartHeader *pPart =
+        hlsl::GetDxilPartByType(pContainer, hlsl::DFCC_ShaderDebugInfoDXIL);
+    VERIFY_IS_NOT_NULL(pPart);
+    return pPart->PartSize;
+  };
+  VERIFY_IS_LESS_THAN(getDebugPartSize(L"/Zi-lines"), getDebugPartSize(L"/Zi"));
+}
+
+TEST_F(CompilerTest, CompileDebugLinesFromContainer) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "float main(float pos : A) : SV_Target {\r\n"
+    "  float x = abs(pos);\r\n"
+    "  return x;\r\n"
+    "}", &pSource);
+  LPCWSTR args[] = { L"/Zi" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+      pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+  VERIFY_IS_NOT_NULL(pContainer);
+  const hlsl::DxilPartHeader *pLinesPart =
+      hlsl::GetDxilPartByType(pContainer, hlsl::DFCC_ShaderDebugLines);
+  VERIFY_IS_NOT_NULL(pLinesPart);
+  VERIFY_IS_TRUE(hlsl::IsDxilDebugLinesValid(pLinesPart));
+
+  // Load the whole container; lines come from the debug lines part.
+  CComPtr<IDxcLibrary> pLib;
+  CComPtr<IStream> pProgramStream;
+  CComPtr<IDiaDataSource> pDiaSource;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLib));
+  VERIFY_SUCCEEDED(pLib->CreateStreamFromBlobReadOnly(pProgram, &pProgramStream));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcDiaDataSource, &pDiaSource));
+  VERIFY_SUCCEEDED(pDiaSource->loadDataFromIStream(pProgramStream));
+
+  CComPtr<IDiaSession> pSession;
+  CComPtr<IDiaEnumLineNumbers> pEnumLineNumbers;
+  VERIFY_SUCCEEDED(pDiaSource->openSession(&pSession));
+  VERIFY_SUCCEEDED(pSession->findLinesByRVA(0, 4, &pEnumLineNumbers));
+  std::vector<LineNumber> lines = ReadLineNumbers(pEnumLineNumbers);
+  // loadInput, abs, storeOutput, ret
+  VERIFY_ARE_EQUAL(lines.size(), 4);
+  VERIFY_ARE_EQUAL(lines[0].line, 1);
+  VERIFY_ARE_EQUAL(lines[1].line, 2);
+  VERIFY_ARE_EQUAL(lines[2].line, 3);
+  VERIFY_ARE_EQUAL(lines[3].rva, 3);
+
+  CComPtr<IDiaSourceFile> pFile;
+  CComPtr<IDiaEnumTables> pTables;
+  VERIFY_SUCCEEDED(pSession->getEnumTables(&pTables));
+  VERIFY_SUCCEEDED(pSession->findFileById(0, &pFile));
+  CComBSTR pName;
+  VERIFY_SUCCEEDED(pFile->get_fileName(&pName));
+  VERIFY_ARE_EQUAL_WSTR(pName, L"source.hlsl");
+
+  // Symbols still come from the debug module.
+  std::wstring diaDump = GetDebugInfoAsText(pDiaSource).c_str();
+  VERIFY_IS_NOT_NULL(wcsstr(diaDump.c_str(), L"CompilandEnv, name: hlslTarget, value: ps_6_0"));
+  VERIFY_IS_NOT_NULL(wcsstr(diaDump.c_str(), L"lineNumber: 2"));
+}
+
+class TestSourceProvider : public IDxcSourceProvider {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  CComPtr<IDxcLibrary> m_pLib;
+  CComPtr<IDxcBlob> m_pPack;
+  unsigned m_loads = 0;
+  TestSourceProvider(IDxcLibrary *pLib, IDxcBlob *pPack)
+      : m_dwRef(0), m_pLib(pLib), m_pPack(pPack) {}
+  __override HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) {
+    return DoBasicQueryInterface<IDxcSourceProvider>(this, iid, ppvObject);
+  }
+  __override HRESULT STDMETHODCALLTYPE LoadSource(const BYTE *pDigest,
+                                                  IDxcBlob **ppSource) {
+    *ppSource = nullptr;
+    ++m_loads;
+    uint8_t digest[hlsl::DxilContainerHashSize];
+    memcpy(digest, pDigest, sizeof(digest));
+    const hlsl::DxilShaderSourceHeader *pSource = hlsl::FindDxilShaderSource(
+        (const hlsl::DxilContainerHeader *)m_pPack->GetBufferPointer(), digest);
+    if (pSource == nullptr)
+      return S_OK;
+    UINT32 offset = (UINT32)(hlsl::GetDxilShaderSourceContent(pSource) -
+                             (const char *)m_pPack->GetBufferPointer());
+    return m_pLib->CreateBlobFromBlob(m_pPack, offset, pSource->ContentSize,
+                                      ppSource);
+  }
+};
+
+TEST_F(CompilerTest, CompileDebugSourcesWhenSourcePackThenProvided) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  const char *source =
+    "float main(float pos : A) : SV_Target {\r\n"
+    "  return abs(pos);\r\n"
+    "}";
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(source, &pSource);
+  LPCWSTR args[] = { L"/Zi", L"/Qsource_pack" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  // The pack holds the one source file.
+  CComPtr<IDxcSourcePack> pSourcePack;
+  CComPtr<IDxcBlob> pPack;
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pSourcePack));
+  VERIFY_ARE_EQUAL(S_OK, pSourcePack->GetSourcePack(&pPack));
+  const hlsl::DxilContainerHeader *pPackHeader = hlsl::IsDxilContainerLike(
+      pPack->GetBufferPointer(), pPack->GetBufferSize());
+  VERIFY_IS_NOT_NULL(pPackHeader);
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(pPackHeader, pPack->GetBufferSize()));
+  VERIFY_ARE_EQUAL(pPackHeader->PartCount, 1);
+  const hlsl::DxilPartHeader *pPart = hlsl::GetDxilContainerPart(pPackHeader, 0);
+  VERIFY_IS_TRUE(hlsl::IsDxilShaderSourceValid(pPart));
+  const hlsl::DxilShaderSourceHeader *pSourceHeader =
+      (const hlsl::DxilShaderSourceHeader *)hlsl::GetDxilPartData(pPart);
+  VERIFY_ARE_EQUAL(std::string(source),
+                   std::string(hlsl::GetDxilShaderSourceContent(pSourceHeader),
+                               pSourceHeader->ContentSize));
+
+  CComPtr<IDxcLibrary> pLib;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLib));
+  auto getInjectedSourceLength = [&](IDxcSourceProvider *pProvider) -> ULONGLONG {
+    CComPtr<IStream> pProgramStream;
+    CComPtr<IDiaDataSource> pDiaSource;
+    CComPtr<IDxcDiaSourceProviderSite> pSite;
+    CComPtr<IDiaSession> pSession;
+    CComPtr<IDiaEnumInjectedSources> pEnumInjectedSources;
+    CComPtr<IDiaInjectedSource> pInjectedSource;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcDiaDataSource, &pDiaSource));
+    VERIFY_SUCCEEDED(pDiaSource.QueryInterface(&pSite));
+    VERIFY_SUCCEEDED(pSite->SetSourceProvider(pProvider));
+    VERIFY_SUCCEEDED(pLib->CreateStreamFromBlobReadOnly(pProgram, &pProgramStream));
+    VERIFY_SUCCEEDED(pDiaSource->loadDataFromIStream(pProgramStream));
+    VERIFY_SUCCEEDED(pDiaSource->openSession(&pSession));
+    VERIFY_SUCCEEDED(pSession->findInjectedSource(L"source.hlsl", &pEnumInjectedSources));
+    VERIFY_SUCCEEDED(pEnumInjectedSources->Item(0, &pInjectedSource));
+    ULONGLONG length;
+    VERIFY_SUCCEEDED(pInjectedSource->get_length(&length));
+    return length;
+  };
+
+  // The debug info only has the digest, which the provider resolves.
+  VERIFY_ARE_EQUAL(getInjectedSourceLength(nullptr), 0);
+  CComPtr<TestSourceProvider> pProvider = new TestSourceProvider(pLib, pPack);
+  VERIFY_ARE_EQUAL(getInjectedSourceLength(pProvider), strlen(source));
+  VERIFY_ARE_EQUAL(pProvider->m_loads, 1);
+}
+
+TEST_F(CompilerTest, AssembleWhenBitcodeThenProgramBitcodeKept) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pBitcode;
+  CComPtr<IDxcBlob> pContainer;
+  CComPtr<IDxcLibrary> pLib;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float main(float pos : A) : SV_Target { return abs(pos); }",
+                     &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  auto getProgramBitcode = [](IDxcBlob *pBlob) -> std::string {
+    const hlsl::DxilContainerHeader *pHeader = hlsl::IsDxilContainerLike(
+        pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pHeader);
+    const hlsl::DxilPartHeader *pPart =
+        hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_DXIL);
+    VERIFY_IS_NOT_NULL(pPart);
+    const char *pBitcode;
+    uint32_t bitcodeLength;
+    hlsl::GetDxilProgramBitcode(
+        (const hlsl::DxilProgramHeader *)hlsl::GetDxilPartData(pPart),
+        &pBitcode, &bitcodeLength);
+    return std::string(pBitcode, bitcodeLength);
+  };
+  std::string bitcode = getProgramBitcode(pProgram);
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLib));
+  CComPtr<IDxcBlobEncoding> pBitcodeBlob;
+  VERIFY_SUCCEEDED(pLib->CreateBlobWithEncodingOnHeapCopy(
+      bitcode.data(), bitcode.size(), CP_ACP, &pBitcodeBlob));
+
+  // The module needs no validator upgrade, so the bitcode isn't written again.
+  AssembleToContainer(m_dllSupport, pBitcodeBlob, &pContainer);
+  VERIFY_IS_TRUE(getProgramBitcode(pContainer) == bitcode);
 }
 
 TEST_F(CompilerTest, CompileWhenDefinesThenApplied) {
@@ -2076,6 +2380,65 @@ TEST_F(CompilerTest, CompileWhenDebugWorksThenStripDebug) {
   VERIFY_IS_NULL(pPartHeader);
 }
 
+TEST_F(CompilerTest, CompileWhenSidecarThenDebugPartsSplit) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler2> pCompiler2;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pSidecar;
+  CComHeapPtr<WCHAR> pDebugName;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompiler2));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  float4 local = abs(pos);\r\n"
+                     "  return local;\r\n"
+                     "}",
+                     &pSource);
+  LPCWSTR args[] = {L"/Zi", L"/Qsidecar", L"/Qembed_hash"};
+
+  VERIFY_SUCCEEDED(pCompiler2->CompileWithDebug(
+      pSource, L"source.hlsl", L"main", L"ps_6_0", args, _countof(args),
+      nullptr, 0, nullptr, &pResult, &pDebugName, &pSidecar));
+  HRESULT hrStatus;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&hrStatus));
+  VERIFY_SUCCEEDED(hrStatus);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  VERIFY_IS_NOT_NULL(pSidecar.p);
+
+  // The shader has no debug info, but keeps its name and hash.
+  const hlsl::DxilContainerHeader *pHeader =
+      (hlsl::DxilContainerHeader *)(pProgram->GetBufferPointer());
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(pHeader, pProgram->GetBufferSize()));
+  VERIFY_IS_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderDebugInfoDXIL));
+  VERIFY_IS_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderDebugLines));
+  VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderDebugName));
+  const hlsl::DxilPartHeader *pHashPart =
+      hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderHash);
+  VERIFY_IS_NOT_NULL(pHashPart);
+
+  // The sidecar has the debug parts, and the same name and hash.
+  const hlsl::DxilContainerHeader *pSidecarHeader =
+      (hlsl::DxilContainerHeader *)(pSidecar->GetBufferPointer());
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(pSidecarHeader, pSidecar->GetBufferSize()));
+  VERIFY_IS_NULL(hlsl::GetDxilPartByType(pSidecarHeader, hlsl::DFCC_DXIL));
+  VERIFY_IS_NOT_NULL(hlsl::GetDxilProgramHeader(pSidecarHeader, hlsl::DFCC_ShaderDebugInfoDXIL));
+  VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pSidecarHeader, hlsl::DFCC_ShaderDebugLines));
+  const char *pName, *pSidecarName;
+  VERIFY_IS_TRUE(hlsl::GetDxilShaderDebugName(
+      hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderDebugName), &pName, nullptr));
+  VERIFY_IS_TRUE(hlsl::GetDxilShaderDebugName(
+      hlsl::GetDxilPartByType(pSidecarHeader, hlsl::DFCC_ShaderDebugName), &pSidecarName, nullptr));
+  VERIFY_ARE_EQUAL_STR(pName, pSidecarName);
+  const hlsl::DxilPartHeader *pSidecarHashPart =
+      hlsl::GetDxilPartByType(pSidecarHeader, hlsl::DFCC_ShaderHash);
+  VERIFY_IS_NOT_NULL(pSidecarHashPart);
+  VERIFY_ARE_EQUAL(0, memcmp(hlsl::GetDxilPartData(pHashPart),
+                             hlsl::GetDxilPartData(pSidecarHashPart),
+                             sizeof(hlsl::DxilShaderHash)));
+}
+
 TEST_F(CompilerTest, CompileWhenWorksThenAddRemovePrivate) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2249,6 +2612,235 @@ TEST_F(CompilerTest, CompileWithRootSignatureThenStripRootSignature) {
   VERIFY_IS_NULL(pPartHeader);
 }
 
+TEST_F(CompilerTest, CompileWhenRootSignatureSharedThenEachShaderVerified) {
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+
+  // The root signature is interned after the first compile; the shader
+  // binding b1 must still be checked against it.
+  LPCSTR pSources[] = {
+    "[RootSignature(\"CBV(b0)\")] \r\n"
+    "cbuffer C : register(b0) { float4 v; };\r\n"
+    "float4 main() : SV_Target { return v; }",
+    "[RootSignature(\"CBV(b0)\")] \r\n"
+    "cbuffer C : register(b1) { float4 v; };\r\n"
+    "float4 main() : SV_Target { return v; }",
+    "[RootSignature(\"CBV(b0)\")] \r\n"
+    "cbuffer C : register(b0) { float4 w; };\r\n"
+    "float4 main() : SV_Target { return w * 2; }",
+  };
+  bool expectSuccess[] = { true, false, true };
+  CComPtr<IDxcBlob> pPrograms[_countof(pSources)];
+  for (unsigned i = 0; i < _countof(pSources); ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CreateBlobFromText(pSources[i], &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_ARE_EQUAL(expectSuccess[i], SUCCEEDED(status));
+    if (expectSuccess[i])
+      VERIFY_SUCCEEDED(pResult->GetResult(&pPrograms[i]));
+  }
+
+  hlsl::DxilPartHeader *pParts[2] = {
+    hlsl::GetDxilPartByType(
+        (hlsl::DxilContainerHeader *)pPrograms[0]->GetBufferPointer(),
+        hlsl::DxilFourCC::DFCC_RootSignature),
+    hlsl::GetDxilPartByType(
+        (hlsl::DxilContainerHeader *)pPrograms[2]->GetBufferPointer(),
+        hlsl::DxilFourCC::DFCC_RootSignature),
+  };
+  VERIFY_IS_NOT_NULL(pParts[0]);
+  VERIFY_IS_NOT_NULL(pParts[1]);
+  VERIFY_ARE_EQUAL(pParts[0]->PartSize, pParts[1]->PartSize);
+  VERIFY_ARE_EQUAL(0, memcmp(hlsl::GetDxilPartData(pParts[0]),
+                             hlsl::GetDxilPartData(pParts[1]),
+                             pParts[0]->PartSize));
+}
+
+TEST_F(CompilerTest, CompileWhenExtendedPSVThenInputLayoutAndHashesEmitted) {
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+
+  // The second shader only differs in its program, the third only in a
+  // binding.
+  LPCSTR pSources[] = {
+    "cbuffer C : register(b0) { float4 v; };\r\n"
+    "float4 main(float4 pos : POSITION, float2 uv[2] : TEXCOORD1,\r\n"
+    "            uint id : SV_VertexID) : SV_Position {\r\n"
+    "  return pos * v + uv[0].xyxy + uv[1].xyxy + id; }",
+    "cbuffer C : register(b0) { float4 v; };\r\n"
+    "float4 main(float4 pos : POSITION, float2 uv[2] : TEXCOORD1,\r\n"
+    "            uint id : SV_VertexID) : SV_Position {\r\n"
+    "  return pos * v - uv[0].xyxy + uv[1].xyxy + id; }",
+    "cbuffer C : register(b1) { float4 v; };\r\n"
+    "float4 main(float4 pos : POSITION, float2 uv[2] : TEXCOORD1,\r\n"
+    "            uint id : SV_VertexID) : SV_Position {\r\n"
+    "  return pos * v + uv[0].xyxy + uv[1].xyxy + id; }",
+  };
+  LPCWSTR args[] = { L"-psv_extended" };
+  CComPtr<IDxcBlob> pPrograms[_countof(pSources)];
+  PSVRuntimeInfo2 infos[_countof(pSources)];
+  for (unsigned i = 0; i < _countof(pSources); ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CreateBlobFromText(pSources[i], &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"vs_6_0", args, _countof(args),
+                                        nullptr, 0, nullptr, &pResult));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pPrograms[i]));
+
+    hlsl::DxilPartHeader *pPart = hlsl::GetDxilPartByType(
+        (hlsl::DxilContainerHeader *)pPrograms[i]->GetBufferPointer(),
+        hlsl::DxilFourCC::DFCC_PipelineStateValidation);
+    VERIFY_IS_NOT_NULL(pPart);
+    DxilPipelineStateValidation PSV;
+    VERIFY_IS_TRUE(PSV.InitFromPSV0(hlsl::GetDxilPartData(pPart),
+                                    pPart->PartSize));
+    VERIFY_IS_NOT_NULL(PSV.GetPSVRuntimeInfo2());
+    infos[i] = *PSV.GetPSVRuntimeInfo2();
+
+    // SV_VertexID is generated, not fetched.
+    VERIFY_ARE_EQUAL(3, PSV.GetInputLayoutElements());
+    const char *pNames[] = { "POSITION", "TEXCOORD", "TEXCOORD" };
+    uint32_t indexes[] = { 0, 1, 2 };
+    uint32_t cols[] = { 4, 2, 2 };
+    for (uint32_t e = 0; e < 3; ++e) {
+      PSVInputLayoutElement0 *pElement = PSV.GetInputLayoutElement0(e);
+      VERIFY_IS_NOT_NULL(pElement);
+      VERIFY_ARE_EQUAL(0, strcmp(pNames[e], PSV.GetStringTable().Get(
+                                                pElement->SemanticName)));
+      VERIFY_ARE_EQUAL(indexes[e], pElement->SemanticIndex);
+      VERIFY_ARE_EQUAL(cols[e], (uint32_t)(pElement->ColsAndStart & 0xF));
+    }
+  }
+
+  VERIFY_ARE_NOT_EQUAL(0, memcmp(infos[0].ShaderHash, infos[1].ShaderHash,
+                                 sizeof(infos[0].ShaderHash)));
+  VERIFY_ARE_EQUAL(0, memcmp(infos[0].ResourceBindingHash,
+                             infos[1].ResourceBindingHash,
+                             sizeof(infos[0].ResourceBindingHash)));
+  VERIFY_ARE_NOT_EQUAL(0, memcmp(infos[0].ResourceBindingHash,
+                                 infos[2].ResourceBindingHash,
+                                 sizeof(infos[0].ResourceBindingHash)));
+  for (unsigned i = 1; i < _countof(pSources); ++i) {
+    VERIFY_ARE_EQUAL(0, memcmp(infos[0].InputLayoutHash,
+                               infos[i].InputLayoutHash,
+                               sizeof(infos[0].InputLayoutHash)));
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenEmbedHashThenResultHasShaderHash) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 1; }", &pSource);
+
+  LPCWSTR noHashArgs[] = { L"/Zi" };
+  LPCWSTR hashArgs[] = { L"/Qembed_hash", L"/Zi" };
+  CComPtr<IDxcBlob> pPrograms[2];
+  DxcShaderHash hashes[2];
+  HRESULT hashHRs[2];
+  for (unsigned i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", i ? hashArgs : noHashArgs,
+                                        i ? _countof(hashArgs) : _countof(noHashArgs),
+                                        nullptr, 0, nullptr, &pResult));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pPrograms[i]));
+    CComPtr<IDxcShaderHash> pShaderHash;
+    VERIFY_SUCCEEDED(pResult.QueryInterface(&pShaderHash));
+    hashHRs[i] = pShaderHash->GetShaderHash(&hashes[i]);
+  }
+  VERIFY_ARE_EQUAL(S_FALSE, hashHRs[0]);
+  VERIFY_ARE_EQUAL(S_OK, hashHRs[1]);
+
+  // The hash computed during assembly matches one computed from the
+  // container.
+  hlsl::DxilShaderHash expected;
+  hlsl::ComputeDxilShaderHash(
+      (const hlsl::DxilContainerHeader *)pPrograms[1]->GetBufferPointer(),
+      &expected);
+  VERIFY_ARE_EQUAL(0, memcmp(expected.Digest, hashes[1].HashDigest,
+                             sizeof(expected.Digest)));
+
+  // Stripping debug information keeps the hash.
+  CComPtr<IDxcContainerBuilder> pBuilder;
+  CComPtr<IDxcOperationResult> pStripResult;
+  VERIFY_SUCCEEDED(CreateContainerBuilder(&pBuilder));
+  VERIFY_SUCCEEDED(pBuilder->Load(pPrograms[1]));
+  VERIFY_SUCCEEDED(pBuilder->RemovePart(hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pStripResult));
+  CComPtr<IDxcShaderHash> pStripHash;
+  VERIFY_SUCCEEDED(pStripResult.QueryInterface(&pStripHash));
+  DxcShaderHash strippedHash;
+  VERIFY_ARE_EQUAL(S_OK, pStripHash->GetShaderHash(&strippedHash));
+  VERIFY_ARE_EQUAL(0, memcmp(hashes[1].HashDigest, strippedHash.HashDigest,
+                             sizeof(strippedHash.HashDigest)));
+}
+
+TEST_F(CompilerTest, CompileWithArgsWhenDefinesAddedThenMatchesCompile) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompilerWithArgs> pCompilerWithArgs;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCompilerWithArgs));
+  CreateBlobFromText("float4 main() : SV_Target { return BASE + VALUE; }",
+                     &pSource);
+
+  // Invalid arguments are reported when the arguments are created.
+  LPCWSTR badArgs[] = { L"/not_an_option" };
+  CComPtr<IDxcCompilerArgs> pBadArgs;
+  CComPtr<IDxcBlobEncoding> pErrors;
+  VERIFY_ARE_EQUAL(E_INVALIDARG,
+                   pCompilerWithArgs->CreateArgs(L"ps_6_0", badArgs,
+                                                 _countof(badArgs), nullptr, 0,
+                                                 &pBadArgs, &pErrors));
+  VERIFY_IS_NULL(pBadArgs.p);
+  VERIFY_IS_NOT_NULL(pErrors.p);
+
+  LPCWSTR args[] = { L"/O3", L"-DBASE=1" };
+  CComPtr<IDxcCompilerArgs> pArgs;
+  VERIFY_SUCCEEDED(pCompilerWithArgs->CreateArgs(
+      L"ps_6_0", args, _countof(args), nullptr, 0, &pArgs, nullptr));
+
+  // Each permutation matches a compile that reads all arguments again.
+  LPCWSTR values[] = { L"2", L"3" };
+  for (LPCWSTR value : values) {
+    DxcDefine define = { L"VALUE", value };
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompilerWithArgs->CompileWithArgs(
+        pSource, L"source.hlsl", L"main", pArgs, &define, 1, nullptr,
+        &pResult));
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+    CComPtr<IDxcOperationResult> pExpectedResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", args, _countof(args),
+                                        &define, 1, nullptr,
+                                        &pExpectedResult));
+    CComPtr<IDxcBlob> pExpected;
+    VERIFY_SUCCEEDED(pExpectedResult->GetResult(&pExpected));
+    VERIFY_ARE_EQUAL(pExpected->GetBufferSize(), pProgram->GetBufferSize());
+    VERIFY_ARE_EQUAL(0, memcmp(pExpected->GetBufferPointer(),
+                               pProgram->GetBufferPointer(),
+                               pProgram->GetBufferSize()));
+  }
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeThenLoadInvoked) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2263,195 +2855,1169 @@ TEST_F(CompilerTest, CompileWhenIncludeThenLoadInvoked) {
   pInclude = new TestIncludeHandler(m_dllSupport);
   pInclude->CallResults.emplace_back("");
 
-  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
-    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
-  VerifyOperationSucceeded(pResult);
-  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeThenDependencyFileListsIt) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"my helper.h\"\r\n"
+    "float4 main() : SV_Target { return 0; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("");
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+
+  CComPtr<IDxcIncludeDependencies> pDependencies;
+  CComPtr<IDxcBlobEncoding> pDependencyFile;
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pDependencies));
+  VERIFY_ARE_EQUAL(S_OK, pDependencies->GetDependencyFile(L"out $1.cso",
+                                                          &pDependencyFile));
+  VERIFY_ARE_EQUAL_STR("out\\ $$1.cso: \\\n"
+                       "  source.hlsl \\\n"
+                       "  ./my\\ helper.h\n",
+                       BlobToUtf8(pDependencyFile).c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeThenLoadUsed) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeAbsoluteThenLoadAbsolute) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"C:\\helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL_WSTR(L"C:\\helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeLocalThenLoadRelative) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"..\\helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL_WSTR(L"./..\\helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeSystemThenLoadNotRelative) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"subdir/other/file.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  LPCWSTR args[] = {
+    L"-Ifoo"
+  };
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#include <helper.h>");
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL_WSTR(L"./subdir/other/file.h;./foo\\helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeSystemMissingThenLoadAttempt) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"subdir/other/file.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#include <helper.h>");
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  std::string failLog(VerifyOperationFailed(pResult));
+  VERIFY_ARE_NOT_EQUAL(std::string::npos, failLog.find("<angled>")); // error message should prompt to use <angled> rather than "quotes"
+  VERIFY_ARE_EQUAL_WSTR(L"./subdir/other/file.h;./subdir/other/helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeFlagsThenIncludeUsed) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include <helper.h>\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+
+  LPCWSTR args[] = {
+    L"-I\\\\server\\share"
+  };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL_WSTR(L"\\\\server\\share\\helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeMissingThenFail) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"file.h\"\r\n"
+    "float4 main() : SV_Target { return 0; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  HRESULT hr;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&hr));
+  VERIFY_FAILED(hr);
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeHasPathThenOK) {
+  CComPtr<IDxcCompiler> pCompiler;
+  LPCWSTR Source = L"c:\\temp\\OddIncludes\\main.hlsl";
+  LPCWSTR Args[] = { L"/I", L"c:\\temp" };
+  LPCWSTR ArgsUp[] = { L"/I", L"c:\\Temp" };
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  bool useUpValues[] = { false, true };
+  for (bool useUp : useUpValues) {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlobEncoding> pSource;
+#if TEST_ON_DISK
+    CComPtr<IDxcLibrary> pLibrary;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+    VERIFY_SUCCEEDED(pLibrary->CreateIncludeHandler(&pInclude));
+    VERIFY_SUCCEEDED(pLibrary->CreateBlobFromFile(Source, nullptr, &pSource));
+#else
+    CComPtr<TestIncludeHandler> pInclude;
+    pInclude = new TestIncludeHandler(m_dllSupport);
+    pInclude->CallResults.emplace_back("// Empty");
+    CreateBlobFromText("#include \"include.hlsl\"\r\n"
+                       "float4 main() : SV_Target { return 0; }",
+                       &pSource);
+#endif
+
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, Source, L"main",
+      L"ps_6_0", useUp ? ArgsUp : Args, _countof(Args), nullptr, 0, pInclude, &pResult));
+    HRESULT hr;
+    VERIFY_SUCCEEDED(pResult->GetStatus(&hr));
+    VERIFY_SUCCEEDED(hr);
+ }
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeSpelledDifferentlyThenPragmaOnceHolds) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"inc/helper.h\"\r\n"
+    "#include \"./inc/../inc\\helper.h\"\r\n"
+    "float4 main() : SV_Target { return zero(); }", &pSource);
+
+  // The second spelling is the same file, so it isn't loaded again and
+  // zero isn't redefined.
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(
+    "#pragma once\r\n"
+    "float zero() { return 0; }");
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL(1, pInclude->CallInfos.size());
+}
+
+static const char EmptyCompute[] = "[numthreads(8,8,1)] void main() { }";
+
+static void DeleteCacheDir(const std::wstring &dir) {
+  WIN32_FIND_DATAW findData;
+  HANDLE hFind = FindFirstFileW((dir + L"\\*").c_str(), &findData);
+  if (hFind != INVALID_HANDLE_VALUE) {
+    do {
+      if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        DeleteFileW((dir + L"\\" + findData.cFileName).c_str());
+    } while (FindNextFileW(hFind, &findData));
+    FindClose(hFind);
+  }
+  RemoveDirectoryW(dir.c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenCacheDirThenResultReused) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  wchar_t tempPath[MAX_PATH];
+  VERIFY_IS_TRUE(GetTempPathW(_countof(tempPath), tempPath) != 0);
+  std::wstring cacheDir(tempPath);
+  cacheDir += L"dxc-cache-test-";
+  cacheDir += std::to_wstring(GetCurrentProcessId());
+  DeleteCacheDir(cacheDir);
+  LPCWSTR args[] = { L"-cache-dir", cacheDir.c_str() };
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+  pInclude->CallResults.emplace_back("#define ZERO 1");
+  pInclude->CallResults.emplace_back("#define ZERO 1");
+
+  auto compile = [&](IDxcBlob **ppProgram) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args, _countof(args), nullptr, 0, pInclude, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(ppProgram));
+  };
+
+  // First compilation populates the cache.
+  CComPtr<IDxcBlob> pFirst;
+  compile(&pFirst);
+  VERIFY_ARE_EQUAL(1, pInclude->CallInfos.size());
+
+  // Second compilation only reloads the include to check its contents.
+  CComPtr<IDxcBlob> pSecond;
+  compile(&pSecond);
+  VERIFY_ARE_EQUAL(2, pInclude->CallInfos.size());
+  VERIFY_ARE_EQUAL(pFirst->GetBufferSize(), pSecond->GetBufferSize());
+  VERIFY_ARE_EQUAL(0, memcmp(pFirst->GetBufferPointer(),
+                             pSecond->GetBufferPointer(),
+                             pFirst->GetBufferSize()));
+
+  // A changed include misses the cache and compiles again.
+  CComPtr<IDxcBlob> pThird;
+  compile(&pThird);
+  VERIFY_ARE_EQUAL(4, pInclude->CallInfos.size());
+
+  DeleteCacheDir(cacheDir);
+}
+
+TEST_F(CompilerTest, CompileBatchWhenTwoEntriesThenBothSucceed) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompilerBatch> pBatch;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pBatch));
+  CreateBlobFromText(
+      "float4 shared(float4 v) { return v * 2; }\r\n"
+      "float4 VSMain(float4 p : POSITION) : SV_Position { return shared(p); }\r\n"
+      "float4 PSMain(float4 p : SV_Position) : SV_Target { return shared(p.yxzw); }",
+      &pSource);
+
+  LPCWSTR entries[] = { L"VSMain", L"PSMain" };
+  LPCWSTR profiles[] = { L"vs_6_0", L"ps_6_0" };
+  IDxcOperationResult *ppResults[2] = { nullptr, nullptr };
+  VERIFY_SUCCEEDED(pBatch->CompileBatch(pSource, L"source.hlsl", 2, entries,
+                                        profiles, nullptr, 0, nullptr, 0,
+                                        nullptr, ppResults));
+  CComPtr<IDxcOperationResult> pVSResult, pPSResult;
+  pVSResult.Attach(ppResults[0]);
+  pPSResult.Attach(ppResults[1]);
+  VerifyOperationSucceeded(pVSResult);
+  VerifyOperationSucceeded(pPSResult);
+
+  CComPtr<IDxcBlob> pVSProgram, pPSProgram;
+  VERIFY_SUCCEEDED(pVSResult->GetResult(&pVSProgram));
+  VERIFY_SUCCEEDED(pPSResult->GetResult(&pPSProgram));
+  CComPtr<IDxcBlobEncoding> pVSText, pPSText;
+  VERIFY_SUCCEEDED(pCompiler->Disassemble(pVSProgram, &pVSText));
+  VERIFY_SUCCEEDED(pCompiler->Disassemble(pPSProgram, &pPSText));
+  std::string vsText(BlobToUtf8(pVSText)), psText(BlobToUtf8(pPSText));
+  VERIFY_IS_TRUE(vsText.find("@VSMain") != std::string::npos);
+  VERIFY_IS_TRUE(vsText.find("@PSMain") == std::string::npos);
+  VERIFY_IS_TRUE(psText.find("@PSMain") != std::string::npos);
+  VERIFY_IS_TRUE(psText.find("@VSMain") == std::string::npos);
+}
+
+TEST_F(CompilerTest, DisassembleFunctionWhenNamedThenOnlyThatFunction) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcFunctionDisassembler> pDisassembler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pDisassembler));
+  CreateBlobFromText(
+      "export float4 Scale(float4 v) { return v * 2; }\r\n"
+      "export float4 Bias(float4 v) { return v + 1; }",
+      &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"",
+                                      L"lib_6_3", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  CComPtr<IDxcBlobEncoding> pFullText;
+  VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pFullText));
+  std::string fullText(BlobToUtf8(pFullText));
+  // Library functions have mangled names; find them by their HLSL names.
+  auto findDefinedName = [&](const char *pHlslName) {
+    for (size_t pos = fullText.find("define "); pos != std::string::npos;
+         pos = fullText.find("define ", pos + 1)) {
+      size_t at = fullText.find('@', pos);
+      std::string name = fullText.substr(at + 1, fullText.find('(', at) - at - 1);
+      if (name.find(pHlslName) != std::string::npos)
+        return name;
+    }
+    return std::string();
+  };
+  std::string scaleName(findDefinedName("Scale"));
+  std::string biasName(findDefinedName("Bias"));
+  VERIFY_IS_FALSE(scaleName.empty());
+  VERIFY_IS_FALSE(biasName.empty());
+
+  CComPtr<IDxcBlobEncoding> pText;
+  CA2W wideScaleName(scaleName.c_str(), CP_UTF8);
+  VERIFY_SUCCEEDED(pDisassembler->DisassembleFunction(pProgram, wideScaleName,
+                                                      &pText));
+  std::string text(BlobToUtf8(pText));
+  VERIFY_IS_TRUE(text.find("@" + scaleName + "(") != std::string::npos);
+  VERIFY_IS_TRUE(text.find("@" + biasName + "(") == std::string::npos);
+  VERIFY_IS_TRUE(text.find("declare ") == std::string::npos);
+
+  CComPtr<IDxcBlobEncoding> pMissing;
+  VERIFY_ARE_EQUAL(E_INVALIDARG, pDisassembler->DisassembleFunction(
+                                     pProgram, L"NoSuchFunction", &pMissing));
+}
+
+TEST_F(CompilerTest, CompileWhenYcThenPretokenizedHeaderProduced) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#define SCALE 2\r\n"
+    "float4 Scale(float4 v) { return v * SCALE; }", &pSource);
+
+  LPCWSTR args[] = { L"/Yc" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"prelude.hlsli", L"main",
+                                      L"ps_6_0", args, _countof(args),
+                                      nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pTokenCache;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pTokenCache));
+  VERIFY_IS_TRUE(pTokenCache->GetBufferSize() > sizeof("cfe-pth"));
+  VERIFY_ARE_EQUAL(0, memcmp(pTokenCache->GetBufferPointer(), "cfe-pth",
+                             sizeof("cfe-pth")));
+}
+
+TEST_F(CompilerTest, CompileWhenIncludeCacheThenIncludeLoadedOnce) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcIncludeCache> pCache;
+  CComPtr<TestIncludeHandler> pInclude;
+  CComPtr<IDxcIncludeHandler> pCachingInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcIncludeCache, &pCache));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+  pInclude->CallResults.emplace_back("#define ZERO 0");
+  VERIFY_SUCCEEDED(pCache->CreateIncludeHandler(pInclude, &pCachingInclude));
+
+  auto compile = [&]() {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", nullptr, 0, nullptr, 0, pCachingInclude, &pResult));
+    VerifyOperationSucceeded(pResult);
+  };
+
+  // The second compilation is served from the cache.
+  compile();
+  compile();
+  VERIFY_ARE_EQUAL(1, pInclude->CallInfos.size());
+
+  // Clearing the cache loads the include again.
+  VERIFY_SUCCEEDED(pCache->Clear());
+  compile();
+  VERIFY_ARE_EQUAL(2, pInclude->CallInfos.size());
+}
+
+// Serves one file from the inc search directory; every other path fails.
+class SearchDirIncludeHandler : public TestIncludeHandler {
+public:
+  SearchDirIncludeHandler(dxc::DxcDllSupport &dllSupport)
+      : TestIncludeHandler(dllSupport) {}
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+      _In_ LPCWSTR pFilename, _COM_Outptr_ IDxcBlob **ppIncludeSource) {
+    CallInfos.push_back(LoadSourceCallInfo(pFilename));
+    *ppIncludeSource = nullptr;
+    std::wstring name(pFilename);
+    if (name.find(L"inc") == std::wstring::npos ||
+        name.find(L"helper.h") == std::wstring::npos)
+      return E_FAIL;
+    Utf8ToBlob(m_dllSupport, "#define ZERO 0", ppIncludeSource);
+    return S_OK;
+  }
+};
+
+TEST_F(CompilerTest, CompileWhenIncludeCacheThenMissesProbedOnce) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcIncludeCache> pCache;
+  CComPtr<SearchDirIncludeHandler> pInclude;
+  CComPtr<IDxcIncludeHandler> pCachingInclude;
+  LPCWSTR Args[] = { L"/I", L"missing", L"/I", L"inc" };
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcIncludeCache, &pCache));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  pInclude = new SearchDirIncludeHandler(m_dllSupport);
+  VERIFY_SUCCEEDED(pCache->CreateIncludeHandler(pInclude, &pCachingInclude));
+
+  auto compile = [&]() {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", Args, _countof(Args), nullptr, 0, pCachingInclude, &pResult));
+    VerifyOperationSucceeded(pResult);
+  };
+
+  // Each path is asked for once, whether or not the handler has it.
+  compile();
+  std::set<std::wstring> names;
+  for (const auto &info : pInclude->CallInfos)
+    names.insert(info.Filename);
+  VERIFY_IS_TRUE(pInclude->CallInfos.size() > 1);
+  VERIFY_ARE_EQUAL(names.size(), pInclude->CallInfos.size());
+
+  // A later compilation finds the misses and the hit in the cache.
+  size_t callCount = pInclude->CallInfos.size();
+  compile();
+  VERIFY_ARE_EQUAL(callCount, pInclude->CallInfos.size());
+}
+
+TEST_F(CompilerTest, CompileWhenTimeReportThenJsonProduced) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+
+  // Without -ftime-report, there is no report.
+  {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcTimeReport> pTimeReport;
+    CComPtr<IDxcBlobEncoding> pReport;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeReport));
+    VERIFY_SUCCEEDED(pTimeReport->GetTimeReport(&pReport));
+    VERIFY_IS_NULL(pReport.p);
+  }
+
+  LPCWSTR args[] = { L"-ftime-report" };
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcTimeReport> pTimeReport;
+  CComPtr<IDxcBlobEncoding> pReport;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args),
+                                      nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeReport));
+  VERIFY_SUCCEEDED(pTimeReport->GetTimeReport(&pReport));
+  VERIFY_IS_NOT_NULL(pReport.p);
+  std::string report = BlobToUtf8(pReport);
+  VERIFY_IS_TRUE(report.find("\"name\": \"frontend\"") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("\"phase\": \"optimizer\"") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("\"name\": \"validation\"") != std::string::npos);
+  VERIFY_IS_TRUE(report.find("\"name\": \"validate-functions\"") != std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWhenTimeTraceThenTraceEventsProduced) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+
+  // -ftime-trace alone doesn't produce a time report.
+  LPCWSTR args[] = { L"-ftime-trace" };
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcTimeReport> pTimeReport;
+  CComPtr<IDxcTimeTrace> pTimeTrace;
+  CComPtr<IDxcBlobEncoding> pReport;
+  CComPtr<IDxcBlobEncoding> pTrace;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args),
+                                      nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeReport));
+  VERIFY_SUCCEEDED(pTimeReport->GetTimeReport(&pReport));
+  VERIFY_IS_NULL(pReport.p);
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeTrace));
+  VERIFY_SUCCEEDED(pTimeTrace->GetTimeTrace(&pTrace));
+  VERIFY_IS_NOT_NULL(pTrace.p);
+  std::string trace = BlobToUtf8(pTrace);
+  VERIFY_IS_TRUE(trace.find("\"traceEvents\"") != std::string::npos);
+  VERIFY_IS_TRUE(trace.find("\"source.hlsl (main)\"") != std::string::npos);
+  VERIFY_IS_TRUE(trace.find("\"name\": \"codegen\", \"cat\": \"phase\"") !=
+                 std::string::npos);
+  VERIFY_IS_TRUE(trace.find("\"name\": \"validate-module\"") !=
+                 std::string::npos);
+  VERIFY_IS_TRUE(trace.find("\"cat\": \"pass\"") != std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWhenPrintIRStatsThenTableProduced) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+      "float4 main(float4 a : A) : SV_Target { return a * 2; }", &pSource);
+
+  LPCWSTR args[] = { L"-print-ir-stats" };
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcIRStats> pIRStats;
+  CComPtr<IDxcBlobEncoding> pStats;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args),
+                                      nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pIRStats));
+  VERIFY_SUCCEEDED(pIRStats->GetIRStats(&pStats));
+  VERIFY_IS_NOT_NULL(pStats.p);
+  std::string stats = BlobToUtf8(pStats);
+  VERIFY_IS_TRUE(stats.find("instructions") != std::string::npos);
+  // Module passes are listed by name, function passes with the function.
+  VERIFY_IS_TRUE(stats.find("  SROA Parameter HLSL\n") != std::string::npos);
+  VERIFY_IS_TRUE(stats.find(" (main)\n") != std::string::npos);
+}
+
+TEST_F(CompilerTest, CompileWhenAllocStatsThenCountsProduced) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+
+  // Without -falloc-stats, there are no statistics.
+  DxcAllocationStats stats;
+  {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcAllocationStats> pAllocationStats;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult.QueryInterface(&pAllocationStats));
+    VERIFY_ARE_EQUAL(S_FALSE, pAllocationStats->GetAllocationStats(&stats));
+    VERIFY_IS_TRUE(stats.AllocCount == 0);
+  }
+
+  LPCWSTR args[] = { L"-falloc-stats" };
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcAllocationStats> pAllocationStats;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args),
+                                      nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pAllocationStats));
+  VERIFY_ARE_EQUAL(S_OK, pAllocationStats->GetAllocationStats(&stats));
+  VERIFY_IS_TRUE(stats.AllocCount > 0);
+  VERIFY_IS_TRUE(stats.AllocBytes >= stats.AllocCount);
+  VERIFY_IS_TRUE(stats.PeakBytes > 0);
+  UINT64 classTotal = 0;
+  for (UINT64 count : stats.SizeClassCounts)
+    classTotal += count;
+  VERIFY_ARE_EQUAL(stats.AllocCount, classTotal);
+}
+
+TEST_F(CompilerTest, CompileWhenSessionThenMatchesCompiler) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler> pSession;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompilerSession, &pSession));
+  CreateBlobFromText("float4 main(float4 a : A) : SV_Target { return a * 2; }", &pSource);
+
+  auto compileToText = [&](IDxcCompiler *pC) {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(pC->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                                 nullptr, 0, nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    return DisassembleProgram(m_dllSupport, pProgram);
+  };
+
+  // The session keeps its state across compilations.
+  std::string expected = compileToText(pCompiler);
+  VERIFY_ARE_EQUAL_STR(expected.c_str(), compileToText(pSession).c_str());
+  VERIFY_ARE_EQUAL_STR(expected.c_str(), compileToText(pSession).c_str());
+}
+
+TEST_F(CompilerTest, CompileWhenSessionSharedByThreadsThenMatchesCompiler) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompiler> pSession;
+  CComPtr<IDxcBlobEncoding> pSource;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompilerSession, &pSession));
+  CreateBlobFromText("float4 main(float4 a : A) : SV_Target { return a * 2; }", &pSource);
+
+  auto compile = [&](IDxcCompiler *pC, IDxcBlob **ppProgram) {
+    CComPtr<IDxcOperationResult> pResult;
+    HRESULT hr = pC->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                             nullptr, 0, nullptr, 0, nullptr, &pResult);
+    if (SUCCEEDED(hr))
+      hr = pResult->GetResult(ppProgram);
+    return hr;
+  };
+
+  CComPtr<IDxcBlob> pExpected;
+  VERIFY_SUCCEEDED(compile(pCompiler, &pExpected));
+  std::string expected = DisassembleProgram(m_dllSupport, pExpected);
+
+  // Every thread compiles with the one session, which lends its contexts
+  // and validator to all of them.
+  const unsigned kThreads = 4, kCompilesPerThread = 4;
+  std::vector<CComPtr<IDxcBlob>> programs(kThreads * kCompilesPerThread);
+  std::vector<HRESULT> hrs(programs.size(), E_FAIL);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (unsigned i = 0; i < kCompilesPerThread; ++i) {
+        unsigned n = t * kCompilesPerThread + i;
+        hrs[n] = compile(pSession, &programs[n]);
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+    thread.join();
+
+  for (size_t n = 0; n < programs.size(); ++n) {
+    VERIFY_SUCCEEDED(hrs[n]);
+    VERIFY_ARE_EQUAL_STR(expected.c_str(),
+                         DisassembleProgram(m_dllSupport, programs[n]).c_str());
+  }
 }
 
-TEST_F(CompilerTest, CompileWhenIncludeThenLoadUsed) {
+TEST_F(CompilerTest, CompileWhenSessionReusesContextThenOutputMatches) {
   CComPtr<IDxcCompiler> pCompiler;
-  CComPtr<IDxcOperationResult> pResult;
-  CComPtr<IDxcBlobEncoding> pSource;
-  CComPtr<TestIncludeHandler> pInclude;
+  CComPtr<IDxcCompiler> pSession;
+  CComPtr<IDxcBlobEncoding> pSources[2];
 
   VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompilerSession, &pSession));
+  // Both use a struct named S, and only the first has precise metadata.
   CreateBlobFromText(
-    "#include \"helper.h\"\r\n"
-    "float4 main() : SV_Target { return ZERO; }", &pSource);
+      "struct S { float4 f; }; cbuffer C { S s; };"
+      "float4 main(float4 a : A) : SV_Target { precise float4 r = a * s.f; return r; }",
+      &pSources[0]);
+  CreateBlobFromText(
+      "struct S { int2 i; float f; }; cbuffer C { S s; };"
+      "float4 main(float4 a : A) : SV_Target { return a * s.f + s.i.x; }",
+      &pSources[1]);
 
-  pInclude = new TestIncludeHandler(m_dllSupport);
-  pInclude->CallResults.emplace_back("#define ZERO 0");
+  auto compile = [&](IDxcCompiler *pC, IDxcBlobEncoding *pSource) {
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(pC->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                                 nullptr, 0, nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+    return BlobToUtf8(pProgram);
+  };
 
-  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
-    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
-  VerifyOperationSucceeded(pResult);
-  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+  // A reused context must not leave type names or metadata kinds behind.
+  std::string expected[2] = {compile(pCompiler, pSources[0]),
+                             compile(pCompiler, pSources[1])};
+  for (unsigned i = 0; i < 4; ++i)
+    VERIFY_IS_TRUE(expected[i % 2] == compile(pSession, pSources[i % 2]));
 }
 
-TEST_F(CompilerTest, CompileWhenIncludeAbsoluteThenLoadAbsolute) {
+TEST_F(CompilerTest, CompileAsyncWhenWaitedThenMatchesCompiler) {
   CComPtr<IDxcCompiler> pCompiler;
-  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcCompilerAsync> pAsync;
   CComPtr<IDxcBlobEncoding> pSource;
-  CComPtr<TestIncludeHandler> pInclude;
 
   VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
-  CreateBlobFromText(
-    "#include \"C:\\helper.h\"\r\n"
-    "float4 main() : SV_Target { return ZERO; }", &pSource);
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompilerAsync, &pAsync));
+  CreateBlobFromText("float4 main(float4 a : A) : SV_Target { return a * 2; }", &pSource);
 
-  pInclude = new TestIncludeHandler(m_dllSupport);
-  pInclude->CallResults.emplace_back("#define ZERO 0");
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pProgram;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                                      nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  std::string expected = DisassembleProgram(m_dllSupport, pProgram);
 
-  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
-    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
-  VerifyOperationSucceeded(pResult);
-  VERIFY_ARE_EQUAL_WSTR(L"C:\\helper.h;", pInclude->GetAllFileNames().c_str());
+  UINT64 ids[3];
+  for (UINT32 i = 0; i < _countof(ids); ++i) {
+    VERIFY_SUCCEEDED(pAsync->CompileAsync(pSource, L"source.hlsl", L"main",
+                                          L"ps_6_0", nullptr, 0, nullptr, 0,
+                                          nullptr, i, nullptr, &ids[i]));
+  }
+  for (UINT64 id : ids) {
+    CComPtr<IDxcOperationResult> pAsyncResult;
+    VERIFY_SUCCEEDED(pAsync->Wait(id, INFINITE, &pAsyncResult));
+    VerifyOperationSucceeded(pAsyncResult);
+    CComPtr<IDxcBlob> pAsyncProgram;
+    VERIFY_SUCCEEDED(pAsyncResult->GetResult(&pAsyncProgram));
+    VERIFY_ARE_EQUAL_STR(expected.c_str(),
+                         DisassembleProgram(m_dllSupport, pAsyncProgram).c_str());
+  }
+
+  // Finished requests can't be cancelled or waited for again.
+  VERIFY_ARE_EQUAL(S_FALSE, pAsync->Cancel(ids[0]));
+  CComPtr<IDxcOperationResult> pAgain;
+  VERIFY_ARE_EQUAL(E_INVALIDARG, pAsync->Wait(ids[0], 0, &pAgain));
 }
 
-TEST_F(CompilerTest, CompileWhenIncludeLocalThenLoadRelative) {
+// Reports cancellation once it has been asked a number of times.
+class TestCancellationToken : public IDxcCancellationToken {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  unsigned m_asks = 0;
+  unsigned m_asksBeforeCancel;
+  TestCancellationToken(unsigned asksBeforeCancel)
+      : m_dwRef(0), m_asksBeforeCancel(asksBeforeCancel) {}
+  __override HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) {
+    return DoBasicQueryInterface<IDxcCancellationToken>(this, iid, ppvObject);
+  }
+  __override BOOL STDMETHODCALLTYPE IsCancelled() {
+    return ++m_asks > m_asksBeforeCancel;
+  }
+};
+
+TEST_F(CompilerTest, CompileWhenCancelledThenAborts) {
   CComPtr<IDxcCompiler> pCompiler;
-  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcCompilerCancellation> pCancellation;
   CComPtr<IDxcBlobEncoding> pSource;
-  CComPtr<TestIncludeHandler> pInclude;
 
   VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
-  CreateBlobFromText(
-    "#include \"..\\helper.h\"\r\n"
-    "float4 main() : SV_Target { return ZERO; }", &pSource);
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pCancellation));
+  CreateBlobFromText("float4 main(float4 a : A) : SV_Target { return a * 2; }", &pSource);
 
-  pInclude = new TestIncludeHandler(m_dllSupport);
-  pInclude->CallResults.emplace_back("#define ZERO 0");
+  // A token that never cancels is still asked between passes.
+  CComPtr<TestCancellationToken> pPatient = new TestCancellationToken(UINT_MAX);
+  VERIFY_SUCCEEDED(pCancellation->SetCancellationToken(pPatient));
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                                      nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_IS_TRUE(pPatient->m_asks > 0);
 
-  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
-    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  // Cancelling partway through stops the compile.
+  CComPtr<TestCancellationToken> pDeadline =
+      new TestCancellationToken(pPatient->m_asks / 2);
+  VERIFY_SUCCEEDED(pCancellation->SetCancellationToken(pDeadline));
+  pResult.Release();
+  VERIFY_ARE_EQUAL(E_ABORT,
+                   pCompiler->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                                      nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VERIFY_IS_NULL(pResult.p);
+
+  // The compiler can be used again once the token is cleared.
+  VERIFY_SUCCEEDED(pCancellation->SetCancellationToken(nullptr));
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                                      nullptr, 0, nullptr, 0, nullptr, &pResult));
   VerifyOperationSucceeded(pResult);
-  VERIFY_ARE_EQUAL_WSTR(L"./..\\helper.h;", pInclude->GetAllFileNames().c_str());
 }
 
-TEST_F(CompilerTest, CompileWhenIncludeSystemThenLoadNotRelative) {
+// Records the events of a compile.
+class TestEventsCallback : public IDxcCompilerEventsCallback {
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  int m_openPhases = 0;
+  int m_openPasses = 0;
+  unsigned m_passesWithStats = 0;
+  std::vector<std::string> m_phases;
+  std::vector<std::wstring> m_includes;
+  TestEventsCallback() : m_dwRef(0) {}
+  __override HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) {
+    return DoBasicQueryInterface<IDxcCompilerEventsCallback>(this, iid, ppvObject);
+  }
+  __override HRESULT STDMETHODCALLTYPE OnPhaseBegin(LPCSTR pName) {
+    m_phases.emplace_back(pName);
+    ++m_openPhases;
+    return S_OK;
+  }
+  __override HRESULT STDMETHODCALLTYPE OnPhaseEnd(LPCSTR pName) {
+    --m_openPhases;
+    return S_OK;
+  }
+  __override HRESULT STDMETHODCALLTYPE OnPassBegin(LPCSTR pName) {
+    ++m_openPasses;
+    return S_OK;
+  }
+  __override HRESULT STDMETHODCALLTYPE OnPassEnd(LPCSTR pName,
+                                                 const DxcPassIRStats *pStats) {
+    --m_openPasses;
+    if (pStats && pStats->Instructions > 0)
+      ++m_passesWithStats;
+    return S_OK;
+  }
+  __override HRESULT STDMETHODCALLTYPE OnIncludeOpened(LPCWSTR pFileName) {
+    m_includes.emplace_back(pFileName);
+    return S_OK;
+  }
+  __override HRESULT STDMETHODCALLTYPE OnCacheLookup(BOOL hit) {
+    return S_OK;
+  }
+};
+
+TEST_F(CompilerTest, CompileWhenEventsCallbackThenPhasesAndPassesReported) {
   CComPtr<IDxcCompiler> pCompiler;
-  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcCompilerEvents> pEvents;
   CComPtr<IDxcBlobEncoding> pSource;
   CComPtr<TestIncludeHandler> pInclude;
 
   VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pEvents));
   CreateBlobFromText(
-    "#include \"subdir/other/file.h\"\r\n"
-    "float4 main() : SV_Target { return ZERO; }", &pSource);
-
-  LPCWSTR args[] = {
-    L"-Ifoo"
-  };
+    "#include \"helper.h\"\r\n"
+    "float4 main(float4 a : A) : SV_Target { return a * TWO; }", &pSource);
   pInclude = new TestIncludeHandler(m_dllSupport);
-  pInclude->CallResults.emplace_back("#include <helper.h>");
-  pInclude->CallResults.emplace_back("#define ZERO 0");
+  pInclude->CallResults.emplace_back("#define TWO 2");
 
-  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
-    L"ps_6_0", args, _countof(args), nullptr, 0, pInclude, &pResult));
+  CComPtr<TestEventsCallback> pCallback = new TestEventsCallback();
+  VERIFY_SUCCEEDED(pEvents->SetEventsCallback(pCallback));
+  CComPtr<IDxcOperationResult> pResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                                      nullptr, 0, nullptr, 0, pInclude, &pResult));
   VerifyOperationSucceeded(pResult);
-  VERIFY_ARE_EQUAL_WSTR(L"./subdir/other/file.h;./foo\\helper.h;", pInclude->GetAllFileNames().c_str());
+
+  // Every phase and pass that began has ended, and passes report the size
+  // of the module.
+  VERIFY_ARE_EQUAL(0, pCallback->m_openPhases);
+  VERIFY_ARE_EQUAL(0, pCallback->m_openPasses);
+  VERIFY_IS_TRUE(pCallback->m_passesWithStats > 0);
+  VERIFY_IS_TRUE(std::find(pCallback->m_phases.begin(), pCallback->m_phases.end(),
+                           "frontend") != pCallback->m_phases.end());
+  VERIFY_ARE_EQUAL(1u, pCallback->m_includes.size());
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h", pCallback->m_includes[0].c_str());
+
+  // Nothing is reported once the callback is cleared.
+  VERIFY_SUCCEEDED(pEvents->SetEventsCallback(nullptr));
+  size_t phaseCount = pCallback->m_phases.size();
+  pInclude->callIndex = 0;
+  pResult.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main", L"ps_6_0",
+                                      nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL(phaseCount, pCallback->m_phases.size());
 }
 
-TEST_F(CompilerTest, CompileWhenIncludeSystemMissingThenLoadAttempt) {
+TEST_F(CompilerTest, CompilePermutationsWhenSameTokensThenSharedResult) {
   CComPtr<IDxcCompiler> pCompiler;
-  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcCompilerPermutations> pPermutations;
   CComPtr<IDxcBlobEncoding> pSource;
-  CComPtr<TestIncludeHandler> pInclude;
 
   VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pPermutations));
   CreateBlobFromText(
-    "#include \"subdir/other/file.h\"\r\n"
-    "float4 main() : SV_Target { return ZERO; }", &pSource);
-
-  pInclude = new TestIncludeHandler(m_dllSupport);
-  pInclude->CallResults.emplace_back("#include <helper.h>");
-  pInclude->CallResults.emplace_back("#define ZERO 0");
-
-  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
-    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
-  std::string failLog(VerifyOperationFailed(pResult));
-  VERIFY_ARE_NOT_EQUAL(std::string::npos, failLog.find("<angled>")); // error message should prompt to use <angled> rather than "quotes"
-  VERIFY_ARE_EQUAL_WSTR(L"./subdir/other/file.h;./subdir/other/helper.h;", pInclude->GetAllFileNames().c_str());
+      "float4 main(float4 a : A) : SV_Target {\n"
+      "#if SCALE\n"
+      "  return a * 2;\n"
+      "#else\n"
+      "  return a;\n"
+      "#endif\n"
+      "}", &pSource);
+
+  // UNUSED doesn't change the preprocessed text, and SCALE=0 matches no
+  // define.
+  DxcDefine scale[] = { { L"SCALE", L"1" } };
+  DxcDefine scaleUnused[] = { { L"SCALE", L"1" }, { L"UNUSED", nullptr } };
+  DxcDefine noScale[] = { { L"SCALE", L"0" } };
+  const DxcDefine *defines[] = { scale, scaleUnused, nullptr, noScale };
+  UINT32 defineCounts[] = { _countof(scale), _countof(scaleUnused), 0,
+                            _countof(noScale) };
+
+  for (UINT32 maxThreads : { 1u, 4u }) {
+    IDxcOperationResult *pRawResults[_countof(defines)];
+    VERIFY_SUCCEEDED(pPermutations->CompilePermutations(
+        pSource, L"source.hlsl", L"main", L"ps_6_0", nullptr, 0,
+        _countof(defines), defines, defineCounts, nullptr, maxThreads,
+        pRawResults));
+    CComPtr<IDxcOperationResult> pResults[_countof(defines)];
+    for (UINT32 i = 0; i < _countof(defines); ++i)
+      pResults[i].Attach(pRawResults[i]);
+    for (auto &pResult : pResults)
+      VerifyOperationSucceeded(pResult);
+    VERIFY_ARE_EQUAL(pResults[0].p, pResults[1].p);
+    VERIFY_ARE_EQUAL(pResults[2].p, pResults[3].p);
+    VERIFY_ARE_NOT_EQUAL(pResults[0].p, pResults[2].p);
+
+    // Each result matches a plain compile of its permutation.
+    for (UINT32 i = 0; i < _countof(defines); ++i) {
+      CComPtr<IDxcOperationResult> pExpected;
+      CComPtr<IDxcBlob> pExpectedProgram, pProgram;
+      VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                          L"ps_6_0", nullptr, 0, defines[i],
+                                          defineCounts[i], nullptr,
+                                          &pExpected));
+      VERIFY_SUCCEEDED(pExpected->GetResult(&pExpectedProgram));
+      VERIFY_SUCCEEDED(pResults[i]->GetResult(&pProgram));
+      VERIFY_ARE_EQUAL_STR(
+          DisassembleProgram(m_dllSupport, pExpectedProgram).c_str(),
+          DisassembleProgram(m_dllSupport, pProgram).c_str());
+    }
+  }
 }
 
-TEST_F(CompilerTest, CompileWhenIncludeFlagsThenIncludeUsed) {
+TEST_F(CompilerTest, SpecializeWhenValuesSetThenConstantsFolded) {
   CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcSpecializer> pSpecializer;
   CComPtr<IDxcOperationResult> pResult;
   CComPtr<IDxcBlobEncoding> pSource;
-  CComPtr<TestIncludeHandler> pInclude;
+  CComPtr<IDxcBlob> pGeneric;
 
   VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(
+      m_dllSupport.CreateInstance(CLSID_DxcSpecializer, &pSpecializer));
   CreateBlobFromText(
-    "#include <helper.h>\r\n"
-    "float4 main() : SV_Target { return ZERO; }", &pSource);
-
-  pInclude = new TestIncludeHandler(m_dllSupport);
-  pInclude->CallResults.emplace_back("#define ZERO 0");
-
-  LPCWSTR args[] = {
-    L"-I\\\\server\\share"
-  };
+      "[specializable] static const bool kScale = false;\n"
+      "[specializable] static const float kFactor = 2.0;\n"
+      "float4 main(float4 a : A) : SV_Target {\n"
+      "  if (kScale) return a * kFactor;\n"
+      "  return a;\n"
+      "}", &pSource);
+
+  LPCWSTR Args[] = { L"-specializable" };
   VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
-    L"ps_6_0", args, _countof(args), nullptr, 0, pInclude, &pResult));
+                                      L"ps_6_0", Args, _countof(Args),
+                                      nullptr, 0, nullptr, &pResult));
   VerifyOperationSucceeded(pResult);
-  VERIFY_ARE_EQUAL_WSTR(L"\\\\server\\share\\helper.h;", pInclude->GetAllFileNames().c_str());
+  VERIFY_SUCCEEDED(pResult->GetResult(&pGeneric));
+  std::string generic = DisassembleProgram(m_dllSupport, pGeneric);
+  VERIFY_IS_TRUE(generic.find("cbufferLoadLegacy") != std::string::npos);
+
+  // Set both constants; 0x40400000 is 3.0f.
+  LPCWSTR names[] = { L"kScale", L"kFactor" };
+  UINT32 values[] = { 1, 0x40400000 };
+  CComPtr<IDxcOperationResult> pScaled;
+  CComPtr<IDxcBlob> pScaledProgram;
+  VERIFY_SUCCEEDED(pSpecializer->Specialize(pGeneric, names, values,
+                                            _countof(names), &pScaled));
+  VerifyOperationSucceeded(pScaled);
+  VERIFY_SUCCEEDED(pScaled->GetResult(&pScaledProgram));
+  std::string scaled = DisassembleProgram(m_dllSupport, pScaledProgram);
+  VERIFY_IS_TRUE(scaled.find("cbufferLoadLegacy") == std::string::npos);
+  VERIFY_IS_TRUE(scaled.find("3.000000e+00") != std::string::npos);
+  VERIFY_IS_TRUE(scaled.find("dx.specializable") == std::string::npos);
+
+  // The defaults leave the input unscaled.
+  CComPtr<IDxcOperationResult> pDefault;
+  CComPtr<IDxcBlob> pDefaultProgram;
+  VERIFY_SUCCEEDED(
+      pSpecializer->Specialize(pGeneric, nullptr, nullptr, 0, &pDefault));
+  VerifyOperationSucceeded(pDefault);
+  VERIFY_SUCCEEDED(pDefault->GetResult(&pDefaultProgram));
+  std::string unscaled = DisassembleProgram(m_dllSupport, pDefaultProgram);
+  VERIFY_IS_TRUE(unscaled.find("cbufferLoadLegacy") == std::string::npos);
+  VERIFY_IS_TRUE(unscaled.find("fmul") == std::string::npos);
+
+  // Names must be specializable constants.
+  LPCWSTR unknown[] = { L"kMissing" };
+  CComPtr<IDxcOperationResult> pUnknown;
+  HRESULT status;
+  VERIFY_SUCCEEDED(
+      pSpecializer->Specialize(pGeneric, unknown, values, 1, &pUnknown));
+  VERIFY_SUCCEEDED(pUnknown->GetStatus(&status));
+  VERIFY_FAILED(status);
 }
 
-TEST_F(CompilerTest, CompileWhenIncludeMissingThenFail) {
+TEST_F(CompilerTest, LinkStagesWhenOutputsUnreadThenRemoved) {
   CComPtr<IDxcCompiler> pCompiler;
-  CComPtr<IDxcOperationResult> pResult;
-  CComPtr<IDxcBlobEncoding> pSource;
-  CComPtr<TestIncludeHandler> pInclude;
+  CComPtr<IDxcStageLinker> pLinker;
+  CComPtr<IDxcBlobEncoding> pVSSource, pPSSource;
+  CComPtr<IDxcOperationResult> pVSResult, pPSResult;
+  CComPtr<IDxcBlob> pVS, pPS;
 
   VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcStageLinker, &pLinker));
   CreateBlobFromText(
-    "#include \"file.h\"\r\n"
-    "float4 main() : SV_Target { return 0; }", &pSource);
-
-  pInclude = new TestIncludeHandler(m_dllSupport);
-
-  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
-    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
-  HRESULT hr;
-  VERIFY_SUCCEEDED(pResult->GetStatus(&hr));
-  VERIFY_FAILED(hr);
+      "struct VSOut { float4 pos : SV_Position; float4 uv : TEXCOORD0;\n"
+      "  float4 tint : TINT; float4 normal : NORMAL; };\n"
+      "VSOut main(float4 p : POSITION, float4 c : COLOR) {\n"
+      "  VSOut o;\n"
+      "  o.pos = p; o.uv = p * 2; o.tint = c * c; o.normal = float4(0, 0, 1, 0);\n"
+      "  return o;\n"
+      "}", &pVSSource);
+  CreateBlobFromText(
+      "float4 main(float4 pos : SV_Position, float4 uv : TEXCOORD0,\n"
+      "            float4 normal : NORMAL) : SV_Target {\n"
+      "  return uv * normal.z;\n"
+      "}", &pPSSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pVSSource, L"vs.hlsl", L"main",
+                                      L"vs_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pVSResult));
+  VerifyOperationSucceeded(pVSResult);
+  VERIFY_SUCCEEDED(pVSResult->GetResult(&pVS));
+  VERIFY_SUCCEEDED(pCompiler->Compile(pPSSource, L"ps.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pPSResult));
+  VerifyOperationSucceeded(pPSResult);
+  VERIFY_SUCCEEDED(pPSResult->GetResult(&pPS));
+
+  // TINT isn't read, and NORMAL is constant, so neither stage keeps them.
+  CComPtr<IDxcOperationResult> pLinkedVSResult, pLinkedPSResult;
+  CComPtr<IDxcBlob> pLinkedVS, pLinkedPS;
+  VERIFY_SUCCEEDED(
+      pLinker->LinkStages(pVS, pPS, &pLinkedVSResult, &pLinkedPSResult));
+  VerifyOperationSucceeded(pLinkedVSResult);
+  VerifyOperationSucceeded(pLinkedPSResult);
+  VERIFY_SUCCEEDED(pLinkedVSResult->GetResult(&pLinkedVS));
+  VERIFY_SUCCEEDED(pLinkedPSResult->GetResult(&pLinkedPS));
+  std::string vs = DisassembleProgram(m_dllSupport, pLinkedVS);
+  std::string ps = DisassembleProgram(m_dllSupport, pLinkedPS);
+  VERIFY_IS_TRUE(vs.find("TINT") == std::string::npos);
+  VERIFY_IS_TRUE(vs.find("NORMAL") == std::string::npos);
+  VERIFY_IS_TRUE(vs.find("TEXCOORD") != std::string::npos);
+  VERIFY_IS_TRUE(ps.find("NORMAL") == std::string::npos);
+  VERIFY_IS_TRUE(ps.find("TEXCOORD") != std::string::npos);
+
+  // A pixel shader can't feed a vertex shader.
+  CComPtr<IDxcOperationResult> pBadVSResult, pBadPSResult;
+  HRESULT status;
+  VERIFY_SUCCEEDED(pLinker->LinkStages(pPS, pVS, &pBadVSResult, &pBadPSResult));
+  VERIFY_SUCCEEDED(pBadVSResult->GetStatus(&status));
+  VERIFY_FAILED(status);
 }
 
-TEST_F(CompilerTest, CompileWhenIncludeHasPathThenOK) {
+TEST_F(CompilerTest, LinkStagesWhenOutputPerPrimitiveThenNoInterpolation) {
   CComPtr<IDxcCompiler> pCompiler;
-  LPCWSTR Source = L"c:\\temp\\OddIncludes\\main.hlsl";
-  LPCWSTR Args[] = { L"/I", L"c:\\temp" };
-  LPCWSTR ArgsUp[] = { L"/I", L"c:\\Temp" };
-  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
-  bool useUpValues[] = { false, true };
-  for (bool useUp : useUpValues) {
-    CComPtr<IDxcOperationResult> pResult;
-    CComPtr<IDxcBlobEncoding> pSource;
-#if TEST_ON_DISK
-    CComPtr<IDxcLibrary> pLibrary;
-    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
-    VERIFY_SUCCEEDED(pLibrary->CreateIncludeHandler(&pInclude));
-    VERIFY_SUCCEEDED(pLibrary->CreateBlobFromFile(Source, nullptr, &pSource));
-#else
-    CComPtr<TestIncludeHandler> pInclude;
-    pInclude = new TestIncludeHandler(m_dllSupport);
-    pInclude->CallResults.emplace_back("// Empty");
-    CreateBlobFromText("#include \"include.hlsl\"\r\n"
-                       "float4 main() : SV_Target { return 0; }",
-                       &pSource);
-#endif
+  CComPtr<IDxcStageLinker> pLinker;
+  CComPtr<IDxcBlobEncoding> pVSSource, pPSSource;
+  CComPtr<IDxcOperationResult> pVSResult, pPSResult;
+  CComPtr<IDxcBlob> pVS, pPS;
 
-    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, Source, L"main",
-      L"ps_6_0", useUp ? ArgsUp : Args, _countof(Args), nullptr, 0, pInclude, &pResult));
-    HRESULT hr;
-    VERIFY_SUCCEEDED(pResult->GetStatus(&hr));
-    VERIFY_SUCCEEDED(hr);
- }
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcStageLinker, &pLinker));
+  CreateBlobFromText(
+      "struct VSOut { float4 pos : SV_Position; float4 uv : TEXCOORD0;\n"
+      "  float4 tint : TINT; };\n"
+      "float4 g_tint;\n"
+      "VSOut main(float4 p : POSITION, uint id : SV_InstanceID) {\n"
+      "  VSOut o;\n"
+      "  o.pos = p; o.uv = p * 2; o.tint = g_tint * id;\n"
+      "  return o;\n"
+      "}", &pVSSource);
+  CreateBlobFromText(
+      "float4 main(float4 pos : SV_Position, float4 uv : TEXCOORD0,\n"
+      "            float4 tint : TINT) : SV_Target {\n"
+      "  return uv * tint;\n"
+      "}", &pPSSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pVSSource, L"vs.hlsl", L"main",
+                                      L"vs_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pVSResult));
+  VerifyOperationSucceeded(pVSResult);
+  VERIFY_SUCCEEDED(pVSResult->GetResult(&pVS));
+  VERIFY_SUCCEEDED(pCompiler->Compile(pPSSource, L"ps.hlsl", L"main",
+                                      L"ps_6_0", nullptr, 0, nullptr, 0,
+                                      nullptr, &pPSResult));
+  VerifyOperationSucceeded(pPSResult);
+  VERIFY_SUCCEEDED(pPSResult->GetResult(&pPS));
+
+  // TINT only depends on a constant buffer and the instance, so it is the
+  // same for all vertices of a primitive; TEXCOORD is still interpolated.
+  CComPtr<IDxcOperationResult> pLinkedVSResult, pLinkedPSResult;
+  CComPtr<IDxcBlob> pLinkedPS;
+  VERIFY_SUCCEEDED(
+      pLinker->LinkStages(pVS, pPS, &pLinkedVSResult, &pLinkedPSResult));
+  VerifyOperationSucceeded(pLinkedVSResult);
+  VerifyOperationSucceeded(pLinkedPSResult);
+  VERIFY_SUCCEEDED(pLinkedPSResult->GetResult(&pLinkedPS));
+  std::string ps = DisassembleProgram(m_dllSupport, pLinkedPS);
+  // The last table of the listing has the interpolation modes.
+  std::string::size_type tint = ps.rfind("; TINT");
+  std::string::size_type uv = ps.rfind("; TEXCOORD");
+  VERIFY_IS_TRUE(tint != std::string::npos && uv != std::string::npos);
+  std::string tintLine = ps.substr(tint, ps.find('\n', tint) - tint);
+  std::string uvLine = ps.substr(uv, ps.find('\n', uv) - uv);
+  VERIFY_IS_TRUE(tintLine.find("nointerpolation") != std::string::npos);
+  VERIFY_IS_TRUE(uvLine.find("linear") != std::string::npos);
 }
 
-static const char EmptyCompute[] = "[numthreads(8,8,1)] void main() { }";
-
 TEST_F(CompilerTest, CompileWhenODumpThenPassConfig) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2558,6 +4124,62 @@ TEST_F(CompilerTest, CompileWhenODumpThenOptimizerMatch) {
   }
 }
 
+TEST_F(CompilerTest, CompileWhenOptPipelineThenSameAsODumpPasses) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pPasses;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pPipelineProgram;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "float4 main(float4 a : A, int i : I) : SV_Target {\r\n"
+    "  float4 r = 0;\r\n"
+    "  for (int j = 0; j < i; ++j) r += a * j;\r\n"
+    "  return r;\r\n"
+    "}", &pSource);
+
+  LPCWSTR DumpArgs[] = { L"/O3", L"/Odump" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", DumpArgs, _countof(DumpArgs), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pPasses));
+  pResult.Release();
+
+  LPCWSTR Args[] = { L"/O3" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  pResult.Release();
+
+  // The passes /Odump printed should build the same program.
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(BlobToUtf8(pPasses).c_str());
+  LPCWSTR PipelineArgs[] = { L"/O3", L"/opt-pipeline", L"pipeline.txt" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", PipelineArgs, _countof(PipelineArgs), nullptr, 0, pInclude,
+    &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pPipelineProgram));
+  pResult.Release();
+  VERIFY_ARE_EQUAL_WSTR(L"pipeline.txt;", pInclude->GetAllFileNames().c_str());
+  VERIFY_ARE_EQUAL_STR(DisassembleProgram(m_dllSupport, pProgram).c_str(),
+    DisassembleProgram(m_dllSupport, pPipelineProgram).c_str());
+
+  // A command that doesn't name a pass is reported.
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("-opt-mod-passes\n-no-such-pass\n");
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", PipelineArgs, _countof(PipelineArgs), nullptr, 0, pInclude,
+    &pResult));
+  std::string errors = VerifyOperationFailed(pResult);
+  VERIFY_ARE_NOT_EQUAL(std::string::npos,
+    errors.find("invalid optimizer pipeline option '-no-such-pass'"));
+}
+
 static const UINT CaptureStacks = 0; // Set to 1 to enable captures
 static const UINT StackFrameCount = 12;
 static const UINT StackFrameCountForRefs = 4;
@@ -2694,6 +4316,40 @@ public:
   virtual void STDMETHODCALLTYPE HeapMinimize(void) {}
 };
 
+TEST_F(CompilerTest, CompileWhenArenaMallocThenPeakReported) {
+  CComPtr<IDxcBlobEncoding> pSource;
+  CreateBlobFromText(EmptyCompute, &pSource);
+
+  InstrumentedHeapMalloc InstrMalloc;
+  InstrMalloc.ResetHeap();
+  ULONG initialRefCount = InstrMalloc.GetRefCount();
+  {
+    CComPtr<IDxcArenaMalloc> pArena;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance2(
+        &InstrMalloc, CLSID_DxcArenaMalloc, &pArena));
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(
+        m_dllSupport.CreateInstance2(pArena, CLSID_DxcCompiler, &pCompiler));
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"cs_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+
+    // The arenas are taken in a few large allocations.
+    UINT64 peakBytes, arenaBytes;
+    VERIFY_SUCCEEDED(pArena->GetPeakBytes(&peakBytes));
+    VERIFY_SUCCEEDED(pArena->GetArenaBytes(&arenaBytes));
+    VERIFY_IS_TRUE(peakBytes > 0);
+    VERIFY_IS_TRUE(arenaBytes >= peakBytes);
+    VERIFY_IS_TRUE(InstrMalloc.GetAllocCount() * 1024 < arenaBytes);
+  }
+
+  // Releasing the allocator returns the arenas.
+  VERIFY_IS_TRUE(0 == InstrMalloc.GetSize());
+  VERIFY_ARE_EQUAL(initialRefCount, InstrMalloc.GetRefCount());
+}
+
 TEST_F(CompilerTest, CompileWhenNoMemThenOOM) {
   WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
 
@@ -3139,6 +4795,10 @@ TEST_F(CompilerTest, PixAccessTracking) {
   CodeGenTestCheck(L"pix\\AccessTracking.hlsl");
 }
 
+TEST_F(CompilerTest, PixBlockCounters) {
+  CodeGenTestCheck(L"pix\\blockCounters.hlsl");
+}
+
 TEST_F(CompilerTest, CodeGenAbs1) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\abs1.hlsl");
 }
@@ -3822,6 +5482,10 @@ TEST_F(CompilerTest, CodeGenLibEntries2) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\lib_entries2.hlsl");
 }
 
+TEST_F(CompilerTest, CodeGenLibMergeFunc) {
+  CodeGenTestCheck(L"..\\CodeGenHLSL\\lib_merge_func.hlsl");
+}
+
 TEST_F(CompilerTest, CodeGenLibNoAlias) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\lib_no_alias.hlsl");
 }
@@ -4336,6 +6000,10 @@ TEST_F(CompilerTest, CodeGenSignaturePackingByWidth) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\signature_packing_by_width.hlsl");
 }
 
+TEST_F(CompilerTest, CodeGenSignaturePackingMinimal) {
+  CodeGenTestCheck(L"..\\CodeGenHLSL\\signature_packing_minimal.hlsl");
+}
+
 TEST_F(CompilerTest, CodeGenShaderAttr) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\shader_attr.hlsl");
 }
@@ -5892,6 +7560,7 @@ TEST_F(CompilerTest, HoistConstantArray) {
   CodeGenTestCheck(L"hca\\13.hlsl");
   CodeGenTestCheck(L"hca\\14.hlsl");
   CodeGenTestCheck(L"hca\\15.ll");
+  CodeGenTestCheck(L"hca\\16.ll");
 }
 
 TEST_F(CompilerTest, VecElemConstEval) {
@@ -5931,6 +7600,49 @@ TEST_F(CompilerTest, PreprocessWhenValidThenOK) {
     "int BAR;\n", text.c_str());
 }
 
+TEST_F(CompilerTest, PreprocessWhenCompiledPreprocessedThenDependenciesKept) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("static const float4 ZERO = 0;");
+
+  VERIFY_SUCCEEDED(pCompiler->Preprocess(pSource, L"source.hlsl", nullptr, 0,
+                                         nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcIncludeDependencies> pDependencies;
+  CComPtr<IDxcBlobEncoding> pDependencyText;
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pDependencies));
+  VERIFY_ARE_EQUAL(S_OK, pDependencies->GetDependencies(&pDependencyText));
+  VERIFY_ARE_EQUAL_STR("source.hlsl\n./helper.h\n",
+                       BlobToUtf8(pDependencyText).c_str());
+
+  // The preprocessed text compiles without the include handler, ignores
+  // defines, and still reports the files it came from.
+  CComPtr<IDxcBlob> pPreprocessed;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pPreprocessed));
+  LPCWSTR args[] = { L"-fpreprocessed" };
+  DxcDefine define = { L"ZERO", L"not valid" };
+  CComPtr<IDxcOperationResult> pCompileResult;
+  VERIFY_SUCCEEDED(pCompiler->Compile(pPreprocessed, L"source.i", L"main",
+                                      L"ps_6_0", args, _countof(args),
+                                      &define, 1, nullptr, &pCompileResult));
+  VerifyOperationSucceeded(pCompileResult);
+  CComPtr<IDxcIncludeDependencies> pCompileDependencies;
+  CComPtr<IDxcBlobEncoding> pCompileDependencyText;
+  VERIFY_SUCCEEDED(pCompileResult.QueryInterface(&pCompileDependencies));
+  VERIFY_ARE_EQUAL(S_OK, pCompileDependencies->GetDependencies(
+                             &pCompileDependencyText));
+  VERIFY_ARE_EQUAL_STR("source.hlsl\n./helper.h\n",
+                       BlobToUtf8(pCompileDependencyText).c_str());
+}
+
 TEST_F(CompilerTest, PreprocessWhenExpandTokenPastingOperandThenAccept) {
   // Tests that we can turn on fxc's behavior (pre-expanding operands before
   // performing token-pasting) using -flegacy-macro-expansion
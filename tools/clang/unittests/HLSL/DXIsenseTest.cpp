@@ -100,7 +100,12 @@ protected:
   TEST_METHOD(InclusionWhenMissingThenError);
   TEST_METHOD(InclusionWhenValidThenAvailable);
 
+  TEST_METHOD(IndexWhenUpdatedThenReferencesAcrossFilesFound);
+
+  TEST_METHOD(TUWhenCodeCompleteMemberThenFieldListed);
+  TEST_METHOD(TUWhenFindReferencesThenDeclAndRefsFound);
   TEST_METHOD(TUWhenGetFileMissingThenFail);
+  TEST_METHOD(TUWhenReparseChangedThenUnchangedFilesKept);
   TEST_METHOD(TUWhenGetFilePresentThenOK);
   TEST_METHOD(TUWhenEmptyStructThenErrorIfISense);
   TEST_METHOD(TUWhenRegionInactiveMissingThenCountIsZero);
@@ -207,6 +212,155 @@ TEST_F(DXIntellisenseTest, InclusionWhenValidThenAvailable) {
   }
 }
 
+TEST_F(DXIntellisenseTest, IndexWhenUpdatedThenReferencesAcrossFilesFound) {
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> index;
+  CComPtr<IDxcIndex2> index2;
+  CComPtr<IDxcUnsavedFile> unsaved[3];
+  CComPtr<IDxcUnsavedFile> changed;
+  CComPtr<IDxcTranslationUnit> TU;
+  CComPtr<IDxcCursor> varRefCursor;
+  CComHeapPtr<DxcIndexedReference> refs;
+  CComHeapPtr<char> fileName;
+  const char main_text[] = "#include \"inc.h\"\r\nfloat4 main() : SV_Target { return g_color; }";
+  const char other_text[] = "#include \"inc.h\"\r\nfloat4 other() : SV_Target { return g_color * 2; }";
+  const char changed_text[] = "#include \"inc.h\"\r\nfloat4 other() : SV_Target { return 0; }";
+  const char inc_text[] = "float4 g_color;";
+  unsigned parsedCount;
+  unsigned refCount;
+  VERIFY_SUCCEEDED(CompilationResult::DefaultHlslSupport->CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&index));
+  VERIFY_SUCCEEDED(index.QueryInterface(&index2));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("./inc.h", inc_text, strlen(inc_text), &unsaved[0]));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("filename.hlsl", main_text, strlen(main_text), &unsaved[1]));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("other.hlsl", other_text, strlen(other_text), &unsaved[2]));
+  VERIFY_SUCCEEDED(index2->AddIndexedFile("filename.hlsl", nullptr, 0));
+  VERIFY_SUCCEEDED(index2->AddIndexedFile("other.hlsl", nullptr, 0));
+  VERIFY_SUCCEEDED(index2->UpdateIndex(&unsaved[0].p, 3, 0, &parsedCount));
+  VERIFY_ARE_EQUAL(2, parsedCount);
+
+  // The declaration in the shared header is found once.
+  VERIFY_SUCCEEDED(index->ParseTranslationUnit("filename.hlsl", nullptr, 0, &unsaved[0].p, 3,
+    DxcTranslationUnitFlags_UseCallerThread, &TU));
+  ExpectCursorAt(TU, 2, 36, DxcCursor_DeclRefExpr, &varRefCursor);
+  VERIFY_SUCCEEDED(index2->FindIndexedReferences(varRefCursor, 0, 10, &refCount, &refs));
+  VERIFY_ARE_EQUAL(3, refCount);
+  VERIFY_SUCCEEDED(index2->GetIndexedFileName(refs[0].FileIndex, &fileName));
+  VERIFY_ARE_EQUAL_STR("./inc.h", fileName.m_pData);
+
+  // Only files whose inputs changed are parsed again.
+  VERIFY_SUCCEEDED(index2->UpdateIndex(&unsaved[0].p, 3, 0, &parsedCount));
+  VERIFY_ARE_EQUAL(0, parsedCount);
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("other.hlsl", changed_text, strlen(changed_text), &changed));
+  unsaved[2] = changed;
+  VERIFY_SUCCEEDED(index2->UpdateIndex(&unsaved[0].p, 3, 0, &parsedCount));
+  VERIFY_ARE_EQUAL(1, parsedCount);
+  refs.Free();
+  VERIFY_SUCCEEDED(index2->FindIndexedReferences(varRefCursor, 0, 10, &refCount, &refs));
+  VERIFY_ARE_EQUAL(2, refCount);
+}
+
+TEST_F(DXIntellisenseTest, TUWhenReparseChangedThenUnchangedFilesKept) {
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> index;
+  CComPtr<IDxcUnsavedFile> unsaved[2];
+  CComPtr<IDxcUnsavedFile> changed;
+  CComPtr<IDxcTranslationUnit> TU;
+  CComPtr<IDxcTranslationUnit2> TU2;
+  const char main_text[] = "#include \"inc.h\"\r\nfloat4 main() : SV_Target { return FOO; }";
+  const char changed_text[] = "#include \"inc.h\"\r\nfloat4 main() : SV_Target { return BAR; }";
+  const char unsaved_text[] = "#define FOO 1";
+  unsigned diagCount;
+  VERIFY_SUCCEEDED(CompilationResult::DefaultHlslSupport->CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&index));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("./inc.h", unsaved_text, strlen(unsaved_text), &unsaved[0]));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("file.hlsl", main_text, strlen(main_text), &unsaved[1]));
+  VERIFY_SUCCEEDED(index->ParseTranslationUnit("file.hlsl", nullptr, 0, &unsaved[0].p, 2,
+    DxcTranslationUnitFlags_UseCallerThread, &TU));
+  VERIFY_SUCCEEDED(TU.QueryInterface(&TU2));
+
+  // The include is still found without being passed again.
+  VERIFY_SUCCEEDED(TU2->ReparseChanged(&unsaved[1].p, 1));
+  VERIFY_SUCCEEDED(TU2->GetNumDiagnostics(&diagCount));
+  VERIFY_ARE_EQUAL(0, diagCount);
+
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile("file.hlsl", changed_text, strlen(changed_text), &changed));
+  VERIFY_SUCCEEDED(TU2->ReparseChanged(&changed.p, 1));
+  VERIFY_SUCCEEDED(TU2->GetNumDiagnostics(&diagCount));
+  VERIFY_ARE_EQUAL(1, diagCount);
+}
+
+TEST_F(DXIntellisenseTest, TUWhenCodeCompleteMemberThenFieldListed) {
+  char program[] =
+    "struct S { float member; };\r\n"
+    "float f(S s) { return s. }";
+
+  CComPtr<IDxcTranslationUnit2> TU2;
+  CComPtr<IDxcCodeCompleteResults> results;
+  unsigned resultCount;
+  bool found = false;
+
+  CompilationResult c(CompilationResult::CreateForProgram(program, strlen(program)));
+  VERIFY_SUCCEEDED(c.TU.QueryInterface(&TU2));
+  VERIFY_SUCCEEDED(TU2->CodeCompleteAt(CompilationResult::getDefaultFileName(), 2, 25,
+    nullptr, 0, DxcCodeCompleteFlags_None, &results));
+  VERIFY_SUCCEEDED(results->GetNumResults(&resultCount));
+  for (unsigned i = 0; i < resultCount && !found; ++i) {
+    CComPtr<IDxcCompletionResult> result;
+    CComPtr<IDxcCompletionString> completionString;
+    unsigned chunkCount;
+    VERIFY_SUCCEEDED(results->GetResultAt(i, &result));
+    VERIFY_SUCCEEDED(result->GetCompletionString(&completionString));
+    VERIFY_SUCCEEDED(completionString->GetNumCompletionChunks(&chunkCount));
+    for (unsigned j = 0; j < chunkCount; ++j) {
+      DxcCompletionChunkKind kind;
+      CComHeapPtr<char> text;
+      VERIFY_SUCCEEDED(completionString->GetCompletionChunkKind(j, &kind));
+      if (kind != DxcCompletionChunk_TypedText)
+        continue;
+      VERIFY_SUCCEEDED(completionString->GetCompletionChunkText(j, &text));
+      found |= 0 == strcmp(text.m_pData, "member");
+    }
+  }
+  VERIFY_IS_TRUE(found);
+}
+
+TEST_F(DXIntellisenseTest, TUWhenFindReferencesThenDeclAndRefsFound) {
+  char program[] =
+    "int g;\r\n"
+    "int main() { return\r\n"
+    "g + g; }";
+
+  CComPtr<IDxcTranslationUnit2> TU2;
+  CComPtr<IDxcCursor> varRefCursor;
+  CComPtr<IDxcCursor> defCursor;
+  CComPtr<IDxcFile> file;
+  CComInterfaceArray<IDxcCursor> refs;
+  CComInterfaceArray<IDxcCursor> pagedRefs;
+  CComPtr<IDxcSourceLocation> loc;
+  unsigned line;
+
+  CompilationResult c(CompilationResult::CreateForProgram(program, strlen(program)));
+  VERIFY_ARE_EQUAL(true, c.ParseSucceeded());
+  VERIFY_SUCCEEDED(c.TU.QueryInterface(&TU2));
+  ExpectCursorAt(c.TU, 3, 1, DxcCursor_DeclRefExpr, &varRefCursor);
+  VERIFY_SUCCEEDED(c.TU->GetFile(CompilationResult::getDefaultFileName(), &file));
+
+  VERIFY_SUCCEEDED(TU2->FindReferences(varRefCursor, nullptr, 0, 10, refs.size_ref(), refs.data_ref()));
+  VERIFY_ARE_EQUAL(3, refs.size());
+  VERIFY_SUCCEEDED(refs.begin()[0]->GetLocation(&loc));
+  VERIFY_SUCCEEDED(loc->GetSpellingLocation(nullptr, &line, nullptr, nullptr));
+  VERIFY_ARE_EQUAL(1, line);
+
+  VERIFY_SUCCEEDED(TU2->FindReferences(varRefCursor, file, 1, 1, pagedRefs.size_ref(), pagedRefs.data_ref()));
+  VERIFY_ARE_EQUAL(1, pagedRefs.size());
+
+  VERIFY_SUCCEEDED(TU2->FindDefinition(varRefCursor, &defCursor));
+  loc.Release();
+  VERIFY_SUCCEEDED(defCursor->GetLocation(&loc));
+  VERIFY_SUCCEEDED(loc->GetSpellingLocation(nullptr, &line, nullptr, nullptr));
+  VERIFY_ARE_EQUAL(1, line);
+}
 
 TEST_F(DXIntellisenseTest, TUWhenGetFileMissingThenFail) {
   const char program[] = "int i;";
@@ -76,6 +76,10 @@ public:
   TEST_METHOD(DisassemblyWhenValidThenOK)
   TEST_METHOD(ValidateFromLL_Abs2)
   TEST_METHOD(DxilContainerUnitTest)
+  TEST_METHOD(CompileWhenCompressDebugThenDebugInfoDecompresses)
+  TEST_METHOD(ReflectionWhenReloadedThenShared)
+  TEST_METHOD(CompileWhenEmbedStatsThenStatisticsPartMatchesReflection)
+  TEST_METHOD(ShaderPackWhenWrittenThenContainersUsedInPlace)
 
   TEST_METHOD(ReflectionMatchesDXBC_CheckIn)
   BEGIN_TEST_METHOD(ReflectionMatchesDXBC_Full)
@@ -995,4 +999,168 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
   VERIFY_IS_NULL(hlsl::GetDxilProgramHeader(&header, hlsl::DxilFourCC::DFCC_DXIL));
   VERIFY_IS_NULL(hlsl::GetDxilPartByType(&header, hlsl::DxilFourCC::DFCC_DXIL));
 
-}
\ No newline at end of file
+}
+
+TEST_F(DxilContainerTest, CompileWhenCompressDebugThenDebugInfoDecompresses) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcOperationResult> pResult;
+  LPCWSTR arguments[] = { L"/Zi", L"/Qcompress_debug" };
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 a : A) : SV_Target { return a * 2; }", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"ps_6_0", arguments, _countof(arguments), nullptr, 0, nullptr, &pResult));
+  HRESULT hrStatus;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&hrStatus));
+  VERIFY_SUCCEEDED(hrStatus);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  // The compressed part replaces the debug info part.
+  const hlsl::DxilContainerHeader *pHeader = static_cast<const hlsl::DxilContainerHeader *> (pProgram->GetBufferPointer());
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(pHeader, pProgram->GetBufferSize()));
+  VERIFY_IS_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
+  const hlsl::DxilPartHeader *pCompressedPart = hlsl::GetDxilPartByType(pHeader, hlsl::DxilFourCC::DFCC_ShaderDebugInfoCompressed);
+  VERIFY_IS_NOT_NULL(pCompressedPart);
+
+  std::vector<char> partStorage;
+  const hlsl::DxilPartHeader *pPart = hlsl::GetDxilDebugInfoPart(pHeader, partStorage);
+  VERIFY_IS_NOT_NULL(pPart);
+  VERIFY_ARE_EQUAL((uint32_t)hlsl::DFCC_ShaderDebugInfoDXIL, pPart->PartFourCC);
+  VERIFY_IS_LESS_THAN(pCompressedPart->PartSize, pPart->PartSize);
+  VERIFY_IS_TRUE(hlsl::IsValidDxilProgramHeader(
+      reinterpret_cast<const hlsl::DxilProgramHeader *>(hlsl::GetDxilPartData(pPart)),
+      pPart->PartSize));
+
+  // Reflection of the compressed part reads the DXIL part, so it shares its
+  // reflection.
+  CComPtr<IDxcContainerReflection> pReflection;
+  UINT32 index, dxilIndex;
+  CComPtr<ID3D12ShaderReflection> pShaderReflection, pDxilReflection;
+  D3D12_SHADER_DESC desc;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection, &pReflection));
+  VERIFY_SUCCEEDED(pReflection->Load(pProgram));
+  VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_ShaderDebugInfoCompressed, &index));
+  VERIFY_SUCCEEDED(pReflection->GetPartReflection(index, __uuidof(ID3D12ShaderReflection), (void **)&pShaderReflection));
+  VERIFY_SUCCEEDED(pShaderReflection->GetDesc(&desc));
+  VERIFY_ARE_EQUAL(1u, desc.InputParameters);
+  VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &dxilIndex));
+  VERIFY_SUCCEEDED(pReflection->GetPartReflection(dxilIndex, __uuidof(ID3D12ShaderReflection), (void **)&pDxilReflection));
+  VERIFY_ARE_EQUAL(pDxilReflection.p, pShaderReflection.p);
+}
+
+TEST_F(DxilContainerTest, ReflectionWhenReloadedThenShared) {
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pOtherProgram;
+  CompileToProgram("float4 main(float4 a : A) : SV_Target { return a * 2; }",
+                   L"main", L"ps_6_0", nullptr, 0, &pProgram);
+  CompileToProgram("float4 main(float4 a : A) : SV_Target { return a * 3; }",
+                   L"main", L"ps_6_0", nullptr, 0, &pOtherProgram);
+
+  CComPtr<IDxcContainerReflection> pReflection;
+  UINT32 index;
+  CComPtr<ID3D12ShaderReflection> pFirst, pSecond, pThird;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection, &pReflection));
+  VERIFY_SUCCEEDED(pReflection->Load(pProgram));
+  VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &index));
+  VERIFY_SUCCEEDED(pReflection->GetPartReflection(index, __uuidof(ID3D12ShaderReflection), (void **)&pFirst));
+
+  // Another blob holding the same container shares the reflection.
+  CComPtr<IDxcBlobEncoding> pCopy;
+  CreateBlobPinned(pProgram->GetBufferPointer(), pProgram->GetBufferSize(), CP_ACP, &pCopy);
+  VERIFY_SUCCEEDED(pReflection->Load(pCopy));
+  VERIFY_SUCCEEDED(pReflection->GetPartReflection(index, __uuidof(ID3D12ShaderReflection), (void **)&pSecond));
+  VERIFY_ARE_EQUAL(pFirst.p, pSecond.p);
+
+  // Another container doesn't.
+  VERIFY_SUCCEEDED(pReflection->Load(pOtherProgram));
+  VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &index));
+  VERIFY_SUCCEEDED(pReflection->GetPartReflection(index, __uuidof(ID3D12ShaderReflection), (void **)&pThird));
+  VERIFY_ARE_NOT_EQUAL(pFirst.p, pThird.p);
+}
+
+TEST_F(DxilContainerTest, CompileWhenEmbedStatsThenStatisticsPartMatchesReflection) {
+  const char *pSource =
+      "Texture2D tex; SamplerState samp;\n"
+      "float4 main(float2 uv : TEXCOORD) : SV_Target {\n"
+      "  return tex.Sample(samp, uv) * sin(uv.x);\n"
+      "}";
+  LPCWSTR statsArgs[] = { L"/Qembed_stats" };
+  CComPtr<IDxcBlob> pProgram, pPlainProgram;
+  CompileToProgram(pSource, L"main", L"ps_6_0", statsArgs, _countof(statsArgs), &pProgram);
+  CompileToProgram(pSource, L"main", L"ps_6_0", nullptr, 0, &pPlainProgram);
+
+  CComPtr<IDxcContainerReflection> pReflection;
+  UINT32 index;
+  CComPtr<IDxcBlob> pPart;
+  CComPtr<ID3D12ShaderReflection> pShaderReflection, pPlainReflection;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection, &pReflection));
+  VERIFY_SUCCEEDED(pReflection->Load(pProgram));
+  VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_ShaderStatistics, &index));
+  VERIFY_SUCCEEDED(pReflection->GetPartContent(index, &pPart));
+  VERIFY_ARE_EQUAL(sizeof(hlsl::DxilShaderStatistics), pPart->GetBufferSize());
+  const hlsl::DxilShaderStatistics *pStats =
+      (const hlsl::DxilShaderStatistics *)pPart->GetBufferPointer();
+  VERIFY_ARE_EQUAL(hlsl::DxilShaderStatisticsVersion, pStats->Version);
+  VERIFY_ARE_EQUAL(1u, pStats->SampleCount);
+  VERIFY_ARE_EQUAL(1u, pStats->TranscendentalCount);
+  VERIFY_IS_TRUE(pStats->MaxLiveValues > 0);
+
+  // Without the part, reflection computes the same counts from the code.
+  D3D12_SHADER_DESC desc, plainDesc;
+  VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &index));
+  VERIFY_SUCCEEDED(pReflection->GetPartReflection(index, __uuidof(ID3D12ShaderReflection), (void **)&pShaderReflection));
+  VERIFY_SUCCEEDED(pShaderReflection->GetDesc(&desc));
+  VERIFY_SUCCEEDED(pReflection->Load(pPlainProgram));
+  VERIFY_IS_TRUE(FAILED(pReflection->FindFirstPartKind(hlsl::DFCC_ShaderStatistics, &index)));
+  VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &index));
+  VERIFY_SUCCEEDED(pReflection->GetPartReflection(index, __uuidof(ID3D12ShaderReflection), (void **)&pPlainReflection));
+  VERIFY_SUCCEEDED(pPlainReflection->GetDesc(&plainDesc));
+  VERIFY_ARE_EQUAL(pStats->InstructionCount, desc.InstructionCount);
+  VERIFY_ARE_EQUAL(desc.InstructionCount, plainDesc.InstructionCount);
+  VERIFY_ARE_EQUAL(desc.TempRegisterCount, plainDesc.TempRegisterCount);
+  VERIFY_ARE_EQUAL(1u, plainDesc.TextureNormalInstructions);
+}
+
+TEST_F(DxilContainerTest, ShaderPackWhenWrittenThenContainersUsedInPlace) {
+  CComPtr<IDxcBlob> pProgram, pOtherProgram, pSameProgram;
+  CompileToProgram("float4 main(float4 a : A) : SV_Target { return a * 2; }",
+                   L"main", L"ps_6_0", nullptr, 0, &pProgram);
+  CompileToProgram("float4 main(float4 a : A) : SV_Target { return a * 3; }",
+                   L"main", L"ps_6_0", nullptr, 0, &pOtherProgram);
+  CompileToProgram("float4 main(float4 a : A) : SV_Target { return a * 2; }",
+                   L"main", L"ps_6_0", nullptr, 0, &pSameProgram);
+  const hlsl::DxilContainerHeader *pHeader = (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer();
+  const hlsl::DxilContainerHeader *pOtherHeader = (const hlsl::DxilContainerHeader *)pOtherProgram->GetBufferPointer();
+
+  // The same shader is only packed once.
+  hlsl::DxilShaderPackWriter writer;
+  VERIFY_IS_TRUE(writer.AddContainer(pHeader));
+  VERIFY_IS_TRUE(writer.AddContainer(pOtherHeader));
+  VERIFY_IS_FALSE(writer.AddContainer((const hlsl::DxilContainerHeader *)pSameProgram->GetBufferPointer()));
+  VERIFY_ARE_EQUAL(2u, writer.GetContainerCount());
+
+  std::vector<char> pack;
+  writer.Write([&](const void *pData, size_t size) {
+    pack.insert(pack.end(), (const char *)pData, (const char *)pData + size);
+  });
+  VERIFY_ARE_EQUAL(writer.GetPackSize(), (uint64_t)pack.size());
+  const hlsl::DxilShaderPackHeader *pPack = (const hlsl::DxilShaderPackHeader *)pack.data();
+  VERIFY_IS_TRUE(hlsl::IsValidDxilShaderPack(pPack, pack.size()));
+  VERIFY_IS_FALSE(hlsl::IsValidDxilShaderPack(pPack, pack.size() - 1));
+
+  // Containers are found by shader hash and read where they are.
+  hlsl::DxilShaderHash hash;
+  hlsl::GetDxilContainerShaderHash(pOtherHeader, &hash);
+  const hlsl::DxilContainerHeader *pFound = hlsl::FindDxilShaderPackContainer(pPack, hash.Digest);
+  VERIFY_IS_NOT_NULL(pFound);
+  VERIFY_ARE_EQUAL(0u, ((const char *)pFound - pack.data()) % hlsl::DxilShaderPackAlignment);
+  VERIFY_ARE_EQUAL(pOtherHeader->ContainerSizeInBytes, pFound->ContainerSizeInBytes);
+  VERIFY_ARE_EQUAL(0, memcmp(pOtherHeader, pFound, pFound->ContainerSizeInBytes));
+  VERIFY_ARE_EQUAL(pOtherHeader->PartCount,
+                   (uint32_t)std::distance(hlsl::begin(pFound), hlsl::end(pFound)));
+  VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pFound, hlsl::DFCC_DXIL));
+
+  hash.Digest[0] ^= 0xFF;
+  VERIFY_IS_NULL(hlsl::FindDxilShaderPackContainer(pPack, hash.Digest));
+}
@@ -227,6 +227,8 @@ public:
     TEST_METHOD_PROPERTY(L"Priority", L"0")
   END_TEST_CLASS()
   TEST_CLASS_SETUP(ExecutionTestClassSetup)
+  TEST_METHOD_SETUP(BeginTiming)
+  TEST_METHOD_CLEANUP(EndTiming)
 
   TEST_METHOD(BasicComputeTest);
   TEST_METHOD(BasicTriangleTest);
@@ -245,6 +247,13 @@ public:
   TEST_METHOD(WaveIntrinsicsInPSTest);
   TEST_METHOD(PartialDerivTest);
 
+  BEGIN_TEST_METHOD(ShaderOpBenchmarkTest)
+    TEST_METHOD_PROPERTY(L"Priority", L"2") // Only useful when asked for with /p:BenchmarkShaderOp.
+  END_TEST_METHOD()
+  BEGIN_TEST_METHOD(WaveOpBenchmarkTest)
+    TEST_METHOD_PROPERTY(L"Priority", L"2") // Takes minutes; reports throughput rather than checking results.
+  END_TEST_METHOD()
+
   BEGIN_TEST_METHOD(CBufferTestHalf)
     TEST_METHOD_PROPERTY(L"Priority", L"2") // Remove this line once warp supports this feature in Shader Model 6.2
   END_TEST_METHOD()
@@ -939,6 +948,14 @@ bool ExecutionTest::ExecutionTestClassSetup() {
 #endif
 }
 
+bool ExecutionTest::BeginTiming() {
+  return hlsl_test::BeginTestTiming();
+}
+
+bool ExecutionTest::EndTiming() {
+  return hlsl_test::EndTestTiming();
+}
+
 void ExecutionTest::RunRWByteBufferComputeTest(ID3D12Device *pDevice, LPCSTR pShader, std::vector<uint32_t> &values) {
   static const int DispatchGroupX = 1;
   static const int DispatchGroupY = 1;
@@ -2094,6 +2111,214 @@ RunShaderOpTest(ID3D12Device *pDevice, dxc::DxcDllSupport &support,
   return RunShaderOpTestAfterParse(pDevice, support, pName, pInitCallback, ShaderOpSet);
 }
 
+// Reads the BenchmarkRuns and BenchmarkVariants runtime parameters.
+static UINT GetBenchmarkRunCount(UINT DefaultCount) {
+  WEX::Common::String RunsValue;
+  UINT RunCount = DefaultCount;
+  if (SUCCEEDED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"BenchmarkRuns", RunsValue)) &&
+      !RunsValue.IsEmpty())
+    RunCount = (UINT)_wtoi(RunsValue);
+  VERIFY_IS_TRUE(RunCount > 0);
+  return RunCount;
+}
+
+static std::vector<std::wstring> GetBenchmarkVariants() {
+  WEX::Common::String VariantsValue;
+  if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"BenchmarkVariants", VariantsValue)) ||
+      VariantsValue.IsEmpty())
+    VariantsValue = L"-O0;-O3";
+
+  std::vector<std::wstring> Variants;
+  std::wstring VariantList = (LPCWSTR)VariantsValue;
+  for (size_t Start = 0; Start <= VariantList.size();) {
+    size_t End = VariantList.find(L';', Start);
+    if (End == std::wstring::npos)
+      End = VariantList.size();
+    Variants.push_back(VariantList.substr(Start, End - Start));
+    Start = End + 1;
+  }
+  return Variants;
+}
+
+// Sets the arguments of each shader to its original ones followed by
+// ExtraArguments; the strings are owned by pShaderOp.
+static void SetShaderOpArguments(st::ShaderOp *pShaderOp,
+                                 const std::vector<LPCSTR> &OrigArguments,
+                                 LPCSTR ExtraArguments) {
+  for (size_t j = 0; j < pShaderOp->Shaders.size(); ++j) {
+    std::string Arguments = OrigArguments[j] ? OrigArguments[j] : "";
+    if (!Arguments.empty())
+      Arguments += ' ';
+    Arguments += ExtraArguments;
+    pShaderOp->Shaders[j].Arguments =
+        pShaderOp->Strings.insert(Arguments.c_str());
+  }
+}
+
+static std::wstring GetAdapterName(ID3D12Device *pDevice) {
+  CComPtr<IDXGIFactory4> factory;
+  CComPtr<IDXGIAdapter1> adapter;
+  DXGI_ADAPTER_DESC1 AdapterDesc;
+  if (FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory))) ||
+      FAILED(factory->EnumAdapterByLuid(pDevice->GetAdapterLuid(),
+                                        IID_PPV_ARGS(&adapter))) ||
+      FAILED(adapter->GetDesc1(&AdapterDesc)))
+    return L"unknown adapter";
+  return AdapterDesc.Description;
+}
+
+// Times a shader operation compiled with each variant of its arguments, to
+// catch compiler changes that slow down execution. Runtime parameters:
+//   BenchmarkShaderOp - name of the operation to run.
+//   BenchmarkFile     - file with the operation; ShaderOpArith.xml by default.
+//   BenchmarkRuns     - runs of each variant; 100 by default.
+//   BenchmarkVariants - arguments added to the shaders' own, one variant per
+//                       ';'-separated item; "-O0;-O3" by default.
+TEST_F(ExecutionTest, ShaderOpBenchmarkTest) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  WEX::Common::String OpName, FileName;
+  if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"BenchmarkShaderOp", OpName)) ||
+      OpName.IsEmpty()) {
+    LogCommentFmt(L"Use /p:BenchmarkShaderOp=<name> to pick the operation to benchmark.");
+    WEX::Logging::Log::Result(WEX::Logging::TestResults::Skipped);
+    return;
+  }
+  if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"BenchmarkFile", FileName)) ||
+      FileName.IsEmpty())
+    FileName = L"ShaderOpArith.xml";
+  UINT RunCount = GetBenchmarkRunCount(100);
+  std::vector<std::wstring> Variants = GetBenchmarkVariants();
+
+  CComPtr<ID3D12Device> pDevice;
+  if (!CreateDevice(&pDevice))
+    return;
+
+  CComPtr<IStream> pStream;
+  ReadHlslDataIntoNewStream(FileName, &pStream);
+  std::shared_ptr<st::ShaderOpSet> ShaderOpSet =
+      std::make_shared<st::ShaderOpSet>();
+  st::ParseShaderOpSetFromStream(pStream, ShaderOpSet.get());
+  CW2A OpNameUtf8(OpName, CP_UTF8);
+  st::ShaderOp *pShaderOp = ShaderOpSet->GetShaderOp(OpNameUtf8.m_psz);
+  VERIFY_IS_NOT_NULL(pShaderOp);
+  pShaderOp->UseWarpDevice = GetTestParamUseWARP(true);
+
+  std::vector<LPCSTR> OrigArguments;
+  for (st::ShaderOpShader &S : pShaderOp->Shaders)
+    OrigArguments.push_back(S.Arguments);
+
+  double BaselineMs = 0;
+  for (size_t i = 0; i < Variants.size(); ++i) {
+    CW2A VariantUtf8(Variants[i].c_str(), CP_UTF8);
+    SetShaderOpArguments(pShaderOp, OrigArguments, VariantUtf8.m_psz);
+
+    // Each variant gets its own pipeline and resources.
+    st::ShaderOpTest Test;
+    st::ShaderOpBenchmarkResult Result;
+    Test.SetDxcSupport(&m_support);
+    Test.SetDevice(pDevice);
+    Test.BenchmarkShaderOp(pShaderOp, RunCount, &Result);
+    if (i == 0)
+      BaselineMs = Result.MedianMs;
+    LogCommentFmt(L"%s [%s]: median %.4f ms, p99 %.4f ms, min %.4f ms, "
+                  L"max %.4f ms over %u runs (%.1f%% of the first variant)",
+                  (LPCWSTR)OpName, Variants[i].c_str(), Result.MedianMs,
+                  Result.P99Ms, Result.MinMs, Result.MaxMs, Result.RunCount,
+                  BaselineMs > 0 ? Result.MedianMs * 100 / BaselineMs : 100.0);
+  }
+
+  for (size_t j = 0; j < pShaderOp->Shaders.size(); ++j)
+    pShaderOp->Shaders[j].Arguments = OrigArguments[j];
+}
+
+// Measures the throughput of each pattern of the WaveOpBenchmark shader
+// operation, compiled with each variant, on the selected adapter. An
+// operation is one loop iteration in one thread. Takes the BenchmarkRuns
+// and BenchmarkVariants runtime parameters of ShaderOpBenchmarkTest; use
+// /p:Adapter to pick the adapter.
+TEST_F(ExecutionTest, WaveOpBenchmarkTest) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  // The patterns, in BENCH_OP order.
+  struct WaveOpBenchmark {
+    LPCWSTR Name;
+    bool UsesWaveOps;
+  };
+  static const WaveOpBenchmark Benchmarks[] = {
+    { L"WaveActiveSum", true },
+    { L"WaveActiveMax", true },
+    { L"WavePrefixSum", true },
+    { L"WaveActiveBitOr", true },
+    { L"WaveReadLaneFirst", true },
+    { L"WaveActiveCountBits", true },
+    { L"InterlockedAdd, one address", false },
+    { L"InterlockedAdd, address per thread", false },
+    { L"InterlockedMax, one address", false },
+    { L"GroupMemoryBarrierWithGroupSync", false },
+    { L"DeviceMemoryBarrier", false },
+    { L"groupshared, consecutive words", false },
+    { L"groupshared, same bank", false },
+    { L"groupshared, same word", false },
+  };
+  const UINT Iterations = 256;
+  const UINT ThreadsPerGroup = 64; // numthreads of WaveOpBenchmark.
+  UINT RunCount = GetBenchmarkRunCount(20);
+  std::vector<std::wstring> Variants = GetBenchmarkVariants();
+
+  CComPtr<ID3D12Device> pDevice;
+  if (!CreateDevice(&pDevice))
+    return;
+  bool bWaveOps = DoesDeviceSupportWaveOps(pDevice);
+  if (!bWaveOps)
+    LogCommentFmt(L"Device does not support wave operations; skipping those.");
+  std::wstring AdapterName = GetAdapterName(pDevice);
+
+  CComPtr<IStream> pStream;
+  ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
+  std::shared_ptr<st::ShaderOpSet> ShaderOpSet =
+      std::make_shared<st::ShaderOpSet>();
+  st::ParseShaderOpSetFromStream(pStream, ShaderOpSet.get());
+  st::ShaderOp *pShaderOp = ShaderOpSet->GetShaderOp("WaveOpBenchmark");
+  VERIFY_IS_NOT_NULL(pShaderOp);
+  pShaderOp->UseWarpDevice = GetTestParamUseWARP(true);
+  double OpsPerRun = (double)pShaderOp->DispatchX * pShaderOp->DispatchY *
+                     pShaderOp->DispatchZ * ThreadsPerGroup * Iterations;
+
+  std::vector<LPCSTR> OrigArguments;
+  for (st::ShaderOpShader &S : pShaderOp->Shaders)
+    OrigArguments.push_back(S.Arguments);
+
+  for (UINT Op = 0; Op < _countof(Benchmarks); ++Op) {
+    if (Benchmarks[Op].UsesWaveOps && !bWaveOps)
+      continue;
+    for (const std::wstring &Variant : Variants) {
+      CW2A VariantUtf8(Variant.c_str(), CP_UTF8);
+      char Arguments[256];
+      VERIFY_IS_TRUE(
+          sprintf_s(Arguments, "-DBENCH_OP=%u -DBENCH_ITERATIONS=%u %s", Op,
+                    Iterations, VariantUtf8.m_psz) > 0);
+      SetShaderOpArguments(pShaderOp, OrigArguments, Arguments);
+
+      st::ShaderOpTest Test;
+      st::ShaderOpBenchmarkResult Result;
+      Test.SetDxcSupport(&m_support);
+      Test.SetDevice(pDevice);
+      Test.BenchmarkShaderOp(pShaderOp, RunCount, &Result);
+      double OpsPerSecond =
+          Result.MedianMs > 0 ? OpsPerRun * 1000 / Result.MedianMs : 0;
+      LogCommentFmt(L"%s [%s] on %s: %.3f Gops/s, median %.4f ms over %u runs",
+                    Benchmarks[Op].Name, Variant.c_str(), AdapterName.c_str(),
+                    OpsPerSecond / 1e9, Result.MedianMs, Result.RunCount);
+    }
+  }
+
+  for (size_t j = 0; j < pShaderOp->Shaders.size(); ++j)
+    pShaderOp->Shaders[j].Arguments = OrigArguments[j];
+}
+
 TEST_F(ExecutionTest, OutOfBoundsTest) {
   WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
   CComPtr<IStream> pStream;
@@ -167,6 +167,51 @@ inline bool GetTestParamBool(LPCWSTR name) {
                                    NameValue, NameValue.GetLength());
 }
 
+// Per-test wall times, which utils/hct/hcttestshard.py collects and compares
+// against a baseline. With /p:"TestTimingFile=<path>", each test appends its
+// name, a tab and its milliseconds to the file when it finishes. Tests may
+// run on several threads and in several processes, so each line is written
+// with one append.
+inline LARGE_INTEGER &GetTestTimingStart() {
+  static __declspec(thread) LARGE_INTEGER start;
+  return start;
+}
+
+inline bool BeginTestTiming() {
+  QueryPerformanceCounter(&GetTestTimingStart());
+  return true;
+}
+
+inline bool EndTestTiming() {
+  LARGE_INTEGER end, frequency;
+  QueryPerformanceCounter(&end);
+  QueryPerformanceFrequency(&frequency);
+  WEX::Common::String FileValue;
+  WEX::Common::String NameValue;
+  if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"TestTimingFile", FileValue)) ||
+      FileValue.IsEmpty() ||
+      FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"TestName", NameValue))) {
+    return true;
+  }
+  double ms = (double)(end.QuadPart - GetTestTimingStart().QuadPart) * 1000 /
+              (double)frequency.QuadPart;
+  char msText[32];
+  sprintf_s(msText, _countof(msText), "\t%.3f\n", ms);
+  std::string line = CW2A(NameValue, CP_UTF8).m_psz;
+  line += msText;
+  HANDLE hFile = CreateFileW(FileValue, FILE_APPEND_DATA,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                             OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile != INVALID_HANDLE_VALUE) {
+    DWORD written;
+    WriteFile(hFile, line.data(), (DWORD)line.size(), &written, nullptr);
+    CloseHandle(hFile);
+  }
+  return true;
+}
+
 inline bool GetTestParamUseWARP(bool defaultVal) {
   WEX::Common::String AdapterValue;
   if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
@@ -40,10 +40,13 @@ public:
 
   TEST_METHOD(RunLinkResource);
   TEST_METHOD(RunLinkAllProfiles);
+  TEST_METHOD(RunLinkRepeated);
+  TEST_METHOD(RunLinkBatch);
   TEST_METHOD(RunLinkFailNoDefine);
   TEST_METHOD(RunLinkFailReDefine);
   TEST_METHOD(RunLinkGlobalInit);
   TEST_METHOD(RunLinkNoAlloca);
+  TEST_METHOD(RunLinkConstArg);
   TEST_METHOD(RunLinkFailReDefineGlobal);
   TEST_METHOD(RunLinkFailProfileMismatch);
   TEST_METHOD(RunLinkFailEntryNoProps);
@@ -166,6 +169,83 @@ TEST_F(LinkerTest, RunLinkAllProfiles) {
   Link(L"cs_main", L"cs_6_0", pLinker, {libName, libResName}, {},{});
 }
 
+TEST_F(LinkerTest, RunLinkRepeated) {
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"entry";
+
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib);
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  // Linking again, after other entries, gives the same container.
+  auto LinkVS = [&](IDxcBlob **ppProgram) {
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pLinker->Link(L"vs_main", L"vs_6_0", &libName, 1,
+                                   nullptr, 0, &pResult));
+    CheckOperationSucceeded(pResult, ppProgram);
+  };
+  CComPtr<IDxcBlob> pFirst, pSecond;
+  LinkVS(&pFirst);
+  Link(L"ps_main", L"ps_6_0", pLinker, {libName}, {},{});
+  LinkVS(&pSecond);
+  VERIFY_ARE_EQUAL(pFirst->GetBufferSize(), pSecond->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pFirst->GetBufferPointer(),
+                             pSecond->GetBufferPointer(),
+                             pFirst->GetBufferSize()));
+}
+
+TEST_F(LinkerTest, RunLinkBatch) {
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+  CComPtr<IDxcLinkerBatch> pBatch;
+  VERIFY_SUCCEEDED(pLinker.QueryInterface(&pBatch));
+
+  LPCWSTR libName = L"entry";
+
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_entries2.hlsl", &pEntryLib);
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  // vs_main goes through the link cache; the other entries are linked.
+  CComPtr<IDxcOperationResult> pVSResult;
+  VERIFY_SUCCEEDED(pLinker->Link(L"vs_main", L"vs_6_0", &libName, 1, nullptr,
+                                 0, &pVSResult));
+  CComPtr<IDxcBlob> pVSProgram;
+  CheckOperationSucceeded(pVSResult, &pVSProgram);
+
+  LPCWSTR entries[] = { L"vs_main", L"hs_main", L"ds_main", L"gs_main",
+                        L"ps_main" };
+  LPCWSTR profiles[] = { L"vs_6_0", L"hs_6_0", L"ds_6_0", L"gs_6_0",
+                         L"ps_6_0" };
+  const UINT32 entryCount = _countof(entries);
+  IDxcOperationResult *ppResults[entryCount] = {};
+  VERIFY_SUCCEEDED(pBatch->LinkBatch(entryCount, entries, profiles, &libName,
+                                     1, nullptr, 0, ppResults));
+
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(
+      m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  for (UINT32 i = 0; i < entryCount; ++i) {
+    CComPtr<IDxcOperationResult> pResult;
+    pResult.Attach(ppResults[i]);
+    CComPtr<IDxcBlob> pProgram;
+    CheckOperationSucceeded(pResult, &pProgram);
+    CComPtr<IDxcBlobEncoding> pDisassembly;
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pProgram, &pDisassembly));
+    std::string IR = BlobToUtf8(pDisassembly);
+    VERIFY_IS_TRUE(IR.find(CW2A(entries[i], CP_UTF8).m_psz) !=
+                   std::string::npos);
+    if (i == 0) {
+      VERIFY_ARE_EQUAL(pVSProgram->GetBufferSize(), pProgram->GetBufferSize());
+      VERIFY_IS_TRUE(0 == memcmp(pVSProgram->GetBufferPointer(),
+                                 pProgram->GetBufferPointer(),
+                                 pProgram->GetBufferSize()));
+    }
+  }
+}
+
 TEST_F(LinkerTest, RunLinkFailNoDefine) {
   CComPtr<IDxcBlob> pEntryLib;
   CompileLib(L"..\\CodeGenHLSL\\lib_cs_entry.hlsl", &pEntryLib);
@@ -280,6 +360,26 @@ TEST_F(LinkerTest, RunLinkNoAlloca) {
   Link(L"ps_main", L"ps_6_0", pLinker, {libName, libName2}, {}, {"alloca"});
 }
 
+TEST_F(LinkerTest, RunLinkConstArg) {
+  CComPtr<IDxcBlob> pEntryLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_const_arg.hlsl", &pEntryLib);
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\lib_const_arg.h", &pLib);
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"ps_main";
+  RegisterDxcModule(libName, pEntryLib, pLinker);
+
+  LPCWSTR libName2 = L"test";
+  RegisterDxcModule(libName2, pLib, pLinker);
+
+  // The sin for other modes is folded away once mode is known.
+  Link(L"ps_main", L"ps_6_0", pLinker, {libName, libName2}, {},
+       {"dx.op.unary.f32(i32 13"});
+}
+
 TEST_F(LinkerTest, RunLinkFailSelectRes) {
   if (m_ver.SkipDxilVersion(1, 3)) return;
   CComPtr<IDxcBlob> pEntryLib;
@@ -89,6 +89,13 @@ public:
   TEST_METHOD(OptimizerWhenSlice1ThenOK)
   TEST_METHOD(OptimizerWhenSlice2ThenOK)
   TEST_METHOD(OptimizerWhenSlice3ThenOK)
+  TEST_METHOD(OptimizerWhenPipelineBatchThenSameAsRunOptimizer)
+  TEST_METHOD(OptimizerWhenModuleHandleThenSameAsCompile)
+  TEST_METHOD(OptimizerWhenBenchmarkPassThenModuleUnchanged)
+
+  BEGIN_TEST_METHOD(OptimizerPassBenchmarkTest)
+    TEST_METHOD_PROPERTY(L"Priority", L"2") // Only useful when asked for with /p:BenchmarkPassCorpus.
+  END_TEST_METHOD()
 
   void OptimizerWhenSliceNThenOK(int optLevel);
   void OptimizerWhenSliceNThenOK(int optLevel, LPCWSTR pText, LPCWSTR pTarget);
@@ -142,6 +149,329 @@ void OptimizerTest::OptimizerWhenSliceNThenOK(int optLevel) {
     L"}";
   OptimizerWhenSliceNThenOK(optLevel, SampleProgram, L"ps_6_0");
 }
+
+TEST_F(OptimizerTest, OptimizerWhenPipelineBatchThenSameAsRunOptimizer) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer> pOptimizer;
+  CComPtr<IDxcOptimizer2> pOptimizer2;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pOptDump;
+
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  VERIFY_SUCCEEDED(pOptimizer.QueryInterface(&pOptimizer2));
+
+  LPCWSTR Programs[] = {
+    L"float4 main(float4 pos : SV_Position) : SV_Target { return pos * 2; }",
+    L"float4 main(float4 pos : SV_Position, bool b : B) : SV_Target {\r\n"
+    L"  if (b) pos = pos.yxwz;\r\n"
+    L"  return pos;\r\n"
+    L"}",
+    L"float f(float a) { return a + 1; }\r\n"
+    L"float4 main(float4 pos : SV_Position) : SV_Target { return f(pos.x); }",
+  };
+  const UINT32 ProgramCount = _countof(Programs);
+
+  // Get the high-level compile of each program.
+  CComPtr<IDxcBlob> pHighLevelBlobs[ProgramCount];
+  IDxcBlob *ppHighLevelBlobs[ProgramCount];
+  LPCWSTR highLevelArgs[] = { L"/Vd", L"/O3", L"/fcgl" };
+  for (UINT32 i = 0; i < ProgramCount; ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    Utf16ToBlob(m_dllSupport, Programs[i], &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", highLevelArgs, _countof(highLevelArgs), nullptr, 0, nullptr,
+      &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pHighLevelBlobs[i]));
+    pResult.Release();
+    ppHighLevelBlobs[i] = pHighLevelBlobs[i];
+  }
+
+  // Get the list of passes for this configuration.
+  CComPtr<IDxcBlobEncoding> pSource;
+  Utf16ToBlob(m_dllSupport, Programs[0], &pSource);
+  LPCWSTR optDumpArgs[] = { L"/Vd", L"/O3", L"/Odump" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", optDumpArgs, _countof(optDumpArgs), nullptr, 0, nullptr,
+    &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pOptDump));
+  pResult.Release();
+  CA2W passesW(BlobToUtf8(pOptDump).c_str(), CP_UTF8);
+  std::vector<LPCWSTR> passList;
+  SplitPassList(passesW.m_psz, passList);
+
+  VERIFY_SUCCEEDED(pOptimizer2->CreatePipeline(passList.data(),
+    (UINT32)passList.size(), &pPipeline));
+  IDxcBlob *ppOutputModules[ProgramCount];
+  VERIFY_SUCCEEDED(pPipeline->RunBatch(ProgramCount, ppHighLevelBlobs,
+    /*threadCount*/ 2, ppOutputModules, nullptr));
+  CComPtr<IDxcBlob> pOutputModules[ProgramCount];
+  for (UINT32 i = 0; i < ProgramCount; ++i)
+    pOutputModules[i].Attach(ppOutputModules[i]);
+
+  // Each module should match what RunOptimizer produces for it.
+  for (UINT32 i = 0; i < ProgramCount; ++i) {
+    CComPtr<IDxcBlob> pModule;
+    VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(pHighLevelBlobs[i],
+      passList.data(), (UINT32)passList.size(), &pModule, nullptr));
+
+    CComPtr<IDxcBlob> pAssembledBlob, pBatchAssembledBlob;
+    AssembleToContainer(m_dllSupport, pModule, &pAssembledBlob);
+    AssembleToContainer(m_dllSupport, pOutputModules[i], &pBatchAssembledBlob);
+    std::string assembly = DisassembleProgram(m_dllSupport, pAssembledBlob);
+    std::string batchAssembly =
+        DisassembleProgram(m_dllSupport, pBatchAssembledBlob);
+    VERIFY_ARE_EQUAL_STR(assembly.c_str(), batchAssembly.c_str());
+  }
+}
+
+TEST_F(OptimizerTest, OptimizerWhenModuleHandleThenSameAsCompile) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer> pOptimizer;
+  CComPtr<IDxcOptimizer2> pOptimizer2;
+  CComPtr<IDxcAssembler> pAssembler;
+  CComPtr<IDxcAssembler2> pAssembler2;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pHighLevelBlob;
+  CComPtr<IDxcBlob> pOptDump;
+
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  VERIFY_SUCCEEDED(pOptimizer.QueryInterface(&pOptimizer2));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+  VERIFY_SUCCEEDED(pAssembler.QueryInterface(&pAssembler2));
+
+  Utf16ToBlob(m_dllSupport,
+    L"Texture2D g_Tex;\r\n"
+    L"SamplerState g_Sampler;\r\n"
+    L"float4 main(float4 pos : SV_Position, bool b : B) : SV_Target {\r\n"
+    L"  if (b) pos = g_Tex.Sample(g_Sampler, pos.xy);\r\n"
+    L"  return pos;\r\n"
+    L"}", &pSource);
+
+  LPCWSTR args[] = { L"/O3" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  pResult.Release();
+  std::string originalAssembly = DisassembleProgram(m_dllSupport, pProgram);
+
+  LPCWSTR optDumpArgs[] = { L"/O3", L"/Odump" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", optDumpArgs, _countof(optDumpArgs), nullptr, 0, nullptr,
+    &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pOptDump));
+  pResult.Release();
+  CA2W passesW(BlobToUtf8(pOptDump).c_str(), CP_UTF8);
+  std::vector<LPCWSTR> passList;
+  SplitPassList(passesW.m_psz, passList);
+
+  LPCWSTR highLevelArgs[] = { L"/O3", L"/fcgl" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", highLevelArgs, _countof(highLevelArgs), nullptr, 0, nullptr,
+    &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pHighLevelBlob));
+  pResult.Release();
+
+  // Load the module once, optimize it in place and assemble it.
+  CComPtr<IDxcModuleHandle> pModule;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  CComPtr<IDxcBlob> pAssembledBlob;
+  VERIFY_SUCCEEDED(pOptimizer2->LoadModule(pHighLevelBlob, &pModule));
+  VERIFY_SUCCEEDED(pOptimizer2->CreatePipeline(passList.data(),
+    (UINT32)passList.size(), &pPipeline));
+  VERIFY_SUCCEEDED(pPipeline->RunOnModule(pModule, nullptr));
+  VERIFY_SUCCEEDED(pAssembler2->AssembleAndValidateModule(pModule, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pAssembledBlob));
+  pResult.Release();
+
+  std::string assembly = DisassembleProgram(m_dllSupport, pAssembledBlob);
+  VERIFY_ARE_EQUAL_STR(originalAssembly.c_str(), assembly.c_str());
+
+  // The handle still holds the optimized module.
+  CComPtr<IDxcBlob> pBitcode;
+  VERIFY_SUCCEEDED(pModule->GetBitcode(&pBitcode));
+  VERIFY_IS_TRUE(pBitcode->GetBufferSize() > 0);
+}
+
+TEST_F(OptimizerTest, OptimizerWhenBenchmarkPassThenModuleUnchanged) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer> pOptimizer;
+  CComPtr<IDxcOptimizer2> pOptimizer2;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pHighLevelBlob;
+
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  VERIFY_SUCCEEDED(pOptimizer.QueryInterface(&pOptimizer2));
+
+  Utf16ToBlob(m_dllSupport,
+    L"float4 main(float4 pos : SV_Position, bool b : B) : SV_Target {\r\n"
+    L"  float4 r = pos;\r\n"
+    L"  if (b) r = pos.yxwz;\r\n"
+    L"  return r;\r\n"
+    L"}", &pSource);
+  LPCWSTR highLevelArgs[] = { L"/Vd", L"/fcgl" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", highLevelArgs, _countof(highLevelArgs), nullptr, 0, nullptr,
+    &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pHighLevelBlob));
+
+  CComPtr<IDxcModuleHandle> pModule;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  CComPtr<IDxcPassBenchmark> pBenchmark;
+  CComPtr<IDxcBlob> pBefore, pAfter;
+  LPCWSTR passes[] = { L"-mem2reg" };
+  VERIFY_SUCCEEDED(pOptimizer2->LoadModule(pHighLevelBlob, &pModule));
+  VERIFY_SUCCEEDED(pOptimizer2->CreatePipeline(passes, _countof(passes),
+    &pPipeline));
+  VERIFY_SUCCEEDED(pPipeline.QueryInterface(&pBenchmark));
+  VERIFY_SUCCEEDED(pModule->GetBitcode(&pBefore));
+
+  double seconds[3];
+  VERIFY_SUCCEEDED(pBenchmark->BenchmarkPass(pModule, L"mem2reg",
+    _countof(seconds), seconds));
+  for (double s : seconds)
+    VERIFY_IS_TRUE(s >= 0);
+  // Only passes of the pipeline can be measured.
+  VERIFY_ARE_EQUAL(E_INVALIDARG, pBenchmark->BenchmarkPass(pModule, L"gvn",
+    _countof(seconds), seconds));
+
+  // Each run went to a copy.
+  VERIFY_SUCCEEDED(pModule->GetBitcode(&pAfter));
+  VERIFY_ARE_EQUAL(pBefore->GetBufferSize(), pAfter->GetBufferSize());
+  VERIFY_IS_TRUE(0 == memcmp(pBefore->GetBufferPointer(),
+    pAfter->GetBufferPointer(), pBefore->GetBufferSize()));
+}
+
+// Times one pass of the pipeline over each shader of a corpus, to measure
+// changes to a pass. Each shader is compiled to high-level IR and runs the
+// passes of its pipeline up to the benchmarked pass, which is the only one
+// timed. Runtime parameters:
+//   BenchmarkPassCorpus - directory with the .hlsl files, which have a main
+//                         entry point.
+//   BenchmarkPass       - option name of the pass; gvn by default.
+//   BenchmarkPassTarget - target profile; ps_6_0 by default.
+//   BenchmarkPassRuns   - runs for each shader; 10 by default.
+TEST_F(OptimizerTest, OptimizerPassBenchmarkTest) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  WEX::Common::String CorpusDir, PassName, Target, RunsValue;
+  if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"BenchmarkPassCorpus", CorpusDir)) ||
+      CorpusDir.IsEmpty()) {
+    LogCommentFmt(L"Use /p:BenchmarkPassCorpus=<dir> to pick the shaders to benchmark.");
+    WEX::Logging::Log::Result(WEX::Logging::TestResults::Skipped);
+    return;
+  }
+  if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"BenchmarkPass", PassName)) ||
+      PassName.IsEmpty())
+    PassName = L"gvn";
+  if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"BenchmarkPassTarget", Target)) ||
+      Target.IsEmpty())
+    Target = L"ps_6_0";
+  UINT RunCount = 10;
+  if (SUCCEEDED(WEX::TestExecution::RuntimeParameters::TryGetValue(
+          L"BenchmarkPassRuns", RunsValue)) &&
+      !RunsValue.IsEmpty())
+    RunCount = (UINT)_wtoi(RunsValue);
+  VERIFY_IS_TRUE(RunCount > 0);
+
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer> pOptimizer;
+  CComPtr<IDxcOptimizer2> pOptimizer2;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  VERIFY_SUCCEEDED(pOptimizer.QueryInterface(&pOptimizer2));
+
+  std::wstring dir(CorpusDir);
+  std::wstring passOption = L"-" + std::wstring(PassName);
+  WIN32_FIND_DATAW findData;
+  HANDLE hFind = FindFirstFileW((dir + L"\\*.hlsl").c_str(), &findData);
+  VERIFY_ARE_NOT_EQUAL(INVALID_HANDLE_VALUE, hFind);
+  unsigned benchmarked = 0;
+  double totalMedian = 0;
+  do {
+    std::wstring path = dir + L"\\" + findData.cFileName;
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pOptDump, pHighLevelBlob;
+    HRESULT status;
+    VERIFY_SUCCEEDED(pLibrary->CreateBlobFromFile(path.c_str(), nullptr,
+                                                  &pSource));
+    LPCWSTR optDumpArgs[] = { L"/Vd", L"/Odump" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, path.c_str(), L"main",
+      Target, optDumpArgs, _countof(optDumpArgs), nullptr, 0, nullptr,
+      &pResult));
+    VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+    if (FAILED(status)) {
+      LogCommentFmt(L"%s: skipped, doesn't compile", findData.cFileName);
+      continue;
+    }
+    VERIFY_SUCCEEDED(pResult->GetResult(&pOptDump));
+    pResult.Release();
+    LPCWSTR highLevelArgs[] = { L"/Vd", L"/fcgl" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, path.c_str(), L"main",
+      Target, highLevelArgs, _countof(highLevelArgs), nullptr, 0, nullptr,
+      &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pHighLevelBlob));
+
+    // The pipeline ends with the first run of the pass.
+    CA2W passesW(BlobToUtf8(pOptDump).c_str(), CP_UTF8);
+    std::vector<LPCWSTR> passList;
+    SplitPassList(passesW.m_psz, passList);
+    auto passIt = std::find_if(passList.begin(), passList.end(),
+      [&](LPCWSTR pOption) {
+        size_t len = passOption.size();
+        return 0 == wcsncmp(pOption, passOption.c_str(), len) &&
+               (pOption[len] == L'\0' || pOption[len] == L',');
+      });
+    if (passIt == passList.end()) {
+      LogCommentFmt(L"%s: skipped, %s isn't in its pipeline",
+                    findData.cFileName, passOption.c_str());
+      continue;
+    }
+    passList.erase(passIt + 1, passList.end());
+
+    CComPtr<IDxcModuleHandle> pModule;
+    CComPtr<IDxcOptimizerPipeline> pPipeline;
+    CComPtr<IDxcPassBenchmark> pBenchmark;
+    VERIFY_SUCCEEDED(pOptimizer2->LoadModule(pHighLevelBlob, &pModule));
+    VERIFY_SUCCEEDED(pOptimizer2->CreatePipeline(passList.data(),
+      (UINT32)passList.size(), &pPipeline));
+    VERIFY_SUCCEEDED(pPipeline.QueryInterface(&pBenchmark));
+    std::vector<double> seconds(RunCount);
+    VERIFY_SUCCEEDED(pBenchmark->BenchmarkPass(pModule, PassName, RunCount,
+                                               seconds.data()));
+    std::sort(seconds.begin(), seconds.end());
+    double median = seconds[RunCount / 2];
+    if (RunCount % 2 == 0)
+      median = (median + seconds[RunCount / 2 - 1]) / 2;
+    LogCommentFmt(L"%s: min %.3f ms, median %.3f ms", findData.cFileName,
+                  seconds.front() * 1000, median * 1000);
+    totalMedian += median;
+    ++benchmarked;
+  } while (FindNextFileW(hFind, &findData));
+  FindClose(hFind);
+  LogCommentFmt(L"%s over %u shaders: %.3f ms total of the medians",
+                passOption.c_str(), benchmarked, totalMedian * 1000);
+}
+
 static bool IsPassMarkerFunction(LPCWSTR pName) {
   return 0 == _wcsicmp(pName, L"-opt-fn-passes");
 }
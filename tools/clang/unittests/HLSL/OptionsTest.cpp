@@ -65,6 +65,7 @@ public:
 
   TEST_METHOD(ReadOptionsForDxcWhenApiArgMissingThenFail)
   TEST_METHOD(ReadOptionsForApiWhenApiArgMissingThenOK)
+  TEST_METHOD(ReadOptionsForDxcWhenBatchThenInputNotRequired)
 
   TEST_METHOD(ConvertWhenFailThenThrow)
 
@@ -256,6 +257,23 @@ TEST_F(OptionsTest, ReadOptionsForApiWhenApiArgMissingThenOK) {
   o = ReadOptsTest(mainArgsArr, CompilerFlags, false, false);
 }
 
+TEST_F(OptionsTest, ReadOptionsForDxcWhenBatchThenInputNotRequired) {
+  // Each line of the batch file is a full command line, so neither an input
+  // file nor a target profile is required alongside /batch.
+  const wchar_t *Args[] = { L"exe.exe", L"/batch", L"jobs.txt", L"/j", L"4" };
+  const wchar_t *ArgsNoBatch[] = { L"exe.exe", L"/j", L"4", L"hlsl.hlsl" };
+  const wchar_t *ArgsBadJobs[] = { L"exe.exe", L"/batch", L"jobs.txt", L"/j", L"0" };
+
+  MainArgsArr ArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+  EXPECT_STREQ("jobs.txt", o->BatchFile.str().c_str());
+  EXPECT_EQ(4u, o->BatchJobs);
+
+  MainArgsArr ArgsNoBatchArr(ArgsNoBatch);
+  ReadOptsTest(ArgsNoBatchArr, DxcFlags, "/j can only be used with /batch.");
+  MainArgsArr ArgsBadJobsArr(ArgsBadJobs);
+  ReadOptsTest(ArgsBadJobsArr, DxcFlags, "Unsupported value '0' for j.");
+}
 
 TEST_F(OptionsTest, ConvertWhenFailThenThrow) {
   std::wstring utf16;
@@ -80,6 +80,7 @@ public:
   TEST_METHOD(RunNoFunctionBodyInclude);
   TEST_METHOD(RunNoStatic);
   TEST_METHOD(RunKeepUserMacro);
+  TEST_METHOD(RunRemoveUnusedGlobalsBatch);
 
   dxc::DxcDllSupport m_dllSupport;
   CComPtr<IDxcIncludeHandler> m_pIncludeHandler;
@@ -608,4 +609,51 @@ float test(float a, float b) {\n\
 #define X 1\n\
 #define Y(A, B)  ( ( A ) + ( B ) )\n\
 ") == 0);
-}
\ No newline at end of file
+}
+TEST_F(RewriterTest, RunRemoveUnusedGlobalsBatch) {
+  CComPtr<IDxcRewriter> pRewriter;
+  VERIFY_SUCCEEDED(CreateRewriter(&pRewriter));
+  CComPtr<IDxcRewriter2> pRewriter2;
+  VERIFY_SUCCEEDED(pRewriter.QueryInterface(&pRewriter2));
+
+  const char *sources[] = {
+    "static int unused0;\nfloat4 main() : SV_Target { return 0; }",
+    "static int unused1;\nstatic int used1;\nfloat4 main() : SV_Target { return used1; }",
+    "float unused2() { return 2; }\nfloat4 main() : SV_Target { return 2; }",
+  };
+  const UINT32 sourceCount = _countof(sources);
+  CComPtr<IDxcBlobEncoding> pSources[sourceCount];
+  IDxcBlobEncoding *ppSources[sourceCount];
+  for (UINT32 i = 0; i < sourceCount; ++i) {
+    CreateBlobPinned(sources[i], strlen(sources[i]), CP_UTF8, &pSources[i]);
+    ppSources[i] = pSources[i];
+  }
+
+  IDxcOperationResult *ppResults[sourceCount];
+  VERIFY_SUCCEEDED(pRewriter2->RemoveUnusedGlobalsBatch(
+      sourceCount, ppSources, /*pSourceNames*/ nullptr, L"main",
+      /*pDefines*/ nullptr, 0, /*pIncludeHandler*/ nullptr,
+      /*threadCount*/ 2, ppResults));
+  CComPtr<IDxcOperationResult> pResults[sourceCount];
+  for (UINT32 i = 0; i < sourceCount; ++i)
+    pResults[i].Attach(ppResults[i]);
+
+  for (UINT32 i = 0; i < sourceCount; ++i) {
+    HRESULT status;
+    VERIFY_SUCCEEDED(pResults[i]->GetStatus(&status));
+    VERIFY_SUCCEEDED(status);
+    CComPtr<IDxcBlob> pResult;
+    VERIFY_SUCCEEDED(pResults[i]->GetResult(&pResult));
+    std::string rewrite = BlobToUtf8(pResult);
+    std::string unusedName = "unused" + std::to_string(i);
+    VERIFY_IS_TRUE(rewrite.find(unusedName) == std::string::npos);
+    VERIFY_IS_TRUE(rewrite.find("main") != std::string::npos);
+
+    CComPtr<IDxcTimeReport> pTimeReport;
+    VERIFY_SUCCEEDED(pResults[i].QueryInterface(&pTimeReport));
+    CComPtr<IDxcBlobEncoding> pReport;
+    VERIFY_SUCCEEDED(pTimeReport->GetTimeReport(&pReport));
+    VERIFY_IS_NOT_NULL(pReport.p);
+    VERIFY_IS_TRUE(BlobToUtf8(pReport).find("parse") != std::string::npos);
+  }
+}
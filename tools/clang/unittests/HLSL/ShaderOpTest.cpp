@@ -27,6 +27,7 @@
 #include "WexTestClass.h"           // TAEF
 #include "HLSLTestUtils.h"          // LogCommentFmt
 
+#include <algorithm>
 #include <stdlib.h>
 #include <DirectXMath.h>
 #include <intsafe.h>
@@ -733,6 +734,23 @@ void ShaderOpTest::CreateShaders() {
   }
 }
 
+void ShaderOpTest::CreateTimestampQueries() {
+  // Each run is bracketed by its own pair of timestamps.
+  D3D12_QUERY_HEAP_DESC queryHeapDesc;
+  ZeroMemory(&queryHeapDesc, sizeof(queryHeapDesc));
+  queryHeapDesc.Count = m_BenchmarkRunCount * 2;
+  queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+  CHECK_HR(m_pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_pTimestampHeap)));
+
+  CD3DX12_HEAP_PROPERTIES readback(D3D12_HEAP_TYPE_READBACK);
+  CD3DX12_RESOURCE_DESC readbackDesc(CD3DX12_RESOURCE_DESC::Buffer(queryHeapDesc.Count * sizeof(UINT64)));
+  CHECK_HR(m_pDevice->CreateCommittedResource(
+    &readback, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+    D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+    IID_PPV_ARGS(&m_pTimestampBuffer)));
+  SetObjectName(m_pTimestampBuffer, "Timestamp Readback Buffer");
+}
+
 void ShaderOpTest::GetPipelineStats(D3D12_QUERY_DATA_PIPELINE_STATISTICS *pStats) {
   MappedData M;
   M.reset(m_pQueryBuffer, sizeof(*pStats));
@@ -761,6 +779,26 @@ static void SetDescriptorHeaps(ID3D12GraphicsCommandList *pList,
     pList->SetDescriptorHeaps((UINT)localHeaps.size(), localHeaps.data());
 }
 
+void ShaderOpTest::RecordRuns(ID3D12GraphicsCommandList *pList,
+                              const std::function<void()> &RecordRun) {
+  if (m_BenchmarkRunCount == 0) {
+    RecordRun();
+    return;
+  }
+  for (UINT i = 0; i < m_BenchmarkRunCount; ++i) {
+    if (i > 0) {
+      // Keep runs from overlapping, so that each is timed on its own.
+      CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::UAV(nullptr);
+      pList->ResourceBarrier(1, &barrier);
+    }
+    pList->EndQuery(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, i * 2);
+    RecordRun();
+    pList->EndQuery(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, i * 2 + 1);
+  }
+  pList->ResolveQueryData(m_pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, 0,
+                          m_BenchmarkRunCount * 2, m_pTimestampBuffer, 0);
+}
+
 void ShaderOpTest::RunCommandList() {
   ID3D12GraphicsCommandList *pList = m_CommandList.List.p;
   if (m_pShaderOp->IsCompute()) {
@@ -768,8 +806,10 @@ void ShaderOpTest::RunCommandList() {
     pList->SetComputeRootSignature(m_pRootSignature);
     SetDescriptorHeaps(pList, m_DescriptorHeaps);
     SetRootValues(pList, m_pShaderOp->IsCompute());
-    pList->Dispatch(m_pShaderOp->DispatchX, m_pShaderOp->DispatchY,
-                    m_pShaderOp->DispatchZ);
+    RecordRuns(pList, [&]() {
+      pList->Dispatch(m_pShaderOp->DispatchX, m_pShaderOp->DispatchY,
+                      m_pShaderOp->DispatchZ);
+    });
   } else {
     pList->SetPipelineState(m_pPSO);
     pList->SetGraphicsRootSignature(m_pRootSignature);
@@ -839,7 +879,9 @@ void ShaderOpTest::RunCommandList() {
     UINT vertexCountPerInstance = vertexCount / instanceCount;
 
     pList->BeginQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
-    pList->DrawInstanced(vertexCountPerInstance, instanceCount, 0, 0);
+    RecordRuns(pList, [&]() {
+      pList->DrawInstanced(vertexCountPerInstance, instanceCount, 0, 0);
+    });
     pList->EndQuery(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 0);
     pList->ResolveQueryData(m_pQueryHeap, D3D12_QUERY_TYPE_PIPELINE_STATISTICS,
                             0, 1, m_pQueryBuffer, 0);
@@ -861,6 +903,43 @@ void ShaderOpTest::RunShaderOp(ShaderOp *pShaderOp) {
   CopyBackResources();
 }
 
+void ShaderOpTest::BenchmarkShaderOp(ShaderOp *pShaderOp, UINT RunCount,
+                                     ShaderOpBenchmarkResult *pResult) {
+  DXASSERT_NOMSG(RunCount > 0);
+  m_pShaderOp = pShaderOp;
+
+  CreateDevice();
+  CreateResources();
+  CreateDescriptorHeaps();
+  CreatePipelineState();
+  CreateCommandList();
+  m_BenchmarkRunCount = RunCount;
+  CreateTimestampQueries();
+  RunCommandList();
+  m_BenchmarkRunCount = 0;
+  CopyBackResources();
+
+  UINT64 frequency;
+  CHECK_HR(m_CommandList.Queue->GetTimestampFrequency(&frequency));
+  std::vector<double> times(RunCount);
+  {
+    MappedData M;
+    M.reset(m_pTimestampBuffer, RunCount * 2 * sizeof(UINT64));
+    const UINT64 *pTimestamps = (const UINT64 *)M.data();
+    for (UINT i = 0; i < RunCount; ++i) {
+      times[i] = (double)(pTimestamps[i * 2 + 1] - pTimestamps[i * 2]) *
+                 1000.0 / (double)frequency;
+    }
+  }
+  std::sort(times.begin(), times.end());
+  pResult->RunCount = RunCount;
+  pResult->MedianMs = (RunCount % 2) ? times[RunCount / 2]
+                                     : (times[RunCount / 2 - 1] + times[RunCount / 2]) / 2;
+  pResult->P99Ms = times[std::min<UINT>(RunCount - 1, (RunCount * 99 + 99) / 100 - 1)];
+  pResult->MinMs = times.front();
+  pResult->MaxMs = times.back();
+}
+
 void ShaderOpTest::RunShaderOp(std::shared_ptr<ShaderOp> ShaderOp) {
   m_OrigShaderOp = ShaderOp;
   RunShaderOp(m_OrigShaderOp.get());
@@ -235,10 +235,23 @@ struct CommandListRefs {
   void CreateForDevice(ID3D12Device *pDevice, bool compute);
 };
 
+// Use this structure to report the GPU time of repeated Draw/Dispatch calls.
+struct ShaderOpBenchmarkResult {
+  UINT   RunCount;
+  double MedianMs;  // Median GPU time of a single call, in milliseconds.
+  double P99Ms;     // 99th percentile GPU time, in milliseconds.
+  double MinMs;
+  double MaxMs;
+};
+
 // Use this class to run the operation described in a ShaderOp object.
 class ShaderOpTest {
 public:
   typedef std::function<void(LPCSTR Name, std::vector<BYTE> &Data, ShaderOp *pShaderOp)> TInitCallbackFn;
+  // Runs the Draw/Dispatch call RunCount times between timestamp queries;
+  // resources are read back after the last run.
+  void BenchmarkShaderOp(ShaderOp *pShaderOp, UINT RunCount,
+                         ShaderOpBenchmarkResult *pResult);
   void GetPipelineStats(D3D12_QUERY_DATA_PIPELINE_STATISTICS *pStats);
   void GetReadBackData(LPCSTR pResourceName, MappedData *pData);
   void RunShaderOp(ShaderOp *pShaderOp);
@@ -271,6 +284,9 @@ private:
   CComPtr<ID3D12RootSignature> m_pRootSignature;
   CComPtr<ID3D12QueryHeap> m_pQueryHeap;
   CComPtr<ID3D12Resource> m_pQueryBuffer;
+  CComPtr<ID3D12QueryHeap> m_pTimestampHeap;
+  CComPtr<ID3D12Resource> m_pTimestampBuffer;
+  UINT m_BenchmarkRunCount = 0;
   dxc::DxcDllSupport *m_pDxcSupport = nullptr;
   CommandListRefs m_CommandList;
   HANDLE m_hFence;
@@ -291,6 +307,9 @@ private:
   void CreateResources();
   void CreateRootSignature();
   void CreateShaders();
+  void CreateTimestampQueries();
+  void RecordRuns(ID3D12GraphicsCommandList *pList,
+                  const std::function<void()> &RecordRun);
   void RunCommandList();
   void SetRootValues(ID3D12GraphicsCommandList *pList, bool isCompute);
 };
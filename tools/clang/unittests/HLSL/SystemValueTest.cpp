@@ -62,6 +62,8 @@ public:
   TEST_METHOD(VerifyShadowEntries)
   TEST_METHOD(VerifyVersionedSemantics)
   TEST_METHOD(VerifyMissingSemanticFailure)
+  TEST_METHOD(VerifySemanticNameLookup)
+  TEST_METHOD(VerifyShaderModelNameLookup)
 
   void CompileHLSLTemplate(CComPtr<IDxcOperationResult> &pResult, DXIL::SigPointKind sigPointKind, DXIL::SemanticKind semKind, bool addArb, unsigned Major = 0, unsigned Minor = 0) {
     const Semantic *sem = Semantic::Get(semKind);
@@ -479,3 +481,34 @@ TEST_F(SystemValueTest, VerifyMissingSemanticFailure) {
     CheckAnyOperationResultMsg(pResult, Errors, _countof(Errors));
   }
 }
+
+TEST_F(SystemValueTest, VerifySemanticNameLookup) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  for (DXIL::SemanticKind sv = (DXIL::SemanticKind)((unsigned)DXIL::SemanticKind::Arbitrary + 1); sv < DXIL::SemanticKind::Invalid; sv = (DXIL::SemanticKind)((unsigned)sv + 1)) {
+    const Semantic *pSemantic = Semantic::Get(sv);
+    std::string Name(pSemantic->GetName());
+    VERIFY_ARE_EQUAL(pSemantic, Semantic::GetByName(Name));
+    std::transform(Name.begin(), Name.end(), Name.begin(), ::tolower);
+    VERIFY_ARE_EQUAL(pSemantic, Semantic::GetByName(Name));
+    std::transform(Name.begin(), Name.end(), Name.begin(), ::toupper);
+    VERIFY_ARE_EQUAL(pSemantic, Semantic::GetByName(Name));
+    Name.pop_back();
+    VERIFY_IS_TRUE(Semantic::GetByName(Name)->IsInvalid());
+  }
+  VERIFY_IS_TRUE(Semantic::GetByName("SV_Unknown")->IsInvalid());
+  VERIFY_IS_TRUE(Semantic::GetByName("SV_")->IsInvalid());
+  VERIFY_IS_TRUE(Semantic::GetByName("TEXCOORD")->IsArbitrary());
+}
+
+TEST_F(SystemValueTest, VerifyShaderModelNameLookup) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  for (unsigned i = 0; i < ShaderModel::Count(); i++) {
+    const ShaderModel *pSM = ShaderModel::Get(i);
+    VERIFY_ARE_EQUAL(pSM, ShaderModel::GetByName(pSM->GetName()));
+    VERIFY_ARE_EQUAL(pSM, ShaderModel::Get(pSM->GetKind(), pSM->GetMajor(), pSM->GetMinor()));
+  }
+  VERIFY_IS_FALSE(ShaderModel::GetByName("lib_5_0")->IsValid());
+  VERIFY_IS_FALSE(ShaderModel::GetByName("vs_3_0")->IsValid());
+  VERIFY_IS_FALSE(ShaderModel::Get(DXIL::ShaderKind::Hull, 4, 1)->IsValid());
+  VERIFY_IS_FALSE(ShaderModel::Get(DXIL::ShaderKind::Pixel, 7, 0)->IsValid());
+}
@@ -158,6 +158,7 @@ public:
   TEST_METHOD(ResourceRangeOverlap1)
   TEST_METHOD(ResourceRangeOverlap2)
   TEST_METHOD(ResourceRangeOverlap3)
+  TEST_METHOD(ResourceRangeOverlapMany)
   TEST_METHOD(CBufferOverlap0)
   TEST_METHOD(CBufferOverlap1)
   TEST_METHOD(ControlFlowHint)
@@ -270,6 +271,7 @@ public:
   TEST_METHOD(PhiTGSMFail);
   TEST_METHOD(QuadOpInCS);
   TEST_METHOD(ReducibleFail);
+  TEST_METHOD(WhenQuickThenReducibilityNotChecked);
   TEST_METHOD(SampleBiasFail);
   TEST_METHOD(SamplerKindFail);
   TEST_METHOD(SemaOverlapFail);
@@ -293,6 +295,7 @@ public:
 
   TEST_METHOD(WhenRootSigMismatchThenFail);
   TEST_METHOD(WhenRootSigCompatThenSucceed);
+  TEST_METHOD(WhenSkipIfValidatedAndRootSigMismatchThenFail);
   TEST_METHOD(WhenRootSigMatchShaderSucceed_RootConstVis);
   TEST_METHOD(WhenRootSigMatchShaderFail_RootConstVis);
   TEST_METHOD(WhenRootSigMatchShaderSucceed_RootCBV);
@@ -338,11 +341,11 @@ public:
     }
   }
 
-  void CheckValidationMsgs(IDxcBlob *pBlob, llvm::ArrayRef<LPCSTR> pErrorMsgs, bool bRegex = false) {
+  void CheckValidationMsgs(IDxcBlob *pBlob, llvm::ArrayRef<LPCSTR> pErrorMsgs, bool bRegex = false,
+                           UINT32 Flags = DxcValidatorFlags_Default) {
     CComPtr<IDxcValidator> pValidator;
     CComPtr<IDxcOperationResult> pResult;
 
-    UINT32 Flags = DxcValidatorFlags_Default;
     if (!IsDxilContainerLike(pBlob->GetBufferPointer(), pBlob->GetBufferSize())) {
       // Validation of raw bitcode as opposed to DxilContainer is not supported through DXIL.dll
       if (!m_ver.m_InternalValidator) {
@@ -358,12 +361,13 @@ public:
     CheckOperationResultMsgs(pResult, pErrorMsgs, false, bRegex);
   }
 
-  void CheckValidationMsgs(const char *pBlob, size_t blobSize, llvm::ArrayRef<LPCSTR> pErrorMsgs, bool bRegex = false) {
+  void CheckValidationMsgs(const char *pBlob, size_t blobSize, llvm::ArrayRef<LPCSTR> pErrorMsgs, bool bRegex = false,
+                           UINT32 Flags = DxcValidatorFlags_Default) {
     CComPtr<IDxcLibrary> pLibrary;
     CComPtr<IDxcBlobEncoding> pBlobEncoding; // Encoding doesn't actually matter, it's binary.
     VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
     VERIFY_SUCCEEDED(pLibrary->CreateBlobWithEncodingFromPinned((LPBYTE)pBlob, blobSize, CP_UTF8, &pBlobEncoding));
-    CheckValidationMsgs(pBlobEncoding, pErrorMsgs, bRegex);
+    CheckValidationMsgs(pBlobEncoding, pErrorMsgs, bRegex, Flags);
   }
 
   void CompileSource(IDxcBlobEncoding *pSource, LPCSTR pShaderModel,
@@ -525,7 +529,8 @@ public:
   // compile one or two sources, validate module from 1 with container parts from 2, check messages
   void ReplaceContainerPartsCheckMsgs(LPCSTR pSource1, LPCSTR pSource2, LPCSTR pShaderModel,
                                      llvm::ArrayRef<DxilFourCC> PartsToReplace,
-                                     llvm::ArrayRef<LPCSTR> pErrorMsgs) {
+                                     llvm::ArrayRef<LPCSTR> pErrorMsgs,
+                                     UINT32 Flags = DxcValidatorFlags_Default) {
     CComPtr<IDxcBlob> pProgram1, pProgram2;
     CompileSource(pSource1, pShaderModel, &pProgram1);
     VERIFY_IS_NOT_NULL(pProgram1);
@@ -581,7 +586,7 @@ public:
     pOutputStream->Reserve(pContainerWriter->size());
     pContainerWriter->write(pOutputStream);
 
-    CheckValidationMsgs((const char *)pOutputStream->GetPtr(), pOutputStream->GetPtrSize(), pErrorMsgs, /*bRegex*/false);
+    CheckValidationMsgs((const char *)pOutputStream->GetPtr(), pOutputStream->GetPtrSize(), pErrorMsgs, /*bRegex*/false, Flags);
   }
 };
 
@@ -899,6 +904,40 @@ TEST_F(ValidationTest, ReducibleFail) {
       },
       "Execution flow must be reducible");
 }
+TEST_F(ValidationTest, WhenQuickThenReducibilityNotChecked) {
+  if (m_ver.SkipIRSensitiveTest()) return;
+  if (!m_ver.m_InternalValidator) {
+    WEX::Logging::Log::Comment(L"Test skipped due to use of external DXIL.dll validator.");
+    return;
+  }
+  // The same irreducible flow as ReducibleFail passes the quick tier.
+  std::wstring fullPath = hlsl_test::GetPathToHlslDataFile(L"..\\CodeGenHLSL\\reducible.hlsl");
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcBlobEncoding> pSource;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  VERIFY_SUCCEEDED(pLibrary->CreateBlobFromFile(fullPath.c_str(), nullptr, &pSource));
+  CComPtr<IDxcBlob> pText;
+  RewriteAssemblyToText(pSource, "ps_6_0", nullptr, 0, nullptr, 0,
+      {"%conv\n"
+       "  br label %if.end",
+       "to float\n"
+       "  br label %if.end"
+      },
+      {"%conv\n"
+      "  br i1 %cmp, label %if.else, label %if.end",
+       "to float\n"
+       "  br i1 %cmp, label %if.then, label %if.end"
+      },
+      &pText);
+  CComPtr<IDxcAssembler> pAssembler;
+  CComPtr<IDxcOperationResult> pAssembleResult;
+  CComPtr<IDxcBlob> pBlob;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcAssembler, &pAssembler));
+  VERIFY_SUCCEEDED(pAssembler->AssembleToContainer(pText, &pAssembleResult));
+  VERIFY_SUCCEEDED(pAssembleResult->GetResult(&pBlob));
+  CheckValidationMsgs(pBlob, {}, false, DxcValidatorFlags_Quick);
+  CheckValidationMsgs(pBlob, {"Execution flow must be reducible"});
+}
 TEST_F(ValidationTest, SampleBiasFail) {
   RewriteAssemblyCheckMsg(
       L"..\\CodeGenHLSL\\sampleBias.hlsl", "ps_6_0",
@@ -1206,6 +1245,31 @@ TEST_F(ValidationTest, ResourceRangeOverlap3) {
       "Resource srv2 with base 0 size 1 overlap");
 }
 
+TEST_F(ValidationTest, ResourceRangeOverlapMany) {
+  // A bindless-style shader with thousands of ranges across spaces, where
+  // ti binds t(4*i) to t(4*i+3) in space i%8.
+  const unsigned kCount = 2048;
+  std::string source;
+  for (unsigned i = 0; i < kCount; ++i)
+    source += "Texture2D<float4> t" + std::to_string(i) + "[4] : register(t" +
+              std::to_string(4 * i) + ", space" + std::to_string(i % 8) +
+              ");\n";
+  source += "float4 main(uint i : I) : SV_Target {\n  float4 r = 0;\n";
+  for (unsigned i = 0; i < kCount; ++i)
+    source += "  r += t" + std::to_string(i) + "[i].Load(int3(0, 0, 0));\n";
+  source += "  return r;\n}\n";
+
+  CComPtr<IDxcBlob> pProgram;
+  CompileSource(source.c_str(), "ps_6_0", &pProgram);
+  CheckValidationMsgs(pProgram, nullptr);
+
+  // Moving t9 into t1's range in space 1 is still reported.
+  RewriteAssemblyCheckMsg(source.c_str(), "ps_6_0",
+                          {"!\"t9\", i32 1, i32 36, i32 4"},
+                          {"!\"t9\", i32 1, i32 6, i32 4"},
+                          {"Resource t9 with base 6 size 4 overlap"});
+}
+
 TEST_F(ValidationTest, CBufferOverlap0) {
     RewriteAssemblyCheckMsg(
       L"..\\CodeGenHLSL\\cbufferOffset.hlsl", "ps_6_0",
@@ -2351,6 +2415,23 @@ TEST_F(ValidationTest, WhenRootSigCompatThenSucceed) {
   );
 }
 
+TEST_F(ValidationTest, WhenSkipIfValidatedAndRootSigMismatchThenFail) {
+  if (!m_ver.m_InternalValidator) {
+    WEX::Logging::Log::Comment(L"Test skipped due to use of external DXIL.dll validator.");
+    return;
+  }
+  // The compiler already validated the module, so only the replaced root
+  // signature is validated.
+  ReplaceContainerPartsCheckMsgs(
+    "float c; [RootSignature ( \"RootConstants(b0, num32BitConstants = 1)\" )] float4 main() : semantic { return c; }",
+    "[RootSignature ( \"\" )] float4 main() : semantic { return 0; }",
+    "vs_6_0",
+    {DFCC_RootSignature},
+    {"Validation failed."},
+    DxcValidatorFlags_SkipIfValidated
+  );
+}
+
 TEST_F(ValidationTest, WhenRootSigMatchShaderSucceed_RootConstVis) {
   ReplaceContainerPartsCheckMsgs(
     "float c; float4 main() : semantic { return c; }",
@@ -1161,6 +1161,16 @@ TEST_F(FileTest, SpirvEntryFunctionWrapper) {
 TEST_F(FileTest, SpirvEntryFunctionInOut) {
   runFileTest("spirv.entry-function.inout.hlsl");
 }
+TEST_F(FileTest, SpirvEntryFunctionMultiple) {
+  runFileTest("spirv.entry-function.multiple.hlsl");
+}
+TEST_F(FileTest, SpirvEntryFunctionMultipleError) {
+  runFileTest("spirv.entry-function.multiple.error.hlsl", Expect::Failure);
+}
+
+TEST_F(FileTest, SpirvRelaxedPrecision) {
+  runFileTest("spirv.relaxed-precision.hlsl");
+}
 
 TEST_F(FileTest, SpirvBuiltInHelperInvocation) {
   runFileTest("spirv.builtin.helper-invocation.hlsl");
@@ -1280,6 +1290,9 @@ TEST_F(FileTest, VulkanAttributeInvalidUsages) {
 TEST_F(FileTest, VulkanCLOptionIgnoreUnusedResources) {
   runFileTest("vk.cloption.ignore-unused-resources.hlsl");
 }
+TEST_F(FileTest, VulkanCLOptionAutoPushConstant) {
+  runFileTest("vk.cloption.auto-push-constant.hlsl");
+}
 
 TEST_F(FileTest, VulkanCLOptionInvertYVS) {
   runFileTest("vk.cloption.invert-y.vs.hlsl");
@@ -60,9 +60,15 @@ bool processRunCommandArgs(const llvm::StringRef runCommandLine,
   for (uint32_t i = 3; i < tokens.size(); ++i) {
     if (tokens[i] == "-T" && (++i) < tokens.size())
       *targetProfile = tokens[i];
-    else if (tokens[i] == "-E" && (++i) < tokens.size())
-      *entryPoint = tokens[i];
-    else
+    else if (tokens[i] == "-E" && (++i) < tokens.size()) {
+      // Entry points after the first are passed on with the rest.
+      if (entryPoint->empty()) {
+        *entryPoint = tokens[i];
+      } else {
+        restArgs->push_back("-E");
+        restArgs->push_back(tokens[i]);
+      }
+    } else
       restArgs->push_back(tokens[i]);
   }
 
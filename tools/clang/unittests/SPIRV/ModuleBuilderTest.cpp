@@ -9,6 +9,7 @@
 
 #include "clang/SPIRV/ModuleBuilder.h"
 #include "spirv/unified1/spirv.hpp11"
+#include "llvm/Support/raw_ostream.h"
 
 #include "SPIRVTestUtils.h"
 
@@ -27,6 +28,37 @@ TEST(ModuleBuilder, TakeModuleDirectlyCreatesHeader) {
               ElementsAre(spv::MagicNumber, 0x00010000, 14u << 16, 1u, 0u));
 }
 
+TEST(ModuleBuilder, TakeModuleToStreamWritesSameWords) {
+  SPIRVContext context;
+  ModuleBuilder builder(&context, nullptr, false);
+
+  const auto rType = context.takeNextId();
+  const auto fType = context.takeNextId();
+  const auto fId = context.getNextId();
+  EXPECT_NE(0, builder.beginFunction(fType, rType));
+  const auto labelId = builder.createBasicBlock();
+  builder.setInsertPoint(labelId);
+  builder.createReturn();
+  EXPECT_TRUE(builder.endFunction());
+
+  std::string bytes;
+  llvm::raw_string_ostream out(bytes);
+  builder.takeModule(out);
+  out.flush();
+
+  SimpleInstBuilder sib(context.getNextId());
+  sib.inst(spv::Op::OpFunction, {rType, fId, 0, fType});
+  sib.inst(spv::Op::OpLabel, {labelId});
+  sib.inst(spv::Op::OpReturn, {});
+  sib.inst(spv::Op::OpFunctionEnd, {});
+  const auto expected = sib.get();
+
+  ASSERT_EQ(expected.size() * 4, bytes.size());
+  std::vector<uint32_t> result(expected.size());
+  memcpy(result.data(), bytes.data(), bytes.size());
+  EXPECT_THAT(result, ContainerEq(expected));
+}
+
 TEST(ModuleBuilder, CreateFunction) {
   SPIRVContext context;
   ModuleBuilder builder(&context, nullptr, false);
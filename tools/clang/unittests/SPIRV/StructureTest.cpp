@@ -32,6 +32,17 @@ TEST(Structure, InstructionGetOriginalContents) {
               ContainerEq(constructInst(spv::Op::OpIAdd, {1, 2, 3, 4})));
 }
 
+TEST(Structure, InstructionInContextGetOriginalContents) {
+  SPIRVContext context;
+  const auto words = constructInst(spv::Op::OpIAdd, {1, 2, 3, 4});
+  Instruction inst(&context, words);
+
+  EXPECT_EQ(inst.getOpcode(), spv::Op::OpIAdd);
+  EXPECT_EQ(context.getAllocatedWordCount(), words.size());
+  EXPECT_THAT(inst.take(), ContainerEq(words));
+  EXPECT_TRUE(inst.isEmpty());
+}
+
 TEST(Structure, InstructionIsTerminator) {
   for (auto opcode :
        {spv::Op::OpKill, spv::Op::OpUnreachable, spv::Op::OpBranch,
@@ -67,6 +78,27 @@ TEST(Structure, TakeBasicBlockHaveAllContents) {
   EXPECT_TRUE(bb.isEmpty());
 }
 
+TEST(Structure, TakeBasicBlockWithContextInstructions) {
+  SPIRVContext context;
+  std::vector<uint32_t> result;
+  auto ib = constructInstBuilder(result);
+
+  auto bb = BasicBlock(42);
+  bb.appendInstruction(
+      Instruction(&context, constructInst(spv::Op::OpNop, {})));
+  bb.appendInstruction(
+      Instruction(&context, constructInst(spv::Op::OpReturn, {})));
+  bb.take(&ib);
+
+  SimpleInstBuilder sib;
+  sib.inst(spv::Op::OpLabel, {42});
+  sib.inst(spv::Op::OpNop, {});
+  sib.inst(spv::Op::OpReturn, {});
+
+  EXPECT_THAT(result, ContainerEq(sib.get()));
+  EXPECT_TRUE(bb.isEmpty());
+}
+
 TEST(Structure, AfterClearBasicBlockIsEmpty) {
   auto bb = BasicBlock(42);
   bb.appendInstruction(constructInst(spv::Op::OpNop, {}));
@@ -196,15 +196,18 @@ static void WritePartToFile(IDxcBlob *pBlob, hlsl::DxilFourCC CC,
   if (!pContainer) {
     throw hlsl::Exception(E_FAIL, "Unable to find required part in blob");
   }
-  hlsl::DxilPartIsType pred(CC);
-  hlsl::DxilPartIterator it =
-      std::find_if(hlsl::begin(pContainer), hlsl::end(pContainer), pred);
-  if (it == hlsl::end(pContainer)) {
+  // Debug info is written decompressed, for tools that only know ILDB.
+  std::vector<char> partStorage;
+  const hlsl::DxilPartHeader *pPart =
+      CC == hlsl::DFCC_ShaderDebugInfoDXIL
+          ? hlsl::GetDxilDebugInfoPart(pContainer, partStorage)
+          : hlsl::GetDxilPartByType(pContainer, CC);
+  if (pPart == nullptr) {
     throw hlsl::Exception(E_FAIL, "Unable to find required part in blob");
   }
 
-  const char *pData = hlsl::GetDxilPartData(*it);
-  DWORD dataLen = (*it)->PartSize;
+  const char *pData = hlsl::GetDxilPartData(pPart);
+  DWORD dataLen = pPart->PartSize;
   StringRefUtf16 WideName(FName);
   CHandle file(CreateFile2(WideName, GENERIC_WRITE, FILE_SHARE_READ,
                            CREATE_ALWAYS, nullptr));
@@ -338,8 +341,17 @@ void DxcContext::UpdatePart(IDxcBlob *pSource, IDxcBlob **ppResult) {
 
   // Update parts based on dxc options
   if (m_Opts.StripDebug) {
-    IFT(pContainerBuilder->RemovePart(
-        hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL));
+    HRESULT hr = pContainerBuilder->RemovePart(
+        hlsl::DxilFourCC::DFCC_ShaderDebugInfoDXIL);
+    if (hr == DXC_E_MISSING_PART)
+      hr = pContainerBuilder->RemovePart(
+          hlsl::DxilFourCC::DFCC_ShaderDebugInfoCompressed);
+    IFT(hr);
+    // Containers from older compilers have no line table.
+    hr = pContainerBuilder->RemovePart(
+        hlsl::DxilFourCC::DFCC_ShaderDebugLines);
+    if (hr != DXC_E_MISSING_PART)
+      IFT(hr);
   }
   if (m_Opts.StripPrivate) {
     IFT(pContainerBuilder->RemovePart(hlsl::DxilFourCC::DFCC_PrivateData));
@@ -1289,7 +1289,8 @@ class db_dxil(object):
         add_pass('die', 'DeadInstElimination', 'Dead Instruction Elimination', [])
         add_pass('globaldce', 'GlobalDCE', 'Dead Global Elimination', [])
         add_pass('dynamic-vector-to-array', 'DynamicIndexingVectorToArray', 'Replace dynamic indexing vector with array', [
-            {'n':'ReplaceAllVectors','t':'bool','c':1}])
+            {'n':'ReplaceAllVectors','t':'bool','c':1},
+            {'n':'SelectDynamicIndexing','t':'bool','c':1}])
         add_pass('hlsl-dxil-legalize-resource-use', 'DxilLegalizeResourceUsePass', 'DXIL legalize resource use', [])
         add_pass('hlsl-dxil-legalize-static-resource-use', 'DxilLegalizeStaticResourceUsePass', 'DXIL legalize static resource use', [])
         add_pass('hlsl-dxil-legalize-eval-operations', 'DxilLegalizeEvalOperations', 'DXIL legalize eval operations', [])
@@ -1305,10 +1306,12 @@ class db_dxil(object):
         add_pass('hlsl-passes-nopause', 'NoPausePasses', 'Clears metadata used for pause and resume', [])
         add_pass('hlsl-passes-pause', 'PausePasses', 'Prepare to pause passes', [])
         add_pass('hlsl-passes-resume', 'ResumePasses', 'Prepare to resume passes', [])
-        add_pass('hlsl-dxil-condense', 'DxilCondenseResources', 'DXIL Condense Resources', [])
+        add_pass('hlsl-dxil-condense', 'DxilCondenseResources', 'DXIL Condense Resources', [
+            {'n':'allocated','t':'bool','c':1}])
         add_pass('hlsl-dxil-convergent-mark', 'DxilConvergentMark', 'Mark convergent', [])
         add_pass('hlsl-dxil-convergent-clear', 'DxilConvergentClear', 'Clear convergent before dxil emit', [])
-        add_pass('hlsl-dxil-eliminate-output-dynamic', 'DxilEliminateOutputDynamicIndexing', 'DXIL eliminate ouptut dynamic indexing', [])
+        add_pass('hlsl-dxil-eliminate-output-dynamic', 'DxilEliminateOutputDynamicIndexing', 'DXIL eliminate ouptut dynamic indexing', [
+            {'n':'max-switch-rows','t':'unsigned','c':1}])
         add_pass('hlsl-dxil-add-pixel-hit-instrmentation', 'DxilAddPixelHitInstrumentation', 'DXIL Count completed PS invocations and costs', [
             {'n':'force-early-z','t':'int','c':1},
             {'n':'add-pixel-cost','t':'int','c':1},
@@ -1325,12 +1328,20 @@ class db_dxil(object):
         add_pass('hlsl-dxil-force-early-z', 'DxilForceEarlyZ', 'HLSL DXIL Force the early Z global flag, if shader has no discard calls', [])
         add_pass('hlsl-dxil-pix-shader-access-instrumentation', 'DxilShaderAccessTracking', 'HLSL DXIL shader access tracking for PIX', [
             {'n':'config','t':'int','c':1},
-            {'n':'checkForDynamicIndexing','t':'bool','c':1}])
+            {'n':'checkForDynamicIndexing','t':'bool','c':1},
+            {'n':'waveAggregate','t':'bool','c':1}])
         add_pass('hlsl-dxil-debug-instrumentation', 'DxilDebugInstrumentation', 'HLSL DXIL debug instrumentation for PIX', [
             {'n':'UAVSize','t':'int','c':1},
             {'n':'parameter0','t':'int','c':1},
             {'n':'parameter1','t':'int','c':1},
-            {'n':'parameter2','t':'int','c':1}])
+            {'n':'parameter2','t':'int','c':1},
+            {'n':'sampleEveryN','t':'int','c':1},
+            {'n':'blockEntriesOnly','t':'bool','c':1},
+            {'n':'ringBuffer','t':'bool','c':1}])
+        add_pass('hlsl-dxil-add-block-counters', 'DxilAddBlockCounters', 'DXIL Count basic block executions', [])
+        add_pass('hlsl-dxil-apply-block-profile', 'DxilApplyBlockProfile', 'DXIL Apply basic block profile as control flow hints', [
+            {'n':'profile-file','t':'string','c':1},
+            {'n':'cold-percent','t':'int','c':1}])
         add_pass('hlsl-dxil-reduce-msaa-to-single', 'DxilReduceMSAAToSingleSample', 'HLSL DXIL Reduce all MSAA reads to single-sample reads', [])
         add_pass('hlsl-dxilfinalize', 'DxilFinalizeModule', 'HLSL DXIL Finalize Module', [])
         add_pass('hlsl-dxilemit', 'DxilEmitMetadata', 'HLSL DXIL Metadata Emit', [])
@@ -1338,7 +1349,25 @@ class db_dxil(object):
         add_pass('dxil-dfe', 'DxilDeadFunctionElimination', 'Remove all unused function except entry from DxilModule', [])
         add_pass('hl-dfe', 'HLDeadFunctionElimination', 'Remove all unused function except entry from HLModule', [])
         add_pass('hl-preprocess', 'HLPreprocess', 'Preprocess HLModule after inline', [])
-        add_pass('hlsl-dxil-expand-trig', 'DxilExpandTrigIntrinsics', 'DXIL expand trig intrinsics', [])
+        add_pass('hlsl-dxil-expand-trig-intrinsics', 'DxilExpandTrigIntrinsics', 'DXIL expand trig intrinsics', [
+            {'n':'fp-speed','t':'string','c':1}])
+        add_pass('hlsl-dxil-coalesce-cbuffer-loads', 'DxilCoalesceCBufferLoads', 'DXIL Coalesce CBuffer Loads', [])
+        add_pass('hlsl-dxil-combine-buffer-accesses', 'DxilCombineBufferAccesses', 'DXIL Combine Buffer Accesses', [])
+        add_pass('hlsl-dxil-uniform-branch-hints', 'DxilUniformBranchHints', 'DXIL Uniform Branch Hints', [])
+        add_pass('hlsl-dxil-auto-flatten', 'DxilAutoFlatten', 'DXIL Auto Flatten', [])
+        add_pass('hlsl-dxil-wave-aggregate-atomics', 'DxilWaveAggregateAtomics', 'DXIL Wave Aggregate Atomics', [])
+        add_pass('hlsl-dxil-demote-precision', 'DxilDemotePrecision', 'DXIL Demote Precision', [])
+        add_pass('hlsl-dxil-promote-early-depth-stencil', 'DxilPromoteEarlyDepthStencil', 'DXIL Promote Early Depth-Stencil', [])
+        add_pass('hlsl-dxil-form-gather', 'DxilFormGather', 'DXIL Form Gather', [])
+        add_pass('hlsl-dxil-mark-readnone-loads', 'DxilMarkReadNoneLoads', 'DXIL Mark ReadNone Loads', [])
+        add_pass('hlsl-dxil-hoist-handles', 'DxilHoistHandles', 'DXIL Hoist Handles', [])
+        add_pass('hlsl-dxil-compact-context', 'DxilCompactContext', 'DXIL Compact Context', [])
+        add_pass('hlsl-dxil-eliminate-redundant-barriers', 'DxilEliminateRedundantBarriers', 'DXIL Eliminate Redundant Barriers', [])
+        add_pass('hlsl-dxil-pack-groupshared', 'DxilPackGroupShared', 'DXIL Pack Groupshared', [
+            {'n':'pad-for-banks','t':'bool','c':1}])
+        add_pass('hlsl-dxil-rematerialize', 'DxilRematerialize', 'DXIL Rematerialize', [
+            {'n':'max-live-values','t':'unsigned','c':1}])
+        add_pass('hlsl-dxil-specialize-constants', 'DxilSpecializeConstants', 'DXIL Specialize Constants', [])
         add_pass('hlsl-hca', 'HoistConstantArray', 'HLSL constant array hoisting', [])
         add_pass('hlsl-dxil-preserve-all-outputs', 'DxilPreserveAllOutputs', 'DXIL write to all outputs in signature', [])
         add_pass('ipsccp', 'IPSCCP', 'Interprocedural Sparse Conditional Constant Propagation', [])
@@ -1382,7 +1411,8 @@ class db_dxil(object):
             {'n':'unroll-count', 'i':'UnrollCount', 't':'unsigned', 'd':'Use this unroll count for all loops including those with unroll_count pragma values, for testing purposes'},
             {'n':'unroll-allow-partial', 'i':'UnrollAllowPartial', 't':'bool', 'd':'Allows loops to be partially unrolled until -unroll-threshold loop size is reached.'},
             {'n':'unroll-runtime', 'i':'UnrollRuntime', 't':'bool', 'd':'Unroll loops with run-time trip counts'},
-            {'n':'pragma-unroll-threshold', 'i':'PragmaUnrollThreshold', 't':'unsigned', 'd':'Unrolled size limit for loops with an unroll(full) or unroll_count pragma.'}])
+            {'n':'pragma-unroll-threshold', 'i':'PragmaUnrollThreshold', 't':'unsigned', 'd':'Unrolled size limit for loops with an unroll(full) or unroll_count pragma.'},
+            {'n':'unroll-instruction-budget', 'i':'UnrollInstructionBudget', 't':'unsigned', 'd':"Don't unroll loops in functions that would grow past this many instructions."}])
         add_pass('mldst-motion', 'MergedLoadStoreMotion', 'MergedLoadStoreMotion', [])
         add_pass('gvn', 'GVN', 'Global Value Numbering', [
             {'n':'noloads', 't':'bool', 'c':1},
@@ -1410,6 +1440,7 @@ class db_dxil(object):
             {'n':'lowerbitsets-avoid-reuse', 'i':'AvoidReuse', 't':'bool', 'd':'Try to avoid reuse of byte array addresses using aliases'}])
         add_pass('red', 'ReducibilityAnalysis', 'Reducibility Analysis', [])
         add_pass('viewid-state', 'ComputeViewIdState', 'Compute information related to ViewID', [])
+        add_pass('hlsl-dxil-domtree-cache', 'DxilDomTreeCachePass', 'DXIL Dominator Tree Cache', [])
         add_pass('hlsl-translate-dxil-opcode-version', 'DxilTranslateRawBuffer', 'Translates one version of dxil to another', [])
         # TODO: turn STATISTICS macros into ETW events
         # assert no duplicate names
@@ -1746,6 +1777,7 @@ class db_dxil(object):
         self.add_valrule("Sm.ThreadGroupChannelRange", "Declared Thread Group %0 size %1 outside valid range [%2..%3]")
         self.add_valrule("Sm.MaxTheadGroup", "Declared Thread Group Count %0 (X*Y*Z) is beyond the valid maximum of %1")
         self.add_valrule("Sm.MaxTGSMSize", "Total Thread Group Shared Memory storage is %0, exceeded %1")
+        self.add_valrule("Sm.WaveSize", "Declared wave size %0 is not a power of two in the range [%1..%2]")
         self.add_valrule("Sm.ROVOnlyInPS", "RasterizerOrdered objects are only allowed in 5.0+ pixel shaders")
         self.add_valrule("Sm.TessFactorForDomain", "Required TessFactor for domain not found declared anywhere in Patch Constant data")
         self.add_valrule("Sm.TessFactorSizeMatchDomain", "TessFactor rows, columns (%0, %1) invalid for domain %2.  Expected %3 rows and 1 column.")
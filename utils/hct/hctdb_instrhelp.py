@@ -644,6 +644,76 @@ def get_hlsl_intrinsic_stats():
     result += "static const int g_MaxIntrinsicParamCount = %d; // Count of parameters (without return) for longest intrinsic argument list - '%s'\n" % (len(longest_arglist_fn.params) - 1, longest_arglist_fn.name)
     return result
 
+def hlsl_intrinsic_name_hash(name, seed):
+    # 32-bit FNV-1a, seeded; must match IntrinsicNameHash in SemaHLSL.cpp.
+    h = (2166136261 ^ seed) & 0xffffffff
+    for c in name:
+        h = ((h ^ ord(c)) * 16777619) & 0xffffffff
+    return h
+
+def build_name_hash(names):
+    # Builds a perfect hash (hash and displace) for names: the unseeded hash
+    # picks a bucket, and the bucket's seed a slot no other name takes.
+    # Returns the bucket count, slot count, seeds and the name in each slot.
+    slot_count = 1
+    while slot_count < len(names) * 3 // 2:
+        slot_count *= 2
+    bucket_count = max(slot_count // 4, 1)
+    buckets = [[] for b in range(bucket_count)]
+    for name in names:
+        buckets[hlsl_intrinsic_name_hash(name, 0) & (bucket_count - 1)].append(name)
+    seeds = [0] * bucket_count
+    slots = [None] * slot_count
+    for b in sorted(range(bucket_count), key=lambda x: (-len(buckets[x]), x)):
+        if not buckets[b]:
+            continue
+        seed = 1
+        while True:
+            taken = [hlsl_intrinsic_name_hash(n, seed) & (slot_count - 1) for n in buckets[b]]
+            if len(set(taken)) == len(taken) and all(slots[t] is None for t in taken):
+                break
+            seed += 1
+        seeds[b] = seed
+        for n, t in zip(buckets[b], taken):
+            slots[t] = n
+    return bucket_count, slot_count, seeds, slots
+
+def get_hlsl_intrinsic_name_hash():
+    # Maps each intrinsic name to the contiguous range of g_Intrinsics entries
+    # that share that name.
+    db = get_db_hlsl()
+    ranges = {}
+    idx = 0
+    for i in sorted(db.intrinsics, key=lambda x: x.key):
+        if i.ns != "Intrinsics":
+            continue
+        if i.name in ranges:
+            ranges[i.name][1] += 1
+        else:
+            ranges[i.name] = [idx, 1]
+        idx += 1
+    bucket_count, slot_count, seeds, slots = build_name_hash(sorted(ranges.keys()))
+    result = "struct HLSL_INTRINSIC_NAME_RANGE {\n"
+    result += "    LPCSTR pName;\n"
+    result += "    UINT uFirst;\n"
+    result += "    UINT uCount;\n"
+    result += "};\n\n"
+    result += "static const UINT g_uIntrinsicNameHashBucketCount = %d;\n" % bucket_count
+    result += "static const UINT g_uIntrinsicNameHashSlotCount = %d;\n\n" % slot_count
+    result += "static const UINT g_IntrinsicNameHashSeeds[] =\n{\n"
+    for b in range(0, bucket_count, 8):
+        result += "    " + " ".join("%d," % x for x in seeds[b:b + 8]) + "\n"
+    result += "};\n\n"
+    result += "// Index of the first g_Intrinsics entry and entry count for each slot.\n"
+    result += "static const HLSL_INTRINSIC_NAME_RANGE g_IntrinsicNameHashSlots[] =\n{\n"
+    for n in slots:
+        if n is None:
+            result += "    {nullptr, 0, 0},\n"
+        else:
+            result += "    {\"%s\", %d, %d},\n" % (n, ranges[n][0], ranges[n][1])
+    result += "};\n"
+    return result
+
 def get_hlsl_intrinsics():
     db = get_db_hlsl()
     result = ""
@@ -713,6 +783,23 @@ def enum_hlsl_intrinsics():
     result += "  Num_Intrinsics,\n"
     return result
 
+def get_hlsl_intrinsic_op_names():
+    db = get_db_hlsl()
+    result = ""
+    enumed = []
+    for i in sorted(db.intrinsics, key=lambda x: x.key):
+        if (i.enum_name not in enumed):
+            name = "  \"%s\",\n" % (i.enum_name)
+            result += wrap_with_ifdef_if_vulkan_specific(i, name)  # SPIRV Change
+            enumed.append(i.enum_name)
+    # unsigned
+    for i in sorted(db.intrinsics, key=lambda x: x.key):
+        if (i.unsigned_op != ""):
+          if (i.unsigned_op not in enumed):
+            result += "  \"%s\",\n" % (i.unsigned_op)
+            enumed.append(i.unsigned_op)
+    return result
+
 def has_unsigned_hlsl_intrinsics():
     db = get_db_hlsl()
     result = ""
@@ -979,6 +1066,26 @@ def get_interpretation_table():
     gen = db_sigpoint_gen(db)
     return run_with_stdout(lambda: gen.print_interpretation_table())
 
+def get_semantic_name_hash():
+    # Maps each system value name, lowercased as lookups are case
+    # insensitive, to its semantic kind.
+    db = get_db_dxil()
+    kinds = dict([("sv_" + k.lower(), k) for k in db.enum_idx['SemanticKind'].value_names()
+                  if k not in ("Arbitrary", "Invalid")])
+    bucket_count, slot_count, seeds, slots = build_name_hash(sorted(kinds.keys()))
+    result = "static const unsigned kSemanticNameHashBucketCount = %d;\n" % bucket_count
+    result += "static const unsigned kSemanticNameHashSlotCount = %d;\n\n" % slot_count
+    result += "static const unsigned SemanticNameHashSeeds[] = {\n"
+    for b in range(0, bucket_count, 8):
+        result += "  " + " ".join("%d," % x for x in seeds[b:b + 8]) + "\n"
+    result += "};\n\n"
+    result += "// Semantic kind of the name in each slot; Invalid for empty slots.\n"
+    result += "static const DXIL::SemanticKind SemanticNameHashSlots[] = {\n"
+    for n in slots:
+        result += "  DXIL::SemanticKind::%s,\n" % (kinds[n] if n else "Invalid")
+    result += "};\n"
+    return result
+
 
 def RunCodeTagUpdate(file_path):
     import os
@@ -1055,8 +1162,10 @@ if __name__ == "__main__":
             'lib/HLSL/DxilValidation.cpp',
             'tools/clang/lib/Sema/gen_intrin_main_tables_15.h',
             'include/dxc/HlslIntrinsicOp.h',
+            'lib/HLSL/HLOperationLower.cpp',
             'tools/clang/tools/dxcompiler/dxcdisassembler.cpp',
             'include/dxc/HLSL/DxilSigPoint.inl',
+            'lib/HLSL/DxilSemantic.cpp',
             ]
         for relative_file_path in files:
             RunCodeTagUpdate(pj(hlsl_src_dir, relative_file_path))
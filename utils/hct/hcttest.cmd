@@ -359,6 +359,9 @@ echo  exec-exp-filter Name
 echo.
 echo Use the HCT_EXTRAS environment variable to add hcttest-before and hcttest-after hooks.
 echo.
+echo To run tests in sharded te.exe processes and compare per-test times with a
+echo baseline, use hcttestshard.py; run it with --help for its arguments.
+echo.
 echo Delete test directory and do not copy binaries or run tests:
 echo   hcttest clean
 echo.
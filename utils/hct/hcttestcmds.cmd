@@ -40,6 +40,64 @@ if %errorlevel% neq 0 (
   exit /b 1
 )
 
+rem A released dxil.dll doesn't know the compressed debug info part.
+if exist dxil.dll (
+  echo Skipping /Qcompress_debug when dxil.dll is present.
+  goto :skipcompressdebug
+)
+dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Zi /Qcompress_debug /Fo smoke.compressed.cso /Fd smoke.compressed.d 1>nul
+if %errorlevel% neq 0 (
+  echo Failed - %CD%\dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Zi /Qcompress_debug /Fo smoke.compressed.cso /Fd smoke.compressed.d
+  call :cleanup 2>nul
+  exit /b 1
+)
+rem The disassembly comes from the decompressed debug module.
+dxc.exe -dumpbin smoke.compressed.cso | findstr "DICompileUnit" 1>nul
+if %errorlevel% neq 0 (
+  echo Failed to find debug info in disassembly of smoke.compressed.cso
+  call :cleanup 2>nul
+  exit /b 1
+)
+dxc.exe smoke.compressed.cso /dumpbin /Qstrip_debug /Fo smoke.compressed.nodebug.cso 1>nul
+if %errorlevel% neq 0 (
+  echo Failed to strip compressed debug part from DXIL container blob
+  call :cleanup 2>nul
+  exit /b 1
+)
+:skipcompressdebug
+
+dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Zi /Qsidecar /Fd smoke.sidecar.d /Fo smoke.split.cso 1>nul
+if %errorlevel% neq 0 (
+  echo Failed - %CD%\dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Zi /Qsidecar /Fd smoke.sidecar.d /Fo smoke.split.cso
+  call :cleanup 2>nul
+  exit /b 1
+)
+rem The shader keeps its debug name but not its debug info.
+dxc.exe -dumpbin smoke.split.cso | findstr "DICompileUnit" 1>nul
+if %errorlevel% equ 0 (
+  echo Found debug info in smoke.split.cso written with /Qsidecar
+  call :cleanup 2>nul
+  exit /b 1
+)
+dxc.exe -dumpbin smoke.sidecar.d | findstr "DICompileUnit" 1>nul
+if %errorlevel% neq 0 (
+  echo Failed to find debug info in sidecar smoke.sidecar.d
+  call :cleanup 2>nul
+  exit /b 1
+)
+
+dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Zi /Fsp smoke.sources /Fo smoke.sourcepack.cso 1>nul
+if %errorlevel% neq 0 (
+  echo Failed - %CD%\dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Zi /Fsp smoke.sources /Fo smoke.sourcepack.cso
+  call :cleanup 2>nul
+  exit /b 1
+)
+if not exist smoke.sources (
+  echo Failed to write source pack smoke.sources with /Fsp
+  call :cleanup 2>nul
+  exit /b 1
+)
+
 rem When dxil.dll is present, /Fd with trailing will not produce a name.
 if exist dxil.dll (
   echo Skipping /Fd with trailing backslash when dxil.dll is present.
@@ -471,6 +529,23 @@ if %errorlevel% neq 0 (
   exit /b 1
 )
 
+dxa.exe smoke.cso.plain.bc smoke.ll -j 2 1>nul
+if %errorlevel% neq 0 (
+  echo Failed to assemble several inputs via dxa.exe smoke.cso.plain.bc smoke.ll -j 2
+  call :cleanup 2>nul
+  exit /b 1
+)
+if not exist smoke.cso.plain.dxbc (
+  echo Failed to find smoke.cso.plain.dxbc assembled with several inputs
+  call :cleanup 2>nul
+  exit /b 1
+)
+if not exist smoke.dxbc (
+  echo Failed to find smoke.dxbc assembled with several inputs
+  call :cleanup 2>nul
+  exit /b 1
+)
+
 echo Smoke test for dxopt command line ...
 dxc /Odump /T ps_6_0 %script_dir%\smoke.hlsl > passes.txt
 if %errorlevel% neq 0 (
@@ -504,6 +579,50 @@ if %errorlevel% neq 0 (
   exit /b 1
 )
 
+echo Smoke test for dxc remote compilation ...
+dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Fo smoke.remote.cso /remote smoke.dxcjob 1>nul
+if %errorlevel% neq 0 (
+  echo Failed to write a remote job - %CD%\dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /remote smoke.dxcjob
+  call :cleanup 2>nul
+  exit /b 1
+)
+dxc.exe /server smoke.dxcjob /Fo smoke.dxcres 1>nul
+if %errorlevel% neq 0 (
+  echo Failed to run a remote job - %CD%\dxc.exe /server smoke.dxcjob /Fo smoke.dxcres
+  call :cleanup 2>nul
+  exit /b 1
+)
+dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Fo smoke.remote.cso /remote-result smoke.dxcres 1>nul
+if %errorlevel% neq 0 (
+  echo Failed to apply a remote result - %CD%\dxc.exe /T ps_6_0 %script_dir%\smoke.hlsl /Fo smoke.remote.cso /remote-result smoke.dxcres
+  call :cleanup 2>nul
+  exit /b 1
+)
+if not exist smoke.remote.cso (
+  echo Failed to write /Fo from a remote result.
+  call :cleanup 2>nul
+  exit /b 1
+)
+
+echo Smoke test for dxc daemon ...
+(echo /T ps_6_0 %script_dir%\smoke.hlsl /Fo smoke.daemon.cso& echo /T ps_6_0 %script_dir%\smoke.hlsl /Fo smoke.daemon.cso) | dxc.exe /daemon >smoke.daemon.txt
+if %errorlevel% neq 0 (
+  echo Failed to run the dxc daemon - %CD%\dxc.exe /daemon
+  call :cleanup 2>nul
+  exit /b 1
+)
+findstr /c:"dxc-daemon: exit 0" smoke.daemon.txt 1>nul
+if %errorlevel% neq 0 (
+  echo Failed to compile with the dxc daemon.
+  call :cleanup 2>nul
+  exit /b 1
+)
+if not exist smoke.daemon.cso (
+  echo Failed to write /Fo from the dxc daemon.
+  call :cleanup 2>nul
+  exit /b 1
+)
+
 echo Smoke test for dxc_batch command line ...
 dxc_batch.exe -lib-link -multi-thread "%2"\..\CodeGenHLSL\batch_cmds2.txt 1>nul
 if %errorlevel% neq 0 (
@@ -651,6 +770,19 @@ del %CD%\private.txt
 del %CD%\private1.txt
 del %CD%\rootsig.cso
 del %CD%\smoke.cso
+del %CD%\smoke.compressed.cso
+del %CD%\smoke.compressed.d
+del %CD%\smoke.compressed.nodebug.cso
+del %CD%\smoke.split.cso
+del %CD%\smoke.sidecar.d
+del %CD%\smoke.sourcepack.cso
+del %CD%\smoke.cso.plain.dxbc
+del %CD%\smoke.dxbc
+del %CD%\smoke.sources
+del %CD%\smoke.daemon.cso
+del %CD%\smoke.daemon.txt
+del %CD%\smoke.dxcjob
+del %CD%\smoke.dxcres
 del %CD%\smoke.cso.ll
 del %CD%\smoke.cso.plain.bc
 del %CD%\smoke.hl.txt
@@ -664,6 +796,7 @@ del %CD%\smoke.opt.ll
 del %CD%\smoke.opt.prn.txt
 del %CD%\smoke.rebuilt-container.cso
 del %CD%\smoke.rebuilt-container2.cso
+del %CD%\smoke.remote.cso
 rem SPIR-V Change Starts
 del %CD%\smoke.spirv.log
 rem SPIR-V Change Ends
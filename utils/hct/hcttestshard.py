@@ -0,0 +1,181 @@
+# Copyright (C) Microsoft Corporation. All rights reserved.
+# This file is distributed under the University of Illinois Open Source License. See LICENSE.TXT for details.
+"""Runs the TAEF tests of a test DLL in parallel shards and compares per-test
+times against a baseline.
+
+The tests are listed with te.exe /listNames and split into shards. With a
+baseline, the shards are balanced by the baseline times; otherwise tests are
+dealt out in turn. Each shard runs in its own te.exe process, so that the
+class setup, and with it the loaded DxcDllSupport, is shared by the tests of
+the shard. Tests write their wall times through the TestTimingFile parameter.
+
+Example:
+  hcttestshard.py --dll %HLSL_BLD_DIR%\\Debug\\test\\clang-hlsl-tests.dll
+      --p HlslDataDir=%HLSL_SRC_DIR%\\tools\\clang\\test\\HLSL
+      --select "@Name='CompilerTest::*'" --baseline base.tsv --timings new.tsv
+"""
+import argparse
+import multiprocessing
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+
+# te.exe has to fit the selection on its command line.
+MAX_SELECT_LENGTH = 24000
+
+def list_tests(args):
+    cmd = [args.te, args.dll, '/listNames', '/select:' + args.select]
+    out = subprocess.check_output(cmd, universal_newlines=True)
+    names = []
+    for line in out.splitlines():
+        m = re.match(r'^\s+([A-Za-z_]\w*::[\w:#]+)\s*$', line)
+        if m:
+            names.append(m.group(1))
+    return names
+
+def read_timings(path):
+    timings = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.rstrip('\n').split('\t')
+            if len(fields) == 2:
+                # A test run twice keeps its larger time.
+                timings[fields[0]] = max(timings.get(fields[0], 0.0), float(fields[1]))
+    return timings
+
+def write_timings(path, timings):
+    with open(path, 'w') as f:
+        for name in sorted(timings):
+            f.write('%s\t%.3f\n' % (name, timings[name]))
+
+def make_shards(names, count, baseline):
+    shards = [[] for _ in range(count)]
+    if not baseline:
+        for i, name in enumerate(names):
+            shards[i % count].append(name)
+        return shards
+    # Longest tests first, each to the shard with the least time so far.
+    totals = [0.0] * count
+    default = sum(baseline.values()) / len(baseline)
+    for name in sorted(names, key=lambda n: -baseline.get(n, default)):
+        i = totals.index(min(totals))
+        shards[i].append(name)
+        totals[i] += baseline.get(name, default)
+    return shards
+
+def selections(names):
+    """Splits names into /select queries that fit on a command line."""
+    query = ''
+    for name in names:
+        term = "@Name='%s'" % name
+        if query and len(query) + len(term) + 4 > MAX_SELECT_LENGTH:
+            yield query
+            query = ''
+        query = term if not query else query + ' OR ' + term
+    if query:
+        yield query
+
+def run_shard(args, index, names, timing_path, results):
+    failed = False
+    log_path = os.path.join(args.log_dir, 'shard%d.log' % index)
+    with open(log_path, 'w') as log:
+        for query in selections(names):
+            cmd = [args.te, args.dll, '/labMode', '/miniDumpOnCrash',
+                   '/logOutput:LowWithConsoleBuffering', '/select:' + query,
+                   '/p:TestTimingFile=' + timing_path]
+            cmd += ['/p:' + p for p in args.p]
+            cmd += args.te_args
+            log.flush()
+            if subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT) != 0:
+                failed = True
+    results[index] = (failed, log_path)
+
+def compare(baseline, timings, threshold, min_ms):
+    """Returns (name, baseline ms, ms) for tests whose time changed by more
+    than threshold percent, ignoring tests under min_ms in both runs."""
+    changed = []
+    for name in sorted(timings):
+        if name not in baseline:
+            continue
+        old, new = baseline[name], timings[name]
+        if max(old, new) < min_ms:
+            continue
+        if abs(new - old) * 100 > threshold * max(old, 0.001):
+            changed.append((name, old, new))
+    return changed
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--te', default='te.exe', help='path to te.exe')
+    parser.add_argument('--dll', required=True, help='TAEF test DLL to run')
+    parser.add_argument('--select', default='@Priority<1',
+                        help='TAEF selection of the tests to run')
+    parser.add_argument('--p', action='append', default=[],
+                        help='NAME=VALUE runtime parameter for the tests')
+    parser.add_argument('--shards', type=int,
+                        default=max(1, multiprocessing.cpu_count() - 1),
+                        help='number of te.exe processes run at once')
+    parser.add_argument('--timings', help='file to write per-test times to')
+    parser.add_argument('--baseline', help='per-test times to compare with')
+    parser.add_argument('--threshold', type=float, default=25,
+                        help='percent change in time that flags a test')
+    parser.add_argument('--min-ms', type=float, default=50,
+                        help='time under which changes are not flagged')
+    parser.add_argument('--log-dir', help='directory for the shard logs')
+    parser.add_argument('te_args', nargs='*', help='more te.exe arguments')
+    args = parser.parse_args()
+
+    if not args.log_dir:
+        args.log_dir = tempfile.mkdtemp(prefix='hcttestshard')
+    baseline = read_timings(args.baseline) if args.baseline else {}
+    names = list_tests(args)
+    if not names:
+        print('No tests match %s.' % args.select)
+        return 1
+    shards = [s for s in make_shards(names, args.shards, baseline) if s]
+    print('Running %d tests in %d shards; logs are in %s.' %
+          (len(names), len(shards), args.log_dir))
+
+    timing_paths = [os.path.join(args.log_dir, 'shard%d.tsv' % i)
+                    for i in range(len(shards))]
+    for path in timing_paths:
+        if os.path.exists(path):
+            os.remove(path)
+    results = [None] * len(shards)
+    threads = [threading.Thread(target=run_shard,
+                                args=(args, i, shards[i], timing_paths[i], results))
+               for i in range(len(shards))]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    timings = {}
+    for path in timing_paths:
+        if os.path.exists(path):
+            for name, ms in read_timings(path).items():
+                timings[name] = max(timings.get(name, 0.0), ms)
+    if args.timings:
+        write_timings(args.timings, timings)
+
+    status = 0
+    for failed, log_path in results:
+        if failed:
+            print('Failures in %s' % log_path)
+            status = 1
+    if baseline:
+        changed = compare(baseline, timings, args.threshold, args.min_ms)
+        for name, old, new in changed:
+            print('%10.1f ms -> %10.1f ms (%+6.1f%%)  %s' %
+                  (old, new, (new - old) * 100 / max(old, 0.001), name))
+        print('%d of %d tests changed by more than %g%%.' %
+              (len(changed), len(timings), args.threshold))
+        if changed and status == 0:
+            status = 2
+    return status
+
+if __name__ == '__main__':
+    sys.exit(main())